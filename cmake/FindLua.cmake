@@ -27,6 +27,9 @@
 #  LUA_LIBRARY = path to where liblua.so* (and liblualib.so* for lua <can be found (on non glibc based systems)
 #
 #  LUA_FOUND = is liblua usable on system?
+#
+# If ENABLE_LUAJIT is set, LuaJIT is searched first (with the Lua 5.1 API),
+# then reference Lua is used if LuaJIT is not found.
 
 if(LUA_FOUND)
    # Already in cache, be silent
@@ -34,6 +37,9 @@ if(LUA_FOUND)
 endif()
 
 find_package(PkgConfig)
-if(PKG_CONFIG_FOUND)
+if(PKG_CONFIG_FOUND AND ENABLE_LUAJIT)
+  pkg_search_module(LUA luajit)
+endif()
+if(PKG_CONFIG_FOUND AND NOT LUA_FOUND)
   pkg_search_module(LUA lua5.3 lua-5.3 lua53 lua5.2 lua-5.2 lua52 lua5.1 lua-5.1 lua51 lua-5.0 lua5.0 lua50 lua)
 endif()
@@ -0,0 +1,51 @@
+#
+# Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+#
+# This file is part of WeeChat, the extensible chat client.
+#
+# WeeChat is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# WeeChat is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# - Find PCRE2
+# This module finds if libpcre2-8 is installed and determines where
+# the include files and libraries are.
+#
+# This code sets the following variables:
+#
+#  PCRE2_INCLUDE_PATH = path to where pcre2.h can be found
+#  PCRE2_LIBRARY = path to where libpcre2-8.so* can be found
+
+if(PCRE2_FOUND)
+  # Already in cache, be silent
+  set(PCRE2_FIND_QUIETLY TRUE)
+endif()
+
+find_path(PCRE2_INCLUDE_PATH
+  NAMES pcre2.h
+  PATHS /usr/include /usr/local/include /usr/pkg/include
+)
+
+find_library(PCRE2_LIBRARY
+  NAMES pcre2-8
+  PATHS /lib /usr/lib /usr/local/lib /usr/pkg/lib
+)
+
+if(PCRE2_INCLUDE_PATH AND PCRE2_LIBRARY)
+  set(PCRE2_FOUND TRUE)
+endif()
+
+mark_as_advanced(
+  PCRE2_INCLUDE_PATH
+  PCRE2_LIBRARY
+  )
@@ -0,0 +1,51 @@
+#
+# Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+#
+# This file is part of WeeChat, the extensible chat client.
+#
+# WeeChat is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# WeeChat is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# - Find Zstandard
+# This module finds if libzstd is installed and determines where
+# the include files and libraries are.
+#
+# This code sets the following variables:
+#
+#  ZSTD_INCLUDE_PATH = path to where zstd.h can be found
+#  ZSTD_LIBRARY = path to where libzstd.so* can be found
+
+if(ZSTD_FOUND)
+  # Already in cache, be silent
+  set(ZSTD_FIND_QUIETLY TRUE)
+endif()
+
+find_path(ZSTD_INCLUDE_PATH
+  NAMES zstd.h
+  PATHS /usr/include /usr/local/include /usr/pkg/include
+)
+
+find_library(ZSTD_LIBRARY
+  NAMES zstd
+  PATHS /lib /usr/lib /usr/local/lib /usr/pkg/lib
+)
+
+if(ZSTD_INCLUDE_PATH AND ZSTD_LIBRARY)
+  set(ZSTD_FOUND TRUE)
+endif()
+
+mark_as_advanced(
+  ZSTD_INCLUDE_PATH
+  ZSTD_LIBRARY
+  )
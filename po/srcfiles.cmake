@@ -2,6 +2,8 @@ SET(WEECHAT_SOURCES
 ./doc/docgen.py
 ./src/core/wee-arraylist.c
 ./src/core/wee-arraylist.h
+./src/core/wee-async.c
+./src/core/wee-async.h
 ./src/core/wee-backtrace.c
 ./src/core/wee-backtrace.h
 ./src/core/weechat.c
@@ -24,18 +26,27 @@ SET(WEECHAT_SOURCES
 ./src/core/wee-infolist.h
 ./src/core/wee-input.c
 ./src/core/wee-input.h
+./src/core/wee-latency.c
+./src/core/wee-latency.h
 ./src/core/wee-list.c
 ./src/core/wee-list.h
 ./src/core/wee-log.c
 ./src/core/wee-log.h
+./src/core/wee-metrics.c
+./src/core/wee-metrics.h
 ./src/core/wee-network.c
 ./src/core/wee-network.h
+./src/core/wee-profile.c
+./src/core/wee-profile.h
 ./src/core/wee-proxy.c
 ./src/core/wee-proxy.h
 ./src/core/wee-secure.c
 ./src/core/wee-secure.h
+./src/core/wee-spawn.c
+./src/core/wee-spawn.h
 ./src/core/wee-string.c
 ./src/core/wee-string.h
+./src/core/wee-trace.h
 ./src/core/wee-upgrade.c
 ./src/core/wee-upgrade-file.c
 ./src/core/wee-upgrade-file.h
@@ -56,6 +67,7 @@ SET(WEECHAT_SOURCES
 ./src/gui/curses/gui-curses-main.c
 ./src/gui/curses/gui-curses-mouse.c
 ./src/gui/curses/gui-curses-window.c
+./src/gui/curses/headless/main.c
 ./src/gui/curses/main.c
 ./src/gui/gui-bar.c
 ./src/gui/gui-bar.h
@@ -89,6 +101,14 @@ SET(WEECHAT_SOURCES
 ./src/gui/gui-layout.h
 ./src/gui/gui-line.c
 ./src/gui/gui-line.h
+./src/gui/gui-line-cold.c
+./src/gui/gui-line-cold.h
+./src/gui/gui-line-cursor.c
+./src/gui/gui-line-cursor.h
+./src/gui/gui-line-index.c
+./src/gui/gui-line-index.h
+./src/gui/gui-line-scroll.c
+./src/gui/gui-line-scroll.h
 ./src/gui/gui-main.h
 ./src/gui/gui-mouse.c
 ./src/gui/gui-mouse.h
@@ -96,6 +116,8 @@ SET(WEECHAT_SOURCES
 ./src/gui/gui-nick.h
 ./src/gui/gui-nicklist.c
 ./src/gui/gui-nicklist.h
+./src/gui/gui-search.c
+./src/gui/gui-search.h
 ./src/gui/gui-window.c
 ./src/gui/gui-window.h
 ./src/plugins/alias/alias.c
@@ -141,12 +163,16 @@ SET(WEECHAT_SOURCES
 ./src/plugins/fifo/fifo-config.h
 ./src/plugins/fifo/fifo-info.c
 ./src/plugins/fifo/fifo-info.h
+./src/plugins/fifo/fifo-socket.c
+./src/plugins/fifo/fifo-socket.h
 ./src/plugins/guile/weechat-guile-api.c
 ./src/plugins/guile/weechat-guile-api.h
 ./src/plugins/guile/weechat-guile.c
 ./src/plugins/guile/weechat-guile.h
 ./src/plugins/irc/irc-bar-item.c
 ./src/plugins/irc/irc-bar-item.h
+./src/plugins/irc/irc-batch.c
+./src/plugins/irc/irc-batch.h
 ./src/plugins/irc/irc-buffer.c
 ./src/plugins/irc/irc-buffer.h
 ./src/plugins/irc/irc.c
@@ -185,6 +211,8 @@ SET(WEECHAT_SOURCES
 ./src/plugins/irc/irc-protocol.h
 ./src/plugins/irc/irc-raw.c
 ./src/plugins/irc/irc-raw.h
+./src/plugins/irc/irc-reader.c
+./src/plugins/irc/irc-reader.h
 ./src/plugins/irc/irc-redirect.c
 ./src/plugins/irc/irc-redirect.h
 ./src/plugins/irc/irc-sasl.c
@@ -197,16 +225,24 @@ SET(WEECHAT_SOURCES
 ./src/plugins/javascript/weechat-js-v8.h
 ./src/plugins/javascript/weechat-js.cpp
 ./src/plugins/javascript/weechat-js.h
+./src/plugins/logger/logger-backlog.c
+./src/plugins/logger/logger-backlog.h
 ./src/plugins/logger/logger-buffer.c
 ./src/plugins/logger/logger-buffer.h
 ./src/plugins/logger/logger.c
 ./src/plugins/logger/logger-config.c
 ./src/plugins/logger/logger-config.h
 ./src/plugins/logger/logger.h
+./src/plugins/logger/logger-index.c
+./src/plugins/logger/logger-index.h
 ./src/plugins/logger/logger-info.c
 ./src/plugins/logger/logger-info.h
+./src/plugins/logger/logger-rotate.c
+./src/plugins/logger/logger-rotate.h
 ./src/plugins/logger/logger-tail.c
 ./src/plugins/logger/logger-tail.h
+./src/plugins/logger/logger-writer.c
+./src/plugins/logger/logger-writer.h
 ./src/plugins/lua/weechat-lua-api.c
 ./src/plugins/lua/weechat-lua-api.h
 ./src/plugins/lua/weechat-lua.c
@@ -231,6 +267,10 @@ SET(WEECHAT_SOURCES
 ./src/plugins/python/weechat-python.h
 ./src/plugins/relay/irc/relay-irc.c
 ./src/plugins/relay/irc/relay-irc.h
+./src/plugins/relay/irc/relay-irc-backlog.c
+./src/plugins/relay/irc/relay-irc-backlog.h
+./src/plugins/relay/metrics/relay-metrics.c
+./src/plugins/relay/metrics/relay-metrics.h
 ./src/plugins/relay/relay-buffer.c
 ./src/plugins/relay/relay-buffer.h
 ./src/plugins/relay/relay.c
@@ -0,0 +1,306 @@
+/*
+ * wee-async.c - events posted by threads, executed by the main thread
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Any thread (main thread or not) can post an event: the event is added in
+ * a queue (protected by a mutex), and the main thread is woken up with a
+ * pipe watched by a fd hook (only one byte is written in the pipe until the
+ * main thread takes the events).
+ *
+ * Events are executed by the main thread once per main loop iteration, in
+ * the order they were posted; events posted by callbacks are executed on
+ * next iteration.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "weechat.h"
+#include "wee-async.h"
+#include "wee-hook.h"
+#include "../plugins/plugin.h"
+
+
+pthread_mutex_t async_mutex = PTHREAD_MUTEX_INITIALIZER;
+struct t_async_event *async_events = NULL;       /* events posted           */
+struct t_async_event *last_async_event = NULL;   /* last event posted       */
+int async_wakeup_pending = 0;          /* 1 if a byte is in the pipe        */
+int async_pipe[2] = { -1, -1 };        /* pipe to wake up main thread       */
+struct t_hook *async_hook_fd = NULL;   /* hook on read end of pipe          */
+
+struct t_async_event *async_events_running = NULL; /* events taken by main  */
+                                                   /* thread, to execute    */
+
+
+/*
+ * Callback for fd hook on pipe: empties the pipe (events are executed by the
+ * main loop).
+ */
+
+int
+async_pipe_read_cb (const void *pointer, void *data, int fd)
+{
+    char buffer[64];
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    while (read (fd, buffer, sizeof (buffer)) > 0)
+    {
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Initializes queue of events.
+ */
+
+void
+async_init ()
+{
+    int i, flags;
+
+    if (pipe (async_pipe) < 0)
+    {
+        async_pipe[0] = -1;
+        async_pipe[1] = -1;
+        return;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        flags = fcntl (async_pipe[i], F_GETFL);
+        if (flags == -1)
+            flags = 0;
+        fcntl (async_pipe[i], F_SETFL, flags | O_NONBLOCK);
+        /* the new process started by /upgrade must not use this pipe */
+        fcntl (async_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    async_hook_fd = hook_fd (NULL, async_pipe[0], 1, 0, 0,
+                             &async_pipe_read_cb, NULL, NULL);
+}
+
+/*
+ * Posts an event: the callback will be called by the main thread, as soon as
+ * possible.
+ *
+ * This function can be called by any thread.
+ *
+ * Argument "callback_data", if not NULL, must have been allocated by malloc
+ * (or similar function), it is freed after the call to callback (or if the
+ * event is discarded because the plugin is unloaded).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+async_post (struct t_weechat_plugin *plugin,
+            t_async_callback *callback,
+            const void *callback_pointer,
+            void *callback_data)
+{
+    struct t_async_event *new_event;
+
+    if (!callback || (async_pipe[1] < 0))
+        return 0;
+
+    new_event = malloc (sizeof (*new_event));
+    if (!new_event)
+        return 0;
+
+    new_event->plugin = plugin;
+    new_event->callback = callback;
+    new_event->callback_pointer = callback_pointer;
+    new_event->callback_data = callback_data;
+    new_event->next_event = NULL;
+
+    pthread_mutex_lock (&async_mutex);
+
+    if (last_async_event)
+        last_async_event->next_event = new_event;
+    else
+        async_events = new_event;
+    last_async_event = new_event;
+
+    if (!async_wakeup_pending)
+    {
+        async_wakeup_pending = 1;
+        if (write (async_pipe[1], "1", 1) < 0)
+        {
+            /* pipe full: main thread is already woken up */
+        }
+    }
+
+    pthread_mutex_unlock (&async_mutex);
+
+    return 1;
+}
+
+/*
+ * Frees an event.
+ */
+
+void
+async_event_free (struct t_async_event *event)
+{
+    if (event->callback_data)
+        free (event->callback_data);
+    free (event);
+}
+
+/*
+ * Executes events posted (called by the main loop).
+ */
+
+void
+async_exec ()
+{
+    struct t_async_event *ptr_event;
+
+    pthread_mutex_lock (&async_mutex);
+    if (!async_events)
+    {
+        pthread_mutex_unlock (&async_mutex);
+        return;
+    }
+    async_events_running = async_events;
+    async_events = NULL;
+    last_async_event = NULL;
+    async_wakeup_pending = 0;
+    pthread_mutex_unlock (&async_mutex);
+
+    /*
+     * the next event is taken from the list at each iteration, because a
+     * callback can unload a plugin (its events are removed from the list)
+     */
+    while (async_events_running)
+    {
+        ptr_event = async_events_running;
+        async_events_running = ptr_event->next_event;
+        (void) (ptr_event->callback) (ptr_event->callback_pointer,
+                                      ptr_event->callback_data);
+        async_event_free (ptr_event);
+    }
+}
+
+/*
+ * Removes events of a list posted by a plugin.
+ *
+ * Returns the new head of list, and updates "last_event" (if not NULL).
+ */
+
+struct t_async_event *
+async_remove_plugin_events (struct t_async_event *events,
+                            struct t_async_event **last_event,
+                            struct t_weechat_plugin *plugin)
+{
+    struct t_async_event *ptr_event, *prev_event, *next_event;
+
+    prev_event = NULL;
+    ptr_event = events;
+    while (ptr_event)
+    {
+        next_event = ptr_event->next_event;
+        if (ptr_event->plugin == plugin)
+        {
+            if (prev_event)
+                prev_event->next_event = next_event;
+            else
+                events = next_event;
+            async_event_free (ptr_event);
+        }
+        else
+        {
+            prev_event = ptr_event;
+        }
+        ptr_event = next_event;
+    }
+
+    if (last_event)
+        *last_event = prev_event;
+
+    return events;
+}
+
+/*
+ * Removes all events posted by a plugin (called when the plugin is
+ * unloaded).
+ */
+
+void
+async_remove_plugin (struct t_weechat_plugin *plugin)
+{
+    async_events_running = async_remove_plugin_events (async_events_running,
+                                                       NULL, plugin);
+
+    pthread_mutex_lock (&async_mutex);
+    async_events = async_remove_plugin_events (async_events,
+                                               &last_async_event, plugin);
+    pthread_mutex_unlock (&async_mutex);
+}
+
+/*
+ * Ends queue of events: events not executed are discarded.
+ */
+
+void
+async_end ()
+{
+    struct t_async_event *ptr_next_event;
+
+    if (async_hook_fd)
+    {
+        unhook (async_hook_fd);
+        async_hook_fd = NULL;
+    }
+
+    pthread_mutex_lock (&async_mutex);
+    while (async_events)
+    {
+        ptr_next_event = async_events->next_event;
+        async_event_free (async_events);
+        async_events = ptr_next_event;
+    }
+    last_async_event = NULL;
+    async_wakeup_pending = 0;
+    if (async_pipe[0] >= 0)
+    {
+        close (async_pipe[0]);
+        async_pipe[0] = -1;
+    }
+    if (async_pipe[1] >= 0)
+    {
+        close (async_pipe[1]);
+        async_pipe[1] = -1;
+    }
+    pthread_mutex_unlock (&async_mutex);
+}
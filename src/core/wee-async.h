@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_ASYNC_H
+#define WEECHAT_ASYNC_H 1
+
+struct t_weechat_plugin;
+
+typedef int (t_async_callback)(const void *pointer, void *data);
+
+/* event posted by any thread, executed by the main thread */
+
+struct t_async_event
+{
+    struct t_weechat_plugin *plugin;   /* plugin which posted the event     */
+    t_async_callback *callback;        /* callback                          */
+    const void *callback_pointer;      /* pointer sent to callback          */
+    void *callback_data;               /* data sent to callback (freed      */
+                                       /* after the call)                   */
+    struct t_async_event *next_event;  /* link to next event                */
+};
+
+extern void async_init ();
+extern int async_post (struct t_weechat_plugin *plugin,
+                       t_async_callback *callback,
+                       const void *callback_pointer,
+                       void *callback_data);
+extern void async_exec ();
+extern void async_remove_plugin (struct t_weechat_plugin *plugin);
+extern void async_end ();
+
+#endif /* WEECHAT_ASYNC_H */
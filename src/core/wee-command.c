@@ -49,10 +49,13 @@
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-input.h"
+#include "wee-latency.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-profile.h"
 #include "wee-proxy.h"
 #include "wee-secure.h"
+#include "wee-spawn.h"
 #include "wee-string.h"
 #include "wee-upgrade.h"
 #include "wee-utf8.h"
@@ -73,6 +76,7 @@
 #include "../gui/gui-line.h"
 #include "../gui/gui-main.h"
 #include "../gui/gui-mouse.h"
+#include "../gui/gui-search.h"
 #include "../gui/gui-window.h"
 #include "../plugins/plugin.h"
 #include "../plugins/plugin-config.h"
@@ -1689,6 +1693,8 @@ COMMAND_CALLBACK(debug)
     struct t_config_option *ptr_option;
     struct t_weechat_plugin *ptr_plugin;
     struct timeval time_start, time_end;
+    char *error;
+    long number;
     int debug;
 
     /* make C compiler happy */
@@ -1743,6 +1749,12 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "config") == 0)
+    {
+        debug_config ();
+        return WEECHAT_RC_OK;
+    }
+
     if (string_strcasecmp (argv[1], "cursor") == 0)
     {
         if (gui_cursor_debug)
@@ -1767,7 +1779,36 @@ COMMAND_CALLBACK(debug)
 
     if (string_strcasecmp (argv[1], "hooks") == 0)
     {
-        debug_hooks ();
+        if (argc > 2)
+        {
+            if (string_strcasecmp (argv[2], "reset") == 0)
+            {
+                hook_stats_reset ();
+                gui_chat_printf (NULL,
+                                 _("Statistics on hook callbacks have been "
+                                   "reset"));
+                return WEECHAT_RC_OK;
+            }
+            if (string_strcasecmp (argv[2], "calls") == 0)
+                debug = DEBUG_HOOKS_SORT_CALLS;
+            else if (string_strcasecmp (argv[2], "total") == 0)
+                debug = DEBUG_HOOKS_SORT_TOTAL;
+            else if (string_strcasecmp (argv[2], "max") == 0)
+                debug = DEBUG_HOOKS_SORT_MAX;
+            else
+                COMMAND_ERROR;
+            number = 20;
+            if (argc > 3)
+            {
+                error = NULL;
+                number = strtol (argv[3], &error, 10);
+                if (!error || error[0] || (number < 0))
+                    COMMAND_ERROR;
+            }
+            debug_hooks_callbacks (debug, (int)number);
+        }
+        else
+            debug_hooks ();
         return WEECHAT_RC_OK;
     }
 
@@ -1777,6 +1818,34 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "latency") == 0)
+    {
+        if (argc < 3)
+        {
+            latency_display ();
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "start") == 0)
+        {
+            latency_start ();
+            gui_chat_printf (NULL, _("Latency tracing started"));
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "stop") == 0)
+        {
+            latency_stop ();
+            latency_display ();
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "reset") == 0)
+        {
+            latency_reset ();
+            gui_chat_printf (NULL, _("Latency tracing has been reset"));
+            return WEECHAT_RC_OK;
+        }
+        COMMAND_ERROR;
+    }
+
     if (string_strcasecmp (argv[1], "libs") == 0)
     {
         gui_chat_printf (NULL, "");
@@ -1787,7 +1856,10 @@ COMMAND_CALLBACK(debug)
 
     if (string_strcasecmp (argv[1], "memory") == 0)
     {
-        debug_memory ();
+        if ((argc > 2) && (string_strcasecmp (argv[2], "detail") == 0))
+            debug_memory_detail ();
+        else
+            debug_memory ();
         return WEECHAT_RC_OK;
     }
 
@@ -1804,9 +1876,45 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "profile") == 0)
+    {
+        if (argc < 3)
+        {
+            profile_display ();
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "start") == 0)
+        {
+            if (profile_start ())
+            {
+                gui_chat_printf (NULL, _("Profiler started"));
+            }
+            else
+            {
+                gui_chat_printf (NULL,
+                                 _("%sUnable to start profiler"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR]);
+            }
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "stop") == 0)
+        {
+            profile_stop ();
+            profile_display ();
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "dump") == 0)
+        {
+            profile_dump ((argc > 3) ? argv_eol[3] : NULL);
+            return WEECHAT_RC_OK;
+        }
+        COMMAND_ERROR;
+    }
+
     if (string_strcasecmp (argv[1], "tags") == 0)
     {
         gui_chat_display_tags ^= 1;
+        gui_chat_layout_invalidate ();
         gui_window_ask_refresh (2);
         return WEECHAT_RC_OK;
     }
@@ -2120,7 +2228,9 @@ COMMAND_CALLBACK(filter)
                     if (!ptr_filter->enabled)
                     {
                         ptr_filter->enabled = 1;
-                        gui_filter_all_buffers ();
+                        gui_filter_all_buffers (ptr_filter);
+                        config_file_set_dirty (weechat_config_file,
+                                               weechat_config_section_filter);
                         gui_chat_printf_date_tags (NULL, 0,
                                                    GUI_FILTER_TAG_NO_FILTER,
                                                    _("Filter \"%s\" enabled"),
@@ -2175,7 +2285,9 @@ COMMAND_CALLBACK(filter)
                     if (ptr_filter->enabled)
                     {
                         ptr_filter->enabled = 0;
-                        gui_filter_all_buffers ();
+                        gui_filter_all_buffers (ptr_filter);
+                        config_file_set_dirty (weechat_config_file,
+                                               weechat_config_section_filter);
                         gui_chat_printf_date_tags (NULL, 0,
                                                    GUI_FILTER_TAG_NO_FILTER,
                                                    _("Filter \"%s\" disabled"),
@@ -2225,7 +2337,9 @@ COMMAND_CALLBACK(filter)
                 if (ptr_filter)
                 {
                     ptr_filter->enabled ^= 1;
-                    gui_filter_all_buffers ();
+                    gui_filter_all_buffers (ptr_filter);
+                    config_file_set_dirty (weechat_config_file,
+                                           weechat_config_section_filter);
                 }
                 else
                 {
@@ -2266,7 +2380,7 @@ COMMAND_CALLBACK(filter)
                                      argv_eol[5]);
         if (ptr_filter)
         {
-            gui_filter_all_buffers ();
+            gui_filter_all_buffers (ptr_filter);
             gui_chat_printf (NULL, "");
             gui_chat_printf_date_tags (NULL, 0, GUI_FILTER_TAG_NO_FILTER,
                                        _("Filter \"%s\" added:"),
@@ -2320,7 +2434,7 @@ COMMAND_CALLBACK(filter)
             if (gui_filters)
             {
                 gui_filter_free_all ();
-                gui_filter_all_buffers ();
+                gui_filter_all_buffers (NULL);
                 gui_chat_printf_date_tags (NULL, 0, GUI_FILTER_TAG_NO_FILTER,
                                            _("All filters have been deleted"));
             }
@@ -2335,8 +2449,10 @@ COMMAND_CALLBACK(filter)
             ptr_filter = gui_filter_search_by_name (argv[2]);
             if (ptr_filter)
             {
+                /* display lines hidden by this filter before freeing it */
+                ptr_filter->enabled = 0;
+                gui_filter_all_buffers (ptr_filter);
                 gui_filter_free (ptr_filter);
-                gui_filter_all_buffers ();
                 gui_chat_printf_date_tags (NULL, 0, GUI_FILTER_TAG_NO_FILTER,
                                            _("Filter \"%s\" deleted"),
                                            argv[2]);
@@ -3851,6 +3967,8 @@ COMMAND_CALLBACK(layout)
             if (flag_windows)
                 gui_layout_window_apply (ptr_layout, -1);
             gui_layout_current = ptr_layout;
+            config_file_set_dirty (weechat_config_file,
+                                   weechat_config_section_layout);
         }
 
         return WEECHAT_RC_OK;
@@ -3863,6 +3981,8 @@ COMMAND_CALLBACK(layout)
         gui_layout_window_reset ();
 
         gui_layout_current = NULL;
+        config_file_set_dirty (weechat_config_file,
+                               weechat_config_section_layout);
 
         gui_chat_printf (NULL,
                          _("Layout of buffers+windows reset (current layout: -)"));
@@ -5234,6 +5354,113 @@ COMMAND_CALLBACK(save)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Callback for command "/search": search text in lines of buffers.
+ */
+
+COMMAND_CALLBACK(search)
+{
+    const char *ptr_buffers, *ptr_tags;
+    char *error;
+    int i, case_sensitive, regex;
+    long value;
+    time_t since;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) buffer;
+
+    COMMAND_MIN_ARGS(2, "");
+
+    if (string_strcasecmp (argv[1], "-stop") == 0)
+    {
+        if (!gui_search_stop ())
+        {
+            gui_chat_printf (NULL,
+                             _("%sNo search in progress"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR]);
+        }
+        return WEECHAT_RC_OK;
+    }
+
+    ptr_buffers = NULL;
+    ptr_tags = NULL;
+    since = 0;
+    case_sensitive = 0;
+    regex = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (string_strcasecmp (argv[i], "-buffer") == 0)
+        {
+            if (i + 1 >= argc)
+                COMMAND_ERROR;
+            i++;
+            ptr_buffers = argv[i];
+        }
+        else if (string_strcasecmp (argv[i], "-tags") == 0)
+        {
+            if (i + 1 >= argc)
+                COMMAND_ERROR;
+            i++;
+            ptr_tags = argv[i];
+        }
+        else if (string_strcasecmp (argv[i], "-since") == 0)
+        {
+            if (i + 1 >= argc)
+                COMMAND_ERROR;
+            i++;
+            error = NULL;
+            value = strtol (argv[i], &error, 10);
+            if (!error || (value < 0))
+                COMMAND_ERROR;
+            if (error[0])
+            {
+                if (error[1])
+                    COMMAND_ERROR;
+                switch (error[0])
+                {
+                    case 's':
+                        break;
+                    case 'm':
+                        value *= 60;
+                        break;
+                    case 'h':
+                        value *= 60 * 60;
+                        break;
+                    case 'd':
+                        value *= 60 * 60 * 24;
+                        break;
+                    default:
+                        COMMAND_ERROR;
+                }
+            }
+            since = time (NULL) - value;
+        }
+        else if (string_strcasecmp (argv[i], "-regex") == 0)
+        {
+            regex = 1;
+        }
+        else if (string_strcasecmp (argv[i], "-case") == 0)
+        {
+            case_sensitive = 1;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (i >= argc)
+        COMMAND_ERROR;
+
+    gui_search_start (argv_eol[i], ptr_buffers, ptr_tags, since,
+                      case_sensitive, regex);
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Displays a secured data.
  */
@@ -6143,6 +6370,7 @@ COMMAND_CALLBACK(upgrade)
         (void) config_weechat_write ();
     gui_main_end (1);
     log_close ();
+    spawn_end ();
 
     if (quit)
     {
@@ -7182,9 +7410,13 @@ command_init ()
         N_("list"
            " || set <plugin> <level>"
            " || dump [<plugin>]"
-           " || buffer|color|infolists|memory|tags|term|windows"
+           " || buffer|color|config|infolists|tags|term|windows"
+           " || memory [detail]"
            " || mouse|cursor [verbose]"
            " || hdata [free]"
+           " || hooks [calls|total|max [<number>]|reset]"
+           " || latency [start|stop|reset]"
+           " || profile [start|stop|dump [<filename>]]"
            " || time <command>"),
         N_("     list: list plugins with debug levels\n"
            "      set: set debug level for plugin\n"
@@ -7194,15 +7426,31 @@ command_init ()
            "written when WeeChat crashes)\n"
            "   buffer: dump buffer content with hexadecimal values in log file\n"
            "    color: display infos about current color pairs\n"
+           "   config: display time spent to read and write configuration "
+           "files\n"
            "   cursor: toggle debug for cursor mode\n"
            "     dirs: display directories\n"
            "    hdata: display infos about hdata (with free: remove all hdata "
            "in memory)\n"
-           "    hooks: display infos about hooks\n"
+           "    hooks: display infos about hooks (with calls/total/max: "
+           "display statistics on hook callbacks, sorted by number of calls, "
+           "total time or max time, only the first <number> hooks (20 by "
+           "default, 0 = all); with reset: reset statistics)\n"
            "infolists: display infos about infolists\n"
+           "  latency: display latency of messages received, by stage: "
+           "queue (received -> processed), process (received -> line "
+           "added), display (line added -> screen refreshed), screen "
+           "(received -> screen refreshed), relay (received -> sent to "
+           "relay client) (with start/stop: start/stop tracing; with reset: "
+           "reset statistics)\n"
            "     libs: display infos about external libraries used\n"
-           "   memory: display infos about memory usage\n"
+           "   memory: display infos about memory usage (with detail: display "
+           "memory used by buffers and plugins)\n"
            "    mouse: toggle debug for mouse\n"
+           "  profile: display data of sampling profiler (with start/stop: "
+           "start/stop profiler; with dump: write stacks in a file for flame "
+           "graphs, default file is \"" PROFILE_FILENAME "\" in WeeChat "
+           "home)\n"
            "     tags: display tags for lines\n"
            "     term: display infos about terminal\n"
            "  windows: display windows tree\n"
@@ -7213,14 +7461,17 @@ command_init ()
         " || dump %(plugins_names)|" PLUGIN_CORE
         " || buffer"
         " || color"
+        " || config"
         " || cursor verbose"
         " || dirs"
         " || hdata free"
-        " || hooks"
+        " || hooks calls|total|max|reset"
         " || infolists"
+        " || latency start|stop|reset"
         " || libs"
-        " || memory"
+        " || memory detail"
         " || mouse verbose"
+        " || profile start|stop|dump"
         " || tags"
         " || term"
         " || windows"
@@ -7834,6 +8085,43 @@ command_init ()
            "command (see option \"weechat.look.save_config_on_exit\")."),
         "%(config_files)|%*",
         &command_save, NULL, NULL);
+    hook_command (
+        NULL, "search",
+        N_("search text in lines of buffers"),
+        N_("[-buffer <name>[,<name>...]] [-tags <tags>] [-since <delay>] "
+           "[-regex] [-case] <text>"
+           " || -stop"),
+        N_(" -buffer: search only in these buffers (comma-separated list, "
+           "\"*\" means all buffers, a name beginning with \"!\" is "
+           "excluded, wildcard \"*\" is allowed in names)\n"
+           "   -tags: search only in lines with these tags (comma-separated "
+           "list, logical \"and\" with \"+\" between tags, wildcard \"*\" is "
+           "allowed)\n"
+           "  -since: search only in lines displayed in this delay (number "
+           "with optional unit: s=seconds (default), m=minutes, h=hours, "
+           "d=days)\n"
+           "  -regex: text is a POSIX extended regular expression\n"
+           "   -case: case sensitive search\n"
+           "    text: text to search (in prefix and message of lines, "
+           "without colors)\n"
+           "   -stop: stop the search in progress\n"
+           "\n"
+           "Lines of buffers are searched by threads, lines found are "
+           "displayed in buffer \"search\" (which is displayed in current "
+           "window).\n"
+           "\n"
+           "Examples:\n"
+           "  search \"weechat\" in all buffers:\n"
+           "    /search weechat\n"
+           "  search \"weechat\" in messages of nick \"FlashCode\" in the last 2 "
+           "days:\n"
+           "    /search -tags nick_flashcode -since 2d weechat\n"
+           "  search an URL in channels of freenode:\n"
+           "    /search -buffer irc.freenode.#* -regex https?://"),
+        "-buffer %(buffers_plugins_names)|%*"
+        " || -tags|-since|-regex|-case|%*"
+        " || -stop",
+        &command_search, NULL, NULL);
     hook_command (
         NULL, "secure",
         N_("manage secured data (passwords or private data encrypted in file "
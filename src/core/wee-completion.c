@@ -58,6 +58,17 @@
 
 extern char **environ;
 
+/* sorted names for completion of commands and options (rebuilt if changed) */
+const char **completion_commands = NULL;  /* (pointers to hook data)        */
+int completion_commands_count = 0;
+int completion_commands_changes = -1;     /* value of hooks_changes when    */
+                                          /* array was built                */
+char **completion_options = NULL;         /* full names of options          */
+int completion_options_count = 0;
+int completion_options_changes = -1;      /* value of                       */
+                                          /* config_file_options_changes    */
+                                          /* when array was built           */
+
 
 /*
  * Adds bar names to completion list.
@@ -584,6 +595,48 @@ completion_list_add_filters_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Builds the sorted array of commands (if command hooks have changed since
+ * last build).
+ */
+
+void
+completion_commands_build ()
+{
+    struct t_hook *ptr_hook;
+    const char **new_commands;
+
+    if (completion_commands
+        && (completion_commands_changes == hooks_changes[HOOK_TYPE_COMMAND]))
+    {
+        return;
+    }
+
+    new_commands = realloc (completion_commands,
+                            (hooks_count[HOOK_TYPE_COMMAND] + 1) *
+                            sizeof (*new_commands));
+    if (!new_commands)
+        return;
+    completion_commands = new_commands;
+
+    completion_commands_count = 0;
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted
+            && (HOOK_COMMAND(ptr_hook, command))
+            && (HOOK_COMMAND(ptr_hook, command)[0])
+            && (completion_commands_count < hooks_count[HOOK_TYPE_COMMAND]))
+        {
+            completion_commands[completion_commands_count++] =
+                HOOK_COMMAND(ptr_hook, command);
+        }
+    }
+    gui_completion_sort_words (completion_commands, completion_commands_count);
+
+    completion_commands_changes = hooks_changes[HOOK_TYPE_COMMAND];
+}
+
 /*
  * Adds command hooks to completion list.
  */
@@ -595,8 +648,6 @@ completion_list_add_commands_cb (const void *pointer, void *data,
                                  struct t_gui_completion *completion)
 {
     const char *pos;
-    char str_command[512];
-    struct t_hook *ptr_hook;
 
     /* make C compiler happy */
     (void) pointer;
@@ -607,30 +658,10 @@ completion_list_add_commands_cb (const void *pointer, void *data,
     if (pos)
         pos++;
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
-    {
-        if (!ptr_hook->deleted
-            && (HOOK_COMMAND(ptr_hook, command))
-            && (HOOK_COMMAND(ptr_hook, command)[0]))
-        {
-            if (pos)
-            {
-                snprintf (str_command, sizeof(str_command),
-                          "%s%s",
-                          pos,
-                          HOOK_COMMAND(ptr_hook, command));
-                gui_completion_list_add (completion, str_command,
-                                         0, WEECHAT_LIST_POS_SORT);
-            }
-            else
-            {
-                gui_completion_list_add (completion,
-                                         HOOK_COMMAND(ptr_hook, command),
-                                         0, WEECHAT_LIST_POS_SORT);
-            }
-        }
-    }
+    completion_commands_build ();
+
+    gui_completion_list_add_sorted (completion, completion_commands,
+                                    completion_commands_count, pos);
 
     return WEECHAT_RC_OK;
 }
@@ -751,27 +782,49 @@ completion_list_add_nicks_cb (const void *pointer, void *data,
 }
 
 /*
- * Adds configuration options to completion list.
+ * Frees the sorted array of options.
  */
 
-int
-completion_list_add_config_options_cb (const void *pointer, void *data,
-                                       const char *completion_item,
-                                       struct t_gui_buffer *buffer,
-                                       struct t_gui_completion *completion)
+void
+completion_options_free ()
+{
+    int i;
+
+    if (completion_options)
+    {
+        for (i = 0; i < completion_options_count; i++)
+        {
+            free (completion_options[i]);
+        }
+        free (completion_options);
+        completion_options = NULL;
+    }
+    completion_options_count = 0;
+    completion_options_changes = -1;
+}
+
+/*
+ * Builds the sorted array of options (if options have been added, renamed or
+ * removed since last build).
+ */
+
+void
+completion_options_build ()
 {
     struct t_config_file *ptr_config;
     struct t_config_section *ptr_section;
     struct t_config_option *ptr_option;
-    int length;
-    char *option_full_name;
+    int count, size;
 
-    /* make C compiler happy */
-    (void) pointer;
-    (void) data;
-    (void) completion_item;
-    (void) buffer;
+    if (completion_options
+        && (completion_options_changes == config_file_options_changes))
+    {
+        return;
+    }
+
+    completion_options_free ();
 
+    count = 0;
     for (ptr_config = config_files; ptr_config;
          ptr_config = ptr_config->next_config)
     {
@@ -781,23 +834,66 @@ completion_list_add_config_options_cb (const void *pointer, void *data,
             for (ptr_option = ptr_section->options; ptr_option;
                  ptr_option = ptr_option->next_option)
             {
-                length = strlen (ptr_config->name) + 1
+                count++;
+            }
+        }
+    }
+
+    completion_options = malloc ((count + 1) * sizeof (*completion_options));
+    if (!completion_options)
+        return;
+
+    for (ptr_config = config_files; ptr_config;
+         ptr_config = ptr_config->next_config)
+    {
+        for (ptr_section = ptr_config->sections; ptr_section;
+             ptr_section = ptr_section->next_section)
+        {
+            for (ptr_option = ptr_section->options; ptr_option;
+                 ptr_option = ptr_option->next_option)
+            {
+                size = strlen (ptr_config->name) + 1
                     + strlen (ptr_section->name) + 1
                     + strlen (ptr_option->name) + 1;
-                option_full_name = malloc (length);
-                if (option_full_name)
+                completion_options[completion_options_count] = malloc (size);
+                if (completion_options[completion_options_count])
                 {
-                    snprintf (option_full_name, length, "%s.%s.%s",
+                    snprintf (completion_options[completion_options_count],
+                              size, "%s.%s.%s",
                               ptr_config->name, ptr_section->name,
                               ptr_option->name);
-                    gui_completion_list_add (completion,
-                                             option_full_name,
-                                             0, WEECHAT_LIST_POS_SORT);
-                    free (option_full_name);
+                    completion_options_count++;
                 }
             }
         }
     }
+    gui_completion_sort_words ((const char **)completion_options,
+                               completion_options_count);
+
+    completion_options_changes = config_file_options_changes;
+}
+
+/*
+ * Adds configuration options to completion list.
+ */
+
+int
+completion_list_add_config_options_cb (const void *pointer, void *data,
+                                       const char *completion_item,
+                                       struct t_gui_buffer *buffer,
+                                       struct t_gui_completion *completion)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) completion_item;
+    (void) buffer;
+
+    completion_options_build ();
+
+    gui_completion_list_add_sorted (completion,
+                                    (const char **)completion_options,
+                                    completion_options_count, NULL);
 
     return WEECHAT_RC_OK;
 }
@@ -1769,3 +1865,21 @@ completion_init ()
                      N_("value of an environment variable"),
                      &completion_list_add_env_value_cb, NULL, NULL);
 }
+
+/*
+ * Frees data used by completions done by WeeChat core.
+ */
+
+void
+completion_end ()
+{
+    if (completion_commands)
+    {
+        free (completion_commands);
+        completion_commands = NULL;
+    }
+    completion_commands_count = 0;
+    completion_commands_changes = -1;
+
+    completion_options_free ();
+}
@@ -29,5 +29,6 @@ extern int completion_list_add_filename_cb (const void *pointer,
                                             struct t_gui_buffer *buffer,
                                             struct t_gui_completion *completion);
 extern void completion_init ();
+extern void completion_end ();
 
 #endif /* WEECHAT_COMPLETION_H */
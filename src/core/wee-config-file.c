@@ -31,16 +31,23 @@
 #include <stdarg.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <wctype.h>
 
 #include "weechat.h"
 #include "wee-config-file.h"
 #include "wee-config.h"
+#include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-infolist.h"
 #include "wee-log.h"
 #include "wee-string.h"
+#include "wee-utf8.h"
+#include "wee-util.h"
 #include "wee-version.h"
 #include "../gui/gui-color.h"
 #include "../gui/gui-chat.h"
@@ -48,7 +55,9 @@
 
 
 struct t_config_file *config_files = NULL;
+struct t_hashtable *config_file_index = NULL; /* config files by name     */
 struct t_config_file *last_config_file = NULL;
+int config_file_options_changes = 0;   /* options added/renamed/removed     */
 
 char *config_option_type_string[CONFIG_NUM_OPTION_TYPES] =
 { N_("boolean"), N_("integer"), N_("string"), N_("color") };
@@ -59,6 +68,64 @@ char *config_boolean_false[] = { "off", "no", "n", "false", "f", "0", NULL };
 void config_file_option_free_data (struct t_config_option *option);
 
 
+/*
+ * Hashes a name of configuration file, section or option (case insensitive).
+ */
+
+unsigned long long
+config_file_index_hash_key_cb (struct t_hashtable *hashtable, const void *key)
+{
+    const char *ptr_key;
+    unsigned long long hash;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    /* variant of djb2 hash, with chars converted to lower case */
+    hash = 5381;
+    for (ptr_key = (const char *)key; ptr_key[0];
+         ptr_key = utf8_next_char (ptr_key))
+    {
+        hash ^= (hash << 5) + (hash >> 2)
+            + (unsigned long long)towlower (utf8_wide_char (ptr_key));
+    }
+
+    return hash;
+}
+
+/*
+ * Compares two names of configuration file, section or option (case
+ * insensitive).
+ */
+
+int
+config_file_index_keycmp_cb (struct t_hashtable *hashtable,
+                             const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return string_strcasecmp ((const char *)key1, (const char *)key2);
+}
+
+/*
+ * Creates a new hashtable to index configuration files, sections or options
+ * by name.
+ *
+ * Returns pointer to new hashtable, NULL if error (then the search is done
+ * in the linked list).
+ */
+
+struct t_hashtable *
+config_file_index_new ()
+{
+    return hashtable_new (0,
+                          WEECHAT_HASHTABLE_STRING,
+                          WEECHAT_HASHTABLE_POINTER,
+                          &config_file_index_hash_key_cb,
+                          &config_file_index_keycmp_cb);
+}
+
 /*
  * Searches for a configuration file.
  */
@@ -71,6 +138,9 @@ config_file_search (const char *name)
     if (!name)
         return NULL;
 
+    if (config_file_index)
+        return hashtable_get (config_file_index, name);
+
     for (ptr_config = config_files; ptr_config;
          ptr_config = ptr_config->next_config)
     {
@@ -209,6 +279,13 @@ config_file_new (struct t_weechat_plugin *plugin, const char *name,
         new_config_file->callback_reload_data = callback_reload_data;
         new_config_file->sections = NULL;
         new_config_file->last_section = NULL;
+        new_config_file->index_sections = config_file_index_new ();
+        new_config_file->time_read = 0;
+        new_config_file->size_read = 0;
+        new_config_file->time_write = 0;
+        new_config_file->size_write = 0;
+        new_config_file->dirty = 1;
+        new_config_file->mtime = 0;
 
         new_config_file->prev_config = last_config_file;
         new_config_file->next_config = NULL;
@@ -217,6 +294,11 @@ config_file_new (struct t_weechat_plugin *plugin, const char *name,
         else
             config_files = new_config_file;
         last_config_file = new_config_file;
+
+        if (!config_file_index)
+            config_file_index = config_file_index_new ();
+        if (config_file_index)
+            hashtable_set (config_file_index, name, new_config_file);
     }
 
     return new_config_file;
@@ -375,6 +457,8 @@ config_file_new_section (struct t_config_file *config_file, const char *name,
         new_section->callback_delete_option_data = callback_delete_option_data;
         new_section->options = NULL;
         new_section->last_option = NULL;
+        new_section->index_options = config_file_index_new ();
+        new_section->dirty = (callback_write) ? -1 : 1;
 
         new_section->prev_section = config_file->last_section;
         new_section->next_section = NULL;
@@ -383,6 +467,11 @@ config_file_new_section (struct t_config_file *config_file, const char *name,
         else
             config_file->sections = new_section;
         config_file->last_section = new_section;
+
+        if (config_file->index_sections)
+            hashtable_set (config_file->index_sections, name, new_section);
+
+        config_file->dirty = 1;
     }
 
     return new_section;
@@ -403,6 +492,9 @@ config_file_search_section (struct t_config_file *config_file,
     if (!config_file || !section_name)
         return NULL;
 
+    if (config_file->index_sections)
+        return hashtable_get (config_file->index_sections, section_name);
+
     for (ptr_section = config_file->sections; ptr_section;
          ptr_section = ptr_section->next_section)
     {
@@ -414,6 +506,123 @@ config_file_search_section (struct t_config_file *config_file,
     return NULL;
 }
 
+/*
+ * Marks a configuration file as changed since last read/write (it will be
+ * written by next call to config_file_write).
+ *
+ * If section is not NULL, the section is marked as changed too: for a section
+ * with a write callback, this enables the tracking of changes, so that the
+ * file is not written any more because of this section until it is marked
+ * again as changed (by this function or by a change on one of its options).
+ */
+
+void
+config_file_set_dirty (struct t_config_file *config_file,
+                       struct t_config_section *section)
+{
+    if (!config_file)
+        return;
+
+    config_file->dirty = 1;
+    if (section)
+        section->dirty = 1;
+}
+
+/*
+ * Marks configuration file and section of an option as changed since last
+ * read/write (a section with untracked changes is left as-is).
+ */
+
+void
+config_file_option_set_dirty (struct t_config_option *option)
+{
+    if (option->config_file)
+        option->config_file->dirty = 1;
+    if (option->section && (option->section->dirty >= 0))
+        option->section->dirty = 1;
+}
+
+/*
+ * Marks a configuration file and all its sections as unchanged (called after
+ * read or write of file).
+ */
+
+void
+config_file_clear_dirty (struct t_config_file *config_file)
+{
+    struct t_config_section *ptr_section;
+
+    config_file->dirty = 0;
+    for (ptr_section = config_file->sections; ptr_section;
+         ptr_section = ptr_section->next_section)
+    {
+        if (ptr_section->dirty > 0)
+            ptr_section->dirty = 0;
+    }
+}
+
+/*
+ * Returns the modification time of a configuration file on disk, 0 if the
+ * file does not exist.
+ */
+
+time_t
+config_file_get_mtime (struct t_config_file *config_file)
+{
+    char *filename;
+    int length;
+    struct stat st;
+    time_t mtime;
+
+    length = strlen (weechat_home) + strlen (DIR_SEPARATOR) +
+        strlen (config_file->filename) + 1;
+    filename = malloc (length);
+    if (!filename)
+        return 0;
+    snprintf (filename, length, "%s%s%s",
+              weechat_home, DIR_SEPARATOR, config_file->filename);
+
+    mtime = (stat (filename, &st) == 0) ? st.st_mtime : 0;
+
+    free (filename);
+
+    return mtime;
+}
+
+/*
+ * Checks if a configuration file must be written: if it has changed since
+ * last read/write, if a section has untracked changes (write callback), or if
+ * the file has been modified or removed outside WeeChat.
+ *
+ * Returns:
+ *   1: configuration file must be written
+ *   0: configuration file is unchanged
+ */
+
+int
+config_file_is_dirty (struct t_config_file *config_file)
+{
+    struct t_config_section *ptr_section;
+
+    if (!config_file)
+        return 0;
+
+    if (config_file->dirty)
+        return 1;
+
+    for (ptr_section = config_file->sections; ptr_section;
+         ptr_section = ptr_section->next_section)
+    {
+        if (ptr_section->dirty != 0)
+            return 1;
+    }
+
+    if (config_file_get_mtime (config_file) != config_file->mtime)
+        return 1;
+
+    return 0;
+}
+
 /*
  * Builds full name for an option, using format: "file.section.option".
  *
@@ -499,6 +708,9 @@ config_file_hook_config_exec (struct t_config_option *option)
 
 /*
  * Searches for position of option in section (to keep options sorted by name).
+ *
+ * The list is searched from the end: options are often added in order, or
+ * near the end of list (for example when reading file).
  */
 
 struct t_config_option *
@@ -508,12 +720,13 @@ config_file_option_find_pos (struct t_config_section *section, const char *name)
 
     if (section && name)
     {
-        for (ptr_option = section->options; ptr_option;
-             ptr_option = ptr_option->next_option)
+        for (ptr_option = section->last_option; ptr_option;
+             ptr_option = ptr_option->prev_option)
         {
-            if (string_strcasecmp (name, ptr_option->name) < 0)
-                return ptr_option;
+            if (string_strcasecmp (name, ptr_option->name) >= 0)
+                return ptr_option->next_option;
         }
+        return section->options;
     }
 
     /* position not found (we will add to the end of list) */
@@ -532,6 +745,13 @@ config_file_option_insert_in_section (struct t_config_option *option)
     if (!option || !option->section)
         return;
 
+    config_file_options_changes++;
+
+    if (option->section->index_options)
+    {
+        hashtable_set (option->section->index_options, option->name, option);
+    }
+
     if (option->section->options)
     {
         pos_option = config_file_option_find_pos (option->section,
@@ -880,6 +1100,8 @@ config_file_new_option (struct t_config_file *config_file,
             new_option->next_option = NULL;
         }
 
+        config_file_option_set_dirty (new_option);
+
         /* run config hook(s) */
         if (new_option->config_file && new_option->section)
         {
@@ -905,6 +1127,32 @@ end:
     return new_option;
 }
 
+/*
+ * Searches for an option in a section.
+ *
+ * Returns pointer to option found, NULL if not found.
+ */
+
+struct t_config_option *
+config_file_section_search_option (struct t_config_section *section,
+                                   const char *option_name)
+{
+    struct t_config_option *ptr_option;
+
+    if (section->index_options)
+        return hashtable_get (section->index_options, option_name);
+
+    for (ptr_option = section->options; ptr_option;
+         ptr_option = ptr_option->next_option)
+    {
+        if (string_strcasecmp (ptr_option->name, option_name) == 0)
+            return ptr_option;
+    }
+
+    /* option not found */
+    return NULL;
+}
+
 /*
  * Searches for an option in a configuration file or section.
  *
@@ -919,26 +1167,21 @@ config_file_search_option (struct t_config_file *config_file,
     struct t_config_section *ptr_section;
     struct t_config_option *ptr_option;
 
+    if (!option_name)
+        return NULL;
+
     if (section)
-    {
-        for (ptr_option = section->options; ptr_option;
-             ptr_option = ptr_option->next_option)
-        {
-            if (string_strcasecmp (ptr_option->name, option_name) == 0)
-                return ptr_option;
-        }
-    }
-    else if (config_file)
+        return config_file_section_search_option (section, option_name);
+
+    if (config_file)
     {
         for (ptr_section = config_file->sections; ptr_section;
              ptr_section = ptr_section->next_section)
         {
-            for (ptr_option = ptr_section->options; ptr_option;
-                 ptr_option = ptr_option->next_option)
-            {
-                if (string_strcasecmp (ptr_option->name, option_name) == 0)
-                    return ptr_option;
-            }
+            ptr_option = config_file_section_search_option (ptr_section,
+                                                            option_name);
+            if (ptr_option)
+                return ptr_option;
         }
     }
 
@@ -966,32 +1209,30 @@ config_file_search_section_option (struct t_config_file *config_file,
     *section_found = NULL;
     *option_found = NULL;
 
+    if (!option_name)
+        return;
+
     if (section)
     {
-        for (ptr_option = section->options; ptr_option;
-             ptr_option = ptr_option->next_option)
+        ptr_option = config_file_section_search_option (section, option_name);
+        if (ptr_option)
         {
-            if (string_strcasecmp (ptr_option->name, option_name) == 0)
-            {
-                *section_found = section;
-                *option_found = ptr_option;
-                return;
-            }
+            *section_found = section;
+            *option_found = ptr_option;
         }
     }
     else if (config_file)
     {
+        /* the option found in the last section is returned */
         for (ptr_section = config_file->sections; ptr_section;
              ptr_section = ptr_section->next_section)
         {
-            for (ptr_option = ptr_section->options; ptr_option;
-                 ptr_option = ptr_option->next_option)
+            ptr_option = config_file_section_search_option (ptr_section,
+                                                            option_name);
+            if (ptr_option)
             {
-                if (string_strcasecmp (ptr_option->name, option_name) == 0)
-                {
-                    *section_found = ptr_section;
-                    *option_found = ptr_option;
-                }
+                *section_found = ptr_section;
+                *option_found = ptr_option;
             }
         }
     }
@@ -1243,6 +1484,9 @@ config_file_option_reset (struct t_config_option *option, int run_callback)
         }
     }
 
+    if (rc == WEECHAT_CONFIG_OPTION_SET_OK_CHANGED)
+        config_file_option_set_dirty (option);
+
     if ((rc == WEECHAT_CONFIG_OPTION_SET_OK_CHANGED)
         && run_callback && option->callback_change)
     {
@@ -1561,6 +1805,9 @@ config_file_option_set (struct t_config_option *option, const char *value,
             rc = WEECHAT_CONFIG_OPTION_SET_OK_SAME_VALUE;
     }
 
+    if (rc == WEECHAT_CONFIG_OPTION_SET_OK_CHANGED)
+        config_file_option_set_dirty (option);
+
     /* run callback if asked and value was changed */
     if ((rc == WEECHAT_CONFIG_OPTION_SET_OK_CHANGED)
         && run_callback && option->callback_change)
@@ -1615,6 +1862,9 @@ config_file_option_set_null (struct t_config_option *option, int run_callback)
         }
     }
 
+    if (rc == WEECHAT_CONFIG_OPTION_SET_OK_CHANGED)
+        config_file_option_set_dirty (option);
+
     /* run callback if asked and value was changed */
     if ((rc == WEECHAT_CONFIG_OPTION_SET_OK_CHANGED)
         && run_callback && option->callback_change)
@@ -1735,6 +1985,11 @@ config_file_option_rename (struct t_config_option *option,
         /* remove option from list */
         if (option->section)
         {
+            if (option->section->index_options)
+            {
+                hashtable_remove (option->section->index_options,
+                                  option->name);
+            }
             if (option->prev_option)
                 (option->prev_option)->next_option = option->next_option;
             if (option->next_option)
@@ -1753,6 +2008,8 @@ config_file_option_rename (struct t_config_option *option,
         /* re-insert option in section */
         if (option->section)
             config_file_option_insert_in_section (option);
+
+        config_file_option_set_dirty (option);
     }
 
     full_new_name = config_file_option_full_name (option);
@@ -2385,9 +2642,56 @@ config_file_write_line (struct t_config_file *config_file,
                             option_name));
 }
 
+/*
+ * Writes a buffer in a new file (mode 0600), with a single write.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+config_file_write_buffer (const char *filename, const char *buffer,
+                          size_t size)
+{
+    int fd;
+    size_t pos;
+    ssize_t num_written;
+
+    fd = open (filename, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return 0;
+
+    /* file may already exist with another mode */
+    (void) fchmod (fd, 0600);
+
+    pos = 0;
+    while (pos < size)
+    {
+        num_written = write (fd, buffer + pos, size - pos);
+        if (num_written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            close (fd);
+            return 0;
+        }
+        pos += num_written;
+    }
+
+    if (close (fd) != 0)
+        return 0;
+
+    return 1;
+}
+
 /*
  * Writes a configuration file (this function must not be called directly).
  *
+ * The content of file is built in memory (if open_memstream is available),
+ * then written in a temporary file with a single write, and the temporary
+ * file is renamed to the configuration file.
+ *
  * Returns:
  *   WEECHAT_CONFIG_WRITE_OK: OK
  *   WEECHAT_CONFIG_WRITE_ERROR: error
@@ -2399,13 +2703,20 @@ config_file_write_internal (struct t_config_file *config_file,
                             int default_options)
 {
     int filename_length, rc;
-    char *filename, *filename2, resolved_path[PATH_MAX];
+    char *filename, *filename2, resolved_path[PATH_MAX], *content;
+    size_t content_size;
     struct t_config_section *ptr_section;
     struct t_config_option *ptr_option;
+    struct timeval tv_start, tv_end;
 
     if (!config_file)
         return WEECHAT_CONFIG_WRITE_ERROR;
 
+    gettimeofday (&tv_start, NULL);
+
+    content = NULL;
+    content_size = 0;
+
     /* build filename */
     filename_length = strlen (weechat_home) +
         strlen (config_file->filename) + 2;
@@ -2447,8 +2758,13 @@ config_file_write_internal (struct t_config_file *config_file,
                 (default_options) ? " " : "",
                 (default_options) ? _("(default options)") : "");
 
+#ifdef HAVE_OPEN_MEMSTREAM
+    /* build content of file in memory */
+    config_file->file = open_memstream (&content, &content_size);
+#else
     /* open temp file in write mode */
     config_file->file = fopen (filename2, "wb");
+#endif /* HAVE_OPEN_MEMSTREAM */
     if (!config_file->file)
     {
         gui_chat_printf (NULL,
@@ -2518,19 +2834,45 @@ config_file_write_internal (struct t_config_file *config_file,
     if (fflush (config_file->file) != 0)
         goto error;
 
+#ifdef HAVE_OPEN_MEMSTREAM
+    /* end of content in memory, write it in temp file */
+    if (fclose (config_file->file) != 0)
+    {
+        config_file->file = NULL;
+        goto error;
+    }
+    config_file->file = NULL;
+    if (!config_file_write_buffer (filename2, content, content_size))
+        goto error;
+    free (content);
+    content = NULL;
+#else
+    content_size = ftell (config_file->file);
+
     /* close temp file */
     fclose (config_file->file);
     config_file->file = NULL;
 
     /* update file mode */
     chmod (filename2, 0600);
+#endif /* HAVE_OPEN_MEMSTREAM */
 
     /* rename temp file to target file */
     rc = rename (filename2, filename);
 
+    if ((rc == 0) && !default_options)
+    {
+        config_file_clear_dirty (config_file);
+        config_file->mtime = config_file_get_mtime (config_file);
+    }
+
     free (filename);
     free (filename2);
 
+    gettimeofday (&tv_end, NULL);
+    config_file->time_write = util_timeval_diff (&tv_start, &tv_end);
+    config_file->size_write = content_size;
+
     if (rc != 0)
         return WEECHAT_CONFIG_WRITE_ERROR;
 
@@ -2548,6 +2890,8 @@ error:
         fclose (config_file->file);
         config_file->file = NULL;
     }
+    if (content)
+        free (content);
     unlink (filename2);
     free (filename);
     free (filename2);
@@ -2566,12 +2910,316 @@ error:
 int
 config_file_write (struct t_config_file *config_file)
 {
+    /* do not write file if nothing has changed since last read/write */
+    if (config_file && !config_file_is_dirty (config_file))
+        return WEECHAT_CONFIG_WRITE_OK;
+
     return config_file_write_internal (config_file, 0);
 }
 
+/*
+ * Parses a line read in a configuration file: section, or option with value.
+ *
+ * Argument "line" is modified by this function, "line_orig" is the line
+ * displayed in warnings.
+ */
+
+void
+config_file_read_line (struct t_config_file *config_file,
+                       const char *filename, int line_number,
+                       struct t_config_section **section,
+                       char *line, const char *line_orig)
+{
+    struct t_config_section *ptr_section;
+    struct t_config_option *ptr_option;
+    char *ptr_line, *pos, *pos2, *ptr_option_name;
+    int rc, undefined_value;
+
+    ptr_line = line;
+
+    /* skip spaces */
+    while (ptr_line[0] == ' ')
+    {
+        ptr_line++;
+    }
+
+    /* comment or empty line */
+    if ((ptr_line[0] == '#') || (ptr_line[0] == '\r') || !ptr_line[0])
+        return;
+
+    /* beginning of section */
+    if ((ptr_line[0] == '[') && !strchr (ptr_line, '='))
+    {
+        pos = strchr (line, ']');
+        if (!pos)
+        {
+            gui_chat_printf (NULL,
+                             _("%sWarning: %s, line %d: invalid "
+                               "syntax, missing \"]\""),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             filename, line_number);
+        }
+        else
+        {
+            pos[0] = '\0';
+            pos = ptr_line + 1;
+            *section = config_file_search_section (config_file, pos);
+            if (!*section)
+            {
+                gui_chat_printf (NULL,
+                                 _("%sWarning: %s, line %d: unknown "
+                                   "section identifier "
+                                   "(\"%s\")"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                                 filename, line_number, pos);
+            }
+        }
+        return;
+    }
+
+    ptr_section = *section;
+    undefined_value = 1;
+
+    /* remove CR */
+    pos = strchr (line, '\r');
+    if (pos != NULL)
+        pos[0] = '\0';
+
+    pos = strstr (line, " =");
+    if (pos)
+    {
+        pos[0] = '\0';
+        pos += 2;
+
+        /* remove spaces before '=' */
+        pos2 = pos - 3;
+        while ((pos2 > line) && (pos2[0] == ' '))
+        {
+            pos2[0] = '\0';
+            pos2--;
+        }
+
+        /* skip spaces after '=' */
+        while (pos[0] && (pos[0] == ' '))
+        {
+            pos++;
+        }
+
+        if (pos[0]
+            && string_strcasecmp (pos, WEECHAT_CONFIG_OPTION_NULL) != 0)
+        {
+            undefined_value = 0;
+            /* remove simple or double quotes and spaces at the end */
+            if (strlen(pos) > 1)
+            {
+                pos2 = pos + strlen (pos) - 1;
+                while ((pos2 > pos) && (pos2[0] == ' '))
+                {
+                    pos2[0] = '\0';
+                    pos2--;
+                }
+                pos2 = pos + strlen (pos) - 1;
+                if (((pos[0] == '\'') &&
+                     (pos2[0] == '\'')) ||
+                    ((pos[0] == '"') &&
+                     (pos2[0] == '"')))
+                {
+                    pos2[0] = '\0';
+                    pos++;
+                }
+            }
+        }
+    }
+
+    ptr_option_name = (line[0] == '\\') ? line + 1 : line;
+
+    if (ptr_section && ptr_section->callback_read)
+    {
+        rc = (ptr_section->callback_read)
+            (ptr_section->callback_read_pointer,
+             ptr_section->callback_read_data,
+             config_file,
+             ptr_section,
+             ptr_option_name,
+             (undefined_value) ? NULL : pos);
+    }
+    else
+    {
+        rc = WEECHAT_CONFIG_OPTION_SET_OPTION_NOT_FOUND;
+        ptr_option = config_file_search_option (config_file,
+                                                ptr_section,
+                                                ptr_option_name);
+        if (ptr_option)
+        {
+            rc = config_file_option_set (ptr_option,
+                                         (undefined_value) ?
+                                         NULL : pos,
+                                         1);
+            ptr_option->loaded = 1;
+        }
+        else
+        {
+            if (ptr_section
+                && ptr_section->callback_create_option)
+            {
+                rc = (int) (ptr_section->callback_create_option) (
+                    ptr_section->callback_create_option_pointer,
+                    ptr_section->callback_create_option_data,
+                    config_file,
+                    ptr_section,
+                    ptr_option_name,
+                    (undefined_value) ? NULL : pos);
+            }
+        }
+    }
+
+    switch (rc)
+    {
+        case WEECHAT_CONFIG_OPTION_SET_OPTION_NOT_FOUND:
+            if (ptr_section)
+                gui_chat_printf (NULL,
+                                 _("%sWarning: %s, line %d: "
+                                   "unknown option for section "
+                                   "\"%s\": %s"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                                 filename, line_number,
+                                 ptr_section->name,
+                                 line_orig);
+            else
+                gui_chat_printf (NULL,
+                                 _("%sWarning: %s, line %d: "
+                                   "option outside section: "
+                                   "%s"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                                 filename, line_number,
+                                 line_orig);
+            break;
+        case WEECHAT_CONFIG_OPTION_SET_ERROR:
+            gui_chat_printf (NULL,
+                             _("%sWarning: %s, line %d: "
+                               "invalid value for option: "
+                               "%s"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             filename, line_number,
+                             line_orig);
+            break;
+    }
+}
+
+/*
+ * Loads content of a file in memory: the file is mapped in memory (mmap),
+ * or read in an allocated buffer if mmap is not possible.
+ *
+ * Returns pointer to content (not NUL-terminated), NULL if error (or if the
+ * file is empty, then *size is 0).
+ *
+ * Note: content must be released with config_file_unload after use.
+ */
+
+char *
+config_file_load (int fd, size_t *size, int *mapped)
+{
+    struct stat st;
+    char *content;
+    size_t pos;
+    ssize_t num_read;
+
+    *size = 0;
+    *mapped = 0;
+
+    if ((fstat (fd, &st) != 0) || (st.st_size <= 0))
+        return NULL;
+
+    content = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (content != MAP_FAILED)
+    {
+        *size = st.st_size;
+        *mapped = 1;
+        return content;
+    }
+
+    /* mmap not possible: read the whole file */
+    content = malloc (st.st_size);
+    if (!content)
+        return NULL;
+    pos = 0;
+    while (pos < (size_t)st.st_size)
+    {
+        num_read = read (fd, content + pos, st.st_size - pos);
+        if (num_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            free (content);
+            return NULL;
+        }
+        if (num_read == 0)
+            break;
+        pos += num_read;
+    }
+    *size = pos;
+
+    return content;
+}
+
+/*
+ * Releases content of a file loaded with config_file_load.
+ */
+
+void
+config_file_unload (char *content, size_t size, int mapped)
+{
+    if (!content)
+        return;
+
+    if (mapped)
+        munmap (content, size);
+    else
+        free (content);
+}
+
+/*
+ * Copies a line of file in a buffer (with a final '\0'), growing the buffer
+ * if needed.
+ *
+ * Returns:
+ *   1: OK
+ *   0: not enough memory
+ */
+
+int
+config_file_copy_line (char **buffer, int *buffer_size,
+                       const char *line, int length)
+{
+    char *new_buffer;
+    int new_size;
+
+    if (length + 1 > *buffer_size)
+    {
+        new_size = (*buffer_size > 0) ? *buffer_size : 1024;
+        while (length + 1 > new_size)
+        {
+            new_size *= 2;
+        }
+        new_buffer = realloc (*buffer, new_size);
+        if (!new_buffer)
+            return 0;
+        *buffer = new_buffer;
+        *buffer_size = new_size;
+    }
+
+    memcpy (*buffer, line, length);
+    (*buffer)[length] = '\0';
+
+    return 1;
+}
+
 /*
  * Reads a configuration file (this function must not be called directly).
  *
+ * The file is loaded in memory with a single call (mmap), then parsed line
+ * by line.
+ *
  * Returns:
  *   WEECHAT_CONFIG_READ_OK: OK
  *   WEECHAT_CONFIG_READ_MEMORY_ERROR: not enough memory
@@ -2581,15 +3229,19 @@ config_file_write (struct t_config_file *config_file)
 int
 config_file_read_internal (struct t_config_file *config_file, int reload)
 {
-    int filename_length, line_number, rc, undefined_value;
-    char *filename;
+    int filename_length, line_number, fd, mapped, length, i, has_8bits, rc;
+    int line_size, line_orig_size;
+    char *filename, *content, *ptr_content, *pos_eol, *line, *line_orig;
+    char *line_converted;
+    size_t content_size;
     struct t_config_section *ptr_section;
-    struct t_config_option *ptr_option;
-    char line[16384], *ptr_line, *ptr_line2, *pos, *pos2, *ptr_option_name;
+    struct timeval tv_start, tv_end;
 
     if (!config_file)
         return WEECHAT_CONFIG_READ_FILE_NOT_FOUND;
 
+    gettimeofday (&tv_start, NULL);
+
     /* build filename */
     filename_length = strlen (weechat_home) + strlen (DIR_SEPARATOR) +
         strlen (config_file->filename) + 1;
@@ -2608,8 +3260,8 @@ config_file_read_internal (struct t_config_file *config_file, int reload)
     }
 
     /* read config file */
-    config_file->file = fopen (filename, "r");
-    if (!config_file->file)
+    fd = open (filename, O_RDONLY);
+    if (fd < 0)
     {
         gui_chat_printf (NULL,
                          _("%sWARNING: failed to read configuration file "
@@ -2630,204 +3282,90 @@ config_file_read_internal (struct t_config_file *config_file, int reload)
     if (!reload)
         log_printf (_("Reading configuration file %s"), config_file->filename);
 
+    content = config_file_load (fd, &content_size, &mapped);
+    close (fd);
+
+    rc = WEECHAT_CONFIG_READ_OK;
+
     /* read all lines */
     ptr_section = NULL;
     line_number = 0;
-    while (!feof (config_file->file))
+    line = NULL;
+    line_size = 0;
+    line_orig = NULL;
+    line_orig_size = 0;
+    ptr_content = content;
+    while (ptr_content && (ptr_content < content + content_size))
     {
-        ptr_line = fgets (line, sizeof (line) - 1, config_file->file);
         line_number++;
-        if (ptr_line)
+        pos_eol = memchr (ptr_content, '\n',
+                          content + content_size - ptr_content);
+        length = (pos_eol) ?
+            pos_eol - ptr_content : content + content_size - ptr_content;
+
+        if (!config_file_copy_line (&line, &line_size, ptr_content, length))
         {
-            /* encode line to internal charset */
-            ptr_line2 = string_iconv_to_internal (NULL, ptr_line);
-            if (ptr_line2)
-                snprintf (line, sizeof (line), "%s", ptr_line2);
+            rc = WEECHAT_CONFIG_READ_MEMORY_ERROR;
+            break;
+        }
 
-            /* skip spaces */
-            while (ptr_line[0] == ' ')
+        /* encode line to internal charset (not needed for ASCII) */
+        has_8bits = 0;
+        for (i = 0; i < length; i++)
+        {
+            if ((unsigned char)line[i] >= 128)
             {
-                ptr_line++;
+                has_8bits = 1;
+                break;
             }
-
-            /* not a comment and not an empty line */
-            if ((ptr_line[0] != '#') && (ptr_line[0] != '\r')
-                && (ptr_line[0] != '\n'))
+        }
+        line_converted = (has_8bits) ?
+            string_iconv_to_internal (NULL, line) : NULL;
+        if (line_converted)
+        {
+            length = strlen (line_converted);
+            if (!config_file_copy_line (&line, &line_size,
+                                        line_converted, length))
             {
-                /* beginning of section */
-                if ((ptr_line[0] == '[') && !strchr (ptr_line, '='))
-                {
-                    pos = strchr (line, ']');
-                    if (!pos)
-                    {
-                        gui_chat_printf (NULL,
-                                         _("%sWarning: %s, line %d: invalid "
-                                           "syntax, missing \"]\""),
-                                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                         filename, line_number);
-                    }
-                    else
-                    {
-                        pos[0] = '\0';
-                        pos = ptr_line + 1;
-                        ptr_section = config_file_search_section (config_file,
-                                                                  pos);
-                        if (!ptr_section)
-                        {
-                            gui_chat_printf (NULL,
-                                             _("%sWarning: %s, line %d: unknown "
-                                               "section identifier "
-                                               "(\"%s\")"),
-                                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                             filename, line_number, pos);
-                        }
-                    }
-                }
-                else
-                {
-                    undefined_value = 1;
-
-                    /* remove CR/LF */
-                    pos = strchr (line, '\r');
-                    if (pos != NULL)
-                        pos[0] = '\0';
-                    pos = strchr (line, '\n');
-                    if (pos != NULL)
-                        pos[0] = '\0';
-
-                    pos = strstr (line, " =");
-                    if (pos)
-                    {
-                        pos[0] = '\0';
-                        pos += 2;
-
-                        /* remove spaces before '=' */
-                        pos2 = pos - 3;
-                        while ((pos2 > line) && (pos2[0] == ' '))
-                        {
-                            pos2[0] = '\0';
-                            pos2--;
-                        }
+                free (line_converted);
+                rc = WEECHAT_CONFIG_READ_MEMORY_ERROR;
+                break;
+            }
+            free (line_converted);
+        }
 
-                        /* skip spaces after '=' */
-                        while (pos[0] && (pos[0] == ' '))
-                        {
-                            pos++;
-                        }
+        /* keep line as read (for warnings), the parser modifies it */
+        if (!config_file_copy_line (&line_orig, &line_orig_size,
+                                    line, length))
+        {
+            rc = WEECHAT_CONFIG_READ_MEMORY_ERROR;
+            break;
+        }
 
-                        if (pos[0]
-                            && string_strcasecmp (pos, WEECHAT_CONFIG_OPTION_NULL) != 0)
-                        {
-                            undefined_value = 0;
-                            /* remove simple or double quotes and spaces at the end */
-                            if (strlen(pos) > 1)
-                            {
-                                pos2 = pos + strlen (pos) - 1;
-                                while ((pos2 > pos) && (pos2[0] == ' '))
-                                {
-                                    pos2[0] = '\0';
-                                    pos2--;
-                                }
-                                pos2 = pos + strlen (pos) - 1;
-                                if (((pos[0] == '\'') &&
-                                     (pos2[0] == '\'')) ||
-                                    ((pos[0] == '"') &&
-                                     (pos2[0] == '"')))
-                                {
-                                    pos2[0] = '\0';
-                                    pos++;
-                                }
-                            }
-                        }
-                    }
+        config_file_read_line (config_file, filename, line_number,
+                               &ptr_section, line, line_orig);
 
-                    ptr_option_name = (line[0] == '\\') ? line + 1 : line;
+        ptr_content = (pos_eol) ? pos_eol + 1 : content + content_size;
+    }
 
-                    if (ptr_section && ptr_section->callback_read)
-                    {
-                        ptr_option = NULL;
-                        rc = (ptr_section->callback_read)
-                            (ptr_section->callback_read_pointer,
-                             ptr_section->callback_read_data,
-                             config_file,
-                             ptr_section,
-                             ptr_option_name,
-                             (undefined_value) ? NULL : pos);
-                    }
-                    else
-                    {
-                        rc = WEECHAT_CONFIG_OPTION_SET_OPTION_NOT_FOUND;
-                        ptr_option = config_file_search_option (config_file,
-                                                                ptr_section,
-                                                                ptr_option_name);
-                        if (ptr_option)
-                        {
-                            rc = config_file_option_set (ptr_option,
-                                                         (undefined_value) ?
-                                                         NULL : pos,
-                                                         1);
-                            ptr_option->loaded = 1;
-                        }
-                        else
-                        {
-                            if (ptr_section
-                                && ptr_section->callback_create_option)
-                            {
-                                rc = (int) (ptr_section->callback_create_option) (
-                                    ptr_section->callback_create_option_pointer,
-                                    ptr_section->callback_create_option_data,
-                                    config_file,
-                                    ptr_section,
-                                    ptr_option_name,
-                                    (undefined_value) ? NULL : pos);
-                            }
-                        }
-                    }
+    if (line)
+        free (line);
+    if (line_orig)
+        free (line_orig);
+    config_file_unload (content, content_size, mapped);
+    free (filename);
 
-                    switch (rc)
-                    {
-                        case WEECHAT_CONFIG_OPTION_SET_OPTION_NOT_FOUND:
-                            if (ptr_section)
-                                gui_chat_printf (NULL,
-                                                 _("%sWarning: %s, line %d: "
-                                                   "unknown option for section "
-                                                   "\"%s\": %s"),
-                                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                                 filename, line_number,
-                                                 ptr_section->name,
-                                                 ptr_line2);
-                            else
-                                gui_chat_printf (NULL,
-                                                 _("%sWarning: %s, line %d: "
-                                                   "option outside section: "
-                                                   "%s"),
-                                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                                 filename, line_number,
-                                                 ptr_line2);
-                            break;
-                        case WEECHAT_CONFIG_OPTION_SET_ERROR:
-                            gui_chat_printf (NULL,
-                                             _("%sWarning: %s, line %d: "
-                                               "invalid value for option: "
-                                               "%s"),
-                                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                             filename, line_number,
-                                             ptr_line2);
-                            break;
-                    }
-                }
-            }
+    gettimeofday (&tv_end, NULL);
+    config_file->time_read = util_timeval_diff (&tv_start, &tv_end);
+    config_file->size_read = content_size;
 
-            if (ptr_line2)
-                free (ptr_line2);
-        }
+    if (rc == WEECHAT_CONFIG_READ_OK)
+    {
+        config_file_clear_dirty (config_file);
+        config_file->mtime = config_file_get_mtime (config_file);
     }
 
-    fclose (config_file->file);
-    config_file->file = NULL;
-    free (filename);
-
-    return WEECHAT_CONFIG_READ_OK;
+    return rc;
 }
 
 /*
@@ -2898,6 +3436,13 @@ config_file_reload (struct t_config_file *config_file)
         }
     }
 
+    /*
+     * options not found in file have been reset to their default value,
+     * like when they are missing in file: the file is considered unchanged
+     */
+    if (rc == WEECHAT_CONFIG_READ_OK)
+        config_file_clear_dirty (config_file);
+
     return rc;
 }
 
@@ -2943,6 +3488,17 @@ config_file_option_free (struct t_config_option *option)
 
     ptr_section = option->section;
 
+    config_file_options_changes++;
+
+    config_file_option_set_dirty (option);
+
+    /* remove option from index of section (before its name is freed) */
+    if (ptr_section && ptr_section->index_options
+        && (hashtable_get (ptr_section->index_options, option->name) == option))
+    {
+        hashtable_remove (ptr_section->index_options, option->name);
+    }
+
     /* free data */
     config_file_option_free_data (option);
 
@@ -2999,6 +3555,13 @@ config_file_section_free (struct t_config_section *section)
 
     /* free data */
     config_file_section_free_options (section);
+    if (ptr_config->index_sections
+        && (hashtable_get (ptr_config->index_sections, section->name) == section))
+    {
+        hashtable_remove (ptr_config->index_sections, section->name);
+    }
+    if (section->index_options)
+        hashtable_free (section->index_options);
     if (section->name)
         free (section->name);
     if (section->callback_read_data)
@@ -3048,6 +3611,13 @@ config_file_free (struct t_config_file *config_file)
     {
         config_file_section_free (config_file->sections);
     }
+    if (config_file->index_sections)
+        hashtable_free (config_file->index_sections);
+    if (config_file_index
+        && (hashtable_get (config_file_index, config_file->name) == config_file))
+    {
+        hashtable_remove (config_file_index, config_file->name);
+    }
     if (config_file->name)
         free (config_file->name);
     if (config_file->filename)
@@ -3074,6 +3644,12 @@ config_file_free (struct t_config_file *config_file)
     free (config_file);
 
     config_files = new_config_files;
+
+    if (!config_files && config_file_index)
+    {
+        hashtable_free (config_file_index);
+        config_file_index = NULL;
+    }
 }
 
 /*
@@ -3137,6 +3713,8 @@ config_file_hdata_config_file_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_config_file, callback_reload_data, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_config_file, sections, POINTER, 0, NULL, "config_section");
         HDATA_VAR(struct t_config_file, last_section, POINTER, 0, NULL, "config_section");
+        HDATA_VAR(struct t_config_file, dirty, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_config_file, mtime, TIME, 0, NULL, NULL);
         HDATA_VAR(struct t_config_file, prev_config, POINTER, 0, NULL, hdata_name);
         HDATA_VAR(struct t_config_file, next_config, POINTER, 0, NULL, hdata_name);
         HDATA_LIST(config_files, WEECHAT_HDATA_LIST_CHECK_POINTERS);
@@ -3184,6 +3762,7 @@ config_file_hdata_config_section_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_config_section, callback_delete_option_data, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_config_section, options, POINTER, 0, NULL, "config_option");
         HDATA_VAR(struct t_config_section, last_option, POINTER, 0, NULL, "config_option");
+        HDATA_VAR(struct t_config_section, dirty, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_config_section, prev_section, POINTER, 0, NULL, hdata_name);
         HDATA_VAR(struct t_config_section, next_section, POINTER, 0, NULL, hdata_name);
     }
@@ -3450,6 +4029,13 @@ config_file_print_log ()
         log_printf ("  callback_reload_data . : 0x%lx", ptr_config_file->callback_reload_data);
         log_printf ("  sections . . . . . . . : 0x%lx", ptr_config_file->sections);
         log_printf ("  last_section . . . . . : 0x%lx", ptr_config_file->last_section);
+        log_printf ("  index_sections . . . . : 0x%lx", ptr_config_file->index_sections);
+        log_printf ("  time_read. . . . . . . : %lld",  ptr_config_file->time_read);
+        log_printf ("  size_read. . . . . . . : %lu",   ptr_config_file->size_read);
+        log_printf ("  time_write . . . . . . : %lld",  ptr_config_file->time_write);
+        log_printf ("  size_write . . . . . . : %lu",   ptr_config_file->size_write);
+        log_printf ("  dirty. . . . . . . . . : %d",    ptr_config_file->dirty);
+        log_printf ("  mtime. . . . . . . . . : %ld",   ptr_config_file->mtime);
         log_printf ("  prev_config. . . . . . : 0x%lx", ptr_config_file->prev_config);
         log_printf ("  next_config. . . . . . : 0x%lx", ptr_config_file->next_config);
 
@@ -3477,6 +4063,8 @@ config_file_print_log ()
             log_printf ("      callback_delete_option_data . : 0x%lx", ptr_section->callback_delete_option_data);
             log_printf ("      options . . . . . . . . . . . : 0x%lx", ptr_section->options);
             log_printf ("      last_option . . . . . . . . . : 0x%lx", ptr_section->last_option);
+            log_printf ("      index_options . . . . . . . . : 0x%lx", ptr_section->index_options);
+            log_printf ("      dirty . . . . . . . . . . . . : %d",    ptr_section->dirty);
             log_printf ("      prev_section. . . . . . . . . : 0x%lx", ptr_section->prev_section);
             log_printf ("      next_section. . . . . . . . . : 0x%lx", ptr_section->next_section);
 
@@ -21,6 +21,8 @@
 #ifndef WEECHAT_CONFIG_FILE_H
 #define WEECHAT_CONFIG_FILE_H 1
 
+#include <time.h>
+
 #define CONFIG_BOOLEAN(option) (*((int *)((option)->value)))
 #define CONFIG_BOOLEAN_DEFAULT(option) (*((int *)((option)->default_value)))
 
@@ -38,6 +40,7 @@
 
 struct t_weelist;
 struct t_infolist;
+struct t_hashtable;
 
 struct t_config_option;
 
@@ -56,6 +59,15 @@ struct t_config_file
     void *callback_reload_data;            /* data sent to callback         */
     struct t_config_section *sections;     /* config sections               */
     struct t_config_section *last_section; /* last config section           */
+    struct t_hashtable *index_sections;    /* sections by name (fast search)*/
+    long long time_read;                   /* duration of last read (usec)  */
+    unsigned long size_read;               /* size of file last read        */
+    long long time_write;                  /* duration of last write (usec) */
+    unsigned long size_write;              /* size of file last written     */
+    int dirty;                             /* 1 if changed since last       */
+                                           /* read/write                    */
+    time_t mtime;                          /* mtime of file after last      */
+                                           /* read/write (0 if unknown)     */
     struct t_config_file *prev_config;     /* link to previous config file  */
     struct t_config_file *next_config;     /* link to next config file      */
 };
@@ -108,6 +120,10 @@ struct t_config_section
     void *callback_delete_option_data;     /* data sent to delete callback  */
     struct t_config_option *options;       /* options in section            */
     struct t_config_option *last_option;   /* last option in section        */
+    struct t_hashtable *index_options;     /* options by name (fast search) */
+    int dirty;                             /* 1 if changed since last       */
+                                           /* read/write, -1 if changes are */
+                                           /* not tracked (write callback)  */
     struct t_config_section *prev_section; /* link to previous section      */
     struct t_config_section *next_section; /* link to next section          */
 };
@@ -162,6 +178,7 @@ struct t_config_option
 
 extern struct t_config_file *config_files;
 extern struct t_config_file *last_config_file;
+extern int config_file_options_changes;
 
 extern struct t_config_file *config_file_search (const char *name);
 extern struct t_config_file *config_file_new (struct t_weechat_plugin *plugin,
@@ -282,6 +299,9 @@ extern int config_file_write_option (struct t_config_file *config_file,
                                      struct t_config_option *option);
 extern int config_file_write_line (struct t_config_file *config_file,
                                    const char *option_name, const char *value, ...);
+extern void config_file_set_dirty (struct t_config_file *config_file,
+                                   struct t_config_section *section);
+extern int config_file_is_dirty (struct t_config_file *config_file);
 extern int config_file_write (struct t_config_file *config_files);
 extern int config_file_read (struct t_config_file *config_file);
 extern int config_file_reload (struct t_config_file *config_file);
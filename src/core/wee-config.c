@@ -60,6 +60,7 @@
 #include "../gui/gui-line.h"
 #include "../gui/gui-main.h"
 #include "../gui/gui-mouse.h"
+#include "../gui/gui-nick.h"
 #include "../gui/gui-nicklist.h"
 #include "../gui/gui-window.h"
 #include "../plugins/plugin.h"
@@ -71,6 +72,9 @@ struct t_config_section *weechat_config_section_color = NULL;
 struct t_config_section *weechat_config_section_proxy = NULL;
 struct t_config_section *weechat_config_section_bar = NULL;
 struct t_config_section *weechat_config_section_notify = NULL;
+struct t_config_section *weechat_config_section_layout = NULL;
+struct t_config_section *weechat_config_section_filter = NULL;
+struct t_config_section *weechat_config_section_key[GUI_KEY_NUM_CONTEXTS];
 
 /* config, startup section */
 
@@ -95,6 +99,7 @@ struct t_config_option *config_look_buffer_notify_default;
 struct t_config_option *config_look_buffer_position;
 struct t_config_option *config_look_buffer_search_case_sensitive;
 struct t_config_option *config_look_buffer_search_force_default;
+struct t_config_option *config_look_buffer_search_index;
 struct t_config_option *config_look_buffer_search_regex;
 struct t_config_option *config_look_buffer_search_where;
 struct t_config_option *config_look_buffer_time_format;
@@ -178,6 +183,7 @@ struct t_config_option *config_look_quote_time_format;
 struct t_config_option *config_look_read_marker;
 struct t_config_option *config_look_read_marker_always_show;
 struct t_config_option *config_look_read_marker_string;
+struct t_config_option *config_look_refresh_max_fps;
 struct t_config_option *config_look_save_config_on_exit;
 struct t_config_option *config_look_save_layout_on_exit;
 struct t_config_option *config_look_scroll_amount;
@@ -276,25 +282,36 @@ struct t_config_option *config_completion_partial_completion_other;
 /* config, history section */
 
 struct t_config_option *config_history_display_default;
+struct t_config_option *config_history_buffer_lines_on_disk;
 struct t_config_option *config_history_max_buffer_lines_minutes;
 struct t_config_option *config_history_max_buffer_lines_number;
 struct t_config_option *config_history_max_commands;
 struct t_config_option *config_history_max_visited_buffers;
+struct t_config_option *config_history_remove_duplicates;
 
 /* config, network section */
 
 struct t_config_option *config_network_connection_timeout;
+struct t_config_option *config_network_dns_cache_ttl;
 struct t_config_option *config_network_gnutls_ca_file;
 struct t_config_option *config_network_gnutls_handshake_timeout;
 struct t_config_option *config_network_proxy_curl;
+struct t_config_option *config_network_url_multi;
 
 /* config, plugin section */
 
 struct t_config_option *config_plugin_autoload;
 struct t_config_option *config_plugin_debug;
 struct t_config_option *config_plugin_extension;
+struct t_config_option *config_plugin_lazy_load;
 struct t_config_option *config_plugin_path;
+struct t_config_option *config_plugin_process_max_running;
+struct t_config_option *config_plugin_process_max_running_per_plugin;
 struct t_config_option *config_plugin_save_config_on_unload;
+struct t_config_option *config_plugin_script_callback_budget;
+struct t_config_option *config_plugin_script_callback_budget_action;
+struct t_config_option *config_plugin_script_callback_timeout;
+struct t_config_option *config_plugin_slow_callback;
 
 /* other */
 
@@ -556,6 +573,7 @@ config_change_buffers (const void *pointer, void *data,
     (void) data;
     (void) option;
 
+    gui_chat_layout_invalidate ();
     gui_window_ask_refresh (1);
 }
 
@@ -687,6 +705,25 @@ config_set_nick_colors ()
         CONFIG_STRING(config_color_chat_nick_colors),
         ",", 0, 0,
         &config_num_nick_colors);
+
+    gui_nick_color_cache_clear ();
+}
+
+/*
+ * Callback for changes on options "weechat.look.nick_color_hash" and
+ * "weechat.look.nick_color_stop_chars".
+ */
+
+void
+config_change_look_nick_color (const void *pointer, void *data,
+                               struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    gui_nick_color_cache_clear ();
 }
 
 /*
@@ -718,6 +755,8 @@ config_change_look_nick_color_force (const void *pointer, void *data,
         hashtable_remove_all (config_hashtable_nick_color_force);
     }
 
+    gui_nick_color_cache_clear ();
+
     items = string_split (CONFIG_STRING(config_look_nick_color_force),
                           ";", 0, 0, &num_items);
     if (items)
@@ -756,6 +795,7 @@ config_change_nick_prefix_suffix (const void *pointer, void *data,
         + gui_chat_strlen_screen (CONFIG_STRING(config_look_nick_suffix));
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_chat_layout_invalidate ();
     gui_window_ask_refresh (1);
 }
 
@@ -776,6 +816,7 @@ config_change_prefix_same_nick (const void *pointer, void *data,
         gui_chat_strlen_screen (CONFIG_STRING(config_look_prefix_same_nick));
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_chat_layout_invalidate ();
     gui_window_ask_refresh (1);
 }
 
@@ -852,7 +893,7 @@ config_change_highlight_regex (const void *pointer, void *data,
 
     if (config_highlight_regex)
     {
-        regfree (config_highlight_regex);
+        string_regfree (config_highlight_regex);
         free (config_highlight_regex);
         config_highlight_regex = NULL;
     }
@@ -894,7 +935,7 @@ config_change_highlight_tags (const void *pointer, void *data,
     {
         for (i = 0; i < config_num_highlight_tags; i++)
         {
-            string_free_split (config_highlight_tags[i]);
+            string_free_split_shared (config_highlight_tags[i]);
         }
         free (config_highlight_tags);
         config_highlight_tags = NULL;
@@ -914,8 +955,8 @@ config_change_highlight_tags (const void *pointer, void *data,
             {
                 for (i = 0; i < config_num_highlight_tags; i++)
                 {
-                    config_highlight_tags[i] = string_split (tags_array[i],
-                                                             "+", 0, 0, NULL);
+                    config_highlight_tags[i] = string_split_shared (tags_array[i],
+                                                                    "+", 0, 0, NULL);
                 }
             }
             string_free_split (tags_array);
@@ -936,7 +977,7 @@ config_change_hotlist_sort (const void *pointer, void *data,
     (void) data;
     (void) option;
 
-    gui_hotlist_resort ();
+    gui_hotlist_ask_resort ();
 }
 
 /*
@@ -1062,6 +1103,7 @@ config_change_prefix_align_min (const void *pointer, void *data,
     (void) option;
 
     config_compute_prefix_max_length_all_buffers ();
+    gui_chat_layout_invalidate ();
     gui_window_ask_refresh (1);
 }
 
@@ -1132,6 +1174,7 @@ config_change_tab_width (const void *pointer, void *data,
     memset (config_tab_spaces, ' ', CONFIG_INTEGER(config_look_tab_width));
     config_tab_spaces[CONFIG_INTEGER(config_look_tab_width)] = '\0';
 
+    gui_chat_layout_invalidate ();
     gui_window_ask_refresh (1);
 }
 
@@ -1172,6 +1215,22 @@ config_change_nick_colors (const void *pointer, void *data,
     gui_color_buffer_display ();
 }
 
+/*
+ * Callback for changes on option "weechat.network.dns_cache_ttl".
+ */
+
+void
+config_change_network_dns_cache_ttl (const void *pointer, void *data,
+                                     struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    network_dns_cache_flush ();
+}
+
 /*
  * Callback for changes on option "weechat.network.gnutls_ca_file".
  */
@@ -1242,6 +1301,23 @@ config_change_plugin_extension (const void *pointer, void *data,
     }
 }
 
+/*
+ * Callback for changes on options "weechat.plugin.process_max_running*".
+ */
+
+void
+config_change_plugin_process_max_running (const void *pointer, void *data,
+                                          struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    /* limits may have been raised: try to run the queued processes */
+    hook_process_pending = 1;
+}
+
 /*
  * Timer called each minute: checks if the day has changed, and if yes:
  * - refreshes screen (if needed)
@@ -1329,7 +1405,7 @@ config_weechat_init_after_read ()
     }
 
     /* apply filters on all buffers */
-    gui_filter_all_buffers ();
+    gui_filter_all_buffers (NULL);
 
     config_change_look_nick_color_force (NULL, NULL, NULL);
 }
@@ -2565,6 +2641,15 @@ config_weechat_init_options ()
            "values from last search in buffer)"),
         NULL, 0, 0, "off", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_look_buffer_search_index = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "buffer_search_index", "integer",
+        N_("min number of lines in a buffer to build an index of its lines "
+           "when a text search starts, so that search is faster on each key "
+           "pressed (0 = never use an index); the index is updated with new "
+           "lines and freed when the search ends"),
+        NULL, 0, INT_MAX, "10000", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     config_look_buffer_search_regex = config_file_new_option (
         weechat_config_file, ptr_section,
         "buffer_search_regex", "boolean",
@@ -3080,7 +3165,9 @@ config_weechat_init_options ()
            "of djb2 (position of letters matters: anagrams of a nick have "
            "different color), sum = sum of letters"),
         "djb2|sum", 0, 0, "djb2", NULL, 0,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        NULL, NULL, NULL,
+        &config_change_look_nick_color, NULL, NULL,
+        NULL, NULL, NULL);
     config_look_nick_color_stop_chars = config_file_new_option (
         weechat_config_file, ptr_section,
         "nick_color_stop_chars", "string",
@@ -3090,7 +3177,7 @@ config_weechat_init_options ()
            "return color of nick \"|nick\")"),
         NULL, 0, 0, "_|[", NULL, 0,
         NULL, NULL, NULL,
-        NULL, NULL, NULL,
+        &config_change_look_nick_color, NULL, NULL,
         NULL, NULL, NULL);
     config_look_nick_prefix = config_file_new_option (
         weechat_config_file, ptr_section,
@@ -3335,6 +3422,16 @@ config_weechat_init_options ()
         NULL, NULL, NULL,
         &config_change_read_marker, NULL, NULL,
         NULL, NULL, NULL);
+    config_look_refresh_max_fps = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "refresh_max_fps", "integer",
+        N_("max number of screen refreshes per second (0 = no limit): when "
+           "a lot of messages are displayed, the changes are drawn together "
+           "at most this number of times per second, which reduces the data "
+           "sent to terminal (useful on slow links); the screen is always "
+           "refreshed immediately after a key is pressed"),
+        NULL, 0, 1000, "60", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     config_look_save_config_on_exit = config_file_new_option (
         weechat_config_file, ptr_section,
         "save_config_on_exit", "boolean",
@@ -4172,6 +4269,17 @@ config_weechat_init_options ()
         return 0;
     }
 
+    config_history_buffer_lines_on_disk = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "buffer_lines_on_disk", "boolean",
+        N_("save lines removed from buffers (according to options "
+           "weechat.history.max_buffer_lines_*) in files (directory "
+           "\"scrollback\" in WeeChat home), so that they are displayed "
+           "again when scrolling above the first line of buffer (not for "
+           "merged buffers); files are deleted when buffers are cleared "
+           "or closed"),
+        NULL, 0, 0, "off", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     config_history_display_default = config_file_new_option (
         weechat_config_file, ptr_section,
         "display_default", "integer",
@@ -4209,6 +4317,14 @@ config_weechat_init_options ()
         N_("maximum number of visited buffers to keep in memory"),
         NULL, 0, 1000, "50", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_history_remove_duplicates = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "remove_duplicates", "boolean",
+        N_("remove the older entry with same text when a text/command is "
+           "added in history (each text is then in history only once); if "
+           "disabled, only a text equal to the last one is ignored"),
+        NULL, 0, 0, "off", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* proxies */
     ptr_section = config_file_new_section (
@@ -4248,6 +4364,17 @@ config_weechat_init_options ()
            "child process)"),
         NULL, 1, INT_MAX, "60", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_network_dns_cache_ttl = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "dns_cache_ttl", "integer",
+        N_("time (in seconds) addresses resolved for connections without "
+           "proxy are kept in cache, so that reconnections do not resolve "
+           "them again (an address is removed from cache if the connection "
+           "fails); 0 = disable cache"),
+        NULL, 0, 86400, "300", NULL, 0,
+        NULL, NULL, NULL,
+        &config_change_network_dns_cache_ttl, NULL, NULL,
+        NULL, NULL, NULL);
     config_network_gnutls_ca_file = config_file_new_option (
         weechat_config_file, ptr_section,
         "gnutls_ca_file", "string",
@@ -4273,6 +4400,16 @@ config_weechat_init_options ()
         &config_check_proxy_curl, NULL, NULL,
         NULL, NULL, NULL,
         NULL, NULL, NULL);
+    config_network_url_multi = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "url_multi", "boolean",
+        N_("download URLs (function hook_process with \"url:\") in WeeChat "
+           "process, without blocking, instead of a child process: the "
+           "connections, DNS cache and TLS sessions are shared between "
+           "downloads; this is used only if Curl resolves names "
+           "asynchronously (otherwise a child process is always used)"),
+        NULL, 0, 0, "on", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* plugin */
     ptr_section = config_file_new_section (weechat_config_file, "plugin",
@@ -4313,6 +4450,18 @@ config_weechat_init_options ()
         NULL, NULL, NULL,
         &config_change_plugin_extension, NULL, NULL,
         NULL, NULL, NULL);
+    config_plugin_lazy_load = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "lazy_load", "string",
+        N_("comma separated list of plugins which are loaded on first use "
+           "instead of startup (they must be allowed by option "
+           "weechat.plugin.autoload): the plugin is loaded when its command "
+           "(same name as plugin) is used, or an info, infolist, signal or "
+           "bar item with name beginning with plugin name and underscore "
+           "(for example \"aspell_dict\"); wildcard \"*\" is allowed in "
+           "names (example: \"aspell,script,xfer\")"),
+        NULL, 0, 0, "", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     config_plugin_path = config_file_new_option (
         weechat_config_file, ptr_section,
         "path", "string",
@@ -4320,12 +4469,70 @@ config_weechat_init_options ()
            "WeeChat home, \"~/.weechat\" by default)"),
         NULL, 0, 0, "%h/plugins", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_plugin_process_max_running = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "process_max_running", "integer",
+        N_("max number of processes (hook_process, for example commands "
+           "launched by /exec or URLs downloaded by scripts) running at same "
+           "time; other processes are queued and started when a running "
+           "process ends, in order of creation; the timeout of a process "
+           "includes the time spent in queue (0 = no limit)"),
+        NULL, 0, INT_MAX, "0", NULL, 0,
+        NULL, NULL, NULL,
+        &config_change_plugin_process_max_running, NULL, NULL,
+        NULL, NULL, NULL);
+    config_plugin_process_max_running_per_plugin = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "process_max_running_per_plugin", "integer",
+        N_("max number of processes (hook_process) running at same time "
+           "for a single plugin (all scripts of a script plugin are counted "
+           "together), see option weechat.plugin.process_max_running "
+           "(0 = no limit)"),
+        NULL, 0, INT_MAX, "0", NULL, 0,
+        NULL, NULL, NULL,
+        &config_change_plugin_process_max_running, NULL, NULL,
+        NULL, NULL, NULL);
     config_plugin_save_config_on_unload = config_file_new_option (
         weechat_config_file, ptr_section,
         "save_config_on_unload", "boolean",
         N_("save configuration files when unloading plugins"),
         NULL, 0, 0, "on", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_plugin_script_callback_budget = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "script_callback_budget", "integer",
+        N_("soft budget for a callback of a script (in milliseconds): when "
+           "a callback takes more time, the action of option "
+           "weechat.plugin.script_callback_budget_action is done "
+           "(0 = disable, see also /script stats)"),
+        NULL, 0, INT_MAX, "0", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_plugin_script_callback_budget_action = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "script_callback_budget_action", "integer",
+        N_("action done when a callback of a script exceeds the budget "
+           "(option weechat.plugin.script_callback_budget): warning = "
+           "display a warning (only once per hook), unhook = display a "
+           "message and remove the hook"),
+        "warning|unhook", 0, 0, "warning", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_plugin_script_callback_timeout = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "script_callback_timeout", "integer",
+        N_("max time for a callback of a script (in milliseconds): a "
+           "callback running longer is interrupted with an error; this is "
+           "supported only by lua and tcl scripts (0 = no limit)"),
+        NULL, 0, INT_MAX, "0", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_plugin_slow_callback = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "slow_callback", "integer",
+        N_("log in WeeChat log file the calls of hook callbacks which take "
+           "more than this delay (in milliseconds), to find plugins or "
+           "scripts slowing down WeeChat (0 = disable, see also "
+           "/debug hooks)"),
+        NULL, 0, INT_MAX, "0", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* bars */
     ptr_section = config_file_new_section (
@@ -4359,6 +4566,9 @@ config_weechat_init_options ()
         return 0;
     }
 
+    weechat_config_section_layout = ptr_section;
+    config_file_set_dirty (weechat_config_file, ptr_section);
+
     /* notify */
     ptr_section = config_file_new_section (
         weechat_config_file, "notify",
@@ -4391,6 +4601,9 @@ config_weechat_init_options ()
         return 0;
     }
 
+    weechat_config_section_filter = ptr_section;
+    config_file_set_dirty (weechat_config_file, ptr_section);
+
     /* keys */
     for (i = 0; i < GUI_KEY_NUM_CONTEXTS; i++)
     {
@@ -4411,6 +4624,9 @@ config_weechat_init_options ()
             config_file_free (weechat_config_file);
             return 0;
         }
+
+        weechat_config_section_key[i] = ptr_section;
+        config_file_set_dirty (weechat_config_file, ptr_section);
     }
 
     return 1;
@@ -4516,10 +4732,11 @@ config_weechat_free ()
     int i;
 
     config_file_free (weechat_config_file);
+    weechat_config_file = NULL;
 
     if (config_highlight_regex)
     {
-        regfree (config_highlight_regex);
+        string_regfree (config_highlight_regex);
         free (config_highlight_regex);
         config_highlight_regex = NULL;
     }
@@ -4528,7 +4745,7 @@ config_weechat_free ()
     {
         for (i = 0; i < config_num_highlight_tags; i++)
         {
-            string_free_split (config_highlight_tags[i]);
+            string_free_split_shared (config_highlight_tags[i]);
         }
         free (config_highlight_tags);
         config_highlight_tags = NULL;
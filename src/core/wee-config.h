@@ -113,6 +113,12 @@ enum t_config_look_save_layout_on_exit
     CONFIG_LOOK_SAVE_LAYOUT_ON_EXIT_ALL,
 };
 
+enum t_config_plugin_script_callback_budget_action
+{
+    CONFIG_PLUGIN_SCRIPT_CALLBACK_BUDGET_ACTION_WARNING = 0,
+    CONFIG_PLUGIN_SCRIPT_CALLBACK_BUDGET_ACTION_UNHOOK,
+};
+
 struct t_config_look_word_char_item
 {
     char exclude;                      /* 1 if char is NOT a word char      */
@@ -126,6 +132,9 @@ extern struct t_config_section *weechat_config_section_color;
 extern struct t_config_section *weechat_config_section_proxy;
 extern struct t_config_section *weechat_config_section_bar;
 extern struct t_config_section *weechat_config_section_notify;
+extern struct t_config_section *weechat_config_section_layout;
+extern struct t_config_section *weechat_config_section_filter;
+extern struct t_config_section *weechat_config_section_key[];
 
 extern struct t_config_option *config_startup_command_after_plugins;
 extern struct t_config_option *config_startup_command_before_plugins;
@@ -146,6 +155,7 @@ extern struct t_config_option *config_look_buffer_notify_default;
 extern struct t_config_option *config_look_buffer_position;
 extern struct t_config_option *config_look_buffer_search_case_sensitive;
 extern struct t_config_option *config_look_buffer_search_force_default;
+extern struct t_config_option *config_look_buffer_search_index;
 extern struct t_config_option *config_look_buffer_search_regex;
 extern struct t_config_option *config_look_buffer_search_where;
 extern struct t_config_option *config_look_buffer_time_format;
@@ -228,6 +238,7 @@ extern struct t_config_option *config_look_quote_time_format;
 extern struct t_config_option *config_look_read_marker;
 extern struct t_config_option *config_look_read_marker_always_show;
 extern struct t_config_option *config_look_read_marker_string;
+extern struct t_config_option *config_look_refresh_max_fps;
 extern struct t_config_option *config_look_save_config_on_exit;
 extern struct t_config_option *config_look_save_layout_on_exit;
 extern struct t_config_option *config_look_scroll_amount;
@@ -320,21 +331,32 @@ extern struct t_config_option *config_completion_partial_completion_count;
 extern struct t_config_option *config_completion_partial_completion_other;
 
 extern struct t_config_option *config_history_display_default;
+extern struct t_config_option *config_history_buffer_lines_on_disk;
 extern struct t_config_option *config_history_max_buffer_lines_minutes;
 extern struct t_config_option *config_history_max_buffer_lines_number;
 extern struct t_config_option *config_history_max_commands;
 extern struct t_config_option *config_history_max_visited_buffers;
+extern struct t_config_option *config_history_remove_duplicates;
 
 extern struct t_config_option *config_network_connection_timeout;
+extern struct t_config_option *config_network_dns_cache_ttl;
 extern struct t_config_option *config_network_gnutls_ca_file;
 extern struct t_config_option *config_network_gnutls_handshake_timeout;
 extern struct t_config_option *config_network_proxy_curl;
+extern struct t_config_option *config_network_url_multi;
 
 extern struct t_config_option *config_plugin_autoload;
 extern struct t_config_option *config_plugin_debug;
 extern struct t_config_option *config_plugin_extension;
+extern struct t_config_option *config_plugin_lazy_load;
 extern struct t_config_option *config_plugin_path;
+extern struct t_config_option *config_plugin_process_max_running;
+extern struct t_config_option *config_plugin_process_max_running_per_plugin;
 extern struct t_config_option *config_plugin_save_config_on_unload;
+extern struct t_config_option *config_plugin_script_callback_budget;
+extern struct t_config_option *config_plugin_script_callback_budget_action;
+extern struct t_config_option *config_plugin_script_callback_timeout;
+extern struct t_config_option *config_plugin_slow_callback;
 
 extern int config_length_nick_prefix_suffix;
 extern int config_length_prefix_same_nick;
@@ -38,15 +38,22 @@
 #include <gnutls/gnutls.h>
 #endif
 
+#ifdef HAVE_PCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#endif
+
 #include "weechat.h"
 #include "wee-backtrace.h"
 #include "wee-config-file.h"
+#include "wee-debug.h"
 #include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-infolist.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-profile.h"
 #include "wee-proxy.h"
 #include "wee-string.h"
 #include "wee-util.h"
@@ -58,13 +65,18 @@
 #include "../gui/gui-hotlist.h"
 #include "../gui/gui-key.h"
 #include "../gui/gui-layout.h"
+#include "../gui/gui-line.h"
 #include "../gui/gui-main.h"
+#include "../gui/gui-nicklist.h"
 #include "../gui/gui-window.h"
 #include "../plugins/plugin.h"
 
 
 int debug_dump_active = 0;
 
+int debug_startup_active = 0;          /* 1 if startup times are recorded   */
+struct t_debug_startup_time *debug_startup_times = NULL;
+
 
 /*
  * Writes dump of data to WeeChat log file.
@@ -275,6 +287,122 @@ debug_memory ()
 #endif /* HAVE_MALLINFO */
 }
 
+/*
+ * Displays memory used by buffers (lines and nicklist), by plugin, then
+ * sends signal "debug_memory" so that plugins display their own memory usage
+ * (for example queues of messages).
+ *
+ * Note: memory is computed by browsing data, shared strings are not counted.
+ */
+
+void
+debug_memory_detail ()
+{
+    struct t_gui_buffer *ptr_buffer;
+    struct t_weechat_plugin *ptr_plugin;
+    long lines_memory, nicklist_memory, total_lines, total_nicklist;
+    int buffers, lines;
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL, _("Memory used by buffers (bytes):"));
+    gui_chat_printf (NULL, "  %8s %12s %8s %12s  %s",
+                     "lines", "memory", "nicks", "memory", "buffer");
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        lines_memory = gui_lines_get_memory (ptr_buffer->own_lines, 1)
+            + gui_lines_get_memory (ptr_buffer->mixed_lines, 0);
+        nicklist_memory = gui_nicklist_get_memory (ptr_buffer->nicklist_root);
+        gui_chat_printf (NULL, "  %8d %12ld %8d %12ld  %s",
+                         ptr_buffer->own_lines->lines_count,
+                         lines_memory,
+                         ptr_buffer->nicklist_nicks_count,
+                         nicklist_memory,
+                         ptr_buffer->full_name);
+    }
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL, _("Memory used by buffers of plugins (bytes):"));
+    gui_chat_printf (NULL, "  %-12s %8s %10s %12s %12s",
+                     "plugin", "buffers", "lines", "lines mem.",
+                     "nicks mem.");
+    ptr_plugin = NULL;
+    while (1)
+    {
+        buffers = 0;
+        lines = 0;
+        total_lines = 0;
+        total_nicklist = 0;
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
+        {
+            if (ptr_buffer->plugin != ptr_plugin)
+                continue;
+            buffers++;
+            lines += ptr_buffer->own_lines->lines_count;
+            total_lines += gui_lines_get_memory (ptr_buffer->own_lines, 1)
+                + gui_lines_get_memory (ptr_buffer->mixed_lines, 0);
+            total_nicklist += gui_nicklist_get_memory (ptr_buffer->nicklist_root);
+        }
+        if (buffers > 0)
+        {
+            gui_chat_printf (NULL, "  %-12s %8d %10d %12ld %12ld",
+                             plugin_get_name (ptr_plugin),
+                             buffers, lines, total_lines, total_nicklist);
+        }
+        ptr_plugin = (ptr_plugin) ? ptr_plugin->next_plugin : weechat_plugins;
+        if (!ptr_plugin)
+            break;
+    }
+
+    (void) hook_signal_send ("debug_memory",
+                             WEECHAT_HOOK_SIGNAL_STRING, NULL);
+}
+
+/*
+ * Displays time spent (and size) for the last read and write of each
+ * configuration file.
+ */
+
+void
+debug_config ()
+{
+    struct t_config_file *ptr_config;
+    struct t_config_section *ptr_section;
+    struct t_config_option *ptr_option;
+    int count;
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL, "configuration files (last read/write):");
+    gui_chat_printf (NULL,
+                     "  %-16s %10s %10s %10s %10s %8s",
+                     "file", "read (ms)", "size", "write (ms)", "size",
+                     "options");
+
+    for (ptr_config = config_files; ptr_config;
+         ptr_config = ptr_config->next_config)
+    {
+        count = 0;
+        for (ptr_section = ptr_config->sections; ptr_section;
+             ptr_section = ptr_section->next_section)
+        {
+            for (ptr_option = ptr_section->options; ptr_option;
+                 ptr_option = ptr_option->next_option)
+            {
+                count++;
+            }
+        }
+        gui_chat_printf (NULL,
+                         "  %-16s %10.3f %10lu %10.3f %10lu %8d",
+                         ptr_config->filename,
+                         ((float)ptr_config->time_read) / 1000,
+                         ptr_config->size_read,
+                         ((float)ptr_config->time_write) / 1000,
+                         ptr_config->size_write,
+                         count);
+    }
+}
+
 /*
  * Callback called for each variable in hdata.
  */
@@ -409,6 +537,116 @@ debug_hooks ()
     gui_chat_printf (NULL, "%17s:%5d", "total", hooks_count_total);
 }
 
+/*
+ * Compares two hooks statistics to sort them (descending order).
+ */
+
+int
+debug_hooks_callbacks_cmp_cb (const void *stats1, const void *stats2)
+{
+    long key1, key2;
+
+    key1 = ((struct t_debug_hook_stats *)stats1)->key;
+    key2 = ((struct t_debug_hook_stats *)stats2)->key;
+
+    if (key1 > key2)
+        return -1;
+    if (key1 < key2)
+        return 1;
+    return 0;
+}
+
+/*
+ * Displays statistics on hook callbacks: number of calls, total and max time
+ * spent in callbacks.
+ *
+ * Argument "sort" is one of DEBUG_HOOKS_SORT_XXX, and "number" is the max
+ * number of hooks to display (0 = all hooks).
+ *
+ * Statistics are copied before being displayed, because displaying lines
+ * runs some hooks (print hooks), and then changes their statistics.
+ */
+
+void
+debug_hooks_callbacks (int sort, int number)
+{
+    struct t_debug_hook_stats *stats;
+    struct t_hook *ptr_hook;
+    const char *str_sort[] = { "calls", "total time", "max time" };
+    char description[512], str_plugin[256];
+    int type, i, count;
+
+    stats = malloc ((hooks_count_total + 1) * sizeof (*stats));
+    if (!stats)
+        return;
+
+    count = 0;
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (ptr_hook->deleted || (ptr_hook->calls == 0)
+                || (count >= hooks_count_total))
+            {
+                continue;
+            }
+            stats[count].hook = ptr_hook;
+            stats[count].calls = ptr_hook->calls;
+            stats[count].time_total = ptr_hook->time_total;
+            stats[count].time_max = ptr_hook->time_max;
+            switch (sort)
+            {
+                case DEBUG_HOOKS_SORT_CALLS:
+                    stats[count].key = ptr_hook->calls;
+                    break;
+                case DEBUG_HOOKS_SORT_MAX:
+                    stats[count].key = ptr_hook->time_max;
+                    break;
+                default:
+                    stats[count].key = ptr_hook->time_total;
+                    break;
+            }
+            count++;
+        }
+    }
+
+    qsort (stats, count, sizeof (*stats), &debug_hooks_callbacks_cmp_cb);
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     "hook callbacks (%d hooks called, sorted by %s):",
+                     count, str_sort[sort]);
+    gui_chat_printf (NULL,
+                     "  %12s %10s %10s %9s  %-12s %-24s %s",
+                     "total (ms)", "max (ms)", "avg (ms)", "calls",
+                     "type", "plugin", "hook");
+
+    if ((number > 0) && (number < count))
+        count = number;
+    for (i = 0; i < count; i++)
+    {
+        ptr_hook = stats[i].hook;
+        hook_get_description (ptr_hook, description, sizeof (description));
+        snprintf (str_plugin, sizeof (str_plugin),
+                  "%s%s%s",
+                  plugin_get_name (ptr_hook->plugin),
+                  (ptr_hook->subplugin) ? "/" : "",
+                  (ptr_hook->subplugin) ? ptr_hook->subplugin : "");
+        gui_chat_printf (NULL,
+                         "  %12.3f %10.3f %10.3f %9ld  %-12s %-24s %s",
+                         ((float)stats[i].time_total) / 1000,
+                         ((float)stats[i].time_max) / 1000,
+                         ((float)stats[i].time_total) / 1000 / stats[i].calls,
+                         stats[i].calls,
+                         hook_type_string[ptr_hook->type],
+                         str_plugin,
+                         description);
+    }
+
+    free (stats);
+}
+
 /*
  * Displays a list of infolists in memory.
  */
@@ -417,9 +655,10 @@ void
 debug_infolists ()
 {
     struct t_infolist *ptr_infolist;
+    struct t_infolist_schema *ptr_schema;
     struct t_infolist_item *ptr_item;
     struct t_infolist_var *ptr_var;
-    int i, count, count_items, count_vars, size_structs, size_data;
+    int i, j, count, count_items, count_vars, size_structs, size_data;
     int total_items, total_vars, total_size;
 
     count = 0;
@@ -455,35 +694,41 @@ debug_infolists ()
                 count_items++;
                 total_items++;
                 size_structs += sizeof (*ptr_item);
-                for (ptr_var = ptr_item->vars; ptr_var;
-                     ptr_var = ptr_var->next_var)
+                size_structs += ptr_item->vars_size * sizeof (ptr_item->vars[0]);
+                for (j = 0; j < ptr_item->vars_count; j++)
                 {
                     count_vars++;
                     total_vars++;
-                    size_structs += sizeof (*ptr_var);
-                    if (ptr_var->value)
+                    ptr_var = &(ptr_item->vars[j]);
+                    switch (ptr_item->schema->fields[j].type)
                     {
-                        switch (ptr_var->type)
-                        {
-                            case INFOLIST_INTEGER:
-                                size_data += sizeof (int);
-                                break;
-                            case INFOLIST_STRING:
-                                size_data += strlen ((char *)(ptr_var->value));
-                                break;
-                            case INFOLIST_POINTER:
-                                size_data += sizeof (void *);
-                                break;
-                            case INFOLIST_BUFFER:
-                                size_data += ptr_var->size;
-                                break;
-                            case INFOLIST_TIME:
-                                size_data += sizeof (time_t);
-                                break;
-                        }
+                        case INFOLIST_INTEGER:
+                            break;
+                        case INFOLIST_STRING:
+                            if (ptr_var->value.string)
+                                size_data += strlen (ptr_var->value.string);
+                            break;
+                        case INFOLIST_POINTER:
+                            break;
+                        case INFOLIST_BUFFER:
+                            size_data += ptr_var->size;
+                            break;
+                        case INFOLIST_TIME:
+                            break;
                     }
                 }
             }
+            for (ptr_schema = ptr_infolist->schemas; ptr_schema;
+                 ptr_schema = ptr_schema->next_schema)
+            {
+                size_structs += sizeof (*ptr_schema);
+                size_structs += ptr_schema->fields_size *
+                    sizeof (ptr_schema->fields[0]);
+                for (j = 0; j < ptr_schema->fields_count; j++)
+                {
+                    size_data += strlen (ptr_schema->fields[j].name);
+                }
+            }
             gui_chat_printf (NULL,
                              "%4d: infolist 0x%lx: %d items, %d vars - "
                              "structs: %d, data: %d (total: %d bytes)",
@@ -511,6 +756,10 @@ debug_libs_cb (const void *pointer, void *data,
                const char *signal, const char *type_data,
                void *signal_data)
 {
+#ifdef HAVE_PCRE2
+    uint32_t pcre2_jit;
+#endif /* HAVE_PCRE2 */
+
     /* make C compiler happy */
     (void) pointer;
     (void) data;
@@ -561,6 +810,17 @@ debug_libs_cb (const void *pointer, void *data,
     gui_chat_printf (NULL, "    zlib: (?)");
 #endif /* ZLIB_VERSION */
 
+    /* display pcre2 version */
+#ifdef HAVE_PCRE2
+    pcre2_jit = 0;
+    pcre2_config (PCRE2_CONFIG_JIT, &pcre2_jit);
+    gui_chat_printf (NULL, "    pcre2: %d.%d%s",
+                     PCRE2_MAJOR, PCRE2_MINOR,
+                     (pcre2_jit) ? " (JIT)" : "");
+#else
+    gui_chat_printf (NULL, "    pcre2: (not available)");
+#endif /* HAVE_PCRE2 */
+
     return WEECHAT_RC_OK;
 }
 
@@ -617,6 +877,120 @@ debug_display_time_elapsed (struct timeval *time1, struct timeval *time2,
     }
 }
 
+/*
+ * Starts recording of time spent in startup phases (called at beginning of
+ * WeeChat startup).
+ */
+
+void
+debug_startup_start ()
+{
+    debug_startup_active = 1;
+}
+
+/*
+ * Records time spent in a startup phase, from time_start to now; time_start
+ * is then set to current time, so that it can be used for next phase.
+ *
+ * Level is 0 for a phase of WeeChat startup, 1 for a detail inside a phase
+ * (for example load or init of a plugin).
+ */
+
+void
+debug_startup_time (const char *name, int level, struct timeval *time_start)
+{
+    struct timeval time_now;
+    struct t_debug_startup_time *new_time, *ptr_time, *ptr_prev;
+
+    if (!debug_startup_active || !name || !time_start)
+        return;
+
+    gettimeofday (&time_now, NULL);
+
+    new_time = malloc (sizeof (*new_time));
+    if (new_time)
+    {
+        new_time->name = strdup (name);
+        new_time->level = level;
+        new_time->start = util_timeval_diff (&weechat_current_start_timeval,
+                                             time_start);
+        new_time->duration = util_timeval_diff (time_start, &time_now);
+
+        /*
+         * insert time sorted by start (a phase is recorded after its details,
+         * but it must be displayed before them)
+         */
+        ptr_prev = NULL;
+        for (ptr_time = debug_startup_times; ptr_time;
+             ptr_time = ptr_time->next_time)
+        {
+            if (ptr_time->start > new_time->start)
+                break;
+            ptr_prev = ptr_time;
+        }
+        new_time->next_time = ptr_time;
+        if (ptr_prev)
+            ptr_prev->next_time = new_time;
+        else
+            debug_startup_times = new_time;
+    }
+
+    *time_start = time_now;
+}
+
+/*
+ * Stops recording of time spent in startup phases; if display is 1, times
+ * recorded are displayed in core buffer and written in log file.
+ */
+
+void
+debug_startup_end (int display)
+{
+    struct timeval time_now;
+    struct t_debug_startup_time *ptr_time, *next_time;
+    long long total;
+
+    if (display)
+    {
+        gettimeofday (&time_now, NULL);
+        total = util_timeval_diff (&weechat_current_start_timeval, &time_now);
+        gui_chat_printf (NULL, "");
+        gui_chat_printf (NULL, "startup profile (times in milliseconds):");
+        gui_chat_printf (NULL, "  %10s %10s  %s", "start", "time", "phase");
+        log_printf ("startup profile (times in milliseconds):");
+        for (ptr_time = debug_startup_times; ptr_time;
+             ptr_time = ptr_time->next_time)
+        {
+            gui_chat_printf (NULL,
+                             "  %10.3f %10.3f  %s%s",
+                             ((float)ptr_time->start) / 1000,
+                             ((float)ptr_time->duration) / 1000,
+                             (ptr_time->level > 0) ? "  " : "",
+                             ptr_time->name);
+            log_printf ("  %10.3f %10.3f  %s%s",
+                        ((float)ptr_time->start) / 1000,
+                        ((float)ptr_time->duration) / 1000,
+                        (ptr_time->level > 0) ? "  " : "",
+                        ptr_time->name);
+        }
+        gui_chat_printf (NULL, "  total: %.3f ms", ((float)total) / 1000);
+        log_printf ("  total: %.3f ms", ((float)total) / 1000);
+    }
+
+    ptr_time = debug_startup_times;
+    while (ptr_time)
+    {
+        next_time = ptr_time->next_time;
+        if (ptr_time->name)
+            free (ptr_time->name);
+        free (ptr_time);
+        ptr_time = next_time;
+    }
+    debug_startup_times = NULL;
+
+    debug_startup_active = 0;
+}
+
 /*
  * Initializes debug.
  */
@@ -640,4 +1014,5 @@ debug_init ()
 void
 debug_end ()
 {
+    profile_end ();
 }
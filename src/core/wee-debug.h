@@ -21,18 +21,52 @@
 #define WEECHAT_DEBUG_H 1
 
 struct t_gui_window_tree;
+struct t_hook;
+
+enum t_debug_hooks_sort
+{
+    DEBUG_HOOKS_SORT_CALLS = 0,        /* sort by number of calls           */
+    DEBUG_HOOKS_SORT_TOTAL,            /* sort by total time in callback    */
+    DEBUG_HOOKS_SORT_MAX,              /* sort by max time in callback      */
+};
+
+struct t_debug_hook_stats
+{
+    struct t_hook *hook;               /* pointer to hook                   */
+    long calls;                        /* number of calls of callback       */
+    long time_total;                   /* total time spent in callback      */
+    long time_max;                     /* max time spent in one call        */
+    long key;                          /* value used to sort statistics     */
+};
+
+struct t_debug_startup_time
+{
+    char *name;                        /* name of phase                     */
+    int level;                         /* 0 = phase, 1 = detail of a phase  */
+    long long start;                   /* start (microseconds since start   */
+                                       /* of WeeChat)                       */
+    long long duration;                /* time spent (in microseconds)      */
+    struct t_debug_startup_time *next_time; /* link to next time            */
+};
 
 extern void debug_sigsegv ();
 extern void debug_windows_tree ();
 extern void debug_memory ();
+extern void debug_memory_detail ();
+extern void debug_config ();
 extern void debug_hdata ();
 extern void debug_hooks ();
+extern void debug_hooks_callbacks (int sort, int number);
 extern void debug_infolists ();
 extern void debug_directories ();
 extern void debug_display_time_elapsed (struct timeval *time1,
                                         struct timeval *time2,
                                         const char *message,
                                         int display);
+extern void debug_startup_start ();
+extern void debug_startup_time (const char *name, int level,
+                                struct timeval *time_start);
+extern void debug_startup_end (int display);
 extern void debug_init ();
 extern void debug_end ();
 
@@ -49,10 +49,34 @@ char *logical_ops[EVAL_NUM_LOGICAL_OPS] =
 char *comparisons[EVAL_NUM_COMPARISONS] =
 { "=~", "!~", "==", "!=", "<=", "<", ">=", ">" };
 
+/* cache of compiled hdata paths (key: "hdata.path") */
+struct t_hashtable *eval_hdata_paths = NULL;
+
+/* cache of compiled expressions (most recently used first) */
+struct t_hashtable *eval_compiled_cache = NULL;
+struct t_eval_compiled *eval_compiled_first = NULL;
+struct t_eval_compiled *eval_compiled_last = NULL;
+int eval_compiled_count = 0;
+
+/*
+ * memoized values of info, secured data and hdata (key: variable), used only
+ * in evaluations with option "cache" (reset on each refresh and signal)
+ */
+struct t_hashtable *eval_memo = NULL;
+int eval_memo_enabled = 0;
+
 char *eval_replace_vars (const char *expr, struct t_hashtable *pointers,
                          struct t_hashtable *extra_vars, int extra_vars_eval,
                          const char *prefix, const char *suffix,
                          struct t_eval_regex *eval_regex);
+struct t_eval_compiled *eval_cache_get (const char *expr, int condition,
+                                        const char *prefix,
+                                        const char *suffix);
+void eval_cache_release (struct t_eval_compiled *compiled);
+char *eval_compiled_run (struct t_eval_compiled *compiled,
+                         struct t_hashtable *pointers,
+                         struct t_hashtable *extra_vars, int extra_vars_eval,
+                         struct t_eval_regex *eval_regex);
 
 
 /*
@@ -70,22 +94,335 @@ eval_is_true (const char *value)
     return (value && value[0] && (strcmp (value, "0") != 0)) ? 1 : 0;
 }
 
+/*
+ * Compiles a hdata path: variables are resolved once, so that the same path
+ * can be evaluated many times without lookup of variables by name.
+ *
+ * Returns pointer to compiled path, NULL if error.
+ *
+ * Note: result must be freed after use (with eval_hdata_path_free).
+ */
+
+struct t_eval_hdata_path *
+eval_hdata_path_compile (struct t_hdata *hdata, const char *path)
+{
+    struct t_eval_hdata_path *new_path;
+    struct t_eval_hdata_path_step *ptr_step;
+    struct t_hdata_var *var;
+    char *ptr_name, *pos;
+    int count;
+
+    new_path = malloc (sizeof (*new_path));
+    if (!new_path)
+        return NULL;
+
+    new_path->path = strdup (path);
+    if (!new_path->path)
+    {
+        free (new_path);
+        return NULL;
+    }
+
+    /* number of steps: one per variable + one for a trailing "." */
+    count = 2;
+    for (pos = new_path->path; pos[0]; pos++)
+    {
+        if (pos[0] == '.')
+            count++;
+    }
+    new_path->steps = malloc (count * sizeof (new_path->steps[0]));
+    if (!new_path->steps)
+    {
+        free (new_path->path);
+        free (new_path);
+        return NULL;
+    }
+    new_path->steps_count = 0;
+
+    ptr_name = new_path->path;
+    while (1)
+    {
+        ptr_step = &(new_path->steps[new_path->steps_count]);
+        new_path->steps_count++;
+        ptr_step->offset = 0;
+        ptr_step->key = NULL;
+
+        /* empty path after a pointer: the value is the pointer itself */
+        if (!ptr_name[0])
+        {
+            ptr_step->type = EVAL_HDATA_PATH_STEP_POINTER;
+            break;
+        }
+
+        /*
+         * look for name of variable, for example in "buffer.full_name", the
+         * variable name is "buffer"
+         */
+        var = NULL;
+        pos = strchr (ptr_name, '.');
+        if (hdata)
+        {
+            if (pos > ptr_name)
+                pos[0] = '\0';
+            var = hashtable_get (hdata->hash_var, ptr_name);
+            if (pos > ptr_name)
+                pos[0] = '.';
+        }
+        if (!var)
+        {
+            ptr_step->type = EVAL_HDATA_PATH_STEP_INVALID;
+            break;
+        }
+
+        ptr_step->type = var->type;
+        ptr_step->offset = var->offset;
+
+        /*
+         * for a hashtable, if there is a "." after name of variable,
+         * the remaining path is the key in hashtable
+         */
+        if ((var->type == WEECHAT_HDATA_HASHTABLE) && pos)
+        {
+            ptr_step->key = pos + 1;
+            break;
+        }
+
+        /*
+         * if we are on a pointer and that something else is in path
+         * (after "."), go on with hdata of this pointer and remaining path
+         */
+        if ((var->type != WEECHAT_HDATA_POINTER) || !pos || !var->hdata_name)
+            break;
+        hdata = hook_hdata_get (NULL, var->hdata_name);
+        ptr_name = pos + 1;
+    }
+
+    new_path->generation = hdata_generation;
+
+    return new_path;
+}
+
+/*
+ * Frees a compiled hdata path.
+ */
+
+void
+eval_hdata_path_free (struct t_eval_hdata_path *hdata_path)
+{
+    if (!hdata_path)
+        return;
+
+    free (hdata_path->path);
+    free (hdata_path->steps);
+    free (hdata_path);
+}
+
+/*
+ * Frees a compiled hdata path in hashtable "eval_hdata_paths".
+ */
+
+void
+eval_hdata_path_free_value_cb (struct t_hashtable *hashtable,
+                               const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    eval_hdata_path_free ((struct t_eval_hdata_path *)value);
+}
+
+/*
+ * Gets compiled hdata path from cache (the path is compiled and added in
+ * cache if not found or if hdata have changed since compilation).
+ *
+ * Argument "cached" is set to 1 if the returned path is in cache, 0 if it
+ * must be freed by caller after use.
+ *
+ * Returns pointer to compiled path, NULL if error.
+ */
+
+struct t_eval_hdata_path *
+eval_hdata_path_get (struct t_hdata *hdata, const char *path, int *cached)
+{
+    struct t_eval_hdata_path *ptr_path;
+    char key[512];
+    int length;
+
+    *cached = 0;
+
+    length = snprintf (key, sizeof (key), "%s.%s", hdata->name, path);
+    if ((length < 0) || (length >= (int)sizeof (key)))
+        return eval_hdata_path_compile (hdata, path);
+
+    if (!eval_hdata_paths)
+    {
+        eval_hdata_paths = hashtable_new (32,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          WEECHAT_HASHTABLE_POINTER,
+                                          NULL,
+                                          NULL);
+        if (!eval_hdata_paths)
+            return eval_hdata_path_compile (hdata, path);
+        eval_hdata_paths->callback_free_value = &eval_hdata_path_free_value_cb;
+    }
+
+    ptr_path = hashtable_get (eval_hdata_paths, key);
+    if (ptr_path && (ptr_path->generation == hdata_generation))
+    {
+        *cached = 1;
+        return ptr_path;
+    }
+
+    ptr_path = eval_hdata_path_compile (hdata, path);
+    if (!ptr_path)
+        return NULL;
+
+    if (eval_hdata_paths->items_count >= EVAL_HDATA_PATH_CACHE_MAX)
+        hashtable_remove_all (eval_hdata_paths);
+    if (!hashtable_set (eval_hdata_paths, key, ptr_path))
+        return ptr_path;
+
+    *cached = 1;
+    return ptr_path;
+}
+
+/*
+ * Gets value of a hashtable item as string.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_hashtable_get_value (struct t_hashtable *hashtable, const char *key)
+{
+    const char *ptr_value;
+    char str_value[128];
+
+    if (!hashtable)
+        return NULL;
+
+    ptr_value = hashtable_get (hashtable, key);
+    if (!ptr_value)
+        return NULL;
+
+    switch (hashtable->type_values)
+    {
+        case HASHTABLE_INTEGER:
+            snprintf (str_value, sizeof (str_value),
+                      "%d", *((int *)ptr_value));
+            return strdup (str_value);
+        case HASHTABLE_STRING:
+            return strdup (ptr_value);
+        case HASHTABLE_POINTER:
+        case HASHTABLE_BUFFER:
+            snprintf (str_value, sizeof (str_value),
+                      "0x%lx", (long unsigned int)ptr_value);
+            return strdup (str_value);
+        case HASHTABLE_TIME:
+            snprintf (str_value, sizeof (str_value),
+                      "%ld", (long)(*((time_t *)ptr_value)));
+            return strdup (str_value);
+        case HASHTABLE_NUM_TYPES:
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Gets value of a compiled hdata path.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_hdata_path_get_value (struct t_eval_hdata_path *hdata_path,
+                           void *pointer)
+{
+    struct t_eval_hdata_path_step *ptr_step;
+    char str_value[128];
+    const char *ptr_value;
+    void *ptr_var;
+    int i;
+
+    for (i = 0; i < hdata_path->steps_count; i++)
+    {
+        /* NULL pointer? return empty string */
+        if (!pointer)
+            return strdup ("");
+
+        ptr_step = &(hdata_path->steps[i]);
+        ptr_var = (ptr_step->offset >= 0) ? pointer + ptr_step->offset : NULL;
+
+        /* build a string with the value or variable */
+        switch (ptr_step->type)
+        {
+            case EVAL_HDATA_PATH_STEP_INVALID:
+                return NULL;
+            case EVAL_HDATA_PATH_STEP_POINTER:
+                snprintf (str_value, sizeof (str_value),
+                          "0x%lx", (long unsigned int)pointer);
+                return strdup (str_value);
+            case WEECHAT_HDATA_CHAR:
+                snprintf (str_value, sizeof (str_value),
+                          "%c", (ptr_var) ? *((char *)ptr_var) : '\0');
+                return strdup (str_value);
+            case WEECHAT_HDATA_INTEGER:
+                snprintf (str_value, sizeof (str_value),
+                          "%d", (ptr_var) ? *((int *)ptr_var) : 0);
+                return strdup (str_value);
+            case WEECHAT_HDATA_LONG:
+                snprintf (str_value, sizeof (str_value),
+                          "%ld", (ptr_var) ? *((long *)ptr_var) : 0);
+                return strdup (str_value);
+            case WEECHAT_HDATA_STRING:
+            case WEECHAT_HDATA_SHARED_STRING:
+                ptr_value = (ptr_var) ? *((char **)ptr_var) : NULL;
+                return (ptr_value) ? strdup (ptr_value) : NULL;
+            case WEECHAT_HDATA_POINTER:
+                pointer = (ptr_var) ? *((void **)ptr_var) : NULL;
+                if (i < hdata_path->steps_count - 1)
+                    break;
+                snprintf (str_value, sizeof (str_value),
+                          "0x%lx", (long unsigned int)pointer);
+                return strdup (str_value);
+            case WEECHAT_HDATA_TIME:
+                snprintf (str_value, sizeof (str_value),
+                          "%ld", (ptr_var) ? (long)(*((time_t *)ptr_var)) : 0);
+                return strdup (str_value);
+            case WEECHAT_HDATA_HASHTABLE:
+                pointer = (ptr_var) ? *((void **)ptr_var) : NULL;
+                if (ptr_step->key)
+                {
+                    return eval_hashtable_get_value (pointer, ptr_step->key);
+                }
+                snprintf (str_value, sizeof (str_value),
+                          "0x%lx", (long unsigned int)pointer);
+                return strdup (str_value);
+            default:
+                return NULL;
+        }
+    }
+
+    return NULL;
+}
+
 /*
  * Gets value of hdata using "path" to a variable.
  *
+ * The path is compiled on first use and kept in a cache, so that the
+ * variables are not searched by name on next evaluations.
+ *
  * Note: result must be freed after use.
  */
 
 char *
 eval_hdata_get_value (struct t_hdata *hdata, void *pointer, const char *path)
 {
-    char *value, *old_value, *var_name, str_value[128], *pos;
-    const char *ptr_value, *hdata_name;
-    int type;
-    struct t_hashtable *hashtable;
-
-    value = NULL;
-    var_name = NULL;
+    struct t_eval_hdata_path *ptr_path;
+    char *value, str_value[128];
+    int cached;
 
     /* NULL pointer? return empty string */
     if (!pointer)
@@ -99,127 +436,79 @@ eval_hdata_get_value (struct t_hdata *hdata, void *pointer, const char *path)
         return strdup (str_value);
     }
 
-    /*
-     * look for name of hdata, for example in "window.buffer.full_name", the
-     * hdata name is "window"
-     */
-    pos = strchr (path, '.');
-    if (pos > path)
-        var_name = string_strndup (path, pos - path);
-    else
-        var_name = strdup (path);
+    if (!hdata)
+        return NULL;
 
-    if (!var_name)
-        goto end;
+    ptr_path = eval_hdata_path_get (hdata, path, &cached);
+    if (!ptr_path)
+        return NULL;
 
-    /* search type of variable in hdata */
-    type = hdata_get_var_type (hdata, var_name);
-    if (type < 0)
-        goto end;
+    value = eval_hdata_path_get_value (ptr_path, pointer);
+
+    if (!cached)
+        eval_hdata_path_free (ptr_path);
+
+    return value;
+}
+
+/*
+ * Searches a memoized value of a variable (only if memoization is enabled).
+ *
+ * Returns a copy of value (must be freed after use), NULL if not found.
+ */
+
+char *
+eval_memo_get (const char *key)
+{
+    const char *ptr_value;
+
+    if (!eval_memo_enabled || !eval_memo || !key)
+        return NULL;
+
+    ptr_value = hashtable_get (eval_memo, key);
+
+    return (ptr_value) ? strdup (ptr_value) : NULL;
+}
+
+/*
+ * Memoizes value of a variable (only if memoization is enabled).
+ */
+
+void
+eval_memo_set (const char *key, const char *value)
+{
+    if (!eval_memo_enabled || !key || !value)
+        return;
 
-    /* build a string with the value or variable */
-    switch (type)
+    if (!eval_memo)
     {
-        case WEECHAT_HDATA_CHAR:
-            snprintf (str_value, sizeof (str_value),
-                      "%c", hdata_char (hdata, pointer, var_name));
-            value = strdup (str_value);
-            break;
-        case WEECHAT_HDATA_INTEGER:
-            snprintf (str_value, sizeof (str_value),
-                      "%d", hdata_integer (hdata, pointer, var_name));
-            value = strdup (str_value);
-            break;
-        case WEECHAT_HDATA_LONG:
-            snprintf (str_value, sizeof (str_value),
-                      "%ld", hdata_long (hdata, pointer, var_name));
-            value = strdup (str_value);
-            break;
-        case WEECHAT_HDATA_STRING:
-        case WEECHAT_HDATA_SHARED_STRING:
-            ptr_value = hdata_string (hdata, pointer, var_name);
-            value = (ptr_value) ? strdup (ptr_value) : NULL;
-            break;
-        case WEECHAT_HDATA_POINTER:
-            pointer = hdata_pointer (hdata, pointer, var_name);
-            snprintf (str_value, sizeof (str_value),
-                      "0x%lx", (long unsigned int)pointer);
-            value = strdup (str_value);
-            break;
-        case WEECHAT_HDATA_TIME:
-            snprintf (str_value, sizeof (str_value),
-                      "%ld", (long)hdata_time (hdata, pointer, var_name));
-            value = strdup (str_value);
-            break;
-        case WEECHAT_HDATA_HASHTABLE:
-            pointer = hdata_hashtable (hdata, pointer, var_name);
-            if (pos)
-            {
-                /*
-                 * for a hashtable, if there is a "." after name of hdata,
-                 * get the value for this key in hashtable
-                 */
-                hashtable = pointer;
-                ptr_value = hashtable_get (hashtable, pos + 1);
-                if (ptr_value)
-                {
-                    switch (hashtable->type_values)
-                    {
-                        case HASHTABLE_INTEGER:
-                            snprintf (str_value, sizeof (str_value),
-                                      "%d", *((int *)ptr_value));
-                            value = strdup (str_value);
-                            break;
-                        case HASHTABLE_STRING:
-                            value = strdup (ptr_value);
-                            break;
-                        case HASHTABLE_POINTER:
-                        case HASHTABLE_BUFFER:
-                            snprintf (str_value, sizeof (str_value),
-                                      "0x%lx", (long unsigned int)ptr_value);
-                            value = strdup (str_value);
-                            break;
-                        case HASHTABLE_TIME:
-                            snprintf (str_value, sizeof (str_value),
-                                      "%ld", (long)(*((time_t *)ptr_value)));
-                            value = strdup (str_value);
-                            break;
-                        case HASHTABLE_NUM_TYPES:
-                            break;
-                    }
-                }
-            }
-            else
-            {
-                snprintf (str_value, sizeof (str_value),
-                          "0x%lx", (long unsigned int)pointer);
-                value = strdup (str_value);
-            }
-            break;
+        eval_memo = hashtable_new (32,
+                                   WEECHAT_HASHTABLE_STRING,
+                                   WEECHAT_HASHTABLE_STRING,
+                                   NULL, NULL);
+        if (!eval_memo)
+            return;
     }
-
-    /*
-     * if we are on a pointer and that something else is in path (after "."),
-     * go on with this pointer and remaining path
-     */
-    if ((type == WEECHAT_HDATA_POINTER) && pos)
+    else if (eval_memo->items_count >= EVAL_MEMO_MAX)
     {
-        hdata_name = hdata_get_var_hdata (hdata, var_name);
-        if (!hdata_name)
-            goto end;
-
-        hdata = hook_hdata_get (NULL, hdata_name);
-        old_value = value;
-        value = eval_hdata_get_value (hdata, pointer, (pos) ? pos + 1 : NULL);
-        if (old_value)
-            free (old_value);
+        hashtable_remove_all (eval_memo);
     }
 
-end:
-    if (var_name)
-        free (var_name);
+    hashtable_set (eval_memo, key, value);
+}
 
-    return value;
+/*
+ * Removes all memoized values.
+ *
+ * This function is called before each refresh of screen and each time a
+ * signal is sent (values used in expressions may have changed).
+ */
+
+void
+eval_memo_reset ()
+{
+    if (eval_memo && (eval_memo->items_count > 0))
+        hashtable_remove_all (eval_memo);
 }
 
 /*
@@ -251,7 +540,7 @@ eval_replace_vars_cb (void *data, const char *text)
     struct t_config_option *ptr_option;
     struct t_gui_buffer *ptr_buffer;
     char str_value[512], *value, *pos, *pos1, *pos2, *hdata_name, *list_name;
-    char *tmp, *info_name, *hide_char, *hidden_string, *error;
+    char *tmp, *info_name, *hide_char, *hidden_string, *error, *memo_key;
     const char *prefix, *suffix, *ptr_value, *ptr_arguments, *ptr_string;
     struct t_hdata *hdata;
     void *pointer;
@@ -372,6 +661,9 @@ eval_replace_vars_cb (void *data, const char *text)
     /* 7. info */
     if (strncmp (text, "info:", 5) == 0)
     {
+        value = eval_memo_get (text);
+        if (value)
+            return value;
         ptr_value = NULL;
         ptr_arguments = strchr (text + 5, ',');
         if (ptr_arguments)
@@ -386,6 +678,7 @@ eval_replace_vars_cb (void *data, const char *text)
             ptr_value = hook_info_get (NULL, info_name, ptr_arguments);
             free (info_name);
         }
+        eval_memo_set (text, (ptr_value) ? ptr_value : "");
         return strdup ((ptr_value) ? ptr_value : "");
     }
 
@@ -413,7 +706,11 @@ eval_replace_vars_cb (void *data, const char *text)
     /* 10. option: if found, return this value */
     if (strncmp (text, "sec.data.", 9) == 0)
     {
+        value = eval_memo_get (text);
+        if (value)
+            return value;
         ptr_value = hashtable_get (secure_hashtable_data, text + 9);
+        eval_memo_set (text, (ptr_value) ? ptr_value : "");
         return strdup ((ptr_value) ? ptr_value : "");
     }
     else
@@ -457,6 +754,7 @@ eval_replace_vars_cb (void *data, const char *text)
     hdata_name = NULL;
     list_name = NULL;
     pointer = NULL;
+    memo_key = NULL;
 
     pos = strchr (text, '.');
     if (pos > text)
@@ -512,13 +810,32 @@ eval_replace_vars_cb (void *data, const char *text)
             goto end;
     }
 
+    if (eval_memo_enabled)
+    {
+        length = strlen (text) + 32;
+        memo_key = malloc (length);
+        if (memo_key)
+        {
+            snprintf (memo_key, length,
+                      "0x%lx:%s", (long unsigned int)pointer, text);
+            value = eval_memo_get (memo_key);
+            if (value)
+                goto end;
+        }
+    }
+
     value = eval_hdata_get_value (hdata, pointer, (pos) ? pos + 1 : NULL);
 
+    if (memo_key)
+        eval_memo_set (memo_key, (value) ? value : "");
+
 end:
     if (hdata_name)
         free (hdata_name);
     if (list_name)
         free (list_name);
+    if (memo_key)
+        free (memo_key);
 
     return (value) ? value : strdup ("");
 }
@@ -584,8 +901,8 @@ eval_compare (const char *expr1, int comparison, const char *expr2)
         {
             goto end;
         }
-        rc = (regexec (&regex, expr1, 0, NULL, 0) == 0) ? 1 : 0;
-        regfree (&regex);
+        rc = (string_regexec (&regex, expr1, 0, NULL, 0) == 0) ? 1 : 0;
+        string_regfree (&regex);
         if (comparison == EVAL_COMPARE_REGEX_NOT_MATCHING)
             rc ^= 1;
         goto end;
@@ -929,57 +1246,856 @@ end:
 }
 
 /*
- * Replaces text in a string using a regular expression and replacement text.
- *
- * The argument "regex" is a pointer to a regex compiled with WeeChat function
- * string_regcomp (or function regcomp).
- *
- * The argument "replace" is evaluated and can contain any valid expression,
- * and these ones:
- *   ${re:0} .. ${re:99}  match 0 to 99 (0 is whole match, 1 .. 99 are groups
- *                        captured)
- *   ${re:+}              the last match (with highest number)
- *
- * Examples:
- *
- *    string   | regex         | replace                    | result
- *   ----------+---------------+----------------------------+-------------
- *    test foo | test          | Z                          | Z foo
- *    test foo | ^(test +)(.*) | ${re:2}                    | foo
- *    test foo | ^(test +)(.*) | ${re:1}/ ${hide:*,${re:2}} | test / ***
- *    test foo | ^(test +)(.*) | ${hide:%,${re:+}}          | %%%
- *
- * Note: result must be freed after use.
+ * Frees a node of a compiled expression.
  */
 
-char *
-eval_replace_regex (const char *string, regex_t *regex, const char *replace,
-                    struct t_hashtable *pointers,
-                    struct t_hashtable *extra_vars, int extra_vars_eval,
-                    const char *prefix, const char *suffix)
+void
+eval_node_free (struct t_eval_node *node)
 {
-    char *result, *result2, *str_replace;
-    int length, length_replace, start_offset, i, rc, end;
-    struct t_eval_regex eval_regex;
-
-    if (!string || !regex || !replace)
-        return NULL;
+    int i;
 
-    length = strlen (string) + 1;
-    result = malloc (length);
-    if (!result)
-        return NULL;
-    snprintf (result, length, "%s", string);
+    if (!node)
+        return;
 
-    start_offset = 0;
-    while (result && result[start_offset])
+    eval_node_free (node->left);
+    eval_node_free (node->right);
+    if (node->text)
+        free (node->text);
+    for (i = 0; i < node->segments_count; i++)
     {
-        for (i = 0; i < 100; i++)
-        {
-            eval_regex.match[i].rm_so = -1;
+        if (node->segments[i].text)
+            free (node->segments[i].text);
+        eval_node_free (node->segments[i].name);
+    }
+    if (node->segments)
+        free (node->segments);
+
+    free (node);
+}
+
+/*
+ * Creates a new node for a compiled expression.
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_eval_node *
+eval_node_new (enum t_eval_node_type type, const char *text)
+{
+    struct t_eval_node *new_node;
+
+    new_node = malloc (sizeof (*new_node));
+    if (!new_node)
+        return NULL;
+
+    new_node->type = type;
+    new_node->op = 0;
+    new_node->left = NULL;
+    new_node->right = NULL;
+    new_node->text = (text) ? strdup (text) : NULL;
+    new_node->segments_count = 0;
+    new_node->segments = NULL;
+
+    if (text && !new_node->text)
+    {
+        free (new_node);
+        return NULL;
+    }
+
+    return new_node;
+}
+
+/*
+ * Adds a segment in a value node.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+eval_node_add_segment (struct t_eval_node *node, int variable,
+                       const char *text, int length)
+{
+    struct t_eval_segment *new_segments;
+
+    new_segments = realloc (node->segments,
+                            (node->segments_count + 1) *
+                            sizeof (node->segments[0]));
+    if (!new_segments)
+        return 0;
+    node->segments = new_segments;
+
+    node->segments[node->segments_count].variable = variable;
+    node->segments[node->segments_count].text = malloc (length + 1);
+    node->segments[node->segments_count].name = NULL;
+    if (!node->segments[node->segments_count].text)
+        return 0;
+    memcpy (node->segments[node->segments_count].text, text, length);
+    node->segments[node->segments_count].text[length] = '\0';
+    node->segments_count++;
+
+    return 1;
+}
+
+/*
+ * Compiles a string with variables to replace (same parsing as function
+ * string_replace_with_callback).
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_eval_node *
+eval_compile_value (const char *string, const char *prefix,
+                    const char *suffix)
+{
+    struct t_eval_node *new_node;
+    struct t_eval_segment *ptr_segment;
+    char *text;
+    const char *pos_end_name;
+    int length_prefix, length_suffix, index_string, length_text;
+    int sub_count, sub_level;
+
+    new_node = eval_node_new (EVAL_NODE_VALUE, string);
+    if (!new_node)
+        return NULL;
+
+    length_prefix = strlen (prefix);
+    length_suffix = strlen (suffix);
+
+    text = malloc (strlen (string) + 1);
+    if (!text)
+        goto error;
+    length_text = 0;
+
+    index_string = 0;
+    while (string[index_string])
+    {
+        if ((string[index_string] == '\\')
+            && (string[index_string + 1] == prefix[0]))
+        {
+            index_string++;
+            text[length_text++] = string[index_string++];
+        }
+        else if (strncmp (string + index_string, prefix, length_prefix) == 0)
+        {
+            sub_count = 0;
+            sub_level = 0;
+            pos_end_name = string + index_string + length_prefix;
+            while (pos_end_name[0])
+            {
+                if (strncmp (pos_end_name, suffix, length_suffix) == 0)
+                {
+                    if (sub_level == 0)
+                        break;
+                    sub_level--;
+                }
+                if ((pos_end_name[0] == '\\')
+                    && (pos_end_name[1] == prefix[0]))
+                {
+                    pos_end_name++;
+                }
+                else if (strncmp (pos_end_name, prefix, length_prefix) == 0)
+                {
+                    sub_count++;
+                    sub_level++;
+                }
+                pos_end_name++;
+            }
+            /* prefix without matching suffix: the string ends here */
+            if (!pos_end_name[0])
+                break;
+            if ((length_text > 0)
+                && !eval_node_add_segment (new_node, 0, text, length_text))
+            {
+                goto error;
+            }
+            length_text = 0;
+            if (!eval_node_add_segment (
+                    new_node, 1,
+                    string + index_string + length_prefix,
+                    pos_end_name - (string + index_string + length_prefix)))
+            {
+                goto error;
+            }
+            if (sub_count > 0)
+            {
+                ptr_segment = &(new_node->segments[new_node->segments_count - 1]);
+                ptr_segment->name = eval_compile_value (ptr_segment->text,
+                                                        prefix, suffix);
+                if (!ptr_segment->name)
+                    goto error;
+            }
+            index_string = pos_end_name - string + length_suffix;
+        }
+        else
+            text[length_text++] = string[index_string++];
+    }
+
+    if ((length_text > 0)
+        && !eval_node_add_segment (new_node, 0, text, length_text))
+    {
+        goto error;
+    }
+
+    free (text);
+
+    return new_node;
+
+error:
+    if (text)
+        free (text);
+    eval_node_free (new_node);
+    return NULL;
+}
+
+/*
+ * Compiles a condition (same parsing as function eval_expression_condition).
+ *
+ * Returns pointer to new node, NULL if error.
+ */
+
+struct t_eval_node *
+eval_compile_condition (const char *expr, const char *prefix,
+                        const char *suffix)
+{
+    struct t_eval_node *new_node;
+    int logic, comp, level;
+    const char *pos, *pos_end;
+    char *expr2, *sub_expr;
+
+    new_node = NULL;
+
+    /* skip spaces at beginning of string */
+    while (expr[0] == ' ')
+    {
+        expr++;
+    }
+    if (!expr[0])
+        return eval_compile_value (expr, prefix, suffix);
+
+    /* skip spaces at end of string */
+    pos_end = expr + strlen (expr) - 1;
+    while ((pos_end > expr) && (pos_end[0] == ' '))
+    {
+        pos_end--;
+    }
+
+    expr2 = string_strndup (expr, pos_end + 1 - expr);
+    if (!expr2)
+        return NULL;
+
+    /* search for a logical operator */
+    for (logic = 0; logic < EVAL_NUM_LOGICAL_OPS; logic++)
+    {
+        pos = eval_strstr_level (expr2, logical_ops[logic]);
+        if (pos > expr2)
+        {
+            new_node = eval_node_new (EVAL_NODE_LOGICAL, NULL);
+            if (!new_node)
+                goto end;
+            new_node->op = logic;
+            pos_end = pos - 1;
+            while ((pos_end > expr2) && (pos_end[0] == ' '))
+            {
+                pos_end--;
+            }
+            sub_expr = string_strndup (expr2, pos_end + 1 - expr2);
+            if (!sub_expr)
+                goto error;
+            new_node->left = eval_compile_condition (sub_expr, prefix, suffix);
+            free (sub_expr);
+            pos += strlen (logical_ops[logic]);
+            while (pos[0] == ' ')
+            {
+                pos++;
+            }
+            new_node->right = eval_compile_condition (pos, prefix, suffix);
+            if (!new_node->left || !new_node->right)
+                goto error;
+            goto end;
+        }
+    }
+
+    /* search for a comparison */
+    for (comp = 0; comp < EVAL_NUM_COMPARISONS; comp++)
+    {
+        pos = eval_strstr_level (expr2, comparisons[comp]);
+        if (pos > expr2)
+        {
+            new_node = eval_node_new (EVAL_NODE_COMPARE, NULL);
+            if (!new_node)
+                goto end;
+            new_node->op = comp;
+            pos_end = pos - 1;
+            while ((pos_end > expr2) && (pos_end[0] == ' '))
+            {
+                pos_end--;
+            }
+            sub_expr = string_strndup (expr2, pos_end + 1 - expr2);
+            if (!sub_expr)
+                goto error;
+            pos += strlen (comparisons[comp]);
+            while (pos[0] == ' ')
+            {
+                pos++;
+            }
+            if ((comp == EVAL_COMPARE_REGEX_MATCHING)
+                || (comp == EVAL_COMPARE_REGEX_NOT_MATCHING))
+            {
+                /* for regex: just replace vars in both expressions */
+                new_node->left = eval_compile_value (sub_expr, prefix, suffix);
+                new_node->right = eval_compile_value (pos, prefix, suffix);
+            }
+            else
+            {
+                /* other comparison: fully evaluate both expressions */
+                new_node->left = eval_compile_condition (sub_expr,
+                                                         prefix, suffix);
+                new_node->right = eval_compile_condition (pos,
+                                                          prefix, suffix);
+            }
+            free (sub_expr);
+            if (!new_node->left || !new_node->right)
+                goto error;
+            goto end;
+        }
+    }
+
+    /* sub-expression between parentheses */
+    if (expr2[0] == '(')
+    {
+        level = 0;
+        pos = expr2 + 1;
+        while (pos[0])
+        {
+            if (pos[0] == '(')
+                level++;
+            else if (pos[0] == ')')
+            {
+                if (level == 0)
+                    break;
+                level--;
+            }
+            pos++;
+        }
+        /* closing parenthesis not found */
+        if (pos[0] != ')')
+        {
+            new_node = eval_node_new (EVAL_NODE_ERROR, NULL);
+            goto end;
+        }
+        if (!pos[1])
+        {
+            /*
+             * nothing around parentheses, then the value is the value of
+             * sub-expression
+             */
+            sub_expr = string_strndup (expr2 + 1, pos - expr2 - 1);
+            if (!sub_expr)
+                goto end;
+            new_node = eval_compile_condition (sub_expr, prefix, suffix);
+            free (sub_expr);
+            goto end;
+        }
+        /*
+         * the value of sub-expression is inserted in the condition and can
+         * change its meaning, so it is evaluated as text
+         */
+        new_node = eval_node_new (EVAL_NODE_CONDITION, expr2);
+        goto end;
+    }
+
+    /* no logical operator neither comparison: just replace variables */
+    new_node = eval_compile_value (expr2, prefix, suffix);
+    goto end;
+
+error:
+    eval_node_free (new_node);
+    new_node = NULL;
+
+end:
+    free (expr2);
+
+    return new_node;
+}
+
+/*
+ * Evaluates a value node: replaces variables in string.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_node_value (struct t_eval_node *node, const void **data)
+{
+    char *result, *result2, *name, *value;
+    const char *ptr_text;
+    int i, length, size, length_value;
+
+    size = strlen (node->text) + 1;
+    result = malloc (size);
+    if (!result)
+        return NULL;
+    length = 0;
+
+    for (i = 0; i < node->segments_count; i++)
+    {
+        if (node->segments[i].variable)
+        {
+            name = NULL;
+            if (node->segments[i].name)
+                name = eval_node_value (node->segments[i].name, data);
+            value = eval_replace_vars_cb (
+                (void *)data, (node->segments[i].name) ?
+                ((name) ? name : "") : node->segments[i].text);
+            if (name)
+                free (name);
+            if (!value)
+            {
+                /* variable not replaced: use the slow way */
+                free (result);
+                return string_replace_with_callback (
+                    node->text, (const char *)data[3],
+                    (const char *)data[4], &eval_replace_vars_cb, (void *)data,
+                    NULL);
+            }
+            ptr_text = value;
+        }
+        else
+        {
+            value = NULL;
+            ptr_text = node->segments[i].text;
+        }
+        length_value = strlen (ptr_text);
+        if (length + length_value + 1 > size)
+        {
+            size = length + length_value + 1 + (size / 2);
+            result2 = realloc (result, size);
+            if (!result2)
+            {
+                free (result);
+                if (value)
+                    free (value);
+                return NULL;
+            }
+            result = result2;
+        }
+        memcpy (result + length, ptr_text, length_value);
+        length += length_value;
+        if (value)
+            free (value);
+    }
+    result[length] = '\0';
+
+    return result;
+}
+
+/*
+ * Evaluates a node of a compiled expression.
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_node_evaluate (struct t_eval_node *node, const void **data)
+{
+    char *value, *value2, *result;
+    int rc;
+
+    switch (node->type)
+    {
+        case EVAL_NODE_VALUE:
+            return eval_node_value (node, data);
+        case EVAL_NODE_LOGICAL:
+            value = eval_node_evaluate (node->left, data);
+            rc = eval_is_true (value);
+            if (value)
+                free (value);
+            /*
+             * if rc == 0 with "&&" or rc == 1 with "||", no need to
+             * evaluate second sub-expression, just return the rc
+             */
+            if ((rc && (node->op == EVAL_LOGICAL_OP_AND))
+                || (!rc && (node->op == EVAL_LOGICAL_OP_OR)))
+            {
+                value = eval_node_evaluate (node->right, data);
+                rc = eval_is_true (value);
+                if (value)
+                    free (value);
+            }
+            return strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
+        case EVAL_NODE_COMPARE:
+            value = eval_node_evaluate (node->left, data);
+            value2 = eval_node_evaluate (node->right, data);
+            result = eval_compare (value, node->op, value2);
+            if (value)
+                free (value);
+            if (value2)
+                free (value2);
+            return result;
+        case EVAL_NODE_CONDITION:
+            return eval_expression_condition (
+                node->text,
+                (struct t_hashtable *)data[0],
+                (struct t_hashtable *)data[1],
+                *((int *)data[2]),
+                (const char *)data[3],
+                (const char *)data[4]);
+        case EVAL_NODE_ERROR:
+        case EVAL_NUM_NODE_TYPES:
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Compiles an expression with given type (condition or not), prefix and
+ * suffix.
+ *
+ * Returns pointer to compiled expression, NULL if error.
+ */
+
+struct t_eval_compiled *
+eval_compile_with_type (const char *expr, int condition,
+                        const char *prefix, const char *suffix)
+{
+    struct t_eval_compiled *new_compiled;
+
+    new_compiled = malloc (sizeof (*new_compiled));
+    if (!new_compiled)
+        return NULL;
+
+    new_compiled->key = NULL;
+    new_compiled->condition = condition;
+    new_compiled->prefix = strdup (prefix);
+    new_compiled->suffix = strdup (suffix);
+    new_compiled->root = NULL;
+    new_compiled->refcount = 0;
+    new_compiled->prev_compiled = NULL;
+    new_compiled->next_compiled = NULL;
+
+    if (new_compiled->prefix && new_compiled->suffix)
+    {
+        new_compiled->root = (condition) ?
+            eval_compile_condition (expr, prefix, suffix) :
+            eval_compile_value (expr, prefix, suffix);
+    }
+    if (!new_compiled->root)
+    {
+        eval_compiled_free (new_compiled);
+        return NULL;
+    }
+
+    return new_compiled;
+}
+
+/*
+ * Reads options used to compile an expression: type of evaluation, prefix
+ * and suffix.
+ */
+
+void
+eval_compile_options (struct t_hashtable *options, int *condition,
+                      const char **prefix, const char **suffix)
+{
+    const char *ptr_value;
+
+    *condition = 0;
+    *prefix = EVAL_DEFAULT_PREFIX;
+    *suffix = EVAL_DEFAULT_SUFFIX;
+
+    if (!options)
+        return;
+
+    /* check the type of evaluation */
+    ptr_value = hashtable_get (options, "type");
+    if (ptr_value && (strcmp (ptr_value, "condition") == 0))
+        *condition = 1;
+
+    /* check for custom prefix */
+    ptr_value = hashtable_get (options, "prefix");
+    if (ptr_value && ptr_value[0])
+        *prefix = ptr_value;
+
+    /* check for custom suffix */
+    ptr_value = hashtable_get (options, "suffix");
+    if (ptr_value && ptr_value[0])
+        *suffix = ptr_value;
+}
+
+/*
+ * Compiles an expression: the expression is parsed once and can then be
+ * evaluated many times with function eval_compiled_expression.
+ *
+ * Options used are the same as function eval_expression (only "type",
+ * "prefix" and "suffix" are used for compilation).
+ *
+ * Returns pointer to compiled expression, NULL if error.
+ *
+ * Note: result must be freed after use (with eval_compiled_free).
+ */
+
+struct t_eval_compiled *
+eval_compile (const char *expr, struct t_hashtable *options)
+{
+    const char *prefix, *suffix;
+    int condition;
+
+    if (!expr)
+        return NULL;
+
+    eval_compile_options (options, &condition, &prefix, &suffix);
+
+    return eval_compile_with_type (expr, condition, prefix, suffix);
+}
+
+/*
+ * Frees a compiled expression.
+ */
+
+void
+eval_compiled_free (struct t_eval_compiled *compiled)
+{
+    if (!compiled)
+        return;
+
+    if (compiled->key)
+        free (compiled->key);
+    if (compiled->prefix)
+        free (compiled->prefix);
+    if (compiled->suffix)
+        free (compiled->suffix);
+    eval_node_free (compiled->root);
+
+    free (compiled);
+}
+
+/*
+ * Removes a compiled expression from cache (it is freed if not used).
+ */
+
+void
+eval_cache_remove (struct t_eval_compiled *compiled)
+{
+    hashtable_remove (eval_compiled_cache, compiled->key);
+
+    if (compiled->prev_compiled)
+        (compiled->prev_compiled)->next_compiled = compiled->next_compiled;
+    else
+        eval_compiled_first = compiled->next_compiled;
+    if (compiled->next_compiled)
+        (compiled->next_compiled)->prev_compiled = compiled->prev_compiled;
+    else
+        eval_compiled_last = compiled->prev_compiled;
+    eval_compiled_count--;
+
+    free (compiled->key);
+    compiled->key = NULL;
+    compiled->prev_compiled = NULL;
+    compiled->next_compiled = NULL;
+
+    if (compiled->refcount == 0)
+        eval_compiled_free (compiled);
+}
+
+/*
+ * Adds a compiled expression at beginning of cache (most recently used).
+ */
+
+void
+eval_cache_add_first (struct t_eval_compiled *compiled)
+{
+    compiled->prev_compiled = NULL;
+    compiled->next_compiled = eval_compiled_first;
+    if (eval_compiled_first)
+        eval_compiled_first->prev_compiled = compiled;
+    else
+        eval_compiled_last = compiled;
+    eval_compiled_first = compiled;
+}
+
+/*
+ * Gets a compiled expression from cache (least recently used expressions are
+ * removed from cache when it is full).
+ *
+ * Returns pointer to compiled expression, NULL if error.
+ *
+ * Note: the compiled expression must be released after use with function
+ * eval_cache_release.
+ */
+
+struct t_eval_compiled *
+eval_cache_get (const char *expr, int condition,
+                const char *prefix, const char *suffix)
+{
+    struct t_eval_compiled *ptr_compiled;
+    char *key;
+    int length;
+
+    length = 1 + strlen (prefix) + 1 + strlen (suffix) + 1 + strlen (expr) + 1;
+    key = malloc (length);
+    if (!key)
+        return NULL;
+    snprintf (key, length, "%c%s\x01%s\x01%s",
+              (condition) ? 'c' : 'v', prefix, suffix, expr);
+
+    if (!eval_compiled_cache)
+    {
+        eval_compiled_cache = hashtable_new (32,
+                                             WEECHAT_HASHTABLE_STRING,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             NULL,
+                                             NULL);
+        if (!eval_compiled_cache)
+        {
+            free (key);
+            return NULL;
+        }
+    }
+
+    ptr_compiled = hashtable_get (eval_compiled_cache, key);
+    if (ptr_compiled)
+    {
+        free (key);
+        /* move expression at beginning of cache */
+        if (ptr_compiled != eval_compiled_first)
+        {
+            (ptr_compiled->prev_compiled)->next_compiled = ptr_compiled->next_compiled;
+            if (ptr_compiled->next_compiled)
+                (ptr_compiled->next_compiled)->prev_compiled = ptr_compiled->prev_compiled;
+            else
+                eval_compiled_last = ptr_compiled->prev_compiled;
+            eval_cache_add_first (ptr_compiled);
+        }
+        ptr_compiled->refcount++;
+        return ptr_compiled;
+    }
+
+    ptr_compiled = eval_compile_with_type (expr, condition, prefix, suffix);
+    if (!ptr_compiled)
+    {
+        free (key);
+        return NULL;
+    }
+
+    /* remove least recently used expressions if cache is full */
+    while (eval_compiled_last
+           && (eval_compiled_count >= EVAL_COMPILED_CACHE_MAX))
+    {
+        eval_cache_remove (eval_compiled_last);
+    }
+
+    ptr_compiled->key = key;
+    if (hashtable_set (eval_compiled_cache, key, ptr_compiled))
+    {
+        eval_cache_add_first (ptr_compiled);
+        eval_compiled_count++;
+    }
+    else
+    {
+        free (ptr_compiled->key);
+        ptr_compiled->key = NULL;
+    }
+
+    ptr_compiled->refcount++;
+    return ptr_compiled;
+}
+
+/*
+ * Releases a compiled expression returned by function eval_cache_get (it is
+ * freed if it is not in cache any more).
+ */
+
+void
+eval_cache_release (struct t_eval_compiled *compiled)
+{
+    compiled->refcount--;
+    if (!compiled->key && (compiled->refcount == 0))
+        eval_compiled_free (compiled);
+}
+
+/*
+ * Frees the cache of compiled expressions.
+ */
+
+void
+eval_cache_free ()
+{
+    while (eval_compiled_first)
+    {
+        eval_cache_remove (eval_compiled_first);
+    }
+    if (eval_compiled_cache)
+    {
+        hashtable_free (eval_compiled_cache);
+        eval_compiled_cache = NULL;
+    }
+}
+
+/*
+ * Replaces text in a string using a regular expression and replacement text.
+ *
+ * The argument "regex" is a pointer to a regex compiled with WeeChat function
+ * string_regcomp (or function regcomp).
+ *
+ * The argument "replace" is evaluated and can contain any valid expression,
+ * and these ones:
+ *   ${re:0} .. ${re:99}  match 0 to 99 (0 is whole match, 1 .. 99 are groups
+ *                        captured)
+ *   ${re:+}              the last match (with highest number)
+ *
+ * Examples:
+ *
+ *    string   | regex         | replace                    | result
+ *   ----------+---------------+----------------------------+-------------
+ *    test foo | test          | Z                          | Z foo
+ *    test foo | ^(test +)(.*) | ${re:2}                    | foo
+ *    test foo | ^(test +)(.*) | ${re:1}/ ${hide:*,${re:2}} | test / ***
+ *    test foo | ^(test +)(.*) | ${hide:%,${re:+}}          | %%%
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_replace_regex (const char *string, regex_t *regex, const char *replace,
+                    struct t_hashtable *pointers,
+                    struct t_hashtable *extra_vars, int extra_vars_eval,
+                    const char *prefix, const char *suffix)
+{
+    char *result, *result2, *str_replace;
+    int length, size, length_before, length_replace, start_offset, i, rc;
+    struct t_eval_regex eval_regex;
+    struct t_eval_compiled *ptr_compiled;
+
+    if (!string || !regex || !replace)
+        return NULL;
+
+    /* replacement is parsed once and kept in cache for next calls */
+    ptr_compiled = eval_cache_get (replace, 0, prefix, suffix);
+
+    /*
+     * the regex is executed on the input string (which is never modified)
+     * and the result is built in a single buffer: text before each match
+     * then the replacement
+     */
+    size = strlen (string) + 1;
+    result = malloc (size);
+    if (!result)
+        goto end;
+    length = 0;
+
+    start_offset = 0;
+    while (string[start_offset])
+    {
+        for (i = 0; i < 100; i++)
+        {
+            eval_regex.match[i].rm_so = -1;
         }
 
-        rc = regexec (regex, result + start_offset, 100, eval_regex.match, 0);
+        rc = string_regexec (regex, string + start_offset, 100,
+                             eval_regex.match, 0);
         /*
          * no match found: exit the loop (if rm_eo == 0, it is an empty match
          * at beginning of string: we consider there is no match, to prevent an
@@ -1004,49 +2120,153 @@ eval_replace_regex (const char *string, regex_t *regex, const char *replace,
             }
         }
 
-        /* check if the regex matched the end of string */
-        end = !result[eval_regex.match[0].rm_eo];
+        eval_regex.result = string;
 
-        eval_regex.result = result;
-
-        str_replace = eval_replace_vars (replace, pointers,
-                                         extra_vars, extra_vars_eval,
-                                         prefix, suffix,
-                                         &eval_regex);
+        str_replace = (ptr_compiled) ?
+            eval_compiled_run (ptr_compiled, pointers,
+                               extra_vars, extra_vars_eval, &eval_regex) :
+            eval_replace_vars (replace, pointers,
+                               extra_vars, extra_vars_eval,
+                               prefix, suffix,
+                               &eval_regex);
 
+        length_before = eval_regex.match[0].rm_so - start_offset;
         length_replace = (str_replace) ? strlen (str_replace) : 0;
 
-        length = eval_regex.match[0].rm_so + length_replace +
-            strlen (result + eval_regex.match[0].rm_eo) + 1;
-        result2 = malloc (length);
-        if (!result2)
+        if (length + length_before + length_replace + 1 > size)
         {
-            free (result);
-            return NULL;
+            size = length + length_before + length_replace + 1 + (size / 2);
+            result2 = realloc (result, size);
+            if (!result2)
+            {
+                free (result);
+                result = NULL;
+                if (str_replace)
+                    free (str_replace);
+                goto end;
+            }
+            result = result2;
         }
-        result2[0] = '\0';
-        if (eval_regex.match[0].rm_so > 0)
+        memcpy (result + length, string + start_offset, length_before);
+        length += length_before;
+        if (str_replace)
         {
-            memcpy (result2, result, eval_regex.match[0].rm_so);
-            result2[eval_regex.match[0].rm_so] = '\0';
+            memcpy (result + length, str_replace, length_replace);
+            length += length_replace;
+            free (str_replace);
         }
-        if (str_replace)
-            strcat (result2, str_replace);
-        strcat (result2, result + eval_regex.match[0].rm_eo);
 
-        free (result);
+        start_offset = eval_regex.match[0].rm_eo;
+    }
+
+    /* add end of string (after last match) */
+    length_before = strlen (string + start_offset);
+    if (length + length_before + 1 > size)
+    {
+        result2 = realloc (result, length + length_before + 1);
+        if (!result2)
+        {
+            free (result);
+            result = NULL;
+            goto end;
+        }
         result = result2;
+    }
+    memcpy (result + length, string + start_offset, length_before + 1);
 
-        if (str_replace)
-            free (str_replace);
+end:
+    if (ptr_compiled)
+        eval_cache_release (ptr_compiled);
 
-        if (end)
-            break;
+    return result;
+}
+
+/*
+ * Evaluates a compiled expression.
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_compiled_run (struct t_eval_compiled *compiled,
+                   struct t_hashtable *pointers,
+                   struct t_hashtable *extra_vars, int extra_vars_eval,
+                   struct t_eval_regex *eval_regex)
+{
+    const void *ptr[6];
+    char *value;
+    int rc;
+
+    ptr[0] = pointers;
+    ptr[1] = extra_vars;
+    ptr[2] = &extra_vars_eval;
+    ptr[3] = compiled->prefix;
+    ptr[4] = compiled->suffix;
+    ptr[5] = eval_regex;
 
-        start_offset = eval_regex.match[0].rm_so + length_replace;
+    value = eval_node_evaluate (compiled->root, ptr);
+
+    if (compiled->condition)
+    {
+        /* evaluate as condition (return a boolean: "0" or "1") */
+        rc = eval_is_true (value);
+        if (value)
+            free (value);
+        value = strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
     }
 
-    return result;
+    return value;
+}
+
+/*
+ * Creates hashtable "pointers" if it's NULL and sets window/buffer with
+ * pointer to current window/buffer (if not already defined in the hashtable).
+ *
+ * Returns:
+ *   1: hashtable "pointers" has been created (it must be freed after use)
+ *   0: hashtable "pointers" was already created
+ *  -1: error
+ */
+
+int
+eval_set_default_pointers (struct t_hashtable **pointers)
+{
+    struct t_gui_window *window;
+    int pointers_allocated;
+
+    pointers_allocated = 0;
+
+    if (!*pointers)
+    {
+        /* create hashtable pointers if it's NULL */
+        *pointers = hashtable_new (32,
+                                   WEECHAT_HASHTABLE_STRING,
+                                   WEECHAT_HASHTABLE_POINTER,
+                                   NULL,
+                                   NULL);
+        if (!*pointers)
+            return -1;
+        pointers_allocated = 1;
+    }
+
+    /*
+     * set window/buffer with pointer to current window/buffer
+     * (if not already defined in the hashtable)
+     */
+    if (gui_current_window)
+    {
+        if (!hashtable_has_key (*pointers, "window"))
+            hashtable_set (*pointers, "window", gui_current_window);
+        if (!hashtable_has_key (*pointers, "buffer"))
+        {
+            window = (struct t_gui_window *)hashtable_get (*pointers,
+                                                           "window");
+            if (window)
+                hashtable_set (*pointers, "buffer", window->buffer);
+        }
+    }
+
+    return pointers_allocated;
 }
 
 /*
@@ -1062,6 +2282,8 @@ eval_replace_regex (const char *string, regex_t *regex, const char *replace,
  *   - type:
  *       - condition: evaluate as a condition (use operators/parentheses,
  *         return a boolean)
+ *   - cache: "1" to memoize values of info, secured data and hdata until
+ *     next refresh of screen or next signal sent (see eval_memo_reset)
  *
  * If the expression is a condition, it can contain:
  *   - conditions:  ==  != <  <=  >  >=
@@ -1095,81 +2317,42 @@ eval_expression (const char *expr, struct t_hashtable *pointers,
                  struct t_hashtable *extra_vars, struct t_hashtable *options)
 {
     int condition, extra_vars_eval, rc, pointers_allocated, regex_allocated;
+    int memo_enabled;
     char *value;
     const char *prefix, *suffix;
-    const char *default_prefix = EVAL_DEFAULT_PREFIX;
-    const char *default_suffix = EVAL_DEFAULT_SUFFIX;
     const char *ptr_value, *regex_replace;
-    struct t_gui_window *window;
+    struct t_eval_compiled *ptr_compiled;
     regex_t *regex;
 
     if (!expr)
         return NULL;
 
-    condition = 0;
     extra_vars_eval = 0;
-    pointers_allocated = 0;
+    memo_enabled = eval_memo_enabled;
     regex_allocated = 0;
-    prefix = default_prefix;
-    suffix = default_suffix;
     regex = NULL;
     regex_replace = NULL;
 
     if (pointers)
-    {
         regex = (regex_t *)hashtable_get (pointers, "regex");
-    }
-    else
-    {
-        /* create hashtable pointers if it's NULL */
-        pointers = hashtable_new (32,
-                                  WEECHAT_HASHTABLE_STRING,
-                                  WEECHAT_HASHTABLE_POINTER,
-                                  NULL,
-                                  NULL);
-        if (!pointers)
-            return NULL;
-        pointers_allocated = 1;
-    }
 
-    /*
-     * set window/buffer with pointer to current window/buffer
-     * (if not already defined in the hashtable)
-     */
-    if (gui_current_window)
-    {
-        if (!hashtable_has_key (pointers, "window"))
-            hashtable_set (pointers, "window", gui_current_window);
-        if (!hashtable_has_key (pointers, "buffer"))
-        {
-            window = (struct t_gui_window *)hashtable_get (pointers, "window");
-            if (window)
-                hashtable_set (pointers, "buffer", window->buffer);
-        }
-    }
+    pointers_allocated = eval_set_default_pointers (&pointers);
+    if (pointers_allocated < 0)
+        return NULL;
 
     /* read options */
+    eval_compile_options (options, &condition, &prefix, &suffix);
+    eval_memo_enabled = 0;
     if (options)
     {
-        /* check the type of evaluation */
-        ptr_value = hashtable_get (options, "type");
-        if (ptr_value && (strcmp (ptr_value, "condition") == 0))
-            condition = 1;
-
         /* check if extra vars must be evaluated */
         ptr_value = hashtable_get (options, "extra");
         if (ptr_value && (strcmp (ptr_value, "eval") == 0))
             extra_vars_eval = 1;
 
-        /* check for custom prefix */
-        ptr_value = hashtable_get (options, "prefix");
-        if (ptr_value && ptr_value[0])
-            prefix = ptr_value;
-
-        /* check for custom suffix */
-        ptr_value = hashtable_get (options, "suffix");
-        if (ptr_value && ptr_value[0])
-            suffix = ptr_value;
+        /* check if values of variables can be memoized */
+        ptr_value = hashtable_get (options, "cache");
+        eval_memo_enabled = (ptr_value && (strcmp (ptr_value, "1") == 0));
 
         /* check for regex */
         ptr_value = hashtable_get (options, "regex");
@@ -1197,25 +2380,32 @@ eval_expression (const char *expr, struct t_hashtable *pointers,
     }
 
     /* evaluate expression */
-    if (condition)
+    if (!condition && regex && regex_replace)
     {
-        /* evaluate as condition (return a boolean: "0" or "1") */
-        value = eval_expression_condition (expr, pointers,
-                                           extra_vars, extra_vars_eval,
-                                           prefix, suffix);
-        rc = eval_is_true (value);
-        if (value)
-            free (value);
-        value = strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
+        /* replace with regex */
+        value = eval_replace_regex (expr, regex, regex_replace,
+                                    pointers, extra_vars, extra_vars_eval,
+                                    prefix, suffix);
     }
     else
     {
-        if (regex && regex_replace)
+        ptr_compiled = eval_cache_get (expr, condition, prefix, suffix);
+        if (ptr_compiled)
         {
-            /* replace with regex */
-            value = eval_replace_regex (expr, regex, regex_replace,
-                                        pointers, extra_vars, extra_vars_eval,
-                                        prefix, suffix);
+            value = eval_compiled_run (ptr_compiled, pointers,
+                                       extra_vars, extra_vars_eval, NULL);
+            eval_cache_release (ptr_compiled);
+        }
+        else if (condition)
+        {
+            /* evaluate as condition (return a boolean: "0" or "1") */
+            value = eval_expression_condition (expr, pointers,
+                                               extra_vars, extra_vars_eval,
+                                               prefix, suffix);
+            rc = eval_is_true (value);
+            if (value)
+                free (value);
+            value = strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
         }
         else
         {
@@ -1230,9 +2420,86 @@ eval_expression (const char *expr, struct t_hashtable *pointers,
         hashtable_free (pointers);
     if (regex && regex_allocated)
     {
-        regfree (regex);
+        string_regfree (regex);
         free (regex);
     }
 
+    eval_memo_enabled = memo_enabled;
+
+    return value;
+}
+
+/*
+ * Evaluates an expression compiled with function eval_compile.
+ *
+ * The hashtables "pointers", "extra_vars" and "options" are the same as
+ * function eval_expression (options "type", "prefix", "suffix" and "regex"
+ * are ignored: they are set when the expression is compiled).
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_compiled_expression (struct t_eval_compiled *compiled,
+                          struct t_hashtable *pointers,
+                          struct t_hashtable *extra_vars,
+                          struct t_hashtable *options)
+{
+    int extra_vars_eval, pointers_allocated, memo_enabled;
+    char *value;
+    const char *ptr_value;
+
+    if (!compiled)
+        return NULL;
+
+    pointers_allocated = eval_set_default_pointers (&pointers);
+    if (pointers_allocated < 0)
+        return NULL;
+
+    extra_vars_eval = 0;
+    memo_enabled = eval_memo_enabled;
+    eval_memo_enabled = 0;
+    if (options)
+    {
+        /* check if extra vars must be evaluated */
+        ptr_value = hashtable_get (options, "extra");
+        if (ptr_value && (strcmp (ptr_value, "eval") == 0))
+            extra_vars_eval = 1;
+
+        /* check if values of variables can be memoized */
+        ptr_value = hashtable_get (options, "cache");
+        eval_memo_enabled = (ptr_value && (strcmp (ptr_value, "1") == 0));
+    }
+
+    compiled->refcount++;
+    value = eval_compiled_run (compiled, pointers, extra_vars,
+                               extra_vars_eval, NULL);
+    compiled->refcount--;
+
+    eval_memo_enabled = memo_enabled;
+
+    if (pointers_allocated)
+        hashtable_free (pointers);
+
     return value;
 }
+
+/*
+ * Frees all allocated data.
+ */
+
+void
+eval_end ()
+{
+    eval_cache_free ();
+    if (eval_memo)
+    {
+        hashtable_free (eval_memo);
+        eval_memo = NULL;
+    }
+    if (eval_hdata_paths)
+    {
+        hashtable_free (eval_hdata_paths);
+        eval_hdata_paths = NULL;
+    }
+}
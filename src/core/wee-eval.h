@@ -28,7 +28,16 @@
 #define EVAL_DEFAULT_PREFIX "${"
 #define EVAL_DEFAULT_SUFFIX "}"
 
+#define EVAL_HDATA_PATH_CACHE_MAX 1024
+#define EVAL_COMPILED_CACHE_MAX   256
+#define EVAL_MEMO_MAX             1024
+
+/* special steps in a compiled hdata path */
+#define EVAL_HDATA_PATH_STEP_INVALID -1
+#define EVAL_HDATA_PATH_STEP_POINTER -2
+
 struct t_hashtable;
+struct t_hdata;
 
 enum t_eval_logical_op
 {
@@ -52,6 +61,50 @@ enum t_eval_comparison
     EVAL_NUM_COMPARISONS,
 };
 
+enum t_eval_node_type
+{
+    EVAL_NODE_VALUE = 0,               /* string with variables to replace  */
+    EVAL_NODE_LOGICAL,                 /* logical operator: left op right   */
+    EVAL_NODE_COMPARE,                 /* comparison: left comp right       */
+    EVAL_NODE_CONDITION,               /* condition evaluated as text       */
+    EVAL_NODE_ERROR,                   /* invalid condition (result: NULL)  */
+    /* number of node types */
+    EVAL_NUM_NODE_TYPES,
+};
+
+struct t_eval_node;
+
+struct t_eval_segment
+{
+    int variable;                      /* 1 if variable, 0 if text          */
+    char *text;                        /* text or name of variable          */
+    struct t_eval_node *name;          /* name with nested variables        */
+                                       /* (NULL if no nested variables)     */
+};
+
+struct t_eval_node
+{
+    enum t_eval_node_type type;        /* type of node                      */
+    int op;                            /* logical operator or comparison    */
+    struct t_eval_node *left;          /* left sub-expression               */
+    struct t_eval_node *right;         /* right sub-expression              */
+    char *text;                        /* text of value or condition        */
+    int segments_count;                /* number of segments in value       */
+    struct t_eval_segment *segments;   /* text and variables in value       */
+};
+
+struct t_eval_compiled
+{
+    char *key;                         /* key in cache (NULL if not cached) */
+    int condition;                     /* 1 if evaluated as a condition     */
+    char *prefix;                      /* prefix before variables           */
+    char *suffix;                      /* suffix after variables            */
+    struct t_eval_node *root;          /* parsed expression                 */
+    int refcount;                      /* > 0 if expression is evaluated    */
+    struct t_eval_compiled *prev_compiled; /* link to previous (cache)      */
+    struct t_eval_compiled *next_compiled; /* link to next (cache)          */
+};
+
 struct t_eval_regex
 {
     const char *result;
@@ -59,10 +112,36 @@ struct t_eval_regex
     int last_match;
 };
 
+struct t_eval_hdata_path_step
+{
+    int type;                          /* hdata type of variable, or        */
+                                       /* EVAL_HDATA_PATH_STEP_xxx          */
+    int offset;                        /* offset of variable in structure   */
+    const char *key;                   /* key in hashtable (or NULL)        */
+};
+
+struct t_eval_hdata_path
+{
+    char *path;                        /* path (keys of hashtables are      */
+                                       /* pointers in this string)          */
+    int generation;                    /* hdata generation when compiled    */
+    int steps_count;                   /* number of steps                   */
+    struct t_eval_hdata_path_step *steps; /* variables to read, in order    */
+};
+
 extern int eval_is_true (const char *value);
 extern char *eval_expression (const char *expr,
                               struct t_hashtable *pointers,
                               struct t_hashtable *extra_vars,
                               struct t_hashtable *options);
+extern struct t_eval_compiled *eval_compile (const char *expr,
+                                             struct t_hashtable *options);
+extern char *eval_compiled_expression (struct t_eval_compiled *compiled,
+                                       struct t_hashtable *pointers,
+                                       struct t_hashtable *extra_vars,
+                                       struct t_hashtable *options);
+extern void eval_compiled_free (struct t_eval_compiled *compiled);
+extern void eval_memo_reset ();
+extern void eval_end ();
 
 #endif /* WEECHAT_EVAL_H */
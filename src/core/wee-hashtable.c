@@ -24,8 +24,11 @@
 #endif
 
 #include <stdlib.h>
+#include <unistd.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <sys/time.h>
 
 #include "weechat.h"
 #include "wee-hashtable.h"
@@ -41,6 +44,16 @@ char *hashtable_type_string[HASHTABLE_NUM_TYPES] =
   WEECHAT_HASHTABLE_POINTER, WEECHAT_HASHTABLE_BUFFER,
   WEECHAT_HASHTABLE_TIME };
 
+char *hashtable_hash_function_string[HASHTABLE_NUM_HASH_FUNCTIONS] =
+{ "siphash", "djb2" };
+
+int hashtable_siphash_key_initialized = 0;
+unsigned long long hashtable_siphash_key[2];
+
+struct t_hashtable *hashtable_pool[HASHTABLE_POOL_SIZE]; /* hashtables      */
+                                       /* released, ready to be reused      */
+int hashtable_pool_count = 0;          /* number of hashtables in pool      */
+
 
 /*
  * Searches for a hashtable type.
@@ -87,6 +100,153 @@ hashtable_hash_key_djb2 (const char *string)
     return hash;
 }
 
+/*
+ * Initializes the random key used by SipHash (read from /dev/urandom, or
+ * built with time and PID if /dev/urandom is not available).
+ */
+
+void
+hashtable_siphash_init_key ()
+{
+    struct timeval tv_now;
+    int fd, rc;
+
+    rc = 0;
+    fd = open ("/dev/urandom", O_RDONLY);
+    if (fd >= 0)
+    {
+        rc = read (fd, hashtable_siphash_key, sizeof (hashtable_siphash_key));
+        close (fd);
+    }
+    if (rc != (int)sizeof (hashtable_siphash_key))
+    {
+        gettimeofday (&tv_now, NULL);
+        hashtable_siphash_key[0] = ((unsigned long long)tv_now.tv_sec << 20)
+            ^ (unsigned long long)tv_now.tv_usec;
+        hashtable_siphash_key[1] = ((unsigned long long)getpid () << 32)
+            ^ (unsigned long long)((unsigned long)&tv_now);
+    }
+
+    hashtable_siphash_key_initialized = 1;
+}
+
+/*
+ * Hashes a string using SipHash-1-3 (with a random key, so that hashes can
+ * not be predicted by a remote peer sending strings).
+ *
+ * The string is read eight bytes at a time.
+ *
+ * Returns the hash of the string.
+ */
+
+unsigned long long
+hashtable_hash_key_siphash (const char *string)
+{
+    unsigned long long v0, v1, v2, v3, m, b;
+    const unsigned char *ptr_string;
+    size_t length, i, remaining;
+
+    if (!hashtable_siphash_key_initialized)
+        hashtable_siphash_init_key ();
+
+    v0 = hashtable_siphash_key[0] ^ 0x736f6d6570736575ULL;
+    v1 = hashtable_siphash_key[1] ^ 0x646f72616e646f6dULL;
+    v2 = hashtable_siphash_key[0] ^ 0x6c7967656e657261ULL;
+    v3 = hashtable_siphash_key[1] ^ 0x7465646279746573ULL;
+
+    length = strlen (string);
+    ptr_string = (const unsigned char *)string;
+
+    for (i = 0; i + 8 <= length; i += 8)
+    {
+        memcpy (&m, ptr_string + i, sizeof (m));
+        v3 ^= m;
+        HASHTABLE_SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    b = ((unsigned long long)length) << 56;
+    remaining = length - i;
+    while (remaining > 0)
+    {
+        remaining--;
+        b |= ((unsigned long long)ptr_string[i + remaining]) << (8 * remaining);
+    }
+    v3 ^= b;
+    HASHTABLE_SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    HASHTABLE_SIPROUND(v0, v1, v2, v3);
+    HASHTABLE_SIPROUND(v0, v1, v2, v3);
+    HASHTABLE_SIPROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*
+ * Hashes a string key with djb2 (callback used for hash function "djb2").
+ *
+ * Returns the hash of the key.
+ */
+
+unsigned long long
+hashtable_hash_key_djb2_cb (struct t_hashtable *hashtable, const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_djb2 ((const char *)key);
+}
+
+/*
+ * Hashes a string key with SipHash (callback used for hash function
+ * "siphash").
+ *
+ * Returns the hash of the key.
+ */
+
+unsigned long long
+hashtable_hash_key_siphash_cb (struct t_hashtable *hashtable, const void *key)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return hashtable_hash_key_siphash ((const char *)key);
+}
+
+/*
+ * Searches for a hash function by name.
+ *
+ * Returns the callback of hash function, NULL if not found.
+ */
+
+t_hashtable_hash_key *
+hashtable_get_hash_function (const char *name)
+{
+    int i;
+
+    if (!name)
+        return NULL;
+
+    for (i = 0; i < HASHTABLE_NUM_HASH_FUNCTIONS; i++)
+    {
+        if (string_strcasecmp (hashtable_hash_function_string[i], name) == 0)
+            break;
+    }
+
+    switch (i)
+    {
+        case HASHTABLE_HASH_SIPHASH:
+            return &hashtable_hash_key_siphash_cb;
+        case HASHTABLE_HASH_DJB2:
+            return &hashtable_hash_key_djb2_cb;
+    }
+
+    /* hash function not found */
+    return NULL;
+}
+
 /*
  * Hashes a key (default callback).
  *
@@ -106,7 +266,7 @@ hashtable_hash_key_default_cb (struct t_hashtable *hashtable, const void *key)
             hash = (unsigned long long)(*((int *)key));
             break;
         case HASHTABLE_STRING:
-            hash = hashtable_hash_key_djb2 ((const char *)key);
+            hash = hashtable_hash_key_siphash ((const char *)key);
             break;
         case HASHTABLE_POINTER:
             hash = (unsigned long long)((unsigned long)((void *)key));
@@ -183,6 +343,13 @@ hashtable_keycmp_default_cb (struct t_hashtable *hashtable,
  * better performance because this reduces the collisions of hashed keys and
  * then reduces length of linked lists.
  *
+ * If size is 0, open addressing is used: the internal array grows
+ * automatically with the number of items.
+ *
+ * The type of keys can be followed by ":" and the name of a hash function for
+ * string keys, for example "string:djb2" (default is "siphash"); it is
+ * ignored if a callback is given to hash keys.
+ *
  * Returns pointer to new hashtable, NULL if error.
  */
 
@@ -193,14 +360,36 @@ hashtable_new (int size,
                t_hashtable_keycmp *callback_keycmp)
 {
     struct t_hashtable *new_hashtable;
+    t_hashtable_hash_key *hash_function;
+    char str_type_keys[64];
+    const char *pos;
     int i, type_keys_int, type_values_int;
 
-    if (size <= 0)
+    if (size < 0)
         return NULL;
 
+    /* optional hash function after type of keys: "string:djb2" */
+    hash_function = NULL;
+    pos = (type_keys) ? strchr (type_keys, ':') : NULL;
+    if (pos)
+    {
+        if ((pos - type_keys) >= (int)sizeof (str_type_keys))
+            return NULL;
+        memcpy (str_type_keys, type_keys, pos - type_keys);
+        str_type_keys[pos - type_keys] = '\0';
+        type_keys = str_type_keys;
+        hash_function = hashtable_get_hash_function (pos + 1);
+        if (!hash_function)
+            return NULL;
+    }
+
     type_keys_int = hashtable_get_type (type_keys);
     if (type_keys_int < 0)
         return NULL;
+
+    /* a hash function can be chosen by name only for string keys */
+    if (hash_function && (type_keys_int != HASHTABLE_STRING))
+        return NULL;
     type_values_int = hashtable_get_type (type_values);
     if (type_values_int < 0)
         return NULL;
@@ -212,24 +401,55 @@ hashtable_new (int size,
     new_hashtable = malloc (sizeof (*new_hashtable));
     if (new_hashtable)
     {
-        new_hashtable->size = size;
+        new_hashtable->open_addressing = (size == 0) ? 1 : 0;
+        new_hashtable->size = (size == 0) ? HASHTABLE_OPEN_MIN_SIZE : size;
         new_hashtable->type_keys = type_keys_int;
         new_hashtable->type_values = type_values_int;
-        new_hashtable->htable = malloc (size * sizeof (*(new_hashtable->htable)));
+        new_hashtable->htable = NULL;
+        new_hashtable->ctrl = NULL;
+        new_hashtable->slots = NULL;
         new_hashtable->keys_values = NULL;
-        if (!new_hashtable->htable)
+        if (new_hashtable->open_addressing)
         {
-            free (new_hashtable);
-            return NULL;
+            new_hashtable->ctrl = malloc (new_hashtable->size *
+                                          sizeof (*(new_hashtable->ctrl)));
+            new_hashtable->slots = malloc (new_hashtable->size *
+                                           sizeof (*(new_hashtable->slots)));
+            if (!new_hashtable->ctrl || !new_hashtable->slots)
+            {
+                if (new_hashtable->ctrl)
+                    free (new_hashtable->ctrl);
+                if (new_hashtable->slots)
+                    free (new_hashtable->slots);
+                free (new_hashtable);
+                return NULL;
+            }
+            memset (new_hashtable->ctrl, HASHTABLE_CTRL_EMPTY,
+                    new_hashtable->size);
         }
-        for (i = 0; i < size; i++)
+        else
         {
-            new_hashtable->htable[i] = NULL;
+            new_hashtable->htable = malloc (size * sizeof (*(new_hashtable->htable)));
+            if (!new_hashtable->htable)
+            {
+                free (new_hashtable);
+                return NULL;
+            }
+            for (i = 0; i < size; i++)
+            {
+                new_hashtable->htable[i] = NULL;
+            }
         }
         new_hashtable->items_count = 0;
-
-        new_hashtable->callback_hash_key = (callback_hash_key) ?
-            callback_hash_key : &hashtable_hash_key_default_cb;
+        new_hashtable->deleted_count = 0;
+        new_hashtable->map_running = 0;
+
+        if (callback_hash_key)
+            new_hashtable->callback_hash_key = callback_hash_key;
+        else if (hash_function)
+            new_hashtable->callback_hash_key = hash_function;
+        else
+            new_hashtable->callback_hash_key = &hashtable_hash_key_default_cb;
         new_hashtable->callback_keycmp = (callback_keycmp) ?
             callback_keycmp : &hashtable_keycmp_default_cb;
 
@@ -361,6 +581,300 @@ hashtable_free_value (struct t_hashtable *hashtable,
     }
 }
 
+/*
+ * Mixes bits of a hash (finalizer of MurmurHash3), so that keys with close
+ * hashes (integers, pointers) are spread in slots of open addressing.
+ *
+ * Returns mixed hash.
+ */
+
+unsigned long long
+hashtable_open_mix_hash (unsigned long long hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/*
+ * Searches for a key in slots of hashtable (open addressing).
+ *
+ * If "insert" is not NULL, it is set with index of slot where the key can be
+ * added if it is not found (first deleted slot or empty slot).
+ *
+ * Returns index of slot with key, -1 if key is not found.
+ */
+
+int
+hashtable_open_search (struct t_hashtable *hashtable, const void *key,
+                       unsigned long long hash, int *insert)
+{
+    unsigned char h2;
+    int mask, index, first_deleted;
+
+    mask = hashtable->size - 1;
+    h2 = (unsigned char)(hash >> 57);
+    first_deleted = -1;
+
+    for (index = (int)(hash & mask); ; index = (index + 1) & mask)
+    {
+        if (hashtable->ctrl[index] == HASHTABLE_CTRL_EMPTY)
+            break;
+        if (hashtable->ctrl[index] == HASHTABLE_CTRL_DELETED)
+        {
+            if (first_deleted < 0)
+                first_deleted = index;
+        }
+        else if ((hashtable->ctrl[index] == h2)
+                 && (hashtable->slots[index].hash == hash)
+                 && (hashtable->callback_keycmp (
+                         hashtable, key,
+                         hashtable->slots[index].item.key) == 0))
+        {
+            return index;
+        }
+    }
+
+    if (insert)
+        *insert = (first_deleted >= 0) ? first_deleted : index;
+
+    return -1;
+}
+
+/*
+ * Resizes slots of hashtable (open addressing); deleted slots are dropped.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hashtable_open_resize (struct t_hashtable *hashtable, int new_size)
+{
+    unsigned char *new_ctrl;
+    struct t_hashtable_slot *new_slots, *ptr_slot;
+    int i, mask, index;
+
+    new_ctrl = malloc (new_size * sizeof (*new_ctrl));
+    if (!new_ctrl)
+        return 0;
+    new_slots = malloc (new_size * sizeof (*new_slots));
+    if (!new_slots)
+    {
+        free (new_ctrl);
+        return 0;
+    }
+    memset (new_ctrl, HASHTABLE_CTRL_EMPTY, new_size);
+
+    mask = new_size - 1;
+    for (i = 0; i < hashtable->size; i++)
+    {
+        if (hashtable->ctrl[i] & HASHTABLE_CTRL_EMPTY)
+            continue;
+        ptr_slot = &hashtable->slots[i];
+        for (index = (int)(ptr_slot->hash & mask);
+             new_ctrl[index] != HASHTABLE_CTRL_EMPTY;
+             index = (index + 1) & mask)
+        {
+        }
+        new_ctrl[index] = hashtable->ctrl[i];
+        memcpy (&new_slots[index], ptr_slot, sizeof (*ptr_slot));
+        if (new_slots[index].inline_flags & HASHTABLE_INLINE_KEY)
+            new_slots[index].item.key = &new_slots[index].key_inline;
+        if (new_slots[index].inline_flags & HASHTABLE_INLINE_VALUE)
+            new_slots[index].item.value = &new_slots[index].value_inline;
+    }
+
+    free (hashtable->ctrl);
+    free (hashtable->slots);
+    hashtable->ctrl = new_ctrl;
+    hashtable->slots = new_slots;
+    hashtable->size = new_size;
+    hashtable->deleted_count = 0;
+
+    return 1;
+}
+
+/*
+ * Checks if slots of hashtable must be resized before adding an item
+ * (open addressing), and resizes them if needed.
+ *
+ * Slots are never moved while items are being mapped: in this case the
+ * item can be added only if there is still at least one empty slot.
+ *
+ * Returns:
+ *   1: OK, the item can be added
+ *   0: error
+ */
+
+int
+hashtable_open_reserve (struct t_hashtable *hashtable)
+{
+    int new_size;
+
+    if ((hashtable->items_count + hashtable->deleted_count + 1) * 4
+        <= hashtable->size * 3)
+    {
+        return 1;
+    }
+
+    if (hashtable->map_running > 0)
+    {
+        return (hashtable->items_count + hashtable->deleted_count + 1
+                < hashtable->size) ? 1 : 0;
+    }
+
+    /* grow if table is half full, otherwise just drop deleted slots */
+    new_size = hashtable->size;
+    if ((hashtable->items_count + 1) * 2 > hashtable->size)
+        new_size *= 2;
+
+    return hashtable_open_resize (hashtable, new_size);
+}
+
+/*
+ * Sets key or value in a slot (open addressing): integer and time are stored
+ * inside the slot unless a callback is set to free them.
+ */
+
+void
+hashtable_open_alloc_type (struct t_hashtable *hashtable,
+                           struct t_hashtable_slot *slot, int is_key,
+                           const void *value, int size_value)
+{
+    enum t_hashtable_type type;
+    union t_hashtable_inline *ptr_inline;
+    void **pointer;
+    int *size, flag, callback_free;
+
+    type = (is_key) ? hashtable->type_keys : hashtable->type_values;
+    ptr_inline = (is_key) ? &slot->key_inline : &slot->value_inline;
+    pointer = (is_key) ? &slot->item.key : &slot->item.value;
+    size = (is_key) ? &slot->item.key_size : &slot->item.value_size;
+    flag = (is_key) ? HASHTABLE_INLINE_KEY : HASHTABLE_INLINE_VALUE;
+    callback_free = (is_key) ?
+        (hashtable->callback_free_key != NULL) :
+        (hashtable->callback_free_value != NULL);
+
+    slot->inline_flags &= ~flag;
+
+    if (value && !callback_free)
+    {
+        if (type == HASHTABLE_INTEGER)
+        {
+            ptr_inline->integer = *((int *)value);
+            *pointer = &ptr_inline->integer;
+            *size = sizeof (int);
+            slot->inline_flags |= flag;
+            return;
+        }
+        if (type == HASHTABLE_TIME)
+        {
+            ptr_inline->time = *((time_t *)value);
+            *pointer = &ptr_inline->time;
+            *size = sizeof (time_t);
+            slot->inline_flags |= flag;
+            return;
+        }
+    }
+
+    hashtable_alloc_type (type, value, size_value, pointer, size);
+}
+
+/*
+ * Frees key and/or value of a slot (open addressing).
+ */
+
+void
+hashtable_open_free_slot (struct t_hashtable *hashtable,
+                          struct t_hashtable_slot *slot,
+                          int free_key, int free_value)
+{
+    if (free_value && !(slot->inline_flags & HASHTABLE_INLINE_VALUE))
+        hashtable_free_value (hashtable, &slot->item);
+    if (free_key && !(slot->inline_flags & HASHTABLE_INLINE_KEY))
+        hashtable_free_key (hashtable, &slot->item);
+}
+
+/*
+ * Sets value for a key in hashtable (open addressing).
+ *
+ * Returns pointer to item created/updated, NULL if error.
+ */
+
+struct t_hashtable_item *
+hashtable_open_set (struct t_hashtable *hashtable,
+                    const void *key, int key_size,
+                    const void *value, int value_size)
+{
+    unsigned long long hash;
+    struct t_hashtable_slot *ptr_slot;
+    int index, insert;
+
+    hash = hashtable_open_mix_hash (
+        hashtable->callback_hash_key (hashtable, key));
+
+    /* replace value if item is already in hashtable */
+    index = hashtable_open_search (hashtable, key, hash, NULL);
+    if (index >= 0)
+    {
+        ptr_slot = &hashtable->slots[index];
+        hashtable_open_free_slot (hashtable, ptr_slot, 0, 1);
+        hashtable_open_alloc_type (hashtable, ptr_slot, 0, value, value_size);
+        return &ptr_slot->item;
+    }
+
+    if (!hashtable_open_reserve (hashtable))
+        return NULL;
+
+    /* search again: slots may have moved */
+    hashtable_open_search (hashtable, key, hash, &insert);
+    if (hashtable->ctrl[insert] == HASHTABLE_CTRL_DELETED)
+        hashtable->deleted_count--;
+    hashtable->ctrl[insert] = (unsigned char)(hash >> 57);
+
+    ptr_slot = &hashtable->slots[insert];
+    ptr_slot->hash = hash;
+    ptr_slot->inline_flags = 0;
+    ptr_slot->item.prev_item = NULL;
+    ptr_slot->item.next_item = NULL;
+    hashtable_open_alloc_type (hashtable, ptr_slot, 1, key, key_size);
+    hashtable_open_alloc_type (hashtable, ptr_slot, 0, value, value_size);
+
+    hashtable->items_count++;
+
+    return &ptr_slot->item;
+}
+
+/*
+ * Removes item in a slot of hashtable (open addressing).
+ */
+
+void
+hashtable_open_remove_slot (struct t_hashtable *hashtable, int index)
+{
+    hashtable_open_free_slot (hashtable, &hashtable->slots[index], 1, 1);
+
+    /* the slot becomes empty if next one is empty (no probe goes through) */
+    if (hashtable->ctrl[(index + 1) & (hashtable->size - 1)]
+        == HASHTABLE_CTRL_EMPTY)
+    {
+        hashtable->ctrl[index] = HASHTABLE_CTRL_EMPTY;
+    }
+    else
+    {
+        hashtable->ctrl[index] = HASHTABLE_CTRL_DELETED;
+        hashtable->deleted_count++;
+    }
+
+    hashtable->items_count--;
+}
+
 /*
  * Sets value for a key in hashtable.
  *
@@ -384,6 +898,12 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
         return NULL;
     }
 
+    if (hashtable->open_addressing)
+    {
+        return hashtable_open_set (hashtable, key, key_size,
+                                   value, value_size);
+    }
+
     /* search position for item in hashtable */
     hash = hashtable->callback_hash_key (hashtable, key) % hashtable->size;
     pos_item = NULL;
@@ -472,10 +992,21 @@ hashtable_get_item (struct t_hashtable *hashtable, const void *key,
 {
     unsigned long long key_hash;
     struct t_hashtable_item *ptr_item;
+    int index;
 
     if (!hashtable || !key)
         return NULL;
 
+    if (hashtable->open_addressing)
+    {
+        key_hash = hashtable_open_mix_hash (
+            hashtable->callback_hash_key (hashtable, key));
+        if (hash)
+            *hash = key_hash;
+        index = hashtable_open_search (hashtable, key, key_hash, NULL);
+        return (index >= 0) ? &hashtable->slots[index].item : NULL;
+    }
+
     key_hash = hashtable->callback_hash_key (hashtable, key) % hashtable->size;
     if (hash)
         *hash = key_hash;
@@ -579,6 +1110,22 @@ hashtable_map (struct t_hashtable *hashtable,
     if (!hashtable)
         return;
 
+    if (hashtable->open_addressing)
+    {
+        hashtable->map_running++;
+        for (i = 0; i < hashtable->size; i++)
+        {
+            if (hashtable->ctrl[i] & HASHTABLE_CTRL_EMPTY)
+                continue;
+            (void) (callback_map) (callback_map_data,
+                                   hashtable,
+                                   hashtable->slots[i].item.key,
+                                   hashtable->slots[i].item.value);
+        }
+        hashtable->map_running--;
+        return;
+    }
+
     for (i = 0; i < hashtable->size; i++)
     {
         ptr_item = hashtable->htable[i];
@@ -596,6 +1143,36 @@ hashtable_map (struct t_hashtable *hashtable,
     }
 }
 
+/*
+ * Calls a function on a hashtable entry with key and value as strings.
+ */
+
+void
+hashtable_map_string_item (struct t_hashtable *hashtable,
+                           struct t_hashtable_item *item,
+                           t_hashtable_map_string *callback_map,
+                           void *callback_map_data)
+{
+    const char *str_key, *str_value;
+    char *key, *value;
+
+    str_key = hashtable_to_string (hashtable->type_keys, item->key);
+    key = (str_key) ? strdup (str_key) : NULL;
+
+    str_value = hashtable_to_string (hashtable->type_values, item->value);
+    value = (str_value) ? strdup (str_value) : NULL;
+
+    (void) (callback_map) (callback_map_data,
+                           hashtable,
+                           key,
+                           value);
+
+    if (key)
+        free (key);
+    if (value)
+        free (value);
+}
+
 /*
  * Calls a function on all hashtable entries (sends keys and values as strings).
  */
@@ -607,12 +1184,24 @@ hashtable_map_string (struct t_hashtable *hashtable,
 {
     int i;
     struct t_hashtable_item *ptr_item, *ptr_next_item;
-    const char *str_key, *str_value;
-    char *key, *value;
 
     if (!hashtable)
         return;
 
+    if (hashtable->open_addressing)
+    {
+        hashtable->map_running++;
+        for (i = 0; i < hashtable->size; i++)
+        {
+            if (hashtable->ctrl[i] & HASHTABLE_CTRL_EMPTY)
+                continue;
+            hashtable_map_string_item (hashtable, &hashtable->slots[i].item,
+                                       callback_map, callback_map_data);
+        }
+        hashtable->map_running--;
+        return;
+    }
+
     for (i = 0; i < hashtable->size; i++)
     {
         ptr_item = hashtable->htable[i];
@@ -620,23 +1209,8 @@ hashtable_map_string (struct t_hashtable *hashtable,
         {
             ptr_next_item = ptr_item->next_item;
 
-            str_key = hashtable_to_string (hashtable->type_keys,
-                                           ptr_item->key);
-            key = (str_key) ? strdup (str_key) : NULL;
-
-            str_value = hashtable_to_string (hashtable->type_values,
-                                             ptr_item->value);
-            value = (str_value) ? strdup (str_value) : NULL;
-
-            (void) (callback_map) (callback_map_data,
-                                   hashtable,
-                                   key,
-                                   value);
-
-            if (key)
-                free (key);
-            if (value)
-                free (value);
+            hashtable_map_string_item (hashtable, ptr_item,
+                                       callback_map, callback_map_data);
 
             ptr_item = ptr_next_item;
         }
@@ -674,7 +1248,8 @@ hashtable_dup (struct t_hashtable *hashtable)
 {
     struct t_hashtable *new_hashtable;
 
-    new_hashtable = hashtable_new (hashtable->size,
+    new_hashtable = hashtable_new ((hashtable->open_addressing) ?
+                                   0 : hashtable->size,
                                    hashtable_type_string[hashtable->type_keys],
                                    hashtable_type_string[hashtable->type_values],
                                    hashtable->callback_hash_key,
@@ -691,6 +1266,110 @@ hashtable_dup (struct t_hashtable *hashtable)
     return new_hashtable;
 }
 
+/*
+ * Gets a hashtable from the pool of hashtables (with default callbacks for
+ * hash and comparison of keys), or creates a new one if the pool has no
+ * hashtable with this size and these types.
+ *
+ * The hashtable is empty and must be given back with hashtable_pool_release
+ * after use (it must not be freed with hashtable_free).
+ *
+ * Returns pointer to hashtable, NULL if error.
+ */
+
+struct t_hashtable *
+hashtable_pool_get (int size, const char *type_keys, const char *type_values)
+{
+    struct t_hashtable *ptr_hashtable;
+    int i, type_keys_int, type_values_int;
+
+    type_keys_int = hashtable_get_type (type_keys);
+    type_values_int = hashtable_get_type (type_values);
+
+    for (i = hashtable_pool_count - 1; i >= 0; i--)
+    {
+        ptr_hashtable = hashtable_pool[i];
+        if (((int)ptr_hashtable->type_keys == type_keys_int)
+            && ((int)ptr_hashtable->type_values == type_values_int)
+            && ((size == 0) ?
+                ptr_hashtable->open_addressing :
+                (!ptr_hashtable->open_addressing
+                 && (ptr_hashtable->size == size))))
+        {
+            hashtable_pool[i] = hashtable_pool[hashtable_pool_count - 1];
+            hashtable_pool_count--;
+            return ptr_hashtable;
+        }
+    }
+
+    return hashtable_new (size, type_keys, type_values, NULL, NULL);
+}
+
+/*
+ * Duplicates a hashtable, using a hashtable from the pool of hashtables.
+ *
+ * The hashtable must have default callbacks for hash and comparison of keys.
+ *
+ * Returns pointer to new hashtable, NULL if error.
+ */
+
+struct t_hashtable *
+hashtable_pool_dup (struct t_hashtable *hashtable)
+{
+    struct t_hashtable *new_hashtable;
+
+    new_hashtable = hashtable_pool_get (
+        (hashtable->open_addressing) ? 0 : hashtable->size,
+        hashtable_type_string[hashtable->type_keys],
+        hashtable_type_string[hashtable->type_values]);
+    if (new_hashtable)
+    {
+        new_hashtable->callback_free_key = hashtable->callback_free_key;
+        new_hashtable->callback_free_value = hashtable->callback_free_value;
+        hashtable_map (hashtable,
+                       &hashtable_duplicate_map_cb,
+                       new_hashtable);
+    }
+
+    return new_hashtable;
+}
+
+/*
+ * Gives back a hashtable to the pool of hashtables: all items are removed,
+ * the table of hashtable is kept to be reused.
+ *
+ * If the pool is full (or the hashtable has custom callbacks for hash or
+ * comparison of keys), the hashtable is freed.
+ */
+
+void
+hashtable_pool_release (struct t_hashtable *hashtable)
+{
+    if (!hashtable)
+        return;
+
+    if ((hashtable_pool_count >= HASHTABLE_POOL_SIZE)
+        || (hashtable->callback_hash_key != &hashtable_hash_key_default_cb)
+        || (hashtable->callback_keycmp != &hashtable_keycmp_default_cb)
+        || (hashtable->size > HASHTABLE_POOL_MAX_SIZE))
+    {
+        hashtable_free (hashtable);
+        return;
+    }
+
+    hashtable_remove_all (hashtable);
+    hashtable->callback_free_key = NULL;
+    hashtable->callback_free_value = NULL;
+    if (hashtable->keys_values)
+    {
+        free (hashtable->keys_values);
+        hashtable->keys_values = NULL;
+    }
+
+    hashtable_pool[hashtable_pool_count] = hashtable;
+    hashtable_pool_count++;
+}
+
 /*
  * Builds sorted list of keys (callback called for each variable in hashtable).
  */
@@ -1030,6 +1709,64 @@ hashtable_set_pointer (struct t_hashtable *hashtable, const char *property,
     }
 }
 
+/*
+ * Adds a hashtable item in an infolist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hashtable_add_item_to_infolist (struct t_hashtable *hashtable,
+                                struct t_hashtable_item *item,
+                                struct t_infolist_item *infolist_item,
+                                const char *prefix, int item_number)
+{
+    char option_name[128];
+
+    snprintf (option_name, sizeof (option_name),
+              "%s_name_%05d", prefix, item_number);
+    if (!infolist_new_var_string (infolist_item, option_name,
+                                  hashtable_to_string (hashtable->type_keys,
+                                                       item->key)))
+        return 0;
+    snprintf (option_name, sizeof (option_name),
+              "%s_value_%05d", prefix, item_number);
+    switch (hashtable->type_values)
+    {
+        case HASHTABLE_INTEGER:
+            if (!infolist_new_var_integer (infolist_item, option_name,
+                                           *((int *)item->value)))
+                return 0;
+            break;
+        case HASHTABLE_STRING:
+            if (!infolist_new_var_string (infolist_item, option_name,
+                                          (const char *)item->value))
+                return 0;
+            break;
+        case HASHTABLE_POINTER:
+            if (!infolist_new_var_pointer (infolist_item, option_name,
+                                           item->value))
+                return 0;
+            break;
+        case HASHTABLE_BUFFER:
+            if (!infolist_new_var_buffer (infolist_item, option_name,
+                                          item->value,
+                                          item->value_size))
+                return 0;
+            break;
+        case HASHTABLE_TIME:
+            if (!infolist_new_var_time (infolist_item, option_name,
+                                        *((time_t *)item->value)))
+                return 0;
+            break;
+        case HASHTABLE_NUM_TYPES:
+            break;
+    }
+    return 1;
+}
+
 /*
  * Adds hashtable keys and values in an infolist.
  *
@@ -1045,56 +1782,36 @@ hashtable_add_to_infolist (struct t_hashtable *hashtable,
 {
     int i, item_number;
     struct t_hashtable_item *ptr_item;
-    char option_name[128];
 
     if (!hashtable || !infolist_item || !prefix)
         return 0;
 
     item_number = 0;
+    if (hashtable->open_addressing)
+    {
+        for (i = 0; i < hashtable->size; i++)
+        {
+            if (hashtable->ctrl[i] & HASHTABLE_CTRL_EMPTY)
+                continue;
+            if (!hashtable_add_item_to_infolist (hashtable,
+                                                 &hashtable->slots[i].item,
+                                                 infolist_item, prefix,
+                                                 item_number))
+                return 0;
+            item_number++;
+        }
+        return 1;
+    }
+
     for (i = 0; i < hashtable->size; i++)
     {
         for (ptr_item = hashtable->htable[i]; ptr_item;
              ptr_item = ptr_item->next_item)
         {
-            snprintf (option_name, sizeof (option_name),
-                      "%s_name_%05d", prefix, item_number);
-            if (!infolist_new_var_string (infolist_item, option_name,
-                                          hashtable_to_string (hashtable->type_keys,
-                                                               ptr_item->key)))
+            if (!hashtable_add_item_to_infolist (hashtable, ptr_item,
+                                                 infolist_item, prefix,
+                                                 item_number))
                 return 0;
-            snprintf (option_name, sizeof (option_name),
-                      "%s_value_%05d", prefix, item_number);
-            switch (hashtable->type_values)
-            {
-                case HASHTABLE_INTEGER:
-                    if (!infolist_new_var_integer (infolist_item, option_name,
-                                                   *((int *)ptr_item->value)))
-                        return 0;
-                    break;
-                case HASHTABLE_STRING:
-                    if (!infolist_new_var_string (infolist_item, option_name,
-                                                  (const char *)ptr_item->value))
-                        return 0;
-                    break;
-                case HASHTABLE_POINTER:
-                    if (!infolist_new_var_pointer (infolist_item, option_name,
-                                                   ptr_item->value))
-                        return 0;
-                    break;
-                case HASHTABLE_BUFFER:
-                    if (!infolist_new_var_buffer (infolist_item, option_name,
-                                                  ptr_item->value,
-                                                  ptr_item->value_size))
-                        return 0;
-                    break;
-                case HASHTABLE_TIME:
-                    if (!infolist_new_var_time (infolist_item, option_name,
-                                                *((time_t *)ptr_item->value)))
-                        return 0;
-                    break;
-                case HASHTABLE_NUM_TYPES:
-                    break;
-            }
             item_number++;
         }
     }
@@ -1113,6 +1830,14 @@ hashtable_remove_item (struct t_hashtable *hashtable,
     if (!hashtable || !item)
         return;
 
+    if (hashtable->open_addressing)
+    {
+        hashtable_open_remove_slot (
+            hashtable,
+            (int)((struct t_hashtable_slot *)item - hashtable->slots));
+        return;
+    }
+
     /* free key and value */
     hashtable_free_value (hashtable, item);
     hashtable_free_key (hashtable, item);
@@ -1160,6 +1885,22 @@ hashtable_remove_all (struct t_hashtable *hashtable)
     if (!hashtable)
         return;
 
+    if (hashtable->open_addressing)
+    {
+        for (i = 0; i < hashtable->size; i++)
+        {
+            if (!(hashtable->ctrl[i] & HASHTABLE_CTRL_EMPTY))
+            {
+                hashtable_open_free_slot (hashtable, &hashtable->slots[i],
+                                          1, 1);
+            }
+        }
+        memset (hashtable->ctrl, HASHTABLE_CTRL_EMPTY, hashtable->size);
+        hashtable->items_count = 0;
+        hashtable->deleted_count = 0;
+        return;
+    }
+
     for (i = 0; i < hashtable->size; i++)
     {
         while (hashtable->htable[i])
@@ -1180,12 +1921,88 @@ hashtable_free (struct t_hashtable *hashtable)
         return;
 
     hashtable_remove_all (hashtable);
-    free (hashtable->htable);
+    if (hashtable->htable)
+        free (hashtable->htable);
+    if (hashtable->ctrl)
+        free (hashtable->ctrl);
+    if (hashtable->slots)
+        free (hashtable->slots);
     if (hashtable->keys_values)
         free (hashtable->keys_values);
     free (hashtable);
 }
 
+/*
+ * Frees all hashtables in the pool of hashtables.
+ */
+
+void
+hashtable_end ()
+{
+    int i;
+
+    for (i = 0; i < hashtable_pool_count; i++)
+    {
+        hashtable_free (hashtable_pool[i]);
+    }
+    hashtable_pool_count = 0;
+}
+
+/*
+ * Prints a hashtable item in WeeChat log file (usually for crash dump).
+ */
+
+void
+hashtable_print_log_item (struct t_hashtable *hashtable,
+                          struct t_hashtable_item *item)
+{
+    log_printf ("    [item 0x%lx]", item);
+    switch (hashtable->type_keys)
+    {
+        case HASHTABLE_INTEGER:
+            log_printf ("      key (integer). . . : %d", *((int *)item->key));
+            break;
+        case HASHTABLE_STRING:
+            log_printf ("      key (string) . . . : '%s'", (char *)item->key);
+            break;
+        case HASHTABLE_POINTER:
+            log_printf ("      key (pointer). . . : 0x%lx", item->key);
+            break;
+        case HASHTABLE_BUFFER:
+            log_printf ("      key (buffer) . . . : 0x%lx", item->key);
+            break;
+        case HASHTABLE_TIME:
+            log_printf ("      key (time) . . . . : %ld",   *((time_t *)item->key));
+            break;
+        case HASHTABLE_NUM_TYPES:
+            break;
+    }
+    log_printf ("      key_size . . . . . : %d", item->key_size);
+    switch (hashtable->type_values)
+    {
+        case HASHTABLE_INTEGER:
+            log_printf ("      value (integer). . : %d", *((int *)item->value));
+            break;
+        case HASHTABLE_STRING:
+            log_printf ("      value (string) . . : '%s'", (char *)item->value);
+            break;
+        case HASHTABLE_POINTER:
+            log_printf ("      value (pointer). . : 0x%lx", item->value);
+            break;
+        case HASHTABLE_BUFFER:
+            log_printf ("      value (buffer) . . : 0x%lx", item->value);
+            break;
+        case HASHTABLE_TIME:
+            log_printf ("      value (time) . . . : %d", *((time_t *)item->value));
+            break;
+        case HASHTABLE_NUM_TYPES:
+            break;
+    }
+    log_printf ("      value_size . . . . : %d",    item->value_size);
+    log_printf ("      prev_item. . . . . : 0x%lx", item->prev_item);
+    log_printf ("      next_item. . . . . : 0x%lx", item->next_item);
+}
+
 /*
  * Prints hashtable in WeeChat log file (usually for crash dump).
  */
@@ -1201,6 +2018,11 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
     log_printf ("  size . . . . . . . . . : %d",    hashtable->size);
     log_printf ("  htable . . . . . . . . : 0x%lx", hashtable->htable);
     log_printf ("  items_count. . . . . . : %d",    hashtable->items_count);
+    log_printf ("  open_addressing. . . . : %d",    hashtable->open_addressing);
+    log_printf ("  ctrl . . . . . . . . . : 0x%lx", hashtable->ctrl);
+    log_printf ("  slots. . . . . . . . . : 0x%lx", hashtable->slots);
+    log_printf ("  deleted_count. . . . . : %d",    hashtable->deleted_count);
+    log_printf ("  map_running. . . . . . : %d",    hashtable->map_running);
     log_printf ("  type_keys. . . . . . . : %d (%s)",
                 hashtable->type_keys,
                 hashtable_type_string[hashtable->type_keys]);
@@ -1213,57 +2035,27 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
     log_printf ("  callback_free_value. . : 0x%lx", hashtable->callback_free_value);
     log_printf ("  keys_values. . . . . . : '%s'",  hashtable->keys_values);
 
+    if (hashtable->open_addressing)
+    {
+        for (i = 0; i < hashtable->size; i++)
+        {
+            if (hashtable->ctrl[i] & HASHTABLE_CTRL_EMPTY)
+                continue;
+            log_printf ("  slots[%06d]. . . . . : hash 0x%llx, inline %d",
+                        i, hashtable->slots[i].hash,
+                        hashtable->slots[i].inline_flags);
+            hashtable_print_log_item (hashtable, &hashtable->slots[i].item);
+        }
+        return;
+    }
+
     for (i = 0; i < hashtable->size; i++)
     {
         log_printf ("  htable[%06d] . . . . : 0x%lx", i, hashtable->htable[i]);
         for (ptr_item = hashtable->htable[i]; ptr_item;
              ptr_item = ptr_item->next_item)
         {
-            log_printf ("    [item 0x%lx]", hashtable->htable);
-            switch (hashtable->type_keys)
-            {
-                case HASHTABLE_INTEGER:
-                    log_printf ("      key (integer). . . : %d", *((int *)ptr_item->key));
-                    break;
-                case HASHTABLE_STRING:
-                    log_printf ("      key (string) . . . : '%s'", (char *)ptr_item->key);
-                    break;
-                case HASHTABLE_POINTER:
-                    log_printf ("      key (pointer). . . : 0x%lx", ptr_item->key);
-                    break;
-                case HASHTABLE_BUFFER:
-                    log_printf ("      key (buffer) . . . : 0x%lx", ptr_item->key);
-                    break;
-                case HASHTABLE_TIME:
-                    log_printf ("      key (time) . . . . : %ld",   *((time_t *)ptr_item->key));
-                    break;
-                case HASHTABLE_NUM_TYPES:
-                    break;
-            }
-            log_printf ("      key_size . . . . . : %d", ptr_item->key_size);
-            switch (hashtable->type_values)
-            {
-                case HASHTABLE_INTEGER:
-                    log_printf ("      value (integer). . : %d", *((int *)ptr_item->value));
-                    break;
-                case HASHTABLE_STRING:
-                    log_printf ("      value (string) . . : '%s'", (char *)ptr_item->value);
-                    break;
-                case HASHTABLE_POINTER:
-                    log_printf ("      value (pointer). . : 0x%lx", ptr_item->value);
-                    break;
-                case HASHTABLE_BUFFER:
-                    log_printf ("      value (buffer) . . : 0x%lx", ptr_item->value);
-                    break;
-                case HASHTABLE_TIME:
-                    log_printf ("      value (time) . . . : %d", *((time_t *)ptr_item->value));
-                    break;
-                case HASHTABLE_NUM_TYPES:
-                    break;
-            }
-            log_printf ("      value_size . . . . : %d",    ptr_item->value_size);
-            log_printf ("      prev_item. . . . . : 0x%lx", ptr_item->prev_item);
-            log_printf ("      next_item. . . . . : 0x%lx", ptr_item->next_item);
+            hashtable_print_log_item (hashtable, ptr_item);
         }
     }
 }
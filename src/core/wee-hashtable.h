@@ -20,6 +20,8 @@
 #ifndef WEECHAT_HASHTABLE_H
 #define WEECHAT_HASHTABLE_H 1
 
+#include <time.h>
+
 struct t_hashtable;
 struct t_infolist_item;
 
@@ -67,8 +69,44 @@ typedef void (t_hashtable_map_string)(void *data,
  * +-----+
  * |   7 | --> "weechat"
  * +-----+
+ *
+ * If the hashtable is created with size 0, open addressing is used instead:
+ * items are stored directly in an array of slots (no linked lists and no
+ * allocation of item), a control byte for each slot gives its state (empty,
+ * deleted or part of the hashed key), and the array grows automatically when
+ * it is 3/4 full. Integer and time keys/values are stored inside the slot.
+ * In this mode, a pointer to an item is valid only until next item is added
+ * in the hashtable.
  */
 
+#define HASHTABLE_OPEN_MIN_SIZE  8
+#define HASHTABLE_CTRL_EMPTY     0x80
+#define HASHTABLE_CTRL_DELETED   0xFE
+
+#define HASHTABLE_POOL_SIZE      16
+#define HASHTABLE_POOL_MAX_SIZE  1024
+
+#define HASHTABLE_INLINE_KEY     (1 << 0)
+#define HASHTABLE_INLINE_VALUE   (1 << 1)
+
+/* one round of SipHash */
+#define HASHTABLE_ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define HASHTABLE_SIPROUND(v0, v1, v2, v3)                              \
+    v0 += v1; v1 = HASHTABLE_ROTL(v1, 13); v1 ^= v0;                    \
+    v0 = HASHTABLE_ROTL(v0, 32);                                        \
+    v2 += v3; v3 = HASHTABLE_ROTL(v3, 16); v3 ^= v2;                    \
+    v0 += v3; v3 = HASHTABLE_ROTL(v3, 21); v3 ^= v0;                    \
+    v2 += v1; v1 = HASHTABLE_ROTL(v1, 17); v1 ^= v2;                    \
+    v2 = HASHTABLE_ROTL(v2, 32);
+
+enum t_hashtable_hash_function
+{
+    HASHTABLE_HASH_SIPHASH = 0,
+    HASHTABLE_HASH_DJB2,
+    /* number of hash functions */
+    HASHTABLE_NUM_HASH_FUNCTIONS,
+};
+
 enum t_hashtable_type
 {
     HASHTABLE_INTEGER = 0,
@@ -90,6 +128,21 @@ struct t_hashtable_item
     struct t_hashtable_item *next_item; /* link to next item                */
 };
 
+union t_hashtable_inline
+{
+    int integer;                        /* inline integer                   */
+    time_t time;                        /* inline time                      */
+};
+
+struct t_hashtable_slot
+{
+    struct t_hashtable_item item;       /* key/value of slot                */
+    unsigned long long hash;            /* hash of key                      */
+    int inline_flags;                   /* key/value stored in slot         */
+    union t_hashtable_inline key_inline;   /* inline key (integer/time)     */
+    union t_hashtable_inline value_inline; /* inline value (integer/time)   */
+};
+
 struct t_hashtable
 {
     int size;                          /* hashtable size                    */
@@ -97,6 +150,13 @@ struct t_hashtable
                                        /* lists                             */
     int items_count;                   /* number of items in hashtable      */
 
+    /* open addressing (if hashtable is created with size 0) */
+    int open_addressing;               /* 1 if open addressing is used      */
+    unsigned char *ctrl;               /* control byte for each slot        */
+    struct t_hashtable_slot *slots;    /* slots with items                  */
+    int deleted_count;                 /* number of deleted slots           */
+    int map_running;                   /* > 0 if items are being mapped     */
+
     /* type for keys and values */
     enum t_hashtable_type type_keys;   /* type for keys: int/str/pointer    */
     enum t_hashtable_type type_values; /* type for values: int/str/pointer  */
@@ -113,6 +173,8 @@ struct t_hashtable
 };
 
 extern unsigned long long hashtable_hash_key_djb2 (const char *string);
+extern unsigned long long hashtable_hash_key_siphash (const char *string);
+extern t_hashtable_hash_key *hashtable_get_hash_function (const char *name);
 extern struct t_hashtable *hashtable_new (int size,
                                           const char *type_keys,
                                           const char *type_values,
@@ -138,6 +200,11 @@ extern void hashtable_map_string (struct t_hashtable *hashtable,
                                   t_hashtable_map_string *callback_map,
                                   void *callback_map_data);
 extern struct t_hashtable *hashtable_dup (struct t_hashtable *hashtable);
+extern struct t_hashtable *hashtable_pool_get (int size,
+                                               const char *type_keys,
+                                               const char *type_values);
+extern struct t_hashtable *hashtable_pool_dup (struct t_hashtable *hashtable);
+extern void hashtable_pool_release (struct t_hashtable *hashtable);
 struct t_weelist *hashtable_get_list_keys (struct t_hashtable *hashtable);
 extern int hashtable_get_integer (struct t_hashtable *hashtable,
                                   const char *property);
@@ -152,6 +219,7 @@ extern int hashtable_add_to_infolist (struct t_hashtable *hashtable,
 extern void hashtable_remove (struct t_hashtable *hashtable, const void *key);
 extern void hashtable_remove_all (struct t_hashtable *hashtable);
 extern void hashtable_free (struct t_hashtable *hashtable);
+extern void hashtable_end ();
 extern void hashtable_print_log (struct t_hashtable *hashtable,
                                  const char *name);
 
@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "weechat.h"
 #include "wee-hdata.h"
@@ -37,6 +38,13 @@
 
 struct t_hashtable *weechat_hdata = NULL;
 
+/*
+ * generation of hdata: incremented each time a hdata or a variable is
+ * created or freed, so that data computed with hdata (for example compiled
+ * paths in evaluation) can be invalidated
+ */
+int hdata_generation = 0;
+
 /* hashtables used in hdata_search() for evaluating expression */
 struct t_hashtable *hdata_search_pointers = NULL;
 struct t_hashtable *hdata_search_extra_vars = NULL;
@@ -133,6 +141,7 @@ hdata_new (struct t_weechat_plugin *plugin, const char *hdata_name,
         new_hdata->callback_update = callback_update;
         new_hdata->callback_update_data = callback_update_data;
         new_hdata->update_pending = 0;
+        hdata_generation++;
     }
 
     return new_hdata;
@@ -160,7 +169,10 @@ hdata_new_var (struct t_hdata *hdata, const char *name, int offset, int type,
         var->update_allowed = update_allowed;
         var->array_size = (array_size && array_size[0]) ? strdup (array_size) : NULL;
         var->hdata_name = (hdata_name && hdata_name[0]) ? strdup (hdata_name) : NULL;
+        var->callback_search = NULL;
+        var->callback_search_data = NULL;
         hashtable_set (hdata->hash_var, name, var);
+        hdata_generation++;
     }
 }
 
@@ -186,6 +198,41 @@ hdata_new_list (struct t_hdata *hdata, const char *name, void *pointer,
     }
 }
 
+/*
+ * Adds an index on a variable of hdata (the variable must be a string, and
+ * its value must be unique in a list).
+ *
+ * The search callback receives the first element of a list and a value, and
+ * returns the element of this list with this value (NULL if not found);
+ * it is used by hdata_search() for a search like "${hdata.var} == value", so
+ * that the expression is not evaluated for each element of the list.
+ */
+
+void
+hdata_new_index (struct t_hdata *hdata, const char *name,
+                 void *(*callback_search)(void *data,
+                                          struct t_hdata *hdata,
+                                          void *pointer,
+                                          const char *value),
+                 void *callback_search_data)
+{
+    struct t_hdata_var *var;
+
+    if (!hdata || !name)
+        return;
+
+    var = hashtable_get (hdata->hash_var, name);
+    if (!var
+        || ((var->type != WEECHAT_HDATA_STRING)
+            && (var->type != WEECHAT_HDATA_SHARED_STRING)))
+    {
+        return;
+    }
+
+    var->callback_search = callback_search;
+    var->callback_search_data = callback_search_data;
+}
+
 /*
  * Gets offset of variable in hdata.
  */
@@ -244,29 +291,22 @@ hdata_get_var_type_string (struct t_hdata *hdata, const char *name)
 }
 
 /*
- * Gets size of array for a variable (if variable is an array).
+ * Gets size of array for a variable (if variable is an array), using pointer
+ * to variable in hdata.
  *
  * Returns size of array, -1 if variable is not an array (or if error).
  */
 
 int
-hdata_get_var_array_size (struct t_hdata *hdata, void *pointer,
-                          const char *name)
+hdata_var_array_size (struct t_hdata *hdata, struct t_hdata_var *var,
+                      void *pointer)
 {
-    struct t_hdata_var *var;
     const char *ptr_size;
     char *error;
     long value;
     int i, offset;
     void *ptr_value;
 
-    if (!hdata || !name)
-        return -1;
-
-    var = hashtable_get (hdata->hash_var, name);
-    if (!var)
-        return -1;
-
     ptr_size = var->array_size;
     if (!ptr_size)
         return -1;
@@ -341,6 +381,28 @@ hdata_get_var_array_size (struct t_hdata *hdata, void *pointer,
     return -1;
 }
 
+/*
+ * Gets size of array for a variable (if variable is an array).
+ *
+ * Returns size of array, -1 if variable is not an array (or if error).
+ */
+
+int
+hdata_get_var_array_size (struct t_hdata *hdata, void *pointer,
+                          const char *name)
+{
+    struct t_hdata_var *var;
+
+    if (!hdata || !name)
+        return -1;
+
+    var = hashtable_get (hdata->hash_var, name);
+    if (!var)
+        return -1;
+
+    return hdata_var_array_size (hdata, var, pointer);
+}
+
 /*
  * Gets size of array for variable as string.
  */
@@ -569,6 +631,108 @@ hdata_move (struct t_hdata *hdata, void *pointer, int count)
     return pointer;
 }
 
+/*
+ * Checks if a search expression is a simple comparison of an indexed variable
+ * with a constant string, like: "${buffer.full_name} == irc.freenode.#test".
+ *
+ * Returns the variable (and sets "name" and "value", which must be freed
+ * after use), NULL if the expression can not be used with an index.
+ */
+
+struct t_hdata_var *
+hdata_search_index_var (struct t_hdata *hdata, const char *search,
+                        char **name, char **value)
+{
+    struct t_hdata_var *var;
+    const char *pos, *pos_name, *pos_end;
+    char *error;
+    int length;
+
+    *name = NULL;
+    *value = NULL;
+
+    /* variable: "${hdata.var}" */
+    pos = search;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+    if (strncmp (pos, "${", 2) != 0)
+        return NULL;
+    pos += 2;
+    length = strlen (hdata->name);
+    if ((strncmp (pos, hdata->name, length) != 0) || (pos[length] != '.'))
+        return NULL;
+    pos += length + 1;
+    pos_name = pos;
+    while (isalnum ((unsigned char)pos[0]) || (pos[0] == '_'))
+    {
+        pos++;
+    }
+    if ((pos == pos_name) || (pos[0] != '}'))
+        return NULL;
+
+    /* comparison: "==" */
+    length = pos - pos_name;
+    pos++;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+    if (strncmp (pos, "==", 2) != 0)
+        return NULL;
+    pos += 2;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+
+    /*
+     * constant: it must not contain any variable, logical operator or
+     * comparison, and must not be an integer (integers are compared as
+     * numbers)
+     */
+    pos_end = pos + strlen (pos);
+    while ((pos_end > pos) && (pos_end[-1] == ' '))
+    {
+        pos_end--;
+    }
+    if ((pos_end == pos) || (pos[0] == '(') || strstr (pos, "${"))
+        return NULL;
+    if (strpbrk (pos, "&|=!<>\""))
+        return NULL;
+    *value = string_strndup (pos, pos_end - pos);
+    if (!*value)
+        return NULL;
+    (void) strtol (*value, &error, 10);
+    if (error && !error[0])
+    {
+        free (*value);
+        *value = NULL;
+        return NULL;
+    }
+
+    *name = string_strndup (pos_name, length);
+    if (!*name)
+    {
+        free (*value);
+        *value = NULL;
+        return NULL;
+    }
+
+    var = hashtable_get (hdata->hash_var, *name);
+    if (!var || !var->callback_search)
+    {
+        free (*name);
+        *name = NULL;
+        free (*value);
+        *value = NULL;
+        return NULL;
+    }
+
+    return var;
+}
+
 /*
  * Searches for an element in list using expression.
  *
@@ -578,12 +742,40 @@ hdata_move (struct t_hdata *hdata, void *pointer, int count)
 void *
 hdata_search (struct t_hdata *hdata, void *pointer, const char *search, int move)
 {
-    char *result;
+    struct t_hdata_var *var;
+    char *result, *name, *value;
+    const char *ptr_value;
+    void *ptr_found;
     int rc;
 
     if (!hdata || !pointer || !search || !search[0] || (move == 0))
         return NULL;
 
+    /*
+     * fast search with index of variable, if the whole list is searched
+     * (from first element) and if the expression is a simple comparison
+     */
+    if ((move == 1) && hdata->var_prev
+        && !hdata_pointer (hdata, pointer, hdata->var_prev))
+    {
+        var = hdata_search_index_var (hdata, search, &name, &value);
+        if (var)
+        {
+            ptr_found = (var->callback_search) (var->callback_search_data,
+                                                hdata, pointer, value);
+            if (ptr_found)
+            {
+                /* index may ignore case: check that value is the same */
+                ptr_value = hdata_string (hdata, ptr_found, name);
+                if (!ptr_value || (strcmp (ptr_value, value) != 0))
+                    ptr_found = NULL;
+            }
+            free (name);
+            free (value);
+            return ptr_found;
+        }
+    }
+
     /* clear or create hashtable with pointer for search */
     if (hdata_search_pointers)
     {
@@ -876,6 +1068,527 @@ hdata_hashtable (struct t_hdata *hdata, void *pointer, const char *name)
     return NULL;
 }
 
+/*
+ * Searches a variable in hdata and returns a field (handle) to read it
+ * without searching the variable again.
+ *
+ * The name can contain an index for arrays: "N|name".
+ *
+ * Note: the field must be freed (with hdata_field_free) before the hdata.
+ *
+ * Returns pointer to new field, NULL if variable is not found or if error.
+ */
+
+struct t_hdata_field *
+hdata_field_new (struct t_hdata *hdata, const char *name)
+{
+    struct t_hdata_field *new_field;
+    struct t_hdata_var *var;
+    const char *ptr_name;
+    int index;
+
+    if (!hdata || !name)
+        return NULL;
+
+    hdata_get_index_and_name (name, &index, &ptr_name);
+    var = hashtable_get (hdata->hash_var, ptr_name);
+    if (!var || (var->offset < 0))
+        return NULL;
+
+    new_field = malloc (sizeof (*new_field));
+    if (!new_field)
+        return NULL;
+
+    new_field->hdata = hdata;
+    new_field->var = var;
+    new_field->index = index;
+
+    return new_field;
+}
+
+/*
+ * Gets type of variable of a field (as integer).
+ */
+
+int
+hdata_field_type (struct t_hdata_field *field)
+{
+    if (!field)
+        return -1;
+
+    return field->var->type;
+}
+
+/*
+ * Gets size of array for variable of a field (if variable is an array).
+ *
+ * Returns size of array, -1 if variable is not an array (or if error).
+ */
+
+int
+hdata_field_array_size (struct t_hdata_field *field, void *pointer)
+{
+    if (!field || !pointer)
+        return -1;
+
+    return hdata_var_array_size (field->hdata, field->var, pointer);
+}
+
+/*
+ * Returns index in array to use to read a field: the index given as argument
+ * if >= 0, otherwise the index found in name of field ("N|name").
+ *
+ * Returns -1 if the variable is not an array.
+ */
+
+int
+hdata_field_get_index (struct t_hdata_field *field, int index)
+{
+    if (!field->var->array_size)
+        return -1;
+
+    return (index >= 0) ? index : field->index;
+}
+
+/*
+ * Gets char value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+char
+hdata_field_char (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return '\0';
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return (*((char **)(pointer + field->var->offset)))[index];
+
+    return *((char *)(pointer + field->var->offset));
+}
+
+/*
+ * Gets integer value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+int
+hdata_field_integer (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return 0;
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return ((int *)(pointer + field->var->offset))[index];
+
+    return *((int *)(pointer + field->var->offset));
+}
+
+/*
+ * Gets long value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+long
+hdata_field_long (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return 0;
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return ((long *)(pointer + field->var->offset))[index];
+
+    return *((long *)(pointer + field->var->offset));
+}
+
+/*
+ * Gets string value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+const char *
+hdata_field_string (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return NULL;
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return (*((char ***)(pointer + field->var->offset)))[index];
+
+    return *((char **)(pointer + field->var->offset));
+}
+
+/*
+ * Gets pointer value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+void *
+hdata_field_pointer (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return NULL;
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return (*((void ***)(pointer + field->var->offset)))[index];
+
+    return *((void **)(pointer + field->var->offset));
+}
+
+/*
+ * Gets time value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+time_t
+hdata_field_time (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return 0;
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return ((time_t *)(pointer + field->var->offset))[index];
+
+    return *((time_t *)(pointer + field->var->offset));
+}
+
+/*
+ * Gets hashtable value of a field.
+ *
+ * Argument "index" is the index in array (if variable is an array), -1 to use
+ * the index given in name of field.
+ */
+
+struct t_hashtable *
+hdata_field_hashtable (struct t_hdata_field *field, void *pointer, int index)
+{
+    if (!field || !pointer)
+        return NULL;
+
+    index = hdata_field_get_index (field, index);
+    if (index >= 0)
+        return (*((struct t_hashtable ***)(pointer + field->var->offset)))[index];
+
+    return *((struct t_hashtable **)(pointer + field->var->offset));
+}
+
+/*
+ * Reads many fields of an object in a single call.
+ *
+ * Value of fields[i] is stored in values[i], which must point to a variable
+ * with the C type of field: char, int, long, const char *, void *, time_t or
+ * struct t_hashtable * (for example a member of a structure).
+ * A NULL field or value is skipped.
+ *
+ * Returns number of values read.
+ */
+
+int
+hdata_field_read (struct t_hdata_field **fields, int num_fields,
+                  void *pointer, void **values)
+{
+    int i, num_read;
+
+    if (!fields || !pointer || !values)
+        return 0;
+
+    num_read = 0;
+    for (i = 0; i < num_fields; i++)
+    {
+        if (!fields[i] || !values[i])
+            continue;
+        switch (fields[i]->var->type)
+        {
+            case WEECHAT_HDATA_CHAR:
+                *((char *)values[i]) = hdata_field_char (fields[i],
+                                                         pointer, -1);
+                break;
+            case WEECHAT_HDATA_INTEGER:
+                *((int *)values[i]) = hdata_field_integer (fields[i],
+                                                           pointer, -1);
+                break;
+            case WEECHAT_HDATA_LONG:
+                *((long *)values[i]) = hdata_field_long (fields[i],
+                                                         pointer, -1);
+                break;
+            case WEECHAT_HDATA_STRING:
+            case WEECHAT_HDATA_SHARED_STRING:
+                *((const char **)values[i]) = hdata_field_string (fields[i],
+                                                                  pointer,
+                                                                  -1);
+                break;
+            case WEECHAT_HDATA_TIME:
+                *((time_t *)values[i]) = hdata_field_time (fields[i],
+                                                           pointer, -1);
+                break;
+            case WEECHAT_HDATA_HASHTABLE:
+                *((struct t_hashtable **)values[i]) =
+                    hdata_field_hashtable (fields[i], pointer, -1);
+                break;
+            default:
+                *((void **)values[i]) = hdata_field_pointer (fields[i],
+                                                             pointer, -1);
+                break;
+        }
+        num_read++;
+    }
+
+    return num_read;
+}
+
+/*
+ * Frees a field.
+ */
+
+void
+hdata_field_free (struct t_hdata_field *field)
+{
+    if (field)
+        free (field);
+}
+
+/*
+ * Adds variables of hdata in array of fields to fetch (used for fields "*").
+ */
+
+void
+hdata_fetch_add_var_cb (void *data, struct t_hashtable *hashtable,
+                        const void *key, const void *value)
+{
+    struct t_hdata_fetch_field **ptr_field;
+    struct t_hdata_var *var;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    ptr_field = (struct t_hdata_fetch_field **)data;
+    var = (struct t_hdata_var *)value;
+
+    /* arrays are fetched only with an explicit index ("N|name") */
+    if ((var->offset < 0) || var->array_size)
+        return;
+
+    (*ptr_field)->name = (const char *)key;
+    (*ptr_field)->var = var;
+    (*ptr_field)->index = -1;
+    (*ptr_field)++;
+}
+
+/*
+ * Returns value of a field as string (for hdata_fetch).
+ *
+ * Pointers are returned as "0x123abc" ("" for NULL), like in scripts.
+ */
+
+const char *
+hdata_fetch_value (struct t_hdata_fetch_field *field, void *pointer,
+                   char *str_value, int size)
+{
+    struct t_hdata_var *var;
+    const char *ptr_string;
+    void *ptr_pointer;
+    int array;
+
+    var = field->var;
+    array = (var->array_size && (field->index >= 0));
+
+    /* arrays of chars, strings and pointers are allocated (can be NULL) */
+    if (array
+        && (var->type != WEECHAT_HDATA_INTEGER)
+        && (var->type != WEECHAT_HDATA_LONG)
+        && (var->type != WEECHAT_HDATA_TIME)
+        && !(*((void **)(pointer + var->offset))))
+    {
+        return "";
+    }
+
+    switch (var->type)
+    {
+        case WEECHAT_HDATA_CHAR:
+            snprintf (str_value, size, "%c",
+                      (array) ?
+                      (*((char **)(pointer + var->offset)))[field->index] :
+                      *((char *)(pointer + var->offset)));
+            return str_value;
+        case WEECHAT_HDATA_INTEGER:
+            snprintf (str_value, size, "%d",
+                      (array) ?
+                      ((int *)(pointer + var->offset))[field->index] :
+                      *((int *)(pointer + var->offset)));
+            return str_value;
+        case WEECHAT_HDATA_LONG:
+            snprintf (str_value, size, "%ld",
+                      (array) ?
+                      ((long *)(pointer + var->offset))[field->index] :
+                      *((long *)(pointer + var->offset)));
+            return str_value;
+        case WEECHAT_HDATA_STRING:
+        case WEECHAT_HDATA_SHARED_STRING:
+            ptr_string = (array) ?
+                (*((char ***)(pointer + var->offset)))[field->index] :
+                *((char **)(pointer + var->offset));
+            return (ptr_string) ? ptr_string : "";
+        case WEECHAT_HDATA_TIME:
+            snprintf (str_value, size, "%ld",
+                      (long)((array) ?
+                             ((time_t *)(pointer + var->offset))[field->index] :
+                             *((time_t *)(pointer + var->offset))));
+            return str_value;
+        case WEECHAT_HDATA_POINTER:
+        case WEECHAT_HDATA_HASHTABLE:
+        case WEECHAT_HDATA_OTHER:
+            ptr_pointer = (array) ?
+                (*((void ***)(pointer + var->offset)))[field->index] :
+                *((void **)(pointer + var->offset));
+            if (!ptr_pointer)
+                return "";
+            snprintf (str_value, size,
+                      "0x%lx", (long unsigned int)ptr_pointer);
+            return str_value;
+    }
+
+    return "";
+}
+
+/*
+ * Fetches many variables of one or more objects in a single call.
+ *
+ * Argument "fields" is a comma-separated list of variables (with optional
+ * index for arrays: "N|name"), or "*" for all variables (except arrays).
+ *
+ * Argument "count" is the max number of objects to fetch: 1 for the object
+ * only, N > 1 to move to next objects (with var_next of hdata), N < 0 to move
+ * to previous objects (with var_prev of hdata), 0 for all objects until the
+ * end of list.
+ *
+ * Variables are searched once, then the callback is called for each object
+ * with a hashtable (keys and values are strings) containing the variables
+ * and the key "__pointer" (pointer to object). The hashtable is reused for
+ * all objects and freed after the last one: the callback must copy the
+ * content it needs.
+ *
+ * Returns number of objects fetched.
+ */
+
+int
+hdata_fetch (struct t_hdata *hdata, void *pointer, const char *fields,
+             int count,
+             void (*callback)(void *data,
+                              struct t_hdata *hdata,
+                              void *pointer,
+                              struct t_hashtable *record),
+             void *callback_data)
+{
+    struct t_hdata_fetch_field *fetch_fields, *ptr_field;
+    struct t_hdata_var *var, *var_move;
+    struct t_hashtable *record;
+    char **argv, str_value[64];
+    const char *ptr_name;
+    int i, argc, num_fields, num_objects, max_objects;
+
+    if (!hdata || !pointer || !fields || !callback)
+        return 0;
+
+    argv = NULL;
+    argc = 0;
+    fetch_fields = NULL;
+    num_fields = 0;
+    record = NULL;
+    num_objects = 0;
+
+    /* search variables (only once for all objects) */
+    if (strcmp (fields, "*") == 0)
+    {
+        fetch_fields = malloc ((hdata->hash_var->items_count + 1) *
+                               sizeof (*fetch_fields));
+        if (!fetch_fields)
+            goto end;
+        ptr_field = fetch_fields;
+        hashtable_map (hdata->hash_var, &hdata_fetch_add_var_cb, &ptr_field);
+        num_fields = ptr_field - fetch_fields;
+    }
+    else
+    {
+        argv = string_split (fields, ",", 0, 0, &argc);
+        if (!argv)
+            goto end;
+        fetch_fields = malloc ((argc + 1) * sizeof (*fetch_fields));
+        if (!fetch_fields)
+            goto end;
+        for (i = 0; i < argc; i++)
+        {
+            hdata_get_index_and_name (argv[i], &fetch_fields[num_fields].index,
+                                      &ptr_name);
+            var = hashtable_get (hdata->hash_var, ptr_name);
+            if (!var || (var->offset < 0))
+                continue;
+            fetch_fields[num_fields].name = argv[i];
+            fetch_fields[num_fields].var = var;
+            num_fields++;
+        }
+    }
+
+    record = hashtable_new (32,
+                            WEECHAT_HASHTABLE_STRING,
+                            WEECHAT_HASHTABLE_STRING,
+                            NULL, NULL);
+    if (!record)
+        goto end;
+
+    /* fetch objects */
+    var_move = hashtable_get (hdata->hash_var,
+                              (count < 0) ? hdata->var_prev : hdata->var_next);
+    if (var_move && (var_move->offset < 0))
+        var_move = NULL;
+    max_objects = abs (count);
+    while (pointer)
+    {
+        for (i = 0; i < num_fields; i++)
+        {
+            hashtable_set (record, fetch_fields[i].name,
+                           hdata_fetch_value (&fetch_fields[i], pointer,
+                                              str_value, sizeof (str_value)));
+        }
+        snprintf (str_value, sizeof (str_value),
+                  "0x%lx", (long unsigned int)pointer);
+        hashtable_set (record, "__pointer", str_value);
+        (callback) (callback_data, hdata, pointer, record);
+        num_objects++;
+        if ((max_objects > 0) && (num_objects >= max_objects))
+            break;
+        pointer = (var_move) ?
+            *((void **)(pointer + var_move->offset)) : NULL;
+    }
+
+end:
+    if (record)
+        hashtable_free (record);
+    if (fetch_fields)
+        free (fetch_fields);
+    if (argv)
+        string_free_split (argv);
+
+    return num_objects;
+}
+
 /*
  * Sets value for a variable in hdata.
  *
@@ -1074,6 +1787,8 @@ hdata_free (struct t_hdata *hdata)
         free (hdata->name);
 
     free (hdata);
+
+    hdata_generation++;
 }
 
 /*
@@ -1158,6 +1873,8 @@ hdata_print_log_var_map_cb (void *data, struct t_hashtable *hashtable,
     log_printf ("    update_allowed . . . . : %d",   (int)var->update_allowed);
     log_printf ("    array_size . . . . . . : '%s'", var->array_size);
     log_printf ("    hdata_name . . . . . . : '%s'", var->hdata_name);
+    log_printf ("    callback_search. . . . : 0x%lx", var->callback_search);
+    log_printf ("    callback_search_data . : 0x%lx", var->callback_search_data);
 }
 
 /*
@@ -30,6 +30,8 @@
 #define HDATA_LIST(__name, __flags)                                     \
     hdata_new_list (hdata, #__name, &(__name), __flags);
 
+struct t_hdata;
+
 struct t_hdata_var
 {
     int offset;                        /* offset                            */
@@ -37,6 +39,12 @@ struct t_hdata_var
     char update_allowed;               /* update allowed?                   */
     char *array_size;                  /* array size                        */
     char *hdata_name;                  /* hdata name                        */
+    void *(*callback_search)           /* search callback (index on var)    */
+    (void *data,
+     struct t_hdata *hdata,
+     void *pointer,
+     const char *value);
+    void *callback_search_data;        /* data sent to search callback      */
 };
 
 struct t_hdata_list
@@ -45,6 +53,20 @@ struct t_hdata_list
     int flags;                         /* flags for list                    */
 };
 
+struct t_hdata_field
+{
+    struct t_hdata *hdata;             /* hdata                             */
+    struct t_hdata_var *var;           /* variable in hdata                 */
+    int index;                         /* index in array (-1 if not array)  */
+};
+
+struct t_hdata_fetch_field
+{
+    const char *name;                  /* name of field (with index)        */
+    struct t_hdata_var *var;           /* variable in hdata                 */
+    int index;                         /* index in array (-1 if not array)  */
+};
+
 struct t_hdata
 {
     char *name;                        /* name of hdata                     */
@@ -72,6 +94,7 @@ struct t_hdata
 };
 
 extern struct t_hashtable *weechat_hdata;
+extern int hdata_generation;
 
 extern char *hdata_type_string[];
 
@@ -89,6 +112,12 @@ extern void hdata_new_var (struct t_hdata *hdata, const char *name, int offset,
                            const char *hdata_name);
 extern void hdata_new_list (struct t_hdata *hdata, const char *name,
                             void *pointer, int flags);
+extern void hdata_new_index (struct t_hdata *hdata, const char *name,
+                             void *(*callback_search)(void *data,
+                                                      struct t_hdata *hdata,
+                                                      void *pointer,
+                                                      const char *value),
+                             void *callback_search_data);
 extern int hdata_get_var_offset (struct t_hdata *hdata, const char *name);
 extern int hdata_get_var_type (struct t_hdata *hdata, const char *name);
 extern const char *hdata_get_var_type_string (struct t_hdata *hdata,
@@ -124,6 +153,35 @@ extern time_t hdata_time (struct t_hdata *hdata, void *pointer,
                           const char *name);
 extern struct t_hashtable *hdata_hashtable (struct t_hdata *hdata,
                                             void *pointer, const char *name);
+extern struct t_hdata_field *hdata_field_new (struct t_hdata *hdata,
+                                             const char *name);
+extern int hdata_field_type (struct t_hdata_field *field);
+extern int hdata_field_array_size (struct t_hdata_field *field,
+                                   void *pointer);
+extern char hdata_field_char (struct t_hdata_field *field, void *pointer,
+                              int index);
+extern int hdata_field_integer (struct t_hdata_field *field, void *pointer,
+                                int index);
+extern long hdata_field_long (struct t_hdata_field *field, void *pointer,
+                              int index);
+extern const char *hdata_field_string (struct t_hdata_field *field,
+                                       void *pointer, int index);
+extern void *hdata_field_pointer (struct t_hdata_field *field, void *pointer,
+                                  int index);
+extern time_t hdata_field_time (struct t_hdata_field *field, void *pointer,
+                                int index);
+extern struct t_hashtable *hdata_field_hashtable (struct t_hdata_field *field,
+                                                  void *pointer, int index);
+extern int hdata_field_read (struct t_hdata_field **fields, int num_fields,
+                             void *pointer, void **values);
+extern void hdata_field_free (struct t_hdata_field *field);
+extern int hdata_fetch (struct t_hdata *hdata, void *pointer,
+                        const char *fields, int count,
+                        void (*callback)(void *data,
+                                         struct t_hdata *hdata,
+                                         void *pointer,
+                                         struct t_hashtable *record),
+                        void *callback_data);
 extern int hdata_set (struct t_hdata *hdata, void *pointer, const char *name,
                       const char *value);
 extern int hdata_update (struct t_hdata *hdata, void *pointer,
@@ -37,17 +37,30 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <errno.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#define HOOK_FD_EPOLL 1
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/event.h>
+#define HOOK_FD_KQUEUE 1
+#endif
 
 #include "weechat.h"
 #include "wee-hook.h"
+#include "wee-arraylist.h"
 #include "wee-config.h"
+#include "wee-eval.h"
 #include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-infolist.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-metrics.h"
 #include "wee-network.h"
+#include "wee-profile.h"
+#include "wee-spawn.h"
 #include "wee-string.h"
+#include "wee-trace.h"
 #include "wee-url.h"
 #include "wee-utf8.h"
 #include "wee-util.h"
@@ -71,18 +84,65 @@ struct t_hook *weechat_hooks[HOOK_NUM_TYPES];     /* list of hooks          */
 struct t_hook *last_weechat_hook[HOOK_NUM_TYPES]; /* last hook              */
 int hooks_count[HOOK_NUM_TYPES];                  /* number of hooks        */
 int hooks_count_total = 0;                        /* total number of hooks  */
+int hooks_changes[HOOK_NUM_TYPES];                /* hooks added/removed    */
+struct t_hook_index *hook_index[HOOK_NUM_TYPES];  /* index of hooks by name */
+struct t_arraylist *hook_priorities[HOOK_NUM_TYPES]; /* hooks by priority   */
+struct t_hashtable *hook_pointers = NULL;         /* valid hooks (not       */
+                                                  /* deleted)               */
+unsigned long long hook_last_number = 0;          /* number of last hook    */
+struct t_hashtable *hook_print_buffers = NULL;    /* print hooks by buffer  */
+struct t_hashtable *hook_print_tags = NULL;       /* print hooks by tag     */
+struct t_arraylist *hook_print_others = NULL;     /* other print hooks      */
 int hook_exec_recursion = 0;           /* 1 when a hook is executed         */
 time_t hook_last_system_time = 0;      /* used to detect system clock skew  */
-int real_delete_pending = 0;           /* 1 if some hooks must be deleted   */
+struct t_arraylist *hooks_deleted = NULL; /* hooks to remove from list   */
+                                       /* after the end of hook exec        */
 
 struct pollfd *hook_fd_pollfd = NULL;  /* file descriptors for poll()       */
 int hook_fd_pollfd_count = 0;          /* number of file descriptors        */
+struct t_hook **hook_fd_table = NULL;  /* fd hooks, indexed by fd           */
+int hook_fd_table_size = 0;            /* size of hook_fd_table             */
+int hook_fd_backend = -1;              /* epoll/kqueue descriptor           */
+                                       /* (-1 = use poll() for all fds)     */
+#if defined(HOOK_FD_EPOLL)
+struct epoll_event *hook_fd_events = NULL; /* events returned by epoll     */
+#elif defined(HOOK_FD_KQUEUE)
+struct kevent *hook_fd_events = NULL;  /* events returned by kqueue         */
+#endif
+int hook_fd_events_size = 0;           /* size of hook_fd_events            */
+time_t hook_fd_last_check_invalid = 0; /* last check of invalid fds         */
+struct t_hook **hook_timer_heap = NULL; /* timers sorted by next_exec     */
+                                       /* (binary min-heap)                 */
+int hook_timer_heap_size = 0;          /* size of hook_timer_heap           */
+int hook_timer_heap_count = 0;         /* number of timers in heap          */
+int hook_fd_poll_only_count = 0;       /* number of fd hooks checked with   */
+                                       /* poll() when epoll/kqueue is used  */
 int hook_process_pending = 0;          /* 1 if there are some process to    */
-                                       /* run (via fork)                    */
+                                       /* run (via fork) or queued process  */
+                                       /* which could be started            */
 int hook_socketpair_ok = 0;            /* 1 if socketpair() is OK           */
 
+#ifdef HAVE_TRACEPOINTS
+TRACE_SEMAPHORE(hook_exec_start);
+TRACE_SEMAPHORE(hook_exec_end);
+TRACE_SEMAPHORE(hook_process_spawn);
+TRACE_SEMAPHORE(hook_process_exit);
+#endif /* HAVE_TRACEPOINTS */
+
 
 void hook_process_run (struct t_hook *hook_process);
+void hook_process_send_buffers (struct t_hook *hook_process, int callback_rc);
+struct t_hook_index *hook_index_new (int wildcards, int prefix_match);
+struct t_hashtable *hook_index_new_hashtable ();
+void hook_index_free_list_cb (struct t_hashtable *hashtable,
+                              const void *key, void *value);
+int hook_index_cmp_cb (void *data, struct t_arraylist *arraylist,
+                       void *pointer1, void *pointer2);
+int hook_priority_cmp_cb (void *data, struct t_arraylist *arraylist,
+                          void *pointer1, void *pointer2);
+void hook_priority_free_cb (void *data, struct t_arraylist *arraylist,
+                            void *pointer);
+void hook_fd_backend_init ();
 
 
 /*
@@ -100,10 +160,47 @@ hook_init ()
         weechat_hooks[type] = NULL;
         last_weechat_hook[type] = NULL;
         hooks_count[type] = 0;
+        hooks_changes[type] = 0;
+        hook_index[type] = NULL;
+        /* commands are sorted by name, then priority */
+        hook_priorities[type] = (type == HOOK_TYPE_COMMAND) ?
+            NULL : arraylist_new (0, 1, 0,
+                                  &hook_priority_cmp_cb, NULL,
+                                  &hook_priority_free_cb, NULL);
     }
     hooks_count_total = 0;
+
+    /* valid hooks and hooks to remove after the end of hook exec */
+    hook_pointers = hashtable_new (256,
+                                   WEECHAT_HASHTABLE_POINTER,
+                                   WEECHAT_HASHTABLE_POINTER,
+                                   NULL, NULL);
+    hooks_deleted = arraylist_new (0, 0, 1, &hook_index_cmp_cb, NULL,
+                                   NULL, NULL);
+
+    /* index of hooks by name */
+    hook_index[HOOK_TYPE_COMMAND] = hook_index_new (0, 0);
+    hook_index[HOOK_TYPE_COMMAND_RUN] = hook_index_new (1, 1);
+    hook_index[HOOK_TYPE_SIGNAL] = hook_index_new (1, 0);
+    hook_index[HOOK_TYPE_HSIGNAL] = hook_index_new (1, 0);
+    hook_index[HOOK_TYPE_CONFIG] = hook_index_new (1, 0);
+    hook_index[HOOK_TYPE_MODIFIER] = hook_index_new (0, 0);
+
+    /* buckets of print hooks (by buffer, by tag, others) */
+    hook_print_buffers = hashtable_new (32,
+                                        WEECHAT_HASHTABLE_POINTER,
+                                        WEECHAT_HASHTABLE_POINTER,
+                                        NULL, NULL);
+    if (hook_print_buffers)
+        hook_print_buffers->callback_free_value = &hook_index_free_list_cb;
+    hook_print_tags = hook_index_new_hashtable ();
+    hook_print_others = arraylist_new (0, 1, 0, &hook_index_cmp_cb, NULL,
+                                       NULL, NULL);
     hook_last_system_time = time (NULL);
 
+    /* initialize epoll/kqueue for fd hooks (if available) */
+    hook_fd_backend_init ();
+
     /*
      * Set a flag to 0 if socketpair() function is not available.
      *
@@ -201,283 +298,1022 @@ hook_fd_realloc_pollfd ()
 }
 
 /*
- * Searches for position of hook in list (to keep hooks sorted).
- *
- * Hooks are sorted by priority, except commands which are sorted by command
- * name, and then priority.
+ * Hashes a key of hook index (case insensitive).
  */
 
-struct t_hook *
-hook_find_pos (struct t_hook *hook)
+unsigned long long
+hook_index_hash_key_cb (struct t_hashtable *hashtable, const void *key)
 {
-    struct t_hook *ptr_hook;
-    int rc_cmp;
+    unsigned long long hash;
+    const char *ptr_key;
+    int c;
 
-    if (hook->type == HOOK_TYPE_COMMAND)
-    {
-        /* for command hook, sort on command name + priority */
-        for (ptr_hook = weechat_hooks[hook->type]; ptr_hook;
-             ptr_hook = ptr_hook->next_hook)
-        {
-            if (!ptr_hook->deleted)
-            {
-                rc_cmp = string_strcasecmp (HOOK_COMMAND(hook, command),
-                                            HOOK_COMMAND(ptr_hook, command));
-                if (rc_cmp < 0)
-                    return ptr_hook;
-                if ((rc_cmp == 0) && (hook->priority > ptr_hook->priority))
-                    return ptr_hook;
-            }
-        }
-    }
-    else
+    /* make C compiler happy */
+    (void) hashtable;
+
+    hash = 5381;
+    for (ptr_key = (const char *)key; ptr_key[0]; ptr_key++)
     {
-        /* for other types, sort on priority */
-        for (ptr_hook = weechat_hooks[hook->type]; ptr_hook;
-             ptr_hook = ptr_hook->next_hook)
-        {
-            if (!ptr_hook->deleted && (hook->priority > ptr_hook->priority))
-                return ptr_hook;
-        }
+        c = (unsigned char)ptr_key[0];
+        if ((c >= 'A') && (c <= 'Z'))
+            c += ('a' - 'A');
+        hash ^= (hash << 5) + (hash >> 2) + c;
     }
 
-    /* position not found, add at the end */
-    return NULL;
+    return hash;
 }
 
 /*
- * Adds a hook to list.
+ * Compares two keys of hook index (case insensitive).
  */
 
-void
-hook_add_to_list (struct t_hook *new_hook)
+int
+hook_index_keycmp_cb (struct t_hashtable *hashtable,
+                      const void *key1, const void *key2)
 {
-    struct t_hook *pos_hook;
-
-    if (weechat_hooks[new_hook->type])
-    {
-        pos_hook = hook_find_pos (new_hook);
-        if (pos_hook)
-        {
-            /* add hook before "pos_hook" */
-            new_hook->prev_hook = pos_hook->prev_hook;
-            new_hook->next_hook = pos_hook;
-            if (pos_hook->prev_hook)
-                (pos_hook->prev_hook)->next_hook = new_hook;
-            else
-                weechat_hooks[new_hook->type] = new_hook;
-            pos_hook->prev_hook = new_hook;
-        }
-        else
-        {
-            /* add hook to end of list */
-            new_hook->prev_hook = last_weechat_hook[new_hook->type];
-            new_hook->next_hook = NULL;
-            last_weechat_hook[new_hook->type]->next_hook = new_hook;
-            last_weechat_hook[new_hook->type] = new_hook;
-        }
-    }
-    else
-    {
-        new_hook->prev_hook = NULL;
-        new_hook->next_hook = NULL;
-        weechat_hooks[new_hook->type] = new_hook;
-        last_weechat_hook[new_hook->type] = new_hook;
-    }
-
-    hooks_count[new_hook->type]++;
-    hooks_count_total++;
+    /* make C compiler happy */
+    (void) hashtable;
 
-    if (new_hook->type == HOOK_TYPE_FD)
-        hook_fd_realloc_pollfd ();
+    return string_strcasecmp ((const char *)key1, (const char *)key2);
 }
 
 /*
- * Removes a hook from list.
+ * Compares two hooks, using same order as hooks in list: priority (higher
+ * first), then creation order.
  */
 
-void
-hook_remove_from_list (struct t_hook *hook)
+int
+hook_index_cmp_hooks (struct t_hook *hook1, struct t_hook *hook2)
 {
-    struct t_hook *new_hooks;
-    int type;
+    if (hook1->priority != hook2->priority)
+        return (hook1->priority > hook2->priority) ? -1 : 1;
 
-    type = hook->type;
+    if (hook1->number != hook2->number)
+        return (hook1->number < hook2->number) ? -1 : 1;
 
-    if (last_weechat_hook[hook->type] == hook)
-        last_weechat_hook[hook->type] = hook->prev_hook;
-    if (hook->prev_hook)
-    {
-        (hook->prev_hook)->next_hook = hook->next_hook;
-        new_hooks = weechat_hooks[hook->type];
-    }
-    else
-        new_hooks = hook->next_hook;
+    return 0;
+}
 
-    if (hook->next_hook)
-        (hook->next_hook)->prev_hook = hook->prev_hook;
+/*
+ * Compares two hooks in a list of hook index.
+ */
 
-    free (hook);
+int
+hook_index_cmp_cb (void *data, struct t_arraylist *arraylist,
+                   void *pointer1, void *pointer2)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
 
-    weechat_hooks[type] = new_hooks;
+    return hook_index_cmp_hooks ((struct t_hook *)pointer1,
+                                 (struct t_hook *)pointer2);
+}
 
-    hooks_count[type]--;
-    hooks_count_total--;
+/*
+ * Compares two hooks (callback for qsort).
+ */
 
-    if (type == HOOK_TYPE_FD)
-        hook_fd_realloc_pollfd ();
+int
+hook_index_qsort_cmp_cb (const void *hook1, const void *hook2)
+{
+    return hook_index_cmp_hooks (*((struct t_hook **)hook1),
+                                 *((struct t_hook **)hook2));
 }
 
 /*
- * Removes hooks marked as "deleted" from list.
+ * Frees a list of hooks in a hashtable of hook index.
  */
 
 void
-hook_remove_deleted ()
+hook_index_free_list_cb (struct t_hashtable *hashtable,
+                         const void *key, void *value)
 {
-    int type;
-    struct t_hook *ptr_hook, *next_hook;
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
 
-    if (real_delete_pending)
-    {
-        for (type = 0; type < HOOK_NUM_TYPES; type++)
-        {
-            ptr_hook = weechat_hooks[type];
-            while (ptr_hook)
-            {
-                next_hook = ptr_hook->next_hook;
+    arraylist_free ((struct t_arraylist *)value);
+}
 
-                if (ptr_hook->deleted)
-                    hook_remove_from_list (ptr_hook);
+/*
+ * Creates a new hashtable for a hook index.
+ *
+ * Returns pointer to new hashtable, NULL if error.
+ */
 
-                ptr_hook = next_hook;
-            }
-        }
-        real_delete_pending = 0;
-    }
+struct t_hashtable *
+hook_index_new_hashtable ()
+{
+    struct t_hashtable *hashtable;
+
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_POINTER,
+                               &hook_index_hash_key_cb,
+                               &hook_index_keycmp_cb);
+    if (hashtable)
+        hashtable->callback_free_value = &hook_index_free_list_cb;
+
+    return hashtable;
 }
 
 /*
- * Extracts priority and name from a string.
+ * Creates a new hook index.
  *
- * String can be:
- *   - a simple name like "test":
- *       => priority = 1000 (default), name = "test"
- *   - a priority + "|" + name, like "500|test":
- *       => priority = 500, name = "test"
+ * If wildcards == 1, masks can contain "*" (checked with string_match),
+ * otherwise masks are names compared without case.
+ *
+ * If prefix_match == 1, a mask without "*" and without space matches also
+ * names beginning with the mask (like masks of command_run hooks: "/away"
+ * matches "/away -all").
+ *
+ * Returns pointer to new index, NULL if error.
  */
 
-void
-hook_get_priority_and_name (const char *string,
-                            int *priority, const char **name)
+struct t_hook_index *
+hook_index_new (int wildcards, int prefix_match)
 {
-    char *pos, *str_priority, *error;
-    long number;
+    struct t_hook_index *new_index;
+    int i;
 
-    if (priority)
-        *priority = HOOK_PRIORITY_DEFAULT;
-    if (name)
-        *name = string;
+    new_index = malloc (sizeof (*new_index));
+    if (!new_index)
+        return NULL;
 
-    pos = strchr (string, '|');
-    if (pos)
+    new_index->wildcards = wildcards;
+    new_index->prefix_match = prefix_match;
+    new_index->names = hook_index_new_hashtable ();
+    new_index->prefixes = hook_index_new_hashtable ();
+    new_index->suffixes = hook_index_new_hashtable ();
+    new_index->others = arraylist_new (0, 1, 0,
+                                       &hook_index_cmp_cb, NULL,
+                                       NULL, NULL);
+    if (!new_index->names || !new_index->prefixes || !new_index->suffixes
+        || !new_index->others)
     {
-        str_priority = string_strndup (string, pos - string);
-        if (str_priority)
-        {
-            error = NULL;
-            number = strtol (str_priority, &error, 10);
-            if (error && !error[0])
-            {
-                if (priority)
-                    *priority = number;
-                if (name)
-                    *name = pos + 1;
-            }
-            free (str_priority);
-        }
+        if (new_index->names)
+            hashtable_free (new_index->names);
+        if (new_index->prefixes)
+            hashtable_free (new_index->prefixes);
+        if (new_index->suffixes)
+            hashtable_free (new_index->suffixes);
+        if (new_index->others)
+            arraylist_free (new_index->others);
+        free (new_index);
+        return NULL;
+    }
+    for (i = 0; i <= HOOK_INDEX_MAX_AFFIX; i++)
+    {
+        new_index->prefixes_count[i] = 0;
+        new_index->suffixes_count[i] = 0;
     }
+    new_index->count = 0;
+
+    return new_index;
 }
 
 /*
- * Initializes a new hook with default values.
+ * Returns mask used to index a hook (depends on hook type).
  */
 
-void
-hook_init_data (struct t_hook *hook, struct t_weechat_plugin *plugin,
-                int type, int priority,
-                const void *callback_pointer, void *callback_data)
+const char *
+hook_index_get_mask (struct t_hook *hook)
 {
-    hook->plugin = plugin;
-    hook->subplugin = NULL;
-    hook->type = type;
-    hook->deleted = 0;
-    hook->running = 0;
-    hook->priority = priority;
-    hook->callback_pointer = callback_pointer;
-    hook->callback_data = callback_data;
-    hook->hook_data = NULL;
+    if (!hook->hook_data)
+        return NULL;
 
-    if (weechat_debug_core >= 2)
+    switch (hook->type)
     {
-        gui_chat_printf (NULL,
-                         "debug: adding hook: type=%d (%s), plugin=\"%s\", "
-                         "priority=%d",
-                         hook->type,
-                         hook_type_string[hook->type],
-                         plugin_get_name (hook->plugin),
-                         hook->priority);
+        case HOOK_TYPE_COMMAND:
+            return HOOK_COMMAND(hook, command);
+        case HOOK_TYPE_COMMAND_RUN:
+            return HOOK_COMMAND_RUN(hook, command);
+        case HOOK_TYPE_SIGNAL:
+            return HOOK_SIGNAL(hook, signal);
+        case HOOK_TYPE_HSIGNAL:
+            return HOOK_HSIGNAL(hook, signal);
+        case HOOK_TYPE_CONFIG:
+            return HOOK_CONFIG(hook, option);
+        case HOOK_TYPE_MODIFIER:
+            return HOOK_MODIFIER(hook, modifier);
+        default:
+            break;
     }
+
+    return NULL;
 }
 
 /*
- * Checks if a hook pointer is valid.
+ * Checks if a mask has only ASCII chars.
  *
  * Returns:
- *   1: hook exists
- *   0: hook does not exist
+ *   1: mask has only ASCII chars
+ *   0: mask has at least one non-ASCII char
  */
 
 int
-hook_valid (struct t_hook *hook)
+hook_index_mask_is_ascii (const char *mask)
 {
-    int type;
-    struct t_hook *ptr_hook;
+    while (mask[0])
+    {
+        if ((unsigned char)mask[0] >= 128)
+            return 0;
+        mask++;
+    }
+    return 1;
+}
 
-    if (!hook)
+/*
+ * Checks if a name matches the mask of a hook.
+ *
+ * Returns:
+ *   1: name matches mask
+ *   0: name does not match mask
+ */
+
+int
+hook_index_match (struct t_hook *hook, const char *name)
+{
+    const char *mask;
+
+    mask = hook_index_get_mask (hook);
+    if (!mask)
         return 0;
 
-    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    if (string_match (name, mask, 0))
+        return 1;
+
+    /* for command_run, "/away" matches "/away -all" */
+    if ((hook->type == HOOK_TYPE_COMMAND_RUN) && !strchr (mask, ' '))
     {
-        for (ptr_hook = weechat_hooks[type]; ptr_hook;
-             ptr_hook = ptr_hook->next_hook)
-        {
-            if (!ptr_hook->deleted && (ptr_hook == hook))
-                return 1;
-        }
+        return (string_strncasecmp (name, mask,
+                                    utf8_strlen (mask)) == 0) ? 1 : 0;
     }
 
-    /* hook not found */
     return 0;
 }
 
 /*
- * Starts a hook exec.
+ * Gets list of hooks where a mask is stored in the index.
+ *
+ * Argument "key" must have a size of (HOOK_INDEX_MAX_AFFIX + 1) bytes, it is
+ * set with the key used in hashtable (if "*hashtable" is not NULL).
+ *
+ * Argument "affix_count" is set with pointer to the counter of prefix or
+ * suffix length (NULL if mask has no prefix/suffix).
  */
 
 void
-hook_exec_start ()
+hook_index_get_location (struct t_hook_index *index, const char *mask,
+                         char *key, struct t_hashtable **hashtable,
+                         int **affix_count)
 {
-    hook_exec_recursion++;
-}
+    const char *pos_first, *pos_last;
+    int length;
 
-/*
- * Ends a hook_exec.
- */
+    *hashtable = NULL;
+    *affix_count = NULL;
+    key[0] = '\0';
 
-void
-hook_exec_end ()
-{
+    pos_first = (index->wildcards) ? strchr (mask, '*') : NULL;
+    if (!pos_first)
+    {
+        if (index->prefix_match && !strchr (mask, ' '))
+        {
+            /*
+             * the mask is a prefix of names: it is stored like a mask with
+             * "*" at the end (if it has only ASCII chars, because the length
+             * of prefix is counted in chars)
+             */
+            length = strlen (mask);
+            if ((length == 0) || !hook_index_mask_is_ascii (mask))
+                return;
+            if (length > HOOK_INDEX_MAX_AFFIX)
+                length = HOOK_INDEX_MAX_AFFIX;
+            memcpy (key, mask, length);
+            key[length] = '\0';
+            *hashtable = index->prefixes;
+            *affix_count = &(index->prefixes_count[length]);
+            return;
+        }
+        *hashtable = index->names;
+        return;
+    }
+
+    length = pos_first - mask;
+    if (length > 0)
+    {
+        if (length > HOOK_INDEX_MAX_AFFIX)
+            length = HOOK_INDEX_MAX_AFFIX;
+        memcpy (key, mask, length);
+        key[length] = '\0';
+        *hashtable = index->prefixes;
+        *affix_count = &(index->prefixes_count[length]);
+        return;
+    }
+
+    pos_last = strrchr (mask, '*');
+    length = strlen (pos_last + 1);
+    if (length > 0)
+    {
+        if (length > HOOK_INDEX_MAX_AFFIX)
+            length = HOOK_INDEX_MAX_AFFIX;
+        memcpy (key, pos_last + 1 + strlen (pos_last + 1) - length, length);
+        key[length] = '\0';
+        *hashtable = index->suffixes;
+        *affix_count = &(index->suffixes_count[length]);
+    }
+}
+
+/*
+ * Adds a hook in its index (if the hook type has an index).
+ */
+
+void
+hook_index_add (struct t_hook *hook)
+{
+    struct t_hook_index *index;
+    struct t_hashtable *hashtable;
+    struct t_arraylist *list;
+    const char *mask;
+    char key[HOOK_INDEX_MAX_AFFIX + 1];
+    int *affix_count;
+
+    index = hook_index[hook->type];
+    if (!index)
+        return;
+
+    mask = hook_index_get_mask (hook);
+    if (!mask)
+        return;
+
+    hook_index_get_location (index, mask, key, &hashtable, &affix_count);
+    if (hashtable)
+    {
+        if (hashtable == index->names)
+            list = hashtable_get (hashtable, mask);
+        else
+            list = hashtable_get (hashtable, key);
+        if (!list)
+        {
+            list = arraylist_new (0, 1, 0,
+                                  &hook_index_cmp_cb, NULL,
+                                  NULL, NULL);
+            if (!list)
+                return;
+            hashtable_set (hashtable,
+                           (hashtable == index->names) ? mask : key,
+                           list);
+        }
+    }
+    else
+    {
+        list = index->others;
+    }
+
+    if (arraylist_add (list, hook) < 0)
+        return;
+
+    if (affix_count)
+        (*affix_count)++;
+    index->count++;
+}
+
+/*
+ * Removes a hook from its index (if the hook type has an index).
+ */
+
+void
+hook_index_remove (struct t_hook *hook)
+{
+    struct t_hook_index *index;
+    struct t_hashtable *hashtable;
+    struct t_arraylist *list;
+    const char *mask, *ptr_key;
+    char key[HOOK_INDEX_MAX_AFFIX + 1];
+    int *affix_count, index_list;
+
+    index = hook_index[hook->type];
+    if (!index)
+        return;
+
+    mask = hook_index_get_mask (hook);
+    if (!mask)
+        return;
+
+    hook_index_get_location (index, mask, key, &hashtable, &affix_count);
+    ptr_key = NULL;
+    if (hashtable)
+    {
+        ptr_key = (hashtable == index->names) ? mask : key;
+        list = hashtable_get (hashtable, ptr_key);
+    }
+    else
+    {
+        list = index->others;
+    }
+    if (!list)
+        return;
+
+    if (!arraylist_search (list, hook, &index_list, NULL))
+        return;
+    arraylist_remove (list, index_list);
+
+    if (hashtable && (arraylist_size (list) == 0))
+        hashtable_remove (hashtable, ptr_key);
+
+    if (affix_count)
+        (*affix_count)--;
+    index->count--;
+}
+
+/*
+ * Initializes result of a search in index (the static array is used first).
+ */
+
+void
+hook_index_result_init (struct t_hook_index_result *result)
+{
+    result->hooks = result->hooks_static;
+    result->count = 0;
+    result->size = HOOK_INDEX_RESULT_STATIC;
+}
+
+/*
+ * Adds a hook in result of search in index.
+ */
+
+void
+hook_index_result_add (struct t_hook_index_result *result,
+                       struct t_hook *hook)
+{
+    struct t_hook **new_hooks;
+    int new_size;
+
+    if (result->count >= result->size)
+    {
+        new_size = result->size * 2;
+        if (result->hooks == result->hooks_static)
+        {
+            new_hooks = malloc (new_size * sizeof (*new_hooks));
+            if (!new_hooks)
+                return;
+            memcpy (new_hooks, result->hooks_static,
+                    result->count * sizeof (*new_hooks));
+        }
+        else
+        {
+            new_hooks = realloc (result->hooks,
+                                 new_size * sizeof (*new_hooks));
+            if (!new_hooks)
+                return;
+        }
+        result->hooks = new_hooks;
+        result->size = new_size;
+    }
+
+    result->hooks[result->count] = hook;
+    result->count++;
+}
+
+/*
+ * Adds hooks of a list in result of search in index
+ * (if check_mask == 1, the mask of each hook is checked against name).
+ */
+
+void
+hook_index_result_add_list (struct t_hook_index_result *result,
+                            struct t_arraylist *list,
+                            const char *name, int check_mask)
+{
+    struct t_hook *ptr_hook;
+    int i, size;
+
+    size = arraylist_size (list);
+    for (i = 0; i < size; i++)
+    {
+        ptr_hook = (struct t_hook *)arraylist_get (list, i);
+        if (ptr_hook->deleted)
+            continue;
+        if (check_mask && !hook_index_match (ptr_hook, name))
+            continue;
+        hook_index_result_add (result, ptr_hook);
+    }
+}
+
+/*
+ * Searches hooks matching a name in an index.
+ *
+ * The result must be freed by a call to hook_index_result_free().
+ *
+ * Hooks found are sorted like the list of hooks (priority, then creation
+ * order).
+ */
+
+void
+hook_index_search (struct t_hook_index *index, const char *name,
+                   struct t_hook_index_result *result)
+{
+    struct t_arraylist *list;
+    char key[HOOK_INDEX_MAX_AFFIX + 1];
+    int length, max_length, i, lists;
+
+    hook_index_result_init (result);
+
+    if (!index || !name || (index->count == 0))
+        return;
+
+    lists = 0;
+
+    list = hashtable_get (index->names, name);
+    if (list)
+    {
+        hook_index_result_add_list (result, list, name, 0);
+        lists++;
+    }
+
+    if (!index->wildcards)
+        return;
+
+    length = strlen (name);
+    max_length = (length < HOOK_INDEX_MAX_AFFIX) ?
+        length : HOOK_INDEX_MAX_AFFIX;
+
+    /* masks with prefix, like "nicklist_*" */
+    for (i = 1; i <= max_length; i++)
+    {
+        if (index->prefixes_count[i] > 0)
+        {
+            memcpy (key, name, i);
+            key[i] = '\0';
+            list = hashtable_get (index->prefixes, key);
+            if (list)
+            {
+                hook_index_result_add_list (result, list, name, 1);
+                lists++;
+            }
+        }
+    }
+
+    /* masks with suffix, like "*,irc_in2_privmsg" */
+    for (i = 1; i <= max_length; i++)
+    {
+        if (index->suffixes_count[i] > 0)
+        {
+            memcpy (key, name + length - i, i);
+            key[i] = '\0';
+            list = hashtable_get (index->suffixes, key);
+            if (list)
+            {
+                hook_index_result_add_list (result, list, name, 1);
+                lists++;
+            }
+        }
+    }
+
+    /* other masks, like "*" */
+    if (arraylist_size (index->others) > 0)
+    {
+        hook_index_result_add_list (result, index->others, name, 1);
+        lists++;
+    }
+
+    /* hooks come from many lists: sort them */
+    if ((lists > 1) && (result->count > 1))
+    {
+        qsort (result->hooks, result->count, sizeof (*result->hooks),
+               &hook_index_qsort_cmp_cb);
+    }
+}
+
+/*
+ * Frees result of a search in index.
+ */
+
+void
+hook_index_result_free (struct t_hook_index_result *result)
+{
+    if (result->hooks && (result->hooks != result->hooks_static))
+        free (result->hooks);
+    result->hooks = NULL;
+    result->count = 0;
+    result->size = 0;
+}
+
+/*
+ * Compares two priorities of hooks (highest priority first).
+ */
+
+int
+hook_priority_cmp_cb (void *data, struct t_arraylist *arraylist,
+                      void *pointer1, void *pointer2)
+{
+    int priority1, priority2;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    priority1 = ((struct t_hook_priority *)pointer1)->priority;
+    priority2 = ((struct t_hook_priority *)pointer2)->priority;
+
+    if (priority1 > priority2)
+        return -1;
+    if (priority1 < priority2)
+        return 1;
+    return 0;
+}
+
+/*
+ * Frees a priority of hooks.
+ */
+
+void
+hook_priority_free_cb (void *data, struct t_arraylist *arraylist,
+                       void *pointer)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    free (pointer);
+}
+
+/*
+ * Adds a hook in priorities of hooks (the hook must have been added in list
+ * of hooks).
+ */
+
+void
+hook_priority_add (struct t_hook *hook)
+{
+    struct t_hook_priority priority, *ptr_priority;
+
+    if (!hook_priorities[hook->type])
+        return;
+
+    priority.priority = hook->priority;
+    ptr_priority = arraylist_search (hook_priorities[hook->type], &priority,
+                                     NULL, NULL);
+    if (ptr_priority)
+    {
+        /* hook is after other hooks with same priority: first is unchanged */
+        ptr_priority->count++;
+        return;
+    }
+
+    ptr_priority = malloc (sizeof (*ptr_priority));
+    if (!ptr_priority)
+        return;
+    ptr_priority->priority = hook->priority;
+    ptr_priority->count = 1;
+    ptr_priority->first_hook = hook;
+    if (arraylist_add (hook_priorities[hook->type], ptr_priority) < 0)
+        free (ptr_priority);
+}
+
+/*
+ * Removes a hook from priorities of hooks (the hook must not yet be marked
+ * as deleted).
+ */
+
+void
+hook_priority_remove (struct t_hook *hook)
+{
+    struct t_hook_priority priority, *ptr_priority;
+    struct t_hook *ptr_hook;
+    int index;
+
+    if (!hook_priorities[hook->type])
+        return;
+
+    priority.priority = hook->priority;
+    ptr_priority = arraylist_search (hook_priorities[hook->type], &priority,
+                                     &index, NULL);
+    if (!ptr_priority)
+        return;
+
+    ptr_priority->count--;
+    if (ptr_priority->count <= 0)
+    {
+        arraylist_remove (hook_priorities[hook->type], index);
+        return;
+    }
+
+    if (ptr_priority->first_hook == hook)
+    {
+        /*
+         * hooks not deleted are sorted by priority, so the next hook not
+         * deleted has the same priority
+         */
+        ptr_hook = hook->next_hook;
+        while (ptr_hook && ptr_hook->deleted)
+        {
+            ptr_hook = ptr_hook->next_hook;
+        }
+        ptr_priority->first_hook = ptr_hook;
+    }
+}
+
+/*
+ * Searches for position of hook in list (to keep hooks sorted).
+ *
+ * Hooks are sorted by priority, except commands which are sorted by command
+ * name, and then priority.
+ */
+
+struct t_hook *
+hook_find_pos (struct t_hook *hook)
+{
+    struct t_hook *ptr_hook;
+    struct t_hook_priority priority, *ptr_priority;
+    int rc_cmp, index_insert;
+
+    if (hook->type == HOOK_TYPE_COMMAND)
+    {
+        /* for command hook, sort on command name + priority */
+        for (ptr_hook = weechat_hooks[hook->type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted)
+            {
+                rc_cmp = string_strcasecmp (HOOK_COMMAND(hook, command),
+                                            HOOK_COMMAND(ptr_hook, command));
+                if (rc_cmp < 0)
+                    return ptr_hook;
+                if ((rc_cmp == 0) && (hook->priority > ptr_hook->priority))
+                    return ptr_hook;
+            }
+        }
+    }
+    else if (hook_priorities[hook->type])
+    {
+        /*
+         * for other types, sort on priority: add hook before the first hook
+         * of the highest priority lower than priority of hook
+         */
+        priority.priority = hook->priority;
+        (void) arraylist_search (hook_priorities[hook->type], &priority,
+                                 NULL, &index_insert);
+        ptr_priority = arraylist_get (hook_priorities[hook->type],
+                                      index_insert);
+        if (ptr_priority)
+            return ptr_priority->first_hook;
+    }
+    else
+    {
+        /* for other types, sort on priority */
+        for (ptr_hook = weechat_hooks[hook->type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted && (hook->priority > ptr_hook->priority))
+                return ptr_hook;
+        }
+    }
+
+    /* position not found, add at the end */
+    return NULL;
+}
+
+/*
+ * Adds a hook to list.
+ */
+
+void
+hook_add_to_list (struct t_hook *new_hook)
+{
+    struct t_hook *pos_hook;
+
+    if (weechat_hooks[new_hook->type])
+    {
+        pos_hook = hook_find_pos (new_hook);
+        if (pos_hook)
+        {
+            /* add hook before "pos_hook" */
+            new_hook->prev_hook = pos_hook->prev_hook;
+            new_hook->next_hook = pos_hook;
+            if (pos_hook->prev_hook)
+                (pos_hook->prev_hook)->next_hook = new_hook;
+            else
+                weechat_hooks[new_hook->type] = new_hook;
+            pos_hook->prev_hook = new_hook;
+        }
+        else
+        {
+            /* add hook to end of list */
+            new_hook->prev_hook = last_weechat_hook[new_hook->type];
+            new_hook->next_hook = NULL;
+            last_weechat_hook[new_hook->type]->next_hook = new_hook;
+            last_weechat_hook[new_hook->type] = new_hook;
+        }
+    }
+    else
+    {
+        new_hook->prev_hook = NULL;
+        new_hook->next_hook = NULL;
+        weechat_hooks[new_hook->type] = new_hook;
+        last_weechat_hook[new_hook->type] = new_hook;
+    }
+
+    hooks_count[new_hook->type]++;
+    hooks_count_total++;
+    hooks_changes[new_hook->type]++;
+
+    hook_priority_add (new_hook);
+    hook_index_add (new_hook);
+    if (hook_pointers)
+        hashtable_set (hook_pointers, new_hook, new_hook);
+
+    if (new_hook->type == HOOK_TYPE_FD)
+        hook_fd_realloc_pollfd ();
+}
+
+/*
+ * Removes a hook from list.
+ */
+
+void
+hook_remove_from_list (struct t_hook *hook)
+{
+    struct t_hook *new_hooks;
+    int type;
+
+    type = hook->type;
+
+    if (last_weechat_hook[hook->type] == hook)
+        last_weechat_hook[hook->type] = hook->prev_hook;
+    if (hook->prev_hook)
+    {
+        (hook->prev_hook)->next_hook = hook->next_hook;
+        new_hooks = weechat_hooks[hook->type];
+    }
+    else
+        new_hooks = hook->next_hook;
+
+    if (hook->next_hook)
+        (hook->next_hook)->prev_hook = hook->prev_hook;
+
+    free (hook);
+
+    weechat_hooks[type] = new_hooks;
+
+    hooks_count[type]--;
+    hooks_count_total--;
+
+    if (type == HOOK_TYPE_FD)
+        hook_fd_realloc_pollfd ();
+}
+
+/*
+ * Removes hooks marked as "deleted" from list.
+ */
+
+void
+hook_remove_deleted ()
+{
+    int i;
+
+    if (!hooks_deleted || (arraylist_size (hooks_deleted) == 0))
+        return;
+
+    for (i = 0; i < arraylist_size (hooks_deleted); i++)
+    {
+        hook_remove_from_list (arraylist_get (hooks_deleted, i));
+    }
+    arraylist_clear (hooks_deleted);
+}
+
+/*
+ * Extracts priority and name from a string.
+ *
+ * String can be:
+ *   - a simple name like "test":
+ *       => priority = 1000 (default), name = "test"
+ *   - a priority + "|" + name, like "500|test":
+ *       => priority = 500, name = "test"
+ */
+
+void
+hook_get_priority_and_name (const char *string,
+                            int *priority, const char **name)
+{
+    char *pos, *str_priority, *error;
+    long number;
+
+    if (priority)
+        *priority = HOOK_PRIORITY_DEFAULT;
+    if (name)
+        *name = string;
+
+    pos = strchr (string, '|');
+    if (pos)
+    {
+        str_priority = string_strndup (string, pos - string);
+        if (str_priority)
+        {
+            error = NULL;
+            number = strtol (str_priority, &error, 10);
+            if (error && !error[0])
+            {
+                if (priority)
+                    *priority = number;
+                if (name)
+                    *name = pos + 1;
+            }
+            free (str_priority);
+        }
+    }
+}
+
+/*
+ * Initializes a new hook with default values.
+ */
+
+void
+hook_init_data (struct t_hook *hook, struct t_weechat_plugin *plugin,
+                int type, int priority,
+                const void *callback_pointer, void *callback_data)
+{
+    hook->plugin = plugin;
+    hook->subplugin = NULL;
+    hook->type = type;
+    hook->deleted = 0;
+    hook->running = 0;
+    hook->priority = priority;
+    hook->number = ++hook_last_number;
+    hook->callback_pointer = callback_pointer;
+    hook->callback_data = callback_data;
+    hook->calls = 0;
+    hook->time_total = 0;
+    hook->time_max = 0;
+    hook->budget_exceeded = 0;
+    hook->hook_budget_timer = NULL;
+    hook->hook_data = NULL;
+
+    if (weechat_debug_core >= 2)
+    {
+        gui_chat_printf (NULL,
+                         "debug: adding hook: type=%d (%s), plugin=\"%s\", "
+                         "priority=%d",
+                         hook->type,
+                         hook_type_string[hook->type],
+                         plugin_get_name (hook->plugin),
+                         hook->priority);
+    }
+}
+
+/*
+ * Checks if a hook pointer is valid.
+ *
+ * Returns:
+ *   1: hook exists
+ *   0: hook does not exist
+ */
+
+int
+hook_valid (struct t_hook *hook)
+{
+    int type;
+    struct t_hook *ptr_hook;
+
+    if (!hook)
+        return 0;
+
+    if (hook_pointers)
+        return hashtable_has_key (hook_pointers, hook);
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted && (ptr_hook == hook))
+                return 1;
+        }
+    }
+
+    /* hook not found */
+    return 0;
+}
+
+/*
+ * Starts a hook exec.
+ */
+
+void
+hook_exec_start ()
+{
+    hook_exec_recursion++;
+}
+
+/*
+ * Ends a hook_exec.
+ */
+
+void
+hook_exec_end ()
+{
     if (hook_exec_recursion > 0)
         hook_exec_recursion--;
 
@@ -485,6 +1321,257 @@ hook_exec_end ()
         hook_remove_deleted ();
 }
 
+/*
+ * Starts the call of a hook callback: saves current time (used to compute
+ * the time spent in the callback).
+ */
+
+void
+hook_callback_start (struct t_hook *hook, struct timeval *time_start)
+{
+    TRACE3(hook_exec_start, hook_type_string[hook->type],
+           plugin_get_name (hook->plugin), hook);
+
+    profile_hook_start (hook);
+
+    gettimeofday (time_start, NULL);
+}
+
+/*
+ * Callback for timer scheduled when a callback of a script has exceeded the
+ * budget (option weechat.plugin.script_callback_budget): displays a warning
+ * or removes the hook (this is not done in the callback itself because the
+ * hook is still used by the caller).
+ *
+ * The timer is removed when the hook is removed, so the hook is always valid
+ * in this callback.
+ */
+
+int
+hook_callback_budget_timer_cb (const void *pointer, void *data,
+                               int remaining_calls)
+{
+    struct t_hook *hook;
+    char description[512];
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    hook = (struct t_hook *)pointer;
+
+    /* the timer is called once, then removed */
+    hook->hook_budget_timer = NULL;
+
+    if (hook->deleted || (hook->budget_exceeded == 0))
+        return WEECHAT_RC_OK;
+
+    hook_get_description (hook, description, sizeof (description));
+
+    if (CONFIG_INTEGER(config_plugin_script_callback_budget_action) ==
+        CONFIG_PLUGIN_SCRIPT_CALLBACK_BUDGET_ACTION_UNHOOK)
+    {
+        gui_chat_printf (NULL,
+                         _("%sScript %s/%s: callback took %.3fms (budget: "
+                           "%dms), hook %s removed: %s"),
+                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                         plugin_get_name (hook->plugin),
+                         hook->subplugin,
+                         ((float)hook->time_max) / 1000,
+                         CONFIG_INTEGER(config_plugin_script_callback_budget),
+                         hook_type_string[hook->type],
+                         description);
+        unhook (hook);
+    }
+    else
+    {
+        gui_chat_printf (NULL,
+                         _("%sScript %s/%s: callback took %.3fms (budget: "
+                           "%dms), hook %s: %s (see /script stats)"),
+                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                         plugin_get_name (hook->plugin),
+                         hook->subplugin,
+                         ((float)hook->time_max) / 1000,
+                         CONFIG_INTEGER(config_plugin_script_callback_budget),
+                         hook_type_string[hook->type],
+                         description);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Ends the call of a hook callback: updates statistics of hook and logs
+ * the call if it took more time than option weechat.plugin.slow_callback.
+ */
+
+void
+hook_callback_end (struct t_hook *hook, struct timeval *time_start)
+{
+    struct timeval time_end;
+    long long diff;
+    char description[512];
+
+    gettimeofday (&time_end, NULL);
+    diff = util_timeval_diff (time_start, &time_end);
+    if (diff < 0)
+        diff = 0;
+
+    hook->calls++;
+    hook->time_total += diff;
+    if (diff > hook->time_max)
+        hook->time_max = diff;
+
+    metrics_hook_calls[hook->type]++;
+    metrics_hook_time[hook->type] += diff;
+
+    if (config_plugin_slow_callback
+        && (CONFIG_INTEGER(config_plugin_slow_callback) > 0)
+        && (diff >= (long long)CONFIG_INTEGER(config_plugin_slow_callback) * 1000))
+    {
+        hook_get_description (hook, description, sizeof (description));
+        log_printf ("slow callback: %.3fms, hook %s (plugin: %s%s%s): %s",
+                    ((float)diff) / 1000,
+                    hook_type_string[hook->type],
+                    plugin_get_name (hook->plugin),
+                    (hook->subplugin) ? "/" : "",
+                    (hook->subplugin) ? hook->subplugin : "",
+                    description);
+    }
+
+    /* soft budget for callbacks of scripts */
+    if (hook->subplugin
+        && config_plugin_script_callback_budget
+        && (CONFIG_INTEGER(config_plugin_script_callback_budget) > 0)
+        && (diff >= (long long)CONFIG_INTEGER(config_plugin_script_callback_budget) * 1000))
+    {
+        hook->budget_exceeded++;
+        if (!hook->hook_budget_timer
+            && ((hook->budget_exceeded == 1)
+                || (CONFIG_INTEGER(config_plugin_script_callback_budget_action) ==
+                    CONFIG_PLUGIN_SCRIPT_CALLBACK_BUDGET_ACTION_UNHOOK)))
+        {
+            hook->hook_budget_timer = hook_timer (
+                NULL, 1, 0, 1, &hook_callback_budget_timer_cb, hook, NULL);
+        }
+    }
+
+    profile_hook_end ();
+
+    TRACE3(hook_exec_end, hook_type_string[hook->type],
+           plugin_get_name (hook->plugin), diff);
+}
+
+/*
+ * Builds a short description of a hook (for example the command name, the
+ * signal, ...), used to display statistics on hook callbacks.
+ */
+
+void
+hook_get_description (struct t_hook *hook, char *description, int size)
+{
+    if (!description || (size <= 0))
+        return;
+
+    description[0] = '\0';
+
+    if (!hook || !hook->hook_data)
+        return;
+
+    switch (hook->type)
+    {
+        case HOOK_TYPE_COMMAND:
+            snprintf (description, size, "/%s", HOOK_COMMAND(hook, command));
+            break;
+        case HOOK_TYPE_COMMAND_RUN:
+            snprintf (description, size, "%s", HOOK_COMMAND_RUN(hook, command));
+            break;
+        case HOOK_TYPE_TIMER:
+            snprintf (description, size, "%ldms",
+                      HOOK_TIMER(hook, interval));
+            break;
+        case HOOK_TYPE_FD:
+            snprintf (description, size, "fd %d", HOOK_FD(hook, fd));
+            break;
+        case HOOK_TYPE_PROCESS:
+            snprintf (description, size, "%s", HOOK_PROCESS(hook, command));
+            break;
+        case HOOK_TYPE_CONNECT:
+            snprintf (description, size, "%s/%d",
+                      HOOK_CONNECT(hook, address), HOOK_CONNECT(hook, port));
+            break;
+        case HOOK_TYPE_PRINT:
+            snprintf (description, size, "%s",
+                      (HOOK_PRINT(hook, buffer)) ?
+                      HOOK_PRINT(hook, buffer)->full_name : "*");
+            break;
+        case HOOK_TYPE_SIGNAL:
+            snprintf (description, size, "%s", HOOK_SIGNAL(hook, signal));
+            break;
+        case HOOK_TYPE_HSIGNAL:
+            snprintf (description, size, "%s", HOOK_HSIGNAL(hook, signal));
+            break;
+        case HOOK_TYPE_CONFIG:
+            snprintf (description, size, "%s",
+                      (HOOK_CONFIG(hook, option)) ?
+                      HOOK_CONFIG(hook, option) : "*");
+            break;
+        case HOOK_TYPE_COMPLETION:
+            snprintf (description, size, "%s",
+                      HOOK_COMPLETION(hook, completion_item));
+            break;
+        case HOOK_TYPE_MODIFIER:
+            snprintf (description, size, "%s", HOOK_MODIFIER(hook, modifier));
+            break;
+        case HOOK_TYPE_INFO:
+            snprintf (description, size, "%s", HOOK_INFO(hook, info_name));
+            break;
+        case HOOK_TYPE_INFO_HASHTABLE:
+            snprintf (description, size, "%s",
+                      HOOK_INFO_HASHTABLE(hook, info_name));
+            break;
+        case HOOK_TYPE_INFOLIST:
+            snprintf (description, size, "%s",
+                      HOOK_INFOLIST(hook, infolist_name));
+            break;
+        case HOOK_TYPE_HDATA:
+            snprintf (description, size, "%s", HOOK_HDATA(hook, hdata_name));
+            break;
+        case HOOK_TYPE_FOCUS:
+            snprintf (description, size, "%s", HOOK_FOCUS(hook, area));
+            break;
+        case HOOK_NUM_TYPES:
+            /*
+             * this constant is used to count types only,
+             * it is never used as type
+             */
+            break;
+    }
+}
+
+/*
+ * Resets statistics on callbacks of all hooks.
+ */
+
+void
+hook_stats_reset ()
+{
+    struct t_hook *ptr_hook;
+    int type;
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            ptr_hook->calls = 0;
+            ptr_hook->time_total = 0;
+            ptr_hook->time_max = 0;
+            ptr_hook->budget_exceeded = 0;
+        }
+    }
+}
+
 /*
  * Searches for a command hook in list.
  *
@@ -495,18 +1582,28 @@ struct t_hook *
 hook_search_command (struct t_weechat_plugin *plugin, const char *command)
 {
     struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
+    int i;
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    if (!command)
+        return NULL;
+
+    hook_index_search (hook_index[HOOK_TYPE_COMMAND], command, &hooks_found);
+
+    ptr_hook = NULL;
+    for (i = 0; i < hooks_found.count; i++)
     {
-        if (!ptr_hook->deleted
-            && (ptr_hook->plugin == plugin)
-            && (string_strcasecmp (HOOK_COMMAND(ptr_hook, command), command) == 0))
-            return ptr_hook;
+        if (!hooks_found.hooks[i]->deleted
+            && (hooks_found.hooks[i]->plugin == plugin))
+        {
+            ptr_hook = hooks_found.hooks[i];
+            break;
+        }
     }
 
-    /* command hook not found for plugin */
-    return NULL;
+    hook_index_result_free (&hooks_found);
+
+    return ptr_hook;
 }
 
 /*
@@ -574,6 +1671,10 @@ hook_command_build_completion (struct t_hook_command *hook_command)
     /* for each template, split/count args */
     hook_command->cplt_templates_static = malloc (hook_command->cplt_num_templates *
                                                   sizeof (*hook_command->cplt_templates_static));
+    hook_command->cplt_templates_static_num_items = malloc (hook_command->cplt_num_templates *
+                                                            sizeof (*hook_command->cplt_templates_static_num_items));
+    hook_command->cplt_templates_static_items = malloc (hook_command->cplt_num_templates *
+                                                        sizeof (*hook_command->cplt_templates_static_items));
     hook_command->cplt_template_num_args = malloc (hook_command->cplt_num_templates *
                                                    sizeof (*hook_command->cplt_template_num_args));
     hook_command->cplt_template_args = malloc (hook_command->cplt_num_templates *
@@ -617,6 +1718,11 @@ hook_command_build_completion (struct t_hook_command *hook_command)
         else
             hook_command->cplt_templates_static[i] = strdup (hook_command->cplt_templates[i]);
 
+        /* split static part of template (used to find matching template) */
+        hook_command->cplt_templates_static_items[i] = string_split (hook_command->cplt_templates_static[i],
+                                                                     "|", 0, 0,
+                                                                     &(hook_command->cplt_templates_static_num_items[i]));
+
         /* build arguments for each template */
         hook_command->cplt_template_args[i] = string_split (hook_command->cplt_templates[i],
                                                             " ", 0, 0,
@@ -742,6 +1848,8 @@ hook_command (struct t_weechat_plugin *plugin, const char *command,
     new_hook_command->cplt_num_templates = 0;
     new_hook_command->cplt_templates = NULL;
     new_hook_command->cplt_templates_static = NULL;
+    new_hook_command->cplt_templates_static_num_items = NULL;
+    new_hook_command->cplt_templates_static_items = NULL;
     new_hook_command->cplt_template_num_args = NULL;
     new_hook_command->cplt_template_args = NULL;
     new_hook_command->cplt_template_num_args_concat = 0;
@@ -771,12 +1879,14 @@ int
 hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
                    struct t_weechat_plugin *plugin, const char *string)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
     struct t_hook *hook_plugin, *hook_other_plugin, *hook_other_plugin2;
     struct t_hook *hook_incomplete_command;
+    struct t_hook_index_result hooks_found;
     char **argv, **argv_eol;
     const char *ptr_command_name;
-    int argc, rc, length_command_name, allow_incomplete_commands;
+    int argc, rc, length_command_name, i;
     int count_other_plugin, count_incomplete_commands;
 
     if (!buffer || !string || !string[0])
@@ -785,13 +1895,12 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
     if (hook_command_run_exec (buffer, string) == WEECHAT_RC_OK_EAT)
         return HOOK_COMMAND_EXEC_OK;
 
-    argv = string_split (string, " ", 0, 0, &argc);
+    argv = string_split_argv (string, " ", 1, 0, &argc, &argv_eol);
     if (argc == 0)
     {
-        string_free_split (argv);
+        string_free_split_argv (argv);
         return HOOK_COMMAND_EXEC_NOT_FOUND;
     }
-    argv_eol = string_split (string, " ", 1, 0, NULL);
 
     ptr_command_name = utf8_next_char (argv[0]);
     length_command_name = strlen (ptr_command_name);
@@ -803,46 +1912,53 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
     hook_other_plugin2 = NULL;
     hook_incomplete_command = NULL;
     count_other_plugin = 0;
-    allow_incomplete_commands = CONFIG_BOOLEAN(config_look_command_incomplete);
     count_incomplete_commands = 0;
-    ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND];
-    while (ptr_hook)
+
+    /*
+     * search commands with this exact name (sorted by priority, so the first
+     * hook found for a plugin is the one with the highest priority)
+     */
+    hook_index_search (hook_index[HOOK_TYPE_COMMAND], ptr_command_name,
+                       &hooks_found);
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
+        if (ptr_hook->deleted)
+            continue;
+        if (ptr_hook->plugin == plugin)
+        {
+            if (!hook_plugin)
+                hook_plugin = ptr_hook;
+        }
+        else if (any_plugin)
+        {
+            if (!hook_other_plugin)
+                hook_other_plugin = ptr_hook;
+            else if (!hook_other_plugin2)
+                hook_other_plugin2 = ptr_hook;
+            count_other_plugin++;
+        }
+    }
+    hook_index_result_free (&hooks_found);
 
-        if (!ptr_hook->deleted)
+    /* command not found: search incomplete commands (if allowed) */
+    if (!hook_plugin && !hook_other_plugin
+        && CONFIG_BOOLEAN(config_look_command_incomplete))
+    {
+        for (ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
         {
-            if (string_strcasecmp (ptr_command_name,
-                                   HOOK_COMMAND(ptr_hook, command)) == 0)
-            {
-                if (ptr_hook->plugin == plugin)
-                {
-                    if (!hook_plugin)
-                        hook_plugin = ptr_hook;
-                }
-                else
-                {
-                    if (any_plugin)
-                    {
-                        if (!hook_other_plugin)
-                            hook_other_plugin = ptr_hook;
-                        else if (!hook_other_plugin2)
-                            hook_other_plugin2 = ptr_hook;
-                        count_other_plugin++;
-                    }
-                }
-            }
-            else if (allow_incomplete_commands
-                     && (string_strncasecmp (ptr_command_name,
-                                             HOOK_COMMAND(ptr_hook, command),
-                                             length_command_name) == 0))
+            if (!ptr_hook->deleted
+                && (string_strncasecmp (ptr_command_name,
+                                        HOOK_COMMAND(ptr_hook, command),
+                                        length_command_name) == 0)
+                && (string_strcasecmp (ptr_command_name,
+                                       HOOK_COMMAND(ptr_hook, command)) != 0))
             {
                 hook_incomplete_command = ptr_hook;
                 count_incomplete_commands++;
             }
         }
-
-        ptr_hook = next_hook;
     }
 
     rc = HOOK_COMMAND_EXEC_NOT_FOUND;
@@ -903,6 +2019,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
         {
             /* execute the command! */
             ptr_hook->running++;
+            hook_callback_start (ptr_hook, &time_start);
             rc = (int) (HOOK_COMMAND(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
@@ -910,6 +2027,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
                  argc,
                  argv,
                  argv_eol);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running--;
             if (rc == WEECHAT_RC_ERROR)
                 rc = HOOK_COMMAND_EXEC_ERROR;
@@ -918,8 +2036,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
         }
     }
 
-    string_free_split (argv);
-    string_free_split (argv_eol);
+    string_free_split_argv (argv);
 
     hook_exec_end ();
 
@@ -978,8 +2095,10 @@ hook_command_run (struct t_weechat_plugin *plugin,
 int
 hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    int rc, hook_matching, length;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
+    int i, rc, length;
     char *command2;
     const char *ptr_command;
 
@@ -997,52 +2116,36 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
         }
     }
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND_RUN];
-    while (ptr_hook)
+    hook_index_search (hook_index[HOOK_TYPE_COMMAND_RUN], ptr_command,
+                       &hooks_found);
+
+    rc = WEECHAT_RC_OK;
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && HOOK_COMMAND_RUN(ptr_hook, command))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
-            hook_matching = string_match (ptr_command,
-                                          HOOK_COMMAND_RUN(ptr_hook, command),
-                                          0);
-
-            if (!hook_matching
-                && !strchr (HOOK_COMMAND_RUN(ptr_hook, command), ' '))
-            {
-                hook_matching = (string_strncasecmp (ptr_command,
-                                                     HOOK_COMMAND_RUN(ptr_hook, command),
-                                                     utf8_strlen (HOOK_COMMAND_RUN(ptr_hook, command))) == 0);
-            }
-
-            if (hook_matching)
-            {
-                ptr_hook->running = 1;
-                rc = (HOOK_COMMAND_RUN(ptr_hook, callback)) (
-                    ptr_hook->callback_pointer,
-                    ptr_hook->callback_data,
-                    buffer,
-                    ptr_command);
-                ptr_hook->running = 0;
-                if (rc == WEECHAT_RC_OK_EAT)
-                {
-                    if (command2)
-                        free (command2);
-                    return rc;
-                }
-            }
+            ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
+            rc = (HOOK_COMMAND_RUN(ptr_hook, callback)) (
+                ptr_hook->callback_pointer,
+                ptr_hook->callback_data,
+                buffer,
+                ptr_command);
+            hook_callback_end (ptr_hook, &time_start);
+            ptr_hook->running = 0;
+            if (rc == WEECHAT_RC_OK_EAT)
+                break;
         }
-
-        ptr_hook = next_hook;
     }
 
+    hook_index_result_free (&hooks_found);
+
     if (command2)
         free (command2);
 
-    return WEECHAT_RC_OK;
+    return (rc == WEECHAT_RC_OK_EAT) ? rc : WEECHAT_RC_OK;
 }
 
 /*
@@ -1101,6 +2204,178 @@ hook_timer_init (struct t_hook *hook)
                       ((long long)HOOK_TIMER(hook, interval)) * 1000);
 }
 
+/*
+ * Compares two timers in heap: by date of next execution, then by creation
+ * order.
+ *
+ * Returns:
+ *   < 0: timer1 must be executed before timer2
+ *     0: timer1 == timer2
+ *   > 0: timer1 must be executed after timer2
+ */
+
+int
+hook_timer_heap_cmp (struct t_hook *hook1, struct t_hook *hook2)
+{
+    int rc;
+
+    rc = util_timeval_cmp (&HOOK_TIMER(hook1, next_exec),
+                           &HOOK_TIMER(hook2, next_exec));
+    if (rc != 0)
+        return rc;
+
+    if (hook1->number != hook2->number)
+        return (hook1->number < hook2->number) ? -1 : 1;
+
+    return 0;
+}
+
+/*
+ * Sets a timer at a position in heap.
+ */
+
+void
+hook_timer_heap_set (int position, struct t_hook *hook)
+{
+    hook_timer_heap[position] = hook;
+    HOOK_TIMER(hook, heap_index) = position;
+}
+
+/*
+ * Moves a timer up in heap, until its parent is executed before it.
+ */
+
+void
+hook_timer_heap_sift_up (int position)
+{
+    struct t_hook *ptr_hook;
+    int parent;
+
+    ptr_hook = hook_timer_heap[position];
+    while (position > 0)
+    {
+        parent = (position - 1) / 2;
+        if (hook_timer_heap_cmp (hook_timer_heap[parent], ptr_hook) <= 0)
+            break;
+        hook_timer_heap_set (position, hook_timer_heap[parent]);
+        position = parent;
+    }
+    hook_timer_heap_set (position, ptr_hook);
+}
+
+/*
+ * Moves a timer down in heap, until its children are executed after it.
+ */
+
+void
+hook_timer_heap_sift_down (int position)
+{
+    struct t_hook *ptr_hook;
+    int child;
+
+    ptr_hook = hook_timer_heap[position];
+    while (1)
+    {
+        child = (position * 2) + 1;
+        if (child >= hook_timer_heap_count)
+            break;
+        if ((child + 1 < hook_timer_heap_count)
+            && (hook_timer_heap_cmp (hook_timer_heap[child + 1],
+                                     hook_timer_heap[child]) < 0))
+        {
+            child++;
+        }
+        if (hook_timer_heap_cmp (ptr_hook, hook_timer_heap[child]) <= 0)
+            break;
+        hook_timer_heap_set (position, hook_timer_heap[child]);
+        position = child;
+    }
+    hook_timer_heap_set (position, ptr_hook);
+}
+
+/*
+ * Adds a timer in heap.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+hook_timer_heap_add (struct t_hook *hook)
+{
+    struct t_hook **new_heap;
+    int new_size;
+
+    if (HOOK_TIMER(hook, heap_index) >= 0)
+        return 1;
+
+    if (hook_timer_heap_count >= hook_timer_heap_size)
+    {
+        new_size = (hook_timer_heap_size > 0) ? hook_timer_heap_size * 2 : 32;
+        new_heap = realloc (hook_timer_heap,
+                            new_size * sizeof (hook_timer_heap[0]));
+        if (!new_heap)
+            return 0;
+        hook_timer_heap = new_heap;
+        hook_timer_heap_size = new_size;
+    }
+
+    hook_timer_heap_count++;
+    hook_timer_heap_set (hook_timer_heap_count - 1, hook);
+    hook_timer_heap_sift_up (hook_timer_heap_count - 1);
+
+    return 1;
+}
+
+/*
+ * Removes a timer from heap.
+ */
+
+void
+hook_timer_heap_remove (struct t_hook *hook)
+{
+    int position;
+
+    position = HOOK_TIMER(hook, heap_index);
+    if ((position < 0) || (position >= hook_timer_heap_count))
+        return;
+
+    HOOK_TIMER(hook, heap_index) = -1;
+    hook_timer_heap_count--;
+
+    if (position == hook_timer_heap_count)
+        return;
+
+    /* move last timer at the position of removed timer */
+    hook_timer_heap_set (position, hook_timer_heap[hook_timer_heap_count]);
+    if ((position > 0)
+        && (hook_timer_heap_cmp (hook_timer_heap[position],
+                                 hook_timer_heap[(position - 1) / 2]) < 0))
+    {
+        hook_timer_heap_sift_up (position);
+    }
+    else
+    {
+        hook_timer_heap_sift_down (position);
+    }
+}
+
+/*
+ * Rebuilds the heap of timers (after next_exec of many timers has changed).
+ */
+
+void
+hook_timer_heap_rebuild ()
+{
+    int i;
+
+    for (i = (hook_timer_heap_count / 2) - 1; i >= 0; i--)
+    {
+        hook_timer_heap_sift_down (i);
+    }
+}
+
 /*
  * Hooks a timer.
  *
@@ -1137,9 +2412,17 @@ hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
     new_hook_timer->interval = interval;
     new_hook_timer->align_second = align_second;
     new_hook_timer->remaining_calls = max_calls;
+    new_hook_timer->heap_index = -1;
 
     hook_timer_init (new_hook);
 
+    if (!hook_timer_heap_add (new_hook))
+    {
+        free (new_hook_timer);
+        free (new_hook);
+        return NULL;
+    }
+
     hook_add_to_list (new_hook);
 
     return new_hook;
@@ -1182,6 +2465,7 @@ hook_timer_check_system_clock ()
             if (!ptr_hook->deleted)
                 hook_timer_init (ptr_hook);
         }
+        hook_timer_heap_rebuild ();
     }
 
     hook_last_system_time = now;
@@ -1194,29 +2478,18 @@ hook_timer_check_system_clock ()
 int
 hook_timer_get_time_to_next ()
 {
-    struct t_hook *ptr_hook;
     int found, timeout;
     struct timeval tv_now, tv_timeout;
     long diff_usec;
 
     hook_timer_check_system_clock ();
 
-    found = 0;
-    tv_timeout.tv_sec = 0;
-    tv_timeout.tv_usec = 0;
-
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    /* the first timer in heap is the next one to execute */
+    found = (hook_timer_heap_count > 0);
+    if (found)
     {
-        if (!ptr_hook->deleted
-            && (!found
-                || (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                      &tv_timeout) < 0)))
-        {
-            found = 1;
-            tv_timeout.tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-            tv_timeout.tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
-        }
+        tv_timeout.tv_sec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_sec;
+        tv_timeout.tv_usec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_usec;
     }
 
     /* no timeout found, return 2 seconds by default */
@@ -1259,89 +2532,372 @@ hook_timer_get_time_to_next ()
         tv_timeout.tv_usec = 0;
     }
 
-end:
-    /* return a number of milliseconds */
-    timeout = (tv_timeout.tv_sec * 1000) + (tv_timeout.tv_usec / 1000);
-    return (timeout < 1) ? 1 : timeout;
+end:
+    /* return a number of milliseconds */
+    timeout = (tv_timeout.tv_sec * 1000) + (tv_timeout.tv_usec / 1000);
+    return (timeout < 1) ? 1 : timeout;
+}
+
+/*
+ * Executes timer hooks.
+ */
+
+void
+hook_timer_exec ()
+{
+    struct timeval tv_time, time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result timers;
+    int i, count;
+
+    hook_timer_check_system_clock ();
+
+    gettimeofday (&tv_time, NULL);
+
+    hook_exec_start ();
+
+    /*
+     * remove expired timers from heap before running callbacks, so that each
+     * timer is executed only once, even if its next execution is still in
+     * the past (it is added again in heap after execution)
+     */
+    hook_index_result_init (&timers);
+    while ((hook_timer_heap_count > 0)
+           && (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                                 &tv_time) <= 0))
+    {
+        ptr_hook = hook_timer_heap[0];
+        count = timers.count;
+        hook_index_result_add (&timers, ptr_hook);
+        if (timers.count == count)
+            break;
+        hook_timer_heap_remove (ptr_hook);
+    }
+
+    for (i = 0; i < timers.count; i++)
+    {
+        ptr_hook = timers.hooks[i];
+
+        if (ptr_hook->deleted)
+            continue;
+
+        if (!ptr_hook->running)
+        {
+            ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
+            (void) (HOOK_TIMER(ptr_hook, callback))
+                (ptr_hook->callback_pointer,
+                 ptr_hook->callback_data,
+                 (HOOK_TIMER(ptr_hook, remaining_calls) > 0) ?
+                  HOOK_TIMER(ptr_hook, remaining_calls) - 1 : -1);
+            hook_callback_end (ptr_hook, &time_start);
+            ptr_hook->running = 0;
+            if (ptr_hook->deleted)
+                continue;
+
+            HOOK_TIMER(ptr_hook, last_exec).tv_sec = tv_time.tv_sec;
+            HOOK_TIMER(ptr_hook, last_exec).tv_usec = tv_time.tv_usec;
+
+            util_timeval_add (
+                &HOOK_TIMER(ptr_hook, next_exec),
+                ((long long)HOOK_TIMER(ptr_hook, interval)) * 1000);
+
+            if (HOOK_TIMER(ptr_hook, remaining_calls) > 0)
+            {
+                HOOK_TIMER(ptr_hook, remaining_calls)--;
+                if (HOOK_TIMER(ptr_hook, remaining_calls) == 0)
+                {
+                    unhook (ptr_hook);
+                    continue;
+                }
+            }
+        }
+
+        hook_timer_heap_add (ptr_hook);
+    }
+
+    hook_index_result_free (&timers);
+
+    hook_exec_end ();
+}
+
+/*
+ * Initializes the epoll/kqueue descriptor used to watch fd hooks.
+ *
+ * If epoll/kqueue is not available (or if it fails), poll() is used for all
+ * file descriptors.
+ */
+
+void
+hook_fd_backend_init ()
+{
+#if defined(HOOK_FD_EPOLL)
+#ifdef EPOLL_CLOEXEC
+    hook_fd_backend = epoll_create1 (EPOLL_CLOEXEC);
+#else
+    hook_fd_backend = epoll_create (64);
+    if (hook_fd_backend >= 0)
+        fcntl (hook_fd_backend, F_SETFD, FD_CLOEXEC);
+#endif /* EPOLL_CLOEXEC */
+#elif defined(HOOK_FD_KQUEUE)
+    hook_fd_backend = kqueue ();
+    if (hook_fd_backend >= 0)
+        fcntl (hook_fd_backend, F_SETFD, FD_CLOEXEC);
+#else
+    hook_fd_backend = -1;
+#endif
+}
+
+/*
+ * Reallocates the array of events returned by epoll/kqueue.
+ *
+ * The array is never shrunk: it can hold at least one event for each fd
+ * hook (two with kqueue: read + write).
+ */
+
+void
+hook_fd_realloc_events ()
+{
+#if defined(HOOK_FD_EPOLL) || defined(HOOK_FD_KQUEUE)
+    void *ptr_events;
+    int size;
+
+    size = hooks_count[HOOK_TYPE_FD];
+#ifdef HOOK_FD_KQUEUE
+    size *= 2;
+#endif /* HOOK_FD_KQUEUE */
+    if (size < 16)
+        size = 16;
+
+    if (size <= hook_fd_events_size)
+        return;
+
+    ptr_events = realloc (hook_fd_events, size * sizeof (hook_fd_events[0]));
+    if (!ptr_events)
+        return;
+    hook_fd_events = ptr_events;
+    hook_fd_events_size = size;
+#endif /* defined(HOOK_FD_EPOLL) || defined(HOOK_FD_KQUEUE) */
+}
+
+/*
+ * Sets the hook for a file descriptor in the table of fd hooks
+ * (hook can be NULL to remove the fd from table).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (table can not be extended)
+ */
+
+int
+hook_fd_table_set (int fd, struct t_hook *hook)
+{
+    struct t_hook **ptr_table;
+    int i, new_size;
+
+    if (fd < 0)
+        return 0;
+
+    if (fd >= hook_fd_table_size)
+    {
+        if (!hook)
+            return 1;
+        new_size = (hook_fd_table_size > 0) ? hook_fd_table_size : 64;
+        while (new_size <= fd)
+        {
+            new_size *= 2;
+        }
+        ptr_table = realloc (hook_fd_table, new_size * sizeof (*ptr_table));
+        if (!ptr_table)
+            return 0;
+        for (i = hook_fd_table_size; i < new_size; i++)
+        {
+            ptr_table[i] = NULL;
+        }
+        hook_fd_table = ptr_table;
+        hook_fd_table_size = new_size;
+    }
+
+    hook_fd_table[fd] = hook;
+
+    return 1;
 }
 
 /*
- * Executes timer hooks.
+ * Searches for a fd hook in list.
+ *
+ * Returns pointer to hook found, NULL if not found.
+ */
+
+struct t_hook *
+hook_search_fd (int fd)
+{
+    if ((fd < 0) || (fd >= hook_fd_table_size))
+        return NULL;
+
+    return hook_fd_table[fd];
+}
+
+/*
+ * Registers (or updates) a fd hook in epoll/kqueue.
+ *
+ * If the file descriptor can not be watched by epoll/kqueue (for example a
+ * regular file with epoll), it will be checked with poll().
  */
 
 void
-hook_timer_exec ()
+hook_fd_backend_add (struct t_hook *hook, int old_flags)
 {
-    struct timeval tv_time;
-    struct t_hook *ptr_hook, *next_hook;
+#if defined(HOOK_FD_EPOLL)
+    struct epoll_event event;
+    int rc;
+#elif defined(HOOK_FD_KQUEUE)
+    struct kevent changes[2];
+    int num_changes, i;
+#endif
 
-    hook_timer_check_system_clock ();
+    if (hook_fd_backend < 0)
+        return;
 
-    gettimeofday (&tv_time, NULL);
+    if (HOOK_FD(hook, poll_only))
+        return;
 
-    hook_exec_start ();
+    /* the fd is watched only for the hook which owns it in table */
+    if (hook_search_fd (HOOK_FD(hook, fd)) != hook)
+        return;
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_TIMER];
-    while (ptr_hook)
+#if defined(HOOK_FD_EPOLL)
+    memset (&event, 0, sizeof (event));
+    event.data.fd = HOOK_FD(hook, fd);
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_READ)
+        event.events |= EPOLLIN;
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_WRITE)
+        event.events |= EPOLLOUT;
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_EXCEPTION)
+        event.events |= EPOLLPRI;
+
+    rc = epoll_ctl (hook_fd_backend,
+                    (old_flags >= 0) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                    HOOK_FD(hook, fd), &event);
+    if ((rc < 0) && (old_flags < 0) && (errno == EEXIST))
     {
-        next_hook = ptr_hook->next_hook;
-
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                  &tv_time) <= 0))
+        /* fd was closed and reused without unhook: update it */
+        rc = epoll_ctl (hook_fd_backend, EPOLL_CTL_MOD, HOOK_FD(hook, fd),
+                        &event);
+    }
+    if (rc < 0)
+    {
+        if (errno == EBADF)
         {
-            ptr_hook->running = 1;
-            (void) (HOOK_TIMER(ptr_hook, callback))
-                (ptr_hook->callback_pointer,
-                 ptr_hook->callback_data,
-                 (HOOK_TIMER(ptr_hook, remaining_calls) > 0) ?
-                  HOOK_TIMER(ptr_hook, remaining_calls) - 1 : -1);
-            ptr_hook->running = 0;
-            if (!ptr_hook->deleted)
+            HOOK_FD(hook, error) = errno;
+            gui_chat_printf (NULL,
+                             _("%sError: bad file descriptor (%d) "
+                               "used in hook_fd"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             HOOK_FD(hook, fd));
+        }
+        else
+        {
+            /* not supported by epoll (regular file, ...): use poll() */
+            HOOK_FD(hook, poll_only) = 1;
+            hook_fd_poll_only_count++;
+        }
+    }
+#elif defined(HOOK_FD_KQUEUE)
+    num_changes = 0;
+    if (old_flags < 0)
+        old_flags = 0;
+    if ((HOOK_FD(hook, flags) ^ old_flags) & HOOK_FD_FLAG_READ)
+    {
+        EV_SET(&changes[num_changes], HOOK_FD(hook, fd), EVFILT_READ,
+               (HOOK_FD(hook, flags) & HOOK_FD_FLAG_READ) ?
+               EV_ADD : EV_DELETE,
+               0, 0, NULL);
+        num_changes++;
+    }
+    if ((HOOK_FD(hook, flags) ^ old_flags) & HOOK_FD_FLAG_WRITE)
+    {
+        EV_SET(&changes[num_changes], HOOK_FD(hook, fd), EVFILT_WRITE,
+               (HOOK_FD(hook, flags) & HOOK_FD_FLAG_WRITE) ?
+               EV_ADD : EV_DELETE,
+               0, 0, NULL);
+        num_changes++;
+    }
+    for (i = 0; i < num_changes; i++)
+    {
+        if ((kevent (hook_fd_backend, &changes[i], 1, NULL, 0, NULL) < 0)
+            && (changes[i].flags & EV_ADD))
+        {
+            if (errno == EBADF)
             {
-                HOOK_TIMER(ptr_hook, last_exec).tv_sec = tv_time.tv_sec;
-                HOOK_TIMER(ptr_hook, last_exec).tv_usec = tv_time.tv_usec;
-
-                util_timeval_add (
-                    &HOOK_TIMER(ptr_hook, next_exec),
-                    ((long long)HOOK_TIMER(ptr_hook, interval)) * 1000);
-
-                if (HOOK_TIMER(ptr_hook, remaining_calls) > 0)
-                {
-                    HOOK_TIMER(ptr_hook, remaining_calls)--;
-                    if (HOOK_TIMER(ptr_hook, remaining_calls) == 0)
-                        unhook (ptr_hook);
-                }
+                HOOK_FD(hook, error) = errno;
+                gui_chat_printf (NULL,
+                                 _("%sError: bad file descriptor (%d) "
+                                   "used in hook_fd"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                                 HOOK_FD(hook, fd));
+            }
+            else
+            {
+                HOOK_FD(hook, poll_only) = 1;
+                hook_fd_poll_only_count++;
             }
+            break;
         }
-
-        ptr_hook = next_hook;
     }
-
-    hook_exec_end ();
+#else
+    (void) old_flags;
+#endif
 }
 
 /*
- * Searches for a fd hook in list.
+ * Unregisters a fd hook from epoll/kqueue.
  *
- * Returns pointer to hook found, NULL if not found.
+ * Nothing is done if the hook does not own the fd in table: the fd may be
+ * watched for another hook (fd closed and reused), which must not be
+ * unregistered. So this function must be called before the hook is removed
+ * from table.
  */
 
-struct t_hook *
-hook_search_fd (int fd)
+void
+hook_fd_backend_remove (struct t_hook *hook)
 {
-    struct t_hook *ptr_hook;
+#if defined(HOOK_FD_EPOLL)
+    struct epoll_event event;
+#elif defined(HOOK_FD_KQUEUE)
+    struct kevent change;
+#endif
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    if (hook_fd_backend < 0)
+        return;
+
+    if (HOOK_FD(hook, poll_only))
     {
-        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, fd) == fd))
-            return ptr_hook;
+        HOOK_FD(hook, poll_only) = 0;
+        hook_fd_poll_only_count--;
+        return;
     }
 
-    /* fd hook not found */
-    return NULL;
+    if (hook_search_fd (HOOK_FD(hook, fd)) != hook)
+        return;
+
+    /* errors are ignored: the fd may have been closed before the unhook */
+#if defined(HOOK_FD_EPOLL)
+    memset (&event, 0, sizeof (event));
+    (void) epoll_ctl (hook_fd_backend, EPOLL_CTL_DEL, HOOK_FD(hook, fd),
+                      &event);
+#elif defined(HOOK_FD_KQUEUE)
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_READ)
+    {
+        EV_SET(&change, HOOK_FD(hook, fd), EVFILT_READ, EV_DELETE, 0, 0, NULL);
+        (void) kevent (hook_fd_backend, &change, 1, NULL, 0, NULL);
+    }
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_WRITE)
+    {
+        EV_SET(&change, HOOK_FD(hook, fd), EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+        (void) kevent (hook_fd_backend, &change, 1, NULL, 0, NULL);
+    }
+#endif
 }
 
 /*
@@ -1381,6 +2937,7 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
     new_hook_fd->fd = fd;
     new_hook_fd->flags = 0;
     new_hook_fd->error = 0;
+    new_hook_fd->poll_only = 0;
     if (flag_read)
         new_hook_fd->flags |= HOOK_FD_FLAG_READ;
     if (flag_write)
@@ -1388,29 +2945,84 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
     if (flag_exception)
         new_hook_fd->flags |= HOOK_FD_FLAG_EXCEPTION;
 
+    if (!hook_fd_table_set (fd, new_hook))
+    {
+        free (new_hook_fd);
+        free (new_hook);
+        return NULL;
+    }
+
     hook_add_to_list (new_hook);
 
+    hook_fd_realloc_events ();
+    hook_fd_backend_add (new_hook, -1);
+
     return new_hook;
 }
 
 /*
- * Executes fd hooks:
- * - poll() on fie descriptors
- * - call of hook fd callbacks if needed.
+ * Changes flags of a fd hook (read, write, exception).
  */
 
 void
-hook_fd_exec ()
+hook_fd_set_flags (struct t_hook *hook, int flags)
 {
-    int i, num_fd, timeout, ready, found;
-    struct t_hook *ptr_hook, *next_hook;
+    int old_flags;
+
+    if (!hook || hook->deleted || (hook->type != HOOK_TYPE_FD))
+        return;
+
+    old_flags = HOOK_FD(hook, flags);
+    if (flags == old_flags)
+        return;
+
+    HOOK_FD(hook, flags) = flags;
+    hook_fd_backend_add (hook, old_flags);
+}
+
+/*
+ * Runs the callback of a fd hook (if the hook is not deleted or running).
+ */
+
+void
+hook_fd_run_callback (struct t_hook *hook)
+{
+    struct timeval time_start;
+
+    if (!hook || hook->deleted || hook->running)
+        return;
+
+    hook->running = 1;
+    hook_callback_start (hook, &time_start);
+    (void) (HOOK_FD(hook, callback)) (
+        hook->callback_pointer,
+        hook->callback_data,
+        HOOK_FD(hook, fd));
+    hook_callback_end (hook, &time_start);
+    hook->running = 0;
+}
+
+/*
+ * Polls file descriptors with poll(), then executes callbacks of fd hooks
+ * with activity.
+ *
+ * If "poll_only" is 1, only hooks flagged as "poll_only" are polled (the
+ * others are handled by epoll/kqueue).
+ */
+
+void
+hook_fd_exec_poll (int timeout, int poll_only)
+{
+    int i, num_fd, ready;
+    struct t_hook *ptr_hook;
 
     /* build an array of "struct pollfd" for poll() */
     num_fd = 0;
     for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
          ptr_hook = ptr_hook->next_hook)
     {
-        if (!ptr_hook->deleted)
+        if (!ptr_hook->deleted
+            && (!poll_only || HOOK_FD(ptr_hook, poll_only)))
         {
             /* skip invalid file descriptors */
             if ((fcntl (HOOK_FD(ptr_hook,fd), F_GETFD) == -1)
@@ -1428,66 +3040,324 @@ hook_fd_exec ()
             }
             else
             {
-                if (num_fd > hook_fd_pollfd_count)
+                if (num_fd >= hook_fd_pollfd_count)
                     break;
 
-                hook_fd_pollfd[num_fd].fd = HOOK_FD(ptr_hook, fd);
-                hook_fd_pollfd[num_fd].events = 0;
-                hook_fd_pollfd[num_fd].revents = 0;
-                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_READ)
-                    hook_fd_pollfd[num_fd].events |= POLLIN;
-                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_WRITE)
-                    hook_fd_pollfd[num_fd].events |= POLLOUT;
+                hook_fd_pollfd[num_fd].fd = HOOK_FD(ptr_hook, fd);
+                hook_fd_pollfd[num_fd].events = 0;
+                hook_fd_pollfd[num_fd].revents = 0;
+                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_READ)
+                    hook_fd_pollfd[num_fd].events |= POLLIN;
+                if (HOOK_FD(ptr_hook, flags) & HOOK_FD_FLAG_WRITE)
+                    hook_fd_pollfd[num_fd].events |= POLLOUT;
+
+                num_fd++;
+            }
+        }
+    }
+
+    /* perform the poll() */
+    profile_set_phase (PROFILE_PHASE_POLL);
+    metrics_wait_start ();
+    ready = poll (hook_fd_pollfd, num_fd, timeout);
+    metrics_wait_end ();
+    profile_set_phase (PROFILE_PHASE_FD);
+    if (ready <= 0)
+        return;
+
+    /* execute callbacks for file descriptors with activity */
+    hook_exec_start ();
+
+    for (i = 0; (i < num_fd) && (ready > 0); i++)
+    {
+        if (hook_fd_pollfd[i].revents)
+        {
+            ready--;
+            hook_fd_run_callback (hook_search_fd (hook_fd_pollfd[i].fd));
+        }
+    }
+
+    hook_exec_end ();
+}
+
+/*
+ * Checks file descriptors watched by epoll/kqueue and displays an error for
+ * those which are not valid any more (closed without unhook): epoll/kqueue
+ * silently remove closed file descriptors, so their hooks would never be
+ * called.
+ *
+ * As this costs one system call by fd hook, this is done at most once per
+ * second.
+ */
+
+void
+hook_fd_check_invalid ()
+{
+    struct t_hook *ptr_hook;
+    time_t now;
+
+    now = time (NULL);
+    if (now == hook_fd_last_check_invalid)
+        return;
+    hook_fd_last_check_invalid = now;
+
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted
+            && !HOOK_FD(ptr_hook, poll_only)
+            && (HOOK_FD(ptr_hook, error) == 0)
+            && (fcntl (HOOK_FD(ptr_hook, fd), F_GETFD) == -1)
+            && (errno == EBADF))
+        {
+            HOOK_FD(ptr_hook, error) = errno;
+            gui_chat_printf (NULL,
+                             _("%sError: bad file descriptor (%d) "
+                               "used in hook_fd"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             HOOK_FD(ptr_hook, fd));
+        }
+    }
+}
+
+/*
+ * Waits for events with epoll/kqueue, then executes callbacks of fd hooks
+ * with activity.
+ */
+
+void
+hook_fd_exec_backend (int timeout)
+{
+#if defined(HOOK_FD_EPOLL) || defined(HOOK_FD_KQUEUE)
+    int i, ready;
+#ifdef HOOK_FD_KQUEUE
+    int j, duplicate;
+    struct timespec ts;
+#endif /* HOOK_FD_KQUEUE */
+
+    hook_fd_check_invalid ();
+
+    /* fds not supported by epoll/kqueue are checked with poll() */
+    if (hook_fd_poll_only_count > 0)
+    {
+        hook_fd_exec_poll (0, 1);
+        timeout = 0;
+    }
+
+    if (!hook_fd_events)
+    {
+        /* no fd hooked yet (possible in headless mode): wait for next timer */
+        if (timeout != 0)
+        {
+            profile_set_phase (PROFILE_PHASE_POLL);
+            metrics_wait_start ();
+            (void) poll (NULL, 0, timeout);
+            metrics_wait_end ();
+            profile_set_phase (PROFILE_PHASE_FD);
+        }
+        return;
+    }
+
+    profile_set_phase (PROFILE_PHASE_POLL);
+    metrics_wait_start ();
+#if defined(HOOK_FD_EPOLL)
+    ready = epoll_wait (hook_fd_backend, hook_fd_events, hook_fd_events_size,
+                        timeout);
+#else
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000;
+    ready = kevent (hook_fd_backend, NULL, 0,
+                    hook_fd_events, hook_fd_events_size, &ts);
+#endif
+    metrics_wait_end ();
+    profile_set_phase (PROFILE_PHASE_FD);
+    if (ready <= 0)
+        return;
+
+    /* execute callbacks for file descriptors with activity */
+    hook_exec_start ();
+
+    for (i = 0; i < ready; i++)
+    {
+#if defined(HOOK_FD_EPOLL)
+        hook_fd_run_callback (hook_search_fd (hook_fd_events[i].data.fd));
+#else
+        /* with kqueue, same fd can be returned twice (read + write) */
+        duplicate = 0;
+        for (j = 0; j < i; j++)
+        {
+            if (hook_fd_events[j].ident == hook_fd_events[i].ident)
+            {
+                duplicate = 1;
+                break;
+            }
+        }
+        if (!duplicate)
+            hook_fd_run_callback (hook_search_fd ((int)hook_fd_events[i].ident));
+#endif
+    }
+
+    hook_exec_end ();
+#else
+    (void) timeout;
+#endif /* defined(HOOK_FD_EPOLL) || defined(HOOK_FD_KQUEUE) */
+}
+
+/*
+ * Executes fd hooks:
+ * - wait for activity on file descriptors (epoll, kqueue or poll)
+ * - call of hook fd callbacks if needed.
+ *
+ * Argument "max_timeout" is the max time to wait (in milliseconds), -1 to
+ * wait until the next timer.
+ */
+
+void
+hook_fd_exec (int max_timeout)
+{
+    int timeout;
+
+    timeout = hook_timer_get_time_to_next ();
+    if ((max_timeout >= 0) && ((timeout < 0) || (timeout > max_timeout)))
+        timeout = max_timeout;
+    if (hook_process_pending)
+        timeout = 0;
+
+    if (hook_fd_backend >= 0)
+        hook_fd_exec_backend (timeout);
+    else
+        hook_fd_exec_poll (timeout, 0);
+}
+
+/*
+ * Returns the number of processes running (queued == 0) or queued
+ * (queued == 1), for all plugins (all_plugins == 1) or for the given plugin
+ * only (NULL for WeeChat core).
+ */
+
+int
+hook_process_count (struct t_weechat_plugin *plugin, int all_plugins,
+                    int queued)
+{
+    struct t_hook *ptr_hook;
+    int count;
+
+    count = 0;
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_PROCESS]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (ptr_hook->deleted)
+            continue;
+        if (!all_plugins && (ptr_hook->plugin != plugin))
+            continue;
+        if (HOOK_PROCESS(ptr_hook, url_transfer))
+        {
+            /* URL downloaded in WeeChat process: it is running */
+            if (!queued)
+                count++;
+        }
+        else if ((queued && (HOOK_PROCESS(ptr_hook, child_pid) == 0))
+                 || (!queued && (HOOK_PROCESS(ptr_hook, child_pid) > 0)))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Checks if a new process can be started for a plugin, according to options
+ * weechat.plugin.process_max_running and
+ * weechat.plugin.process_max_running_per_plugin.
+ *
+ * Argument "running" is the number of processes running for all plugins
+ * (if negative, it is computed).
+ *
+ * Returns:
+ *   1: a process can be started
+ *   0: the limit is reached (process must stay in queue)
+ */
 
-                num_fd++;
-            }
-        }
+int
+hook_process_can_run (struct t_weechat_plugin *plugin, int running)
+{
+    if (CONFIG_INTEGER(config_plugin_process_max_running) > 0)
+    {
+        if (running < 0)
+            running = hook_process_count (NULL, 1, 0);
+        if (running >= CONFIG_INTEGER(config_plugin_process_max_running))
+            return 0;
     }
 
-    /* perform the poll() */
-    timeout = hook_timer_get_time_to_next ();
-    if (hook_process_pending)
-        timeout = 0;
-    ready = poll (hook_fd_pollfd, num_fd, timeout);
-    if (ready <= 0)
-        return;
+    if ((CONFIG_INTEGER(config_plugin_process_max_running_per_plugin) > 0)
+        && (hook_process_count (plugin, 0, 0) >=
+            CONFIG_INTEGER(config_plugin_process_max_running_per_plugin)))
+    {
+        return 0;
+    }
 
-    /* execute callbacks for file descriptors with activity */
-    hook_exec_start ();
+    return 1;
+}
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_FD];
-    while (ptr_hook)
+/*
+ * Callback for timeout of a process still in queue (not yet started).
+ */
+
+int
+hook_process_queue_timer_cb (const void *pointer, void *data,
+                             int remaining_calls)
+{
+    struct t_hook *hook_process;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    hook_process = (struct t_hook *)pointer;
+
+    if (hook_process->deleted
+        || (HOOK_PROCESS(hook_process, child_pid) != 0)
+        || HOOK_PROCESS(hook_process, url_transfer))
     {
-        next_hook = ptr_hook->next_hook;
+        return WEECHAT_RC_OK;
+    }
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running)
-        {
-            found = 0;
-            for (i = 0; i < num_fd; i++)
-            {
-                if (hook_fd_pollfd[i].fd == HOOK_FD(ptr_hook, fd)
-                    && hook_fd_pollfd[i].revents)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found)
-            {
-                ptr_hook->running = 1;
-                (void) (HOOK_FD(ptr_hook, callback)) (
-                    ptr_hook->callback_pointer,
-                    ptr_hook->callback_data,
-                    HOOK_FD(ptr_hook, fd));
-                ptr_hook->running = 0;
-            }
-        }
+    HOOK_PROCESS(hook_process, hook_timer) = NULL;
 
-        ptr_hook = next_hook;
+    hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_ERROR);
+    if (weechat_debug_core >= 1)
+    {
+        gui_chat_printf (NULL,
+                         _("End of command '%s', timeout reached in queue "
+                           "(%.1fs)"),
+                         HOOK_PROCESS(hook_process, command),
+                         ((float)HOOK_PROCESS(hook_process, timeout)) / 1000);
     }
+    unhook (hook_process);
 
-    hook_exec_end ();
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Adds a process in queue: it will be started by function hook_process_exec
+ * when the limits of processes running allow it.
+ *
+ * If the process has a timeout, a timer is created to end the process if it
+ * is still in queue when the timeout is reached.
+ */
+
+void
+hook_process_queue (struct t_hook *hook_process)
+{
+    if (HOOK_PROCESS(hook_process, timeout) > 0)
+    {
+        HOOK_PROCESS(hook_process, hook_timer) = hook_timer (
+            hook_process->plugin,
+            HOOK_PROCESS(hook_process, timeout), 0, 1,
+            &hook_process_queue_timer_cb, hook_process, NULL);
+    }
+    hook_process_pending = 1;
 }
 
 /*
@@ -1552,6 +3422,9 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
     new_hook_process->child_write[HOOK_PROCESS_STDOUT] = -1;
     new_hook_process->child_write[HOOK_PROCESS_STDERR] = -1;
     new_hook_process->child_pid = 0;
+    new_hook_process->child_spawned = 0;
+    new_hook_process->child_ended = 0;
+    new_hook_process->child_status = 0;
     new_hook_process->hook_fd[HOOK_PROCESS_STDIN] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDOUT] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDERR] = NULL;
@@ -1563,6 +3436,8 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
     new_hook_process->buffer_size[HOOK_PROCESS_STDOUT] = 0;
     new_hook_process->buffer_size[HOOK_PROCESS_STDERR] = 0;
     new_hook_process->buffer_flush = HOOK_PROCESS_BUFFER_SIZE;
+    gettimeofday (&new_hook_process->time_queued, NULL);
+    new_hook_process->url_transfer = NULL;
     if (options)
     {
         ptr_value = hashtable_get (options, "buffer_flush");
@@ -1590,10 +3465,21 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
                          new_hook_process->timeout);
     }
 
-    if (strncmp (new_hook_process->command, "func:", 5) == 0)
-        hook_process_pending = 1;
+    /*
+     * functions are always run by hook_process_exec (in main loop); the
+     * process is queued if the limits are reached or if other processes are
+     * already waiting in queue (to keep the order of creation)
+     */
+    if ((strncmp (new_hook_process->command, "func:", 5) == 0)
+        || (hook_process_count (NULL, 1, 1) > 1)
+        || !hook_process_can_run (plugin, -1))
+    {
+        hook_process_queue (new_hook);
+    }
     else
+    {
         hook_process_run (new_hook);
+    }
 
     return new_hook;
 
@@ -1627,6 +3513,91 @@ hook_process (struct t_weechat_plugin *plugin,
                                    callback, callback_pointer, callback_data);
 }
 
+/*
+ * Builds arguments for execvp with the command of a process hook: the
+ * arguments are read in options "arg1", "arg2", ... or the command is split
+ * like the shell does.
+ *
+ * Note: result must be freed after use with function string_free_split.
+ */
+
+char **
+hook_process_get_exec_args (struct t_hook *hook_process)
+{
+    char **exec_args, *arg0, str_arg[64];
+    const char *ptr_arg;
+    int i, num_args;
+
+    num_args = 0;
+    if (HOOK_PROCESS(hook_process, options))
+    {
+        /*
+         * count number of arguments given in the hashtable options,
+         * keys are: "arg1", "arg2", ...
+         */
+        while (1)
+        {
+            snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
+            ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                     str_arg);
+            if (!ptr_arg)
+                break;
+            num_args++;
+        }
+    }
+    if (num_args > 0)
+    {
+        /*
+         * if at least one argument was found in hashtable option, the
+         * "command" contains only path to binary (without arguments), and
+         * the arguments are in hashtable
+         */
+        exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
+        if (exec_args)
+        {
+            exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
+            for (i = 1; i <= num_args; i++)
+            {
+                snprintf (str_arg, sizeof (str_arg), "arg%d", i);
+                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                         str_arg);
+                exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
+            }
+            exec_args[num_args + 1] = NULL;
+        }
+    }
+    else
+    {
+        /*
+         * if no arguments were found in hashtable, make an automatic split
+         * of command, like the shell does
+         */
+        exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
+                                        NULL);
+    }
+
+    if (exec_args)
+    {
+        arg0 = string_expand_home (exec_args[0]);
+        if (arg0)
+        {
+            free (exec_args[0]);
+            exec_args[0] = arg0;
+        }
+        if (weechat_debug_core >= 1)
+        {
+            log_printf ("hook_process, command='%s'",
+                        HOOK_PROCESS(hook_process, command));
+            for (i = 0; exec_args[i]; i++)
+            {
+                log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
+            }
+        }
+    }
+
+    return exec_args;
+}
+
 /*
  * Child process for hook process: executes command and returns string result
  * into pipe for WeeChat process.
@@ -1635,9 +3606,9 @@ hook_process (struct t_weechat_plugin *plugin,
 void
 hook_process_child (struct t_hook *hook_process)
 {
-    char **exec_args, *arg0, str_arg[64];
-    const char *ptr_url, *ptr_arg;
-    int rc, i, num_args;
+    char **exec_args;
+    const char *ptr_url;
+    int rc;
     FILE *f;
 
     /* read stdin from parent, if a pipe was defined */
@@ -1715,73 +3686,9 @@ hook_process_child (struct t_hook *hook_process)
     else
     {
         /* launch command */
-        num_args = 0;
-        if (HOOK_PROCESS(hook_process, options))
-        {
-            /*
-             * count number of arguments given in the hashtable options,
-             * keys are: "arg1", "arg2", ...
-             */
-            while (1)
-            {
-                snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
-                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                         str_arg);
-                if (!ptr_arg)
-                    break;
-                num_args++;
-            }
-        }
-        if (num_args > 0)
-        {
-            /*
-             * if at least one argument was found in hashtable option, the
-             * "command" contains only path to binary (without arguments), and
-             * the arguments are in hashtable
-             */
-            exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
-            if (exec_args)
-            {
-                exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
-                for (i = 1; i <= num_args; i++)
-                {
-                    snprintf (str_arg, sizeof (str_arg), "arg%d", i);
-                    ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                             str_arg);
-                    exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
-                }
-                exec_args[num_args + 1] = NULL;
-            }
-        }
-        else
-        {
-            /*
-             * if no arguments were found in hashtable, make an automatic split
-             * of command, like the shell does
-             */
-            exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
-                                            NULL);
-        }
-
+        exec_args = hook_process_get_exec_args (hook_process);
         if (exec_args)
-        {
-            arg0 = string_expand_home (exec_args[0]);
-            if (arg0)
-            {
-                free (exec_args[0]);
-                exec_args[0] = arg0;
-            }
-            if (weechat_debug_core >= 1)
-            {
-                log_printf ("hook_process, command='%s'",
-                            HOOK_PROCESS(hook_process, command));
-                for (i = 0; exec_args[i]; i++)
-                {
-                    log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
-                }
-            }
             execvp (exec_args[0], exec_args);
-        }
 
         /* should not be executed if execvp was OK */
         if (exec_args)
@@ -1803,6 +3710,7 @@ hook_process_child (struct t_hook *hook_process)
 void
 hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
 {
+    struct timeval time_start;
     int size;
 
     /* add '\0' at end of stdout and stderr */
@@ -1814,6 +3722,7 @@ hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR])[size] = '\0';
 
     /* send buffers to callback */
+    hook_callback_start (hook_process, &time_start);
     (void) (HOOK_PROCESS(hook_process, callback))
         (hook_process->callback_pointer,
          hook_process->callback_data,
@@ -1823,6 +3732,7 @@ hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
          HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT]) : NULL,
          (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) > 0) ?
          HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR]) : NULL);
+    hook_callback_end (hook_process, &time_start);
 
     /* reset size for stdout and stderr */
     HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) = 0;
@@ -1993,6 +3903,95 @@ hook_process_child_read_until_eof (struct t_hook *hook_process)
     }
 }
 
+/*
+ * Saves exit status of a child started by the spawn helper (called when the
+ * spawn helper sends the exit status).
+ */
+
+void
+hook_process_child_exited (pid_t pid, int status)
+{
+    struct t_hook *ptr_hook;
+
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_PROCESS]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted
+            && HOOK_PROCESS(ptr_hook, child_spawned)
+            && (HOOK_PROCESS(ptr_hook, child_pid) == pid))
+        {
+            HOOK_PROCESS(ptr_hook, child_ended) = 1;
+            HOOK_PROCESS(ptr_hook, child_status) = status;
+            break;
+        }
+    }
+}
+
+/*
+ * Checks if a child process has ended.
+ *
+ * Returns:
+ *   1: child has ended (status is set)
+ *   0: child is still running
+ */
+
+int
+hook_process_child_has_ended (struct t_hook *hook_process, int *status)
+{
+    if (!HOOK_PROCESS(hook_process, child_spawned))
+    {
+        return (waitpid (HOOK_PROCESS(hook_process, child_pid),
+                         status, WNOHANG) > 0) ? 1 : 0;
+    }
+
+    spawn_read_messages ();
+    if (HOOK_PROCESS(hook_process, child_ended))
+    {
+        *status = HOOK_PROCESS(hook_process, child_status);
+        return 1;
+    }
+
+    /*
+     * if the spawn helper has died, the exit status of child will never be
+     * received (and its pid can not be used any more, it may have been
+     * reused): the child is considered as ended, with an unknown status (-1)
+     */
+    if (!spawn_available ())
+    {
+        *status = -1;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Sends a signal to a child process.
+ *
+ * A child started by the spawn helper is signaled by the helper, only if it
+ * is still running (its pid may have been reused if it has ended).
+ *
+ * Returns:
+ *   0: OK
+ *  -1: error (errno is set)
+ */
+
+int
+hook_process_kill_child (struct t_hook *hook_process, int signum)
+{
+    if (HOOK_PROCESS(hook_process, child_spawned))
+    {
+        if (HOOK_PROCESS(hook_process, child_ended))
+        {
+            errno = ESRCH;
+            return -1;
+        }
+        return spawn_kill (HOOK_PROCESS(hook_process, child_pid), signum);
+    }
+
+    return kill (HOOK_PROCESS(hook_process, child_pid), signum);
+}
+
 /*
  * Checks if child process is still alive.
  */
@@ -2022,15 +4021,16 @@ hook_process_timer_cb (const void *pointer, void *data, int remaining_calls)
                              HOOK_PROCESS(hook_process, command),
                              ((float)HOOK_PROCESS(hook_process, timeout)) / 1000);
         }
-        kill (HOOK_PROCESS(hook_process, child_pid), SIGKILL);
+        hook_process_kill_child (hook_process, SIGKILL);
         usleep (1000);
         unhook (hook_process);
     }
     else
     {
-        if (waitpid (HOOK_PROCESS(hook_process, child_pid),
-                     &status, WNOHANG) > 0)
+        if (hook_process_child_has_ended (hook_process, &status))
         {
+            TRACE3(hook_process_exit, HOOK_PROCESS(hook_process, command),
+                   HOOK_PROCESS(hook_process, child_pid), status);
             if (WIFEXITED(status))
             {
                 /* child terminated normally */
@@ -2039,9 +4039,9 @@ hook_process_timer_cb (const void *pointer, void *data, int remaining_calls)
                 hook_process_send_buffers (hook_process, rc);
                 unhook (hook_process);
             }
-            else if (WIFSIGNALED(status))
+            else
             {
-                /* child terminated by a signal */
+                /* child terminated by a signal (or unknown status) */
                 hook_process_child_read_until_eof (hook_process);
                 hook_process_send_buffers (hook_process,
                                            WEECHAT_HOOK_PROCESS_ERROR);
@@ -2053,18 +4053,95 @@ hook_process_timer_cb (const void *pointer, void *data, int remaining_calls)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Starts the child process with the spawn helper (without calling fork in
+ * WeeChat process).
+ *
+ * Functions ("func:...") are always run with fork, as they need the memory
+ * of WeeChat process; URLs are downloaded with fork if a curl proxy is set
+ * (the spawn helper does not know the proxies).
+ *
+ * Returns pid of child, -1 if the helper could not start the child.
+ */
+
+pid_t
+hook_process_spawn (struct t_hook *hook_process)
+{
+    char **exec_args;
+    const char *ptr_url;
+    pid_t pid;
+
+    if (!spawn_available ())
+        return -1;
+
+    if (strncmp (HOOK_PROCESS(hook_process, command), "func:", 5) == 0)
+        return -1;
+
+    if (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) == 0)
+    {
+        if (CONFIG_STRING(config_network_proxy_curl)
+            && CONFIG_STRING(config_network_proxy_curl)[0])
+        {
+            return -1;
+        }
+        ptr_url = HOOK_PROCESS(hook_process, command) + 4;
+        while (ptr_url[0] == ' ')
+        {
+            ptr_url++;
+        }
+        return spawn_url (ptr_url, HOOK_PROCESS(hook_process, options),
+                          HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]),
+                          HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]),
+                          HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]));
+    }
+
+    exec_args = hook_process_get_exec_args (hook_process);
+    if (!exec_args)
+        return -1;
+    pid = spawn_exec (HOOK_PROCESS(hook_process, command), exec_args,
+                      HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]),
+                      HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]),
+                      HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]));
+    string_free_split (exec_args);
+
+    return pid;
+}
+
 /*
  * Executes process command in child, and read data in current process,
  * with fd hook.
  */
 
-void
-hook_process_run (struct t_hook *hook_process)
-{
-    int pipes[3][2], timeout, max_calls, rc, i;
-    char str_error[1024];
-    long interval;
-    pid_t pid;
+void
+hook_process_run (struct t_hook *hook_process)
+{
+    int pipes[3][2], timeout, max_calls, rc, i;
+    char str_error[1024];
+    long interval;
+    struct timeval tv_now;
+    pid_t pid;
+
+    /* remove timer of timeout in queue */
+    if (HOOK_PROCESS(hook_process, hook_timer))
+    {
+        unhook (HOOK_PROCESS(hook_process, hook_timer));
+        HOOK_PROCESS(hook_process, hook_timer) = NULL;
+    }
+
+    timeout = HOOK_PROCESS(hook_process, timeout);
+    if (timeout > 0)
+    {
+        /* the time spent in queue is part of the timeout */
+        gettimeofday (&tv_now, NULL);
+        timeout -= util_timeval_diff (&HOOK_PROCESS(hook_process, time_queued),
+                                      &tv_now) / 1000;
+        if (timeout < 1)
+            timeout = 1;
+    }
+
+    /* download URL in WeeChat process, if possible */
+    if (weeurl_multi_start (hook_process, timeout))
+        return;
 
     for (i = 0; i < 3; i++)
     {
@@ -2096,6 +4173,14 @@ hook_process_run (struct t_hook *hook_process)
         HOOK_PROCESS(hook_process, child_write[i]) = pipes[i][1];
     }
 
+    /* run the command with the spawn helper, if possible */
+    pid = hook_process_spawn (hook_process);
+    if (pid > 0)
+    {
+        HOOK_PROCESS(hook_process, child_spawned) = 1;
+        goto parent;
+    }
+
     /* fork */
     switch (pid = fork ())
     {
@@ -2122,8 +4207,11 @@ hook_process_run (struct t_hook *hook_process)
             break;
     }
 
+parent:
     /* parent process */
     HOOK_PROCESS(hook_process, child_pid) = pid;
+    TRACE3(hook_process_spawn, HOOK_PROCESS(hook_process, command), pid,
+           HOOK_PROCESS(hook_process, child_spawned));
     if (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]) >= 0)
     {
         close (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]));
@@ -2160,7 +4248,6 @@ hook_process_run (struct t_hook *hook_process)
                      hook_process, NULL);
     }
 
-    timeout = HOOK_PROCESS(hook_process, timeout);
     interval = 100;
     max_calls = 0;
     if (timeout > 0)
@@ -2203,16 +4290,25 @@ error:
 }
 
 /*
- * Executes all process commands pending.
+ * Executes process commands pending, in order of creation, until the limits
+ * of processes running are reached (the other processes stay in queue).
  */
 
 void
 hook_process_exec ()
 {
     struct t_hook *ptr_hook, *next_hook;
+    int running;
+
+    if (!hook_process_pending)
+        return;
+
+    hook_process_pending = 0;
 
     hook_exec_start ();
 
+    running = hook_process_count (NULL, 1, 0);
+
     ptr_hook = weechat_hooks[HOOK_TYPE_PROCESS];
     while (ptr_hook)
     {
@@ -2220,19 +4316,31 @@ hook_process_exec ()
 
         if (!ptr_hook->deleted
             && !ptr_hook->running
-            && (HOOK_PROCESS(ptr_hook, child_pid) == 0))
+            && (HOOK_PROCESS(ptr_hook, child_pid) == 0)
+            && !HOOK_PROCESS(ptr_hook, url_transfer))
         {
-            ptr_hook->running = 1;
-            hook_process_run (ptr_hook);
-            ptr_hook->running = 0;
+            if (!hook_process_can_run (ptr_hook->plugin, running))
+            {
+                if ((CONFIG_INTEGER(config_plugin_process_max_running) > 0)
+                    && (running >= CONFIG_INTEGER(config_plugin_process_max_running)))
+                {
+                    break;
+                }
+                /* per plugin limit reached: try processes of other plugins */
+            }
+            else
+            {
+                ptr_hook->running = 1;
+                hook_process_run (ptr_hook);
+                ptr_hook->running = 0;
+                running++;
+            }
         }
 
         ptr_hook = next_hook;
     }
 
     hook_exec_end ();
-
-    hook_process_pending = 0;
 }
 
 /*
@@ -2317,7 +4425,7 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
 
     hook_add_to_list (new_hook);
 
-    network_connect_with_fork (new_hook);
+    network_connect_start (new_hook);
 
     return new_hook;
 }
@@ -2400,6 +4508,194 @@ hook_connect_gnutls_set_certificates (gnutls_session_t tls_session,
 }
 #endif /* HAVE_GNUTLS */
 
+/*
+ * Gets the tag used to store a print hook in bucket of tags.
+ *
+ * A tag can be used only if the hook is not bound to a buffer and has a single
+ * list of tags (tags combined with "+"): the first tag which is not negated
+ * and has no wildcard must be present in the line for the hook to match.
+ *
+ * Returns the tag, NULL if the hook can not be stored by tag.
+ */
+
+const char *
+hook_print_get_tag_key (struct t_hook *hook)
+{
+    char **ptr_tags;
+    int i;
+
+    if (HOOK_PRINT(hook, buffer)
+        || !HOOK_PRINT(hook, tags_array)
+        || (HOOK_PRINT(hook, tags_count) != 1))
+    {
+        return NULL;
+    }
+
+    ptr_tags = HOOK_PRINT(hook, tags_array)[0];
+    if (!ptr_tags)
+        return NULL;
+
+    for (i = 0; ptr_tags[i]; i++)
+    {
+        if ((ptr_tags[i][0] == '!') && ptr_tags[i][1])
+            continue;
+        if (strchr (ptr_tags[i], '*'))
+            continue;
+        return ptr_tags[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Gets the bucket where a print hook is stored.
+ *
+ * If create == 1, the list is created if it does not exist yet.
+ *
+ * Argument "hashtable" is set with the hashtable containing the list and "key"
+ * with the key of list in this hashtable (both NULL for list of other hooks).
+ *
+ * Returns pointer to list, NULL if not found or error.
+ */
+
+struct t_arraylist *
+hook_print_get_bucket (struct t_hook *hook, int create,
+                       struct t_hashtable **hashtable, const void **key)
+{
+    struct t_arraylist *list;
+
+    *hashtable = NULL;
+    *key = NULL;
+
+    if (HOOK_PRINT(hook, buffer))
+    {
+        *hashtable = hook_print_buffers;
+        *key = HOOK_PRINT(hook, buffer);
+    }
+    else
+    {
+        *key = hook_print_get_tag_key (hook);
+        if (*key)
+            *hashtable = hook_print_tags;
+    }
+
+    if (!*hashtable)
+        return hook_print_others;
+
+    list = hashtable_get (*hashtable, *key);
+    if (!list && create)
+    {
+        list = arraylist_new (0, 1, 0, &hook_index_cmp_cb, NULL, NULL, NULL);
+        if (list)
+            hashtable_set (*hashtable, *key, list);
+    }
+
+    return list;
+}
+
+/*
+ * Adds a print hook in its bucket.
+ */
+
+void
+hook_print_bucket_add (struct t_hook *hook)
+{
+    struct t_arraylist *list;
+    struct t_hashtable *hashtable;
+    const void *key;
+
+    list = hook_print_get_bucket (hook, 1, &hashtable, &key);
+    if (list)
+        arraylist_add (list, hook);
+}
+
+/*
+ * Removes a print hook from its bucket.
+ */
+
+void
+hook_print_bucket_remove (struct t_hook *hook)
+{
+    struct t_arraylist *list;
+    struct t_hashtable *hashtable;
+    const void *key;
+    int index_list;
+
+    list = hook_print_get_bucket (hook, 0, &hashtable, &key);
+    if (!list)
+        return;
+
+    if (!arraylist_search (list, hook, &index_list, NULL))
+        return;
+    arraylist_remove (list, index_list);
+
+    if (hashtable && (arraylist_size (list) == 0))
+        hashtable_remove (hashtable, key);
+}
+
+/*
+ * Searches print hooks that can match a line: hooks bound to the buffer,
+ * hooks stored with a tag of line and other hooks.
+ *
+ * Hooks found are sorted by priority, then creation order.
+ *
+ * The result must be freed by a call to hook_index_result_free().
+ */
+
+void
+hook_print_search (struct t_gui_buffer *buffer, struct t_gui_line *line,
+                   struct t_hook_index_result *result)
+{
+    struct t_arraylist *list;
+    int i, j, lists;
+
+    hook_index_result_init (result);
+
+    lists = 0;
+
+    list = hashtable_get (hook_print_buffers, buffer);
+    if (list)
+    {
+        hook_index_result_add_list (result, list, NULL, 0);
+        lists++;
+    }
+
+    if (hook_print_tags && (hook_print_tags->items_count > 0))
+    {
+        for (i = 0; i < line->data->tags_count; i++)
+        {
+            /* skip tag if it was already found in line */
+            for (j = 0; j < i; j++)
+            {
+                if ((line->data->tags_array[i] == line->data->tags_array[j])
+                    || (string_strcasecmp (line->data->tags_array[i],
+                                           line->data->tags_array[j]) == 0))
+                    break;
+            }
+            if (j < i)
+                continue;
+            list = hashtable_get (hook_print_tags, line->data->tags_array[i]);
+            if (list)
+            {
+                hook_index_result_add_list (result, list, NULL, 0);
+                lists++;
+            }
+        }
+    }
+
+    if (hook_print_others && (arraylist_size (hook_print_others) > 0))
+    {
+        hook_index_result_add_list (result, hook_print_others, NULL, 0);
+        lists++;
+    }
+
+    if ((lists > 1) && (result->count > 1))
+    {
+        qsort (result->hooks, result->count, sizeof (result->hooks[0]),
+               &hook_index_qsort_cmp_cb);
+    }
+}
+
 /*
  * Hooks a message printed by WeeChat.
  *
@@ -2451,9 +4747,9 @@ hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
             {
                 for (i = 0; i < new_hook_print->tags_count; i++)
                 {
-                    new_hook_print->tags_array[i] = string_split (tags_array[i],
-                                                                  "+", 0, 0,
-                                                                  NULL);
+                    new_hook_print->tags_array[i] = string_split_shared (tags_array[i],
+                                                                         "+", 0, 0,
+                                                                         NULL);
                 }
             }
             string_free_split (tags_array);
@@ -2464,6 +4760,8 @@ hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
 
     hook_add_to_list (new_hook);
 
+    hook_print_bucket_add (new_hook);
+
     return new_hook;
 }
 
@@ -2474,29 +4772,39 @@ hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
 void
 hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
     char *prefix_no_color, *message_no_color;
+    int i;
 
     if (!line->data->message || !line->data->message[0])
         return;
 
+    hook_print_search (buffer, line, &hooks_found);
+    if (hooks_found.count == 0)
+    {
+        hook_index_result_free (&hooks_found);
+        return;
+    }
+
     prefix_no_color = (line->data->prefix) ?
         gui_color_decode (line->data->prefix, NULL) : NULL;
 
-    message_no_color = gui_color_decode (line->data->message, NULL);
+    message_no_color = gui_line_data_get_message_no_color (line->data);
     if (!message_no_color)
     {
         if (prefix_no_color)
             free (prefix_no_color);
+        hook_index_result_free (&hooks_found);
         return;
     }
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_PRINT];
-    while (ptr_hook)
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
 
         if (!ptr_hook->deleted
             && !ptr_hook->running
@@ -2515,6 +4823,7 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
             {
                 /* run callback */
                 ptr_hook->running = 1;
+                hook_callback_start (ptr_hook, &time_start);
                 (void) (HOOK_PRINT(ptr_hook, callback))
                     (ptr_hook->callback_pointer,
                      ptr_hook->callback_data, buffer, line->data->date,
@@ -2523,13 +4832,14 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
                      (int)line->data->displayed, (int)line->data->highlight,
                      (HOOK_PRINT(ptr_hook, strip_colors)) ? prefix_no_color : line->data->prefix,
                      (HOOK_PRINT(ptr_hook, strip_colors)) ? message_no_color : line->data->message);
+                hook_callback_end (ptr_hook, &time_start);
                 ptr_hook->running = 0;
             }
         }
-
-        ptr_hook = next_hook;
     }
 
+    hook_index_result_free (&hooks_found);
+
     if (prefix_no_color)
         free (prefix_no_color);
     if (message_no_color)
@@ -2588,38 +4898,48 @@ hook_signal (struct t_weechat_plugin *plugin, const char *signal,
 int
 hook_signal_send (const char *signal, const char *type_data, void *signal_data)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    int rc;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
+    int i, rc;
 
     rc = WEECHAT_RC_OK;
 
+    /* data used in expressions may have changed: forget memoized values */
+    eval_memo_reset ();
+
+    /* load plugin waiting for its first use (if signal belongs to it) */
+    if (plugin_lazy_plugins)
+        plugin_lazy_load_name (signal, 0);
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_SIGNAL];
-    while (ptr_hook)
+    hook_index_search (hook_index[HOOK_TYPE_SIGNAL], signal, &hooks_found);
+
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_match (signal, HOOK_SIGNAL(ptr_hook, signal), 0)))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             rc = (HOOK_SIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  signal,
                  type_data,
                  signal_data);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
                 break;
         }
-
-        ptr_hook = next_hook;
     }
 
+    hook_index_result_free (&hooks_found);
+
     hook_exec_end ();
 
     return rc;
@@ -2675,37 +4995,44 @@ hook_hsignal (struct t_weechat_plugin *plugin, const char *signal,
 int
 hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    int rc;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
+    int i, rc;
 
     rc = WEECHAT_RC_OK;
 
+    /* load plugin waiting for its first use (if hsignal belongs to it) */
+    if (plugin_lazy_plugins)
+        plugin_lazy_load_name (signal, 0);
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_HSIGNAL];
-    while (ptr_hook)
+    hook_index_search (hook_index[HOOK_TYPE_HSIGNAL], signal, &hooks_found);
+
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_match (signal, HOOK_HSIGNAL(ptr_hook, signal), 0)))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             rc = (HOOK_HSIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  signal,
                  hashtable);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
                 break;
         }
-
-        ptr_hook = next_hook;
     }
 
+    hook_index_result_free (&hooks_found);
+
     hook_exec_end ();
 
     return rc;
@@ -2762,32 +5089,35 @@ hook_config (struct t_weechat_plugin *plugin, const char *option,
 void
 hook_config_exec (const char *option, const char *value)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
+    int i;
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_CONFIG];
-    while (ptr_hook)
+    hook_index_search (hook_index[HOOK_TYPE_CONFIG], option, &hooks_found);
+
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (!HOOK_CONFIG(ptr_hook, option)
-                || (string_match (option, HOOK_CONFIG(ptr_hook, option), 0))))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             (void) (HOOK_CONFIG(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  option,
                  value);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
         }
-
-        ptr_hook = next_hook;
     }
 
+    hook_index_result_free (&hooks_found);
+
     hook_exec_end ();
 }
 
@@ -2872,6 +5202,7 @@ hook_completion_exec (struct t_weechat_plugin *plugin,
                       struct t_gui_buffer *buffer,
                       struct t_gui_completion *completion)
 {
+    struct timeval time_start;
     struct t_hook *ptr_hook, *next_hook;
     const char *pos;
     char *item;
@@ -2899,12 +5230,14 @@ hook_completion_exec (struct t_weechat_plugin *plugin,
                                    item) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             (void) (HOOK_COMPLETION(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  completion_item,
                  buffer,
                  completion);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
         }
 
@@ -2969,8 +5302,11 @@ char *
 hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                     const char *modifier_data, const char *string)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct timeval time_start;
+    struct t_hook *ptr_hook;
+    struct t_hook_index_result hooks_found;
     char *new_msg, *message_modified;
+    int i;
 
     /* make C compiler happy */
     (void) plugin;
@@ -2985,31 +5321,32 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_MODIFIER];
-    while (ptr_hook)
+    hook_index_search (hook_index[HOOK_TYPE_MODIFIER], modifier,
+                       &hooks_found);
+
+    for (i = 0; i < hooks_found.count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks_found.hooks[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_strcasecmp (HOOK_MODIFIER(ptr_hook, modifier),
-                                   modifier) == 0))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             new_msg = (HOOK_MODIFIER(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  modifier,
                  modifier_data,
                  message_modified);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             /* empty string returned => message dropped */
             if (new_msg && !new_msg[0])
             {
                 free (message_modified);
-                hook_exec_end ();
-                return new_msg;
+                message_modified = new_msg;
+                break;
             }
 
             /* new message => keep it as base for next modifier */
@@ -3019,15 +5356,56 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                 message_modified = new_msg;
             }
         }
-
-        ptr_hook = next_hook;
     }
 
+    hook_index_result_free (&hooks_found);
+
     hook_exec_end ();
 
     return message_modified;
 }
 
+/*
+ * Checks if at least one modifier hook exists for a modifier name.
+ *
+ * This can be used before calling hook_modifier_exec, to not build the
+ * modifier data (or copy the string) if nobody is listening.
+ *
+ * Returns:
+ *   1: at least one hook exists for this modifier
+ *   0: no hook for this modifier
+ */
+
+int
+hook_modifier_exists (struct t_weechat_plugin *plugin, const char *modifier)
+{
+    struct t_hook_index_result hooks_found;
+    int i, found;
+
+    /* make C compiler happy */
+    (void) plugin;
+
+    if (!modifier || !modifier[0])
+        return 0;
+
+    hook_index_search (hook_index[HOOK_TYPE_MODIFIER], modifier,
+                       &hooks_found);
+
+    found = 0;
+    for (i = 0; i < hooks_found.count; i++)
+    {
+        if (!hooks_found.hooks[i]->deleted)
+        {
+            found = 1;
+            break;
+        }
+    }
+
+    hook_index_result_free (&hooks_found);
+
+    return found;
+}
+
 /*
  * Hooks an info.
  *
@@ -3084,6 +5462,7 @@ const char *
 hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
                const char *arguments)
 {
+    struct timeval time_start;
     struct t_hook *ptr_hook, *next_hook;
     const char *value;
 
@@ -3093,6 +5472,10 @@ hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
     if (!info_name || !info_name[0])
         return NULL;
 
+    /* load plugin waiting for its first use (if info belongs to it) */
+    if (plugin_lazy_plugins)
+        plugin_lazy_load_name (info_name, 0);
+
     hook_exec_start ();
 
     ptr_hook = weechat_hooks[HOOK_TYPE_INFO];
@@ -3106,11 +5489,13 @@ hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
                                    info_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             value = (HOOK_INFO(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  info_name,
                  arguments);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3185,6 +5570,7 @@ struct t_hashtable *
 hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
                          struct t_hashtable *hashtable)
 {
+    struct timeval time_start;
     struct t_hook *ptr_hook, *next_hook;
     struct t_hashtable *value;
 
@@ -3194,6 +5580,10 @@ hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
     if (!info_name || !info_name[0])
         return NULL;
 
+    /* load plugin waiting for its first use (if info belongs to it) */
+    if (plugin_lazy_plugins)
+        plugin_lazy_load_name (info_name, 0);
+
     hook_exec_start ();
 
     ptr_hook = weechat_hooks[HOOK_TYPE_INFO_HASHTABLE];
@@ -3207,11 +5597,13 @@ hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
                                    info_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             value = (HOOK_INFO_HASHTABLE(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  info_name,
                  hashtable);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3286,6 +5678,7 @@ struct t_infolist *
 hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
                    void *pointer, const char *arguments)
 {
+    struct timeval time_start;
     struct t_hook *ptr_hook, *next_hook;
     struct t_infolist *value;
 
@@ -3295,6 +5688,10 @@ hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
     if (!infolist_name || !infolist_name[0])
         return NULL;
 
+    /* load plugin waiting for its first use (if infolist belongs to it) */
+    if (plugin_lazy_plugins)
+        plugin_lazy_load_name (infolist_name, 0);
+
     hook_exec_start ();
 
     ptr_hook = weechat_hooks[HOOK_TYPE_INFOLIST];
@@ -3308,12 +5705,14 @@ hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
                                    infolist_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             value = (HOOK_INFOLIST(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  infolist_name,
                  pointer,
                  arguments);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3382,6 +5781,7 @@ hook_hdata (struct t_weechat_plugin *plugin, const char *hdata_name,
 struct t_hdata *
 hook_hdata_get (struct t_weechat_plugin *plugin, const char *hdata_name)
 {
+    struct timeval time_start;
     struct t_hook *ptr_hook, *next_hook;
     struct t_hdata *value;
 
@@ -3410,10 +5810,12 @@ hook_hdata_get (struct t_weechat_plugin *plugin, const char *hdata_name)
             && (strcmp (HOOK_HDATA(ptr_hook, hdata_name), hdata_name) == 0))
         {
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             value = (HOOK_HDATA(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  HOOK_HDATA(ptr_hook, hdata_name));
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3527,12 +5929,15 @@ hook_focus_hashtable_map2_cb (void *data,
  *
  * Argument hashtable_focus2 is not NULL only for a mouse gesture (it's for
  * point where mouse button has been released).
+ *
+ * Note: result must be given back with hashtable_pool_release after use.
  */
 
 struct t_hashtable *
 hook_focus_get_data (struct t_hashtable *hashtable_focus1,
                      struct t_hashtable *hashtable_focus2)
 {
+    struct timeval time_start;
     struct t_hook *ptr_hook, *next_hook;
     struct t_hashtable *hashtable1, *hashtable2, *hashtable_ret;
     const char *focus1_chat, *focus1_bar_item_name, *keys;
@@ -3546,10 +5951,11 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
     focus1_is_chat = (focus1_chat && (strcmp (focus1_chat, "1") == 0));
     focus1_bar_item_name = hashtable_get (hashtable_focus1, "_bar_item_name");
 
-    hashtable1 = hashtable_dup (hashtable_focus1);
+    hashtable1 = hashtable_pool_dup (hashtable_focus1);
     if (!hashtable1)
         return NULL;
-    hashtable2 = (hashtable_focus2) ? hashtable_dup (hashtable_focus2) : NULL;
+    hashtable2 = (hashtable_focus2) ?
+        hashtable_pool_dup (hashtable_focus2) : NULL;
 
     hook_exec_start ();
 
@@ -3567,10 +5973,12 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
         {
             /* run callback for focus #1 */
             ptr_hook->running = 1;
+            hook_callback_start (ptr_hook, &time_start);
             hashtable_ret = (HOOK_FOCUS(ptr_hook, callback))
                 (ptr_hook->callback_pointer,
                  ptr_hook->callback_data,
                  hashtable1);
+            hook_callback_end (ptr_hook, &time_start);
             ptr_hook->running = 0;
             if (hashtable_ret)
             {
@@ -3591,10 +5999,12 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
             if (hashtable2)
             {
                 ptr_hook->running = 1;
+                hook_callback_start (ptr_hook, &time_start);
                 hashtable_ret = (HOOK_FOCUS(ptr_hook, callback))
                     (ptr_hook->callback_pointer,
                      ptr_hook->callback_data,
                      hashtable2);
+                hook_callback_end (ptr_hook, &time_start);
                 ptr_hook->running = 0;
                 if (hashtable_ret)
                 {
@@ -3620,7 +6030,7 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
     {
         hashtable_map (hashtable2,
                        &hook_focus_hashtable_map2_cb, hashtable1);
-        hashtable_free (hashtable2);
+        hashtable_pool_release (hashtable2);
     }
     else
     {
@@ -3713,7 +6123,7 @@ hook_set (struct t_hook *hook, const char *property, const char *value)
             }
             if (number >= 0)
             {
-                rc = kill (HOOK_PROCESS(hook, child_pid), (int)number);
+                rc = hook_process_kill_child (hook, (int)number);
                 if (rc < 0)
                 {
                     gui_chat_printf (NULL,
@@ -3754,6 +6164,20 @@ unhook (struct t_hook *hook)
                          plugin_get_name (hook->plugin));
     }
 
+    /* cancel the warning/removal scheduled when budget was exceeded */
+    if (hook->hook_budget_timer)
+    {
+        unhook (hook->hook_budget_timer);
+        hook->hook_budget_timer = NULL;
+    }
+
+    /* remove hook from index (before its data is freed) */
+    hook_index_remove (hook);
+    hook_priority_remove (hook);
+    if (hook_pointers)
+        hashtable_remove (hook_pointers, hook);
+    hooks_changes[hook->type]++;
+
     /* free data specific to the hook */
     if (hook->hook_data)
     {
@@ -3793,6 +6217,7 @@ unhook (struct t_hook *hook)
                             free (HOOK_COMMAND(hook, cplt_templates)[i]);
                         if (HOOK_COMMAND(hook, cplt_templates_static)[i])
                             free (HOOK_COMMAND(hook, cplt_templates_static)[i]);
+                        string_free_split (HOOK_COMMAND(hook, cplt_templates_static_items)[i]);
                         string_free_split (HOOK_COMMAND(hook, cplt_template_args)[i]);
                     }
                     free (HOOK_COMMAND(hook, cplt_templates));
@@ -3802,6 +6227,16 @@ unhook (struct t_hook *hook)
                     free (HOOK_COMMAND(hook, cplt_templates_static));
                     HOOK_COMMAND(hook, cplt_templates_static) = NULL;
                 }
+                if (HOOK_COMMAND(hook, cplt_templates_static_num_items))
+                {
+                    free (HOOK_COMMAND(hook, cplt_templates_static_num_items));
+                    HOOK_COMMAND(hook, cplt_templates_static_num_items) = NULL;
+                }
+                if (HOOK_COMMAND(hook, cplt_templates_static_items))
+                {
+                    free (HOOK_COMMAND(hook, cplt_templates_static_items));
+                    HOOK_COMMAND(hook, cplt_templates_static_items) = NULL;
+                }
                 if (HOOK_COMMAND(hook, cplt_template_num_args))
                 {
                     free (HOOK_COMMAND(hook, cplt_template_num_args));
@@ -3832,8 +6267,12 @@ unhook (struct t_hook *hook)
                 }
                 break;
             case HOOK_TYPE_TIMER:
+                hook_timer_heap_remove (hook);
                 break;
             case HOOK_TYPE_FD:
+                hook_fd_backend_remove (hook);
+                if (hook_search_fd (HOOK_FD(hook, fd)) == hook)
+                    hook_fd_table_set (HOOK_FD(hook, fd), NULL);
                 break;
             case HOOK_TYPE_PROCESS:
                 if (HOOK_PROCESS(hook, command))
@@ -3866,10 +6305,19 @@ unhook (struct t_hook *hook)
                     unhook (HOOK_PROCESS(hook, hook_timer));
                     HOOK_PROCESS(hook, hook_timer) = NULL;
                 }
+                if (HOOK_PROCESS(hook, url_transfer))
+                {
+                    /* a process may be started from the queue */
+                    hook_process_pending = 1;
+                    weeurl_multi_remove (hook);
+                }
                 if (HOOK_PROCESS(hook, child_pid) > 0)
                 {
-                    kill (HOOK_PROCESS(hook, child_pid), SIGKILL);
-                    waitpid (HOOK_PROCESS(hook, child_pid), NULL, 0);
+                    /* a process may be started from the queue */
+                    hook_process_pending = 1;
+                    hook_process_kill_child (hook, SIGKILL);
+                    if (!HOOK_PROCESS(hook, child_spawned))
+                        waitpid (HOOK_PROCESS(hook, child_pid), NULL, 0);
                     HOOK_PROCESS(hook, child_pid) = 0;
                 }
                 if (HOOK_PROCESS(hook, child_read[HOOK_PROCESS_STDIN]) != -1)
@@ -4010,11 +6458,12 @@ unhook (struct t_hook *hook)
                 }
                 break;
             case HOOK_TYPE_PRINT:
+                hook_print_bucket_remove (hook);
                 if (HOOK_PRINT(hook, tags_array))
                 {
                     for (i = 0; i < HOOK_PRINT(hook, tags_count); i++)
                     {
-                        string_free_split (HOOK_PRINT(hook, tags_array)[i]);
+                        string_free_split_shared (HOOK_PRINT(hook, tags_array)[i]);
                     }
                     free (HOOK_PRINT(hook, tags_array));
                     HOOK_PRINT(hook, tags_array) = NULL;
@@ -4177,7 +6626,7 @@ unhook (struct t_hook *hook)
     {
         /* there is one or more hook exec, then delete later */
         hook->deleted = 1;
-        real_delete_pending = 1;
+        arraylist_add (hooks_deleted, hook);
     }
 }
 
@@ -4231,6 +6680,62 @@ unhook_all ()
             ptr_hook = next_hook;
         }
     }
+
+    if (hook_timer_heap && (hook_timer_heap_count == 0))
+    {
+        free (hook_timer_heap);
+        hook_timer_heap = NULL;
+        hook_timer_heap_size = 0;
+    }
+}
+
+/*
+ * Returns hdata for hook.
+ */
+
+struct t_hdata *
+hook_hdata_hook_cb (const void *pointer, void *data,
+                    const char *hdata_name)
+{
+    struct t_hdata *hdata;
+    char str_list[128];
+    int i;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    hdata = hdata_new (NULL, hdata_name, "prev_hook", "next_hook",
+                       0, 0, NULL, NULL);
+    if (hdata)
+    {
+        HDATA_VAR(struct t_hook, plugin, POINTER, 0, NULL, "plugin");
+        HDATA_VAR(struct t_hook, subplugin, STRING, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, type, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, deleted, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, running, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, priority, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, callback_pointer, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, callback_data, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, calls, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, time_total, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, time_max, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, budget_exceeded, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, hook_data, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, prev_hook, POINTER, 0, NULL, hdata_name);
+        HDATA_VAR(struct t_hook, next_hook, POINTER, 0, NULL, hdata_name);
+        for (i = 0; i < HOOK_NUM_TYPES; i++)
+        {
+            snprintf (str_list, sizeof (str_list),
+                      "weechat_hooks_%s", hook_type_string[i]);
+            hdata_new_list (hdata, str_list, &weechat_hooks[i],
+                            WEECHAT_HDATA_LIST_CHECK_POINTERS);
+            snprintf (str_list, sizeof (str_list),
+                      "last_weechat_hook_%s", hook_type_string[i]);
+            hdata_new_list (hdata, str_list, &last_weechat_hook[i], 0);
+        }
+    }
+    return hdata;
 }
 
 /*
@@ -4273,6 +6778,18 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
         return 0;
     if (!infolist_new_var_pointer (ptr_item, "callback_data", (void *)hook->callback_data))
         return 0;
+    snprintf (value, sizeof (value), "%ld", hook->calls);
+    if (!infolist_new_var_string (ptr_item, "calls", value))
+        return 0;
+    snprintf (value, sizeof (value), "%ld", hook->time_total);
+    if (!infolist_new_var_string (ptr_item, "time_total", value))
+        return 0;
+    snprintf (value, sizeof (value), "%ld", hook->time_max);
+    if (!infolist_new_var_string (ptr_item, "time_max", value))
+        return 0;
+    snprintf (value, sizeof (value), "%ld", hook->budget_exceeded);
+    if (!infolist_new_var_string (ptr_item, "budget_exceeded", value))
+        return 0;
     switch (hook->type)
     {
         case HOOK_TYPE_COMMAND:
@@ -4389,6 +6906,14 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_timer", HOOK_PROCESS(hook, hook_timer)))
                     return 0;
+                if (!infolist_new_var_integer (ptr_item, "queued", ((HOOK_PROCESS(hook, child_pid) == 0) && !HOOK_PROCESS(hook, url_transfer)) ? 1 : 0))
+                    return 0;
+                if (!infolist_new_var_buffer (ptr_item, "time_queued",
+                                              &(HOOK_PROCESS(hook, time_queued)),
+                                              sizeof (HOOK_PROCESS(hook, time_queued))))
+                    return 0;
+                if (!infolist_new_var_pointer (ptr_item, "url_transfer", HOOK_PROCESS(hook, url_transfer)))
+                    return 0;
             }
             break;
         case HOOK_TYPE_CONNECT:
@@ -4751,6 +7276,11 @@ hook_print_log ()
             log_printf ("  priority. . . . . . . . : %d",    ptr_hook->priority);
             log_printf ("  callback_pointer. . . . : 0x%lx", ptr_hook->callback_pointer);
             log_printf ("  callback_data . . . . . : 0x%lx", ptr_hook->callback_data);
+            log_printf ("  calls . . . . . . . . . : %ld",   ptr_hook->calls);
+            log_printf ("  time_total. . . . . . . : %ld",   ptr_hook->time_total);
+            log_printf ("  time_max. . . . . . . . : %ld",   ptr_hook->time_max);
+            log_printf ("  budget_exceeded . . . . : %ld",   ptr_hook->budget_exceeded);
+            log_printf ("  hook_budget_timer . . . : 0x%lx", ptr_hook->hook_budget_timer);
             if (ptr_hook->deleted)
                 continue;
             switch (ptr_hook->type)
@@ -4820,6 +7350,7 @@ hook_print_log ()
                                 HOOK_TIMER(ptr_hook, next_exec.tv_sec),
                                 text_time);
                     log_printf ("    next_exec.tv_usec . . : %ld",   HOOK_TIMER(ptr_hook, next_exec.tv_usec));
+                    log_printf ("    heap_index. . . . . . : %d",    HOOK_TIMER(ptr_hook, heap_index));
                     break;
                 case HOOK_TYPE_FD:
                     log_printf ("  fd data:");
@@ -4827,6 +7358,7 @@ hook_print_log ()
                     log_printf ("    fd. . . . . . . . . . : %d",    HOOK_FD(ptr_hook, fd));
                     log_printf ("    flags . . . . . . . . : %d",    HOOK_FD(ptr_hook, flags));
                     log_printf ("    error . . . . . . . . : %d",    HOOK_FD(ptr_hook, error));
+                    log_printf ("    poll_only . . . . . . : %d",    HOOK_FD(ptr_hook, poll_only));
                     break;
                 case HOOK_TYPE_PROCESS:
                     log_printf ("  process data:");
@@ -4845,10 +7377,16 @@ hook_print_log ()
                     log_printf ("    child_read[stderr]. . : %d",    HOOK_PROCESS(ptr_hook, child_read[HOOK_PROCESS_STDERR]));
                     log_printf ("    child_write[stderr] . : %d",    HOOK_PROCESS(ptr_hook, child_write[HOOK_PROCESS_STDERR]));
                     log_printf ("    child_pid . . . . . . : %d",    HOOK_PROCESS(ptr_hook, child_pid));
+                    log_printf ("    child_spawned . . . . : %d",    HOOK_PROCESS(ptr_hook, child_spawned));
+                    log_printf ("    child_ended . . . . . : %d",    HOOK_PROCESS(ptr_hook, child_ended));
+                    log_printf ("    child_status. . . . . : %d",    HOOK_PROCESS(ptr_hook, child_status));
                     log_printf ("    hook_fd[stdin]. . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDIN]));
                     log_printf ("    hook_fd[stdout] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDOUT]));
                     log_printf ("    hook_fd[stderr] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDERR]));
                     log_printf ("    hook_timer. . . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_timer));
+                    log_printf ("    time_queued.tv_sec. . : %ld",   HOOK_PROCESS(ptr_hook, time_queued.tv_sec));
+                    log_printf ("    time_queued.tv_usec . : %ld",   HOOK_PROCESS(ptr_hook, time_queued.tv_usec));
+                    log_printf ("    url_transfer. . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, url_transfer));
                     break;
                 case HOOK_TYPE_CONNECT:
                     log_printf ("  connect data:");
@@ -39,6 +39,7 @@ struct t_gui_window;
 struct t_weelist;
 struct t_hashtable;
 struct t_infolist;
+struct t_url_transfer;
 
 /* hook types */
 
@@ -125,9 +126,24 @@ struct t_hook
     int deleted;                       /* hook marked for deletion ?        */
     int running;                       /* 1 if hook is currently running    */
     int priority;                      /* priority (to sort hooks)          */
+    unsigned long long number;         /* creation order of hook (used to   */
+                                       /* sort hooks with same priority)    */
     const void *callback_pointer;      /* pointer sent to callback          */
     void *callback_data;               /* data sent to callback             */
 
+    /* statistics on callback calls */
+    long calls;                        /* number of calls of callback       */
+    long time_total;                   /* total time spent in callback      */
+                                       /* (microseconds)                    */
+    long time_max;                     /* max time spent in one call        */
+                                       /* (microseconds)                    */
+    long budget_exceeded;              /* number of calls exceeding budget  */
+                                       /* (only for scripts, see option     */
+                                       /* weechat.plugin.script_callback_   */
+                                       /* budget)                           */
+    struct t_hook *hook_budget_timer;  /* timer to warn/unhook when budget  */
+                                       /* is exceeded (removed with hook)   */
+
     /* hook data (depends on hook type) */
     void *hook_data;                   /* hook specific data                */
     struct t_hook *prev_hook;          /* link to previous hook             */
@@ -154,6 +170,9 @@ struct t_hook_command
     char **cplt_templates;              /* completion templates             */
     char **cplt_templates_static;       /* static part of template (at      */
                                         /* beginning                        */
+    int *cplt_templates_static_num_items; /* number of items in static part */
+    char ***cplt_templates_static_items; /* items of static part (split on  */
+                                        /* "|")                             */
 
     /* arguments for each template */
     int *cplt_template_num_args;        /* number of arguments for template */
@@ -190,6 +209,8 @@ struct t_hook_timer
     int remaining_calls;               /* calls remaining (0 = unlimited)   */
     struct timeval last_exec;          /* last time hook was executed       */
     struct timeval next_exec;          /* next scheduled execution          */
+    int heap_index;                    /* position in heap of timers        */
+                                       /* (-1 if not in heap)               */
 };
 
 /* hook fd */
@@ -203,6 +224,8 @@ struct t_hook_fd
     int flags;                         /* fd flags (read,write,..)          */
     int error;                         /* contains errno if error occurred  */
                                        /* with fd                           */
+    int poll_only;                     /* 1 if fd is not supported by       */
+                                       /* epoll/kqueue (checked with poll)  */
 };
 
 /* hook process */
@@ -222,11 +245,18 @@ struct t_hook_process
     int child_read[3];                 /* read stdin/out/err data from child*/
     int child_write[3];                /* write stdin/out/err data for child*/
     pid_t child_pid;                   /* pid of child process              */
+    int child_spawned;                 /* 1 if child started by spawn helper*/
+    int child_ended;                   /* 1 if spawned child has ended      */
+    int child_status;                  /* exit status of spawned child      */
     struct t_hook *hook_fd[3];         /* hook fd for stdin/out/err         */
     struct t_hook *hook_timer;         /* timer to check if child has died  */
     char *buffer[3];                   /* buffers for child stdin/out/err   */
     int buffer_size[3];                /* size of child stdin/out/err       */
     int buffer_flush;                  /* bytes to flush output buffers     */
+    struct timeval time_queued;        /* time of creation (the process is  */
+                                       /* queued until it can be started)   */
+    struct t_url_transfer *url_transfer; /* download of URL in WeeChat      */
+                                       /* process (instead of a child)      */
 };
 
 /* hook connect */
@@ -438,6 +468,54 @@ struct t_hook_focus
     char *area;                         /* "chat" or bar item name          */
 };
 
+/*
+ * index of hooks by name (for some hook types like signals): masks without
+ * wildcard are stored in a hashtable (lower case name -> list of hooks),
+ * masks with wildcards are stored by prefix (before first "*") or by
+ * suffix (after last "*"), and masks without prefix/suffix (like "*") are
+ * stored in a separate list; all lists are sorted like list of hooks
+ * (priority, then creation order)
+ */
+
+#define HOOK_INDEX_MAX_AFFIX    64
+
+struct t_hook_index
+{
+    int wildcards;                     /* 1 if "*" is allowed in mask       */
+    int prefix_match;                  /* 1 if a mask without "*" and space */
+                                       /* matches names beginning with mask */
+                                       /* (like commands in command_run)    */
+    struct t_hashtable *names;         /* masks without wildcard            */
+    struct t_hashtable *prefixes;      /* masks with prefix before "*"      */
+    struct t_hashtable *suffixes;      /* masks with suffix after "*"       */
+    struct t_arraylist *others;        /* other masks (like "*")            */
+    int prefixes_count[HOOK_INDEX_MAX_AFFIX + 1]; /* count by prefix length */
+    int suffixes_count[HOOK_INDEX_MAX_AFFIX + 1]; /* count by suffix length */
+    int count;                         /* number of hooks in index          */
+};
+
+/* hooks found in index (the first ones are stored without malloc) */
+
+#define HOOK_INDEX_RESULT_STATIC 32
+
+struct t_hook_index_result
+{
+    struct t_hook **hooks;             /* hooks found (sorted)              */
+    int count;                         /* number of hooks found             */
+    int size;                          /* allocated size for hooks          */
+    struct t_hook *hooks_static[HOOK_INDEX_RESULT_STATIC];
+};
+
+/* hooks with same priority in list of hooks (used to find position of hook) */
+
+struct t_hook_priority
+{
+    int priority;                      /* priority of hooks                 */
+    int count;                         /* number of hooks (not deleted)     */
+    struct t_hook *first_hook;         /* first hook (not deleted) with     */
+                                       /* this priority in list             */
+};
+
 /* hook variables */
 
 extern char *hook_type_string[];
@@ -445,12 +523,26 @@ extern struct t_hook *weechat_hooks[];
 extern struct t_hook *last_weechat_hook[];
 extern int hooks_count[];
 extern int hooks_count_total;
+extern int hooks_changes[];
+extern struct t_hook_index *hook_index[];
+extern struct t_arraylist *hook_priorities[];
+extern int hook_process_pending;
 extern int hook_socketpair_ok;
 
 /* hook functions */
 
 extern void hook_init ();
 extern int hook_valid (struct t_hook *hook);
+extern void hook_index_search (struct t_hook_index *index, const char *name,
+                               struct t_hook_index_result *result);
+extern void hook_index_result_free (struct t_hook_index_result *result);
+extern void hook_callback_start (struct t_hook *hook,
+                                 struct timeval *time_start);
+extern void hook_callback_end (struct t_hook *hook,
+                               struct timeval *time_start);
+extern void hook_get_description (struct t_hook *hook, char *description,
+                                  int size);
+extern void hook_stats_reset ();
 extern struct t_hook *hook_command (struct t_weechat_plugin *plugin,
                                     const char *command,
                                     const char *description,
@@ -483,7 +575,8 @@ extern struct t_hook *hook_fd (struct t_weechat_plugin *plugin, int fd,
                                t_hook_callback_fd *callback,
                                const void *callback_pointer,
                                void *callback_data);
-extern void hook_fd_exec ();
+extern void hook_fd_set_flags (struct t_hook *hook, int flags);
+extern void hook_fd_exec (int max_timeout);
 extern struct t_hook *hook_process (struct t_weechat_plugin *plugin,
                                     const char *command,
                                     int timeout,
@@ -497,7 +590,15 @@ extern struct t_hook *hook_process_hashtable (struct t_weechat_plugin *plugin,
                                               t_hook_callback_process *callback,
                                               const void *callback_pointer,
                                               void *callback_data);
+extern int hook_process_count (struct t_weechat_plugin *plugin,
+                               int all_plugins, int queued);
+extern void hook_process_send_buffers (struct t_hook *hook_process,
+                                       int callback_rc);
+extern void hook_process_add_to_buffer (struct t_hook *hook_process,
+                                        int index_buffer,
+                                        const char *buffer, int size);
 extern void hook_process_exec ();
+extern void hook_process_child_exited (pid_t pid, int status);
 extern struct t_hook *hook_connect (struct t_weechat_plugin *plugin,
                                     const char *proxy, const char *address,
                                     int port, int ipv6, int retry,
@@ -573,6 +674,8 @@ extern char *hook_modifier_exec (struct t_weechat_plugin *plugin,
                                  const char *modifier,
                                  const char *modifier_data,
                                  const char *string);
+extern int hook_modifier_exists (struct t_weechat_plugin *plugin,
+                                 const char *modifier);
 extern struct t_hook *hook_info (struct t_weechat_plugin *plugin,
                                  const char *info_name,
                                  const char *description,
@@ -627,6 +730,8 @@ extern void unhook (struct t_hook *hook);
 extern void unhook_all_plugin (struct t_weechat_plugin *plugin,
                                const char *subplugin);
 extern void unhook_all ();
+extern struct t_hdata *hook_hdata_hook_cb (const void *pointer, void *data,
+                                          const char *hdata_name);
 extern int hook_add_to_infolist (struct t_infolist *infolist,
                                  struct t_hook *hook,
                                  const char *arguments);
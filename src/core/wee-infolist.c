@@ -25,11 +25,15 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <wctype.h>
 
 #include "weechat.h"
+#include "wee-hashtable.h"
 #include "wee-log.h"
 #include "wee-string.h"
+#include "wee-utf8.h"
 #include "wee-infolist.h"
+#include "../plugins/plugin.h"
 
 
 struct t_infolist *weechat_infolists = NULL;
@@ -51,9 +55,13 @@ infolist_new (struct t_weechat_plugin *plugin)
     if (new_infolist)
     {
         new_infolist->plugin = plugin;
+        new_infolist->schemas = NULL;
         new_infolist->items = NULL;
         new_infolist->last_item = NULL;
         new_infolist->ptr_item = NULL;
+        new_infolist->stream_callback = NULL;
+        new_infolist->stream_free_callback = NULL;
+        new_infolist->stream_data = NULL;
 
         new_infolist->prev_infolist = last_weechat_infolist;
         new_infolist->next_infolist = NULL;
@@ -94,9 +102,236 @@ infolist_valid (struct t_infolist *infolist)
     return 0;
 }
 
+/*
+ * Sets callbacks to build items of an infolist on demand (streamed infolist).
+ *
+ * Instead of building all items before returning the infolist, the provider
+ * builds one item at a time, when the caller moves in the infolist:
+ * the callback is called with direction 1 for infolist_next, -1 for
+ * infolist_prev and 0 for infolist_reset_item_cursor, and it must add one
+ * item with infolist_new_item (except for direction 0) and return 1, or
+ * return 0 if there is no more item.
+ *
+ * Only the current item is kept in memory. The callback "free_callback"
+ * (can be NULL) is called with "stream_data" when the infolist is freed.
+ */
+
+void
+infolist_set_stream (struct t_infolist *infolist,
+                     int (*callback)(void *stream_data,
+                                     struct t_infolist *infolist,
+                                     int direction),
+                     void (*free_callback)(void *stream_data),
+                     void *stream_data)
+{
+    if (!infolist)
+        return;
+
+    infolist->stream_callback = callback;
+    infolist->stream_free_callback = free_callback;
+    infolist->stream_data = stream_data;
+}
+
+/*
+ * Hashes a field name (case insensitive).
+ */
+
+unsigned long long
+infolist_schema_hash_key_cb (struct t_hashtable *hashtable, const void *key)
+{
+    const char *ptr_key;
+    unsigned long long hash;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    /* variant of djb2 hash, with chars converted to lower case */
+    hash = 5381;
+    for (ptr_key = (const char *)key; ptr_key[0];
+         ptr_key = utf8_next_char (ptr_key))
+    {
+        hash ^= (hash << 5) + (hash >> 2)
+            + (unsigned long long)towlower (utf8_wide_char (ptr_key));
+    }
+
+    return hash;
+}
+
+/*
+ * Compares two field names (case insensitive).
+ */
+
+int
+infolist_schema_keycmp_cb (struct t_hashtable *hashtable,
+                           const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    return string_strcasecmp ((const char *)key1, (const char *)key2);
+}
+
+/*
+ * Creates a new schema in an infolist, with first "count" fields of another
+ * schema (can be NULL).
+ *
+ * Returns pointer to new schema, NULL if error.
+ */
+
+struct t_infolist_schema *
+infolist_schema_new (struct t_infolist *infolist,
+                     struct t_infolist_schema *schema, int count)
+{
+    struct t_infolist_schema *new_schema;
+    int i;
+
+    new_schema = malloc (sizeof (*new_schema));
+    if (!new_schema)
+        return NULL;
+
+    new_schema->fields_size = (count < 8) ? 8 : count * 2;
+    new_schema->fields = malloc (new_schema->fields_size *
+                                 sizeof (new_schema->fields[0]));
+    if (!new_schema->fields)
+    {
+        free (new_schema);
+        return NULL;
+    }
+    new_schema->fields_count = 0;
+    for (i = 0; i < count; i++)
+    {
+        new_schema->fields[i].name = strdup (schema->fields[i].name);
+        if (!new_schema->fields[i].name)
+            break;
+        new_schema->fields[i].type = schema->fields[i].type;
+        new_schema->fields_count++;
+    }
+    new_schema->index = NULL;
+    new_schema->fields_string = NULL;
+
+    new_schema->next_schema = infolist->schemas;
+    infolist->schemas = new_schema;
+
+    return new_schema;
+}
+
+/*
+ * Adds a field at the end of a schema.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+infolist_schema_add_field (struct t_infolist_schema *schema,
+                           const char *name, enum t_infolist_type type)
+{
+    struct t_infolist_field *new_fields;
+    int new_size, index;
+
+    if (schema->fields_count >= schema->fields_size)
+    {
+        new_size = schema->fields_size * 2;
+        new_fields = realloc (schema->fields,
+                              new_size * sizeof (schema->fields[0]));
+        if (!new_fields)
+            return 0;
+        schema->fields = new_fields;
+        schema->fields_size = new_size;
+    }
+
+    index = schema->fields_count;
+    schema->fields[index].name = strdup (name);
+    if (!schema->fields[index].name)
+        return 0;
+    schema->fields[index].type = type;
+    schema->fields_count++;
+
+    /* update index (the first field with a name is kept) */
+    if (schema->index
+        && !hashtable_has_key (schema->index, schema->fields[index].name))
+    {
+        hashtable_set (schema->index, schema->fields[index].name, &index);
+    }
+
+    if (schema->fields_string)
+    {
+        free (schema->fields_string);
+        schema->fields_string = NULL;
+    }
+
+    return 1;
+}
+
+/*
+ * Searches for a field in a schema (case insensitive).
+ *
+ * Returns index of field, -1 if not found.
+ */
+
+int
+infolist_schema_search_field (struct t_infolist_schema *schema,
+                              const char *name)
+{
+    int i, *ptr_index;
+
+    if (!schema->index)
+    {
+        schema->index = hashtable_new (0,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_INTEGER,
+                                       &infolist_schema_hash_key_cb,
+                                       &infolist_schema_keycmp_cb);
+        if (!schema->index)
+        {
+            for (i = 0; i < schema->fields_count; i++)
+            {
+                if (string_strcasecmp (schema->fields[i].name, name) == 0)
+                    return i;
+            }
+            return -1;
+        }
+        for (i = 0; i < schema->fields_count; i++)
+        {
+            if (!hashtable_has_key (schema->index, schema->fields[i].name))
+                hashtable_set (schema->index, schema->fields[i].name, &i);
+        }
+    }
+
+    ptr_index = hashtable_get (schema->index, name);
+
+    return (ptr_index) ? *ptr_index : -1;
+}
+
+/*
+ * Frees a schema.
+ */
+
+void
+infolist_schema_free (struct t_infolist_schema *schema)
+{
+    int i;
+
+    for (i = 0; i < schema->fields_count; i++)
+    {
+        free (schema->fields[i].name);
+    }
+    free (schema->fields);
+    if (schema->index)
+        hashtable_free (schema->index);
+    if (schema->fields_string)
+        free (schema->fields_string);
+
+    free (schema);
+}
+
 /*
  * Creates a new item in an infolist.
  *
+ * The item uses the same schema as the previous item (items of an infolist
+ * have usually the same fields).
+ *
  * Returns pointer to new item, NULL if error.
  */
 
@@ -108,8 +343,20 @@ infolist_new_item (struct t_infolist *infolist)
     new_item = malloc (sizeof (*new_item));
     if (new_item)
     {
+        new_item->infolist = infolist;
+        new_item->schema = (infolist->last_item) ?
+            infolist->last_item->schema : NULL;
+        new_item->vars_size = (new_item->schema) ?
+            new_item->schema->fields_count : 0;
         new_item->vars = NULL;
-        new_item->last_var = NULL;
+        if (new_item->vars_size > 0)
+        {
+            new_item->vars = malloc (new_item->vars_size *
+                                     sizeof (new_item->vars[0]));
+            if (!new_item->vars)
+                new_item->vars_size = 0;
+        }
+        new_item->vars_count = 0;
         new_item->fields = NULL;
 
         new_item->prev_item = infolist->last_item;
@@ -124,6 +371,71 @@ infolist_new_item (struct t_infolist *infolist)
     return new_item;
 }
 
+/*
+ * Creates a new variable in an item: the field is added in schema of item if
+ * needed (a new schema is created if the item has different fields than the
+ * other items using its schema).
+ *
+ * Returns pointer to new variable, NULL if error.
+ */
+
+struct t_infolist_var *
+infolist_new_var (struct t_infolist_item *item,
+                  const char *name, enum t_infolist_type type)
+{
+    struct t_infolist_schema *ptr_schema;
+    struct t_infolist_var *new_vars, *new_var;
+    int index, new_size;
+
+    index = item->vars_count;
+    ptr_schema = item->schema;
+
+    if (!ptr_schema
+        || (index >= ptr_schema->fields_count)
+        || (ptr_schema->fields[index].type != type)
+        || (strcmp (ptr_schema->fields[index].name, name) != 0))
+    {
+        /*
+         * the field can be added at the end of schema if no other item uses
+         * the next fields, otherwise a new schema is created
+         */
+        if (!ptr_schema || (index < ptr_schema->fields_count))
+        {
+            ptr_schema = infolist_schema_new (item->infolist, ptr_schema,
+                                              index);
+            if (!ptr_schema)
+                return NULL;
+            if (ptr_schema->fields_count < index)
+                return NULL;
+            item->schema = ptr_schema;
+        }
+        if (!infolist_schema_add_field (ptr_schema, name, type))
+            return NULL;
+    }
+
+    if (index >= item->vars_size)
+    {
+        new_size = (item->vars_size < 8) ? 8 : item->vars_size * 2;
+        new_vars = realloc (item->vars, new_size * sizeof (item->vars[0]));
+        if (!new_vars)
+            return NULL;
+        item->vars = new_vars;
+        item->vars_size = new_size;
+    }
+
+    new_var = &(item->vars[index]);
+    memset (new_var, 0, sizeof (*new_var));
+    item->vars_count++;
+
+    if (item->fields)
+    {
+        free (item->fields);
+        item->fields = NULL;
+    }
+
+    return new_var;
+}
+
 /*
  * Creates a new integer variable in an item.
  *
@@ -139,23 +451,9 @@ infolist_new_var_integer (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_new_var (item, name, INFOLIST_INTEGER);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_INTEGER;
-        new_var->value = malloc (sizeof (int));
-        if (new_var->value)
-            *((int *)new_var->value) = value;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.integer = value;
 
     return new_var;
 }
@@ -175,21 +473,9 @@ infolist_new_var_string (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_new_var (item, name, INFOLIST_STRING);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_STRING;
-        new_var->value = (value) ? strdup (value) : NULL;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.string = (value) ? strdup (value) : NULL;
 
     return new_var;
 }
@@ -209,21 +495,9 @@ infolist_new_var_pointer (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_new_var (item, name, INFOLIST_POINTER);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_POINTER;
-        new_var->value = pointer;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.pointer = pointer;
 
     return new_var;
 }
@@ -243,23 +517,13 @@ infolist_new_var_buffer (struct t_infolist_item *item,
     if (!item || !name || !name[0] || (size <= 0))
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_new_var (item, name, INFOLIST_BUFFER);
     if (new_var)
     {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_BUFFER;
-        new_var->value = malloc (size);
-        if (new_var->value)
-            memcpy (new_var->value, pointer, size);
+        new_var->value.pointer = malloc (size);
+        if (new_var->value.pointer)
+            memcpy (new_var->value.pointer, pointer, size);
         new_var->size = size;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
     }
 
     return new_var;
@@ -280,25 +544,119 @@ infolist_new_var_time (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_new_var (item, name, INFOLIST_TIME);
     if (new_var)
+        new_var->value.time = time;
+
+    return new_var;
+}
+
+/*
+ * Frees an item in infolist.
+ */
+
+void
+infolist_item_free (struct t_infolist *infolist,
+                    struct t_infolist_item *item)
+{
+    struct t_infolist_item *new_items;
+    int i;
+
+    /* remove var */
+    if (infolist->last_item == item)
+        infolist->last_item = item->prev_item;
+    if (item->prev_item)
     {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_TIME;
-        new_var->value = malloc (sizeof (time_t));
-        if (new_var->value)
-            *((time_t *)new_var->value) = time;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
+        (item->prev_item)->next_item = item->next_item;
+        new_items = infolist->items;
+    }
+    else
+        new_items = item->next_item;
+
+    if (item->next_item)
+        (item->next_item)->prev_item = item->prev_item;
+
+    /* free data */
+    for (i = 0; i < item->vars_count; i++)
+    {
+        switch (item->schema->fields[i].type)
+        {
+            case INFOLIST_STRING:
+                if (item->vars[i].value.string)
+                    free (item->vars[i].value.string);
+                break;
+            case INFOLIST_BUFFER:
+                if (item->vars[i].value.pointer)
+                    free (item->vars[i].value.pointer);
+                break;
+            default:
+                break;
+        }
+    }
+    if (item->vars)
+        free (item->vars);
+    if (item->fields)
+        free (item->fields);
+
+    free (item);
+
+    infolist->items = new_items;
+}
+
+/*
+ * Moves cursor in a streamed infolist: the callback builds the new current
+ * item (direction: 1 = next, -1 = previous, 0 = reset cursor), then the
+ * previous item and schemas not used any more are freed.
+ *
+ * Returns pointer to new current item, NULL if end of infolist is reached.
+ */
+
+struct t_infolist_item *
+infolist_stream_move (struct t_infolist *infolist, int direction)
+{
+    struct t_infolist_item *ptr_old_last_item;
+    struct t_infolist_schema *ptr_schema, *ptr_next_schema, *ptr_prev_schema;
+    int rc;
+
+    ptr_old_last_item = infolist->last_item;
+
+    /* build new item (after old item, so that it can reuse its schema) */
+    rc = (infolist->stream_callback) (infolist->stream_data, infolist,
+                                      direction);
+
+    infolist->ptr_item = (rc && (infolist->last_item != ptr_old_last_item)) ?
+        infolist->last_item : NULL;
+
+    /* free all other items */
+    while (infolist->items && (infolist->items != infolist->ptr_item))
+    {
+        infolist_item_free (infolist, infolist->items);
+    }
+    while (infolist->last_item && (infolist->last_item != infolist->ptr_item))
+    {
+        infolist_item_free (infolist, infolist->last_item);
+    }
+
+    /* free schemas not used by current item */
+    ptr_prev_schema = NULL;
+    ptr_schema = infolist->schemas;
+    while (ptr_schema)
+    {
+        ptr_next_schema = ptr_schema->next_schema;
+        if (!infolist->ptr_item || (ptr_schema != infolist->ptr_item->schema))
+        {
+            if (ptr_prev_schema)
+                ptr_prev_schema->next_schema = ptr_next_schema;
+            else
+                infolist->schemas = ptr_next_schema;
+            infolist_schema_free (ptr_schema);
+        }
         else
-            item->vars = new_var;
-        item->last_var = new_var;
+            ptr_prev_schema = ptr_schema;
+        ptr_schema = ptr_next_schema;
     }
 
-    return new_var;
+    return infolist->ptr_item;
 }
 
 /*
@@ -310,6 +668,9 @@ infolist_new_var_time (struct t_infolist_item *item,
 struct t_infolist_item *
 infolist_next (struct t_infolist *infolist)
 {
+    if (infolist->stream_callback)
+        return infolist_stream_move (infolist, 1);
+
     if (!infolist->ptr_item)
     {
         infolist->ptr_item = infolist->items;
@@ -328,6 +689,9 @@ infolist_next (struct t_infolist *infolist)
 struct t_infolist_item *
 infolist_prev (struct t_infolist *infolist)
 {
+    if (infolist->stream_callback)
+        return infolist_stream_move (infolist, -1);
+
     if (!infolist->ptr_item)
     {
         infolist->ptr_item = infolist->last_item;
@@ -344,30 +708,55 @@ infolist_prev (struct t_infolist *infolist)
 void
 infolist_reset_item_cursor (struct t_infolist *infolist)
 {
+    if (infolist->stream_callback)
+    {
+        infolist_stream_move (infolist, 0);
+        return;
+    }
+
     infolist->ptr_item = NULL;
 }
 
 /*
  * Searches for a variable in current infolist item.
+ *
+ * Argument "type" is set with the type of variable (if found).
+ *
+ * Returns pointer to variable, NULL if not found.
  */
 
 struct t_infolist_var *
-infolist_search_var (struct t_infolist *infolist, const char *name)
+infolist_search_var_type (struct t_infolist *infolist, const char *name,
+                          enum t_infolist_type *type)
 {
-    struct t_infolist_var *ptr_var;
+    struct t_infolist_item *ptr_item;
+    int index;
 
     if (!infolist || !infolist->ptr_item || !name || !name[0])
         return NULL;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, name) == 0)
-            return ptr_var;
-    }
+    ptr_item = infolist->ptr_item;
+    if (!ptr_item->schema)
+        return NULL;
 
-    /* variable not found */
-    return NULL;
+    index = infolist_schema_search_field (ptr_item->schema, name);
+    if ((index < 0) || (index >= ptr_item->vars_count))
+        return NULL;
+
+    if (type)
+        *type = ptr_item->schema->fields[index].type;
+
+    return &(ptr_item->vars[index]);
+}
+
+/*
+ * Searches for a variable in current infolist item.
+ */
+
+struct t_infolist_var *
+infolist_search_var (struct t_infolist *infolist, const char *name)
+{
+    return infolist_search_var_type (infolist, name, NULL);
 }
 
 /*
@@ -377,55 +766,67 @@ infolist_search_var (struct t_infolist *infolist, const char *name)
 const char *
 infolist_fields (struct t_infolist *infolist)
 {
-    struct t_infolist_var *ptr_var;
-    int length;
+    struct t_infolist_item *ptr_item;
+    struct t_infolist_schema *ptr_schema;
+    char **fields;
+    int i, length;
 
     if (!infolist || !infolist->ptr_item)
         return NULL;
 
+    ptr_item = infolist->ptr_item;
+    ptr_schema = ptr_item->schema;
+    if (!ptr_schema)
+        return "";
+
+    /*
+     * the list of fields is stored in schema if the item has all fields of
+     * schema, otherwise in item
+     */
+    fields = (ptr_item->vars_count == ptr_schema->fields_count) ?
+        &ptr_schema->fields_string : &ptr_item->fields;
+
     /* list of fields already asked ? if yes, just return string */
-    if (infolist->ptr_item->fields)
-        return infolist->ptr_item->fields;
+    if (*fields)
+        return *fields;
 
     length = 0;
-    for (ptr_var = infolist->ptr_item->vars;
-         ptr_var; ptr_var = ptr_var->next_var)
+    for (i = 0; i < ptr_item->vars_count; i++)
     {
-        length += strlen (ptr_var->name) + 3;
+        length += strlen (ptr_schema->fields[i].name) + 3;
     }
 
-    infolist->ptr_item->fields = malloc (length + 1);
-    if (!infolist->ptr_item->fields)
+    *fields = malloc (length + 1);
+    if (!*fields)
         return NULL;
 
-    infolist->ptr_item->fields[0] = '\0';
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
+    (*fields)[0] = '\0';
+    for (i = 0; i < ptr_item->vars_count; i++)
     {
-        switch (ptr_var->type)
+        switch (ptr_schema->fields[i].type)
         {
             case INFOLIST_INTEGER:
-                strcat (infolist->ptr_item->fields, "i:");
+                strcat (*fields, "i:");
                 break;
             case INFOLIST_STRING:
-                strcat (infolist->ptr_item->fields, "s:");
+                strcat (*fields, "s:");
                 break;
             case INFOLIST_POINTER:
-                strcat (infolist->ptr_item->fields, "p:");
+                strcat (*fields, "p:");
                 break;
             case INFOLIST_BUFFER:
-                strcat (infolist->ptr_item->fields, "b:");
+                strcat (*fields, "b:");
                 break;
             case INFOLIST_TIME:
-                strcat (infolist->ptr_item->fields, "t:");
+                strcat (*fields, "t:");
                 break;
         }
-        strcat (infolist->ptr_item->fields, ptr_var->name);
-        if (ptr_var->next_var)
-            strcat (infolist->ptr_item->fields, ",");
+        strcat (*fields, ptr_schema->fields[i].name);
+        if (i < ptr_item->vars_count - 1)
+            strcat (*fields, ",");
     }
 
-    return infolist->ptr_item->fields;
+    return *fields;
 }
 
 /*
@@ -436,24 +837,13 @@ int
 infolist_integer (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
+    enum t_infolist_type type;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
+    ptr_var = infolist_search_var_type (infolist, var, &type);
+    if (!ptr_var || (type != INFOLIST_INTEGER))
         return 0;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_INTEGER)
-                return *((int *)ptr_var->value);
-            else
-                return 0;
-        }
-    }
-
-    /* variable not found */
-    return 0;
+    return ptr_var->value.integer;
 }
 
 /*
@@ -464,24 +854,13 @@ const char *
 infolist_string (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
+    enum t_infolist_type type;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
+    ptr_var = infolist_search_var_type (infolist, var, &type);
+    if (!ptr_var || (type != INFOLIST_STRING))
         return NULL;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_STRING)
-                return (char *)ptr_var->value;
-            else
-                return NULL;
-        }
-    }
-
-    /* variable not found */
-    return NULL;
+    return ptr_var->value.string;
 }
 
 /*
@@ -492,24 +871,13 @@ void *
 infolist_pointer (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
+    enum t_infolist_type type;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
+    ptr_var = infolist_search_var_type (infolist, var, &type);
+    if (!ptr_var || (type != INFOLIST_POINTER))
         return NULL;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_POINTER)
-                return ptr_var->value;
-            else
-                return NULL;
-        }
-    }
-
-    /* variable not found */
-    return NULL;
+    return ptr_var->value.pointer;
 }
 
 /*
@@ -523,27 +891,14 @@ infolist_buffer (struct t_infolist *infolist, const char *var,
                  int *size)
 {
     struct t_infolist_var *ptr_var;
+    enum t_infolist_type type;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
+    ptr_var = infolist_search_var_type (infolist, var, &type);
+    if (!ptr_var || (type != INFOLIST_BUFFER))
         return NULL;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_BUFFER)
-            {
-                *size = ptr_var->size;
-                return ptr_var->value;
-            }
-            else
-                return NULL;
-        }
-    }
-
-    /* variable not found */
-    return NULL;
+    *size = ptr_var->size;
+    return ptr_var->value.pointer;
 }
 
 /*
@@ -554,102 +909,13 @@ time_t
 infolist_time (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
+    enum t_infolist_type type;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
+    ptr_var = infolist_search_var_type (infolist, var, &type);
+    if (!ptr_var || (type != INFOLIST_TIME))
         return 0;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_TIME)
-                return *((time_t *)ptr_var->value);
-            else
-                return 0;
-        }
-    }
-
-    /* variable not found */
-    return 0;
-}
-
-/*
- * Frees a variable in item.
- */
-
-void
-infolist_var_free (struct t_infolist_item *item,
-                   struct t_infolist_var *var)
-{
-    struct t_infolist_var *new_vars;
-
-    /* remove var */
-    if (item->last_var == var)
-        item->last_var = var->prev_var;
-    if (var->prev_var)
-    {
-        (var->prev_var)->next_var = var->next_var;
-        new_vars = item->vars;
-    }
-    else
-        new_vars = var->next_var;
-
-    if (var->next_var)
-        (var->next_var)->prev_var = var->prev_var;
-
-    /* free data */
-    if (var->name)
-        free (var->name);
-    if (((var->type == INFOLIST_INTEGER)
-         || (var->type == INFOLIST_STRING)
-         || (var->type == INFOLIST_BUFFER)
-         || (var->type == INFOLIST_TIME))
-        && var->value)
-    {
-        free (var->value);
-    }
-
-    free (var);
-
-    item->vars = new_vars;
-}
-
-/*
- * Frees an item in infolist.
- */
-
-void
-infolist_item_free (struct t_infolist *infolist,
-                    struct t_infolist_item *item)
-{
-    struct t_infolist_item *new_items;
-
-    /* remove var */
-    if (infolist->last_item == item)
-        infolist->last_item = item->prev_item;
-    if (item->prev_item)
-    {
-        (item->prev_item)->next_item = item->next_item;
-        new_items = infolist->items;
-    }
-    else
-        new_items = item->next_item;
-
-    if (item->next_item)
-        (item->next_item)->prev_item = item->prev_item;
-
-    /* free data */
-    while (item->vars)
-    {
-        infolist_var_free (item, item->vars);
-    }
-    if (item->fields)
-        free (item->fields);
-
-    free (item);
-
-    infolist->items = new_items;
+    return ptr_var->value.time;
 }
 
 /*
@@ -660,6 +926,7 @@ void
 infolist_free (struct t_infolist *infolist)
 {
     struct t_infolist *new_weechat_infolists;
+    struct t_infolist_schema *ptr_schema;
 
     /* remove list */
     if (last_weechat_infolist == infolist)
@@ -680,6 +947,14 @@ infolist_free (struct t_infolist *infolist)
     {
         infolist_item_free (infolist, infolist->items);
     }
+    if (infolist->stream_free_callback)
+        (infolist->stream_free_callback) (infolist->stream_data);
+    while (infolist->schemas)
+    {
+        ptr_schema = infolist->schemas->next_schema;
+        infolist_schema_free (infolist->schemas);
+        infolist->schemas = ptr_schema;
+    }
 
     free (infolist);
 
@@ -713,8 +988,10 @@ void
 infolist_print_log ()
 {
     struct t_infolist *ptr_infolist;
+    struct t_infolist_schema *ptr_schema;
     struct t_infolist_item *ptr_item;
     struct t_infolist_var *ptr_var;
+    int i;
 
     for (ptr_infolist = weechat_infolists; ptr_infolist;
          ptr_infolist = ptr_infolist->next_infolist)
@@ -722,50 +999,66 @@ infolist_print_log ()
         log_printf ("");
         log_printf ("[infolist (addr:0x%lx)]", ptr_infolist);
         log_printf ("  plugin . . . . . . . . : 0x%lx", ptr_infolist->plugin);
+        log_printf ("  schemas. . . . . . . . : 0x%lx", ptr_infolist->schemas);
         log_printf ("  items. . . . . . . . . : 0x%lx", ptr_infolist->items);
         log_printf ("  last_item. . . . . . . : 0x%lx", ptr_infolist->last_item);
         log_printf ("  ptr_item . . . . . . . : 0x%lx", ptr_infolist->ptr_item);
+        log_printf ("  stream_callback. . . . : 0x%lx", ptr_infolist->stream_callback);
+        log_printf ("  stream_free_callback . : 0x%lx", ptr_infolist->stream_free_callback);
+        log_printf ("  stream_data. . . . . . : 0x%lx", ptr_infolist->stream_data);
         log_printf ("  prev_infolist. . . . . : 0x%lx", ptr_infolist->prev_infolist);
         log_printf ("  next_infolist. . . . . : 0x%lx", ptr_infolist->next_infolist);
 
+        for (ptr_schema = ptr_infolist->schemas; ptr_schema;
+             ptr_schema = ptr_schema->next_schema)
+        {
+            log_printf ("");
+            log_printf ("    [schema (addr:0x%lx)]", ptr_schema);
+            log_printf ("      fields_count . . . . . : %d",    ptr_schema->fields_count);
+            log_printf ("      fields_size. . . . . . : %d",    ptr_schema->fields_size);
+            log_printf ("      index. . . . . . . . . : 0x%lx", ptr_schema->index);
+            log_printf ("      fields_string. . . . . : '%s'",  ptr_schema->fields_string);
+            log_printf ("      next_schema. . . . . . : 0x%lx", ptr_schema->next_schema);
+        }
+
         for (ptr_item = ptr_infolist->items; ptr_item;
              ptr_item = ptr_item->next_item)
         {
             log_printf ("");
             log_printf ("    [item (addr:0x%lx)]", ptr_item);
+            log_printf ("      schema . . . . . . . . : 0x%lx", ptr_item->schema);
             log_printf ("      vars . . . . . . . . . : 0x%lx", ptr_item->vars);
-            log_printf ("      last_var . . . . . . . : 0x%lx", ptr_item->last_var);
+            log_printf ("      vars_count . . . . . . : %d",    ptr_item->vars_count);
+            log_printf ("      vars_size. . . . . . . : %d",    ptr_item->vars_size);
             log_printf ("      prev_item. . . . . . . : 0x%lx", ptr_item->prev_item);
             log_printf ("      next_item. . . . . . . : 0x%lx", ptr_item->next_item);
 
-            for (ptr_var = ptr_item->vars; ptr_var;
-                 ptr_var = ptr_var->next_var)
+            for (i = 0; i < ptr_item->vars_count; i++)
             {
+                ptr_var = &(ptr_item->vars[i]);
                 log_printf ("");
                 log_printf ("      [var (addr:0x%lx)]", ptr_var);
-                log_printf ("        name . . . . . . . . : '%s'", ptr_var->name);
-                log_printf ("        type . . . . . . . . : %d",   ptr_var->type);
-                switch (ptr_var->type)
+                log_printf ("        name . . . . . . . . : '%s'", ptr_item->schema->fields[i].name);
+                log_printf ("        type . . . . . . . . : %d",   ptr_item->schema->fields[i].type);
+                switch (ptr_item->schema->fields[i].type)
                 {
                     case INFOLIST_INTEGER:
-                        log_printf ("        value (integer). . . : %d",    *((int *)ptr_var->value));
+                        log_printf ("        value (integer). . . : %d",    ptr_var->value.integer);
                         break;
                     case INFOLIST_STRING:
-                        log_printf ("        value (string) . . . : '%s'",  (char *)ptr_var->value);
+                        log_printf ("        value (string) . . . : '%s'",  ptr_var->value.string);
                         break;
                     case INFOLIST_POINTER:
-                        log_printf ("        value (pointer). . . : 0x%lx", ptr_var->value);
+                        log_printf ("        value (pointer). . . : 0x%lx", ptr_var->value.pointer);
                         break;
                     case INFOLIST_BUFFER:
-                        log_printf ("        value (buffer) . . . : 0x%lx", ptr_var->value);
+                        log_printf ("        value (buffer) . . . : 0x%lx", ptr_var->value.pointer);
                         log_printf ("        size of buffer . . . : %d",    ptr_var->size);
                         break;
                     case INFOLIST_TIME:
-                        log_printf ("        value (time) . . . . : %ld", *((time_t *)ptr_var->value));
+                        log_printf ("        value (time) . . . . : %ld", ptr_var->value.time);
                         break;
                 }
-                log_printf ("        prev_var . . . . . . : 0x%lx", ptr_var->prev_var);
-                log_printf ("        next_var . . . . . . : 0x%lx", ptr_var->next_var);
             }
         }
     }
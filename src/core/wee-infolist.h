@@ -22,6 +22,8 @@
 
 #include <time.h>
 
+struct t_hashtable;
+
 /* list structures */
 
 enum t_infolist_type
@@ -33,21 +35,50 @@ enum t_infolist_type
     INFOLIST_TIME,
 };
 
-struct t_infolist_var
+/*
+ * Infolist items with same fields (names and types, in same order) share the
+ * same schema: field names and types are stored only once, and values of each
+ * item are stored in a contiguous row (array of vars, same order as fields).
+ */
+
+struct t_infolist_field
 {
     char *name;                        /* variable name                     */
     enum t_infolist_type type;         /* type: int, string, ...            */
-    void *value;                       /* pointer to value                  */
+};
+
+struct t_infolist_schema
+{
+    struct t_infolist_field *fields;   /* fields (name and type)            */
+    int fields_count;                  /* number of fields                  */
+    int fields_size;                   /* size of array "fields"            */
+    struct t_hashtable *index;         /* index of fields by name (built on */
+                                       /* first search of a variable)       */
+    char *fields_string;               /* fields list (NULL if never asked) */
+    struct t_infolist_schema *next_schema; /* link to next schema           */
+};
+
+struct t_infolist_var
+{
+    union
+    {
+        int integer;                   /* value for type integer            */
+        char *string;                  /* value for type string             */
+        void *pointer;                 /* value for type pointer and buffer */
+        time_t time;                   /* value for type time               */
+    } value;
     int size;                          /* for type buffer                   */
-    struct t_infolist_var *prev_var;   /* link to previous variable         */
-    struct t_infolist_var *next_var;   /* link to next variable             */
 };
 
 struct t_infolist_item
 {
-    struct t_infolist_var *vars;       /* item variables                    */
-    struct t_infolist_var *last_var;   /* last variable                     */
+    struct t_infolist *infolist;       /* infolist containing this item     */
+    struct t_infolist_schema *schema;  /* fields of item (names and types)  */
+    struct t_infolist_var *vars;       /* item variables (values)           */
+    int vars_count;                    /* number of variables               */
+    int vars_size;                     /* size of array "vars"              */
     char *fields;                      /* fields list (NULL if never asked) */
+                                       /* (only if not all schema fields)   */
     struct t_infolist_item *prev_item; /* link to previous item             */
     struct t_infolist_item *next_item; /* link to next item                 */
 };
@@ -56,9 +87,18 @@ struct t_infolist
 {
     struct t_weechat_plugin *plugin;   /* plugin which created this infolist*/
                                        /* (NULL if created by WeeChat)      */
+    struct t_infolist_schema *schemas; /* schemas used by items             */
     struct t_infolist_item *items;     /* link to items                     */
     struct t_infolist_item *last_item; /* last variable                     */
     struct t_infolist_item *ptr_item;  /* pointer to current item           */
+    int (*stream_callback)(void *stream_data, struct t_infolist *infolist,
+                           int direction);
+                                       /* callback adding items on demand   */
+                                       /* (NULL if all items are built by   */
+                                       /* the provider)                     */
+    void (*stream_free_callback)(void *stream_data);
+                                       /* callback to free stream data      */
+    void *stream_data;                 /* data for stream callbacks         */
     struct t_infolist *prev_infolist;  /* link to previous list             */
     struct t_infolist *next_infolist;  /* link to next list                 */
 };
@@ -72,6 +112,12 @@ extern struct t_infolist *last_weechat_infolist;
 
 extern struct t_infolist *infolist_new (struct t_weechat_plugin *plugin);
 extern int infolist_valid (struct t_infolist *infolist);
+extern void infolist_set_stream (struct t_infolist *infolist,
+                                 int (*callback)(void *stream_data,
+                                                 struct t_infolist *infolist,
+                                                 int direction),
+                                 void (*free_callback)(void *stream_data),
+                                 void *stream_data);
 extern struct t_infolist_item *infolist_new_item (struct t_infolist *infolist);
 extern struct t_infolist_var *infolist_new_var_integer (struct t_infolist_item *item,
                                                         const char *name,
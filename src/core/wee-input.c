@@ -188,9 +188,9 @@ input_exec_command (struct t_gui_buffer *buffer,
 int
 input_data (struct t_gui_buffer *buffer, const char *data)
 {
-    char *pos, *buf, str_buffer[128], *new_data, *buffer_full_name;
-    const char *ptr_data, *ptr_data_for_buffer;
-    int length, char_size, first_command, rc;
+    char *pos, *pos_next, *buf, str_buffer[128], *new_data, *buffer_full_name;
+    const char *ptr_data, *ptr_data_for_buffer, *ptr_next_line;
+    int length, char_size, first_command, is_text, rc;
 
     rc = WEECHAT_RC_OK;
 
@@ -241,6 +241,33 @@ input_data (struct t_gui_buffer *buffer, const char *data)
         if (pos)
             pos[0] = '\0';
 
+        if (pos && buffer->input_multiline && ptr_data[0]
+            && (string_input_for_buffer (ptr_data) == ptr_data))
+        {
+            /*
+             * buffer accepts many lines at once: append all following
+             * lines of text (not commands) to send them in a single call
+             * to input callback
+             */
+            while (pos)
+            {
+                ptr_next_line = pos + 1;
+                pos_next = strchr (ptr_next_line, '\n');
+                if (pos_next)
+                    pos_next[0] = '\0';
+                is_text = (ptr_next_line[0]
+                           && (string_input_for_buffer (ptr_next_line) == ptr_next_line));
+                if (pos_next)
+                    pos_next[0] = '\n';
+                if (!is_text)
+                    break;
+                pos[0] = '\n';
+                pos = pos_next;
+                if (pos)
+                    pos[0] = '\0';
+            }
+        }
+
         ptr_data_for_buffer = string_input_for_buffer (ptr_data);
         if (ptr_data_for_buffer)
         {
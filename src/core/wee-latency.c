@@ -0,0 +1,417 @@
+/*
+ * wee-latency.c - latency tracing of messages received (socket to screen)
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When a plugin processes a message received (for example irc), it gives the
+ * date of reception of message (read on socket) with function
+ * latency_message_set; all lines added while the message is processed
+ * (by the plugin, hooks, triggers, scripts) are attributed to this message.
+ *
+ * Lines displayed in a window are then waiting for the next refresh of
+ * screen, and relay plugin measures the time until data is sent to its
+ * clients. The latency of each stage is added in a histogram.
+ *
+ * When tracing is not running, functions return immediately (the date of
+ * reception is not even read).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "weechat.h"
+#include "wee-latency.h"
+#include "wee-util.h"
+#include "../gui/gui-buffer.h"
+#include "../gui/gui-chat.h"
+
+
+int latency_running = 0;               /* 1 if latency tracing is running   */
+
+char *latency_stage_string[LATENCY_NUM_STAGES] =
+{ "queue", "process", "display", "screen", "relay" };
+
+/* upper bounds of buckets (in microseconds) */
+long long latency_buckets[LATENCY_NUM_BUCKETS] =
+{ 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+  1000000 };
+
+long long latency_count[LATENCY_NUM_STAGES][LATENCY_NUM_BUCKETS + 1];
+long long latency_time_sum[LATENCY_NUM_STAGES]; /* total latency (µs)       */
+long long latency_time_max[LATENCY_NUM_STAGES]; /* max latency (µs)         */
+
+struct timeval latency_time_start;     /* start of tracing                  */
+struct timeval latency_time_stop;      /* stop of tracing                   */
+
+struct timeval latency_message_date;   /* reception of message processed    */
+int latency_message_is_set = 0;        /* 1 if a message is processed       */
+
+/* lines displayed in a window, waiting for next refresh of screen */
+struct timeval latency_pending_line[LATENCY_MAX_PENDING]; /* line added     */
+struct timeval latency_pending_recv[LATENCY_MAX_PENDING]; /* message recv.  */
+int latency_pending_count = 0;
+long long latency_pending_dropped = 0; /* lines not measured (array full)   */
+
+
+/*
+ * Searches for a stage by name.
+ *
+ * Returns index of stage, -1 if not found.
+ */
+
+int
+latency_search_stage (const char *stage)
+{
+    int i;
+
+    if (!stage)
+        return -1;
+
+    for (i = 0; i < LATENCY_NUM_STAGES; i++)
+    {
+        if (strcmp (latency_stage_string[i], stage) == 0)
+            return i;
+    }
+
+    /* stage not found */
+    return -1;
+}
+
+/*
+ * Resets all histograms.
+ */
+
+void
+latency_reset ()
+{
+    memset (latency_count, 0, sizeof (latency_count));
+    memset (latency_time_sum, 0, sizeof (latency_time_sum));
+    memset (latency_time_max, 0, sizeof (latency_time_max));
+    latency_pending_count = 0;
+    latency_pending_dropped = 0;
+    gettimeofday (&latency_time_start, NULL);
+    latency_time_stop = latency_time_start;
+}
+
+/*
+ * Starts latency tracing (histograms are reset).
+ */
+
+void
+latency_start ()
+{
+    if (latency_running)
+        return;
+
+    latency_reset ();
+    latency_message_is_set = 0;
+    latency_running = 1;
+}
+
+/*
+ * Stops latency tracing (histograms are kept).
+ */
+
+void
+latency_stop ()
+{
+    if (!latency_running)
+        return;
+
+    gettimeofday (&latency_time_stop, NULL);
+    latency_message_is_set = 0;
+    latency_pending_count = 0;
+    latency_running = 0;
+}
+
+/*
+ * Adds latency between two dates in histogram of a stage.
+ */
+
+void
+latency_add_diff (int stage, const struct timeval *date_start,
+                  const struct timeval *date_end)
+{
+    long long diff;
+    int i;
+
+    diff = util_timeval_diff ((struct timeval *)date_start,
+                              (struct timeval *)date_end);
+    if (diff < 0)
+        diff = 0;
+
+    for (i = 0; i < LATENCY_NUM_BUCKETS; i++)
+    {
+        if (diff <= latency_buckets[i])
+            break;
+    }
+    latency_count[stage][i]++;
+    latency_time_sum[stage] += diff;
+    if (diff > latency_time_max[stage])
+        latency_time_max[stage] = diff;
+}
+
+/*
+ * Adds latency of a stage (time between "date_start" and now).
+ *
+ * If "date_start" is NULL, the date of reception of message being processed
+ * is used (nothing is added if no message is processed).
+ */
+
+void
+latency_add (const char *stage, const struct timeval *date_start)
+{
+    struct timeval now;
+    int index_stage;
+
+    if (!latency_running)
+        return;
+
+    index_stage = latency_search_stage (stage);
+    if (index_stage < 0)
+        return;
+
+    if (!date_start)
+    {
+        if (!latency_message_is_set)
+            return;
+        date_start = &latency_message_date;
+    }
+
+    gettimeofday (&now, NULL);
+    latency_add_diff (index_stage, date_start, &now);
+}
+
+/*
+ * Sets date of reception of message being processed (NULL when processing
+ * of message is done).
+ */
+
+void
+latency_message_set (const struct timeval *date_recv)
+{
+    struct timeval now;
+
+    if (!latency_running || !date_recv)
+    {
+        latency_message_is_set = 0;
+        return;
+    }
+
+    latency_message_date = *date_recv;
+    latency_message_is_set = 1;
+
+    gettimeofday (&now, NULL);
+    latency_add_diff (LATENCY_STAGE_QUEUE, date_recv, &now);
+}
+
+/*
+ * Returns date of reception of message being processed, NULL if no message
+ * is processed or if tracing is not running.
+ */
+
+const struct timeval *
+latency_message_get ()
+{
+    return (latency_running && latency_message_is_set) ?
+        &latency_message_date : NULL;
+}
+
+/*
+ * Called when a line is added in a buffer: adds latency of processing of
+ * message (if a message is processed) and keeps the line for next refresh
+ * of screen if it is displayed in a window.
+ */
+
+void
+latency_line_added (struct t_gui_buffer *buffer, int displayed)
+{
+    struct timeval now;
+
+    if (!latency_running)
+        return;
+
+    gettimeofday (&now, NULL);
+
+    if (latency_message_is_set)
+        latency_add_diff (LATENCY_STAGE_PROCESS, &latency_message_date, &now);
+
+    if (!displayed || weechat_headless || !buffer
+        || (buffer->num_displayed <= 0))
+    {
+        return;
+    }
+
+    if (latency_pending_count >= LATENCY_MAX_PENDING)
+    {
+        latency_pending_dropped++;
+        return;
+    }
+
+    latency_pending_line[latency_pending_count] = now;
+    if (latency_message_is_set)
+    {
+        latency_pending_recv[latency_pending_count] = latency_message_date;
+    }
+    else
+    {
+        latency_pending_recv[latency_pending_count].tv_sec = 0;
+        latency_pending_recv[latency_pending_count].tv_usec = 0;
+    }
+    latency_pending_count++;
+}
+
+/*
+ * Called after a refresh of screen: adds latency of lines displayed since
+ * previous refresh.
+ */
+
+void
+latency_screen_refreshed ()
+{
+    struct timeval now;
+    int i;
+
+    if (!latency_running || (latency_pending_count == 0))
+        return;
+
+    gettimeofday (&now, NULL);
+
+    for (i = 0; i < latency_pending_count; i++)
+    {
+        latency_add_diff (LATENCY_STAGE_DISPLAY,
+                          &latency_pending_line[i], &now);
+        if (latency_pending_recv[i].tv_sec != 0)
+        {
+            latency_add_diff (LATENCY_STAGE_SCREEN,
+                              &latency_pending_recv[i], &now);
+        }
+    }
+    latency_pending_count = 0;
+}
+
+/*
+ * Returns an estimation of a percentile of latency for a stage (in
+ * microseconds): the upper bound of bucket containing the percentile
+ * (or max latency if lower).
+ */
+
+long long
+latency_get_percentile (int stage, long long count, int percentile)
+{
+    long long target, total;
+    int i;
+
+    target = ((count * percentile) + 99) / 100;
+    if (target < 1)
+        target = 1;
+
+    total = 0;
+    for (i = 0; i < LATENCY_NUM_BUCKETS; i++)
+    {
+        total += latency_count[stage][i];
+        if (total >= target)
+        {
+            return (latency_buckets[i] < latency_time_max[stage]) ?
+                latency_buckets[i] : latency_time_max[stage];
+        }
+    }
+
+    return latency_time_max[stage];
+}
+
+/*
+ * Displays histograms of latency (count, average, percentiles and max
+ * latency for each stage).
+ */
+
+void
+latency_display ()
+{
+    struct timeval now;
+    long long count, duration;
+    int i, j;
+
+    if (latency_running)
+        gettimeofday (&now, NULL);
+    else
+        now = latency_time_stop;
+    duration = util_timeval_diff (&latency_time_start, &now);
+
+    count = 0;
+    for (i = 0; i < LATENCY_NUM_STAGES; i++)
+    {
+        for (j = 0; j <= LATENCY_NUM_BUCKETS; j++)
+        {
+            count += latency_count[i][j];
+        }
+    }
+    if (!latency_running && (count == 0))
+    {
+        gui_chat_printf (NULL, _("Latency tracing: no data"));
+        return;
+    }
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     _("Latency tracing (%s): %.3fs"),
+                     (latency_running) ? _("running") : _("stopped"),
+                     ((float)duration) / 1000000);
+    gui_chat_printf (NULL, "  %-8s %10s %10s %10s %10s %10s %10s",
+                     "stage", "count", "avg (ms)", "p50 (ms)", "p90 (ms)",
+                     "p99 (ms)", "max (ms)");
+    for (i = 0; i < LATENCY_NUM_STAGES; i++)
+    {
+        count = 0;
+        for (j = 0; j <= LATENCY_NUM_BUCKETS; j++)
+        {
+            count += latency_count[i][j];
+        }
+        if (count == 0)
+        {
+            gui_chat_printf (NULL, "  %-8s %10d %10s %10s %10s %10s %10s",
+                             latency_stage_string[i], 0,
+                             "-", "-", "-", "-", "-");
+            continue;
+        }
+        gui_chat_printf (NULL,
+                         "  %-8s %10lld %10.3f %10.3f %10.3f %10.3f %10.3f",
+                         latency_stage_string[i],
+                         count,
+                         ((float)latency_time_sum[i]) / count / 1000,
+                         ((float)latency_get_percentile (i, count, 50)) / 1000,
+                         ((float)latency_get_percentile (i, count, 90)) / 1000,
+                         ((float)latency_get_percentile (i, count, 99)) / 1000,
+                         ((float)latency_time_max[i]) / 1000);
+    }
+    if (latency_pending_dropped > 0)
+    {
+        gui_chat_printf (NULL,
+                         _("  lines not measured on screen (too many lines "
+                           "between two refreshs): %lld"),
+                         latency_pending_dropped);
+    }
+}
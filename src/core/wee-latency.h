@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LATENCY_H
+#define WEECHAT_LATENCY_H 1
+
+#include <sys/time.h>
+
+/* number of buckets for histograms of latency (without "+Inf") */
+#define LATENCY_NUM_BUCKETS 12
+
+/* max number of lines waiting for a refresh of screen */
+#define LATENCY_MAX_PENDING 4096
+
+struct t_gui_buffer;
+
+/* stages of a message received (latency is measured at end of stage) */
+
+enum t_latency_stage
+{
+    LATENCY_STAGE_QUEUE = 0,           /* received -> start of processing   */
+    LATENCY_STAGE_PROCESS,             /* received -> line added in buffer  */
+    LATENCY_STAGE_DISPLAY,             /* line added -> screen refreshed    */
+    LATENCY_STAGE_SCREEN,              /* received -> screen refreshed      */
+    LATENCY_STAGE_RELAY,               /* received -> sent to relay client  */
+    /* number of stages */
+    LATENCY_NUM_STAGES,
+};
+
+extern int latency_running;
+extern char *latency_stage_string[];
+extern long long latency_buckets[];
+extern long long latency_count[LATENCY_NUM_STAGES][LATENCY_NUM_BUCKETS + 1];
+extern long long latency_time_sum[];
+extern long long latency_time_max[];
+
+extern int latency_search_stage (const char *stage);
+extern void latency_start ();
+extern void latency_stop ();
+extern void latency_reset ();
+extern void latency_add (const char *stage, const struct timeval *date_start);
+extern void latency_message_set (const struct timeval *date_recv);
+extern const struct timeval *latency_message_get ();
+extern void latency_line_added (struct t_gui_buffer *buffer, int displayed);
+extern void latency_screen_refreshed ();
+extern void latency_display ();
+
+#endif /* WEECHAT_LATENCY_H */
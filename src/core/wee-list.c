@@ -27,12 +27,31 @@
 #include <string.h>
 
 #include "weechat.h"
+#include "wee-arraylist.h"
 #include "wee-list.h"
 #include "wee-log.h"
 #include "wee-string.h"
 #include "../plugins/plugin.h"
 
 
+/*
+ * Compares two items of list (case insensitive).
+ *
+ * This callback is used by the arraylist of items.
+ */
+
+int
+weelist_arraylist_cmp_cb (void *data, struct t_arraylist *arraylist,
+                          void *pointer1, void *pointer2)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    return string_strcasecmp (((struct t_weelist_item *)pointer1)->data,
+                              ((struct t_weelist_item *)pointer2)->data);
+}
+
 /*
  * Creates a new list.
  *
@@ -47,6 +66,20 @@ weelist_new ()
     new_weelist = malloc (sizeof (*new_weelist));
     if (new_weelist)
     {
+        /*
+         * the arraylist is "sorted" as long as items are sorted (case
+         * insensitive), so that binary search can be used; it is unset if
+         * an item is added at beginning/end or changed so that the order
+         * is lost
+         */
+        new_weelist->array = arraylist_new (0, 1, 1,
+                                            &weelist_arraylist_cmp_cb, NULL,
+                                            NULL, NULL);
+        if (!new_weelist->array)
+        {
+            free (new_weelist);
+            return NULL;
+        }
         new_weelist->items = NULL;
         new_weelist->last_item = NULL;
         new_weelist->size = 0;
@@ -56,38 +89,97 @@ weelist_new ()
 
 /*
  * Searches for position of data (to keep list sorted).
+ *
+ * Returns index where data must be inserted (size of list to add it at the
+ * end), -1 if error.
  */
 
-struct t_weelist_item *
+int
 weelist_find_pos (struct t_weelist *weelist, const char *data)
 {
-    struct t_weelist_item *ptr_item;
+    struct t_weelist_item item, *ptr_item;
+    int i, index_insert;
 
     if (!weelist || !data)
-        return NULL;
+        return -1;
 
-    for (ptr_item = weelist->items; ptr_item;
-         ptr_item = ptr_item->next_item)
+    if (weelist->array->sorted)
     {
+        item.data = (char *)data;
+        (void) arraylist_search (weelist->array, &item, NULL, &index_insert);
+        return (index_insert >= 0) ? index_insert : weelist->array->size;
+    }
+
+    for (i = 0; i < weelist->array->size; i++)
+    {
+        ptr_item = arraylist_get (weelist->array, i);
         if (string_strcasecmp (data, ptr_item->data) < 0)
-            return ptr_item;
+            return i;
     }
+
     /* position not found, best position is at the end */
-    return NULL;
+    return weelist->array->size;
+}
+
+/*
+ * Searches for index of an item in the list.
+ *
+ * Returns index of item (>= 0), -1 if not found.
+ */
+
+int
+weelist_item_index (struct t_weelist *weelist, struct t_weelist_item *item)
+{
+    int i;
+
+    if (!weelist || !item)
+        return -1;
+
+    if (item == weelist->last_item)
+        return weelist->array->size - 1;
+    if (item == weelist->items)
+        return 0;
+
+    if (weelist->array->sorted)
+    {
+        /* item is in the range of items with same value (case insensitive) */
+        if (!arraylist_search (weelist->array, item, &i, NULL))
+            return -1;
+        for (; i < weelist->array->size; i++)
+        {
+            if (arraylist_get (weelist->array, i) == item)
+                return i;
+        }
+        return -1;
+    }
+
+    for (i = 0; i < weelist->array->size; i++)
+    {
+        if (arraylist_get (weelist->array, i) == item)
+            return i;
+    }
+
+    /* item not found */
+    return -1;
 }
 
 /*
  * Inserts an element in the list (keeping list sorted).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
  */
 
-void
+int
 weelist_insert (struct t_weelist *weelist, struct t_weelist_item *item,
                 const char *where)
 {
     struct t_weelist_item *pos_item;
+    int index, sorted;
 
     if (!weelist || !item)
-        return;
+        return 0;
 
     if (weelist->items)
     {
@@ -97,44 +189,64 @@ weelist_insert (struct t_weelist *weelist, struct t_weelist_item *item,
             weelist_remove (weelist, pos_item);
     }
 
-    if (weelist->items)
+    /* search position for new element, according to pos asked */
+    sorted = weelist->array->sorted;
+    if (string_strcasecmp (where, WEECHAT_LIST_POS_BEGINNING) == 0)
     {
-        /* search position for new element, according to pos asked */
-        pos_item = NULL;
-        if (string_strcasecmp (where, WEECHAT_LIST_POS_BEGINNING) == 0)
-            pos_item = weelist->items;
-        else if (string_strcasecmp (where, WEECHAT_LIST_POS_END) == 0)
-            pos_item = NULL;
-        else
-            pos_item = weelist_find_pos (weelist, item->data);
-
-        if (pos_item)
+        index = 0;
+        if (weelist->items
+            && (string_strcasecmp (item->data, weelist->items->data) > 0))
         {
-            /* insert data into the list (before position found) */
-            item->prev_item = pos_item->prev_item;
-            item->next_item = pos_item;
-            if (pos_item->prev_item)
-                (pos_item->prev_item)->next_item = item;
-            else
-                weelist->items = item;
-            pos_item->prev_item = item;
+            sorted = 0;
         }
-        else
+    }
+    else if (string_strcasecmp (where, WEECHAT_LIST_POS_END) == 0)
+    {
+        index = weelist->array->size;
+        if (weelist->last_item
+            && (string_strcasecmp (item->data, weelist->last_item->data) < 0))
         {
-            /* add data to the end */
-            item->prev_item = weelist->last_item;
-            item->next_item = NULL;
-            (weelist->last_item)->next_item = item;
-            weelist->last_item = item;
+            sorted = 0;
         }
     }
+    else
+        index = weelist_find_pos (weelist, item->data);
+
+    pos_item = arraylist_get (weelist->array, index);
+
+    /* add item in arraylist at the index found (not computed by arraylist) */
+    weelist->array->sorted = 0;
+    index = arraylist_insert (weelist->array, index, item);
+    weelist->array->sorted = sorted;
+    if (index < 0)
+        return 0;
+
+    item->weelist = weelist;
+
+    if (pos_item)
+    {
+        /* insert data into the list (before position found) */
+        item->prev_item = pos_item->prev_item;
+        item->next_item = pos_item;
+        if (pos_item->prev_item)
+            (pos_item->prev_item)->next_item = item;
+        else
+            weelist->items = item;
+        pos_item->prev_item = item;
+    }
     else
     {
-        item->prev_item = NULL;
+        /* add data to the end */
+        item->prev_item = weelist->last_item;
         item->next_item = NULL;
-        weelist->items = item;
+        if (weelist->last_item)
+            (weelist->last_item)->next_item = item;
+        else
+            weelist->items = item;
         weelist->last_item = item;
     }
+
+    return 1;
 }
 
 /*
@@ -157,7 +269,13 @@ weelist_add (struct t_weelist *weelist, const char *data, const char *where,
     {
         new_item->data = strdup (data);
         new_item->user_data = user_data;
-        weelist_insert (weelist, new_item, where);
+        if (!new_item->data || !weelist_insert (weelist, new_item, where))
+        {
+            if (new_item->data)
+                free (new_item->data);
+            free (new_item);
+            return NULL;
+        }
         weelist->size++;
     }
     return new_item;
@@ -172,19 +290,7 @@ weelist_add (struct t_weelist *weelist, const char *data, const char *where,
 struct t_weelist_item *
 weelist_search (struct t_weelist *weelist, const char *data)
 {
-    struct t_weelist_item *ptr_item;
-
-    if (!weelist || !data)
-        return NULL;
-
-    for (ptr_item = weelist->items; ptr_item;
-         ptr_item = ptr_item->next_item)
-    {
-        if (strcmp (data, ptr_item->data) == 0)
-            return ptr_item;
-    }
-    /* data not found in list */
-    return NULL;
+    return weelist_get (weelist, weelist_search_pos (weelist, data));
 }
 
 /*
@@ -196,20 +302,39 @@ weelist_search (struct t_weelist *weelist, const char *data)
 int
 weelist_search_pos (struct t_weelist *weelist, const char *data)
 {
-    struct t_weelist_item *ptr_item;
+    struct t_weelist_item item, *ptr_item;
     int i;
 
     if (!weelist || !data)
         return -1;
 
-    i = 0;
-    for (ptr_item = weelist->items; ptr_item;
-         ptr_item = ptr_item->next_item)
+    if (weelist->array->sorted)
+    {
+        /*
+         * an item with same value (case sensitive) is in the range of items
+         * with same value (case insensitive)
+         */
+        item.data = (char *)data;
+        if (!arraylist_search (weelist->array, &item, &i, NULL))
+            return -1;
+        for (; i < weelist->array->size; i++)
+        {
+            ptr_item = arraylist_get (weelist->array, i);
+            if (string_strcasecmp (data, ptr_item->data) != 0)
+                break;
+            if (strcmp (data, ptr_item->data) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    for (i = 0; i < weelist->array->size; i++)
     {
+        ptr_item = arraylist_get (weelist->array, i);
         if (strcmp (data, ptr_item->data) == 0)
             return i;
-        i++;
     }
+
     /* data not found in list */
     return -1;
 }
@@ -223,19 +348,7 @@ weelist_search_pos (struct t_weelist *weelist, const char *data)
 struct t_weelist_item *
 weelist_casesearch (struct t_weelist *weelist, const char *data)
 {
-    struct t_weelist_item *ptr_item;
-
-    if (!weelist || !data)
-        return NULL;
-
-    for (ptr_item = weelist->items; ptr_item;
-         ptr_item = ptr_item->next_item)
-    {
-        if (string_strcasecmp (data, ptr_item->data) == 0)
-            return ptr_item;
-    }
-    /* data not found in list */
-    return NULL;
+    return weelist_get (weelist, weelist_casesearch_pos (weelist, data));
 }
 
 /*
@@ -247,20 +360,26 @@ weelist_casesearch (struct t_weelist *weelist, const char *data)
 int
 weelist_casesearch_pos (struct t_weelist *weelist, const char *data)
 {
-    struct t_weelist_item *ptr_item;
+    struct t_weelist_item item, *ptr_item;
     int i;
 
     if (!weelist || !data)
         return -1;
 
-    i = 0;
-    for (ptr_item = weelist->items; ptr_item;
-         ptr_item = ptr_item->next_item)
+    if (weelist->array->sorted)
     {
+        item.data = (char *)data;
+        (void) arraylist_search (weelist->array, &item, &i, NULL);
+        return i;
+    }
+
+    for (i = 0; i < weelist->array->size; i++)
+    {
+        ptr_item = arraylist_get (weelist->array, i);
         if (string_strcasecmp (data, ptr_item->data) == 0)
             return i;
-        i++;
     }
+
     /* data not found in list */
     return -1;
 }
@@ -272,23 +391,10 @@ weelist_casesearch_pos (struct t_weelist *weelist, const char *data)
 struct t_weelist_item *
 weelist_get (struct t_weelist *weelist, int position)
 {
-    int i;
-    struct t_weelist_item *ptr_item;
-
     if (!weelist)
         return NULL;
 
-    i = 0;
-    ptr_item = weelist->items;
-    while (ptr_item)
-    {
-        if (i == position)
-            return ptr_item;
-        ptr_item = ptr_item->next_item;
-        i++;
-    }
-    /* item not found */
-    return NULL;
+    return arraylist_get (weelist->array, position);
 }
 
 /*
@@ -304,6 +410,18 @@ weelist_set (struct t_weelist_item *item, const char *value)
     if (item->data)
         free (item->data);
     item->data = strdup (value);
+
+    /* disable binary search if the new value breaks the sort */
+    if (item->weelist
+        && item->weelist->array->sorted
+        && ((item->prev_item
+             && (string_strcasecmp (item->prev_item->data, item->data) > 0))
+            || (item->next_item
+                && (string_strcasecmp (item->data,
+                                       item->next_item->data) > 0))))
+    {
+        item->weelist->array->sorted = 0;
+    }
 }
 
 /*
@@ -374,6 +492,9 @@ weelist_remove (struct t_weelist *weelist, struct t_weelist_item *item)
     if (!weelist || !item)
         return;
 
+    /* remove item from arraylist */
+    arraylist_remove (weelist->array, weelist_item_index (weelist, item));
+
     /* remove item from list */
     if (weelist->last_item == item)
         weelist->last_item = item->prev_item;
@@ -395,6 +516,10 @@ weelist_remove (struct t_weelist *weelist, struct t_weelist_item *item)
     weelist->items = new_items;
 
     weelist->size--;
+
+    /* an empty list is sorted */
+    if (!weelist->items)
+        weelist->array->sorted = 1;
 }
 
 /*
@@ -404,13 +529,26 @@ weelist_remove (struct t_weelist *weelist, struct t_weelist_item *item)
 void
 weelist_remove_all (struct t_weelist *weelist)
 {
+    struct t_weelist_item *ptr_item, *ptr_next_item;
+
     if (!weelist)
         return;
 
-    while (weelist->items)
+    ptr_item = weelist->items;
+    while (ptr_item)
     {
-        weelist_remove (weelist, weelist->items);
+        ptr_next_item = ptr_item->next_item;
+        if (ptr_item->data)
+            free (ptr_item->data);
+        free (ptr_item);
+        ptr_item = ptr_next_item;
     }
+    weelist->items = NULL;
+    weelist->last_item = NULL;
+    weelist->size = 0;
+
+    arraylist_clear (weelist->array);
+    weelist->array->sorted = 1;
 }
 
 /*
@@ -424,6 +562,7 @@ weelist_free (struct t_weelist *weelist)
         return;
 
     weelist_remove_all (weelist);
+    arraylist_free (weelist->array);
     free (weelist);
 }
 
@@ -441,6 +580,8 @@ weelist_print_log (struct t_weelist *weelist, const char *name)
     log_printf ("  items. . . . . . . . . : 0x%lx", weelist->items);
     log_printf ("  last_item. . . . . . . : 0x%lx", weelist->last_item);
     log_printf ("  size . . . . . . . . . : %d", weelist->size);
+    log_printf ("  array. . . . . . . . . : 0x%lx", weelist->array);
+    log_printf ("  sorted . . . . . . . . : %d", weelist->array->sorted);
 
     i = 0;
     for (ptr_item = weelist->items; ptr_item;
@@ -449,6 +590,7 @@ weelist_print_log (struct t_weelist *weelist, const char *name)
         log_printf ("  [item %d (addr:0x%lx)]", i, ptr_item);
         log_printf ("    data . . . . . . . . : '%s'",  ptr_item->data);
         log_printf ("    user_data. . . . . . : 0x%lx", ptr_item->user_data);
+        log_printf ("    weelist. . . . . . . : 0x%lx", ptr_item->weelist);
         log_printf ("    prev_item. . . . . . : 0x%lx", ptr_item->prev_item);
         log_printf ("    next_item. . . . . . : 0x%lx", ptr_item->next_item);
         i++;
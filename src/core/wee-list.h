@@ -20,10 +20,13 @@
 #ifndef WEECHAT_LIST_H
 #define WEECHAT_LIST_H 1
 
+struct t_arraylist;
+
 struct t_weelist_item
 {
     char *data;                        /* item data                         */
     void *user_data;                   /* pointer to user data              */
+    struct t_weelist *weelist;         /* list containing this item         */
     struct t_weelist_item *prev_item;  /* link to previous item             */
     struct t_weelist_item *next_item;  /* link to next item                 */
 };
@@ -33,6 +36,8 @@ struct t_weelist
     struct t_weelist_item *items;      /* items in list                     */
     struct t_weelist_item *last_item;  /* last item in list                 */
     int size;                          /* number of items in list           */
+    struct t_arraylist *array;         /* items by position; flag "sorted"  */
+                                       /* is set while items are sorted     */
 };
 
 extern struct t_weelist *weelist_new ();
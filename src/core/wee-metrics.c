@@ -0,0 +1,445 @@
+/*
+ * wee-metrics.c - metrics of WeeChat core (Prometheus text format)
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Counters are incremented in place (main loop, hook callbacks, lines added
+ * in buffers), they are converted to text only when metrics are asked (for
+ * example by relay plugin on a scrape of resource "/metrics").
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/time.h>
+
+#if defined(HAVE_MALLINFO) || defined(HAVE_MALLINFO2)
+#include <malloc.h>
+#endif /* HAVE_MALLINFO || HAVE_MALLINFO2 */
+
+#include "weechat.h"
+#include "wee-metrics.h"
+#include "wee-hook.h"
+#include "wee-latency.h"
+#include "wee-string.h"
+#include "wee-util.h"
+#include "../gui/gui-buffer.h"
+#include "../gui/gui-line.h"
+#include "../gui/gui-nicklist.h"
+#include "../plugins/plugin.h"
+
+
+/* upper bounds of buckets for main loop time (in microseconds) */
+long long metrics_loop_buckets[METRICS_LOOP_NUM_BUCKETS] =
+{ 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+  1000000 };
+
+long long metrics_loop_count[METRICS_LOOP_NUM_BUCKETS + 1]; /* by bucket     */
+long long metrics_loop_time_sum = 0;   /* total time in main loop (µs)      */
+struct timeval metrics_loop_time_start; /* start of current iteration       */
+struct timeval metrics_wait_time_start; /* start of wait for events         */
+long long metrics_wait_time = 0;       /* time waiting in iteration (µs)    */
+
+long long metrics_hook_calls[HOOK_NUM_TYPES]; /* hook callbacks by type     */
+long long metrics_hook_time[HOOK_NUM_TYPES];  /* time in callbacks (µs)     */
+
+char *metrics_string = NULL;           /* metrics being built               */
+int metrics_string_size = 0;           /* size allocated for string         */
+int metrics_string_length = 0;         /* length of string                  */
+
+
+/*
+ * Starts an iteration of main loop.
+ */
+
+void
+metrics_loop_start ()
+{
+    gettimeofday (&metrics_loop_time_start, NULL);
+    metrics_wait_time = 0;
+}
+
+/*
+ * Ends an iteration of main loop: adds the time spent (without the time
+ * waiting for events) in histogram.
+ */
+
+void
+metrics_loop_end ()
+{
+    struct timeval time_end;
+    long long diff;
+    int i;
+
+    gettimeofday (&time_end, NULL);
+    diff = util_timeval_diff (&metrics_loop_time_start, &time_end)
+        - metrics_wait_time;
+    if (diff < 0)
+        diff = 0;
+
+    for (i = 0; i < METRICS_LOOP_NUM_BUCKETS; i++)
+    {
+        if (diff <= metrics_loop_buckets[i])
+            break;
+    }
+    metrics_loop_count[i]++;
+    metrics_loop_time_sum += diff;
+}
+
+/*
+ * Starts a wait for events (poll/epoll/kqueue).
+ */
+
+void
+metrics_wait_start ()
+{
+    gettimeofday (&metrics_wait_time_start, NULL);
+}
+
+/*
+ * Ends a wait for events.
+ */
+
+void
+metrics_wait_end ()
+{
+    struct timeval time_end;
+    long long diff;
+
+    gettimeofday (&time_end, NULL);
+    diff = util_timeval_diff (&metrics_wait_time_start, &time_end);
+    if (diff > 0)
+        metrics_wait_time += diff;
+}
+
+/*
+ * Adds a formatted string to metrics being built.
+ */
+
+void
+metrics_printf (const char *format, ...)
+{
+    char *new_string;
+    int length, new_size;
+
+    weechat_va_format (format);
+    if (!vbuffer)
+        return;
+
+    length = strlen (vbuffer);
+    if (metrics_string_length + length + 1 > metrics_string_size)
+    {
+        new_size = (metrics_string_size > 0) ? metrics_string_size * 2 : 4096;
+        while (metrics_string_length + length + 1 > new_size)
+        {
+            new_size *= 2;
+        }
+        new_string = realloc (metrics_string, new_size);
+        if (!new_string)
+        {
+            free (vbuffer);
+            return;
+        }
+        metrics_string = new_string;
+        metrics_string_size = new_size;
+    }
+    memcpy (metrics_string + metrics_string_length, vbuffer, length + 1);
+    metrics_string_length += length;
+
+    free (vbuffer);
+}
+
+/*
+ * Escapes a label value: backslash, double quote and new line are escaped
+ * with a backslash.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+metrics_escape_label (const char *value)
+{
+    char *result;
+    int i, j;
+
+    if (!value)
+        return strdup ("");
+
+    result = malloc ((strlen (value) * 2) + 1);
+    if (!result)
+        return NULL;
+
+    j = 0;
+    for (i = 0; value[i]; i++)
+    {
+        switch (value[i])
+        {
+            case '\\':
+            case '"':
+                result[j++] = '\\';
+                result[j++] = value[i];
+                break;
+            case '\n':
+                result[j++] = '\\';
+                result[j++] = 'n';
+                break;
+            default:
+                result[j++] = value[i];
+                break;
+        }
+    }
+    result[j] = '\0';
+
+    return result;
+}
+
+/*
+ * Adds metrics of main loop (histogram of time by iteration).
+ */
+
+void
+metrics_build_loop ()
+{
+    long long count;
+    int i;
+
+    metrics_printf ("# HELP weechat_main_loop_seconds Time spent in an "
+                    "iteration of main loop (without waiting for events).\n"
+                    "# TYPE weechat_main_loop_seconds histogram\n");
+    count = 0;
+    for (i = 0; i < METRICS_LOOP_NUM_BUCKETS; i++)
+    {
+        count += metrics_loop_count[i];
+        metrics_printf ("weechat_main_loop_seconds_bucket{le=\"%g\"} %lld\n",
+                        ((double)metrics_loop_buckets[i]) / 1000000,
+                        count);
+    }
+    count += metrics_loop_count[METRICS_LOOP_NUM_BUCKETS];
+    metrics_printf ("weechat_main_loop_seconds_bucket{le=\"+Inf\"} %lld\n"
+                    "weechat_main_loop_seconds_sum %.6f\n"
+                    "weechat_main_loop_seconds_count %lld\n",
+                    count,
+                    ((double)metrics_loop_time_sum) / 1000000,
+                    count);
+}
+
+/*
+ * Adds metrics of latency of messages received (histogram by stage, filled
+ * only when latency tracing is running, see command "/debug latency").
+ */
+
+void
+metrics_build_latency ()
+{
+    long long count;
+    int i, j;
+
+    metrics_printf ("# HELP weechat_latency_seconds Latency of messages "
+                    "received, by stage (see command \"/debug latency\").\n"
+                    "# TYPE weechat_latency_seconds histogram\n");
+    for (i = 0; i < LATENCY_NUM_STAGES; i++)
+    {
+        count = 0;
+        for (j = 0; j < LATENCY_NUM_BUCKETS; j++)
+        {
+            count += latency_count[i][j];
+            metrics_printf ("weechat_latency_seconds_bucket"
+                            "{stage=\"%s\",le=\"%g\"} %lld\n",
+                            latency_stage_string[i],
+                            ((double)latency_buckets[j]) / 1000000,
+                            count);
+        }
+        count += latency_count[i][LATENCY_NUM_BUCKETS];
+        metrics_printf ("weechat_latency_seconds_bucket"
+                        "{stage=\"%s\",le=\"+Inf\"} %lld\n"
+                        "weechat_latency_seconds_sum{stage=\"%s\"} %.6f\n"
+                        "weechat_latency_seconds_count{stage=\"%s\"} %lld\n",
+                        latency_stage_string[i], count,
+                        latency_stage_string[i],
+                        ((double)latency_time_sum[i]) / 1000000,
+                        latency_stage_string[i], count);
+    }
+}
+
+/*
+ * Adds metrics of hook callbacks (calls and time by type of hook).
+ */
+
+void
+metrics_build_hooks ()
+{
+    int i;
+
+    metrics_printf ("# HELP weechat_hook_callbacks_total Number of hook "
+                    "callbacks called.\n"
+                    "# TYPE weechat_hook_callbacks_total counter\n");
+    for (i = 0; i < HOOK_NUM_TYPES; i++)
+    {
+        metrics_printf ("weechat_hook_callbacks_total{type=\"%s\"} %lld\n",
+                        hook_type_string[i], metrics_hook_calls[i]);
+    }
+    metrics_printf ("# HELP weechat_hook_callback_seconds_total Time spent "
+                    "in hook callbacks.\n"
+                    "# TYPE weechat_hook_callback_seconds_total counter\n");
+    for (i = 0; i < HOOK_NUM_TYPES; i++)
+    {
+        metrics_printf ("weechat_hook_callback_seconds_total{type=\"%s\"} "
+                        "%.6f\n",
+                        hook_type_string[i],
+                        ((double)metrics_hook_time[i]) / 1000000);
+    }
+}
+
+/*
+ * Adds metrics of buffers (lines added by buffer).
+ */
+
+void
+metrics_build_buffers ()
+{
+    struct t_gui_buffer *ptr_buffer;
+    char *plugin, *name;
+
+    metrics_printf ("# HELP weechat_buffer_lines_added_total Number of lines "
+                    "added in buffer.\n"
+                    "# TYPE weechat_buffer_lines_added_total counter\n");
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        plugin = metrics_escape_label (gui_buffer_get_plugin_name (ptr_buffer));
+        name = metrics_escape_label (ptr_buffer->full_name);
+        if (plugin && name)
+        {
+            metrics_printf ("weechat_buffer_lines_added_total"
+                            "{plugin=\"%s\",buffer=\"%s\"} %ld\n",
+                            plugin, name, ptr_buffer->lines_added);
+        }
+        if (plugin)
+            free (plugin);
+        if (name)
+            free (name);
+    }
+}
+
+/*
+ * Adds metrics of memory: memory allocated and memory used by buffers of
+ * each plugin (lines and nicklist).
+ *
+ * Note: memory of buffers is computed by browsing data (like command
+ * "/debug memory detail").
+ */
+
+void
+metrics_build_memory ()
+{
+    struct t_gui_buffer *ptr_buffer;
+    struct t_weechat_plugin *ptr_plugin;
+    long total_lines, total_nicklist;
+    int buffers;
+#if defined(HAVE_MALLINFO2)
+    struct mallinfo2 info;
+#elif defined(HAVE_MALLINFO)
+    struct mallinfo info;
+#endif /* HAVE_MALLINFO2 */
+
+#if defined(HAVE_MALLINFO2)
+    /* mallinfo2 uses size_t fields (mallinfo overflows above 2 GB) */
+    info = mallinfo2 ();
+    metrics_printf ("# HELP weechat_memory_allocated_bytes Memory allocated "
+                    "(see \"man mallinfo2\", field \"uordblks\").\n"
+                    "# TYPE weechat_memory_allocated_bytes gauge\n"
+                    "weechat_memory_allocated_bytes %lu\n",
+                    (unsigned long)info.uordblks);
+#elif defined(HAVE_MALLINFO)
+    info = mallinfo ();
+    metrics_printf ("# HELP weechat_memory_allocated_bytes Memory allocated "
+                    "(see \"man mallinfo\", field \"uordblks\").\n"
+                    "# TYPE weechat_memory_allocated_bytes gauge\n"
+                    "weechat_memory_allocated_bytes %d\n",
+                    info.uordblks);
+#endif /* HAVE_MALLINFO2 */
+
+    metrics_printf ("# HELP weechat_buffer_memory_bytes Memory used by "
+                    "buffers of plugin.\n"
+                    "# TYPE weechat_buffer_memory_bytes gauge\n");
+    ptr_plugin = NULL;
+    while (1)
+    {
+        buffers = 0;
+        total_lines = 0;
+        total_nicklist = 0;
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
+        {
+            if (ptr_buffer->plugin != ptr_plugin)
+                continue;
+            buffers++;
+            total_lines += gui_lines_get_memory (ptr_buffer->own_lines, 1)
+                + gui_lines_get_memory (ptr_buffer->mixed_lines, 0);
+            total_nicklist += gui_nicklist_get_memory (ptr_buffer->nicklist_root);
+        }
+        if (buffers > 0)
+        {
+            metrics_printf ("weechat_buffer_memory_bytes"
+                            "{plugin=\"%s\",kind=\"lines\"} %ld\n"
+                            "weechat_buffer_memory_bytes"
+                            "{plugin=\"%s\",kind=\"nicklist\"} %ld\n",
+                            plugin_get_name (ptr_plugin), total_lines,
+                            plugin_get_name (ptr_plugin), total_nicklist);
+        }
+        ptr_plugin = (ptr_plugin) ? ptr_plugin->next_plugin : weechat_plugins;
+        if (!ptr_plugin)
+            break;
+    }
+}
+
+/*
+ * Builds metrics of WeeChat core, in Prometheus text format.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+metrics_build ()
+{
+    char *result;
+
+    metrics_string = NULL;
+    metrics_string_size = 0;
+    metrics_string_length = 0;
+
+    metrics_build_loop ();
+    metrics_build_latency ();
+    metrics_build_hooks ();
+    metrics_build_buffers ();
+    metrics_build_memory ();
+
+    result = metrics_string;
+    metrics_string = NULL;
+    metrics_string_size = 0;
+    metrics_string_length = 0;
+
+    return result;
+}
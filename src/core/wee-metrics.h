@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_METRICS_H
+#define WEECHAT_METRICS_H 1
+
+#include "wee-hook.h"
+
+/* number of buckets for histogram of main loop time (without "+Inf") */
+#define METRICS_LOOP_NUM_BUCKETS 12
+
+extern long long metrics_loop_count[];
+extern long long metrics_loop_time_sum;
+extern long long metrics_hook_calls[];
+extern long long metrics_hook_time[];
+
+extern void metrics_loop_start ();
+extern void metrics_loop_end ();
+extern void metrics_wait_start ();
+extern void metrics_wait_end ();
+extern char *metrics_build ();
+
+#endif /* WEECHAT_METRICS_H */
@@ -48,6 +48,9 @@
 #include <errno.h>
 #include <gcrypt.h>
 #include <sys/time.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
 #if defined(__OpenBSD__)
 #include <sys/uio.h>
 #endif
@@ -68,6 +71,20 @@
 
 int network_init_gnutls_ok = 0;
 
+/* cache of resolved addresses (shared by connect threads) */
+struct t_network_dns_cache *network_dns_cache = NULL;
+struct t_network_dns_cache *last_network_dns_cache = NULL;
+int network_dns_cache_count = 0;
+pthread_mutex_t network_dns_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* connect threads and queue of jobs */
+struct t_network_connect_job *network_connect_jobs = NULL;
+struct t_network_connect_job *last_network_connect_job = NULL;
+int network_connect_threads = 0;
+int network_connect_threads_idle = 0;
+pthread_mutex_t network_connect_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t network_connect_cond = PTHREAD_COND_INITIALIZER;
+
 #ifdef HAVE_GNUTLS
 gnutls_certificate_credentials_t gnutls_xcred; /* GnuTLS client credentials */
 #endif /* HAVE_GNUTLS */
@@ -165,6 +182,8 @@ network_end ()
 #endif /* HAVE_GNUTLS */
         network_init_gnutls_ok = 0;
     }
+
+    network_dns_cache_flush ();
 }
 
 /*
@@ -231,6 +250,297 @@ network_recv_with_retry (int sock, void *buffer, int length, int flags)
     return total_recv;
 }
 
+/*
+ * Duplicates a list of addresses returned by getaddrinfo.
+ *
+ * Note: result must be freed with network_addrinfo_free (not freeaddrinfo).
+ *
+ * Returns pointer to new list, NULL if error.
+ */
+
+struct addrinfo *
+network_addrinfo_dup (const struct addrinfo *res)
+{
+    struct addrinfo *new_res, *last_res, *new_addrinfo;
+    const struct addrinfo *ptr_res;
+
+    new_res = NULL;
+    last_res = NULL;
+
+    for (ptr_res = res; ptr_res; ptr_res = ptr_res->ai_next)
+    {
+        new_addrinfo = malloc (sizeof (*new_addrinfo));
+        if (!new_addrinfo)
+            goto error;
+        memcpy (new_addrinfo, ptr_res, sizeof (*new_addrinfo));
+        new_addrinfo->ai_addr = NULL;
+        new_addrinfo->ai_canonname = NULL;
+        new_addrinfo->ai_next = NULL;
+        if (last_res)
+            last_res->ai_next = new_addrinfo;
+        else
+            new_res = new_addrinfo;
+        last_res = new_addrinfo;
+        if (ptr_res->ai_addr)
+        {
+            new_addrinfo->ai_addr = malloc (ptr_res->ai_addrlen);
+            if (!new_addrinfo->ai_addr)
+                goto error;
+            memcpy (new_addrinfo->ai_addr, ptr_res->ai_addr,
+                    ptr_res->ai_addrlen);
+        }
+        if (ptr_res->ai_canonname)
+        {
+            new_addrinfo->ai_canonname = strdup (ptr_res->ai_canonname);
+            if (!new_addrinfo->ai_canonname)
+                goto error;
+        }
+    }
+
+    return new_res;
+
+error:
+    network_addrinfo_free (new_res);
+    return NULL;
+}
+
+/*
+ * Frees a list of addresses duplicated by network_addrinfo_dup.
+ */
+
+void
+network_addrinfo_free (struct addrinfo *res)
+{
+    struct addrinfo *ptr_next;
+
+    while (res)
+    {
+        ptr_next = res->ai_next;
+        if (res->ai_addr)
+            free (res->ai_addr);
+        if (res->ai_canonname)
+            free (res->ai_canonname);
+        free (res);
+        res = ptr_next;
+    }
+}
+
+/*
+ * Searches an address in DNS cache.
+ *
+ * Note: the DNS cache mutex must be locked by caller.
+ *
+ * Returns pointer to entry found, NULL if not found.
+ */
+
+struct t_network_dns_cache *
+network_dns_cache_search (const char *address, const char *port, int family)
+{
+    struct t_network_dns_cache *ptr_entry;
+
+    for (ptr_entry = network_dns_cache; ptr_entry;
+         ptr_entry = ptr_entry->next_entry)
+    {
+        if ((ptr_entry->family == family)
+            && (strcmp (ptr_entry->port, port) == 0)
+            && (strcmp (ptr_entry->address, address) == 0))
+        {
+            return ptr_entry;
+        }
+    }
+
+    /* entry not found */
+    return NULL;
+}
+
+/*
+ * Frees an entry of DNS cache and removes it from list.
+ *
+ * Note: the DNS cache mutex must be locked by caller.
+ */
+
+void
+network_dns_cache_free (struct t_network_dns_cache *entry)
+{
+    if (entry->prev_entry)
+        (entry->prev_entry)->next_entry = entry->next_entry;
+    if (entry->next_entry)
+        (entry->next_entry)->prev_entry = entry->prev_entry;
+    if (network_dns_cache == entry)
+        network_dns_cache = entry->next_entry;
+    if (last_network_dns_cache == entry)
+        last_network_dns_cache = entry->prev_entry;
+
+    free (entry->address);
+    free (entry->port);
+    network_addrinfo_free (entry->res);
+    free (entry);
+
+    network_dns_cache_count--;
+}
+
+/*
+ * Adds addresses resolved in DNS cache; they are kept "ttl" seconds.
+ *
+ * The oldest entry is removed if the cache is full.
+ */
+
+void
+network_dns_cache_add (const char *address, const char *port, int family,
+                       const struct addrinfo *res, int ttl)
+{
+    struct t_network_dns_cache *new_entry, *ptr_entry;
+
+    new_entry = malloc (sizeof (*new_entry));
+    if (!new_entry)
+        return;
+    new_entry->address = strdup (address);
+    new_entry->port = strdup (port);
+    new_entry->family = family;
+    new_entry->res = network_addrinfo_dup (res);
+    new_entry->expire = time (NULL) + ttl;
+    if (!new_entry->address || !new_entry->port || !new_entry->res)
+    {
+        if (new_entry->address)
+            free (new_entry->address);
+        if (new_entry->port)
+            free (new_entry->port);
+        network_addrinfo_free (new_entry->res);
+        free (new_entry);
+        return;
+    }
+
+    pthread_mutex_lock (&network_dns_cache_mutex);
+
+    ptr_entry = network_dns_cache_search (address, port, family);
+    if (ptr_entry)
+        network_dns_cache_free (ptr_entry);
+    if (network_dns_cache_count >= NETWORK_DNS_CACHE_MAX_ENTRIES)
+        network_dns_cache_free (network_dns_cache);
+
+    new_entry->prev_entry = last_network_dns_cache;
+    new_entry->next_entry = NULL;
+    if (last_network_dns_cache)
+        last_network_dns_cache->next_entry = new_entry;
+    else
+        network_dns_cache = new_entry;
+    last_network_dns_cache = new_entry;
+    network_dns_cache_count++;
+
+    pthread_mutex_unlock (&network_dns_cache_mutex);
+}
+
+/*
+ * Gets a copy of addresses found in DNS cache (expired entries are removed).
+ *
+ * Note: result must be freed with network_addrinfo_free.
+ *
+ * Returns list of addresses, NULL if not found in cache.
+ */
+
+struct addrinfo *
+network_dns_cache_get (const char *address, const char *port, int family)
+{
+    struct t_network_dns_cache *ptr_entry;
+    struct addrinfo *res;
+
+    res = NULL;
+
+    pthread_mutex_lock (&network_dns_cache_mutex);
+
+    ptr_entry = network_dns_cache_search (address, port, family);
+    if (ptr_entry)
+    {
+        if (ptr_entry->expire > time (NULL))
+            res = network_addrinfo_dup (ptr_entry->res);
+        else
+            network_dns_cache_free (ptr_entry);
+    }
+
+    pthread_mutex_unlock (&network_dns_cache_mutex);
+
+    return res;
+}
+
+/*
+ * Removes an address from DNS cache.
+ */
+
+void
+network_dns_cache_remove (const char *address, const char *port, int family)
+{
+    struct t_network_dns_cache *ptr_entry;
+
+    pthread_mutex_lock (&network_dns_cache_mutex);
+
+    ptr_entry = network_dns_cache_search (address, port, family);
+    if (ptr_entry)
+        network_dns_cache_free (ptr_entry);
+
+    pthread_mutex_unlock (&network_dns_cache_mutex);
+}
+
+/*
+ * Removes all entries from DNS cache.
+ */
+
+void
+network_dns_cache_flush ()
+{
+    pthread_mutex_lock (&network_dns_cache_mutex);
+
+    while (network_dns_cache)
+    {
+        network_dns_cache_free (network_dns_cache);
+    }
+
+    pthread_mutex_unlock (&network_dns_cache_mutex);
+}
+
+/*
+ * Resolves an address with getaddrinfo, using the DNS cache if "ttl" is
+ * greater than 0.
+ *
+ * Note: result must be freed with network_addrinfo_free (not freeaddrinfo).
+ *
+ * Returns value of getaddrinfo (0 if OK).
+ */
+
+int
+network_getaddrinfo (const char *address, const char *port,
+                     const struct addrinfo *hints, struct addrinfo **res,
+                     int ttl)
+{
+    struct addrinfo *res_getaddrinfo;
+    int rc;
+
+    *res = NULL;
+
+    if (ttl > 0)
+    {
+        *res = network_dns_cache_get (address, port, hints->ai_family);
+        if (*res)
+            return 0;
+    }
+
+    res_getaddrinfo = NULL;
+    rc = getaddrinfo (address, port, hints, &res_getaddrinfo);
+    if (rc != 0)
+        return rc;
+
+    if (res_getaddrinfo)
+    {
+        *res = network_addrinfo_dup (res_getaddrinfo);
+        freeaddrinfo (res_getaddrinfo);
+        if (!*res)
+            return EAI_MEMORY;
+        if (ttl > 0)
+            network_dns_cache_add (address, port, hints->ai_family, *res, ttl);
+    }
+
+    return 0;
+}
+
 /*
  * Establishes a connection and authenticates with a HTTP proxy.
  *
@@ -602,10 +912,11 @@ network_pass_proxy (const char *proxy, int sock, const char *address, int port)
 }
 
 /*
- * Connects to a remote host and wait for connection if socket is non blocking.
+ * Connects to a remote host and wait for connection if socket is non blocking
+ * (timeout is in milliseconds, -1 to wait without limit).
  *
  * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * process or in a connect thread.
  *
  * Returns:
  *   1: OK
@@ -613,7 +924,8 @@ network_pass_proxy (const char *proxy, int sock, const char *address, int port)
  */
 
 int
-network_connect (int sock, const struct sockaddr *addr, socklen_t addrlen)
+network_connect (int sock, const struct sockaddr *addr, socklen_t addrlen,
+                 int timeout)
 {
     struct pollfd poll_fd;
     int ready, value;
@@ -635,8 +947,8 @@ network_connect (int sock, const struct sockaddr *addr, socklen_t addrlen)
         poll_fd.fd = sock;
         poll_fd.events = POLLOUT;
         poll_fd.revents = 0;
-        ready = poll (&poll_fd, 1, -1);
-        if (ready < 0)
+        ready = poll (&poll_fd, 1, timeout);
+        if (ready <= 0)
             break;
         if (ready > 0)
         {
@@ -715,7 +1027,7 @@ network_connect_to (const char *proxy, struct sockaddr *address,
         if (sock == -1)
             goto error;
         if (!network_connect (sock, proxy_addrinfo->ai_addr,
-                              proxy_addrinfo->ai_addrlen))
+                              proxy_addrinfo->ai_addrlen, -1))
             goto error;
         if (!network_pass_proxy (proxy, sock, ip, port))
             goto error;
@@ -725,7 +1037,7 @@ network_connect_to (const char *proxy, struct sockaddr *address,
         sock = socket (address->sa_family, SOCK_STREAM, 0);
         if (sock == -1)
             goto error;
-        if (!network_connect (sock, address, address_length))
+        if (!network_connect (sock, address, address_length, -1))
             goto error;
     }
 
@@ -743,11 +1055,11 @@ error:
 }
 
 /*
- * Connects to peer in a child process.
+ * Connects to peer in a child process or a connect thread.
  */
 
 void
-network_connect_child (struct t_hook *hook_connect)
+network_connect_child (struct t_network_connect_job *job)
 {
     struct t_proxy *ptr_proxy;
     struct addrinfo hints, *res_local, *res_remote, *ptr_res, *ptr_loc;
@@ -773,6 +1085,7 @@ network_connect_child (struct t_hook *hook_connect)
     struct addrinfo **res_reorder;
     int last_af;
     struct timeval tv_time;
+    unsigned int seed;
 
     res_local = NULL;
     res_remote = NULL;
@@ -784,20 +1097,25 @@ network_connect_child (struct t_hook *hook_connect)
 
     ptr_address = NULL;
 
+    /*
+     * this function runs in threads of the connect pool: rand() is not
+     * thread-safe, so rand_r() is used with a seed for this connection
+     */
     gettimeofday (&tv_time, NULL);
-    srand ((tv_time.tv_sec * tv_time.tv_usec) ^ getpid ());
+    seed = (unsigned int)((tv_time.tv_sec * tv_time.tv_usec) ^ getpid ()
+                          ^ (unsigned long)job);
 
     ptr_proxy = NULL;
-    if (HOOK_CONNECT(hook_connect, proxy)
-        && HOOK_CONNECT(hook_connect, proxy)[0])
+    if (job->proxy
+        && job->proxy[0])
     {
-        ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+        ptr_proxy = proxy_search (job->proxy);
         if (!ptr_proxy)
         {
             /* proxy not found */
             snprintf (status_without_string, sizeof (status_without_string),
                       "%c00000", '0' + WEECHAT_HOOK_CONNECT_PROXY_ERROR);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
+            num_written = write (job->child_write,
                                  status_without_string, strlen (status_without_string));
             (void) num_written;
             goto end;
@@ -816,14 +1134,15 @@ network_connect_child (struct t_hook *hook_connect)
         hints.ai_family = (CONFIG_BOOLEAN(ptr_proxy->options[PROXY_OPTION_IPV6])) ?
             AF_UNSPEC : AF_INET;
         snprintf (port, sizeof (port), "%d", CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_PORT]));
-        rc = getaddrinfo (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_ADDRESS]),
-                          port, &hints, &res_remote);
+        rc = network_getaddrinfo (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_ADDRESS]),
+                                  port, &hints, &res_remote, 0);
     }
     else
     {
-        hints.ai_family = HOOK_CONNECT(hook_connect, ipv6) ? AF_UNSPEC : AF_INET;
-        snprintf (port, sizeof (port), "%d", HOOK_CONNECT(hook_connect, port));
-        rc = getaddrinfo (HOOK_CONNECT(hook_connect, address), port, &hints, &res_remote);
+        hints.ai_family = job->ipv6 ? AF_UNSPEC : AF_INET;
+        snprintf (port, sizeof (port), "%d", job->port);
+        rc = network_getaddrinfo (job->address, port, &hints, &res_remote,
+                                  job->dns_cache_ttl);
     }
 
     if (rc != 0)
@@ -844,14 +1163,14 @@ network_connect_child (struct t_hook *hook_connect)
         }
         if (status_with_string)
         {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
+            num_written = write (job->child_write,
                                  status_with_string, strlen (status_with_string));
         }
         else
         {
             snprintf (status_without_string, sizeof (status_without_string),
                       "%c00000", '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
+            num_written = write (job->child_write,
                                  status_without_string, strlen (status_without_string));
         }
         (void) num_written;
@@ -863,15 +1182,15 @@ network_connect_child (struct t_hook *hook_connect)
         /* address not found */
         snprintf (status_without_string, sizeof (status_without_string),
                   "%c00000", '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
+        num_written = write (job->child_write,
                              status_without_string, strlen (status_without_string));
         (void) num_written;
         goto end;
     }
 
     /* set local hostname/IP if asked by user */
-    if (HOOK_CONNECT(hook_connect, local_hostname)
-        && HOOK_CONNECT(hook_connect, local_hostname[0]))
+    if (job->local_hostname
+        && job->local_hostname[0])
     {
         memset (&hints, 0, sizeof (hints));
         hints.ai_family = AF_UNSPEC;
@@ -879,7 +1198,7 @@ network_connect_child (struct t_hook *hook_connect)
 #ifdef AI_ADDRCONFIG
         hints.ai_flags = AI_ADDRCONFIG;
 #endif /* AI_ADDRCONFIG */
-        rc = getaddrinfo (HOOK_CONNECT(hook_connect, local_hostname),
+        rc = getaddrinfo (job->local_hostname,
                           NULL, &hints, &res_local);
         if (rc != 0)
         {
@@ -899,14 +1218,14 @@ network_connect_child (struct t_hook *hook_connect)
             }
             if (status_with_string)
             {
-                num_written = write (HOOK_CONNECT(hook_connect, child_write),
+                num_written = write (job->child_write,
                                      status_with_string, strlen (status_with_string));
             }
             else
             {
                 snprintf (status_without_string, sizeof (status_without_string),
                           "%c00000", '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR);
-                num_written = write (HOOK_CONNECT(hook_connect, child_write),
+                num_written = write (job->child_write,
                                      status_without_string, strlen (status_without_string));
             }
             (void) num_written;
@@ -918,7 +1237,7 @@ network_connect_child (struct t_hook *hook_connect)
             /* address not found */
             snprintf (status_without_string, sizeof (status_without_string),
                       "%c00000", '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
+            num_written = write (job->child_write,
                                  status_without_string, strlen (status_without_string));
             (void) num_written;
             goto end;
@@ -953,14 +1272,14 @@ network_connect_child (struct t_hook *hook_connect)
     {
         snprintf (status_without_string, sizeof (status_without_string),
                   "%c00000", '0' + WEECHAT_HOOK_CONNECT_MEMORY_ERROR);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
+        num_written = write (job->child_write,
                              status_without_string, strlen (status_without_string));
         (void) num_written;
         goto end;
     }
 
     /* reorder groups */
-    retry = HOOK_CONNECT(hook_connect, retry);
+    retry = job->retry;
     if (num_groups > 0)
     {
         retry %= num_groups;
@@ -984,7 +1303,7 @@ network_connect_child (struct t_hook *hook_connect)
             if (tmp_num_groups >= retry)
             {
                 /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
+                rand_num = tmp_host + (rand_r (&seed) % ((i + 1) - tmp_host));
                 if (rand_num == i)
                     res_reorder[i++] = ptr_res;
                 else
@@ -1015,7 +1334,7 @@ network_connect_child (struct t_hook *hook_connect)
             if (tmp_num_groups < retry)
             {
                 /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
+                rand_num = tmp_host + (rand_r (&seed) % ((i + 1) - tmp_host));
                 if (rand_num == i)
                     res_reorder[i++] = ptr_res;
                 else
@@ -1035,7 +1354,7 @@ network_connect_child (struct t_hook *hook_connect)
         /* no IP addresses found (all AF_UNSPEC) */
         snprintf (status_without_string, sizeof (status_without_string),
                   "%c00000", '0' + WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
+        num_written = write (job->child_write,
                              status_without_string, strlen (status_without_string));
         (void) num_written;
         goto end;
@@ -1064,19 +1383,19 @@ network_connect_child (struct t_hook *hook_connect)
             {
                 if (ptr_res->ai_family == AF_INET)
                 {
-                    sock = HOOK_CONNECT(hook_connect, sock_v4[j]);
+                    sock = job->sock_v4[j];
                     if (sock != -1)
                     {
-                        HOOK_CONNECT(hook_connect, sock_v4[j]) = -1;
+                        job->sock_v4[j] = -1;
                         break;
                     }
                 }
                 else if (ptr_res->ai_family == AF_INET6)
                 {
-                    sock = HOOK_CONNECT(hook_connect, sock_v6[j]);
+                    sock = job->sock_v6[j];
                     if (sock != -1)
                     {
-                        HOOK_CONNECT(hook_connect, sock_v6[j]) = -1;
+                        job->sock_v6[j] = -1;
                         break;
                     }
                 }
@@ -1129,7 +1448,8 @@ network_connect_child (struct t_hook *hook_connect)
         }
 
         /* connect to peer */
-        if (network_connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen))
+        if (network_connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen,
+                             job->timeout))
         {
             status_str[0] = '0' + WEECHAT_HOOK_CONNECT_OK;
             rc = getnameinfo (ptr_res->ai_addr, ptr_res->ai_addrlen,
@@ -1147,14 +1467,9 @@ network_connect_child (struct t_hook *hook_connect)
         }
     }
 
-    HOOK_CONNECT(hook_connect, sock) = sock;
-
     if (ptr_proxy && status_str[0] == '0' + WEECHAT_HOOK_CONNECT_OK)
     {
-        if (!network_pass_proxy (HOOK_CONNECT(hook_connect, proxy),
-                                 HOOK_CONNECT(hook_connect, sock),
-                                 HOOK_CONNECT(hook_connect, address),
-                                 HOOK_CONNECT(hook_connect, port)))
+        if (!network_pass_proxy (job->proxy, sock, job->address, job->port))
         {
             /* proxy fails to connect to peer */
             status_str[0] = '0' + WEECHAT_HOOK_CONNECT_PROXY_ERROR;
@@ -1177,7 +1492,7 @@ network_connect_child (struct t_hook *hook_connect)
 
         if (status_with_string)
         {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
+            num_written = write (job->child_write,
                                  status_with_string, strlen (status_with_string));
             (void) num_written;
         }
@@ -1185,7 +1500,7 @@ network_connect_child (struct t_hook *hook_connect)
         {
             snprintf (status_without_string, sizeof (status_without_string),
                       "%s00000", status_str);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
+            num_written = write (job->child_write,
                                  status_without_string, strlen (status_without_string));
             (void) num_written;
         }
@@ -1210,12 +1525,15 @@ network_connect_child (struct t_hook *hook_connect)
             cmsg->cmsg_len = CMSG_LEN(sizeof (sock));
             memcpy(CMSG_DATA(cmsg), &sock, sizeof (sock));
             msg.msg_controllen = cmsg->cmsg_len;
-            num_written = sendmsg (HOOK_CONNECT(hook_connect, child_send), &msg, 0);
+            num_written = sendmsg (job->child_send, &msg, 0);
             (void) num_written;
+
+            /* the parent has its own copy of socket now */
+            close (sock);
         }
         else
         {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write), &sock, sizeof (sock));
+            num_written = write (job->child_write, &sock, sizeof (sock));
             (void) num_written;
         }
     }
@@ -1223,9 +1541,19 @@ network_connect_child (struct t_hook *hook_connect)
     {
         snprintf (status_without_string, sizeof (status_without_string),
                   "%s00000", status_str);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
+        num_written = write (job->child_write,
                              status_without_string, strlen (status_without_string));
         (void) num_written;
+
+        if (sock >= 0)
+            close (sock);
+
+        /* cached addresses may be obsolete: resolve again next time */
+        if (!ptr_proxy && (job->dns_cache_ttl > 0))
+        {
+            network_dns_cache_remove (job->address, port,
+                                      (job->ipv6) ? AF_UNSPEC : AF_INET);
+        }
     }
 
 end:
@@ -1236,7 +1564,166 @@ end:
     if (res_local)
         freeaddrinfo (res_local);
     if (res_remote)
-        freeaddrinfo (res_remote);
+        network_addrinfo_free (res_remote);
+}
+
+/*
+ * Creates a connect job with info from a hook connect.
+ *
+ * If "thread" is 1, the job will run in a connect thread and must not use
+ * any data of the hook: strings are duplicated and proxy is not allowed.
+ *
+ * Returns pointer to new job, NULL if error.
+ */
+
+struct t_network_connect_job *
+network_connect_job_new (struct t_hook *hook_connect, int thread)
+{
+    struct t_network_connect_job *new_job;
+
+    new_job = malloc (sizeof (*new_job));
+    if (!new_job)
+        return NULL;
+
+    new_job->proxy = (!thread && HOOK_CONNECT(hook_connect, proxy)) ?
+        strdup (HOOK_CONNECT(hook_connect, proxy)) : NULL;
+    new_job->address = strdup (HOOK_CONNECT(hook_connect, address));
+    new_job->port = HOOK_CONNECT(hook_connect, port);
+    new_job->ipv6 = HOOK_CONNECT(hook_connect, ipv6);
+    new_job->retry = HOOK_CONNECT(hook_connect, retry);
+    new_job->local_hostname = (HOOK_CONNECT(hook_connect, local_hostname)) ?
+        strdup (HOOK_CONNECT(hook_connect, local_hostname)) : NULL;
+    new_job->sock_v4 = (thread) ? NULL : HOOK_CONNECT(hook_connect, sock_v4);
+    new_job->sock_v6 = (thread) ? NULL : HOOK_CONNECT(hook_connect, sock_v6);
+    new_job->timeout = (thread) ?
+        CONFIG_INTEGER(config_network_connection_timeout) * 1000 : -1;
+    new_job->dns_cache_ttl = (thread) ?
+        CONFIG_INTEGER(config_network_dns_cache_ttl) : 0;
+    new_job->child_write = HOOK_CONNECT(hook_connect, child_write);
+    new_job->child_send = HOOK_CONNECT(hook_connect, child_send);
+    new_job->next_job = NULL;
+
+    if (!new_job->address)
+    {
+        network_connect_job_free (new_job);
+        return NULL;
+    }
+
+    return new_job;
+}
+
+/*
+ * Frees a connect job.
+ */
+
+void
+network_connect_job_free (struct t_network_connect_job *job)
+{
+    if (job->proxy)
+        free (job->proxy);
+    if (job->address)
+        free (job->address);
+    if (job->local_hostname)
+        free (job->local_hostname);
+    free (job);
+}
+
+/*
+ * Runs connect jobs queued by the main thread (blocking calls to getaddrinfo
+ * and connect are made here, the result is sent to the main thread like a
+ * child process would do).
+ */
+
+void *
+network_connect_thread (void *arg)
+{
+    struct t_network_connect_job *ptr_job;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&network_connect_mutex);
+
+    while (1)
+    {
+        while (!network_connect_jobs)
+        {
+            network_connect_threads_idle++;
+            pthread_cond_wait (&network_connect_cond, &network_connect_mutex);
+            network_connect_threads_idle--;
+        }
+
+        ptr_job = network_connect_jobs;
+        network_connect_jobs = ptr_job->next_job;
+        if (!network_connect_jobs)
+            last_network_connect_job = NULL;
+
+        pthread_mutex_unlock (&network_connect_mutex);
+
+        network_connect_child (ptr_job);
+
+        /* closing pipes tells the main thread that job is done */
+        close (ptr_job->child_write);
+        close (ptr_job->child_send);
+        network_connect_job_free (ptr_job);
+
+        pthread_mutex_lock (&network_connect_mutex);
+    }
+
+    return NULL;
+}
+
+/*
+ * Queues a connect job for the connect threads, a new thread is started if
+ * all threads are busy (up to NETWORK_CONNECT_MAX_THREADS).
+ *
+ * Returns:
+ *   1: OK (job will be run by a thread)
+ *   0: error (no thread available)
+ */
+
+int
+network_connect_thread_queue (struct t_network_connect_job *job)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t sigset, old_sigset;
+    int rc;
+
+    pthread_mutex_lock (&network_connect_mutex);
+
+    if ((network_connect_threads_idle == 0)
+        && (network_connect_threads < NETWORK_CONNECT_MAX_THREADS))
+    {
+        /* signals must be received by the main thread only */
+        sigfillset (&sigset);
+        pthread_sigmask (SIG_SETMASK, &sigset, &old_sigset);
+        pthread_attr_init (&attr);
+        pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+        rc = pthread_create (&thread, &attr, &network_connect_thread, NULL);
+        pthread_attr_destroy (&attr);
+        pthread_sigmask (SIG_SETMASK, &old_sigset, NULL);
+        if (rc == 0)
+            network_connect_threads++;
+        else if (network_connect_threads == 0)
+        {
+            pthread_mutex_unlock (&network_connect_mutex);
+            return 0;
+        }
+    }
+
+    job->next_job = NULL;
+    if (last_network_connect_job)
+        last_network_connect_job->next_job = job;
+    else
+        network_connect_jobs = job;
+    last_network_connect_job = job;
+
+    pthread_cond_signal (&network_connect_cond);
+
+    pthread_mutex_unlock (&network_connect_mutex);
+
+    return 1;
 }
 
 /*
@@ -1299,8 +1786,9 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
             || (((flags & HOOK_FD_FLAG_WRITE) == HOOK_FD_FLAG_WRITE)
                 && (direction != 1)))
         {
-            HOOK_FD(HOOK_CONNECT(hook_connect, handshake_hook_fd), flags) =
-                (direction) ? HOOK_FD_FLAG_WRITE: HOOK_FD_FLAG_READ;
+            hook_fd_set_flags (HOOK_CONNECT(hook_connect, handshake_hook_fd),
+                               (direction) ?
+                               HOOK_FD_FLAG_WRITE: HOOK_FD_FLAG_READ);
         }
     }
     else if (rc != GNUTLS_E_SUCCESS)
@@ -1386,7 +1874,7 @@ network_connect_gnutls_handshake_timer_cb (const void *pointer,
 #endif /* HAVE_GNUTLS */
 
 /*
- * Reads connection progress from child process.
+ * Reads connection progress from child process or connect thread.
  */
 
 int
@@ -1632,12 +2120,17 @@ network_connect_child_read_cb (const void *pointer, void *data, int fd)
 }
 
 /*
- * Connects with fork (called by hook_connect() only!).
+ * Starts connection (called by hook_connect() only!).
+ *
+ * Without proxy, the connection is made in a connect thread; a child process
+ * is forked for a proxy (which uses configuration options) or if the socket
+ * can not be sent with a socketpair.
  */
 
 void
-network_connect_with_fork (struct t_hook *hook_connect)
+network_connect_start (struct t_hook *hook_connect)
 {
+    struct t_network_connect_job *job;
     int child_pipe[2], child_socket[2], rc, i;
     char str_error[1024];
 #ifdef HAVE_GNUTLS
@@ -1733,6 +2226,25 @@ network_connect_with_fork (struct t_hook *hook_connect)
         }
     }
 
+    if (hook_socketpair_ok
+        && (!HOOK_CONNECT(hook_connect, proxy)
+            || !HOOK_CONNECT(hook_connect, proxy)[0]))
+    {
+        job = network_connect_job_new (hook_connect, 1);
+        if (job)
+        {
+            if (network_connect_thread_queue (job))
+            {
+                /* pipes are now owned by the thread */
+                HOOK_CONNECT(hook_connect, child_write) = -1;
+                HOOK_CONNECT(hook_connect, child_send) = -1;
+                network_connect_hook_child (hook_connect);
+                return;
+            }
+            network_connect_job_free (job);
+        }
+    }
+
     switch (pid = fork ())
     {
         /* fork failed */
@@ -1754,7 +2266,9 @@ network_connect_with_fork (struct t_hook *hook_connect)
             close (HOOK_CONNECT(hook_connect, child_read));
             if (hook_socketpair_ok)
                 close (HOOK_CONNECT(hook_connect, child_recv));
-            network_connect_child (hook_connect);
+            job = network_connect_job_new (hook_connect, 0);
+            if (job)
+                network_connect_child (job);
             _exit (EXIT_SUCCESS);
     }
     /* parent process */
@@ -1766,6 +2280,17 @@ network_connect_with_fork (struct t_hook *hook_connect)
         close (HOOK_CONNECT(hook_connect, child_send));
         HOOK_CONNECT(hook_connect, child_send) = -1;
     }
+    network_connect_hook_child (hook_connect);
+}
+
+/*
+ * Hooks timer (for timeout) and reading of connection progress, sent by the
+ * child process or the connect thread.
+ */
+
+void
+network_connect_hook_child (struct t_hook *hook_connect)
+{
     HOOK_CONNECT(hook_connect, hook_child_timer) = hook_timer (hook_connect->plugin,
                                                                CONFIG_INTEGER(config_network_connection_timeout) * 1000,
                                                                0, 1,
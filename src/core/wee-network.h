@@ -22,8 +22,13 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <time.h>
+
+#define NETWORK_CONNECT_MAX_THREADS   8
+#define NETWORK_DNS_CACHE_MAX_ENTRIES 256
 
 struct t_hook;
+struct addrinfo;
 
 struct t_network_socks4
 {
@@ -43,16 +48,55 @@ struct t_network_socks5
                           /*              auth(user/pass) (2), ...          */
 };
 
+/* connection made by a child process or a connect thread */
+
+struct t_network_connect_job
+{
+    char *proxy;                       /* proxy used (never with a thread)  */
+    char *address;                     /* peer address                      */
+    int port;                          /* peer port                         */
+    int ipv6;                          /* use IPv6                          */
+    int retry;                         /* retry count                       */
+    char *local_hostname;              /* force local hostname (optional)   */
+    int *sock_v4;                      /* IPv4 sockets (if no socketpair)   */
+    int *sock_v6;                      /* IPv6 sockets (if no socketpair)   */
+    int timeout;                       /* connect timeout (ms, -1 = none)   */
+    int dns_cache_ttl;                 /* use DNS cache if > 0 (seconds)    */
+    int child_write;                   /* to write status for main thread   */
+    int child_send;                    /* to send socket to main thread     */
+    struct t_network_connect_job *next_job; /* link to next job in queue    */
+};
+
+/* cache of addresses resolved */
+
+struct t_network_dns_cache
+{
+    char *address;                     /* address resolved                  */
+    char *port;                        /* port resolved                     */
+    int family;                        /* AF_INET or AF_UNSPEC              */
+    struct addrinfo *res;              /* addresses found                   */
+    time_t expire;                     /* entry is valid until this time    */
+    struct t_network_dns_cache *prev_entry; /* link to previous entry       */
+    struct t_network_dns_cache *next_entry; /* link to next entry           */
+};
+
 extern int network_init_gnutls_ok;
 
 extern void network_init_gcrypt ();
 extern void network_set_gnutls_ca_file ();
 extern void network_init_gnutls ();
 extern void network_end ();
+extern struct addrinfo *network_addrinfo_dup (const struct addrinfo *res);
+extern void network_addrinfo_free (struct addrinfo *res);
 extern int network_pass_proxy (const char *proxy, int sock,
                                const char *address, int port);
 extern int network_connect_to (const char *proxy, struct sockaddr *address,
                                socklen_t address_length);
-extern void network_connect_with_fork (struct t_hook *hook_connect);
+extern void network_dns_cache_flush ();
+extern struct t_network_connect_job *network_connect_job_new (struct t_hook *hook_connect,
+                                                              int thread);
+extern void network_connect_job_free (struct t_network_connect_job *job);
+extern void network_connect_start (struct t_hook *hook_connect);
+extern void network_connect_hook_child (struct t_hook *hook_connect);
 
 #endif /* WEECHAT_NETWORK_H */
@@ -0,0 +1,551 @@
+/*
+ * wee-profile.c - sampling profiler for main loop and hook callbacks
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The profiler asks the kernel to send signal SIGPROF each
+ * PROFILE_SAMPLING_INTERVAL microseconds of CPU time used by WeeChat
+ * (setitimer with ITIMER_PROF). The signal handler only increments the
+ * counter of the current "stack", which is an id for the phase of main loop
+ * and the hook callbacks being executed (with plugin and script).
+ *
+ * Stacks are built in the main loop (when a phase changes or a hook callback
+ * is called), so that the signal handler does not allocate memory.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "weechat.h"
+#include "wee-profile.h"
+#include "wee-hashtable.h"
+#include "wee-hook.h"
+#include "wee-string.h"
+#include "wee-trace.h"
+#include "wee-util.h"
+#include "../gui/gui-chat.h"
+#include "../plugins/plugin.h"
+
+
+int profile_running = 0;               /* 1 if profiler is running          */
+
+char *profile_phase_string[PROFILE_NUM_PHASES] =
+{ "other", "timers", "refresh", "fd", "poll", "process" };
+
+struct t_hashtable *profile_stacks_ids = NULL; /* stack name -> id          */
+char *profile_stacks[PROFILE_MAX_STACKS]; /* stack names (frames sep. by ;) */
+int profile_stacks_phase[PROFILE_MAX_STACKS]; /* phase of each stack        */
+volatile unsigned int profile_samples[PROFILE_MAX_STACKS]; /* samples       */
+int profile_stacks_count = 0;          /* number of stacks                  */
+
+volatile sig_atomic_t profile_current_stack = 0; /* stack sampled           */
+int profile_depth = 0;                 /* depth of nested hook callbacks    */
+int profile_depth_stack[PROFILE_MAX_DEPTH]; /* stacks of parent callbacks   */
+
+enum t_profile_phase profile_phase = PROFILE_PHASE_OTHER; /* current phase  */
+struct timeval profile_phase_start;    /* start of current phase            */
+long long profile_phase_time[PROFILE_NUM_PHASES]; /* time by phase (µs)     */
+
+struct timeval profile_time_start;     /* start of profiling                */
+struct timeval profile_time_stop;      /* stop of profiling                 */
+long long profile_cpu_start;           /* CPU time used at start (µs)       */
+long long profile_cpu_stop;            /* CPU time used at stop (µs)        */
+
+#ifdef HAVE_TRACEPOINTS
+TRACE_SEMAPHORE(main_loop_phase);
+#endif /* HAVE_TRACEPOINTS */
+
+
+/*
+ * Callback for signal SIGPROF: counts a sample in current stack.
+ */
+
+void
+profile_sigprof_cb (int signo)
+{
+    /* make C compiler happy */
+    (void) signo;
+
+    profile_samples[profile_current_stack]++;
+}
+
+/*
+ * Returns CPU time used by WeeChat (user + system, in microseconds).
+ */
+
+long long
+profile_get_cpu_time ()
+{
+    struct rusage usage;
+
+    if (getrusage (RUSAGE_SELF, &usage) < 0)
+        return 0;
+
+    return ((long long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000)
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/*
+ * Frees all stacks.
+ */
+
+void
+profile_free_stacks ()
+{
+    int i;
+
+    for (i = 0; i < profile_stacks_count; i++)
+    {
+        free (profile_stacks[i]);
+        profile_stacks[i] = NULL;
+    }
+    profile_stacks_count = 0;
+
+    if (profile_stacks_ids)
+        hashtable_remove_all (profile_stacks_ids);
+}
+
+/*
+ * Gets id of a stack: parent stack with a frame added (a new stack is
+ * created if needed).
+ *
+ * If parent is -1, the frame is the root of stack.
+ *
+ * Returns id of stack, parent (or 0 for a root frame) if the max number of
+ * stacks is reached.
+ */
+
+int
+profile_get_stack (int parent, const char *frame)
+{
+    char name[4096], *ptr_name;
+    int id, *ptr_id;
+
+    if (parent >= 0)
+    {
+        snprintf (name, sizeof (name),
+                  "%s;%s", profile_stacks[parent], frame);
+    }
+    else
+    {
+        snprintf (name, sizeof (name), "%s", frame);
+    }
+
+    /* frames are separated by ";" and stack is followed by a space */
+    ptr_name = name + ((parent >= 0) ? strlen (profile_stacks[parent]) + 1 : 0);
+    while (ptr_name[0])
+    {
+        if ((ptr_name[0] == ';') || (ptr_name[0] == '\n'))
+            ptr_name[0] = ',';
+        else if (ptr_name[0] == ' ')
+            ptr_name[0] = '_';
+        ptr_name++;
+    }
+
+    ptr_id = hashtable_get (profile_stacks_ids, name);
+    if (ptr_id)
+        return *ptr_id;
+
+    if (profile_stacks_count >= PROFILE_MAX_STACKS)
+        return (parent >= 0) ? parent : 0;
+
+    id = profile_stacks_count;
+    profile_stacks[id] = strdup (name);
+    if (!profile_stacks[id])
+        return (parent >= 0) ? parent : 0;
+    profile_stacks_phase[id] = (parent >= 0) ?
+        profile_stacks_phase[parent] : (int)profile_phase;
+    profile_samples[id] = 0;
+    hashtable_set (profile_stacks_ids, name, &id);
+    profile_stacks_count++;
+
+    return id;
+}
+
+/*
+ * Starts the profiler (previous profile data is lost).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+profile_start ()
+{
+    struct sigaction act;
+    struct itimerval timer;
+    int i;
+
+    if (profile_running)
+        return 1;
+
+    if (!profile_stacks_ids)
+    {
+        profile_stacks_ids = hashtable_new (256,
+                                            WEECHAT_HASHTABLE_STRING,
+                                            WEECHAT_HASHTABLE_INTEGER,
+                                            NULL, NULL);
+        if (!profile_stacks_ids)
+            return 0;
+    }
+
+    profile_free_stacks ();
+
+    /* one stack for each phase of main loop (id is the phase) */
+    for (i = 0; i < PROFILE_NUM_PHASES; i++)
+    {
+        profile_phase = i;
+        profile_get_stack (-1, profile_phase_string[i]);
+        profile_phase_time[i] = 0;
+    }
+    profile_phase = PROFILE_PHASE_OTHER;
+    profile_current_stack = PROFILE_PHASE_OTHER;
+    profile_depth = 0;
+
+    gettimeofday (&profile_time_start, NULL);
+    profile_phase_start = profile_time_start;
+    profile_time_stop = profile_time_start;
+    profile_cpu_start = profile_get_cpu_time ();
+    profile_cpu_stop = profile_cpu_start;
+
+    sigemptyset (&act.sa_mask);
+    act.sa_flags = SA_RESTART;
+    act.sa_handler = &profile_sigprof_cb;
+    if (sigaction (SIGPROF, &act, NULL) < 0)
+        return 0;
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = PROFILE_SAMPLING_INTERVAL;
+    timer.it_value = timer.it_interval;
+    if (setitimer (ITIMER_PROF, &timer, NULL) < 0)
+    {
+        util_catch_signal (SIGPROF, SIG_IGN);
+        return 0;
+    }
+
+    profile_running = 1;
+
+    return 1;
+}
+
+/*
+ * Stops the profiler (profile data is kept until next start).
+ */
+
+void
+profile_stop ()
+{
+    struct itimerval timer;
+
+    if (!profile_running)
+        return;
+
+    memset (&timer, 0, sizeof (timer));
+    setitimer (ITIMER_PROF, &timer, NULL);
+
+    /* a pending signal must not terminate WeeChat (default action) */
+    util_catch_signal (SIGPROF, SIG_IGN);
+
+    profile_set_phase (PROFILE_PHASE_OTHER);
+    gettimeofday (&profile_time_stop, NULL);
+    profile_cpu_stop = profile_get_cpu_time ();
+
+    profile_running = 0;
+}
+
+/*
+ * Sets current phase of main loop (time spent in the previous phase is
+ * added to its total).
+ */
+
+void
+profile_set_phase (enum t_profile_phase phase)
+{
+    struct timeval now;
+    long long diff;
+
+    TRACE2(main_loop_phase, phase, profile_phase_string[phase]);
+
+    if (!profile_running)
+        return;
+
+    gettimeofday (&now, NULL);
+    diff = util_timeval_diff (&profile_phase_start, &now);
+    if (diff > 0)
+        profile_phase_time[profile_phase] += diff;
+    profile_phase_start = now;
+
+    profile_phase = phase;
+    if (profile_depth == 0)
+        profile_current_stack = phase;
+}
+
+/*
+ * Starts the call of a hook callback: samples are counted in a stack with
+ * plugin, script (if any) and hook added to current stack.
+ */
+
+void
+profile_hook_start (struct t_hook *hook)
+{
+    char description[512], frame[1024];
+    int id;
+
+    if (!profile_running)
+        return;
+
+    if (profile_depth < PROFILE_MAX_DEPTH)
+    {
+        profile_depth_stack[profile_depth] = profile_current_stack;
+        id = profile_get_stack (profile_current_stack,
+                                plugin_get_name (hook->plugin));
+        if (hook->subplugin)
+            id = profile_get_stack (id, hook->subplugin);
+        hook_get_description (hook, description, sizeof (description));
+        snprintf (frame, sizeof (frame), "%s:%s",
+                  hook_type_string[hook->type], description);
+        id = profile_get_stack (id, frame);
+        profile_current_stack = id;
+    }
+
+    profile_depth++;
+}
+
+/*
+ * Ends the call of a hook callback: samples are counted again in parent
+ * stack.
+ */
+
+void
+profile_hook_end ()
+{
+    if (!profile_running || (profile_depth == 0))
+        return;
+
+    profile_depth--;
+    if (profile_depth < PROFILE_MAX_DEPTH)
+        profile_current_stack = profile_depth_stack[profile_depth];
+}
+
+/*
+ * Compares two stacks by number of samples (for sort, descending order).
+ */
+
+int
+profile_compare_stacks_cb (const void *stack1, const void *stack2)
+{
+    unsigned int samples1, samples2;
+
+    samples1 = profile_samples[*((int *)stack1)];
+    samples2 = profile_samples[*((int *)stack2)];
+
+    return (samples1 < samples2) ? 1 : ((samples1 > samples2) ? -1 : 0);
+}
+
+/*
+ * Displays profile data: time and samples by phase of main loop, then the
+ * stacks with most samples.
+ */
+
+void
+profile_display ()
+{
+    struct timeval now;
+    unsigned long long total, phase_samples[PROFILE_NUM_PHASES];
+    long long duration, cpu;
+    int i, *ids, count;
+
+    if (profile_stacks_count == 0)
+    {
+        gui_chat_printf (NULL, _("Profiler: no data"));
+        return;
+    }
+
+    if (profile_running)
+    {
+        profile_set_phase (profile_phase);
+        gettimeofday (&now, NULL);
+        cpu = profile_get_cpu_time () - profile_cpu_start;
+    }
+    else
+    {
+        now = profile_time_stop;
+        cpu = profile_cpu_stop - profile_cpu_start;
+    }
+    duration = util_timeval_diff (&profile_time_start, &now);
+
+    total = 0;
+    for (i = 0; i < PROFILE_NUM_PHASES; i++)
+    {
+        phase_samples[i] = 0;
+    }
+    for (i = 0; i < profile_stacks_count; i++)
+    {
+        total += profile_samples[i];
+        phase_samples[profile_stacks_phase[i]] += profile_samples[i];
+    }
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     _("Profiler (%s): %.3fs (%.3fs of CPU), %llu samples"),
+                     (profile_running) ? _("running") : _("stopped"),
+                     ((float)duration) / 1000000,
+                     ((float)cpu) / 1000000,
+                     total);
+    gui_chat_printf (NULL, "  %-10s %12s %10s", "phase", "time (ms)", "samples");
+    for (i = 0; i < PROFILE_NUM_PHASES; i++)
+    {
+        gui_chat_printf (NULL, "  %-10s %12.3f %10llu",
+                         profile_phase_string[i],
+                         ((float)profile_phase_time[i]) / 1000,
+                         phase_samples[i]);
+    }
+
+    ids = malloc (profile_stacks_count * sizeof (*ids));
+    if (!ids)
+        return;
+    for (i = 0; i < profile_stacks_count; i++)
+    {
+        ids[i] = i;
+    }
+    qsort (ids, profile_stacks_count, sizeof (*ids),
+           &profile_compare_stacks_cb);
+    gui_chat_printf (NULL, _("  stacks with most samples:"));
+    count = 0;
+    for (i = 0; (i < profile_stacks_count) && (count < 20); i++)
+    {
+        if (profile_samples[ids[i]] == 0)
+            break;
+        gui_chat_printf (NULL, "  %10u  %s",
+                         profile_samples[ids[i]],
+                         profile_stacks[ids[i]]);
+        count++;
+    }
+    free (ids);
+}
+
+/*
+ * Writes stacks with samples in a file, one stack by line ("collapsed" format
+ * used to build flame graphs): "frame1;frame2;frame3 samples".
+ *
+ * If filename is NULL, the file PROFILE_FILENAME in WeeChat home is used.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+profile_dump (const char *filename)
+{
+    char *path;
+    int i, length, rc;
+    FILE *file;
+
+    if (profile_stacks_count == 0)
+        return 0;
+
+    if (filename && filename[0])
+    {
+        path = string_expand_home (filename);
+    }
+    else
+    {
+        length = strlen (weechat_home) + strlen (DIR_SEPARATOR)
+            + strlen (PROFILE_FILENAME) + 1;
+        path = malloc (length);
+        if (path)
+        {
+            snprintf (path, length, "%s%s%s",
+                      weechat_home, DIR_SEPARATOR, PROFILE_FILENAME);
+        }
+    }
+    if (!path)
+        return 0;
+
+    file = fopen (path, "w");
+    if (!file)
+    {
+        gui_chat_printf (NULL,
+                         _("%sUnable to write file \"%s\""),
+                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                         path);
+        free (path);
+        return 0;
+    }
+
+    rc = 1;
+    for (i = 0; i < profile_stacks_count; i++)
+    {
+        if (profile_samples[i] > 0)
+        {
+            if (fprintf (file, "%s %u\n",
+                         profile_stacks[i], profile_samples[i]) < 0)
+            {
+                rc = 0;
+                break;
+            }
+        }
+    }
+
+    if (fclose (file) != 0)
+        rc = 0;
+
+    if (rc)
+    {
+        gui_chat_printf (NULL, _("Profile written in file \"%s\""), path);
+    }
+    else
+    {
+        gui_chat_printf (NULL,
+                         _("%sUnable to write file \"%s\""),
+                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                         path);
+    }
+
+    free (path);
+
+    return rc;
+}
+
+/*
+ * Ends profiler: stops it and frees all data.
+ */
+
+void
+profile_end ()
+{
+    profile_stop ();
+    profile_free_stacks ();
+    if (profile_stacks_ids)
+    {
+        hashtable_free (profile_stacks_ids);
+        profile_stacks_ids = NULL;
+    }
+}
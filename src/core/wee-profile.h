@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_PROFILE_H
+#define WEECHAT_PROFILE_H 1
+
+/* interval between two samples (in microseconds of CPU time) */
+#define PROFILE_SAMPLING_INTERVAL 1000
+
+/* max number of different stacks (more stacks are counted in parent) */
+#define PROFILE_MAX_STACKS        4096
+
+/* max depth of nested hook callbacks */
+#define PROFILE_MAX_DEPTH         32
+
+/* default name of file with collapsed stacks (in WeeChat home) */
+#define PROFILE_FILENAME          "weechat_profile.txt"
+
+struct t_hook;
+
+/* phases of main loop */
+
+enum t_profile_phase
+{
+    PROFILE_PHASE_OTHER = 0,           /* outside phases below              */
+    PROFILE_PHASE_TIMERS,              /* execution of timers               */
+    PROFILE_PHASE_REFRESH,             /* refresh of screen                 */
+    PROFILE_PHASE_FD,                  /* callbacks of file descriptors     */
+    PROFILE_PHASE_POLL,                /* wait for file descriptors         */
+    PROFILE_PHASE_PROCESS,             /* run of processes                  */
+    /* number of phases */
+    PROFILE_NUM_PHASES,
+};
+
+extern int profile_running;
+
+extern int profile_start ();
+extern void profile_stop ();
+extern void profile_set_phase (enum t_profile_phase phase);
+extern void profile_hook_start (struct t_hook *hook);
+extern void profile_hook_end ();
+extern void profile_display ();
+extern int profile_dump (const char *filename);
+extern void profile_end ();
+
+#endif /* WEECHAT_PROFILE_H */
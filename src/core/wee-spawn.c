@@ -0,0 +1,958 @@
+/*
+ * wee-spawn.c - helper process used to spawn child processes
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The spawn helper is a process forked when WeeChat starts, after options
+ * are read (when memory used by WeeChat is still small, before plugins are
+ * loaded). Then WeeChat sends requests to this process
+ * (over a socket) to run commands, instead of calling fork() in the main
+ * process, which can be slow when WeeChat uses a lot of memory.
+ *
+ * The file descriptors of pipes for stdin/stdout/stderr are created by
+ * WeeChat and sent with the request (SCM_RIGHTS), so the child writes
+ * directly in the pipes read by WeeChat. The helper sends back the pid of
+ * child, and its exit status when the child has ended.
+ *
+ * Signals are sent to children by the helper too: only the helper knows if a
+ * child has been reaped (and then if its pid can be reused by another
+ * process).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#include "weechat.h"
+#include "wee-spawn.h"
+#include "wee-hashtable.h"
+#include "wee-hook.h"
+#include "wee-log.h"
+#include "wee-url.h"
+#include "wee-util.h"
+#include "../plugins/plugin.h"
+
+
+pid_t spawn_helper_pid = -1;           /* pid of spawn helper process       */
+int spawn_helper_socket = -1;          /* socket to talk with spawn helper  */
+
+
+/*
+ * Sends a message with an optional payload and file descriptors.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+spawn_send (int sock, struct t_spawn_message *message, const char *payload,
+            int *fds, int num_fds)
+{
+    struct msghdr msg;
+    struct iovec iov[2];
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(3 * sizeof (int))];
+    ssize_t num_sent;
+    size_t total, sent;
+    const char *ptr_data;
+
+    memset (&msg, 0, sizeof (msg));
+    iov[0].iov_base = message;
+    iov[0].iov_len = sizeof (*message);
+    iov[1].iov_base = (void *)payload;
+    iov[1].iov_len = (payload) ? (size_t)message->length : 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (iov[1].iov_len > 0) ? 2 : 1;
+
+    if (num_fds > 0)
+    {
+        memset (control, 0, sizeof (control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(num_fds * sizeof (int));
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(num_fds * sizeof (int));
+        memcpy (CMSG_DATA(cmsg), fds, num_fds * sizeof (int));
+    }
+
+    do
+    {
+        num_sent = sendmsg (sock, &msg, 0);
+    } while ((num_sent < 0) && (errno == EINTR));
+    if (num_sent <= 0)
+        return 0;
+
+    /* send the end of message if it was partially sent */
+    total = iov[0].iov_len + iov[1].iov_len;
+    sent = num_sent;
+    while (sent < total)
+    {
+        if (sent < iov[0].iov_len)
+            ptr_data = (const char *)message + sent;
+        else
+            ptr_data = payload + (sent - iov[0].iov_len);
+        num_sent = write (sock, ptr_data,
+                          (sent < iov[0].iov_len) ?
+                          iov[0].iov_len - sent : total - sent);
+        if (num_sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        sent += num_sent;
+    }
+
+    return 1;
+}
+
+/*
+ * Reads exactly "size" bytes on a socket.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error or end of file
+ */
+
+int
+spawn_read_all (int sock, char *buffer, size_t size)
+{
+    ssize_t num_read;
+
+    while (size > 0)
+    {
+        num_read = read (sock, buffer, size);
+        if (num_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        if (num_read == 0)
+            return 0;
+        buffer += num_read;
+        size -= num_read;
+    }
+
+    return 1;
+}
+
+/*
+ * Receives a message with its payload and file descriptors.
+ *
+ * Argument "payload" is set with the payload (NULL if no payload), it must be
+ * freed after use. Argument "fds" must have room for 3 file descriptors.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error or end of file
+ */
+
+int
+spawn_recv (int sock, struct t_spawn_message *message, char **payload,
+            int *fds, int *num_fds)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(3 * sizeof (int))];
+    ssize_t num_read;
+    int count;
+
+    *payload = NULL;
+    *num_fds = 0;
+
+    memset (&msg, 0, sizeof (msg));
+    iov.iov_base = message;
+    iov.iov_len = sizeof (*message);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+
+    do
+    {
+        num_read = recvmsg (sock, &msg, 0);
+    } while ((num_read < 0) && (errno == EINTR));
+    if (num_read <= 0)
+        return 0;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if ((cmsg->cmsg_level == SOL_SOCKET)
+            && (cmsg->cmsg_type == SCM_RIGHTS))
+        {
+            count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof (int);
+            if (count > 3)
+                count = 3;
+            memcpy (fds, CMSG_DATA(cmsg), count * sizeof (int));
+            *num_fds = count;
+        }
+    }
+
+    /* read the end of message if it was partially received */
+    if ((size_t)num_read < sizeof (*message))
+    {
+        if (!spawn_read_all (sock, (char *)message + num_read,
+                             sizeof (*message) - num_read))
+            goto error;
+    }
+
+    if ((message->length < 0) || (message->length > SPAWN_MAX_PAYLOAD))
+        goto error;
+
+    if (message->length > 0)
+    {
+        *payload = malloc (message->length + 1);
+        if (!*payload)
+            goto error;
+        if (!spawn_read_all (sock, *payload, message->length))
+            goto error;
+        (*payload)[message->length] = '\0';
+    }
+
+    return 1;
+
+error:
+    if (*payload)
+    {
+        free (*payload);
+        *payload = NULL;
+    }
+    while (*num_fds > 0)
+    {
+        (*num_fds)--;
+        close (fds[*num_fds]);
+    }
+    return 0;
+}
+
+/*
+ * Restores default action for all signals and unblocks them (the helper is
+ * forked by WeeChat and inherits its signal handlers).
+ */
+
+void
+spawn_reset_signals ()
+{
+    sigset_t sigset;
+    int i;
+
+    for (i = 1; i < NSIG; i++)
+    {
+        if ((i != SIGKILL) && (i != SIGSTOP))
+            util_catch_signal (i, SIG_DFL);
+    }
+    sigemptyset (&sigset);
+    sigprocmask (SIG_SETMASK, &sigset, NULL);
+}
+
+/*
+ * Redirects a standard stream of child to a file descriptor received with
+ * the request (or "/dev/null" if fd is -1).
+ */
+
+void
+spawn_child_redirect (int fd, int std_fd, const char *mode)
+{
+    FILE *f;
+
+    if (fd >= 0)
+    {
+        if (dup2 (fd, std_fd) < 0)
+            _exit (EXIT_FAILURE);
+        close (fd);
+    }
+    else
+    {
+        switch (std_fd)
+        {
+            case STDIN_FILENO:
+                f = freopen ("/dev/null", mode, stdin);
+                break;
+            case STDOUT_FILENO:
+                f = freopen ("/dev/null", mode, stdout);
+                break;
+            default:
+                f = freopen ("/dev/null", mode, stderr);
+                break;
+        }
+        (void) f;
+    }
+}
+
+/*
+ * Runs a request in the child process (forked by the spawn helper).
+ *
+ * This function never returns.
+ */
+
+void
+spawn_child_run (struct t_spawn_message *message, char *payload,
+                 int *fds, int num_fds)
+{
+    char **argv, *ptr_payload, *end_payload, *ptr_value;
+    int std_fds[3], flags[3], i, j, argc, rc;
+    struct t_hashtable *options;
+
+    /* signals ignored by the helper must not be ignored by the command */
+    spawn_reset_signals ();
+
+    /* file descriptors are sent in this order: stdin, stdout, stderr */
+    flags[0] = SPAWN_FD_STDIN;
+    flags[1] = SPAWN_FD_STDOUT;
+    flags[2] = SPAWN_FD_STDERR;
+    j = 0;
+    for (i = 0; i < 3; i++)
+    {
+        std_fds[i] = ((message->flags & flags[i]) && (j < num_fds)) ?
+            fds[j++] : -1;
+    }
+    spawn_child_redirect (std_fds[0], STDIN_FILENO, "r");
+    spawn_child_redirect (std_fds[1], STDOUT_FILENO, "w");
+    spawn_child_redirect (std_fds[2], STDERR_FILENO, "w");
+
+    end_payload = payload + message->length;
+
+    if (message->type == SPAWN_MSG_URL)
+    {
+        /* payload: URL, then options (key and value) */
+        options = hashtable_new (32,
+                                 WEECHAT_HASHTABLE_STRING,
+                                 WEECHAT_HASHTABLE_STRING,
+                                 NULL, NULL);
+        ptr_payload = payload + strlen (payload) + 1;
+        while (options && (ptr_payload < end_payload))
+        {
+            ptr_value = ptr_payload + strlen (ptr_payload) + 1;
+            if (ptr_value >= end_payload)
+                break;
+            hashtable_set (options, ptr_payload, ptr_value);
+            ptr_payload = ptr_value + strlen (ptr_value) + 1;
+        }
+        rc = weeurl_download (payload, options);
+        fflush (stdout);
+        fflush (stderr);
+        _exit (rc);
+    }
+
+    /* payload: command, then arguments for execvp */
+    argc = 0;
+    for (ptr_payload = payload + strlen (payload) + 1;
+         ptr_payload < end_payload;
+         ptr_payload += strlen (ptr_payload) + 1)
+    {
+        argc++;
+    }
+    argv = malloc ((argc + 1) * sizeof (argv[0]));
+    if (argv)
+    {
+        i = 0;
+        for (ptr_payload = payload + strlen (payload) + 1;
+             ptr_payload < end_payload;
+             ptr_payload += strlen (ptr_payload) + 1)
+        {
+            argv[i++] = ptr_payload;
+        }
+        argv[argc] = NULL;
+        if (argc > 0)
+            execvp (argv[0], argv);
+    }
+
+    /* should not be executed if execvp was OK */
+    fprintf (stderr, "Error with command '%s'\n", payload);
+    fflush (stderr);
+    _exit (EXIT_FAILURE);
+}
+
+/*
+ * Searches for a child in list of children running (not yet reaped).
+ *
+ * Returns index of child in list, -1 if not found.
+ */
+
+int
+spawn_helper_child_search (pid_t *children, int num_children, pid_t pid)
+{
+    int i;
+
+    if (pid <= 0)
+        return -1;
+
+    for (i = 0; i < num_children; i++)
+    {
+        if (children[i] == pid)
+            return i;
+    }
+
+    /* child not found */
+    return -1;
+}
+
+/*
+ * Sends a signal to a child, only if it has not been reaped yet (otherwise
+ * the pid may be used by another process).
+ *
+ * Returns 0 if the signal was sent, errno if error.
+ */
+
+int
+spawn_helper_child_kill (pid_t *children, int num_children, pid_t pid,
+                         int signum)
+{
+    if (spawn_helper_child_search (children, num_children, pid) < 0)
+        return ESRCH;
+
+    return (kill (pid, signum) < 0) ? errno : 0;
+}
+
+/*
+ * Main loop of spawn helper: reads requests from WeeChat, forks children and
+ * sends back their pid and their exit status.
+ *
+ * This function never returns.
+ */
+
+void
+spawn_helper_run (int sock)
+{
+    struct t_spawn_message message, reply;
+    struct pollfd poll_fd;
+    char *payload;
+    int fds[3], num_fds, num_children, status, ready, index, i;
+    pid_t pid, *children, *new_children;
+
+    spawn_reset_signals ();
+
+    /* the helper ends when WeeChat closes the socket */
+    signal (SIGHUP, SIG_IGN);
+    signal (SIGINT, SIG_IGN);
+    signal (SIGQUIT, SIG_IGN);
+    signal (SIGPIPE, SIG_IGN);
+
+    children = NULL;
+    num_children = 0;
+
+    while (1)
+    {
+        /*
+         * the socket is checked often when some children are running, to
+         * send quickly their exit status
+         */
+        poll_fd.fd = sock;
+        poll_fd.events = POLLIN;
+        poll_fd.revents = 0;
+        ready = poll (&poll_fd, 1, (num_children > 0) ? 10 : -1);
+        if ((ready < 0) && (errno != EINTR))
+            break;
+
+        if ((ready > 0) && poll_fd.revents)
+        {
+            if (!spawn_recv (sock, &message, &payload, fds, &num_fds))
+                break;
+            if (((message.type == SPAWN_MSG_EXEC)
+                 || (message.type == SPAWN_MSG_URL))
+                && payload)
+            {
+                memset (&reply, 0, sizeof (reply));
+                new_children = realloc (
+                    children, (num_children + 1) * sizeof (children[0]));
+                if (new_children)
+                {
+                    children = new_children;
+                    pid = fork ();
+                }
+                else
+                {
+                    pid = -1;
+                    errno = ENOMEM;
+                }
+                switch (pid)
+                {
+                    case -1:
+                        reply.type = SPAWN_MSG_ERROR;
+                        reply.status = errno;
+                        break;
+                    case 0:
+                        close (sock);
+                        spawn_child_run (&message, payload, fds, num_fds);
+                        /* never executed */
+                        _exit (EXIT_FAILURE);
+                        break;
+                    default:
+                        reply.type = SPAWN_MSG_STARTED;
+                        reply.pid = pid;
+                        children[num_children++] = pid;
+                        break;
+                }
+                if (!spawn_send (sock, &reply, NULL, NULL, 0))
+                    break;
+            }
+            else if (message.type == SPAWN_MSG_KILL)
+            {
+                memset (&reply, 0, sizeof (reply));
+                reply.type = SPAWN_MSG_KILLED;
+                reply.pid = message.pid;
+                reply.status = spawn_helper_child_kill (children, num_children,
+                                                        message.pid,
+                                                        message.status);
+                if (!spawn_send (sock, &reply, NULL, NULL, 0))
+                    break;
+            }
+            for (i = 0; i < num_fds; i++)
+            {
+                close (fds[i]);
+            }
+            if (payload)
+                free (payload);
+        }
+
+        /* send exit status of children which have ended */
+        while ((pid = waitpid (-1, &status, WNOHANG)) > 0)
+        {
+            index = spawn_helper_child_search (children, num_children, pid);
+            if (index >= 0)
+            {
+                children[index] = children[num_children - 1];
+                num_children--;
+            }
+            memset (&reply, 0, sizeof (reply));
+            reply.type = SPAWN_MSG_EXITED;
+            reply.pid = pid;
+            reply.status = status;
+            if (!spawn_send (sock, &reply, NULL, NULL, 0))
+                _exit (EXIT_SUCCESS);
+        }
+    }
+
+    _exit (EXIT_SUCCESS);
+}
+
+/*
+ * Starts the spawn helper process.
+ *
+ * If the helper can not be started, fork() is used (in hook_process) for each
+ * child process.
+ */
+
+void
+spawn_init ()
+{
+    int sock[2];
+    pid_t pid;
+
+    if (socketpair (AF_LOCAL, SOCK_STREAM, 0, sock) < 0)
+        return;
+
+    switch (pid = fork ())
+    {
+        case -1:
+            close (sock[0]);
+            close (sock[1]);
+            return;
+        case 0:
+            close (sock[0]);
+            spawn_helper_run (sock[1]);
+            /* never executed */
+            _exit (EXIT_SUCCESS);
+            break;
+    }
+
+    close (sock[1]);
+
+    /* the new process started by /upgrade must not use this socket */
+    fcntl (sock[0], F_SETFD, FD_CLOEXEC);
+
+    spawn_helper_pid = pid;
+    spawn_helper_socket = sock[0];
+}
+
+/*
+ * Stops the spawn helper (after an error, or when WeeChat exits).
+ */
+
+void
+spawn_end ()
+{
+    if (spawn_helper_socket >= 0)
+    {
+        close (spawn_helper_socket);
+        spawn_helper_socket = -1;
+    }
+    if (spawn_helper_pid > 0)
+    {
+        waitpid (spawn_helper_pid, NULL, 0);
+        spawn_helper_pid = -1;
+    }
+}
+
+/*
+ * Checks if the spawn helper is available.
+ *
+ * Returns:
+ *   1: spawn helper is running
+ *   0: spawn helper is not running (fork() must be used)
+ */
+
+int
+spawn_available ()
+{
+    return (spawn_helper_socket >= 0) ? 1 : 0;
+}
+
+/*
+ * Handles a message received from spawn helper.
+ */
+
+void
+spawn_handle_message (struct t_spawn_message *message)
+{
+    if (message->type == SPAWN_MSG_EXITED)
+        hook_process_child_exited (message->pid, message->status);
+}
+
+/*
+ * Reads all messages received from spawn helper, without blocking.
+ */
+
+void
+spawn_read_messages ()
+{
+    struct t_spawn_message message;
+    struct pollfd poll_fd;
+    char *payload;
+    int fds[3], num_fds;
+
+    while (spawn_helper_socket >= 0)
+    {
+        poll_fd.fd = spawn_helper_socket;
+        poll_fd.events = POLLIN;
+        poll_fd.revents = 0;
+        if (poll (&poll_fd, 1, 0) <= 0)
+            break;
+        if (!spawn_recv (spawn_helper_socket, &message, &payload,
+                         fds, &num_fds))
+        {
+            spawn_end ();
+            break;
+        }
+        spawn_handle_message (&message);
+        if (payload)
+            free (payload);
+    }
+}
+
+/*
+ * Waits for the reply to a request sent to spawn helper (exit status of
+ * children received before the reply are handled).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (spawn helper is stopped)
+ */
+
+int
+spawn_wait_reply (struct t_spawn_message *message)
+{
+    char *payload;
+    int fds[3], num_fds;
+
+    while (1)
+    {
+        if (!spawn_recv (spawn_helper_socket, message, &payload,
+                         fds, &num_fds))
+        {
+            spawn_end ();
+            return 0;
+        }
+        if (payload)
+            free (payload);
+        if (message->type != SPAWN_MSG_EXITED)
+            return 1;
+        spawn_handle_message (message);
+    }
+
+    /* never executed */
+    return 0;
+}
+
+/*
+ * Sends a request to spawn helper and waits for the pid of child.
+ *
+ * Returns pid of child, -1 if error.
+ */
+
+pid_t
+spawn_request (int type, const char *payload, int length,
+               int fd_stdin, int fd_stdout, int fd_stderr)
+{
+    struct t_spawn_message message;
+    int fds[3], num_fds;
+
+    if (spawn_helper_socket < 0)
+        return -1;
+
+    memset (&message, 0, sizeof (message));
+    message.type = type;
+    message.length = length;
+    num_fds = 0;
+    if (fd_stdin >= 0)
+    {
+        message.flags |= SPAWN_FD_STDIN;
+        fds[num_fds++] = fd_stdin;
+    }
+    if (fd_stdout >= 0)
+    {
+        message.flags |= SPAWN_FD_STDOUT;
+        fds[num_fds++] = fd_stdout;
+    }
+    if (fd_stderr >= 0)
+    {
+        message.flags |= SPAWN_FD_STDERR;
+        fds[num_fds++] = fd_stderr;
+    }
+
+    if (!spawn_send (spawn_helper_socket, &message, payload, fds, num_fds))
+    {
+        spawn_end ();
+        return -1;
+    }
+    if (!spawn_wait_reply (&message))
+        return -1;
+
+    if (message.type == SPAWN_MSG_STARTED)
+        return message.pid;
+
+    errno = (message.type == SPAWN_MSG_ERROR) ? message.status : EPROTO;
+    return -1;
+}
+
+/*
+ * Sends a signal to a child started by spawn helper.
+ *
+ * The signal is sent by the helper only if the child is still running (if it
+ * has been reaped, its pid may be used by another process).
+ *
+ * Returns:
+ *   0: OK
+ *  -1: error (errno is set, ESRCH if the child has already ended)
+ */
+
+int
+spawn_kill (pid_t pid, int signum)
+{
+    struct t_spawn_message message;
+
+    if (spawn_helper_socket < 0)
+    {
+        errno = ESRCH;
+        return -1;
+    }
+
+    memset (&message, 0, sizeof (message));
+    message.type = SPAWN_MSG_KILL;
+    message.pid = pid;
+    message.status = signum;
+
+    if (!spawn_send (spawn_helper_socket, &message, NULL, NULL, 0))
+    {
+        spawn_end ();
+        errno = ESRCH;
+        return -1;
+    }
+    if (!spawn_wait_reply (&message))
+    {
+        errno = ESRCH;
+        return -1;
+    }
+
+    if (message.type != SPAWN_MSG_KILLED)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+    if (message.status != 0)
+    {
+        errno = message.status;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Adds a string (with its final '\0') in a payload.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory or payload too long)
+ */
+
+int
+spawn_payload_add (char **payload, int *length, const char *string)
+{
+    char *new_payload;
+    int length_string;
+
+    length_string = strlen (string) + 1;
+    if (*length + length_string > SPAWN_MAX_PAYLOAD)
+        return 0;
+
+    new_payload = realloc (*payload, *length + length_string);
+    if (!new_payload)
+        return 0;
+    memcpy (new_payload + *length, string, length_string);
+    *payload = new_payload;
+    *length += length_string;
+
+    return 1;
+}
+
+/*
+ * Runs a command (with execvp) in a child of spawn helper.
+ *
+ * Argument "command" is used only in error message if execvp fails.
+ * File descriptors can be -1 (then "/dev/null" is used in child).
+ *
+ * Returns pid of child, -1 if error.
+ */
+
+pid_t
+spawn_exec (const char *command, char **argv,
+            int fd_stdin, int fd_stdout, int fd_stderr)
+{
+    char *payload;
+    int i, length;
+    pid_t pid;
+
+    if (!command || !argv || !argv[0] || (spawn_helper_socket < 0))
+        return -1;
+
+    payload = NULL;
+    length = 0;
+    if (!spawn_payload_add (&payload, &length, command))
+        goto error;
+    for (i = 0; argv[i]; i++)
+    {
+        if (!spawn_payload_add (&payload, &length, argv[i]))
+            goto error;
+    }
+
+    pid = spawn_request (SPAWN_MSG_EXEC, payload, length,
+                         fd_stdin, fd_stdout, fd_stderr);
+
+    free (payload);
+
+    return pid;
+
+error:
+    if (payload)
+        free (payload);
+    return -1;
+}
+
+/*
+ * Callback used to add options in payload of an URL request.
+ */
+
+void
+spawn_url_options_map_cb (void *data, struct t_hashtable *hashtable,
+                          const void *key, const void *value)
+{
+    void **map_data;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    map_data = (void **)data;
+    if (!map_data[2])
+        return;
+
+    if (!spawn_payload_add ((char **)map_data[0], (int *)map_data[1],
+                            (const char *)key)
+        || !spawn_payload_add ((char **)map_data[0], (int *)map_data[1],
+                               (value) ? (const char *)value : ""))
+    {
+        map_data[2] = NULL;
+    }
+}
+
+/*
+ * Downloads an URL in a child of spawn helper.
+ *
+ * Argument "options" is a hashtable with string keys/values (can be NULL).
+ *
+ * Returns pid of child, -1 if error.
+ */
+
+pid_t
+spawn_url (const char *url, struct t_hashtable *options,
+           int fd_stdin, int fd_stdout, int fd_stderr)
+{
+    char *payload;
+    void *map_data[3];
+    int length;
+    pid_t pid;
+
+    if (!url || (spawn_helper_socket < 0))
+        return -1;
+
+    payload = NULL;
+    length = 0;
+    if (!spawn_payload_add (&payload, &length, url))
+        goto error;
+
+    if (options)
+    {
+        map_data[0] = &payload;
+        map_data[1] = &length;
+        map_data[2] = &length;
+        hashtable_map (options, &spawn_url_options_map_cb, map_data);
+        if (!map_data[2])
+            goto error;
+    }
+
+    pid = spawn_request (SPAWN_MSG_URL, payload, length,
+                         fd_stdin, fd_stdout, fd_stderr);
+
+    free (payload);
+
+    return pid;
+
+error:
+    if (payload)
+        free (payload);
+    return -1;
+}
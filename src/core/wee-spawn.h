@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_SPAWN_H
+#define WEECHAT_SPAWN_H 1
+
+#include <sys/types.h>
+
+struct t_hashtable;
+
+/* messages exchanged with the spawn helper */
+
+#define SPAWN_MSG_EXEC    1            /* run a command (execvp)            */
+#define SPAWN_MSG_URL     2            /* download an URL                   */
+#define SPAWN_MSG_STARTED 3            /* child started (with pid)          */
+#define SPAWN_MSG_EXITED  4            /* child ended (with status)         */
+#define SPAWN_MSG_ERROR   5            /* error (errno in status)           */
+#define SPAWN_MSG_KILL    6            /* send a signal (in status) to child*/
+#define SPAWN_MSG_KILLED  7            /* signal sent (errno in status)     */
+
+/* flags for file descriptors sent with a request */
+
+#define SPAWN_FD_STDIN    (1 << 0)
+#define SPAWN_FD_STDOUT   (1 << 1)
+#define SPAWN_FD_STDERR   (1 << 2)
+
+#define SPAWN_MAX_PAYLOAD (1024 * 1024)
+
+struct t_spawn_message
+{
+    int type;                          /* SPAWN_MSG_XXX                     */
+    int flags;                         /* file descriptors sent (requests)  */
+    pid_t pid;                         /* pid of child                      */
+    int status;                        /* exit status, signal or errno      */
+    int length;                        /* length of payload after message   */
+};
+
+extern pid_t spawn_helper_pid;
+
+extern void spawn_init ();
+extern int spawn_available ();
+extern pid_t spawn_exec (const char *command, char **argv,
+                         int fd_stdin, int fd_stdout, int fd_stderr);
+extern pid_t spawn_url (const char *url, struct t_hashtable *options,
+                        int fd_stdin, int fd_stdout, int fd_stderr);
+extern int spawn_kill (pid_t pid, int signum);
+extern void spawn_read_messages ();
+extern void spawn_end ();
+
+#endif /* WEECHAT_SPAWN_H */
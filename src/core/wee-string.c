@@ -37,6 +37,12 @@
 #include <iconv.h>
 #endif
 
+#ifdef HAVE_PCRE2
+#include <pthread.h>
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#endif
+
 #ifndef ICONV_CONST
   #ifdef ICONV_2ARG_IS_CONST
     #define ICONV_CONST const
@@ -64,6 +70,22 @@ typedef uint32_t string_shared_count_t;
 
 struct t_hashtable *string_hashtable_shared = NULL;
 
+#ifdef HAVE_ICONV
+/* iconv descriptors opened by string_iconv (key: "to_code\nfrom_code") */
+struct t_hashtable *string_hashtable_iconv = NULL;
+#endif /* HAVE_ICONV */
+
+#ifdef HAVE_PCRE2
+/* PCRE2 regex compiled with string_regcomp (key: pointer to regex_t) */
+struct t_hashtable *string_hashtable_regex_pcre2 = NULL;
+/* lock on hashtable (string_regexec is called by threads) */
+pthread_rwlock_t string_hashtable_regex_pcre2_lock = PTHREAD_RWLOCK_INITIALIZER;
+/* match data used by string_regexec (one per thread) */
+pthread_key_t string_regex_match_data_key;
+pthread_once_t string_regex_match_data_once = PTHREAD_ONCE_INIT;
+int string_regex_match_data_key_ok = 0;
+#endif /* HAVE_PCRE2 */
+
 
 /*
  * Defines a "strndup" function for systems where this function does not exist
@@ -1046,17 +1068,709 @@ string_regex_flags (const char *regex, int default_flags, int *flags)
  *   other value: compilation failed
  */
 
-int
-string_regcomp (void *preg, const char *regex, int default_flags)
+#ifdef HAVE_PCRE2
+/*
+ * Frees a PCRE2 regex (callback called when an entry is removed from
+ * hashtable "string_hashtable_regex_pcre2").
+ */
+
+void
+string_regex_pcre2_free_value_cb (struct t_hashtable *hashtable,
+                                  const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    pcre2_code_free ((pcre2_code *)value);
+}
+
+/*
+ * Compiles a regex with PCRE2 (and JIT if available), in addition to the POSIX
+ * regex compiled in "preg".
+ *
+ * The PCRE2 regex is used by function string_regexec; if the regex can not be
+ * compiled with PCRE2 (not an extended regex or syntax not supported), the
+ * POSIX regex is used.
+ */
+
+void
+string_regcomp_pcre2 (void *preg, const char *regex, int flags)
+{
+    pcre2_code *code;
+    uint32_t options;
+    PCRE2_SIZE error_offset;
+    int error_code;
+
+    pthread_rwlock_wrlock (&string_hashtable_regex_pcre2_lock);
+    if (!string_hashtable_regex_pcre2)
+    {
+        string_hashtable_regex_pcre2 = hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!string_hashtable_regex_pcre2)
+        {
+            pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+            return;
+        }
+        string_hashtable_regex_pcre2->callback_free_value =
+            &string_regex_pcre2_free_value_cb;
+    }
+
+    /* remove any PCRE2 regex previously compiled with same pointer */
+    hashtable_remove (string_hashtable_regex_pcre2, preg);
+    pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+
+    /* basic regular expressions have a different syntax */
+    if (!(flags & REG_EXTENDED))
+        return;
+
+    options = PCRE2_UTF | PCRE2_UCP;
+#ifdef PCRE2_MATCH_INVALID_UTF
+    options |= PCRE2_MATCH_INVALID_UTF;
+#endif /* PCRE2_MATCH_INVALID_UTF */
+    if (flags & REG_ICASE)
+        options |= PCRE2_CASELESS;
+    if (flags & REG_NEWLINE)
+        options |= PCRE2_MULTILINE;
+    else
+        options |= PCRE2_DOTALL | PCRE2_DOLLAR_ENDONLY;
+
+    code = pcre2_compile ((PCRE2_SPTR)regex, PCRE2_ZERO_TERMINATED, options,
+                          &error_code, &error_offset, NULL);
+    if (!code)
+        return;
+
+    /* JIT compilation is optional: interpreter is used if it fails */
+    pcre2_jit_compile (code, PCRE2_JIT_COMPLETE);
+
+    pthread_rwlock_wrlock (&string_hashtable_regex_pcre2_lock);
+    if (!hashtable_set (string_hashtable_regex_pcre2, preg, code))
+        pcre2_code_free (code);
+    pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+}
+
+/*
+ * Frees match data of a thread (called when a thread ends).
+ */
+
+void
+string_regex_match_data_free_cb (void *match_data)
+{
+    pcre2_match_data_free ((pcre2_match_data *)match_data);
+}
+
+/*
+ * Creates the key used to store match data of each thread.
+ */
+
+void
+string_regex_match_data_key_init ()
+{
+    string_regex_match_data_key_ok =
+        (pthread_key_create (&string_regex_match_data_key,
+                             &string_regex_match_data_free_cb) == 0) ? 1 : 0;
+}
+
+/*
+ * Gets match data of current thread (created on first call in thread): a
+ * PCRE2 regex can be used by many threads at same time, but each thread
+ * needs its own match data.
+ *
+ * Returns pointer to match data, NULL if error.
+ */
+
+pcre2_match_data *
+string_regex_get_match_data ()
+{
+    pcre2_match_data *match_data;
+
+    pthread_once (&string_regex_match_data_once,
+                  &string_regex_match_data_key_init);
+    if (!string_regex_match_data_key_ok)
+        return NULL;
+
+    match_data = pthread_getspecific (string_regex_match_data_key);
+    if (!match_data)
+    {
+        match_data = pcre2_match_data_create (100, NULL);
+        if (!match_data)
+            return NULL;
+        if (pthread_setspecific (string_regex_match_data_key,
+                                 match_data) != 0)
+        {
+            pcre2_match_data_free (match_data);
+            return NULL;
+        }
+    }
+
+    return match_data;
+}
+
+/*
+ * Executes a PCRE2 regex, with same arguments and return code as function
+ * regexec.
+ *
+ * Returns:
+ *   0: regex matches
+ *   REG_NOMATCH: regex does not match
+ *   -1: error (the POSIX regex must be used)
+ */
+
+int
+string_regexec_pcre2 (pcre2_code *code, const char *string,
+                      int nmatch, regmatch_t *pmatch, int eflags)
+{
+    pcre2_match_data *match_data;
+    PCRE2_SIZE *ovector;
+    uint32_t options;
+    int i, rc, count;
+
+    match_data = string_regex_get_match_data ();
+    if (!match_data)
+        return -1;
+
+    options = 0;
+    if (eflags & REG_NOTBOL)
+        options |= PCRE2_NOTBOL;
+    if (eflags & REG_NOTEOL)
+        options |= PCRE2_NOTEOL;
+
+    rc = pcre2_match (code, (PCRE2_SPTR)string, PCRE2_ZERO_TERMINATED, 0,
+                      options, match_data, NULL);
+    if (rc == PCRE2_ERROR_NOMATCH)
+        return REG_NOMATCH;
+    if (rc < 0)
+        return -1;
+
+    if (pmatch && (nmatch > 0))
+    {
+        ovector = pcre2_get_ovector_pointer (match_data);
+        /* rc == 0: ovector too small, all its pairs are set */
+        count = (rc == 0) ?
+            (int)pcre2_get_ovector_count (match_data) : rc;
+        for (i = 0; i < nmatch; i++)
+        {
+            if ((i < count) && (ovector[i * 2] != PCRE2_UNSET))
+            {
+                pmatch[i].rm_so = (regoff_t)ovector[i * 2];
+                pmatch[i].rm_eo = (regoff_t)ovector[(i * 2) + 1];
+            }
+            else
+            {
+                pmatch[i].rm_so = -1;
+                pmatch[i].rm_eo = -1;
+            }
+        }
+    }
+
+    return 0;
+}
+#endif /* HAVE_PCRE2 */
+
+/*
+ * Compiles a regex using optional flags at beginning of string (for format of
+ * flags in regex, see string_regex_flags()).
+ *
+ * If WeeChat is built with PCRE2, the regex is compiled with PCRE2 as well
+ * (and JIT if available), so the regex must then be used with function
+ * string_regexec and freed with function string_regfree.
+ *
+ * Returns:
+ *   0: successful compilation
+ *   other value: compilation failed
+ */
+
+int
+string_regcomp (void *preg, const char *regex, int default_flags)
+{
+    const char *ptr_regex;
+    int flags, rc;
+
+    if (!regex)
+        return -1;
+
+    ptr_regex = string_regex_flags (regex, default_flags, &flags);
+    rc = regcomp ((regex_t *)preg, ptr_regex, flags);
+
+#ifdef HAVE_PCRE2
+    if (rc == 0)
+        string_regcomp_pcre2 (preg, ptr_regex, flags);
+    else
+    {
+        pthread_rwlock_wrlock (&string_hashtable_regex_pcre2_lock);
+        if (string_hashtable_regex_pcre2)
+            hashtable_remove (string_hashtable_regex_pcre2, preg);
+        pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+    }
+#endif /* HAVE_PCRE2 */
+
+    return rc;
+}
+
+/*
+ * Executes a regex compiled with string_regcomp (same arguments and return
+ * code as function regexec).
+ *
+ * The PCRE2 regex is used if WeeChat is built with PCRE2 and if the regex
+ * could be compiled with PCRE2, otherwise the POSIX regex is used.
+ *
+ * This function can be called by threads (while other regex are compiled or
+ * freed in main thread).
+ *
+ * Returns:
+ *   0: regex matches
+ *   REG_NOMATCH: regex does not match
+ */
+
+int
+string_regexec (void *preg, const char *string, int nmatch, void *pmatch,
+                int eflags)
+{
+#ifdef HAVE_PCRE2
+    pcre2_code *code;
+    int rc;
+#endif /* HAVE_PCRE2 */
+
+    if (!preg || !string)
+        return REG_NOMATCH;
+
+#ifdef HAVE_PCRE2
+    /*
+     * the PCRE2 regex itself can not be freed while it is used: it is freed
+     * only by string_regcomp/string_regfree on the same pointer "preg"
+     */
+    pthread_rwlock_rdlock (&string_hashtable_regex_pcre2_lock);
+    code = (string_hashtable_regex_pcre2) ?
+        (pcre2_code *)hashtable_get (string_hashtable_regex_pcre2, preg) :
+        NULL;
+    pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+    if (code)
+    {
+        rc = string_regexec_pcre2 (code, string, nmatch,
+                                   (regmatch_t *)pmatch, eflags);
+        if (rc >= 0)
+            return rc;
+    }
+#endif /* HAVE_PCRE2 */
+
+    return regexec ((regex_t *)preg, string, nmatch, (regmatch_t *)pmatch,
+                    eflags);
+}
+
+/*
+ * Frees a regex compiled with string_regcomp.
+ *
+ * Note: the pointer "preg" itself is not freed.
+ */
+
+void
+string_regfree (void *preg)
+{
+    if (!preg)
+        return;
+
+    regfree ((regex_t *)preg);
+
+#ifdef HAVE_PCRE2
+    pthread_rwlock_wrlock (&string_hashtable_regex_pcre2_lock);
+    if (string_hashtable_regex_pcre2)
+        hashtable_remove (string_hashtable_regex_pcre2, preg);
+    pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+#endif /* HAVE_PCRE2 */
+}
+
+/*
+ * Returns ASCII lower case of a char (for highlight automaton).
+ */
+
+unsigned char
+string_highlight_lower (unsigned char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+}
+
+/*
+ * Returns child of a node in highlight automaton for a char, 0 if not found.
+ */
+
+int
+string_highlight_child (struct t_string_highlight *highlight, int node,
+                        unsigned char c)
+{
+    int child;
+
+    if (node == 0)
+        return highlight->root_children[c];
+
+    for (child = highlight->nodes[node].first_child; child;
+         child = highlight->nodes[child].next_sibling)
+    {
+        if (highlight->nodes[child].c == c)
+            return child;
+    }
+
+    return 0;
+}
+
+/*
+ * Adds a node in highlight automaton (child of "parent" for char "c").
+ *
+ * Returns index of new node, 0 if error.
+ */
+
+int
+string_highlight_add_node (struct t_string_highlight *highlight, int parent,
+                           unsigned char c)
+{
+    struct t_string_highlight_node *new_nodes;
+    int new_size, node;
+
+    if (highlight->nodes_count >= highlight->nodes_size)
+    {
+        new_size = highlight->nodes_size * 2;
+        new_nodes = realloc (highlight->nodes,
+                             new_size * sizeof (*new_nodes));
+        if (!new_nodes)
+            return 0;
+        highlight->nodes = new_nodes;
+        highlight->nodes_size = new_size;
+    }
+
+    node = highlight->nodes_count++;
+    highlight->nodes[node].c = c;
+    highlight->nodes[node].first_child = 0;
+    highlight->nodes[node].next_sibling = highlight->nodes[parent].first_child;
+    highlight->nodes[node].fail = 0;
+    highlight->nodes[node].dict = 0;
+    highlight->nodes[node].first_word = -1;
+    highlight->nodes[parent].first_child = node;
+    if (parent == 0)
+        highlight->root_children[c] = node;
+
+    return node;
+}
+
+/*
+ * Adds a word in highlight automaton.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+string_highlight_add_word (struct t_string_highlight *highlight,
+                           const char *word, int length, int case_sensitive,
+                           int wildcard_start, int wildcard_end)
+{
+    struct t_string_highlight_word *new_words, *ptr_word;
+    int i, node, child;
+
+    new_words = realloc (highlight->words,
+                         (highlight->words_count + 1) * sizeof (*new_words));
+    if (!new_words)
+        return 0;
+    highlight->words = new_words;
+
+    node = 0;
+    for (i = 0; i < length; i++)
+    {
+        child = string_highlight_child (
+            highlight, node, string_highlight_lower ((unsigned char)word[i]));
+        if (!child)
+        {
+            child = string_highlight_add_node (
+                highlight, node,
+                string_highlight_lower ((unsigned char)word[i]));
+            if (!child)
+                return 0;
+        }
+        node = child;
+    }
+
+    ptr_word = &highlight->words[highlight->words_count];
+    ptr_word->word = string_strndup (word, length);
+    if (!ptr_word->word)
+        return 0;
+    ptr_word->length = length;
+    ptr_word->case_sensitive = case_sensitive;
+    ptr_word->wildcard_start = wildcard_start;
+    ptr_word->wildcard_end = wildcard_end;
+    ptr_word->next_word = highlight->nodes[node].first_word;
+    highlight->nodes[node].first_word = highlight->words_count;
+    highlight->words_count++;
+
+    return 1;
+}
+
+/*
+ * Computes links "fail" and "dict" of nodes in highlight automaton (breadth
+ * first traversal of nodes).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+string_highlight_build_links (struct t_string_highlight *highlight)
+{
+    int *queue, queue_start, queue_end, node, child, fail;
+
+    queue = malloc (highlight->nodes_count * sizeof (*queue));
+    if (!queue)
+        return 0;
+
+    queue_start = 0;
+    queue_end = 0;
+    for (child = highlight->nodes[0].first_child; child;
+         child = highlight->nodes[child].next_sibling)
+    {
+        queue[queue_end++] = child;
+    }
+
+    while (queue_start < queue_end)
+    {
+        node = queue[queue_start++];
+        for (child = highlight->nodes[node].first_child; child;
+             child = highlight->nodes[child].next_sibling)
+        {
+            fail = highlight->nodes[node].fail;
+            while (fail
+                   && !string_highlight_child (highlight, fail,
+                                               highlight->nodes[child].c))
+            {
+                fail = highlight->nodes[fail].fail;
+            }
+            fail = string_highlight_child (highlight, fail,
+                                           highlight->nodes[child].c);
+            highlight->nodes[child].fail = fail;
+            highlight->nodes[child].dict =
+                (highlight->nodes[fail].first_word >= 0) ?
+                fail : highlight->nodes[fail].dict;
+            queue[queue_end++] = child;
+        }
+    }
+
+    free (queue);
+
+    return 1;
+}
+
+/*
+ * Compiles a list of highlight words (comma separated, same format as
+ * function string_has_highlight), to search all words in a string with
+ * function string_highlight_match.
+ *
+ * Note: result must be freed after use with function string_highlight_free.
+ */
+
+struct t_string_highlight *
+string_highlight_compile (const char *highlight_words)
+{
+    struct t_string_highlight *new_highlight;
+    const char *pos, *pos_end;
+    int i, length, flags, wildcard_start, wildcard_end;
+
+    if (!highlight_words)
+        return NULL;
+
+    new_highlight = malloc (sizeof (*new_highlight));
+    if (!new_highlight)
+        return NULL;
+
+    new_highlight->highlight_words = strdup (highlight_words);
+    new_highlight->words = NULL;
+    new_highlight->words_count = 0;
+    new_highlight->nodes_size = 64;
+    new_highlight->nodes = malloc (new_highlight->nodes_size *
+                                   sizeof (*new_highlight->nodes));
+    new_highlight->nodes_count = 1;
+    for (i = 0; i < 256; i++)
+    {
+        new_highlight->root_children[i] = 0;
+    }
+    if (!new_highlight->highlight_words || !new_highlight->nodes)
+    {
+        string_highlight_free (new_highlight);
+        return NULL;
+    }
+    new_highlight->nodes[0].c = 0;
+    new_highlight->nodes[0].first_child = 0;
+    new_highlight->nodes[0].next_sibling = 0;
+    new_highlight->nodes[0].fail = 0;
+    new_highlight->nodes[0].dict = 0;
+    new_highlight->nodes[0].first_word = -1;
+
+    pos = highlight_words;
+    while (pos)
+    {
+        flags = 0;
+        pos = string_regex_flags (pos, REG_ICASE, &flags);
+
+        pos_end = strchr (pos, ',');
+        length = (pos_end) ? pos_end - pos : (int)strlen (pos);
+
+        wildcard_start = 0;
+        wildcard_end = 0;
+        if (length > 0)
+        {
+            if ((wildcard_start = (pos[0] == '*')))
+            {
+                pos++;
+                length--;
+            }
+            if ((length > 0) && (wildcard_end = (pos[length - 1] == '*')))
+                length--;
+        }
+
+        if (length > 0)
+        {
+            if (!string_highlight_add_word (new_highlight, pos, length,
+                                            (flags & REG_ICASE) ? 0 : 1,
+                                            wildcard_start, wildcard_end))
+            {
+                string_highlight_free (new_highlight);
+                return NULL;
+            }
+        }
+
+        pos = (pos_end) ? pos_end + 1 : NULL;
+    }
+
+    if (!string_highlight_build_links (new_highlight))
+    {
+        string_highlight_free (new_highlight);
+        return NULL;
+    }
+
+    return new_highlight;
+}
+
+/*
+ * Checks if a word found in a string at position "match" is a highlight
+ * (according to wildcards and word chars around).
+ *
+ * Returns:
+ *   1: word is a highlight
+ *   0: word is not a highlight
+ */
+
+int
+string_highlight_match_word (struct t_string_highlight_word *word,
+                             const char *string, const char *match)
+{
+    const char *match_pre, *match_post;
+    int startswith, endswith;
+
+    if (word->case_sensitive
+        && (strncmp (match, word->word, word->length) != 0))
+    {
+        return 0;
+    }
+
+    if (word->wildcard_start && word->wildcard_end)
+        return 1;
+
+    match_pre = utf8_prev_char (string, match);
+    if (!match_pre)
+        match_pre = match - 1;
+    match_post = match + word->length;
+    startswith = ((match == string)
+                  || (!string_is_word_char_highlight (match_pre)));
+    endswith = ((!match_post[0])
+                || (!string_is_word_char_highlight (match_post)));
+
+    return ((!word->wildcard_start && !word->wildcard_end
+             && startswith && endswith)
+            || (word->wildcard_start && endswith)
+            || (word->wildcard_end && startswith)) ? 1 : 0;
+}
+
+/*
+ * Checks if a string has a highlight, using compiled highlight words (see
+ * function string_highlight_compile): all words are searched in a single
+ * pass on string.
+ *
+ * Returns:
+ *   1: string has a highlight
+ *   0: string has no highlight
+ */
+
+int
+string_highlight_match (struct t_string_highlight *highlight,
+                        const char *string)
+{
+    const char *ptr_string;
+    int node, child, word_node, word;
+    unsigned char c;
+
+    if (!highlight || (highlight->words_count == 0) || !string)
+        return 0;
+
+    node = 0;
+    for (ptr_string = string; ptr_string[0]; ptr_string++)
+    {
+        c = string_highlight_lower ((unsigned char)ptr_string[0]);
+        while (node && !string_highlight_child (highlight, node, c))
+        {
+            node = highlight->nodes[node].fail;
+        }
+        child = string_highlight_child (highlight, node, c);
+        node = child;
+        if (!node)
+            continue;
+
+        /* check all words ending here */
+        word_node = (highlight->nodes[node].first_word >= 0) ?
+            node : highlight->nodes[node].dict;
+        while (word_node)
+        {
+            for (word = highlight->nodes[word_node].first_word; word >= 0;
+                 word = highlight->words[word].next_word)
+            {
+                if (string_highlight_match_word (
+                        &highlight->words[word], string,
+                        ptr_string + 1 - highlight->words[word].length))
+                {
+                    return 1;
+                }
+            }
+            word_node = highlight->nodes[word_node].dict;
+        }
+    }
+
+    /* no highlight found */
+    return 0;
+}
+
+/*
+ * Frees compiled highlight words.
+ */
+
+void
+string_highlight_free (struct t_string_highlight *highlight)
 {
-    const char *ptr_regex;
-    int flags;
+    int i;
 
-    if (!regex)
-        return -1;
+    if (!highlight)
+        return;
 
-    ptr_regex = string_regex_flags (regex, default_flags, &flags);
-    return regcomp ((regex_t *)preg, ptr_regex, flags);
+    if (highlight->highlight_words)
+        free (highlight->highlight_words);
+    for (i = 0; i < highlight->words_count; i++)
+    {
+        free (highlight->words[i].word);
+    }
+    if (highlight->words)
+        free (highlight->words);
+    if (highlight->nodes)
+        free (highlight->nodes);
+
+    free (highlight);
 }
 
 /*
@@ -1070,100 +1784,21 @@ string_regcomp (void *preg, const char *regex, int default_flags)
 int
 string_has_highlight (const char *string, const char *highlight_words)
 {
-    const char *match, *match_pre, *match_post, *msg_pos;
-    char *msg, *highlight, *pos, *pos_end;
-    int end, length, startswith, endswith, wildcard_start, wildcard_end, flags;
+    struct t_string_highlight *highlight;
+    int rc;
 
     if (!string || !string[0] || !highlight_words || !highlight_words[0])
         return 0;
 
-    msg = strdup (string);
-    if (!msg)
-        return 0;
-
-    highlight = strdup (highlight_words);
+    highlight = string_highlight_compile (highlight_words);
     if (!highlight)
-    {
-        free (msg);
         return 0;
-    }
-
-    pos = highlight;
-    end = 0;
-    while (!end)
-    {
-        flags = 0;
-        pos = (char *)string_regex_flags (pos, REG_ICASE, &flags);
-
-        pos_end = strchr (pos, ',');
-        if (!pos_end)
-        {
-            pos_end = strchr (pos, '\0');
-            end = 1;
-        }
-        /* error parsing string! */
-        if (!pos_end)
-        {
-            free (msg);
-            free (highlight);
-            return 0;
-        }
 
-        length = pos_end - pos;
-        pos_end[0] = '\0';
-        if (length > 0)
-        {
-            if ((wildcard_start = (pos[0] == '*')))
-            {
-                pos++;
-                length--;
-            }
-            if ((wildcard_end = (*(pos_end - 1) == '*')))
-            {
-                *(pos_end - 1) = '\0';
-                length--;
-            }
-        }
-
-        if (length > 0)
-        {
-            msg_pos = msg;
-            while (1)
-            {
-                match = (flags & REG_ICASE) ?
-                    string_strcasestr (msg_pos, pos) : strstr (msg_pos, pos);
-                if (!match)
-                    break;
-                match_pre = utf8_prev_char (msg, match);
-                if (!match_pre)
-                    match_pre = match - 1;
-                match_post = match + length;
-                startswith = ((match == msg) || (!string_is_word_char_highlight (match_pre)));
-                endswith = ((!match_post[0]) || (!string_is_word_char_highlight (match_post)));
-                if ((wildcard_start && wildcard_end) ||
-                    (!wildcard_start && !wildcard_end &&
-                     startswith && endswith) ||
-                    (wildcard_start && endswith) ||
-                    (wildcard_end && startswith))
-                {
-                    /* highlight found! */
-                    free (msg);
-                    free (highlight);
-                    return 1;
-                }
-                msg_pos = match_post;
-            }
-        }
-
-        if (!end)
-            pos = pos_end + 1;
-    }
+    rc = string_highlight_match (highlight, string);
 
-    free (msg);
-    free (highlight);
+    string_highlight_free (highlight);
 
-    /* no highlight found */
-    return 0;
+    return rc;
 }
 
 /*
@@ -1183,7 +1818,7 @@ string_has_highlight_regex_compiled (const char *string, regex_t *regex)
 
     while (string && string[0])
     {
-        rc = regexec (regex, string,  1, &regex_match, 0);
+        rc = string_regexec (regex, string,  1, &regex_match, 0);
 
         /*
          * no match found: exit the loop (if rm_eo == 0, it is an empty match
@@ -1234,7 +1869,7 @@ string_has_highlight_regex (const char *string, const char *regex)
 
     rc = string_has_highlight_regex_compiled (string, &reg);
 
-    regfree (&reg);
+    string_regfree (&reg);
 
     return rc;
 }
@@ -1525,8 +2160,8 @@ string_replace_regex (const char *string, void *regex, const char *replace,
             regex_match[i].rm_so = -1;
         }
 
-        rc = regexec ((regex_t *)regex, result + start_offset, 100, regex_match,
-                      0);
+        rc = string_regexec (regex, result + start_offset, 100, regex_match,
+                             0);
         /*
          * no match found: exit the loop (if rm_eo == 0, it is an empty match
          * at beginning of string: we consider there is no match, to prevent an
@@ -1816,6 +2451,207 @@ string_split_shared (const char *string, const char *separators, int keep_eol,
                                   num_items_max, num_items, 1);
 }
 
+/*
+ * Splits a string according to separators, without copy: items are returned
+ * as slices (offset and length of item in string).
+ *
+ * Arguments "keep_eol" and "num_items_max" have same meaning as in function
+ * string_split_internal: if keep_eol is not 0, the length of each slice goes
+ * until the end of string (without the separators at the end of string if
+ * keep_eol == 1).
+ *
+ * If "buffer" is not NULL and has enough room ("buffer_size" slices), the
+ * slices are stored in this buffer (which is returned), otherwise a new array
+ * is allocated (and must be freed after use).
+ *
+ * Returns array of slices, NULL if error or if no items were found.
+ */
+
+struct t_string_slice *
+string_split_slices (const char *string, const char *separators, int keep_eol,
+                     int num_items_max, struct t_string_slice *buffer,
+                     int buffer_size, int *num_items)
+{
+    struct t_string_slice *slices;
+    const char *ptr_start, *ptr_end, *ptr;
+    int i, n_items, length;
+
+    if (num_items)
+        *num_items = 0;
+
+    if (!string || !string[0] || !separators || !separators[0])
+        return NULL;
+
+    /* skip separators at beginning of string */
+    ptr_start = string;
+    while (ptr_start[0] && strchr (separators, ptr_start[0]))
+    {
+        ptr_start++;
+    }
+
+    /* end of string, without separators (unless keep_eol == 2) */
+    ptr_end = ptr_start + strlen (ptr_start);
+    if (keep_eol != 2)
+    {
+        while ((ptr_end > ptr_start) && strchr (separators, ptr_end[-1]))
+        {
+            ptr_end--;
+        }
+    }
+    if (ptr_end == ptr_start)
+        return NULL;
+
+    /* calculate number of items */
+    n_items = 0;
+    ptr = ptr_start;
+    while (ptr < ptr_end)
+    {
+        n_items++;
+        ptr += strcspn (ptr, separators);
+        while (ptr[0] && strchr (separators, ptr[0]))
+        {
+            ptr++;
+        }
+    }
+
+    if ((num_items_max != 0) && (n_items > num_items_max))
+        n_items = num_items_max;
+
+    if (buffer && (n_items <= buffer_size))
+    {
+        slices = buffer;
+    }
+    else
+    {
+        slices = malloc (n_items * sizeof (slices[0]));
+        if (!slices)
+            return NULL;
+    }
+
+    /* fill slices */
+    ptr = ptr_start;
+    for (i = 0; i < n_items; i++)
+    {
+        length = strcspn (ptr, separators);
+        slices[i].offset = ptr - string;
+        slices[i].length = (keep_eol) ? ptr_end - ptr : length;
+        ptr += length;
+        while (ptr[0] && strchr (separators, ptr[0]))
+        {
+            ptr++;
+        }
+    }
+
+    if (num_items)
+        *num_items = n_items;
+
+    return slices;
+}
+
+/*
+ * Splits a string according to separators, and builds two arrays like the
+ * ones given to command callbacks: "argv" (items) and "argv_eol" (items with
+ * end of string), with a single allocation for both arrays and strings.
+ *
+ * This gives same result as two calls to string_split (the first one with
+ * keep_eol == 0 and the second one with "keep_eol"), but much faster.
+ *
+ * Argument "keep_eol" must be 1 or 2 (see function string_split_internal),
+ * "argv_eol" can be NULL (then only array "argv" is built).
+ *
+ * Note: the array "argv_eol" is in same memory block as "argv", so it must
+ * not be freed: the result must be freed after use with function
+ * string_free_split_argv() (which frees both arrays).
+ *
+ * Returns array of strings (argv), NULL if error or if no items were found.
+ */
+
+char **
+string_split_argv (const char *string, const char *separators, int keep_eol,
+                   int num_items_max, int *num_items, char ***argv_eol)
+{
+    struct t_string_slice slices_buffer[32], *slices;
+    char **argv, *ptr_items, *ptr_eol;
+    int i, n_items, length_items, length_eol, offset_eol, size;
+
+    if (num_items)
+        *num_items = 0;
+    if (argv_eol)
+        *argv_eol = NULL;
+
+    slices = string_split_slices (string, separators, 0, num_items_max,
+                                  slices_buffer,
+                                  sizeof (slices_buffer) / sizeof (slices_buffer[0]),
+                                  &n_items);
+    if (!slices)
+        return NULL;
+
+    /* compute size of items and end of string */
+    length_items = 0;
+    for (i = 0; i < n_items; i++)
+    {
+        length_items += slices[i].length + 1;
+    }
+    offset_eol = slices[0].offset;
+    length_eol = 0;
+    if (argv_eol)
+    {
+        length_eol = strlen (string + offset_eol);
+        if (keep_eol != 2)
+        {
+            while ((length_eol > 0)
+                   && strchr (separators, string[offset_eol + length_eol - 1]))
+            {
+                length_eol--;
+            }
+        }
+        length_eol++;
+    }
+
+    size = ((argv_eol) ? 2 : 1) * (n_items + 1) * sizeof (argv[0])
+        + length_items + length_eol;
+    argv = malloc (size);
+    if (!argv)
+    {
+        if (slices != slices_buffer)
+            free (slices);
+        return NULL;
+    }
+
+    /* build items */
+    ptr_items = (char *)(argv + (((argv_eol) ? 2 : 1) * (n_items + 1)));
+    ptr_eol = ptr_items + length_items;
+    for (i = 0; i < n_items; i++)
+    {
+        argv[i] = ptr_items;
+        memcpy (ptr_items, string + slices[i].offset, slices[i].length);
+        ptr_items[slices[i].length] = '\0';
+        ptr_items += slices[i].length + 1;
+    }
+    argv[n_items] = NULL;
+
+    /* build items with end of string (pointers in same string) */
+    if (argv_eol)
+    {
+        *argv_eol = argv + n_items + 1;
+        memcpy (ptr_eol, string + offset_eol, length_eol - 1);
+        ptr_eol[length_eol - 1] = '\0';
+        for (i = 0; i < n_items; i++)
+        {
+            (*argv_eol)[i] = ptr_eol + (slices[i].offset - offset_eol);
+        }
+        (*argv_eol)[n_items] = NULL;
+    }
+
+    if (slices != slices_buffer)
+        free (slices);
+
+    if (num_items)
+        *num_items = n_items;
+
+    return argv;
+}
+
 /*
  * Splits a string like the shell does for a command with arguments.
  *
@@ -2031,6 +2867,18 @@ string_free_split (char **split_string)
     }
 }
 
+/*
+ * Frees arrays built by function string_split_argv (both "argv" and
+ * "argv_eol").
+ */
+
+void
+string_free_split_argv (char **argv)
+{
+    if (argv)
+        free (argv);
+}
+
 /*
  * Frees a split string (using shared strings).
  */
@@ -2197,6 +3045,144 @@ string_free_split_command (char **split_command)
     }
 }
 
+/*
+ * Checks if a string has only ASCII chars (< 128).
+ *
+ * Returns:
+ *   1: string has only ASCII chars
+ *   0: string has at least one non-ASCII char
+ */
+
+int
+string_is_ascii (const char *string)
+{
+    const unsigned char *ptr_string;
+
+    if (!string)
+        return 1;
+
+    for (ptr_string = (const unsigned char *)string; ptr_string[0];
+         ptr_string++)
+    {
+        if (ptr_string[0] >= 128)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Checks if a charset encodes ASCII chars as themselves, on one byte
+ * (for example UTF-8, ISO-8859-*, CP125x), so that a string with only ASCII
+ * chars is the same in this charset.
+ *
+ * Returns:
+ *   1: charset is ASCII-compatible
+ *   0: charset is not ASCII-compatible (or unknown)
+ */
+
+int
+string_charset_is_ascii_compatible (const char *charset)
+{
+    const char *charsets[] = {
+        "ascii", "us-ascii", "ansi_x3.4",
+        "utf-8", "utf8",
+        "iso-8859-", "iso8859-", "iso_8859-", "latin",
+        "cp125", "windows-125",
+        "koi8",
+        NULL,
+    };
+    int i;
+
+    if (!charset)
+        return 0;
+
+    for (i = 0; charsets[i]; i++)
+    {
+        if (string_strncasecmp (charset, charsets[i],
+                                strlen (charsets[i])) == 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_ICONV
+/*
+ * Callback called when a key is removed in hashtable "string_hashtable_iconv".
+ */
+
+void
+string_iconv_free_value_cb (struct t_hashtable *hashtable,
+                            const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    iconv_close ((iconv_t)value);
+}
+
+/*
+ * Gets an iconv descriptor to convert from a charset to another one: the
+ * descriptor is opened on first use then kept in a cache, and its conversion
+ * state is reset on each call.
+ *
+ * Returns (iconv_t)(-1) if the conversion is not supported.
+ */
+
+iconv_t
+string_iconv_open (const char *from_code, const char *to_code)
+{
+    iconv_t cd;
+    char *key;
+    int length;
+
+    if (!string_hashtable_iconv)
+    {
+        string_hashtable_iconv = hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!string_hashtable_iconv)
+            return iconv_open (to_code, from_code);
+        string_hashtable_iconv->callback_free_value =
+            &string_iconv_free_value_cb;
+    }
+
+    length = strlen (to_code) + 1 + strlen (from_code) + 1;
+    key = malloc (length);
+    if (!key)
+        return (iconv_t)(-1);
+    snprintf (key, length, "%s\n%s", to_code, from_code);
+
+    if (hashtable_has_key (string_hashtable_iconv, key))
+    {
+        cd = (iconv_t)hashtable_get (string_hashtable_iconv, key);
+        /* reset conversion state */
+        iconv (cd, NULL, NULL, NULL, NULL);
+    }
+    else
+    {
+        cd = iconv_open (to_code, from_code);
+        if (cd != (iconv_t)(-1))
+        {
+            /* many charsets in cache? then close all descriptors */
+            if (string_hashtable_iconv->items_count >= 64)
+                hashtable_remove_all (string_hashtable_iconv);
+            hashtable_set (string_hashtable_iconv, key, cd);
+        }
+    }
+
+    free (key);
+
+    return cd;
+}
+#endif /* HAVE_ICONV */
+
 /*
  * Converts a string to another charset.
  *
@@ -2224,7 +3210,14 @@ string_iconv (int from_utf8, const char *from_code, const char *to_code,
     if (from_code && from_code[0] && to_code && to_code[0]
         && (string_strcasecmp(from_code, to_code) != 0))
     {
-        cd = iconv_open (to_code, from_code);
+        /* only ASCII chars and charsets compatible with ASCII: no conversion */
+        if (string_is_ascii (string)
+            && string_charset_is_ascii_compatible (from_code)
+            && string_charset_is_ascii_compatible (to_code))
+        {
+            return strdup (string);
+        }
+        cd = string_iconv_open (from_code, to_code);
         if (cd == (iconv_t)(-1))
             outbuf = strdup (string);
         else
@@ -2297,7 +3290,6 @@ string_iconv (int from_utf8, const char *from_code, const char *to_code,
                 ptr_inbuf = ptr_inbuf_shift;
             ptr_outbuf[0] = '\0';
             free (inbuf);
-            iconv_close (cd);
         }
     }
     else
@@ -3052,7 +4044,7 @@ string_replace_with_callback (const char *string,
  * Hashes a shared string.
  * The string starts after the reference count, which is skipped.
  *
- * Returns the hash of the shared string (variant of djb2).
+ * Returns the hash of the shared string (SipHash).
  */
 
 unsigned long long
@@ -3062,7 +4054,7 @@ string_shared_hash_key (struct t_hashtable *hashtable,
     /* make C compiler happy */
     (void) hashtable;
 
-    return hashtable_hash_key_djb2 (((const char *)key) + sizeof (string_shared_count_t));
+    return hashtable_hash_key_siphash (((const char *)key) + sizeof (string_shared_count_t));
 }
 
 /*
@@ -3199,9 +4191,38 @@ string_shared_free (const char *string)
 void
 string_end ()
 {
+#ifdef HAVE_PCRE2
+    pcre2_match_data *match_data;
+#endif /* HAVE_PCRE2 */
+
     if (string_hashtable_shared)
     {
         hashtable_free (string_hashtable_shared);
         string_hashtable_shared = NULL;
     }
+#ifdef HAVE_ICONV
+    if (string_hashtable_iconv)
+    {
+        hashtable_free (string_hashtable_iconv);
+        string_hashtable_iconv = NULL;
+    }
+#endif /* HAVE_ICONV */
+#ifdef HAVE_PCRE2
+    pthread_rwlock_wrlock (&string_hashtable_regex_pcre2_lock);
+    if (string_hashtable_regex_pcre2)
+    {
+        hashtable_free (string_hashtable_regex_pcre2);
+        string_hashtable_regex_pcre2 = NULL;
+    }
+    pthread_rwlock_unlock (&string_hashtable_regex_pcre2_lock);
+    if (string_regex_match_data_key_ok)
+    {
+        match_data = pthread_getspecific (string_regex_match_data_key);
+        if (match_data)
+        {
+            pcre2_match_data_free (match_data);
+            pthread_setspecific (string_regex_match_data_key, NULL);
+        }
+    }
+#endif /* HAVE_PCRE2 */
 }
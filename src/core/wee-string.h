@@ -24,6 +24,51 @@
 
 struct t_hashtable;
 
+/* slice of a string (returned by function string_split_slices) */
+
+struct t_string_slice
+{
+    int offset;                        /* offset of item in string          */
+    int length;                        /* length of item (in bytes)         */
+};
+
+/*
+ * compiled list of highlight words (see function string_highlight_compile):
+ * an Aho-Corasick automaton on words (ASCII lower case), to search all words
+ * in a single pass on a string
+ */
+
+struct t_string_highlight_word
+{
+    char *word;                        /* word (without wildcards)          */
+    int length;                        /* length of word (in bytes)         */
+    int case_sensitive;                /* 1 if word is case sensitive       */
+    int wildcard_start;                /* 1 if word starts with "*"         */
+    int wildcard_end;                  /* 1 if word ends with "*"           */
+    int next_word;                     /* next word ending on same node     */
+};
+
+struct t_string_highlight_node
+{
+    unsigned char c;                   /* char to reach this node           */
+    int first_child;                   /* first child node (0 if none)      */
+    int next_sibling;                  /* next node with same parent        */
+    int fail;                          /* longest suffix node in automaton  */
+    int dict;                          /* longest suffix node with a word   */
+    int first_word;                    /* first word ending here (-1: none) */
+};
+
+struct t_string_highlight
+{
+    char *highlight_words;             /* words used to build automaton     */
+    struct t_string_highlight_word *words; /* words                         */
+    int words_count;                   /* number of words                   */
+    struct t_string_highlight_node *nodes; /* nodes (0 is the root)         */
+    int nodes_count;                   /* number of nodes                   */
+    int nodes_size;                    /* allocated size of array "nodes"   */
+    int root_children[256];            /* child of root for each char       */
+};
+
 extern char *string_strndup (const char *string, int length);
 extern void string_tolower (char *string);
 extern void string_toupper (char *string);
@@ -58,8 +103,15 @@ extern char *string_mask_to_regex (const char *mask);
 extern const char *string_regex_flags (const char *regex, int default_flags,
                                        int *flags);
 extern int string_regcomp (void *preg, const char *regex, int default_flags);
+extern int string_regexec (void *preg, const char *string, int nmatch,
+                           void *pmatch, int eflags);
+extern void string_regfree (void *preg);
 extern int string_has_highlight (const char *string,
                                  const char *highlight_words);
+extern struct t_string_highlight *string_highlight_compile (const char *highlight_words);
+extern int string_highlight_match (struct t_string_highlight *highlight,
+                                   const char *string);
+extern void string_highlight_free (struct t_string_highlight *highlight);
 extern int string_has_highlight_regex_compiled (const char *string,
                                                 regex_t *regex);
 extern int string_has_highlight_regex (const char *string, const char *regex);
@@ -73,13 +125,26 @@ extern char **string_split (const char *string, const char *separators,
 extern char **string_split_shared (const char *string, const char *separators,
                                    int keep_eol, int num_items_max,
                                    int *num_items);
+extern struct t_string_slice *string_split_slices (const char *string,
+                                                   const char *separators,
+                                                   int keep_eol,
+                                                   int num_items_max,
+                                                   struct t_string_slice *buffer,
+                                                   int buffer_size,
+                                                   int *num_items);
+extern char **string_split_argv (const char *string, const char *separators,
+                                 int keep_eol, int num_items_max,
+                                 int *num_items, char ***argv_eol);
 extern char **string_split_shell (const char *string, int *num_items);
 extern void string_free_split (char **split_string);
 extern void string_free_split_shared (char **split_string);
+extern void string_free_split_argv (char **argv);
 extern char *string_build_with_split_string (const char **split_string,
                                              const char *separator);
 extern char **string_split_command (const char *command, char separator);
 extern void string_free_split_command (char **split_command);
+extern int string_is_ascii (const char *string);
+extern int string_charset_is_ascii_compatible (const char *charset);
 extern char *string_iconv (int from_utf8, const char *from_code,
                            const char *to_code, const char *string);
 extern char *string_iconv_to_internal (const char *charset, const char *string);
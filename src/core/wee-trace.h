@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_TRACE_H
+#define WEECHAT_TRACE_H 1
+
+/*
+ * Static tracepoints (USDT), enabled with cmake option ENABLE_TRACEPOINTS
+ * (or configure option --enable-tracepoints).
+ *
+ * With tracepoints, each probe is a single "nop" instruction in the code,
+ * replaced by a breakpoint only when a tracer (perf, bpftrace, systemtap)
+ * is attached to it; all probes are in provider "weechat", for example:
+ *
+ *   bpftrace -e 'usdt:/usr/bin/weechat:weechat:gui_line_add
+ *                { @[str(arg0)] = count(); }'
+ *
+ * Probes (with arguments):
+ *   hook_exec_start      hook type, plugin name, hook pointer
+ *   hook_exec_end        hook type, plugin name, time spent (µs)
+ *   hook_process_spawn   command, pid, 1 if started by spawn helper
+ *   hook_process_exit    command, pid, status (as returned by waitpid)
+ *   main_loop_phase      phase number, phase name (see wee-profile.h)
+ *   gui_line_add         buffer full name, message, 1 if line displayed
+ *   irc_recv             server name, number of bytes received
+ *   irc_parse            server name, message
+ *   irc_dispatch_start   server name, command, channel (may be NULL)
+ *   irc_dispatch_end     server name, command, channel (may be NULL)
+ *   relay_send           client description, message type, size of data
+ *   relay_flush          client description
+ *
+ * Each probe has a semaphore, incremented by the tracer when it is attached
+ * to the probe: the arguments of probe are evaluated only if the semaphore
+ * is set (so that arguments can be computed with function calls). The
+ * semaphores must be defined (with TRACE_SEMAPHORE) in the file using the
+ * probe (each plugin has its own semaphores).
+ *
+ * Without tracepoints, the macros are empty (arguments are not evaluated).
+ */
+
+#ifdef HAVE_TRACEPOINTS
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define TRACE_SEMAPHORE_NAME(name) weechat_##name##_semaphore
+#define TRACE_SEMAPHORE(name)                                           \
+    __extension__ unsigned short TRACE_SEMAPHORE_NAME(name)             \
+    __attribute__ ((unused)) __attribute__ ((section (".probes")))
+#define TRACE_ENABLED(name)                                             \
+    __builtin_expect (TRACE_SEMAPHORE_NAME(name), 0)
+
+#define TRACE(name)                                                     \
+    do { if (TRACE_ENABLED(name))                                       \
+            DTRACE_PROBE(weechat, name); } while (0)
+#define TRACE1(name, a1)                                                \
+    do { if (TRACE_ENABLED(name))                                       \
+            DTRACE_PROBE1(weechat, name, a1); } while (0)
+#define TRACE2(name, a1, a2)                                            \
+    do { if (TRACE_ENABLED(name))                                       \
+            DTRACE_PROBE2(weechat, name, a1, a2); } while (0)
+#define TRACE3(name, a1, a2, a3)                                        \
+    do { if (TRACE_ENABLED(name))                                       \
+            DTRACE_PROBE3(weechat, name, a1, a2, a3); } while (0)
+#define TRACE4(name, a1, a2, a3, a4)                                    \
+    do { if (TRACE_ENABLED(name))                                       \
+            DTRACE_PROBE4(weechat, name, a1, a2, a3, a4); } while (0)
+
+#else
+
+#define TRACE_ENABLED(name) 0
+
+#define TRACE(name)
+#define TRACE1(name, a1)
+#define TRACE2(name, a1, a2)
+#define TRACE3(name, a1, a2, a3)
+#define TRACE4(name, a1, a2, a3, a4)
+
+#endif /* HAVE_TRACEPOINTS */
+
+#endif /* WEECHAT_TRACE_H */
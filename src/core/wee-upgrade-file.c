@@ -93,7 +93,7 @@ upgrade_file_error (struct t_upgrade_file *upgrade_file, char *message1,
 int
 upgrade_file_write_integer (struct t_upgrade_file *upgrade_file, int value)
 {
-    if (fwrite ((void *)(&value), sizeof (value), 1, upgrade_file->file) <= 0)
+    if (gzwrite (upgrade_file->file, (void *)(&value), sizeof (value)) <= 0)
         return 0;
 
     return 1;
@@ -110,7 +110,7 @@ upgrade_file_write_integer (struct t_upgrade_file *upgrade_file, int value)
 int
 upgrade_file_write_time (struct t_upgrade_file *upgrade_file, time_t date)
 {
-    if (fwrite ((void *)(&date), sizeof (date), 1, upgrade_file->file) <= 0)
+    if (gzwrite (upgrade_file->file, (void *)(&date), sizeof (date)) <= 0)
         return 0;
 
     return 1;
@@ -135,7 +135,7 @@ upgrade_file_write_string (struct t_upgrade_file *upgrade_file,
         length = strlen (string);
         if (!upgrade_file_write_integer (upgrade_file, length))
             return 0;
-        if (fwrite ((void *)string, length, 1, upgrade_file->file) <= 0)
+        if (gzwrite (upgrade_file->file, (void *)string, length) <= 0)
             return 0;
     }
     else
@@ -163,7 +163,7 @@ upgrade_file_write_buffer (struct t_upgrade_file *upgrade_file, void *pointer,
     {
         if (!upgrade_file_write_integer (upgrade_file, size))
             return 0;
-        if (fwrite (pointer, size, 1, upgrade_file->file) <= 0)
+        if (gzwrite (upgrade_file->file, pointer, size) <= 0)
             return 0;
     }
     else
@@ -194,6 +194,7 @@ upgrade_file_new (const char *filename,
                   void *callback_read_data)
 {
     int length;
+    char mode[8];
     struct t_upgrade_file *new_upgrade_file;
 
     if (!filename)
@@ -216,11 +217,21 @@ upgrade_file_new (const char *filename,
         new_upgrade_file->callback_read_pointer = callback_read_pointer;
         new_upgrade_file->callback_read_data = callback_read_data;
 
-        /* open file in read or write mode */
+        /*
+         * open file in read or write mode; the file is compressed with zlib
+         * when writing, and read transparently (compressed or not) when
+         * reading
+         */
         if (callback_read)
-            new_upgrade_file->file = fopen (new_upgrade_file->filename, "rb");
+        {
+            snprintf (mode, sizeof (mode), "rb");
+        }
         else
-            new_upgrade_file->file = fopen (new_upgrade_file->filename, "wb");
+        {
+            snprintf (mode, sizeof (mode), "wb%d",
+                      UPGRADE_FILE_COMPRESSION_LEVEL);
+        }
+        new_upgrade_file->file = gzopen (new_upgrade_file->filename, mode);
 
         if (!new_upgrade_file->file)
         {
@@ -229,6 +240,10 @@ upgrade_file_new (const char *filename,
             return NULL;
         }
 
+#if ZLIB_VERNUM >= 0x1240
+        gzbuffer (new_upgrade_file->file, UPGRADE_FILE_BUFFER_SIZE);
+#endif /* ZLIB_VERNUM >= 0x1240 */
+
         /* change permissions if write mode */
         if (!callback_read)
         {
@@ -422,17 +437,18 @@ upgrade_file_write_object (struct t_upgrade_file *upgrade_file, int object_id,
 int
 upgrade_file_read_integer (struct t_upgrade_file *upgrade_file, int *value)
 {
-    upgrade_file->last_read_pos = ftell (upgrade_file->file);
+    upgrade_file->last_read_pos = gztell (upgrade_file->file);
     upgrade_file->last_read_length = sizeof (*value);
 
     if (value)
     {
-        if (fread ((void *)value, sizeof (*value), 1, upgrade_file->file) <= 0)
+        if (gzread (upgrade_file->file, (void *)value,
+                    sizeof (*value)) != sizeof (*value))
             return 0;
     }
     else
     {
-        if (fseek (upgrade_file->file, sizeof (*value), SEEK_CUR) < 0)
+        if (gzseek (upgrade_file->file, sizeof (*value), SEEK_CUR) < 0)
             return 0;
     }
     return 1;
@@ -460,7 +476,7 @@ upgrade_file_read_string (struct t_upgrade_file *upgrade_file, char **string)
     if (!upgrade_file_read_integer (upgrade_file, &length))
         return 0;
 
-    upgrade_file->last_read_pos = ftell (upgrade_file->file);
+    upgrade_file->last_read_pos = gztell (upgrade_file->file);
     upgrade_file->last_read_length = length;
 
     if (string)
@@ -472,7 +488,7 @@ upgrade_file_read_string (struct t_upgrade_file *upgrade_file, char **string)
         if (!(*string))
             return 0;
 
-        if (fread ((void *)(*string), length, 1, upgrade_file->file) <= 0)
+        if (gzread (upgrade_file->file, (void *)(*string), length) != length)
         {
             free (*string);
             *string = NULL;
@@ -482,7 +498,7 @@ upgrade_file_read_string (struct t_upgrade_file *upgrade_file, char **string)
     }
     else
     {
-        if (fseek (upgrade_file->file, length, SEEK_CUR) < 0)
+        if (gzseek (upgrade_file->file, length, SEEK_CUR) < 0)
             return 0;
     }
     return 1;
@@ -535,19 +551,19 @@ upgrade_file_read_buffer (struct t_upgrade_file *upgrade_file,
 
     if (*size > 0)
     {
-        upgrade_file->last_read_pos = ftell (upgrade_file->file);
+        upgrade_file->last_read_pos = gztell (upgrade_file->file);
         upgrade_file->last_read_length = *size;
 
         *buffer = malloc (*size);
 
         if (*buffer)
         {
-            if (fread (*buffer, *size, 1, upgrade_file->file) <= 0)
+            if (gzread (upgrade_file->file, *buffer, *size) != *size)
                 return 0;
         }
         else
         {
-            if (fseek (upgrade_file->file, *size, SEEK_CUR) < 0)
+            if (gzseek (upgrade_file->file, *size, SEEK_CUR) < 0)
                 return 0;
         }
     }
@@ -566,17 +582,18 @@ upgrade_file_read_buffer (struct t_upgrade_file *upgrade_file,
 int
 upgrade_file_read_time (struct t_upgrade_file *upgrade_file, time_t *time)
 {
-    upgrade_file->last_read_pos = ftell (upgrade_file->file);
+    upgrade_file->last_read_pos = gztell (upgrade_file->file);
     upgrade_file->last_read_length = sizeof (*time);
 
     if (time)
     {
-        if (fread ((void *)time, sizeof (*time), 1, upgrade_file->file) <= 0)
+        if (gzread (upgrade_file->file, (void *)time,
+                    sizeof (*time)) != sizeof (*time))
             return 0;
     }
     else
     {
-        if (fseek (upgrade_file->file, sizeof (*time), SEEK_CUR) < 0)
+        if (gzseek (upgrade_file->file, sizeof (*time), SEEK_CUR) < 0)
             return 0;
     }
 
@@ -610,7 +627,7 @@ upgrade_file_read_object (struct t_upgrade_file *upgrade_file)
 
     if (!upgrade_file_read_integer (upgrade_file, &type))
     {
-        if (feof (upgrade_file->file))
+        if (gzeof (upgrade_file->file))
             rc = 1;
         else
             UPGRADE_ERROR(_("read - object type"), "");
@@ -773,7 +790,7 @@ upgrade_file_read (struct t_upgrade_file *upgrade_file)
 
     free (signature);
 
-    while (!feof (upgrade_file->file))
+    while (!gzeof (upgrade_file->file))
     {
         if (!upgrade_file_read_object (upgrade_file))
             return 0;
@@ -795,7 +812,7 @@ upgrade_file_close (struct t_upgrade_file *upgrade_file)
     if (upgrade_file->filename)
         free (upgrade_file->filename);
     if (upgrade_file->file)
-        fclose (upgrade_file->file);
+        gzclose (upgrade_file->file);
     if (upgrade_file->callback_read_data)
         free (upgrade_file->callback_read_data);
 
@@ -20,8 +20,16 @@
 #ifndef WEECHAT_UPGRADE_FILE_H
 #define WEECHAT_UPGRADE_FILE_H 1
 
+#include <zlib.h>
+
 #define UPGRADE_SIGNATURE "===== WeeChat Upgrade file v2.2 - binary, do not edit! ====="
 
+/* compression level of upgrade files (1 = fastest) */
+#define UPGRADE_FILE_COMPRESSION_LEVEL 1
+
+/* size of buffer used to read/write upgrade files */
+#define UPGRADE_FILE_BUFFER_SIZE (128 * 1024)
+
 #define UPGRADE_ERROR(msg1, msg2)                                       \
     upgrade_file_error(upgrade_file, msg1, msg2, __FILE__, __LINE__)
 
@@ -37,7 +45,7 @@ enum t_upgrade_type
 struct t_upgrade_file
 {
     char *filename;                        /* filename with path            */
-    FILE *file;                            /* file pointer                  */
+    gzFile file;                           /* file (compressed with zlib)   */
     long last_read_pos;                    /* last read position            */
     int last_read_length;                  /* last read length              */
     int (*callback_read)                   /* callback called when reading  */
@@ -108,6 +108,151 @@ upgrade_weechat_save_history (struct t_upgrade_file *upgrade_file,
     return 1;
 }
 
+/*
+ * Writes a block of buffer lines in WeeChat upgrade file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_write_lines_block (struct t_upgrade_file *upgrade_file,
+                                   char *block, int size)
+{
+    struct t_infolist *ptr_infolist;
+    struct t_infolist_item *ptr_item;
+    int rc;
+
+    ptr_infolist = infolist_new (NULL);
+    if (!ptr_infolist)
+        return 0;
+
+    rc = 0;
+    ptr_item = infolist_new_item (ptr_infolist);
+    if (ptr_item && infolist_new_var_buffer (ptr_item, "lines", block, size))
+    {
+        rc = upgrade_file_write_object (upgrade_file,
+                                        UPGRADE_WEECHAT_TYPE_BUFFER_LINES,
+                                        ptr_infolist);
+    }
+
+    infolist_free (ptr_infolist);
+
+    return rc;
+}
+
+/*
+ * Saves lines of a buffer in WeeChat upgrade file.
+ *
+ * Lines are saved in blocks (at most UPGRADE_WEECHAT_LINES_BLOCK_SIZE bytes,
+ * unless a single line is bigger): each line is a header
+ * (struct t_upgrade_weechat_line) followed by tags, prefix and message (with
+ * their final '\0').
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_save_buffer_lines (struct t_upgrade_file *upgrade_file,
+                                   struct t_gui_buffer *buffer)
+{
+    struct t_gui_line *ptr_line;
+    struct t_upgrade_weechat_line line_header;
+    char *block, *block2, *tags;
+    int size, size_allocated, size_line, rc;
+
+    if (!buffer->own_lines->first_line)
+        return 1;
+
+    size_allocated = UPGRADE_WEECHAT_LINES_BLOCK_SIZE;
+    block = malloc (size_allocated);
+    if (!block)
+        return 0;
+    size = 0;
+
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        tags = string_build_with_split_string (
+            (const char **)ptr_line->data->tags_array, ",");
+
+        memset (&line_header, 0, sizeof (line_header));
+        line_header.id = ptr_line->data->id;
+        line_header.y = ptr_line->data->y;
+        line_header.date = ptr_line->data->date;
+        line_header.date_printed = ptr_line->data->date_printed;
+        line_header.highlight = ptr_line->data->highlight;
+        line_header.last_read_line =
+            (buffer->own_lines->last_read_line == ptr_line) ? 1 : 0;
+        line_header.length_tags = (tags) ? strlen (tags) + 1 : 0;
+        line_header.length_prefix = (ptr_line->data->prefix) ?
+            strlen (ptr_line->data->prefix) + 1 : 0;
+        line_header.length_message = (ptr_line->data->message) ?
+            strlen (ptr_line->data->message) + 1 : 0;
+        size_line = sizeof (line_header) + line_header.length_tags
+            + line_header.length_prefix + line_header.length_message;
+
+        /* block is full? then write it */
+        if ((size > 0) && (size + size_line > UPGRADE_WEECHAT_LINES_BLOCK_SIZE))
+        {
+            if (!upgrade_weechat_write_lines_block (upgrade_file, block, size))
+            {
+                if (tags)
+                    free (tags);
+                free (block);
+                return 0;
+            }
+            size = 0;
+        }
+
+        /* line bigger than block? then enlarge block */
+        if (size + size_line > size_allocated)
+        {
+            block2 = realloc (block, size + size_line);
+            if (!block2)
+            {
+                if (tags)
+                    free (tags);
+                free (block);
+                return 0;
+            }
+            block = block2;
+            size_allocated = size + size_line;
+        }
+
+        memcpy (block + size, &line_header, sizeof (line_header));
+        size += sizeof (line_header);
+        if (tags)
+        {
+            memcpy (block + size, tags, line_header.length_tags);
+            size += line_header.length_tags;
+            free (tags);
+        }
+        if (ptr_line->data->prefix)
+        {
+            memcpy (block + size, ptr_line->data->prefix,
+                    line_header.length_prefix);
+            size += line_header.length_prefix;
+        }
+        if (ptr_line->data->message)
+        {
+            memcpy (block + size, ptr_line->data->message,
+                    line_header.length_message);
+            size += line_header.length_message;
+        }
+    }
+
+    rc = (size > 0) ?
+        upgrade_weechat_write_lines_block (upgrade_file, block, size) : 1;
+
+    free (block);
+
+    return rc;
+}
+
 /*
  * Saves buffers in WeeChat upgrade file.
  *
@@ -121,7 +266,6 @@ upgrade_weechat_save_buffers (struct t_upgrade_file *upgrade_file)
 {
     struct t_infolist *ptr_infolist;
     struct t_gui_buffer *ptr_buffer;
-    struct t_gui_line *ptr_line;
     int rc;
 
     for (ptr_buffer = gui_buffers; ptr_buffer;
@@ -163,26 +307,8 @@ upgrade_weechat_save_buffers (struct t_upgrade_file *upgrade_file)
         }
 
         /* save buffer lines */
-        for (ptr_line = ptr_buffer->own_lines->first_line; ptr_line;
-             ptr_line = ptr_line->next_line)
-        {
-            ptr_infolist = infolist_new (NULL);
-            if (!ptr_infolist)
-                return 0;
-            if (!gui_line_add_to_infolist (ptr_infolist,
-                                           ptr_buffer->own_lines,
-                                           ptr_line))
-            {
-                infolist_free (ptr_infolist);
-                return 0;
-            }
-            rc = upgrade_file_write_object (upgrade_file,
-                                            UPGRADE_WEECHAT_TYPE_BUFFER_LINE,
-                                            ptr_infolist);
-            infolist_free (ptr_infolist);
-            if (!rc)
-                return 0;
-        }
+        if (!upgrade_weechat_save_buffer_lines (upgrade_file, ptr_buffer))
+            return 0;
 
         /* save command/text history of buffer */
         if (ptr_buffer->history)
@@ -509,6 +635,8 @@ upgrade_weechat_read_buffer (struct t_infolist *infolist)
     ptr_buffer->input = infolist_integer (infolist, "input");
     ptr_buffer->input_get_unknown_commands =
         infolist_integer (infolist, "input_get_unknown_commands");
+    ptr_buffer->input_multiline =
+        infolist_integer (infolist, "input_multiline");
     if (infolist_integer (infolist, "input_buffer_alloc") > 0)
     {
         ptr_buffer->input_buffer =
@@ -614,11 +742,14 @@ upgrade_weechat_read_buffer (struct t_infolist *infolist)
 }
 
 /*
- * Reads a buffer line from infolist.
+ * Adds a buffer line read in upgrade file.
  */
 
 void
-upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
+upgrade_weechat_add_buffer_line (int y, time_t date, time_t date_printed,
+                                 const char *tags, const char *prefix,
+                                 const char *message, int highlight,
+                                 const long *id, int last_read_line)
 {
     struct t_gui_line *new_line;
 
@@ -629,29 +760,102 @@ upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
     {
         case GUI_BUFFER_TYPE_FORMATTED:
             new_line = gui_line_add (upgrade_current_buffer,
-                                     infolist_time (infolist, "date"),
-                                     infolist_time (infolist, "date_printed"),
-                                     infolist_string (infolist, "tags"),
-                                     infolist_string (infolist, "prefix"),
-                                     infolist_string (infolist, "message"));
+                                     date, date_printed,
+                                     tags, prefix, message);
             if (new_line)
             {
-                new_line->data->highlight = infolist_integer (infolist,
-                                                              "highlight");
-                if (infolist_integer (infolist, "last_read_line"))
+                new_line->data->highlight = highlight;
+                /* restore id of line (kept by clients, for example relay) */
+                if (id)
+                {
+                    new_line->data->id = *id;
+                    if (new_line->data->id >= gui_line_data_next_id)
+                        gui_line_data_next_id = new_line->data->id + 1;
+                }
+                if (last_read_line)
                     upgrade_current_buffer->lines->last_read_line = new_line;
             }
             break;
         case GUI_BUFFER_TYPE_FREE:
-            gui_line_add_y (upgrade_current_buffer,
-                            infolist_integer (infolist, "y"),
-                            infolist_string (infolist, "message"));
+            gui_line_add_y (upgrade_current_buffer, y, message);
             break;
         case GUI_BUFFER_NUM_TYPES:
             break;
     }
 }
 
+/*
+ * Reads a buffer line from infolist (upgrade file saved by an old version,
+ * with one object by line).
+ */
+
+void
+upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
+{
+    void *buf;
+    long id;
+    int size;
+
+    buf = infolist_buffer (infolist, "id", &size);
+    if (buf && (size == sizeof (id)))
+        memcpy (&id, buf, size);
+
+    upgrade_weechat_add_buffer_line (
+        infolist_integer (infolist, "y"),
+        infolist_time (infolist, "date"),
+        infolist_time (infolist, "date_printed"),
+        infolist_string (infolist, "tags"),
+        infolist_string (infolist, "prefix"),
+        infolist_string (infolist, "message"),
+        infolist_integer (infolist, "highlight"),
+        (buf && (size == sizeof (id))) ? &id : NULL,
+        infolist_integer (infolist, "last_read_line"));
+}
+
+/*
+ * Reads a block of buffer lines from infolist.
+ */
+
+void
+upgrade_weechat_read_buffer_lines (struct t_infolist *infolist)
+{
+    struct t_upgrade_weechat_line line_header;
+    const char *block, *ptr_block, *tags, *prefix, *message;
+    int size, size_line;
+
+    block = infolist_buffer (infolist, "lines", &size);
+    if (!block || (size <= 0))
+        return;
+
+    ptr_block = block;
+    while (ptr_block + sizeof (line_header) <= block + size)
+    {
+        memcpy (&line_header, ptr_block, sizeof (line_header));
+        size_line = sizeof (line_header) + line_header.length_tags
+            + line_header.length_prefix + line_header.length_message;
+        if ((line_header.length_tags < 0) || (line_header.length_prefix < 0)
+            || (line_header.length_message < 0)
+            || (ptr_block + size_line > block + size))
+        {
+            break;
+        }
+        ptr_block += sizeof (line_header);
+        tags = (line_header.length_tags > 0) ? ptr_block : NULL;
+        ptr_block += line_header.length_tags;
+        prefix = (line_header.length_prefix > 0) ? ptr_block : NULL;
+        ptr_block += line_header.length_prefix;
+        message = (line_header.length_message > 0) ? ptr_block : NULL;
+        ptr_block += line_header.length_message;
+        upgrade_weechat_add_buffer_line (line_header.y,
+                                         line_header.date,
+                                         line_header.date_printed,
+                                         tags, prefix, message,
+                                         line_header.highlight,
+                                         &line_header.id,
+                                         line_header.last_read_line);
+    }
+}
+
 /*
  * Reads a nicklist from infolist.
  */
@@ -793,6 +997,9 @@ upgrade_weechat_read_cb (const void *pointer, void *data,
             case UPGRADE_WEECHAT_TYPE_BUFFER_LINE:
                 upgrade_weechat_read_buffer_line (infolist);
                 break;
+            case UPGRADE_WEECHAT_TYPE_BUFFER_LINES:
+                upgrade_weechat_read_buffer_lines (infolist);
+                break;
             case UPGRADE_WEECHAT_TYPE_NICKLIST:
                 upgrade_weechat_read_nicklist (infolist);
                 break;
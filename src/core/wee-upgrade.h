@@ -35,6 +35,26 @@ enum t_upgrade_weechat_type
     UPGRADE_WEECHAT_TYPE_MISC,
     UPGRADE_WEECHAT_TYPE_HOTLIST,
     UPGRADE_WEECHAT_TYPE_LAYOUT_WINDOW,
+    UPGRADE_WEECHAT_TYPE_BUFFER_LINES,
+};
+
+/* max size of a block of buffer lines saved in upgrade file */
+#define UPGRADE_WEECHAT_LINES_BLOCK_SIZE (1024 * 1024)
+
+/* header of a line in a block of buffer lines (followed by the strings) */
+
+struct t_upgrade_weechat_line
+{
+    long id;                           /* unique id of line                 */
+    int y;                             /* line position (for free buffer)   */
+    time_t date;                       /* date/time of line                 */
+    time_t date_printed;               /* date/time when weechat print it   */
+    int highlight;                     /* 1 if line has highlight           */
+    int last_read_line;                /* 1 if line is the last read line   */
+    int length_tags;                   /* length of tags (with final '\0'), */
+                                       /* 0 if NULL                         */
+    int length_prefix;                 /* length of prefix (same rule)      */
+    int length_message;                /* length of message (same rule)     */
 };
 
 int upgrade_weechat_save ();
@@ -32,9 +32,12 @@
 #include "wee-url.h"
 #include "wee-config.h"
 #include "wee-hashtable.h"
+#include "wee-hook.h"
 #include "wee-infolist.h"
 #include "wee-proxy.h"
 #include "wee-string.h"
+#include "../gui/gui-chat.h"
+#include "../plugins/plugin.h"
 
 
 #define URL_DEF_CONST(__prefix, __name)                                 \
@@ -790,6 +793,15 @@ struct t_url_option url_options[] =
 
 char url_error[CURL_ERROR_SIZE + 1];
 
+CURLM *url_multi = NULL;                /* Curl multi handle (downloads in   */
+                                        /* WeeChat process)                  */
+CURLSH *url_share = NULL;               /* data shared by downloads (TLS     */
+                                        /* sessions, DNS cache)              */
+struct t_url_transfer *url_transfers = NULL; /* downloads in progress       */
+struct t_hook *url_multi_hook_timer = NULL;  /* timer asked by Curl         */
+struct t_hook *url_multi_hook_timer_end = NULL; /* timer to end downloads   */
+                                             /* which failed before start   */
+
 
 /*
  * Searches for a constant in array of constants.
@@ -1147,6 +1159,631 @@ end:
     return rc;
 }
 
+/*
+ * Adds data received in output of a transfer (callback called by Curl when
+ * there is no output file).
+ */
+
+size_t
+weeurl_multi_write_cb (void *buffer, size_t size, size_t nmemb, void *stream)
+{
+    struct t_url_transfer *transfer;
+    char *new_output;
+    int length, new_alloc;
+
+    transfer = (struct t_url_transfer *)stream;
+    length = size * nmemb;
+
+    if (transfer->output_size + length > transfer->output_alloc)
+    {
+        new_alloc = (transfer->output_alloc > 0) ?
+            transfer->output_alloc : HOOK_PROCESS_BUFFER_SIZE;
+        while (transfer->output_size + length > new_alloc)
+        {
+            new_alloc *= 2;
+        }
+        new_output = realloc (transfer->output, new_alloc);
+        if (!new_output)
+            return 0;
+        transfer->output = new_output;
+        transfer->output_alloc = new_alloc;
+    }
+
+    memcpy (transfer->output + transfer->output_size, buffer, length);
+    transfer->output_size += length;
+
+    return length;
+}
+
+/*
+ * Checks if a transfer pointer is still in list of transfers.
+ *
+ * Returns:
+ *   1: transfer exists
+ *   0: transfer does not exist
+ */
+
+int
+weeurl_multi_transfer_valid (struct t_url_transfer *transfer)
+{
+    struct t_url_transfer *ptr_transfer;
+
+    for (ptr_transfer = url_transfers; ptr_transfer;
+         ptr_transfer = ptr_transfer->next_transfer)
+    {
+        if (ptr_transfer == transfer)
+            return 1;
+    }
+
+    /* transfer not found */
+    return 0;
+}
+
+/*
+ * Sends output and end of transfers to the process hooks (called after Curl
+ * calls, never inside a Curl callback, because the hook callback can remove
+ * the hook).
+ */
+
+void
+weeurl_multi_deliver ()
+{
+    struct t_url_transfer *ptr_transfer;
+    struct t_hook *ptr_hook;
+    char str_error[1024];
+    int size, chunk;
+
+    ptr_transfer = url_transfers;
+    while (ptr_transfer)
+    {
+        ptr_hook = ptr_transfer->hook_process;
+
+        /* send data received to the hook, by chunks (like a child process) */
+        if (ptr_transfer->output_size > 0)
+        {
+            size = 0;
+            while (size < ptr_transfer->output_size)
+            {
+                chunk = ptr_transfer->output_size - size;
+                if (chunk > HOOK_PROCESS_BUFFER_SIZE / 8)
+                    chunk = HOOK_PROCESS_BUFFER_SIZE / 8;
+                hook_process_add_to_buffer (ptr_hook, HOOK_PROCESS_STDOUT,
+                                            ptr_transfer->output + size,
+                                            chunk);
+                if (ptr_hook->deleted)
+                    break;
+                size += chunk;
+                if (HOOK_PROCESS(ptr_hook, buffer_size[HOOK_PROCESS_STDOUT]) >=
+                    HOOK_PROCESS(ptr_hook, buffer_flush))
+                {
+                    hook_process_send_buffers (ptr_hook,
+                                               WEECHAT_HOOK_PROCESS_RUNNING);
+                    if (ptr_hook->deleted)
+                        break;
+                }
+            }
+            if (ptr_hook->deleted
+                || !weeurl_multi_transfer_valid (ptr_transfer))
+            {
+                /* the hook was removed by its callback: restart the loop */
+                ptr_transfer = url_transfers;
+                continue;
+            }
+            ptr_transfer->output_size = 0;
+        }
+
+        /* end of transfer: send last data and return code, remove hook */
+        if (ptr_transfer->rc != WEECHAT_HOOK_PROCESS_RUNNING)
+        {
+            if (ptr_transfer->rc == 2)
+            {
+                snprintf (str_error, sizeof (str_error),
+                          _("curl error %d (%s) (URL: \"%s\")\n"),
+                          ptr_transfer->curl_rc, ptr_transfer->error,
+                          HOOK_PROCESS(ptr_hook, command) + 4);
+                hook_process_add_to_buffer (ptr_hook, HOOK_PROCESS_STDERR,
+                                            str_error, strlen (str_error));
+            }
+            if ((ptr_transfer->rc == WEECHAT_HOOK_PROCESS_ERROR)
+                && (weechat_debug_core >= 1))
+            {
+                gui_chat_printf (NULL,
+                                 _("End of command '%s', timeout reached "
+                                   "(%.1fs)"),
+                                 HOOK_PROCESS(ptr_hook, command),
+                                 ((float)HOOK_PROCESS(ptr_hook, timeout)) / 1000);
+            }
+            hook_process_send_buffers (ptr_hook, ptr_transfer->rc);
+            unhook (ptr_hook);
+            ptr_transfer = url_transfers;
+            continue;
+        }
+
+        ptr_transfer = ptr_transfer->next_transfer;
+    }
+}
+
+/*
+ * Reads messages from Curl multi handle: marks the transfers which are
+ * finished, with their return code.
+ */
+
+void
+weeurl_multi_check_done ()
+{
+    CURLMsg *msg;
+    struct t_url_transfer *ptr_transfer;
+    int msgs_left;
+
+    while ((msg = curl_multi_info_read (url_multi, &msgs_left)))
+    {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+        ptr_transfer = NULL;
+        curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE,
+                           (char **)&ptr_transfer);
+        if (!ptr_transfer)
+            continue;
+        ptr_transfer->curl_rc = msg->data.result;
+        if (msg->data.result == CURLE_OK)
+        {
+            ptr_transfer->rc = 0;
+        }
+        else if ((msg->data.result == CURLE_OPERATION_TIMEDOUT)
+                 && (ptr_transfer->timeout > 0))
+        {
+            /* timeout of the hook (same code as for a child process) */
+            ptr_transfer->rc = WEECHAT_HOOK_PROCESS_ERROR;
+        }
+        else
+        {
+            ptr_transfer->rc = 2;
+        }
+    }
+}
+
+/*
+ * Callback for data available (or space to write) on a socket used by Curl.
+ */
+
+int
+weeurl_multi_fd_cb (const void *pointer, void *data, int fd)
+{
+    int running_handles;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    if (!url_multi)
+        return WEECHAT_RC_OK;
+
+    curl_multi_socket_action (url_multi, fd, 0, &running_handles);
+    weeurl_multi_check_done ();
+    weeurl_multi_deliver ();
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for timer asked by Curl.
+ */
+
+int
+weeurl_multi_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    long timeout_ms;
+    int running_handles;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    /* timer is called only one time: Curl may ask for a new one */
+    url_multi_hook_timer = NULL;
+
+    if (!url_multi)
+        return WEECHAT_RC_OK;
+
+    curl_multi_socket_action (url_multi, CURL_SOCKET_TIMEOUT, 0,
+                              &running_handles);
+
+    /*
+     * the timer may be called a bit before the time asked by Curl, and then
+     * Curl does not ask again for the same timeout: set it again
+     */
+    if (!url_multi_hook_timer
+        && (curl_multi_timeout (url_multi, &timeout_ms) == CURLM_OK)
+        && (timeout_ms >= 0))
+    {
+        url_multi_hook_timer = hook_timer (NULL,
+                                           (timeout_ms > 0) ? timeout_ms : 1,
+                                           0, 1,
+                                           &weeurl_multi_timer_cb, NULL, NULL);
+    }
+    weeurl_multi_check_done ();
+    weeurl_multi_deliver ();
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for timer used to end transfers which failed before being started.
+ */
+
+int
+weeurl_multi_timer_end_cb (const void *pointer, void *data,
+                           int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    url_multi_hook_timer_end = NULL;
+
+    weeurl_multi_deliver ();
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Adds, updates or removes a fd hook for a socket (callback called by Curl).
+ */
+
+int
+weeurl_multi_socket_cb (CURL *easy, curl_socket_t s, int what,
+                        void *userp, void *socketp)
+{
+    struct t_hook *ptr_hook;
+    int flags;
+
+    /* make C compiler happy */
+    (void) easy;
+    (void) userp;
+
+    ptr_hook = (struct t_hook *)socketp;
+
+    if (what == CURL_POLL_REMOVE)
+    {
+        if (ptr_hook)
+            unhook (ptr_hook);
+        curl_multi_assign (url_multi, s, NULL);
+        return 0;
+    }
+
+    flags = 0;
+    if ((what == CURL_POLL_IN) || (what == CURL_POLL_INOUT))
+        flags |= HOOK_FD_FLAG_READ;
+    if ((what == CURL_POLL_OUT) || (what == CURL_POLL_INOUT))
+        flags |= HOOK_FD_FLAG_WRITE;
+
+    if (ptr_hook)
+    {
+        hook_fd_set_flags (ptr_hook, flags);
+    }
+    else
+    {
+        ptr_hook = hook_fd (NULL, s,
+                            (flags & HOOK_FD_FLAG_READ) ? 1 : 0,
+                            (flags & HOOK_FD_FLAG_WRITE) ? 1 : 0,
+                            0,
+                            &weeurl_multi_fd_cb, NULL, NULL);
+        curl_multi_assign (url_multi, s, ptr_hook);
+    }
+
+    return 0;
+}
+
+/*
+ * Sets timer asked by Curl (callback called by Curl).
+ */
+
+int
+weeurl_multi_timer_set_cb (CURLM *multi, long timeout_ms, void *userp)
+{
+    /* make C compiler happy */
+    (void) multi;
+    (void) userp;
+
+    if (url_multi_hook_timer)
+    {
+        unhook (url_multi_hook_timer);
+        url_multi_hook_timer = NULL;
+    }
+
+    if (timeout_ms >= 0)
+    {
+        url_multi_hook_timer = hook_timer (NULL,
+                                           (timeout_ms > 0) ? timeout_ms : 1,
+                                           0, 1,
+                                           &weeurl_multi_timer_cb, NULL, NULL);
+    }
+
+    return 0;
+}
+
+/*
+ * Initializes Curl multi and share handles (if not already done).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+weeurl_multi_init ()
+{
+    if (url_multi)
+        return 1;
+
+    url_multi = curl_multi_init ();
+    if (!url_multi)
+        return 0;
+
+    curl_multi_setopt (url_multi, CURLMOPT_SOCKETFUNCTION,
+                       &weeurl_multi_socket_cb);
+    curl_multi_setopt (url_multi, CURLMOPT_TIMERFUNCTION,
+                       &weeurl_multi_timer_set_cb);
+
+    url_share = curl_share_init ();
+    if (url_share)
+    {
+        curl_share_setopt (url_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#if LIBCURL_VERSION_NUM >= 0x071700 /* 7.23.0 */
+        curl_share_setopt (url_share, CURLSHOPT_SHARE,
+                           CURL_LOCK_DATA_SSL_SESSION);
+#endif /* LIBCURL_VERSION_NUM >= 0x071700 */
+    }
+
+    return 1;
+}
+
+/*
+ * Ends a transfer with a return code, before it is added in Curl multi
+ * handle (the hook callback is called a bit later, by a timer, so that the
+ * caller of hook_process gets a valid hook).
+ */
+
+void
+weeurl_multi_fail (struct t_url_transfer *transfer, int rc)
+{
+    transfer->rc = rc;
+    if (!url_multi_hook_timer_end)
+    {
+        url_multi_hook_timer_end = hook_timer (NULL, 1, 0, 1,
+                                               &weeurl_multi_timer_end_cb,
+                                               NULL, NULL);
+    }
+}
+
+/*
+ * Starts download of URL of a process hook ("url:...") in WeeChat process,
+ * with Curl multi interface: the hook callback is called with data received
+ * and return code, like for a child process.
+ *
+ * Argument "timeout" is the remaining timeout of hook (in milliseconds,
+ * 0 = no timeout).
+ *
+ * Returns:
+ *   1: download started in WeeChat process
+ *   0: download must be done in a child process (option
+ *      weechat.network.url_multi is off, Curl can not resolve names
+ *      asynchronously, or error)
+ */
+
+int
+weeurl_multi_start (struct t_hook *hook_process, long timeout)
+{
+    struct t_url_transfer *new_transfer;
+    curl_version_info_data *curl_info;
+    char *url_file_option[2] = { "file_in", "file_out" };
+    char *url_file_mode[2] = { "rb", "wb" };
+    CURLoption url_file_opt_func[2] = { CURLOPT_READFUNCTION, CURLOPT_WRITEFUNCTION };
+    CURLoption url_file_opt_data[2] = { CURLOPT_READDATA, CURLOPT_WRITEDATA };
+    void *url_file_opt_cb[2] = { &weeurl_read, &weeurl_write };
+    struct t_hashtable *options;
+    struct t_proxy *ptr_proxy;
+    const char *ptr_url;
+    int i;
+
+    if (!CONFIG_BOOLEAN(config_network_url_multi))
+        return 0;
+
+    if (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) != 0)
+        return 0;
+
+    if (HOOK_PROCESS(hook_process, detached))
+        return 0;
+
+    /* a blocking name resolution would freeze WeeChat */
+    curl_info = curl_version_info (CURLVERSION_NOW);
+    if (!curl_info || !(curl_info->features & CURL_VERSION_ASYNCHDNS))
+        return 0;
+
+    if (!weeurl_multi_init ())
+        return 0;
+
+    new_transfer = malloc (sizeof (*new_transfer));
+    if (!new_transfer)
+        return 0;
+
+    new_transfer->curl = NULL;
+    new_transfer->hook_process = hook_process;
+    for (i = 0; i < 2; i++)
+    {
+        new_transfer->file[i].filename = NULL;
+        new_transfer->file[i].stream = NULL;
+    }
+    new_transfer->timeout = timeout;
+    new_transfer->rc = WEECHAT_HOOK_PROCESS_RUNNING;
+    new_transfer->curl_rc = CURLE_OK;
+    new_transfer->output = NULL;
+    new_transfer->output_size = 0;
+    new_transfer->output_alloc = 0;
+    new_transfer->error[0] = '\0';
+
+    new_transfer->prev_transfer = NULL;
+    new_transfer->next_transfer = url_transfers;
+    if (url_transfers)
+        url_transfers->prev_transfer = new_transfer;
+    url_transfers = new_transfer;
+
+    HOOK_PROCESS(hook_process, url_transfer) = new_transfer;
+
+    ptr_url = HOOK_PROCESS(hook_process, command) + 4;
+    while (ptr_url[0] == ' ')
+    {
+        ptr_url++;
+    }
+    if (!ptr_url[0])
+    {
+        weeurl_multi_fail (new_transfer, 1);
+        return 1;
+    }
+
+    new_transfer->curl = curl_easy_init ();
+    if (!new_transfer->curl)
+    {
+        weeurl_multi_fail (new_transfer, 3);
+        return 1;
+    }
+
+    /* set default options */
+    curl_easy_setopt (new_transfer->curl, CURLOPT_URL, ptr_url);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_PRIVATE, new_transfer);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_ERRORBUFFER,
+                      new_transfer->error);
+    if (url_share)
+        curl_easy_setopt (new_transfer->curl, CURLOPT_SHARE, url_share);
+    if (timeout > 0)
+        curl_easy_setopt (new_transfer->curl, CURLOPT_TIMEOUT_MS, timeout);
+
+    /* output sent to the hook callback (if no output file) */
+    curl_easy_setopt (new_transfer->curl, CURLOPT_WRITEFUNCTION,
+                      &weeurl_multi_write_cb);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_WRITEDATA, new_transfer);
+
+    /* set proxy (if option weechat.network.proxy_curl is set) */
+    if (CONFIG_STRING(config_network_proxy_curl)
+        && CONFIG_STRING(config_network_proxy_curl)[0])
+    {
+        ptr_proxy = proxy_search (CONFIG_STRING(config_network_proxy_curl));
+        if (ptr_proxy)
+            weeurl_set_proxy (new_transfer->curl, ptr_proxy);
+    }
+
+    /* set file in/out from options in hashtable */
+    options = HOOK_PROCESS(hook_process, options);
+    if (options)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            new_transfer->file[i].filename = hashtable_get (options,
+                                                            url_file_option[i]);
+            if (new_transfer->file[i].filename)
+            {
+                new_transfer->file[i].stream = fopen (
+                    new_transfer->file[i].filename, url_file_mode[i]);
+                if (!new_transfer->file[i].stream)
+                {
+                    weeurl_multi_fail (new_transfer, 4);
+                    return 1;
+                }
+                curl_easy_setopt (new_transfer->curl, url_file_opt_func[i],
+                                  url_file_opt_cb[i]);
+                curl_easy_setopt (new_transfer->curl, url_file_opt_data[i],
+                                  new_transfer->file[i].stream);
+            }
+        }
+    }
+
+    /* set other options in hashtable */
+    hashtable_map (options, &weeurl_option_map_cb, new_transfer->curl);
+
+    /* start download (done by callbacks of fd/timer hooks) */
+    if (curl_multi_add_handle (url_multi, new_transfer->curl) != CURLM_OK)
+    {
+        curl_easy_cleanup (new_transfer->curl);
+        new_transfer->curl = NULL;
+        weeurl_multi_fail (new_transfer, 3);
+    }
+
+    return 1;
+}
+
+/*
+ * Removes transfer of a process hook (called when the hook is removed).
+ */
+
+void
+weeurl_multi_remove (struct t_hook *hook_process)
+{
+    struct t_url_transfer *transfer;
+    int i;
+
+    transfer = HOOK_PROCESS(hook_process, url_transfer);
+    if (!transfer)
+        return;
+
+    if (transfer->curl)
+    {
+        if (url_multi)
+            curl_multi_remove_handle (url_multi, transfer->curl);
+        curl_easy_cleanup (transfer->curl);
+    }
+    for (i = 0; i < 2; i++)
+    {
+        if (transfer->file[i].stream)
+            fclose (transfer->file[i].stream);
+    }
+    if (transfer->output)
+        free (transfer->output);
+
+    if (transfer->prev_transfer)
+        (transfer->prev_transfer)->next_transfer = transfer->next_transfer;
+    if (transfer->next_transfer)
+        (transfer->next_transfer)->prev_transfer = transfer->prev_transfer;
+    if (url_transfers == transfer)
+        url_transfers = transfer->next_transfer;
+
+    free (transfer);
+
+    HOOK_PROCESS(hook_process, url_transfer) = NULL;
+}
+
+/*
+ * Ends Curl multi interface (called when all hooks have been removed).
+ */
+
+void
+weeurl_multi_end ()
+{
+    if (url_multi_hook_timer)
+    {
+        unhook (url_multi_hook_timer);
+        url_multi_hook_timer = NULL;
+    }
+    if (url_multi_hook_timer_end)
+    {
+        unhook (url_multi_hook_timer_end);
+        url_multi_hook_timer_end = NULL;
+    }
+    if (url_multi)
+    {
+        curl_multi_cleanup (url_multi);
+        url_multi = NULL;
+    }
+    if (url_share)
+    {
+        curl_share_cleanup (url_share);
+        url_share = NULL;
+    }
+}
+
 /*
  * Adds an URL option in an infolist.
  *
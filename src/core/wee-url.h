@@ -20,8 +20,12 @@
 #ifndef WEECHAT_URL_H
 #define WEECHAT_URL_H 1
 
+/* size of error buffer for Curl (CURL_ERROR_SIZE) */
+#define URL_ERROR_SIZE 256
+
 struct t_hashtable;
 struct t_infolist;
+struct t_hook;
 
 enum t_url_type
 {
@@ -51,9 +55,31 @@ struct t_url_file
     FILE *stream;                      /* file stream                       */
 };
 
+/* URL downloaded in WeeChat process (Curl multi interface) */
+
+struct t_url_transfer
+{
+    void *curl;                        /* Curl easy handle                  */
+    struct t_hook *hook_process;       /* process hook with "url:" command  */
+    struct t_url_file file[2];         /* files in/out (from options)       */
+    long timeout;                      /* timeout of hook (ms, 0 = none)    */
+    int rc;                            /* return code (or running)          */
+    int curl_rc;                       /* Curl return code (if rc == 2)     */
+    char *output;                      /* data received, not yet sent to    */
+                                       /* the hook callback                 */
+    int output_size;                   /* size of data in output            */
+    int output_alloc;                  /* allocated size for output         */
+    char error[URL_ERROR_SIZE + 1];    /* error buffer for Curl             */
+    struct t_url_transfer *prev_transfer; /* link to previous transfer      */
+    struct t_url_transfer *next_transfer; /* link to next transfer          */
+};
+
 extern struct t_url_option url_options[];
 
 extern int weeurl_download (const char *url, struct t_hashtable *options);
+extern int weeurl_multi_start (struct t_hook *hook_process, long timeout);
+extern void weeurl_multi_remove (struct t_hook *hook_process);
+extern void weeurl_multi_end ();
 extern int weeurl_option_add_to_infolist (struct t_infolist *infolist,
                                           struct t_url_option *option);
 
@@ -25,6 +25,7 @@
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <wctype.h>
 
@@ -36,6 +37,34 @@
 
 int local_utf8 = 0;
 
+/* constants used to check many bytes at once in a machine word */
+#define UTF8_WORD_ONES  ((unsigned long)-1 / 0xFF)
+#define UTF8_WORD_HIGHS (UTF8_WORD_ONES * 0x80)
+
+/* non-zero if "word" has a byte equal to 0 */
+#define UTF8_WORD_HAS_ZERO(word)                                        \
+    (((word) - UTF8_WORD_ONES) & ~(word) & UTF8_WORD_HIGHS)
+
+/* non-zero if "word" (with only 7-bit bytes) has a byte lower than "n" */
+#define UTF8_WORD_HAS_LESS(word, n)                                     \
+    (((word) - (UTF8_WORD_ONES * (n))) & ~(word) & UTF8_WORD_HIGHS)
+
+/*
+ * reading an aligned word after the end of string is safe, but it is
+ * reported as an error by AddressSanitizer: bytes are checked one by one
+ * when it is enabled
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define UTF8_CHECK_WORDS 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define UTF8_CHECK_WORDS 0
+#endif
+#endif
+#ifndef UTF8_CHECK_WORDS
+#define UTF8_CHECK_WORDS 1
+#endif
+
 
 /*
  * Initializes UTF-8 in WeeChat.
@@ -47,6 +76,73 @@ utf8_init ()
     local_utf8 = (string_strcasecmp (weechat_local_charset, "UTF-8") == 0);
 }
 
+/*
+ * Returns the number of 7-bit chars at beginning of string (stops on first
+ * 8-bit char or end of string).
+ *
+ * If printable == 1, the function stops on first char which is not printable
+ * (a control char: lower than 32 or equal to 127).
+ *
+ * Bytes are checked by machine words, so this is much faster than a loop on
+ * each byte for long strings with only 7-bit chars.
+ */
+
+int
+utf8_ascii_length (const char *string, int printable)
+{
+    const char *ptr_string;
+#if UTF8_CHECK_WORDS
+    unsigned long word;
+#endif
+
+    if (!string)
+        return 0;
+
+    ptr_string = string;
+
+#if UTF8_CHECK_WORDS
+    /* check bytes one by one until pointer is aligned on a word */
+    while (((uintptr_t)ptr_string) % sizeof (unsigned long) != 0)
+    {
+        if (!ptr_string[0] || ((unsigned char)ptr_string[0] >= 0x80)
+            || (printable && (((unsigned char)ptr_string[0] < 32)
+                              || (ptr_string[0] == 127))))
+        {
+            return ptr_string - string;
+        }
+        ptr_string++;
+    }
+
+    /*
+     * check words: an aligned word can not cross a page boundary, so it's
+     * safe to read a full word, even if the string ends inside
+     */
+    while (1)
+    {
+        memcpy (&word, ptr_string, sizeof (word));
+        if ((word & UTF8_WORD_HIGHS) || UTF8_WORD_HAS_ZERO(word))
+            break;
+        if (printable
+            && (UTF8_WORD_HAS_LESS(word, 32)
+                || UTF8_WORD_HAS_ZERO(word ^ (UTF8_WORD_ONES * 127))))
+        {
+            break;
+        }
+        ptr_string += sizeof (word);
+    }
+#endif
+
+    /* find the exact position in last word */
+    while (ptr_string[0] && ((unsigned char)ptr_string[0] < 0x80)
+           && (!printable || (((unsigned char)ptr_string[0] >= 32)
+                              && (ptr_string[0] != 127))))
+    {
+        ptr_string++;
+    }
+
+    return ptr_string - string;
+}
+
 /*
  * Checks if a string has some 8-bit chars.
  *
@@ -58,13 +154,10 @@ utf8_init ()
 int
 utf8_has_8bits (const char *string)
 {
-    while (string && string[0])
-    {
-        if (string[0] & 0x80)
-            return 1;
-        string++;
-    }
-    return 0;
+    if (!string)
+        return 0;
+
+    return (string[utf8_ascii_length (string, 0)]) ? 1 : 0;
 }
 
 /*
@@ -82,13 +175,23 @@ utf8_has_8bits (const char *string)
 int
 utf8_is_valid (const char *string, int length, char **error)
 {
-    int code_point, current_char;
+    int code_point, current_char, ascii_length;
 
     current_char = 0;
 
     while (string && string[0]
            && ((length <= 0) || (current_char < length)))
     {
+        /* skip quickly all 7-bit chars */
+        if ((unsigned char)(string[0]) < 0x80)
+        {
+            ascii_length = utf8_ascii_length (string, 0);
+            if ((length > 0) && (ascii_length > length - current_char))
+                ascii_length = length - current_char;
+            string += ascii_length;
+            current_char += ascii_length;
+            continue;
+        }
         /*
          * UTF-8, 2 bytes, should be: 110vvvvv 10vvvvvv
          * and in range: U+0080 - U+07FF
@@ -143,11 +246,9 @@ utf8_is_valid (const char *string, int length, char **error)
                 goto invalid;
             string += 4;
         }
-        /* UTF-8, 1 byte, should be: 0vvvvvvv */
-        else if ((unsigned char)(string[0]) >= 0x80)
-            goto invalid;
+        /* UTF-8, 1 byte, should be: 0vvvvvvv (already skipped above) */
         else
-            string++;
+            goto invalid;
         current_char++;
     }
     if (error)
@@ -441,7 +542,7 @@ utf8_char_size (const char *string)
 int
 utf8_strlen (const char *string)
 {
-    int length;
+    int length, ascii_length;
 
     if (!string)
         return 0;
@@ -449,6 +550,14 @@ utf8_strlen (const char *string)
     length = 0;
     while (string && string[0])
     {
+        /* count quickly all 7-bit chars */
+        ascii_length = utf8_ascii_length (string, 0);
+        if (ascii_length > 0)
+        {
+            string += ascii_length;
+            length += ascii_length;
+            continue;
+        }
         string = utf8_next_char (string);
         length++;
     }
@@ -496,6 +605,11 @@ utf8_strlen_screen (const char *string)
     if (!string || !string[0])
         return 0;
 
+    /* optimization for printable 7-bit chars: 1 char == 1 column */
+    length = utf8_ascii_length (string, 1);
+    if (!string[length])
+        return length;
+
     if (!local_utf8)
         return utf8_strlen (string);
 
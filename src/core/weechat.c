@@ -40,6 +40,7 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -47,25 +48,30 @@
 #include <sys/time.h>
 #include <time.h>
 #include <signal.h>
+#include <unistd.h>
 
 #ifdef HAVE_LANGINFO_CODESET
 #include <langinfo.h>
 #endif
 
 #include "weechat.h"
+#include "wee-async.h"
 #include "wee-command.h"
 #include "wee-completion.h"
 #include "wee-config.h"
 #include "wee-debug.h"
 #include "wee-eval.h"
+#include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-log.h"
 #include "wee-network.h"
 #include "wee-proxy.h"
 #include "wee-secure.h"
+#include "wee-spawn.h"
 #include "wee-string.h"
 #include "wee-upgrade.h"
+#include "wee-url.h"
 #include "wee-utf8.h"
 #include "wee-util.h"
 #include "wee-version.h"
@@ -75,10 +81,13 @@
 #include "../gui/gui-key.h"
 #include "../gui/gui-layout.h"
 #include "../gui/gui-main.h"
+#include "../gui/gui-search.h"
 #include "../plugins/plugin.h"
 #include "../plugins/plugin-api.h"
 
 
+int weechat_headless = 0;              /* =1 if running headless (no GUI)   */
+int weechat_daemon = 0;                /* =1 if daemon (no std fd used)     */
 int weechat_debug_core = 0;            /* debug level for core              */
 char *weechat_argv0 = NULL;            /* WeeChat binary file name (argv[0])*/
 int weechat_upgrading = 0;             /* =1 if WeeChat is upgrading        */
@@ -102,6 +111,7 @@ int weechat_no_gnutls = 0;             /* remove init/deinit of gnutls      */
 int weechat_no_gcrypt = 0;             /* remove init/deinit of gcrypt      */
                                        /* (useful with valgrind)            */
 char *weechat_startup_commands = NULL; /* startup commands (-r flag)        */
+int weechat_profile_startup = 0;       /* display time spent in startup     */
 
 
 /*
@@ -144,6 +154,10 @@ weechat_display_usage (char *exec_name)
         _("  -a, --no-connect         disable auto-connect to servers at "
           "startup\n"
           "  -c, --colors             display default colors in terminal\n"
+          "      --daemon             run WeeChat as a daemon (fork, new "
+          "process group,\n"
+          "                           file descriptors closed); works only "
+          "with weechat-headless\n"
           "  -d, --dir <path>         set WeeChat home directory "
           "(default: ~/.weechat)\n"
           "                           (environment variable WEECHAT_HOME is "
@@ -151,6 +165,8 @@ weechat_display_usage (char *exec_name)
           "  -h, --help               display this help\n"
           "  -l, --license            display WeeChat license\n"
           "  -p, --no-plugin          don't load any plugin at startup\n"
+          "      --profile-startup    display time spent in each phase of "
+          "startup\n"
           "  -r, --run-command <cmd>  run command(s) after startup\n"
           "                           (many commands can be separated by "
           "semicolons)\n"
@@ -188,6 +204,12 @@ weechat_parse_args (int argc, char *argv[])
             gui_color_display_terminal_colors ();
             weechat_shutdown (EXIT_SUCCESS, 0);
         }
+        else if (strcmp (argv[i], "--daemon") == 0)
+        {
+            /* ignored if not running headless (a terminal is needed) */
+            if (weechat_headless)
+                weechat_daemon = 1;
+        }
         else if ((strcmp (argv[i], "-d") == 0)
             || (strcmp (argv[i], "--dir") == 0))
         {
@@ -255,6 +277,10 @@ weechat_parse_args (int argc, char *argv[])
         {
             weechat_auto_load_plugins = 0;
         }
+        else if (strcmp (argv[i], "--profile-startup") == 0)
+        {
+            weechat_profile_startup = 1;
+        }
         else if ((strcmp (argv[i], "-r") == 0)
                  || (strcmp (argv[i], "--run-command") == 0))
         {
@@ -286,6 +312,49 @@ weechat_parse_args (int argc, char *argv[])
     }
 }
 
+/*
+ * Runs WeeChat in background: forks (the parent process exits), starts a new
+ * session and redirects standard input/output/error to /dev/null.
+ */
+
+void
+weechat_daemonize ()
+{
+    pid_t pid;
+    int fd, i;
+
+    string_fprintf (stdout, _("Running WeeChat in background...\n"));
+    fflush (stdout);
+
+    pid = fork ();
+    if (pid < 0)
+    {
+        string_fprintf (stderr,
+                        _("Error: unable to fork (%s)\n"),
+                        strerror (errno));
+        weechat_shutdown (EXIT_FAILURE, 0);
+    }
+    if (pid > 0)
+    {
+        /* parent process: the daemon is running, just exit */
+        exit (EXIT_SUCCESS);
+    }
+
+    /* child process: detach from terminal */
+    setsid ();
+
+    fd = open ("/dev/null", O_RDWR);
+    if (fd >= 0)
+    {
+        for (i = STDIN_FILENO; i <= STDERR_FILENO; i++)
+        {
+            dup2 (fd, i);
+        }
+        if (fd > STDERR_FILENO)
+            close (fd);
+    }
+}
+
 /*
  * Expands and assigns given path to "weechat_home".
  */
@@ -607,8 +676,12 @@ weechat_shutdown (int return_code, int crash)
 void
 weechat_init (int argc, char *argv[], void (*gui_init_cb)())
 {
+    struct timeval time_phase;
+
     weechat_first_start_time = time (NULL); /* initialize start time        */
     gettimeofday (&weechat_current_start_timeval, NULL);
+    time_phase = weechat_current_start_timeval;
+    debug_startup_start ();             /* record time of startup phases    */
 
     weechat_locale_ok = (setlocale (LC_ALL, "") != NULL);   /* init gettext */
 #ifdef ENABLE_NLS
@@ -635,6 +708,7 @@ weechat_init (int argc, char *argv[], void (*gui_init_cb)())
 
     hdata_init ();                      /* initialize hdata                 */
     hook_init ();                       /* initialize hooks                 */
+    async_init ();                      /* initialize queue of async events */
     debug_init ();                      /* hook signals for debug           */
     gui_color_init ();                  /* initialize colors                */
     gui_chat_init ();                   /* initialize chat                  */
@@ -647,33 +721,49 @@ weechat_init (int argc, char *argv[], void (*gui_init_cb)())
     if (!config_weechat_init ())        /* init WeeChat options (weechat.*) */
         weechat_shutdown (EXIT_FAILURE, 0);
     weechat_parse_args (argc, argv);    /* parse command line args          */
+    if (weechat_daemon)
+        weechat_daemonize ();           /* run in background                */
+    debug_startup_time ("core init", 0, &time_phase);
     weechat_create_home_dir ();         /* create WeeChat home directory    */
     log_init ();                        /* init log file                    */
     plugin_api_init ();                 /* create some hooks (info,hdata,..)*/
+    debug_startup_time ("home, log", 0, &time_phase);
     secure_read ();                     /* read secured data options        */
     config_weechat_read ();             /* read WeeChat options             */
+    spawn_init ();                      /* start spawn helper (after config)*/
+    debug_startup_time ("config read, spawn", 0, &time_phase);
     network_init_gnutls ();             /* init GnuTLS                      */
+    debug_startup_time ("gnutls init", 0, &time_phase);
 
     if (gui_init_cb)
         (*gui_init_cb) ();              /* init WeeChat interface           */
+    debug_startup_time ("gui init", 0, &time_phase);
 
     if (weechat_upgrading)
     {
         upgrade_weechat_load ();        /* upgrade with session file        */
         weechat_upgrade_count++;        /* increase /upgrade count          */
+        debug_startup_time ("upgrade load", 0, &time_phase);
     }
     weechat_startup_message ();         /* display WeeChat startup message  */
     gui_chat_print_lines_waiting_buffer (NULL); /* display lines waiting    */
-    weechat_term_check ();              /* warning about wrong $TERM        */
+    if (!weechat_headless)
+        weechat_term_check ();          /* warning about wrong $TERM        */
     weechat_locale_check ();            /* warning about wrong locale       */
     command_startup (0);                /* command executed before plugins  */
+    debug_startup_time ("startup message, commands", 0, &time_phase);
     plugin_init (weechat_auto_load_plugins, /* init plugin interface(s)     */
                  argc, argv);
+    debug_startup_time ("plugins", 0, &time_phase);
     command_startup (1);                /* commands executed after plugins  */
+    debug_startup_time ("commands after plugins", 0, &time_phase);
     if (!weechat_upgrading)
         gui_layout_window_apply (gui_layout_current, -1);
     if (weechat_upgrading)
         upgrade_weechat_end ();         /* remove .upgrade files + signal   */
+    debug_startup_time ((weechat_upgrading) ? "upgrade end" : "layout", 0,
+                        &time_phase);
+    debug_startup_end (weechat_profile_startup); /* display startup times   */
 }
 
 /*
@@ -684,6 +774,7 @@ void
 weechat_end (void (*gui_end_cb)(int clean_exit))
 {
     gui_layout_store_on_exit ();        /* store layout                     */
+    gui_search_end ();                  /* stop search in buffers           */
     plugin_end ();                      /* end plugin interface(s)          */
     if (CONFIG_BOOLEAN(config_look_save_config_on_exit))
         (void) config_weechat_write (); /* save WeeChat config file         */
@@ -697,8 +788,14 @@ weechat_end (void (*gui_end_cb)(int clean_exit))
     secure_free ();                     /* free secured data options        */
     config_file_free_all ();            /* free all configuration files     */
     gui_key_end ();                     /* remove all keys                  */
+    async_end ();                       /* discard async events             */
     unhook_all ();                      /* remove all hooks                 */
+    weeurl_multi_end ();                /* end Curl multi interface         */
+    completion_end ();                  /* free completion data             */
+    spawn_end ();                       /* stop spawn helper process        */
+    eval_end ();                        /* end eval                         */
     hdata_end ();                       /* end hdata                        */
+    hashtable_end ();                   /* free pool of hashtables          */
     secure_end ();                      /* end secured data                 */
     string_end ();                      /* end string                       */
     weechat_shutdown (-1, 0);           /* end other things                 */
@@ -94,6 +94,8 @@
 #define WEECHAT_INTERNAL_CHARSET "UTF-8"
 
 /* global variables and functions */
+extern int weechat_headless;
+extern int weechat_daemon;
 extern int weechat_debug_core;
 extern char *weechat_argv0;
 extern int weechat_upgrading;
@@ -109,6 +111,7 @@ extern int weechat_plugin_no_dlclose;
 extern int weechat_no_gnutls;
 extern int weechat_no_gcrypt;
 extern char *weechat_startup_commands;
+extern int weechat_profile_startup;
 
 extern void weechat_term_check ();
 extern void weechat_shutdown (int return_code, int crash);
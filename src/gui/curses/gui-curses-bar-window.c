@@ -64,6 +64,10 @@ gui_bar_window_objects_init (struct t_gui_bar_window *bar_window)
         bar_window->gui_objects = new_objects;
         GUI_BAR_WINDOW_OBJECTS(bar_window)->win_bar = NULL;
         GUI_BAR_WINDOW_OBJECTS(bar_window)->win_separator = NULL;
+        GUI_BAR_WINDOW_OBJECTS(bar_window)->content_drawn = 0;
+        GUI_BAR_WINDOW_OBJECTS(bar_window)->content = NULL;
+        GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_x = 0;
+        GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_y = 0;
         return 1;
     }
     return 0;
@@ -89,6 +93,12 @@ gui_bar_window_objects_free (struct t_gui_bar_window *bar_window)
         delwin (GUI_BAR_WINDOW_OBJECTS(bar_window)->win_separator);
         GUI_BAR_WINDOW_OBJECTS(bar_window)->win_separator = NULL;
     }
+    if (GUI_BAR_WINDOW_OBJECTS(bar_window)->content)
+    {
+        free (GUI_BAR_WINDOW_OBJECTS(bar_window)->content);
+        GUI_BAR_WINDOW_OBJECTS(bar_window)->content = NULL;
+    }
+    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_drawn = 0;
 }
 
 /*
@@ -115,6 +125,9 @@ gui_bar_window_create_win (struct t_gui_bar_window *bar_window)
         GUI_BAR_WINDOW_OBJECTS(bar_window)->win_separator = NULL;
     }
 
+    /* new window is empty: content must be drawn again */
+    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_drawn = 0;
+
     if ((bar_window->x >= 0) && (bar_window->y >= 0))
     {
         GUI_BAR_WINDOW_OBJECTS(bar_window)->win_bar = newwin (bar_window->height,
@@ -400,6 +413,35 @@ gui_bar_window_print_string (struct t_gui_bar_window *bar_window,
     return 1;
 }
 
+/*
+ * Checks if a content is the same as the one already drawn in curses window
+ * of bar (with same scroll).
+ *
+ * Returns:
+ *   1: content is already drawn
+ *   0: content must be drawn
+ */
+
+int
+gui_bar_window_content_is_drawn (struct t_gui_bar_window *bar_window,
+                                 const char *content)
+{
+    const char *ptr_content;
+
+    if (!GUI_BAR_WINDOW_OBJECTS(bar_window)->content_drawn
+        || (GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_x != bar_window->scroll_x)
+        || (GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_y != bar_window->scroll_y))
+    {
+        return 0;
+    }
+
+    ptr_content = GUI_BAR_WINDOW_OBJECTS(bar_window)->content;
+    if (!ptr_content || !content)
+        return (!ptr_content && !content) ? 1 : 0;
+
+    return (strcmp (ptr_content, content) == 0) ? 1 : 0;
+}
+
 /*
  * Draws a bar for a window.
  */
@@ -423,6 +465,7 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
     int diff, max_length, optimal_number_of_lines;
     int some_data_not_displayed;
     int index_item, index_subitem, index_line;
+    int first_line, total_lines;
 
     if (!gui_init_ok)
         return;
@@ -453,6 +496,25 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
                   GUI_COLOR_BAR_MOVE_CURSOR_CHAR);
     }
 
+    filling = gui_bar_get_filling (bar_window->bar);
+
+    content = gui_bar_window_content_get_with_filling (bar_window, window);
+    if (content)
+        utf8_normalize (content, '?');
+
+    /*
+     * skip draw if the content is the same as the one already drawn in
+     * the curses window (except if the cursor is moved by an item, like
+     * input_text)
+     */
+    if (gui_bar_window_content_is_drawn (bar_window, content)
+        && (!content || !strstr (content, str_cursor)))
+    {
+        if (content)
+            free (content);
+        return;
+    }
+
     /*
      * these values will be overwritten later (by gui_bar_window_print_string)
      * if cursor has to move somewhere in bar window
@@ -468,12 +530,8 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
 
     gui_window_current_emphasis = 0;
 
-    filling = gui_bar_get_filling (bar_window->bar);
-
-    content = gui_bar_window_content_get_with_filling (bar_window, window);
     if (content)
     {
-        utf8_normalize (content, '?');
         if ((filling == GUI_BAR_FILLING_HORIZONTAL)
             && (bar_window->scroll_x > 0))
         {
@@ -522,6 +580,11 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
                         num_lines = 1;
                     optimal_number_of_lines += num_lines;
                 }
+                if ((bar_window->virtual_start >= 0)
+                    && (bar_window->virtual_max_length > max_length))
+                {
+                    max_length = bar_window->virtual_max_length;
+                }
                 if (max_length == 0)
                     max_length = 1;
 
@@ -552,12 +615,26 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
             x = 0;
             y = 0;
             some_data_not_displayed = 0;
-            if ((bar_window->scroll_y > 0)
-                && (bar_window->scroll_y > items_count - bar_window->height))
+            if (bar_window->virtual_start >= 0)
             {
-                bar_window->scroll_y = items_count - bar_window->height;
-                if (bar_window->scroll_y < 0)
-                    bar_window->scroll_y = 0;
+                /*
+                 * virtual content: it starts at line "scroll_y" (already
+                 * checked when content was built)
+                 */
+                first_line = 0;
+                total_lines = bar_window->items_num_lines[0][0];
+            }
+            else
+            {
+                if ((bar_window->scroll_y > 0)
+                    && (bar_window->scroll_y > items_count - bar_window->height))
+                {
+                    bar_window->scroll_y = items_count - bar_window->height;
+                    if (bar_window->scroll_y < 0)
+                        bar_window->scroll_y = 0;
+                }
+                first_line = bar_window->scroll_y;
+                total_lines = items_count;
             }
             for (line = 0;
                  (line < items_count) && (y < bar_window->height);
@@ -638,8 +715,7 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
                     }
                 }
 
-                if ((bar_window->scroll_y == 0)
-                    || (line >= bar_window->scroll_y))
+                if (line >= first_line)
                 {
                     if (!gui_bar_window_print_string (bar_window, filling,
                                                       &x, &y,
@@ -709,7 +785,8 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
                 }
             }
             if ((bar_window->cursor_x < 0) && (bar_window->cursor_y < 0)
-                && (some_data_not_displayed || (line < items_count)))
+                && (some_data_not_displayed
+                    || (bar_window->scroll_y - first_line + line < total_lines)))
             {
                 ptr_string = (filling == GUI_BAR_FILLING_HORIZONTAL) ?
                     CONFIG_STRING(config_look_bar_more_right) :
@@ -731,7 +808,6 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
         }
         if (items)
             string_free_split (items);
-        free (content);
     }
     else
     {
@@ -803,6 +879,14 @@ gui_bar_window_draw (struct t_gui_bar_window *bar_window,
         wnoutrefresh (GUI_BAR_WINDOW_OBJECTS(bar_window)->win_separator);
     }
 
+    /* save content drawn (to compare with next content) */
+    if (GUI_BAR_WINDOW_OBJECTS(bar_window)->content)
+        free (GUI_BAR_WINDOW_OBJECTS(bar_window)->content);
+    GUI_BAR_WINDOW_OBJECTS(bar_window)->content = content;
+    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_drawn = 1;
+    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_x = bar_window->scroll_x;
+    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_y = bar_window->scroll_y;
+
     refresh ();
 }
 
@@ -816,4 +900,8 @@ gui_bar_window_objects_print_log (struct t_gui_bar_window *bar_window)
     log_printf ("    bar window specific objects for Curses:");
     log_printf ("      win_bar. . . . . . . : 0x%lx", GUI_BAR_WINDOW_OBJECTS(bar_window)->win_bar);
     log_printf ("      win_separator. . . . : 0x%lx", GUI_BAR_WINDOW_OBJECTS(bar_window)->win_separator);
+    log_printf ("      content_drawn. . . . : %d",    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_drawn);
+    log_printf ("      content. . . . . . . : '%s'",  GUI_BAR_WINDOW_OBJECTS(bar_window)->content);
+    log_printf ("      content_scroll_x . . : %d",    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_x);
+    log_printf ("      content_scroll_y . . : %d",    GUI_BAR_WINDOW_OBJECTS(bar_window)->content_scroll_y);
 }
@@ -1221,100 +1221,25 @@ gui_chat_display_time_to_prefix (struct t_gui_window *window,
 }
 
 /*
- * Displays a line in the chat window.
- *
- * If count == 0, display whole line.
- * If count > 0, display 'count' lines (beginning from the end).
- * If simulate == 1, nothing is displayed (for counting how many lines would
- * have been displayed).
- *
- * Returns number of lines displayed (or simulated).
+ * Displays time, prefix and message of a line (without day change messages
+ * and read marker).
  */
 
-int
-gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
-                       int count, int simulate)
+void
+gui_chat_display_line_message (struct t_gui_window *window,
+                               struct t_gui_line *line,
+                               int num_lines, int count,
+                               int pre_lines_displayed, int *lines_displayed,
+                               int simulate)
 {
-    int num_lines, x, y, pre_lines_displayed, lines_displayed, line_align;
-    int read_marker_x, read_marker_y;
-    int word_start_offset, word_end_offset;
+    int line_align, word_start_offset, word_end_offset;
     int word_length_with_spaces, word_length;
     char *message_with_tags, *message_with_search;
     const char *ptr_data, *ptr_end_offset, *ptr_style, *next_char;
-    struct t_gui_line *ptr_prev_line, *ptr_next_line;
-    struct tm local_time, local_time2;
-    struct timeval tv_time;
-    time_t seconds, *ptr_time;
-
-    if (!line)
-        return 0;
-
-    if (simulate)
-    {
-        x = window->win_chat_cursor_x;
-        y = window->win_chat_cursor_y;
-        window->win_chat_cursor_x = 0;
-        window->win_chat_cursor_y = 0;
-        num_lines = 0;
-    }
-    else
-    {
-        if (window->win_chat_cursor_y > window->win_chat_height - 1)
-            return 0;
-        x = window->win_chat_cursor_x;
-        y = window->win_chat_cursor_y;
-        num_lines = gui_chat_display_line (window, line, 0, 1);
-        window->win_chat_cursor_x = x;
-        window->win_chat_cursor_y = y;
-        gui_window_current_emphasis = 0;
-    }
-
-    pre_lines_displayed = 0;
-    lines_displayed = 0;
-
-    /* display message before first line of buffer if date is not today */
-    if ((line->data->date != 0)
-        && CONFIG_BOOLEAN(config_look_day_change)
-        && window->buffer->day_change)
-    {
-        ptr_time = NULL;
-        ptr_prev_line = gui_line_get_prev_displayed (line);
-        if (ptr_prev_line)
-        {
-            while (ptr_prev_line && (ptr_prev_line->data->date == 0))
-            {
-                ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
-            }
-        }
-        if (!ptr_prev_line)
-        {
-            gettimeofday (&tv_time, NULL);
-            seconds = tv_time.tv_sec;
-            localtime_r (&seconds, &local_time);
-            localtime_r (&line->data->date, &local_time2);
-            if ((local_time.tm_mday != local_time2.tm_mday)
-                || (local_time.tm_mon != local_time2.tm_mon)
-                || (local_time.tm_year != local_time2.tm_year))
-            {
-                gui_chat_display_day_changed (window, NULL, &local_time2,
-                                              simulate);
-                gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
-                pre_lines_displayed++;
-            }
-        }
-    }
-
-    /* calculate marker position (maybe not used for this line!) */
-    if (window->buffer->time_for_each_line && line->data->str_time)
-        read_marker_x = x + gui_chat_strlen_screen (line->data->str_time);
-    else
-        read_marker_x = x;
-    read_marker_y = y;
 
     /* display time and prefix */
     gui_chat_display_time_to_prefix (window, line, num_lines, count,
-                                     pre_lines_displayed, &lines_displayed,
+                                     pre_lines_displayed, lines_displayed,
                                      simulate);
     if (!simulate && !gui_chat_display_tags)
     {
@@ -1390,13 +1315,13 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
             if (word_length >= 0)
             {
                 line_align = gui_line_get_align (window->buffer, line, 1,
-                                                 (lines_displayed == 0) ? 1 : 0);
+                                                 (*lines_displayed == 0) ? 1 : 0);
                 if ((window->win_chat_cursor_x + word_length_with_spaces > gui_chat_get_real_width (window))
                     && (word_length <= gui_chat_get_real_width (window) - line_align))
                 {
                     /* spaces + word too long for current line but OK for next line */
                     gui_chat_display_new_line (window, num_lines, count,
-                                               &lines_displayed, simulate);
+                                               lines_displayed, simulate);
                     /* apply styles before jumping to start of word */
                     if (!simulate && (word_start_offset > 0))
                     {
@@ -1422,7 +1347,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
                 gui_chat_display_word (window, line, ptr_data,
                                        ptr_end_offset + 1,
                                        0, num_lines, count,
-                                       pre_lines_displayed, &lines_displayed,
+                                       pre_lines_displayed, lines_displayed,
                                        simulate,
                                        CONFIG_BOOLEAN(config_look_color_inactive_message),
                                        0);
@@ -1455,7 +1380,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
             else
             {
                 gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
+                                           lines_displayed, simulate);
                 ptr_data = NULL;
             }
         }
@@ -1464,13 +1389,150 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     {
         /* no message */
         gui_chat_display_new_line (window, num_lines, count,
-                                   &lines_displayed, simulate);
+                                   lines_displayed, simulate);
     }
 
     if (message_with_tags)
         free (message_with_tags);
     if (message_with_search)
         free (message_with_search);
+}
+
+/*
+ * Checks if the layout cached in line can be used to simulate display of
+ * time, prefix and message with this width of chat area and alignment.
+ *
+ * Returns:
+ *   1: cached layout is valid
+ *   0: cached layout is obsolete (or not computed)
+ */
+
+int
+gui_chat_line_layout_is_valid (struct t_gui_line *line, int width, int align)
+{
+    return ((line->layout_generation == gui_chat_layout_generation)
+            && (line->layout_width == width)
+            && (line->layout_align == align)) ? 1 : 0;
+}
+
+/*
+ * Displays a line in the chat window.
+ *
+ * If count == 0, display whole line.
+ * If count > 0, display 'count' lines (beginning from the end).
+ * If simulate == 1, nothing is displayed (for counting how many lines would
+ * have been displayed).
+ *
+ * Returns number of lines displayed (or simulated).
+ */
+
+int
+gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
+                       int count, int simulate)
+{
+    int num_lines, x, y, pre_lines_displayed, lines_displayed;
+    int read_marker_x, read_marker_y, layout_width, layout_align;
+    struct t_gui_line *ptr_prev_line, *ptr_next_line;
+    struct tm local_time, local_time2;
+    struct timeval tv_time;
+    time_t seconds, *ptr_time;
+
+    if (!line)
+        return 0;
+
+    if (simulate)
+    {
+        x = window->win_chat_cursor_x;
+        y = window->win_chat_cursor_y;
+        window->win_chat_cursor_x = 0;
+        window->win_chat_cursor_y = 0;
+        num_lines = 0;
+    }
+    else
+    {
+        if (window->win_chat_cursor_y > window->win_chat_height - 1)
+            return 0;
+        x = window->win_chat_cursor_x;
+        y = window->win_chat_cursor_y;
+        num_lines = gui_chat_display_line (window, line, 0, 1);
+        window->win_chat_cursor_x = x;
+        window->win_chat_cursor_y = y;
+        gui_window_current_emphasis = 0;
+    }
+
+    pre_lines_displayed = 0;
+    lines_displayed = 0;
+
+    /* display message before first line of buffer if date is not today */
+    if ((line->data->date != 0)
+        && CONFIG_BOOLEAN(config_look_day_change)
+        && window->buffer->day_change)
+    {
+        ptr_time = NULL;
+        ptr_prev_line = gui_line_get_prev_displayed (line);
+        if (ptr_prev_line)
+        {
+            while (ptr_prev_line && (ptr_prev_line->data->date == 0))
+            {
+                ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
+            }
+        }
+        if (!ptr_prev_line)
+        {
+            gettimeofday (&tv_time, NULL);
+            seconds = tv_time.tv_sec;
+            localtime_r (&seconds, &local_time);
+            localtime_r (&line->data->date, &local_time2);
+            if ((local_time.tm_mday != local_time2.tm_mday)
+                || (local_time.tm_mon != local_time2.tm_mon)
+                || (local_time.tm_year != local_time2.tm_year))
+            {
+                gui_chat_display_day_changed (window, NULL, &local_time2,
+                                              simulate);
+                gui_chat_display_new_line (window, num_lines, count,
+                                           &lines_displayed, simulate);
+                pre_lines_displayed++;
+            }
+        }
+    }
+
+    /* calculate marker position (maybe not used for this line!) */
+    if (window->buffer->time_for_each_line && line->data->str_time)
+        read_marker_x = x + gui_chat_strlen_screen (line->data->str_time);
+    else
+        read_marker_x = x;
+    read_marker_y = y;
+
+    /*
+     * display time, prefix and message; in simulation mode, the number of
+     * lines is cached in line, so that scrolling does not wrap again all
+     * the lines that did not change
+     */
+    if (simulate && (pre_lines_displayed == 0))
+    {
+        layout_width = gui_chat_get_real_width (window);
+        layout_align = gui_line_get_align (window->buffer, line, 1, 1);
+        if (gui_chat_line_layout_is_valid (line, layout_width, layout_align))
+        {
+            lines_displayed += line->layout_lines;
+        }
+        else
+        {
+            gui_chat_display_line_message (window, line, num_lines, count,
+                                           pre_lines_displayed,
+                                           &lines_displayed, simulate);
+            line->layout_generation = gui_chat_layout_generation;
+            line->layout_width = layout_width;
+            line->layout_align = layout_align;
+            line->layout_lines = lines_displayed;
+        }
+    }
+    else
+    {
+        gui_chat_display_line_message (window, line, num_lines, count,
+                                       pre_lines_displayed, &lines_displayed,
+                                       simulate);
+    }
 
     /* display message if day has changed after this line */
     if ((line->data->date != 0)
@@ -1716,6 +1778,175 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
     }
 }
 
+/*
+ * Saves state of chat window when end of buffer is displayed on all lines of
+ * chat, so that lines added later can be displayed by scrolling the chat (see
+ * function gui_chat_draw_lines_added).
+ */
+
+void
+gui_chat_bottom_save (struct t_gui_window *window)
+{
+    struct t_gui_window_chat_bottom *bottom;
+    struct t_gui_lines *lines;
+
+    bottom = &(GUI_WINDOW_OBJECTS(window)->chat_bottom);
+    lines = window->buffer->lines;
+
+    bottom->last_line = gui_line_get_last_displayed (window->buffer);
+    if (!bottom->last_line)
+    {
+        bottom->valid = 0;
+        return;
+    }
+
+    bottom->valid = 1;
+    bottom->buffer = window->buffer;
+    bottom->lines = lines;
+    bottom->last_line_id = bottom->last_line->id;
+    bottom->last_line_rows = gui_chat_display_line (window, bottom->last_line,
+                                                    0, 1);
+    bottom->next_line_id = lines->next_line_id;
+    bottom->last_read_line = lines->last_read_line;
+    bottom->first_line_not_read = lines->first_line_not_read;
+    bottom->prefix_max_length = lines->prefix_max_length;
+    bottom->buffer_max_length = lines->buffer_max_length;
+    bottom->layout_generation = gui_chat_layout_generation;
+    bottom->width = window->win_chat_width;
+    bottom->height = window->win_chat_height;
+    bottom->current_window = (window == gui_current_window) ? 1 : 0;
+}
+
+/*
+ * Displays lines added at the end of buffer by scrolling the chat window: only
+ * the new lines are drawn, so that the terminal can scroll the chat area
+ * instead of receiving again all the lines displayed.
+ *
+ * This is possible only if the end of buffer was displayed on all lines of
+ * chat (see function gui_chat_bottom_save) and if lines added at the end of
+ * buffer are the only change since this display (same prefix alignment,
+ * filters, read marker, size of chat, ...).
+ *
+ * Returns:
+ *   1: lines added have been displayed
+ *   0: chat must be fully redrawn
+ */
+
+int
+gui_chat_draw_lines_added (struct t_gui_window *window)
+{
+    struct t_gui_window_chat_bottom *bottom;
+    struct t_gui_lines *lines;
+    struct t_gui_line *ptr_line, *ptr_first_new_line, *ptr_top_line;
+    unsigned long long count;
+    int i, rows, top_line_pos;
+
+    bottom = &(GUI_WINDOW_OBJECTS(window)->chat_bottom);
+    lines = window->buffer->lines;
+    if (!bottom->valid
+        || (bottom->buffer != window->buffer)
+        || (bottom->lines != lines)
+        || (window->buffer->type != GUI_BUFFER_TYPE_FORMATTED)
+        || (window->buffer->text_search != GUI_TEXT_SEARCH_DISABLED)
+        || window->scroll->start_line
+        || (bottom->width != window->win_chat_width)
+        || (bottom->height != window->win_chat_height)
+        || !window->coords
+        || (window->coords_size != window->win_chat_height)
+        || (bottom->layout_generation != gui_chat_layout_generation)
+        || (bottom->current_window != ((window == gui_current_window) ? 1 : 0))
+        || (bottom->prefix_max_length != lines->prefix_max_length)
+        || (bottom->buffer_max_length != lines->buffer_max_length)
+        || (bottom->last_read_line != lines->last_read_line)
+        || (bottom->first_line_not_read != lines->first_line_not_read)
+        || (lines->next_line_id <= bottom->next_line_id))
+    {
+        return 0;
+    }
+
+    /*
+     * all lines after the last line displayed must be new lines (no line
+     * inserted before, no line removed)
+     */
+    count = 0;
+    ptr_line = lines->last_line;
+    while (ptr_line && (ptr_line != bottom->last_line))
+    {
+        if (ptr_line->id < bottom->next_line_id)
+            return 0;
+        count++;
+        ptr_line = ptr_line->prev_line;
+    }
+    if (!ptr_line
+        || (ptr_line->id != bottom->last_line_id)
+        || !ptr_line->data->displayed
+        || (count != lines->next_line_id - bottom->next_line_id))
+    {
+        return 0;
+    }
+
+    /*
+     * last line displayed must have same number of rows (a read marker or a
+     * day change may be displayed after it now)
+     */
+    if (gui_chat_display_line (window, ptr_line, 0, 1) != bottom->last_line_rows)
+        return 0;
+
+    /* count rows of new lines (full redraw if they fill the chat) */
+    ptr_first_new_line = gui_line_get_next_displayed (ptr_line);
+    rows = 0;
+    for (ptr_line = ptr_first_new_line; ptr_line;
+         ptr_line = gui_line_get_next_displayed (ptr_line))
+    {
+        rows += gui_chat_display_line (window, ptr_line, 0, 1);
+        if (rows >= window->win_chat_height)
+            return 0;
+    }
+
+    if (rows > 0)
+    {
+        /* end of buffer must still be displayed on all lines of chat */
+        ptr_top_line = NULL;
+        top_line_pos = 0;
+        gui_chat_calculate_line_diff (window, &ptr_top_line, &top_line_pos,
+                                      (-1) * (window->win_chat_height - 1));
+        if (!ptr_top_line
+            || ((top_line_pos == 0)
+                && (ptr_top_line == gui_line_get_first_displayed (window->buffer))))
+        {
+            return 0;
+        }
+
+        /* scroll chat and coordinates, then display new lines at bottom */
+        scrollok (GUI_WINDOW_OBJECTS(window)->win_chat, TRUE);
+        wscrl (GUI_WINDOW_OBJECTS(window)->win_chat, rows);
+        scrollok (GUI_WINDOW_OBJECTS(window)->win_chat, FALSE);
+        memmove (window->coords, window->coords + rows,
+                 (window->win_chat_height - rows) * sizeof (window->coords[0]));
+        for (i = window->win_chat_height - rows;
+             i < window->win_chat_height; i++)
+        {
+            gui_window_coords_init_line (window, i);
+        }
+
+        window->win_chat_cursor_x = 0;
+        window->win_chat_cursor_y = window->win_chat_height - rows;
+        for (ptr_line = ptr_first_new_line; ptr_line;
+             ptr_line = gui_line_get_next_displayed (ptr_line))
+        {
+            gui_chat_display_line (window, ptr_line, 0, 0);
+        }
+        window->scroll->first_line_displayed = 0;
+    }
+
+    gui_chat_bottom_save (window);
+
+    window->win_chat_cursor_x = 0;
+    window->win_chat_cursor_y = window->win_chat_height - 1;
+
+    return 1;
+}
+
 /*
  * Draws chat window for a formatted buffer.
  */
@@ -1727,6 +1958,8 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
     int auto_search_first_line, line_pos, line_pos2, count;
     int old_scrolling, old_lines_after;
 
+    GUI_WINDOW_OBJECTS(window)->chat_bottom.valid = 0;
+
     /* display at position of scrolling */
     auto_search_first_line = 1;
     ptr_line = NULL;
@@ -1839,6 +2072,16 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
                                  WEECHAT_HOOK_SIGNAL_POINTER, window);
     }
 
+    /* end of buffer displayed on all lines of chat? */
+    if (auto_search_first_line
+        && !ptr_line
+        && !window->scroll->scrolling
+        && !window->scroll->first_line_displayed
+        && (window->win_chat_cursor_y >= window->win_chat_height))
+    {
+        gui_chat_bottom_save (window);
+    }
+
     /* cursor is below end line of chat window? */
     if (window->win_chat_cursor_y > window->win_chat_height - 1)
     {
@@ -1917,7 +2160,7 @@ gui_chat_get_bare_line (struct t_gui_line *line)
     if (!prefix)
         goto end;
     message = (line->data->message) ?
-        gui_color_decode (line->data->message, NULL) : strdup ("");
+        gui_line_data_get_message_no_color (line->data) : strdup ("");
     if (!message)
         goto end;
 
@@ -2063,13 +2306,21 @@ gui_chat_draw (struct t_gui_buffer *buffer, int clear_chat)
             && (ptr_win->win_chat_x >= 0) && (ptr_win->win_chat_y >= 0)
             && (GUI_WINDOW_OBJECTS(ptr_win)->win_chat))
         {
-            gui_window_coords_alloc (ptr_win);
-
             gui_chat_reset_style (ptr_win, NULL, 0, 1,
                                   GUI_COLOR_CHAT_INACTIVE_WINDOW,
                                   GUI_COLOR_CHAT_INACTIVE_BUFFER,
                                   GUI_COLOR_CHAT);
 
+            /* only lines added? then scroll chat and display them */
+            if (!clear_chat && gui_chat_draw_lines_added (ptr_win))
+            {
+                wnoutrefresh (GUI_WINDOW_OBJECTS(ptr_win)->win_chat);
+                continue;
+            }
+
+            gui_window_coords_alloc (ptr_win);
+            GUI_WINDOW_OBJECTS(ptr_win)->chat_bottom.valid = 0;
+
             if (clear_chat)
             {
                 snprintf (format_empty, sizeof (format_empty),
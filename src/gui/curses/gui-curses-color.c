@@ -99,6 +99,11 @@ short *gui_color_term_color_content = NULL; /* content of colors (r/b/g)    */
 int gui_color_num_pairs = 63;            /* number of pairs used by WeeChat */
 short *gui_color_pairs = NULL;           /* table with pair for each fg+bg  */
 int gui_color_pairs_used = 0;            /* number of pairs currently used  */
+int *gui_color_pairs_index = NULL;       /* index in table for each pair    */
+unsigned int *gui_color_pairs_last_used = NULL; /* refresh of last use      */
+char *gui_color_pairs_visible = NULL;    /* pairs displayed on screen       */
+unsigned int gui_color_pairs_refresh = 1;   /* number of current refresh    */
+unsigned int gui_color_pairs_scan_refresh = 0; /* refresh of last scan      */
 int gui_color_warning_pairs_full = 0;    /* warning displayed?              */
 int gui_color_pairs_auto_reset = 0;         /* auto reset of pairs needed   */
 int gui_color_pairs_auto_reset_pending = 0; /* auto reset is pending        */
@@ -367,10 +372,96 @@ gui_color_timer_warning_pairs_full (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Marks pairs displayed on screen (read in the cells of terminal), so that
+ * they are not recycled.
+ *
+ * The screen is read only once per refresh: pairs displayed after the scan
+ * are used in this refresh, so they can not be recycled anyway.
+ */
+
+void
+gui_color_pairs_scan_screen ()
+{
+    int x, y, cur_x, cur_y, pair;
+    chtype cell;
+
+    if (gui_color_pairs_scan_refresh == gui_color_pairs_refresh)
+        return;
+
+    memset (gui_color_pairs_visible, 0,
+            (gui_color_num_pairs + 1) * sizeof (gui_color_pairs_visible[0]));
+
+    /* cursor of curscr is the cursor of terminal: restore it after scan */
+    getyx (curscr, cur_y, cur_x);
+
+    for (y = 0; y < gui_term_lines; y++)
+    {
+        for (x = 0; x < gui_term_cols; x++)
+        {
+            cell = mvwinch (curscr, y, x);
+            if (cell == (chtype)ERR)
+                continue;
+            pair = PAIR_NUMBER(cell);
+            if ((pair > 0) && (pair <= gui_color_num_pairs))
+                gui_color_pairs_visible[pair] = 1;
+        }
+    }
+
+    wmove (curscr, cur_y, cur_x);
+
+    gui_color_pairs_scan_refresh = gui_color_pairs_refresh;
+}
+
+/*
+ * Searches for a pair to recycle: the least recently used pair which is not
+ * displayed on screen and not used in current refresh.
+ *
+ * Argument "available" is set with the number of pairs that can be recycled.
+ *
+ * Returns pair number, 0 if no pair can be recycled.
+ */
+
+int
+gui_color_pairs_search_recycle (int *available)
+{
+    int i, pair;
+
+    *available = 0;
+
+    if (!gui_color_pairs_index || !gui_color_pairs_last_used
+        || !gui_color_pairs_visible)
+    {
+        return 0;
+    }
+
+    gui_color_pairs_scan_screen ();
+
+    pair = 0;
+    for (i = 1; i <= gui_color_pairs_used; i++)
+    {
+        if (gui_color_pairs_visible[i]
+            || (gui_color_pairs_last_used[i] == gui_color_pairs_refresh))
+        {
+            continue;
+        }
+        (*available)++;
+        if ((pair == 0)
+            || (gui_color_pairs_last_used[i] < gui_color_pairs_last_used[pair]))
+        {
+            pair = i;
+        }
+    }
+
+    return pair;
+}
+
 /*
  * Gets a pair with given foreground/background colors.
  *
- * If no pair is found for fg/bg, a new pair is created.
+ * If no pair is found for fg/bg, a new pair is created; if all pairs are
+ * used, the least recently used pair not displayed on screen is recycled
+ * (pairs are reset only if too few pairs can be recycled).
  *
  * Returns a value between 0 and COLOR_PAIRS-1.
  */
@@ -378,7 +469,7 @@ gui_color_timer_warning_pairs_full (const void *pointer, void *data,
 int
 gui_color_get_pair (int fg, int bg)
 {
-    int index;
+    int index, pair, available;
 
     /* only one color when displaying terminal colors */
     if (gui_color_use_term_colors)
@@ -398,31 +489,47 @@ gui_color_get_pair (int fg, int bg)
     {
         if (gui_color_pairs_used >= gui_color_num_pairs)
         {
-            /* oh no, no more pair available! */
-            if (!gui_color_warning_pairs_full
-                && (CONFIG_INTEGER(config_look_color_pairs_auto_reset) < 0))
+            /* no more pair available, try to recycle an unused pair */
+            pair = gui_color_pairs_search_recycle (&available);
+            if ((gui_color_num_pairs > 1)
+                && !gui_color_pairs_auto_reset_pending
+                && (CONFIG_INTEGER(config_look_color_pairs_auto_reset) >= 0)
+                && (available <= CONFIG_INTEGER(config_look_color_pairs_auto_reset)))
             {
-                /* display warning if auto reset of pairs is disabled */
-                hook_timer (NULL, 1, 0, 1,
-                            &gui_color_timer_warning_pairs_full, NULL, NULL);
-                gui_color_warning_pairs_full = 1;
+                gui_color_pairs_auto_reset = 1;
             }
-            return 1;
+            if (pair == 0)
+            {
+                /* oh no, no pair can be recycled! */
+                if (!gui_color_warning_pairs_full
+                    && (CONFIG_INTEGER(config_look_color_pairs_auto_reset) < 0))
+                {
+                    /* display warning if auto reset of pairs is disabled */
+                    hook_timer (NULL, 1, 0, 1,
+                                &gui_color_timer_warning_pairs_full,
+                                NULL, NULL);
+                    gui_color_warning_pairs_full = 1;
+                }
+                return 1;
+            }
+            gui_color_pairs[gui_color_pairs_index[pair]] = 0;
         }
-
-        /* create a new pair if no pair exists for this fg/bg */
-        gui_color_pairs_used++;
-        gui_color_pairs[index] = gui_color_pairs_used;
-        init_pair (gui_color_pairs_used, fg, bg);
-        if ((gui_color_num_pairs > 1) && !gui_color_pairs_auto_reset_pending
-            && (CONFIG_INTEGER(config_look_color_pairs_auto_reset) >= 0)
-            && (gui_color_num_pairs - gui_color_pairs_used <= CONFIG_INTEGER(config_look_color_pairs_auto_reset)))
+        else
         {
-            gui_color_pairs_auto_reset = 1;
+            /* create a new pair if no pair exists for this fg/bg */
+            gui_color_pairs_used++;
+            pair = gui_color_pairs_used;
         }
+        gui_color_pairs[index] = pair;
+        if (gui_color_pairs_index)
+            gui_color_pairs_index[pair] = index;
+        init_pair (pair, fg, bg);
         gui_color_buffer_refresh_needed = 1;
     }
 
+    if (gui_color_pairs_last_used)
+        gui_color_pairs_last_used[gui_color_pairs[index]] = gui_color_pairs_refresh;
+
     return gui_color_pairs[index];
 }
 
@@ -553,6 +660,77 @@ gui_color_build (int number, int foreground, int background)
     }
 }
 
+/*
+ * Allocates arrays used to recycle least recently used pairs.
+ */
+
+void
+gui_color_alloc_pairs_lru ()
+{
+    int i;
+
+    gui_color_pairs_index = malloc (
+        (gui_color_num_pairs + 1) * sizeof (gui_color_pairs_index[0]));
+    gui_color_pairs_last_used = malloc (
+        (gui_color_num_pairs + 1) * sizeof (gui_color_pairs_last_used[0]));
+    gui_color_pairs_visible = malloc (
+        (gui_color_num_pairs + 1) * sizeof (gui_color_pairs_visible[0]));
+    if (!gui_color_pairs_index || !gui_color_pairs_last_used
+        || !gui_color_pairs_visible)
+    {
+        /* not enough memory: pairs will not be recycled */
+        gui_color_free_pairs_lru ();
+        return;
+    }
+    for (i = 0; i <= gui_color_num_pairs; i++)
+    {
+        gui_color_pairs_index[i] = -1;
+        gui_color_pairs_last_used[i] = 0;
+        gui_color_pairs_visible[i] = 0;
+    }
+    gui_color_pairs_scan_refresh = 0;
+}
+
+/*
+ * Frees arrays used to recycle least recently used pairs.
+ */
+
+void
+gui_color_free_pairs_lru ()
+{
+    if (gui_color_pairs_index)
+    {
+        free (gui_color_pairs_index);
+        gui_color_pairs_index = NULL;
+    }
+    if (gui_color_pairs_last_used)
+    {
+        free (gui_color_pairs_last_used);
+        gui_color_pairs_last_used = NULL;
+    }
+    if (gui_color_pairs_visible)
+    {
+        free (gui_color_pairs_visible);
+        gui_color_pairs_visible = NULL;
+    }
+}
+
+/*
+ * Frees table of pairs.
+ */
+
+void
+gui_color_free_pairs ()
+{
+    if (gui_color_pairs)
+    {
+        free (gui_color_pairs);
+        gui_color_pairs = NULL;
+    }
+    gui_color_free_pairs_lru ();
+    gui_color_pairs_used = 0;
+}
+
 /*
  * Initializes color variables using terminal infos.
  */
@@ -567,12 +745,7 @@ gui_color_init_vars ()
     gui_color_term_color_pairs = 0;
     gui_color_term_can_change_color = 0;
     gui_color_num_pairs = 63;
-    if (gui_color_pairs)
-    {
-        free (gui_color_pairs);
-        gui_color_pairs = NULL;
-    }
-    gui_color_pairs_used = 0;
+    gui_color_free_pairs ();
 
     if (gui_color_term_has_colors)
     {
@@ -589,6 +762,7 @@ gui_color_init_vars ()
         if (gui_color_pairs)
             memset (gui_color_pairs, 0, size);
         gui_color_pairs_used = 0;
+        gui_color_alloc_pairs_lru ();
 
         /* reserved for future usage */
         /*
@@ -617,6 +791,7 @@ gui_color_init_vars ()
         if (gui_color_pairs)
             memset (gui_color_pairs, 0, size);
         gui_color_pairs_used = 0;
+        gui_color_alloc_pairs_lru ();
     }
 }
 
@@ -627,11 +802,7 @@ gui_color_init_vars ()
 void
 gui_color_free_vars ()
 {
-    if (gui_color_pairs)
-    {
-        free (gui_color_pairs);
-        gui_color_pairs = NULL;
-    }
+    gui_color_free_pairs ();
     if (gui_color_term_color_content)
     {
         free (gui_color_term_color_content);
@@ -1117,6 +1288,8 @@ gui_color_switch_colors ()
 void
 gui_color_reset_pairs ()
 {
+    int i;
+
     if (gui_color_pairs)
     {
         memset (gui_color_pairs, 0,
@@ -1124,6 +1297,15 @@ gui_color_reset_pairs ()
                 * (gui_color_term_colors + 2)
                 * sizeof (gui_color_pairs[0]));
         gui_color_pairs_used = 0;
+        if (gui_color_pairs_index && gui_color_pairs_last_used)
+        {
+            for (i = 0; i <= gui_color_num_pairs; i++)
+            {
+                gui_color_pairs_index[i] = -1;
+                gui_color_pairs_last_used[i] = 0;
+            }
+        }
+        gui_color_pairs_scan_refresh = 0;
         gui_color_warning_pairs_full = 0;
         gui_color_buffer_refresh_needed = 1;
         gui_window_ask_refresh (1);
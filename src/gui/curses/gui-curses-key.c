@@ -308,12 +308,13 @@ gui_key_default_bindings (int context)
 void
 gui_key_flush (int paste)
 {
-    int i, key, last_key_used, insert_ok, undo_done;
+    int i, key, last_key_used, insert_ok, undo_done, input_changed_undo;
+    int newline_in_input;
     static char key_str[64] = { '\0' };
     static int length_key_str = 0;
     char key_temp[2], *key_utf, *input_old, *ptr_char, *next_char, *ptr_error;
     char utf_partial_char[16];
-    struct t_gui_buffer *old_buffer;
+    struct t_gui_buffer *old_buffer, *input_changed_buffer, *input_lines_buffer;
 
     /* if paste pending or bracketed paste detected, just return */
     if (gui_key_paste_pending || gui_key_paste_bracketed)
@@ -328,9 +329,13 @@ gui_key_flush (int paste)
      * according to keys
      */
     gui_key_last_activity_time = time (NULL);
+    gui_window_refresh_immediate = 1;
     last_key_used = -1;
     undo_done = 0;
     old_buffer = NULL;
+    input_changed_buffer = NULL;
+    input_changed_undo = 0;
+    input_lines_buffer = NULL;
     for (i = 0; i < gui_key_buffer_size; i++)
     {
         key = gui_key_buffer[i];
@@ -422,16 +427,89 @@ gui_key_flush (int paste)
                 input_old = NULL;
             old_buffer = gui_current_window->buffer;
 
-            if ((gui_key_pressed (key_str) != 0) && (insert_ok)
+            /*
+             * in a paste, if buffer accepts many lines at once, a newline
+             * is kept in input, and all lines are sent in a single call to
+             * the buffer at the end of paste
+             */
+            newline_in_input = (paste
+                                && ((key == '\r') || (key == '\n'))
+                                && gui_current_window->buffer->input_multiline
+                                && !gui_cursor_mode
+                                && !gui_key_combo_buffer[0]
+                                && (gui_current_window->buffer->text_search == GUI_TEXT_SEARCH_DISABLED));
+            if (newline_in_input)
+            {
+                if (!undo_done)
+                {
+                    gui_buffer_undo_snap (gui_current_window->buffer);
+                    input_changed_undo = 1;
+                }
+                gui_input_insert_string (gui_current_window->buffer,
+                                         "\n", -1);
+                input_lines_buffer = gui_current_window->buffer;
+                input_changed_buffer = gui_current_window->buffer;
+                undo_done = 1;
+            }
+
+            /*
+             * send lines, pending modifier and signal for chars pasted
+             * before this key, if the key is not a char inserted in the
+             * same buffer
+             */
+            if (!newline_in_input
+                && input_lines_buffer
+                && (!insert_ok
+                    || (input_lines_buffer != gui_current_window->buffer)))
+            {
+                if (gui_buffer_valid (input_lines_buffer))
+                    gui_input_return_lines (input_lines_buffer);
+                if (input_changed_buffer == input_lines_buffer)
+                {
+                    input_changed_buffer = NULL;
+                    input_changed_undo = 0;
+                }
+                input_lines_buffer = NULL;
+            }
+            if (!newline_in_input
+                && input_changed_buffer
+                && (!insert_ok
+                    || (input_changed_buffer != gui_current_window->buffer)))
+            {
+                if (gui_buffer_valid (input_changed_buffer))
+                {
+                    gui_input_text_changed_modifier_and_signal (input_changed_buffer,
+                                                                input_changed_undo,
+                                                                1); /* stop completion */
+                }
+                input_changed_buffer = NULL;
+                input_changed_undo = 0;
+            }
+
+            if (!newline_in_input
+                && (gui_key_pressed (key_str) != 0) && (insert_ok)
                 && (!gui_cursor_mode))
             {
                 if (!paste || !undo_done)
                     gui_buffer_undo_snap (gui_current_window->buffer);
                 gui_input_insert_string (gui_current_window->buffer,
                                          key_str, -1);
-                gui_input_text_changed_modifier_and_signal (gui_current_window->buffer,
-                                                            (!paste || !undo_done) ? 1 : 0,
-                                                            1); /* stop completion */
+                if (paste)
+                {
+                    /*
+                     * in a paste, modifier and signal are sent only once for
+                     * all chars inserted (each of them is O(input length))
+                     */
+                    if (!undo_done)
+                        input_changed_undo = 1;
+                    input_changed_buffer = gui_current_window->buffer;
+                }
+                else
+                {
+                    gui_input_text_changed_modifier_and_signal (gui_current_window->buffer,
+                                                                1, /* save undo */
+                                                                1); /* stop completion */
+                }
                 undo_done = 1;
             }
 
@@ -493,6 +571,19 @@ gui_key_flush (int paste)
             last_key_used = i;
     }
 
+    if (input_lines_buffer && gui_buffer_valid (input_lines_buffer))
+    {
+        gui_input_return_lines (input_lines_buffer);
+        if (input_changed_buffer == input_lines_buffer)
+            input_changed_buffer = NULL;
+    }
+    if (input_changed_buffer && gui_buffer_valid (input_changed_buffer))
+    {
+        gui_input_text_changed_modifier_and_signal (input_changed_buffer,
+                                                    input_changed_undo,
+                                                    1); /* stop completion */
+    }
+
     if (last_key_used == gui_key_buffer_size - 1)
         gui_key_buffer_reset ();
     else if (last_key_used >= 0)
@@ -29,12 +29,18 @@
 #include <string.h>
 #include <signal.h>
 #include <time.h>
+#include <sys/time.h>
 
 #include "../../core/weechat.h"
+#include "../../core/wee-async.h"
 #include "../../core/wee-command.h"
 #include "../../core/wee-config.h"
+#include "../../core/wee-eval.h"
 #include "../../core/wee-hook.h"
+#include "../../core/wee-latency.h"
 #include "../../core/wee-log.h"
+#include "../../core/wee-metrics.h"
+#include "../../core/wee-profile.h"
 #include "../../core/wee-string.h"
 #include "../../core/wee-utf8.h"
 #include "../../core/wee-util.h"
@@ -55,6 +61,7 @@
 #include "../gui-line.h"
 #include "../gui-history.h"
 #include "../gui-mouse.h"
+#include "../gui-nick.h"
 #include "../gui-nicklist.h"
 #include "../gui-window.h"
 #include "gui-curses.h"
@@ -78,6 +85,16 @@ gui_main_get_password (const char **prompt, char *password, int size)
 {
     int line, i, ch;
 
+    if (weechat_headless)
+    {
+        /*
+         * no terminal to ask the passphrase: skip it (the secured data is
+         * not decrypted, it can be done later with /secure decrypt)
+         */
+        snprintf (password, size, " ");
+        return;
+    }
+
     initscr ();
     cbreak ();
     noecho ();
@@ -323,6 +340,12 @@ gui_main_refreshs ()
     struct t_gui_buffer *ptr_buffer;
     struct t_gui_bar *ptr_bar;
 
+    /* values memoized in expressions are valid only for one refresh */
+    eval_memo_reset ();
+
+    /* pairs used in this refresh will not be recycled */
+    gui_color_pairs_refresh++;
+
     /* refresh color buffer if needed */
     if (gui_color_buffer_refresh_needed)
     {
@@ -359,6 +382,9 @@ gui_main_refreshs ()
         }
     }
 
+    /* update bar items asked since last refresh */
+    gui_bar_item_update_pending ();
+
     /* refresh window if needed */
     if (gui_window_refresh_needed)
     {
@@ -419,6 +445,44 @@ gui_main_refreshs ()
     }
 }
 
+/*
+ * Checks if the screen can be refreshed now, according to option
+ * weechat.look.refresh_max_fps.
+ *
+ * The refresh is never delayed after a key is pressed, so that the input
+ * is displayed immediately.
+ *
+ * Returns:
+ *   0: screen can be refreshed now
+ *   > 0: delay before next refresh is allowed (in milliseconds)
+ */
+
+int
+gui_main_refresh_delay ()
+{
+    static struct timeval tv_last_refresh = { 0, 0 };
+    struct timeval tv_now;
+    long long diff, interval;
+    int max_fps;
+
+    gettimeofday (&tv_now, NULL);
+
+    max_fps = CONFIG_INTEGER(config_look_refresh_max_fps);
+    if ((max_fps > 0) && !gui_window_refresh_immediate)
+    {
+        interval = 1000000 / max_fps;
+        diff = util_timeval_diff (&tv_last_refresh, &tv_now);
+        if ((diff >= 0) && (diff < interval))
+            return (int)((interval - diff + 999) / 1000);
+    }
+
+    tv_last_refresh.tv_sec = tv_now.tv_sec;
+    tv_last_refresh.tv_usec = tv_now.tv_usec;
+    gui_window_refresh_immediate = 0;
+
+    return 0;
+}
+
 /*
  * Main loop for WeeChat with ncurses GUI.
  */
@@ -427,23 +491,35 @@ void
 gui_main_loop ()
 {
     struct t_hook *hook_fd_keyboard;
-    int send_signal_sigwinch;
+    int send_signal_sigwinch, refresh_delay;
 
     send_signal_sigwinch = 0;
+    hook_fd_keyboard = NULL;
 
-    /* catch SIGWINCH signal: redraw screen */
-    util_catch_signal (SIGWINCH, &gui_main_signal_sigwinch);
+    /*
+     * in headless mode there is no terminal: keyboard is not read and the
+     * screen is never refreshed (buffers and lines are still updated)
+     */
+    if (!weechat_headless)
+    {
+        /* catch SIGWINCH signal: redraw screen */
+        util_catch_signal (SIGWINCH, &gui_main_signal_sigwinch);
 
-    /* hook stdin (read keyboard) */
-    hook_fd_keyboard = hook_fd (NULL, STDIN_FILENO, 1, 0, 0,
-                                &gui_key_read_cb, NULL, NULL);
+        /* hook stdin (read keyboard) */
+        hook_fd_keyboard = hook_fd (NULL, STDIN_FILENO, 1, 0, 0,
+                                    &gui_key_read_cb, NULL, NULL);
+    }
 
     gui_window_ask_refresh (1);
 
     while (!weechat_quit)
     {
+        metrics_loop_start ();
+
         /* execute timer hooks */
+        profile_set_phase (PROFILE_PHASE_TIMERS);
         hook_timer_exec ();
+        profile_set_phase (PROFILE_PHASE_OTHER);
 
         /* auto reset of color pairs */
         if (gui_color_pairs_auto_reset)
@@ -457,13 +533,33 @@ gui_main_loop ()
         if (gui_signal_sigwinch_received)
         {
             gui_window_ask_refresh (2);
+            gui_window_refresh_immediate = 1;
             gui_signal_sigwinch_received = 0;
             send_signal_sigwinch = 1;
         }
 
-        gui_main_refreshs ();
-        if (gui_window_refresh_needed && !gui_window_bare_display)
+        /* resort hotlist and send signal "hotlist_changed" if needed */
+        gui_hotlist_flush ();
+
+        /* free some lines of buffers closed or cleared */
+        if (gui_lines_detached)
+            gui_lines_detached_free (GUI_LINES_DETACHED_FREE_LINES);
+
+        /*
+         * refresh screen (if not refreshed too recently: all changes done
+         * in the meantime will be drawn together by next refresh);
+         * never done in headless mode
+         */
+        refresh_delay = (weechat_headless) ? -1 : gui_main_refresh_delay ();
+        if (refresh_delay == 0)
+        {
+            profile_set_phase (PROFILE_PHASE_REFRESH);
             gui_main_refreshs ();
+            if (gui_window_refresh_needed && !gui_window_bare_display)
+                gui_main_refreshs ();
+            latency_screen_refreshed ();
+            profile_set_phase (PROFILE_PHASE_OTHER);
+        }
 
         if (send_signal_sigwinch)
         {
@@ -474,19 +570,34 @@ gui_main_loop ()
 
         gui_color_pairs_auto_reset_pending = 0;
 
-        /* execute fd hooks */
-        hook_fd_exec ();
+        /*
+         * execute fd hooks (wake up for next refresh if it was delayed, or
+         * immediately if there are still lines to free)
+         */
+        profile_set_phase (PROFILE_PHASE_FD);
+        if (gui_lines_detached)
+            hook_fd_exec (0);
+        else
+            hook_fd_exec ((refresh_delay > 0) ? refresh_delay : -1);
 
         /* run process (with fork) */
+        profile_set_phase (PROFILE_PHASE_PROCESS);
         hook_process_exec ();
+        profile_set_phase (PROFILE_PHASE_OTHER);
+
+        /* execute events posted by threads */
+        async_exec ();
 
         /* handle signals received */
         if (weechat_quit_signal > 0)
             gui_main_handle_quit_signals ();
+
+        metrics_loop_end ();
     }
 
     /* remove keyboard hook */
-    unhook (hook_fd_keyboard);
+    if (hook_fd_keyboard)
+        unhook (hook_fd_keyboard);
 }
 
 /*
@@ -505,7 +616,7 @@ gui_main_end (int clean_exit)
          * final refreshs, to see messages just before exiting
          * (if we are upgrading, don't refresh anything!)
          */
-        if (!weechat_upgrading)
+        if (!weechat_upgrading && !weechat_headless)
         {
             gui_main_refreshs ();
             if (gui_window_refresh_needed)
@@ -545,6 +656,9 @@ gui_main_end (int clean_exit)
             gui_buffer_close (gui_buffers);
         }
 
+        /* free lines detached from buffers */
+        gui_lines_detached_free (-1);
+
         gui_init_ok = 0;
 
         /* delete global history */
@@ -560,12 +674,12 @@ gui_main_end (int clean_exit)
         /* end color */
         gui_color_end ();
 
+        /* free cache of nick colors */
+        gui_nick_end ();
+
         /* free some variables used for chat area */
         gui_chat_end ();
 
-        /* free some variables used for nicklist */
-        gui_nicklist_end ();
-
         /* free some variables used for hotlist */
         gui_hotlist_end ();
     }
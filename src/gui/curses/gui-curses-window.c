@@ -52,6 +52,7 @@
 #include "../gui-key.h"
 #include "../gui-layout.h"
 #include "../gui-line.h"
+#include "../gui-line-cold.h"
 #include "../gui-main.h"
 #include "../gui-mouse.h"
 #include "../gui-nicklist.h"
@@ -100,6 +101,14 @@ gui_window_read_terminal_size ()
     struct winsize size;
     int new_width, new_height;
 
+    if (weechat_headless)
+    {
+        /* no terminal: simulate a 80x25 terminal (like fake ncurses lib) */
+        gui_term_cols = 80;
+        gui_term_lines = 25;
+        return;
+    }
+
     if (ioctl (fileno (stdout), TIOCGWINSZ, &size) == 0)
     {
         resizeterm (size.ws_row, size.ws_col);
@@ -134,6 +143,7 @@ gui_window_objects_init (struct t_gui_window *window)
         GUI_WINDOW_OBJECTS(window)->win_chat = NULL;
         GUI_WINDOW_OBJECTS(window)->win_separator_horiz = NULL;
         GUI_WINDOW_OBJECTS(window)->win_separator_vertic = NULL;
+        GUI_WINDOW_OBJECTS(window)->chat_bottom.valid = 0;
         return 1;
     }
     return 0;
@@ -151,6 +161,7 @@ gui_window_objects_free (struct t_gui_window *window, int free_separators)
         delwin (GUI_WINDOW_OBJECTS(window)->win_chat);
         GUI_WINDOW_OBJECTS(window)->win_chat = NULL;
     }
+    GUI_WINDOW_OBJECTS(window)->chat_bottom.valid = 0;
     if (free_separators)
     {
         if  (GUI_WINDOW_OBJECTS(window)->win_separator_horiz)
@@ -1174,6 +1185,7 @@ gui_window_switch_to_buffer (struct t_gui_window *window,
 {
     struct t_gui_bar_window *ptr_bar_window;
     struct t_gui_buffer *old_buffer;
+    int old_x, old_y, old_width, old_height, old_refresh_needed;
 
     if (!gui_init_ok)
         return;
@@ -1226,36 +1238,67 @@ gui_window_switch_to_buffer (struct t_gui_window *window,
     if (!weechat_upgrading && (old_buffer != buffer))
         gui_hotlist_remove_buffer (buffer, 0);
 
-    /* remove unused bars and add missing bars in window */
+    /*
+     * remove unused bars and add missing bars in window; the layout of this
+     * window is entirely computed below, so the refresh of all windows asked
+     * when a bar window is added or removed is not needed
+     */
+    old_refresh_needed = gui_window_refresh_needed;
     gui_bar_window_remove_unused_bars (window);
     gui_bar_window_add_missing_bars (window);
+    gui_window_refresh_needed = old_refresh_needed;
 
-    /* create bar windows */
+    /*
+     * create bar windows (Curses windows are kept if the bar window has same
+     * position and size, so that an unchanged content is not drawn again)
+     */
     for (ptr_bar_window = window->bar_windows; ptr_bar_window;
          ptr_bar_window = ptr_bar_window->next_bar_window)
     {
+        old_x = ptr_bar_window->x;
+        old_y = ptr_bar_window->y;
+        old_width = ptr_bar_window->width;
+        old_height = ptr_bar_window->height;
         gui_bar_window_content_build (ptr_bar_window, window);
         gui_bar_window_calculate_pos_size (ptr_bar_window, window);
-        gui_bar_window_create_win (ptr_bar_window);
+        if (!GUI_BAR_WINDOW_OBJECTS(ptr_bar_window)->win_bar
+            || (ptr_bar_window->x != old_x)
+            || (ptr_bar_window->y != old_y)
+            || (ptr_bar_window->width != old_width)
+            || (ptr_bar_window->height != old_height))
+        {
+            gui_bar_window_create_win (ptr_bar_window);
+        }
     }
 
-    gui_window_calculate_pos_size (window);
+    old_x = window->win_chat_x;
+    old_y = window->win_chat_y;
+    old_width = window->win_chat_width;
+    old_height = window->win_chat_height;
 
-    /* destroy Curses windows */
-    gui_window_objects_free (window, 0);
+    gui_window_calculate_pos_size (window);
 
-    /* create Curses windows */
-    if (GUI_WINDOW_OBJECTS(window)->win_chat)
+    /* create Curses window for chat (if position or size has changed) */
+    GUI_WINDOW_OBJECTS(window)->chat_bottom.valid = 0;
+    if (GUI_WINDOW_OBJECTS(window)->win_chat
+        && ((window->win_chat_x != old_x)
+            || (window->win_chat_y != old_y)
+            || (window->win_chat_width != old_width)
+            || (window->win_chat_height != old_height)))
     {
         delwin (GUI_WINDOW_OBJECTS(window)->win_chat);
         GUI_WINDOW_OBJECTS(window)->win_chat = NULL;
     }
-    if ((window->win_chat_x >= 0) && (window->win_chat_y >= 0))
+    if (!GUI_WINDOW_OBJECTS(window)->win_chat
+        && (window->win_chat_x >= 0) && (window->win_chat_y >= 0))
     {
         GUI_WINDOW_OBJECTS(window)->win_chat = newwin (window->win_chat_height,
                                                        window->win_chat_width,
                                                        window->win_chat_y,
                                                        window->win_chat_x);
+        /* allow use of terminal scrolling when lines are added in chat */
+        if (GUI_WINDOW_OBJECTS(window)->win_chat)
+            idlok (GUI_WINDOW_OBJECTS(window)->win_chat, TRUE);
     }
     gui_window_draw_separators (window);
     gui_buffer_ask_chat_refresh (window->buffer, 2);
@@ -1351,6 +1394,12 @@ gui_window_page_up (struct t_gui_window *window)
     switch (window->buffer->type)
     {
         case GUI_BUFFER_TYPE_FORMATTED:
+            if (window->scroll->first_line_displayed
+                && (gui_line_cold_load (window->buffer,
+                                        GUI_LINE_COLD_LOAD_LINES) > 0))
+            {
+                window->scroll->first_line_displayed = 0;
+            }
             if (!window->scroll->first_line_displayed)
             {
                 gui_chat_calculate_line_diff (window, &window->scroll->start_line,
@@ -1447,6 +1496,12 @@ gui_window_scroll_up (struct t_gui_window *window)
     switch (window->buffer->type)
     {
         case GUI_BUFFER_TYPE_FORMATTED:
+            if (window->scroll->first_line_displayed
+                && (gui_line_cold_load (window->buffer,
+                                        GUI_LINE_COLD_LOAD_LINES) > 0))
+            {
+                window->scroll->first_line_displayed = 0;
+            }
             if (!window->scroll->first_line_displayed)
             {
                 gui_chat_calculate_line_diff (window, &window->scroll->start_line,
@@ -1536,6 +1591,12 @@ gui_window_scroll_top (struct t_gui_window *window)
     switch (window->buffer->type)
     {
         case GUI_BUFFER_TYPE_FORMATTED:
+            if (window->scroll->first_line_displayed
+                && (gui_line_cold_load (window->buffer,
+                                        GUI_LINE_COLD_LOAD_LINES) > 0))
+            {
+                window->scroll->first_line_displayed = 0;
+            }
             if (!window->scroll->first_line_displayed)
             {
                 window->scroll->start_line = gui_line_get_first_displayed (window->buffer);
@@ -2442,6 +2503,9 @@ gui_window_set_title (const char *title)
 {
     char *new_title, *envterm, *envshell, *shell, *shellname;
 
+    if (weechat_headless)
+        return;
+
     envterm = getenv ("TERM");
     if (!envterm)
         return;
@@ -2539,6 +2603,9 @@ gui_window_set_bracketed_paste_mode (int enable)
     char *envterm, *envtmux;
     int tmux, screen;
 
+    if (weechat_headless)
+        return;
+
     envtmux = getenv ("TMUX");
     tmux = (envtmux && envtmux[0]);
 
@@ -32,6 +32,7 @@
 
 struct t_gui_buffer;
 struct t_gui_line;
+struct t_gui_lines;
 struct t_gui_window;
 struct t_gui_bar_window;
 
@@ -58,23 +59,51 @@ struct t_gui_window_saved_style
     short pair;
 };
 
+struct t_gui_window_chat_bottom
+{
+    int valid;                      /* 1 if chat displays end of buffer on  */
+                                    /* all lines (0 if unknown)             */
+    struct t_gui_buffer *buffer;    /* buffer displayed                     */
+    struct t_gui_lines *lines;      /* lines displayed (own or mixed)       */
+    struct t_gui_line *last_line;   /* last line displayed                  */
+    unsigned long long last_line_id; /* id of last line displayed           */
+    int last_line_rows;             /* number of rows of last line          */
+    unsigned long long next_line_id; /* next id of lines when drawn         */
+    struct t_gui_line *last_read_line; /* last read line when drawn         */
+    int first_line_not_read;        /* first_line_not_read when drawn       */
+    int prefix_max_length;          /* prefix max length when drawn         */
+    int buffer_max_length;          /* buffer max length when drawn         */
+    int layout_generation;          /* generation of layout when drawn      */
+    int width;                      /* width of chat when drawn             */
+    int height;                     /* height of chat when drawn            */
+    int current_window;             /* 1 if window was current window       */
+};
+
 struct t_gui_window_curses_objects
 {
     WINDOW *win_chat;               /* chat window (example: channel)       */
     WINDOW *win_separator_horiz;    /* horizontal separator (optional)      */
     WINDOW *win_separator_vertic;   /* vertical separator (optional)        */
+    struct t_gui_window_chat_bottom chat_bottom; /* end of buffer displayed */
+                                    /* (to scroll chat when lines are added)*/
 };
 
 struct t_gui_bar_window_curses_objects
 {
     WINDOW *win_bar;                /* bar Curses window                    */
     WINDOW *win_separator;          /* separator (optional)                 */
+    int content_drawn;              /* 1 if content has been drawn in       */
+                                    /* win_bar (0 if window is new)         */
+    char *content;                  /* content drawn (may be NULL)          */
+    int content_scroll_x;           /* scroll X when content was drawn      */
+    int content_scroll_y;           /* scroll Y when content was drawn      */
 };
 
 extern int gui_term_cols, gui_term_lines;
 extern struct t_gui_color *gui_weechat_colors;
 extern int gui_color_term_colors;
 extern int gui_color_num_pairs;
+extern unsigned int gui_color_pairs_refresh;
 extern int gui_color_pairs_auto_reset;
 extern int gui_color_pairs_auto_reset_pending;
 extern time_t gui_color_pairs_auto_reset_last;
@@ -87,9 +116,14 @@ extern void gui_main_loop ();
 
 /* color functions */
 extern int gui_color_get_extended_attrs (int color);
+extern void gui_color_pairs_scan_screen ();
+extern int gui_color_pairs_search_recycle (int *available);
 extern int gui_color_get_pair (int fg, int bg);
 extern int gui_color_weechat_get_pair (int weechat_color);
 extern void gui_color_alloc ();
+extern void gui_color_alloc_pairs_lru ();
+extern void gui_color_free_pairs_lru ();
+extern void gui_color_free_pairs ();
 
 /* chat functions */
 extern void gui_chat_calculate_line_diff (struct t_gui_window *window,
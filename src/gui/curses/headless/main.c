@@ -0,0 +1,49 @@
+/*
+ * main.c - entry point for headless mode (no GUI)
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "../../../core/weechat.h"
+#include "../../gui-main.h"
+#include "../gui-curses.h"
+
+
+/*
+ * Entry point for WeeChat in headless mode: buffers and lines are kept in
+ * memory, but nothing is displayed (the fake ncurses lib is used and screen
+ * is never refreshed).
+ */
+
+int
+main (int argc, char *argv[])
+{
+    weechat_headless = 1;
+
+    weechat_init (argc, argv, &gui_main_init);
+    gui_main_loop ();
+    weechat_end (&gui_main_end);
+
+    return EXIT_SUCCESS;
+}
@@ -1,5 +1,5 @@
 /*
- * ncurses.c - fake ncurses lib used for tests
+ * ncurses-fake.c - fake ncurses lib (for headless mode and tests)
  *
  * Copyright (C) 2014-2017 Sébastien Helleu <flashcode@flashtux.org>
  *
@@ -36,8 +36,33 @@ typedef unsigned chtype;
 
 /* simulate 80x25 terminal */
 WINDOW stdscr = { 0, 0, 24, 79, 0, 0 };
+WINDOW curscr = { 0, 0, 24, 79, 0, 0 };
 chtype acs_map[256];
 
+/* counters (used by benchmarks) */
+long long ncurses_fake_calls = 0;      /* calls to functions drawing/moving */
+long long ncurses_fake_cells = 0;      /* chars written                     */
+
+/*
+ * Counts chars (not bytes) in a UTF-8 string (at most "n" bytes, -1 for all
+ * string).
+ */
+
+void
+ncurses_fake_add_cells (const char *str, int n)
+{
+    int i;
+
+    if (!str)
+        return;
+
+    for (i = 0; str[i] && ((n < 0) || (i < n)); i++)
+    {
+        if ((((unsigned char)str[i]) & 0xC0) != 0x80)
+            ncurses_fake_cells++;
+    }
+}
+
 
 WINDOW
 *initscr ()
@@ -66,6 +91,7 @@ delwin ()
 int
 wmove (WINDOW *win, int y, int x)
 {
+    ncurses_fake_calls++;
     (void)win;
     (void)y;
     (void)x;
@@ -75,6 +101,7 @@ wmove (WINDOW *win, int y, int x)
 int
 wattr_on (WINDOW *win, attr_t attrs, void *opts)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) attrs;
     (void) opts;
@@ -84,6 +111,7 @@ wattr_on (WINDOW *win, attr_t attrs, void *opts)
 int
 wattr_off (WINDOW *win, attr_t attrs, void *opts)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) attrs;
     (void) opts;
@@ -93,6 +121,7 @@ wattr_off (WINDOW *win, attr_t attrs, void *opts)
 int
 wattr_get (WINDOW *win, attr_t *attrs, short *pair, void *opts)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) attrs;
     (void) pair;
@@ -103,6 +132,7 @@ wattr_get (WINDOW *win, attr_t *attrs, short *pair, void *opts)
 int
 wattr_set (WINDOW *win, attr_t *attrs, short *pair, void *opts)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) attrs;
     (void) pair;
@@ -113,15 +143,16 @@ wattr_set (WINDOW *win, attr_t *attrs, short *pair, void *opts)
 int
 waddnstr(WINDOW *win, const char *str, int n)
 {
+    ncurses_fake_calls++;
+    ncurses_fake_add_cells (str, n);
     (void) win;
-    (void) str;
-    (void) n;
     return OK;
 }
 
 int
 wclrtobot(WINDOW *win)
 {
+    ncurses_fake_calls++;
     (void) win;
     return OK;
 }
@@ -129,6 +160,7 @@ wclrtobot(WINDOW *win)
 int
 wrefresh(WINDOW *win)
 {
+    ncurses_fake_calls++;
     (void) win;
     return OK;
 }
@@ -136,20 +168,55 @@ wrefresh(WINDOW *win)
 int
 wnoutrefresh(WINDOW *win)
 {
+    ncurses_fake_calls++;
     (void) win;
     return OK;
 }
 
+chtype
+winch(WINDOW *win)
+{
+    (void) win;
+    return 0;
+}
+
 int
 wclrtoeol(WINDOW *win)
 {
+    ncurses_fake_calls++;
     (void) win;
     return OK;
 }
 
+int
+wscrl(WINDOW *win, int n)
+{
+    ncurses_fake_calls++;
+    (void) win;
+    (void) n;
+    return OK;
+}
+
+int
+scrollok(WINDOW *win, bool bf)
+{
+    (void) win;
+    (void) bf;
+    return OK;
+}
+
+int
+idlok(WINDOW *win, bool bf)
+{
+    (void) win;
+    (void) bf;
+    return OK;
+}
+
 int
 mvwprintw(WINDOW *win, int y, int x, const char *fmt, ...)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) y;
     (void) x;
@@ -193,6 +260,7 @@ noecho()
 int
 wclear(WINDOW *win)
 {
+    ncurses_fake_calls++;
     (void) win;
     return OK;
 }
@@ -229,6 +297,7 @@ nodelay(WINDOW *win, bool bf)
 int
 werase(WINDOW *win)
 {
+    ncurses_fake_calls++;
     (void) win;
     return OK;
 }
@@ -236,6 +305,7 @@ werase(WINDOW *win)
 int
 wbkgdset(WINDOW *win, chtype ch)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) ch;
     return OK;
@@ -244,6 +314,7 @@ wbkgdset(WINDOW *win, chtype ch)
 void
 wchgat(WINDOW *win, int n, attr_t attr, short color, const void *opts)
 {
+    ncurses_fake_calls++;
     (void) win;
     (void) n;
     (void) attr;
@@ -254,11 +325,13 @@ wchgat(WINDOW *win, int n, attr_t attr, short color, const void *opts)
 void
 whline()
 {
+    ncurses_fake_calls++;
 }
 
 void
 wvline()
 {
+    ncurses_fake_calls++;
 }
 
 void
@@ -269,6 +342,7 @@ raw()
 void
 wcolor_set()
 {
+    ncurses_fake_calls++;
 }
 
 void
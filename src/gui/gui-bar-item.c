@@ -79,6 +79,8 @@ char *gui_bar_items_default_for_bars[][2] =
     NULL },
 };
 struct t_gui_bar_item_hook *gui_bar_item_hooks = NULL;
+struct t_hashtable *gui_bar_item_updates_pending = NULL;
+                                       /* items to update on next refresh  */
 struct t_hook *gui_bar_item_timer = NULL;
 
 struct t_hdata *gui_bar_item_hdata_bar_item = NULL;
@@ -396,6 +398,11 @@ gui_bar_item_get_value (struct t_gui_bar *bar, struct t_gui_window *window,
         ptr_item = gui_bar_item_search_with_plugin ((buffer) ? buffer->plugin : NULL,
                                                     0,
                                                     bar->items_name[item][subitem]);
+        if (!ptr_item && plugin_lazy_plugins)
+        {
+            /* load plugin waiting for its first use (if item belongs to it) */
+            plugin_lazy_load_name (bar->items_name[item][subitem], 1);
+        }
         if (ptr_item && ptr_item->build_callback)
         {
             item_value = (ptr_item->build_callback) (
@@ -665,6 +672,85 @@ gui_bar_item_update (const char *item_name)
     }
 }
 
+/*
+ * Asks for update of a bar item: the update is done only once on next
+ * refresh, even if it is asked many times before.
+ */
+
+void
+gui_bar_item_ask_update (const char *item_name)
+{
+    if (!item_name)
+        return;
+
+    if (!gui_bar_item_updates_pending)
+    {
+        gui_bar_item_updates_pending = hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!gui_bar_item_updates_pending)
+        {
+            gui_bar_item_update (item_name);
+            return;
+        }
+    }
+
+    hashtable_set (gui_bar_item_updates_pending, item_name, NULL);
+}
+
+/*
+ * Callback for updating a bar item (called for each item in hashtable
+ * gui_bar_item_updates_pending).
+ */
+
+void
+gui_bar_item_update_pending_map_cb (void *data,
+                                    struct t_hashtable *hashtable,
+                                    const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) hashtable;
+    (void) value;
+
+    gui_bar_item_update ((const char *)key);
+}
+
+/*
+ * Updates bar items asked with gui_bar_item_ask_update (called on each
+ * refresh, before bars are drawn).
+ */
+
+void
+gui_bar_item_update_pending ()
+{
+    struct t_hashtable *updates;
+
+    if (!gui_bar_item_updates_pending
+        || (gui_bar_item_updates_pending->items_count == 0))
+    {
+        return;
+    }
+
+    /* updates asked during the update of items are done on next refresh */
+    updates = gui_bar_item_updates_pending;
+    gui_bar_item_updates_pending = NULL;
+
+    hashtable_map (updates, &gui_bar_item_update_pending_map_cb, NULL);
+
+    if (gui_bar_item_updates_pending)
+    {
+        hashtable_free (updates);
+    }
+    else
+    {
+        hashtable_remove_all (updates);
+        gui_bar_item_updates_pending = updates;
+    }
+}
+
 /*
  * Deletes a bar item.
  */
@@ -1659,148 +1745,296 @@ gui_bar_item_buffer_title_cb (const void *pointer, void *data,
 }
 
 /*
- * Bar item with nicklist.
+ * Checks if a group or a nick is displayed in nicklist bar item.
+ *
+ * Returns:
+ *   1: group/nick is displayed
+ *   0: group/nick is not displayed
+ */
+
+int
+gui_bar_item_nicklist_is_displayed (struct t_gui_buffer *buffer,
+                                    struct t_gui_nick_group *group,
+                                    struct t_gui_nick *nick)
+{
+    return ((nick && nick->visible)
+            || (group && !nick
+                && buffer->nicklist_display_groups
+                && group->visible)) ? 1 : 0;
+}
+
+/*
+ * Gets max length of a group or a nick in nicklist bar item (including
+ * color codes).
+ */
+
+int
+gui_bar_item_nicklist_get_max_length (struct t_gui_nick_group *group,
+                                      struct t_gui_nick *nick)
+{
+    if (nick)
+    {
+        return nick->group->level + 16 /* color */
+            + ((nick->prefix) ? strlen (nick->prefix) : 0)
+            + 16 /* color */
+            + strlen (nick->name);
+    }
+
+    return group->level - 1
+        + 16 /* color */
+        + strlen (gui_nicklist_get_group_start (group->name));
+}
+
+/*
+ * Gets color code for a color of group/nick in nicklist bar item (the color
+ * can be a color name or an option name, like "weechat.color.chat_nick").
+ *
+ * Returns NULL if the color is not found.
+ */
+
+const char *
+gui_bar_item_nicklist_get_color (const char *color)
+{
+    struct t_config_option *ptr_option;
+
+    if (!color)
+        return NULL;
+
+    if (strchr (color, '.'))
+    {
+        config_file_search_with_string (color, NULL, NULL, &ptr_option, NULL);
+        return (ptr_option) ?
+            gui_color_get_custom (gui_color_get_name (CONFIG_COLOR(ptr_option))) :
+            NULL;
+    }
+
+    return gui_color_get_custom (color);
+}
+
+/*
+ * Adds a string at the end of nicklist, and returns pointer to the end of
+ * nicklist.
  */
 
 char *
-gui_bar_item_buffer_nicklist_cb (const void *pointer, void *data,
-                                 struct t_gui_bar_item *item,
-                                 struct t_gui_window *window,
-                                 struct t_gui_buffer *buffer,
-                                 struct t_hashtable *extra_info)
+gui_bar_item_nicklist_add_string (char *ptr_nicklist, const char *string)
+{
+    int length;
+
+    if (string)
+    {
+        length = strlen (string);
+        memcpy (ptr_nicklist, string, length);
+        ptr_nicklist += length;
+    }
+    return ptr_nicklist;
+}
+
+/*
+ * Adds a group or a nick at the end of nicklist, and returns pointer to the
+ * end of nicklist.
+ */
+
+char *
+gui_bar_item_nicklist_add_item (struct t_gui_buffer *buffer,
+                                char *ptr_nicklist,
+                                struct t_gui_nick_group *group,
+                                struct t_gui_nick *nick)
+{
+    int i;
+
+    if (nick)
+    {
+        if (buffer->nicklist_display_groups)
+        {
+            for (i = 0; i < nick->group->level; i++)
+            {
+                *(ptr_nicklist++) = ' ';
+            }
+        }
+        ptr_nicklist = gui_bar_item_nicklist_add_string (
+            ptr_nicklist,
+            gui_bar_item_nicklist_get_color (nick->prefix_color));
+        ptr_nicklist = gui_bar_item_nicklist_add_string (ptr_nicklist,
+                                                         nick->prefix);
+        ptr_nicklist = gui_bar_item_nicklist_add_string (
+            ptr_nicklist,
+            gui_bar_item_nicklist_get_color (nick->color));
+        ptr_nicklist = gui_bar_item_nicklist_add_string (ptr_nicklist,
+                                                         nick->name);
+    }
+    else
+    {
+        for (i = 0; i < group->level - 1; i++)
+        {
+            *(ptr_nicklist++) = ' ';
+        }
+        ptr_nicklist = gui_bar_item_nicklist_add_string (
+            ptr_nicklist,
+            gui_bar_item_nicklist_get_color (group->color));
+        ptr_nicklist = gui_bar_item_nicklist_add_string (
+            ptr_nicklist,
+            gui_nicklist_get_group_start (group->name));
+    }
+
+    return ptr_nicklist;
+}
+
+/*
+ * Counts number of lines in nicklist bar item (groups and nicks displayed).
+ *
+ * If max_length is not NULL, it is set to the max length of lines on screen.
+ */
+
+int
+gui_bar_item_buffer_nicklist_count_lines (struct t_gui_buffer *buffer,
+                                          int *max_length)
 {
     struct t_gui_nick_group *ptr_group;
     struct t_gui_nick *ptr_nick;
-    struct t_config_option *ptr_option;
-    int i, length;
-    char *str_nicklist;
+    int count, length;
 
-    /* make C compiler happy */
-    (void) pointer;
-    (void) data;
-    (void) item;
-    (void) window;
-    (void) extra_info;
+    if (max_length)
+        *max_length = 0;
 
     if (!buffer)
-        return NULL;
+        return 0;
 
-    length = 1;
+    count = 0;
     ptr_group = NULL;
     ptr_nick = NULL;
     gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
     while (ptr_group || ptr_nick)
     {
-        if ((ptr_nick && ptr_nick->visible)
-            || (ptr_group && !ptr_nick
-                && buffer->nicklist_display_groups
-                && ptr_group->visible))
+        if (gui_bar_item_nicklist_is_displayed (buffer, ptr_group, ptr_nick))
         {
-            if (ptr_nick)
-                length += ptr_nick->group->level + 16 /* color */
-                    + ((ptr_nick->prefix) ? strlen (ptr_nick->prefix) : 0)
-                    + 16 /* color */
-                    + strlen (ptr_nick->name) + 1;
-            else
-                length += ptr_group->level - 1
-                    + 16 /* color */
-                    + strlen (gui_nicklist_get_group_start (ptr_group->name))
-                    + 1;
-        }
-        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
-    }
-
-    str_nicklist = malloc (length);
-    if (str_nicklist)
-    {
-        str_nicklist[0] = '\0';
-        ptr_group = NULL;
-        ptr_nick = NULL;
-        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
-        while (ptr_group || ptr_nick)
-        {
-            if ((ptr_nick && ptr_nick->visible)
-                || (ptr_group && !ptr_nick
-                    && buffer->nicklist_display_groups
-                    && ptr_group->visible))
+            count++;
+            if (max_length)
             {
-                if (str_nicklist[0])
-                    strcat (str_nicklist, "\n");
-
                 if (ptr_nick)
                 {
-                    if (buffer->nicklist_display_groups)
-                    {
-                        for (i = 0; i < ptr_nick->group->level; i++)
-                        {
-                            strcat (str_nicklist, " ");
-                        }
-                    }
-                    if (ptr_nick->prefix_color)
-                    {
-                        if (strchr (ptr_nick->prefix_color, '.'))
-                        {
-                            config_file_search_with_string (ptr_nick->prefix_color,
-                                                            NULL, NULL, &ptr_option,
-                                                            NULL);
-                            if (ptr_option)
-                                strcat (str_nicklist, gui_color_get_custom (gui_color_get_name (CONFIG_COLOR(ptr_option))));
-                        }
-                        else
-                        {
-                            strcat (str_nicklist, gui_color_get_custom (ptr_nick->prefix_color));
-                        }
-                    }
-                    if (ptr_nick->prefix)
-                        strcat (str_nicklist, ptr_nick->prefix);
-                    if (ptr_nick->color)
-                    {
-                        if (strchr (ptr_nick->color, '.'))
-                        {
-                            config_file_search_with_string (ptr_nick->color,
-                                                            NULL, NULL, &ptr_option,
-                                                            NULL);
-                            if (ptr_option)
-                                strcat (str_nicklist, gui_color_get_custom (gui_color_get_name (CONFIG_COLOR(ptr_option))));
-                        }
-                        else
-                        {
-                            strcat (str_nicklist, gui_color_get_custom (ptr_nick->color));
-                        }
-                    }
-                    strcat (str_nicklist, ptr_nick->name);
+                    length = ((buffer->nicklist_display_groups) ?
+                              ptr_nick->group->level : 0)
+                        + ((ptr_nick->prefix) ?
+                           gui_chat_strlen_screen (ptr_nick->prefix) : 0)
+                        + gui_chat_strlen_screen (ptr_nick->name);
                 }
                 else
                 {
-                    for (i = 0; i < ptr_group->level - 1; i++)
-                    {
-                        strcat (str_nicklist, " ");
-                    }
-                    if (ptr_group->color)
-                    {
-                        if (strchr (ptr_group->color, '.'))
-                        {
-                            config_file_search_with_string (ptr_group->color,
-                                                            NULL, NULL, &ptr_option,
-                                                            NULL);
-                            if (ptr_option)
-                                strcat (str_nicklist, gui_color_get_custom (gui_color_get_name (CONFIG_COLOR(ptr_option))));
-                        }
-                        else
-                        {
-                            strcat (str_nicklist, gui_color_get_custom (ptr_group->color));
-                        }
-                    }
-                    strcat (str_nicklist, gui_nicklist_get_group_start (ptr_group->name));
+                    length = ptr_group->level - 1
+                        + gui_chat_strlen_screen (
+                            gui_nicklist_get_group_start (ptr_group->name));
                 }
+                if (length > *max_length)
+                    *max_length = length;
             }
-            gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
         }
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    }
+
+    return count;
+}
+
+/*
+ * Builds content of nicklist bar item: "count" lines starting at line
+ * "start" (count = -1 for all lines).
+ *
+ * The bar window asks only lines displayed (see function
+ * gui_bar_window_content_build_virtual), the whole nicklist is built for
+ * other callers of the bar item (like scripts).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_bar_item_buffer_nicklist_build (struct t_gui_buffer *buffer,
+                                    int start, int count)
+{
+    struct t_gui_nick_group *ptr_group, *ptr_first_group;
+    struct t_gui_nick *ptr_nick, *ptr_first_nick;
+    int index, lines, length;
+    char *str_nicklist, *ptr_nicklist;
+
+    if (!buffer)
+        return NULL;
+
+    /* skip lines before "start" */
+    index = 0;
+    ptr_group = NULL;
+    ptr_nick = NULL;
+    gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    while ((ptr_group || ptr_nick) && (index < start))
+    {
+        if (gui_bar_item_nicklist_is_displayed (buffer, ptr_group, ptr_nick))
+            index++;
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    }
+    ptr_first_group = ptr_group;
+    ptr_first_nick = ptr_nick;
+
+    /* compute length of lines */
+    length = 1;
+    lines = 0;
+    while ((ptr_group || ptr_nick) && ((count < 0) || (lines < count)))
+    {
+        if (gui_bar_item_nicklist_is_displayed (buffer, ptr_group, ptr_nick))
+        {
+            length += gui_bar_item_nicklist_get_max_length (ptr_group,
+                                                            ptr_nick) + 1;
+            lines++;
+        }
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
     }
 
+    str_nicklist = malloc (length);
+    if (!str_nicklist)
+        return NULL;
+
+    /* build lines */
+    ptr_nicklist = str_nicklist;
+    ptr_group = ptr_first_group;
+    ptr_nick = ptr_first_nick;
+    lines = 0;
+    while ((ptr_group || ptr_nick) && ((count < 0) || (lines < count)))
+    {
+        if (gui_bar_item_nicklist_is_displayed (buffer, ptr_group, ptr_nick))
+        {
+            if (lines > 0)
+                *(ptr_nicklist++) = '\n';
+            ptr_nicklist = gui_bar_item_nicklist_add_item (buffer,
+                                                           ptr_nicklist,
+                                                           ptr_group,
+                                                           ptr_nick);
+            lines++;
+        }
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    }
+    ptr_nicklist[0] = '\0';
+
     return str_nicklist;
 }
 
+/*
+ * Bar item with nicklist.
+ */
+
+char *
+gui_bar_item_buffer_nicklist_cb (const void *pointer, void *data,
+                                 struct t_gui_bar_item *item,
+                                 struct t_gui_window *window,
+                                 struct t_gui_buffer *buffer,
+                                 struct t_hashtable *extra_info)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) item;
+    (void) window;
+    (void) extra_info;
+
+    return gui_bar_item_buffer_nicklist_build (buffer, 0, -1);
+}
+
 /*
  * Bar item with number of window.
  */
@@ -2036,7 +2270,8 @@ gui_bar_item_timer_cb (const void *pointer, void *data, int remaining_calls)
 }
 
 /*
- * Callback when a signal is received: rebuilds an item.
+ * Callback when a signal is received: asks update of items depending on this
+ * signal (items are rebuilt only once on next refresh).
  */
 
 int
@@ -2044,35 +2279,87 @@ gui_bar_item_signal_cb (const void *pointer, void *data,
                         const char *signal,
                         const char *type_data, void *signal_data)
 {
+    struct t_gui_bar_item_hook *bar_item_hook;
+    int i;
+
     /* make C compiler happy */
     (void) data;
     (void) signal;
     (void) type_data;
     (void) signal_data;
 
-    gui_bar_item_update ((char *)pointer);
+    bar_item_hook = (struct t_gui_bar_item_hook *)pointer;
+
+    for (i = 0; i < bar_item_hook->items_count; i++)
+    {
+        gui_bar_item_ask_update (bar_item_hook->items[i]);
+    }
 
     return WEECHAT_RC_OK;
 }
 
 /*
- * Hooks a signal to update bar items.
+ * Declares that an item depends on a signal: the item is updated when the
+ * signal is received.
+ *
+ * Only one hook is created by signal, with the list of items depending on
+ * this signal.
  */
 
 void
 gui_bar_item_hook_signal (const char *signal, const char *item)
 {
-    struct t_gui_bar_item_hook *bar_item_hook;
+    struct t_gui_bar_item_hook *ptr_hook, *bar_item_hook;
+    const char **new_items;
+    int i;
+
+    for (ptr_hook = gui_bar_item_hooks; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (strcmp (ptr_hook->signal, signal) == 0)
+            break;
+    }
+
+    if (ptr_hook)
+    {
+        for (i = 0; i < ptr_hook->items_count; i++)
+        {
+            if (strcmp (ptr_hook->items[i], item) == 0)
+                return;
+        }
+        new_items = realloc (ptr_hook->items,
+                             (ptr_hook->items_count + 1) *
+                             sizeof (*ptr_hook->items));
+        if (!new_items)
+            return;
+        ptr_hook->items = new_items;
+        ptr_hook->items[ptr_hook->items_count] = item;
+        ptr_hook->items_count++;
+        return;
+    }
 
     bar_item_hook = malloc (sizeof (*bar_item_hook));
-    if (bar_item_hook)
+    if (!bar_item_hook)
+        return;
+
+    bar_item_hook->signal = strdup (signal);
+    bar_item_hook->items = malloc (sizeof (*bar_item_hook->items));
+    if (!bar_item_hook->signal || !bar_item_hook->items)
     {
-        bar_item_hook->hook = hook_signal (NULL, signal,
-                                           &gui_bar_item_signal_cb,
-                                           (void *)item, NULL);
-        bar_item_hook->next_hook = gui_bar_item_hooks;
-        gui_bar_item_hooks = bar_item_hook;
+        if (bar_item_hook->signal)
+            free (bar_item_hook->signal);
+        if (bar_item_hook->items)
+            free (bar_item_hook->items);
+        free (bar_item_hook);
+        return;
     }
+    bar_item_hook->items[0] = item;
+    bar_item_hook->items_count = 1;
+    bar_item_hook->hook = hook_signal (NULL, signal,
+                                       &gui_bar_item_signal_cb,
+                                       bar_item_hook, NULL);
+    bar_item_hook->next_hook = gui_bar_item_hooks;
+    gui_bar_item_hooks = bar_item_hook;
 }
 
 /*
@@ -2351,11 +2638,20 @@ gui_bar_item_end ()
         next_bar_item_hook = gui_bar_item_hooks->next_hook;
 
         unhook (gui_bar_item_hooks->hook);
+        free (gui_bar_item_hooks->signal);
+        free (gui_bar_item_hooks->items);
         free (gui_bar_item_hooks);
 
         gui_bar_item_hooks = next_bar_item_hook;
     }
 
+    /* remove pending updates */
+    if (gui_bar_item_updates_pending)
+    {
+        hashtable_free (gui_bar_item_updates_pending);
+        gui_bar_item_updates_pending = NULL;
+    }
+
     /* remove bar items */
     gui_bar_item_free_all ();
 }
@@ -71,6 +71,9 @@ struct t_gui_bar_item
 struct t_gui_bar_item_hook
 {
     struct t_hook *hook;                   /* pointer to hook               */
+    char *signal;                          /* signal hooked (can be a mask) */
+    const char **items;                    /* items depending on the signal */
+    int items_count;                       /* number of items               */
     struct t_gui_bar_item_hook *next_hook; /* next hook                     */
 };
 
@@ -85,6 +88,9 @@ extern char *gui_bar_items_default_for_bars[][2];
 
 extern int gui_bar_item_valid (struct t_gui_bar_item *bar_item);
 extern struct t_gui_bar_item *gui_bar_item_search (const char *name);
+extern struct t_gui_bar_item *gui_bar_item_search_with_plugin (struct t_weechat_plugin *plugin,
+                                                               int exact_plugin,
+                                                               const char *item_name);
 extern int gui_bar_item_used_in_bar (struct t_gui_bar *bar,
                                      const char *item_name,
                                      int partial_name);
@@ -98,6 +104,10 @@ extern char *gui_bar_item_get_value (struct t_gui_bar *bar,
                                      struct t_gui_window *window,
                                      int item, int subitem);
 extern int gui_bar_item_count_lines (char *string);
+extern int gui_bar_item_buffer_nicklist_count_lines (struct t_gui_buffer *buffer,
+                                                     int *max_length);
+extern char *gui_bar_item_buffer_nicklist_build (struct t_gui_buffer *buffer,
+                                                 int start, int count);
 extern struct t_gui_bar_item *gui_bar_item_new (struct t_weechat_plugin *plugin,
                                                 const char *name,
                                                 char *(*build_callback)(const void *pointer,
@@ -109,6 +119,8 @@ extern struct t_gui_bar_item *gui_bar_item_new (struct t_weechat_plugin *plugin,
                                                 const void *build_callback_pointer,
                                                 void *build_callback_data);
 extern void gui_bar_item_update (const char *name);
+extern void gui_bar_item_ask_update (const char *item_name);
+extern void gui_bar_item_update_pending ();
 extern void gui_bar_item_free (struct t_gui_bar_item *item);
 extern void gui_bar_item_free_all ();
 extern void gui_bar_item_free_all_plugin (struct t_weechat_plugin *plugin);
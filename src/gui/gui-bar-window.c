@@ -450,6 +450,9 @@ gui_bar_window_content_alloc (struct t_gui_bar_window *bar_window)
     bar_window->items_refresh_needed = NULL;
     bar_window->screen_col_size = 0;
     bar_window->screen_lines = 0;
+    bar_window->virtual_start = -1;
+    bar_window->virtual_height = 0;
+    bar_window->virtual_max_length = 0;
     bar_window->items_subcount = calloc (1,
                                          bar_window->items_count *
                                          sizeof (*bar_window->items_subcount));
@@ -582,6 +585,94 @@ gui_bar_window_content_free (struct t_gui_bar_window *bar_window)
     }
 }
 
+/*
+ * Builds virtual content of an item for a bar window: if the bar has only
+ * the item "buffer_nicklist" (with vertical filling, on left/right), only the
+ * lines displayed are built (from line "scroll_y", for "height" lines), and
+ * the number of lines of item is the number of lines in whole nicklist.
+ *
+ * Returns:
+ *   1: virtual content built
+ *   0: item can not have virtual content (content must be built by item
+ *      callback)
+ */
+
+int
+gui_bar_window_content_build_virtual (struct t_gui_bar_window *bar_window,
+                                      struct t_gui_window *window,
+                                      int index_item, int index_subitem)
+{
+    struct t_gui_bar *ptr_bar;
+    struct t_gui_bar_item *ptr_item;
+    struct t_gui_buffer *buffer;
+    char *content;
+    int position, lines, max_length;
+
+    ptr_bar = bar_window->bar;
+
+    if ((bar_window->items_count != 1)
+        || (bar_window->items_subcount[0] != 1)
+        || !ptr_bar->items_name[index_item][index_subitem]
+        || (strcmp (ptr_bar->items_name[index_item][index_subitem],
+                    gui_bar_item_names[GUI_BAR_ITEM_BUFFER_NICKLIST]) != 0)
+        || ptr_bar->items_buffer[index_item][index_subitem]
+        || ptr_bar->items_prefix[index_item][index_subitem]
+        || ptr_bar->items_suffix[index_item][index_subitem]
+        || (gui_bar_get_filling (ptr_bar) != GUI_BAR_FILLING_VERTICAL))
+    {
+        return 0;
+    }
+
+    position = CONFIG_INTEGER(ptr_bar->options[GUI_BAR_OPTION_POSITION]);
+    if ((position != GUI_BAR_POSITION_LEFT)
+        && (position != GUI_BAR_POSITION_RIGHT))
+    {
+        return 0;
+    }
+
+    buffer = (window) ?
+        window->buffer : ((gui_current_window) ? gui_current_window->buffer : NULL);
+    if (!buffer)
+        return 0;
+
+    /* the item must be the core item (not an item defined by a plugin) */
+    ptr_item = gui_bar_item_search_with_plugin (buffer->plugin, 0,
+                                                ptr_bar->items_name[index_item][index_subitem]);
+    if (!ptr_item || ptr_item->plugin)
+        return 0;
+
+    lines = gui_bar_item_buffer_nicklist_count_lines (
+        buffer,
+        (CONFIG_INTEGER(ptr_bar->options[GUI_BAR_OPTION_SIZE]) == 0) ?
+        &max_length : NULL);
+    if (CONFIG_INTEGER(ptr_bar->options[GUI_BAR_OPTION_SIZE]) != 0)
+        max_length = 0;
+
+    if (bar_window->scroll_y > lines - bar_window->height)
+        bar_window->scroll_y = lines - bar_window->height;
+    if (bar_window->scroll_y < 0)
+        bar_window->scroll_y = 0;
+
+    content = gui_bar_item_buffer_nicklist_build (buffer,
+                                                  bar_window->scroll_y,
+                                                  bar_window->height);
+    if (content && !content[0])
+    {
+        free (content);
+        content = NULL;
+    }
+
+    bar_window->items_content[index_item][index_subitem] = content;
+    bar_window->items_num_lines[index_item][index_subitem] = (content) ?
+        lines : 0;
+    bar_window->items_refresh_needed[index_item][index_subitem] = 0;
+    bar_window->virtual_start = bar_window->scroll_y;
+    bar_window->virtual_height = bar_window->height;
+    bar_window->virtual_max_length = max_length;
+
+    return 1;
+}
+
 /*
  * Builds content of an item for a bar window.
  */
@@ -603,10 +694,18 @@ gui_bar_window_content_build_item (struct t_gui_bar_window *bar_window,
         }
         bar_window->items_num_lines[index_item][index_subitem] = 0;
 
+        bar_window->virtual_start = -1;
+
         /* build item, but only if there's a buffer in window */
         if ((window && window->buffer)
             || (gui_current_window && gui_current_window->buffer))
         {
+            if (gui_bar_window_content_build_virtual (bar_window, window,
+                                                      index_item,
+                                                      index_subitem))
+            {
+                return;
+            }
             bar_window->items_content[index_item][index_subitem] =
                 gui_bar_item_get_value (bar_window->bar, window,
                                         index_item, index_subitem);
@@ -655,8 +754,14 @@ gui_bar_window_content_get (struct t_gui_bar_window *bar_window,
     if (!bar_window)
         return NULL;
 
-    /* rebuild content if refresh is needed */
-    if (bar_window->items_refresh_needed[index_item][index_subitem])
+    /*
+     * rebuild content if refresh is needed (or if the virtual content does
+     * not match lines displayed)
+     */
+    if (bar_window->items_refresh_needed[index_item][index_subitem]
+        || ((bar_window->virtual_start >= 0)
+            && ((bar_window->virtual_start != bar_window->scroll_y)
+                || (bar_window->virtual_height != bar_window->height))))
     {
         gui_bar_window_content_build_item (bar_window, window,
                                            index_item, index_subitem);
@@ -1156,6 +1261,9 @@ gui_bar_window_new (struct t_gui_bar *bar, struct t_gui_window *window)
         new_bar_window->items_refresh_needed = NULL;
         new_bar_window->screen_col_size = 0;
         new_bar_window->screen_lines = 0;
+        new_bar_window->virtual_start = -1;
+        new_bar_window->virtual_height = 0;
+        new_bar_window->virtual_max_length = 0;
         new_bar_window->coords_count = 0;
         new_bar_window->coords = NULL;
         gui_bar_window_objects_init (new_bar_window);
@@ -1554,6 +1662,9 @@ gui_bar_window_hdata_bar_window_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_bar_window, items_refresh_needed, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_bar_window, screen_col_size, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_bar_window, screen_lines, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_bar_window, virtual_start, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_bar_window, virtual_height, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_bar_window, virtual_max_length, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_bar_window, coords_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_bar_window, coords, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_bar_window, gui_objects, POINTER, 0, NULL, NULL);
@@ -1684,6 +1795,9 @@ gui_bar_window_print_log (struct t_gui_bar_window *bar_window)
     }
     log_printf ("    screen_col_size. . . . : %d", bar_window->screen_col_size);
     log_printf ("    screen_lines . . . . . : %d", bar_window->screen_lines);
+    log_printf ("    virtual_start. . . . . : %d",    bar_window->virtual_start);
+    log_printf ("    virtual_height . . . . : %d",    bar_window->virtual_height);
+    log_printf ("    virtual_max_length . . : %d",    bar_window->virtual_max_length);
     log_printf ("    coords_count . . . . . : %d", bar_window->coords_count);
     for (i = 0; i < bar_window->coords_count; i++)
     {
@@ -52,6 +52,11 @@ struct t_gui_bar_window
                                     /* (for filling with columns)           */
     int screen_lines;               /* number of lines on screen            */
                                     /* (for filling with columns)           */
+    int virtual_start;              /* first line in virtual content        */
+                                    /* (-1 if content is not virtual)       */
+    int virtual_height;             /* height for virtual content           */
+    int virtual_max_length;         /* max length of all lines on screen    */
+                                    /* (for virtual content)                */
     int coords_count;               /* number of coords saved               */
     struct t_gui_bar_window_coords **coords; /* coords for filling horiz.   */
                                     /* (size is 5 * coords_count)           */
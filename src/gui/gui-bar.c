@@ -435,7 +435,10 @@ gui_bar_check_conditions (struct t_gui_bar *bar,
                                  WEECHAT_HASHTABLE_POINTER,
                                  NULL, NULL);
         if (options)
+        {
             hashtable_set (options, "type", "condition");
+            hashtable_set (options, "cache", "1");
+        }
 
         result = eval_expression (conditions, pointers, extra_vars, options);
 
@@ -56,6 +56,7 @@
 #include "gui-key.h"
 #include "gui-layout.h"
 #include "gui-line.h"
+#include "gui-line-cold.h"
 #include "gui-main.h"
 #include "gui-nicklist.h"
 #include "gui-window.h"
@@ -64,6 +65,10 @@
 struct t_gui_buffer *gui_buffers = NULL;           /* first buffer          */
 struct t_gui_buffer *last_gui_buffer = NULL;       /* last buffer           */
 int gui_buffers_count = 0;                         /* number of buffers     */
+struct t_hashtable *gui_buffers_by_full_name = NULL; /* index: full name ->  */
+                                                     /* buffer              */
+struct t_hashtable *gui_buffer_properties = NULL;  /* index: property name  */
+                                                   /* -> property id        */
 
 /* history of last visited buffers */
 struct t_gui_buffer_visited *gui_buffers_visited = NULL;
@@ -76,6 +81,28 @@ struct t_gui_buffer *gui_buffer_last_displayed = NULL; /* last b. displayed */
 char *gui_buffer_notify_string[GUI_BUFFER_NUM_NOTIFY] =
 { "none", "highlight", "message", "all" };
 
+char *gui_buffer_property_string[GUI_BUFFER_NUM_PROPERTIES] =
+{ "number", "layout_number", "layout_number_merge_order", "short_name_is_set",
+  "type", "notify", "num_displayed", "active", "hidden", "zoomed",
+  "print_hooks_enabled", "day_change", "clear", "filter", "closing",
+  "lines_hidden", "prefix_max_length", "time_for_each_line", "nicklist",
+  "nicklist_case_sensitive", "nicklist_max_length", "nicklist_display_groups",
+  "nicklist_count", "nicklist_groups_count", "nicklist_nicks_count",
+  "nicklist_visible_count", "nicklist_batch", "lines_batch", "input",
+  "input_get_unknown_commands", "input_multiline", "input_size",
+  "input_length", "input_pos", "input_1st_display", "num_history",
+  "text_search", "text_search_exact", "text_search_regex",
+  "text_search_where", "text_search_found", "plugin", "name", "full_name",
+  "short_name", "title", "text_search_input", "highlight_words",
+  "highlight_regex", "highlight_tags_restrict", "highlight_tags",
+  "hotlist_max_level_nicks", "text_search_regex_compiled",
+  "highlight_regex_compiled", "hotlist", "completion_freeze", "unread",
+  "display", "highlight_words_add", "highlight_words_del",
+  "hotlist_max_level_nicks_add", "hotlist_max_level_nicks_del",
+  "close_callback", "close_callback_pointer", "close_callback_data",
+  "nickcmp_callback", "nickcmp_callback_pointer", "nickcmp_callback_data",
+  "input_callback", "input_callback_pointer", "input_callback_data" };
+
 char *gui_buffer_properties_get_integer[] =
 { "number", "layout_number", "layout_number_merge_order", "type", "notify",
   "num_displayed", "active", "hidden", "zoomed", "print_hooks_enabled",
@@ -83,7 +110,8 @@ char *gui_buffer_properties_get_integer[] =
   "prefix_max_length", "time_for_each_line", "nicklist",
   "nicklist_case_sensitive", "nicklist_max_length", "nicklist_display_groups",
   "nicklist_count", "nicklist_groups_count", "nicklist_nicks_count",
-  "nicklist_visible_count", "input", "input_get_unknown_commands",
+  "nicklist_visible_count", "nicklist_batch", "lines_batch", "input",
+  "input_get_unknown_commands", "input_multiline",
   "input_size", "input_length", "input_pos", "input_1st_display",
   "num_history", "text_search", "text_search_exact", "text_search_regex",
   "text_search_where", "text_search_found",
@@ -103,11 +131,13 @@ char *gui_buffer_properties_set[] =
 { "hotlist", "unread", "display", "hidden", "print_hooks_enabled", "day_change",
   "clear", "filter", "number", "name", "short_name", "type", "notify", "title",
   "time_for_each_line", "nicklist", "nicklist_case_sensitive",
-  "nicklist_display_groups", "highlight_words", "highlight_words_add",
+  "nicklist_display_groups", "nicklist_batch", "lines_batch",
+  "highlight_words",
+  "highlight_words_add",
   "highlight_words_del", "highlight_regex", "highlight_tags_restrict",
   "highlight_tags", "hotlist_max_level_nicks", "hotlist_max_level_nicks_add",
   "hotlist_max_level_nicks_del", "input", "input_pos",
-  "input_get_unknown_commands",
+  "input_get_unknown_commands", "input_multiline",
   NULL
 };
 
@@ -146,6 +176,67 @@ gui_buffer_get_short_name (struct t_gui_buffer *buffer)
     return (buffer->short_name) ? buffer->short_name : buffer->name;
 }
 
+/*
+ * Adds a buffer in index of buffers by full name.
+ *
+ * If another buffer has the same full name, the index is not changed.
+ */
+
+void
+gui_buffer_index_add (struct t_gui_buffer *buffer)
+{
+    if (!buffer->full_name)
+        return;
+
+    if (!gui_buffers_by_full_name)
+    {
+        gui_buffers_by_full_name = hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!gui_buffers_by_full_name)
+            return;
+    }
+
+    if (!hashtable_has_key (gui_buffers_by_full_name, buffer->full_name))
+        hashtable_set (gui_buffers_by_full_name, buffer->full_name, buffer);
+}
+
+/*
+ * Removes a buffer from index of buffers by full name.
+ *
+ * If another buffer has the same full name, it is added in index.
+ */
+
+void
+gui_buffer_index_remove (struct t_gui_buffer *buffer)
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    if (!gui_buffers_by_full_name || !buffer->full_name)
+        return;
+
+    if (hashtable_get (gui_buffers_by_full_name,
+                       buffer->full_name) != buffer)
+        return;
+
+    hashtable_remove (gui_buffers_by_full_name, buffer->full_name);
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        if ((ptr_buffer != buffer)
+            && ptr_buffer->full_name
+            && (strcmp (ptr_buffer->full_name, buffer->full_name) == 0))
+        {
+            hashtable_set (gui_buffers_by_full_name, ptr_buffer->full_name,
+                           ptr_buffer);
+            break;
+        }
+    }
+}
+
 /*
  * Builds "full_name" of buffer (for example after changing name or
  * plugin_name_for_upgrade).
@@ -160,7 +251,10 @@ gui_buffer_build_full_name (struct t_gui_buffer *buffer)
         return;
 
     if (buffer->full_name)
+    {
+        gui_buffer_index_remove (buffer);
         free (buffer->full_name);
+    }
     length = strlen (gui_buffer_get_plugin_name (buffer)) + 1 +
         strlen (buffer->name) + 1;
     buffer->full_name = malloc (length);
@@ -168,6 +262,7 @@ gui_buffer_build_full_name (struct t_gui_buffer *buffer)
     {
         snprintf (buffer->full_name, length, "%s.%s",
                   gui_buffer_get_plugin_name (buffer), buffer->name);
+        gui_buffer_index_add (buffer);
     }
 }
 
@@ -412,10 +507,12 @@ gui_buffer_insert (struct t_gui_buffer *buffer)
     /*
      * if position was not forced by layout and that buffer position is set
      * to "first gap", search for the first available number in the list
-     * (if there is not, buffer will be added to the end of list)
+     * (if there is not, buffer will be added to the end of list); with auto
+     * renumber, there is no gap in numbers, so the search is skipped
      */
     if (!pos_buffer
         && (buffer->layout_number == 0)
+        && !CONFIG_BOOLEAN(config_look_buffer_auto_renumber)
         && (CONFIG_INTEGER(config_look_buffer_position) == CONFIG_LOOK_BUFFER_POSITION_FIRST_GAP))
     {
         for (ptr_buffer = gui_buffers; ptr_buffer;
@@ -637,8 +734,16 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->own_lines = gui_lines_alloc ();
     new_buffer->mixed_lines = NULL;
     new_buffer->lines = new_buffer->own_lines;
+    new_buffer->lines_cold = NULL;
+    new_buffer->lines_added = 0;
     new_buffer->time_for_each_line = 1;
     new_buffer->chat_refresh_needed = 2;
+    new_buffer->lines_batch = 0;
+    new_buffer->lines_batch_count = 0;
+    new_buffer->lines_batch_hidden = 0;
+    new_buffer->lines_batch_removed = 0;
+    new_buffer->lines_batch_hotlist = NULL;
+    new_buffer->lines_batch_top_line = NULL;
 
     /* nicklist */
     new_buffer->nicklist = 0;
@@ -650,9 +755,19 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->nicklist_groups_count = 0;
     new_buffer->nicklist_nicks_count = 0;
     new_buffer->nicklist_visible_count = 0;
+    new_buffer->nicklist_batch = 0;
+    new_buffer->nicklist_batch_changes = 0;
     new_buffer->nickcmp_callback = NULL;
     new_buffer->nickcmp_callback_pointer = NULL;
     new_buffer->nickcmp_callback_data = NULL;
+    new_buffer->nicklist_nicks_index = hashtable_new (32,
+                                                      WEECHAT_HASHTABLE_STRING,
+                                                      WEECHAT_HASHTABLE_POINTER,
+                                                      NULL, NULL);
+    new_buffer->nicklist_groups_index = hashtable_new (32,
+                                                       WEECHAT_HASHTABLE_STRING,
+                                                       WEECHAT_HASHTABLE_POINTER,
+                                                       NULL, NULL);
     gui_nicklist_add_group (new_buffer, NULL, "root", NULL, 0);
 
     /* input */
@@ -661,6 +776,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->input_callback_pointer = input_callback_pointer;
     new_buffer->input_callback_data = input_callback_data;
     new_buffer->input_get_unknown_commands = 0;
+    new_buffer->input_multiline = 0;
     gui_buffer_input_buffer_init (new_buffer);
 
     /* undo for input */
@@ -687,6 +803,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->last_history = NULL;
     new_buffer->ptr_history = NULL;
     new_buffer->num_history = 0;
+    new_buffer->history_index = NULL;
 
     /* text search */
     new_buffer->text_search = GUI_TEXT_SEARCH_DISABLED;
@@ -701,6 +818,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->highlight_words = NULL;
     new_buffer->highlight_regex = NULL;
     new_buffer->highlight_regex_compiled = NULL;
+    new_buffer->highlight_words_compiled = NULL;
     new_buffer->highlight_tags_restrict = NULL;
     new_buffer->highlight_tags_restrict_count = 0;
     new_buffer->highlight_tags_restrict_array = NULL;
@@ -721,10 +839,10 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->keys_count = 0;
 
     /* local variables */
-    new_buffer->local_variables = hashtable_new (32,
-                                                 WEECHAT_HASHTABLE_STRING,
-                                                 WEECHAT_HASHTABLE_STRING,
-                                                 NULL, NULL);
+    new_buffer->local_variables = hashtable_new (0,
+                                                WEECHAT_HASHTABLE_STRING,
+                                                WEECHAT_HASHTABLE_STRING,
+                                                NULL, NULL);
     hashtable_set (new_buffer->local_variables,
                    "plugin", plugin_get_name (plugin));
     hashtable_set (new_buffer->local_variables, "name", name);
@@ -873,6 +991,59 @@ gui_buffer_string_replace_local_var (struct t_gui_buffer *buffer,
     return result;
 }
 
+/*
+ * Gets compiled highlight words for a buffer: words of buffer and words of
+ * option weechat.look.highlight (with local variables replaced).
+ *
+ * The highlight words are compiled again only if they have changed.
+ *
+ * Returns pointer to compiled highlight words, NULL if error.
+ */
+
+struct t_string_highlight *
+gui_buffer_get_highlight_words_compiled (struct t_gui_buffer *buffer)
+{
+    char *buffer_words, *global_words, *words;
+    const char *ptr_buffer_words, *ptr_global_words;
+    int length;
+
+    if (!buffer)
+        return NULL;
+
+    buffer_words = gui_buffer_string_replace_local_var (
+        buffer, buffer->highlight_words);
+    ptr_buffer_words = (buffer_words) ? buffer_words : buffer->highlight_words;
+    global_words = gui_buffer_string_replace_local_var (
+        buffer, CONFIG_STRING(config_look_highlight));
+    ptr_global_words = (global_words) ?
+        global_words : CONFIG_STRING(config_look_highlight);
+
+    length = ((ptr_buffer_words) ? strlen (ptr_buffer_words) : 0) + 1
+        + ((ptr_global_words) ? strlen (ptr_global_words) : 0) + 1;
+    words = malloc (length);
+    if (words)
+    {
+        snprintf (words, length, "%s,%s",
+                  (ptr_buffer_words) ? ptr_buffer_words : "",
+                  (ptr_global_words) ? ptr_global_words : "");
+        if (!buffer->highlight_words_compiled
+            || (strcmp (buffer->highlight_words_compiled->highlight_words,
+                        words) != 0))
+        {
+            string_highlight_free (buffer->highlight_words_compiled);
+            buffer->highlight_words_compiled = string_highlight_compile (words);
+        }
+        free (words);
+    }
+
+    if (buffer_words)
+        free (buffer_words);
+    if (global_words)
+        free (global_words);
+
+    return buffer->highlight_words_compiled;
+}
+
 /*
  * Checks if full name of buffer matches (split) list of buffers.
  *
@@ -996,6 +1167,166 @@ gui_buffer_property_in_list (char *properties[], char *property)
     return 0;
 }
 
+/*
+ * Searches a buffer property by name (case insensitive).
+ *
+ * Property names are indexed in a hashtable (built on first call), so that
+ * functions gui_buffer_get_xxx and gui_buffer_set do not compare the name
+ * with all property names.
+ *
+ * Returns id of property (enum t_gui_buffer_property), -1 if not found
+ * (for example a property with a name prefix like "localvar_xxx").
+ */
+
+int
+gui_buffer_search_property (const char *property)
+{
+    char lower_property[64];
+    int i, *ptr_id, has_upper;
+
+    if (!property)
+        return -1;
+
+    if (!gui_buffer_properties)
+    {
+        gui_buffer_properties = hashtable_new (0,
+                                               WEECHAT_HASHTABLE_STRING,
+                                               WEECHAT_HASHTABLE_INTEGER,
+                                               NULL, NULL);
+        if (!gui_buffer_properties)
+            return -1;
+        for (i = 0; i < GUI_BUFFER_NUM_PROPERTIES; i++)
+        {
+            hashtable_set (gui_buffer_properties,
+                           gui_buffer_property_string[i], &i);
+        }
+    }
+
+    ptr_id = (int *)hashtable_get (gui_buffer_properties, property);
+    if (ptr_id)
+        return *ptr_id;
+
+    /* names are almost always lower case: retry only with upper case chars */
+    has_upper = 0;
+    for (i = 0; property[i] && (i < (int)sizeof (lower_property) - 1); i++)
+    {
+        if ((property[i] >= 'A') && (property[i] <= 'Z'))
+        {
+            lower_property[i] = property[i] - 'A' + 'a';
+            has_upper = 1;
+        }
+        else
+            lower_property[i] = property[i];
+    }
+    if (!has_upper || property[i])
+        return -1;
+    lower_property[i] = '\0';
+
+    ptr_id = (int *)hashtable_get (gui_buffer_properties, lower_property);
+
+    return (ptr_id) ? *ptr_id : -1;
+}
+
+/*
+ * Gets a buffer property as integer, using the id of property (see function
+ * gui_buffer_search_property).
+ */
+
+int
+gui_buffer_get_integer_id (struct t_gui_buffer *buffer, int property)
+{
+    if (!buffer)
+        return 0;
+
+    switch (property)
+    {
+        case GUI_BUFFER_PROPERTY_NUMBER:
+            return buffer->number;
+        case GUI_BUFFER_PROPERTY_LAYOUT_NUMBER:
+            return buffer->layout_number;
+        case GUI_BUFFER_PROPERTY_LAYOUT_NUMBER_MERGE_ORDER:
+            return buffer->layout_number_merge_order;
+        case GUI_BUFFER_PROPERTY_SHORT_NAME_IS_SET:
+            return (buffer->short_name) ? 1 : 0;
+        case GUI_BUFFER_PROPERTY_TYPE:
+            return buffer->type;
+        case GUI_BUFFER_PROPERTY_NOTIFY:
+            return buffer->notify;
+        case GUI_BUFFER_PROPERTY_NUM_DISPLAYED:
+            return buffer->num_displayed;
+        case GUI_BUFFER_PROPERTY_ACTIVE:
+            return buffer->active;
+        case GUI_BUFFER_PROPERTY_HIDDEN:
+            return buffer->hidden;
+        case GUI_BUFFER_PROPERTY_ZOOMED:
+            return buffer->zoomed;
+        case GUI_BUFFER_PROPERTY_PRINT_HOOKS_ENABLED:
+            return buffer->print_hooks_enabled;
+        case GUI_BUFFER_PROPERTY_DAY_CHANGE:
+            return buffer->day_change;
+        case GUI_BUFFER_PROPERTY_CLEAR:
+            return buffer->clear;
+        case GUI_BUFFER_PROPERTY_FILTER:
+            return buffer->filter;
+        case GUI_BUFFER_PROPERTY_CLOSING:
+            return buffer->closing;
+        case GUI_BUFFER_PROPERTY_LINES_HIDDEN:
+            return buffer->lines->lines_hidden;
+        case GUI_BUFFER_PROPERTY_PREFIX_MAX_LENGTH:
+            return buffer->lines->prefix_max_length;
+        case GUI_BUFFER_PROPERTY_TIME_FOR_EACH_LINE:
+            return buffer->time_for_each_line;
+        case GUI_BUFFER_PROPERTY_NICKLIST:
+            return buffer->nicklist;
+        case GUI_BUFFER_PROPERTY_NICKLIST_CASE_SENSITIVE:
+            return buffer->nicklist_case_sensitive;
+        case GUI_BUFFER_PROPERTY_NICKLIST_MAX_LENGTH:
+            return buffer->nicklist_max_length;
+        case GUI_BUFFER_PROPERTY_NICKLIST_DISPLAY_GROUPS:
+            return buffer->nicklist_display_groups;
+        case GUI_BUFFER_PROPERTY_NICKLIST_COUNT:
+            return buffer->nicklist_count;
+        case GUI_BUFFER_PROPERTY_NICKLIST_GROUPS_COUNT:
+            return buffer->nicklist_groups_count;
+        case GUI_BUFFER_PROPERTY_NICKLIST_NICKS_COUNT:
+            return buffer->nicklist_nicks_count;
+        case GUI_BUFFER_PROPERTY_NICKLIST_VISIBLE_COUNT:
+            return buffer->nicklist_visible_count;
+        case GUI_BUFFER_PROPERTY_NICKLIST_BATCH:
+            return buffer->nicklist_batch;
+        case GUI_BUFFER_PROPERTY_LINES_BATCH:
+            return buffer->lines_batch;
+        case GUI_BUFFER_PROPERTY_INPUT:
+            return buffer->input;
+        case GUI_BUFFER_PROPERTY_INPUT_GET_UNKNOWN_COMMANDS:
+            return buffer->input_get_unknown_commands;
+        case GUI_BUFFER_PROPERTY_INPUT_MULTILINE:
+            return buffer->input_multiline;
+        case GUI_BUFFER_PROPERTY_INPUT_SIZE:
+            return buffer->input_buffer_size;
+        case GUI_BUFFER_PROPERTY_INPUT_LENGTH:
+            return buffer->input_buffer_length;
+        case GUI_BUFFER_PROPERTY_INPUT_POS:
+            return buffer->input_buffer_pos;
+        case GUI_BUFFER_PROPERTY_INPUT_1ST_DISPLAY:
+            return buffer->input_buffer_1st_display;
+        case GUI_BUFFER_PROPERTY_NUM_HISTORY:
+            return buffer->num_history;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH:
+            return buffer->text_search;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH_EXACT:
+            return buffer->text_search_exact;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH_REGEX:
+            return buffer->text_search_regex;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH_WHERE:
+            return buffer->text_search_where;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH_FOUND:
+            return buffer->text_search_found;
+    }
+
+    return 0;
+}
+
 /*
  * Gets a buffer property as integer.
  */
@@ -1006,84 +1337,53 @@ gui_buffer_get_integer (struct t_gui_buffer *buffer, const char *property)
     if (!buffer || !property)
         return 0;
 
-    if (string_strcasecmp (property, "number") == 0)
-        return buffer->number;
-    else if (string_strcasecmp (property, "layout_number") == 0)
-        return buffer->layout_number;
-    else if (string_strcasecmp (property, "layout_number_merge_order") == 0)
-        return buffer->layout_number_merge_order;
-    else if (string_strcasecmp (property, "short_name_is_set") == 0)
-        return (buffer->short_name) ? 1 : 0;
-    else if (string_strcasecmp (property, "type") == 0)
-        return buffer->type;
-    else if (string_strcasecmp (property, "notify") == 0)
-        return buffer->notify;
-    else if (string_strcasecmp (property, "num_displayed") == 0)
-        return buffer->num_displayed;
-    else if (string_strcasecmp (property, "active") == 0)
-        return buffer->active;
-    else if (string_strcasecmp (property, "hidden") == 0)
-        return buffer->hidden;
-    else if (string_strcasecmp (property, "zoomed") == 0)
-        return buffer->zoomed;
-    else if (string_strcasecmp (property, "print_hooks_enabled") == 0)
-        return buffer->print_hooks_enabled;
-    else if (string_strcasecmp (property, "day_change") == 0)
-        return buffer->day_change;
-    else if (string_strcasecmp (property, "clear") == 0)
-        return buffer->clear;
-    else if (string_strcasecmp (property, "filter") == 0)
-        return buffer->filter;
-    else if (string_strcasecmp (property, "closing") == 0)
-        return buffer->closing;
-    else if (string_strcasecmp (property, "lines_hidden") == 0)
-        return buffer->lines->lines_hidden;
-    else if (string_strcasecmp (property, "prefix_max_length") == 0)
-        return buffer->lines->prefix_max_length;
-    else if (string_strcasecmp (property, "time_for_each_line") == 0)
-        return buffer->time_for_each_line;
-    else if (string_strcasecmp (property, "nicklist") == 0)
-        return buffer->nicklist;
-    else if (string_strcasecmp (property, "nicklist_case_sensitive") == 0)
-        return buffer->nicklist_case_sensitive;
-    else if (string_strcasecmp (property, "nicklist_max_length") == 0)
-        return buffer->nicklist_max_length;
-    else if (string_strcasecmp (property, "nicklist_display_groups") == 0)
-        return buffer->nicklist_display_groups;
-    else if (string_strcasecmp (property, "nicklist_count") == 0)
-        return buffer->nicklist_count;
-    else if (string_strcasecmp (property, "nicklist_groups_count") == 0)
-        return buffer->nicklist_groups_count;
-    else if (string_strcasecmp (property, "nicklist_nicks_count") == 0)
-        return buffer->nicklist_nicks_count;
-    else if (string_strcasecmp (property, "nicklist_visible_count") == 0)
-        return buffer->nicklist_visible_count;
-    else if (string_strcasecmp (property, "input") == 0)
-        return buffer->input;
-    else if (string_strcasecmp (property, "input_get_unknown_commands") == 0)
-        return buffer->input_get_unknown_commands;
-    else if (string_strcasecmp (property, "input_size") == 0)
-        return buffer->input_buffer_size;
-    else if (string_strcasecmp (property, "input_length") == 0)
-        return buffer->input_buffer_length;
-    else if (string_strcasecmp (property, "input_pos") == 0)
-        return buffer->input_buffer_pos;
-    else if (string_strcasecmp (property, "input_1st_display") == 0)
-        return buffer->input_buffer_1st_display;
-    else if (string_strcasecmp (property, "num_history") == 0)
-        return buffer->num_history;
-    else if (string_strcasecmp (property, "text_search") == 0)
-        return buffer->text_search;
-    else if (string_strcasecmp (property, "text_search_exact") == 0)
-        return buffer->text_search_exact;
-    else if (string_strcasecmp (property, "text_search_regex") == 0)
-        return buffer->text_search_regex;
-    else if (string_strcasecmp (property, "text_search_where") == 0)
-        return buffer->text_search_where;
-    else if (string_strcasecmp (property, "text_search_found") == 0)
-        return buffer->text_search_found;
+    return gui_buffer_get_integer_id (buffer,
+                                      gui_buffer_search_property (property));
+}
 
-    return 0;
+/*
+ * Gets a buffer property as string, using the id of property (see function
+ * gui_buffer_search_property).
+ *
+ * Note: local variables ("localvar_xxx") can not be read with this function.
+ */
+
+const char *
+gui_buffer_get_string_id (struct t_gui_buffer *buffer, int property)
+{
+    if (!buffer)
+        return NULL;
+
+    switch (property)
+    {
+        case GUI_BUFFER_PROPERTY_PLUGIN:
+            return gui_buffer_get_plugin_name (buffer);
+        case GUI_BUFFER_PROPERTY_NAME:
+            return buffer->name;
+        case GUI_BUFFER_PROPERTY_FULL_NAME:
+            return buffer->full_name;
+        case GUI_BUFFER_PROPERTY_SHORT_NAME:
+            return gui_buffer_get_short_name (buffer);
+        case GUI_BUFFER_PROPERTY_TITLE:
+            return buffer->title;
+        case GUI_BUFFER_PROPERTY_INPUT:
+            return buffer->input_buffer;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH_INPUT:
+            return buffer->text_search_input;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS:
+            return buffer->highlight_words;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_REGEX:
+            return buffer->highlight_regex;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_TAGS_RESTRICT:
+            return buffer->highlight_tags_restrict;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_TAGS:
+            return buffer->highlight_tags;
+        case GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS:
+            return hashtable_get_string (buffer->hotlist_max_level_nicks,
+                                         "keys_values");
+    }
+
+    return NULL;
 }
 
 /*
@@ -1094,35 +1394,16 @@ const char *
 gui_buffer_get_string (struct t_gui_buffer *buffer, const char *property)
 {
     const char *ptr_value;
+    int property_id;
 
     if (!buffer || !property)
         return NULL;
 
-    if (string_strcasecmp (property, "plugin") == 0)
-        return gui_buffer_get_plugin_name (buffer);
-    else if (string_strcasecmp (property, "name") == 0)
-        return buffer->name;
-    else if (string_strcasecmp (property, "full_name") == 0)
-        return buffer->full_name;
-    else if (string_strcasecmp (property, "short_name") == 0)
-        return gui_buffer_get_short_name (buffer);
-    else if (string_strcasecmp (property, "title") == 0)
-        return buffer->title;
-    else if (string_strcasecmp (property, "input") == 0)
-        return buffer->input_buffer;
-    else if (string_strcasecmp (property, "text_search_input") == 0)
-        return buffer->text_search_input;
-    else if (string_strcasecmp (property, "highlight_words") == 0)
-        return buffer->highlight_words;
-    else if (string_strcasecmp (property, "highlight_regex") == 0)
-        return buffer->highlight_regex;
-    else if (string_strcasecmp (property, "highlight_tags_restrict") == 0)
-        return buffer->highlight_tags_restrict;
-    else if (string_strcasecmp (property, "highlight_tags") == 0)
-        return buffer->highlight_tags;
-    else if (string_strcasecmp (property, "hotlist_max_level_nicks") == 0)
-        return hashtable_get_string (buffer->hotlist_max_level_nicks, "keys_values");
-    else if (string_strncasecmp (property, "localvar_", 9) == 0)
+    property_id = gui_buffer_search_property (property);
+    if (property_id >= 0)
+        return gui_buffer_get_string_id (buffer, property_id);
+
+    if (string_strncasecmp (property, "localvar_", 9) == 0)
     {
         ptr_value = (const char *)hashtable_get (buffer->local_variables,
                                                  property + 9);
@@ -1133,6 +1414,30 @@ gui_buffer_get_string (struct t_gui_buffer *buffer, const char *property)
     return NULL;
 }
 
+/*
+ * Gets a buffer property as pointer, using the id of property (see function
+ * gui_buffer_search_property).
+ */
+
+void *
+gui_buffer_get_pointer_id (struct t_gui_buffer *buffer, int property)
+{
+    if (!buffer)
+        return NULL;
+
+    switch (property)
+    {
+        case GUI_BUFFER_PROPERTY_PLUGIN:
+            return buffer->plugin;
+        case GUI_BUFFER_PROPERTY_TEXT_SEARCH_REGEX_COMPILED:
+            return buffer->text_search_regex_compiled;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_REGEX_COMPILED:
+            return buffer->highlight_regex_compiled;
+    }
+
+    return NULL;
+}
+
 /*
  * Gets a buffer property as pointer.
  */
@@ -1143,14 +1448,8 @@ gui_buffer_get_pointer (struct t_gui_buffer *buffer, const char *property)
     if (!buffer || !property)
         return NULL;
 
-    if (string_strcasecmp (property, "plugin") == 0)
-        return buffer->plugin;
-    else if (string_strcasecmp (property, "text_search_regex_compiled") == 0)
-        return buffer->text_search_regex_compiled;
-    else if (string_strcasecmp (property, "highlight_regex_compiled") == 0)
-        return buffer->highlight_regex_compiled;
-
-    return NULL;
+    return gui_buffer_get_pointer_id (buffer,
+                                      gui_buffer_search_property (property));
 }
 
 /*
@@ -1495,7 +1794,7 @@ gui_buffer_set_highlight_regex (struct t_gui_buffer *buffer,
     }
     if (buffer->highlight_regex_compiled)
     {
-        regfree (buffer->highlight_regex_compiled);
+        string_regfree (buffer->highlight_regex_compiled);
         free (buffer->highlight_regex_compiled);
         buffer->highlight_regex_compiled = NULL;
     }
@@ -1544,7 +1843,7 @@ gui_buffer_set_highlight_tags_restrict (struct t_gui_buffer *buffer,
     {
         for (i = 0; i < buffer->highlight_tags_restrict_count; i++)
         {
-            string_free_split (buffer->highlight_tags_restrict_array[i]);
+            string_free_split_shared (buffer->highlight_tags_restrict_array[i]);
         }
         free (buffer->highlight_tags_restrict_array);
         buffer->highlight_tags_restrict_array = NULL;
@@ -1569,9 +1868,9 @@ gui_buffer_set_highlight_tags_restrict (struct t_gui_buffer *buffer,
         {
             for (i = 0; i < buffer->highlight_tags_restrict_count; i++)
             {
-                buffer->highlight_tags_restrict_array[i] = string_split (tags_array[i],
-                                                                         "+", 0, 0,
-                                                                         NULL);
+                buffer->highlight_tags_restrict_array[i] = string_split_shared (tags_array[i],
+                                                                                "+", 0, 0,
+                                                                                NULL);
             }
         }
         string_free_split (tags_array);
@@ -1601,7 +1900,7 @@ gui_buffer_set_highlight_tags (struct t_gui_buffer *buffer,
     {
         for (i = 0; i < buffer->highlight_tags_count; i++)
         {
-            string_free_split (buffer->highlight_tags_array[i]);
+            string_free_split_shared (buffer->highlight_tags_array[i]);
         }
         free (buffer->highlight_tags_array);
         buffer->highlight_tags_array = NULL;
@@ -1626,9 +1925,9 @@ gui_buffer_set_highlight_tags (struct t_gui_buffer *buffer,
         {
             for (i = 0; i < buffer->highlight_tags_count; i++)
             {
-                buffer->highlight_tags_array[i] = string_split (tags_array[i],
-                                                                "+", 0, 0,
-                                                                NULL);
+                buffer->highlight_tags_array[i] = string_split_shared (tags_array[i],
+                                                                       "+", 0, 0,
+                                                                       NULL);
             }
         }
         string_free_split (tags_array);
@@ -1759,6 +2058,20 @@ gui_buffer_set_input_get_unknown_commands (struct t_gui_buffer *buffer,
     buffer->input_get_unknown_commands = (input_get_unknown_commands) ? 1 : 0;
 }
 
+/*
+ * Sets flag "input_multiline" for a buffer.
+ */
+
+void
+gui_buffer_set_input_multiline (struct t_gui_buffer *buffer,
+                                int input_multiline)
+{
+    if (!buffer)
+        return;
+
+    buffer->input_multiline = (input_multiline) ? 1 : 0;
+}
+
 /*
  * Sets unread marker for a buffer.
  */
@@ -1791,247 +2104,254 @@ gui_buffer_set (struct t_gui_buffer *buffer, const char *property,
 {
     long number;
     char *error;
+    int property_id;
 
     if (!property || !value)
         return;
 
+    property_id = gui_buffer_search_property (property);
+
     /* properties with optional buffer */
-    if (string_strcasecmp (property, "hotlist") == 0)
-    {
-        if (strcmp (value, "-") == 0)
-            gui_add_hotlist = 0;
-        else if (strcmp (value, "+") == 0)
-            gui_add_hotlist = 1;
-        else if (buffer)
-        {
-            error = NULL;
-            number = strtol (value, &error, 10);
-            if (error && !error[0])
+    switch (property_id)
+    {
+        case GUI_BUFFER_PROPERTY_HOTLIST:
+            if (strcmp (value, "-") == 0)
+                gui_add_hotlist = 0;
+            else if (strcmp (value, "+") == 0)
+                gui_add_hotlist = 1;
+            else if (buffer)
             {
-                if (number < 0)
-                    gui_hotlist_remove_buffer (buffer, 0);
-                else
-                    (void) gui_hotlist_add (buffer, number, NULL);
+                error = NULL;
+                number = strtol (value, &error, 10);
+                if (error && !error[0])
+                {
+                    if (number < 0)
+                        gui_hotlist_remove_buffer (buffer, 0);
+                    else
+                        (void) gui_hotlist_add (buffer, number, NULL);
+                }
             }
-        }
-    }
-    else if (string_strcasecmp (property, "completion_freeze") == 0)
-    {
-        gui_completion_freeze = (strcmp (value, "1") == 0) ? 1 : 0;
+            break;
+        case GUI_BUFFER_PROPERTY_COMPLETION_FREEZE:
+            gui_completion_freeze = (strcmp (value, "1") == 0) ? 1 : 0;
+            break;
     }
 
     if (!buffer)
         return;
 
-    /* properties that need a buffer */
-    if (string_strcasecmp (property, "unread") == 0)
+    /* properties with a name prefix (key bindings, local variables) */
+    if (property_id < 0)
     {
-        gui_buffer_set_unread (buffer);
-    }
-    else if (string_strcasecmp (property, "display") == 0)
-    {
-        /*
-         * if it is auto-switch to a buffer, then we don't set read marker,
-         * otherwise we reset it (if current buffer is not displayed) after
-         * switch
-         */
-        gui_window_switch_to_buffer (gui_current_window, buffer,
-                                     (string_strcasecmp (value, "auto") == 0) ?
-                                     0 : 1);
-    }
-    else if (string_strcasecmp (property, "hidden") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-        {
-            if (number)
-                gui_buffer_hide (buffer);
-            else
-                gui_buffer_unhide (buffer);
-        }
-    }
-    else if (string_strcasecmp (property, "print_hooks_enabled") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            buffer->print_hooks_enabled = (number) ? 1 : 0;
-    }
-    else if (string_strcasecmp (property, "day_change") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
+        if (string_strncasecmp (property, "key_bind_", 9) == 0)
         {
-            buffer->day_change = (number) ? 1 : 0;
-            gui_buffer_ask_chat_refresh (buffer, 2);
+            gui_key_bind (buffer, 0, property + 9, value);
         }
-    }
-    else if (string_strcasecmp (property, "clear") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            buffer->clear = (number) ? 1 : 0;
-    }
-    else if (string_strcasecmp (property, "filter") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
+        else if (string_strncasecmp (property, "key_unbind_", 11) == 0)
         {
-            buffer->filter = (number) ? 1 : 0;
-            gui_filter_buffer (buffer, NULL);
+            if (strcmp (property + 11, "*") == 0)
+            {
+                gui_key_free_all (&buffer->keys, &buffer->last_key,
+                                  &buffer->keys_count);
+            }
+            else
+                gui_key_unbind (buffer, 0, property + 11);
         }
-    }
-    else if (string_strcasecmp (property, "number") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0] && (number >= 1))
-            gui_buffer_move_to_number (buffer, number);
-    }
-    else if (string_strcasecmp (property, "name") == 0)
-    {
-        gui_buffer_set_name (buffer, value);
-    }
-    else if (string_strcasecmp (property, "short_name") == 0)
-    {
-        gui_buffer_set_short_name (buffer, value);
-    }
-    else if (string_strcasecmp (property, "type") == 0)
-    {
-        if (string_strcasecmp (value, "formatted") == 0)
-            gui_buffer_set_type (buffer, GUI_BUFFER_TYPE_FORMATTED);
-        else if (string_strcasecmp (value, "free") == 0)
-            gui_buffer_set_type (buffer, GUI_BUFFER_TYPE_FREE);
-    }
-    else if (string_strcasecmp (property, "notify") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0]
-            && (number < GUI_BUFFER_NUM_NOTIFY))
+        else if (string_strncasecmp (property, "localvar_set_", 13) == 0)
         {
-            if (number < 0)
-                buffer->notify = CONFIG_INTEGER(config_look_buffer_notify_default);
-            else
-                buffer->notify = number;
+            if (value)
+                gui_buffer_local_var_add (buffer, property + 13, value);
         }
-    }
-    else if (string_strcasecmp (property, "title") == 0)
-    {
-        gui_buffer_set_title (buffer, value);
-    }
-    else if (string_strcasecmp (property, "time_for_each_line") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            gui_buffer_set_time_for_each_line (buffer, number);
-    }
-    else if (string_strcasecmp (property, "nicklist") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            gui_buffer_set_nicklist (buffer, number);
-    }
-    else if (string_strcasecmp (property, "nicklist_case_sensitive") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            gui_buffer_set_nicklist_case_sensitive (buffer, number);
-    }
-    else if (string_strcasecmp (property, "nicklist_display_groups") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            gui_buffer_set_nicklist_display_groups (buffer, number);
-    }
-    else if (string_strcasecmp (property, "highlight_words") == 0)
-    {
-        gui_buffer_set_highlight_words (buffer, value);
-    }
-    else if (string_strcasecmp (property, "highlight_words_add") == 0)
-    {
-        gui_buffer_add_highlight_words (buffer, value);
-    }
-    else if (string_strcasecmp (property, "highlight_words_del") == 0)
-    {
-        gui_buffer_remove_highlight_words (buffer, value);
-    }
-    else if (string_strcasecmp (property, "highlight_regex") == 0)
-    {
-        gui_buffer_set_highlight_regex (buffer, value);
-    }
-    else if (string_strcasecmp (property, "highlight_tags_restrict") == 0)
-    {
-        gui_buffer_set_highlight_tags_restrict (buffer, value);
-    }
-    else if (string_strcasecmp (property, "highlight_tags") == 0)
-    {
-        gui_buffer_set_highlight_tags (buffer, value);
-    }
-    else if (string_strcasecmp (property, "hotlist_max_level_nicks") == 0)
-    {
-        gui_buffer_set_hotlist_max_level_nicks (buffer, value);
-    }
-    else if (string_strcasecmp (property, "hotlist_max_level_nicks_add") == 0)
-    {
-        gui_buffer_add_hotlist_max_level_nicks (buffer, value);
-    }
-    else if (string_strcasecmp (property, "hotlist_max_level_nicks_del") == 0)
-    {
-        gui_buffer_remove_hotlist_max_level_nicks (buffer, value);
-    }
-    else if (string_strncasecmp (property, "key_bind_", 9) == 0)
-    {
-        gui_key_bind (buffer, 0, property + 9, value);
-    }
-    else if (string_strncasecmp (property, "key_unbind_", 11) == 0)
-    {
-        if (strcmp (property + 11, "*") == 0)
+        else if (string_strncasecmp (property, "localvar_del_", 13) == 0)
         {
-            gui_key_free_all (&buffer->keys, &buffer->last_key,
-                              &buffer->keys_count);
+            gui_buffer_local_var_remove (buffer, property + 13);
         }
-        else
-            gui_key_unbind (buffer, 0, property + 11);
-    }
-    else if (string_strcasecmp (property, "input") == 0)
-    {
-        gui_buffer_undo_snap (buffer);
-        gui_input_replace_input (buffer, value);
-        gui_input_text_changed_modifier_and_signal (buffer,
-                                                    1, /* save undo */
-                                                    1); /* stop completion */
-    }
-    else if (string_strcasecmp (property, "input_pos") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            gui_input_set_pos (buffer, number);
-    }
-    else if (string_strcasecmp (property, "input_get_unknown_commands") == 0)
-    {
-        error = NULL;
-        number = strtol (value, &error, 10);
-        if (error && !error[0])
-            gui_buffer_set_input_get_unknown_commands (buffer, number);
-    }
-    else if (string_strncasecmp (property, "localvar_set_", 13) == 0)
-    {
-        if (value)
-            gui_buffer_local_var_add (buffer, property + 13, value);
+        return;
     }
-    else if (string_strncasecmp (property, "localvar_del_", 13) == 0)
+
+    /* properties that need a buffer */
+    switch (property_id)
     {
-        gui_buffer_local_var_remove (buffer, property + 13);
+        case GUI_BUFFER_PROPERTY_UNREAD:
+            gui_buffer_set_unread (buffer);
+            break;
+        case GUI_BUFFER_PROPERTY_DISPLAY:
+            /*
+             * if it is auto-switch to a buffer, then we don't set read marker,
+             * otherwise we reset it (if current buffer is not displayed) after
+             * switch
+             */
+            gui_window_switch_to_buffer (gui_current_window, buffer,
+                                         (string_strcasecmp (value, "auto") == 0) ?
+                                         0 : 1);
+            break;
+        case GUI_BUFFER_PROPERTY_HIDDEN:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+            {
+                if (number)
+                    gui_buffer_hide (buffer);
+                else
+                    gui_buffer_unhide (buffer);
+            }
+            break;
+        case GUI_BUFFER_PROPERTY_PRINT_HOOKS_ENABLED:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                buffer->print_hooks_enabled = (number) ? 1 : 0;
+            break;
+        case GUI_BUFFER_PROPERTY_DAY_CHANGE:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+            {
+                buffer->day_change = (number) ? 1 : 0;
+                gui_buffer_ask_chat_refresh (buffer, 2);
+            }
+            break;
+        case GUI_BUFFER_PROPERTY_CLEAR:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                buffer->clear = (number) ? 1 : 0;
+            break;
+        case GUI_BUFFER_PROPERTY_FILTER:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+            {
+                buffer->filter = (number) ? 1 : 0;
+                gui_filter_buffer (buffer, NULL);
+            }
+            break;
+        case GUI_BUFFER_PROPERTY_NUMBER:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0] && (number >= 1))
+                gui_buffer_move_to_number (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_NAME:
+            gui_buffer_set_name (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_SHORT_NAME:
+            gui_buffer_set_short_name (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_TYPE:
+            if (string_strcasecmp (value, "formatted") == 0)
+                gui_buffer_set_type (buffer, GUI_BUFFER_TYPE_FORMATTED);
+            else if (string_strcasecmp (value, "free") == 0)
+                gui_buffer_set_type (buffer, GUI_BUFFER_TYPE_FREE);
+            break;
+        case GUI_BUFFER_PROPERTY_NOTIFY:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0]
+                && (number < GUI_BUFFER_NUM_NOTIFY))
+            {
+                if (number < 0)
+                    buffer->notify = CONFIG_INTEGER(config_look_buffer_notify_default);
+                else
+                    buffer->notify = number;
+            }
+            break;
+        case GUI_BUFFER_PROPERTY_TITLE:
+            gui_buffer_set_title (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_TIME_FOR_EACH_LINE:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_buffer_set_time_for_each_line (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_NICKLIST:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_buffer_set_nicklist (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_NICKLIST_CASE_SENSITIVE:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_buffer_set_nicklist_case_sensitive (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_NICKLIST_DISPLAY_GROUPS:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_buffer_set_nicklist_display_groups (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_NICKLIST_BATCH:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_nicklist_set_batch (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_LINES_BATCH:
+            if (strcmp (value, "top") == 0)
+            {
+                gui_line_set_batch (buffer, GUI_LINE_BATCH_TOP);
+                break;
+            }
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_line_set_batch (buffer, (number) ? 1 : 0);
+            break;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS:
+            gui_buffer_set_highlight_words (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS_ADD:
+            gui_buffer_add_highlight_words (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS_DEL:
+            gui_buffer_remove_highlight_words (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_REGEX:
+            gui_buffer_set_highlight_regex (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_TAGS_RESTRICT:
+            gui_buffer_set_highlight_tags_restrict (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HIGHLIGHT_TAGS:
+            gui_buffer_set_highlight_tags (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS:
+            gui_buffer_set_hotlist_max_level_nicks (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS_ADD:
+            gui_buffer_add_hotlist_max_level_nicks (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS_DEL:
+            gui_buffer_remove_hotlist_max_level_nicks (buffer, value);
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT:
+            gui_buffer_undo_snap (buffer);
+            gui_input_replace_input (buffer, value);
+            gui_input_text_changed_modifier_and_signal (buffer,
+                                                        1, /* save undo */
+                                                        1); /* stop completion */
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT_POS:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_input_set_pos (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT_GET_UNKNOWN_COMMANDS:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_buffer_set_input_get_unknown_commands (buffer, number);
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT_MULTILINE:
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (error && !error[0])
+                gui_buffer_set_input_multiline (buffer, number);
+            break;
     }
 }
 
@@ -2046,41 +2366,35 @@ gui_buffer_set_pointer (struct t_gui_buffer *buffer, const char *property,
     if (!buffer || !property)
         return;
 
-    if (string_strcasecmp (property, "close_callback") == 0)
-    {
-        buffer->close_callback = pointer;
-    }
-    else if (string_strcasecmp (property, "close_callback_pointer") == 0)
-    {
-        buffer->close_callback_pointer = pointer;
-    }
-    else if (string_strcasecmp (property, "close_callback_data") == 0)
-    {
-        buffer->close_callback_data = pointer;
-    }
-    else if (string_strcasecmp (property, "nickcmp_callback") == 0)
+    switch (gui_buffer_search_property (property))
     {
-        buffer->nickcmp_callback = pointer;
-    }
-    else if (string_strcasecmp (property, "nickcmp_callback_pointer") == 0)
-    {
-        buffer->nickcmp_callback_pointer = pointer;
-    }
-    else if (string_strcasecmp (property, "nickcmp_callback_data") == 0)
-    {
-        buffer->nickcmp_callback_data = pointer;
-    }
-    else if (string_strcasecmp (property, "input_callback") == 0)
-    {
-        buffer->input_callback = pointer;
-    }
-    else if (string_strcasecmp (property, "input_callback_pointer") == 0)
-    {
-        buffer->input_callback_pointer = pointer;
-    }
-    else if (string_strcasecmp (property, "input_callback_data") == 0)
-    {
-        buffer->input_callback_data = pointer;
+        case GUI_BUFFER_PROPERTY_CLOSE_CALLBACK:
+            buffer->close_callback = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_CLOSE_CALLBACK_POINTER:
+            buffer->close_callback_pointer = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_CLOSE_CALLBACK_DATA:
+            buffer->close_callback_data = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_NICKCMP_CALLBACK:
+            buffer->nickcmp_callback = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_NICKCMP_CALLBACK_POINTER:
+            buffer->nickcmp_callback_pointer = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_NICKCMP_CALLBACK_DATA:
+            buffer->nickcmp_callback_data = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT_CALLBACK:
+            buffer->input_callback = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT_CALLBACK_POINTER:
+            buffer->input_callback_pointer = pointer;
+            break;
+        case GUI_BUFFER_PROPERTY_INPUT_CALLBACK_DATA:
+            buffer->input_callback_data = pointer;
+            break;
     }
 }
 
@@ -2204,6 +2518,10 @@ gui_buffer_search_by_full_name (const char *full_name)
         full_name += 4;
     }
 
+    /* quick search with the index (only if case sensitive) */
+    if (case_sensitive && gui_buffers_by_full_name)
+        return hashtable_get (gui_buffers_by_full_name, full_name);
+
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
@@ -2229,7 +2547,8 @@ struct t_gui_buffer *
 gui_buffer_search_by_name (const char *plugin, const char *name)
 {
     struct t_gui_buffer *ptr_buffer;
-    int plugin_match, case_sensitive;
+    char str_full_name[512], *full_name;
+    int plugin_match, case_sensitive, length;
 
     if (!name || !name[0])
         return gui_current_window->buffer;
@@ -2244,6 +2563,25 @@ gui_buffer_search_by_name (const char *plugin, const char *name)
         name += 4;
     }
 
+    /*
+     * quick search with the index (only if plugin is given and if case
+     * sensitive): the full name is "plugin.name"
+     */
+    if (case_sensitive && plugin && plugin[0] && gui_buffers_by_full_name)
+    {
+        length = strlen (plugin) + 1 + strlen (name) + 1;
+        full_name = (length <= (int)sizeof (str_full_name)) ?
+            str_full_name : malloc (length);
+        if (full_name)
+        {
+            snprintf (full_name, length, "%s.%s", plugin, name);
+            ptr_buffer = hashtable_get (gui_buffers_by_full_name, full_name);
+            if (full_name != str_full_name)
+                free (full_name);
+            return ptr_buffer;
+        }
+    }
+
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
@@ -2363,18 +2701,41 @@ gui_buffer_search_by_partial_name (const char *plugin, const char *name)
 }
 
 /*
- * Searches for a buffer by number.
+ * Searches for first buffer with a number greater than or equal to "number".
+ *
+ * Buffers are sorted by number in list, so the search starts from the end of
+ * list if the number is closer to the last buffer (for example buffers added
+ * or moved at the end of list, like on autojoin of channels).
+ *
+ * Returns pointer to buffer found, NULL if all buffers have a lower number.
  */
 
 struct t_gui_buffer *
-gui_buffer_search_by_number (int number)
+gui_buffer_search_number_pos (int number)
 {
     struct t_gui_buffer *ptr_buffer;
 
+    if (!gui_buffers || (number > last_gui_buffer->number))
+        return NULL;
+
+    if (number <= gui_buffers->number)
+        return gui_buffers;
+
+    if (number - gui_buffers->number > last_gui_buffer->number - number)
+    {
+        ptr_buffer = last_gui_buffer;
+        while (ptr_buffer->prev_buffer
+               && (ptr_buffer->prev_buffer->number >= number))
+        {
+            ptr_buffer = ptr_buffer->prev_buffer;
+        }
+        return ptr_buffer;
+    }
+
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if (ptr_buffer->number == number)
+        if (ptr_buffer->number >= number)
             return ptr_buffer;
     }
 
@@ -2382,6 +2743,20 @@ gui_buffer_search_by_number (int number)
     return NULL;
 }
 
+/*
+ * Searches for a buffer by number.
+ */
+
+struct t_gui_buffer *
+gui_buffer_search_by_number (int number)
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    ptr_buffer = gui_buffer_search_number_pos (number);
+
+    return (ptr_buffer && (ptr_buffer->number == number)) ? ptr_buffer : NULL;
+}
+
 /*
  * Searches for a buffer by number, full name or partial name.
  */
@@ -2469,11 +2844,11 @@ gui_buffer_search_range (int number1, int number2,
         return;
 
     prev_number = -1;
-    for (ptr_buffer = gui_buffers;
+    for (ptr_buffer = gui_buffer_search_number_pos (number1);
          ptr_buffer && (ptr_buffer->number <= number2);
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if (!*ptr_first_buffer && (ptr_buffer->number >= number1))
+        if (!*ptr_first_buffer)
             *ptr_first_buffer = ptr_buffer;
 
         *ptr_last_buffer = ptr_buffer;
@@ -2500,11 +2875,11 @@ gui_buffer_count_merged_buffers (int number)
 
     count = 0;
 
-    for (ptr_buffer = gui_buffers; ptr_buffer;
+    for (ptr_buffer = gui_buffer_search_number_pos (number);
+         ptr_buffer && (ptr_buffer->number == number);
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if (ptr_buffer->number == number)
-            count++;
+        count++;
     }
 
     return count;
@@ -2706,9 +3081,9 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     /* free all lines */
     gui_line_free_all (buffer);
     if (buffer->own_lines)
-        free (buffer->own_lines);
+        gui_lines_free (buffer->own_lines);
     if (buffer->mixed_lines)
-        free (buffer->mixed_lines);
+        gui_lines_free (buffer->mixed_lines);
 
     /* free some data */
     gui_buffer_undo_free_all (buffer);
@@ -2717,8 +3092,14 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         gui_completion_free (buffer->completion);
     gui_nicklist_remove_all (buffer);
     gui_nicklist_remove_group (buffer, buffer->nicklist_root);
+    if (buffer->nicklist_nicks_index)
+        hashtable_free (buffer->nicklist_nicks_index);
+    if (buffer->nicklist_groups_index)
+        hashtable_free (buffer->nicklist_groups_index);
     if (buffer->hotlist_max_level_nicks)
         hashtable_free (buffer->hotlist_max_level_nicks);
+    if (buffer->lines_batch_hotlist)
+        free (buffer->lines_batch_hotlist);
     gui_key_free_all (&buffer->keys, &buffer->last_key,
                       &buffer->keys_count);
     gui_buffer_local_var_remove_all (buffer);
@@ -2728,7 +3109,10 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     if (buffer->name)
         free (buffer->name);
     if (buffer->full_name)
+    {
+        gui_buffer_index_remove (buffer);
         free (buffer->full_name);
+    }
     if (buffer->short_name)
         free (buffer->short_name);
     if (buffer->title)
@@ -2741,7 +3125,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         free (buffer->text_search_input);
     if (buffer->text_search_regex_compiled)
     {
-        regfree (buffer->text_search_regex_compiled);
+        string_regfree (buffer->text_search_regex_compiled);
         free (buffer->text_search_regex_compiled);
     }
     if (buffer->highlight_words)
@@ -2750,16 +3134,17 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         free (buffer->highlight_regex);
     if (buffer->highlight_regex_compiled)
     {
-        regfree (buffer->highlight_regex_compiled);
+        string_regfree (buffer->highlight_regex_compiled);
         free (buffer->highlight_regex_compiled);
     }
+    string_highlight_free (buffer->highlight_words_compiled);
     if (buffer->highlight_tags_restrict)
         free (buffer->highlight_tags_restrict);
     if (buffer->highlight_tags_restrict_array)
     {
         for (i = 0; i < buffer->highlight_tags_restrict_count; i++)
         {
-            string_free_split (buffer->highlight_tags_restrict_array[i]);
+            string_free_split_shared (buffer->highlight_tags_restrict_array[i]);
         }
         free (buffer->highlight_tags_restrict_array);
     }
@@ -2769,7 +3154,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     {
         for (i = 0; i < buffer->highlight_tags_count; i++)
         {
-            string_free_split (buffer->highlight_tags_array[i]);
+            string_free_split_shared (buffer->highlight_tags_array[i]);
         }
         free (buffer->highlight_tags_array);
     }
@@ -2790,6 +3175,17 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     if (last_gui_buffer == buffer)
         last_gui_buffer = buffer->prev_buffer;
 
+    if (!gui_buffers && gui_buffers_by_full_name)
+    {
+        hashtable_free (gui_buffers_by_full_name);
+        gui_buffers_by_full_name = NULL;
+    }
+    if (!gui_buffers && gui_buffer_properties)
+    {
+        hashtable_free (gui_buffer_properties);
+        gui_buffer_properties = NULL;
+    }
+
     for (ptr_window = gui_windows; ptr_window;
          ptr_window = ptr_window->next_window)
     {
@@ -2844,41 +3240,49 @@ gui_buffer_switch_by_number (struct t_gui_window *window, int number)
 void
 gui_buffer_set_active_buffer (struct t_gui_buffer *buffer)
 {
-    struct t_gui_buffer *ptr_buffer;
+    struct t_gui_buffer *ptr_buffer, *ptr_first_buffer, *ptr_last_buffer;
     int active;
 
     if (!buffer)
         return;
 
+    /* search for first and last buffer merged with this buffer */
+    gui_buffer_search_range (buffer->number, buffer->number,
+                             &ptr_first_buffer, &ptr_last_buffer,
+                             NULL);
+    if (!ptr_first_buffer || !ptr_last_buffer)
+        return;
+
     active = 1;
-    for (ptr_buffer = gui_buffers; ptr_buffer;
+    for (ptr_buffer = ptr_first_buffer; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if ((ptr_buffer->number == buffer->number) && (ptr_buffer->active))
+        if (ptr_buffer->active)
         {
             active = ptr_buffer->active;
             break;
         }
+        if (ptr_buffer == ptr_last_buffer)
+            break;
     }
 
-    for (ptr_buffer = gui_buffers; ptr_buffer;
+    for (ptr_buffer = ptr_first_buffer; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if (ptr_buffer->number == buffer->number)
+        if (ptr_buffer == buffer)
         {
-            if (ptr_buffer == buffer)
-            {
-                if (active == 2)
-                    ptr_buffer->lines = ptr_buffer->own_lines;
-                ptr_buffer->active = active;
-            }
-            else
-            {
-                if (ptr_buffer->active == 2)
-                    ptr_buffer->lines = ptr_buffer->mixed_lines;
-                ptr_buffer->active = 0;
-            }
+            if (active == 2)
+                ptr_buffer->lines = ptr_buffer->own_lines;
+            ptr_buffer->active = active;
+        }
+        else
+        {
+            if (ptr_buffer->active == 2)
+                ptr_buffer->lines = ptr_buffer->mixed_lines;
+            ptr_buffer->active = 0;
         }
+        if (ptr_buffer == ptr_last_buffer)
+            break;
     }
 }
 
@@ -3149,12 +3553,7 @@ gui_buffer_move_to_number (struct t_gui_buffer *buffer, int number)
     }
 
     /* search for new position in the list */
-    for (ptr_buffer_pos = gui_buffers; ptr_buffer_pos;
-         ptr_buffer_pos = ptr_buffer_pos->next_buffer)
-    {
-        if (ptr_buffer_pos->number >= number)
-            break;
-    }
+    ptr_buffer_pos = gui_buffer_search_number_pos (number);
 
     if (ptr_buffer_pos)
     {
@@ -4061,6 +4460,25 @@ gui_buffer_visited_get_index_next ()
     return gui_buffers_visited_index + 1;
 }
 
+/*
+ * Searches a buffer by full name with the index (callback used by
+ * hdata_search).
+ */
+
+void *
+gui_buffer_hdata_search_full_name_cb (void *data, struct t_hdata *hdata,
+                                      void *pointer, const char *value)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) hdata;
+
+    if ((pointer != gui_buffers) || !gui_buffers_by_full_name)
+        return NULL;
+
+    return hashtable_get (gui_buffers_by_full_name, value);
+}
+
 /*
  * Returns hdata for buffer.
  */
@@ -4105,8 +4523,14 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, own_lines, POINTER, 0, NULL, "lines");
         HDATA_VAR(struct t_gui_buffer, mixed_lines, POINTER, 0, NULL, "lines");
         HDATA_VAR(struct t_gui_buffer, lines, POINTER, 0, NULL, "lines");
+        HDATA_VAR(struct t_gui_buffer, lines_added, LONG, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, time_for_each_line, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, chat_refresh_needed, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_count, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_hidden, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_removed, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, lines_batch_top_line, POINTER, 0, NULL, "line");
         HDATA_VAR(struct t_gui_buffer, nicklist, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_case_sensitive, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_root, POINTER, 0, NULL, "nick_group");
@@ -4116,6 +4540,8 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, nicklist_groups_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_nicks_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_visible_count, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, nicklist_batch, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, nicklist_batch_changes, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback_pointer, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback_data, POINTER, 0, NULL, NULL);
@@ -4124,6 +4550,7 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, input_callback_pointer, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, input_callback_data, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, input_get_unknown_commands, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, input_multiline, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, input_buffer, STRING, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, input_buffer_alloc, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, input_buffer_size, INTEGER, 0, NULL, NULL);
@@ -4166,6 +4593,8 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_LIST(gui_buffers, WEECHAT_HDATA_LIST_CHECK_POINTERS);
         HDATA_LIST(last_gui_buffer, 0);
         HDATA_LIST(gui_buffer_last_displayed, 0);
+        hdata_new_index (hdata, "full_name",
+                         &gui_buffer_hdata_search_full_name_cb, NULL);
     }
     return hdata;
 }
@@ -4319,6 +4748,8 @@ gui_buffer_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!infolist_new_var_integer (ptr_item, "input_get_unknown_commands", buffer->input_get_unknown_commands))
         return 0;
+    if (!infolist_new_var_integer (ptr_item, "input_multiline", buffer->input_multiline))
+        return 0;
     if (!infolist_new_var_string (ptr_item, "input_buffer", buffer->input_buffer))
         return 0;
     if (!infolist_new_var_integer (ptr_item, "input_buffer_alloc", buffer->input_buffer_alloc))
@@ -4378,6 +4809,63 @@ gui_buffer_add_to_infolist (struct t_infolist *infolist,
     return 1;
 }
 
+/*
+ * Adds memory used by a buffer (lines and nicklist) in an infolist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+gui_buffer_memory_add_to_infolist (struct t_infolist *infolist,
+                                   struct t_gui_buffer *buffer)
+{
+    struct t_infolist_item *ptr_item;
+
+    if (!infolist || !buffer)
+        return 0;
+
+    ptr_item = infolist_new_item (infolist);
+    if (!ptr_item)
+        return 0;
+
+    if (!infolist_new_var_pointer (ptr_item, "pointer", buffer))
+        return 0;
+    if (!infolist_new_var_string (ptr_item, "plugin_name",
+                                  gui_buffer_get_plugin_name (buffer)))
+        return 0;
+    if (!infolist_new_var_string (ptr_item, "full_name", buffer->full_name))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "lines_count",
+                                   buffer->own_lines->lines_count))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "lines_memory",
+                                   (int)gui_lines_get_memory (buffer->own_lines, 1)))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "mixed_lines_count",
+                                   (buffer->mixed_lines) ?
+                                   buffer->mixed_lines->lines_count : 0))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "mixed_lines_memory",
+                                   (int)gui_lines_get_memory (buffer->mixed_lines, 0)))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "nicklist_groups_count",
+                                   buffer->nicklist_groups_count))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "nicklist_nicks_count",
+                                   buffer->nicklist_nicks_count))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "nicklist_memory",
+                                   (int)gui_nicklist_get_memory (buffer->nicklist_root)))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "local_variables_count",
+                                   buffer->local_variables->items_count))
+        return 0;
+
+    return 1;
+}
+
 /*
  * Dumps content of buffer as hexa data in WeeChat log file.
  */
@@ -4399,7 +4887,7 @@ gui_buffer_dump_hexa (struct t_gui_buffer *buffer)
         prefix_without_colors = (ptr_line->data->prefix) ?
             gui_color_decode (ptr_line->data->prefix, NULL) : NULL;
         message_without_colors = (ptr_line->data->message) ?
-            gui_color_decode (ptr_line->data->message, NULL) : NULL;
+            gui_line_data_get_message_no_color (ptr_line->data) : NULL;
         log_printf ("");
         log_printf ("  line %d: %s | %s",
                     num_line,
@@ -4411,7 +4899,8 @@ gui_buffer_dump_hexa (struct t_gui_buffer *buffer)
             free (message_without_colors);
         tags = string_build_with_split_string ((const char **)ptr_line->data->tags_array,
                                                ",");
-        log_printf ("  tags: '%s', displayed: %d, highlight: %d",
+        log_printf ("  id: %ld, tags: '%s', displayed: %d, highlight: %d",
+                    ptr_line->data->id,
                     (tags) ? tags : "(none)",
                     ptr_line->data->displayed,
                     ptr_line->data->highlight);
@@ -4511,8 +5000,17 @@ gui_buffer_print_log ()
         log_printf ("  mixed_lines . . . . . . : 0x%lx", ptr_buffer->mixed_lines);
         gui_lines_print_log (ptr_buffer->mixed_lines);
         log_printf ("  lines . . . . . . . . . : 0x%lx", ptr_buffer->lines);
+        log_printf ("  lines_cold. . . . . . . : 0x%lx", ptr_buffer->lines_cold);
+        gui_line_cold_print_log (ptr_buffer->lines_cold);
+        log_printf ("  lines_added . . . . . . : %ld",   ptr_buffer->lines_added);
         log_printf ("  time_for_each_line. . . : %d",    ptr_buffer->time_for_each_line);
         log_printf ("  chat_refresh_needed . . : %d",    ptr_buffer->chat_refresh_needed);
+        log_printf ("  lines_batch . . . . . . : %d",    ptr_buffer->lines_batch);
+        log_printf ("  lines_batch_count . . . : %d",    ptr_buffer->lines_batch_count);
+        log_printf ("  lines_batch_hidden. . . : %d",    ptr_buffer->lines_batch_hidden);
+        log_printf ("  lines_batch_removed . . : %d",    ptr_buffer->lines_batch_removed);
+        log_printf ("  lines_batch_hotlist . . : 0x%lx", ptr_buffer->lines_batch_hotlist);
+        log_printf ("  lines_batch_top_line. . : 0x%lx", ptr_buffer->lines_batch_top_line);
         log_printf ("  nicklist. . . . . . . . : %d",    ptr_buffer->nicklist);
         log_printf ("  nicklist_case_sensitive : %d",    ptr_buffer->nicklist_case_sensitive);
         log_printf ("  nicklist_root . . . . . : 0x%lx", ptr_buffer->nicklist_root);
@@ -4522,6 +5020,10 @@ gui_buffer_print_log ()
         log_printf ("  nicklist_groups_count . : %d",    ptr_buffer->nicklist_groups_count);
         log_printf ("  nicklist_nicks_count. . : %d",    ptr_buffer->nicklist_nicks_count);
         log_printf ("  nicklist_visible_count. : %d",    ptr_buffer->nicklist_visible_count);
+        log_printf ("  nicklist_batch. . . . . : %d",    ptr_buffer->nicklist_batch);
+        log_printf ("  nicklist_batch_changes. : %d",    ptr_buffer->nicklist_batch_changes);
+        log_printf ("  nicklist_nicks_index. . : 0x%lx", ptr_buffer->nicklist_nicks_index);
+        log_printf ("  nicklist_groups_index . : 0x%lx", ptr_buffer->nicklist_groups_index);
         log_printf ("  nickcmp_callback. . . . : 0x%lx", ptr_buffer->nickcmp_callback);
         log_printf ("  nickcmp_callback_pointer: 0x%lx", ptr_buffer->nickcmp_callback_pointer);
         log_printf ("  nickcmp_callback_data . : 0x%lx", ptr_buffer->nickcmp_callback_data);
@@ -4530,6 +5032,7 @@ gui_buffer_print_log ()
         log_printf ("  input_callback_pointer. : 0x%lx", ptr_buffer->input_callback_pointer);
         log_printf ("  input_callback_data . . : 0x%lx", ptr_buffer->input_callback_data);
         log_printf ("  input_get_unknown_cmd . : %d",    ptr_buffer->input_get_unknown_commands);
+        log_printf ("  input_multiline . . . . : %d",    ptr_buffer->input_multiline);
         log_printf ("  input_buffer. . . . . . : '%s'",  ptr_buffer->input_buffer);
         log_printf ("  input_buffer_alloc. . . : %d",    ptr_buffer->input_buffer_alloc);
         log_printf ("  input_buffer_size . . . : %d",    ptr_buffer->input_buffer_size);
@@ -4555,6 +5058,7 @@ gui_buffer_print_log ()
         log_printf ("  last_history. . . . . . : 0x%lx", ptr_buffer->last_history);
         log_printf ("  ptr_history . . . . . . : 0x%lx", ptr_buffer->ptr_history);
         log_printf ("  num_history . . . . . . : %d",    ptr_buffer->num_history);
+        log_printf ("  history_index . . . . . : 0x%lx", ptr_buffer->history_index);
         log_printf ("  text_search . . . . . . : %d",    ptr_buffer->text_search);
         log_printf ("  text_search_exact . . . : %d",    ptr_buffer->text_search_exact);
         log_printf ("  text_search_regex . . . : %d",    ptr_buffer->text_search_regex);
@@ -4565,6 +5069,7 @@ gui_buffer_print_log ()
         log_printf ("  highlight_words . . . . : '%s'",  ptr_buffer->highlight_words);
         log_printf ("  highlight_regex . . . . : '%s'",  ptr_buffer->highlight_regex);
         log_printf ("  highlight_regex_compiled: 0x%lx", ptr_buffer->highlight_regex_compiled);
+        log_printf ("  highlight_words_compiled: 0x%lx", ptr_buffer->highlight_words_compiled);
         log_printf ("  highlight_tags_restrict. . . : '%s'",  ptr_buffer->highlight_tags_restrict);
         log_printf ("  highlight_tags_restrict_count: %d",    ptr_buffer->highlight_tags_restrict_count);
         log_printf ("  highlight_tags_restrict_array: 0x%lx", ptr_buffer->highlight_tags_restrict_array);
@@ -26,6 +26,7 @@
 struct t_hashtable;
 struct t_gui_window;
 struct t_infolist;
+struct t_string_highlight;
 
 enum t_gui_buffer_type
 {
@@ -45,6 +46,85 @@ enum t_gui_buffer_notify
     GUI_BUFFER_NUM_NOTIFY,
 };
 
+/* properties for functions gui_buffer_get_xxx and gui_buffer_set */
+
+enum t_gui_buffer_property
+{
+    GUI_BUFFER_PROPERTY_NUMBER = 0,
+    GUI_BUFFER_PROPERTY_LAYOUT_NUMBER,
+    GUI_BUFFER_PROPERTY_LAYOUT_NUMBER_MERGE_ORDER,
+    GUI_BUFFER_PROPERTY_SHORT_NAME_IS_SET,
+    GUI_BUFFER_PROPERTY_TYPE,
+    GUI_BUFFER_PROPERTY_NOTIFY,
+    GUI_BUFFER_PROPERTY_NUM_DISPLAYED,
+    GUI_BUFFER_PROPERTY_ACTIVE,
+    GUI_BUFFER_PROPERTY_HIDDEN,
+    GUI_BUFFER_PROPERTY_ZOOMED,
+    GUI_BUFFER_PROPERTY_PRINT_HOOKS_ENABLED,
+    GUI_BUFFER_PROPERTY_DAY_CHANGE,
+    GUI_BUFFER_PROPERTY_CLEAR,
+    GUI_BUFFER_PROPERTY_FILTER,
+    GUI_BUFFER_PROPERTY_CLOSING,
+    GUI_BUFFER_PROPERTY_LINES_HIDDEN,
+    GUI_BUFFER_PROPERTY_PREFIX_MAX_LENGTH,
+    GUI_BUFFER_PROPERTY_TIME_FOR_EACH_LINE,
+    GUI_BUFFER_PROPERTY_NICKLIST,
+    GUI_BUFFER_PROPERTY_NICKLIST_CASE_SENSITIVE,
+    GUI_BUFFER_PROPERTY_NICKLIST_MAX_LENGTH,
+    GUI_BUFFER_PROPERTY_NICKLIST_DISPLAY_GROUPS,
+    GUI_BUFFER_PROPERTY_NICKLIST_COUNT,
+    GUI_BUFFER_PROPERTY_NICKLIST_GROUPS_COUNT,
+    GUI_BUFFER_PROPERTY_NICKLIST_NICKS_COUNT,
+    GUI_BUFFER_PROPERTY_NICKLIST_VISIBLE_COUNT,
+    GUI_BUFFER_PROPERTY_NICKLIST_BATCH,
+    GUI_BUFFER_PROPERTY_LINES_BATCH,
+    GUI_BUFFER_PROPERTY_INPUT,
+    GUI_BUFFER_PROPERTY_INPUT_GET_UNKNOWN_COMMANDS,
+    GUI_BUFFER_PROPERTY_INPUT_MULTILINE,
+    GUI_BUFFER_PROPERTY_INPUT_SIZE,
+    GUI_BUFFER_PROPERTY_INPUT_LENGTH,
+    GUI_BUFFER_PROPERTY_INPUT_POS,
+    GUI_BUFFER_PROPERTY_INPUT_1ST_DISPLAY,
+    GUI_BUFFER_PROPERTY_NUM_HISTORY,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH_EXACT,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH_REGEX,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH_WHERE,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH_FOUND,
+    GUI_BUFFER_PROPERTY_PLUGIN,
+    GUI_BUFFER_PROPERTY_NAME,
+    GUI_BUFFER_PROPERTY_FULL_NAME,
+    GUI_BUFFER_PROPERTY_SHORT_NAME,
+    GUI_BUFFER_PROPERTY_TITLE,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH_INPUT,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_REGEX,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_TAGS_RESTRICT,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_TAGS,
+    GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS,
+    GUI_BUFFER_PROPERTY_TEXT_SEARCH_REGEX_COMPILED,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_REGEX_COMPILED,
+    GUI_BUFFER_PROPERTY_HOTLIST,
+    GUI_BUFFER_PROPERTY_COMPLETION_FREEZE,
+    GUI_BUFFER_PROPERTY_UNREAD,
+    GUI_BUFFER_PROPERTY_DISPLAY,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS_ADD,
+    GUI_BUFFER_PROPERTY_HIGHLIGHT_WORDS_DEL,
+    GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS_ADD,
+    GUI_BUFFER_PROPERTY_HOTLIST_MAX_LEVEL_NICKS_DEL,
+    GUI_BUFFER_PROPERTY_CLOSE_CALLBACK,
+    GUI_BUFFER_PROPERTY_CLOSE_CALLBACK_POINTER,
+    GUI_BUFFER_PROPERTY_CLOSE_CALLBACK_DATA,
+    GUI_BUFFER_PROPERTY_NICKCMP_CALLBACK,
+    GUI_BUFFER_PROPERTY_NICKCMP_CALLBACK_POINTER,
+    GUI_BUFFER_PROPERTY_NICKCMP_CALLBACK_DATA,
+    GUI_BUFFER_PROPERTY_INPUT_CALLBACK,
+    GUI_BUFFER_PROPERTY_INPUT_CALLBACK_POINTER,
+    GUI_BUFFER_PROPERTY_INPUT_CALLBACK_DATA,
+    /* number of buffer properties */
+    GUI_BUFFER_NUM_PROPERTIES,
+};
+
 #define GUI_BUFFER_MAIN "weechat"
 
 #define GUI_BUFFERS_MAX 10000
@@ -121,9 +201,23 @@ struct t_gui_buffer
     struct t_gui_lines *mixed_lines;   /* mixed lines (if buffers merged)   */
     struct t_gui_lines *lines;         /* pointer to "own_lines" or         */
                                        /* "mixed_lines"                     */
+    struct t_gui_line_cold *lines_cold; /* lines removed, saved in a file   */
+                                       /* (see gui-line-cold.c)             */
+    long lines_added;                  /* number of lines added (metrics)   */
     int time_for_each_line;            /* time is displayed for each line?  */
     int chat_refresh_needed;           /* refresh for chat is needed ?      */
                                        /* (1=refresh, 2=erase+refresh)      */
+    int lines_batch;                   /* 1 if lines are added in a batch   */
+                                       /* (hotlist updated and chat         */
+                                       /* refreshed at the end of batch)    */
+    int lines_batch_count;             /* number of lines added in batch    */
+    int lines_batch_hidden;            /* number of hidden lines in batch   */
+    int lines_batch_removed;           /* number of lines removed in batch  */
+    int *lines_batch_hotlist;          /* hotlist counts (by priority) for  */
+                                       /* lines added in batch              */
+    struct t_gui_line *lines_batch_top_line; /* last line before batch     */
+                                       /* (batch "top": lines added after   */
+                                       /* it are moved on top of buffer)    */
 
     /* nicklist */
     int nicklist;                      /* = 1 if nicklist is enabled        */
@@ -135,6 +229,13 @@ struct t_gui_buffer
     int nicklist_groups_count;         /* number of groups                  */
     int nicklist_nicks_count;          /* number of nicks                   */
     int nicklist_visible_count;        /* number of nicks/groups to display */
+    int nicklist_batch;                /* 1 if nicks are added/changed in   */
+                                       /* a batch (sorted and signal sent   */
+                                       /* at the end of batch)              */
+    int nicklist_batch_changes;        /* number of changes in batch        */
+    struct t_hashtable *nicklist_nicks_index;  /* nicks by name             */
+    struct t_hashtable *nicklist_groups_index; /* groups by name (without   */
+                                       /* digits and '|' at beginning)      */
     int (*nickcmp_callback)(const void *pointer, /* called to compare nicks */
                             void *data,          /* (search in nicklist)    */
                             struct t_gui_buffer *buffer,
@@ -154,6 +255,8 @@ struct t_gui_buffer
                                        /* to this buffer                    */
     int input_get_unknown_commands;    /* 1 if unknown commands are sent to */
                                        /* input_callback                    */
+    int input_multiline;               /* 1 if many lines of data can be    */
+                                       /* sent to input_callback at once    */
     char *input_buffer;                /* input buffer                      */
     int input_buffer_alloc;            /* input buffer: allocated size      */
     int input_buffer_size;             /* buffer size in bytes              */
@@ -176,6 +279,8 @@ struct t_gui_buffer
     struct t_gui_history *last_history;/* last command in history           */
     struct t_gui_history *ptr_history; /* current command in history        */
     int num_history;                   /* number of commands in history     */
+    struct t_hashtable *history_index; /* text -> entry in history (if      */
+                                       /* duplicates are removed)           */
 
     /* text search */
     int text_search;                   /* text search type                  */
@@ -190,6 +295,9 @@ struct t_gui_buffer
     char *highlight_words;             /* list of words to highlight        */
     char *highlight_regex;             /* regex for highlight               */
     regex_t *highlight_regex_compiled; /* compiled regex                    */
+    struct t_string_highlight *highlight_words_compiled;
+                                       /* compiled buffer and global        */
+                                       /* highlight words                   */
     char *highlight_tags_restrict;     /* restrict highlight to these tags  */
     int highlight_tags_restrict_count; /* number of restricted tags         */
     char ***highlight_tags_restrict_array; /* array with restricted tags    */
@@ -226,6 +334,7 @@ struct t_gui_buffer_visited
 extern struct t_gui_buffer *gui_buffers;
 extern struct t_gui_buffer *last_gui_buffer;
 extern int gui_buffers_count;
+extern struct t_hashtable *gui_buffers_by_full_name;
 extern struct t_gui_buffer_visited *gui_buffers_visited;
 extern struct t_gui_buffer_visited *last_gui_buffer_visited;
 extern int gui_buffers_visited_index;
@@ -233,6 +342,7 @@ extern int gui_buffers_visited_count;
 extern int gui_buffers_visited_frozen;
 extern struct t_gui_buffer *gui_buffer_last_displayed;
 extern char *gui_buffer_notify_string[];
+extern char *gui_buffer_property_string[];
 extern char *gui_buffer_properties_get_integer[];
 extern char *gui_buffer_properties_get_string[];
 extern char *gui_buffer_properties_get_pointer[];
@@ -242,6 +352,8 @@ extern char *gui_buffer_properties_set[];
 
 extern const char *gui_buffer_get_plugin_name (struct t_gui_buffer *buffer);
 extern const char *gui_buffer_get_short_name (struct t_gui_buffer *buffer);
+extern void gui_buffer_index_add (struct t_gui_buffer *buffer);
+extern void gui_buffer_index_remove (struct t_gui_buffer *buffer);
 extern void gui_buffer_build_full_name (struct t_gui_buffer *buffer);
 extern void gui_buffer_notify_set_all ();
 extern void gui_buffer_input_buffer_init (struct t_gui_buffer *buffer);
@@ -261,6 +373,7 @@ extern struct t_gui_buffer *gui_buffer_new (struct t_weechat_plugin *plugin,
 extern int gui_buffer_valid (struct t_gui_buffer *buffer);
 extern char *gui_buffer_string_replace_local_var (struct t_gui_buffer *buffer,
                                                   const char *string);
+extern struct t_string_highlight *gui_buffer_get_highlight_words_compiled (struct t_gui_buffer *buffer);
 extern int gui_buffer_match_list_split (struct t_gui_buffer *buffer,
                                         int num_buffers, char **buffers);
 extern int gui_buffer_match_list (struct t_gui_buffer *buffer,
@@ -268,10 +381,17 @@ extern int gui_buffer_match_list (struct t_gui_buffer *buffer,
 extern void gui_buffer_set_plugin_for_upgrade (char *name,
                                                struct t_weechat_plugin *plugin);
 extern int gui_buffer_property_in_list (char *properties[], char *property);
+extern int gui_buffer_search_property (const char *property);
+extern int gui_buffer_get_integer_id (struct t_gui_buffer *buffer,
+                                      int property);
 extern int gui_buffer_get_integer (struct t_gui_buffer *buffer,
                                    const char *property);
+extern const char *gui_buffer_get_string_id (struct t_gui_buffer *buffer,
+                                             int property);
 extern const char *gui_buffer_get_string (struct t_gui_buffer *buffer,
                                           const char *property);
+extern void *gui_buffer_get_pointer_id (struct t_gui_buffer *buffer,
+                                        int property);
 extern void *gui_buffer_get_pointer (struct t_gui_buffer *buffer,
                                      const char *property);
 extern void gui_buffer_ask_chat_refresh (struct t_gui_buffer *buffer,
@@ -303,6 +423,7 @@ extern struct t_gui_buffer *gui_buffer_search_by_name (const char *plugin,
                                                        const char *name);
 extern struct t_gui_buffer *gui_buffer_search_by_partial_name (const char *plugin,
                                                                const char *name);
+extern struct t_gui_buffer *gui_buffer_search_number_pos (int number);
 extern struct t_gui_buffer *gui_buffer_search_by_number (int number);
 extern struct t_gui_buffer *gui_buffer_search_by_number_or_name (const char *string);
 extern struct t_gui_buffer *gui_buffer_search_by_layout_number (int layout_number,
@@ -355,6 +476,8 @@ extern struct t_hdata *gui_buffer_hdata_buffer_visited_cb (const void *pointer,
 extern int gui_buffer_add_to_infolist (struct t_infolist *infolist,
                                        struct t_gui_buffer *buffer);
 extern void gui_buffer_dump_hexa (struct t_gui_buffer *buffer);
+extern int gui_buffer_memory_add_to_infolist (struct t_infolist *infolist,
+                                              struct t_gui_buffer *buffer);
 extern void gui_buffer_print_log ();
 
 #endif /* WEECHAT_GUI_BUFFER_H */
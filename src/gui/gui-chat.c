@@ -24,6 +24,7 @@
 #endif
 
 #include <stdlib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -55,8 +56,18 @@ int gui_chat_time_length = 0;    /* length of time for each line (in chars) */
 int gui_chat_mute = GUI_CHAT_MUTE_DISABLED;     /* mute mode                */
 struct t_gui_buffer *gui_chat_mute_buffer = NULL; /* mute buffer            */
 int gui_chat_display_tags = 0;                  /* display tags?            */
+int gui_chat_layout_generation = 1;             /* generation of layout of  */
+                                                /* lines (cached in lines)  */
 char *gui_chat_lines_waiting_buffer = NULL;     /* lines waiting for core   */
                                                 /* buffer                   */
+struct t_gui_chat_time_cache gui_chat_time_cache[GUI_CHAT_TIME_CACHE_SIZE];
+                                                /* last time strings built  */
+int gui_chat_time_cache_index = 0;              /* next entry to replace    */
+char *gui_chat_time_string_evaluated = NULL;    /* last time string with    */
+                                                /* evaluated format         */
+struct t_gui_chat_scratch *gui_chat_scratch = NULL; /* scratch buffers      */
+int gui_chat_scratch_count = 0;                 /* number of scratch buffers*/
+int gui_chat_scratch_level = 0;                 /* scratch buffers in use   */
 
 
 /*
@@ -383,25 +394,24 @@ gui_chat_get_word_info (struct t_gui_window *window,
 }
 
 /*
- * Gets time string, for display (with colors).
+ * Builds time string, for display (with colors).
+ *
+ * If "evaluated" is not NULL, it is set to 1 if the time string has been
+ * evaluated (format with "${...}"), otherwise 0.
  *
  * Note: result must be freed after use.
  */
 
 char *
-gui_chat_get_time_string (time_t date)
+gui_chat_build_time_string (time_t date, int *evaluated)
 {
     char text_time[128], text_time2[(128*3)+16], text_time_char[2];
     char *text_with_color;
     int i, time_first_digit, time_last_digit, last_color;
     struct tm *local_time;
 
-    if (date == 0)
-        return NULL;
-
-    if (!CONFIG_STRING(config_look_buffer_time_format)
-        || !CONFIG_STRING(config_look_buffer_time_format)[0])
-        return NULL;
+    if (evaluated)
+        *evaluated = 0;
 
     local_time = localtime (&date);
     if (!local_time)
@@ -413,6 +423,8 @@ gui_chat_get_time_string (time_t date)
 
     if (strstr (text_time, "${"))
     {
+        if (evaluated)
+            *evaluated = 1;
         text_with_color = eval_expression (text_time, NULL, NULL, NULL);
         if (text_with_color)
         {
@@ -492,6 +504,101 @@ gui_chat_get_time_string (time_t date)
     return strdup (text_time2);
 }
 
+/*
+ * Gets time string, for display (with colors).
+ *
+ * Lines are often added with the same date (same second), so the last time
+ * strings built are kept in a small ring (by date and time format) and
+ * reused; a time string with an evaluated format ("${...}") is not kept,
+ * since its result may change on each evaluation.
+ *
+ * Returns pointer to time string, NULL if there is no time to display.
+ *
+ * Note: result must NOT be freed, it is valid until next call to this
+ * function.
+ */
+
+const char *
+gui_chat_get_time_string_cached (time_t date)
+{
+    const char *format;
+    char *str_time;
+    int i, evaluated;
+    struct t_gui_chat_time_cache *ptr_cache;
+
+    if (date == 0)
+        return NULL;
+
+    format = CONFIG_STRING(config_look_buffer_time_format);
+    if (!format || !format[0])
+        return NULL;
+
+    for (i = 0; i < GUI_CHAT_TIME_CACHE_SIZE; i++)
+    {
+        ptr_cache = &gui_chat_time_cache[i];
+        if (ptr_cache->str_time
+            && (ptr_cache->date == date)
+            && (strcmp (ptr_cache->format, format) == 0))
+        {
+            return ptr_cache->str_time;
+        }
+    }
+
+    str_time = gui_chat_build_time_string (date, &evaluated);
+    if (!str_time)
+        return NULL;
+
+    if (evaluated)
+    {
+        if (gui_chat_time_string_evaluated)
+            free (gui_chat_time_string_evaluated);
+        gui_chat_time_string_evaluated = str_time;
+        return str_time;
+    }
+
+    ptr_cache = &gui_chat_time_cache[gui_chat_time_cache_index];
+    if (!ptr_cache->format || (strcmp (ptr_cache->format, format) != 0))
+    {
+        if (ptr_cache->format)
+            free (ptr_cache->format);
+        ptr_cache->format = strdup (format);
+        if (!ptr_cache->format)
+        {
+            free (str_time);
+            if (ptr_cache->str_time)
+            {
+                free (ptr_cache->str_time);
+                ptr_cache->str_time = NULL;
+            }
+            return NULL;
+        }
+    }
+    if (ptr_cache->str_time)
+        free (ptr_cache->str_time);
+    ptr_cache->date = date;
+    ptr_cache->str_time = str_time;
+    gui_chat_time_cache_index = (gui_chat_time_cache_index + 1)
+        % GUI_CHAT_TIME_CACHE_SIZE;
+
+    return str_time;
+}
+
+/*
+ * Gets time string, for display (with colors).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_chat_get_time_string (time_t date)
+{
+    const char *str_time;
+
+    str_time = gui_chat_get_time_string_cached (date);
+
+    return (str_time) ? strdup (str_time) : NULL;
+}
+
 /*
  * Calculates time length with a time format (format can include color codes
  * with format ${name}).
@@ -539,12 +646,34 @@ gui_chat_change_time_format ()
         {
             if (ptr_line->data->date != 0)
             {
-                if (ptr_line->data->str_time)
-                    free (ptr_line->data->str_time);
+                gui_line_data_free_string (ptr_line->data,
+                                           &ptr_line->data->str_time);
                 ptr_line->data->str_time = gui_chat_get_time_string (ptr_line->data->date);
             }
         }
     }
+
+    gui_chat_layout_invalidate ();
+}
+
+/*
+ * Invalidates layout cached in all lines (called when something that changes
+ * the way lines are wrapped on screen has changed: option, content of a
+ * line, ...).
+ *
+ * The layout is also cached with the width of chat area and the alignment
+ * of line, so a change in one of these values does not require to call this
+ * function.
+ */
+
+void
+gui_chat_layout_invalidate ()
+{
+    /* 0 is reserved for "no layout cached" */
+    if (gui_chat_layout_generation == INT_MAX)
+        gui_chat_layout_generation = 1;
+    else
+        gui_chat_layout_generation++;
 }
 
 /*
@@ -633,62 +762,235 @@ gui_chat_build_string_message_tags (struct t_gui_line *line)
 }
 
 /*
- * Displays a message in a buffer with optional date and tags.
+ * Checks if a message can be printed in a buffer and returns the buffer to
+ * use in *buffer: main buffer if buffer is NULL, first buffer if buffer has
+ * free content (before the GUI is initialized, buffer is not changed).
  *
- * Note: this function works only with formatted buffers (not buffers with free
- * content).
+ * Returns:
+ *   1: message can be printed
+ *   0: message must not be printed (invalid or closing buffer, mute enabled)
  */
 
-void
-gui_chat_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
-                           const char *tags, const char *message, ...)
+int
+gui_chat_get_print_buffer (struct t_gui_buffer **buffer)
 {
-    time_t date_printed;
-    int display_time, length, at_least_one_message_printed, msg_discarded;
-    char *pos, *pos_prefix, *pos_tab, *pos_end, *pos_lines;
-    char *modifier_data, *new_msg, *ptr_msg, *lines_waiting;
-    struct t_gui_line *ptr_line;
-
-    if (!message)
-        return;
-
-    if (!gui_buffer_valid (buffer))
-        return;
+    if (!gui_buffer_valid (*buffer))
+        return 0;
 
     if (gui_init_ok)
     {
-        if (!buffer)
-            buffer = gui_buffer_search_main ();
+        if (!*buffer)
+            *buffer = gui_buffer_search_main ();
 
-        if (!buffer || buffer->closing)
-            return;
+        if (!*buffer || (*buffer)->closing)
+            return 0;
 
-        if (buffer->type != GUI_BUFFER_TYPE_FORMATTED)
-            buffer = gui_buffers;
+        if ((*buffer)->type != GUI_BUFFER_TYPE_FORMATTED)
+            *buffer = gui_buffers;
 
-        if (buffer->type != GUI_BUFFER_TYPE_FORMATTED)
-            return;
+        if ((*buffer)->type != GUI_BUFFER_TYPE_FORMATTED)
+            return 0;
     }
 
-    /* if mute is enabled for buffer (or all buffers), then just return */
+    /* if mute is enabled for buffer (or all buffers), then nothing is printed */
     if ((gui_chat_mute == GUI_CHAT_MUTE_ALL_BUFFERS)
         || ((gui_chat_mute == GUI_CHAT_MUTE_BUFFER)
-            && (gui_chat_mute_buffer == buffer)))
-        return;
+            && (gui_chat_mute_buffer == *buffer)))
+        return 0;
 
-    weechat_va_format (message);
-    if (!vbuffer)
+    return 1;
+}
+
+/*
+ * Returns the scratch buffer of current nesting level, with at least "size"
+ * bytes allocated.
+ *
+ * Scratch buffers are used to format messages printed without allocating
+ * memory for each message: a message printed can cause another message to be
+ * printed (for example by a modifier or a print hook), so there is one
+ * scratch buffer by nesting level. They are used only in the main thread.
+ *
+ * Returns NULL if error.
+ */
+
+char *
+gui_chat_scratch_get (int size)
+{
+    struct t_gui_chat_scratch *new_scratch, *ptr_scratch;
+    char *new_buffer;
+
+    if (gui_chat_scratch_level >= gui_chat_scratch_count)
+    {
+        new_scratch = realloc (gui_chat_scratch,
+                               (gui_chat_scratch_count + 1) * sizeof (new_scratch[0]));
+        if (!new_scratch)
+            return NULL;
+        gui_chat_scratch = new_scratch;
+        gui_chat_scratch[gui_chat_scratch_count].buffer = NULL;
+        gui_chat_scratch[gui_chat_scratch_count].size = 0;
+        gui_chat_scratch_count++;
+    }
+
+    ptr_scratch = &gui_chat_scratch[gui_chat_scratch_level];
+    if (ptr_scratch->size < size)
+    {
+        new_buffer = realloc (ptr_scratch->buffer, size);
+        if (!new_buffer)
+            return NULL;
+        ptr_scratch->buffer = new_buffer;
+        ptr_scratch->size = size;
+    }
+
+    return ptr_scratch->buffer;
+}
+
+/*
+ * Formats a message in scratch buffer of current nesting level.
+ *
+ * Returns pointer to formatted message, NULL if error.
+ *
+ * Note: if not NULL, result must be given back with gui_chat_scratch_release
+ * after use (and must not be freed).
+ */
+
+char *
+gui_chat_scratch_vprintf (const char *format, va_list args)
+{
+    va_list args_copy;
+    char *buffer;
+    int size, num;
+
+    size = 1024;
+    if ((gui_chat_scratch_level < gui_chat_scratch_count)
+        && (gui_chat_scratch[gui_chat_scratch_level].size > size))
+    {
+        size = gui_chat_scratch[gui_chat_scratch_level].size;
+    }
+
+    while (1)
+    {
+        buffer = gui_chat_scratch_get (size);
+        if (!buffer)
+            return NULL;
+        va_copy (args_copy, args);
+        num = vsnprintf (buffer, size, format, args_copy);
+        va_end (args_copy);
+        if ((num >= 0) && (num < size))
+            break;
+        size = (num >= 0) ? num + 1 : size * 2;
+    }
+
+    gui_chat_scratch_level++;
+
+    return buffer;
+}
+
+/*
+ * Copies a string in scratch buffer of current nesting level.
+ *
+ * Returns pointer to copy of string, NULL if error.
+ *
+ * Note: if not NULL, result must be given back with gui_chat_scratch_release
+ * after use (and must not be freed).
+ */
+
+char *
+gui_chat_scratch_strdup (const char *string)
+{
+    char *buffer;
+    int length;
+
+    length = strlen (string) + 1;
+    buffer = gui_chat_scratch_get (length);
+    if (!buffer)
+        return NULL;
+
+    memcpy (buffer, string, length);
+
+    gui_chat_scratch_level++;
+
+    return buffer;
+}
+
+/*
+ * Gives back the last scratch buffer returned by gui_chat_scratch_vprintf or
+ * gui_chat_scratch_strdup (a big buffer is freed).
+ */
+
+void
+gui_chat_scratch_release ()
+{
+    struct t_gui_chat_scratch *ptr_scratch;
+
+    if (gui_chat_scratch_level <= 0)
         return;
 
-    utf8_normalize (vbuffer, '?');
+    gui_chat_scratch_level--;
 
-    date_printed = time (NULL);
-    if (date <= 0)
-        date = date_printed;
+    ptr_scratch = &gui_chat_scratch[gui_chat_scratch_level];
+    if (ptr_scratch->size > GUI_CHAT_SCRATCH_MAX_KEEP)
+    {
+        free (ptr_scratch->buffer);
+        ptr_scratch->buffer = NULL;
+        ptr_scratch->size = 0;
+    }
+}
+
+/*
+ * Builds data for modifier "weechat_print": "plugin;buffer_name;tags".
+ *
+ * Returns NULL if there is no modifier "weechat_print".
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_chat_build_print_modifier_data (struct t_gui_buffer *buffer,
+                                    const char *tags)
+{
+    char *modifier_data;
+    int length;
+
+    if (!buffer || !hook_modifier_exists (NULL, "weechat_print"))
+        return NULL;
+
+    length = strlen (gui_buffer_get_plugin_name (buffer)) + 1 +
+        strlen (buffer->name) + 1 + ((tags) ? strlen (tags) : 0) + 1;
+    modifier_data = malloc (length);
+    if (!modifier_data)
+        return NULL;
+
+    snprintf (modifier_data, length, "%s;%s;%s",
+              gui_buffer_get_plugin_name (buffer),
+              buffer->name,
+              (tags) ? tags : "");
+
+    return modifier_data;
+}
+
+/*
+ * Adds lines of a message (separated by "\n") in a buffer; the message is
+ * modified by this function.
+ *
+ * Argument "modifier_data" is the data sent to modifier "weechat_print"
+ * (NULL if the modifier is not called).
+ *
+ * Returns 1 if at least one line displayed was added, otherwise 0.
+ */
+
+int
+gui_chat_print_message (struct t_gui_buffer *buffer, time_t date,
+                        time_t date_printed, const char *tags,
+                        const char *modifier_data, char *message)
+{
+    int display_time, length, at_least_one_message_printed, msg_discarded;
+    char *pos, *pos_prefix, *pos_tab, *pos_end, *pos_lines;
+    char *new_msg, *ptr_msg, *lines_waiting;
+    struct t_gui_line *ptr_line;
 
     at_least_one_message_printed = 0;
 
-    pos = vbuffer;
+    pos = message;
     while (pos)
     {
         /* display until next end of line */
@@ -699,40 +1001,29 @@ gui_chat_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
         /* call modifier for message printed ("weechat_print") */
         new_msg = NULL;
         msg_discarded = 0;
-        if (buffer)
+        if (modifier_data)
         {
-            length = strlen (gui_buffer_get_plugin_name (buffer)) + 1 +
-                strlen (buffer->name) + 1 + ((tags) ? strlen (tags) : 0) + 1;
-            modifier_data = malloc (length);
-            if (modifier_data)
+            new_msg = hook_modifier_exec (NULL,
+                                          "weechat_print",
+                                          modifier_data,
+                                          pos);
+            if (new_msg)
             {
-                snprintf (modifier_data, length, "%s;%s;%s",
-                          gui_buffer_get_plugin_name (buffer),
-                          buffer->name,
-                          (tags) ? tags : "");
-                new_msg = hook_modifier_exec (NULL,
-                                              "weechat_print",
-                                              modifier_data,
-                                              pos);
-                free (modifier_data);
-                if (new_msg)
+                if (!new_msg[0] && pos[0])
                 {
-                    if (!new_msg[0] && pos[0])
-                    {
-                        /*
-                         * modifier returned empty message, then we'll not
-                         * print anything
-                         */
-                        free (new_msg);
-                        new_msg = NULL;
-                        msg_discarded = 1;
-                    }
-                    else if (strcmp (message, new_msg) == 0)
-                    {
-                        /* no changes in new message */
-                        free (new_msg);
-                        new_msg = NULL;
-                    }
+                    /*
+                     * modifier returned empty message, then we'll not
+                     * print anything
+                     */
+                    free (new_msg);
+                    new_msg = NULL;
+                    msg_discarded = 1;
+                }
+                else if (strcmp (pos, new_msg) == 0)
+                {
+                    /* no changes in new message */
+                    free (new_msg);
+                    new_msg = NULL;
                 }
             }
         }
@@ -832,10 +1123,117 @@ gui_chat_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
         pos = (pos_end && pos_end[1]) ? pos_end + 1 : NULL;
     }
 
-    if (gui_init_ok && at_least_one_message_printed)
+    return at_least_one_message_printed;
+}
+
+/*
+ * Displays a message in a buffer with optional date and tags.
+ *
+ * Note: this function works only with formatted buffers (not buffers with free
+ * content).
+ */
+
+void
+gui_chat_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
+                           const char *tags, const char *message, ...)
+{
+    va_list args;
+    time_t date_printed;
+    int at_least_one_message_printed;
+    char *modifier_data, *vbuffer;
+
+    if (!message)
+        return;
+
+    if (!gui_chat_get_print_buffer (&buffer))
+        return;
+
+    va_start (args, message);
+    vbuffer = gui_chat_scratch_vprintf (message, args);
+    va_end (args);
+    if (!vbuffer)
+        return;
+
+    utf8_normalize (vbuffer, '?');
+
+    date_printed = time (NULL);
+    if (date <= 0)
+        date = date_printed;
+
+    modifier_data = gui_chat_build_print_modifier_data (buffer, tags);
+
+    at_least_one_message_printed = gui_chat_print_message (buffer, date,
+                                                           date_printed, tags,
+                                                           modifier_data,
+                                                           vbuffer);
+
+    if (modifier_data)
+        free (modifier_data);
+
+    if (gui_init_ok && at_least_one_message_printed && !buffer->lines_batch)
         gui_buffer_ask_chat_refresh (buffer, 1);
 
-    free (vbuffer);
+    gui_chat_scratch_release ();
+}
+
+/*
+ * Displays many lines in a buffer with optional date and tags (lines are not
+ * formatted, and each line can contain "\n" to display more lines).
+ *
+ * Lines are added in a batch of lines (if no batch is already in progress in
+ * buffer): hotlist and refresh of chat are updated once for all lines, and a
+ * single signal "buffer_lines_added" is sent at the end (see function
+ * gui_line_set_batch).
+ *
+ * Note: this function works only with formatted buffers (not buffers with free
+ * content).
+ */
+
+void
+gui_chat_print_lines (struct t_gui_buffer *buffer, time_t date,
+                      const char *tags, const char **lines, int num_lines)
+{
+    time_t date_printed;
+    int i, batch_started;
+    char *modifier_data, *message;
+
+    if (!lines || (num_lines <= 0))
+        return;
+
+    if (!gui_chat_get_print_buffer (&buffer))
+        return;
+
+    date_printed = time (NULL);
+    if (date <= 0)
+        date = date_printed;
+
+    batch_started = 0;
+    if (gui_init_ok && !buffer->lines_batch)
+    {
+        gui_line_set_batch (buffer, 1);
+        batch_started = 1;
+    }
+
+    modifier_data = gui_chat_build_print_modifier_data (buffer, tags);
+
+    for (i = 0; i < num_lines; i++)
+    {
+        if (!lines[i])
+            continue;
+        message = gui_chat_scratch_strdup (lines[i]);
+        if (!message)
+            continue;
+        utf8_normalize (message, '?');
+        (void) gui_chat_print_message (buffer, date, date_printed, tags,
+                                       modifier_data, message);
+        gui_chat_scratch_release ();
+    }
+
+    if (modifier_data)
+        free (modifier_data);
+
+    if (batch_started)
+        gui_line_set_batch (buffer, 0);
 }
 
 /*
@@ -848,8 +1246,10 @@ gui_chat_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
 void
 gui_chat_printf_y (struct t_gui_buffer *buffer, int y, const char *message, ...)
 {
+    va_list args;
     struct t_gui_line *ptr_line;
     int i, num_lines_to_add;
+    char *vbuffer;
 
     if (!gui_buffer_valid (buffer))
         return;
@@ -869,7 +1269,9 @@ gui_chat_printf_y (struct t_gui_buffer *buffer, int y, const char *message, ...)
             return;
     }
 
-    weechat_va_format (message);
+    va_start (args, message);
+    vbuffer = gui_chat_scratch_vprintf (message, args);
+    va_end (args);
     if (!vbuffer)
         return;
 
@@ -930,7 +1332,7 @@ gui_chat_printf_y (struct t_gui_buffer *buffer, int y, const char *message, ...)
             string_fprintf (stdout, "%s\n", vbuffer);
     }
 
-    free (vbuffer);
+    gui_chat_scratch_release ();
 }
 
 /*
@@ -1106,4 +1508,39 @@ gui_chat_end ()
         free (gui_chat_lines_waiting_buffer);
         gui_chat_lines_waiting_buffer = NULL;
     }
+
+    /* free scratch buffers */
+    for (i = 0; i < gui_chat_scratch_count; i++)
+    {
+        if (gui_chat_scratch[i].buffer)
+            free (gui_chat_scratch[i].buffer);
+    }
+    if (gui_chat_scratch)
+    {
+        free (gui_chat_scratch);
+        gui_chat_scratch = NULL;
+    }
+    gui_chat_scratch_count = 0;
+    gui_chat_scratch_level = 0;
+
+    /* free cache of time strings */
+    for (i = 0; i < GUI_CHAT_TIME_CACHE_SIZE; i++)
+    {
+        if (gui_chat_time_cache[i].format)
+        {
+            free (gui_chat_time_cache[i].format);
+            gui_chat_time_cache[i].format = NULL;
+        }
+        if (gui_chat_time_cache[i].str_time)
+        {
+            free (gui_chat_time_cache[i].str_time);
+            gui_chat_time_cache[i].str_time = NULL;
+        }
+    }
+    gui_chat_time_cache_index = 0;
+    if (gui_chat_time_string_evaluated)
+    {
+        free (gui_chat_time_string_evaluated);
+        gui_chat_time_string_evaluated = NULL;
+    }
 }
@@ -20,6 +20,7 @@
 #ifndef WEECHAT_GUI_CHAT_H
 #define WEECHAT_GUI_CHAT_H 1
 
+#include <stdarg.h>
 #include <time.h>
 
 struct t_hashtable;
@@ -38,6 +39,11 @@ struct t_gui_line;
 #define GUI_CHAT_PREFIX_JOIN_DEFAULT    "-->"
 #define GUI_CHAT_PREFIX_QUIT_DEFAULT    "<--"
 
+#define GUI_CHAT_TIME_CACHE_SIZE 8
+
+/* scratch buffers bigger than this size are freed after use */
+#define GUI_CHAT_SCRATCH_MAX_KEEP (64 * 1024)
+
 enum t_gui_chat_prefix
 {
     GUI_CHAT_PREFIX_ERROR = 0,
@@ -56,12 +62,30 @@ enum t_gui_chat_mute
     GUI_CHAT_MUTE_ALL_BUFFERS,
 };
 
+/* time strings built for last dates (used when lines are added) */
+
+struct t_gui_chat_time_cache
+{
+    time_t date;                       /* date of line (seconds)            */
+    char *format;                      /* time format used to build string  */
+    char *str_time;                    /* time string (with colors)         */
+};
+
+/* scratch buffer used to format messages printed (one per nesting level) */
+
+struct t_gui_chat_scratch
+{
+    char *buffer;                      /* buffer (reused for each message)  */
+    int size;                          /* allocated size of buffer          */
+};
+
 extern char *gui_chat_prefix[GUI_CHAT_NUM_PREFIXES];
 extern char gui_chat_prefix_empty[];
 extern int gui_chat_time_length;
 extern int gui_chat_mute;
 extern struct t_gui_buffer *gui_chat_mute_buffer;
 extern int gui_chat_display_tags;
+extern int gui_chat_layout_generation;
 
 /* chat functions */
 
@@ -80,14 +104,28 @@ extern void gui_chat_get_word_info (struct t_gui_window *window,
                                     int *word_end_offset,
                                     int *word_length_with_spaces,
                                     int *word_length);
+extern const char *gui_chat_get_time_string_cached (time_t date);
 extern char *gui_chat_get_time_string (time_t date);
 extern int gui_chat_get_time_length ();
+extern void gui_chat_layout_invalidate ();
 extern void gui_chat_change_time_format ();
 extern char *gui_chat_build_string_prefix_message (struct t_gui_line *line);
 extern char *gui_chat_build_string_message_tags (struct t_gui_line *line);
+extern int gui_chat_get_print_buffer (struct t_gui_buffer **buffer);
+extern char *gui_chat_build_print_modifier_data (struct t_gui_buffer *buffer,
+                                                 const char *tags);
+extern char *gui_chat_scratch_vprintf (const char *format, va_list args);
+extern char *gui_chat_scratch_strdup (const char *string);
+extern void gui_chat_scratch_release ();
+extern int gui_chat_print_message (struct t_gui_buffer *buffer, time_t date,
+                                   time_t date_printed, const char *tags,
+                                   const char *modifier_data, char *message);
 extern void gui_chat_printf_date_tags (struct t_gui_buffer *buffer,
                                        time_t date, const char *tags,
                                        const char *message, ...);
+extern void gui_chat_print_lines (struct t_gui_buffer *buffer, time_t date,
+                                  const char *tags, const char **lines,
+                                  int num_lines);
 extern void gui_chat_printf_y (struct t_gui_buffer *buffer, int y,
                                const char *message, ...);
 extern void gui_chat_print_lines_waiting_buffer (FILE *f);
@@ -42,6 +42,7 @@
 #include "../plugins/plugin.h"
 #include "gui-color.h"
 #include "gui-chat.h"
+#include "gui-nick.h"
 #include "gui-window.h"
 
 
@@ -558,196 +559,338 @@ gui_color_convert_rgb_to_term (int rgb, int limit)
 }
 
 /*
- * Removes WeeChat color codes from a message.
- *
- * If replacement is not NULL and not empty, it is used to replace color codes
- * by first char of replacement (and next chars in string are NOT removed).
- * If replacement is NULL or empty, color codes are removed, with following
- * chars if they are related to color code.
+ * Skips a WeeChat color code at beginning of string.
  *
- * Note: result must be freed after use.
+ * Returns pointer to first char after the color code, NULL if string does not
+ * start with a color code.
  */
 
-char *
-gui_color_decode (const char *string, const char *replacement)
+const char *
+gui_color_skip_code (const char *string)
 {
     const unsigned char *ptr_string;
-    unsigned char *out;
-    int out_length, out_pos, length;
 
     if (!string)
         return NULL;
 
-    out_length = (strlen ((char *)string) * 2) + 1;
-    out = malloc (out_length);
-    if (!out)
-        return NULL;
+    ptr_string = (const unsigned char *)string;
 
-    ptr_string = (unsigned char *)string;
-    out_pos = 0;
-    while (ptr_string && ptr_string[0] && (out_pos < out_length - 1))
+    switch (ptr_string[0])
     {
-        switch (ptr_string[0])
-        {
-            case GUI_COLOR_COLOR_CHAR:
-                ptr_string++;
-                switch (ptr_string[0])
-                {
-                    case GUI_COLOR_FG_CHAR:
+        case GUI_COLOR_COLOR_CHAR:
+            ptr_string++;
+            switch (ptr_string[0])
+            {
+                case GUI_COLOR_FG_CHAR:
+                    ptr_string++;
+                    if (ptr_string[0] == GUI_COLOR_EXTENDED_CHAR)
+                    {
                         ptr_string++;
-                        if (ptr_string[0] == GUI_COLOR_EXTENDED_CHAR)
+                        while (gui_color_attr_get_flag (ptr_string[0]) > 0)
                         {
                             ptr_string++;
-                            while (gui_color_attr_get_flag (ptr_string[0]) > 0)
-                            {
-                                ptr_string++;
-                            }
-                            if (ptr_string[0] && ptr_string[1] && ptr_string[2]
-                                && ptr_string[3] && ptr_string[4])
-                            {
-                                ptr_string += 5;
-                            }
                         }
-                        else
+                        if (ptr_string[0] && ptr_string[1] && ptr_string[2]
+                            && ptr_string[3] && ptr_string[4])
                         {
-                            while (gui_color_attr_get_flag (ptr_string[0]) > 0)
-                            {
-                                ptr_string++;
-                            }
-                            if (ptr_string[0] && ptr_string[1])
-                                ptr_string += 2;
+                            ptr_string += 5;
                         }
-                        break;
-                    case GUI_COLOR_BG_CHAR:
-                        ptr_string++;
-                        if (ptr_string[0] == GUI_COLOR_EXTENDED_CHAR)
+                    }
+                    else
+                    {
+                        while (gui_color_attr_get_flag (ptr_string[0]) > 0)
                         {
                             ptr_string++;
-                            if (ptr_string[0] && ptr_string[1] && ptr_string[2]
-                                && ptr_string[3] && ptr_string[4])
-                            {
-                                ptr_string += 5;
-                            }
                         }
-                        else
+                        if (ptr_string[0] && ptr_string[1])
+                            ptr_string += 2;
+                    }
+                    break;
+                case GUI_COLOR_BG_CHAR:
+                    ptr_string++;
+                    if (ptr_string[0] == GUI_COLOR_EXTENDED_CHAR)
+                    {
+                        ptr_string++;
+                        if (ptr_string[0] && ptr_string[1] && ptr_string[2]
+                            && ptr_string[3] && ptr_string[4])
                         {
-                            if (ptr_string[0] && ptr_string[1])
-                                ptr_string += 2;
+                            ptr_string += 5;
                         }
-                        break;
-                    case GUI_COLOR_FG_BG_CHAR:
+                    }
+                    else
+                    {
+                        if (ptr_string[0] && ptr_string[1])
+                            ptr_string += 2;
+                    }
+                    break;
+                case GUI_COLOR_FG_BG_CHAR:
+                    ptr_string++;
+                    if (ptr_string[0] == GUI_COLOR_EXTENDED_CHAR)
+                    {
                         ptr_string++;
-                        if (ptr_string[0] == GUI_COLOR_EXTENDED_CHAR)
+                        while (gui_color_attr_get_flag (ptr_string[0]) > 0)
                         {
                             ptr_string++;
-                            while (gui_color_attr_get_flag (ptr_string[0]) > 0)
-                            {
-                                ptr_string++;
-                            }
-                            if (ptr_string[0] && ptr_string[1] && ptr_string[2]
-                                && ptr_string[3] && ptr_string[4])
-                            {
-                                ptr_string += 5;
-                            }
                         }
-                        else
+                        if (ptr_string[0] && ptr_string[1] && ptr_string[2]
+                            && ptr_string[3] && ptr_string[4])
                         {
-                            while (gui_color_attr_get_flag (ptr_string[0]) > 0)
-                            {
-                                ptr_string++;
-                            }
-                            if (ptr_string[0] && ptr_string[1])
-                                ptr_string += 2;
+                            ptr_string += 5;
                         }
-                        if (ptr_string[0] == ',')
+                    }
+                    else
+                    {
+                        while (gui_color_attr_get_flag (ptr_string[0]) > 0)
                         {
-                            if (ptr_string[1] == GUI_COLOR_EXTENDED_CHAR)
-                            {
-                                if (ptr_string[2] && ptr_string[3]
-                                    && ptr_string[4] && ptr_string[5]
-                                    && ptr_string[6])
-                                {
-                                    ptr_string += 7;
-                                }
-                            }
-                            else
+                            ptr_string++;
+                        }
+                        if (ptr_string[0] && ptr_string[1])
+                            ptr_string += 2;
+                    }
+                    if (ptr_string[0] == ',')
+                    {
+                        if (ptr_string[1] == GUI_COLOR_EXTENDED_CHAR)
+                        {
+                            if (ptr_string[2] && ptr_string[3]
+                                && ptr_string[4] && ptr_string[5]
+                                && ptr_string[6])
                             {
-                                if (ptr_string[1] && ptr_string[2])
-                                    ptr_string += 3;
+                                ptr_string += 7;
                             }
                         }
-                        break;
-                    case GUI_COLOR_EXTENDED_CHAR:
-                        if ((isdigit (ptr_string[1])) && (isdigit (ptr_string[2]))
-                            && (isdigit (ptr_string[3])) && (isdigit (ptr_string[4]))
-                            && (isdigit (ptr_string[5])))
-                            ptr_string += 6;
-                        break;
-                    case GUI_COLOR_EMPHASIS_CHAR:
-                        ptr_string++;
-                        break;
-                    case GUI_COLOR_BAR_CHAR:
-                        ptr_string++;
-                        switch (ptr_string[0])
+                        else
                         {
-                            case GUI_COLOR_BAR_FG_CHAR:
-                            case GUI_COLOR_BAR_BG_CHAR:
-                            case GUI_COLOR_BAR_DELIM_CHAR:
-                            case GUI_COLOR_BAR_START_INPUT_CHAR:
-                            case GUI_COLOR_BAR_START_INPUT_HIDDEN_CHAR:
-                            case GUI_COLOR_BAR_MOVE_CURSOR_CHAR:
-                            case GUI_COLOR_BAR_START_ITEM:
-                            case GUI_COLOR_BAR_START_LINE_ITEM:
-                                ptr_string++;
-                                break;
+                            if (ptr_string[1] && ptr_string[2])
+                                ptr_string += 3;
                         }
-                        break;
-                    case GUI_COLOR_RESET_CHAR:
-                        ptr_string++;
-                        break;
-                    default:
-                        if (isdigit (ptr_string[0]) && isdigit (ptr_string[1]))
-                            ptr_string += 2;
-                        break;
-                }
-                if (replacement && replacement[0])
-                {
-                    out[out_pos] = replacement[0];
-                    out_pos++;
-                }
-                break;
-            case GUI_COLOR_SET_ATTR_CHAR:
-            case GUI_COLOR_REMOVE_ATTR_CHAR:
-                ptr_string++;
-                if (ptr_string[0])
+                    }
+                    break;
+                case GUI_COLOR_EXTENDED_CHAR:
+                    if ((isdigit (ptr_string[1])) && (isdigit (ptr_string[2]))
+                        && (isdigit (ptr_string[3])) && (isdigit (ptr_string[4]))
+                        && (isdigit (ptr_string[5])))
+                        ptr_string += 6;
+                    break;
+                case GUI_COLOR_EMPHASIS_CHAR:
                     ptr_string++;
-                if (replacement && replacement[0])
-                {
-                    out[out_pos] = replacement[0];
-                    out_pos++;
-                }
-                break;
-            case GUI_COLOR_RESET_CHAR:
+                    break;
+                case GUI_COLOR_BAR_CHAR:
+                    ptr_string++;
+                    switch (ptr_string[0])
+                    {
+                        case GUI_COLOR_BAR_FG_CHAR:
+                        case GUI_COLOR_BAR_BG_CHAR:
+                        case GUI_COLOR_BAR_DELIM_CHAR:
+                        case GUI_COLOR_BAR_START_INPUT_CHAR:
+                        case GUI_COLOR_BAR_START_INPUT_HIDDEN_CHAR:
+                        case GUI_COLOR_BAR_MOVE_CURSOR_CHAR:
+                        case GUI_COLOR_BAR_START_ITEM:
+                        case GUI_COLOR_BAR_START_LINE_ITEM:
+                            ptr_string++;
+                            break;
+                    }
+                    break;
+                case GUI_COLOR_RESET_CHAR:
+                    ptr_string++;
+                    break;
+                default:
+                    if (isdigit (ptr_string[0]) && isdigit (ptr_string[1]))
+                        ptr_string += 2;
+                    break;
+            }
+            break;
+        case GUI_COLOR_SET_ATTR_CHAR:
+        case GUI_COLOR_REMOVE_ATTR_CHAR:
+            ptr_string++;
+            if (ptr_string[0])
                 ptr_string++;
-                if (replacement && replacement[0])
+            break;
+        case GUI_COLOR_RESET_CHAR:
+            ptr_string++;
+            break;
+        default:
+            return NULL;
+    }
+
+    return (const char *)ptr_string;
+}
+
+/*
+ * Removes WeeChat color codes from a message.
+ *
+ * If replacement is not NULL and not empty, it is used to replace color codes
+ * by first char of replacement (and next chars in string are NOT removed).
+ * If replacement is NULL or empty, color codes are removed, with following
+ * chars if they are related to color code.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_color_decode (const char *string, const char *replacement)
+{
+    const char *ptr_string, *ptr_next;
+    char *out;
+    int out_length, out_pos, length;
+
+    if (!string)
+        return NULL;
+
+    out_length = (strlen (string) * 2) + 1;
+    out = malloc (out_length);
+    if (!out)
+        return NULL;
+
+    ptr_string = string;
+    out_pos = 0;
+    while (ptr_string && ptr_string[0] && (out_pos < out_length - 1))
+    {
+        /* copy text until next color code (or end of string) */
+        length = strcspn (ptr_string, GUI_COLOR_CODE_START_CHARS);
+        if (length > 0)
+        {
+            memcpy (out + out_pos, ptr_string, length);
+            out_pos += length;
+            ptr_string += length;
+            continue;
+        }
+
+        ptr_next = gui_color_skip_code (ptr_string);
+        if (ptr_next)
+        {
+            ptr_string = ptr_next;
+            if (replacement && replacement[0])
+            {
+                out[out_pos] = replacement[0];
+                out_pos++;
+            }
+        }
+        else
+        {
+            length = utf8_char_size (ptr_string);
+            if (length == 0)
+                length = 1;
+            memcpy (out + out_pos, ptr_string, length);
+            out_pos += length;
+            ptr_string += length;
+        }
+    }
+    out[out_pos] = '\0';
+
+    return out;
+}
+
+/*
+ * Gets runs of text in a string: a run is a part of string without any color
+ * code (color codes are between runs).
+ *
+ * If runs is not NULL, at most max_runs runs are stored in this array.
+ *
+ * Returns the number of runs in string (which may be greater than max_runs),
+ * so this function can be called first with runs == NULL to get the size of
+ * array to allocate.
+ */
+
+int
+gui_color_get_runs (const char *string, struct t_gui_color_run *runs,
+                    int max_runs)
+{
+    const char *ptr_string, *ptr_next, *ptr_start;
+    int count, length;
+
+    if (!string)
+        return 0;
+
+    count = 0;
+    ptr_start = NULL;
+    ptr_string = string;
+    while (ptr_string[0])
+    {
+        /* skip text until next color code (or end of string) */
+        length = strcspn (ptr_string, GUI_COLOR_CODE_START_CHARS);
+        if (length > 0)
+        {
+            if (!ptr_start)
+                ptr_start = ptr_string;
+            ptr_string += length;
+            continue;
+        }
+
+        ptr_next = gui_color_skip_code (ptr_string);
+        if (ptr_next)
+        {
+            if (ptr_start)
+            {
+                if (runs && (count < max_runs))
                 {
-                    out[out_pos] = replacement[0];
-                    out_pos++;
+                    runs[count].offset = ptr_start - string;
+                    runs[count].length = ptr_string - ptr_start;
                 }
-                break;
-            default:
-                length = utf8_char_size ((char *)ptr_string);
-                if (length == 0)
-                    length = 1;
-                memcpy (out + out_pos, ptr_string, length);
-                out_pos += length;
-                ptr_string += length;
-                break;
+                count++;
+                ptr_start = NULL;
+            }
+            ptr_string = ptr_next;
+        }
+        else
+        {
+            if (!ptr_start)
+                ptr_start = ptr_string;
+            length = utf8_char_size (ptr_string);
+            if (length == 0)
+                length = 1;
+            ptr_string += length;
         }
     }
-    out[out_pos] = '\0';
+    if (ptr_start)
+    {
+        if (runs && (count < max_runs))
+        {
+            runs[count].offset = ptr_start - string;
+            runs[count].length = ptr_string - ptr_start;
+        }
+        count++;
+    }
+
+    return count;
+}
 
-    return (char *)out;
+/*
+ * Removes WeeChat color codes from a string, using runs of text returned by
+ * function gui_color_get_runs (faster than gui_color_decode because the
+ * string is not parsed again).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_color_decode_runs (const char *string, struct t_gui_color_run *runs,
+                       int runs_count)
+{
+    char *out;
+    int i, length;
+
+    if (!string || (runs_count < 0))
+        return NULL;
+
+    length = 0;
+    for (i = 0; i < runs_count; i++)
+    {
+        length += runs[i].length;
+    }
+
+    out = malloc (length + 1);
+    if (!out)
+        return NULL;
+
+    length = 0;
+    for (i = 0; i < runs_count; i++)
+    {
+        memcpy (out + length, string + runs[i].offset, runs[i].length);
+        length += runs[i].length;
+    }
+    out[length] = '\0';
+
+    return out;
 }
 
 /*
@@ -961,6 +1104,13 @@ end:
 char *
 gui_color_decode_ansi (const char *string, int keep_colors)
 {
+    if (!string)
+        return NULL;
+
+    /* no escape char: nothing to convert */
+    if (!strchr (string, '\33'))
+        return strdup (string);
+
     /* allocate/compile regex if needed (first call) */
     if (!gui_color_regex_ansi)
     {
@@ -1054,7 +1204,7 @@ gui_color_emphasize (const char *string,
         {
             /* search next match using the regex */
             regex_match.rm_so = -1;
-            rc = regexec (regex, ptr_no_color, 1, &regex_match, 0);
+            rc = string_regexec (regex, ptr_no_color, 1, &regex_match, 0);
 
             /*
              * no match found: exit the loop (if rm_no == 0, it is an empty
@@ -1262,6 +1412,7 @@ gui_color_palette_add (int number, const char *value)
     hashtable_set (gui_color_hash_palette_color,
                    str_number, new_color_palette);
     gui_color_palette_build_aliases ();
+    gui_nick_color_cache_clear ();
 
     if (gui_init_ok)
         gui_color_buffer_display ();
@@ -1286,6 +1437,7 @@ gui_color_palette_remove (int number)
     {
         hashtable_remove (gui_color_hash_palette_color, str_number);
         gui_color_palette_build_aliases ();
+        gui_nick_color_cache_clear ();
 
         if (gui_init_ok)
             gui_color_buffer_display ();
@@ -1341,7 +1493,7 @@ gui_color_end ()
 
     if (gui_color_regex_ansi)
     {
-        regfree (gui_color_regex_ansi);
+        string_regfree (gui_color_regex_ansi);
         free (gui_color_regex_ansi);
         gui_color_regex_ansi = NULL;
     }
@@ -100,6 +100,9 @@ enum t_gui_color_enum
 #define GUI_COLOR_REMOVE_ATTR_CHAR     '\x1B'
 #define GUI_COLOR_RESET_CHAR           '\x1C'
 
+/* chars which can start a color code (to quickly find text without colors) */
+#define GUI_COLOR_CODE_START_CHARS     "\x19\x1A\x1B\x1C"
+
 #define GUI_COLOR_ATTR_BOLD_CHAR       '\x01'
 #define GUI_COLOR_ATTR_REVERSE_CHAR    '\x02'
 #define GUI_COLOR_ATTR_ITALIC_CHAR     '\x03'
@@ -162,6 +165,14 @@ struct t_gui_color
     char *string;                  /* WeeChat color: "\x19??", ?? is #color */
 };
 
+/* run of text (without color codes) in a string */
+
+struct t_gui_color_run
+{
+    int offset;                    /* offset of text in string (bytes)      */
+    int length;                    /* length of text (bytes)                */
+};
+
 /* custom color in palette */
 
 struct t_gui_color_palette
@@ -186,7 +197,13 @@ extern void gui_color_attr_build_string (int color, char *str_attr);
 extern const char *gui_color_get_custom (const char *color_name);
 extern int gui_color_convert_term_to_rgb (int color);
 extern int gui_color_convert_rgb_to_term (int rgb, int limit);
+extern const char *gui_color_skip_code (const char *string);
 extern char *gui_color_decode (const char *string, const char *replacement);
+extern int gui_color_get_runs (const char *string,
+                               struct t_gui_color_run *runs, int max_runs);
+extern char *gui_color_decode_runs (const char *string,
+                                    struct t_gui_color_run *runs,
+                                    int runs_count);
 extern char *gui_color_decode_ansi (const char *string, int keep_colors);
 extern char *gui_color_emphasize (const char *string, const char *search,
                                   int case_sensitive, regex_t *regex);
@@ -236,42 +236,54 @@ gui_completion_search_command (struct t_weechat_plugin *plugin,
                                const char *command)
 {
     struct t_hook *ptr_hook, *hook_for_other_plugin, *hook_incomplete_command;
-    int length_command, allow_incomplete_commands, count_incomplete_commands;
+    struct t_hook_index_result hooks_found;
+    int i, length_command, count_incomplete_commands;
 
+    /* search command with this exact name, first for current plugin */
     hook_for_other_plugin = NULL;
+    hook_index_search (hook_index[HOOK_TYPE_COMMAND], command, &hooks_found);
+    for (i = 0; i < hooks_found.count; i++)
+    {
+        ptr_hook = hooks_found.hooks[i];
+        if (!ptr_hook->deleted && HOOK_COMMAND(ptr_hook, command)[0])
+        {
+            if (ptr_hook->plugin == plugin)
+            {
+                hook_index_result_free (&hooks_found);
+                return ptr_hook;
+            }
+            hook_for_other_plugin = ptr_hook;
+        }
+    }
+    hook_index_result_free (&hooks_found);
+
+    if (hook_for_other_plugin)
+        return hook_for_other_plugin;
+
+    if (!CONFIG_BOOLEAN(config_look_command_incomplete))
+        return NULL;
+
+    /* search incomplete command */
     hook_incomplete_command = NULL;
     length_command = strlen (command);
     count_incomplete_commands = 0;
-    allow_incomplete_commands = CONFIG_BOOLEAN(config_look_command_incomplete);
-
     for (ptr_hook = weechat_hooks[HOOK_TYPE_COMMAND]; ptr_hook;
          ptr_hook = ptr_hook->next_hook)
     {
         if (!ptr_hook->deleted
             && HOOK_COMMAND(ptr_hook, command)
-            && HOOK_COMMAND(ptr_hook, command)[0])
+            && HOOK_COMMAND(ptr_hook, command)[0]
+            && (string_strncasecmp (HOOK_COMMAND(ptr_hook, command),
+                                    command,
+                                    length_command) == 0)
+            && (string_strcasecmp (HOOK_COMMAND(ptr_hook, command),
+                                   command) != 0))
         {
-            if (string_strcasecmp (HOOK_COMMAND(ptr_hook, command),
-                                   command) == 0)
-            {
-                if (ptr_hook->plugin == plugin)
-                    return ptr_hook;
-                hook_for_other_plugin = ptr_hook;
-            }
-            else if (allow_incomplete_commands
-                     && (string_strncasecmp (HOOK_COMMAND(ptr_hook, command),
-                                             command,
-                                             length_command) == 0))
-            {
-                hook_incomplete_command = ptr_hook;
-                count_incomplete_commands++;
-            }
+            hook_incomplete_command = ptr_hook;
+            count_incomplete_commands++;
         }
     }
 
-    if (hook_for_other_plugin)
-        return hook_for_other_plugin;
-
     return (count_incomplete_commands == 1) ?
         hook_incomplete_command : NULL;
 }
@@ -428,6 +440,103 @@ gui_completion_list_add (struct t_gui_completion *completion, const char *word,
     }
 }
 
+/*
+ * Compares words for sorting them with function gui_completion_sort_words.
+ */
+
+int
+gui_completion_sort_words_cmp_cb (const void *word1, const void *word2)
+{
+    return string_strcasecmp (*((const char **)word1),
+                              *((const char **)word2));
+}
+
+/*
+ * Sorts an array of words (case insensitive), for use with function
+ * gui_completion_list_add_sorted.
+ */
+
+void
+gui_completion_sort_words (const char **words, int count)
+{
+    if (words && (count > 1))
+        qsort (words, count, sizeof (*words), &gui_completion_sort_words_cmp_cb);
+}
+
+/*
+ * Adds words of a sorted array (see function gui_completion_sort_words) to
+ * completion list: only words beginning with base word are added (found
+ * with a binary search), each one with an optional prefix (for example "/"
+ * for commands).
+ */
+
+void
+gui_completion_list_add_sorted (struct t_gui_completion *completion,
+                                const char **words, int count,
+                                const char *prefix)
+{
+    const char *key;
+    char str_word[512];
+    int length_base, length_prefix, length_key, start, end, middle;
+
+    if (!completion || !words || (count <= 0))
+        return;
+
+    if (!prefix)
+        prefix = "";
+
+    start = 0;
+    end = count;
+
+    length_base = (completion->base_word) ?
+        utf8_strlen (completion->base_word) : 0;
+    length_prefix = utf8_strlen (prefix);
+    if (length_base > 0)
+    {
+        if (string_strncasecmp (completion->base_word, prefix,
+                                (length_base < length_prefix) ?
+                                length_base : length_prefix) != 0)
+        {
+            return;
+        }
+        if (length_base > length_prefix)
+        {
+            /* search first word beginning with the base word (without prefix) */
+            key = utf8_add_offset (completion->base_word, length_prefix);
+            length_key = length_base - length_prefix;
+            while (start < end)
+            {
+                middle = start + ((end - start) / 2);
+                if (string_strncasecmp (words[middle], key, length_key) < 0)
+                    start = middle + 1;
+                else
+                    end = middle;
+            }
+            end = start;
+            while ((end < count)
+                   && (string_strncasecmp (words[end], key, length_key) == 0))
+            {
+                end++;
+            }
+        }
+    }
+
+    for (; start < end; start++)
+    {
+        if (prefix[0])
+        {
+            snprintf (str_word, sizeof (str_word), "%s%s", prefix, words[start]);
+            gui_completion_list_add (completion, str_word,
+                                     0, WEECHAT_LIST_POS_SORT);
+        }
+        else
+        {
+            gui_completion_list_add (completion, words[start],
+                                     0, WEECHAT_LIST_POS_SORT);
+        }
+    }
+}
+
 /*
  * Custom completion by a plugin.
  */
@@ -540,21 +649,20 @@ gui_completion_get_matching_template (struct t_gui_completion *completion,
 
     for (i = 0; i < HOOK_COMMAND(hook_command, cplt_num_templates); i++)
     {
-        items = string_split (HOOK_COMMAND(hook_command, cplt_templates_static)[i],
-                              "|", 0, 0, &num_items);
+        items = HOOK_COMMAND(hook_command, cplt_templates_static_items)[i];
         if (items)
         {
+            num_items = HOOK_COMMAND(hook_command,
+                                     cplt_templates_static_num_items)[i];
             for (j = 0; j < num_items; j++)
             {
                 length = strlen (items[j]);
                 if ((strncmp (items[j], completion->args, length) == 0)
                     && (completion->args[length] == ' '))
                 {
-                    string_free_split (items);
                     return i;
                 }
             }
-            string_free_split (items);
         }
 
         /*
@@ -75,6 +75,10 @@ extern void gui_completion_stop (struct t_gui_completion *completion);
 extern void gui_completion_list_add (struct t_gui_completion *completion,
                                      const char *word,
                                      int nick_completion, const char *where);
+extern void gui_completion_sort_words (const char **words, int count);
+extern void gui_completion_list_add_sorted (struct t_gui_completion *completion,
+                                            const char **words, int count,
+                                            const char *prefix);
 extern void gui_completion_search (struct t_gui_completion *completion,
                                    int direction, const char *data, int size,
                                    int pos);
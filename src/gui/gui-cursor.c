@@ -108,6 +108,7 @@ gui_cursor_display_debug_info ()
     focus_info = gui_focus_get_info (gui_cursor_x, gui_cursor_y);
     if (focus_info)
     {
+        gui_focus_get_chat_words (focus_info);
         snprintf (str_info, sizeof (str_info),
                   "%s(%d,%d) window:0x%lx, buffer:0x%lx (%s), "
                   "bar_window:0x%lx (bar: %s, item: %s, line: %d, col: %d), "
@@ -25,8 +25,10 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <unistd.h>
 #include <string.h>
 #include <regex.h>
+#include <pthread.h>
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
@@ -46,60 +48,176 @@
 struct t_gui_filter *gui_filters = NULL;           /* first filter          */
 struct t_gui_filter *last_gui_filter = NULL;       /* last filter           */
 int gui_filters_enabled = 1;                       /* filters enabled?      */
+int gui_filter_lines_changes = 0;                  /* number of changes of  */
+                                                   /* lines displayed       */
 
 
 /*
- * Checks if a line must be displayed or not (filtered).
+ * Checks if a filter matches a line (buffer, tags and regex), without
+ * checking if the filter is enabled, using the given regex for prefix and
+ * message (regex of filter or a copy of them).
  *
  * Returns:
- *   1: line must be displayed (not filtered)
- *   0: line must be hidden (filtered)
+ *   1: filter matches line (line must be hidden by this filter)
+ *   0: filter does not match line
  */
 
 int
-gui_filter_check_line (struct t_gui_line_data *line_data)
+gui_filter_match_line_regex (struct t_gui_filter *filter,
+                             struct t_gui_line_data *line_data,
+                             int check_buffer,
+                             regex_t *regex_prefix, regex_t *regex_message)
 {
-    struct t_gui_filter *ptr_filter;
     int rc;
 
-    /* line is always displayed if filters are disabled (globally or in buffer) */
+    /* check buffer */
+    if (check_buffer
+        && !gui_buffer_match_list_split (line_data->buffer,
+                                         filter->num_buffers,
+                                         filter->buffers))
+    {
+        return 0;
+    }
+
+    /* check tags */
+    if ((strcmp (filter->tags, "*") != 0)
+        && !gui_line_match_tags (line_data,
+                                 filter->tags_count,
+                                 filter->tags_array))
+    {
+        return 0;
+    }
+
+    /* check line with regex */
+    rc = 1;
+    if (!regex_prefix && !regex_message)
+        rc = 0;
+    if (gui_line_match_regex (line_data, regex_prefix, regex_message))
+        rc = 0;
+    if (filter->regex && (filter->regex[0] == '!'))
+        rc ^= 1;
+
+    return (rc == 0) ? 1 : 0;
+}
+
+/*
+ * Checks if a filter matches a line (buffer, tags and regex), without
+ * checking if the filter is enabled.
+ *
+ * Returns:
+ *   1: filter matches line (line must be hidden by this filter)
+ *   0: filter does not match line
+ */
+
+int
+gui_filter_match_line (struct t_gui_filter *filter,
+                       struct t_gui_line_data *line_data, int check_buffer)
+{
+    return gui_filter_match_line_regex (filter, line_data, check_buffer,
+                                        filter->regex_prefix,
+                                        filter->regex_message);
+}
+
+/*
+ * Checks if filters can hide a line (filters enabled globally and in buffer
+ * and line without tag "no_filter").
+ *
+ * Returns:
+ *   1: line can be filtered
+ *   0: line is always displayed
+ */
+
+int
+gui_filter_line_can_be_filtered (struct t_gui_line_data *line_data)
+{
     if (!gui_filters_enabled || !line_data->buffer->filter)
-        return 1;
+        return 0;
 
     if (gui_line_has_tag_no_filter (line_data))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Returns the mask with the bits of enabled filters.
+ */
+
+unsigned long long
+gui_filter_get_enabled_mask ()
+{
+    struct t_gui_filter *ptr_filter;
+    unsigned long long mask;
+
+    mask = 0;
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        if (ptr_filter->enabled && (ptr_filter->index >= 0))
+            mask |= 1ULL << ptr_filter->index;
+    }
+
+    return mask;
+}
+
+/*
+ * Computes the mask of enabled filters hiding a line and stores it in the
+ * line (only filters with a bit in mask are checked, the others are checked
+ * each time by function gui_filter_line_displayed).
+ */
+
+void
+gui_filter_line_update_mask (struct t_gui_line_data *line_data)
+{
+    struct t_gui_filter *ptr_filter;
+
+    line_data->filters_mask = 0;
+
+    if (!gui_filter_line_can_be_filtered (line_data))
+        return;
+
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        if (ptr_filter->enabled
+            && (ptr_filter->index >= 0)
+            && gui_filter_match_line (ptr_filter, line_data, 1))
+        {
+            line_data->filters_mask |= 1ULL << ptr_filter->index;
+        }
+    }
+}
+
+/*
+ * Checks if a line must be displayed or not, using the mask of filters
+ * stored in line and the mask of enabled filters.
+ *
+ * Returns:
+ *   1: line must be displayed (not filtered)
+ *   0: line must be hidden (filtered)
+ */
+
+int
+gui_filter_line_displayed (struct t_gui_line_data *line_data,
+                           unsigned long long enabled_mask)
+{
+    struct t_gui_filter *ptr_filter;
+
+    if (!gui_filter_line_can_be_filtered (line_data))
         return 1;
 
+    if (line_data->filters_mask & enabled_mask)
+        return 0;
+
+    /* filters without bit in mask are checked now */
     for (ptr_filter = gui_filters; ptr_filter;
          ptr_filter = ptr_filter->next_filter)
     {
-        if (ptr_filter->enabled)
+        if (ptr_filter->enabled
+            && (ptr_filter->index < 0)
+            && gui_filter_match_line (ptr_filter, line_data, 1))
         {
-            /* check buffer */
-            if (gui_buffer_match_list_split (line_data->buffer,
-                                             ptr_filter->num_buffers,
-                                             ptr_filter->buffers))
-            {
-                if ((strcmp (ptr_filter->tags, "*") == 0)
-                    || (gui_line_match_tags (line_data,
-                                             ptr_filter->tags_count,
-                                             ptr_filter->tags_array)))
-                {
-                    /* check line with regex */
-                    rc = 1;
-                    if (!ptr_filter->regex_prefix && !ptr_filter->regex_message)
-                        rc = 0;
-                    if (gui_line_match_regex (line_data,
-                                              ptr_filter->regex_prefix,
-                                              ptr_filter->regex_message))
-                    {
-                        rc = 0;
-                    }
-                    if (ptr_filter->regex && (ptr_filter->regex[0] == '!'))
-                        rc ^= 1;
-                    if (rc == 0)
-                        return 0;
-                }
-            }
+            return 0;
         }
     }
 
@@ -108,30 +226,98 @@ gui_filter_check_line (struct t_gui_line_data *line_data)
 }
 
 /*
- * Filters a buffer, using message filters.
+ * Checks if a line must be displayed or not (filtered).
+ *
+ * The mask of filters in line must be up-to-date (see function
+ * gui_filter_line_update_mask).
+ *
+ * Returns:
+ *   1: line must be displayed (not filtered)
+ *   0: line must be hidden (filtered)
+ */
+
+int
+gui_filter_check_line (struct t_gui_line_data *line_data)
+{
+    return gui_filter_line_displayed (line_data,
+                                      gui_filter_get_enabled_mask ());
+}
+
+/*
+ * Filters lines of a buffer.
  *
  * If line_data is NULL, filters all lines in buffer.
  * If line_data is not NULL, filters only this line_data.
+ *
+ * If filter is NULL, the mask of filters is computed again for lines (all
+ * filters are checked).
+ * If filter is not NULL, only this filter has changed: if it is enabled, it
+ * is checked on lines and its bit is updated in masks, other filters are not
+ * checked (if it is disabled, only the masks are used).
+ *
+ * If update_masks is 0, the masks of lines are already up-to-date (computed
+ * by threads, see function gui_filter_lines_masks_threads).
  */
 
 void
-gui_filter_buffer (struct t_gui_buffer *buffer,
-                   struct t_gui_line_data *line_data)
+gui_filter_buffer_lines (struct t_gui_buffer *buffer,
+                         struct t_gui_line_data *line_data,
+                         struct t_gui_filter *filter, int update_masks)
 {
     struct t_gui_line *ptr_line;
     struct t_gui_line_data *ptr_line_data;
+    struct t_gui_buffer *ptr_buffer_checked;
     struct t_gui_window *ptr_window;
-    int lines_changed, line_displayed, lines_hidden;
+    unsigned long long enabled_mask, filter_bit;
+    int lines_changed, line_displayed, lines_hidden, buffer_match;
 
     lines_changed = 0;
     lines_hidden = buffer->lines->lines_hidden;
 
+    enabled_mask = gui_filter_get_enabled_mask ();
+    filter_bit = (filter && (filter->index >= 0)) ? 1ULL << filter->index : 0;
+    ptr_buffer_checked = NULL;
+    buffer_match = 0;
+
     ptr_line = buffer->lines->first_line;
     while (ptr_line || line_data)
     {
         ptr_line_data = (line_data) ? line_data : ptr_line->data;
 
-        line_displayed = gui_filter_check_line (ptr_line_data);
+        if (!update_masks)
+        {
+            /* masks already computed */
+        }
+        else if (!filter)
+        {
+            gui_filter_line_update_mask (ptr_line_data);
+        }
+        else if (filter_bit)
+        {
+            /* mixed lines can contain lines from different buffers */
+            if (ptr_line_data->buffer != ptr_buffer_checked)
+            {
+                ptr_buffer_checked = ptr_line_data->buffer;
+                buffer_match = gui_buffer_match_list_split (
+                    ptr_buffer_checked,
+                    filter->num_buffers,
+                    filter->buffers);
+            }
+            if (filter->enabled
+                && buffer_match
+                && gui_filter_line_can_be_filtered (ptr_line_data)
+                && gui_filter_match_line (filter, ptr_line_data, 0))
+            {
+                ptr_line_data->filters_mask |= filter_bit;
+            }
+            else
+            {
+                ptr_line_data->filters_mask &= ~filter_bit;
+            }
+        }
+
+        line_displayed = gui_filter_line_displayed (ptr_line_data,
+                                                    enabled_mask);
 
         if (ptr_line_data->displayed != line_displayed)
         {
@@ -161,6 +347,9 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
 
     if (lines_changed)
     {
+        /* lines displayed have changed: the index for scroll is obsolete */
+        gui_filter_lines_changes++;
+
         /* force a full refresh of buffer */
         gui_buffer_ask_chat_refresh (buffer, 2);
 
@@ -184,19 +373,398 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
     }
 }
 
+/*
+ * Filters a buffer, using message filters.
+ *
+ * If line_data is NULL, filters all lines in buffer.
+ * If line_data is not NULL, filters only this line_data.
+ */
+
+void
+gui_filter_buffer (struct t_gui_buffer *buffer,
+                   struct t_gui_line_data *line_data)
+{
+    gui_filter_buffer_lines (buffer, line_data, NULL, 1);
+}
+
+/*
+ * Compiles again a regex of a filter (prefix or message), for a thread: with
+ * the same compiled regex, calls to regexec are serialized by the C library.
+ *
+ * The regex is compiled with string_regcomp, like the regex of filter (so the
+ * same engine is used by all workers: PCRE2 if available, POSIX otherwise);
+ * it must be freed with string_regfree.
+ *
+ * Note: result must be freed after use.
+ */
+
+regex_t *
+gui_filter_regex_copy (const char *regex)
+{
+    regex_t *new_regex;
+
+    new_regex = malloc (sizeof (*new_regex));
+    if (!new_regex)
+        return NULL;
+
+    if (string_regcomp (new_regex, regex,
+                        REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0)
+    {
+        free (new_regex);
+        return NULL;
+    }
+
+    return new_regex;
+}
+
+/*
+ * Initializes regex of a worker: the first worker (main thread) uses regex of
+ * filters, the other workers use copies.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (regex could not be compiled)
+ */
+
+int
+gui_filter_worker_init (struct t_gui_filter_worker *worker,
+                        struct t_gui_filter_job *job, int copy_regex)
+{
+    struct t_gui_filter *ptr_filter;
+    const char *ptr_regex, *pos_tab;
+    char *regex_prefix;
+    int index;
+
+    worker->job = job;
+    worker->regex_copied = copy_regex;
+
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        index = ptr_filter->index;
+        if (!ptr_filter->enabled || (index < 0)
+            || (job->filter && (ptr_filter != job->filter)))
+        {
+            continue;
+        }
+        if (!copy_regex)
+        {
+            worker->regex_prefix[index] = ptr_filter->regex_prefix;
+            worker->regex_message[index] = ptr_filter->regex_message;
+            continue;
+        }
+        ptr_regex = ptr_filter->regex;
+        if ((ptr_regex[0] == '!')
+            || ((ptr_regex[0] == '\\') && (ptr_regex[1] == '!')))
+        {
+            ptr_regex++;
+        }
+        pos_tab = strstr (ptr_regex, "\\t");
+        if (ptr_filter->regex_prefix && pos_tab)
+        {
+            regex_prefix = string_strndup (ptr_regex, pos_tab - ptr_regex);
+            if (!regex_prefix)
+                return 0;
+            worker->regex_prefix[index] = gui_filter_regex_copy (regex_prefix);
+            free (regex_prefix);
+            if (!worker->regex_prefix[index])
+                return 0;
+        }
+        if (ptr_filter->regex_message)
+        {
+            worker->regex_message[index] = gui_filter_regex_copy (
+                (pos_tab) ? pos_tab + 2 : ptr_regex);
+            if (!worker->regex_message[index])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Frees regex copied for a worker.
+ */
+
+void
+gui_filter_worker_free_regex (struct t_gui_filter_worker *worker)
+{
+    int i;
+
+    if (!worker->regex_copied)
+        return;
+
+    for (i = 0; i < GUI_FILTER_MASK_MAX_FILTERS; i++)
+    {
+        if (worker->regex_prefix[i])
+        {
+            string_regfree (worker->regex_prefix[i]);
+            free (worker->regex_prefix[i]);
+        }
+        if (worker->regex_message[i])
+        {
+            string_regfree (worker->regex_message[i]);
+            free (worker->regex_message[i]);
+        }
+    }
+}
+
+/*
+ * Computes the masks of filters in a chunk of lines (same masks as function
+ * gui_filter_buffer_lines), with the regex of worker.
+ *
+ * Only the lines of chunk are written, so that threads can compute masks of
+ * different chunks at same time.
+ */
+
+void
+gui_filter_worker_chunk (struct t_gui_filter_worker *worker, int chunk)
+{
+    struct t_gui_filter_job *job;
+    struct t_gui_filter *ptr_filter;
+    struct t_gui_line_data *ptr_line_data;
+    struct t_gui_buffer *ptr_buffer_checked;
+    unsigned long long filter_bit;
+    int i, end, index, buffer_match;
+
+    job = worker->job;
+
+    end = (chunk + 1) * GUI_FILTER_CHUNK_LINES;
+    if (end > job->lines_count)
+        end = job->lines_count;
+
+    ptr_buffer_checked = NULL;
+    buffer_match = 0;
+
+    for (i = chunk * GUI_FILTER_CHUNK_LINES; i < end; i++)
+    {
+        ptr_line_data = job->lines[i];
+
+        if (!job->filter)
+        {
+            ptr_line_data->filters_mask = 0;
+            if (!gui_filter_line_can_be_filtered (ptr_line_data))
+                continue;
+            for (ptr_filter = gui_filters; ptr_filter;
+                 ptr_filter = ptr_filter->next_filter)
+            {
+                index = ptr_filter->index;
+                if (ptr_filter->enabled
+                    && (index >= 0)
+                    && gui_filter_match_line_regex (
+                        ptr_filter, ptr_line_data, 1,
+                        worker->regex_prefix[index],
+                        worker->regex_message[index]))
+                {
+                    ptr_line_data->filters_mask |= 1ULL << index;
+                }
+            }
+        }
+        else
+        {
+            index = job->filter->index;
+            filter_bit = 1ULL << index;
+            if (ptr_line_data->buffer != ptr_buffer_checked)
+            {
+                ptr_buffer_checked = ptr_line_data->buffer;
+                buffer_match = gui_buffer_match_list_split (
+                    ptr_buffer_checked,
+                    job->filter->num_buffers,
+                    job->filter->buffers);
+            }
+            if (buffer_match
+                && gui_filter_line_can_be_filtered (ptr_line_data)
+                && gui_filter_match_line_regex (job->filter, ptr_line_data, 0,
+                                                worker->regex_prefix[index],
+                                                worker->regex_message[index]))
+            {
+                ptr_line_data->filters_mask |= filter_bit;
+            }
+            else
+            {
+                ptr_line_data->filters_mask &= ~filter_bit;
+            }
+        }
+    }
+}
+
+/*
+ * Computes masks of filters in chunks of lines, until there are no more
+ * chunks.
+ *
+ * This function is the main function of threads (it is called directly by
+ * the main thread, which filters lines as well).
+ */
+
+void *
+gui_filter_worker_run (void *arg)
+{
+    struct t_gui_filter_worker *worker;
+    int chunk;
+
+    worker = (struct t_gui_filter_worker *)arg;
+
+    while (1)
+    {
+        pthread_mutex_lock (&worker->job->mutex);
+        if (worker->job->next_chunk >= worker->job->chunks_count)
+        {
+            pthread_mutex_unlock (&worker->job->mutex);
+            break;
+        }
+        chunk = worker->job->next_chunk;
+        worker->job->next_chunk++;
+        pthread_mutex_unlock (&worker->job->mutex);
+
+        gui_filter_worker_chunk (worker, chunk);
+    }
+
+    return NULL;
+}
+
+/*
+ * Computes masks of filters in lines of all buffers with threads, if there
+ * are many lines (the main thread waits for threads, and only the masks of
+ * lines are updated by threads: lines displayed are updated by the main
+ * thread, with function gui_filter_buffer_lines).
+ *
+ * Argument "filter" has same meaning as in function gui_filter_all_buffers.
+ *
+ * Returns:
+ *   1: masks of lines have been computed
+ *   0: masks not computed (not enough lines or error), they must be computed
+ *      by the caller
+ */
+
+int
+gui_filter_lines_masks_threads (struct t_gui_filter *filter)
+{
+    struct t_gui_filter_job job;
+    struct t_gui_filter_worker *workers;
+    struct t_gui_buffer *ptr_buffer;
+    struct t_gui_line *ptr_line;
+    int i, threads, workers_count, threads_started;
+    long cpus;
+
+    /* a disabled filter (or without bit) does not need to check lines */
+    if (!gui_filters_enabled
+        || (filter && (!filter->enabled || (filter->index < 0))))
+    {
+        return 0;
+    }
+
+    memset (&job, 0, sizeof (job));
+    job.filter = filter;
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        job.lines_count += ptr_buffer->own_lines->lines_count;
+    }
+    if (job.lines_count < GUI_FILTER_THREADS_MIN_LINES)
+        return 0;
+    job.chunks_count = (job.lines_count + GUI_FILTER_CHUNK_LINES - 1) /
+        GUI_FILTER_CHUNK_LINES;
+
+    cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? (int)cpus : 1;
+    if (threads > GUI_FILTER_MAX_THREADS)
+        threads = GUI_FILTER_MAX_THREADS;
+    if (threads > job.chunks_count)
+        threads = job.chunks_count;
+    if (threads < 2)
+        return 0;
+
+    /* lines of all buffers (mixed lines are the lines of merged buffers) */
+    job.lines = malloc (job.lines_count * sizeof (*job.lines));
+    if (!job.lines)
+        return 0;
+    i = 0;
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        for (ptr_line = ptr_buffer->own_lines->first_line;
+             ptr_line && (i < job.lines_count);
+             ptr_line = ptr_line->next_line)
+        {
+            job.lines[i++] = ptr_line->data;
+        }
+    }
+    job.lines_count = i;
+
+    workers = calloc (threads, sizeof (*workers));
+    if (!workers)
+    {
+        free (job.lines);
+        return 0;
+    }
+    workers_count = 0;
+    for (i = 0; i < threads; i++)
+    {
+        workers_count++;
+        if (!gui_filter_worker_init (&workers[i], &job, (i > 0) ? 1 : 0))
+        {
+            gui_filter_worker_free_regex (&workers[i]);
+            workers_count--;
+            break;
+        }
+    }
+
+    pthread_mutex_init (&job.mutex, NULL);
+
+    /* first worker is the main thread */
+    threads_started = 1;
+    for (i = 1; i < workers_count; i++)
+    {
+        if (pthread_create (&workers[i].thread, NULL,
+                            &gui_filter_worker_run, &workers[i]) != 0)
+        {
+            break;
+        }
+        threads_started++;
+    }
+    gui_filter_worker_run (&workers[0]);
+    for (i = 1; i < threads_started; i++)
+    {
+        pthread_join (workers[i].thread, NULL);
+    }
+
+    pthread_mutex_destroy (&job.mutex);
+    for (i = 0; i < workers_count; i++)
+    {
+        gui_filter_worker_free_regex (&workers[i]);
+    }
+    free (workers);
+    free (job.lines);
+
+    return 1;
+}
+
 /*
  * Filters all buffers, using message filters.
+ *
+ * If filter is NULL, all filters are checked on all lines.
+ * If filter is not NULL, only this filter has changed (added, enabled or
+ * disabled): it is checked on lines of buffers it matches (if enabled),
+ * and lines are displayed or hidden using the mask of filters stored in
+ * lines, without checking other filters again.
+ *
+ * With many lines, masks of lines are computed by threads before lines are
+ * displayed or hidden in each buffer.
  */
 
 void
-gui_filter_all_buffers ()
+gui_filter_all_buffers (struct t_gui_filter *filter)
 {
     struct t_gui_buffer *ptr_buffer;
+    int update_masks;
+
+    update_masks = (gui_filter_lines_masks_threads (filter)) ? 0 : 1;
 
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        gui_filter_buffer (ptr_buffer, NULL);
+        gui_filter_buffer_lines (ptr_buffer, NULL, filter, update_masks);
     }
 }
 
@@ -210,7 +778,8 @@ gui_filter_global_enable ()
     if (!gui_filters_enabled)
     {
         gui_filters_enabled = 1;
-        gui_filter_all_buffers ();
+        gui_filter_lines_changes++;
+        gui_filter_all_buffers (NULL);
         (void) hook_signal_send ("filters_enabled",
                                  WEECHAT_HOOK_SIGNAL_STRING, NULL);
     }
@@ -226,7 +795,8 @@ gui_filter_global_disable ()
     if (gui_filters_enabled)
     {
         gui_filters_enabled = 0;
-        gui_filter_all_buffers ();
+        gui_filter_lines_changes++;
+        gui_filter_all_buffers (NULL);
         (void) hook_signal_send ("filters_disabled",
                                  WEECHAT_HOOK_SIGNAL_STRING, NULL);
     }
@@ -254,6 +824,35 @@ gui_filter_search_by_name (const char *name)
     return NULL;
 }
 
+/*
+ * Returns the first bit available in masks of filters for a new filter, -1 if
+ * all bits are used by other filters.
+ */
+
+int
+gui_filter_get_free_index ()
+{
+    struct t_gui_filter *ptr_filter;
+    unsigned long long mask;
+    int i;
+
+    mask = 0;
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        if (ptr_filter->index >= 0)
+            mask |= 1ULL << ptr_filter->index;
+    }
+
+    for (i = 0; i < GUI_FILTER_MASK_MAX_FILTERS; i++)
+    {
+        if (!(mask & (1ULL << i)))
+            return i;
+    }
+
+    return -1;
+}
+
 /*
  * Displays an error when a new filter is created.
  */
@@ -364,7 +963,7 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
                         free (regex_prefix);
                     if (regex1)
                     {
-                        regfree (regex1);
+                        string_regfree (regex1);
                         free (regex1);
                     }
                     free (regex2);
@@ -383,6 +982,7 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
     {
         /* init filter */
         new_filter->enabled = enabled;
+        new_filter->index = gui_filter_get_free_index ();
         new_filter->name = strdup (name);
         new_filter->buffer_name = strdup ((buffer_name) ? buffer_name : "*");
         new_filter->buffers = string_split (new_filter->buffer_name,
@@ -403,9 +1003,9 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
                 {
                     for (i = 0; i < new_filter->tags_count; i++)
                     {
-                        new_filter->tags_array[i] = string_split (tags_array[i],
-                                                                  "+", 0, 0,
-                                                                  NULL);
+                        new_filter->tags_array[i] = string_split_shared (tags_array[i],
+                                                                         "+", 0, 0,
+                                                                         NULL);
                     }
                 }
                 string_free_split (tags_array);
@@ -424,6 +1024,9 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
         last_gui_filter = new_filter;
         new_filter->next_filter = NULL;
 
+        config_file_set_dirty (weechat_config_file,
+                               weechat_config_section_filter);
+
         (void) hook_signal_send ("filter_added",
                                  WEECHAT_HOOK_SIGNAL_POINTER, new_filter);
     }
@@ -455,6 +1058,9 @@ gui_filter_rename (struct t_gui_filter *filter, const char *new_name)
     free (filter->name);
     filter->name = strdup (new_name);
 
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_filter);
+
     return 1;
 }
 
@@ -483,7 +1089,7 @@ gui_filter_free (struct t_gui_filter *filter)
     {
         for (i = 0; i < filter->tags_count; i++)
         {
-            string_free_split (filter->tags_array[i]);
+            string_free_split_shared (filter->tags_array[i]);
         }
         free (filter->tags_array);
     }
@@ -491,12 +1097,12 @@ gui_filter_free (struct t_gui_filter *filter)
         free (filter->regex);
     if (filter->regex_prefix)
     {
-        regfree (filter->regex_prefix);
+        string_regfree (filter->regex_prefix);
         free (filter->regex_prefix);
     }
     if (filter->regex_message)
     {
-        regfree (filter->regex_message);
+        string_regfree (filter->regex_message);
         free (filter->regex_message);
     }
 
@@ -512,6 +1118,9 @@ gui_filter_free (struct t_gui_filter *filter)
 
     free (filter);
 
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_filter);
+
     (void) hook_signal_send ("filter_removed", WEECHAT_HOOK_SIGNAL_STRING, NULL);
 }
 
@@ -638,6 +1247,7 @@ gui_filter_print_log ()
         log_printf ("");
         log_printf ("[filter (addr:0x%lx)]", ptr_filter);
         log_printf ("  enabled. . . . . . . . : %d",    ptr_filter->enabled);
+        log_printf ("  index. . . . . . . . . : %d",    ptr_filter->index);
         log_printf ("  name . . . . . . . . . : '%s'",  ptr_filter->name);
         log_printf ("  buffer_name. . . . . . : '%s'",  ptr_filter->buffer_name);
         log_printf ("  num_buffers. . . . . . : %d",    ptr_filter->num_buffers);
@@ -21,9 +21,22 @@
 #define WEECHAT_GUI_FILTER_H 1
 
 #include <regex.h>
+#include <pthread.h>
 
 #define GUI_FILTER_TAG_NO_FILTER "no_filter"
 
+/* max number of filters with a bit in mask of lines */
+#define GUI_FILTER_MASK_MAX_FILTERS 64
+
+/* min number of lines in buffers to filter them with threads */
+#define GUI_FILTER_THREADS_MIN_LINES 16384
+
+/* number of lines filtered by a thread before taking next chunk of lines */
+#define GUI_FILTER_CHUNK_LINES 4096
+
+/* max number of threads filtering lines */
+#define GUI_FILTER_MAX_THREADS 8
+
 /* filter structures */
 
 struct t_gui_line_data;
@@ -31,6 +44,7 @@ struct t_gui_line_data;
 struct t_gui_filter
 {
     int enabled;                       /* 1 if filter enabled, otherwise 0  */
+    int index;                         /* bit in mask of lines (-1 if none) */
     char *name;                        /* filter name                       */
     char *buffer_name;                 /* name of buffer(s)                 */
     int num_buffers;                   /* number of buffers in list         */
@@ -45,18 +59,43 @@ struct t_gui_filter
     struct t_gui_filter *next_filter;  /* link to next filter               */
 };
 
+/* lines of all buffers filtered by threads */
+
+struct t_gui_filter_job
+{
+    struct t_gui_filter *filter;       /* filter changed (NULL: all)        */
+    struct t_gui_line_data **lines;    /* lines to filter                   */
+    int lines_count;                   /* number of lines                   */
+    pthread_mutex_t mutex;             /* mutex for next_chunk              */
+    int chunks_count;                  /* number of chunks of lines         */
+    int next_chunk;                    /* next chunk to filter              */
+};
+
+/* thread filtering lines, with its own regex (regexec is not concurrent) */
+
+struct t_gui_filter_worker
+{
+    struct t_gui_filter_job *job;      /* lines to filter                   */
+    regex_t *regex_prefix[GUI_FILTER_MASK_MAX_FILTERS];  /* by filter index */
+    regex_t *regex_message[GUI_FILTER_MASK_MAX_FILTERS]; /* by filter index */
+    int regex_copied;                  /* 1 if regex are copies of filters  */
+    pthread_t thread;                  /* thread filtering lines            */
+};
+
 /* filter variables */
 
 extern struct t_gui_filter *gui_filters;
 extern struct t_gui_filter *last_gui_filter;
 extern int gui_filters_enabled;
+extern int gui_filter_lines_changes;
 
 /* filter functions */
 
+extern void gui_filter_line_update_mask (struct t_gui_line_data *line_data);
 extern int gui_filter_check_line (struct t_gui_line_data *line_data);
 extern void gui_filter_buffer (struct t_gui_buffer *buffer,
                                struct t_gui_line_data *line_data);
-extern void gui_filter_all_buffers ();
+extern void gui_filter_all_buffers (struct t_gui_filter *filter);
 extern void gui_filter_global_enable ();
 extern void gui_filter_global_disable ();
 extern struct t_gui_filter *gui_filter_search_by_name (const char *name);
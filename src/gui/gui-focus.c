@@ -65,6 +65,9 @@
 /*
  * Gets info about what is pointed by cursor at (x,y).
  *
+ * The word, beginning and end of line in chat area are not computed here
+ * (see function gui_focus_get_chat_words).
+ *
  * Returns pointer to focus info, NULL if error.
  *
  * Note: focus info must be freed after use.
@@ -92,9 +95,11 @@ gui_focus_get_info (int x, int y)
                                   &focus_info->chat,
                                   &focus_info->chat_line,
                                   &focus_info->chat_line_x,
-                                  &focus_info->chat_word,
-                                  &focus_info->chat_bol,
-                                  &focus_info->chat_eol);
+                                  NULL, NULL, NULL);
+    focus_info->chat_words = 0;
+    focus_info->chat_word = NULL;
+    focus_info->chat_bol = NULL;
+    focus_info->chat_eol = NULL;
 
     /* search bar window, item, and line/col in item */
     gui_bar_window_search_by_xy (focus_info->window,
@@ -112,6 +117,29 @@ gui_focus_get_info (int x, int y)
     return focus_info;
 }
 
+/*
+ * Computes word, beginning and end of line at (x,y) in chat area (if not
+ * already done).
+ */
+
+void
+gui_focus_get_chat_words (struct t_gui_focus_info *focus_info)
+{
+    int chat, line_x;
+    struct t_gui_line *line;
+
+    if (focus_info->chat_words)
+        return;
+
+    gui_window_get_context_at_xy (focus_info->window,
+                                  focus_info->x, focus_info->y,
+                                  &chat, &line, &line_x,
+                                  &focus_info->chat_word,
+                                  &focus_info->chat_bol,
+                                  &focus_info->chat_eol);
+    focus_info->chat_words = 1;
+}
+
 /*
  * Frees a focus info structure.
  */
@@ -155,24 +183,25 @@ gui_focus_buffer_localvar_map_cb (void *data,
 }
 
 /*
- * Adds two focus info into hashtable.
+ * Adds focus info into hashtable.
+ *
+ * Strings with content of chat line are not added here (see function
+ * gui_focus_add_chat_line).
  *
  * Returns pointer to new hashtable.
  *
- * Note: result must be freed after use.
+ * Note: result must be given back with hashtable_pool_release after use.
  */
 
 struct t_hashtable *
 gui_focus_to_hashtable (struct t_gui_focus_info *focus_info, const char *key)
 {
     struct t_hashtable *hashtable;
-    char str_value[128], *str_time, *str_prefix, *str_tags, *str_message;
-    const char *nick;
+    char str_value[128];
 
-    hashtable = hashtable_new (32,
-                               WEECHAT_HASHTABLE_STRING,
-                               WEECHAT_HASHTABLE_STRING,
-                               NULL, NULL);
+    hashtable = hashtable_pool_get (32,
+                                    WEECHAT_HASHTABLE_STRING,
+                                    WEECHAT_HASHTABLE_STRING);
     if (!hashtable)
         return NULL;
 
@@ -214,35 +243,15 @@ gui_focus_to_hashtable (struct t_gui_focus_info *focus_info, const char *key)
         FOCUS_STR("_buffer_full_name", "");
     }
 
-    /* chat area */
+    /* chat area (strings with content of line are added later) */
     FOCUS_INT("_chat", focus_info->chat);
-    str_time = NULL;
-    str_prefix = NULL;
     if (focus_info->chat_line)
     {
-        str_time = gui_color_decode (((focus_info->chat_line)->data)->str_time, NULL);
-        str_prefix = gui_color_decode (((focus_info->chat_line)->data)->prefix, NULL);
-        str_tags = string_build_with_split_string ((const char **)((focus_info->chat_line)->data)->tags_array, ",");
-        str_message = gui_color_decode (((focus_info->chat_line)->data)->message, NULL);
-        nick = gui_line_get_nick_tag (focus_info->chat_line);
         FOCUS_PTR("_chat_line", focus_info->chat_line);
         FOCUS_INT("_chat_line_x", focus_info->chat_line_x);
         FOCUS_INT("_chat_line_y", ((focus_info->chat_line)->data)->y);
         FOCUS_TIME("_chat_line_date", ((focus_info->chat_line)->data)->date);
         FOCUS_TIME("_chat_line_date_printed", ((focus_info->chat_line)->data)->date_printed);
-        FOCUS_STR_VAR("_chat_line_time", str_time);
-        FOCUS_STR_VAR("_chat_line_tags", str_tags);
-        FOCUS_STR_VAR("_chat_line_nick", nick);
-        FOCUS_STR_VAR("_chat_line_prefix", str_prefix);
-        FOCUS_STR_VAR("_chat_line_message", str_message);
-        if (str_time)
-            free (str_time);
-        if (str_prefix)
-            free (str_prefix);
-        if (str_tags)
-            free (str_tags);
-        if (str_message)
-            free (str_message);
     }
     else
     {
@@ -251,15 +260,7 @@ gui_focus_to_hashtable (struct t_gui_focus_info *focus_info, const char *key)
         FOCUS_STR("_chat_line_y", "-1");
         FOCUS_STR("_chat_line_date", "-1");
         FOCUS_STR("_chat_line_date_printed", "-1");
-        FOCUS_STR("_chat_line_time", "");
-        FOCUS_STR("_chat_line_tags", "");
-        FOCUS_STR("_chat_line_nick", "");
-        FOCUS_STR("_chat_line_prefix", "");
-        FOCUS_STR("_chat_line_message", "");
     }
-    FOCUS_STR_VAR("_chat_word", focus_info->chat_word);
-    FOCUS_STR_VAR("_chat_bol", focus_info->chat_bol);
-    FOCUS_STR_VAR("_chat_eol", focus_info->chat_eol);
 
     /* bar/item */
     if (focus_info->bar_window)
@@ -278,3 +279,57 @@ gui_focus_to_hashtable (struct t_gui_focus_info *focus_info, const char *key)
 
     return hashtable;
 }
+
+/*
+ * Adds strings with content of chat line in focus hashtable: time, tags,
+ * nick, prefix, message, word, beginning and end of line.
+ *
+ * These strings are copies of the line, so they are added only when the
+ * focus hashtable is really used (a key is matching the focus).
+ */
+
+void
+gui_focus_add_chat_line (struct t_gui_focus_info *focus_info,
+                         struct t_hashtable *hashtable)
+{
+    char *str_time, *str_prefix, *str_tags, *str_message;
+    const char *nick;
+
+    if (!focus_info || !hashtable)
+        return;
+
+    if (focus_info->chat_line)
+    {
+        str_time = gui_color_decode (((focus_info->chat_line)->data)->str_time, NULL);
+        str_prefix = gui_color_decode (((focus_info->chat_line)->data)->prefix, NULL);
+        str_tags = string_build_with_split_string ((const char **)((focus_info->chat_line)->data)->tags_array, ",");
+        str_message = gui_line_data_get_message_no_color ((focus_info->chat_line)->data);
+        nick = gui_line_get_nick_tag (focus_info->chat_line);
+        FOCUS_STR_VAR("_chat_line_time", str_time);
+        FOCUS_STR_VAR("_chat_line_tags", str_tags);
+        FOCUS_STR_VAR("_chat_line_nick", nick);
+        FOCUS_STR_VAR("_chat_line_prefix", str_prefix);
+        FOCUS_STR_VAR("_chat_line_message", str_message);
+        if (str_time)
+            free (str_time);
+        if (str_prefix)
+            free (str_prefix);
+        if (str_tags)
+            free (str_tags);
+        if (str_message)
+            free (str_message);
+    }
+    else
+    {
+        FOCUS_STR("_chat_line_time", "");
+        FOCUS_STR("_chat_line_tags", "");
+        FOCUS_STR("_chat_line_nick", "");
+        FOCUS_STR("_chat_line_prefix", "");
+        FOCUS_STR("_chat_line_message", "");
+    }
+
+    gui_focus_get_chat_words (focus_info);
+    FOCUS_STR_VAR("_chat_word", focus_info->chat_word);
+    FOCUS_STR_VAR("_chat_bol", focus_info->chat_bol);
+    FOCUS_STR_VAR("_chat_eol", focus_info->chat_eol);
+}
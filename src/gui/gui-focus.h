@@ -30,6 +30,7 @@ struct t_gui_focus_info
     int chat;                          /* 1 for chat area, otherwise 0      */
     struct t_gui_line *chat_line;      /* line in chat area                 */
     int chat_line_x;                   /* x in line                         */
+    int chat_words;                    /* 1 if 3 vars below are computed    */
     char *chat_word;                   /* word at (x,y)                     */
     char *chat_bol;                    /* beginning of line until (x,y)     */
     char *chat_eol;                    /* (x,y) until end of line           */
@@ -42,8 +43,11 @@ struct t_gui_focus_info
 /* focus functions */
 
 extern struct t_gui_focus_info *gui_focus_get_info (int x, int y);
+extern void gui_focus_get_chat_words (struct t_gui_focus_info *focus_info);
 extern void gui_focus_free_info (struct t_gui_focus_info *focus_info);
 extern struct t_hashtable *gui_focus_to_hashtable (struct t_gui_focus_info *focus_info,
                                                    const char *key);
+extern void gui_focus_add_chat_line (struct t_gui_focus_info *focus_info,
+                                     struct t_hashtable *hashtable);
 
 #endif /* WEECHAT_GUI_FOCUS_H */
@@ -45,100 +45,180 @@ struct t_gui_history *gui_history = NULL;
 struct t_gui_history *last_gui_history = NULL;
 struct t_gui_history *gui_history_ptr = NULL;
 int num_gui_history = 0;
+struct t_hashtable *gui_history_index = NULL; /* text -> global history     */
+                                              /* (remove duplicates)        */
 
 
 /*
- * Adds a text/command to buffer's history.
+ * Builds the index of a history (text -> history entry), if option
+ * weechat.history.remove_duplicates is enabled, or frees it if option is
+ * disabled.
+ *
+ * If a text is in history more than once, the index points to the most
+ * recent entry.
  */
 
 void
-gui_history_buffer_add (struct t_gui_buffer *buffer, const char *string)
+gui_history_index_update (struct t_gui_history *last_history,
+                          struct t_hashtable **index)
 {
-    struct t_gui_history *new_history, *ptr_history;
-
-    if (!string)
-        return;
+    struct t_gui_history *ptr_history;
 
-    if (!buffer->history
-        || (buffer->history
-            && (strcmp (buffer->history->text, string) != 0)))
+    if (!CONFIG_BOOLEAN(config_history_remove_duplicates))
     {
-        new_history = malloc (sizeof (*new_history));
-        if (new_history)
+        if (*index)
         {
-            new_history->text = strdup (string);
-            if (buffer->history)
-                buffer->history->prev_history = new_history;
-            else
-                buffer->last_history = new_history;
-            new_history->next_history = buffer->history;
-            new_history->prev_history = NULL;
-            buffer->history = new_history;
-            buffer->num_history++;
-
-            /* remove one command if necessary */
-            if ((CONFIG_INTEGER(config_history_max_commands) > 0)
-                && (buffer->num_history > CONFIG_INTEGER(config_history_max_commands)))
-            {
-                ptr_history = buffer->last_history->prev_history;
-                if (buffer->ptr_history == buffer->last_history)
-                    buffer->ptr_history = ptr_history;
-                ((buffer->last_history)->prev_history)->next_history = NULL;
-                if (buffer->last_history->text)
-                    free (buffer->last_history->text);
-                free (buffer->last_history);
-                buffer->last_history = ptr_history;
-                buffer->num_history++;
-            }
+            hashtable_free (*index);
+            *index = NULL;
         }
+        return;
+    }
+
+    if (*index)
+        return;
+
+    *index = hashtable_new (32,
+                            WEECHAT_HASHTABLE_STRING,
+                            WEECHAT_HASHTABLE_POINTER,
+                            NULL, NULL);
+    if (!*index)
+        return;
+
+    for (ptr_history = last_history; ptr_history;
+         ptr_history = ptr_history->prev_history)
+    {
+        hashtable_set (*index, ptr_history->text, ptr_history);
     }
 }
 
 /*
- * Adds a text/command to global history.
+ * Removes an entry from a history and frees it.
  */
 
 void
-gui_history_global_add (const char *string)
+gui_history_remove (struct t_gui_history **history,
+                    struct t_gui_history **last_history,
+                    struct t_gui_history **ptr_history,
+                    int *num_history,
+                    struct t_hashtable *index,
+                    struct t_gui_history *entry)
 {
-    struct t_gui_history *new_history, *ptr_history;
+    if (*ptr_history == entry)
+        *ptr_history = entry->prev_history;
 
-    if (!string)
+    if (index && (hashtable_get (index, entry->text) == entry))
+        hashtable_remove (index, entry->text);
+
+    if (entry->prev_history)
+        (entry->prev_history)->next_history = entry->next_history;
+    else
+        *history = entry->next_history;
+    if (entry->next_history)
+        (entry->next_history)->prev_history = entry->prev_history;
+    else
+        *last_history = entry->prev_history;
+
+    if (entry->text)
+        free (entry->text);
+    free (entry);
+
+    (*num_history)--;
+}
+
+/*
+ * Adds a text/command at beginning of a history:
+ *   - the text is not added if it is the same as the most recent entry
+ *   - the older entry with same text is removed, if option
+ *     weechat.history.remove_duplicates is enabled (found with the index)
+ *   - the oldest entry is removed if there are too many entries.
+ */
+
+void
+gui_history_add_to_list (struct t_gui_history **history,
+                         struct t_gui_history **last_history,
+                         struct t_gui_history **ptr_history,
+                         int *num_history,
+                         struct t_hashtable **index,
+                         const char *string)
+{
+    struct t_gui_history *new_history, *ptr_duplicate;
+
+    if (*history && (strcmp ((*history)->text, string) == 0))
+        return;
+
+    new_history = malloc (sizeof (*new_history));
+    if (!new_history)
         return;
 
-    if (!gui_history
-        || (gui_history
-            && (strcmp (gui_history->text, string) != 0)))
+    new_history->text = strdup (string);
+    if (!new_history->text)
     {
-        new_history = malloc (sizeof (*new_history));
-        if (new_history)
+        free (new_history);
+        return;
+    }
+
+    /* remove older entry with same text */
+    gui_history_index_update (*last_history, index);
+    if (*index)
+    {
+        ptr_duplicate = hashtable_get (*index, string);
+        if (ptr_duplicate)
         {
-            new_history->text = strdup (string);
-            if (gui_history)
-                gui_history->prev_history = new_history;
-            else
-                last_gui_history = new_history;
-            new_history->next_history = gui_history;
-            new_history->prev_history = NULL;
-            gui_history = new_history;
-            num_gui_history++;
-
-            /* remove one command if necessary */
-            if ((CONFIG_INTEGER(config_history_max_commands) > 0)
-                && (num_gui_history > CONFIG_INTEGER(config_history_max_commands)))
-            {
-                ptr_history = last_gui_history->prev_history;
-                if (gui_history_ptr == last_gui_history)
-                    gui_history_ptr = ptr_history;
-                (last_gui_history->prev_history)->next_history = NULL;
-                if (last_gui_history->text)
-                    free (last_gui_history->text);
-                free (last_gui_history);
-                last_gui_history = ptr_history;
-                num_gui_history--;
-            }
+            gui_history_remove (history, last_history, ptr_history,
+                                num_history, *index, ptr_duplicate);
         }
     }
+
+    /* add entry at beginning of history */
+    if (*history)
+        (*history)->prev_history = new_history;
+    else
+        *last_history = new_history;
+    new_history->next_history = *history;
+    new_history->prev_history = NULL;
+    *history = new_history;
+    (*num_history)++;
+    if (*index)
+        hashtable_set (*index, new_history->text, new_history);
+
+    /* remove oldest entry if necessary */
+    if ((CONFIG_INTEGER(config_history_max_commands) > 0)
+        && (*num_history > CONFIG_INTEGER(config_history_max_commands))
+        && (*last_history != *history))
+    {
+        gui_history_remove (history, last_history, ptr_history,
+                            num_history, *index, *last_history);
+    }
+}
+
+/*
+ * Adds a text/command to buffer's history.
+ */
+
+void
+gui_history_buffer_add (struct t_gui_buffer *buffer, const char *string)
+{
+    if (!string)
+        return;
+
+    gui_history_add_to_list (&buffer->history, &buffer->last_history,
+                             &buffer->ptr_history, &buffer->num_history,
+                             &buffer->history_index, string);
+}
+
+/*
+ * Adds a text/command to global history.
+ */
+
+void
+gui_history_global_add (const char *string)
+{
+    if (!string)
+        return;
+
+    gui_history_add_to_list (&gui_history, &last_gui_history,
+                             &gui_history_ptr, &num_gui_history,
+                             &gui_history_index, string);
 }
 
 /*
@@ -189,6 +269,11 @@ gui_history_global_free ()
     last_gui_history = NULL;
     gui_history_ptr = NULL;
     num_gui_history = 0;
+    if (gui_history_index)
+    {
+        hashtable_free (gui_history_index);
+        gui_history_index = NULL;
+    }
 }
 
 
@@ -213,6 +298,11 @@ gui_history_buffer_free (struct t_gui_buffer *buffer)
     buffer->last_history = NULL;
     buffer->ptr_history = NULL;
     buffer->num_history = 0;
+    if (buffer->history_index)
+    {
+        hashtable_free (buffer->history_index);
+        buffer->history_index = NULL;
+    }
 }
 
 /*
@@ -248,6 +338,21 @@ gui_history_hdata_history_update_cb (void *data,
         if (ptr_history->text)
             free (ptr_history->text);
         ptr_history->text = strdup (text);
+        /* index is built again on next add */
+        if (gui_history_index)
+        {
+            hashtable_free (gui_history_index);
+            gui_history_index = NULL;
+        }
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
+        {
+            if (ptr_buffer->history_index)
+            {
+                hashtable_free (ptr_buffer->history_index);
+                ptr_buffer->history_index = NULL;
+            }
+        }
     }
     else
     {
@@ -32,6 +32,8 @@ struct t_gui_history
 extern struct t_gui_history *gui_history;
 extern struct t_gui_history *last_gui_history;
 extern struct t_gui_history *gui_history_ptr;
+extern int num_gui_history;
+extern struct t_hashtable *gui_history_index;
 
 extern void gui_history_buffer_add (struct t_gui_buffer *buffer,
                                     const char *string);
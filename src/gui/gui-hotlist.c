@@ -45,6 +45,13 @@
 
 struct t_gui_hotlist *gui_hotlist = NULL;
 struct t_gui_hotlist *last_gui_hotlist = NULL;
+struct t_gui_hotlist **gui_hotlist_sorted = NULL; /* hotlist as array (same */
+                                                  /* order as linked list)  */
+int gui_hotlist_sorted_count = 0;           /* number of hotlists in array  */
+int gui_hotlist_sorted_size = 0;            /* allocated size of array      */
+struct t_hashtable *gui_hotlist_buffers = NULL; /* hotlists by buffer       */
+int gui_hotlist_signal_pending = 0;         /* 1 if signal must be sent     */
+int gui_hotlist_resort_pending = 0;         /* 1 if hotlist must be resorted*/
 struct t_gui_buffer *gui_hotlist_initial_buffer = NULL;
 struct t_hashtable *gui_hotlist_hashtable_add_conditions_pointers = NULL;
 struct t_hashtable *gui_hotlist_hashtable_add_conditions_vars = NULL;
@@ -55,14 +62,17 @@ int gui_add_hotlist = 1;                    /* 0 is for temporarily disable */
 
 
 /*
- * Sends signal "hotlist_changed".
+ * Asks to send signal "hotlist_changed".
+ *
+ * The signal is sent only once by function gui_hotlist_flush, at the end of
+ * main loop iteration, so that many changes in hotlist (for example when
+ * many buffers get activity at same time) are sent only once.
  */
 
 void
 gui_hotlist_changed_signal ()
 {
-    (void) hook_signal_send ("hotlist_changed",
-                             WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    gui_hotlist_signal_pending = 1;
 }
 
 /*
@@ -72,11 +82,14 @@ gui_hotlist_changed_signal ()
  */
 
 struct t_gui_hotlist *
-gui_hotlist_search (struct t_gui_hotlist *hotlist, struct t_gui_buffer *buffer)
+gui_hotlist_search (struct t_gui_buffer *buffer)
 {
     struct t_gui_hotlist *ptr_hotlist;
 
-    for (ptr_hotlist = hotlist; ptr_hotlist;
+    if (gui_hotlist_buffers)
+        return hashtable_get (gui_hotlist_buffers, buffer);
+
+    for (ptr_hotlist = gui_hotlist; ptr_hotlist;
          ptr_hotlist = ptr_hotlist->next_hotlist)
     {
         if (ptr_hotlist->buffer == buffer)
@@ -85,33 +98,225 @@ gui_hotlist_search (struct t_gui_hotlist *hotlist, struct t_gui_buffer *buffer)
     return NULL;
 }
 
+/*
+ * Checks if a hotlist must be displayed before another one in hotlist,
+ * according to option weechat.look.hotlist_sort.
+ *
+ * Returns:
+ *   1: hotlist1 is before hotlist2
+ *   0: hotlist1 is not before hotlist2 (it is after or at same position)
+ */
+
+int
+gui_hotlist_is_before (struct t_gui_hotlist *hotlist1,
+                       struct t_gui_hotlist *hotlist2)
+{
+    switch (CONFIG_INTEGER(config_look_hotlist_sort))
+    {
+        case CONFIG_LOOK_HOTLIST_SORT_GROUP_TIME_ASC:
+            return ((hotlist1->priority > hotlist2->priority)
+                    || ((hotlist1->priority == hotlist2->priority)
+                        && (util_timeval_diff (&(hotlist1->creation_time),
+                                               &(hotlist2->creation_time)) > 0)));
+        case CONFIG_LOOK_HOTLIST_SORT_GROUP_TIME_DESC:
+            return ((hotlist1->priority > hotlist2->priority)
+                    || ((hotlist1->priority == hotlist2->priority)
+                        && (util_timeval_diff (&(hotlist1->creation_time),
+                                               &(hotlist2->creation_time)) < 0)));
+        case CONFIG_LOOK_HOTLIST_SORT_GROUP_NUMBER_ASC:
+            return ((hotlist1->priority > hotlist2->priority)
+                    || ((hotlist1->priority == hotlist2->priority)
+                        && (hotlist1->buffer->number < hotlist2->buffer->number)));
+        case CONFIG_LOOK_HOTLIST_SORT_GROUP_NUMBER_DESC:
+            return ((hotlist1->priority > hotlist2->priority)
+                    || ((hotlist1->priority == hotlist2->priority)
+                        && (hotlist1->buffer->number > hotlist2->buffer->number)));
+        case CONFIG_LOOK_HOTLIST_SORT_NUMBER_ASC:
+            return (hotlist1->buffer->number < hotlist2->buffer->number);
+        case CONFIG_LOOK_HOTLIST_SORT_NUMBER_DESC:
+            return (hotlist1->buffer->number > hotlist2->buffer->number);
+    }
+    return 0;
+}
+
+/*
+ * Searches for position of hotlist (to keep hotlist sorted), using a binary
+ * search in sorted hotlist.
+ *
+ * Returns index of first hotlist which is after the new hotlist (or number of
+ * hotlists if new hotlist will be added at the end of list).
+ */
+
+int
+gui_hotlist_find_pos (struct t_gui_hotlist *new_hotlist)
+{
+    int low, high, middle;
+
+    low = 0;
+    high = gui_hotlist_sorted_count;
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (gui_hotlist_is_before (new_hotlist, gui_hotlist_sorted[middle]))
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    return low;
+}
+
+/*
+ * Allocates room for one more hotlist in sorted hotlist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_hotlist_alloc_sorted ()
+{
+    struct t_gui_hotlist **new_sorted;
+    int new_size;
+
+    if (gui_hotlist_sorted_count < gui_hotlist_sorted_size)
+        return 1;
+
+    new_size = (gui_hotlist_sorted_size > 0) ?
+        gui_hotlist_sorted_size * 2 : 32;
+    new_sorted = realloc (gui_hotlist_sorted,
+                          new_size * sizeof (*new_sorted));
+    if (!new_sorted)
+        return 0;
+
+    gui_hotlist_sorted = new_sorted;
+    gui_hotlist_sorted_size = new_size;
+
+    return 1;
+}
+
+/*
+ * Adds new hotlist in list.
+ *
+ * Room for the hotlist in sorted hotlist must have been allocated with
+ * function gui_hotlist_alloc_sorted.
+ */
+
+void
+gui_hotlist_add_hotlist (struct t_gui_hotlist *new_hotlist)
+{
+    struct t_gui_hotlist *pos_hotlist;
+    int pos;
+
+    pos = gui_hotlist_find_pos (new_hotlist);
+    pos_hotlist = (pos < gui_hotlist_sorted_count) ?
+        gui_hotlist_sorted[pos] : NULL;
+
+    if (pos_hotlist)
+    {
+        /* insert hotlist into the hotlist (before hotlist found) */
+        new_hotlist->prev_hotlist = pos_hotlist->prev_hotlist;
+        new_hotlist->next_hotlist = pos_hotlist;
+        if (pos_hotlist->prev_hotlist)
+            (pos_hotlist->prev_hotlist)->next_hotlist = new_hotlist;
+        else
+            gui_hotlist = new_hotlist;
+        pos_hotlist->prev_hotlist = new_hotlist;
+        memmove (gui_hotlist_sorted + pos + 1,
+                 gui_hotlist_sorted + pos,
+                 (gui_hotlist_sorted_count - pos) *
+                 sizeof (*gui_hotlist_sorted));
+    }
+    else
+    {
+        /* add hotlist to the end */
+        new_hotlist->prev_hotlist = last_gui_hotlist;
+        new_hotlist->next_hotlist = NULL;
+        if (last_gui_hotlist)
+            last_gui_hotlist->next_hotlist = new_hotlist;
+        else
+            gui_hotlist = new_hotlist;
+        last_gui_hotlist = new_hotlist;
+    }
+
+    gui_hotlist_sorted[pos] = new_hotlist;
+    gui_hotlist_sorted_count++;
+}
+
+/*
+ * Removes a hotlist from sorted hotlist.
+ */
+
+void
+gui_hotlist_remove_sorted (struct t_gui_hotlist *hotlist)
+{
+    int low, high, middle, pos;
+
+    /* search first hotlist which is not before the hotlist */
+    low = 0;
+    high = gui_hotlist_sorted_count;
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (gui_hotlist_is_before (gui_hotlist_sorted[middle], hotlist))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    /* many hotlists can be at same position, search the hotlist pointer */
+    for (pos = low; pos < gui_hotlist_sorted_count; pos++)
+    {
+        if (gui_hotlist_sorted[pos] == hotlist)
+            break;
+    }
+
+    /*
+     * not found: the sort keys have changed since the hotlist was added
+     * (for example buffer number), search in whole array
+     */
+    if (pos >= gui_hotlist_sorted_count)
+    {
+        for (pos = 0; pos < gui_hotlist_sorted_count; pos++)
+        {
+            if (gui_hotlist_sorted[pos] == hotlist)
+                break;
+        }
+        if (pos >= gui_hotlist_sorted_count)
+            return;
+    }
+
+    memmove (gui_hotlist_sorted + pos,
+             gui_hotlist_sorted + pos + 1,
+             (gui_hotlist_sorted_count - pos - 1) *
+             sizeof (*gui_hotlist_sorted));
+    gui_hotlist_sorted_count--;
+}
+
 /*
  * Frees a hotlist and removes it from hotlist queue.
  */
 
 void
-gui_hotlist_free (struct t_gui_hotlist **hotlist,
-                  struct t_gui_hotlist **last_hotlist,
-                  struct t_gui_hotlist *ptr_hotlist)
+gui_hotlist_free (struct t_gui_hotlist *ptr_hotlist)
 {
-    struct t_gui_hotlist *new_hotlist;
+    gui_hotlist_remove_sorted (ptr_hotlist);
+    if (gui_hotlist_buffers)
+        hashtable_remove (gui_hotlist_buffers, ptr_hotlist->buffer);
 
     /* remove hotlist from queue */
-    if (*last_hotlist == ptr_hotlist)
-        *last_hotlist = ptr_hotlist->prev_hotlist;
+    if (last_gui_hotlist == ptr_hotlist)
+        last_gui_hotlist = ptr_hotlist->prev_hotlist;
     if (ptr_hotlist->prev_hotlist)
-    {
         (ptr_hotlist->prev_hotlist)->next_hotlist = ptr_hotlist->next_hotlist;
-        new_hotlist = *hotlist;
-    }
     else
-        new_hotlist = ptr_hotlist->next_hotlist;
+        gui_hotlist = ptr_hotlist->next_hotlist;
 
     if (ptr_hotlist->next_hotlist)
         (ptr_hotlist->next_hotlist)->prev_hotlist = ptr_hotlist->prev_hotlist;
 
     free (ptr_hotlist);
-    *hotlist = new_hotlist;
 }
 
 /*
@@ -119,14 +324,22 @@ gui_hotlist_free (struct t_gui_hotlist **hotlist,
  */
 
 void
-gui_hotlist_free_all (struct t_gui_hotlist **hotlist,
-                      struct t_gui_hotlist **last_hotlist)
+gui_hotlist_free_all ()
 {
+    struct t_gui_hotlist *ptr_next_hotlist;
+
     /* remove all hotlists */
-    while (*hotlist)
+    while (gui_hotlist)
     {
-        gui_hotlist_free (hotlist, last_hotlist, *hotlist);
+        ptr_next_hotlist = gui_hotlist->next_hotlist;
+        free (gui_hotlist);
+        gui_hotlist = ptr_next_hotlist;
     }
+    last_gui_hotlist = NULL;
+
+    gui_hotlist_sorted_count = 0;
+    if (gui_hotlist_buffers)
+        hashtable_remove_all (gui_hotlist_buffers);
 }
 
 /*
@@ -160,124 +373,6 @@ gui_hotlist_check_buffer_notify (struct t_gui_buffer *buffer,
     return 1;
 }
 
-/*
- * Searches for position of hotlist (to keep hotlist sorted).
- */
-
-struct t_gui_hotlist *
-gui_hotlist_find_pos (struct t_gui_hotlist *hotlist,
-                      struct t_gui_hotlist *new_hotlist)
-{
-    struct t_gui_hotlist *ptr_hotlist;
-
-    switch (CONFIG_INTEGER(config_look_hotlist_sort))
-    {
-        case CONFIG_LOOK_HOTLIST_SORT_GROUP_TIME_ASC:
-            for (ptr_hotlist = hotlist; ptr_hotlist;
-                 ptr_hotlist = ptr_hotlist->next_hotlist)
-            {
-                if ((new_hotlist->priority > ptr_hotlist->priority)
-                    || ((new_hotlist->priority == ptr_hotlist->priority)
-                        && (util_timeval_diff (&(new_hotlist->creation_time),
-                                               &(ptr_hotlist->creation_time)) > 0)))
-                    return ptr_hotlist;
-            }
-            break;
-        case CONFIG_LOOK_HOTLIST_SORT_GROUP_TIME_DESC:
-            for (ptr_hotlist = hotlist; ptr_hotlist;
-                 ptr_hotlist = ptr_hotlist->next_hotlist)
-            {
-                if ((new_hotlist->priority > ptr_hotlist->priority)
-                    || ((new_hotlist->priority == ptr_hotlist->priority)
-                        && (util_timeval_diff (&(new_hotlist->creation_time),
-                                               &(ptr_hotlist->creation_time)) < 0)))
-                    return ptr_hotlist;
-            }
-            break;
-        case CONFIG_LOOK_HOTLIST_SORT_GROUP_NUMBER_ASC:
-            for (ptr_hotlist = hotlist; ptr_hotlist;
-                 ptr_hotlist = ptr_hotlist->next_hotlist)
-            {
-                if ((new_hotlist->priority > ptr_hotlist->priority)
-                    || ((new_hotlist->priority == ptr_hotlist->priority)
-                        && (new_hotlist->buffer->number < ptr_hotlist->buffer->number)))
-                    return ptr_hotlist;
-            }
-            break;
-        case CONFIG_LOOK_HOTLIST_SORT_GROUP_NUMBER_DESC:
-            for (ptr_hotlist = hotlist; ptr_hotlist;
-                 ptr_hotlist = ptr_hotlist->next_hotlist)
-            {
-                if ((new_hotlist->priority > ptr_hotlist->priority)
-                    || ((new_hotlist->priority == ptr_hotlist->priority)
-                        && (new_hotlist->buffer->number > ptr_hotlist->buffer->number)))
-                    return ptr_hotlist;
-            }
-            break;
-        case CONFIG_LOOK_HOTLIST_SORT_NUMBER_ASC:
-            for (ptr_hotlist = hotlist; ptr_hotlist;
-                 ptr_hotlist = ptr_hotlist->next_hotlist)
-            {
-                if (new_hotlist->buffer->number < ptr_hotlist->buffer->number)
-                    return ptr_hotlist;
-            }
-            break;
-        case CONFIG_LOOK_HOTLIST_SORT_NUMBER_DESC:
-            for (ptr_hotlist = hotlist; ptr_hotlist;
-                 ptr_hotlist = ptr_hotlist->next_hotlist)
-            {
-                if (new_hotlist->buffer->number > ptr_hotlist->buffer->number)
-                    return ptr_hotlist;
-            }
-            break;
-    }
-    return NULL;
-}
-
-/*
- * Adds new hotlist in list.
- */
-
-void
-gui_hotlist_add_hotlist (struct t_gui_hotlist **hotlist,
-                         struct t_gui_hotlist **last_hotlist,
-                         struct t_gui_hotlist *new_hotlist)
-{
-    struct t_gui_hotlist *pos_hotlist;
-
-    if (*hotlist)
-    {
-        pos_hotlist = gui_hotlist_find_pos (*hotlist, new_hotlist);
-
-        if (pos_hotlist)
-        {
-            /* insert hotlist into the hotlist (before hotlist found) */
-            new_hotlist->prev_hotlist = pos_hotlist->prev_hotlist;
-            new_hotlist->next_hotlist = pos_hotlist;
-            if (pos_hotlist->prev_hotlist)
-                (pos_hotlist->prev_hotlist)->next_hotlist = new_hotlist;
-            else
-                *hotlist = new_hotlist;
-            pos_hotlist->prev_hotlist = new_hotlist;
-        }
-        else
-        {
-            /* add hotlist to the end */
-            new_hotlist->prev_hotlist = *last_hotlist;
-            new_hotlist->next_hotlist = NULL;
-            (*last_hotlist)->next_hotlist = new_hotlist;
-            *last_hotlist = new_hotlist;
-        }
-    }
-    else
-    {
-        new_hotlist->prev_hotlist = NULL;
-        new_hotlist->next_hotlist = NULL;
-        *hotlist = new_hotlist;
-        *last_hotlist = new_hotlist;
-    }
-}
-
 /*
  * Adds a buffer to hotlist, with priority.
  *
@@ -370,7 +465,7 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
         count[i] = 0;
     }
 
-    ptr_hotlist = gui_hotlist_search (gui_hotlist, buffer);
+    ptr_hotlist = gui_hotlist_search (buffer);
     if (ptr_hotlist)
     {
         /* return if priority is greater or equal than the one to add */
@@ -386,9 +481,21 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
          * and go on
          */
         memcpy (count, ptr_hotlist->count, sizeof (ptr_hotlist->count));
-        gui_hotlist_free (&gui_hotlist, &last_gui_hotlist, ptr_hotlist);
+        gui_hotlist_free (ptr_hotlist);
+    }
+
+    /* create index of hotlists by buffer (only possible if hotlist is empty) */
+    if (!gui_hotlist_buffers && !gui_hotlist)
+    {
+        gui_hotlist_buffers = hashtable_new (32,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             NULL, NULL);
     }
 
+    if (!gui_hotlist_alloc_sorted ())
+        return NULL;
+
     new_hotlist = malloc (sizeof (*new_hotlist));
     if (!new_hotlist)
         return NULL;
@@ -407,7 +514,13 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
     new_hotlist->next_hotlist = NULL;
     new_hotlist->prev_hotlist = NULL;
 
-    gui_hotlist_add_hotlist (&gui_hotlist, &last_gui_hotlist, new_hotlist);
+    gui_hotlist_add_hotlist (new_hotlist);
+    if (gui_hotlist_buffers
+        && !hashtable_set (gui_hotlist_buffers, buffer, new_hotlist))
+    {
+        hashtable_free (gui_hotlist_buffers);
+        gui_hotlist_buffers = NULL;
+    }
 
     gui_hotlist_changed_signal ();
 
@@ -415,57 +528,65 @@ gui_hotlist_add (struct t_gui_buffer *buffer,
 }
 
 /*
- * Duplicates a hotlist element.
- *
- * Returns pointer to new hotlist, NULL if error.
+ * Resorts hotlist with new sort type.
  */
 
-struct t_gui_hotlist *
-gui_hotlist_dup (struct t_gui_hotlist *hotlist)
+void
+gui_hotlist_resort ()
 {
-    struct t_gui_hotlist *new_hotlist;
+    struct t_gui_hotlist *ptr_hotlist, *ptr_next_hotlist;
 
-    new_hotlist = malloc (sizeof (*new_hotlist));
-    if (new_hotlist)
-    {
-        new_hotlist->priority = hotlist->priority;
-        memcpy (&(new_hotlist->creation_time), &(hotlist->creation_time),
-                sizeof (new_hotlist->creation_time));
-        new_hotlist->buffer = hotlist->buffer;
-        memcpy (new_hotlist->count, hotlist->count, sizeof (hotlist->count));
-        new_hotlist->prev_hotlist = NULL;
-        new_hotlist->next_hotlist = NULL;
-        return new_hotlist;
+    if (!gui_hotlist)
+        return;
+
+    /* add again all hotlists in list, in current order */
+    ptr_hotlist = gui_hotlist;
+    gui_hotlist = NULL;
+    last_gui_hotlist = NULL;
+    gui_hotlist_sorted_count = 0;
+    while (ptr_hotlist)
+    {
+        ptr_next_hotlist = ptr_hotlist->next_hotlist;
+        gui_hotlist_add_hotlist (ptr_hotlist);
+        ptr_hotlist = ptr_next_hotlist;
     }
-    return NULL;
+
+    gui_hotlist_changed_signal ();
 }
 
 /*
- * Resorts hotlist with new sort type.
+ * Asks for a resort of hotlist (done by function gui_hotlist_flush, at the
+ * end of main loop iteration).
  */
 
 void
-gui_hotlist_resort ()
+gui_hotlist_ask_resort ()
 {
-    struct t_gui_hotlist *new_hotlist, *last_new_hotlist;
-    struct t_gui_hotlist *ptr_hotlist, *element;
+    gui_hotlist_resort_pending = 1;
+}
 
-    /* copy and resort hotlist in new linked list */
-    new_hotlist = NULL;
-    last_new_hotlist = NULL;
-    for (ptr_hotlist = gui_hotlist; ptr_hotlist;
-         ptr_hotlist = ptr_hotlist->next_hotlist)
+/*
+ * Resorts hotlist if asked and sends signal "hotlist_changed" if hotlist has
+ * changed.
+ *
+ * This function is called at the end of each main loop iteration.
+ */
+
+void
+gui_hotlist_flush ()
+{
+    if (gui_hotlist_resort_pending)
     {
-        element = gui_hotlist_dup (ptr_hotlist);
-        gui_hotlist_add_hotlist (&new_hotlist, &last_new_hotlist, element);
+        gui_hotlist_resort_pending = 0;
+        gui_hotlist_resort ();
     }
 
-    gui_hotlist_free_all (&gui_hotlist, &last_gui_hotlist);
-
-    gui_hotlist = new_hotlist;
-    last_gui_hotlist = last_new_hotlist;
-
-    gui_hotlist_changed_signal ();
+    if (gui_hotlist_signal_pending)
+    {
+        gui_hotlist_signal_pending = 0;
+        (void) hook_signal_send ("hotlist_changed",
+                                 WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    }
 }
 
 /*
@@ -497,7 +618,7 @@ gui_hotlist_clear (int level_mask)
         ptr_next_hotlist = ptr_hotlist->next_hotlist;
         if (level_mask & (1 << ptr_hotlist->priority))
         {
-            gui_hotlist_free (&gui_hotlist, &last_gui_hotlist, ptr_hotlist);
+            gui_hotlist_free (ptr_hotlist);
             hotlist_changed = 1;
         }
         ptr_hotlist = ptr_next_hotlist;
@@ -548,7 +669,7 @@ gui_hotlist_remove_buffer (struct t_gui_buffer *buffer,
 
         if (buffer_to_remove)
         {
-            gui_hotlist_free (&gui_hotlist, &last_gui_hotlist, ptr_hotlist);
+            gui_hotlist_free (ptr_hotlist);
             hotlist_changed = 1;
         }
 
@@ -699,6 +820,19 @@ gui_hotlist_print_log ()
 void
 gui_hotlist_end ()
 {
+    gui_hotlist_free_all ();
+    if (gui_hotlist_sorted)
+    {
+        free (gui_hotlist_sorted);
+        gui_hotlist_sorted = NULL;
+    }
+    gui_hotlist_sorted_count = 0;
+    gui_hotlist_sorted_size = 0;
+    if (gui_hotlist_buffers)
+    {
+        hashtable_free (gui_hotlist_buffers);
+        gui_hotlist_buffers = NULL;
+    }
     if (gui_hotlist_hashtable_add_conditions_pointers)
     {
         hashtable_free (gui_hotlist_hashtable_add_conditions_pointers);
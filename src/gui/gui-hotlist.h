@@ -60,6 +60,8 @@ extern struct t_gui_hotlist *gui_hotlist_add (struct t_gui_buffer *buffer,
                                               enum t_gui_hotlist_priority priority,
                                               struct timeval *creation_time);
 extern void gui_hotlist_resort ();
+extern void gui_hotlist_ask_resort ();
+extern void gui_hotlist_flush ();
 extern void gui_hotlist_clear (int level_mask);
 extern void gui_hotlist_remove_buffer (struct t_gui_buffer *buffer,
                                        int force_remove_buffer);
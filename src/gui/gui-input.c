@@ -69,6 +69,27 @@ gui_input_optimize_size (struct t_gui_buffer *buffer,
 
     optimal_size = ((new_size / GUI_BUFFER_INPUT_BLOCK_SIZE) *
                     GUI_BUFFER_INPUT_BLOCK_SIZE) + GUI_BUFFER_INPUT_BLOCK_SIZE;
+    if (optimal_size > buffer->input_buffer_alloc)
+    {
+        /*
+         * grow by at least 50% of current size, so that many inserts (for
+         * example a big paste) do not realloc the input on each insert
+         */
+        if (optimal_size < buffer->input_buffer_alloc +
+            (buffer->input_buffer_alloc / 2))
+        {
+            optimal_size = (((buffer->input_buffer_alloc +
+                              (buffer->input_buffer_alloc / 2)) /
+                             GUI_BUFFER_INPUT_BLOCK_SIZE) *
+                            GUI_BUFFER_INPUT_BLOCK_SIZE) +
+                GUI_BUFFER_INPUT_BLOCK_SIZE;
+        }
+    }
+    else if (optimal_size > buffer->input_buffer_alloc / 2)
+    {
+        /* shrink only if more than half of allocated size is unused */
+        optimal_size = buffer->input_buffer_alloc;
+    }
     if (buffer->input_buffer_alloc != optimal_size)
     {
         input_buffer2 = realloc (buffer->input_buffer, optimal_size);
@@ -245,7 +266,7 @@ void
 gui_input_insert_string (struct t_gui_buffer *buffer, const char *string,
                          int pos)
 {
-    int size, length;
+    int size, length, old_size, old_length;
     char *string_utf8, *ptr_start;
 
     if (buffer->input)
@@ -262,19 +283,31 @@ gui_input_insert_string (struct t_gui_buffer *buffer, const char *string,
         size = strlen (string_utf8);
         length = utf8_strlen (string_utf8);
 
+        old_size = buffer->input_buffer_size;
+        old_length = buffer->input_buffer_length;
+
         if (gui_input_optimize_size (buffer,
-                                     buffer->input_buffer_size + size,
-                                     buffer->input_buffer_length + length))
+                                     old_size + size,
+                                     old_length + length))
         {
             buffer->input_buffer[buffer->input_buffer_size] = '\0';
 
-            /* move end of string to the right */
-            ptr_start = (char *)utf8_add_offset (buffer->input_buffer, pos);
-            memmove (ptr_start + size, ptr_start, strlen (ptr_start));
+            /*
+             * move end of string to the right (position is not searched
+             * when inserting at the end of input, which is the most common
+             * case, for example with a paste)
+             */
+            ptr_start = (pos >= old_length) ?
+                buffer->input_buffer + old_size :
+                (char *)utf8_add_offset (buffer->input_buffer, pos);
+            if (ptr_start < buffer->input_buffer + old_size)
+            {
+                memmove (ptr_start + size, ptr_start,
+                         buffer->input_buffer + old_size - ptr_start);
+            }
 
             /* insert new string */
-            ptr_start = (char *)utf8_add_offset (buffer->input_buffer, pos);
-            strncpy (ptr_start, string_utf8, size);
+            memcpy (ptr_start, string_utf8, size);
 
             buffer->input_buffer_pos += length;
         }
@@ -437,6 +470,61 @@ gui_input_return (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Terminates all complete lines in input (lines ending with a newline,
+ * kept in input during a paste for a buffer with flag "input_multiline"):
+ *   - saves each line in history
+ *   - keeps last incomplete line in input
+ *   - sends all lines to buffer in a single call.
+ */
+
+void
+gui_input_return_lines (struct t_gui_buffer *buffer)
+{
+    char *pos, *lines, **items;
+    int i, num_items;
+
+    if (!buffer->input || (buffer->input_buffer_size == 0))
+        return;
+
+    buffer->input_buffer[buffer->input_buffer_size] = '\0';
+    pos = strrchr (buffer->input_buffer, '\n');
+    if (!pos)
+        return;
+
+    /* empty lines are ignored (like return on an empty input) */
+    pos[0] = '\0';
+    num_items = 0;
+    items = string_split (buffer->input_buffer, "\n", 0, 0, &num_items);
+    pos[0] = '\n';
+    lines = (items) ?
+        string_build_with_split_string ((const char **)items, "\n") : NULL;
+
+    /* keep last incomplete line in input */
+    gui_input_replace_input (buffer, pos + 1);
+    buffer->input_buffer_pos = buffer->input_buffer_length;
+    buffer->input_buffer_1st_display = 0;
+
+    for (i = 0; i < num_items; i++)
+    {
+        gui_history_add (buffer, items[i]);
+    }
+    gui_buffer_undo_free_all (buffer);
+    buffer->ptr_history = NULL;
+    gui_history_ptr = NULL;
+    gui_input_text_changed_modifier_and_signal (buffer,
+                                                0, /* save undo */
+                                                1); /* stop completion */
+
+    if (lines && lines[0])
+        (void) input_data (buffer, lines);
+
+    if (items)
+        string_free_split (items);
+    if (lines)
+        free (lines);
+}
+
 /*
  * Completes a word in input buffer.
  */
@@ -614,7 +702,7 @@ gui_input_search_compile_regex (struct t_gui_buffer *buffer)
     /* remove the compiled regex */
     if (buffer->text_search_regex_compiled)
     {
-        regfree (buffer->text_search_regex_compiled);
+        string_regfree (buffer->text_search_regex_compiled);
         free (buffer->text_search_regex_compiled);
         buffer->text_search_regex_compiled = NULL;
     }
@@ -41,6 +41,7 @@ extern void gui_input_move_to_buffer (struct t_gui_buffer *from_buffer,
                                       struct t_gui_buffer *to_buffer);
 extern void gui_input_clipboard_paste (struct t_gui_buffer *buffer);
 extern void gui_input_return (struct t_gui_buffer *buffer);
+extern void gui_input_return_lines (struct t_gui_buffer *buffer);
 extern void gui_input_complete_next (struct t_gui_buffer *buffer);
 extern void gui_input_complete_previous (struct t_gui_buffer *buffer);
 extern void gui_input_search_text_here (struct t_gui_buffer *buffer);
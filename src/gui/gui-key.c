@@ -63,6 +63,8 @@ struct t_gui_key *gui_default_keys[GUI_KEY_NUM_CONTEXTS]; /* default keys   */
 struct t_gui_key *last_gui_default_key[GUI_KEY_NUM_CONTEXTS];
 int gui_keys_count[GUI_KEY_NUM_CONTEXTS];            /* keys number         */
 int gui_default_keys_count[GUI_KEY_NUM_CONTEXTS];    /* default keys number */
+struct t_gui_key_trie *gui_key_trie[GUI_KEY_NUM_CONTEXTS]; /* keys trie    */
+int gui_key_trie_valid[GUI_KEY_NUM_CONTEXTS];        /* 0 = trie to rebuild */
 
 char *gui_key_context_string[GUI_KEY_NUM_CONTEXTS] =
 { "default", "search", "cursor", "mouse" };
@@ -115,6 +117,8 @@ gui_key_init ()
         last_gui_default_key[i] = NULL;
         gui_keys_count[i] = 0;
         gui_default_keys_count[i] = 0;
+        gui_key_trie[i] = NULL;
+        gui_key_trie_valid[i] = 0;
         gui_key_default_bindings (i);
         gui_default_keys[i] = gui_keys[i];
         last_gui_default_key[i] = last_gui_key[i];
@@ -359,6 +363,165 @@ gui_key_get_expanded_name (const char *key)
     return result;
 }
 
+/*
+ * Frees a trie of keys.
+ */
+
+void
+gui_key_trie_free (struct t_gui_key_trie *trie)
+{
+    struct t_gui_key_trie *ptr_next;
+
+    while (trie)
+    {
+        ptr_next = trie->next;
+        gui_key_trie_free (trie->child);
+        free (trie);
+        trie = ptr_next;
+    }
+}
+
+/*
+ * Invalidates trie of keys if the list is the list of keys of a context
+ * (the trie will be built again on next search of a key).
+ */
+
+void
+gui_key_trie_invalidate (struct t_gui_key **keys)
+{
+    int i;
+
+    for (i = 0; i < GUI_KEY_NUM_CONTEXTS; i++)
+    {
+        if (keys == &gui_keys[i])
+        {
+            gui_key_trie_valid[i] = 0;
+            break;
+        }
+    }
+}
+
+/*
+ * Adds a key in a trie of keys.
+ *
+ * Keys must be added in sorted order, so that each node references the first
+ * key in its subtree (same key as found by a scan of the sorted list).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_key_trie_add (struct t_gui_key_trie *trie, struct t_gui_key *key)
+{
+    struct t_gui_key_trie *ptr_node, *ptr_child;
+    const unsigned char *ptr_byte;
+
+    ptr_node = trie;
+    if (!ptr_node->first_key)
+        ptr_node->first_key = key;
+
+    for (ptr_byte = (const unsigned char *)key->key; ptr_byte[0]; ptr_byte++)
+    {
+        for (ptr_child = ptr_node->child; ptr_child;
+             ptr_child = ptr_child->next)
+        {
+            if (ptr_child->byte == ptr_byte[0])
+                break;
+        }
+        if (!ptr_child)
+        {
+            ptr_child = malloc (sizeof (*ptr_child));
+            if (!ptr_child)
+                return 0;
+            ptr_child->byte = ptr_byte[0];
+            ptr_child->first_key = NULL;
+            ptr_child->child = NULL;
+            ptr_child->next = ptr_node->child;
+            ptr_node->child = ptr_child;
+        }
+        ptr_node = ptr_child;
+        if (!ptr_node->first_key)
+            ptr_node->first_key = key;
+    }
+
+    return 1;
+}
+
+/*
+ * Builds the trie of keys for a context (if it is not valid).
+ *
+ * Returns pointer to root node of trie, NULL if error.
+ */
+
+struct t_gui_key_trie *
+gui_key_trie_build (int context)
+{
+    struct t_gui_key *ptr_key;
+
+    if (gui_key_trie_valid[context] && gui_key_trie[context])
+        return gui_key_trie[context];
+
+    gui_key_trie_free (gui_key_trie[context]);
+
+    gui_key_trie[context] = malloc (sizeof (*gui_key_trie[context]));
+    if (!gui_key_trie[context])
+        return NULL;
+    gui_key_trie[context]->byte = 0;
+    gui_key_trie[context]->first_key = NULL;
+    gui_key_trie[context]->child = NULL;
+    gui_key_trie[context]->next = NULL;
+
+    for (ptr_key = gui_keys[context]; ptr_key; ptr_key = ptr_key->next_key)
+    {
+        if (!ptr_key->key
+            || ((context == GUI_KEY_CONTEXT_CURSOR)
+                && (ptr_key->key[0] == '@')))
+        {
+            continue;
+        }
+        if (!gui_key_trie_add (gui_key_trie[context], ptr_key))
+        {
+            gui_key_trie_free (gui_key_trie[context]);
+            gui_key_trie[context] = NULL;
+            return NULL;
+        }
+    }
+
+    gui_key_trie_valid[context] = 1;
+
+    return gui_key_trie[context];
+}
+
+/*
+ * Searches a key in a trie of keys: the key found is the first key (in sorted
+ * order) which is equal to or begins with "key".
+ *
+ * Returns pointer to key found, NULL if not found.
+ */
+
+struct t_gui_key *
+gui_key_trie_search (struct t_gui_key_trie *trie, const char *key)
+{
+    struct t_gui_key_trie *ptr_node;
+    const unsigned char *ptr_byte;
+
+    ptr_node = trie;
+    for (ptr_byte = (const unsigned char *)key; ptr_byte[0]; ptr_byte++)
+    {
+        for (ptr_node = ptr_node->child; ptr_node; ptr_node = ptr_node->next)
+        {
+            if (ptr_node->byte == ptr_byte[0])
+                break;
+        }
+        if (!ptr_node)
+            return NULL;
+    }
+
+    return ptr_node->first_key;
+}
+
 /*
  * Searches for position of a key (to keep keys sorted).
  */
@@ -426,6 +589,8 @@ gui_key_insert_sorted (struct t_gui_key **keys,
     }
 
     (*keys_count)++;
+
+    gui_key_trie_invalidate (keys);
 }
 
 /*
@@ -656,6 +821,8 @@ gui_key_new (struct t_gui_buffer *buffer, int context, const char *key,
         gui_key_insert_sorted (&gui_keys[context],
                                &last_gui_key[context],
                                &gui_keys_count[context], new_key);
+        config_file_set_dirty (weechat_config_file,
+                               weechat_config_section_key[context]);
     }
 
     expanded_name = gui_key_get_expanded_name (new_key->key);
@@ -737,6 +904,18 @@ gui_key_search_part (struct t_gui_buffer *buffer, int context,
                      const char *key)
 {
     struct t_gui_key *ptr_key;
+    struct t_gui_key_trie *ptr_trie;
+
+    /*
+     * use the trie for keys of context (except mouse: keys are masks),
+     * fallback on a scan of sorted list if trie can not be built
+     */
+    if (!buffer && (context != GUI_KEY_CONTEXT_MOUSE))
+    {
+        ptr_trie = gui_key_trie_build (context);
+        if (ptr_trie)
+            return gui_key_trie_search (ptr_trie, key);
+    }
 
     for (ptr_key = (buffer) ? buffer->keys : gui_keys[context]; ptr_key;
          ptr_key = ptr_key->next_key)
@@ -1029,10 +1208,11 @@ gui_key_focus_command_replace_cb (void *data, const char *text)
 
 int
 gui_key_focus_command (const char *key, int context,
+                       struct t_gui_focus_info **focus_info,
                        struct t_hashtable **hashtable_focus)
 {
     struct t_gui_key *ptr_key;
-    int i, matching, debug, rc;
+    int i, matching, debug, rc, chat_line_added;
     long unsigned int value;
     char *command, **commands;
     const char *str_buffer;
@@ -1041,6 +1221,8 @@ gui_key_focus_command (const char *key, int context,
     struct t_weelist_item *ptr_item;
     struct t_gui_buffer *ptr_buffer;
 
+    chat_line_added = 0;
+
     debug = 0;
     if (gui_cursor_debug && (context == GUI_KEY_CONTEXT_CURSOR))
         debug = gui_cursor_debug;
@@ -1072,6 +1254,16 @@ gui_key_focus_command (const char *key, int context,
         if (!matching)
             continue;
 
+        /* add content of chat line (only once, when a key is matching) */
+        if (!chat_line_added)
+        {
+            for (i = 0; i < 2; i++)
+            {
+                gui_focus_add_chat_line (focus_info[i], hashtable_focus[i]);
+            }
+            chat_line_added = 1;
+        }
+
         hashtable = hook_focus_get_data (hashtable_focus[0],
                                          hashtable_focus[1]);
         if (!hashtable)
@@ -1087,7 +1279,10 @@ gui_key_focus_command (const char *key, int context,
                 ptr_buffer = (struct t_gui_buffer *)value;
         }
         if (!ptr_buffer)
+        {
+            hashtable_pool_release (hashtable);
             continue;
+        }
 
         if ((context == GUI_KEY_CONTEXT_CURSOR) && gui_cursor_debug)
         {
@@ -1154,7 +1349,7 @@ gui_key_focus_command (const char *key, int context,
                 string_free_split (commands);
             }
         }
-        hashtable_free (hashtable);
+        hashtable_pool_release (hashtable);
         return 1;
     }
 
@@ -1173,33 +1368,33 @@ gui_key_focus_command (const char *key, int context,
 int
 gui_key_focus (const char *key, int context)
 {
-    struct t_gui_focus_info *focus_info1, *focus_info2;
+    struct t_gui_focus_info *focus_info[2];
     struct t_hashtable *hashtable_focus[2];
     int rc;
 
     rc = 0;
-    focus_info1 = NULL;
-    focus_info2 = NULL;
+    focus_info[0] = NULL;
+    focus_info[1] = NULL;
     hashtable_focus[0] = NULL;
     hashtable_focus[1] = NULL;
 
     if (context == GUI_KEY_CONTEXT_MOUSE)
     {
-        focus_info1 = gui_focus_get_info (gui_mouse_event_x[0],
-                                          gui_mouse_event_y[0]);
-        if (!focus_info1)
+        focus_info[0] = gui_focus_get_info (gui_mouse_event_x[0],
+                                            gui_mouse_event_y[0]);
+        if (!focus_info[0])
             goto end;
-        hashtable_focus[0] = gui_focus_to_hashtable (focus_info1, key);
+        hashtable_focus[0] = gui_focus_to_hashtable (focus_info[0], key);
         if (!hashtable_focus[0])
             goto end;
         if ((gui_mouse_event_x[0] != gui_mouse_event_x[1])
             || (gui_mouse_event_y[0] != gui_mouse_event_y[1]))
         {
-            focus_info2 = gui_focus_get_info (gui_mouse_event_x[1],
-                                              gui_mouse_event_y[1]);
-            if (!focus_info2)
+            focus_info[1] = gui_focus_get_info (gui_mouse_event_x[1],
+                                                gui_mouse_event_y[1]);
+            if (!focus_info[1])
                 goto end;
-            hashtable_focus[1] = gui_focus_to_hashtable (focus_info2, key);
+            hashtable_focus[1] = gui_focus_to_hashtable (focus_info[1], key);
             if (!hashtable_focus[1])
                 goto end;
         }
@@ -1213,25 +1408,25 @@ gui_key_focus (const char *key, int context)
     }
     else
     {
-        focus_info1 = gui_focus_get_info (gui_cursor_x, gui_cursor_y);
-        if (!focus_info1)
+        focus_info[0] = gui_focus_get_info (gui_cursor_x, gui_cursor_y);
+        if (!focus_info[0])
             goto end;
-        hashtable_focus[0] = gui_focus_to_hashtable (focus_info1, key);
+        hashtable_focus[0] = gui_focus_to_hashtable (focus_info[0], key);
         if (!hashtable_focus[0])
             goto end;
     }
 
-    rc = gui_key_focus_command (key, context, hashtable_focus);
+    rc = gui_key_focus_command (key, context, focus_info, hashtable_focus);
 
 end:
-    if (focus_info1)
-        gui_focus_free_info (focus_info1);
-    if (focus_info2)
-        gui_focus_free_info (focus_info2);
+    if (focus_info[0])
+        gui_focus_free_info (focus_info[0]);
+    if (focus_info[1])
+        gui_focus_free_info (focus_info[1]);
     if (hashtable_focus[0])
-        hashtable_free (hashtable_focus[0]);
+        hashtable_pool_release (hashtable_focus[0]);
     if (hashtable_focus[1])
-        hashtable_free (hashtable_focus[1]);
+        hashtable_pool_release (hashtable_focus[1]);
 
     return rc;
 }
@@ -1461,6 +1656,19 @@ gui_key_free (struct t_gui_key **keys, struct t_gui_key **last_key,
     free (key);
 
     (*keys_count)--;
+
+    gui_key_trie_invalidate (keys);
+
+    /* keys not local to a buffer are saved in configuration file */
+    for (i = 0; i < GUI_KEY_NUM_CONTEXTS; i++)
+    {
+        if (keys == &gui_keys[i])
+        {
+            config_file_set_dirty (weechat_config_file,
+                                   weechat_config_section_key[i]);
+            break;
+        }
+    }
 }
 
 /*
@@ -1867,6 +2075,10 @@ gui_key_end ()
         /* free default keys */
         gui_key_free_all (&gui_default_keys[i], &last_gui_default_key[i],
                           &gui_default_keys_count[i]);
+        /* free trie of keys */
+        gui_key_trie_free (gui_key_trie[i]);
+        gui_key_trie[i] = NULL;
+        gui_key_trie_valid[i] = 0;
     }
 }
 
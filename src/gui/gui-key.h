@@ -64,6 +64,19 @@ struct t_gui_key
     struct t_gui_key *next_key;     /* link to next key                     */
 };
 
+/*
+ * byte trie with the keys of a context, to quickly find the key matching
+ * the combo typed by user (exact key or beginning of a key)
+ */
+
+struct t_gui_key_trie
+{
+    unsigned char byte;             /* byte of key for this node            */
+    struct t_gui_key *first_key;    /* first key (sorted) in this subtree   */
+    struct t_gui_key_trie *child;   /* first child (next byte of keys)      */
+    struct t_gui_key_trie *next;    /* next sibling (same depth)            */
+};
+
 /* key variables */
 
 extern struct t_gui_key *gui_keys[GUI_KEY_NUM_CONTEXTS];
@@ -29,6 +29,7 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-log.h"
@@ -91,6 +92,7 @@ gui_layout_alloc (const char *name)
     new_layout->name = strdup (name);
     new_layout->layout_buffers = NULL;
     new_layout->last_layout_buffer = NULL;
+    new_layout->layout_buffers_index = NULL;
     new_layout->layout_windows = NULL;
     new_layout->internal_id = 0;
     new_layout->internal_id_current_window = 0;
@@ -128,6 +130,9 @@ gui_layout_add (struct t_gui_layout *layout)
         gui_layouts = layout;
     last_gui_layout = layout;
 
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_layout);
+
     return 1;
 }
 
@@ -144,6 +149,23 @@ gui_layout_rename (struct t_gui_layout *layout, const char *new_name)
     if (layout->name)
         free (layout->name);
     layout->name = strdup (new_name);
+
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_layout);
+}
+
+/*
+ * Frees index of layout buffers (it is built again on next search).
+ */
+
+void
+gui_layout_buffer_index_free (struct t_gui_layout *layout)
+{
+    if (layout->layout_buffers_index)
+    {
+        hashtable_free (layout->layout_buffers_index);
+        layout->layout_buffers_index = NULL;
+    }
 }
 
 /*
@@ -167,6 +189,8 @@ gui_layout_buffer_remove (struct t_gui_layout *layout,
     if (layout->last_layout_buffer == layout_buffer)
         layout->last_layout_buffer = layout_buffer->prev_layout;
 
+    gui_layout_buffer_index_free (layout);
+
     /* free data */
     if (layout_buffer->plugin_name)
         free (layout_buffer->plugin_name);
@@ -174,6 +198,9 @@ gui_layout_buffer_remove (struct t_gui_layout *layout,
         free (layout_buffer->buffer_name);
 
     free (layout_buffer);
+
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_layout);
 }
 
 /*
@@ -240,11 +267,97 @@ gui_layout_buffer_add (struct t_gui_layout *layout,
             layout->layout_buffers = new_layout_buffer;
         layout->last_layout_buffer = new_layout_buffer;
         new_layout_buffer->next_layout = NULL;
+
+        gui_layout_buffer_index_free (layout);
+
+        config_file_set_dirty (weechat_config_file,
+                               weechat_config_section_layout);
     }
 
     return new_layout_buffer;
 }
 
+/*
+ * Builds key used to search a plugin/buffer in layout buffers: the key is
+ * "plugin.name" in lower case (comparison of names is case insensitive).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_layout_buffer_build_key (const char *plugin_name, const char *buffer_name)
+{
+    char *key;
+    int length;
+
+    length = strlen (plugin_name) + 1 + strlen (buffer_name) + 1;
+    key = malloc (length);
+    if (!key)
+        return NULL;
+
+    snprintf (key, length, "%s.%s", plugin_name, buffer_name);
+    string_tolower (key);
+
+    return key;
+}
+
+/*
+ * Builds index of layout buffers: "plugin.name" -> layout number and merge
+ * order, so that layout number of a new buffer is found without walking the
+ * whole list of layout buffers (the index is kept until layout buffers are
+ * changed).
+ *
+ * Returns pointer to index, NULL if error.
+ */
+
+struct t_hashtable *
+gui_layout_buffer_index_build (struct t_gui_layout *layout)
+{
+    struct t_gui_layout_buffer *ptr_layout_buffer;
+    char *key;
+    int old_number, numbers[2];
+
+    if (layout->layout_buffers_index)
+        return layout->layout_buffers_index;
+
+    layout->layout_buffers_index = hashtable_new (0,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  WEECHAT_HASHTABLE_BUFFER,
+                                                  NULL, NULL);
+    if (!layout->layout_buffers_index)
+        return NULL;
+
+    old_number = -1;
+    numbers[1] = 0;
+    for (ptr_layout_buffer = layout->layout_buffers; ptr_layout_buffer;
+         ptr_layout_buffer = ptr_layout_buffer->next_layout)
+    {
+        if (ptr_layout_buffer->number != old_number)
+        {
+            old_number = ptr_layout_buffer->number;
+            numbers[1] = 0;
+        }
+        else
+            numbers[1]++;
+        numbers[0] = ptr_layout_buffer->number;
+
+        key = gui_layout_buffer_build_key (ptr_layout_buffer->plugin_name,
+                                           ptr_layout_buffer->buffer_name);
+        if (key)
+        {
+            /* keep first layout buffer found (like a sequential search) */
+            if (!hashtable_has_key (layout->layout_buffers_index, key))
+            {
+                hashtable_set_with_size (layout->layout_buffers_index, key, 0,
+                                         numbers, sizeof (numbers));
+            }
+            free (key);
+        }
+    }
+
+    return layout->layout_buffers_index;
+}
+
 /*
  * Gets layout number for a plugin/buffer.
  */
@@ -256,14 +369,32 @@ gui_layout_buffer_get_number (struct t_gui_layout *layout,
                               int *layout_number_merge_order)
 {
     struct t_gui_layout_buffer *ptr_layout_buffer;
-    int old_number, merge_order;
+    char *key;
+    int old_number, merge_order, *ptr_numbers;
 
     *layout_number = 0;
     *layout_number_merge_order = 0;
 
-    if (!layout)
+    if (!layout || !layout->layout_buffers)
         return;
 
+    /* quick search with the index */
+    if (gui_layout_buffer_index_build (layout))
+    {
+        key = gui_layout_buffer_build_key (plugin_name, buffer_name);
+        if (key)
+        {
+            ptr_numbers = hashtable_get (layout->layout_buffers_index, key);
+            if (ptr_numbers)
+            {
+                *layout_number = ptr_numbers[0];
+                *layout_number_merge_order = ptr_numbers[1];
+            }
+            free (key);
+            return;
+        }
+    }
+
     old_number = -1;
     merge_order = 0;
 
@@ -300,11 +431,12 @@ gui_layout_buffer_get_number_all (struct t_gui_layout *layout)
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        gui_layout_buffer_get_number (layout,
-                                      gui_buffer_get_plugin_name (ptr_buffer),
-                                      ptr_buffer->name,
-                                      &(ptr_buffer->layout_number),
-                                      &(ptr_buffer->layout_number_merge_order));
+        gui_layout_buffer_get_number (
+            layout,
+            gui_buffer_get_plugin_name (ptr_buffer),
+            ptr_buffer->name,
+            &(ptr_buffer->layout_number),
+            &(ptr_buffer->layout_number_merge_order));
     }
 }
 
@@ -356,11 +488,17 @@ gui_layout_buffer_apply (struct t_gui_layout *layout)
     /* sort buffers by layout number (without merge) */
     gui_buffer_sort_by_layout_number ();
 
-    /* set appropriate active buffers */
+    /*
+     * set appropriate active buffers (buffers are sorted, so merged buffers
+     * are next to each other in list)
+     */
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if ((gui_buffer_count_merged_buffers (ptr_buffer->number) > 1)
+        if (((ptr_buffer->prev_buffer
+              && (ptr_buffer->prev_buffer->number == ptr_buffer->number))
+             || (ptr_buffer->next_buffer
+                 && (ptr_buffer->next_buffer->number == ptr_buffer->number)))
             && (ptr_buffer->layout_number == ptr_buffer->number)
             && (ptr_buffer->layout_number_merge_order == 0))
         {
@@ -392,6 +530,9 @@ gui_layout_window_remove (struct t_gui_layout_window *layout_window)
         free (layout_window->buffer_name);
 
     free (layout_window);
+
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_layout);
 }
 
 /*
@@ -515,6 +656,9 @@ gui_layout_window_add (struct t_gui_layout_window **layout_window,
             /* no parent? => it's root! */
             *layout_window = new_layout_window;
         }
+
+        config_file_set_dirty (weechat_config_file,
+                               weechat_config_section_layout);
     }
 
     return new_layout_window;
@@ -654,21 +798,28 @@ gui_layout_window_assign_all_buffers ()
 {
     struct t_gui_window *ptr_win;
     struct t_gui_buffer *ptr_buffer;
+    char *full_name;
+    int length;
 
     for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
     {
         if (ptr_win->layout_plugin_name && ptr_win->layout_buffer_name)
         {
-            for (ptr_buffer = gui_buffers; ptr_buffer;
-                 ptr_buffer = ptr_buffer->next_buffer)
-            {
-                if ((strcmp (ptr_win->layout_plugin_name, gui_buffer_get_plugin_name (ptr_buffer)) == 0)
-                    && (strcmp (ptr_win->layout_buffer_name, ptr_buffer->name) == 0))
-                {
-                    gui_window_switch_to_buffer (ptr_win, ptr_buffer, 0);
-                    break;
-                }
-            }
+            /* search buffer with the index (full name is "plugin.name") */
+            length = strlen (ptr_win->layout_plugin_name) + 1 +
+                strlen (ptr_win->layout_buffer_name) + 1;
+            full_name = malloc (length);
+            if (!full_name)
+                continue;
+            snprintf (full_name, length, "%s.%s",
+                      ptr_win->layout_plugin_name,
+                      ptr_win->layout_buffer_name);
+            ptr_buffer = gui_buffer_search_by_full_name (full_name);
+            free (full_name);
+
+            /* switch only if buffer changes (window is not redrawn if same) */
+            if (ptr_buffer && (ptr_buffer != ptr_win->buffer))
+                gui_window_switch_to_buffer (ptr_win, ptr_buffer, 0);
         }
     }
 }
@@ -731,8 +882,97 @@ gui_layout_window_apply_tree (struct t_gui_layout_window *layout_window,
     }
 }
 
+/*
+ * Merges all windows of a part of windows tree into a single window.
+ *
+ * Returns pointer to the remaining window, NULL if error.
+ */
+
+struct t_gui_window *
+gui_layout_window_merge_tree (struct t_gui_window_tree *tree)
+{
+    struct t_gui_window *window;
+
+    if (tree->window)
+        return tree->window;
+
+    if (!tree->child1 || !tree->child2)
+        return NULL;
+
+    window = gui_layout_window_merge_tree (tree->child1);
+    if (!window || !gui_layout_window_merge_tree (tree->child2))
+        return NULL;
+
+    /* both children are now leaves: merge them */
+    if (!gui_window_merge (window))
+        return NULL;
+
+    return window;
+}
+
+/*
+ * Applies tree windows, reusing windows of current windows tree: parts of
+ * tree with same splits are kept as-is (only layout buffer is set in leaves),
+ * other parts are merged and split again according to layout.
+ */
+
+void
+gui_layout_window_apply_tree_reuse (struct t_gui_layout_window *layout_window,
+                                    struct t_gui_window_tree *tree,
+                                    int internal_id_current_window,
+                                    struct t_gui_window **current_window)
+{
+    struct t_gui_window *window;
+
+    if ((layout_window->split_pct != 0)
+        && !tree->window
+        && layout_window->child1 && layout_window->child2
+        && (layout_window->split_pct == tree->split_pct)
+        && (layout_window->split_horiz == tree->split_horizontal))
+    {
+        /* same split: keep windows and compare children */
+        gui_layout_window_apply_tree_reuse (layout_window->child1,
+                                            tree->child1,
+                                            internal_id_current_window,
+                                            current_window);
+        gui_layout_window_apply_tree_reuse (layout_window->child2,
+                                            tree->child2,
+                                            internal_id_current_window,
+                                            current_window);
+        return;
+    }
+
+    window = gui_layout_window_merge_tree (tree);
+    if (!window)
+        return;
+
+    if (layout_window->split_pct == 0)
+    {
+        /* leaf */
+        if (layout_window->internal_id == internal_id_current_window)
+            *current_window = window;
+
+        gui_window_set_layout_plugin_name (window,
+                                           layout_window->plugin_name);
+        gui_window_set_layout_buffer_name (window,
+                                           layout_window->buffer_name);
+    }
+    else
+    {
+        /* different split: split again the merged window */
+        gui_window_switch (window);
+        gui_layout_window_apply_tree (layout_window,
+                                      internal_id_current_window,
+                                      current_window);
+    }
+}
+
 /*
  * Applies current layout for windows.
+ *
+ * Windows which already have the geometry of layout are reused (they are not
+ * destroyed and created again), and only windows displaying another buffer
+ * are switched to the buffer of layout.
  */
 
 void
@@ -740,18 +980,39 @@ gui_layout_window_apply (struct t_gui_layout *layout,
                          int internal_id_current_window)
 {
     struct t_gui_window *old_window, *ptr_current_window;
+    struct t_gui_window_tree *ptr_tree;
 
     if (!layout || !layout->layout_windows)
         return;
 
-    gui_window_merge_all (gui_current_window);
-
-    old_window = gui_current_window;
     ptr_current_window = NULL;
 
-    gui_layout_window_apply_tree (layout->layout_windows,
-                                  internal_id_current_window,
-                                  &ptr_current_window);
+    if (gui_windows_tree)
+    {
+        gui_layout_window_apply_tree_reuse (layout->layout_windows,
+                                            gui_windows_tree,
+                                            internal_id_current_window,
+                                            &ptr_current_window);
+
+        /*
+         * default current window is the first leaf of tree (like when the
+         * screen is split again from a single window)
+         */
+        ptr_tree = gui_windows_tree;
+        while (ptr_tree && !ptr_tree->window)
+        {
+            ptr_tree = ptr_tree->child1;
+        }
+        old_window = (ptr_tree) ? ptr_tree->window : gui_current_window;
+    }
+    else
+    {
+        gui_window_merge_all (gui_current_window);
+        old_window = gui_current_window;
+        gui_layout_window_apply_tree (layout->layout_windows,
+                                      internal_id_current_window,
+                                      &ptr_current_window);
+    }
 
     gui_layout_window_assign_all_buffers ();
 
@@ -803,6 +1064,8 @@ gui_layout_store_on_exit ()
 
     /* use layout, so it will be used after restart of WeeChat */
     gui_layout_current = ptr_layout;
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_layout);
 }
 
 /*
@@ -863,6 +1126,9 @@ gui_layout_remove (struct t_gui_layout *layout)
     gui_layout_free (layout);
 
     gui_layouts = new_gui_layouts;
+
+    config_file_set_dirty (weechat_config_file,
+                           weechat_config_section_layout);
 }
 
 /*
@@ -1129,6 +1395,7 @@ gui_layout_print_log ()
         log_printf ("[layout \"%s\" (addr:0x%lx)]", ptr_layout->name, ptr_layout);
         log_printf ("  layout_buffers . . . . : 0x%lx", ptr_layout->layout_buffers);
         log_printf ("  last_layout_buffer . . : 0x%lx", ptr_layout->last_layout_buffer);
+        log_printf ("  layout_buffers_index . : 0x%lx", ptr_layout->layout_buffers_index);
         log_printf ("  layout_windows . . . . : 0x%lx", ptr_layout->layout_windows);
         log_printf ("  internal_id. . . . . . : %d",    ptr_layout->internal_id);
         log_printf ("  internal_id_current_win: %d",    ptr_layout->internal_id_current_window);
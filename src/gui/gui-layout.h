@@ -59,6 +59,8 @@ struct t_gui_layout
     char *name;                        /* name of layout                    */
     struct t_gui_layout_buffer *layout_buffers;     /* layout for buffers   */
     struct t_gui_layout_buffer *last_layout_buffer; /* last buffer layout   */
+    struct t_hashtable *layout_buffers_index;       /* index: "plugin.name" */
+                                       /* -> layout number and merge order  */
     struct t_gui_layout_window *layout_windows;     /* layout for windows   */
     int internal_id;                   /* for unique id in each window      */
     int internal_id_current_window;    /* id of current window              */
@@ -78,12 +80,14 @@ extern struct t_gui_layout *gui_layout_search (const char *name);
 extern struct t_gui_layout *gui_layout_alloc (const char *name);
 extern int gui_layout_add (struct t_gui_layout *layout);
 extern void gui_layout_rename (struct t_gui_layout *layout, const char *new_name);
+extern void gui_layout_buffer_index_free (struct t_gui_layout *layout);
 extern void gui_layout_buffer_remove_all (struct t_gui_layout *layout);
 extern void gui_layout_buffer_reset ();
 extern struct t_gui_layout_buffer *gui_layout_buffer_add (struct t_gui_layout *layout,
                                                           const char *plugin_name,
                                                           const char *buffer_name,
                                                           int number);
+extern struct t_hashtable *gui_layout_buffer_index_build (struct t_gui_layout *layout);
 extern void gui_layout_buffer_get_number (struct t_gui_layout *layout,
                                           const char *plugin_name,
                                           const char *buffer_name,
@@ -0,0 +1,467 @@
+/*
+ * gui-line-cold.c - lines removed from buffers, kept in files (used by all GUI)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When option weechat.history.buffer_lines_on_disk is enabled, the lines
+ * removed from a formatted buffer (according to options
+ * weechat.history.max_buffer_lines_*) are appended to a file in directory
+ * "scrollback" of WeeChat home.
+ *
+ * When the user scrolls above the first line of buffer, the file is mapped in
+ * memory and the previous lines are loaded again on top of buffer; these
+ * lines are kept while the buffer is scrolled and are removed again (without
+ * writing them a second time) when new lines are added.
+ *
+ * Each record in file is:
+ *   size (uint32), id (int64), date (int64), date_printed (int64),
+ *   highlight (char), flags (char), tags, prefix (if flag is set), message (strings ending
+ *   with '\0'), size (uint32)
+ * so that the file can be read backward from any record.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include "../core/weechat.h"
+#include "../core/wee-config.h"
+#include "../core/wee-log.h"
+#include "../core/wee-string.h"
+#include "../core/wee-util.h"
+#include "../plugins/plugin.h"
+#include "gui-line-cold.h"
+#include "gui-buffer.h"
+#include "gui-chat.h"
+#include "gui-filter.h"
+#include "gui-line.h"
+#include "gui-line-index.h"
+#include "gui-line-scroll.h"
+#include "gui-window.h"
+
+
+#define GUI_LINE_COLD_HEADER_SIZE (sizeof (uint32_t) + 3 * sizeof (int64_t) \
+                                   + 2)
+#define GUI_LINE_COLD_MIN_SIZE    (GUI_LINE_COLD_HEADER_SIZE + 2 \
+                                   + sizeof (uint32_t))
+
+int gui_line_cold_next_file = 0;       /* number for next file created      */
+
+
+/*
+ * Checks if a line loaded from file must be kept in buffer: it is kept as
+ * long as at least one window is scrolled in the buffer.
+ *
+ * Returns:
+ *   1: line must be kept
+ *   0: line can be removed
+ */
+
+int
+gui_line_cold_keep_line (struct t_gui_buffer *buffer, struct t_gui_line *line)
+{
+    struct t_gui_window *ptr_win;
+    struct t_gui_window_scroll *ptr_scroll;
+
+    if (!buffer || !buffer->lines_cold || !line || (line->data->cold_size == 0))
+        return 0;
+
+    for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
+    {
+        for (ptr_scroll = ptr_win->scroll; ptr_scroll;
+             ptr_scroll = ptr_scroll->next_scroll)
+        {
+            if ((ptr_scroll->buffer == buffer) && ptr_scroll->start_line)
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Opens (and truncates) the file for lines of a buffer.
+ *
+ * Returns pointer to cold lines structure, NULL if error.
+ */
+
+struct t_gui_line_cold *
+gui_line_cold_open (struct t_gui_buffer *buffer)
+{
+    struct t_gui_line_cold *new_cold;
+    int length;
+
+    if (!util_mkdir_home (GUI_LINE_COLD_DIR, 0700))
+        return NULL;
+
+    new_cold = malloc (sizeof (*new_cold));
+    if (!new_cold)
+        return NULL;
+
+    length = strlen (weechat_home) + strlen (GUI_LINE_COLD_DIR) + 64;
+    new_cold->filename = malloc (length);
+    if (!new_cold->filename)
+    {
+        free (new_cold);
+        return NULL;
+    }
+    snprintf (new_cold->filename, length, "%s/%s/%d_%d.lines",
+              weechat_home, GUI_LINE_COLD_DIR, (int)getpid (),
+              gui_line_cold_next_file++);
+
+    new_cold->fd = open (new_cold->filename,
+                         O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0600);
+    if (new_cold->fd < 0)
+    {
+        log_printf (_("Error: unable to create file \"%s\" for lines of "
+                      "buffer \"%s\""),
+                    new_cold->filename, buffer->full_name);
+        free (new_cold->filename);
+        free (new_cold);
+        return NULL;
+    }
+    new_cold->size = 0;
+    new_cold->offset = 0;
+    new_cold->lines_loaded = 0;
+
+    return new_cold;
+}
+
+/*
+ * Saves a line which is removed from a buffer.
+ *
+ * If the line was loaded from file, it is not written again (it is already
+ * in file).
+ */
+
+void
+gui_line_cold_save (struct t_gui_buffer *buffer, struct t_gui_line *line)
+{
+    struct t_gui_line_cold *ptr_cold;
+    char *tags, *record, *ptr_record;
+    uint32_t size;
+    int64_t date;
+    int length_tags, length_prefix, length_message;
+
+    if (!buffer || !line || (buffer->type != GUI_BUFFER_TYPE_FORMATTED))
+        return;
+
+    ptr_cold = buffer->lines_cold;
+
+    if (line->data->cold_size > 0)
+    {
+        /* line loaded from file: the record is now out of memory again */
+        if (ptr_cold && (ptr_cold->lines_loaded > 0))
+        {
+            ptr_cold->offset += line->data->cold_size;
+            ptr_cold->lines_loaded--;
+        }
+        return;
+    }
+
+    if (!CONFIG_BOOLEAN(config_history_buffer_lines_on_disk))
+        return;
+
+    if (!ptr_cold)
+    {
+        buffer->lines_cold = gui_line_cold_open (buffer);
+        ptr_cold = buffer->lines_cold;
+        if (!ptr_cold)
+            return;
+    }
+
+    tags = (line->data->tags_count > 0) ?
+        string_build_with_split_string (
+            (const char **)line->data->tags_array, ",") : NULL;
+    length_tags = (tags) ? strlen (tags) + 1 : 1;
+    length_prefix = (line->data->prefix) ? strlen (line->data->prefix) + 1 : 0;
+    length_message = (line->data->message) ?
+        strlen (line->data->message) + 1 : 1;
+    size = GUI_LINE_COLD_HEADER_SIZE + length_tags + length_prefix
+        + length_message + sizeof (size);
+
+    record = malloc (size);
+    if (!record)
+    {
+        if (tags)
+            free (tags);
+        return;
+    }
+
+    ptr_record = record;
+    memcpy (ptr_record, &size, sizeof (size));
+    ptr_record += sizeof (size);
+    date = (int64_t)line->data->id;
+    memcpy (ptr_record, &date, sizeof (date));
+    ptr_record += sizeof (date);
+    date = (int64_t)line->data->date;
+    memcpy (ptr_record, &date, sizeof (date));
+    ptr_record += sizeof (date);
+    date = (int64_t)line->data->date_printed;
+    memcpy (ptr_record, &date, sizeof (date));
+    ptr_record += sizeof (date);
+    *(ptr_record++) = line->data->highlight;
+    *(ptr_record++) = (line->data->prefix) ? 1 : 0;
+    memcpy (ptr_record, (tags) ? tags : "", length_tags);
+    ptr_record += length_tags;
+    if (line->data->prefix)
+    {
+        memcpy (ptr_record, line->data->prefix, length_prefix);
+        ptr_record += length_prefix;
+    }
+    memcpy (ptr_record, (line->data->message) ? line->data->message : "",
+            length_message);
+    ptr_record += length_message;
+    memcpy (ptr_record, &size, sizeof (size));
+
+    if (write (ptr_cold->fd, record, size) == (ssize_t)size)
+    {
+        ptr_cold->size += size;
+        if (ptr_cold->lines_loaded == 0)
+            ptr_cold->offset = ptr_cold->size;
+    }
+    else
+    {
+        /* write error: restore the end of file (drop a partial record) */
+        if (ftruncate (ptr_cold->fd, ptr_cold->size) != 0)
+            ptr_cold->size = lseek (ptr_cold->fd, 0, SEEK_END);
+    }
+
+    free (record);
+    if (tags)
+        free (tags);
+}
+
+/*
+ * Creates a line from a record of file and adds it on top of buffer.
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_gui_line *
+gui_line_cold_add_record (struct t_gui_buffer *buffer, const char *record,
+                          uint32_t size)
+{
+    struct t_gui_lines *lines;
+    struct t_gui_line *new_line;
+    const char *ptr_record, *ptr_end, *tags, *prefix, *message;
+    int64_t id, date, date_printed;
+    char highlight, flags;
+
+    ptr_record = record + sizeof (uint32_t);
+    ptr_end = record + size - sizeof (uint32_t);
+    memcpy (&id, ptr_record, sizeof (id));
+    ptr_record += sizeof (id);
+    memcpy (&date, ptr_record, sizeof (date));
+    ptr_record += sizeof (date);
+    memcpy (&date_printed, ptr_record, sizeof (date_printed));
+    ptr_record += sizeof (date_printed);
+    highlight = *(ptr_record++);
+    flags = *(ptr_record++);
+
+    /* check that all strings end in the record */
+    if (*(ptr_end - 1) != '\0')
+        return NULL;
+    tags = ptr_record;
+    ptr_record += strlen (ptr_record) + 1;
+    prefix = NULL;
+    if (flags & 1)
+    {
+        if (ptr_record >= ptr_end)
+            return NULL;
+        prefix = ptr_record;
+        ptr_record += strlen (ptr_record) + 1;
+    }
+    if (ptr_record >= ptr_end)
+        return NULL;
+    message = ptr_record;
+
+    lines = buffer->own_lines;
+
+    new_line = gui_lines_alloc_line (lines);
+    if (!new_line)
+        return NULL;
+    new_line->data = gui_line_data_alloc ((time_t)date, tags, message);
+    if (!new_line->data)
+    {
+        gui_lines_free_line (lines, new_line);
+        return NULL;
+    }
+
+    new_line->data->buffer = buffer;
+    new_line->data->id = (long)id;
+    new_line->data->y = -1;
+    new_line->data->date = (time_t)date;
+    new_line->data->date_printed = (time_t)date_printed;
+    new_line->data->refresh_needed = 0;
+    new_line->data->prefix = (prefix) ? (char *)string_shared_get (prefix) : NULL;
+    new_line->data->prefix_length = (prefix) ?
+        gui_chat_strlen_screen (prefix) : 0;
+    new_line->data->highlight = highlight;
+    new_line->data->cold_size = size;
+    gui_filter_line_update_mask (new_line->data);
+    new_line->data->displayed = gui_filter_check_line (new_line->data);
+
+    /* add line on top of buffer */
+    new_line->prev_line = NULL;
+    new_line->next_line = lines->first_line;
+    if (lines->first_line)
+        lines->first_line->prev_line = new_line;
+    else
+        lines->last_line = new_line;
+    lines->first_line = new_line;
+    lines->lines_count++;
+    lines->unordered = 1;
+
+    /* count prefix length (and prefix of next line, with same nick) */
+    gui_lines_prefix_length_add (lines, new_line);
+    gui_lines_prefix_length_update (lines, new_line->next_line);
+
+    if (!new_line->data->displayed)
+        lines->lines_hidden = 1;
+
+    return new_line;
+}
+
+/*
+ * Loads at most "max_lines" lines removed from a buffer (the most recent
+ * ones not in memory) and adds them on top of buffer.
+ *
+ * Merged buffers are not supported (lines are not loaded).
+ *
+ * Returns number of lines loaded.
+ */
+
+int
+gui_line_cold_load (struct t_gui_buffer *buffer, int max_lines)
+{
+    struct t_gui_line_cold *ptr_cold;
+    struct t_gui_line *ptr_line;
+    unsigned long long id;
+    char *map;
+    off_t pos;
+    uint32_t size;
+    int count, index_built;
+
+    if (!buffer || !buffer->lines_cold || buffer->mixed_lines
+        || (buffer->type != GUI_BUFFER_TYPE_FORMATTED) || (max_lines <= 0))
+    {
+        return 0;
+    }
+
+    ptr_cold = buffer->lines_cold;
+    if (ptr_cold->offset <= 0)
+        return 0;
+
+    map = mmap (NULL, ptr_cold->offset, PROT_READ, MAP_SHARED, ptr_cold->fd, 0);
+    if (map == MAP_FAILED)
+        return 0;
+
+    count = 0;
+    pos = ptr_cold->offset;
+    while ((pos > 0) && (count < max_lines))
+    {
+        if (pos < (off_t)GUI_LINE_COLD_MIN_SIZE)
+            break;
+        memcpy (&size, map + pos - sizeof (size), sizeof (size));
+        if ((size < GUI_LINE_COLD_MIN_SIZE) || ((off_t)size > pos)
+            || (memcmp (map + pos - size, &size, sizeof (size)) != 0))
+        {
+            break;
+        }
+        if (!gui_line_cold_add_record (buffer, map + pos - size, size))
+            break;
+        pos -= size;
+        count++;
+    }
+
+    munmap (map, ptr_cold->offset);
+
+    /* invalid record: previous lines can not be loaded */
+    if ((pos > 0) && (count < max_lines))
+        pos = 0;
+
+    ptr_cold->offset = pos;
+    ptr_cold->lines_loaded += count;
+
+    if (count > 0)
+    {
+        /* line ids must be increasing in list (for the index of lines) */
+        index_built = (buffer->own_lines->search_index) ? 1 : 0;
+        gui_line_index_free (buffer->own_lines);
+        gui_line_scroll_free (buffer->own_lines);
+        id = 0;
+        for (ptr_line = buffer->own_lines->first_line; ptr_line;
+             ptr_line = ptr_line->next_line)
+        {
+            ptr_line->id = id++;
+        }
+        buffer->own_lines->next_line_id = id;
+        if (index_built)
+            gui_line_index_build (buffer);
+
+        gui_buffer_ask_chat_refresh (buffer, 2);
+    }
+
+    return count;
+}
+
+/*
+ * Closes and deletes the file with lines removed from a buffer.
+ */
+
+void
+gui_line_cold_free (struct t_gui_buffer *buffer)
+{
+    if (!buffer || !buffer->lines_cold)
+        return;
+
+    if (buffer->lines_cold->fd >= 0)
+        close (buffer->lines_cold->fd);
+    unlink (buffer->lines_cold->filename);
+    free (buffer->lines_cold->filename);
+    free (buffer->lines_cold);
+    buffer->lines_cold = NULL;
+}
+
+/*
+ * Prints cold lines structure in WeeChat log file (usually for crash dump).
+ */
+
+void
+gui_line_cold_print_log (struct t_gui_line_cold *lines_cold)
+{
+    if (!lines_cold)
+        return;
+
+    log_printf ("    filename . . . . . . . : '%s'", lines_cold->filename);
+    log_printf ("    fd . . . . . . . . . . : %d",   lines_cold->fd);
+    log_printf ("    size . . . . . . . . . : %lld", (long long)lines_cold->size);
+    log_printf ("    offset . . . . . . . . : %lld", (long long)lines_cold->offset);
+    log_printf ("    lines_loaded . . . . . : %d",   lines_cold->lines_loaded);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_GUI_LINE_COLD_H
+#define WEECHAT_GUI_LINE_COLD_H 1
+
+#include <sys/types.h>
+
+#define GUI_LINE_COLD_DIR        "scrollback"
+#define GUI_LINE_COLD_LOAD_LINES 256
+
+/* cold lines structures */
+
+struct t_gui_buffer;
+struct t_gui_line;
+
+/*
+ * lines removed from a buffer, saved in a file: records are appended in
+ * order of removal, and records [0, offset) are the lines not in memory
+ * (records after "offset" are lines loaded again in memory, on top of buffer)
+ */
+
+struct t_gui_line_cold
+{
+    char *filename;                    /* path to file with lines           */
+    int fd;                            /* file descriptor (-1 if not open)  */
+    off_t size;                        /* size of file                      */
+    off_t offset;                      /* end of records not in memory      */
+    int lines_loaded;                  /* number of lines loaded from file  */
+};
+
+/* cold lines functions */
+
+extern int gui_line_cold_keep_line (struct t_gui_buffer *buffer,
+                                    struct t_gui_line *line);
+extern void gui_line_cold_save (struct t_gui_buffer *buffer,
+                                struct t_gui_line *line);
+extern int gui_line_cold_load (struct t_gui_buffer *buffer, int max_lines);
+extern void gui_line_cold_free (struct t_gui_buffer *buffer);
+extern void gui_line_cold_print_log (struct t_gui_line_cold *lines_cold);
+
+#endif /* WEECHAT_GUI_LINE_COLD_H */
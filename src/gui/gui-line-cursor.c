@@ -0,0 +1,177 @@
+/*
+ * gui-line-cursor.c - cursors to read lines one by one (used by all GUI)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A cursor keeps a pointer to a line between two reads (for example by a
+ * streamed infolist "buffer_lines"): lines can be removed in the meantime,
+ * so all cursors are updated when a line is removed (like scroll of windows).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "../core/weechat.h"
+#include "gui-line-cursor.h"
+#include "gui-line.h"
+
+
+struct t_gui_line_cursor *gui_line_cursors = NULL; /* cursors on lines      */
+
+
+/*
+ * Creates a new cursor on lines (before first line).
+ *
+ * Returns pointer to new cursor, NULL if error.
+ */
+
+struct t_gui_line_cursor *
+gui_line_cursor_new (struct t_gui_lines *lines)
+{
+    struct t_gui_line_cursor *new_cursor;
+
+    if (!lines)
+        return NULL;
+
+    new_cursor = malloc (sizeof (*new_cursor));
+    if (!new_cursor)
+        return NULL;
+
+    new_cursor->lines = lines;
+    new_cursor->line = NULL;
+    new_cursor->line_removed = 0;
+
+    new_cursor->prev_cursor = NULL;
+    new_cursor->next_cursor = gui_line_cursors;
+    if (gui_line_cursors)
+        gui_line_cursors->prev_cursor = new_cursor;
+    gui_line_cursors = new_cursor;
+
+    return new_cursor;
+}
+
+/*
+ * Moves a cursor: direction is 1 for next line, -1 for previous line and 0 to
+ * reset the cursor (no current line).
+ *
+ * With no current line, the next line is the first line and the previous line
+ * is the last line.
+ *
+ * Returns pointer to new current line, NULL if end of lines is reached.
+ */
+
+struct t_gui_line *
+gui_line_cursor_move (struct t_gui_line_cursor *cursor, int direction)
+{
+    struct t_gui_line *ptr_line;
+
+    if (!cursor || !cursor->lines)
+        return NULL;
+
+    if (direction > 0)
+    {
+        ptr_line = (cursor->line) ?
+            cursor->line->next_line : cursor->lines->first_line;
+    }
+    else if (direction < 0)
+    {
+        if (cursor->line_removed)
+            ptr_line = cursor->line;
+        else
+        {
+            ptr_line = (cursor->line) ?
+                cursor->line->prev_line : cursor->lines->last_line;
+        }
+    }
+    else
+        ptr_line = NULL;
+
+    cursor->line = ptr_line;
+    cursor->line_removed = 0;
+
+    return ptr_line;
+}
+
+/*
+ * Updates cursors when a line is removed: a cursor on this line is moved
+ * between the previous and the next line.
+ */
+
+void
+gui_line_cursor_remove_line (struct t_gui_lines *lines,
+                             struct t_gui_line *line)
+{
+    struct t_gui_line_cursor *ptr_cursor;
+
+    for (ptr_cursor = gui_line_cursors; ptr_cursor;
+         ptr_cursor = ptr_cursor->next_cursor)
+    {
+        if ((ptr_cursor->lines == lines) && (ptr_cursor->line == line))
+        {
+            ptr_cursor->line = line->prev_line;
+            ptr_cursor->line_removed = 1;
+        }
+    }
+}
+
+/*
+ * Updates cursors when all lines are removed or freed: cursors on these lines
+ * have no more line to read.
+ */
+
+void
+gui_line_cursor_remove_lines (struct t_gui_lines *lines)
+{
+    struct t_gui_line_cursor *ptr_cursor;
+
+    for (ptr_cursor = gui_line_cursors; ptr_cursor;
+         ptr_cursor = ptr_cursor->next_cursor)
+    {
+        if (ptr_cursor->lines == lines)
+        {
+            ptr_cursor->lines = NULL;
+            ptr_cursor->line = NULL;
+            ptr_cursor->line_removed = 0;
+        }
+    }
+}
+
+/*
+ * Frees a cursor.
+ */
+
+void
+gui_line_cursor_free (struct t_gui_line_cursor *cursor)
+{
+    if (!cursor)
+        return;
+
+    if (cursor->prev_cursor)
+        (cursor->prev_cursor)->next_cursor = cursor->next_cursor;
+    if (cursor->next_cursor)
+        (cursor->next_cursor)->prev_cursor = cursor->prev_cursor;
+    if (gui_line_cursors == cursor)
+        gui_line_cursors = cursor->next_cursor;
+
+    free (cursor);
+}
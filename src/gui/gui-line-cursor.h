@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_GUI_LINE_CURSOR_H
+#define WEECHAT_GUI_LINE_CURSOR_H 1
+
+struct t_gui_line;
+struct t_gui_lines;
+
+/* cursor on lines (used to read lines one by one) */
+
+struct t_gui_line_cursor
+{
+    struct t_gui_lines *lines;         /* lines read (NULL if lines have    */
+                                       /* been freed: no more line to read) */
+    struct t_gui_line *line;           /* current line (NULL if none)       */
+    int line_removed;                  /* 1 if current line was removed:    */
+                                       /* "line" is then the line before    */
+                                       /* it (NULL = before first line)     */
+    struct t_gui_line_cursor *prev_cursor; /* link to previous cursor       */
+    struct t_gui_line_cursor *next_cursor; /* link to next cursor           */
+};
+
+/* cursor functions */
+
+extern struct t_gui_line_cursor *gui_line_cursor_new (struct t_gui_lines *lines);
+extern struct t_gui_line *gui_line_cursor_move (struct t_gui_line_cursor *cursor,
+                                                int direction);
+extern void gui_line_cursor_remove_line (struct t_gui_lines *lines,
+                                         struct t_gui_line *line);
+extern void gui_line_cursor_remove_lines (struct t_gui_lines *lines);
+extern void gui_line_cursor_free (struct t_gui_line_cursor *cursor);
+
+#endif /* WEECHAT_GUI_LINE_CURSOR_H */
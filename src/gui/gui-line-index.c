@@ -0,0 +1,619 @@
+/*
+ * gui-line-index.c - index of lines for text search (used by all GUI)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The index is a hashtable with trigrams of lines (3 consecutive ASCII chars
+ * of prefix or message, without colors and lower case) as keys, and for each
+ * trigram the list of lines containing it, sorted by line id.
+ *
+ * It is built when a search starts in a buffer with many lines, updated when
+ * lines are added or removed, and freed when the search ends. A search uses
+ * the shortest list among the trigrams of searched text (or literal parts of
+ * regex), then checks only these lines with function gui_line_search_text.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/weechat.h"
+#include "../core/wee-config.h"
+#include "../core/wee-hashtable.h"
+#include "../plugins/plugin.h"
+#include "gui-line-index.h"
+#include "gui-buffer.h"
+#include "gui-color.h"
+#include "gui-line.h"
+
+
+/*
+ * Returns lower case of an ASCII char, -1 if char is not ASCII.
+ */
+
+int
+gui_line_index_char (unsigned char c)
+{
+    if (c >= 128)
+        return -1;
+
+    return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+}
+
+/*
+ * Frees a list of lines (callback of hashtable).
+ */
+
+void
+gui_line_index_free_list_cb (struct t_hashtable *hashtable,
+                             const void *key, void *value)
+{
+    struct t_gui_line_index_list *list;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    list = (struct t_gui_line_index_list *)value;
+    if (list)
+    {
+        if (list->lines)
+            free (list->lines);
+        free (list);
+    }
+}
+
+/*
+ * Returns position of first line in list with id greater than or equal to
+ * "id" (list->end if not found).
+ */
+
+int
+gui_line_index_list_lower_bound (struct t_gui_line_index_list *list,
+                                 unsigned long long id)
+{
+    int low, high, middle;
+
+    low = list->start;
+    high = list->end;
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (list->lines[middle]->id < id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/*
+ * Adds a line in list of lines for a trigram.
+ */
+
+void
+gui_line_index_list_add (struct t_hashtable *index, int trigram,
+                         struct t_gui_line *line)
+{
+    struct t_gui_line_index_list *list;
+    struct t_gui_line **new_lines;
+    int pos, new_size;
+
+    list = hashtable_get (index, &trigram);
+    if (!list)
+    {
+        list = malloc (sizeof (*list));
+        if (!list)
+            return;
+        list->lines = NULL;
+        list->start = 0;
+        list->end = 0;
+        list->size = 0;
+        if (!hashtable_set (index, &trigram, list))
+        {
+            free (list);
+            return;
+        }
+    }
+
+    /* usual case: line is added at the end (or has already been added) */
+    if ((list->end == list->start)
+        || (list->lines[list->end - 1]->id < line->id))
+    {
+        pos = list->end;
+    }
+    else
+    {
+        pos = gui_line_index_list_lower_bound (list, line->id);
+        if ((pos < list->end) && (list->lines[pos] == line))
+            return;
+    }
+
+    if (list->end >= list->size)
+    {
+        if (list->start >= list->size / 2)
+        {
+            /* first half of array is unused: move lines to the beginning */
+            memmove (list->lines, list->lines + list->start,
+                     (list->end - list->start) * sizeof (*list->lines));
+            pos -= list->start;
+            list->end -= list->start;
+            list->start = 0;
+        }
+        if (list->end >= list->size)
+        {
+            new_size = (list->size > 0) ? list->size * 2 : 4;
+            new_lines = realloc (list->lines,
+                                 new_size * sizeof (*new_lines));
+            if (!new_lines)
+                return;
+            list->lines = new_lines;
+            list->size = new_size;
+        }
+    }
+
+    if (pos < list->end)
+    {
+        memmove (list->lines + pos + 1, list->lines + pos,
+                 (list->end - pos) * sizeof (*list->lines));
+    }
+    list->lines[pos] = line;
+    list->end++;
+}
+
+/*
+ * Removes a line from list of lines for a trigram.
+ */
+
+void
+gui_line_index_list_remove (struct t_hashtable *index, int trigram,
+                            struct t_gui_line *line)
+{
+    struct t_gui_line_index_list *list;
+    int pos;
+
+    list = hashtable_get (index, &trigram);
+    if (!list)
+        return;
+
+    if (list->lines[list->start] == line)
+    {
+        list->start++;
+    }
+    else if (list->lines[list->end - 1] == line)
+    {
+        list->end--;
+    }
+    else
+    {
+        pos = gui_line_index_list_lower_bound (list, line->id);
+        if ((pos >= list->end) || (list->lines[pos] != line))
+            return;
+        memmove (list->lines + pos, list->lines + pos + 1,
+                 (list->end - pos - 1) * sizeof (*list->lines));
+        list->end--;
+    }
+
+    if (list->start >= list->end)
+        hashtable_remove (index, &trigram);
+}
+
+/*
+ * Adds or removes a line in lists of all trigrams found in a string
+ * (colors are removed from string).
+ */
+
+void
+gui_line_index_string (struct t_hashtable *index, struct t_gui_line *line,
+                       const char *string, int add)
+{
+    char *decoded;
+    const char *ptr_string;
+    int c, trigram, length;
+
+    decoded = gui_color_decode (string, NULL);
+    if (!decoded)
+        return;
+
+    trigram = 0;
+    length = 0;
+    for (ptr_string = decoded; ptr_string[0]; ptr_string++)
+    {
+        c = gui_line_index_char ((unsigned char)ptr_string[0]);
+        if (c < 0)
+        {
+            length = 0;
+            continue;
+        }
+        trigram = ((trigram << 8) | c) & 0xFFFFFF;
+        length++;
+        if (length >= 3)
+        {
+            if (add)
+                gui_line_index_list_add (index, trigram, line);
+            else
+                gui_line_index_list_remove (index, trigram, line);
+        }
+    }
+
+    free (decoded);
+}
+
+/*
+ * Adds a line in index of lines (if the index exists).
+ */
+
+void
+gui_line_index_add_line (struct t_gui_lines *lines, struct t_gui_line *line)
+{
+    if (!lines || !lines->search_index || !line)
+        return;
+
+    if (line->data->prefix)
+        gui_line_index_string (lines->search_index, line, line->data->prefix, 1);
+    if (line->data->message)
+        gui_line_index_string (lines->search_index, line, line->data->message, 1);
+}
+
+/*
+ * Removes a line from index of lines (if the index exists); this must be
+ * called before prefix and message of line are freed.
+ */
+
+void
+gui_line_index_remove_line (struct t_gui_lines *lines,
+                            struct t_gui_line *line)
+{
+    if (!lines || !lines->search_index || !line)
+        return;
+
+    if (line->data->prefix)
+        gui_line_index_string (lines->search_index, line, line->data->prefix, 0);
+    if (line->data->message)
+        gui_line_index_string (lines->search_index, line, line->data->message, 0);
+}
+
+/*
+ * Builds the index of lines displayed in a buffer, if the buffer has at least
+ * N lines (N = option weechat.look.buffer_search_index).
+ */
+
+void
+gui_line_index_build (struct t_gui_buffer *buffer)
+{
+    struct t_gui_lines *lines;
+    struct t_gui_line *ptr_line;
+
+    if (!buffer || (buffer->type != GUI_BUFFER_TYPE_FORMATTED))
+        return;
+
+    lines = buffer->lines;
+    if (lines->search_index
+        || (CONFIG_INTEGER(config_look_buffer_search_index) == 0)
+        || (lines->lines_count < CONFIG_INTEGER(config_look_buffer_search_index)))
+    {
+        return;
+    }
+
+    lines->search_index = hashtable_new (0,
+                                         WEECHAT_HASHTABLE_INTEGER,
+                                         WEECHAT_HASHTABLE_POINTER,
+                                         NULL, NULL);
+    if (!lines->search_index)
+        return;
+    lines->search_index->callback_free_value = &gui_line_index_free_list_cb;
+
+    for (ptr_line = lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        gui_line_index_add_line (lines, ptr_line);
+    }
+}
+
+/*
+ * Searches the shortest list of lines for the trigrams of a literal string
+ * (all trigrams must be found in a line for the string to be found).
+ *
+ * Returns:
+ *   1: string has at least one trigram (*list is updated if a shorter list
+ *      is found, *no_match is set to 1 if a trigram is not in index)
+ *   0: string has no trigram
+ */
+
+int
+gui_line_index_shortest_list (struct t_hashtable *index,
+                              const char *string, int length,
+                              struct t_gui_line_index_list **list,
+                              int *no_match)
+{
+    struct t_gui_line_index_list *ptr_list;
+    int i, c, trigram, count, rc;
+
+    rc = 0;
+    trigram = 0;
+    count = 0;
+    for (i = 0; i < length; i++)
+    {
+        c = gui_line_index_char ((unsigned char)string[i]);
+        if (c < 0)
+        {
+            count = 0;
+            continue;
+        }
+        trigram = ((trigram << 8) | c) & 0xFFFFFF;
+        count++;
+        if (count >= 3)
+        {
+            rc = 1;
+            ptr_list = hashtable_get (index, &trigram);
+            if (!ptr_list)
+            {
+                *no_match = 1;
+                return 1;
+            }
+            if (!*list
+                || (ptr_list->end - ptr_list->start < (*list)->end - (*list)->start))
+            {
+                *list = ptr_list;
+            }
+        }
+    }
+
+    return rc;
+}
+
+/*
+ * Searches the shortest list of lines for the literal parts of a regex
+ * (parts that must be in any string matching the regex).
+ *
+ * Parts inside groups and brackets are ignored, and a char followed by an
+ * optional quantifier is not part of the literal.
+ *
+ * Returns:
+ *   1: regex has at least one literal part with a trigram
+ *   0: regex has no literal part usable with the index
+ */
+
+int
+gui_line_index_regex_shortest_list (struct t_hashtable *index,
+                                    const char *regex,
+                                    struct t_gui_line_index_list **list,
+                                    int *no_match)
+{
+    char *literal;
+    const char *ptr_regex;
+    int length, depth, rc;
+
+    literal = malloc (strlen (regex) + 1);
+    if (!literal)
+        return 0;
+
+    rc = 0;
+    length = 0;
+    depth = 0;
+    ptr_regex = regex;
+    while (ptr_regex[0])
+    {
+        switch (ptr_regex[0])
+        {
+            case '|':
+                if (depth == 0)
+                {
+                    /* alternation: no part is required in matching string */
+                    free (literal);
+                    return 0;
+                }
+                ptr_regex++;
+                break;
+            case '(':
+            case ')':
+                if (gui_line_index_shortest_list (index, literal, length,
+                                                  list, no_match))
+                {
+                    rc = 1;
+                }
+                length = 0;
+                depth += (ptr_regex[0] == '(') ? 1 : ((depth > 0) ? -1 : 0);
+                ptr_regex++;
+                break;
+            case '[':
+                if (gui_line_index_shortest_list (index, literal, length,
+                                                  list, no_match))
+                {
+                    rc = 1;
+                }
+                length = 0;
+                ptr_regex++;
+                if (ptr_regex[0] == '^')
+                    ptr_regex++;
+                if (ptr_regex[0] == ']')
+                    ptr_regex++;
+                while (ptr_regex[0] && (ptr_regex[0] != ']'))
+                {
+                    if ((ptr_regex[0] == '[')
+                        && ((ptr_regex[1] == ':') || (ptr_regex[1] == '=')
+                            || (ptr_regex[1] == '.')))
+                    {
+                        ptr_regex = strchr (ptr_regex + 2, ']');
+                        if (!ptr_regex)
+                            break;
+                    }
+                    ptr_regex++;
+                }
+                if (!ptr_regex)
+                {
+                    free (literal);
+                    return rc;
+                }
+                if (ptr_regex[0])
+                    ptr_regex++;
+                break;
+            case '*':
+            case '?':
+            case '{':
+                /* previous char is optional */
+                if (length > 0)
+                    length--;
+                /* FALLTHROUGH */
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+            case '\\':
+                if (gui_line_index_shortest_list (index, literal, length,
+                                                  list, no_match))
+                {
+                    rc = 1;
+                }
+                length = 0;
+                if (ptr_regex[0] == '{')
+                {
+                    while (ptr_regex[0] && (ptr_regex[0] != '}'))
+                    {
+                        ptr_regex++;
+                    }
+                }
+                else if ((ptr_regex[0] == '\\') && ptr_regex[1])
+                {
+                    ptr_regex++;
+                }
+                if (ptr_regex[0])
+                    ptr_regex++;
+                break;
+            default:
+                if (depth == 0)
+                    literal[length++] = ptr_regex[0];
+                ptr_regex++;
+                break;
+        }
+    }
+
+    if (gui_line_index_shortest_list (index, literal, length,
+                                      list, no_match))
+    {
+        rc = 1;
+    }
+
+    free (literal);
+
+    return rc;
+}
+
+/*
+ * Searches text (input of buffer) in lines of buffer using the index,
+ * starting after (or before if backward is 1) start_line (if start_line is
+ * NULL, search starts at the end of buffer if backward is 1, or at the
+ * beginning of buffer).
+ *
+ * Returns:
+ *   1: index has been used (*line_found is set to the line found, NULL if
+ *      text is not found)
+ *   0: index can not be used for this search (for example if text has less
+ *      than 3 chars), the caller must check all lines
+ */
+
+int
+gui_line_index_search (struct t_gui_buffer *buffer,
+                       struct t_gui_line *start_line, int backward,
+                       struct t_gui_line **line_found)
+{
+    struct t_hashtable *index;
+    struct t_gui_line_index_list *list;
+    struct t_gui_line *ptr_line;
+    int rc, no_match, pos;
+
+    *line_found = NULL;
+
+    index = buffer->lines->search_index;
+    if (!index || !buffer->input_buffer || !buffer->input_buffer[0])
+        return 0;
+
+    list = NULL;
+    no_match = 0;
+    if (buffer->text_search_regex)
+    {
+        rc = gui_line_index_regex_shortest_list (index, buffer->input_buffer,
+                                                 &list, &no_match);
+    }
+    else
+    {
+        rc = gui_line_index_shortest_list (index, buffer->input_buffer,
+                                           strlen (buffer->input_buffer),
+                                           &list, &no_match);
+    }
+
+    if (!rc)
+        return 0;
+
+    if (no_match || !list)
+        return 1;
+
+    if (backward)
+    {
+        pos = (start_line) ?
+            gui_line_index_list_lower_bound (list, start_line->id) : list->end;
+        for (pos--; pos >= list->start; pos--)
+        {
+            ptr_line = list->lines[pos];
+            if (gui_line_is_displayed (ptr_line)
+                && gui_line_search_text (buffer, ptr_line))
+            {
+                *line_found = ptr_line;
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        pos = (start_line) ?
+            gui_line_index_list_lower_bound (list, start_line->id + 1) :
+            list->start;
+        for (; pos < list->end; pos++)
+        {
+            ptr_line = list->lines[pos];
+            if (gui_line_is_displayed (ptr_line)
+                && gui_line_search_text (buffer, ptr_line))
+            {
+                *line_found = ptr_line;
+                return 1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Frees the index of lines.
+ */
+
+void
+gui_line_index_free (struct t_gui_lines *lines)
+{
+    if (!lines || !lines->search_index)
+        return;
+
+    hashtable_free (lines->search_index);
+    lines->search_index = NULL;
+}
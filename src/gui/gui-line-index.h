@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_GUI_LINE_INDEX_H
+#define WEECHAT_GUI_LINE_INDEX_H 1
+
+/* index of lines structures */
+
+struct t_gui_buffer;
+struct t_gui_line;
+struct t_gui_lines;
+
+/*
+ * list of lines containing a trigram, sorted by line id; lines are removed
+ * from the beginning, so the array starts at index "start"
+ */
+
+struct t_gui_line_index_list
+{
+    struct t_gui_line **lines;         /* lines containing the trigram      */
+    int start;                         /* index of first line in array      */
+    int end;                           /* index after last line in array    */
+    int size;                          /* allocated size of array           */
+};
+
+/* index of lines functions */
+
+extern void gui_line_index_build (struct t_gui_buffer *buffer);
+extern void gui_line_index_add_line (struct t_gui_lines *lines,
+                                     struct t_gui_line *line);
+extern void gui_line_index_remove_line (struct t_gui_lines *lines,
+                                        struct t_gui_line *line);
+extern int gui_line_index_search (struct t_gui_buffer *buffer,
+                                  struct t_gui_line *start_line,
+                                  int backward,
+                                  struct t_gui_line **line_found);
+extern void gui_line_index_free (struct t_gui_lines *lines);
+
+#endif /* WEECHAT_GUI_LINE_INDEX_H */
@@ -0,0 +1,533 @@
+/*
+ * gui-line-scroll.c - index of lines for scroll (used by all GUI)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The index is an array with lines that can be a target of scroll (lines
+ * displayed, with a date for a buffer with formatted content), sorted by
+ * line id, so that a scroll by a number of messages is a binary search on id
+ * followed by a move in array.
+ *
+ * For each block of GUI_LINE_SCROLL_BLOCK_SIZE lines in array, the min and
+ * max dates are kept: a scroll by time (like "-1d") skips the blocks where
+ * all lines are too close to the date of start line.
+ *
+ * It is built on first scroll in buffer, updated when lines are added or
+ * removed, and rebuilt on next scroll when lines displayed have changed
+ * (filters).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../core/weechat.h"
+#include "gui-line-scroll.h"
+#include "gui-buffer.h"
+#include "gui-filter.h"
+#include "gui-line.h"
+
+
+/*
+ * Checks if a line can be a target of scroll.
+ *
+ * Returns:
+ *   1: line is indexed
+ *   0: line is not indexed
+ */
+
+int
+gui_line_scroll_line_indexed (struct t_gui_line *line)
+{
+    if (!gui_line_is_displayed (line))
+        return 0;
+
+    return ((line->data->buffer->type != GUI_BUFFER_TYPE_FORMATTED)
+            || (line->data->date != 0)) ? 1 : 0;
+}
+
+/*
+ * Computes min and max dates of a block of lines.
+ */
+
+void
+gui_line_scroll_compute_block (struct t_gui_line_scroll *scroll, int block)
+{
+    int i, first, last;
+    time_t date;
+
+    first = block * GUI_LINE_SCROLL_BLOCK_SIZE;
+    if (first < scroll->start)
+        first = scroll->start;
+    last = (block + 1) * GUI_LINE_SCROLL_BLOCK_SIZE;
+    if (last > scroll->end)
+        last = scroll->end;
+
+    for (i = first; i < last; i++)
+    {
+        date = scroll->lines[i]->data->date;
+        if ((i == first) || (date < scroll->dates_min[block]))
+            scroll->dates_min[block] = date;
+        if ((i == first) || (date > scroll->dates_max[block]))
+            scroll->dates_max[block] = date;
+    }
+}
+
+/*
+ * Adds a line at the end of index.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_line_scroll_append (struct t_gui_line_scroll *scroll,
+                        struct t_gui_line *line)
+{
+    struct t_gui_line **new_lines;
+    time_t *new_dates_min, *new_dates_max, date;
+    int i, pos, block, new_size;
+
+    if (scroll->end >= scroll->size)
+    {
+        if ((scroll->start > 0) && (scroll->start >= scroll->size / 2))
+        {
+            /* first half of array is unused: move lines to the beginning */
+            memmove (scroll->lines, scroll->lines + scroll->start,
+                     (scroll->end - scroll->start) * sizeof (*scroll->lines));
+            scroll->end -= scroll->start;
+            scroll->start = 0;
+            for (i = 0; i * GUI_LINE_SCROLL_BLOCK_SIZE < scroll->end; i++)
+            {
+                gui_line_scroll_compute_block (scroll, i);
+            }
+        }
+        else
+        {
+            new_size = (scroll->size > 0) ?
+                scroll->size * 2 : GUI_LINE_SCROLL_BLOCK_SIZE;
+            new_lines = realloc (scroll->lines,
+                                 new_size * sizeof (*scroll->lines));
+            if (!new_lines)
+                return 0;
+            scroll->lines = new_lines;
+            new_dates_min = realloc (
+                scroll->dates_min,
+                (new_size / GUI_LINE_SCROLL_BLOCK_SIZE) * sizeof (*new_dates_min));
+            if (!new_dates_min)
+                return 0;
+            scroll->dates_min = new_dates_min;
+            new_dates_max = realloc (
+                scroll->dates_max,
+                (new_size / GUI_LINE_SCROLL_BLOCK_SIZE) * sizeof (*new_dates_max));
+            if (!new_dates_max)
+                return 0;
+            scroll->dates_max = new_dates_max;
+            scroll->size = new_size;
+        }
+    }
+
+    pos = scroll->end;
+    block = pos / GUI_LINE_SCROLL_BLOCK_SIZE;
+    date = line->data->date;
+    scroll->lines[pos] = line;
+    if ((pos == scroll->start) || (pos % GUI_LINE_SCROLL_BLOCK_SIZE == 0))
+    {
+        scroll->dates_min[block] = date;
+        scroll->dates_max[block] = date;
+    }
+    else
+    {
+        if (date < scroll->dates_min[block])
+            scroll->dates_min[block] = date;
+        if (date > scroll->dates_max[block])
+            scroll->dates_max[block] = date;
+    }
+    scroll->end++;
+
+    return 1;
+}
+
+/*
+ * Returns index of the first line with id greater than or equal to "id"
+ * ("end" if there is no such line).
+ */
+
+int
+gui_line_scroll_lower_bound (struct t_gui_line_scroll *scroll,
+                             unsigned long long id)
+{
+    int low, high, middle;
+
+    low = scroll->start;
+    high = scroll->end;
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (scroll->lines[middle]->id < id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/*
+ * Builds index of lines for scroll (if it is not already built or if lines
+ * displayed have changed).
+ *
+ * Returns pointer to index, NULL if error or if line ids are not increasing
+ * in list (lines inserted in a buffer with free content).
+ */
+
+struct t_gui_line_scroll *
+gui_line_scroll_build (struct t_gui_lines *lines)
+{
+    struct t_gui_line_scroll *new_scroll;
+    struct t_gui_line *ptr_line;
+
+    if (!lines)
+        return NULL;
+
+    if (lines->scroll_index
+        && (lines->scroll_index->filters_changes == gui_filter_lines_changes))
+    {
+        return lines->scroll_index;
+    }
+
+    gui_line_scroll_free (lines);
+
+    new_scroll = malloc (sizeof (*new_scroll));
+    if (!new_scroll)
+        return NULL;
+    new_scroll->lines = NULL;
+    new_scroll->dates_min = NULL;
+    new_scroll->dates_max = NULL;
+    new_scroll->start = 0;
+    new_scroll->end = 0;
+    new_scroll->size = 0;
+    new_scroll->filters_changes = gui_filter_lines_changes;
+    lines->scroll_index = new_scroll;
+
+    for (ptr_line = lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        if (!gui_line_scroll_line_indexed (ptr_line))
+            continue;
+        if (((new_scroll->end > 0)
+             && (new_scroll->lines[new_scroll->end - 1]->id >= ptr_line->id))
+            || !gui_line_scroll_append (new_scroll, ptr_line))
+        {
+            gui_line_scroll_free (lines);
+            return NULL;
+        }
+    }
+
+    return new_scroll;
+}
+
+/*
+ * Adds a line (at the end of lines) in index, if index is built.
+ */
+
+void
+gui_line_scroll_add_line (struct t_gui_lines *lines, struct t_gui_line *line)
+{
+    struct t_gui_line_scroll *ptr_scroll;
+
+    ptr_scroll = lines->scroll_index;
+    if (!ptr_scroll || !gui_line_scroll_line_indexed (line))
+        return;
+
+    if ((ptr_scroll->filters_changes != gui_filter_lines_changes)
+        || ((ptr_scroll->end > ptr_scroll->start)
+            && (ptr_scroll->lines[ptr_scroll->end - 1]->id >= line->id))
+        || !gui_line_scroll_append (ptr_scroll, line))
+    {
+        gui_line_scroll_free (lines);
+    }
+}
+
+/*
+ * Removes a line from index, if index is built.
+ *
+ * Lines are usually removed at the beginning of index; if a line is removed
+ * in the middle, the index is freed (it will be built again on next scroll).
+ */
+
+void
+gui_line_scroll_remove_line (struct t_gui_lines *lines,
+                             struct t_gui_line *line)
+{
+    struct t_gui_line_scroll *ptr_scroll;
+
+    ptr_scroll = lines->scroll_index;
+    if (!ptr_scroll || (ptr_scroll->start >= ptr_scroll->end))
+        return;
+
+    if (ptr_scroll->lines[ptr_scroll->start] == line)
+        ptr_scroll->start++;
+    else if (ptr_scroll->lines[ptr_scroll->end - 1] == line)
+        ptr_scroll->end--;
+    else if ((ptr_scroll->filters_changes != gui_filter_lines_changes)
+             || gui_line_scroll_line_indexed (line))
+        gui_line_scroll_free (lines);
+}
+
+/*
+ * Returns difference between dates to stop scroll (in seconds) for a time
+ * letter and number, 0 if the scroll is not by a duration.
+ */
+
+time_t
+gui_line_scroll_date_delta (char time_letter, long number)
+{
+    if (number == 0)
+        return 0;
+
+    switch (time_letter)
+    {
+        case 's': /* seconds */
+            return number;
+        case 'm': /* minutes */
+            return number * 60;
+        case 'h': /* hours */
+            return number * 60 * 60;
+        case 'd': /* days */
+            return number * 60 * 60 * 24;
+        case 'M': /* months */
+            /*
+             * we consider month is 30 days, who will notice
+             * I'm too lazy to code exact date diff ? ;)
+             */
+            return number * 60 * 60 * 24 * 30;
+        case 'y': /* years */
+            /*
+             * we consider year is 365 days, who will notice
+             * I'm too lazy to code exact date diff ? ;)
+             */
+            return number * 60 * 60 * 24 * 365;
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if scroll by time stops on a line with date "date", starting from a
+ * line with date "old_date" ("old_line_date" is the local time of this date).
+ *
+ * If "number" is 0, the scroll stops on the first line with a different
+ * unit (second, minute, ...), otherwise on the first line with a difference
+ * of at least "number" units.
+ *
+ * Returns:
+ *   1: scroll stops on line
+ *   0: scroll continues
+ *  -1: error
+ */
+
+int
+gui_line_scroll_date_stop (char time_letter, long number, time_t old_date,
+                           struct tm *old_line_date, time_t date)
+{
+    struct tm *date_tmp, line_date;
+    time_t delta, diff_date;
+
+    if (number > 0)
+    {
+        delta = gui_line_scroll_date_delta (time_letter, number);
+        if (delta == 0)
+            return 0;
+        diff_date = (old_date > date) ? old_date - date : date - old_date;
+        return (diff_date >= delta) ? 1 : 0;
+    }
+
+    date_tmp = localtime (&date);
+    if (!date_tmp)
+        return -1;
+    memcpy (&line_date, date_tmp, sizeof (struct tm));
+
+    switch (time_letter)
+    {
+        case 's': /* stop if line has different second */
+            if (line_date.tm_sec != old_line_date->tm_sec)
+                return 1;
+            break;
+        case 'm': /* stop if line has different minute */
+            if ((line_date.tm_min != old_line_date->tm_min)
+                || (line_date.tm_hour != old_line_date->tm_hour)
+                || (line_date.tm_mday != old_line_date->tm_mday)
+                || (line_date.tm_mon != old_line_date->tm_mon)
+                || (line_date.tm_year != old_line_date->tm_year))
+                return 1;
+            break;
+        case 'h': /* stop if line has different hour */
+            if ((line_date.tm_hour != old_line_date->tm_hour)
+                || (line_date.tm_mday != old_line_date->tm_mday)
+                || (line_date.tm_mon != old_line_date->tm_mon)
+                || (line_date.tm_year != old_line_date->tm_year))
+                return 1;
+            break;
+        case 'd': /* stop if line has different day */
+            if ((line_date.tm_mday != old_line_date->tm_mday)
+                || (line_date.tm_mon != old_line_date->tm_mon)
+                || (line_date.tm_year != old_line_date->tm_year))
+                return 1;
+            break;
+        case 'M': /* stop if line has different month */
+            if ((line_date.tm_mon != old_line_date->tm_mon)
+                || (line_date.tm_year != old_line_date->tm_year))
+                return 1;
+            break;
+        case 'y': /* stop if line has different year */
+            if (line_date.tm_year != old_line_date->tm_year)
+                return 1;
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Searches line to scroll to, from line "start_line" (if NULL: from last
+ * line if direction is < 0, otherwise from first line), by a number of
+ * messages (if "time_letter" is ' ') or by time.
+ *
+ * Returns:
+ *   1: line found (in *line_found)
+ *   0: line not found (scroll goes beyond first or last line)
+ *  -1: error
+ */
+
+int
+gui_line_scroll_search (struct t_gui_line_scroll *scroll,
+                        struct t_gui_line *start_line,
+                        int direction, long number, char time_letter,
+                        struct t_gui_line **line_found)
+{
+    struct tm *date_tmp, old_line_date;
+    time_t old_date, delta;
+    int pos, block, rc;
+
+    if (!scroll || !line_found)
+        return -1;
+
+    *line_found = NULL;
+
+    /* search index of start line */
+    if (direction < 0)
+    {
+        pos = (start_line) ?
+            gui_line_scroll_lower_bound (scroll, start_line->id + 1) - 1 :
+            scroll->end - 1;
+    }
+    else
+    {
+        pos = (start_line) ?
+            gui_line_scroll_lower_bound (scroll, start_line->id) :
+            scroll->start;
+    }
+    if ((pos < scroll->start) || (pos >= scroll->end))
+        return 0;
+
+    /* scroll by number of messages */
+    if (time_letter == ' ')
+    {
+        if (direction < 0)
+        {
+            if (number > pos - scroll->start)
+                return 0;
+            pos -= number;
+        }
+        else
+        {
+            if (number >= scroll->end - pos)
+                return 0;
+            pos += number;
+        }
+        *line_found = scroll->lines[pos];
+        return 1;
+    }
+
+    /* scroll by time */
+    old_date = scroll->lines[pos]->data->date;
+    date_tmp = localtime (&old_date);
+    if (!date_tmp)
+        return -1;
+    memcpy (&old_line_date, date_tmp, sizeof (struct tm));
+    delta = gui_line_scroll_date_delta (time_letter, number);
+
+    pos += direction;
+    while ((pos >= scroll->start) && (pos < scroll->end))
+    {
+        /* skip block if all its lines are too close to start date */
+        block = pos / GUI_LINE_SCROLL_BLOCK_SIZE;
+        if ((delta > 0)
+            && (pos % GUI_LINE_SCROLL_BLOCK_SIZE ==
+                ((direction < 0) ? GUI_LINE_SCROLL_BLOCK_SIZE - 1 : 0))
+            && (old_date - scroll->dates_min[block] < delta)
+            && (scroll->dates_max[block] - old_date < delta))
+        {
+            pos = (direction < 0) ?
+                (block * GUI_LINE_SCROLL_BLOCK_SIZE) - 1 :
+                (block + 1) * GUI_LINE_SCROLL_BLOCK_SIZE;
+            continue;
+        }
+        rc = gui_line_scroll_date_stop (time_letter, number, old_date,
+                                        &old_line_date,
+                                        scroll->lines[pos]->data->date);
+        if (rc < 0)
+            return -1;
+        if (rc)
+        {
+            *line_found = scroll->lines[pos];
+            return 1;
+        }
+        pos += direction;
+    }
+
+    return 0;
+}
+
+/*
+ * Frees index of lines for scroll.
+ */
+
+void
+gui_line_scroll_free (struct t_gui_lines *lines)
+{
+    if (!lines || !lines->scroll_index)
+        return;
+
+    if (lines->scroll_index->lines)
+        free (lines->scroll_index->lines);
+    if (lines->scroll_index->dates_min)
+        free (lines->scroll_index->dates_min);
+    if (lines->scroll_index->dates_max)
+        free (lines->scroll_index->dates_max);
+    free (lines->scroll_index);
+    lines->scroll_index = NULL;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_GUI_LINE_SCROLL_H
+#define WEECHAT_GUI_LINE_SCROLL_H 1
+
+#include <time.h>
+
+#define GUI_LINE_SCROLL_BLOCK_SIZE 256
+
+/* index of lines for scroll structures */
+
+struct t_gui_line;
+struct t_gui_lines;
+
+/*
+ * lines displayed, sorted by line id; lines are removed from the beginning,
+ * so the array starts at index "start"; for each block of
+ * GUI_LINE_SCROLL_BLOCK_SIZE lines in array, the min and max dates are kept
+ * (they can include lines removed from array)
+ */
+
+struct t_gui_line_scroll
+{
+    struct t_gui_line **lines;         /* lines displayed                   */
+    time_t *dates_min;                 /* min date for each block of lines  */
+    time_t *dates_max;                 /* max date for each block of lines  */
+    int start;                         /* index of first line in array      */
+    int end;                           /* index after last line in array    */
+    int size;                          /* allocated size of array           */
+                                       /* (multiple of block size)          */
+    int filters_changes;               /* changes of lines displayed when   */
+                                       /* index was built (see gui-filter.c)*/
+};
+
+/* index of lines for scroll functions */
+
+extern struct t_gui_line_scroll *gui_line_scroll_build (struct t_gui_lines *lines);
+extern void gui_line_scroll_add_line (struct t_gui_lines *lines,
+                                      struct t_gui_line *line);
+extern void gui_line_scroll_remove_line (struct t_gui_lines *lines,
+                                         struct t_gui_line *line);
+extern int gui_line_scroll_date_stop (char time_letter, long number,
+                                      time_t old_date,
+                                      struct tm *old_line_date,
+                                      time_t date);
+extern int gui_line_scroll_search (struct t_gui_line_scroll *scroll,
+                                   struct t_gui_line *start_line,
+                                   int direction, long number,
+                                   char time_letter,
+                                   struct t_gui_line **line_found);
+extern void gui_line_scroll_free (struct t_gui_lines *lines);
+
+#endif /* WEECHAT_GUI_LINE_SCROLL_H */
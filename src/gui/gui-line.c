@@ -34,11 +34,17 @@
 #include "../core/wee-hdata.h"
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
+#include "../core/wee-latency.h"
 #include "../core/wee-log.h"
 #include "../core/wee-string.h"
+#include "../core/wee-trace.h"
 #include "../plugins/plugin.h"
 #include "gui-line.h"
 #include "gui-buffer.h"
+#include "gui-line-cold.h"
+#include "gui-line-cursor.h"
+#include "gui-line-index.h"
+#include "gui-line-scroll.h"
 #include "gui-chat.h"
 #include "gui-color.h"
 #include "gui-filter.h"
@@ -47,6 +53,23 @@
 #include "gui-window.h"
 
 
+struct t_gui_lines_detached *gui_lines_detached = NULL; /* lines to free   */
+int gui_lines_detached_count = 0;      /* number of lines to free           */
+long gui_line_data_next_id = 1;        /* id for next line data created     */
+
+char *gui_line_tags_known[GUI_LINE_NUM_TAGS] =
+{ "irc_action", "irc_ctcp", "irc_join", "irc_kick", "irc_mode", "irc_nick",
+  "irc_notice", "irc_part", "irc_privmsg", "irc_quit", "irc_smart_filter",
+  "irc_topic", "log0", "log1", "log2", "log3", "log4", "log5", "log6", "log7",
+  "log8", "log9", "no_filter", "no_highlight", "no_log", "notify_highlight",
+  "notify_message", "notify_none", "notify_private", "self_msg",
+};
+
+#ifdef HAVE_TRACEPOINTS
+TRACE_SEMAPHORE(gui_line_add);
+#endif /* HAVE_TRACEPOINTS */
+
+
 /*
  * Allocates structure "t_gui_lines" and initializes it.
  *
@@ -71,11 +94,268 @@ gui_lines_alloc ()
         new_lines->buffer_max_length_refresh = 0;
         new_lines->prefix_max_length = CONFIG_INTEGER(config_look_prefix_align_min);
         new_lines->prefix_max_length_refresh = 0;
+        new_lines->prefix_lengths = NULL;
+        new_lines->prefix_lengths_size = 0;
+        new_lines->prefix_lengths_max = -1;
+        new_lines->chunks = NULL;
+        new_lines->chunks_count = 0;
+        new_lines->chunks_size = 0;
+        new_lines->first_slot = 0;
+        new_lines->holes = 0;
+        new_lines->unordered = 0;
+        new_lines->next_line_id = 0;
+        new_lines->lines_removed = 0;
+        new_lines->search_index = NULL;
+        new_lines->scroll_index = NULL;
     }
 
     return new_lines;
 }
 
+/*
+ * Allocates a line in the chunks of a "t_gui_lines" structure (the line is
+ * not added in the list of lines).
+ *
+ * Lines are allocated in chunks of GUI_LINES_CHUNK_SIZE lines, so that
+ * consecutive lines are contiguous in memory and that a line can be found by
+ * its index without walking the list (see function gui_lines_get_line).
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_gui_line *
+gui_lines_alloc_line (struct t_gui_lines *lines)
+{
+    struct t_gui_line_chunk *ptr_chunk, **new_chunks;
+    struct t_gui_line *new_line;
+    int new_size;
+
+    if (!lines)
+        return NULL;
+
+    ptr_chunk = (lines->chunks_count > 0) ?
+        lines->chunks[lines->chunks_count - 1] : NULL;
+
+    if (!ptr_chunk || (ptr_chunk->used >= GUI_LINES_CHUNK_SIZE))
+    {
+        if (lines->chunks_count >= lines->chunks_size)
+        {
+            new_size = (lines->chunks_size > 0) ? lines->chunks_size * 2 : 4;
+            new_chunks = realloc (lines->chunks,
+                                  new_size * sizeof (*new_chunks));
+            if (!new_chunks)
+                return NULL;
+            lines->chunks = new_chunks;
+            lines->chunks_size = new_size;
+        }
+        ptr_chunk = malloc (sizeof (*ptr_chunk));
+        if (!ptr_chunk)
+            return NULL;
+        ptr_chunk->used = 0;
+        ptr_chunk->count = 0;
+        lines->chunks[lines->chunks_count] = ptr_chunk;
+        lines->chunks_count++;
+        if (lines->chunks_count == 1)
+            lines->first_slot = 0;
+    }
+
+    new_line = &(ptr_chunk->lines[ptr_chunk->used]);
+    new_line->data = NULL;
+    new_line->prev_line = NULL;
+    new_line->next_line = NULL;
+    new_line->chunk = ptr_chunk;
+    new_line->id = lines->next_line_id++;
+    new_line->layout_generation = 0;
+    new_line->layout_width = 0;
+    new_line->layout_align = 0;
+    new_line->layout_lines = 0;
+    new_line->prefix_length_counted = -1;
+    ptr_chunk->used++;
+    ptr_chunk->count++;
+
+    return new_line;
+}
+
+/*
+ * Removes a chunk from a "t_gui_lines" structure and frees it.
+ */
+
+void
+gui_lines_free_chunk (struct t_gui_lines *lines, int index)
+{
+    free (lines->chunks[index]);
+    if (index < lines->chunks_count - 1)
+    {
+        memmove (&lines->chunks[index], &lines->chunks[index + 1],
+                 (lines->chunks_count - index - 1) * sizeof (*lines->chunks));
+    }
+    lines->chunks_count--;
+}
+
+/*
+ * Frees a line allocated by function gui_lines_alloc_line (the line must
+ * have been removed from the list of lines before this call).
+ *
+ * Holes between the first and the last line are kept until the whole chunk
+ * is free, then the chunk is freed.
+ */
+
+void
+gui_lines_free_line (struct t_gui_lines *lines, struct t_gui_line *line)
+{
+    struct t_gui_line_chunk *ptr_chunk;
+    int i, start, last;
+
+    if (!lines || !line)
+        return;
+
+    ptr_chunk = line->chunk;
+    line->data = NULL;
+    line->prev_line = NULL;
+    line->next_line = NULL;
+    ptr_chunk->count--;
+
+    /* search chunk (usually the first one: oldest lines are removed) */
+    if (lines->chunks[0] == ptr_chunk)
+    {
+        i = 0;
+    }
+    else
+    {
+        for (i = lines->chunks_count - 1; i > 0; i--)
+        {
+            if (lines->chunks[i] == ptr_chunk)
+                break;
+        }
+    }
+    last = (i == lines->chunks_count - 1);
+    start = (i == 0) ? lines->first_slot : 0;
+
+    if (ptr_chunk->count == 0)
+    {
+        /* the chunk is empty: remove its holes and free it */
+        lines->holes -= ptr_chunk->used - start - 1;
+        gui_lines_free_chunk (lines, i);
+        if (lines->chunks_count == 0)
+        {
+            lines->first_slot = 0;
+            lines->holes = 0;
+            lines->unordered = 0;
+            return;
+        }
+        if (i == 0)
+        {
+            /* skip removed lines at beginning of new first chunk */
+            lines->first_slot = 0;
+            ptr_chunk = lines->chunks[0];
+            while ((lines->first_slot < ptr_chunk->used)
+                   && !ptr_chunk->lines[lines->first_slot].data)
+            {
+                lines->first_slot++;
+                lines->holes--;
+            }
+        }
+        else if (last)
+        {
+            /* skip removed lines at end of new last chunk */
+            ptr_chunk = lines->chunks[lines->chunks_count - 1];
+            while ((ptr_chunk->used > 0)
+                   && !ptr_chunk->lines[ptr_chunk->used - 1].data)
+            {
+                ptr_chunk->used--;
+                lines->holes--;
+            }
+        }
+    }
+    else if ((i == 0) && (line == &(ptr_chunk->lines[start])))
+    {
+        /* first line removed: skip removed lines after it */
+        lines->first_slot++;
+        while ((lines->first_slot < ptr_chunk->used)
+               && !ptr_chunk->lines[lines->first_slot].data)
+        {
+            lines->first_slot++;
+            lines->holes--;
+        }
+    }
+    else if (last && (line == &(ptr_chunk->lines[ptr_chunk->used - 1])))
+    {
+        /* last line removed: reuse its slot and removed lines before it */
+        ptr_chunk->used--;
+        while ((ptr_chunk->used > start)
+               && !ptr_chunk->lines[ptr_chunk->used - 1].data)
+        {
+            ptr_chunk->used--;
+            lines->holes--;
+        }
+    }
+    else
+    {
+        lines->holes++;
+    }
+}
+
+/*
+ * Gets line by index (0 = first line).
+ *
+ * If lines are contiguous in chunks (no line removed in the middle and no
+ * line inserted before another), the line is found in constant time,
+ * otherwise the chunks (or the list of lines) are walked.
+ *
+ * Returns pointer to line found, NULL if not found.
+ */
+
+struct t_gui_line *
+gui_lines_get_line (struct t_gui_lines *lines, int index)
+{
+    struct t_gui_line_chunk *ptr_chunk;
+    struct t_gui_line *ptr_line;
+    int i, j, slot, start;
+
+    if (!lines || (index < 0) || (index >= lines->lines_count))
+        return NULL;
+
+    if (lines->unordered || (lines->chunks_count == 0))
+    {
+        for (ptr_line = lines->first_line; ptr_line && (index > 0);
+             ptr_line = ptr_line->next_line)
+        {
+            index--;
+        }
+        return ptr_line;
+    }
+
+    if (lines->holes == 0)
+    {
+        /* all chunks except the last one are full */
+        slot = lines->first_slot + index;
+        return &(lines->chunks[slot / GUI_LINES_CHUNK_SIZE]->lines[slot % GUI_LINES_CHUNK_SIZE]);
+    }
+
+    for (i = 0; i < lines->chunks_count; i++)
+    {
+        ptr_chunk = lines->chunks[i];
+        if (index >= ptr_chunk->count)
+        {
+            index -= ptr_chunk->count;
+            continue;
+        }
+        start = (i == 0) ? lines->first_slot : 0;
+        for (j = start; j < ptr_chunk->used; j++)
+        {
+            if (ptr_chunk->lines[j].data)
+            {
+                if (index == 0)
+                    return &(ptr_chunk->lines[j]);
+                index--;
+            }
+        }
+        break;
+    }
+
+    return NULL;
+}
+
 /*
  * Frees a "t_gui_lines" structure.
  */
@@ -83,9 +363,296 @@ gui_lines_alloc ()
 void
 gui_lines_free (struct t_gui_lines *lines)
 {
+    int i;
+
+    if (!lines)
+        return;
+
+    gui_line_cursor_remove_lines (lines);
+    gui_line_index_free (lines);
+    gui_line_scroll_free (lines);
+
+    for (i = 0; i < lines->chunks_count; i++)
+    {
+        free (lines->chunks[i]);
+    }
+    if (lines->chunks)
+        free (lines->chunks);
+    if (lines->prefix_lengths)
+        free (lines->prefix_lengths);
+
     free (lines);
 }
 
+/*
+ * Checks if a pointer is inside the block allocated for a line data (line
+ * data, tags array, time and message are allocated in a single block by
+ * function gui_line_add).
+ *
+ * Returns:
+ *   1: pointer is inside the block
+ *   0: pointer is not inside the block (allocated separately)
+ */
+
+int
+gui_line_data_in_block (struct t_gui_line_data *line_data, const void *pointer)
+{
+    return (pointer
+            && (line_data->block_size > 0)
+            && ((const char *)pointer >= (const char *)line_data)
+            && ((const char *)pointer < (const char *)line_data + line_data->block_size)) ?
+        1 : 0;
+}
+
+/*
+ * Frees a string in a line data (time or message) and sets it to NULL.
+ *
+ * The string is freed only if it was allocated separately (not in the block
+ * of line data).
+ */
+
+void
+gui_line_data_free_string (struct t_gui_line_data *line_data, char **string)
+{
+    if (*string && !gui_line_data_in_block (line_data, *string))
+        free (*string);
+    *string = NULL;
+}
+
+/*
+ * Frees runs of text of message in a line data.
+ *
+ * The runs are freed only if they were allocated separately (not in the block
+ * of line data).
+ */
+
+void
+gui_line_data_free_message_runs (struct t_gui_line_data *line_data)
+{
+    if (line_data->message_runs
+        && !gui_line_data_in_block (line_data, line_data->message_runs))
+    {
+        free (line_data->message_runs);
+    }
+    line_data->message_runs = NULL;
+    line_data->message_runs_count = -1;
+}
+
+/*
+ * Builds runs of text of message in a line data (called when the message is
+ * changed after the line data has been allocated).
+ */
+
+void
+gui_line_data_build_message_runs (struct t_gui_line_data *line_data)
+{
+    int runs_count;
+
+    gui_line_data_free_message_runs (line_data);
+
+    if (!line_data->message)
+        return;
+
+    runs_count = gui_color_get_runs (line_data->message, NULL, 0);
+    if (runs_count > 0)
+    {
+        line_data->message_runs = malloc (
+            runs_count * sizeof (line_data->message_runs[0]));
+        if (!line_data->message_runs)
+            return;
+        gui_color_get_runs (line_data->message, line_data->message_runs,
+                            runs_count);
+    }
+    line_data->message_runs_count = runs_count;
+}
+
+/*
+ * Returns message of a line data without color codes, using the runs of text
+ * built when the message was set (if they are not available, the color codes
+ * are removed from message).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+gui_line_data_get_message_no_color (struct t_gui_line_data *line_data)
+{
+    if (!line_data || !line_data->message)
+        return NULL;
+
+    if (line_data->message_runs_count >= 0)
+    {
+        return gui_color_decode_runs (line_data->message,
+                                      line_data->message_runs,
+                                      line_data->message_runs_count);
+    }
+
+    return gui_color_decode (line_data->message, NULL);
+}
+
+/*
+ * Searches a well-known tag (case insensitive).
+ *
+ * Returns index of tag in enum t_gui_line_tag, -1 if tag is not a well-known
+ * tag.
+ */
+
+int
+gui_line_tags_get_known (const char *tag)
+{
+    int low, high, middle, rc;
+
+    if (!tag)
+        return -1;
+
+    low = 0;
+    high = GUI_LINE_NUM_TAGS - 1;
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+        rc = string_strcasecmp (tag, gui_line_tags_known[middle]);
+        if (rc == 0)
+            return middle;
+        if (rc < 0)
+            high = middle - 1;
+        else
+            low = middle + 1;
+    }
+
+    /* tag not found */
+    return -1;
+}
+
+/*
+ * Computes mask of well-known tags in a line_data.
+ */
+
+void
+gui_line_tags_compute_mask (struct t_gui_line_data *line_data)
+{
+    int i, tag;
+
+    line_data->tags_mask = 0;
+    for (i = 0; i < line_data->tags_count; i++)
+    {
+        tag = gui_line_tags_get_known (line_data->tags_array[i]);
+        if (tag >= 0)
+            line_data->tags_mask |= GUI_LINE_TAG_BIT(tag);
+    }
+}
+
+/*
+ * Allocates a line data in a single block, with tags array, time and message
+ * stored after the structure (tags are shared strings).
+ *
+ * Returns pointer to new line data, NULL if error.
+ */
+
+struct t_gui_line_data *
+gui_line_data_alloc (time_t date, const char *tags, const char *message)
+{
+    struct t_gui_line_data *new_line_data;
+    struct t_string_slice slices_buffer[16], *slices;
+    const char *str_time;
+    char *ptr_block, str_tag[256], *tag;
+    int i, tags_count, length_tags, length_runs, length_time, length_message;
+    int runs_count, size;
+
+    str_time = gui_chat_get_time_string_cached (date);
+
+    tags_count = 0;
+    slices = string_split_slices (tags, ",", 0, 0, slices_buffer,
+                                  sizeof (slices_buffer) / sizeof (slices_buffer[0]),
+                                  &tags_count);
+    if (!slices)
+        tags_count = 0;
+
+    runs_count = gui_color_get_runs (message, NULL, 0);
+
+    length_tags = (tags_count > 0) ? (tags_count + 1) * sizeof (char *) : 0;
+    length_runs = runs_count * sizeof (struct t_gui_color_run);
+    length_time = (str_time) ? strlen (str_time) + 1 : 0;
+    length_message = (message) ? strlen (message) + 1 : 1;
+    size = sizeof (*new_line_data) + length_tags + length_runs + length_time
+        + length_message;
+
+    new_line_data = malloc (size);
+    if (!new_line_data)
+    {
+        if (slices && (slices != slices_buffer))
+            free (slices);
+        return NULL;
+    }
+    new_line_data->block_size = size;
+    new_line_data->mixed_line = NULL;
+    new_line_data->cold_size = 0;
+    ptr_block = (char *)(new_line_data + 1);
+
+    /* tags */
+    new_line_data->tags_count = tags_count;
+    new_line_data->tags_array = NULL;
+    if (tags_count > 0)
+    {
+        new_line_data->tags_array = (char **)ptr_block;
+        for (i = 0; i < tags_count; i++)
+        {
+            if (slices[i].length < (int)sizeof (str_tag))
+            {
+                memcpy (str_tag, tags + slices[i].offset, slices[i].length);
+                str_tag[slices[i].length] = '\0';
+                tag = str_tag;
+            }
+            else
+            {
+                tag = string_strndup (tags + slices[i].offset,
+                                      slices[i].length);
+            }
+            new_line_data->tags_array[i] = (tag) ?
+                (char *)string_shared_get (tag) : NULL;
+            if (tag && (tag != str_tag))
+                free (tag);
+        }
+        new_line_data->tags_array[tags_count] = NULL;
+        ptr_block += length_tags;
+    }
+    gui_line_tags_compute_mask (new_line_data);
+
+    /* runs of text in message (filled when message is copied) */
+    new_line_data->message_runs_count = runs_count;
+    new_line_data->message_runs = NULL;
+    if (runs_count > 0)
+    {
+        new_line_data->message_runs = (struct t_gui_color_run *)ptr_block;
+        ptr_block += length_runs;
+    }
+
+    /* time */
+    new_line_data->str_time = NULL;
+    if (str_time)
+    {
+        memcpy (ptr_block, str_time, length_time);
+        new_line_data->str_time = ptr_block;
+        ptr_block += length_time;
+    }
+
+    /* message */
+    if (message)
+        memcpy (ptr_block, message, length_message);
+    else
+        ptr_block[0] = '\0';
+    new_line_data->message = ptr_block;
+    if (runs_count > 0)
+    {
+        gui_color_get_runs (new_line_data->message,
+                            new_line_data->message_runs, runs_count);
+    }
+
+    if (slices && (slices != slices_buffer))
+        free (slices);
+
+    return new_line_data;
+}
+
 /*
  * Allocates array with tags in a line_data.
  */
@@ -103,6 +670,7 @@ gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
         line_data->tags_count = 0;
         line_data->tags_array = NULL;
     }
+    gui_line_tags_compute_mask (line_data);
 }
 
 /*
@@ -112,12 +680,116 @@ gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
 void
 gui_line_tags_free (struct t_gui_line_data *line_data)
 {
+    int i;
+
     if (line_data->tags_array)
     {
-        string_free_split_shared (line_data->tags_array);
+        if (gui_line_data_in_block (line_data, line_data->tags_array))
+        {
+            /* array is in block of line data: free only the shared tags */
+            for (i = 0; i < line_data->tags_count; i++)
+            {
+                if (line_data->tags_array[i])
+                    string_shared_free (line_data->tags_array[i]);
+            }
+        }
+        else
+        {
+            string_free_split_shared (line_data->tags_array);
+        }
         line_data->tags_count = 0;
         line_data->tags_array = NULL;
     }
+    line_data->tags_mask = 0;
+}
+
+/*
+ * Frees a line data (with time, tags, prefix and message).
+ */
+
+void
+gui_line_data_free (struct t_gui_line_data *line_data)
+{
+    gui_line_data_free_string (line_data, &line_data->str_time);
+    gui_line_tags_free (line_data);
+    if (line_data->prefix)
+        string_shared_free (line_data->prefix);
+    gui_line_data_free_message_runs (line_data);
+    gui_line_data_free_string (line_data, &line_data->message);
+    free (line_data);
+}
+
+/*
+ * Returns memory used by a line data (in bytes): structure, tags array, runs
+ * of message, time and message.
+ *
+ * Note: shared strings (tags and prefix) are not counted.
+ */
+
+long
+gui_line_data_get_memory (struct t_gui_line_data *line_data)
+{
+    long size;
+
+    if (!line_data)
+        return 0;
+
+    size = (line_data->block_size > 0) ?
+        line_data->block_size : (long)sizeof (*line_data);
+
+    if (line_data->tags_array
+        && !gui_line_data_in_block (line_data, line_data->tags_array))
+    {
+        size += (line_data->tags_count + 1) * sizeof (char *);
+    }
+    if (line_data->message_runs
+        && !gui_line_data_in_block (line_data, line_data->message_runs))
+    {
+        size += line_data->message_runs_count * sizeof (struct t_gui_color_run);
+    }
+    if (line_data->str_time
+        && !gui_line_data_in_block (line_data, line_data->str_time))
+    {
+        size += strlen (line_data->str_time) + 1;
+    }
+    if (line_data->message
+        && !gui_line_data_in_block (line_data, line_data->message))
+    {
+        size += strlen (line_data->message) + 1;
+    }
+
+    return size;
+}
+
+/*
+ * Returns memory used by lines (in bytes).
+ *
+ * If with_data == 1, the data of lines is counted (own lines of a buffer),
+ * otherwise only the lines are counted (mixed lines, which share data with
+ * own lines of merged buffers).
+ */
+
+long
+gui_lines_get_memory (struct t_gui_lines *lines, int with_data)
+{
+    struct t_gui_line *ptr_line;
+    long size;
+
+    if (!lines)
+        return 0;
+
+    size = sizeof (*lines) + (lines->lines_count * sizeof (struct t_gui_line));
+
+    if (with_data)
+    {
+        for (ptr_line = lines->first_line; ptr_line;
+             ptr_line = ptr_line->next_line)
+        {
+            size += gui_line_data_get_memory (ptr_line->data);
+        }
+    }
+
+    return size;
 }
 
 /*
@@ -455,8 +1127,8 @@ gui_line_search_text (struct t_gui_buffer *buffer, struct t_gui_line *line)
             {
                 if (buffer->text_search_regex_compiled)
                 {
-                    if (regexec (buffer->text_search_regex_compiled,
-                                 prefix, 0, NULL, 0) == 0)
+                    if (string_regexec (buffer->text_search_regex_compiled,
+                                        prefix, 0, NULL, 0) == 0)
                     {
                         rc = 1;
                     }
@@ -475,15 +1147,15 @@ gui_line_search_text (struct t_gui_buffer *buffer, struct t_gui_line *line)
 
     if (!rc && (buffer->text_search_where & GUI_TEXT_SEARCH_IN_MESSAGE))
     {
-        message = gui_color_decode (line->data->message, NULL);
+        message = gui_line_data_get_message_no_color (line->data);
         if (message)
         {
             if (buffer->text_search_regex)
             {
                 if (buffer->text_search_regex_compiled)
                 {
-                    if (regexec (buffer->text_search_regex_compiled,
-                                 message, 0, NULL, 0) == 0)
+                    if (string_regexec (buffer->text_search_regex_compiled,
+                                        message, 0, NULL, 0) == 0)
                     {
                         rc = 1;
                     }
@@ -531,7 +1203,8 @@ gui_line_match_regex (struct t_gui_line_data *line_data, regex_t *regex_prefix,
     {
         prefix = gui_color_decode (line_data->prefix, NULL);
         if (!prefix
-            || (regex_prefix && (regexec (regex_prefix, prefix, 0, NULL, 0) != 0)))
+            || (regex_prefix
+                && (string_regexec (regex_prefix, prefix, 0, NULL, 0) != 0)))
             match_prefix = 0;
     }
     else
@@ -542,9 +1215,10 @@ gui_line_match_regex (struct t_gui_line_data *line_data, regex_t *regex_prefix,
 
     if (line_data->message)
     {
-        message = gui_color_decode (line_data->message, NULL);
+        message = gui_line_data_get_message_no_color (line_data);
         if (!message
-            || (regex_message && (regexec (regex_message, message, 0, NULL, 0) != 0)))
+            || (regex_message
+                && (string_regexec (regex_message, message, 0, NULL, 0) != 0)))
             match_message = 0;
     }
     else
@@ -573,21 +1247,18 @@ gui_line_match_regex (struct t_gui_line_data *line_data, regex_t *regex_prefix,
 int
 gui_line_has_tag_no_filter (struct t_gui_line_data *line_data)
 {
-    int i;
-
-    for (i = 0; i < line_data->tags_count; i++)
-    {
-        if (strcmp (line_data->tags_array[i], GUI_FILTER_TAG_NO_FILTER) == 0)
-            return 1;
-    }
-
-    /* tag not found, line may be filtered */
-    return 0;
+    return (line_data->tags_mask
+            & GUI_LINE_TAG_BIT(GUI_LINE_TAG_NO_FILTER)) ? 1 : 0;
 }
 
 /*
  * Checks if line matches tags.
  *
+ * A well-known tag without wildcard is checked with the mask of tags in line.
+ * Other tags of lines are shared strings: if the tags to match are shared
+ * strings as well (split with string_split_shared), a tag which is exactly
+ * the same is found by comparing pointers, without any string comparison.
+ *
  * Returns:
  *   1: line matches tags
  *   0: line does not match tags
@@ -597,7 +1268,8 @@ int
 gui_line_match_tags (struct t_gui_line_data *line_data,
                      int tags_count, char ***tags_array)
 {
-    int i, j, k, match, tag_found, tag_negated;
+    int i, j, k, match, tag_found, tag_negated, known_tag;
+    const char *ptr_tag;
 
     if (!line_data)
         return 0;
@@ -617,14 +1289,38 @@ gui_line_match_tags (struct t_gui_line_data *line_data,
             if ((tags_array[i][j][0] == '!') && tags_array[i][j][1])
                 tag_negated = 1;
 
-            for (k = 0; k < line_data->tags_count; k++)
+            ptr_tag = (tag_negated) ? tags_array[i][j] + 1 : tags_array[i][j];
+
+            /* fastest path: well-known tag, checked with mask */
+            known_tag = (strchr (ptr_tag, '*')) ?
+                -1 : gui_line_tags_get_known (ptr_tag);
+            if (known_tag >= 0)
             {
-                if (string_match (line_data->tags_array[k],
-                                  (tag_negated) ? tags_array[i][j] + 1 : tags_array[i][j],
-                                  0))
+                tag_found = (line_data->tags_mask
+                             & GUI_LINE_TAG_BIT(known_tag)) ? 1 : 0;
+            }
+            else
+            {
+                /* fast path: same shared string in line */
+                for (k = 0; k < line_data->tags_count; k++)
                 {
-                    tag_found = 1;
-                    break;
+                    if (line_data->tags_array[k] == ptr_tag)
+                    {
+                        tag_found = 1;
+                        break;
+                    }
+                }
+            }
+
+            if (!tag_found && (known_tag < 0))
+            {
+                for (k = 0; k < line_data->tags_count; k++)
+                {
+                    if (string_match (line_data->tags_array[k], ptr_tag, 0))
+                    {
+                        tag_found = 1;
+                        break;
+                    }
                 }
             }
             if ((!tag_found && !tag_negated) || (tag_found && tag_negated))
@@ -692,8 +1388,8 @@ gui_line_get_nick_tag (struct t_gui_line *line)
 int
 gui_line_has_highlight (struct t_gui_line *line)
 {
-    int rc, i, no_highlight, action, length;
-    char *msg_no_color, *ptr_msg_no_color, *highlight_words;
+    int rc, i, action, length;
+    char *msg_no_color, *ptr_msg_no_color;
     const char *ptr_nick;
 
     /*
@@ -704,19 +1400,20 @@ gui_line_has_highlight (struct t_gui_line *line)
         && (strcmp (line->data->buffer->highlight_words, "-") == 0))
         return 0;
 
+    /* check if highlight is disabled for line */
+    if (line->data->tags_mask & GUI_LINE_TAG_BIT(GUI_LINE_TAG_NO_HIGHLIGHT))
+        return 0;
+
     /*
-     * check if highlight is disabled for line; also check if the line is an
-     * action message (for example tag "irc_action") and get pointer on the nick
-     * (tag "nick_xxx"), these info will be used later (see below)
+     * check if the line is an action message (for example tag "irc_action")
+     * and get pointer on the nick (tag "nick_xxx"), these info will be used
+     * later (see below)
      */
-    no_highlight = 0;
     action = 0;
     ptr_nick = NULL;
     for (i = 0; i < line->data->tags_count; i++)
     {
-        if (strcmp (line->data->tags_array[i], GUI_CHAT_TAG_NO_HIGHLIGHT) == 0)
-            no_highlight = 1;
-        else if (strncmp (line->data->tags_array[i], "nick_", 5) == 0)
+        if (strncmp (line->data->tags_array[i], "nick_", 5) == 0)
             ptr_nick = line->data->tags_array[i] + 5;
         else
         {
@@ -728,8 +1425,6 @@ gui_line_has_highlight (struct t_gui_line *line)
             }
         }
     }
-    if (no_highlight)
-        return 0;
 
     /*
      * check if highlight is forced by a tag
@@ -768,7 +1463,7 @@ gui_line_has_highlight (struct t_gui_line *line)
     }
 
     /* remove color codes from line message */
-    msg_no_color = gui_color_decode (line->data->message, NULL);
+    msg_no_color = gui_line_data_get_message_no_color (line->data);
     if (!msg_no_color)
         return 0;
     ptr_msg_no_color = msg_no_color;
@@ -796,26 +1491,12 @@ gui_line_has_highlight (struct t_gui_line *line)
 
     /*
      * there is highlight on line if one of buffer highlight words matches line
-     * or one of global highlight words matches line
+     * or one of global highlight words matches line (all words are searched
+     * in a single pass on message)
      */
-    highlight_words = gui_buffer_string_replace_local_var (line->data->buffer,
-                                                           line->data->buffer->highlight_words);
-    rc = string_has_highlight (ptr_msg_no_color,
-                               (highlight_words) ?
-                               highlight_words : line->data->buffer->highlight_words);
-    if (highlight_words)
-        free (highlight_words);
-
-    if (!rc)
-    {
-        highlight_words = gui_buffer_string_replace_local_var (line->data->buffer,
-                                                               CONFIG_STRING(config_look_highlight));
-        rc = string_has_highlight (ptr_msg_no_color,
-                                   (highlight_words) ?
-                                   highlight_words : CONFIG_STRING(config_look_highlight));
-        if (highlight_words)
-            free (highlight_words);
-    }
+    rc = string_highlight_match (
+        gui_buffer_get_highlight_words_compiled (line->data->buffer),
+        ptr_msg_no_color);
 
     if (!rc && config_highlight_regex)
     {
@@ -889,33 +1570,138 @@ gui_line_compute_buffer_max_length (struct t_gui_buffer *buffer,
         }
     }
 
-    lines->buffer_max_length_refresh = 0;
+    lines->buffer_max_length_refresh = 0;
+}
+
+/*
+ * Adds prefix length of a line in the number of lines by prefix length (only
+ * if line is displayed), and adjusts "prefix_max_length".
+ */
+
+void
+gui_lines_prefix_length_add (struct t_gui_lines *lines,
+                             struct t_gui_line *line)
+{
+    int *new_lengths, new_size, prefix_length, prefix_is_nick;
+
+    line->prefix_length_counted = -1;
+
+    if (!line->data->displayed)
+        return;
+
+    gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
+                                     &prefix_is_nick);
+    if (prefix_is_nick)
+        prefix_length += config_length_nick_prefix_suffix;
+    if (prefix_length < 0)
+        prefix_length = 0;
+
+    if (prefix_length >= lines->prefix_lengths_size)
+    {
+        new_size = (lines->prefix_lengths_size > 0) ?
+            lines->prefix_lengths_size : 32;
+        while (new_size <= prefix_length)
+        {
+            new_size *= 2;
+        }
+        new_lengths = realloc (lines->prefix_lengths,
+                               new_size * sizeof (*new_lengths));
+        if (!new_lengths)
+            return;
+        memset (new_lengths + lines->prefix_lengths_size, 0,
+                (new_size - lines->prefix_lengths_size) * sizeof (*new_lengths));
+        lines->prefix_lengths = new_lengths;
+        lines->prefix_lengths_size = new_size;
+    }
+
+    lines->prefix_lengths[prefix_length]++;
+    line->prefix_length_counted = prefix_length;
+
+    if (prefix_length > lines->prefix_lengths_max)
+        lines->prefix_lengths_max = prefix_length;
+    if (prefix_length > lines->prefix_max_length)
+        lines->prefix_max_length = prefix_length;
+}
+
+/*
+ * Removes prefix length of a line from the number of lines by prefix length,
+ * and adjusts "prefix_max_length" if the line had the longest prefix.
+ */
+
+void
+gui_lines_prefix_length_remove (struct t_gui_lines *lines,
+                                struct t_gui_line *line)
+{
+    int length;
+
+    length = line->prefix_length_counted;
+    if (length < 0)
+        return;
+
+    line->prefix_length_counted = -1;
+
+    if ((length >= lines->prefix_lengths_size)
+        || (lines->prefix_lengths[length] <= 0))
+        return;
+
+    lines->prefix_lengths[length]--;
+
+    if ((length == lines->prefix_lengths_max)
+        && (lines->prefix_lengths[length] == 0))
+    {
+        while ((lines->prefix_lengths_max >= 0)
+               && (lines->prefix_lengths[lines->prefix_lengths_max] == 0))
+        {
+            lines->prefix_lengths_max--;
+        }
+        lines->prefix_max_length =
+            (lines->prefix_lengths_max > CONFIG_INTEGER(config_look_prefix_align_min)) ?
+            lines->prefix_lengths_max : CONFIG_INTEGER(config_look_prefix_align_min);
+    }
+}
+
+/*
+ * Updates prefix length of a line in the number of lines by prefix length
+ * (for example if the previous line displayed has changed, with option
+ * weechat.look.prefix_same_nick).
+ */
+
+void
+gui_lines_prefix_length_update (struct t_gui_lines *lines,
+                                struct t_gui_line *line)
+{
+    if (!lines || !line)
+        return;
+
+    gui_lines_prefix_length_remove (lines, line);
+    gui_lines_prefix_length_add (lines, line);
 }
 
 /*
  * Computes "prefix_max_length" for a "t_gui_lines" structure.
+ *
+ * The number of lines by prefix length is built again with all lines (this
+ * is needed only when lines displayed or their prefix have changed, for
+ * example after a change in filters).
  */
 
 void
 gui_line_compute_prefix_max_length (struct t_gui_lines *lines)
 {
     struct t_gui_line *ptr_line;
-    int prefix_length, prefix_is_nick;
 
     lines->prefix_max_length = CONFIG_INTEGER(config_look_prefix_align_min);
+    lines->prefix_lengths_max = -1;
+    if (lines->prefix_lengths)
+    {
+        memset (lines->prefix_lengths, 0,
+                lines->prefix_lengths_size * sizeof (*lines->prefix_lengths));
+    }
 
     for (ptr_line = lines->first_line; ptr_line;
          ptr_line = ptr_line->next_line)
     {
-        if (ptr_line->data->displayed)
-        {
-            gui_line_get_prefix_for_display (ptr_line, NULL, &prefix_length,
-                                             NULL, &prefix_is_nick);
-            if (prefix_is_nick)
-                prefix_length += config_length_nick_prefix_suffix;
-            if (prefix_length > lines->prefix_max_length)
-                lines->prefix_max_length = prefix_length;
-        }
+        gui_lines_prefix_length_add (lines, ptr_line);
     }
 
     lines->prefix_max_length_refresh = 0;
@@ -929,8 +1715,6 @@ void
 gui_line_add_to_list (struct t_gui_lines *lines,
                       struct t_gui_line *line)
 {
-    int prefix_length, prefix_is_nick;
-
     if (!lines->first_line)
         lines->first_line = line;
     else
@@ -939,19 +1723,17 @@ gui_line_add_to_list (struct t_gui_lines *lines,
     line->next_line = NULL;
     lines->last_line = line;
 
-    /* adjust "prefix_max_length" if this prefix length is > max */
-    gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
-                                     &prefix_is_nick);
-    if (prefix_is_nick)
-        prefix_length += config_length_nick_prefix_suffix;
-    if (prefix_length > lines->prefix_max_length)
-        lines->prefix_max_length = prefix_length;
+    /* count prefix length (adjust "prefix_max_length" if it is > max) */
+    gui_lines_prefix_length_add (lines, line);
 
     /* adjust "lines_hidden" if the line is hidden */
     if (!line->data->displayed)
         (lines->lines_hidden)++;
 
     lines->lines_count++;
+
+    gui_line_index_add_line (lines, line);
+    gui_line_scroll_add_line (lines, line);
 }
 
 /*
@@ -966,7 +1748,7 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 {
     struct t_gui_window *ptr_win;
     struct t_gui_window_scroll *ptr_scroll;
-    int prefix_length, prefix_is_nick;
+    struct t_gui_line *ptr_next_displayed;
 
     for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
     {
@@ -998,12 +1780,19 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
         gui_window_coords_remove_line (ptr_win, line);
     }
 
-    gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
-                                     &prefix_is_nick);
-    if (prefix_is_nick)
-        prefix_length += config_length_nick_prefix_suffix;
-    if (prefix_length == lines->prefix_max_length)
-        lines->prefix_max_length_refresh = 1;
+    /*
+     * remove prefix length of line; with option weechat.look.prefix_same_nick,
+     * the prefix of next line displayed may change
+     */
+    gui_lines_prefix_length_remove (lines, line);
+    ptr_next_displayed = (CONFIG_STRING(config_look_prefix_same_nick)
+                          && CONFIG_STRING(config_look_prefix_same_nick)[0]
+                          && gui_line_is_displayed (line)) ?
+        gui_line_get_next_displayed (line) : NULL;
+
+    /* the last line before a batch "top" becomes the previous line */
+    if ((lines == buffer->own_lines) && (buffer->lines_batch_top_line == line))
+        buffer->lines_batch_top_line = line->prev_line;
 
     /* move read marker if it was on line we are removing */
     if (lines->last_read_line == line)
@@ -1017,18 +1806,16 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
     if (!line->data->displayed && (lines->lines_hidden > 0))
         (lines->lines_hidden)--;
 
+    gui_line_index_remove_line (lines, line);
+    gui_line_scroll_remove_line (lines, line);
+    gui_line_cursor_remove_line (lines, line);
+
+    if (line->data->mixed_line == line)
+        line->data->mixed_line = NULL;
+
     /* free data */
     if (free_data)
-    {
-        if (line->data->str_time)
-            free (line->data->str_time);
-        gui_line_tags_free (line->data);
-        if (line->data->prefix)
-            string_shared_free (line->data->prefix);
-        if (line->data->message)
-            free (line->data->message);
-        free (line->data);
-    }
+        gui_line_data_free (line->data);
 
     /* remove line from list */
     if (line->prev_line)
@@ -1041,8 +1828,12 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
         lines->last_line = line->prev_line;
 
     lines->lines_count--;
+    lines->lines_removed++;
+
+    gui_lines_free_line (lines, line);
 
-    free (line);
+    if (ptr_next_displayed)
+        gui_lines_prefix_length_update (lines, ptr_next_displayed);
 }
 
 /*
@@ -1055,10 +1846,11 @@ gui_line_mixed_add (struct t_gui_lines *lines,
 {
     struct t_gui_line *new_line;
 
-    new_line = malloc (sizeof (*new_line));
+    new_line = gui_lines_alloc_line (lines);
     if (new_line)
     {
         new_line->data = line_data;
+        line_data->mixed_line = new_line;
         gui_line_add_to_list (lines, new_line);
     }
 }
@@ -1092,23 +1884,147 @@ gui_line_mixed_free_buffer (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Checks if a line is allocated in chunks of a "t_gui_lines" structure.
+ *
+ * Returns:
+ *   1: line is in the lines
+ *   0: line is not in the lines
+ */
+
+int
+gui_lines_has_line (struct t_gui_lines *lines, struct t_gui_line *line)
+{
+    int i;
+
+    if (!lines || !line)
+        return 0;
+
+    for (i = lines->chunks_count - 1; i >= 0; i--)
+    {
+        if (lines->chunks[i] == line->chunk)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Removes all lines of a "t_gui_lines" structure from windows: windows
+ * scrolled in these lines are reset and coordinates of these lines are
+ * removed (as if lines were removed one by one).
+ */
+
+void
+gui_lines_remove_from_windows (struct t_gui_lines *lines)
+{
+    struct t_gui_window *ptr_win;
+    struct t_gui_window_scroll *ptr_scroll;
+    int i;
+
+    for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
+    {
+        for (ptr_scroll = ptr_win->scroll; ptr_scroll;
+             ptr_scroll = ptr_scroll->next_scroll)
+        {
+            if (gui_lines_has_line (lines, ptr_scroll->start_line))
+            {
+                ptr_scroll->start_line = NULL;
+                ptr_scroll->start_line_pos = 0;
+                ptr_scroll->first_line_displayed = 1;
+                ptr_scroll->scrolling = 0;
+                ptr_scroll->lines_after = 0;
+                gui_window_ask_refresh (1);
+            }
+            if (gui_lines_has_line (lines, ptr_scroll->text_search_start_line))
+                ptr_scroll->text_search_start_line = NULL;
+        }
+        if (ptr_win->coords)
+        {
+            for (i = 0; i < ptr_win->coords_size; i++)
+            {
+                if (gui_lines_has_line (lines, ptr_win->coords[i].line))
+                    gui_window_coords_init_line (ptr_win, i);
+            }
+        }
+    }
+}
+
+/*
+ * Resets a "t_gui_lines" structure after all its lines have been removed
+ * (chunks must have been freed or detached before call to this function).
+ */
+
+void
+gui_lines_reset (struct t_gui_buffer *buffer, struct t_gui_lines *lines)
+{
+    lines->first_slot = 0;
+    lines->holes = 0;
+    lines->unordered = 0;
+
+    lines->first_line = NULL;
+    lines->last_line = NULL;
+    if (lines->last_read_line)
+    {
+        lines->last_read_line = NULL;
+        lines->first_line_not_read = 1;
+        gui_buffer_ask_chat_refresh (buffer, 1);
+    }
+    lines->lines_removed += lines->lines_count;
+    lines->lines_count = 0;
+    lines->lines_hidden = 0;
+    lines->prefix_max_length = CONFIG_INTEGER(config_look_prefix_align_min);
+    lines->prefix_lengths_max = -1;
+    if (lines->prefix_lengths)
+    {
+        memset (lines->prefix_lengths, 0,
+                lines->prefix_lengths_size * sizeof (*lines->prefix_lengths));
+    }
+}
+
 /*
  * Frees all mixed lines in a buffer.
+ *
+ * All lines are removed at once: windows scrolled in these lines are reset
+ * (as if lines were removed one by one), then the chunks with lines are
+ * freed without unlinking each line.
  */
 
 void
 gui_line_mixed_free_all (struct t_gui_buffer *buffer)
 {
-    if (buffer->mixed_lines)
+    struct t_gui_lines *lines;
+    struct t_gui_line_chunk *ptr_chunk;
+    int i, j, start;
+
+    lines = buffer->mixed_lines;
+    if (!lines || !lines->first_line)
+        return;
+
+    gui_lines_remove_from_windows (lines);
+
+    gui_line_cursor_remove_lines (lines);
+    gui_line_index_free (lines);
+    gui_line_scroll_free (lines);
+
+    /* free chunks (and unlink line data from mixed lines) */
+    for (i = 0; i < lines->chunks_count; i++)
     {
-        while (buffer->mixed_lines->first_line)
+        ptr_chunk = lines->chunks[i];
+        start = (i == 0) ? lines->first_slot : 0;
+        for (j = start; j < ptr_chunk->used; j++)
         {
-            gui_line_remove_from_list (buffer,
-                                       buffer->mixed_lines,
-                                       buffer->mixed_lines->first_line,
-                                       0);
+            if (ptr_chunk->lines[j].data
+                && (ptr_chunk->lines[j].data->mixed_line == &(ptr_chunk->lines[j])))
+            {
+                ptr_chunk->lines[j].data->mixed_line = NULL;
+            }
         }
+        free (ptr_chunk);
     }
+    lines->chunks_count = 0;
+
+    gui_lines_reset (buffer, lines);
 }
 
 /*
@@ -1118,39 +2034,130 @@ gui_line_mixed_free_all (struct t_gui_buffer *buffer)
 void
 gui_line_free (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
+    /* first remove mixed line if it exists */
+    if (buffer->mixed_lines && line->data->mixed_line)
+    {
+        gui_line_remove_from_list (buffer,
+                                   buffer->mixed_lines,
+                                   line->data->mixed_line,
+                                   0);
+    }
+
+    /* remove line from lines list */
+    gui_line_remove_from_list (buffer, buffer->own_lines, line, 1);
+}
+
+/*
+ * Deletes all formatted lines from a buffer.
+ */
+
+void
+gui_line_free_all (struct t_gui_buffer *buffer)
+{
+    struct t_gui_lines *lines;
+    struct t_gui_lines_detached *new_detached;
     struct t_gui_line *ptr_line;
 
-    /* first remove mixed line if it exists */
-    if (buffer->mixed_lines)
+    lines = buffer->own_lines;
+
+    /*
+     * with many lines, the chunks are detached from buffer and lines are
+     * freed later, a few at a time, by function gui_lines_detached_free
+     * (called in main loop), so that WeeChat is not blocked
+     */
+    new_detached = (lines->lines_count >= GUI_LINES_DETACHED_MIN_LINES) ?
+        malloc (sizeof (*new_detached)) : NULL;
+    if (new_detached)
     {
-        for (ptr_line = buffer->mixed_lines->first_line; ptr_line;
-             ptr_line = ptr_line->next_line)
+        /* first remove mixed lines (they point to data of lines) */
+        if (buffer->mixed_lines)
         {
-            if (ptr_line->data == line->data)
+            for (ptr_line = lines->first_line; ptr_line;
+                 ptr_line = ptr_line->next_line)
             {
-                gui_line_remove_from_list (buffer,
-                                           buffer->mixed_lines,
-                                           ptr_line,
-                                           0);
-                break;
+                if (ptr_line->data->mixed_line)
+                {
+                    gui_line_remove_from_list (buffer,
+                                               buffer->mixed_lines,
+                                               ptr_line->data->mixed_line,
+                                               0);
+                }
             }
         }
+
+        gui_lines_remove_from_windows (lines);
+
+        gui_line_cursor_remove_lines (lines);
+        gui_line_index_free (lines);
+        gui_line_scroll_free (lines);
+
+        new_detached->chunks = lines->chunks;
+        new_detached->chunks_count = lines->chunks_count;
+        new_detached->chunk_index = 0;
+        new_detached->slot = lines->first_slot;
+        new_detached->next_detached = gui_lines_detached;
+        gui_lines_detached = new_detached;
+        gui_lines_detached_count += lines->lines_count;
+
+        lines->chunks = NULL;
+        lines->chunks_count = 0;
+        lines->chunks_size = 0;
+        gui_lines_reset (buffer, lines);
+        buffer->lines_batch_top_line = NULL;
+    }
+    else
+    {
+        while (lines->first_line)
+        {
+            gui_line_free (buffer, lines->first_line);
+        }
     }
 
-    /* remove line from lines list */
-    gui_line_remove_from_list (buffer, buffer->own_lines, line, 1);
+    gui_line_cold_free (buffer);
 }
 
 /*
- * Deletes all formatted lines from a buffer.
+ * Frees lines detached from buffers (by function gui_line_free_all).
+ *
+ * At most "max_lines" lines are freed (-1 = free all lines).
  */
 
 void
-gui_line_free_all (struct t_gui_buffer *buffer)
+gui_lines_detached_free (int max_lines)
 {
-    while (buffer->own_lines->first_line)
+    struct t_gui_lines_detached *ptr_detached;
+    struct t_gui_line_chunk *ptr_chunk;
+    int count;
+
+    count = 0;
+    while (gui_lines_detached && ((max_lines < 0) || (count < max_lines)))
     {
-        gui_line_free (buffer, buffer->own_lines->first_line);
+        ptr_detached = gui_lines_detached;
+        if (ptr_detached->chunk_index >= ptr_detached->chunks_count)
+        {
+            gui_lines_detached = ptr_detached->next_detached;
+            if (ptr_detached->chunks)
+                free (ptr_detached->chunks);
+            free (ptr_detached);
+            continue;
+        }
+        ptr_chunk = ptr_detached->chunks[ptr_detached->chunk_index];
+        if (ptr_detached->slot < ptr_chunk->used)
+        {
+            if (ptr_chunk->lines[ptr_detached->slot].data)
+            {
+                gui_line_data_free (ptr_chunk->lines[ptr_detached->slot].data);
+                gui_lines_detached_count--;
+                count++;
+            }
+            ptr_detached->slot++;
+        }
+        else
+        {
+            free (ptr_chunk);
+            ptr_detached->chunk_index++;
+            ptr_detached->slot = 0;
+        }
     }
 }
 
@@ -1164,8 +2171,23 @@ gui_line_free_all (struct t_gui_buffer *buffer)
 int
 gui_line_get_notify_level (struct t_gui_line *line)
 {
+    unsigned long long notify_mask;
     int i;
 
+    /* usual case: no more than one tag "notify_xxx" in line */
+    notify_mask = line->data->tags_mask & GUI_LINE_TAGS_NOTIFY_MASK;
+    if (notify_mask == 0)
+        return GUI_HOTLIST_LOW;
+    if (notify_mask == GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_NONE))
+        return -1;
+    if (notify_mask == GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_HIGHLIGHT))
+        return GUI_HOTLIST_HIGHLIGHT;
+    if (notify_mask == GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_PRIVATE))
+        return GUI_HOTLIST_PRIVATE;
+    if (notify_mask == GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_MESSAGE))
+        return GUI_HOTLIST_MESSAGE;
+
+    /* many tags "notify_xxx": the first one in line is used */
     for (i = 0; i < line->data->tags_count; i++)
     {
         if (string_strcasecmp (line->data->tags_array[i], "notify_none") == 0)
@@ -1180,6 +2202,26 @@ gui_line_get_notify_level (struct t_gui_line *line)
     return GUI_HOTLIST_LOW;
 }
 
+/*
+ * Adds a buffer in hotlist for a line added (if a batch of lines is in
+ * progress, the hotlist is updated at the end of batch).
+ */
+
+void
+gui_line_hotlist_add (struct t_gui_buffer *buffer,
+                      enum t_gui_hotlist_priority priority)
+{
+    if (buffer->lines_batch && buffer->lines_batch_hotlist)
+    {
+        if (priority > GUI_HOTLIST_MAX)
+            priority = GUI_HOTLIST_MAX;
+        buffer->lines_batch_hotlist[priority]++;
+        return;
+    }
+
+    (void) gui_hotlist_add (buffer, priority, NULL);
+}
+
 /*
  * Adds a new line for a buffer.
  */
@@ -1201,10 +2243,12 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
      * remove line(s) if necessary, according to history options:
      *   max_lines:   if > 0, keep only N lines in buffer
      *   max_minutes: if > 0, keep only lines from last N minutes
+     * (lines loaded from file are kept while buffer is scrolled)
      */
     lines_removed = 0;
     current_time = time (NULL);
     while (buffer->own_lines->first_line
+           && !gui_line_cold_keep_line (buffer, buffer->own_lines->first_line)
            && (((CONFIG_INTEGER(config_history_max_buffer_lines_number) > 0)
                 && (buffer->own_lines->lines_count + 1 >
                     CONFIG_INTEGER(config_history_max_buffer_lines_number)))
@@ -1212,23 +2256,24 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
                    && (current_time - buffer->own_lines->first_line->data->date_printed >
                        CONFIG_INTEGER(config_history_max_buffer_lines_minutes) * 60))))
     {
+        gui_line_cold_save (buffer, buffer->own_lines->first_line);
         gui_line_free (buffer, buffer->own_lines->first_line);
         lines_removed++;
     }
 
     /* create new line */
-    new_line = malloc (sizeof (*new_line));
+    new_line = gui_lines_alloc_line (buffer->own_lines);
     if (!new_line)
     {
         log_printf (_("Not enough memory for new line"));
         return NULL;
     }
 
-    /* create data for line */
-    new_line_data = malloc (sizeof (*new_line_data));
+    /* create data for line (with tags, time and message) */
+    new_line_data = gui_line_data_alloc (date, tags, message);
     if (!new_line_data)
     {
-        free (new_line);
+        gui_lines_free_line (buffer->own_lines, new_line);
         log_printf (_("Not enough memory for new line"));
         return NULL;
     }
@@ -1236,17 +2281,15 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
 
     /* fill data in new line */
     new_line->data->buffer = buffer;
+    new_line->data->id = gui_line_data_next_id++;
     new_line->data->y = -1;
     new_line->data->date = date;
     new_line->data->date_printed = date_printed;
-    new_line->data->str_time = gui_chat_get_time_string (date);
-    gui_line_tags_alloc (new_line->data, tags);
     new_line->data->refresh_needed = 0;
     new_line->data->prefix = (prefix) ?
         (char *)string_shared_get (prefix) : ((date != 0) ? (char *)string_shared_get ("") : NULL);
     new_line->data->prefix_length = (prefix) ?
         gui_chat_strlen_screen (prefix) : 0;
-    new_line->data->message = (message) ? strdup (message) : strdup ("");
 
     /* get notify level and max notify level for nick in buffer */
     notify_level = gui_line_get_notify_level (new_line);
@@ -1266,17 +2309,27 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
         new_line->data->highlight = gui_line_has_highlight (new_line);
 
     /* check if line is filtered or not */
+    gui_filter_line_update_mask (new_line->data);
     new_line->data->displayed = gui_filter_check_line (new_line->data);
 
     /* add line to lines list */
     gui_line_add_to_list (buffer->own_lines, new_line);
+    buffer->lines_added++;
+
+    TRACE3(gui_line_add, buffer->full_name, new_line->data->message,
+           new_line->data->displayed);
+
+    latency_line_added (buffer, new_line->data->displayed);
+
+    if (buffer->lines_batch)
+        buffer->lines_batch_count++;
 
     /* update hotlist and/or send signals for line */
     if (new_line->data->displayed)
     {
         if (new_line->data->highlight)
         {
-            (void) gui_hotlist_add (buffer, GUI_HOTLIST_HIGHLIGHT, NULL);
+            gui_line_hotlist_add (buffer, GUI_HOTLIST_HIGHLIGHT);
             if (!weechat_upgrading)
             {
                 message_for_signal = gui_chat_build_string_prefix_message (new_line);
@@ -1303,13 +2356,20 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
                 }
             }
             if (notify_level >= GUI_HOTLIST_MIN)
-                (void) gui_hotlist_add (buffer, notify_level, NULL);
+                gui_line_hotlist_add (buffer, notify_level);
         }
     }
     else
     {
-        (void) hook_signal_send ("buffer_lines_hidden",
-                                 WEECHAT_HOOK_SIGNAL_POINTER, buffer);
+        if (buffer->lines_batch)
+        {
+            buffer->lines_batch_hidden++;
+        }
+        else
+        {
+            (void) hook_signal_send ("buffer_lines_hidden",
+                                     WEECHAT_HOOK_SIGNAL_POINTER, buffer);
+        }
     }
 
     /* add mixed line, if buffer is attached to at least one other buffer */
@@ -1325,13 +2385,19 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
      */
     if (lines_removed > 0)
     {
-        for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
+        if (buffer->lines_batch)
+            buffer->lines_batch_removed += lines_removed;
+        else
         {
-            if ((ptr_win->buffer == buffer)
-                && (buffer->own_lines->lines_count < ptr_win->win_chat_height))
+            for (ptr_win = gui_windows; ptr_win;
+                 ptr_win = ptr_win->next_window)
             {
-                gui_buffer_ask_chat_refresh (buffer, 2);
-                break;
+                if ((ptr_win->buffer == buffer)
+                    && (buffer->own_lines->lines_count < ptr_win->win_chat_height))
+                {
+                    gui_buffer_ask_chat_refresh (buffer, 2);
+                    break;
+                }
             }
         }
     }
@@ -1342,6 +2408,184 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     return new_line;
 }
 
+/*
+ * Moves lines after "anchor_line" (last lines of list) on top of lines, before
+ * the first line, and renumbers all lines.
+ *
+ * Returns:
+ *   1: lines moved
+ *   0: nothing to move
+ */
+
+int
+gui_lines_move_end_to_top (struct t_gui_lines *lines,
+                           struct t_gui_line *anchor_line)
+{
+    struct t_gui_line *ptr_line, *first_moved_line, *old_first_line;
+    unsigned long long id;
+
+    if (!anchor_line || !anchor_line->next_line)
+        return 0;
+
+    first_moved_line = anchor_line->next_line;
+    old_first_line = lines->first_line;
+
+    /* move lines after anchor line before first line */
+    anchor_line->next_line = NULL;
+    first_moved_line->prev_line = NULL;
+    lines->last_line->next_line = old_first_line;
+    old_first_line->prev_line = lines->last_line;
+    lines->first_line = first_moved_line;
+    lines->last_line = anchor_line;
+    lines->unordered = 1;
+
+    /* prefix of old first line may change (option prefix_same_nick) */
+    gui_lines_prefix_length_update (lines, old_first_line);
+
+    /* line ids must be increasing in list (for the index of lines) */
+    gui_line_scroll_free (lines);
+    id = 0;
+    for (ptr_line = lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        ptr_line->id = id++;
+    }
+    lines->next_line_id = id;
+
+    return 1;
+}
+
+/*
+ * Moves lines added during a batch "top" (after line
+ * buffer->lines_batch_top_line) on top of buffer, before lines that were
+ * already in buffer when the batch started.
+ *
+ * If the buffer is merged, the lines are moved on top of mixed lines as well
+ * (lines of batch are the last mixed lines, since lines are added in
+ * mixed lines at same time).
+ */
+
+void
+gui_line_batch_move_top (struct t_gui_buffer *buffer)
+{
+    struct t_gui_line *ptr_line, *ptr_mixed_anchor;
+    int index_built;
+
+    ptr_line = buffer->lines_batch_top_line;
+    buffer->lines_batch_top_line = NULL;
+
+    if (!ptr_line || !ptr_line->next_line)
+        return;
+
+    ptr_mixed_anchor = NULL;
+    if (buffer->mixed_lines && ptr_line->next_line->data->mixed_line)
+        ptr_mixed_anchor = ptr_line->next_line->data->mixed_line->prev_line;
+
+    index_built = (buffer->lines->search_index) ? 1 : 0;
+    gui_line_index_free (buffer->own_lines);
+    if (buffer->mixed_lines)
+        gui_line_index_free (buffer->mixed_lines);
+
+    gui_lines_move_end_to_top (buffer->own_lines, ptr_line);
+    if (ptr_mixed_anchor)
+        gui_lines_move_end_to_top (buffer->mixed_lines, ptr_mixed_anchor);
+
+    if (index_built)
+        gui_line_index_build (buffer);
+
+    gui_buffer_ask_chat_refresh (buffer, 2);
+}
+
+/*
+ * Starts or ends a batch of lines added in a buffer.
+ *
+ * During a batch, lines are added without update of hotlist, refresh of chat
+ * and signal "buffer_lines_hidden"; at the end of batch, the hotlist is
+ * updated once (with the count of messages for each priority), the signal
+ * "buffer_lines_hidden" is sent once (if some lines are hidden), a single
+ * refresh of chat is asked and the signal "buffer_lines_added" is sent (if
+ * some lines were added).
+ *
+ * With batch == GUI_LINE_BATCH_TOP, lines added during the batch are moved
+ * on top of buffer at the end of batch (used to display old lines, for
+ * example backlog read asynchronously).
+ */
+
+void
+gui_line_set_batch (struct t_gui_buffer *buffer, int batch)
+{
+    struct t_gui_hotlist *ptr_hotlist;
+    int i, hidden, removed;
+
+    if (!buffer)
+        return;
+
+    if (batch)
+    {
+        if (buffer->lines_batch)
+            return;
+        if (!buffer->lines_batch_hotlist)
+        {
+            buffer->lines_batch_hotlist = calloc (
+                GUI_HOTLIST_NUM_PRIORITIES,
+                sizeof (*buffer->lines_batch_hotlist));
+        }
+        buffer->lines_batch = batch;
+        buffer->lines_batch_top_line = (batch == GUI_LINE_BATCH_TOP) ?
+            buffer->own_lines->last_line : NULL;
+        buffer->lines_batch_count = 0;
+        buffer->lines_batch_hidden = 0;
+        buffer->lines_batch_removed = 0;
+        return;
+    }
+
+    if (!buffer->lines_batch)
+        return;
+
+    if (buffer->lines_batch == GUI_LINE_BATCH_TOP)
+        gui_line_batch_move_top (buffer);
+
+    buffer->lines_batch = 0;
+
+    /* update hotlist: one add for each priority, then counts are adjusted */
+    if (buffer->lines_batch_hotlist)
+    {
+        for (i = 0; i < GUI_HOTLIST_NUM_PRIORITIES; i++)
+        {
+            if (buffer->lines_batch_hotlist[i] > 0)
+            {
+                ptr_hotlist = gui_hotlist_add (buffer, i, NULL);
+                if (ptr_hotlist)
+                {
+                    ptr_hotlist->count[i] += buffer->lines_batch_hotlist[i] - 1;
+                }
+                buffer->lines_batch_hotlist[i] = 0;
+            }
+        }
+        free (buffer->lines_batch_hotlist);
+        buffer->lines_batch_hotlist = NULL;
+    }
+
+    hidden = buffer->lines_batch_hidden;
+    removed = buffer->lines_batch_removed;
+    buffer->lines_batch_hidden = 0;
+    buffer->lines_batch_removed = 0;
+
+    if (hidden > 0)
+    {
+        (void) hook_signal_send ("buffer_lines_hidden",
+                                 WEECHAT_HOOK_SIGNAL_POINTER, buffer);
+    }
+
+    if (buffer->lines_batch_count > 0)
+    {
+        buffer->lines_batch_count = 0;
+        gui_buffer_ask_chat_refresh (buffer, (removed > 0) ? 2 : 1);
+        (void) hook_signal_send ("buffer_lines_added",
+                                 WEECHAT_HOOK_SIGNAL_POINTER, buffer);
+    }
+}
+
 /*
  * Adds or updates a line for a buffer with free content.
  */
@@ -1363,7 +2607,7 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
 
     if (!ptr_line || (ptr_line->data->y > y))
     {
-        new_line = malloc (sizeof (*new_line));
+        new_line = gui_lines_alloc_line (buffer->own_lines);
         if (!new_line)
         {
             log_printf (_("Not enough memory for new line"));
@@ -1373,7 +2617,7 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
         new_line_data = malloc (sizeof (*new_line_data));
         if (!new_line_data)
         {
-            free (new_line);
+            gui_lines_free_line (buffer->own_lines, new_line);
             log_printf (_("Not enough memory for new line"));
             return;
         }
@@ -1383,22 +2627,30 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
 
         /* fill data in new line */
         new_line->data->buffer = buffer;
+        new_line->data->id = gui_line_data_next_id++;
         new_line->data->y = y;
         new_line->data->date = 0;
         new_line->data->date_printed = 0;
         new_line->data->str_time = NULL;
         new_line->data->tags_count = 0;
         new_line->data->tags_array = NULL;
+        new_line->data->tags_mask = 0;
         new_line->data->refresh_needed = 1;
         new_line->data->prefix = NULL;
         new_line->data->prefix_length = 0;
         new_line->data->message = NULL;
+        new_line->data->message_runs = NULL;
+        new_line->data->message_runs_count = -1;
+        new_line->data->block_size = 0;
+        new_line->data->mixed_line = NULL;
+        new_line->data->cold_size = 0;
         new_line->data->highlight = 0;
 
         /* add line to lines list */
         if (ptr_line)
         {
             /* add before line found */
+            buffer->own_lines->unordered = 1;
             new_line->prev_line = ptr_line->prev_line;
             new_line->next_line = ptr_line;
             if (ptr_line->prev_line)
@@ -1432,11 +2684,16 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
         }
 
         /* free message in line */
-        free (ptr_line->data->message);
+        gui_line_data_free_string (ptr_line->data, &ptr_line->data->message);
     }
     ptr_line->data->message = (message) ? strdup (message) : strdup ("");
+    gui_line_data_build_message_runs (ptr_line->data);
+
+    /* line added or changed: the index for scroll is obsolete */
+    gui_line_scroll_free (buffer->own_lines);
 
     /* check if line is filtered or not */
+    gui_filter_line_update_mask (ptr_line->data);
     ptr_line->data->displayed = gui_filter_check_line (ptr_line->data);
     if (!ptr_line->data->displayed)
     {
@@ -1459,9 +2716,9 @@ gui_line_clear (struct t_gui_line *line)
         string_shared_free (line->data->prefix);
     line->data->prefix = (char *)string_shared_get ("");
 
-    if (line->data->message)
-        free (line->data->message);
+    gui_line_data_free_string (line->data, &line->data->message);
     line->data->message = strdup ("");
+    gui_line_data_build_message_runs (line->data);
 }
 
 /*
@@ -1542,7 +2799,7 @@ gui_line_mix_buffers (struct t_gui_buffer *buffer)
     if (ptr_buffer_found->mixed_lines)
     {
         gui_line_mixed_free_all (ptr_buffer_found);
-        free (ptr_buffer_found->mixed_lines);
+        gui_lines_free (ptr_buffer_found->mixed_lines);
     }
 
     /* use new structure with mixed lines in all buffers with correct number */
@@ -1578,6 +2835,7 @@ gui_line_hdata_lines_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_lines, last_line, POINTER, 0, NULL, "line");
         HDATA_VAR(struct t_gui_lines, last_read_line, POINTER, 0, NULL, "line");
         HDATA_VAR(struct t_gui_lines, lines_count, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_lines, lines_removed, LONG, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_lines, first_line_not_read, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_lines, lines_hidden, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_lines, buffer_max_length, INTEGER, 0, NULL, NULL);
@@ -1642,8 +2900,7 @@ gui_line_hdata_line_data_update_cb (void *data,
         if (value)
         {
             hdata_set (hdata, pointer, "date", value);
-            if (line_data->str_time)
-                free (line_data->str_time);
+            gui_line_data_free_string (line_data, &line_data->str_time);
             line_data->str_time = gui_chat_get_time_string (line_data->date);
             rc++;
             update_coords = 1;
@@ -1682,7 +2939,10 @@ gui_line_hdata_line_data_update_cb (void *data,
     if (hashtable_has_key (hashtable, "message"))
     {
         value = hashtable_get (hashtable, "message");
-        hdata_set (hdata, pointer, "message", value);
+        /* message may be in block of line data: it can not be freed by hdata */
+        gui_line_data_free_string (line_data, &line_data->message);
+        line_data->message = (value) ? strdup (value) : NULL;
+        gui_line_data_build_message_runs (line_data);
         rc++;
         update_coords = 1;
     }
@@ -1691,11 +2951,19 @@ gui_line_hdata_line_data_update_cb (void *data,
     {
         if (update_coords)
         {
+            /* text of line has changed: the index for search is obsolete */
+            gui_line_index_free (line_data->buffer->own_lines);
+            gui_line_index_free (line_data->buffer->mixed_lines);
             for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
             {
                 gui_window_coords_remove_line_data (ptr_win, line_data);
             }
         }
+        /* date may change: the index for scroll is obsolete */
+        gui_line_scroll_free (line_data->buffer->own_lines);
+        gui_line_scroll_free (line_data->buffer->mixed_lines);
+        /* date, prefix or message may change the layout of line */
+        gui_chat_layout_invalidate ();
         gui_filter_buffer (line_data->buffer, line_data);
         gui_buffer_ask_chat_refresh (line_data->buffer, 1);
     }
@@ -1722,6 +2990,7 @@ gui_line_hdata_line_data_cb (const void *pointer, void *data,
     if (hdata)
     {
         HDATA_VAR(struct t_gui_line_data, buffer, POINTER, 0, NULL, "buffer");
+        HDATA_VAR(struct t_gui_line_data, id, LONG, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_line_data, y, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_line_data, date, TIME, 1, NULL, NULL);
         HDATA_VAR(struct t_gui_line_data, date_printed, TIME, 1, NULL, NULL);
@@ -1762,6 +3031,9 @@ gui_line_add_to_infolist (struct t_infolist *infolist,
     if (!ptr_item)
         return 0;
 
+    if (!infolist_new_var_buffer (ptr_item, "id", &(line->data->id),
+                                  sizeof (line->data->id)))
+        return 0;
     if (!infolist_new_var_integer (ptr_item, "y", line->data->y))
         return 0;
     if (!infolist_new_var_time (ptr_item, "date", line->data->date))
@@ -1834,5 +3106,18 @@ gui_lines_print_log (struct t_gui_lines *lines)
         log_printf ("    buffer_max_length_refresh: %d",    lines->buffer_max_length_refresh);
         log_printf ("    prefix_max_length. . . . : %d",    lines->prefix_max_length);
         log_printf ("    prefix_max_length_refresh: %d",    lines->prefix_max_length_refresh);
+        log_printf ("    prefix_lengths . . . . . : 0x%lx", lines->prefix_lengths);
+        log_printf ("    prefix_lengths_size. . . : %d",    lines->prefix_lengths_size);
+        log_printf ("    prefix_lengths_max . . . : %d",    lines->prefix_lengths_max);
+        log_printf ("    chunks . . . . . . . . . : 0x%lx", lines->chunks);
+        log_printf ("    chunks_count . . . . . . : %d",    lines->chunks_count);
+        log_printf ("    chunks_size. . . . . . . : %d",    lines->chunks_size);
+        log_printf ("    first_slot . . . . . . . : %d",    lines->first_slot);
+        log_printf ("    holes. . . . . . . . . . : %d",    lines->holes);
+        log_printf ("    unordered. . . . . . . . : %d",    lines->unordered);
+        log_printf ("    next_line_id . . . . . . : %llu",  lines->next_line_id);
+        log_printf ("    lines_removed. . . . . . : %ld",   lines->lines_removed);
+        log_printf ("    search_index . . . . . . : 0x%lx", lines->search_index);
+        log_printf ("    scroll_index . . . . . . : 0x%lx", lines->scroll_index);
     }
 }
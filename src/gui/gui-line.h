@@ -23,32 +23,129 @@
 #include <time.h>
 #include <regex.h>
 
+#define GUI_LINES_CHUNK_SIZE 128
+
+/* batch of lines moved on top of buffer at the end of batch */
+#define GUI_LINE_BATCH_TOP 2
+
+/* min lines in buffer to free lines later (see gui_line_free_all) */
+#define GUI_LINES_DETACHED_MIN_LINES  1024
+/* max lines freed in each iteration of main loop */
+#define GUI_LINES_DETACHED_FREE_LINES 4096
+
+/*
+ * well-known tags of lines, with a bit in "tags_mask" of line data
+ * (sorted by name, see gui_line_tags_known in gui-line.c)
+ */
+
+enum t_gui_line_tag
+{
+    GUI_LINE_TAG_IRC_ACTION = 0,
+    GUI_LINE_TAG_IRC_CTCP,
+    GUI_LINE_TAG_IRC_JOIN,
+    GUI_LINE_TAG_IRC_KICK,
+    GUI_LINE_TAG_IRC_MODE,
+    GUI_LINE_TAG_IRC_NICK,
+    GUI_LINE_TAG_IRC_NOTICE,
+    GUI_LINE_TAG_IRC_PART,
+    GUI_LINE_TAG_IRC_PRIVMSG,
+    GUI_LINE_TAG_IRC_QUIT,
+    GUI_LINE_TAG_IRC_SMART_FILTER,
+    GUI_LINE_TAG_IRC_TOPIC,
+    GUI_LINE_TAG_LOG0,
+    GUI_LINE_TAG_LOG1,
+    GUI_LINE_TAG_LOG2,
+    GUI_LINE_TAG_LOG3,
+    GUI_LINE_TAG_LOG4,
+    GUI_LINE_TAG_LOG5,
+    GUI_LINE_TAG_LOG6,
+    GUI_LINE_TAG_LOG7,
+    GUI_LINE_TAG_LOG8,
+    GUI_LINE_TAG_LOG9,
+    GUI_LINE_TAG_NO_FILTER,
+    GUI_LINE_TAG_NO_HIGHLIGHT,
+    GUI_LINE_TAG_NO_LOG,
+    GUI_LINE_TAG_NOTIFY_HIGHLIGHT,
+    GUI_LINE_TAG_NOTIFY_MESSAGE,
+    GUI_LINE_TAG_NOTIFY_NONE,
+    GUI_LINE_TAG_NOTIFY_PRIVATE,
+    GUI_LINE_TAG_SELF_MSG,
+    /* number of well-known tags */
+    GUI_LINE_NUM_TAGS,
+};
+
+#define GUI_LINE_TAG_BIT(__tag) (1ULL << (__tag))
+#define GUI_LINE_TAGS_NOTIFY_MASK                                       \
+    (GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_HIGHLIGHT)                    \
+     | GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_MESSAGE)                    \
+     | GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_NONE)                       \
+     | GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_PRIVATE))
+
 struct t_infolist;
+struct t_hashtable;
 
 /* line structures */
 
+struct t_gui_color_run;
+
 struct t_gui_line_data
 {
     struct t_gui_buffer *buffer;       /* pointer to buffer                 */
+    long id;                           /* unique id of line (increasing)    */
     int y;                             /* line position (for free buffer)   */
     time_t date;                       /* date/time of line (may be past)   */
     time_t date_printed;               /* date/time when weechat print it   */
     char *str_time;                    /* time string (for display)         */
     int tags_count;                    /* number of tags for line           */
     char **tags_array;                 /* tags for line                     */
+    unsigned long long tags_mask;      /* well-known tags in "tags_array"   */
+                                       /* (see enum t_gui_line_tag)         */
+    unsigned long long filters_mask;   /* mask of enabled filters hiding    */
+                                       /* line (see gui-filter.h)           */
     char displayed;                    /* 1 if line is displayed            */
     char highlight;                    /* 1 if line has highlight           */
     char refresh_needed;               /* 1 if refresh asked (free buffer)  */
     char *prefix;                      /* prefix for line (may be NULL)     */
     int prefix_length;                 /* prefix length (on screen)         */
     char *message;                     /* line content (after prefix)       */
+    struct t_gui_color_run *message_runs; /* runs of text in message     */
+                                       /* (without color codes)             */
+    int message_runs_count;            /* number of runs (-1 if not built)  */
+    int block_size;                    /* size of block with line data,     */
+                                       /* tags array, time and message      */
+                                       /* (0 if allocated separately)       */
+    struct t_gui_line *mixed_line;     /* line in mixed lines (if buffer is */
+                                       /* merged with other buffers)        */
+    int cold_size;                     /* size of record in file if line    */
+                                       /* was loaded from file (see         */
+                                       /* gui-line-cold.c), 0 otherwise     */
 };
 
+struct t_gui_line_chunk;
+struct t_gui_line_scroll;
+
 struct t_gui_line
 {
     struct t_gui_line_data *data;      /* pointer to line data              */
     struct t_gui_line *prev_line;      /* link to previous line             */
     struct t_gui_line *next_line;      /* link to next line                 */
+    struct t_gui_line_chunk *chunk;    /* chunk where line is allocated     */
+    unsigned long long id;             /* line id (increasing in lines)     */
+    int layout_generation;             /* generation of cached layout       */
+                                       /* (0 = no layout cached)            */
+    int layout_width;                  /* chat width used for layout        */
+    int layout_align;                  /* alignment used for layout         */
+    int layout_lines;                  /* number of lines on screen for     */
+                                       /* time, prefix and message          */
+    int prefix_length_counted;         /* prefix length counted in          */
+                                       /* "prefix_lengths" (-1 if none)     */
+};
+
+struct t_gui_line_chunk
+{
+    struct t_gui_line lines[GUI_LINES_CHUNK_SIZE]; /* lines of chunk       */
+    int used;                          /* number of lines allocated         */
+    int count;                         /* number of lines not removed       */
 };
 
 struct t_gui_lines
@@ -64,11 +161,69 @@ struct t_gui_lines
     int buffer_max_length_refresh;     /* refresh asked for buffer max len. */
     int prefix_max_length;             /* max length for prefix align       */
     int prefix_max_length_refresh;     /* refresh asked for prefix max len. */
+    int *prefix_lengths;               /* number of lines displayed for     */
+                                       /* each prefix length (index=length) */
+    int prefix_lengths_size;           /* size of array "prefix_lengths"    */
+    int prefix_lengths_max;            /* highest length with lines in      */
+                                       /* "prefix_lengths" (-1 if none)     */
+    struct t_gui_line_chunk **chunks;  /* chunks with lines (in order of    */
+                                       /* allocation)                       */
+    int chunks_count;                  /* number of chunks                  */
+    int chunks_size;                   /* size of array "chunks"            */
+    int first_slot;                    /* first line used in first chunk    */
+    int holes;                         /* lines removed between first and   */
+                                       /* last line                         */
+    int unordered;                     /* 1 if a line was inserted before   */
+                                       /* another (lines not in order of    */
+                                       /* chunks)                           */
+    unsigned long long next_line_id;   /* id for next line added            */
+    long lines_removed;                /* number of lines removed (since    */
+                                       /* creation of lines)                */
+    struct t_hashtable *search_index;  /* index of lines for text search    */
+                                       /* (see gui-line-index.c)            */
+    struct t_gui_line_scroll *scroll_index; /* index of lines for scroll    */
+                                       /* (see gui-line-scroll.c)           */
 };
 
+/* lines detached from a buffer, freed later (a few lines at a time) */
+
+struct t_gui_lines_detached
+{
+    struct t_gui_line_chunk **chunks;  /* chunks with lines to free         */
+    int chunks_count;                  /* number of chunks                  */
+    int chunk_index;                   /* index of chunk being freed        */
+    int slot;                          /* next line to free in chunk        */
+    struct t_gui_lines_detached *next_detached; /* link to next lines       */
+};
+
+/* line variables */
+
+extern char *gui_line_tags_known[];
+extern long gui_line_data_next_id;
+extern struct t_gui_lines_detached *gui_lines_detached;
+extern int gui_lines_detached_count;
+
 /* line functions */
 
 extern struct t_gui_lines *gui_lines_alloc ();
+extern struct t_gui_line *gui_lines_alloc_line (struct t_gui_lines *lines);
+extern void gui_lines_free_line (struct t_gui_lines *lines,
+                                 struct t_gui_line *line);
+extern struct t_gui_line *gui_lines_get_line (struct t_gui_lines *lines,
+                                              int index);
+extern int gui_line_data_in_block (struct t_gui_line_data *line_data,
+                                   const void *pointer);
+extern void gui_line_data_free_string (struct t_gui_line_data *line_data,
+                                       char **string);
+extern void gui_line_data_free (struct t_gui_line_data *line_data);
+extern void gui_line_data_free_message_runs (struct t_gui_line_data *line_data);
+extern long gui_line_data_get_memory (struct t_gui_line_data *line_data);
+extern long gui_lines_get_memory (struct t_gui_lines *lines, int with_data);
+extern void gui_line_data_build_message_runs (struct t_gui_line_data *line_data);
+extern char *gui_line_data_get_message_no_color (struct t_gui_line_data *line_data);
+extern struct t_gui_line_data *gui_line_data_alloc (time_t date,
+                                                    const char *tags,
+                                                    const char *message);
 extern void gui_lines_free (struct t_gui_lines *lines);
 extern void gui_line_get_prefix_for_display (struct t_gui_line *line,
                                              char **prefix, int *length,
@@ -87,6 +242,7 @@ extern int gui_line_match_regex (struct t_gui_line_data *line_data,
                                  regex_t *regex_prefix,
                                  regex_t *regex_message);
 extern int gui_line_has_tag_no_filter (struct t_gui_line_data *line_data);
+extern int gui_line_tags_get_known (const char *tag);
 extern int gui_line_match_tags (struct t_gui_line_data *line_data,
                                 int tags_count, char ***tags_array);
 extern const char *gui_line_search_tag_starting_with (struct t_gui_line *line,
@@ -96,13 +252,23 @@ extern int gui_line_has_highlight (struct t_gui_line *line);
 extern int gui_line_has_offline_nick (struct t_gui_line *line);
 extern void gui_line_compute_buffer_max_length (struct t_gui_buffer *buffer,
                                                 struct t_gui_lines *lines);
+extern void gui_lines_prefix_length_add (struct t_gui_lines *lines,
+                                        struct t_gui_line *line);
+extern void gui_lines_prefix_length_remove (struct t_gui_lines *lines,
+                                           struct t_gui_line *line);
+extern void gui_lines_prefix_length_update (struct t_gui_lines *lines,
+                                           struct t_gui_line *line);
 extern void gui_line_compute_prefix_max_length (struct t_gui_lines *lines);
 extern void gui_line_set_prefix_same_nick (struct t_gui_line *line);
 extern void gui_line_mixed_free_buffer (struct t_gui_buffer *buffer);
+extern void gui_lines_remove_from_windows (struct t_gui_lines *lines);
+extern void gui_lines_reset (struct t_gui_buffer *buffer,
+                             struct t_gui_lines *lines);
 extern void gui_line_mixed_free_all (struct t_gui_buffer *buffer);
 extern void gui_line_free (struct t_gui_buffer *buffer,
                            struct t_gui_line *line);
 extern void gui_line_free_all (struct t_gui_buffer *buffer);
+extern void gui_lines_detached_free (int max_lines);
 extern int gui_line_get_notify_level (struct t_gui_line *line);
 extern struct t_gui_line *gui_line_add (struct t_gui_buffer *buffer,
                                         time_t date,
@@ -110,6 +276,7 @@ extern struct t_gui_line *gui_line_add (struct t_gui_buffer *buffer,
                                         const char *tags,
                                         const char *prefix,
                                         const char *message);
+extern void gui_line_set_batch (struct t_gui_buffer *buffer, int batch);
 extern void gui_line_add_y (struct t_gui_buffer *buffer, int y,
                             const char *message);
 extern void gui_line_clear (struct t_gui_line *line);
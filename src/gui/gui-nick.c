@@ -24,6 +24,7 @@
 #endif
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "../core/weechat.h"
@@ -31,10 +32,16 @@
 #include "../core/wee-hashtable.h"
 #include "../core/wee-string.h"
 #include "../core/wee-utf8.h"
+#include "../plugins/plugin.h"
 #include "gui-nick.h"
 #include "gui-color.h"
 
 
+struct t_hashtable *gui_nick_color_cache = NULL; /* cache of nick colors   */
+struct t_gui_nick_color *gui_nick_color_cache_first = NULL; /* most recent */
+struct t_gui_nick_color *gui_nick_color_cache_last = NULL; /* least recent */
+
+
 /*
  * Hashes a nickname to find color.
  *
@@ -165,52 +172,181 @@ gui_nick_strdup_for_color (const char *nickname)
 }
 
 /*
- * Finds a color code for a nick (according to nick letters).
+ * Callback called to free a nick color in cache.
+ */
+
+void
+gui_nick_color_cache_free_value_cb (struct t_hashtable *hashtable,
+                                    const void *key, void *value)
+{
+    struct t_gui_nick_color *nick_color;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    nick_color = (struct t_gui_nick_color *)value;
+    if (!nick_color)
+        return;
+
+    /* remove nick color from list */
+    if (nick_color->prev_color)
+        (nick_color->prev_color)->next_color = nick_color->next_color;
+    if (nick_color->next_color)
+        (nick_color->next_color)->prev_color = nick_color->prev_color;
+    if (gui_nick_color_cache_first == nick_color)
+        gui_nick_color_cache_first = nick_color->next_color;
+    if (gui_nick_color_cache_last == nick_color)
+        gui_nick_color_cache_last = nick_color->prev_color;
+
+    free (nick_color->nickname);
+    free (nick_color);
+}
+
+/*
+ * Computes color of a nick and adds it in cache.
  *
- * Returns a WeeChat color code (that can be used for display).
+ * Returns pointer to new nick color, NULL if error.
  */
 
-const char *
-gui_nick_find_color (const char *nickname)
+struct t_gui_nick_color *
+gui_nick_color_cache_add (const char *nickname)
 {
-    int color;
+    struct t_gui_nick_color *new_color;
     char *nickname2;
     const char *forced_color, *str_color;
+    int color;
 
-    if (!nickname || !nickname[0])
-        return gui_color_get_custom ("default");
+    if (!gui_nick_color_cache)
+    {
+        gui_nick_color_cache = hashtable_new (GUI_NICK_COLOR_CACHE_SIZE,
+                                              WEECHAT_HASHTABLE_STRING,
+                                              WEECHAT_HASHTABLE_POINTER,
+                                              NULL, NULL);
+        if (!gui_nick_color_cache)
+            return NULL;
+        gui_nick_color_cache->callback_free_value = &gui_nick_color_cache_free_value_cb;
+    }
 
-    if (!config_nick_colors)
-        config_set_nick_colors ();
+    /* remove least recently used nick color if cache is full */
+    if (gui_nick_color_cache_last
+        && (gui_nick_color_cache->items_count >= GUI_NICK_COLOR_CACHE_SIZE))
+    {
+        hashtable_remove (gui_nick_color_cache,
+                          gui_nick_color_cache_last->nickname);
+    }
 
-    if (config_num_nick_colors == 0)
-        return gui_color_get_custom ("default");
+    new_color = malloc (sizeof (*new_color));
+    if (!new_color)
+        return NULL;
+    new_color->nickname = strdup (nickname);
+    if (!new_color->nickname)
+    {
+        free (new_color);
+        return NULL;
+    }
 
     nickname2 = gui_nick_strdup_for_color (nickname);
 
-    /* look if color is forced */
+    /* look if color is forced, otherwise hash nickname to get color */
     forced_color = gui_nick_get_forced_color (
         (nickname2) ? nickname2 : nickname);
-    if (forced_color)
+    str_color = (forced_color) ? gui_color_get_custom (forced_color) : NULL;
+    if (!str_color || !str_color[0])
     {
-        forced_color = gui_color_get_custom (forced_color);
-        if (forced_color && forced_color[0])
-        {
-            if (nickname2)
-                free (nickname2);
-            return forced_color;
-        }
+        color = gui_nick_hash_color ((nickname2) ? nickname2 : nickname);
+        str_color = gui_color_get_custom (config_nick_colors[color]);
+        if (!str_color[0])
+            str_color = gui_color_get_custom ("default");
+        if (!forced_color)
+            forced_color = config_nick_colors[color];
     }
-
-    /* hash nickname to get color */
-    color = gui_nick_hash_color ((nickname2) ? nickname2 : nickname);
+    new_color->color_name = forced_color;
+    snprintf (new_color->color, sizeof (new_color->color), "%s", str_color);
 
     if (nickname2)
         free (nickname2);
 
-    /* return color */
-    str_color = gui_color_get_custom (config_nick_colors[color]);
-    return (str_color[0]) ? str_color : gui_color_get_custom ("default");
+    new_color->prev_color = NULL;
+    new_color->next_color = gui_nick_color_cache_first;
+    if (gui_nick_color_cache_first)
+        gui_nick_color_cache_first->prev_color = new_color;
+    else
+        gui_nick_color_cache_last = new_color;
+    gui_nick_color_cache_first = new_color;
+
+    if (!hashtable_set (gui_nick_color_cache, nickname, new_color))
+    {
+        gui_nick_color_cache_free_value_cb (NULL, NULL, new_color);
+        return NULL;
+    }
+
+    return new_color;
+}
+
+/*
+ * Gets color of a nick (from cache, or computed and added in cache).
+ *
+ * Returns pointer to nick color, NULL if error.
+ */
+
+struct t_gui_nick_color *
+gui_nick_color_get (const char *nickname)
+{
+    struct t_gui_nick_color *ptr_color;
+
+    ptr_color = (gui_nick_color_cache) ?
+        hashtable_get (gui_nick_color_cache, nickname) : NULL;
+    if (!ptr_color)
+        return gui_nick_color_cache_add (nickname);
+
+    /* move nick color at beginning of list (most recently used) */
+    if (ptr_color != gui_nick_color_cache_first)
+    {
+        (ptr_color->prev_color)->next_color = ptr_color->next_color;
+        if (ptr_color->next_color)
+            (ptr_color->next_color)->prev_color = ptr_color->prev_color;
+        else
+            gui_nick_color_cache_last = ptr_color->prev_color;
+        ptr_color->prev_color = NULL;
+        ptr_color->next_color = gui_nick_color_cache_first;
+        gui_nick_color_cache_first->prev_color = ptr_color;
+        gui_nick_color_cache_first = ptr_color;
+    }
+
+    return ptr_color;
+}
+
+/*
+ * Finds a color code for a nick (according to nick letters).
+ *
+ * Returns a WeeChat color code (that can be used for display).
+ */
+
+const char *
+gui_nick_find_color (const char *nickname)
+{
+    struct t_gui_nick_color *ptr_color;
+    static char color[32][32];
+    static int index_color = 0;
+
+    if (!nickname || !nickname[0])
+        return gui_color_get_custom ("default");
+
+    if (!config_nick_colors)
+        config_set_nick_colors ();
+
+    if (config_num_nick_colors == 0)
+        return gui_color_get_custom ("default");
+
+    ptr_color = gui_nick_color_get (nickname);
+    if (!ptr_color)
+        return gui_color_get_custom ("default");
+
+    /* return a copy of color (the nick color may be removed from cache) */
+    index_color = (index_color + 1) % 32;
+    memcpy (color[index_color], ptr_color->color, sizeof (color[index_color]));
+    return color[index_color];
 }
 
 /*
@@ -222,9 +358,7 @@ gui_nick_find_color (const char *nickname)
 const char *
 gui_nick_find_color_name (const char *nickname)
 {
-    int color;
-    char *nickname2;
-    const char *forced_color;
+    struct t_gui_nick_color *ptr_color;
     static char *default_color = "default";
 
     if (!nickname || !nickname[0])
@@ -236,24 +370,33 @@ gui_nick_find_color_name (const char *nickname)
     if (config_num_nick_colors == 0)
         return default_color;
 
-    nickname2 = gui_nick_strdup_for_color (nickname);
+    ptr_color = gui_nick_color_get (nickname);
 
-    /* look if color is forced */
-    forced_color = gui_nick_get_forced_color (
-        (nickname2) ? nickname2 : nickname);
-    if (forced_color)
-    {
-        if (nickname2)
-            free (nickname2);
-        return forced_color;
-    }
+    return (ptr_color) ? ptr_color->color_name : default_color;
+}
 
-    /* hash nickname to get color */
-    color = gui_nick_hash_color ((nickname2) ? nickname2 : nickname);
+/*
+ * Clears cache of nick colors (called when options used to compute colors
+ * are changed).
+ */
 
-    if (nickname2)
-        free (nickname2);
+void
+gui_nick_color_cache_clear ()
+{
+    if (gui_nick_color_cache)
+        hashtable_remove_all (gui_nick_color_cache);
+}
 
-    /* return color name */
-    return config_nick_colors[color];
+/*
+ * Ends nick functions.
+ */
+
+void
+gui_nick_end ()
+{
+    if (gui_nick_color_cache)
+    {
+        hashtable_free (gui_nick_color_cache);
+        gui_nick_color_cache = NULL;
+    }
 }
@@ -20,7 +20,29 @@
 #ifndef WEECHAT_GUI_NICK_H
 #define WEECHAT_GUI_NICK_H 1
 
+#define GUI_NICK_COLOR_CACHE_SIZE 256
+
+/* cache of nick colors (most recently used first) */
+
+struct t_gui_nick_color
+{
+    char *nickname;                    /* nickname                          */
+    const char *color_name;            /* color name (forced or from hash)  */
+    char color[32];                    /* color (result of                  */
+                                       /* gui_color_get_custom)             */
+    struct t_gui_nick_color *prev_color; /* link to previous color          */
+    struct t_gui_nick_color *next_color; /* link to next color              */
+};
+
+/* nick variables */
+
+extern struct t_hashtable *gui_nick_color_cache;
+
+/* nick functions */
+
 extern const char *gui_nick_find_color (const char *nickname);
 extern const char *gui_nick_find_color_name (const char *nickname);
+extern void gui_nick_color_cache_clear ();
+extern void gui_nick_end ();
 
 #endif /* WEECHAT_GUI_NICK_H */
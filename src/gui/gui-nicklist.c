@@ -48,9 +48,6 @@
 #include "gui-color.h"
 
 
-struct t_hashtable *gui_nicklist_hsignal = NULL;
-
-
 /*
  * Sends a signal when something has changed in nicklist.
  */
@@ -93,28 +90,62 @@ gui_nicklist_send_hsignal (const char *signal, struct t_gui_buffer *buffer,
                            struct t_gui_nick_group *group,
                            struct t_gui_nick *nick)
 {
-    if (!gui_nicklist_hsignal)
-    {
-        gui_nicklist_hsignal = hashtable_new (32,
-                                              WEECHAT_HASHTABLE_STRING,
-                                              WEECHAT_HASHTABLE_POINTER,
-                                              NULL, NULL);
-    }
+    struct t_hashtable *hashtable;
 
-    if (!gui_nicklist_hsignal)
+    hashtable = hashtable_pool_get (32,
+                                    WEECHAT_HASHTABLE_STRING,
+                                    WEECHAT_HASHTABLE_POINTER);
+    if (!hashtable)
         return;
 
-    hashtable_remove_all (gui_nicklist_hsignal);
-
-    hashtable_set (gui_nicklist_hsignal, "buffer", buffer);
-    hashtable_set (gui_nicklist_hsignal, "parent_group",
+    hashtable_set (hashtable, "buffer", buffer);
+    hashtable_set (hashtable, "parent_group",
                    (group) ? group->parent : nick->group);
     if (group)
-        hashtable_set (gui_nicklist_hsignal, "group", group);
+        hashtable_set (hashtable, "group", group);
     if (nick)
-        hashtable_set (gui_nicklist_hsignal, "nick", nick);
+        hashtable_set (hashtable, "nick", nick);
 
-    (void) hook_hsignal_send (signal, gui_nicklist_hsignal);
+    (void) hook_hsignal_send (signal, hashtable);
+
+    hashtable_pool_release (hashtable);
+}
+
+/*
+ * Adds a group or a nick in an index of nicklist.
+ *
+ * If the name is already in index, the pointer is set to NULL: the index can
+ * not be used any more for this name and the nicklist is searched instead.
+ *
+ * If the index can not be updated, it is destroyed (so the nicklist is always
+ * searched).
+ */
+
+void
+gui_nicklist_index_add (struct t_hashtable **index, const char *name,
+                        void *pointer)
+{
+    if (!*index)
+        return;
+
+    if (!hashtable_set (*index, name,
+                        (hashtable_has_key (*index, name)) ? NULL : pointer))
+    {
+        hashtable_free (*index);
+        *index = NULL;
+    }
+}
+
+/*
+ * Removes a group or a nick from an index of nicklist.
+ */
+
+void
+gui_nicklist_index_remove (struct t_hashtable *index, const char *name,
+                           void *pointer)
+{
+    if (index && (hashtable_get (index, name) == pointer))
+        hashtable_remove (index, name);
 }
 
 /*
@@ -229,9 +260,46 @@ gui_nicklist_search_group_internal (struct t_gui_buffer *buffer,
     return NULL;
 }
 
+/*
+ * Checks if a group is found by a search in nicklist starting at
+ * "from_group": the group is "from_group", one of its next groups, or a
+ * group found the same way from first child of "from_group".
+ *
+ * Returns:
+ *   1: group is found by the search
+ *   0: group is not found by the search
+ */
+
+int
+gui_nicklist_group_is_searched (struct t_gui_buffer *buffer,
+                                struct t_gui_nick_group *from_group,
+                                struct t_gui_nick_group *group)
+{
+    struct t_gui_nick_group *ptr_group;
+
+    if (!from_group)
+        from_group = buffer->nicklist_root;
+
+    while (from_group)
+    {
+        for (ptr_group = from_group; ptr_group;
+             ptr_group = ptr_group->next_group)
+        {
+            if (ptr_group == group)
+                return 1;
+        }
+        from_group = from_group->children;
+    }
+
+    return 0;
+}
+
 /*
  * Searches for a group in nicklist.
  *
+ * If the name of group does not begin with digits and '|', the digits and '|'
+ * are ignored in names of groups.
+ *
  * Returns pointer to group found, NULL if not found.
  */
 
@@ -240,10 +308,34 @@ gui_nicklist_search_group (struct t_gui_buffer *buffer,
                            struct t_gui_nick_group *from_group,
                            const char *name)
 {
+    struct t_hashtable_item *ptr_item;
+    struct t_gui_nick_group *ptr_group;
     const char *ptr_name;
 
     ptr_name = gui_nicklist_get_group_start (name);
 
+    if (buffer && buffer->nicklist_groups_index)
+    {
+        /*
+         * the index contains the groups by name without digits, so a single
+         * group can match the name (or the index has a NULL pointer if
+         * there are many groups with this name: the nicklist is searched)
+         */
+        ptr_item = hashtable_get_item (buffer->nicklist_groups_index,
+                                       ptr_name, NULL);
+        if (!ptr_item)
+            return NULL;
+        ptr_group = (struct t_gui_nick_group *)ptr_item->value;
+        if (ptr_group)
+        {
+            if ((ptr_name != name) && (strcmp (ptr_group->name, name) != 0))
+                return NULL;
+            return (gui_nicklist_group_is_searched (buffer, from_group,
+                                                    ptr_group)) ?
+                ptr_group : NULL;
+        }
+    }
+
     return gui_nicklist_search_group_internal (buffer, from_group, name,
                                                (ptr_name == name) ? 1 : 0);
 }
@@ -277,6 +369,10 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
     new_group->last_child = NULL;
     new_group->nicks = NULL;
     new_group->last_nick = NULL;
+    new_group->sorted_nicks = NULL;
+    new_group->sorted_nicks_count = 0;
+    new_group->sorted_nicks_size = 0;
+    new_group->nicks_unsorted = 0;
     new_group->prev_group = NULL;
     new_group->next_group = NULL;
 
@@ -293,6 +389,10 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
         buffer->nicklist_root = new_group;
     }
 
+    gui_nicklist_index_add (&buffer->nicklist_groups_index,
+                            gui_nicklist_get_group_start (new_group->name),
+                            new_group);
+
     if (buffer->nicklist_display_groups && visible)
         buffer->nicklist_visible_count++;
 
@@ -303,30 +403,69 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
 }
 
 /*
- * Searches for position of a nick (to keep nicklist sorted).
+ * Searches for position of a nick in sorted nicks of a group (to keep
+ * nicklist sorted).
+ *
+ * Returns index of first nick greater than the nick (or number of nicks in
+ * group if nick will be inserted at end of list).
  */
 
-struct t_gui_nick *
+int
 gui_nicklist_find_pos_nick (struct t_gui_nick_group *group,
                             struct t_gui_nick *nick)
 {
-    struct t_gui_nick *ptr_nick;
+    int low, high, middle;
 
-    if (!group)
-        return NULL;
-
-    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    low = 0;
+    high = group->sorted_nicks_count;
+    while (low < high)
     {
-        if (string_strcasecmp (nick->name, ptr_nick->name) < 0)
-            return ptr_nick;
+        middle = low + ((high - low) / 2);
+        if (string_strcasecmp (nick->name,
+                               group->sorted_nicks[middle]->name) < 0)
+            high = middle;
+        else
+            low = middle + 1;
     }
 
-    /* nick will be inserted at end of list */
-    return NULL;
+    return low;
+}
+
+/*
+ * Allocates room for one more nick in sorted nicks of a group.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_nicklist_alloc_sorted_nick (struct t_gui_nick_group *group)
+{
+    struct t_gui_nick **new_sorted_nicks;
+    int new_size;
+
+    if (group->sorted_nicks_count < group->sorted_nicks_size)
+        return 1;
+
+    new_size = (group->sorted_nicks_size > 0) ?
+        group->sorted_nicks_size * 2 : 16;
+    new_sorted_nicks = realloc (group->sorted_nicks,
+                                new_size * sizeof (*new_sorted_nicks));
+    if (!new_sorted_nicks)
+        return 0;
+
+    group->sorted_nicks = new_sorted_nicks;
+    group->sorted_nicks_size = new_size;
+
+    return 1;
 }
 
 /*
  * Inserts nick into sorted list.
+ *
+ * Room for the nick in sorted nicks of group must have been allocated with
+ * function gui_nicklist_alloc_sorted_nick.
  */
 
 void
@@ -334,50 +473,198 @@ gui_nicklist_insert_nick_sorted (struct t_gui_nick_group *group,
                                  struct t_gui_nick *nick)
 {
     struct t_gui_nick *pos_nick;
+    int pos;
+
+    pos = gui_nicklist_find_pos_nick (group, nick);
+    pos_nick = (pos < group->sorted_nicks_count) ?
+        group->sorted_nicks[pos] : NULL;
+
+    if (pos_nick)
+    {
+        /* insert nick into the list (before nick found) */
+        nick->prev_nick = pos_nick->prev_nick;
+        nick->next_nick = pos_nick;
+        if (pos_nick->prev_nick)
+            (pos_nick->prev_nick)->next_nick = nick;
+        else
+            group->nicks = nick;
+        pos_nick->prev_nick = nick;
+        memmove (group->sorted_nicks + pos + 1,
+                 group->sorted_nicks + pos,
+                 (group->sorted_nicks_count - pos) *
+                 sizeof (*group->sorted_nicks));
+    }
+    else
+    {
+        /* add nick to the end */
+        nick->prev_nick = group->last_nick;
+        nick->next_nick = NULL;
+        if (group->last_nick)
+            group->last_nick->next_nick = nick;
+        else
+            group->nicks = nick;
+        group->last_nick = nick;
+    }
+
+    group->sorted_nicks[pos] = nick;
+    group->sorted_nicks_count++;
+}
+
+/*
+ * Adds nick at the end of nicks of a group, without sort (used in a batch
+ * of changes in nicklist).
+ *
+ * Room for the nick in sorted nicks of group must have been allocated with
+ * function gui_nicklist_alloc_sorted_nick.
+ */
+
+void
+gui_nicklist_append_nick_unsorted (struct t_gui_nick_group *group,
+                                   struct t_gui_nick *nick)
+{
+    if (!group->nicks_unsorted
+        && group->last_nick
+        && (string_strcasecmp (nick->name, group->last_nick->name) < 0))
+    {
+        group->nicks_unsorted = 1;
+    }
+
+    nick->prev_nick = group->last_nick;
+    nick->next_nick = NULL;
+    if (group->last_nick)
+        group->last_nick->next_nick = nick;
+    else
+        group->nicks = nick;
+    group->last_nick = nick;
+
+    group->sorted_nicks[group->sorted_nicks_count] = nick;
+    group->sorted_nicks_count++;
+}
+
+/*
+ * Compares two nicks (for sort of nicks in a group).
+ */
+
+int
+gui_nicklist_sort_nicks_cmp_cb (const void *nick1, const void *nick2)
+{
+    const struct t_gui_nick *ptr_nick1, *ptr_nick2;
+    int rc;
+
+    ptr_nick1 = *((const struct t_gui_nick **)nick1);
+    ptr_nick2 = *((const struct t_gui_nick **)nick2);
+
+    rc = string_strcasecmp (ptr_nick1->name, ptr_nick2->name);
+
+    return (rc != 0) ? rc : strcmp (ptr_nick1->name, ptr_nick2->name);
+}
+
+/*
+ * Sorts nicks of a group (after nicks were added in a batch), and sorts nicks
+ * of child groups if argument "recursive" is 1.
+ */
+
+void
+gui_nicklist_sort_nicks (struct t_gui_nick_group *group, int recursive)
+{
+    struct t_gui_nick_group *ptr_group;
+    int i;
 
-    if (group->nicks)
+    if (!group)
+        return;
+
+    if (group->nicks_unsorted)
     {
-        pos_nick = gui_nicklist_find_pos_nick (group, nick);
+        qsort (group->sorted_nicks, group->sorted_nicks_count,
+               sizeof (*group->sorted_nicks),
+               &gui_nicklist_sort_nicks_cmp_cb);
 
-        if (pos_nick)
+        /* rebuild linked list of nicks */
+        for (i = 0; i < group->sorted_nicks_count; i++)
         {
-            /* insert nick into the list (before nick found) */
-            nick->prev_nick = pos_nick->prev_nick;
-            nick->next_nick = pos_nick;
-            if (pos_nick->prev_nick)
-                (pos_nick->prev_nick)->next_nick = nick;
-            else
-                group->nicks = nick;
-            pos_nick->prev_nick = nick;
+            group->sorted_nicks[i]->prev_nick = (i > 0) ?
+                group->sorted_nicks[i - 1] : NULL;
+            group->sorted_nicks[i]->next_nick =
+                (i < group->sorted_nicks_count - 1) ?
+                group->sorted_nicks[i + 1] : NULL;
         }
-        else
+        group->nicks = (group->sorted_nicks_count > 0) ?
+            group->sorted_nicks[0] : NULL;
+        group->last_nick = (group->sorted_nicks_count > 0) ?
+            group->sorted_nicks[group->sorted_nicks_count - 1] : NULL;
+
+        group->nicks_unsorted = 0;
+    }
+
+    if (recursive)
+    {
+        for (ptr_group = group->children; ptr_group;
+             ptr_group = ptr_group->next_group)
         {
-            /* add nick to the end */
-            nick->prev_nick = group->last_nick;
-            nick->next_nick = NULL;
-            group->last_nick->next_nick = nick;
-            group->last_nick = nick;
+            gui_nicklist_sort_nicks (ptr_group, 1);
         }
     }
-    else
+}
+
+/*
+ * Removes a nick from sorted nicks of its group.
+ */
+
+void
+gui_nicklist_remove_sorted_nick (struct t_gui_nick *nick)
+{
+    struct t_gui_nick_group *group;
+    int low, high, middle, pos;
+
+    group = nick->group;
+
+    /* search first nick which is not lower than the nick */
+    low = 0;
+    high = (group->nicks_unsorted) ? 0 : group->sorted_nicks_count;
+    while (low < high)
     {
-        nick->prev_nick = NULL;
-        nick->next_nick = NULL;
-        group->nicks = nick;
-        group->last_nick = nick;
+        middle = low + ((high - low) / 2);
+        if (string_strcasecmp (group->sorted_nicks[middle]->name,
+                               nick->name) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    /* many nicks can be equal (ignoring case), search the nick pointer */
+    for (pos = low; pos < group->sorted_nicks_count; pos++)
+    {
+        if (group->sorted_nicks[pos] == nick)
+            break;
+    }
+    if (pos >= group->sorted_nicks_count)
+        return;
+
+    memmove (group->sorted_nicks + pos,
+             group->sorted_nicks + pos + 1,
+             (group->sorted_nicks_count - pos - 1) *
+             sizeof (*group->sorted_nicks));
+    group->sorted_nicks_count--;
+
+    if (group->sorted_nicks_count == 0)
+    {
+        free (group->sorted_nicks);
+        group->sorted_nicks = NULL;
+        group->sorted_nicks_size = 0;
+        group->nicks_unsorted = 0;
     }
 }
 
 /*
- * Searches for a nick in nicklist.
+ * Searches for a nick in nicklist (this function must not be called directly).
  *
  * Returns pointer to nick found, NULL if not found.
  */
 
 struct t_gui_nick *
-gui_nicklist_search_nick (struct t_gui_buffer *buffer,
-                          struct t_gui_nick_group *from_group,
-                          const char *name)
+gui_nicklist_search_nick_internal (struct t_gui_buffer *buffer,
+                                   struct t_gui_nick_group *from_group,
+                                   const char *name)
 {
     struct t_gui_nick *ptr_nick;
     struct t_gui_nick_group *ptr_group;
@@ -411,7 +698,8 @@ gui_nicklist_search_nick (struct t_gui_buffer *buffer,
     for (ptr_group = (from_group) ? from_group->children : buffer->nicklist_root->children;
          ptr_group; ptr_group = ptr_group->next_group)
     {
-        ptr_nick = gui_nicklist_search_nick (buffer, ptr_group, name);
+        ptr_nick = gui_nicklist_search_nick_internal (buffer, ptr_group,
+                                                      name);
         if (ptr_nick)
             return ptr_nick;
     }
@@ -420,6 +708,67 @@ gui_nicklist_search_nick (struct t_gui_buffer *buffer,
     return NULL;
 }
 
+/*
+ * Checks if a nick is in a group or one of its child groups (if group is NULL,
+ * any nick is in the group).
+ *
+ * Returns:
+ *   1: nick is in the group
+ *   0: nick is not in the group
+ */
+
+int
+gui_nicklist_nick_is_in_group (struct t_gui_nick *nick,
+                               struct t_gui_nick_group *group)
+{
+    struct t_gui_nick_group *ptr_group;
+
+    if (!group)
+        return 1;
+
+    for (ptr_group = nick->group; ptr_group; ptr_group = ptr_group->parent)
+    {
+        if (ptr_group == group)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Searches for a nick in nicklist.
+ *
+ * Returns pointer to nick found, NULL if not found.
+ */
+
+struct t_gui_nick *
+gui_nicklist_search_nick (struct t_gui_buffer *buffer,
+                          struct t_gui_nick_group *from_group,
+                          const char *name)
+{
+    struct t_hashtable_item *ptr_item;
+    struct t_gui_nick *ptr_nick;
+
+    if (buffer && name && buffer->nicklist_nicks_index)
+    {
+        /*
+         * the index contains the nicks by name (with a NULL pointer if there
+         * are many nicks with this name: the nicklist is searched); if the
+         * buffer has a callback to compare nicks, a nick not found in index
+         * may still match, so the nicklist is searched
+         */
+        ptr_item = hashtable_get_item (buffer->nicklist_nicks_index,
+                                       name, NULL);
+        ptr_nick = (ptr_item) ? (struct t_gui_nick *)ptr_item->value : NULL;
+        if (ptr_nick && gui_nicklist_nick_is_in_group (ptr_nick, from_group))
+            return ptr_nick;
+        if (!buffer->nickcmp_callback && (!ptr_item || ptr_nick))
+            return NULL;
+    }
+
+    return gui_nicklist_search_nick_internal (buffer, from_group, name);
+}
+
 /*
  * Adds a nick to nicklist.
  *
@@ -438,18 +787,33 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     if (!buffer || !name || gui_nicklist_search_nick (buffer, NULL, name))
         return NULL;
 
+    if (!group)
+        group = buffer->nicklist_root;
+    if (!group || !gui_nicklist_alloc_sorted_nick (group))
+        return NULL;
+
     new_nick = malloc (sizeof (*new_nick));
     if (!new_nick)
         return NULL;
 
-    new_nick->group = (group) ? group : buffer->nicklist_root;
+    new_nick->group = group;
     new_nick->name = (char *)string_shared_get (name);
     new_nick->color = (color) ? (char *)string_shared_get (color) : NULL;
     new_nick->prefix = (prefix) ? (char *)string_shared_get (prefix) : NULL;
     new_nick->prefix_color = (prefix_color) ? (char *)string_shared_get (prefix_color) : NULL;
     new_nick->visible = visible;
 
-    gui_nicklist_insert_nick_sorted (new_nick->group, new_nick);
+    if (buffer->nicklist_batch)
+    {
+        gui_nicklist_append_nick_unsorted (new_nick->group, new_nick);
+    }
+    else
+    {
+        gui_nicklist_sort_nicks (new_nick->group, 0);
+        gui_nicklist_insert_nick_sorted (new_nick->group, new_nick);
+    }
+    gui_nicklist_index_add (&buffer->nicklist_nicks_index, new_nick->name,
+                            new_nick);
 
     buffer->nicklist_count++;
     buffer->nicklist_nicks_count++;
@@ -457,6 +821,13 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     if (visible)
         buffer->nicklist_visible_count++;
 
+    if (buffer->nicklist_batch)
+    {
+        /* signals are sent at the end of batch */
+        buffer->nicklist_batch_changes++;
+        return new_nick;
+    }
+
     if (CONFIG_BOOLEAN(config_look_color_nick_offline))
         gui_buffer_ask_chat_refresh (buffer, 1);
 
@@ -479,12 +850,24 @@ gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
     if (!buffer || !nick)
         return;
 
-    nick_removed = (nick->name) ? strdup (nick->name) : NULL;
-
-    gui_nicklist_send_signal ("nicklist_nick_removing", buffer, nick_removed);
-    gui_nicklist_send_hsignal ("nicklist_nick_removing", buffer, NULL, nick);
+    if (buffer->nicklist_batch)
+    {
+        /* signals are sent at the end of batch */
+        nick_removed = NULL;
+        buffer->nicklist_batch_changes++;
+    }
+    else
+    {
+        nick_removed = (nick->name) ? strdup (nick->name) : NULL;
+        gui_nicklist_send_signal ("nicklist_nick_removing", buffer,
+                                  nick_removed);
+        gui_nicklist_send_hsignal ("nicklist_nick_removing", buffer,
+                                   NULL, nick);
+    }
 
     /* remove nick from list */
+    gui_nicklist_index_remove (buffer->nicklist_nicks_index, nick->name, nick);
+    gui_nicklist_remove_sorted_nick (nick);
     if (nick->prev_nick)
         (nick->prev_nick)->next_nick = nick->next_nick;
     if (nick->next_nick)
@@ -515,6 +898,9 @@ gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
 
     free (nick);
 
+    if (buffer->nicklist_batch)
+        return;
+
     if (CONFIG_BOOLEAN(config_look_color_nick_offline))
         gui_buffer_ask_chat_refresh (buffer, 1);
 
@@ -554,6 +940,10 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
     gui_nicklist_send_signal ("nicklist_group_removing", buffer, group_removed);
     gui_nicklist_send_hsignal ("nicklist_group_removing", buffer, group, NULL);
 
+    gui_nicklist_index_remove (buffer->nicklist_groups_index,
+                               gui_nicklist_get_group_start (group->name),
+                               group);
+
     if (group->parent)
     {
         /* remove group from list */
@@ -579,6 +969,8 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
         string_shared_free (group->name);
     if (group->color)
         string_shared_free (group->color);
+    if (group->sorted_nicks)
+        free (group->sorted_nicks);
 
     if (group->visible)
     {
@@ -618,6 +1010,48 @@ gui_nicklist_remove_all (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Starts or ends a batch of changes in nicklist.
+ *
+ * During a batch, nicks are added without sort and no signal is sent for
+ * nicks added or changed; at the end of batch, nicks are sorted and a single
+ * signal "nicklist_batch_end" is sent (if nicks were added, changed or
+ * removed).
+ */
+
+void
+gui_nicklist_set_batch (struct t_gui_buffer *buffer, int batch)
+{
+    if (!buffer)
+        return;
+
+    if (batch)
+    {
+        buffer->nicklist_batch = 1;
+        return;
+    }
+
+    if (!buffer->nicklist_batch)
+        return;
+
+    buffer->nicklist_batch = 0;
+
+    gui_nicklist_sort_nicks (buffer->nicklist_root, 1);
+
+    if (buffer->nicklist_batch_changes > 0)
+    {
+        buffer->nicklist_batch_changes = 0;
+        if (CONFIG_BOOLEAN(config_look_color_nick_offline))
+            gui_buffer_ask_chat_refresh (buffer, 1);
+        gui_nicklist_send_signal ("nicklist_batch_end", buffer, NULL);
+        if (buffer->nicklist_root)
+        {
+            gui_nicklist_send_hsignal ("nicklist_batch_end", buffer,
+                                       buffer->nicklist_root, NULL);
+        }
+    }
+}
+
 /*
  * Gets next item (group or nick) of a group/nick.
  */
@@ -1023,7 +1457,12 @@ gui_nicklist_nick_set (struct t_gui_buffer *buffer,
         nick_changed = 1;
     }
 
-    if (nick_changed)
+    if (nick_changed && buffer->nicklist_batch)
+    {
+        /* signals are sent at the end of batch */
+        buffer->nicklist_batch_changes++;
+    }
+    else if (nick_changed)
     {
         gui_nicklist_send_signal ("nicklist_nick_changed", buffer,
                                   nick->name);
@@ -1031,6 +1470,39 @@ gui_nicklist_nick_set (struct t_gui_buffer *buffer,
     }
 }
 
+/*
+ * Returns memory used by a group (in bytes), with its nicks and subgroups.
+ *
+ * Note: shared strings (names, colors and prefixes) are not counted.
+ */
+
+long
+gui_nicklist_get_memory (struct t_gui_nick_group *group)
+{
+    struct t_gui_nick_group *ptr_group;
+    struct t_gui_nick *ptr_nick;
+    long size;
+
+    if (!group)
+        return 0;
+
+    size = sizeof (*group)
+        + (group->sorted_nicks_size * sizeof (struct t_gui_nick *));
+
+    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        size += sizeof (*ptr_nick);
+    }
+
+    for (ptr_group = group->children; ptr_group;
+         ptr_group = ptr_group->next_group)
+    {
+        size += gui_nicklist_get_memory (ptr_group);
+    }
+
+    return size;
+}
+
 /*
  * Returns hdata for nick_group.
  */
@@ -1276,6 +1748,22 @@ gui_nicklist_print_log (struct t_gui_nick_group *group, int indent)
               "%%-%dslast_nick . : 0x%%lx",
               (indent * 2) + 6);
     log_printf (format, " ", group->last_nick);
+    snprintf (format, sizeof (format),
+              "%%-%dssorted_nicks: 0x%%lx",
+              (indent * 2) + 6);
+    log_printf (format, " ", group->sorted_nicks);
+    snprintf (format, sizeof (format),
+              "%%-%dssorted_count: %%d",
+              (indent * 2) + 6);
+    log_printf (format, " ", group->sorted_nicks_count);
+    snprintf (format, sizeof (format),
+              "%%-%dssorted_size : %%d",
+              (indent * 2) + 6);
+    log_printf (format, " ", group->sorted_nicks_size);
+    snprintf (format, sizeof (format),
+              "%%-%dsnicks_unsort: %%d",
+              (indent * 2) + 6);
+    log_printf (format, " ", group->nicks_unsorted);
     snprintf (format, sizeof (format),
               "%%-%dsprev_group. : 0x%%lx",
               (indent * 2) + 6);
@@ -1337,17 +1825,3 @@ gui_nicklist_print_log (struct t_gui_nick_group *group, int indent)
         log_printf (format, " ", ptr_nick->next_nick);
     }
 }
-
-/*
- * Frees all allocated data.
- */
-
-void
-gui_nicklist_end ()
-{
-    if (gui_nicklist_hsignal)
-    {
-        hashtable_free (gui_nicklist_hsignal);
-        gui_nicklist_hsignal = NULL;
-    }
-}
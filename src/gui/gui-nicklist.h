@@ -34,6 +34,12 @@ struct t_gui_nick_group
     struct t_gui_nick_group *last_child; /* last child                      */
     struct t_gui_nick *nicks;          /* nicks for group                   */
     struct t_gui_nick *last_nick;      /* last nick for group               */
+    struct t_gui_nick **sorted_nicks;  /* nicks sorted by name (used to     */
+                                       /* find position of a new nick)      */
+    int sorted_nicks_count;            /* number of nicks in sorted_nicks   */
+    int sorted_nicks_size;             /* allocated size of sorted_nicks    */
+    int nicks_unsorted;                /* 1 if nicks were added in a batch  */
+                                       /* (sorted at the end of batch)      */
     struct t_gui_nick_group *prev_group; /* link to previous group          */
     struct t_gui_nick_group *next_group; /* link to next group              */
 };
@@ -75,6 +81,7 @@ extern void gui_nicklist_remove_group (struct t_gui_buffer *buffer,
 extern void gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
                                       struct t_gui_nick *nick);
 extern void gui_nicklist_remove_all (struct t_gui_buffer *buffer);
+extern void gui_nicklist_set_batch (struct t_gui_buffer *buffer, int batch);
 extern void gui_nicklist_get_next_item (struct t_gui_buffer *buffer,
                                         struct t_gui_nick_group **group,
                                         struct t_gui_nick **nick);
@@ -108,6 +115,7 @@ extern void *gui_nicklist_nick_get_pointer (struct t_gui_buffer *buffer,
 extern void gui_nicklist_nick_set (struct t_gui_buffer *buffer,
                                    struct t_gui_nick *nick,
                                    const char *property, const char *value);
+extern long gui_nicklist_get_memory (struct t_gui_nick_group *group);
 extern struct t_hdata *gui_nicklist_hdata_nick_group_cb (const void *pointer,
                                                          void *data,
                                                          const char *hdata_name);
@@ -118,6 +126,5 @@ extern int gui_nicklist_add_to_infolist (struct t_infolist *infolist,
                                          struct t_gui_buffer *buffer,
                                          const char *name);
 extern void gui_nicklist_print_log (struct t_gui_nick_group *group, int indent);
-extern void gui_nicklist_end ();
 
 #endif /* WEECHAT_GUI_NICKLIST_H */
@@ -0,0 +1,786 @@
+/*
+ * gui-search.c - search of text in lines of all buffers (used by all GUI)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A search is done in 3 steps:
+ *
+ * 1. main thread: the lines of buffers (matching buffers, tags and date) are
+ *    copied: messages in a single block of memory, prefixes are shared
+ *    strings (a reference is kept); lines of buffers can then be modified or
+ *    freed during the search without any impact on threads
+ * 2. threads: the lines copied are split in chunks, each thread takes the
+ *    next chunk not yet searched and marks lines found in array "matches",
+ *    then notifies the main thread (with an async event)
+ * 3. main thread: the chunks searched are displayed in order in the buffer
+ *    "search", and when all threads have finished, the search is freed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <regex.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "../core/weechat.h"
+#include "../core/wee-async.h"
+#include "../core/wee-string.h"
+#include "../core/wee-util.h"
+#include "../plugins/plugin.h"
+#include "gui-search.h"
+#include "gui-buffer.h"
+#include "gui-chat.h"
+#include "gui-color.h"
+#include "gui-line.h"
+#include "gui-window.h"
+
+
+struct t_gui_search *gui_search_current = NULL;   /* search in progress     */
+
+
+/*
+ * Callback called when the buffer "search" is closed.
+ */
+
+int
+gui_search_buffer_close_cb (const void *pointer, void *data,
+                            struct t_gui_buffer *buffer)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    if (gui_search_current && (gui_search_current->buffer == buffer))
+    {
+        gui_search_current->buffer = NULL;
+        gui_search_stop ();
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Gets the buffer "search" (creates it if needed).
+ *
+ * Returns pointer to buffer, NULL if error.
+ */
+
+struct t_gui_buffer *
+gui_search_get_buffer ()
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    ptr_buffer = gui_buffer_search_by_name (PLUGIN_CORE,
+                                            GUI_SEARCH_BUFFER_NAME);
+    if (ptr_buffer)
+        return ptr_buffer;
+
+    ptr_buffer = gui_buffer_new (NULL, GUI_SEARCH_BUFFER_NAME,
+                                 NULL, NULL, NULL,
+                                 &gui_search_buffer_close_cb, NULL, NULL);
+    if (ptr_buffer)
+        gui_buffer_set_title (ptr_buffer, _("WeeChat search results"));
+
+    return ptr_buffer;
+}
+
+/*
+ * Adds a line in the search (copy of prefix and message).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_search_add_line (struct t_gui_search *search, int buffer_index,
+                     struct t_gui_line_data *line_data)
+{
+    struct t_gui_search_line *new_lines;
+    char *new_block;
+    size_t length, new_size;
+    int new_lines_size;
+
+    if (search->lines_count >= search->lines_size)
+    {
+        new_lines_size = (search->lines_size > 0) ?
+            search->lines_size * 2 : 1024;
+        new_lines = realloc (search->lines,
+                             new_lines_size * sizeof (*new_lines));
+        if (!new_lines)
+            return 0;
+        search->lines = new_lines;
+        search->lines_size = new_lines_size;
+    }
+
+    length = (line_data->message) ? strlen (line_data->message) + 1 : 1;
+    if (search->block_used + length > search->block_size)
+    {
+        new_size = (search->block_size > 0) ? search->block_size : 65536;
+        while (search->block_used + length > new_size)
+        {
+            new_size *= 2;
+        }
+        new_block = realloc (search->block, new_size);
+        if (!new_block)
+            return 0;
+        search->block = new_block;
+        search->block_size = new_size;
+    }
+
+    if (line_data->message)
+        memcpy (search->block + search->block_used, line_data->message, length);
+    else
+        search->block[search->block_used] = '\0';
+
+    search->lines[search->lines_count].buffer_index = buffer_index;
+    search->lines[search->lines_count].date = line_data->date;
+    search->lines[search->lines_count].prefix = (line_data->prefix) ?
+        string_shared_get (line_data->prefix) : NULL;
+    search->lines[search->lines_count].message = search->block_used;
+    search->block_used += length;
+    search->lines_count++;
+
+    return 1;
+}
+
+/*
+ * Copies lines of buffers in the search.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+gui_search_copy_lines (struct t_gui_search *search, const char *buffers,
+                       const char *tags, time_t since)
+{
+    struct t_gui_buffer *ptr_buffer;
+    struct t_gui_line *ptr_line;
+    char **tags_split, ***tags_array, **new_buffers;
+    int i, rc, tags_count, buffer_index;
+
+    rc = 1;
+
+    tags_count = 0;
+    tags_array = NULL;
+    if (tags && tags[0])
+    {
+        tags_split = string_split (tags, ",", 0, 0, &tags_count);
+        if (tags_split)
+        {
+            tags_array = malloc (tags_count * sizeof (*tags_array));
+            if (tags_array)
+            {
+                for (i = 0; i < tags_count; i++)
+                {
+                    tags_array[i] = string_split_shared (tags_split[i],
+                                                         "+", 0, 0, NULL);
+                }
+            }
+            string_free_split (tags_split);
+        }
+        if (!tags_array)
+            return 0;
+    }
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        if ((ptr_buffer->type != GUI_BUFFER_TYPE_FORMATTED)
+            || (ptr_buffer == search->buffer)
+            || !ptr_buffer->own_lines
+            || !ptr_buffer->own_lines->first_line)
+        {
+            continue;
+        }
+        if (buffers && buffers[0]
+            && !gui_buffer_match_list (ptr_buffer, buffers))
+        {
+            continue;
+        }
+
+        buffer_index = -1;
+        for (ptr_line = ptr_buffer->own_lines->first_line; ptr_line;
+             ptr_line = ptr_line->next_line)
+        {
+            if ((since > 0) && (ptr_line->data->date < since))
+                continue;
+            if (tags_array
+                && !gui_line_match_tags (ptr_line->data, tags_count,
+                                         tags_array))
+            {
+                continue;
+            }
+            if (buffer_index < 0)
+            {
+                new_buffers = realloc (search->buffers,
+                                       (search->buffers_count + 1) *
+                                       sizeof (*new_buffers));
+                if (!new_buffers)
+                {
+                    rc = 0;
+                    goto end;
+                }
+                search->buffers = new_buffers;
+                search->buffers[search->buffers_count] =
+                    strdup (ptr_buffer->full_name);
+                if (!search->buffers[search->buffers_count])
+                {
+                    rc = 0;
+                    goto end;
+                }
+                buffer_index = search->buffers_count;
+                search->buffers_count++;
+            }
+            if (!gui_search_add_line (search, buffer_index, ptr_line->data))
+            {
+                rc = 0;
+                goto end;
+            }
+        }
+    }
+
+end:
+    if (tags_array)
+    {
+        for (i = 0; i < tags_count; i++)
+        {
+            string_free_split_shared (tags_array[i]);
+        }
+        free (tags_array);
+    }
+
+    return rc;
+}
+
+/*
+ * Checks if a string matches the text searched.
+ *
+ * This function is called by threads: it must not use any global variable
+ * (string_regexec is thread-safe).
+ *
+ * Returns:
+ *   1: string matches text
+ *   0: string does not match text
+ */
+
+int
+gui_search_match_string (struct t_gui_search *search, const char *string)
+{
+    char *string_no_color;
+    int match;
+
+    if (!string || !string[0])
+        return 0;
+
+    string_no_color = gui_color_decode (string, NULL);
+    if (!string_no_color)
+        return 0;
+
+    if (search->regex)
+    {
+        match = (string_regexec (&search->regex_compiled, string_no_color,
+                                 0, NULL, 0) == 0) ? 1 : 0;
+    }
+    else if (search->case_sensitive)
+    {
+        match = (strstr (string_no_color, search->text)) ? 1 : 0;
+    }
+    else
+    {
+        match = (string_strcasestr (string_no_color, search->text)) ? 1 : 0;
+    }
+
+    free (string_no_color);
+
+    return match;
+}
+
+/*
+ * Searches text in lines of a chunk.
+ *
+ * This function is called by threads: it must not use any global variable.
+ */
+
+void
+gui_search_chunk (struct t_gui_search *search, int chunk)
+{
+    int i, start, end;
+
+    start = chunk * GUI_SEARCH_CHUNK_LINES;
+    end = start + GUI_SEARCH_CHUNK_LINES;
+    if (end > search->lines_count)
+        end = search->lines_count;
+
+    for (i = start; i < end; i++)
+    {
+        search->matches[i] =
+            (gui_search_match_string (search, search->lines[i].prefix)
+             || gui_search_match_string (search,
+                                         search->block + search->lines[i].message)) ?
+            1 : 0;
+    }
+}
+
+/*
+ * Frees a search.
+ *
+ * Threads of search must have been joined before calling this function.
+ */
+
+void
+gui_search_free (struct t_gui_search *search)
+{
+    int i;
+
+    if (!search)
+        return;
+
+    if (search->text)
+        free (search->text);
+    if (search->regex)
+        string_regfree (&search->regex_compiled);
+    if (search->buffers)
+    {
+        for (i = 0; i < search->buffers_count; i++)
+        {
+            if (search->buffers[i])
+                free (search->buffers[i]);
+        }
+        free (search->buffers);
+    }
+    if (search->lines)
+    {
+        for (i = 0; i < search->lines_count; i++)
+        {
+            if (search->lines[i].prefix)
+                string_shared_free (search->lines[i].prefix);
+        }
+        free (search->lines);
+    }
+    if (search->block)
+        free (search->block);
+    if (search->matches)
+        free (search->matches);
+    if (search->chunks_done)
+        free (search->chunks_done);
+    if (search->threads)
+        free (search->threads);
+    if (search->buffers_found)
+        free (search->buffers_found);
+    pthread_mutex_destroy (&search->mutex);
+
+    free (search);
+}
+
+/*
+ * Waits for end of threads of current search.
+ */
+
+void
+gui_search_join_threads (struct t_gui_search *search)
+{
+    int i;
+
+    for (i = 0; i < search->threads_count; i++)
+    {
+        pthread_join (search->threads[i], NULL);
+    }
+    search->threads_count = 0;
+}
+
+/*
+ * Displays lines found in chunks searched (in order of chunks).
+ */
+
+void
+gui_search_display_chunks (struct t_gui_search *search)
+{
+    struct t_gui_search_line *ptr_line;
+    int i, chunk, start, end;
+
+    if (!search->buffer)
+        return;
+
+    gui_line_set_batch (search->buffer, 1);
+
+    while (1)
+    {
+        chunk = search->chunks_displayed;
+        if (chunk >= search->chunks_count)
+            break;
+        pthread_mutex_lock (&search->mutex);
+        if (!search->chunks_done[chunk])
+        {
+            pthread_mutex_unlock (&search->mutex);
+            break;
+        }
+        pthread_mutex_unlock (&search->mutex);
+
+        start = chunk * GUI_SEARCH_CHUNK_LINES;
+        end = start + GUI_SEARCH_CHUNK_LINES;
+        if (end > search->lines_count)
+            end = search->lines_count;
+        for (i = start; i < end; i++)
+        {
+            if (!search->matches[i])
+                continue;
+            ptr_line = &search->lines[i];
+            gui_chat_printf_date_tags (
+                search->buffer,
+                ptr_line->date,
+                "no_highlight,no_log,notify_none",
+                "%s\t%s%s%s: %s",
+                (ptr_line->prefix) ? ptr_line->prefix : "",
+                GUI_COLOR(GUI_COLOR_CHAT_BUFFER),
+                search->buffers[ptr_line->buffer_index],
+                GUI_COLOR(GUI_COLOR_CHAT),
+                search->block + ptr_line->message);
+            search->lines_found++;
+            search->buffers_found[ptr_line->buffer_index] = 1;
+        }
+
+        search->chunks_displayed++;
+    }
+
+    gui_line_set_batch (search->buffer, 0);
+}
+
+/*
+ * Displays end of search (number of lines found and time elapsed).
+ */
+
+void
+gui_search_display_end (struct t_gui_search *search)
+{
+    struct timeval tv_now;
+    long long diff;
+    int i, buffers_found;
+
+    if (!search->buffer)
+        return;
+
+    buffers_found = 0;
+    for (i = 0; i < search->buffers_count; i++)
+    {
+        if (search->buffers_found[i])
+            buffers_found++;
+    }
+
+    gettimeofday (&tv_now, NULL);
+    diff = util_timeval_diff (&search->start_time, &tv_now);
+
+    gui_chat_printf_date_tags (
+        search->buffer, 0, "no_highlight,no_log,notify_none",
+        _("%s%d lines found in %d buffers (%d lines searched in %d "
+          "buffers, %lld.%03lld seconds, %d threads)"),
+        gui_chat_prefix[GUI_CHAT_PREFIX_NETWORK],
+        search->lines_found,
+        buffers_found,
+        search->lines_count,
+        search->buffers_count,
+        diff / 1000000,
+        (diff % 1000000) / 1000,
+        search->threads_count);
+}
+
+/*
+ * Callback for async event posted by threads: displays chunks searched and
+ * ends the search when all threads have finished.
+ */
+
+int
+gui_search_async_cb (const void *pointer, void *data)
+{
+    struct t_gui_search *search;
+    int threads_running;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    search = gui_search_current;
+    if (!search)
+        return WEECHAT_RC_OK;
+
+    pthread_mutex_lock (&search->mutex);
+    search->notify_pending = 0;
+    threads_running = search->threads_running;
+    pthread_mutex_unlock (&search->mutex);
+
+    gui_search_display_chunks (search);
+
+    if (threads_running == 0)
+    {
+        gui_search_display_end (search);
+        gui_search_join_threads (search);
+        gui_search_current = NULL;
+        gui_search_free (search);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Notifies main thread that some chunks have been searched.
+ *
+ * Mutex of search must be locked by the caller.
+ */
+
+void
+gui_search_notify (struct t_gui_search *search)
+{
+    if (!search->notify_pending)
+    {
+        if (async_post (NULL, &gui_search_async_cb, NULL, NULL))
+            search->notify_pending = 1;
+    }
+}
+
+/*
+ * Searches text in chunks of lines, until there are no more chunks (or until
+ * the search is cancelled).
+ *
+ * This function is the main function of threads (it is called directly by
+ * the main thread if no thread could be created).
+ */
+
+void *
+gui_search_worker (void *arg)
+{
+    struct t_gui_search *search;
+    int chunk;
+
+    search = (struct t_gui_search *)arg;
+
+    while (1)
+    {
+        pthread_mutex_lock (&search->mutex);
+        if (search->cancel || (search->next_chunk >= search->chunks_count))
+        {
+            pthread_mutex_unlock (&search->mutex);
+            break;
+        }
+        chunk = search->next_chunk;
+        search->next_chunk++;
+        pthread_mutex_unlock (&search->mutex);
+
+        gui_search_chunk (search, chunk);
+
+        pthread_mutex_lock (&search->mutex);
+        search->chunks_done[chunk] = 1;
+        gui_search_notify (search);
+        pthread_mutex_unlock (&search->mutex);
+    }
+
+    pthread_mutex_lock (&search->mutex);
+    search->threads_running--;
+    gui_search_notify (search);
+    pthread_mutex_unlock (&search->mutex);
+
+    return NULL;
+}
+
+/*
+ * Starts a search of text in lines of buffers.
+ *
+ * Argument "buffers" is a comma-separated list of buffers (see function
+ * gui_buffer_match_list), "tags" a comma-separated list of tags (with "+" for
+ * a logical "and" between tags, like filters) and "since" is the minimum date
+ * of lines (0 for all lines).
+ *
+ * Results are displayed in buffer "search", which is displayed in current
+ * window.
+ *
+ * Returns:
+ *   1: search started
+ *   0: error (invalid regex or not enough memory)
+ */
+
+int
+gui_search_start (const char *text, const char *buffers, const char *tags,
+                  time_t since, int case_sensitive, int regex)
+{
+    struct t_gui_search *new_search;
+    int i, threads;
+    long cpus;
+
+    if (!text || !text[0])
+        return 0;
+
+    gui_search_stop ();
+
+    new_search = calloc (1, sizeof (*new_search));
+    if (!new_search)
+        return 0;
+
+    pthread_mutex_init (&new_search->mutex, NULL);
+    gettimeofday (&new_search->start_time, NULL);
+
+    new_search->text = strdup (text);
+    new_search->case_sensitive = case_sensitive;
+    if (!new_search->text)
+        goto error;
+    if (regex)
+    {
+        if (string_regcomp (&new_search->regex_compiled, text,
+                            REG_EXTENDED | REG_NOSUB
+                            | ((case_sensitive) ? 0 : REG_ICASE)) != 0)
+        {
+            gui_chat_printf (NULL,
+                             _("%sError: invalid regular expression (%s)"),
+                             gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                             text);
+            goto error;
+        }
+        new_search->regex = 1;
+    }
+
+    new_search->buffer = gui_search_get_buffer ();
+    if (!new_search->buffer)
+        goto error;
+    gui_buffer_clear (new_search->buffer);
+
+    if (!gui_search_copy_lines (new_search, buffers, tags, since))
+        goto error;
+
+    if (new_search->lines_count > 0)
+    {
+        new_search->matches = calloc (new_search->lines_count,
+                                      sizeof (*new_search->matches));
+        if (!new_search->matches)
+            goto error;
+    }
+    new_search->chunks_count = (new_search->lines_count +
+                                GUI_SEARCH_CHUNK_LINES - 1) /
+        GUI_SEARCH_CHUNK_LINES;
+    if (new_search->chunks_count > 0)
+    {
+        new_search->chunks_done = calloc (new_search->chunks_count,
+                                          sizeof (*new_search->chunks_done));
+        if (!new_search->chunks_done)
+            goto error;
+    }
+    if (new_search->buffers_count > 0)
+    {
+        new_search->buffers_found = calloc (
+            new_search->buffers_count,
+            sizeof (*new_search->buffers_found));
+        if (!new_search->buffers_found)
+            goto error;
+    }
+
+    cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? (int)cpus : 1;
+    if (threads > GUI_SEARCH_MAX_THREADS)
+        threads = GUI_SEARCH_MAX_THREADS;
+    if (threads > new_search->chunks_count)
+        threads = new_search->chunks_count;
+
+    gui_search_current = new_search;
+
+    gui_window_switch_to_buffer (gui_current_window, new_search->buffer, 1);
+
+    if (threads > 0)
+    {
+        new_search->threads = malloc (threads *
+                                      sizeof (*new_search->threads));
+        if (new_search->threads)
+        {
+            pthread_mutex_lock (&new_search->mutex);
+            for (i = 0; i < threads; i++)
+            {
+                if (pthread_create (&new_search->threads[i], NULL,
+                                    &gui_search_worker, new_search) != 0)
+                {
+                    break;
+                }
+                new_search->threads_count++;
+                new_search->threads_running++;
+            }
+            pthread_mutex_unlock (&new_search->mutex);
+        }
+    }
+
+    if (new_search->threads_count == 0)
+    {
+        /* no thread created: search in main thread */
+        new_search->threads_running = 1;
+        gui_search_worker (new_search);
+    }
+
+    return 1;
+
+error:
+    if (gui_search_current == new_search)
+        gui_search_current = NULL;
+    gui_search_free (new_search);
+    return 0;
+}
+
+/*
+ * Stops the current search (lines already found are kept in buffer
+ * "search").
+ *
+ * Returns:
+ *   1: search stopped
+ *   0: no search in progress
+ */
+
+int
+gui_search_stop ()
+{
+    struct t_gui_search *search;
+
+    search = gui_search_current;
+    if (!search)
+        return 0;
+
+    pthread_mutex_lock (&search->mutex);
+    search->cancel = 1;
+    pthread_mutex_unlock (&search->mutex);
+
+    gui_search_join_threads (search);
+
+    gui_search_display_chunks (search);
+
+    gui_search_current = NULL;
+    gui_search_free (search);
+
+    return 1;
+}
+
+/*
+ * Ends search (called when WeeChat is exiting).
+ */
+
+void
+gui_search_end ()
+{
+    gui_search_stop ();
+}
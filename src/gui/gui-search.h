@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_GUI_SEARCH_H
+#define WEECHAT_GUI_SEARCH_H 1
+
+#include <time.h>
+#include <regex.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#define GUI_SEARCH_BUFFER_NAME "search"
+
+/* number of lines searched by a thread before taking next chunk of lines */
+#define GUI_SEARCH_CHUNK_LINES 2048
+
+/* max number of threads for a search */
+#define GUI_SEARCH_MAX_THREADS 8
+
+/* search structures */
+
+struct t_gui_buffer;
+
+/* line copied from a buffer (message is in block of search) */
+
+struct t_gui_search_line
+{
+    int buffer_index;                  /* index in array "buffers"          */
+    time_t date;                       /* date of line                      */
+    const char *prefix;                /* prefix (shared string) or NULL    */
+    size_t message;                    /* offset of message in block        */
+};
+
+struct t_gui_search
+{
+    /* search options (read-only while threads are running) */
+    char *text;                        /* text searched                     */
+    int case_sensitive;                /* 1 if search is case sensitive     */
+    int regex;                         /* 1 if text is a regex              */
+    regex_t regex_compiled;            /* compiled regex (if regex == 1)    */
+
+    /* lines copied from buffers (read-only while threads are running) */
+    char **buffers;                    /* full names of buffers searched    */
+    int buffers_count;                 /* number of buffers                 */
+    struct t_gui_search_line *lines;   /* lines copied                      */
+    int lines_count;                   /* number of lines                   */
+    int lines_size;                    /* allocated size of "lines"         */
+    char *block;                       /* messages of lines (with colors)   */
+    size_t block_used;                 /* bytes used in block               */
+    size_t block_size;                 /* allocated size of block           */
+
+    /* result of search: each thread writes only lines of its chunks */
+    char *matches;                     /* 1 byte per line: 1 if found       */
+
+    /* progress (protected by mutex) */
+    pthread_mutex_t mutex;             /* mutex for variables below         */
+    int chunks_count;                  /* number of chunks of lines         */
+    int next_chunk;                    /* next chunk to search              */
+    char *chunks_done;                 /* 1 byte per chunk: 1 if searched   */
+    int threads_running;               /* number of threads running         */
+    int cancel;                        /* 1 if search is cancelled          */
+    int notify_pending;                /* 1 if main thread is notified      */
+
+    /* threads */
+    pthread_t *threads;                /* threads searching lines           */
+    int threads_count;                 /* number of threads started         */
+
+    /* display of results (main thread only) */
+    struct t_gui_buffer *buffer;       /* buffer with results               */
+    int chunks_displayed;              /* number of chunks displayed        */
+    int lines_found;                   /* number of lines found             */
+    char *buffers_found;               /* 1 byte per buffer: 1 if found     */
+    struct timeval start_time;         /* start of search                   */
+};
+
+/* search variables */
+
+extern struct t_gui_search *gui_search_current;
+
+/* search functions */
+
+extern int gui_search_start (const char *text, const char *buffers,
+                             const char *tags, time_t since,
+                             int case_sensitive, int regex);
+extern int gui_search_stop ();
+extern void gui_search_end ();
+
+#endif /* WEECHAT_GUI_SEARCH_H */
@@ -53,10 +53,15 @@
 #include "gui-hotlist.h"
 #include "gui-layout.h"
 #include "gui-line.h"
+#include "gui-line-index.h"
+#include "gui-line-scroll.h"
 
 
 int gui_init_ok = 0;                            /* = 1 if GUI is initialized*/
 int gui_window_refresh_needed = 0;              /* = 1 if refresh needed    */
+int gui_window_refresh_immediate = 0;           /* = 1 to refresh screen    */
+                                                /* now (not delayed by max  */
+                                                /* FPS, after a key)        */
                                                 /* = 2 for full refresh     */
 struct t_gui_window *gui_windows = NULL;        /* first window             */
 struct t_gui_window *last_gui_window = NULL;    /* last window              */
@@ -127,6 +132,9 @@ gui_window_search_by_xy (int x, int y)
  *   - word at (x,y)
  *   - beginning of line until (x,y)
  *   - (x,y) until end of line.
+ *
+ * If "word" is NULL, the word, beginning and end of line are not computed
+ * (they are copies of the line, so they are computed only when needed).
  */
 
 void
@@ -146,9 +154,12 @@ gui_window_get_context_at_xy (struct t_gui_window *window,
     *chat = 0;
     *line = NULL;
     *line_x = -1;
-    *word = NULL;
-    *beginning = NULL;
-    *end = NULL;
+    if (word)
+    {
+        *word = NULL;
+        *beginning = NULL;
+        *end = NULL;
+    }
 
     /* not in a window? */
     if (!window)
@@ -183,6 +194,10 @@ gui_window_get_context_at_xy (struct t_gui_window *window,
     if (!window->coords[win_y].data)
         return;
 
+    /* word, beginning and end of line not asked? */
+    if (!word)
+        return;
+
     if (win_x < window->coords_x_message)
     {
         /* X is before message (time/buffer/prefix) */
@@ -1127,11 +1142,12 @@ gui_window_scroll (struct t_gui_window *window, char *scroll)
 {
     int direction, stop, count_msg, scroll_from_end_free_buffer;
     char time_letter, saved_char;
-    time_t old_date, diff_date;
+    time_t old_date;
     char *pos, *error;
     long number;
     struct t_gui_line *ptr_line;
-    struct tm *date_tmp, line_date, old_line_date;
+    struct t_gui_line_scroll *scroll_index;
+    struct tm *date_tmp, old_line_date;
 
     if (!window || !window->buffer->lines->first_line)
         return;
@@ -1189,175 +1205,105 @@ gui_window_scroll (struct t_gui_window *window, char *scroll)
     if ((number == 0) && (time_letter == ' '))
         return;
 
+    /*
+     * it's not possible to scroll before first line of buffer on a buffer
+     * with free content
+     */
+    if ((direction < 0) && !scroll_from_end_free_buffer
+        && !window->scroll->start_line
+        && (window->buffer->type == GUI_BUFFER_TYPE_FREE))
+        return;
+
     /* do the scroll! */
-    stop = 0;
-    count_msg = 0;
-    if (direction < 0)
-    {
-        /*
-         * it's not possible to scroll before first line of buffer on a buffer
-         * with free content
-         */
-        if (!scroll_from_end_free_buffer && !window->scroll->start_line
-           && (window->buffer->type == GUI_BUFFER_TYPE_FREE))
+    ptr_line = NULL;
+    scroll_index = gui_line_scroll_build (window->buffer->lines);
+    if (scroll_index)
+    {
+        /* fast search with the index of lines */
+        stop = gui_line_scroll_search (scroll_index,
+                                       window->scroll->start_line,
+                                       direction, number, time_letter,
+                                       &ptr_line);
+        if (stop < 0)
             return;
-        ptr_line = (window->scroll->start_line) ?
-            window->scroll->start_line : window->buffer->lines->last_line;
-        while (ptr_line
-               && (!gui_line_is_displayed (ptr_line)
-                   || ((window->buffer->type == GUI_BUFFER_TYPE_FORMATTED)
-                       && (ptr_line->data->date == 0))))
-        {
-            ptr_line = ptr_line->prev_line;
-        }
     }
     else
     {
-        ptr_line = (window->scroll->start_line) ?
-            window->scroll->start_line : window->buffer->lines->first_line;
-        while (ptr_line
-               && (!gui_line_is_displayed (ptr_line)
-                   || ((window->buffer->type == GUI_BUFFER_TYPE_FORMATTED)
-                       && (ptr_line->data->date == 0))))
+        stop = 0;
+        count_msg = 0;
+        if (direction < 0)
         {
-            ptr_line = ptr_line->next_line;
+            ptr_line = (window->scroll->start_line) ?
+                window->scroll->start_line : window->buffer->lines->last_line;
+            while (ptr_line
+                   && (!gui_line_is_displayed (ptr_line)
+                       || ((window->buffer->type == GUI_BUFFER_TYPE_FORMATTED)
+                           && (ptr_line->data->date == 0))))
+            {
+                ptr_line = ptr_line->prev_line;
+            }
         }
-    }
-
-    if (ptr_line)
-    {
-        old_date = ptr_line->data->date;
-        date_tmp = localtime (&old_date);
-        if (!date_tmp)
-            return;
-        memcpy (&old_line_date, date_tmp, sizeof (struct tm));
-    }
-
-    while (ptr_line)
-    {
-        ptr_line = (direction < 0) ?
-            gui_line_get_prev_displayed (ptr_line) : gui_line_get_next_displayed (ptr_line);
-
-        if (ptr_line
-            && ((window->buffer->type != GUI_BUFFER_TYPE_FORMATTED)
-                || (ptr_line->data->date != 0)))
+        else
         {
-            if (time_letter == ' ')
+            ptr_line = (window->scroll->start_line) ?
+                window->scroll->start_line : window->buffer->lines->first_line;
+            while (ptr_line
+                   && (!gui_line_is_displayed (ptr_line)
+                       || ((window->buffer->type == GUI_BUFFER_TYPE_FORMATTED)
+                           && (ptr_line->data->date == 0))))
             {
-                count_msg++;
-                if (count_msg >= number)
-                    stop = 1;
+                ptr_line = ptr_line->next_line;
             }
-            else
+        }
+
+        if (ptr_line)
+        {
+            old_date = ptr_line->data->date;
+            date_tmp = localtime (&old_date);
+            if (!date_tmp)
+                return;
+            memcpy (&old_line_date, date_tmp, sizeof (struct tm));
+        }
+
+        while (ptr_line && !stop)
+        {
+            ptr_line = (direction < 0) ?
+                gui_line_get_prev_displayed (ptr_line) :
+                gui_line_get_next_displayed (ptr_line);
+
+            if (ptr_line
+                && ((window->buffer->type != GUI_BUFFER_TYPE_FORMATTED)
+                    || (ptr_line->data->date != 0)))
             {
-                date_tmp = localtime (&(ptr_line->data->date));
-                if (!date_tmp)
-                    return;
-                memcpy (&line_date, date_tmp, sizeof (struct tm));
-                if (old_date > ptr_line->data->date)
-                    diff_date = old_date - ptr_line->data->date;
+                if (time_letter == ' ')
+                {
+                    count_msg++;
+                    if (count_msg >= number)
+                        stop = 1;
+                }
                 else
-                    diff_date = ptr_line->data->date - old_date;
-                switch (time_letter)
                 {
-                    case 's': /* seconds */
-                        if (number == 0)
-                        {
-                            /* stop if line has different second */
-                            if ((line_date.tm_sec != old_line_date.tm_sec)
-                                || (line_date.tm_min != old_line_date.tm_min)
-                                || (line_date.tm_hour != old_line_date.tm_hour)
-                                || (line_date.tm_mday != old_line_date.tm_mday)
-                                || (line_date.tm_mon != old_line_date.tm_mon)
-                                || (line_date.tm_year != old_line_date.tm_year))
-                                if (line_date.tm_sec != old_line_date.tm_sec)
-                                    stop = 1;
-                        }
-                        else if (diff_date >= number)
-                            stop = 1;
-                        break;
-                    case 'm': /* minutes */
-                        if (number == 0)
-                        {
-                            /* stop if line has different minute */
-                            if ((line_date.tm_min != old_line_date.tm_min)
-                                || (line_date.tm_hour != old_line_date.tm_hour)
-                                || (line_date.tm_mday != old_line_date.tm_mday)
-                                || (line_date.tm_mon != old_line_date.tm_mon)
-                                || (line_date.tm_year != old_line_date.tm_year))
-                                stop = 1;
-                        }
-                        else if (diff_date >= number * 60)
-                            stop = 1;
-                        break;
-                    case 'h': /* hours */
-                        if (number == 0)
-                        {
-                            /* stop if line has different hour */
-                            if ((line_date.tm_hour != old_line_date.tm_hour)
-                                || (line_date.tm_mday != old_line_date.tm_mday)
-                                || (line_date.tm_mon != old_line_date.tm_mon)
-                                || (line_date.tm_year != old_line_date.tm_year))
-                                stop = 1;
-                        }
-                        else if (diff_date >= number * 60 * 60)
-                            stop = 1;
-                        break;
-                    case 'd': /* days */
-                        if (number == 0)
-                        {
-                            /* stop if line has different day */
-                            if ((line_date.tm_mday != old_line_date.tm_mday)
-                                || (line_date.tm_mon != old_line_date.tm_mon)
-                                || (line_date.tm_year != old_line_date.tm_year))
-                                stop = 1;
-                        }
-                        else if (diff_date >= number * 60 * 60 * 24)
-                            stop = 1;
-                        break;
-                    case 'M': /* months */
-                        if (number == 0)
-                        {
-                            /* stop if line has different month */
-                            if ((line_date.tm_mon != old_line_date.tm_mon)
-                                || (line_date.tm_year != old_line_date.tm_year))
-                                stop = 1;
-                        }
-                        /*
-                         * we consider month is 30 days, who will notice
-                         * I'm too lazy to code exact date diff ? ;)
-                         */
-                        else if (diff_date >= number * 60 * 60 * 24 * 30)
-                            stop = 1;
-                        break;
-                    case 'y': /* years */
-                        if (number == 0)
-                        {
-                            /* stop if line has different year */
-                            if (line_date.tm_year != old_line_date.tm_year)
-                                stop = 1;
-                        }
-                        /*
-                         * we consider year is 365 days, who will notice
-                         * I'm too lazy to code exact date diff ? ;)
-                         */
-                        else if (diff_date >= number * 60 * 60 * 24 * 365)
-                            stop = 1;
-                        break;
+                    stop = gui_line_scroll_date_stop (time_letter, number,
+                                                      old_date,
+                                                      &old_line_date,
+                                                      ptr_line->data->date);
+                    if (stop < 0)
+                        return;
                 }
             }
-            if (stop)
-            {
-                window->scroll->start_line = ptr_line;
-                window->scroll->start_line_pos = 0;
-                window->scroll->first_line_displayed =
-                    (window->scroll->start_line == gui_line_get_first_displayed (window->buffer));
-                gui_buffer_ask_chat_refresh (window->buffer, 2);
-                return;
-            }
         }
     }
 
+    if (stop && ptr_line)
+    {
+        window->scroll->start_line = ptr_line;
+        window->scroll->start_line_pos = 0;
+        window->scroll->first_line_displayed =
+            (window->scroll->start_line == gui_line_get_first_displayed (window->buffer));
+        gui_buffer_ask_chat_refresh (window->buffer, 2);
+        return;
+    }
+
     if (direction < 0)
     {
         gui_window_scroll_top (window);
@@ -1571,21 +1517,27 @@ gui_window_search_text (struct t_gui_window *window)
         if (window->buffer->lines->first_line
             && window->buffer->input_buffer && window->buffer->input_buffer[0])
         {
-            ptr_line = (window->scroll->start_line) ?
-                gui_line_get_prev_displayed (window->scroll->start_line) :
-                gui_line_get_last_displayed (window->buffer);
-            while (ptr_line)
+            if (!gui_line_index_search (window->buffer,
+                                        window->scroll->start_line,
+                                        1, &ptr_line))
             {
-                if (gui_line_search_text (window->buffer, ptr_line))
+                ptr_line = (window->scroll->start_line) ?
+                    gui_line_get_prev_displayed (window->scroll->start_line) :
+                    gui_line_get_last_displayed (window->buffer);
+                while (ptr_line
+                       && !gui_line_search_text (window->buffer, ptr_line))
                 {
-                    window->scroll->start_line = ptr_line;
-                    window->scroll->start_line_pos = 0;
-                    window->scroll->first_line_displayed =
-                        (window->scroll->start_line == gui_line_get_first_displayed (window->buffer));
-                    gui_buffer_ask_chat_refresh (window->buffer, 2);
-                    return 1;
+                    ptr_line = gui_line_get_prev_displayed (ptr_line);
                 }
-                ptr_line = gui_line_get_prev_displayed (ptr_line);
+            }
+            if (ptr_line)
+            {
+                window->scroll->start_line = ptr_line;
+                window->scroll->start_line_pos = 0;
+                window->scroll->first_line_displayed =
+                    (window->scroll->start_line == gui_line_get_first_displayed (window->buffer));
+                gui_buffer_ask_chat_refresh (window->buffer, 2);
+                return 1;
             }
         }
     }
@@ -1594,21 +1546,27 @@ gui_window_search_text (struct t_gui_window *window)
         if (window->buffer->lines->first_line
             && window->buffer->input_buffer && window->buffer->input_buffer[0])
         {
-            ptr_line = (window->scroll->start_line) ?
-                gui_line_get_next_displayed (window->scroll->start_line) :
-                gui_line_get_first_displayed (window->buffer);
-            while (ptr_line)
+            if (!gui_line_index_search (window->buffer,
+                                        window->scroll->start_line,
+                                        0, &ptr_line))
             {
-                if (gui_line_search_text (window->buffer, ptr_line))
+                ptr_line = (window->scroll->start_line) ?
+                    gui_line_get_next_displayed (window->scroll->start_line) :
+                    gui_line_get_first_displayed (window->buffer);
+                while (ptr_line
+                       && !gui_line_search_text (window->buffer, ptr_line))
                 {
-                    window->scroll->start_line = ptr_line;
-                    window->scroll->start_line_pos = 0;
-                    window->scroll->first_line_displayed =
-                        (window->scroll->start_line == window->buffer->lines->first_line);
-                    gui_buffer_ask_chat_refresh (window->buffer, 2);
-                    return 1;
+                    ptr_line = gui_line_get_next_displayed (ptr_line);
                 }
-                ptr_line = gui_line_get_next_displayed (ptr_line);
+            }
+            if (ptr_line)
+            {
+                window->scroll->start_line = ptr_line;
+                window->scroll->start_line_pos = 0;
+                window->scroll->first_line_displayed =
+                    (window->scroll->start_line == window->buffer->lines->first_line);
+                gui_buffer_ask_chat_refresh (window->buffer, 2);
+                return 1;
             }
         }
     }
@@ -1662,6 +1620,7 @@ gui_window_search_start (struct t_gui_window *window,
 
     window->buffer->text_search_found = 0;
     gui_input_search_compile_regex (window->buffer);
+    gui_line_index_build (window->buffer);
     if (window->buffer->text_search_input)
     {
         free (window->buffer->text_search_input);
@@ -1716,9 +1675,11 @@ gui_window_search_end (struct t_gui_window *window)
 
     window->buffer->text_search = GUI_TEXT_SEARCH_DISABLED;
     window->buffer->text_search = 0;
+    gui_line_index_free (window->buffer->own_lines);
+    gui_line_index_free (window->buffer->mixed_lines);
     if (window->buffer->text_search_regex_compiled)
     {
-        regfree (window->buffer->text_search_regex_compiled);
+        string_regfree (window->buffer->text_search_regex_compiled);
         free (window->buffer->text_search_regex_compiled);
         window->buffer->text_search_regex_compiled = NULL;
     }
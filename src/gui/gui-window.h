@@ -120,6 +120,7 @@ struct t_gui_window_tree
 
 extern int gui_init_ok;
 extern int gui_window_refresh_needed;
+extern int gui_window_refresh_immediate;
 extern struct t_gui_window *gui_windows;
 extern struct t_gui_window *last_gui_window;
 extern struct t_gui_window *gui_current_window;
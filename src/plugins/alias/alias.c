@@ -44,6 +44,7 @@ struct t_weechat_plugin *weechat_alias_plugin = NULL;
 
 struct t_alias *alias_list = NULL;
 struct t_alias *last_alias = NULL;
+struct t_hashtable *alias_hashtable = NULL; /* aliases by name (case ignored)*/
 
 
 /*
@@ -82,95 +83,99 @@ alias_valid (struct t_alias *alias)
 struct t_alias *
 alias_search (const char *alias_name)
 {
-    struct t_alias *ptr_alias;
+    if (!alias_name || !alias_hashtable)
+        return NULL;
 
-    for (ptr_alias = alias_list; ptr_alias;
-         ptr_alias = ptr_alias->next_alias)
-    {
-        if (weechat_strcasecmp (alias_name, ptr_alias->name) == 0)
-            return ptr_alias;
-    }
-    return NULL;
+    return weechat_hashtable_get (alias_hashtable, alias_name);
 }
 
 /*
- * Adds a word to string and increments length.
+ * Hashes an alias name in hashtable of aliases: the case is ignored (only
+ * for chars A-Z, as in function weechat_strcasecmp).
  */
 
-void
-alias_string_add_word (char **alias, int *length, const char *word)
+unsigned long long
+alias_hash_key_cb (struct t_hashtable *hashtable, const void *key)
 {
-    int length_word;
-    char *alias2;
+    const unsigned char *ptr_key;
+    unsigned long long hash;
 
-    if (!word)
-        return;
-
-    length_word = strlen (word);
-    if (length_word == 0)
-        return;
+    /* make C compiler happy */
+    (void) hashtable;
 
-    if (*alias == NULL)
+    /* variant of djb2 hash */
+    hash = 5381;
+    for (ptr_key = (const unsigned char *)key; ptr_key[0]; ptr_key++)
     {
-        *alias = malloc (length_word + 1);
-        strcpy (*alias, word);
+        hash ^= (hash << 5) + (hash >> 2)
+            + (((ptr_key[0] >= 'A') && (ptr_key[0] <= 'Z')) ?
+               ptr_key[0] + ('a' - 'A') : ptr_key[0]);
     }
-    else
-    {
-        alias2 = realloc (*alias, strlen (*alias) + length_word + 1);
-        if (!alias2)
-        {
-            if (*alias)
-            {
-                free (*alias);
-                *alias = NULL;
-            }
-            return;
-        }
-        *alias = alias2;
-        strcat (*alias, word);
-    }
-    *length += length_word;
+
+    return hash;
 }
 
 /*
- * Adds word (in range) to string and increments length.
+ * Compares two alias names in hashtable of aliases (case is ignored).
  */
 
-void
-alias_string_add_word_range (char **alias, int *length, const char *start,
-                             const char *end)
+int
+alias_keycmp_cb (struct t_hashtable *hashtable,
+                 const void *key1, const void *key2)
 {
-    char *word;
+    /* make C compiler happy */
+    (void) hashtable;
 
-    word = weechat_strndup (start, end - start);
-    if (word)
-    {
-        alias_string_add_word (alias, length, word);
-        free (word);
-    }
+    return weechat_strcasecmp ((const char *)key1, (const char *)key2);
 }
 
 /*
- * Adds some arguments to string and increments length.
+ * Adds a text token in a command of alias.
  */
 
 void
-alias_string_add_arguments (char **alias, int *length, char **argv, int start,
-                            int end)
+alias_command_add_text (struct t_alias_command *alias_command,
+                        const char *text, int length)
 {
-    int i;
+    struct t_alias_token *ptr_token;
 
-    for (i = start; i <= end; i++)
-    {
-        if (i != start)
-            alias_string_add_word (alias, length, " ");
-        alias_string_add_word (alias, length, argv[i]);
-    }
+    if (length <= 0)
+        return;
+
+    ptr_token = &(alias_command->tokens[alias_command->tokens_count]);
+    ptr_token->type = ALIAS_TOKEN_TEXT;
+    ptr_token->text = text;
+    ptr_token->length = length;
+    ptr_token->arg_start = 0;
+    ptr_token->arg_end = -1;
+    alias_command->tokens_count++;
+}
+
+/*
+ * Adds an argument token in a command of alias.
+ */
+
+void
+alias_command_add_args (struct t_alias_command *alias_command,
+                        enum t_alias_token_type type,
+                        int arg_start, int arg_end)
+{
+    struct t_alias_token *ptr_token;
+
+    ptr_token = &(alias_command->tokens[alias_command->tokens_count]);
+    ptr_token->type = type;
+    ptr_token->text = NULL;
+    ptr_token->length = 0;
+    ptr_token->arg_start = arg_start;
+    ptr_token->arg_end = arg_end;
+    alias_command->tokens_count++;
+    alias_command->args_replaced = 1;
 }
 
 /*
- * Replaces arguments in alias.
+ * Compiles a command of alias: the command is split in tokens (text and
+ * arguments to insert), so that arguments are replaced in a single pass each
+ * time the alias is run.
  *
  * Arguments replaced are (n and m in 1..9):
  *   $n   argument n
@@ -180,105 +185,95 @@ alias_string_add_arguments (char **alias, int *length, char **argv, int start,
  *   $*   all arguments
  *   $~   last argument
  *
- * Note: result must be freed after use.
+ * Returns:
+ *   1: OK
+ *   0: error
  */
 
-char *
-alias_replace_args (const char *alias_args, const char *user_args)
+int
+alias_command_compile (struct t_alias_command *alias_command)
 {
-    char **argv, *res;
     const char *start, *pos;
-    int n, m, argc, length_res, args_count, offset;
+    int max_tokens, offset;
 
-    argv = weechat_string_split (user_args, " ", 0, 0, &argc);
+    alias_command->tokens = NULL;
+    alias_command->tokens_count = 0;
+    alias_command->args_replaced = 0;
 
-    res = NULL;
-    length_res = 0;
-    args_count = 0;
-    start = alias_args;
+    /* each "$" adds at most 2 tokens (text before "$" and arguments) */
+    max_tokens = 1;
+    for (pos = alias_command->command; pos[0]; pos++)
+    {
+        if (pos[0] == '$')
+            max_tokens += 2;
+    }
+    alias_command->tokens = malloc (max_tokens *
+                                    sizeof (alias_command->tokens[0]));
+    if (!alias_command->tokens)
+        return 0;
+
+    start = alias_command->command;
     pos = start;
-    while (pos && pos[0])
+    while (pos[0])
     {
         offset = 0;
 
         if ((pos[0] == '\\') && (pos[1] == '$'))
         {
             offset = 2;
-            alias_string_add_word_range (&res, &length_res, start, pos);
-            alias_string_add_word (&res, &length_res, "$");
+            alias_command_add_text (alias_command, start, pos - start);
+            alias_command_add_text (alias_command, pos + 1, 1);
+            alias_command->args_replaced = 1;
         }
-        else
+        else if (pos[0] == '$')
         {
-            if (pos[0] == '$')
+            if (pos[1] == '*')
+            {
+                /* replace with all arguments */
+                offset = 2;
+                alias_command_add_text (alias_command, start, pos - start);
+                alias_command_add_args (alias_command,
+                                        ALIAS_TOKEN_ARGS_ALL, 0, -1);
+            }
+            else if (pos[1] == '~')
             {
-                if (pos[1] == '*')
+                /* replace with last argument */
+                offset = 2;
+                alias_command_add_text (alias_command, start, pos - start);
+                alias_command_add_args (alias_command,
+                                        ALIAS_TOKEN_ARG_LAST, 0, -1);
+            }
+            else if ((pos[1] == '-') && ALIAS_IS_ARG_NUMBER(pos[2]))
+            {
+                /* replace with arguments 1 to m */
+                offset = 3;
+                alias_command_add_text (alias_command, start, pos - start);
+                alias_command_add_args (alias_command, ALIAS_TOKEN_ARGS,
+                                        0, pos[2] - '1');
+            }
+            else if (ALIAS_IS_ARG_NUMBER(pos[1]))
+            {
+                alias_command_add_text (alias_command, start, pos - start);
+                if (pos[2] != '-')
                 {
-                    /* replace with all arguments */
-                    args_count++;
+                    /* replace with argument n */
                     offset = 2;
-                    if (pos > start)
-                        alias_string_add_word_range (&res, &length_res, start, pos);
-                    alias_string_add_word (&res, &length_res, user_args);
+                    alias_command_add_args (alias_command, ALIAS_TOKEN_ARGS,
+                                            pos[1] - '1', pos[1] - '1');
                 }
-                else if (pos[1] == '~')
+                else if (ALIAS_IS_ARG_NUMBER(pos[3]))
                 {
-                    /* replace with last argument */
-                    args_count++;
-                    offset = 2;
-                    if (pos > start)
-                        alias_string_add_word_range (&res, &length_res, start, pos);
-                    if (argc > 0)
-                        alias_string_add_word (&res, &length_res, argv[argc - 1]);
+                    /* replace with arguments n to m */
+                    offset = 4;
+                    alias_command_add_args (alias_command, ALIAS_TOKEN_ARGS,
+                                            pos[1] - '1', pos[3] - '1');
                 }
-                else if ((pos[1] == '-') && ALIAS_IS_ARG_NUMBER(pos[2]))
+                else
                 {
-                    /* replace with arguments 1 to m */
-                    args_count++;
+                    /* replace with arguments n to last */
                     offset = 3;
-                    if (pos > start)
-                        alias_string_add_word_range (&res, &length_res, start, pos);
-                    if (pos[2] - '1' < argc)
-                        m = pos[2] - '1';
-                    else
-                        m = argc - 1;
-                    alias_string_add_arguments (&res, &length_res, argv, 0, m);
-                }
-                else if (ALIAS_IS_ARG_NUMBER(pos[1]))
-                {
-                    args_count++;
-                    n = pos[1] - '1';
-                    if (pos > start)
-                        alias_string_add_word_range (&res, &length_res, start, pos);
-                    if (pos[2] != '-')
-                    {
-                        /* replace with argument n */
-                        offset = 2;
-                        if (n < argc)
-                            alias_string_add_word (&res, &length_res, argv[n]);
-                    }
-                    else
-                    {
-                        if (ALIAS_IS_ARG_NUMBER(pos[3]))
-                        {
-                            /* replace with arguments n to m */
-                            offset = 4;
-                            if (pos[3] - '1' < argc)
-                                m = pos[3] - '1';
-                            else
-                                m = argc - 1;
-                        }
-                        else
-                        {
-                            /* replace with arguments n to last */
-                            offset = 3;
-                            m = argc - 1;
-                        }
-                        if (n < argc)
-                        {
-                            alias_string_add_arguments (&res, &length_res,
-                                                        argv, n, m);
-                        }
-                    }
+                    alias_command_add_args (alias_command, ALIAS_TOKEN_ARGS,
+                                            pos[1] - '1', -1);
                 }
             }
         }
@@ -292,13 +287,207 @@ alias_replace_args (const char *alias_args, const char *user_args)
             pos++;
     }
 
-    if (pos > start)
-        alias_string_add_word (&res, &length_res, start);
+    alias_command_add_text (alias_command, start, pos - start);
+
+    return 1;
+}
+
+/*
+ * Copies the value of a token in a string (if "dest" is not NULL).
+ *
+ * Returns length of value.
+ */
+
+int
+alias_token_copy (struct t_alias_token *token, const char *user_args,
+                  char **argv, int argc, char *dest)
+{
+    int i, arg_end, length, length_arg;
 
-    if (argv)
-        weechat_string_free_split (argv);
+    switch (token->type)
+    {
+        case ALIAS_TOKEN_TEXT:
+            if (dest)
+                memcpy (dest, token->text, token->length);
+            return token->length;
+        case ALIAS_TOKEN_ARGS_ALL:
+            length = strlen (user_args);
+            if (dest)
+                memcpy (dest, user_args, length);
+            return length;
+        case ALIAS_TOKEN_ARG_LAST:
+            if (argc <= 0)
+                return 0;
+            length = strlen (argv[argc - 1]);
+            if (dest)
+                memcpy (dest, argv[argc - 1], length);
+            return length;
+        case ALIAS_TOKEN_ARGS:
+            if (token->arg_start >= argc)
+                return 0;
+            arg_end = ((token->arg_end < 0) || (token->arg_end >= argc)) ?
+                argc - 1 : token->arg_end;
+            length = 0;
+            for (i = token->arg_start; i <= arg_end; i++)
+            {
+                if (i != token->arg_start)
+                {
+                    if (dest)
+                        dest[length] = ' ';
+                    length++;
+                }
+                length_arg = strlen (argv[i]);
+                if (dest)
+                    memcpy (dest + length, argv[i], length_arg);
+                length += length_arg;
+            }
+            return length;
+    }
 
-    return res;
+    return 0;
+}
+
+/*
+ * Replaces arguments in a command of alias (in a single pass on tokens of the
+ * compiled command).
+ *
+ * Returns NULL if there is no argument to replace in command, or if the
+ * result is empty (then the command must be used as-is).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+alias_command_replace_args (struct t_alias_command *alias_command,
+                            const char *user_args, char **argv, int argc)
+{
+    char *result;
+    int i, length;
+
+    if (!alias_command->args_replaced)
+        return NULL;
+
+    length = 0;
+    for (i = 0; i < alias_command->tokens_count; i++)
+    {
+        length += alias_token_copy (&(alias_command->tokens[i]),
+                                    user_args, argv, argc, NULL);
+    }
+    if (length == 0)
+        return NULL;
+
+    result = malloc (length + 1);
+    if (!result)
+        return NULL;
+
+    length = 0;
+    for (i = 0; i < alias_command->tokens_count; i++)
+    {
+        length += alias_token_copy (&(alias_command->tokens[i]),
+                                    user_args, argv, argc, result + length);
+    }
+    result[length] = '\0';
+
+    return result;
+}
+
+/*
+ * Releases compiled commands of an alias: they are freed when the alias is
+ * freed and the alias is not running any more.
+ */
+
+void
+alias_compiled_release (struct t_alias_compiled *compiled)
+{
+    int i;
+
+    compiled->refs--;
+    if (compiled->refs > 0)
+        return;
+
+    if (compiled->commands)
+    {
+        for (i = 0; i < compiled->commands_count; i++)
+        {
+            if (compiled->commands[i].command)
+                free (compiled->commands[i].command);
+            if (compiled->commands[i].tokens)
+                free (compiled->commands[i].tokens);
+        }
+        free (compiled->commands);
+    }
+    free (compiled);
+}
+
+/*
+ * Compiles commands of an alias (separated by ";").
+ *
+ * Returns pointer to compiled commands, NULL if error.
+ */
+
+struct t_alias_compiled *
+alias_compile (struct t_alias *alias)
+{
+    struct t_alias_compiled *compiled;
+    struct t_alias_command *ptr_command;
+    char **commands;
+    int i, j, count;
+
+    /* an alias can contain many commands separated by ';' */
+    commands = weechat_string_split_command (alias->command, ';');
+    if (!commands)
+        return NULL;
+
+    count = 0;
+    while (commands[count])
+    {
+        count++;
+    }
+
+    compiled = malloc (sizeof (*compiled));
+    if (!compiled)
+    {
+        weechat_string_free_split_command (commands);
+        return NULL;
+    }
+    compiled->alias = alias;
+    compiled->refs = 1;
+    compiled->commands_count = 0;
+    compiled->split_args = 0;
+    compiled->commands = (count > 0) ?
+        malloc (count * sizeof (compiled->commands[0])) : NULL;
+    if ((count > 0) && !compiled->commands)
+    {
+        weechat_string_free_split_command (commands);
+        alias_compiled_release (compiled);
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        ptr_command = &(compiled->commands[i]);
+        ptr_command->command = strdup (commands[i]);
+        ptr_command->tokens = NULL;
+        compiled->commands_count++;
+        if (!ptr_command->command || !alias_command_compile (ptr_command))
+        {
+            weechat_string_free_split_command (commands);
+            alias_compiled_release (compiled);
+            return NULL;
+        }
+        for (j = 0; j < ptr_command->tokens_count; j++)
+        {
+            if ((ptr_command->tokens[j].type == ALIAS_TOKEN_ARGS)
+                || (ptr_command->tokens[j].type == ALIAS_TOKEN_ARG_LAST))
+            {
+                compiled->split_args = 1;
+            }
+        }
+    }
+
+    weechat_string_free_split_command (commands);
+
+    return compiled;
 }
 
 /*
@@ -342,9 +531,11 @@ alias_cb (const void *pointer, void *data,
           char **argv_eol)
 {
     struct t_alias *ptr_alias;
-    char **commands, **ptr_cmd, **ptr_next_cmd;
-    char *args_replaced, *alias_command;
-    int some_args_replaced, length1, length2;
+    struct t_alias_compiled *compiled;
+    struct t_alias_command *ptr_command;
+    char *args_replaced, *alias_command, **user_argv;
+    const char *user_args, *ptr_cmd;
+    int i, some_args_replaced, length1, length2, user_argc;
 
     /* make C compiler happy */
     (void) data;
@@ -361,79 +552,92 @@ alias_cb (const void *pointer, void *data,
                         ptr_alias->name);
         return WEECHAT_RC_OK;
     }
-    else
+
+    compiled = ptr_alias->compiled;
+    if (!compiled)
+        return WEECHAT_RC_OK;
+
+    /* arguments are split only once for all commands */
+    user_args = (argc > 1) ? argv_eol[1] : "";
+    user_argv = NULL;
+    user_argc = 0;
+    if (compiled->split_args)
+        user_argv = weechat_string_split (user_args, " ", 0, 0, &user_argc);
+
+    /* compiled commands are kept if the alias is freed by one command */
+    compiled->refs++;
+    ptr_alias->running = 1;
+
+    some_args_replaced = 0;
+    for (i = 0; i < compiled->commands_count; i++)
     {
-        /* an alias can contain many commands separated by ';' */
-        commands = weechat_string_split_command (ptr_alias->command, ';');
-        if (commands)
+        ptr_command = &(compiled->commands[i]);
+
+        args_replaced = alias_command_replace_args (ptr_command, user_args,
+                                                    user_argv, user_argc);
+        if (args_replaced)
+            some_args_replaced = 1;
+
+        /*
+         * if alias has arguments, they are now
+         * arguments of the last command in the list (if no $1,$2,..$*)
+         * was found
+         */
+        if ((i == compiled->commands_count - 1) && argv_eol[1]
+            && (!some_args_replaced))
         {
-            some_args_replaced = 0;
-            ptr_alias->running = 1;
-            for (ptr_cmd = commands; *ptr_cmd; ptr_cmd++)
+            length1 = strlen (ptr_command->command);
+            length2 = strlen (argv_eol[1]);
+
+            alias_command = malloc (1 + length1 + 1 + length2 + 1);
+            if (alias_command)
             {
-                ptr_next_cmd = ptr_cmd;
-                ptr_next_cmd++;
-
-                args_replaced = alias_replace_args (*ptr_cmd,
-                                                    (argc > 1) ? argv_eol[1] : "");
-                if (args_replaced && (strcmp (args_replaced, *ptr_cmd) != 0))
-                    some_args_replaced = 1;
-
-                /*
-                 * if alias has arguments, they are now
-                 * arguments of the last command in the list (if no $1,$2,..$*)
-                 * was found
-                 */
-                if ((*ptr_next_cmd == NULL) && argv_eol[1] && (!some_args_replaced))
-                {
-                    length1 = strlen (*ptr_cmd);
-                    length2 = strlen (argv_eol[1]);
-
-                    alias_command = malloc (1 + length1 + 1 + length2 + 1);
-                    if (alias_command)
-                    {
-                        if (!weechat_string_is_command_char (*ptr_cmd))
-                            strcpy (alias_command, "/");
-                        else
-                            alias_command[0] = '\0';
-
-                        strcat (alias_command, *ptr_cmd);
-                        strcat (alias_command, " ");
-                        strcat (alias_command, argv_eol[1]);
-
-                        alias_run_command (&buffer,
-                                           alias_command);
-                        free (alias_command);
-                    }
-                }
+                if (!weechat_string_is_command_char (ptr_command->command))
+                    strcpy (alias_command, "/");
                 else
+                    alias_command[0] = '\0';
+
+                strcat (alias_command, ptr_command->command);
+                strcat (alias_command, " ");
+                strcat (alias_command, argv_eol[1]);
+
+                alias_run_command (&buffer,
+                                   alias_command);
+                free (alias_command);
+            }
+        }
+        else
+        {
+            ptr_cmd = (args_replaced) ? args_replaced : ptr_command->command;
+            if (weechat_string_is_command_char (ptr_command->command))
+            {
+                alias_run_command (&buffer, ptr_cmd);
+            }
+            else
+            {
+                alias_command = malloc (1 + strlen (ptr_cmd) + 1);
+                if (alias_command)
                 {
-                    if (weechat_string_is_command_char (*ptr_cmd))
-                    {
-                        alias_run_command (&buffer,
-                                           (args_replaced) ? args_replaced : *ptr_cmd);
-                    }
-                    else
-                    {
-                        alias_command = malloc (1 + strlen((args_replaced) ? args_replaced : *ptr_cmd) + 1);
-                        if (alias_command)
-                        {
-                            strcpy (alias_command, "/");
-                            strcat (alias_command, (args_replaced) ? args_replaced : *ptr_cmd);
-                            alias_run_command (&buffer,
-                                               alias_command);
-                            free (alias_command);
-                        }
-                    }
+                    strcpy (alias_command, "/");
+                    strcat (alias_command, ptr_cmd);
+                    alias_run_command (&buffer,
+                                       alias_command);
+                    free (alias_command);
                 }
-
-                if (args_replaced)
-                    free (args_replaced);
             }
-            ptr_alias->running = 0;
-            weechat_string_free_split_command (commands);
         }
+
+        if (args_replaced)
+            free (args_replaced);
     }
+
+    if (compiled->alias)
+        compiled->alias->running = 0;
+    alias_compiled_release (compiled);
+
+    if (user_argv)
+        weechat_string_free_split (user_argv);
+
     return WEECHAT_RC_OK;
 }
 
@@ -459,9 +663,16 @@ alias_free (struct t_alias *alias)
     if (alias->next_alias)
         (alias->next_alias)->prev_alias = alias->prev_alias;
 
+    weechat_hashtable_remove (alias_hashtable, alias->name);
+
     /* free data */
     if (alias->hook)
         weechat_unhook (alias->hook);
+    if (alias->compiled)
+    {
+        alias->compiled->alias = NULL;
+        alias_compiled_release (alias->compiled);
+    }
     if (alias->name)
         free (alias->name);
     if (alias->command)
@@ -639,8 +850,24 @@ alias_new (const char *name, const char *command, const char *completion)
         new_alias->name = strdup (name);
         new_alias->command = strdup (command);
         new_alias->completion = (completion) ? strdup (completion) : NULL;
+        new_alias->compiled = (new_alias->command) ?
+            alias_compile (new_alias) : NULL;
         new_alias->running = 0;
 
+        if (!new_alias->name || !new_alias->compiled)
+        {
+            if (new_alias->name)
+                free (new_alias->name);
+            if (new_alias->command)
+                free (new_alias->command);
+            if (new_alias->completion)
+                free (new_alias->completion);
+            if (new_alias->compiled)
+                alias_compiled_release (new_alias->compiled);
+            free (new_alias);
+            return NULL;
+        }
+
         alias_hook_command (new_alias);
 
         if (alias_list)
@@ -673,6 +900,8 @@ alias_new (const char *name, const char *command, const char *completion)
             alias_list = new_alias;
             last_alias = new_alias;
         }
+
+        weechat_hashtable_set (alias_hashtable, new_alias->name, new_alias);
     }
 
     return new_alias;
@@ -725,6 +954,14 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_plugin = plugin;
 
+    alias_hashtable = weechat_hashtable_new (32,
+                                             WEECHAT_HASHTABLE_STRING,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             &alias_hash_key_cb,
+                                             &alias_keycmp_cb);
+    if (!alias_hashtable)
+        return WEECHAT_RC_ERROR;
+
     if (!alias_config_init ())
         return WEECHAT_RC_ERROR;
 
@@ -752,6 +989,8 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
     alias_config_write ();
     alias_free_all ();
     weechat_config_free (alias_config_file);
+    weechat_hashtable_free (alias_hashtable);
+    alias_hashtable = NULL;
 
     return WEECHAT_RC_OK;
 }
@@ -25,6 +25,46 @@
 
 #define ALIAS_CONFIG_NAME "alias"
 
+enum t_alias_token_type
+{
+    ALIAS_TOKEN_TEXT = 0,              /* text copied as-is                 */
+    ALIAS_TOKEN_ARGS_ALL,              /* $*: all arguments (as typed)      */
+    ALIAS_TOKEN_ARG_LAST,              /* $~: last argument                 */
+    ALIAS_TOKEN_ARGS,                  /* $n, $-m, $n-, $n-m: arguments     */
+};
+
+/* token of a command (text or arguments to insert) */
+
+struct t_alias_token
+{
+    enum t_alias_token_type type;      /* type of token                     */
+    const char *text;                  /* text (for type "text")            */
+    int length;                        /* length of text                    */
+    int arg_start;                     /* first argument (0 for $1)         */
+    int arg_end;                       /* last argument (-1 = last one)     */
+};
+
+/* command of an alias (alias command is split on ";") */
+
+struct t_alias_command
+{
+    char *command;                     /* command (without arguments)       */
+    struct t_alias_token *tokens;      /* tokens of command                 */
+    int tokens_count;                  /* number of tokens                  */
+    int args_replaced;                 /* 1 if some $xxx are in command     */
+};
+
+/* commands of an alias, compiled when the alias is created */
+
+struct t_alias_compiled
+{
+    struct t_alias *alias;             /* alias (NULL if alias is freed)    */
+    int refs;                          /* alias + alias callbacks running   */
+    struct t_alias_command *commands;  /* commands                          */
+    int commands_count;                /* number of commands                */
+    int split_args;                    /* 1 if arguments must be split      */
+};
+
 struct t_alias
 {
     struct t_hook *hook;               /* command hook                      */
@@ -32,12 +72,14 @@ struct t_alias
     char *command;                     /* alias command                     */
     char *completion;                  /* completion for alias (if not set, */
                                        /* uses completion of target cmd)    */
+    struct t_alias_compiled *compiled; /* commands compiled                 */
     int running;                       /* 1 if alias is running             */
     struct t_alias *prev_alias;        /* link to previous alias            */
     struct t_alias *next_alias;        /* link to next alias                */
 };
 
 extern struct t_alias *alias_list;
+extern struct t_hashtable *alias_hashtable;
 
 extern struct t_weechat_plugin *weechat_alias_plugin;
 
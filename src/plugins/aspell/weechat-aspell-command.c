@@ -312,6 +312,8 @@ weechat_aspell_command_add_word (struct t_gui_buffer *buffer, const char *dict,
         goto error;
 #endif /* USE_ENCHANT */
 
+    weechat_aspell_speller_buffer_clear_cache ();
+
     goto end;
 
 error:
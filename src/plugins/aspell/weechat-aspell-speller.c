@@ -364,6 +364,11 @@ weechat_aspell_speller_buffer_new (struct t_gui_buffer *buffer)
         return NULL;
 
     new_speller_buffer->spellers = NULL;
+    new_speller_buffer->words = weechat_hashtable_new (
+        32,
+        WEECHAT_HASHTABLE_STRING,
+        WEECHAT_HASHTABLE_INTEGER,
+        NULL, NULL);
     new_speller_buffer->modifier_string = NULL;
     new_speller_buffer->input_pos = -1;
     new_speller_buffer->modifier_result = NULL;
@@ -406,6 +411,42 @@ weechat_aspell_speller_buffer_new (struct t_gui_buffer *buffer)
     return new_speller_buffer;
 }
 
+/*
+ * Clears cache of words in a buffer speller info.
+ */
+
+void
+weechat_aspell_speller_buffer_clear_cache_cb (void *data,
+                                              struct t_hashtable *hashtable,
+                                              const void *key,
+                                              const void *value)
+{
+    struct t_aspell_speller_buffer *ptr_speller_buffer;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) hashtable;
+    (void) key;
+
+    ptr_speller_buffer = (struct t_aspell_speller_buffer *)value;
+
+    if (ptr_speller_buffer->words)
+        weechat_hashtable_remove_all (ptr_speller_buffer->words);
+}
+
+/*
+ * Clears cache of words in all buffers (for example when a word is added to
+ * a dictionary).
+ */
+
+void
+weechat_aspell_speller_buffer_clear_cache ()
+{
+    weechat_hashtable_map (weechat_aspell_speller_buffer,
+                           &weechat_aspell_speller_buffer_clear_cache_cb,
+                           NULL);
+}
+
 /*
  * Callback called when a key is removed in hashtable
  * "weechat_aspell_speller_buffer".
@@ -425,6 +466,8 @@ weechat_aspell_speller_buffer_free_value_cb (struct t_hashtable *hashtable,
 
     if (ptr_speller_buffer->spellers)
         free (ptr_speller_buffer->spellers);
+    if (ptr_speller_buffer->words)
+        weechat_hashtable_free (ptr_speller_buffer->words);
     if (ptr_speller_buffer->modifier_string)
         free (ptr_speller_buffer->modifier_string);
     if (ptr_speller_buffer->modifier_result)
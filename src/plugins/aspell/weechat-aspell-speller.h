@@ -21,6 +21,9 @@
 #ifndef WEECHAT_ASPELL_SPELLER_H
 #define WEECHAT_ASPELL_SPELLER_H 1
 
+/* max number of words in cache of a buffer (cache is cleared when full) */
+#define ASPELL_SPELLER_BUFFER_CACHE_MAX_WORDS 4096
+
 struct t_aspell_speller_buffer
 {
 #ifdef USE_ENCHANT
@@ -28,6 +31,8 @@ struct t_aspell_speller_buffer
 #else
     AspellSpeller **spellers;              /* aspell spellers for buffer    */
 #endif /* USE_ENCHANT */
+    struct t_hashtable *words;             /* cache: word -> 1 (OK) or 0    */
+                                           /* (misspelled)                  */
     char *modifier_string;                 /* last modifier string          */
     int input_pos;                         /* position of cursor in input   */
     char *modifier_result;                 /* last modifier result          */
@@ -45,6 +50,7 @@ extern AspellSpeller *weechat_aspell_speller_new (const char *lang);
 #endif /* USE_ENCHANT */
 extern void weechat_aspell_speller_remove_unused ();
 extern struct t_aspell_speller_buffer *weechat_aspell_speller_buffer_new (struct t_gui_buffer *buffer);
+extern void weechat_aspell_speller_buffer_clear_cache ();
 extern int weechat_aspell_speller_init ();
 extern void weechat_aspell_speller_end ();
 
@@ -463,7 +463,7 @@ int
 weechat_aspell_check_word (struct t_aspell_speller_buffer *speller_buffer,
                            const char *word)
 {
-    int i;
+    int *ptr_word_ok, word_ok, i;
 
     /* word too small? then do not check word */
     if ((weechat_config_integer (weechat_aspell_config_check_word_min_length) > 0)
@@ -474,7 +474,16 @@ weechat_aspell_check_word (struct t_aspell_speller_buffer *speller_buffer,
     if (weechat_aspell_string_is_simili_number (word))
         return 1;
 
+    /* word already checked? then return result from cache */
+    if (speller_buffer->words)
+    {
+        ptr_word_ok = weechat_hashtable_get (speller_buffer->words, word);
+        if (ptr_word_ok)
+            return *ptr_word_ok;
+    }
+
     /* check word with all spellers (order is important) */
+    word_ok = 0;
     if (speller_buffer->spellers)
     {
         for (i = 0; speller_buffer->spellers[i]; i++)
@@ -484,12 +493,25 @@ weechat_aspell_check_word (struct t_aspell_speller_buffer *speller_buffer,
 #else
             if (aspell_speller_check (speller_buffer->spellers[i], word, -1) == 1)
 #endif /* USE_ENCHANT */
-                return 1;
+            {
+                word_ok = 1;
+                break;
+            }
         }
     }
 
-    /* misspelled word! */
-    return 0;
+    /* save result in cache */
+    if (speller_buffer->words)
+    {
+        if (weechat_hashtable_get_integer (speller_buffer->words, "items_count")
+            >= ASPELL_SPELLER_BUFFER_CACHE_MAX_WORDS)
+        {
+            weechat_hashtable_remove_all (speller_buffer->words);
+        }
+        weechat_hashtable_set (speller_buffer->words, word, &word_ok);
+    }
+
+    return word_ok;
 }
 
 /*
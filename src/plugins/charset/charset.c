@@ -41,6 +41,9 @@ WEECHAT_PLUGIN_PRIORITY(13000);
 
 #define CHARSET_CONFIG_NAME "charset"
 
+/* max number of charsets in cache (cache is cleared when it is full) */
+#define CHARSET_CACHE_MAX_SIZE 4096
+
 struct t_weechat_plugin *weechat_charset_plugin = NULL;
 #define weechat_plugin weechat_charset_plugin
 
@@ -53,6 +56,41 @@ struct t_config_section *charset_config_section_encode = NULL;
 const char *charset_terminal = NULL;
 const char *charset_internal = NULL;
 
+/* charsets found by modifier data (value "" if no charset is found) */
+struct t_hashtable *charset_cache_decode = NULL;
+struct t_hashtable *charset_cache_encode = NULL;
+
+
+/*
+ * Clears cache of decode/encode charsets (called when charset options are
+ * changed).
+ */
+
+void
+charset_cache_clear ()
+{
+    if (charset_cache_decode)
+        weechat_hashtable_remove_all (charset_cache_decode);
+    if (charset_cache_encode)
+        weechat_hashtable_remove_all (charset_cache_encode);
+}
+
+/*
+ * Callback for changes on a charset option.
+ */
+
+void
+charset_config_change_cb (const void *pointer, void *data,
+                          struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    charset_cache_clear ();
+}
+
 
 /*
  * Reloads charset configuration file.
@@ -70,6 +108,8 @@ charset_config_reload (const void *pointer, void *data,
     weechat_config_section_free_options (charset_config_section_decode);
     weechat_config_section_free_options (charset_config_section_encode);
 
+    charset_cache_clear ();
+
     return weechat_config_reload (config_file);
 }
 
@@ -151,6 +191,7 @@ charset_config_create_option (const void *pointer, void *data,
             else
             {
                 weechat_config_option_free (ptr_option);
+                charset_cache_clear ();
                 rc = WEECHAT_CONFIG_OPTION_SET_OK_SAME_VALUE;
             }
         }
@@ -166,8 +207,9 @@ charset_config_create_option (const void *pointer, void *data,
                         option_name, "string", NULL,
                         NULL, 0, 0, "", value, 0,
                         (section == charset_config_section_decode) ? &charset_check_charset_decode_cb : NULL, NULL, NULL,
-                        NULL, NULL, NULL,
-                        NULL, NULL, NULL);
+                        &charset_config_change_cb, NULL, NULL,
+                        &charset_config_change_cb, NULL, NULL);
+                    charset_cache_clear ();
                     rc = (ptr_option) ?
                         WEECHAT_CONFIG_OPTION_SET_OK_SAME_VALUE : WEECHAT_CONFIG_OPTION_SET_ERROR;
                 }
@@ -230,7 +272,7 @@ charset_config_init ()
                                  charset_internal) != 0)) ?
         charset_terminal : "iso-8859-1", NULL, 0,
         &charset_check_charset_decode_cb, NULL, NULL,
-        NULL, NULL, NULL,
+        &charset_config_change_cb, NULL, NULL,
         NULL, NULL, NULL);
     charset_default_encode = weechat_config_new_option (
         charset_config_file, ptr_section,
@@ -239,7 +281,9 @@ charset_config_init ()
            "(if empty, default is UTF-8 because it is the WeeChat internal "
            "charset)"),
         NULL, 0, 0, "", NULL, 0,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        NULL, NULL, NULL,
+        &charset_config_change_cb, NULL, NULL,
+        NULL, NULL, NULL);
 
     ptr_section = weechat_config_new_section (
         charset_config_file, "decode",
@@ -375,6 +419,52 @@ charset_get (struct t_config_section *section, const char *name,
     return NULL;
 }
 
+/*
+ * Reads a charset in cache, or in configuration file if not found in cache
+ * (then the charset is added in cache).
+ */
+
+const char *
+charset_get_cached (struct t_hashtable *cache,
+                    struct t_config_section *section, const char *name,
+                    struct t_config_option *default_charset)
+{
+    const char *charset;
+
+    if (!cache || !name)
+        return charset_get (section, name, default_charset);
+
+    charset = weechat_hashtable_get (cache, name);
+    if (charset)
+        return (charset[0]) ? charset : NULL;
+
+    charset = charset_get (section, name, default_charset);
+
+    if (weechat_hashtable_get_integer (cache,
+                                       "items_count") >= CHARSET_CACHE_MAX_SIZE)
+    {
+        weechat_hashtable_remove_all (cache);
+    }
+    weechat_hashtable_set (cache, name, (charset) ? charset : "");
+
+    return charset;
+}
+
+/*
+ * Checks if a charset is UTF-8.
+ *
+ * Returns:
+ *   1: charset is UTF-8
+ *   0: charset is not UTF-8
+ */
+
+int
+charset_is_utf8 (const char *charset)
+{
+    return ((weechat_strcasecmp (charset, "utf-8") == 0)
+            || (weechat_strcasecmp (charset, "utf8") == 0)) ? 1 : 0;
+}
+
 /*
  * Decodes a string with a charset to internal charset (UTF-8).
  */
@@ -391,8 +481,9 @@ charset_decode_cb (const void *pointer, void *data,
     (void) data;
     (void) modifier;
 
-    charset = charset_get (charset_config_section_decode, modifier_data,
-                           charset_default_decode);
+    charset = charset_get_cached (charset_cache_decode,
+                                  charset_config_section_decode, modifier_data,
+                                  charset_default_decode);
     if (weechat_charset_plugin->debug)
     {
         weechat_printf (NULL,
@@ -400,7 +491,8 @@ charset_decode_cb (const void *pointer, void *data,
                         "(modifier=\"%s\", modifier_data=\"%s\", string=\"%s\")",
                         charset, modifier, modifier_data, string);
     }
-    if (charset && charset[0])
+    /* a valid UTF-8 string is not decoded (string is kept as-is) */
+    if (charset && charset[0] && !weechat_utf8_is_valid (string, -1, NULL))
         return weechat_iconv_to_internal (charset, string);
 
     return NULL;
@@ -422,8 +514,9 @@ charset_encode_cb (const void *pointer, void *data,
     (void) data;
     (void) modifier;
 
-    charset = charset_get (charset_config_section_encode, modifier_data,
-                           charset_default_encode);
+    charset = charset_get_cached (charset_cache_encode,
+                                  charset_config_section_encode, modifier_data,
+                                  charset_default_encode);
     if (weechat_charset_plugin->debug)
     {
         weechat_printf (NULL,
@@ -431,7 +524,8 @@ charset_encode_cb (const void *pointer, void *data,
                         "(modifier=\"%s\", modifier_data=\"%s\", string=\"%s\")",
                         charset, modifier, modifier_data, string);
     }
-    if (charset && charset[0])
+    /* string is already UTF-8 (internal charset): no conversion needed */
+    if (charset && charset[0] && !charset_is_utf8 (charset))
         return weechat_iconv_from_internal (charset, string);
 
     return NULL;
@@ -599,6 +693,15 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
     if (weechat_charset_plugin->debug >= 1)
         charset_display_charsets ();
 
+    charset_cache_decode = weechat_hashtable_new (32,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  NULL, NULL);
+    charset_cache_encode = weechat_hashtable_new (32,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  WEECHAT_HASHTABLE_STRING,
+                                                  NULL, NULL);
+
     if (!charset_config_init ())
         return WEECHAT_RC_ERROR;
 
@@ -638,5 +741,16 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     weechat_config_free (charset_config_file);
 
+    if (charset_cache_decode)
+    {
+        weechat_hashtable_free (charset_cache_decode);
+        charset_cache_decode = NULL;
+    }
+    if (charset_cache_encode)
+    {
+        weechat_hashtable_free (charset_cache_encode);
+        charset_cache_encode = NULL;
+    }
+
     return WEECHAT_RC_OK;
 }
@@ -33,6 +33,8 @@ struct t_config_file *exec_config_file = NULL;
 /* exec config, command section */
 
 struct t_config_option *exec_config_command_default_options;
+struct t_config_option *exec_config_command_output_batch_lines;
+struct t_config_option *exec_config_command_output_max_size;
 struct t_config_option *exec_config_command_purge_delay;
 
 /* exec config, color section */
@@ -122,6 +124,24 @@ exec_config_init ()
         NULL, NULL, NULL,
         &exec_config_change_command_default_options, NULL, NULL,
         NULL, NULL, NULL);
+    exec_config_command_output_batch_lines = weechat_config_new_option (
+        exec_config_file, ptr_section,
+        "output_batch_lines", "integer",
+        N_("max number of lines of output displayed at once for a command; "
+           "next lines are queued and displayed by batches every 100 "
+           "milliseconds, so that a command with a lot of output does not "
+           "freeze WeeChat (0 = no limit, display all lines immediately)"),
+        NULL, 0, 1000000, "1000", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    exec_config_command_output_max_size = weechat_config_new_option (
+        exec_config_file, ptr_section,
+        "output_max_size", "integer",
+        N_("max size of output queued for a command (in kilobytes); when "
+           "this size is reached, the oldest lines queued are dropped "
+           "(0 = no limit); this is not used for a command with output "
+           "sent as hsignal"),
+        NULL, 0, 1024 * 1024, "0", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     exec_config_command_purge_delay = weechat_config_new_option (
         exec_config_file, ptr_section,
         "purge_delay", "integer",
@@ -161,7 +161,11 @@ exec_add ()
     {
         new_exec_cmd->output_size[i] = 0;
         new_exec_cmd->output[i] = NULL;
+        new_exec_cmd->output_start[i] = 0;
+        new_exec_cmd->output_alloc[i] = 0;
     }
+    new_exec_cmd->output_lines_dropped = 0;
+    new_exec_cmd->hook_timer_output = NULL;
     new_exec_cmd->return_code = -1;
     new_exec_cmd->pipe_command = NULL;
     new_exec_cmd->hsignal = NULL;
@@ -245,32 +249,17 @@ exec_decode_color (struct t_exec_cmd *exec_cmd, const char *string)
 }
 
 /*
- * Displays a line of output.
+ * Displays a line of output (colors already decoded).
  */
 
 void
 exec_display_line (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
-                   int out, const char *line)
+                   int out, const char *line_color)
 {
-    char *line_color, *line_color2, *line2, str_number[32], str_tags[1024];
+    char *line_color2, *line2, str_number[32], str_tags[1024];
     const char *ptr_line_color;
     int length;
 
-    if (!exec_cmd || !line)
-        return;
-
-    /*
-     * if output is sent to the buffer, the buffer must exist
-     * (we don't send output by default to core buffer)
-     */
-    if (exec_cmd->output_to_buffer && !exec_cmd->pipe_command && !buffer)
-        return;
-
-    /* decode colors */
-    line_color = exec_decode_color (exec_cmd, line);
-    if (!line_color)
-        return;
-
     exec_cmd->output_line_nb++;
 
     if (exec_cmd->pipe_command)
@@ -368,74 +357,349 @@ exec_display_line (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
                 line_color);
         }
     }
+}
+
+/*
+ * Displays lines of output in a formatted buffer, with a single message
+ * (colors already decoded, lines are separated by '\n').
+ */
+
+void
+exec_print_lines (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
+                  int out, const char *lines_color)
+{
+    char *message, *ptr_message, str_number[32], str_tags[1024];
+    const char *ptr_line, *pos;
+    int num_lines, length, length_line;
+
+    num_lines = 1;
+    for (ptr_line = lines_color; (pos = strchr (ptr_line, '\n'));
+         ptr_line = pos + 1)
+    {
+        num_lines++;
+    }
+
+    /* each line has its own prefix: line number or " \t" (no prefix) */
+    length = strlen (lines_color) + (num_lines * sizeof (str_number)) + 1;
+    message = malloc (length);
+    if (!message)
+        return;
+
+    ptr_message = message;
+    ptr_line = lines_color;
+    while (ptr_line)
+    {
+        pos = strchr (ptr_line, '\n');
+        exec_cmd->output_line_nb++;
+        if (exec_cmd->line_numbers)
+        {
+            ptr_message += snprintf (ptr_message,
+                                     length - (ptr_message - message),
+                                     "%d\t", exec_cmd->output_line_nb);
+        }
+        else
+        {
+            memcpy (ptr_message, " \t", 2);
+            ptr_message += 2;
+        }
+        length_line = (pos) ? pos - ptr_line + 1 : (int)strlen (ptr_line);
+        memcpy (ptr_message, ptr_line, length_line);
+        ptr_message += length_line;
+        ptr_line = (pos) ? pos + 1 : NULL;
+    }
+    ptr_message[0] = '\0';
+
+    snprintf (str_number, sizeof (str_number), "%d", exec_cmd->number);
+    snprintf (str_tags, sizeof (str_tags),
+              "exec_%s,exec_cmd_%s",
+              (out == EXEC_STDOUT) ? "stdout" : "stderr",
+              (exec_cmd->name) ? exec_cmd->name : str_number);
+    weechat_printf_date_tags (buffer, 0, str_tags, "%s", message);
 
-    free (line_color);
+    free (message);
 }
 
 /*
- * Concatenates some text to stdout/stderr of a command.
+ * Displays lines of output (lines are separated by '\n').
+ *
+ * Colors are decoded once for all lines, and lines displayed in a formatted
+ * buffer are printed with a single message.
  */
 
 void
-exec_concat_output (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
-                    int out, const char *text)
+exec_display_lines (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
+                    int out, const char *lines)
 {
-    int length, new_size;
-    const char *ptr_text;
-    char *new_output, *pos, *line;
+    char *lines_color, *ptr_line, *pos;
 
-    ptr_text = text;
+    if (!exec_cmd || !lines)
+        return;
+
+    /*
+     * if output is sent to the buffer, the buffer must exist
+     * (we don't send output by default to core buffer)
+     */
+    if (exec_cmd->output_to_buffer && !exec_cmd->pipe_command && !buffer)
+        return;
 
-    /* if output is not sent as hsignal, display lines (ending with '\n') */
-    if (!exec_cmd->hsignal)
+    /* decode colors */
+    lines_color = exec_decode_color (exec_cmd, lines);
+    if (!lines_color)
+        return;
+
+    if (!exec_cmd->pipe_command && !exec_cmd->output_to_buffer
+        && (weechat_buffer_get_integer (buffer, "type") != 1))
+    {
+        exec_print_lines (exec_cmd, buffer, out, lines_color);
+    }
+    else
     {
-        ptr_text = text;
-        while (ptr_text[0])
+        ptr_line = lines_color;
+        while (ptr_line)
+        {
+            pos = strchr (ptr_line, '\n');
+            if (pos)
+                pos[0] = '\0';
+            exec_display_line (exec_cmd, buffer, out, ptr_line);
+            ptr_line = (pos) ? pos + 1 : NULL;
+        }
+    }
+
+    free (lines_color);
+}
+
+/*
+ * Adds some text at the end of stdout/stderr of a command.
+ *
+ * The data received is kept in a buffer which is reused: displayed lines are
+ * removed from the beginning of buffer (by moving the start of data), and the
+ * data is moved to the beginning of buffer only when there is not enough
+ * space at the end.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+exec_output_add (struct t_exec_cmd *exec_cmd, int out, const char *text,
+                 int length)
+{
+    char *new_output;
+    int new_alloc;
+
+    if (exec_cmd->output_start[out] + exec_cmd->output_size[out] + length + 1
+        > exec_cmd->output_alloc[out])
+    {
+        if (exec_cmd->output_start[out] > 0)
+        {
+            memmove (exec_cmd->output[out],
+                     exec_cmd->output[out] + exec_cmd->output_start[out],
+                     exec_cmd->output_size[out] + 1);
+            exec_cmd->output_start[out] = 0;
+        }
+        if (exec_cmd->output_size[out] + length + 1
+            > exec_cmd->output_alloc[out])
         {
-            pos = strchr (ptr_text, '\n');
+            new_alloc = exec_cmd->output_alloc[out] * 2;
+            if (new_alloc < exec_cmd->output_size[out] + length + 1)
+                new_alloc = exec_cmd->output_size[out] + length + 1;
+            new_output = realloc (exec_cmd->output[out], new_alloc);
+            if (!new_output)
+                return 0;
+            exec_cmd->output[out] = new_output;
+            exec_cmd->output_alloc[out] = new_alloc;
+        }
+    }
+
+    memcpy (exec_cmd->output[out] + exec_cmd->output_start[out]
+            + exec_cmd->output_size[out],
+            text, length);
+    exec_cmd->output_size[out] += length;
+    exec_cmd->output[out][exec_cmd->output_start[out]
+                          + exec_cmd->output_size[out]] = '\0';
+
+    return 1;
+}
+
+/*
+ * Removes "size" bytes at the beginning of stdout/stderr of a command.
+ */
+
+void
+exec_output_remove (struct t_exec_cmd *exec_cmd, int out, int size)
+{
+    if (size >= exec_cmd->output_size[out])
+    {
+        exec_cmd->output_start[out] = 0;
+        exec_cmd->output_size[out] = 0;
+        if (exec_cmd->output[out])
+            exec_cmd->output[out][0] = '\0';
+    }
+    else
+    {
+        exec_cmd->output_start[out] += size;
+        exec_cmd->output_size[out] -= size;
+    }
+}
+
+/*
+ * Drops oldest lines of stdout/stderr of a command if the size of output
+ * queued is greater than option exec.command.output_max_size.
+ */
+
+void
+exec_output_drop (struct t_exec_cmd *exec_cmd, int out)
+{
+    char *ptr_output, *pos;
+    int max_size, size;
+
+    max_size = weechat_config_integer (exec_config_command_output_max_size) * 1024;
+    if ((max_size <= 0) || (exec_cmd->output_size[out] <= max_size))
+        return;
+
+    ptr_output = exec_cmd->output[out] + exec_cmd->output_start[out];
+
+    /* remove only complete lines (until the end of a line) */
+    pos = memchr (ptr_output + exec_cmd->output_size[out] - max_size - 1,
+                  '\n', max_size + 1);
+    size = (pos) ? pos - ptr_output + 1 : exec_cmd->output_size[out];
+
+    for (pos = ptr_output; (pos = memchr (pos, '\n', size - (pos - ptr_output)));
+         pos++)
+    {
+        exec_cmd->output_lines_dropped++;
+    }
+
+    exec_output_remove (exec_cmd, out, size);
+}
+
+/*
+ * Displays complete lines queued in stdout/stderr of a command, at most
+ * "max_lines" lines (0 = no limit).
+ *
+ * Returns:
+ *   1: some complete lines are still queued
+ *   0: no more complete lines queued
+ */
+
+int
+exec_output_flush (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
+                   int max_lines)
+{
+    char *ptr_output, *pos, *pos_end;
+    int out, num_lines;
+
+    num_lines = 0;
+    for (out = 0; out < 2; out++)
+    {
+        if (!exec_cmd->output[out] || (exec_cmd->output_size[out] == 0))
+            continue;
+
+        ptr_output = exec_cmd->output[out] + exec_cmd->output_start[out];
+
+        /* search end of last line to display */
+        pos_end = NULL;
+        pos = ptr_output;
+        while ((max_lines <= 0) || (num_lines < max_lines))
+        {
+            pos = memchr (pos, '\n',
+                          exec_cmd->output_size[out] - (pos - ptr_output));
             if (!pos)
                 break;
-            if (exec_cmd->output_size[out] > 0)
-            {
-                length = exec_cmd->output_size[out] + (pos - ptr_text) + 1;
-                line = malloc (length);
-                if (line)
-                {
-                    memcpy (line, exec_cmd->output[out],
-                            exec_cmd->output_size[out]);
-                    memcpy (line + exec_cmd->output_size[out],
-                            ptr_text, pos - ptr_text);
-                    line[length - 1] = '\0';
-                }
-            }
-            else
-                line = weechat_strndup (ptr_text, pos - ptr_text);
-            if (!line)
-                break;
-            if (exec_cmd->output[out])
-            {
-                free (exec_cmd->output[out]);
-                exec_cmd->output[out] = NULL;
-            }
-            exec_cmd->output_size[out] = 0;
-            exec_display_line (exec_cmd, buffer, out, line);
-            free (line);
-            ptr_text = pos + 1;
+            pos_end = pos;
+            num_lines++;
+            pos++;
+        }
+        if (!pos_end)
+            continue;
+
+        /* display lines (they are split in place) */
+        pos_end[0] = '\0';
+        exec_display_lines (exec_cmd, buffer, out, ptr_output);
+        exec_output_remove (exec_cmd, out, pos_end - ptr_output + 1);
+    }
+
+    for (out = 0; out < 2; out++)
+    {
+        if ((exec_cmd->output_size[out] > 0)
+            && memchr (exec_cmd->output[out] + exec_cmd->output_start[out],
+                       '\n', exec_cmd->output_size[out]))
+        {
+            return 1;
         }
     }
 
-    /* concatenate ptr_text to output buffer */
-    length = strlen (ptr_text);
-    if (length > 0)
+    return 0;
+}
+
+/*
+ * Callback for timer displaying queued output of a command.
+ */
+
+int
+exec_timer_output_cb (const void *pointer, void *data, int remaining_calls)
+{
+    struct t_exec_cmd *exec_cmd;
+    struct t_gui_buffer *ptr_buffer;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    exec_cmd = (struct t_exec_cmd *)pointer;
+    if (!exec_cmd)
+        return WEECHAT_RC_ERROR;
+
+    ptr_buffer = weechat_buffer_search ("==", exec_cmd->buffer_full_name);
+    if (!exec_output_flush (
+            exec_cmd, ptr_buffer,
+            weechat_config_integer (exec_config_command_output_batch_lines)))
+    {
+        weechat_unhook (exec_cmd->hook_timer_output);
+        exec_cmd->hook_timer_output = NULL;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Concatenates some text to stdout/stderr of a command.
+ *
+ * If output is not sent as hsignal, complete lines are displayed: at most
+ * exec.command.output_batch_lines lines are displayed immediately, and
+ * next lines are queued and displayed later by a timer.
+ */
+
+void
+exec_concat_output (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
+                    int out, const char *text)
+{
+    int length;
+
+    length = strlen (text);
+    if (length == 0)
+        return;
+
+    if (!exec_output_add (exec_cmd, out, text, length))
+        return;
+
+    if (exec_cmd->hsignal)
+        return;
+
+    exec_output_drop (exec_cmd, out);
+
+    /* lines already queued: they will be displayed by the timer */
+    if (exec_cmd->hook_timer_output)
+        return;
+
+    if (exec_output_flush (
+            exec_cmd, buffer,
+            weechat_config_integer (exec_config_command_output_batch_lines)))
     {
-        new_size = exec_cmd->output_size[out] + length;
-        new_output = realloc (exec_cmd->output[out], new_size + 1);
-        if (!new_output)
-            return;
-        exec_cmd->output[out] = new_output;
-        memcpy (exec_cmd->output[out] + exec_cmd->output_size[out],
-                ptr_text, length + 1);
-        exec_cmd->output_size[out] = new_size;
+        exec_cmd->hook_timer_output = weechat_hook_timer (
+            EXEC_OUTPUT_FLUSH_DELAY, 0, 0,
+            &exec_timer_output_cb, exec_cmd, NULL);
     }
 }
 
@@ -481,11 +745,30 @@ exec_end_command (struct t_exec_cmd *exec_cmd, int return_code)
     {
         ptr_buffer = weechat_buffer_search ("==", exec_cmd->buffer_full_name);
 
+        /* display all lines still queued */
+        exec_output_flush (exec_cmd, ptr_buffer, 0);
+
         /* display the last line of output (if not ending with '\n') */
-        exec_display_line (exec_cmd, ptr_buffer, EXEC_STDOUT,
-                           exec_cmd->output[EXEC_STDOUT]);
-        exec_display_line (exec_cmd, ptr_buffer, EXEC_STDERR,
-                           exec_cmd->output[EXEC_STDERR]);
+        for (i = 0; i < 2; i++)
+        {
+            if (exec_cmd->output_size[i] > 0)
+            {
+                exec_display_lines (exec_cmd, ptr_buffer, i,
+                                    exec_cmd->output[i]
+                                    + exec_cmd->output_start[i]);
+            }
+        }
+
+        if (exec_cmd->output_lines_dropped > 0)
+        {
+            weechat_printf (NULL,
+                            _("%s%s: %d lines of output dropped for command "
+                              "%d (\"%s\") (see option "
+                              "exec.command.output_max_size)"),
+                            weechat_prefix ("error"), EXEC_PLUGIN_NAME,
+                            exec_cmd->output_lines_dropped,
+                            exec_cmd->number, exec_cmd->command);
+        }
 
         /*
          * display return code (only if command is not detached, if output is
@@ -541,6 +824,11 @@ exec_end_command (struct t_exec_cmd *exec_cmd, int return_code)
 
     /* (re)set some variables after the end of command */
     exec_cmd->hook = NULL;
+    if (exec_cmd->hook_timer_output)
+    {
+        weechat_unhook (exec_cmd->hook_timer_output);
+        exec_cmd->hook_timer_output = NULL;
+    }
     exec_cmd->pid = 0;
     exec_cmd->end_time = time (NULL);
     exec_cmd->return_code = return_code;
@@ -552,6 +840,8 @@ exec_end_command (struct t_exec_cmd *exec_cmd, int return_code)
             exec_cmd->output[i] = NULL;
         }
         exec_cmd->output_size[i] = 0;
+        exec_cmd->output_start[i] = 0;
+        exec_cmd->output_alloc[i] = 0;
     }
 
     /* schedule a timer to remove the executed command */
@@ -637,6 +927,8 @@ exec_free (struct t_exec_cmd *exec_cmd)
     /* free data */
     if (exec_cmd->hook)
         weechat_unhook (exec_cmd->hook);
+    if (exec_cmd->hook_timer_output)
+        weechat_unhook (exec_cmd->hook_timer_output);
     if (exec_cmd->name)
         free (exec_cmd->name);
     if (exec_cmd->command)
@@ -700,9 +992,15 @@ exec_print_log ()
         weechat_log_printf ("  display_rc. . . . . . . . : %d",    ptr_exec_cmd->display_rc);
         weechat_log_printf ("  output_line_nb. . . . . . : %d",    ptr_exec_cmd->output_line_nb);
         weechat_log_printf ("  output_size[stdout] . . . : %d",    ptr_exec_cmd->output_size[EXEC_STDOUT]);
-        weechat_log_printf ("  output[stdout]. . . . . . : '%s'",  ptr_exec_cmd->output[EXEC_STDOUT]);
+        weechat_log_printf ("  output[stdout]. . . . . . : 0x%lx", ptr_exec_cmd->output[EXEC_STDOUT]);
+        weechat_log_printf ("  output_start[stdout]. . . : %d",    ptr_exec_cmd->output_start[EXEC_STDOUT]);
+        weechat_log_printf ("  output_alloc[stdout]. . . : %d",    ptr_exec_cmd->output_alloc[EXEC_STDOUT]);
         weechat_log_printf ("  output_size[stderr] . . . : %d",    ptr_exec_cmd->output_size[EXEC_STDERR]);
-        weechat_log_printf ("  output[stderr]. . . . . . : '%s'",  ptr_exec_cmd->output[EXEC_STDERR]);
+        weechat_log_printf ("  output[stderr]. . . . . . : 0x%lx", ptr_exec_cmd->output[EXEC_STDERR]);
+        weechat_log_printf ("  output_start[stderr]. . . : %d",    ptr_exec_cmd->output_start[EXEC_STDERR]);
+        weechat_log_printf ("  output_alloc[stderr]. . . : %d",    ptr_exec_cmd->output_alloc[EXEC_STDERR]);
+        weechat_log_printf ("  output_lines_dropped. . . : %d",    ptr_exec_cmd->output_lines_dropped);
+        weechat_log_printf ("  hook_timer_output . . . . : 0x%lx", ptr_exec_cmd->hook_timer_output);
         weechat_log_printf ("  return_code . . . . . . . : %d",    ptr_exec_cmd->return_code);
         weechat_log_printf ("  pipe_command. . . . . . . : '%s'",  ptr_exec_cmd->pipe_command);
         weechat_log_printf ("  hsignal . . . . . . . . . : '%s'",  ptr_exec_cmd->hsignal);
@@ -29,6 +29,9 @@
 #define EXEC_STDOUT 0
 #define EXEC_STDERR 1
 
+/* delay between two displays of queued output (in milliseconds) */
+#define EXEC_OUTPUT_FLUSH_DELAY 100
+
 enum t_exec_color
 {
     EXEC_COLOR_ANSI = 0,
@@ -64,6 +67,10 @@ struct t_exec_cmd
     int output_line_nb;                /* line number                       */
     int output_size[2];                /* number of bytes in stdout/stderr  */
     char *output[2];                   /* stdout/stderr of command          */
+    int output_start[2];               /* start of data in output buffers   */
+    int output_alloc[2];               /* allocated size of output buffers  */
+    int output_lines_dropped;          /* lines dropped (too much output)   */
+    struct t_hook *hook_timer_output;  /* timer to display queued output    */
     int return_code;                   /* command return code               */
 
     /* pipe/hsignal */
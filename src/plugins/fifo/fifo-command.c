@@ -24,6 +24,7 @@
 #include "../weechat-plugin.h"
 #include "fifo.h"
 #include "fifo-config.h"
+#include "fifo-socket.h"
 
 
 /*
@@ -55,6 +56,18 @@ fifo_command_fifo (const void *pointer, void *data,
             weechat_printf (NULL,
                             _("%s: pipe is disabled"), FIFO_PLUGIN_NAME);
         }
+        if (fifo_socket_fd != -1)
+        {
+            weechat_printf (NULL,
+                            NG_("%s: socket is enabled (file: %s), "
+                                "%d client connected",
+                                "%s: socket is enabled (file: %s), "
+                                "%d clients connected",
+                                fifo_socket_count_clients),
+                            FIFO_PLUGIN_NAME,
+                            fifo_socket_filename,
+                            fifo_socket_count_clients);
+        }
         return WEECHAT_RC_OK;
     }
 
@@ -112,6 +125,16 @@ fifo_command_init ()
            "  echo 'irc.server.freenode */nick newnick' "
            ">~/.weechat/weechat_fifo\n"
            "\n"
+           "If option fifo.socket.enabled is on, the same lines are accepted "
+           "on a UNIX domain socket (by default ~/.weechat/weechat_socket) "
+           "by many clients at same time. A client can send the line "
+           "\"#reply json\" or \"#reply binary\" to receive a reply for "
+           "each command, with the request number, the return code and the "
+           "lines printed by the command: in JSON, one object per line; in "
+           "binary, a header with size of data, request number and return "
+           "code (three 32-bit big-endian integers) followed by the lines "
+           "printed (\"buffer<tab>prefix<tab>message\").\n"
+           "\n"
            "Please read the user's guide for more info and examples.\n"
            "\n"
            "Examples:\n"
@@ -24,6 +24,7 @@
 #include "../weechat-plugin.h"
 #include "fifo.h"
 #include "fifo-config.h"
+#include "fifo-socket.h"
 
 
 struct t_config_file *fifo_config_file = NULL;
@@ -33,6 +34,13 @@ struct t_config_file *fifo_config_file = NULL;
 struct t_config_option *fifo_config_file_enabled;
 struct t_config_option *fifo_config_file_path;
 
+/* fifo config, socket section */
+
+struct t_config_option *fifo_config_socket_enabled;
+struct t_config_option *fifo_config_socket_max_clients;
+struct t_config_option *fifo_config_socket_max_output_size;
+struct t_config_option *fifo_config_socket_path;
+
 
 /*
  * Callback for changes on option "enabled".
@@ -74,6 +82,46 @@ fifo_config_change_file_path (const void *pointer, void *data,
     fifo_quiet = 0;
 }
 
+/*
+ * Callback for changes on option "fifo.socket.enabled".
+ */
+
+void
+fifo_config_change_socket_enabled (const void *pointer, void *data,
+                                   struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    fifo_socket_remove ();
+
+    if (weechat_config_boolean (fifo_config_socket_enabled))
+        fifo_socket_create ();
+}
+
+/*
+ * Callback for changes on option "fifo.socket.path".
+ */
+
+void
+fifo_config_change_socket_path (const void *pointer, void *data,
+                                struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    fifo_quiet = 1;
+
+    fifo_socket_remove ();
+    fifo_socket_create ();
+
+    fifo_quiet = 0;
+}
+
 /*
  * Initializes fifo configuration file.
  *
@@ -126,6 +174,57 @@ fifo_config_init ()
         fifo_config_change_file_path, NULL, NULL,
         NULL, NULL, NULL);
 
+    /* socket */
+    ptr_section = weechat_config_new_section (fifo_config_file, "socket",
+                                              0, 0,
+                                              NULL, NULL, NULL,
+                                              NULL, NULL, NULL,
+                                              NULL, NULL, NULL,
+                                              NULL, NULL, NULL,
+                                              NULL, NULL, NULL);
+    if (!ptr_section)
+    {
+        weechat_config_free (fifo_config_file);
+        return 0;
+    }
+
+    fifo_config_socket_enabled = weechat_config_new_option (
+        fifo_config_file, ptr_section,
+        "enabled", "boolean",
+        N_("enable UNIX domain socket for remote control: unlike the FIFO "
+           "pipe, many clients can be connected at same time and replies "
+           "can be sent to clients (see /help fifo)"),
+        NULL, 0, 0, "off", NULL, 0,
+        NULL, NULL, NULL,
+        &fifo_config_change_socket_enabled, NULL, NULL,
+        NULL, NULL, NULL);
+    fifo_config_socket_max_clients = weechat_config_new_option (
+        fifo_config_file, ptr_section,
+        "max_clients", "integer",
+        N_("max number of clients connected on socket (0 = no limit)"),
+        NULL, 0, 65535, "16", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    fifo_config_socket_max_output_size = weechat_config_new_option (
+        fifo_config_file, ptr_section,
+        "max_output_size", "integer",
+        N_("max size of replies waiting to be read by a client (in "
+           "kilobytes); when this size is reached, the commands received "
+           "from this client are not executed any more until it reads the "
+           "replies (0 = no limit)"),
+        NULL, 0, 1024 * 1024, "1024", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    fifo_config_socket_path = weechat_config_new_option (
+        fifo_config_file, ptr_section,
+        "path", "string",
+        N_("path for socket; \"%h\" at beginning of string is "
+           "replaced by WeeChat home (\"~/.weechat\" by default); "
+           "WeeChat PID can be used in path with ${info:pid} "
+           "(note: content is evaluated, see /help eval)"),
+        NULL, 0, 0, "%h/weechat_socket", NULL, 0,
+        NULL, NULL, NULL,
+        &fifo_config_change_socket_path, NULL, NULL,
+        NULL, NULL, NULL);
+
     return 1;
 }
 
@@ -26,6 +26,11 @@
 extern struct t_config_option *fifo_config_file_enabled;
 extern struct t_config_option *fifo_config_file_path;
 
+extern struct t_config_option *fifo_config_socket_enabled;
+extern struct t_config_option *fifo_config_socket_max_clients;
+extern struct t_config_option *fifo_config_socket_max_output_size;
+extern struct t_config_option *fifo_config_socket_path;
+
 extern int fifo_config_init ();
 extern int fifo_config_read ();
 extern int fifo_config_write ();
@@ -0,0 +1,897 @@
+/*
+ * fifo-socket.c - remote control with a UNIX domain socket
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "../weechat-plugin.h"
+#include "fifo.h"
+#include "fifo-config.h"
+#include "fifo-socket.h"
+
+
+int fifo_socket_fd = -1;               /* listening socket                  */
+struct t_hook *fifo_socket_hook = NULL; /* hook to accept clients           */
+char *fifo_socket_filename = NULL;     /* path to socket                    */
+
+struct t_fifo_socket_client *fifo_socket_clients = NULL;
+struct t_fifo_socket_client *last_fifo_socket_client = NULL;
+int fifo_socket_count_clients = 0;
+
+/* lines printed by the command currently executed for a client */
+struct t_hook *fifo_socket_capture_hook = NULL;
+struct t_fifo_socket_client *fifo_socket_capture_client = NULL;
+char *fifo_socket_capture = NULL;
+int fifo_socket_capture_size = 0;
+int fifo_socket_capture_alloc = 0;
+int fifo_socket_capture_lines = 0;
+
+char *fifo_socket_reply_string[FIFO_SOCKET_NUM_REPLIES] =
+{ "none", "json", "binary" };
+
+
+int fifo_socket_client_fd_cb (const void *pointer, void *data, int fd);
+
+
+/*
+ * Appends data to a dynamic buffer (the buffer is grown if needed).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+fifo_socket_buffer_add (char **buffer, int *size, int *alloc,
+                        const void *data, int length)
+{
+    char *new_buffer;
+    int new_alloc;
+
+    if (length <= 0)
+        return 1;
+
+    if (*size + length > *alloc)
+    {
+        new_alloc = (*alloc > 0) ? *alloc : 4096;
+        while (new_alloc < *size + length)
+        {
+            new_alloc *= 2;
+        }
+        new_buffer = realloc (*buffer, new_alloc);
+        if (!new_buffer)
+            return 0;
+        *buffer = new_buffer;
+        *alloc = new_alloc;
+    }
+
+    memcpy (*buffer + *size, data, length);
+    *size += length;
+
+    return 1;
+}
+
+/*
+ * Appends a string to the capture buffer, escaped for JSON.
+ */
+
+void
+fifo_socket_capture_add_json_string (const char *string)
+{
+    char str_char[16];
+    const char *ptr_string, *ptr_start;
+
+    fifo_socket_buffer_add (&fifo_socket_capture, &fifo_socket_capture_size,
+                            &fifo_socket_capture_alloc, "\"", 1);
+
+    ptr_start = string;
+    for (ptr_string = string; ptr_string[0]; ptr_string++)
+    {
+        if ((ptr_string[0] == '"') || (ptr_string[0] == '\\')
+            || ((unsigned char)ptr_string[0] < 32))
+        {
+            fifo_socket_buffer_add (&fifo_socket_capture,
+                                    &fifo_socket_capture_size,
+                                    &fifo_socket_capture_alloc,
+                                    ptr_start, ptr_string - ptr_start);
+            switch (ptr_string[0])
+            {
+                case '"':
+                case '\\':
+                    snprintf (str_char, sizeof (str_char),
+                              "\\%c", ptr_string[0]);
+                    break;
+                case '\n':
+                    snprintf (str_char, sizeof (str_char), "\\n");
+                    break;
+                case '\t':
+                    snprintf (str_char, sizeof (str_char), "\\t");
+                    break;
+                default:
+                    snprintf (str_char, sizeof (str_char),
+                              "\\u%04x", (unsigned char)ptr_string[0]);
+                    break;
+            }
+            fifo_socket_buffer_add (&fifo_socket_capture,
+                                    &fifo_socket_capture_size,
+                                    &fifo_socket_capture_alloc,
+                                    str_char, strlen (str_char));
+            ptr_start = ptr_string + 1;
+        }
+    }
+    fifo_socket_buffer_add (&fifo_socket_capture, &fifo_socket_capture_size,
+                            &fifo_socket_capture_alloc,
+                            ptr_start, ptr_string - ptr_start);
+
+    fifo_socket_buffer_add (&fifo_socket_capture, &fifo_socket_capture_size,
+                            &fifo_socket_capture_alloc, "\"", 1);
+}
+
+/*
+ * Callback for lines printed while a command received on socket is
+ * executed: the lines are added to the reply.
+ */
+
+int
+fifo_socket_capture_print_cb (const void *pointer, void *data,
+                              struct t_gui_buffer *buffer, time_t date,
+                              int tags_count, const char **tags,
+                              int displayed, int highlight,
+                              const char *prefix, const char *message)
+{
+    const char *ptr_buffer_name;
+    char *prefix_no_color;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+
+    if (!fifo_socket_capture_client)
+        return WEECHAT_RC_OK;
+
+    ptr_buffer_name = weechat_buffer_get_string (buffer, "full_name");
+    prefix_no_color = (prefix) ? weechat_string_remove_color (prefix, NULL) : NULL;
+
+    if (fifo_socket_capture_client->reply == FIFO_SOCKET_REPLY_JSON)
+    {
+        /* JSON: {"buffer":"...","prefix":"...","message":"..."} */
+        if (fifo_socket_capture_lines > 0)
+        {
+            fifo_socket_buffer_add (&fifo_socket_capture,
+                                    &fifo_socket_capture_size,
+                                    &fifo_socket_capture_alloc, ",", 1);
+        }
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc,
+                                "{\"buffer\":", 10);
+        fifo_socket_capture_add_json_string (
+            (ptr_buffer_name) ? ptr_buffer_name : "");
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc,
+                                ",\"prefix\":", 10);
+        fifo_socket_capture_add_json_string (
+            (prefix_no_color) ? prefix_no_color : "");
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc,
+                                ",\"message\":", 11);
+        fifo_socket_capture_add_json_string ((message) ? message : "");
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc, "}", 1);
+    }
+    else
+    {
+        /* binary: "buffer\tprefix\tmessage\n" */
+        if (ptr_buffer_name)
+        {
+            fifo_socket_buffer_add (&fifo_socket_capture,
+                                    &fifo_socket_capture_size,
+                                    &fifo_socket_capture_alloc,
+                                    ptr_buffer_name,
+                                    strlen (ptr_buffer_name));
+        }
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc, "\t", 1);
+        if (prefix_no_color)
+        {
+            fifo_socket_buffer_add (&fifo_socket_capture,
+                                    &fifo_socket_capture_size,
+                                    &fifo_socket_capture_alloc,
+                                    prefix_no_color,
+                                    strlen (prefix_no_color));
+        }
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc, "\t", 1);
+        if (message)
+        {
+            fifo_socket_buffer_add (&fifo_socket_capture,
+                                    &fifo_socket_capture_size,
+                                    &fifo_socket_capture_alloc,
+                                    message, strlen (message));
+        }
+        fifo_socket_buffer_add (&fifo_socket_capture,
+                                &fifo_socket_capture_size,
+                                &fifo_socket_capture_alloc, "\n", 1);
+    }
+
+    fifo_socket_capture_lines++;
+
+    if (prefix_no_color)
+        free (prefix_no_color);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Checks if a client pointer is valid.
+ *
+ * Returns:
+ *   1: client exists
+ *   0: client does not exist
+ */
+
+int
+fifo_socket_client_valid (struct t_fifo_socket_client *client)
+{
+    struct t_fifo_socket_client *ptr_client;
+
+    if (!client)
+        return 0;
+
+    for (ptr_client = fifo_socket_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if (ptr_client == client)
+            return 1;
+    }
+
+    /* client not found */
+    return 0;
+}
+
+/*
+ * Frees a client and closes its socket.
+ */
+
+void
+fifo_socket_client_free (struct t_fifo_socket_client *client)
+{
+    if (!client)
+        return;
+
+    if (fifo_socket_capture_client == client)
+        fifo_socket_capture_client = NULL;
+
+    if (client->hook_fd)
+        weechat_unhook (client->hook_fd);
+    if (client->sock >= 0)
+        close (client->sock);
+    if (client->input)
+        free (client->input);
+    if (client->output)
+        free (client->output);
+
+    /* remove client from list */
+    if (client->prev_client)
+        (client->prev_client)->next_client = client->next_client;
+    if (client->next_client)
+        (client->next_client)->prev_client = client->prev_client;
+    if (fifo_socket_clients == client)
+        fifo_socket_clients = client->next_client;
+    if (last_fifo_socket_client == client)
+        last_fifo_socket_client = client->prev_client;
+
+    free (client);
+
+    fifo_socket_count_clients--;
+}
+
+/*
+ * Hooks the socket of a client with flags according to its state: "read"
+ * if the read is not paused, "write" if some data is waiting to be sent.
+ *
+ * Only one hook is allowed by file descriptor, so the hook is replaced when
+ * the flags change.
+ */
+
+void
+fifo_socket_client_set_hook (struct t_fifo_socket_client *client)
+{
+    int flag_read, flag_write;
+
+    flag_read = (client->paused) ? 0 : 1;
+    flag_write = (client->output_pos < client->output_size) ? 1 : 0;
+
+    if (client->hook_fd
+        && (flag_read == client->hook_fd_read)
+        && (flag_write == client->hook_fd_write))
+    {
+        return;
+    }
+
+    if (client->hook_fd)
+    {
+        weechat_unhook (client->hook_fd);
+        client->hook_fd = NULL;
+    }
+
+    client->hook_fd = weechat_hook_fd (client->sock, flag_read, flag_write, 0,
+                                       &fifo_socket_client_fd_cb,
+                                       client, NULL);
+    client->hook_fd_read = flag_read;
+    client->hook_fd_write = flag_write;
+}
+
+/*
+ * Sends data queued for a client, without blocking: if the socket is full,
+ * the remaining data is sent when the socket becomes writable.
+ *
+ * Returns:
+ *   1: OK (data sent or queued)
+ *   0: error (client has been freed)
+ */
+
+int
+fifo_socket_client_flush (struct t_fifo_socket_client *client)
+{
+    int num_sent;
+
+    while (client->output_pos < client->output_size)
+    {
+        num_sent = send (client->sock, client->output + client->output_pos,
+                         client->output_size - client->output_pos, 0);
+        if (num_sent < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+            if (errno == EINTR)
+                continue;
+            fifo_socket_client_free (client);
+            return 0;
+        }
+        client->output_pos += num_sent;
+    }
+
+    if (client->output_pos >= client->output_size)
+    {
+        /* all data sent */
+        client->output_pos = 0;
+        client->output_size = 0;
+    }
+
+    fifo_socket_client_set_hook (client);
+
+    return 1;
+}
+
+/*
+ * Adds the reply to a request in output of client.
+ */
+
+void
+fifo_socket_client_add_reply (struct t_fifo_socket_client *client, int rc)
+{
+    char str_reply[128];
+    uint32_t header[3];
+
+    if (client->reply == FIFO_SOCKET_REPLY_JSON)
+    {
+        snprintf (str_reply, sizeof (str_reply),
+                  "{\"id\":%llu,\"rc\":%d,\"lines\":[",
+                  client->requests, rc);
+        fifo_socket_buffer_add (&client->output, &client->output_size,
+                                &client->output_alloc,
+                                str_reply, strlen (str_reply));
+        fifo_socket_buffer_add (&client->output, &client->output_size,
+                                &client->output_alloc,
+                                fifo_socket_capture,
+                                fifo_socket_capture_size);
+        fifo_socket_buffer_add (&client->output, &client->output_size,
+                                &client->output_alloc, "]}\n", 3);
+    }
+    else if (client->reply == FIFO_SOCKET_REPLY_BINARY)
+    {
+        header[0] = htonl ((uint32_t)fifo_socket_capture_size);
+        header[1] = htonl ((uint32_t)client->requests);
+        header[2] = htonl ((uint32_t)rc);
+        fifo_socket_buffer_add (&client->output, &client->output_size,
+                                &client->output_alloc,
+                                header, FIFO_SOCKET_BINARY_HEADER_SIZE);
+        fifo_socket_buffer_add (&client->output, &client->output_size,
+                                &client->output_alloc,
+                                fifo_socket_capture,
+                                fifo_socket_capture_size);
+    }
+}
+
+/*
+ * Executes a control line received from a client (beginning with "#").
+ */
+
+void
+fifo_socket_client_control (struct t_fifo_socket_client *client,
+                            const char *line)
+{
+    int i;
+
+    if (strncmp (line, "#reply ", 7) == 0)
+    {
+        for (i = 0; i < FIFO_SOCKET_NUM_REPLIES; i++)
+        {
+            if (strcmp (line + 7, fifo_socket_reply_string[i]) == 0)
+            {
+                client->reply = i;
+                return;
+            }
+        }
+    }
+
+    weechat_printf (NULL,
+                    _("%s%s: invalid control line received on socket: "
+                      "\"%s\""),
+                    weechat_prefix ("error"), FIFO_PLUGIN_NAME, line);
+}
+
+/*
+ * Executes a line received from a client and adds the reply to its output.
+ *
+ * Returns:
+ *   1: OK
+ *   0: client has been freed by the command
+ */
+
+int
+fifo_socket_client_exec_line (struct t_fifo_socket_client *client,
+                              const char *line)
+{
+    int rc;
+
+    if (line[0] == '#')
+    {
+        fifo_socket_client_control (client, line);
+        return 1;
+    }
+
+    client->requests++;
+
+    if (client->reply == FIFO_SOCKET_REPLY_NONE)
+    {
+        fifo_exec (line);
+        return fifo_socket_client_valid (client);
+    }
+
+    /* the hook is removed after execution of all lines received */
+    if (!fifo_socket_capture_hook)
+    {
+        fifo_socket_capture_hook = weechat_hook_print (
+            NULL, NULL, NULL, 1,
+            &fifo_socket_capture_print_cb, NULL, NULL);
+    }
+
+    fifo_socket_capture_client = client;
+    fifo_socket_capture_size = 0;
+    fifo_socket_capture_lines = 0;
+
+    rc = fifo_exec (line);
+
+    fifo_socket_capture_client = NULL;
+
+    if (!fifo_socket_client_valid (client))
+        return 0;
+
+    fifo_socket_client_add_reply (client, rc);
+
+    return 1;
+}
+
+/*
+ * Executes the complete lines received from a client.
+ *
+ * When too much data is waiting to be sent to the client (option
+ * fifo.socket.max_output_size), the execution is stopped and the socket is
+ * not read any more: it is resumed when the client has read the replies.
+ */
+
+void
+fifo_socket_client_process (struct t_fifo_socket_client *client)
+{
+    char *pos;
+    int start, length, max_output, valid, unterminated;
+
+    max_output = weechat_config_integer (fifo_config_socket_max_output_size) * 1024;
+
+    valid = 1;
+    unterminated = 0;
+    start = 0;
+    while (start < client->input_size)
+    {
+        if ((max_output > 0) && (client->output_size >= max_output))
+        {
+            if (!fifo_socket_client_flush (client))
+            {
+                valid = 0;
+                break;
+            }
+            if (client->output_size >= max_output)
+            {
+                /* client does not read replies: stop reading its requests */
+                client->paused = 1;
+                fifo_socket_client_set_hook (client);
+                break;
+            }
+        }
+        pos = memchr (client->input + start, '\n', client->input_size - start);
+        if (!pos)
+        {
+            unterminated = 1;
+            break;
+        }
+        pos[0] = '\0';
+        length = pos - (client->input + start);
+        if ((length > 0) && (pos[-1] == '\r'))
+            pos[-1] = '\0';
+        if (client->input[start])
+        {
+            if (!fifo_socket_client_exec_line (client, client->input + start))
+            {
+                valid = 0;
+                break;
+            }
+        }
+        start += length + 1;
+    }
+
+    if (fifo_socket_capture_hook)
+    {
+        weechat_unhook (fifo_socket_capture_hook);
+        fifo_socket_capture_hook = NULL;
+    }
+
+    if (!valid)
+        return;
+
+    /* keep unterminated line (or lines not executed) */
+    if (start > 0)
+    {
+        memmove (client->input, client->input + start,
+                 client->input_size - start);
+        client->input_size -= start;
+    }
+    if (unterminated && (client->input_size > FIFO_SOCKET_MAX_LINE_SIZE))
+    {
+        weechat_printf (NULL,
+                        _("%s%s: line too long received on socket, "
+                          "closing connection"),
+                        weechat_prefix ("error"), FIFO_PLUGIN_NAME);
+        fifo_socket_client_free (client);
+        return;
+    }
+
+    fifo_socket_client_flush (client);
+}
+
+/*
+ * Callback for socket of a client: sends replies waiting to be sent and
+ * reads requests.
+ */
+
+int
+fifo_socket_client_fd_cb (const void *pointer, void *data, int fd)
+{
+    struct t_fifo_socket_client *client;
+    char buffer[FIFO_SOCKET_READ_SIZE];
+    int num_read;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) fd;
+
+    client = (struct t_fifo_socket_client *)pointer;
+
+    if (client->output_pos < client->output_size)
+    {
+        if (!fifo_socket_client_flush (client))
+            return WEECHAT_RC_OK;
+        if (client->paused && (client->output_size == 0))
+        {
+            /* all replies sent: resume execution and read of requests */
+            client->paused = 0;
+            fifo_socket_client_process (client);
+            return WEECHAT_RC_OK;
+        }
+    }
+
+    if (client->paused)
+        return WEECHAT_RC_OK;
+
+    num_read = recv (client->sock, buffer, sizeof (buffer), 0);
+    if (num_read > 0)
+    {
+        if (!fifo_socket_buffer_add (&client->input, &client->input_size,
+                                     &client->input_alloc,
+                                     buffer, num_read))
+        {
+            weechat_printf (NULL,
+                            _("%s%s: not enough memory (%s)"),
+                            weechat_prefix ("error"), FIFO_PLUGIN_NAME,
+                            "socket");
+            fifo_socket_client_free (client);
+            return WEECHAT_RC_OK;
+        }
+        fifo_socket_client_process (client);
+    }
+    else if ((num_read == 0)
+             || ((errno != EAGAIN) && (errno != EWOULDBLOCK)
+                 && (errno != EINTR)))
+    {
+        /* connection closed by client, or error */
+        fifo_socket_client_free (client);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Accepts a new client on the control socket.
+ */
+
+int
+fifo_socket_accept_cb (const void *pointer, void *data, int fd)
+{
+    struct t_fifo_socket_client *new_client;
+    int client_fd, flags, max_clients;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) fd;
+
+    client_fd = accept (fifo_socket_fd, NULL, NULL);
+    if (client_fd < 0)
+        return WEECHAT_RC_OK;
+
+    max_clients = weechat_config_integer (fifo_config_socket_max_clients);
+    if ((max_clients > 0) && (fifo_socket_count_clients >= max_clients))
+    {
+        close (client_fd);
+        return WEECHAT_RC_OK;
+    }
+
+    new_client = malloc (sizeof (*new_client));
+    if (!new_client)
+    {
+        close (client_fd);
+        return WEECHAT_RC_OK;
+    }
+
+    flags = fcntl (client_fd, F_GETFL);
+    if (flags == -1)
+        flags = 0;
+    fcntl (client_fd, F_SETFL, flags | O_NONBLOCK);
+
+    new_client->sock = client_fd;
+    new_client->hook_fd = NULL;
+    new_client->hook_fd_read = 0;
+    new_client->hook_fd_write = 0;
+    new_client->paused = 0;
+    new_client->reply = FIFO_SOCKET_REPLY_NONE;
+    new_client->requests = 0;
+    new_client->input = NULL;
+    new_client->input_size = 0;
+    new_client->input_alloc = 0;
+    new_client->output = NULL;
+    new_client->output_pos = 0;
+    new_client->output_size = 0;
+    new_client->output_alloc = 0;
+
+    new_client->prev_client = last_fifo_socket_client;
+    new_client->next_client = NULL;
+    if (last_fifo_socket_client)
+        last_fifo_socket_client->next_client = new_client;
+    else
+        fifo_socket_clients = new_client;
+    last_fifo_socket_client = new_client;
+
+    fifo_socket_count_clients++;
+
+    fifo_socket_client_set_hook (new_client);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Creates UNIX domain socket for remote control.
+ */
+
+void
+fifo_socket_create ()
+{
+    struct stat st;
+    struct sockaddr_un addr;
+    mode_t old_umask;
+    int flags;
+
+    if (!weechat_config_boolean (fifo_config_socket_enabled))
+        return;
+
+    if (!fifo_socket_filename)
+    {
+        /* replace %h and "~", evaluate path */
+        fifo_socket_filename = weechat_string_eval_path_home (
+            weechat_config_string (fifo_config_socket_path),
+            NULL, NULL, NULL);
+    }
+
+    if (!fifo_socket_filename)
+    {
+        weechat_printf (NULL,
+                        _("%s%s: not enough memory (%s)"),
+                        weechat_prefix ("error"), FIFO_PLUGIN_NAME,
+                        "fifo_socket_filename");
+        return;
+    }
+
+    if (strlen (fifo_socket_filename) >= sizeof (addr.sun_path))
+    {
+        weechat_printf (NULL,
+                        _("%s%s: path for socket is too long (%s)"),
+                        weechat_prefix ("error"), FIFO_PLUGIN_NAME,
+                        fifo_socket_filename);
+        free (fifo_socket_filename);
+        fifo_socket_filename = NULL;
+        return;
+    }
+
+    /* remove a socket with same name (if exists) */
+    if (stat (fifo_socket_filename, &st) == 0)
+    {
+        /* if the file is a socket, delete it */
+        if (S_ISSOCK(st.st_mode))
+            unlink (fifo_socket_filename);
+    }
+
+    fifo_socket_fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fifo_socket_fd < 0)
+    {
+        weechat_printf (NULL,
+                        _("%s%s: unable to create socket for remote "
+                          "control (%s): error %d %s"),
+                        weechat_prefix ("error"), FIFO_PLUGIN_NAME,
+                        fifo_socket_filename, errno, strerror (errno));
+        return;
+    }
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, fifo_socket_filename);
+
+    /* create socket, writable for user only */
+    old_umask = umask (0077);
+    if ((bind (fifo_socket_fd, (struct sockaddr *)&addr, sizeof (addr)) < 0)
+        || (listen (fifo_socket_fd, SOMAXCONN) < 0))
+    {
+        umask (old_umask);
+        weechat_printf (NULL,
+                        _("%s%s: unable to create socket for remote "
+                          "control (%s): error %d %s"),
+                        weechat_prefix ("error"), FIFO_PLUGIN_NAME,
+                        fifo_socket_filename, errno, strerror (errno));
+        close (fifo_socket_fd);
+        fifo_socket_fd = -1;
+        return;
+    }
+    umask (old_umask);
+
+    flags = fcntl (fifo_socket_fd, F_GETFL);
+    if (flags == -1)
+        flags = 0;
+    fcntl (fifo_socket_fd, F_SETFL, flags | O_NONBLOCK);
+
+    if ((weechat_fifo_plugin->debug >= 1) || !fifo_quiet)
+    {
+        weechat_printf (NULL,
+                        _("%s: socket opened (file: %s)"),
+                        FIFO_PLUGIN_NAME,
+                        fifo_socket_filename);
+    }
+    fifo_socket_hook = weechat_hook_fd (fifo_socket_fd, 1, 0, 0,
+                                        &fifo_socket_accept_cb, NULL, NULL);
+}
+
+/*
+ * Removes UNIX domain socket and disconnects all clients.
+ */
+
+void
+fifo_socket_remove ()
+{
+    int socket_found;
+
+    socket_found = (fifo_socket_fd != -1);
+
+    while (fifo_socket_clients)
+    {
+        fifo_socket_client_free (fifo_socket_clients);
+    }
+
+    if (fifo_socket_capture_hook)
+    {
+        weechat_unhook (fifo_socket_capture_hook);
+        fifo_socket_capture_hook = NULL;
+    }
+    if (fifo_socket_capture)
+    {
+        free (fifo_socket_capture);
+        fifo_socket_capture = NULL;
+    }
+    fifo_socket_capture_size = 0;
+    fifo_socket_capture_alloc = 0;
+
+    /* remove fd hook */
+    if (fifo_socket_hook)
+    {
+        weechat_unhook (fifo_socket_hook);
+        fifo_socket_hook = NULL;
+    }
+
+    /* close socket */
+    if (fifo_socket_fd != -1)
+    {
+        close (fifo_socket_fd);
+        fifo_socket_fd = -1;
+    }
+
+    /* remove socket from disk */
+    if (fifo_socket_filename)
+    {
+        if (socket_found)
+            unlink (fifo_socket_filename);
+        free (fifo_socket_filename);
+        fifo_socket_filename = NULL;
+    }
+
+    if (socket_found && !fifo_quiet)
+    {
+        weechat_printf (NULL,
+                        _("%s: socket closed"),
+                        FIFO_PLUGIN_NAME);
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_FIFO_SOCKET_H
+#define WEECHAT_FIFO_SOCKET_H 1
+
+/* max bytes read on a client socket in one call of the fd callback */
+#define FIFO_SOCKET_READ_SIZE (64 * 1024)
+
+/* max size of a line received (without newline) */
+#define FIFO_SOCKET_MAX_LINE_SIZE (1024 * 1024)
+
+/* size of header in binary replies: size of data, request id, return code */
+#define FIFO_SOCKET_BINARY_HEADER_SIZE 12
+
+/* format of replies sent to a client */
+
+enum t_fifo_socket_reply
+{
+    FIFO_SOCKET_REPLY_NONE = 0,        /* no reply (like the FIFO pipe)     */
+    FIFO_SOCKET_REPLY_JSON,            /* one JSON object per line          */
+    FIFO_SOCKET_REPLY_BINARY,          /* binary header + lines             */
+    /* number of reply formats */
+    FIFO_SOCKET_NUM_REPLIES,
+};
+
+/* client connected on control socket */
+
+struct t_fifo_socket_client
+{
+    int sock;                          /* socket for connection             */
+    struct t_hook *hook_fd;            /* hook for socket                   */
+    int hook_fd_read;                  /* 1 if hook has flag "read"         */
+    int hook_fd_write;                 /* 1 if hook has flag "write"        */
+    int paused;                        /* 1 if read is paused (too much     */
+                                       /* data waiting to be sent)          */
+    enum t_fifo_socket_reply reply;    /* format of replies                 */
+    unsigned long long requests;       /* number of requests received       */
+    char *input;                       /* data received, not yet executed   */
+    int input_size;                    /* size of data in input             */
+    int input_alloc;                   /* allocated size for input          */
+    char *output;                      /* replies not yet sent              */
+    int output_pos;                    /* position of data to send          */
+    int output_size;                   /* size of data in output            */
+    int output_alloc;                  /* allocated size for output         */
+    struct t_fifo_socket_client *prev_client; /* link to previous client    */
+    struct t_fifo_socket_client *next_client; /* link to next client        */
+};
+
+extern int fifo_socket_fd;
+extern char *fifo_socket_filename;
+extern struct t_fifo_socket_client *fifo_socket_clients;
+extern int fifo_socket_count_clients;
+
+extern void fifo_socket_create ();
+extern void fifo_socket_remove ();
+
+#endif /* WEECHAT_FIFO_SOCKET_H */
@@ -35,6 +35,7 @@
 #include "fifo-command.h"
 #include "fifo-config.h"
 #include "fifo-info.h"
+#include "fifo-socket.h"
 
 
 WEECHAT_PLUGIN_NAME(FIFO_PLUGIN_NAME);
@@ -181,18 +182,21 @@ fifo_remove ()
 }
 
 /*
- * Executes a command/text received in FIFO pipe.
+ * Executes a command/text received in FIFO pipe (or on control socket).
+ *
+ * Returns return code of command, WEECHAT_RC_ERROR if the text is invalid.
  */
 
-void
+int
 fifo_exec (const char *text)
 {
     char *text2, *pos_msg;
     struct t_gui_buffer *ptr_buffer;
+    int rc;
 
     text2 = strdup (text);
     if (!text2)
-        return;
+        return WEECHAT_RC_ERROR;
 
     pos_msg = NULL;
     ptr_buffer = NULL;
@@ -215,7 +219,7 @@ fifo_exec (const char *text)
                             _("%s%s: invalid text received in pipe"),
                             weechat_prefix ("error"), FIFO_PLUGIN_NAME);
             free (text2);
-            return;
+            return WEECHAT_RC_ERROR;
         }
         pos_msg[0] = '\0';
         pos_msg += 2;
@@ -227,13 +231,15 @@ fifo_exec (const char *text)
                             weechat_prefix ("error"), FIFO_PLUGIN_NAME,
                             text2);
             free (text2);
-            return;
+            return WEECHAT_RC_ERROR;
         }
     }
 
-    weechat_command (ptr_buffer, pos_msg);
+    rc = weechat_command (ptr_buffer, pos_msg);
 
     free (text2);
+
+    return rc;
 }
 
 /*
@@ -369,6 +375,7 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
     fifo_quiet = 1;
 
     fifo_create ();
+    fifo_socket_create ();
 
     fifo_command_init ();
     fifo_info_init ();
@@ -389,6 +396,7 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
     (void) plugin;
 
     fifo_remove ();
+    fifo_socket_remove ();
 
     fifo_config_write ();
     fifo_config_free ();
@@ -31,5 +31,6 @@ extern char *fifo_filename;
 
 extern void fifo_create ();
 extern void fifo_remove ();
+extern int fifo_exec (const char *text);
 
 #endif /* WEECHAT_FIFO_H */
@@ -1869,6 +1869,24 @@ weechat_guile_api_print_date_tags (SCM buffer, SCM date, SCM tags, SCM message)
     API_RETURN_OK;
 }
 
+SCM
+weechat_guile_api_print_lines (SCM buffer, SCM date, SCM tags, SCM lines)
+{
+    API_INIT_FUNC(1, "print_lines", API_RETURN_ERROR);
+    if (!scm_is_string (buffer) || !scm_is_integer (date)
+        || !scm_is_string (tags) || !scm_is_string (lines))
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    plugin_script_api_print_lines (weechat_guile_plugin,
+                                   guile_current_script,
+                                   API_STR2PTR(API_SCM_TO_STRING(buffer)),
+                                   scm_to_int (date),
+                                   API_SCM_TO_STRING(tags),
+                                   API_SCM_TO_STRING(lines));
+
+    API_RETURN_OK;
+}
+
 SCM
 weechat_guile_api_print_y (SCM buffer, SCM y, SCM message)
 {
@@ -4631,6 +4649,48 @@ weechat_guile_api_hdata_hashtable (SCM hdata, SCM pointer, SCM name)
     API_RETURN_OTHER(result_alist);
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * alist with the variables of object in the list (in reverse order).
+ */
+
+void
+weechat_guile_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                                  void *pointer, struct t_hashtable *record)
+{
+    SCM *list;
+
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    list = (SCM *)data;
+
+    *list = scm_cons (weechat_guile_hashtable_to_alist (record), *list);
+}
+
+SCM
+weechat_guile_api_hdata_fetch (SCM hdata, SCM pointer, SCM fields, SCM count)
+{
+    SCM result_list;
+
+    API_INIT_FUNC(1, "hdata_fetch", API_RETURN_EMPTY);
+    if (!scm_is_string (hdata) || !scm_is_string (pointer)
+        || !scm_is_string (fields) || !scm_is_integer (count))
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    result_list = SCM_EOL;
+
+    weechat_hdata_fetch (API_STR2PTR(API_SCM_TO_STRING(hdata)),
+                         API_STR2PTR(API_SCM_TO_STRING(pointer)),
+                         API_SCM_TO_STRING(fields),
+                         scm_to_int (count),
+                         &weechat_guile_api_hdata_fetch_cb,
+                         &result_list);
+
+    API_RETURN_OTHER(scm_reverse (result_list));
+}
+
 SCM
 weechat_guile_api_hdata_update (SCM hdata, SCM pointer, SCM hashtable)
 {
@@ -4883,6 +4943,7 @@ weechat_guile_api_module_init (void *data)
     API_DEF_FUNC(color, 1);
     API_DEF_FUNC(print, 2);
     API_DEF_FUNC(print_date_tags, 4);
+    API_DEF_FUNC(print_lines, 4);
     API_DEF_FUNC(print_y, 3);
     API_DEF_FUNC(log_print, 1);
     API_DEF_FUNC(hook_command, 7);
@@ -4991,6 +5052,7 @@ weechat_guile_api_module_init (void *data)
     API_DEF_FUNC(hdata_pointer, 3);
     API_DEF_FUNC(hdata_time, 3);
     API_DEF_FUNC(hdata_hashtable, 3);
+    API_DEF_FUNC(hdata_fetch, 4);
     API_DEF_FUNC(hdata_update, 3);
     API_DEF_FUNC(hdata_get_string, 2);
     API_DEF_FUNC(upgrade_new, 3);
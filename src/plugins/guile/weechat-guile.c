@@ -137,17 +137,52 @@ weechat_guile_scm_call_n (void *proc)
                        guile_function->argv, guile_function->nargs);
 }
 
+/*
+ * Callback called to free a reference to a scheme function.
+ */
+
+void
+weechat_guile_function_ref_free_cb (struct t_hashtable *hashtable,
+                                    const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    weechat_guile_catch (scm_gc_unprotect_object, value);
+}
+
 /*
  * Executes scheme function (with optional args) and returns value.
+ *
+ * The variable of function is cached in script, so that the function name is
+ * not searched again in module on next calls (the value of variable is read
+ * on each call, so that a function redefined by the script is used).
  */
 
 SCM
-weechat_guile_exec_function (const char *function, SCM *argv, size_t nargs)
+weechat_guile_exec_function (struct t_plugin_script *script,
+                             const char *function, SCM *argv, size_t nargs)
 {
     SCM func, func2, value;
     struct t_guile_function guile_function;
 
-    func = weechat_guile_catch (scm_c_lookup, (void *)function);
+    func = (SCM)plugin_script_function_ref_get (weechat_guile_plugin,
+                                                script, function);
+    if (!func)
+    {
+        func = weechat_guile_catch (scm_c_lookup, (void *)function);
+        if (scm_is_true (scm_variable_p (func)))
+        {
+            weechat_guile_catch (scm_gc_protect_object, (void *)func);
+            if (!plugin_script_function_ref_set (weechat_guile_plugin,
+                                                 script, function, (void *)func,
+                                                 &weechat_guile_function_ref_free_cb))
+            {
+                weechat_guile_catch (scm_gc_unprotect_object, (void *)func);
+            }
+        }
+    }
     func2 = weechat_guile_catch (scm_variable_ref, func);
 
     if (argv)
@@ -303,11 +338,12 @@ weechat_guile_exec (struct t_plugin_script *script,
         {
             argv2[i] = SCM_UNDEFINED;
         }
-        rc = weechat_guile_exec_function (function, (SCM *)argv2, argc);
+        rc = weechat_guile_exec_function (script, function,
+                                          (SCM *)argv2, argc);
     }
     else
     {
-        rc = weechat_guile_exec_function (function, NULL, 0);
+        rc = weechat_guile_exec_function (script, function, NULL, 0);
     }
 
     ret_value = NULL;
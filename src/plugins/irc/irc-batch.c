@@ -0,0 +1,456 @@
+/*
+ * irc-batch.c - batch of IRC messages (IRCv3 capability "batch")
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../weechat-plugin.h"
+#include "irc.h"
+#include "irc-batch.h"
+#include "irc-channel.h"
+#include "irc-protocol.h"
+#include "irc-server.h"
+
+
+int irc_batch_processing = 0;          /* > 0 if messages of a batch are    */
+                                       /* being processed                   */
+
+
+/*
+ * Searches for a batch by reference.
+ *
+ * Returns pointer to batch found, NULL if not found.
+ */
+
+struct t_irc_batch *
+irc_batch_search (struct t_irc_server *server, const char *reference)
+{
+    struct t_irc_batch *ptr_batch;
+
+    if (!server || !reference)
+        return NULL;
+
+    for (ptr_batch = server->batches; ptr_batch;
+         ptr_batch = ptr_batch->next_batch)
+    {
+        if (strcmp (ptr_batch->reference, reference) == 0)
+            return ptr_batch;
+    }
+
+    /* batch not found */
+    return NULL;
+}
+
+/*
+ * Starts a batch: creates a new batch and adds it to the list of batches
+ * in server.
+ *
+ * Returns pointer to new batch, NULL if error.
+ */
+
+struct t_irc_batch *
+irc_batch_start_batch (struct t_irc_server *server, const char *reference,
+                       const char *parent_ref, const char *type,
+                       const char *parameters)
+{
+    struct t_irc_batch *new_batch;
+
+    if (!server || !reference || !reference[0] || !type)
+        return NULL;
+
+    /* a batch with same reference is replaced */
+    irc_batch_free (server, irc_batch_search (server, reference));
+
+    new_batch = malloc (sizeof (*new_batch));
+    if (!new_batch)
+        return NULL;
+
+    new_batch->reference = strdup (reference);
+    new_batch->parent_ref = (parent_ref) ? strdup (parent_ref) : NULL;
+    new_batch->type = strdup (type);
+    new_batch->parameters = (parameters) ? strdup (parameters) : NULL;
+    new_batch->start_time = time (NULL);
+    new_batch->messages = NULL;
+    new_batch->messages_count = 0;
+    new_batch->messages_size = 0;
+
+    new_batch->prev_batch = server->last_batch;
+    new_batch->next_batch = NULL;
+    if (server->last_batch)
+        (server->last_batch)->next_batch = new_batch;
+    else
+        server->batches = new_batch;
+    server->last_batch = new_batch;
+
+    return new_batch;
+}
+
+/*
+ * Starts a nested batch with a message "BATCH +ref type params" received in a
+ * parent batch.
+ *
+ * Returns:
+ *   1: nested batch started
+ *   0: message is not the start of a batch
+ */
+
+int
+irc_batch_start_nested (struct t_irc_server *server,
+                        struct t_irc_batch *parent_batch,
+                        const char *message)
+{
+    const char *pos, *pos_ref, *pos_type, *pos_params;
+    char *reference, *type;
+
+    if (!message)
+        return 0;
+
+    /* skip prefix and command */
+    pos = message;
+    if (pos[0] == ':')
+    {
+        pos = strchr (pos, ' ');
+        if (!pos)
+            return 0;
+        while (pos[0] == ' ')
+        {
+            pos++;
+        }
+    }
+    pos = strchr (pos, ' ');
+    if (!pos)
+        return 0;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+    if (pos[0] != '+')
+        return 0;
+
+    /* get reference, type and parameters */
+    pos_ref = pos + 1;
+    pos_type = strchr (pos_ref, ' ');
+    if (!pos_type)
+        return 0;
+    reference = weechat_strndup (pos_ref, pos_type - pos_ref);
+    while (pos_type[0] == ' ')
+    {
+        pos_type++;
+    }
+    pos_params = strchr (pos_type, ' ');
+    type = (pos_params) ?
+        weechat_strndup (pos_type, pos_params - pos_type) : strdup (pos_type);
+    if (pos_params)
+    {
+        while (pos_params[0] == ' ')
+        {
+            pos_params++;
+        }
+        if (pos_params[0] == ':')
+            pos_params++;
+    }
+
+    /* a nested batch can not have the reference of its parent */
+    if (reference && (strcmp (reference, parent_batch->reference) != 0))
+    {
+        irc_batch_start_batch (server, reference, parent_batch->reference,
+                               type,
+                               (pos_params && pos_params[0]) ? pos_params : NULL);
+    }
+
+    if (reference)
+        free (reference);
+    if (type)
+        free (type);
+
+    return 1;
+}
+
+/*
+ * Adds a message in a batch, if the message has a tag "batch" with the
+ * reference of a batch started on server.
+ *
+ * Returns:
+ *   1: message added in batch (it will be processed at the end of batch)
+ *   0: message not in a batch (it must be processed now)
+ */
+
+int
+irc_batch_add_message (struct t_irc_server *server,
+                       struct t_hashtable *hash_tags,
+                       const char *tags, const char *command,
+                       const char *channel, const char *message)
+{
+    struct t_irc_batch *ptr_batch;
+    struct t_irc_batch_message *new_messages, *ptr_message;
+    int new_size;
+
+    if (!server || !hash_tags || !command)
+        return 0;
+
+    ptr_batch = irc_batch_search (
+        server, weechat_hashtable_get (hash_tags, "batch"));
+    if (!ptr_batch)
+        return 0;
+
+    /*
+     * start of a nested batch: it is started now (and not when the parent
+     * batch is processed), so that messages of nested batch are added in
+     * the nested batch
+     */
+    if ((weechat_strcasecmp (command, "batch") == 0)
+        && irc_batch_start_nested (server, ptr_batch, message))
+    {
+        return 1;
+    }
+
+    if (ptr_batch->messages_count >= ptr_batch->messages_size)
+    {
+        new_size = (ptr_batch->messages_size == 0) ?
+            64 : ptr_batch->messages_size * 2;
+        new_messages = realloc (ptr_batch->messages,
+                                new_size * sizeof (*new_messages));
+        if (!new_messages)
+            return 0;
+        ptr_batch->messages = new_messages;
+        ptr_batch->messages_size = new_size;
+    }
+
+    ptr_message = &(ptr_batch->messages[ptr_batch->messages_count]);
+    ptr_message->tags = (tags) ? strdup (tags) : NULL;
+    ptr_message->command = strdup (command);
+    ptr_message->channel = (channel) ? strdup (channel) : NULL;
+    ptr_message->message = (message) ? strdup (message) : NULL;
+    ptr_batch->messages_count++;
+
+    return 1;
+}
+
+/*
+ * Starts or ends a batch of lines on all buffers of a server (server and
+ * channels).
+ */
+
+void
+irc_batch_set_lines_batch (struct t_irc_server *server, int batch)
+{
+    struct t_irc_channel *ptr_channel;
+    const char *value;
+
+    value = (batch) ? "1" : "0";
+
+    if (server->buffer)
+        weechat_buffer_set (server->buffer, "lines_batch", value);
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if (ptr_channel->buffer)
+            weechat_buffer_set (ptr_channel->buffer, "lines_batch", value);
+    }
+}
+
+/*
+ * Removes a batch from list of batches in server.
+ */
+
+void
+irc_batch_remove_from_list (struct t_irc_server *server,
+                            struct t_irc_batch *batch)
+{
+    if (server->last_batch == batch)
+        server->last_batch = batch->prev_batch;
+    if (batch->prev_batch)
+        (batch->prev_batch)->next_batch = batch->next_batch;
+    else
+        server->batches = batch->next_batch;
+    if (batch->next_batch)
+        (batch->next_batch)->prev_batch = batch->prev_batch;
+    batch->prev_batch = NULL;
+    batch->next_batch = NULL;
+}
+
+/*
+ * Frees data in a batch and the batch itself (the batch must not be in list
+ * of batches any more).
+ */
+
+void
+irc_batch_free_data (struct t_irc_batch *batch)
+{
+    int i;
+
+    if (batch->reference)
+        free (batch->reference);
+    if (batch->parent_ref)
+        free (batch->parent_ref);
+    if (batch->type)
+        free (batch->type);
+    if (batch->parameters)
+        free (batch->parameters);
+    for (i = 0; i < batch->messages_count; i++)
+    {
+        if (batch->messages[i].tags)
+            free (batch->messages[i].tags);
+        if (batch->messages[i].command)
+            free (batch->messages[i].command);
+        if (batch->messages[i].channel)
+            free (batch->messages[i].channel);
+        if (batch->messages[i].message)
+            free (batch->messages[i].message);
+    }
+    if (batch->messages)
+        free (batch->messages);
+
+    free (batch);
+}
+
+/*
+ * Ends a batch: processes all messages received in the batch (lines are
+ * added in buffers with a batch of lines: hotlist and display are updated
+ * once at the end), then frees the batch.
+ */
+
+void
+irc_batch_end_batch (struct t_irc_server *server, const char *reference)
+{
+    struct t_irc_batch *ptr_batch;
+    struct t_irc_batch_message *ptr_message;
+    int i;
+
+    ptr_batch = irc_batch_search (server, reference);
+    if (!ptr_batch)
+        return;
+
+    /*
+     * remove batch from list, so that messages with this reference are
+     * processed now (and not added again in the batch)
+     */
+    irc_batch_remove_from_list (server, ptr_batch);
+
+    /* process messages (a nested batch is processed with its parent) */
+    if (irc_batch_processing == 0)
+        irc_batch_set_lines_batch (server, 1);
+    irc_batch_processing++;
+    for (i = 0; i < ptr_batch->messages_count; i++)
+    {
+        ptr_message = &(ptr_batch->messages[i]);
+        irc_protocol_recv_command (server,
+                                   ptr_message->message,
+                                   ptr_message->tags,
+                                   ptr_message->command,
+                                   ptr_message->channel);
+        /* stop if the connection was lost during processing */
+        if (server->sock < 0)
+            break;
+    }
+    irc_batch_processing--;
+    if (irc_batch_processing == 0)
+        irc_batch_set_lines_batch (server, 0);
+
+    irc_batch_free_data (ptr_batch);
+}
+
+/*
+ * Frees a batch and removes it from list of batches in server.
+ */
+
+void
+irc_batch_free (struct t_irc_server *server, struct t_irc_batch *batch)
+{
+    if (!server || !batch)
+        return;
+
+    irc_batch_remove_from_list (server, batch);
+    irc_batch_free_data (batch);
+}
+
+/*
+ * Frees all batches of a server.
+ */
+
+void
+irc_batch_free_all (struct t_irc_server *server)
+{
+    while (server->batches)
+    {
+        irc_batch_free (server, server->batches);
+    }
+}
+
+/*
+ * Returns hdata for batch.
+ */
+
+struct t_hdata *
+irc_batch_hdata_batch_cb (const void *pointer, void *data,
+                          const char *hdata_name)
+{
+    struct t_hdata *hdata;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    hdata = weechat_hdata_new (hdata_name, "prev_batch", "next_batch",
+                               0, 0, NULL, NULL);
+    if (hdata)
+    {
+        WEECHAT_HDATA_VAR(struct t_irc_batch, reference, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, parent_ref, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, type, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, parameters, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, start_time, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, messages_count, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, prev_batch, POINTER, 0, NULL, hdata_name);
+        WEECHAT_HDATA_VAR(struct t_irc_batch, next_batch, POINTER, 0, NULL, hdata_name);
+    }
+    return hdata;
+}
+
+/*
+ * Prints batches in WeeChat log file (usually for crash dump).
+ */
+
+void
+irc_batch_print_log (struct t_irc_server *server)
+{
+    struct t_irc_batch *ptr_batch;
+
+    for (ptr_batch = server->batches; ptr_batch;
+         ptr_batch = ptr_batch->next_batch)
+    {
+        weechat_log_printf ("");
+        weechat_log_printf ("  => batch (addr:0x%lx):", ptr_batch);
+        weechat_log_printf ("       reference . . . . . : '%s'",  ptr_batch->reference);
+        weechat_log_printf ("       parent_ref. . . . . : '%s'",  ptr_batch->parent_ref);
+        weechat_log_printf ("       type. . . . . . . . : '%s'",  ptr_batch->type);
+        weechat_log_printf ("       parameters. . . . . : '%s'",  ptr_batch->parameters);
+        weechat_log_printf ("       start_time. . . . . : %ld",   ptr_batch->start_time);
+        weechat_log_printf ("       messages. . . . . . : 0x%lx", ptr_batch->messages);
+        weechat_log_printf ("       messages_count. . . : %d",    ptr_batch->messages_count);
+        weechat_log_printf ("       messages_size . . . : %d",    ptr_batch->messages_size);
+        weechat_log_printf ("       prev_batch. . . . . : 0x%lx", ptr_batch->prev_batch);
+        weechat_log_printf ("       next_batch. . . . . : 0x%lx", ptr_batch->next_batch);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_IRC_BATCH_H
+#define WEECHAT_IRC_BATCH_H 1
+
+#include <time.h>
+
+struct t_irc_server;
+struct t_hashtable;
+
+/* message received in a batch (processed at the end of batch) */
+
+struct t_irc_batch_message
+{
+    char *tags;                     /* tags of message (without "@")         */
+    char *command;                  /* IRC command                           */
+    char *channel;                  /* channel (can be NULL)                 */
+    char *message;                  /* message (without tags)                */
+};
+
+/* batch of messages (IRCv3 capability "batch") */
+
+struct t_irc_batch
+{
+    char *reference;                /* reference of batch                    */
+    char *parent_ref;               /* reference of parent batch (or NULL)   */
+    char *type;                     /* type (for example: "netsplit")        */
+    char *parameters;               /* parameters of batch (can be NULL)     */
+    time_t start_time;              /* time when batch was started           */
+    struct t_irc_batch_message *messages; /* messages received in batch      */
+    int messages_count;             /* number of messages in batch           */
+    int messages_size;              /* allocated size for messages           */
+    struct t_irc_batch *prev_batch; /* link to previous batch                */
+    struct t_irc_batch *next_batch; /* link to next batch                    */
+};
+
+extern int irc_batch_processing;
+
+extern struct t_irc_batch *irc_batch_search (struct t_irc_server *server,
+                                             const char *reference);
+extern struct t_irc_batch *irc_batch_start_batch (struct t_irc_server *server,
+                                                  const char *reference,
+                                                  const char *parent_ref,
+                                                  const char *type,
+                                                  const char *parameters);
+extern int irc_batch_add_message (struct t_irc_server *server,
+                                  struct t_hashtable *hash_tags,
+                                  const char *tags,
+                                  const char *command,
+                                  const char *channel,
+                                  const char *message);
+extern void irc_batch_end_batch (struct t_irc_server *server,
+                                 const char *reference);
+extern void irc_batch_free (struct t_irc_server *server,
+                            struct t_irc_batch *batch);
+extern void irc_batch_free_all (struct t_irc_server *server);
+extern struct t_hdata *irc_batch_hdata_batch_cb (const void *pointer,
+                                                 void *data,
+                                                 const char *hdata_name);
+extern void irc_batch_print_log (struct t_irc_server *server);
+
+#endif /* WEECHAT_IRC_BATCH_H */
@@ -55,6 +55,30 @@ irc_buffer_get_server_and_channel (struct t_gui_buffer *buffer,
     if (!buffer)
         return;
 
+    /* fast path: find server and channel with local variables of buffer */
+    ptr_server = irc_server_search (
+        weechat_buffer_get_string (buffer, "localvar_server"));
+    if (ptr_server)
+    {
+        if (ptr_server->buffer == buffer)
+        {
+            if (server)
+                *server = ptr_server;
+            return;
+        }
+        ptr_channel = irc_channel_search (
+            ptr_server,
+            weechat_buffer_get_string (buffer, "localvar_channel"));
+        if (ptr_channel && (ptr_channel->buffer == buffer))
+        {
+            if (server)
+                *server = ptr_server;
+            if (channel)
+                *channel = ptr_channel;
+            return;
+        }
+    }
+
     /* look for a server or channel using this buffer */
     for (ptr_server = irc_servers; ptr_server;
          ptr_server = ptr_server->next_server)
@@ -76,47 +76,35 @@ irc_channel_move_near_server (struct t_irc_server *server, int channel_type,
     int number, number_channel, number_last_channel, number_last_private;
     int number_found;
     char str_number[32];
-    const char *ptr_type, *ptr_server_name;
-    struct t_hdata *hdata_buffer;
-    struct t_gui_buffer *ptr_buffer;
+    struct t_irc_channel *ptr_channel;
 
     number = weechat_buffer_get_integer (buffer, "number");
     number_last_channel = 0;
     number_last_private = 0;
     number_found = 0;
 
-    hdata_buffer = weechat_hdata_get ("buffer");
-    ptr_buffer = weechat_hdata_get_list (hdata_buffer, "gui_buffers");
-    while (ptr_buffer)
+    /*
+     * only channels/pv of server are checked (and not all buffers), so that
+     * the autojoin of many channels is not slowed down by the number of
+     * buffers
+     */
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
     {
-        if ((ptr_buffer != buffer)
-            && (weechat_buffer_get_pointer (ptr_buffer,
-                                            "plugin") == weechat_irc_plugin))
+        if (!ptr_channel->buffer || (ptr_channel->buffer == buffer))
+            continue;
+        number_channel = weechat_buffer_get_integer (ptr_channel->buffer,
+                                                     "number");
+        if (ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
         {
-            ptr_type = weechat_buffer_get_string (ptr_buffer,
-                                                  "localvar_type");
-            ptr_server_name = weechat_buffer_get_string (ptr_buffer,
-                                                         "localvar_server");
-            number_channel = weechat_buffer_get_integer (ptr_buffer,
-                                                         "number");
-            if (ptr_type && ptr_type[0]
-                && ptr_server_name && ptr_server_name[0]
-                && (strcmp (ptr_server_name, server->name) == 0))
-            {
-                if (strcmp (ptr_type, "channel") == 0)
-                {
-                    if (number_channel > number_last_channel)
-                        number_last_channel = number_channel;
-                }
-                else if (strcmp (ptr_type, "private") == 0)
-                {
-                    if (number_channel > number_last_private)
-                        number_last_private = number_channel;
-                }
-            }
+            if (number_channel > number_last_channel)
+                number_last_channel = number_channel;
+        }
+        else if (ptr_channel->type == IRC_CHANNEL_TYPE_PRIVATE)
+        {
+            if (number_channel > number_last_private)
+                number_last_private = number_channel;
         }
-        /* move to next buffer */
-        ptr_buffer = weechat_hdata_move (hdata_buffer, ptr_buffer, 1);
     }
 
     /* use last channel/pv number + 1 */
@@ -149,6 +137,47 @@ irc_channel_move_near_server (struct t_irc_server *server, int channel_type,
     }
 }
 
+/*
+ * Sets the name of channel with case folded (used to search channels),
+ * according to casemapping of server.
+ */
+
+void
+irc_channel_set_name_fold (struct t_irc_server *server,
+                           struct t_irc_channel *channel)
+{
+    if (channel->name_fold)
+    {
+        if (server->channels_hash
+            && (weechat_hashtable_get (server->channels_hash,
+                                       channel->name_fold) == channel))
+        {
+            weechat_hashtable_remove (server->channels_hash,
+                                      channel->name_fold);
+        }
+        free (channel->name_fold);
+    }
+
+    channel->name_fold = irc_server_string_fold (server, channel->name,
+                                                 NULL, 0);
+    if (!channel->name_fold)
+        return;
+
+    if (!server->channels_hash)
+    {
+        server->channels_hash = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+    }
+    if (server->channels_hash)
+    {
+        weechat_hashtable_set (server->channels_hash,
+                               channel->name_fold, channel);
+    }
+}
+
 /*
  * Searches for a channel by name.
  *
@@ -159,17 +188,40 @@ struct t_irc_channel *
 irc_channel_search (struct t_irc_server *server, const char *channel_name)
 {
     struct t_irc_channel *ptr_channel;
+    char buffer[128], *channel_name_fold;
 
     if (!server || !channel_name)
         return NULL;
 
+    channel_name_fold = irc_server_string_fold (server, channel_name,
+                                                buffer, sizeof (buffer));
+
+    if (channel_name_fold && server->channels_hash)
+    {
+        ptr_channel = weechat_hashtable_get (server->channels_hash,
+                                             channel_name_fold);
+        if (channel_name_fold != buffer)
+            free (channel_name_fold);
+        return ptr_channel;
+    }
+
     for (ptr_channel = server->channels; ptr_channel;
          ptr_channel = ptr_channel->next_channel)
     {
-        if (irc_server_strcasecmp (server, ptr_channel->name, channel_name) == 0)
-            return ptr_channel;
+        if (channel_name_fold && ptr_channel->name_fold)
+        {
+            if (strcmp (ptr_channel->name_fold, channel_name_fold) == 0)
+                break;
+        }
+        else if (irc_server_strcasecmp (server, ptr_channel->name,
+                                        channel_name) == 0)
+            break;
     }
-    return NULL;
+
+    if (channel_name_fold && (channel_name_fold != buffer))
+        free (channel_name_fold);
+
+    return ptr_channel;
 }
 
 /*
@@ -345,6 +397,7 @@ irc_channel_create_buffer (struct t_irc_server *server,
                                          ptr_buffer);
         if (weechat_config_boolean (irc_config_network_send_unknown_commands))
             weechat_buffer_set (ptr_buffer, "input_get_unknown_commands", "1");
+        weechat_buffer_set (ptr_buffer, "input_multiline", "1");
         if (channel_type == IRC_CHANNEL_TYPE_CHANNEL)
         {
             weechat_buffer_set (ptr_buffer, "nicklist", "1");
@@ -446,6 +499,8 @@ irc_channel_new (struct t_irc_server *server, int channel_type,
     /* initialize new channel */
     new_channel->type = channel_type;
     new_channel->name = strdup (channel_name);
+    new_channel->name_fold = NULL;
+    irc_channel_set_name_fold (server, new_channel);
     new_channel->topic = NULL;
     new_channel->modes = NULL;
     new_channel->limit = 0;
@@ -465,6 +520,9 @@ irc_channel_new (struct t_irc_server *server, int channel_type,
         WEECHAT_HASHTABLE_STRING,
         NULL, NULL);
     new_channel->checking_whox = 0;
+    new_channel->away_check_time = 0;
+    new_channel->nicklist_burst = 0;
+    new_channel->nicklist_burst_count = 0;
     new_channel->away_message = NULL;
     new_channel->has_quit_server = 0;
     new_channel->cycle = 0;
@@ -475,11 +533,17 @@ irc_channel_new (struct t_irc_server *server, int channel_type,
     new_channel->nicks_count = 0;
     new_channel->nicks = NULL;
     new_channel->last_nick = NULL;
+    new_channel->nicks_hash = NULL;
     new_channel->nicks_speaking[0] = NULL;
     new_channel->nicks_speaking[1] = NULL;
     new_channel->nicks_speaking_time = NULL;
     new_channel->last_nick_speaking_time = NULL;
+    new_channel->nicks_speaking_time_hash = NULL;
     new_channel->join_smart_filtered = NULL;
+    new_channel->join_smart_filtered_lines = NULL;
+    new_channel->stats_messages_recv = 0;
+    new_channel->stats_bytes_recv = 0;
+    new_channel->stats_time_recv_command = 0;
     new_channel->buffer = ptr_buffer;
     new_channel->buffer_as_string = NULL;
 
@@ -530,6 +594,85 @@ irc_channel_add_nicklist_groups (struct t_irc_server *server,
                                 "weechat.color.nicklist_group", 1);
 }
 
+/*
+ * Starts or ends a batch of changes in nicklist of a channel (for example
+ * while receiving names or "who" of channel): nicks are added without sort
+ * and the nicklist is sorted once at the end of batch.
+ */
+
+void
+irc_channel_nicklist_batch (struct t_irc_channel *channel, int batch)
+{
+    if (!channel || !channel->buffer)
+        return;
+
+    weechat_buffer_set (channel->buffer, "nicklist_batch",
+                        (batch) ? "1" : "0");
+}
+
+/*
+ * Adds a join, quit or nick mode change in the burst detection of a channel.
+ *
+ * A batch of changes in nicklist is started if "force" is 1 (for example on
+ * a netsplit or many nick modes in a single message) or if there are many
+ * joins/modes in messages received; the batch is ended when all messages
+ * received are processed (see function irc_channel_nicklist_burst_end_all).
+ */
+
+void
+irc_channel_nicklist_burst_add (struct t_irc_channel *channel, int force)
+{
+    if (!channel || !channel->buffer)
+        return;
+
+    channel->nicklist_burst_count++;
+
+    if (channel->nicklist_burst)
+        return;
+
+    if (!force
+        && (channel->nicklist_burst_count < IRC_CHANNEL_NICKLIST_BURST_JOINS))
+    {
+        return;
+    }
+
+    /* batch already in progress (for example names of channel)? */
+    if (weechat_buffer_get_integer (channel->buffer, "nicklist_batch"))
+        return;
+
+    irc_channel_nicklist_batch (channel, 1);
+    channel->nicklist_burst = 1;
+}
+
+/*
+ * Ends the bursts detected in all channels of all servers: ends batches of
+ * changes in nicklist started by function irc_channel_nicklist_burst_add.
+ *
+ * This function is called when all messages received are processed.
+ */
+
+void
+irc_channel_nicklist_burst_end_all ()
+{
+    struct t_irc_server *ptr_server;
+    struct t_irc_channel *ptr_channel;
+
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        for (ptr_channel = ptr_server->channels; ptr_channel;
+             ptr_channel = ptr_channel->next_channel)
+        {
+            if (ptr_channel->nicklist_burst)
+            {
+                irc_channel_nicklist_batch (ptr_channel, 0);
+                ptr_channel->nicklist_burst = 0;
+            }
+            ptr_channel->nicklist_burst_count = 0;
+        }
+    }
+}
+
 /*
  * Sets the buffer title with the channel topic.
  */
@@ -652,9 +795,7 @@ irc_channel_remove_account (struct t_irc_server *server,
         for (ptr_nick = channel->nicks; ptr_nick;
              ptr_nick = ptr_nick->next_nick)
         {
-            if (ptr_nick->account)
-                free (ptr_nick->account);
-            ptr_nick->account = NULL;
+            irc_nick_set_string (&ptr_nick->account, NULL);
         }
     }
 }
@@ -696,6 +837,7 @@ irc_channel_check_whox (struct t_irc_server *server,
                     || (channel->nicks_count <= IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS)))))
         {
             channel->checking_whox++;
+            channel->away_check_time = time (NULL);
             if (irc_server_get_isupport_value (server, "WHOX"))
             {
                 /* WHOX is supported */
@@ -863,24 +1005,44 @@ irc_channel_nick_speaking_time_search (struct t_irc_server *server,
                                        int check_time)
 {
     struct t_irc_channel_speaking *ptr_nick;
+    char buffer[128], *nick_fold;
     time_t time_limit;
 
-    time_limit = time (NULL) -
-        (weechat_config_integer (irc_config_look_smart_filter_delay) * 60);
+    if (!channel->nicks_speaking_time || !nick_name)
+        return NULL;
 
-    for (ptr_nick = channel->nicks_speaking_time; ptr_nick;
-         ptr_nick = ptr_nick->next_nick)
+    nick_fold = irc_server_string_fold (server, nick_name,
+                                        buffer, sizeof (buffer));
+    if (!nick_fold)
+        return NULL;
+
+    if (channel->nicks_speaking_time_hash)
+    {
+        ptr_nick = weechat_hashtable_get (channel->nicks_speaking_time_hash,
+                                          nick_fold);
+    }
+    else
     {
-        if (irc_server_strcasecmp (server, ptr_nick->nick, nick_name) == 0)
+        for (ptr_nick = channel->nicks_speaking_time; ptr_nick;
+             ptr_nick = ptr_nick->next_nick)
         {
-            if (check_time && (ptr_nick->time_last_message < time_limit))
-                return NULL;
-            return ptr_nick;
+            if (strcmp (ptr_nick->nick_fold, nick_fold) == 0)
+                break;
         }
     }
 
-    /* nick speaking time not found */
-    return NULL;
+    if (nick_fold != buffer)
+        free (nick_fold);
+
+    if (ptr_nick && check_time)
+    {
+        time_limit = time (NULL) -
+            (weechat_config_integer (irc_config_look_smart_filter_delay) * 60);
+        if (ptr_nick->time_last_message < time_limit)
+            return NULL;
+    }
+
+    return ptr_nick;
 }
 
 /*
@@ -891,9 +1053,21 @@ void
 irc_channel_nick_speaking_time_free (struct t_irc_channel *channel,
                                      struct t_irc_channel_speaking *nick_speaking)
 {
+    /* remove nick from hashtable */
+    if (channel->nicks_speaking_time_hash
+        && nick_speaking->nick_fold
+        && (weechat_hashtable_get (channel->nicks_speaking_time_hash,
+                                   nick_speaking->nick_fold) == nick_speaking))
+    {
+        weechat_hashtable_remove (channel->nicks_speaking_time_hash,
+                                  nick_speaking->nick_fold);
+    }
+
     /* free data */
     if (nick_speaking->nick)
         free (nick_speaking->nick);
+    if (nick_speaking->nick_fold)
+        free (nick_speaking->nick_fold);
 
     /* remove nick from list */
     if (nick_speaking->prev_nick)
@@ -922,6 +1096,61 @@ irc_channel_nick_speaking_time_free_all (struct t_irc_channel *channel)
     }
 }
 
+/*
+ * Sets the nick with case folded in a nick speaking time and adds it in
+ * hashtable of channel (creates the hashtable if needed).
+ */
+
+void
+irc_channel_nick_speaking_time_set_fold (struct t_irc_server *server,
+                                         struct t_irc_channel *channel,
+                                         struct t_irc_channel_speaking *nick_speaking)
+{
+    if (nick_speaking->nick_fold)
+        free (nick_speaking->nick_fold);
+    nick_speaking->nick_fold = irc_server_string_fold (server,
+                                                       nick_speaking->nick,
+                                                       NULL, 0);
+    if (!nick_speaking->nick_fold)
+        return;
+
+    if (!channel->nicks_speaking_time_hash)
+    {
+        channel->nicks_speaking_time_hash = weechat_hashtable_new (
+            64,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+    }
+    if (channel->nicks_speaking_time_hash)
+    {
+        weechat_hashtable_set (channel->nicks_speaking_time_hash,
+                               nick_speaking->nick_fold, nick_speaking);
+    }
+}
+
+/*
+ * Rebuilds the hashtable of nicks speaking time on a channel (used when the
+ * casemapping of server has changed).
+ */
+
+void
+irc_channel_nick_speaking_time_rehash (struct t_irc_server *server,
+                                       struct t_irc_channel *channel)
+{
+    struct t_irc_channel_speaking *ptr_nick;
+
+    if (channel->nicks_speaking_time_hash)
+        weechat_hashtable_remove_all (channel->nicks_speaking_time_hash);
+
+    /* from oldest to newest, so that the newest is kept for a nick */
+    for (ptr_nick = channel->last_nick_speaking_time; ptr_nick;
+         ptr_nick = ptr_nick->prev_nick)
+    {
+        irc_channel_nick_speaking_time_set_fold (server, channel, ptr_nick);
+    }
+}
+
 /*
  * Removes old nicks speaking.
  */
@@ -965,6 +1194,7 @@ irc_channel_nick_speaking_time_add (struct t_irc_server *server,
     if (new_nick)
     {
         new_nick->nick = strdup (nick_name);
+        new_nick->nick_fold = NULL;
         new_nick->time_last_message = time_last_message;
 
         /* insert nick at beginning of list */
@@ -975,6 +1205,8 @@ irc_channel_nick_speaking_time_add (struct t_irc_server *server,
         else
             channel->last_nick_speaking_time = new_nick;
         channel->nicks_speaking_time = new_nick;
+
+        irc_channel_nick_speaking_time_set_fold (server, channel, new_nick);
     }
 }
 
@@ -996,15 +1228,244 @@ irc_channel_nick_speaking_time_rename (struct t_irc_server *server,
                                                           old_nick, 0);
         if (ptr_nick)
         {
+            if (ptr_nick->nick_fold
+                && channel->nicks_speaking_time_hash)
+            {
+                weechat_hashtable_remove (channel->nicks_speaking_time_hash,
+                                          ptr_nick->nick_fold);
+            }
             free (ptr_nick->nick);
             ptr_nick->nick = strdup (new_nick);
+            irc_channel_nick_speaking_time_set_fold (server, channel,
+                                                     ptr_nick);
+        }
+    }
+}
+
+/*
+ * Gets the last line displayed in buffer of channel, if it is smart filtered
+ * and has the given tag.
+ *
+ * Returns:
+ *   1: line found (*line is set)
+ *   0: last line is not smart filtered or does not have the tag
+ */
+
+int
+irc_channel_get_last_line (struct t_irc_channel *channel, const char *tag,
+                           struct t_irc_channel_line *line)
+{
+    struct t_hdata *hdata_lines;
+    void *own_lines, *ptr_line, *ptr_line_data;
+    const char **tags;
+    int i, tag_found, smart_filtered;
+
+    if (!channel->buffer)
+        return 0;
+
+    hdata_lines = weechat_hdata_get ("lines");
+    own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
+                                       channel->buffer, "own_lines");
+    if (!own_lines
+        || (weechat_hdata_get_var_type (hdata_lines, "lines_removed") < 0))
+    {
+        return 0;
+    }
+    ptr_line = weechat_hdata_pointer (hdata_lines, own_lines, "last_line");
+    if (!ptr_line)
+        return 0;
+    ptr_line_data = weechat_hdata_pointer (weechat_hdata_get ("line"),
+                                           ptr_line, "data");
+    if (!ptr_line_data)
+        return 0;
+    tags = weechat_hdata_pointer (weechat_hdata_get ("line_data"),
+                                  ptr_line_data, "tags_array");
+    if (!tags)
+        return 0;
+
+    tag_found = 0;
+    smart_filtered = 0;
+    for (i = 0; tags[i]; i++)
+    {
+        if (strcmp (tags[i], tag) == 0)
+            tag_found = 1;
+        else if (strcmp (tags[i], "irc_smart_filter") == 0)
+            smart_filtered = 1;
+    }
+    if (!tag_found || !smart_filtered)
+        return 0;
+
+    line->line = ptr_line;
+    line->lines_before = weechat_hdata_integer (hdata_lines, own_lines,
+                                                "lines_count") - 1;
+    line->lines_removed = weechat_hdata_long (hdata_lines, own_lines,
+                                              "lines_removed");
+
+    return 1;
+}
+
+/*
+ * Checks if a line got with irc_channel_get_last_line is still in buffer of
+ * channel.
+ *
+ * Lines of a channel are removed from the first line (or all lines are
+ * removed), so the line is still in buffer if less lines than lines before it
+ * have been removed since it was displayed.
+ *
+ * Returns:
+ *   1: line is still in buffer
+ *   0: line has been removed
+ */
+
+int
+irc_channel_line_valid (struct t_irc_channel *channel,
+                        struct t_irc_channel_line *line)
+{
+    struct t_hdata *hdata_lines;
+    void *own_lines;
+    long lines_removed;
+
+    if (!channel->buffer)
+        return 0;
+
+    hdata_lines = weechat_hdata_get ("lines");
+    own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
+                                       channel->buffer, "own_lines");
+    if (!own_lines)
+        return 0;
+
+    lines_removed = weechat_hdata_long (hdata_lines, own_lines,
+                                        "lines_removed");
+
+    return (lines_removed - line->lines_removed <= line->lines_before) ? 1 : 0;
+}
+
+/*
+ * Removes tag "irc_smart_filter" in a line (the line is then checked again
+ * with filters).
+ */
+
+void
+irc_channel_line_remove_smart_filter (struct t_hdata *hdata_line_data,
+                                      void *line_data)
+{
+    const char **tags;
+    char *new_tags;
+    int i, length_tags;
+    struct t_hashtable *hashtable;
+
+    tags = weechat_hdata_pointer (hdata_line_data, line_data, "tags_array");
+    if (!tags)
+        return;
+
+    length_tags = 0;
+    for (i = 0; tags[i]; i++)
+    {
+        length_tags += strlen (tags[i]) + 1;
+    }
+
+    new_tags = malloc (length_tags + 1);
+    if (!new_tags)
+        return;
+
+    /* build a string with all tags, except "irc_smart_filter" */
+    new_tags[0] = '\0';
+    for (i = 0; tags[i]; i++)
+    {
+        if (strcmp (tags[i], "irc_smart_filter") != 0)
+        {
+            if (new_tags[0])
+                strcat (new_tags, ",");
+            strcat (new_tags, tags[i]);
         }
     }
+    hashtable = weechat_hashtable_new (4,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       NULL, NULL);
+    if (hashtable)
+    {
+        /* update tags in line (remove tag "irc_smart_filter") */
+        weechat_hashtable_set (hashtable, "tags_array", new_tags);
+        weechat_hdata_update (hdata_line_data, line_data, hashtable);
+        weechat_hashtable_free (hashtable);
+    }
+    free (new_tags);
+}
+
+/*
+ * Callback used to free lines of a smart filtered join.
+ */
+
+void
+irc_channel_join_lines_free_cb (struct t_hashtable *hashtable,
+                                const void *key, void *value)
+{
+    struct t_irc_channel_join_lines *join_lines;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    join_lines = (struct t_irc_channel_join_lines *)value;
+    if (join_lines->lines)
+        free (join_lines->lines);
+    free (join_lines);
+}
+
+/*
+ * Creates lines of a smart filtered join with the lines of another join (can
+ * be NULL) and a new line (can be NULL).
+ *
+ * Returns pointer to lines, NULL if error.
+ */
+
+struct t_irc_channel_join_lines *
+irc_channel_join_lines_new (struct t_irc_channel_join_lines *join_lines,
+                            struct t_irc_channel_line *line)
+{
+    struct t_irc_channel_join_lines *new_join_lines;
+    int count;
+
+    new_join_lines = malloc (sizeof (*new_join_lines));
+    if (!new_join_lines)
+        return NULL;
+
+    count = ((join_lines) ? join_lines->count : 0) + ((line) ? 1 : 0);
+    new_join_lines->count = 0;
+    new_join_lines->lines = NULL;
+    if (count > 0)
+    {
+        new_join_lines->lines = malloc (
+            count * sizeof (*new_join_lines->lines));
+        if (!new_join_lines->lines)
+        {
+            free (new_join_lines);
+            return NULL;
+        }
+        if (join_lines && (join_lines->count > 0))
+        {
+            memcpy (new_join_lines->lines, join_lines->lines,
+                    join_lines->count * sizeof (*join_lines->lines));
+            new_join_lines->count = join_lines->count;
+        }
+        if (line)
+        {
+            new_join_lines->lines[new_join_lines->count] = *line;
+            new_join_lines->count++;
+        }
+    }
+
+    return new_join_lines;
 }
 
 /*
  * Adds a nick in hashtable "join_smart_filtered" (creates the hashtable if
  * needed).
+ *
+ * The join must have just been displayed: the last line of buffer is saved
+ * in hashtable "join_smart_filtered_lines", to unmask it without searching
+ * it in buffer.
  */
 
 void
@@ -1012,11 +1473,15 @@ irc_channel_join_smart_filtered_add (struct t_irc_channel *channel,
                                      const char *nick,
                                      time_t join_time)
 {
+    struct t_irc_channel_line line;
+    struct t_irc_channel_join_lines *join_lines;
+    char str_tag[512];
+
     /* return if unmasking of smart filtered joins is disabled */
     if (weechat_config_integer (irc_config_look_smart_filter_join_unmask) == 0)
         return;
 
-    /* create hashtable if needed */
+    /* create hashtables if needed */
     if (!channel->join_smart_filtered)
     {
         channel->join_smart_filtered = weechat_hashtable_new (
@@ -1027,12 +1492,44 @@ irc_channel_join_smart_filtered_add (struct t_irc_channel *channel,
     }
     if (!channel->join_smart_filtered)
         return;
+    if (!channel->join_smart_filtered_lines)
+    {
+        channel->join_smart_filtered_lines = weechat_hashtable_new (
+            64,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (channel->join_smart_filtered_lines)
+        {
+            weechat_hashtable_set_pointer (channel->join_smart_filtered_lines,
+                                           "callback_free_value",
+                                           &irc_channel_join_lines_free_cb);
+        }
+    }
 
     weechat_hashtable_set (channel->join_smart_filtered, nick, &join_time);
+
+    if (!channel->join_smart_filtered_lines)
+        return;
+    snprintf (str_tag, sizeof (str_tag), "nick_%s", nick);
+    join_lines = (irc_channel_get_last_line (channel, str_tag, &line)) ?
+        irc_channel_join_lines_new (NULL, &line) : NULL;
+    if (join_lines)
+    {
+        weechat_hashtable_set (channel->join_smart_filtered_lines,
+                               nick, join_lines);
+    }
+    else
+    {
+        weechat_hashtable_remove (channel->join_smart_filtered_lines, nick);
+    }
 }
 
 /*
  * Renames a nick in hashtable "join_smart_filtered".
+ *
+ * The nick change must have just been displayed: if it is smart filtered,
+ * the last line of buffer is added to lines of the join.
  */
 
 void
@@ -1041,6 +1538,9 @@ irc_channel_join_smart_filtered_rename (struct t_irc_channel *channel,
                                         const char *new_nick)
 {
     time_t *ptr_time, join_time;
+    struct t_irc_channel_join_lines *ptr_join_lines, *new_join_lines;
+    struct t_irc_channel_line line;
+    char str_tag[512];
 
     /* return if hashtable does not exist in channel */
     if (!channel->join_smart_filtered)
@@ -1055,6 +1555,24 @@ irc_channel_join_smart_filtered_rename (struct t_irc_channel *channel,
     join_time = *ptr_time;
     weechat_hashtable_remove (channel->join_smart_filtered, old_nick);
     weechat_hashtable_set (channel->join_smart_filtered, new_nick, &join_time);
+
+    /* same for lines of join, with the nick change added */
+    if (!channel->join_smart_filtered_lines)
+        return;
+    ptr_join_lines = weechat_hashtable_get (channel->join_smart_filtered_lines,
+                                            old_nick);
+    if (!ptr_join_lines)
+        return;
+    snprintf (str_tag, sizeof (str_tag), "irc_nick2_%s", new_nick);
+    new_join_lines = irc_channel_join_lines_new (
+        ptr_join_lines,
+        (irc_channel_get_last_line (channel, str_tag, &line)) ? &line : NULL);
+    weechat_hashtable_remove (channel->join_smart_filtered_lines, old_nick);
+    if (new_join_lines)
+    {
+        weechat_hashtable_set (channel->join_smart_filtered_lines,
+                               new_nick, new_join_lines);
+    }
 }
 
 /*
@@ -1070,27 +1588,34 @@ irc_channel_join_smart_filtered_remove (struct t_irc_channel *channel,
         return;
 
     weechat_hashtable_remove (channel->join_smart_filtered, nick);
+    if (channel->join_smart_filtered_lines)
+        weechat_hashtable_remove (channel->join_smart_filtered_lines, nick);
 }
 
 /*
  * Unmasks a smart filtered join if nick is in hashtable "join_smart_filtered",
  * then removes nick from hashtable.
+ *
+ * The lines of join (and nick changes) saved in hashtable
+ * "join_smart_filtered_lines" are unmasked directly; if lines are not known
+ * (for example after /upgrade), the join is searched in buffer, from the last
+ * line.
  */
 
 void
 irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
                                         const char *nick)
 {
-    int i, unmask_delay, length_tags, nick_found, join, nick_changed;
+    int i, unmask_delay, nick_found, join, nick_changed;
     int smart_filtered, remove_smart_filter;
     time_t *ptr_time, date_min;
     struct t_hdata *hdata_line, *hdata_line_data;
     struct t_gui_line *own_lines;
     struct t_gui_line *line;
     struct t_gui_line_data *line_data;
+    struct t_irc_channel_join_lines *ptr_join_lines;
     const char **tags, *irc_nick1, *irc_nick2;
-    char *new_tags, *nick_to_search;
-    struct t_hashtable *hashtable;
+    char *nick_to_search;
 
     /* return if hashtable does not exist in channel */
     if (!channel->join_smart_filtered)
@@ -1119,11 +1644,34 @@ irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
      */
     if (*ptr_time < date_min)
     {
-        weechat_hashtable_remove (channel->join_smart_filtered, nick);
+        irc_channel_join_smart_filtered_remove (channel, nick);
         return;
     }
 
-    /* get hdata and pointers on last line in buffer */
+    hdata_line = weechat_hdata_get ("line");
+    hdata_line_data = weechat_hdata_get ("line_data");
+
+    /* fast path: unmask the lines saved (if they are still in buffer) */
+    ptr_join_lines = (channel->join_smart_filtered_lines) ?
+        weechat_hashtable_get (channel->join_smart_filtered_lines, nick) : NULL;
+    if (ptr_join_lines)
+    {
+        for (i = 0; i < ptr_join_lines->count; i++)
+        {
+            if (!irc_channel_line_valid (channel, &ptr_join_lines->lines[i]))
+                continue;
+            line_data = weechat_hdata_pointer (hdata_line,
+                                               ptr_join_lines->lines[i].line,
+                                               "data");
+            if (line_data)
+                irc_channel_line_remove_smart_filter (hdata_line_data,
+                                                      line_data);
+        }
+        irc_channel_join_smart_filtered_remove (channel, nick);
+        return;
+    }
+
+    /* get pointer on last line in buffer */
     own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
                                        channel->buffer, "own_lines");
     if (!own_lines)
@@ -1132,8 +1680,6 @@ irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
                                   own_lines, "last_line");
     if (!line)
         return;
-    hdata_line = weechat_hdata_get ("line");
-    hdata_line_data = weechat_hdata_get ("line_data");
 
     /* the nick to search in messages (track nick changes) */
     nick_to_search = strdup (nick);
@@ -1155,7 +1701,6 @@ irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
         tags = weechat_hdata_pointer (hdata_line_data, line_data, "tags_array");
         if (tags)
         {
-            length_tags = 0;
             nick_found = 0;
             join = 0;
             nick_changed = 0;
@@ -1179,7 +1724,6 @@ irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
                     irc_nick2 = tags[i] + 10;
                 else if (strcmp (tags[i], "irc_smart_filter") == 0)
                     smart_filtered = 1;
-                length_tags += strlen (tags[i]) + 1;
             }
 
             /* check if we must remove tag "irc_smart_filter" in line */
@@ -1205,35 +1749,8 @@ irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
                  * unmask a "nick" or "join" message: remove the tag
                  * "irc_smart_filter"
                  */
-                new_tags = malloc (length_tags);
-                if (new_tags)
-                {
-                    /* build a string with all tags, except "irc_smart_filter" */
-                    new_tags[0] = '\0';
-                    for (i = 0; tags[i]; i++)
-                    {
-                        if (strcmp (tags[i], "irc_smart_filter") != 0)
-                        {
-                            if (new_tags[0])
-                                strcat (new_tags, ",");
-                            strcat (new_tags, tags[i]);
-                        }
-                    }
-                    hashtable = weechat_hashtable_new (4,
-                                                       WEECHAT_HASHTABLE_STRING,
-                                                       WEECHAT_HASHTABLE_STRING,
-                                                       NULL, NULL);
-                    if (hashtable)
-                    {
-                        /* update tags in line (remove tag "irc_smart_filter") */
-                        weechat_hashtable_set (hashtable,
-                                               "tags_array", new_tags);
-                        weechat_hdata_update (hdata_line_data, line_data,
-                                              hashtable);
-                        weechat_hashtable_free (hashtable);
-                    }
-                    free (new_tags);
-                }
+                irc_channel_line_remove_smart_filter (hdata_line_data,
+                                                      line_data);
 
                 /*
                  * exit loop if the message was the join (if it's a nick change,
@@ -1251,7 +1768,7 @@ irc_channel_join_smart_filtered_unmask (struct t_irc_channel *channel,
     if (nick_to_search)
         free (nick_to_search);
 
-    weechat_hashtable_remove (channel->join_smart_filtered, nick);
+    irc_channel_join_smart_filtered_remove (channel, nick);
 }
 
 
@@ -1382,12 +1899,25 @@ irc_channel_free (struct t_irc_server *server, struct t_irc_channel *channel)
     if (channel->next_channel)
         (channel->next_channel)->prev_channel = channel->prev_channel;
 
+    /* remove channel from hashtable */
+    if (server->channels_hash
+        && channel->name_fold
+        && (weechat_hashtable_get (server->channels_hash,
+                                   channel->name_fold) == channel))
+    {
+        weechat_hashtable_remove (server->channels_hash, channel->name_fold);
+    }
+
     /* free linked lists */
     irc_nick_free_all (server, channel);
+    if (channel->nicks_hash)
+        weechat_hashtable_free (channel->nicks_hash);
 
     /* free channel data */
     if (channel->name)
         free (channel->name);
+    if (channel->name_fold)
+        free (channel->name_fold);
     if (channel->topic)
         free (channel->topic);
     if (channel->modes)
@@ -1407,8 +1937,12 @@ irc_channel_free (struct t_irc_server *server, struct t_irc_channel *channel)
     if (channel->nicks_speaking[1])
         weechat_list_free (channel->nicks_speaking[1]);
     irc_channel_nick_speaking_time_free_all (channel);
+    if (channel->nicks_speaking_time_hash)
+        weechat_hashtable_free (channel->nicks_speaking_time_hash);
     if (channel->join_smart_filtered)
         weechat_hashtable_free (channel->join_smart_filtered);
+    if (channel->join_smart_filtered_lines)
+        weechat_hashtable_free (channel->join_smart_filtered_lines);
     if (channel->buffer_as_string)
         free (channel->buffer_as_string);
 
@@ -1456,6 +1990,9 @@ irc_channel_hdata_channel_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_channel, key, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, join_msg_received, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, checking_whox, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, away_check_time, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicklist_burst, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicklist_burst_count, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, away_message, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, has_quit_server, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, cycle, INTEGER, 0, NULL, NULL);
@@ -1466,10 +2003,16 @@ irc_channel_hdata_channel_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_count, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks, POINTER, 0, NULL, "irc_nick");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick, POINTER, 0, NULL, "irc_nick");
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_hash, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_time_hash, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, join_smart_filtered, HASHTABLE, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, join_smart_filtered_lines, HASHTABLE, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, stats_messages_recv, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, stats_bytes_recv, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel, stats_time_recv_command, LONG, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, buffer, POINTER, 0, NULL, "buffer");
         WEECHAT_HDATA_VAR(struct t_irc_channel, buffer_as_string, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, prev_channel, POINTER, 0, NULL, hdata_name);
@@ -1497,6 +2040,7 @@ irc_channel_hdata_channel_speaking_cb (const void *pointer, void *data,
     if (hdata)
     {
         WEECHAT_HDATA_VAR(struct t_irc_channel_speaking, nick, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_channel_speaking, nick_fold, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel_speaking, time_last_message, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel_speaking, prev_nick, POINTER, 0, NULL, hdata_name);
         WEECHAT_HDATA_VAR(struct t_irc_channel_speaking, next_nick, POINTER, 0, NULL, hdata_name);
@@ -1556,6 +2100,8 @@ irc_channel_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "checking_whox", channel->checking_whox))
         return 0;
+    if (!weechat_infolist_new_var_time (ptr_item, "away_check_time", channel->away_check_time))
+        return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "away_message", channel->away_message))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "has_quit_server", channel->has_quit_server))
@@ -1629,6 +2175,7 @@ irc_channel_print_log (struct t_irc_channel *channel)
 
     weechat_log_printf ("");
     weechat_log_printf ("  => channel %s (addr:0x%lx):", channel->name, channel);
+    weechat_log_printf ("       name_fold. . . . . . . . : '%s'",  channel->name_fold);
     weechat_log_printf ("       type . . . . . . . . . . : %d",    channel->type);
     weechat_log_printf ("       topic. . . . . . . . . . : '%s'",  channel->topic);
     weechat_log_printf ("       modes. . . . . . . . . . : '%s'",  channel->modes);
@@ -1639,6 +2186,9 @@ irc_channel_print_log (struct t_irc_channel *channel)
                         weechat_hashtable_get_string (channel->join_msg_received,
                                                       "keys_values"));
     weechat_log_printf ("       checking_whox. . . . . . : %d",    channel->checking_whox);
+    weechat_log_printf ("       away_check_time. . . . . : %ld",   channel->away_check_time);
+    weechat_log_printf ("       nicklist_burst . . . . . : %d",    channel->nicklist_burst);
+    weechat_log_printf ("       nicklist_burst_count . . : %d",    channel->nicklist_burst_count);
     weechat_log_printf ("       away_message . . . . . . : '%s'",  channel->away_message);
     weechat_log_printf ("       has_quit_server. . . . . : %d",    channel->has_quit_server);
     weechat_log_printf ("       cycle. . . . . . . . . . : %d",    channel->cycle);
@@ -1649,14 +2199,23 @@ irc_channel_print_log (struct t_irc_channel *channel)
     weechat_log_printf ("       nicks_count. . . . . . . : %d",    channel->nicks_count);
     weechat_log_printf ("       nicks. . . . . . . . . . : 0x%lx", channel->nicks);
     weechat_log_printf ("       last_nick. . . . . . . . : 0x%lx", channel->last_nick);
+    weechat_log_printf ("       nicks_hash . . . . . . . : 0x%lx", channel->nicks_hash);
     weechat_log_printf ("       nicks_speaking[0]. . . . : 0x%lx", channel->nicks_speaking[0]);
     weechat_log_printf ("       nicks_speaking[1]. . . . : 0x%lx", channel->nicks_speaking[1]);
     weechat_log_printf ("       nicks_speaking_time. . . : 0x%lx", channel->nicks_speaking_time);
     weechat_log_printf ("       last_nick_speaking_time. : 0x%lx", channel->last_nick_speaking_time);
+    weechat_log_printf ("       nicks_speaking_time_hash : 0x%lx", channel->nicks_speaking_time_hash);
     weechat_log_printf ("       join_smart_filtered. . . : 0x%lx (hashtable: '%s')",
                         channel->join_smart_filtered,
                         weechat_hashtable_get_string (channel->join_smart_filtered,
                                                       "keys_values"));
+    weechat_log_printf ("       join_smart_filtered_lines: 0x%lx (hashtable: '%s')",
+                        channel->join_smart_filtered_lines,
+                        weechat_hashtable_get_string (channel->join_smart_filtered_lines,
+                                                      "keys"));
+    weechat_log_printf ("       stats_messages_recv. . . : %ld",   channel->stats_messages_recv);
+    weechat_log_printf ("       stats_bytes_recv . . . . : %ld",   channel->stats_bytes_recv);
+    weechat_log_printf ("       stats_time_recv_command. : %ld",   channel->stats_time_recv_command);
     weechat_log_printf ("       buffer . . . . . . . . . : 0x%lx", channel->buffer);
     weechat_log_printf ("       buffer_as_string . . . . : '%s'",  channel->buffer_as_string);
     weechat_log_printf ("       prev_channel . . . . . . : 0x%lx", channel->prev_channel);
@@ -31,20 +31,43 @@
 
 #define IRC_CHANNEL_NICKS_SPEAKING_LIMIT 128
 
+/* number of joins in data received to start a batch of changes in nicklist */
+#define IRC_CHANNEL_NICKLIST_BURST_JOINS 8
+
 struct t_irc_server;
 
 struct t_irc_channel_speaking
 {
     char *nick;                        /* nick speaking                     */
+    char *nick_fold;                   /* nick with case folded (casemap.)  */
     time_t time_last_message;          /* time                              */
     struct t_irc_channel_speaking *prev_nick; /* pointer to previous nick   */
     struct t_irc_channel_speaking *next_nick; /* pointer to next nick       */
 };
 
+/* line displayed in buffer of channel (to update it later without search) */
+
+struct t_irc_channel_line
+{
+    struct t_gui_line *line;           /* line in own lines of buffer       */
+    int lines_before;                  /* lines before it when displayed    */
+    long lines_removed;                /* lines removed from buffer when    */
+                                       /* line was displayed                */
+};
+
+/* lines of a smart filtered join: the join, then the nick changes */
+
+struct t_irc_channel_join_lines
+{
+    int count;                         /* number of lines                   */
+    struct t_irc_channel_line *lines;  /* lines (the join is the first one) */
+};
+
 struct t_irc_channel
 {
     int type;                          /* channel type                      */
     char *name;                        /* name of channel (example: "#abc") */
+    char *name_fold;                   /* name with case folded (casemap.)  */
     char *topic;                       /* topic of channel (host for pv)    */
     char *modes;                       /* channel modes                     */
     int limit;                         /* user limit (0 is limit not set)   */
@@ -53,6 +76,11 @@ struct t_irc_channel
                                        /* 353=names, 366=names count,       */
                                        /* 332/333=topic, 329=creation date  */
     int checking_whox;                 /* = 1 if checking WHOX              */
+    time_t away_check_time;            /* last WHO sent for away check      */
+    int nicklist_burst;                /* 1 if nicklist batch started for a */
+                                       /* burst (netsplit/netjoin/modes)    */
+    int nicklist_burst_count;          /* # joins/quits/modes in messages   */
+                                       /* being processed (burst detection) */
     char *away_message;                /* to display away only once in pv   */
     int has_quit_server;               /* =1 if nick has quit (pv only), to */
                                        /* display message when he's back    */
@@ -65,13 +93,22 @@ struct t_irc_channel
     int nicks_count;                   /* # nicks on channel (0 if pv)      */
     struct t_irc_nick *nicks;          /* nicks on the channel              */
     struct t_irc_nick *last_nick;      /* last nick on the channel          */
+    struct t_hashtable *nicks_hash;    /* nicks by name with case folded    */
+                                       /* (to search nicks quickly)         */
     struct t_weelist *nicks_speaking[2]; /* for smart completion: first     */
                                        /* list is nick speaking, second is  */
                                        /* speaking to me (highlight)        */
     struct t_irc_channel_speaking *nicks_speaking_time; /* for smart filter */
                                        /* of join/part/quit messages        */
     struct t_irc_channel_speaking *last_nick_speaking_time;
+    struct t_hashtable *nicks_speaking_time_hash; /* nicks speaking time by */
+                                       /* name with case folded             */
     struct t_hashtable *join_smart_filtered; /* smart filtered joins        */
+    struct t_hashtable *join_smart_filtered_lines; /* lines of smart        */
+                                       /* filtered joins (by nick)          */
+    long stats_messages_recv;          /* messages received for channel     */
+    long stats_bytes_recv;             /* bytes received for channel        */
+    long stats_time_recv_command;      /* time in commands cb (microsec)    */
     struct t_gui_buffer *buffer;       /* buffer allocated for channel      */
     char *buffer_as_string;            /* used to return buffer info        */
     struct t_irc_channel *prev_channel; /* link to previous channel         */
@@ -80,6 +117,8 @@ struct t_irc_channel
 
 extern int irc_channel_valid (struct t_irc_server *server,
                               struct t_irc_channel *channel);
+extern void irc_channel_set_name_fold (struct t_irc_server *server,
+                                       struct t_irc_channel *channel);
 extern struct t_irc_channel *irc_channel_search (struct t_irc_server *server,
                                                  const char *channel_name);
 extern struct t_gui_buffer *irc_channel_search_buffer (struct t_irc_server *server,
@@ -97,6 +136,11 @@ extern struct t_irc_channel *irc_channel_new (struct t_irc_server *server,
                                               int auto_switch);
 extern void irc_channel_add_nicklist_groups (struct t_irc_server *server,
                                              struct t_irc_channel *channel);
+extern void irc_channel_nicklist_batch (struct t_irc_channel *channel,
+                                        int batch);
+extern void irc_channel_nicklist_burst_add (struct t_irc_channel *channel,
+                                            int force);
+extern void irc_channel_nicklist_burst_end_all ();
 extern void irc_channel_set_buffer_title (struct t_irc_channel *channel);
 extern void irc_channel_set_topic (struct t_irc_channel *channel,
                                    const char *topic);
@@ -132,6 +176,8 @@ extern struct t_irc_channel_speaking *irc_channel_nick_speaking_time_search (str
                                                                              struct t_irc_channel *channel,
                                                                              const char *nick_name,
                                                                              int check_time);
+extern void irc_channel_nick_speaking_time_rehash (struct t_irc_server *server,
+                                                  struct t_irc_channel *channel);
 extern void irc_channel_nick_speaking_time_remove_old (struct t_irc_channel *channel);
 extern void irc_channel_nick_speaking_time_add (struct t_irc_server *server,
                                                 struct t_irc_channel *channel,
@@ -83,27 +83,86 @@ char irc_color_term2irc[IRC_COLOR_TERM2IRC_NUM_COLORS] =
 regex_t *irc_color_regex_ansi = NULL;
 
 
+/*
+ * Searches for the first IRC color/attribute code in a string.
+ *
+ * Returns pointer to first code found, NULL if the string has no IRC
+ * color/attribute code.
+ */
+
+const char *
+irc_color_search_code (const char *string)
+{
+    if (!string)
+        return NULL;
+
+    return strpbrk (string, IRC_COLOR_CODES_CHARS);
+}
+
+/*
+ * Adds data at the end of a string being built by function
+ * irc_color_decode (the string is enlarged if needed).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+irc_color_decode_add (char **out, int *out_length, int *out_pos,
+                      const char *data, int length)
+{
+    char *out2;
+    int new_length;
+
+    if (*out_pos + length + 1 > *out_length)
+    {
+        new_length = *out_length;
+        while (*out_pos + length + 1 > new_length)
+        {
+            new_length *= 2;
+        }
+        out2 = realloc (*out, new_length);
+        if (!out2)
+            return 0;
+        *out = out2;
+        *out_length = new_length;
+    }
+
+    memcpy (*out + *out_pos, data, length);
+    *out_pos += length;
+    (*out)[*out_pos] = '\0';
+
+    return 1;
+}
+
 /*
  * Replaces IRC colors by WeeChat colors.
  *
  * If keep_colors == 0: removes any color/style in message otherwise keeps
  * colors.
  *
+ * Text between codes is copied in one pass, and a string without any IRC
+ * color/attribute code is just duplicated.
+ *
  * Note: result must be freed after use.
  */
 
 char *
 irc_color_decode (const char *string, int keep_colors)
 {
-    unsigned char *out, *out2, *ptr_string;
-    int out_length, length, out_pos, length_to_add;
-    char str_fg[3], str_bg[3], str_color[128], str_key[128], str_to_add[128];
-    const char *remapped_color;
-    int fg, bg, bold, reverse, italic, underline, rc;
+    char *out, str_color[128], str_key[128];
+    const char *ptr_string, *ptr_code, *ptr_color, *remapped_color;
+    int out_length, out_pos, fg, bg, bold, reverse, italic, underline;
 
     if (!string)
         return NULL;
 
+    /* fast path: no color/attribute code in string */
+    ptr_code = irc_color_search_code (string);
+    if (!ptr_code)
+        return strdup (string);
+
     /*
      * create output string with size of length*2 (with min 128 bytes),
      * this string will be realloc() later with a larger size if needed
@@ -121,29 +180,36 @@ irc_color_decode (const char *string, int keep_colors)
     italic = 0;
     underline = 0;
 
-    ptr_string = (unsigned char *)string;
+    ptr_string = string;
     out[0] = '\0';
     out_pos = 0;
-    while (ptr_string && ptr_string[0])
+    while (ptr_string[0])
     {
-        str_to_add[0] = '\0';
+        /* copy text until next code (or end of string) */
+        if (!ptr_code)
+            ptr_code = ptr_string + strlen (ptr_string);
+        if (ptr_code > ptr_string)
+        {
+            if (!irc_color_decode_add (&out, &out_length, &out_pos,
+                                       ptr_string, ptr_code - ptr_string))
+                return out;
+            ptr_string = ptr_code;
+            if (!ptr_string[0])
+                break;
+        }
+
+        ptr_color = NULL;
         switch (ptr_string[0])
         {
             case IRC_COLOR_BOLD_CHAR:
                 if (keep_colors)
-                {
-                    snprintf (str_to_add, sizeof (str_to_add), "%s",
-                              weechat_color ((bold) ? "-bold" : "bold"));
-                }
+                    ptr_color = weechat_color ((bold) ? "-bold" : "bold");
                 bold ^= 1;
                 ptr_string++;
                 break;
             case IRC_COLOR_RESET_CHAR:
                 if (keep_colors)
-                {
-                    snprintf (str_to_add, sizeof (str_to_add), "%s",
-                              weechat_color ("reset"));
-                }
+                    ptr_color = weechat_color ("reset");
                 bold = 0;
                 reverse = 0;
                 italic = 0;
@@ -155,82 +221,54 @@ irc_color_decode (const char *string, int keep_colors)
                 break;
             case IRC_COLOR_REVERSE_CHAR:
                 if (keep_colors)
-                {
-                    snprintf (str_to_add, sizeof (str_to_add), "%s",
-                              weechat_color ((reverse) ? "-reverse" : "reverse"));
-                }
+                    ptr_color = weechat_color ((reverse) ? "-reverse" : "reverse");
                 reverse ^= 1;
                 ptr_string++;
                 break;
             case IRC_COLOR_ITALIC_CHAR:
                 if (keep_colors)
-                {
-                    snprintf (str_to_add, sizeof (str_to_add), "%s",
-                              weechat_color ((italic) ? "-italic" : "italic"));
-                }
+                    ptr_color = weechat_color ((italic) ? "-italic" : "italic");
                 italic ^= 1;
                 ptr_string++;
                 break;
             case IRC_COLOR_UNDERLINE_CHAR:
                 if (keep_colors)
-                {
-                    snprintf (str_to_add, sizeof (str_to_add), "%s",
-                              weechat_color ((underline) ? "-underline" : "underline"));
-                }
+                    ptr_color = weechat_color ((underline) ? "-underline" : "underline");
                 underline ^= 1;
                 ptr_string++;
                 break;
             case IRC_COLOR_COLOR_CHAR:
                 ptr_string++;
-                str_fg[0] = '\0';
-                str_bg[0] = '\0';
-                if (isdigit (ptr_string[0]))
+                fg = -1;
+                bg = -1;
+                if (isdigit ((unsigned char)ptr_string[0]))
                 {
-                    str_fg[0] = ptr_string[0];
-                    str_fg[1] = '\0';
+                    fg = ptr_string[0] - '0';
                     ptr_string++;
-                    if (isdigit (ptr_string[0]))
+                    if (isdigit ((unsigned char)ptr_string[0]))
                     {
-                        str_fg[1] = ptr_string[0];
-                        str_fg[2] = '\0';
+                        fg = (fg * 10) + (ptr_string[0] - '0');
                         ptr_string++;
                     }
+                    fg %= IRC_NUM_COLORS;
                 }
-                if ((ptr_string[0] == ',') && (isdigit (ptr_string[1])))
+                if ((ptr_string[0] == ',')
+                    && isdigit ((unsigned char)ptr_string[1]))
                 {
                     ptr_string++;
-                    str_bg[0] = ptr_string[0];
-                    str_bg[1] = '\0';
+                    bg = ptr_string[0] - '0';
                     ptr_string++;
-                    if (isdigit (ptr_string[0]))
+                    if (isdigit ((unsigned char)ptr_string[0]))
                     {
-                        str_bg[1] = ptr_string[0];
-                        str_bg[2] = '\0';
+                        bg = (bg * 10) + (ptr_string[0] - '0');
                         ptr_string++;
                     }
+                    bg %= IRC_NUM_COLORS;
                 }
                 if (keep_colors)
                 {
-                    if (str_fg[0] || str_bg[0])
+                    if ((fg >= 0) || (bg >= 0))
                     {
-                        fg = -1;
-                        bg = -1;
-                        if (str_fg[0])
-                        {
-                            rc = sscanf (str_fg, "%d", &fg);
-                            if ((rc != EOF) && (rc >= 1))
-                            {
-                                fg %= IRC_NUM_COLORS;
-                            }
-                        }
-                        if (str_bg[0])
-                        {
-                            rc = sscanf (str_bg, "%d", &bg);
-                            if ((rc != EOF) && (rc >= 1))
-                            {
-                                bg %= IRC_NUM_COLORS;
-                            }
-                        }
                         /* search "fg,bg" in hashtable of remapped colors */
                         snprintf (str_key, sizeof (str_key), "%d,%d", fg, bg);
                         remapped_color = weechat_hashtable_get (
@@ -249,50 +287,28 @@ irc_color_decode (const char *string, int keep_colors)
                                       (bg >= 0) ? "," : "",
                                       (bg >= 0) ? irc_color_to_weechat[bg] : "");
                         }
-                        snprintf (str_to_add, sizeof (str_to_add), "%s",
-                                  weechat_color (str_color));
+                        ptr_color = weechat_color (str_color);
                     }
                     else
                     {
-                        snprintf (str_to_add, sizeof (str_to_add), "%s",
-                                  weechat_color ("resetcolor"));
+                        ptr_color = weechat_color ("resetcolor");
                     }
                 }
                 break;
-            default:
-                /*
-                 * we are not on an IRC color code, just copy the UTF-8 char
-                 * into "str_to_add"
-                 */
-                length = weechat_utf8_char_size ((char *)ptr_string);
-                if (length == 0)
-                    length = 1;
-                memcpy (str_to_add, ptr_string, length);
-                str_to_add[length] = '\0';
-                ptr_string += length;
-                break;
         }
-        /* add "str_to_add" (if not empty) to "out" */
-        if (str_to_add[0])
+
+        /* add WeeChat color (if not empty) to "out" */
+        if (ptr_color && ptr_color[0])
         {
-            /* if "out" is too small for adding "str_to_add", do a realloc() */
-            length_to_add = strlen (str_to_add);
-            if (out_pos + length_to_add + 1 > out_length)
-            {
-                /* try to double the size of "out" */
-                out_length *= 2;
-                out2 = realloc (out, out_length);
-                if (!out2)
-                    return (char *)out;
-                out = out2;
-            }
-            /* add "str_to_add" to "out" */
-            memcpy (out + out_pos, str_to_add, length_to_add + 1);
-            out_pos += length_to_add;
+            if (!irc_color_decode_add (&out, &out_length, &out_pos,
+                                       ptr_color, strlen (ptr_color)))
+                return out;
         }
+
+        ptr_code = irc_color_search_code (ptr_string);
     }
 
-    return (char *)out;
+    return out;
 }
 
 /*
@@ -850,7 +866,7 @@ irc_color_end ()
 {
     if (irc_color_regex_ansi)
     {
-        regfree (irc_color_regex_ansi);
+        weechat_string_regfree (irc_color_regex_ansi);
         free (irc_color_regex_ansi);
         irc_color_regex_ansi = NULL;
     }
@@ -59,6 +59,12 @@
 #define IRC_COLOR_UNDERLINE_CHAR '\x1F'  /* underlined text                 */
 #define IRC_COLOR_UNDERLINE_STR  "\x1F"  /*   [1F]...[1F]                   */
 
+/* all chars of IRC color & style codes (to search codes in a string) */
+#define IRC_COLOR_CODES_CHARS                                           \
+    IRC_COLOR_BOLD_STR IRC_COLOR_COLOR_STR IRC_COLOR_RESET_STR          \
+    IRC_COLOR_FIXED_STR IRC_COLOR_REVERSE_STR IRC_COLOR_ITALIC_STR      \
+    IRC_COLOR_UNDERLINE_STR
+
 #define IRC_COLOR_TERM2IRC_NUM_COLORS 16
 
 /* macros for WeeChat core and IRC colors */
@@ -104,6 +110,7 @@ struct t_irc_color_ansi_state
     char italic;
 };
 
+extern const char *irc_color_search_code (const char *string);
 extern char *irc_color_decode (const char *string, int keep_colors);
 extern char *irc_color_encode (const char *string, int keep_colors);
 extern char *irc_color_modifier_cb (const void *pointer, void *data,
@@ -1984,7 +1984,8 @@ irc_command_disconnect_one_server (struct t_irc_server *server,
         return 0;
 
     if ((!server->is_connected) && (!server->hook_connect)
-        && (!server->hook_fd) && (server->reconnect_start == 0))
+        && (!server->hook_fd) && (!server->reader)
+        && (server->reconnect_start == 0))
     {
         weechat_printf (
             server->buffer,
@@ -2040,7 +2041,7 @@ IRC_COMMAND_CALLBACK(disconnect)
                  ptr_server = ptr_server->next_server)
             {
                 if ((ptr_server->is_connected) || (ptr_server->hook_connect)
-                    || (ptr_server->hook_fd)
+                    || (ptr_server->hook_fd) || (ptr_server->reader)
                     || (ptr_server->reconnect_start != 0))
                 {
                     if (!irc_command_disconnect_one_server (ptr_server, reason))
@@ -2907,7 +2908,7 @@ IRC_COMMAND_CALLBACK(list)
 
     if (ptr_server->cmd_list_regexp)
     {
-        regfree (ptr_server->cmd_list_regexp);
+        weechat_string_regfree (ptr_server->cmd_list_regexp);
         free (ptr_server->cmd_list_regexp);
         ptr_server->cmd_list_regexp = NULL;
     }
@@ -4222,7 +4223,8 @@ irc_command_reconnect_one_server (struct t_irc_server *server,
 
     switch_done = 0;
 
-    if ((server->is_connected) || (server->hook_connect) || (server->hook_fd))
+    if ((server->is_connected) || (server->hook_connect) || (server->hook_fd)
+        || (server->reader))
     {
         /* disconnect from server */
         irc_command_quit_server (server, NULL);
@@ -4933,6 +4935,14 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
                             IRC_COLOR_CHAT_VALUE,
                             weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]),
                             NG_("second", "seconds", weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW])));
+        /* anti_flood_burst */
+        if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]))
+            weechat_printf (NULL, "  anti_flood_burst . . :   (%d)",
+                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST));
+        else
+            weechat_printf (NULL, "  anti_flood_burst . . : %s%d",
+                            IRC_COLOR_CHAT_VALUE,
+                            weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]));
         /* away_check */
         if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_printf (NULL, "  away_check . . . . . :   (%d %s)",
@@ -5020,13 +5030,78 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
     }
 }
 
+/*
+ * Displays processing cost of messages received on a server (stats).
+ */
+
+void
+irc_command_display_server_stats (struct t_irc_server *server)
+{
+    struct t_irc_server_stats_item *items;
+    int i, num_items;
+
+    weechat_printf (NULL, "");
+    weechat_printf (NULL,
+                    _("Stats for server %s%s%s (last %ld seconds):"),
+                    IRC_COLOR_CHAT_SERVER,
+                    server->name,
+                    IRC_COLOR_RESET,
+                    (long)(time (NULL) - server->stats_start));
+    weechat_printf (NULL,
+                    _("  received: %ld bytes, %ld messages"),
+                    server->stats_bytes_recv,
+                    server->stats_messages_recv);
+    weechat_printf (NULL,
+                    _("  time: %.3f ms processing messages, %.3f ms in "
+                      "commands, %.3f ms in modifiers, %.3f ms in signals"),
+                    ((float)server->stats_time_msgq) / 1000,
+                    ((float)server->stats_time_recv_command) / 1000,
+                    ((float)server->stats_time_modifiers) / 1000,
+                    ((float)server->stats_time_signals) / 1000);
+
+    items = irc_server_stats_sort_commands (server, &num_items);
+    if (items)
+    {
+        weechat_printf (NULL, _("  most expensive commands:"));
+        for (i = 0; (i < num_items) && (i < IRC_SERVER_STATS_TOP); i++)
+        {
+            weechat_printf (NULL,
+                            _("    %-16s %10.3f ms, %ld messages, %ld bytes"),
+                            items[i].name,
+                            ((float)items[i].time) / 1000,
+                            items[i].count,
+                            items[i].bytes);
+        }
+        free (items);
+    }
+
+    items = irc_server_stats_sort_channels (server, &num_items);
+    if (items)
+    {
+        weechat_printf (NULL, _("  most expensive channels:"));
+        for (i = 0; (i < num_items) && (i < IRC_SERVER_STATS_TOP); i++)
+        {
+            weechat_printf (NULL,
+                            _("    %s%-16s%s %10.3f ms, %ld messages, "
+                              "%ld bytes"),
+                            IRC_COLOR_CHAT_CHANNEL,
+                            items[i].name,
+                            IRC_COLOR_RESET,
+                            ((float)items[i].time) / 1000,
+                            items[i].count,
+                            items[i].bytes);
+        }
+        free (items);
+    }
+}
+
 /*
  * Callback for command "/server": manages IRC servers.
  */
 
 IRC_COMMAND_CALLBACK(server)
 {
-    int i, detailed_list, one_server_found, length, count;
+    int i, detailed_list, one_server_found, length, count, reset;
     struct t_irc_server *ptr_server2, *server_found, *new_server;
     char *server_name, *message;
 
@@ -5351,6 +5426,54 @@ IRC_COMMAND_CALLBACK(server)
         return WEECHAT_RC_OK;
     }
 
+    if (weechat_strcasecmp (argv[1], "stats") == 0)
+    {
+        reset = 0;
+        server_name = NULL;
+        for (i = 2; i < argc; i++)
+        {
+            if (weechat_strcasecmp (argv[i], "-reset") == 0)
+                reset = 1;
+            else if (!server_name)
+                server_name = argv[i];
+        }
+        if (server_name)
+        {
+            server_found = irc_server_search (server_name);
+            if (!server_found)
+            {
+                weechat_printf (
+                    NULL,
+                    _("%s%s: server \"%s\" not found for \"%s\" command"),
+                    weechat_prefix ("error"), IRC_PLUGIN_NAME,
+                    server_name, "server stats");
+                return WEECHAT_RC_OK;
+            }
+        }
+        else
+            server_found = NULL;
+        for (ptr_server2 = irc_servers; ptr_server2;
+             ptr_server2 = ptr_server2->next_server)
+        {
+            if (server_found && (ptr_server2 != server_found))
+                continue;
+            if (reset)
+                irc_server_stats_reset (ptr_server2);
+            else
+                irc_command_display_server_stats (ptr_server2);
+        }
+        if (reset)
+        {
+            weechat_printf (NULL,
+                            (server_found) ?
+                            _("%s: stats reset for server %s") :
+                            _("%s: stats reset for all servers"),
+                            IRC_PLUGIN_NAME,
+                            (server_found) ? server_found->name : NULL);
+        }
+        return WEECHAT_RC_OK;
+    }
+
     if (weechat_strcasecmp (argv[1], "raw") == 0)
     {
         irc_raw_open (1);
@@ -6264,7 +6387,7 @@ irc_command_init ()
            "Without argument, \"ls\" and \"list\" are sent.\n"
            "\n"
            "Capabilities supported by WeeChat are: "
-           "account-notify, away-notify, cap-notify, extended-join, "
+           "account-notify, away-notify, batch, cap-notify, extended-join, "
            "multi-prefix, server-time, userhost-in-names.\n"
            "\n"
            "The capabilities to automatically enable on servers can be set "
@@ -6802,7 +6925,8 @@ irc_command_init ()
            " || copy|rename <server> <new_name>"
            " || reorder <server> [<server>...]"
            " || del|keep <server>"
-           " || deloutq|jump|raw"),
+           " || deloutq|jump|raw"
+           " || stats [-reset] [<server>]"),
         N_("    list: list servers (without argument, this list is displayed)\n"
            "listfull: list servers with detailed info for each server\n"
            "     add: add a new server\n"
@@ -6822,6 +6946,10 @@ irc_command_init ()
            "WeeChat is currently sending)\n"
            "    jump: jump to server buffer\n"
            "     raw: open buffer with raw IRC data\n"
+           "   stats: display processing cost of messages received (bytes, "
+           "messages, time spent in commands, modifiers and signals), with "
+           "most expensive commands and channels\n"
+           "  -reset: reset stats\n"
            "\n"
            "Examples:\n"
            "  /server listfull\n"
@@ -6833,7 +6961,8 @@ irc_command_init ()
            "  /server rename freenode-test freenode2\n"
            "  /server reorder freenode2 freenode\n"
            "  /server del freenode\n"
-           "  /server deloutq"),
+           "  /server deloutq\n"
+           "  /server stats freenode"),
         "list %(irc_servers)"
         " || listfull %(irc_servers)"
         " || add %(irc_servers)"
@@ -6844,7 +6973,8 @@ irc_command_init ()
         " || del %(irc_servers)"
         " || deloutq"
         " || jump"
-        " || raw",
+        " || raw"
+        " || stats -reset|%(irc_servers) %(irc_servers)",
         &irc_command_server, NULL, NULL);
     weechat_hook_command (
         "servlist",
@@ -38,12 +38,14 @@
 #include "irc-msgbuffer.h"
 #include "irc-nick.h"
 #include "irc-notify.h"
+#include "irc-raw.h"
 #include "irc-server.h"
 
 
 struct t_config_file *irc_config_file = NULL;
 struct t_config_section *irc_config_section_msgbuffer = NULL;
 struct t_config_section *irc_config_section_ctcp = NULL;
+struct t_config_section *irc_config_section_ignore = NULL;
 struct t_config_section *irc_config_section_server_default = NULL;
 struct t_config_section *irc_config_section_server = NULL;
 
@@ -95,7 +97,7 @@ struct t_config_option *irc_config_look_notify_tags_whois;
 struct t_config_option *irc_config_look_part_closes_buffer;
 struct t_config_option *irc_config_look_pv_buffer;
 struct t_config_option *irc_config_look_pv_tags;
-struct t_config_option *irc_config_look_raw_messages;
+struct t_config_option *irc_config_look_raw_messages_size;
 struct t_config_option *irc_config_look_server_buffer;
 struct t_config_option *irc_config_look_smart_filter;
 struct t_config_option *irc_config_look_smart_filter_delay;
@@ -132,6 +134,7 @@ struct t_config_option *irc_config_network_ban_mask_default;
 struct t_config_option *irc_config_network_channel_encode;
 struct t_config_option *irc_config_network_colors_receive;
 struct t_config_option *irc_config_network_colors_send;
+struct t_config_option *irc_config_network_connect_max;
 struct t_config_option *irc_config_network_lag_check;
 struct t_config_option *irc_config_network_lag_max;
 struct t_config_option *irc_config_network_lag_min_show;
@@ -139,6 +142,7 @@ struct t_config_option *irc_config_network_lag_reconnect;
 struct t_config_option *irc_config_network_lag_refresh_interval;
 struct t_config_option *irc_config_network_notify_check_ison;
 struct t_config_option *irc_config_network_notify_check_whois;
+struct t_config_option *irc_config_network_recv_thread;
 struct t_config_option *irc_config_network_sasl_fail_unavailable;
 struct t_config_option *irc_config_network_send_unknown_commands;
 struct t_config_option *irc_config_network_whois_double_nick;
@@ -210,9 +214,8 @@ irc_config_compute_nick_colors ()
                 if (irc_server_strcasecmp (ptr_server, ptr_nick->name,
                                            ptr_server->nick) != 0)
                 {
-                    if (ptr_nick->color)
-                        free (ptr_nick->color);
-                    ptr_nick->color = strdup (irc_nick_find_color (ptr_nick->name));
+                    irc_nick_set_string (&ptr_nick->color,
+                                         irc_nick_find_color (ptr_nick->name));
                 }
             }
             if (ptr_channel->pv_remote_nick_color)
@@ -586,6 +589,22 @@ irc_config_change_look_nicks_hide_password (const void *pointer, void *data,
     }
 }
 
+/*
+ * Callback for changes on option "irc.look.raw_messages_size".
+ */
+
+void
+irc_config_change_look_raw_messages_size (const void *pointer, void *data,
+                                          struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    irc_raw_ring_resize ();
+}
+
 /*
  * Callback for changes on option "irc.look.topic_strip_colors".
  */
@@ -778,6 +797,23 @@ irc_config_change_color_nick_prefixes (const void *pointer, void *data,
     weechat_bar_item_update ("input_prompt");
 }
 
+/*
+ * Callback for changes on option "irc.network.connect_max".
+ */
+
+void
+irc_config_change_network_connect_max (const void *pointer, void *data,
+                                       struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    /* limit may be higher: start queued connections */
+    irc_server_connect_queue_schedule ();
+}
+
 /*
  * Callback for changes on option "irc.network.lag_check".
  */
@@ -803,6 +839,8 @@ irc_config_change_network_lag_check (const void *pointer, void *data,
         if (ptr_server->is_connected)
             ptr_server->lag_next_check = time_next_check;
     }
+
+    irc_server_timer_schedule_all ();
 }
 
 /*
@@ -2154,6 +2192,25 @@ irc_config_server_new_option (struct t_config_file *config_file,
                 callback_change_data,
                 NULL, NULL, NULL);
             break;
+        case IRC_SERVER_OPTION_ANTI_FLOOD_BURST:
+            new_option = weechat_config_new_option (
+                config_file, section,
+                option_name, "integer",
+                N_("anti-flood: number of messages that can be sent at once to "
+                   "IRC server; then one more message can be sent after each "
+                   "delay of option anti_flood_prio_high (1 = no burst, one "
+                   "message per delay)"),
+                NULL, 1, 100,
+                default_value, value,
+                null_value_allowed,
+                callback_check_value,
+                callback_check_value_pointer,
+                callback_check_value_data,
+                callback_change,
+                callback_change_pointer,
+                callback_change_data,
+                NULL, NULL, NULL);
+            break;
         case IRC_SERVER_OPTION_AWAY_CHECK:
             new_option = weechat_config_new_option (
                 config_file, section,
@@ -2869,13 +2926,17 @@ irc_config_init ()
            "\"notify_message\", \"notify_private\" or \"notify_highlight\""),
         NULL, 0, 0, "notify_private", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-    irc_config_look_raw_messages = weechat_config_new_option (
-        irc_config_file, ptr_section,
-        "raw_messages", "integer",
-        N_("number of raw messages to save in memory when raw data buffer is "
-           "closed (messages will be displayed when opening raw data buffer)"),
-        NULL, 0, 65535, "256", NULL, 0,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    irc_config_look_raw_messages_size = weechat_config_new_option (
+        irc_config_file, ptr_section,
+        "raw_messages_size", "integer",
+        N_("size of memory (in bytes) used to save raw messages when raw data "
+           "buffer is closed, oldest messages are removed when this size is "
+           "reached (messages will be displayed when opening raw data buffer); "
+           "0 = do not save raw messages"),
+        NULL, 0, 1024 * 1024 * 1024, "262144", NULL, 0,
+        NULL, NULL, NULL,
+        &irc_config_change_look_raw_messages_size, NULL, NULL,
+        NULL, NULL, NULL);
     irc_config_look_server_buffer = weechat_config_new_option (
         irc_config_file, ptr_section,
         "server_buffer", "integer",
@@ -3148,6 +3209,17 @@ irc_config_init ()
            "i=italic, o=disable color/attributes, r=reverse, u=underline)"),
         NULL, 0, 0, "on", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    irc_config_network_connect_max = weechat_config_new_option (
+        irc_config_file, ptr_section,
+        "connect_max", "integer",
+        N_("maximum number of connections to servers in progress at same "
+           "time (connection and TLS handshake); other connections are "
+           "queued and started as soon as a connection is established or "
+           "has failed (0 = no limit)"),
+        NULL, 0, 1000, "0", NULL, 0,
+        NULL, NULL, NULL,
+        &irc_config_change_network_connect_max, NULL, NULL,
+        NULL, NULL, NULL);
     irc_config_network_lag_check = weechat_config_new_option (
         irc_config_file, ptr_section,
         "lag_check", "integer",
@@ -3206,6 +3278,16 @@ irc_config_init ()
         NULL, NULL, NULL,
         &irc_config_change_network_notify_check_whois, NULL, NULL,
         NULL, NULL, NULL);
+    irc_config_network_recv_thread = weechat_config_new_option (
+        irc_config_file, ptr_section,
+        "recv_thread", "boolean",
+        N_("read sockets of servers in threads (one thread by server): "
+           "data is received (and decrypted with TLS) by the thread, then "
+           "messages are processed by WeeChat, so that a server sending a "
+           "lot of data does not slow down the other servers; new value is "
+           "used for next connections to servers"),
+        NULL, 0, 0, "off", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     irc_config_network_sasl_fail_unavailable = weechat_config_new_option (
         irc_config_file, ptr_section,
         "sasl_fail_unavailable", "boolean",
@@ -3278,6 +3360,8 @@ irc_config_init ()
         weechat_config_free (irc_config_file);
         return 0;
     }
+    irc_config_section_ignore = ptr_section;
+    weechat_config_set_dirty (irc_config_file, ptr_section);
 
     /* server_default */
     ptr_section = weechat_config_new_section (
@@ -3312,6 +3396,7 @@ irc_config_init ()
         return 0;
     }
     irc_config_section_server = ptr_section;
+    weechat_config_set_dirty (irc_config_file, ptr_section);
 
     irc_config_hook_config_nick_color_options = weechat_hook_config (
         "weechat.look.nick_color_*",
@@ -87,6 +87,7 @@ enum t_irc_config_display_away
 extern struct t_config_file *irc_config_file;
 extern struct t_config_section *irc_config_section_msgbuffer;
 extern struct t_config_section *irc_config_section_ctcp;
+extern struct t_config_section *irc_config_section_ignore;
 extern struct t_config_section *irc_config_section_server_default;
 extern struct t_config_section *irc_config_section_server;
 
@@ -134,7 +135,7 @@ extern struct t_config_option *irc_config_look_notify_tags_whois;
 extern struct t_config_option *irc_config_look_part_closes_buffer;
 extern struct t_config_option *irc_config_look_pv_buffer;
 extern struct t_config_option *irc_config_look_pv_tags;
-extern struct t_config_option *irc_config_look_raw_messages;
+extern struct t_config_option *irc_config_look_raw_messages_size;
 extern struct t_config_option *irc_config_look_server_buffer;
 extern struct t_config_option *irc_config_look_smart_filter;
 extern struct t_config_option *irc_config_look_smart_filter_delay;
@@ -167,6 +168,7 @@ extern struct t_config_option *irc_config_network_ban_mask_default;
 extern struct t_config_option *irc_config_network_channel_encode;
 extern struct t_config_option *irc_config_network_colors_receive;
 extern struct t_config_option *irc_config_network_colors_send;
+extern struct t_config_option *irc_config_network_connect_max;
 extern struct t_config_option *irc_config_network_lag_check;
 extern struct t_config_option *irc_config_network_lag_max;
 extern struct t_config_option *irc_config_network_lag_min_show;
@@ -174,6 +176,7 @@ extern struct t_config_option *irc_config_network_lag_reconnect;
 extern struct t_config_option *irc_config_network_lag_refresh_interval;
 extern struct t_config_option *irc_config_network_notify_check_ison;
 extern struct t_config_option *irc_config_network_notify_check_whois;
+extern struct t_config_option *irc_config_network_recv_thread;
 extern struct t_config_option *irc_config_network_sasl_fail_unavailable;
 extern struct t_config_option *irc_config_network_send_unknown_commands;
 extern struct t_config_option *irc_config_network_whois_double_nick;
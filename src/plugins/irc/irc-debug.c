@@ -26,6 +26,7 @@
 #include "irc.h"
 #include "irc-debug.h"
 #include "irc-ignore.h"
+#include "irc-channel.h"
 #include "irc-redirect.h"
 #include "irc-server.h"
 
@@ -64,6 +65,61 @@ irc_debug_signal_debug_dump_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Displays memory used by IRC servers (channels, nicks and out queues).
+ */
+
+int
+irc_debug_signal_debug_memory_cb (const void *pointer, void *data,
+                                  const char *signal,
+                                  const char *type_data, void *signal_data)
+{
+    struct t_irc_server *ptr_server;
+    struct t_irc_channel *ptr_channel;
+    struct t_irc_outqueue *ptr_outqueue;
+    int i, channels, nicks, messages;
+    long size;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    weechat_printf (NULL, "");
+    weechat_printf (NULL, "%s:", IRC_PLUGIN_NAME);
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        channels = 0;
+        nicks = 0;
+        for (ptr_channel = ptr_server->channels; ptr_channel;
+             ptr_channel = ptr_channel->next_channel)
+        {
+            channels++;
+            nicks += ptr_channel->nicks_count;
+        }
+        messages = 0;
+        size = 0;
+        for (i = 0; i < 2; i++)
+        {
+            for (ptr_outqueue = ptr_server->outqueue[i]; ptr_outqueue;
+                 ptr_outqueue = ptr_outqueue->next_outqueue)
+            {
+                messages++;
+                size += sizeof (*ptr_outqueue) + ptr_outqueue->data_size;
+            }
+        }
+        weechat_printf (NULL,
+                        "  %s: %d channels, %d nicks, out queue: "
+                        "%d messages (%ld bytes)",
+                        ptr_server->name, channels, nicks, messages, size);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Initializes debug for IRC plugin.
  */
@@ -73,4 +129,6 @@ irc_debug_init ()
 {
     weechat_hook_signal ("debug_dump",
                          &irc_debug_signal_debug_dump_cb, NULL, NULL);
+    weechat_hook_signal ("debug_memory",
+                         &irc_debug_signal_debug_memory_cb, NULL, NULL);
 }
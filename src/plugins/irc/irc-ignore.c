@@ -27,12 +27,27 @@
 #include "irc.h"
 #include "irc-ignore.h"
 #include "irc-channel.h"
+#include "irc-config.h"
 #include "irc-server.h"
 
 
 struct t_irc_ignore *irc_ignore_list = NULL; /* list of ignore              */
 struct t_irc_ignore *last_irc_ignore = NULL; /* last ignore in list         */
 
+/*
+ * index of ignores (built on first check after ignores are changed):
+ * ignores with exact/prefix/suffix strings are in hashtables (key is the
+ * string, value is the first ignore with this string, the others are linked
+ * with "next_match"); for prefix/suffix, the lengths of strings are kept to
+ * search only these lengths; other ignores are checked sequentially
+ */
+int irc_ignore_index_valid = 0;         /* 0 if index must be built        */
+struct t_hashtable *irc_ignore_index[IRC_IGNORE_NUM_MATCH];
+int *irc_ignore_index_lengths[IRC_IGNORE_NUM_MATCH];
+int irc_ignore_index_lengths_count[IRC_IGNORE_NUM_MATCH];
+struct t_irc_ignore **irc_ignore_index_others = NULL;
+int irc_ignore_index_others_count = 0;
+
 
 /*
  * Checks if an ignore pointer is valid.
@@ -115,6 +130,218 @@ irc_ignore_search_by_number (int number)
     return NULL;
 }
 
+/*
+ * Analyzes the regex of an ignore to find how it can be matched: without
+ * regex if the mask is like "^string$", "^string.*$", "^.*string$" or
+ * "^.*string.*$" (as built by command /ignore for a mask with wildcards), with
+ * only ASCII chars in string.
+ *
+ * The fields "match" and "match_string" of ignore are set.
+ */
+
+void
+irc_ignore_set_match (struct t_irc_ignore *ignore)
+{
+    const char *ptr_mask;
+    char *string, *ptr_string;
+    int any_start, any_end;
+
+    ignore->match = IRC_IGNORE_MATCH_REGEX;
+    ignore->match_string = NULL;
+
+    ptr_mask = ignore->mask;
+    if (ptr_mask[0] != '^')
+        return;
+    ptr_mask++;
+
+    string = malloc (strlen (ptr_mask) + 1);
+    if (!string)
+        return;
+    ptr_string = string;
+
+    any_start = 0;
+    any_end = 0;
+    if ((ptr_mask[0] == '.') && (ptr_mask[1] == '*'))
+    {
+        any_start = 1;
+        ptr_mask += 2;
+    }
+    while (ptr_mask[0])
+    {
+        if ((ptr_mask[0] == '.') && (ptr_mask[1] == '*')
+            && (ptr_mask[2] == '$') && !ptr_mask[3])
+        {
+            any_end = 1;
+            ptr_mask += 2;
+        }
+        if ((ptr_mask[0] == '$') && !ptr_mask[1])
+            break;
+        if (ptr_mask[0] == '\\')
+        {
+            /* only an escaped special char is allowed */
+            if (!ptr_mask[1] || !strchr (".[]{}()?+*|^$\\", ptr_mask[1]))
+                break;
+            ptr_mask++;
+        }
+        else if (strchr (".[]{}()?+*|^$", ptr_mask[0]))
+        {
+            break;
+        }
+        if ((unsigned char)ptr_mask[0] >= 128)
+            break;
+        ptr_string[0] = ptr_mask[0];
+        ptr_string++;
+        ptr_mask++;
+    }
+    ptr_string[0] = '\0';
+
+    /* the whole mask must be a string between "^" and "$" */
+    if ((ptr_mask[0] != '$') || ptr_mask[1])
+    {
+        free (string);
+        return;
+    }
+
+    weechat_string_tolower (string);
+    ignore->match_string = string;
+    if (any_start)
+    {
+        ignore->match = (any_end) ?
+            IRC_IGNORE_MATCH_SUBSTRING : IRC_IGNORE_MATCH_SUFFIX;
+    }
+    else
+    {
+        ignore->match = (any_end) ?
+            IRC_IGNORE_MATCH_PREFIX : IRC_IGNORE_MATCH_EXACT;
+    }
+}
+
+/*
+ * Frees index of ignores.
+ */
+
+void
+irc_ignore_index_free ()
+{
+    int i;
+
+    for (i = 0; i < IRC_IGNORE_NUM_MATCH; i++)
+    {
+        if (irc_ignore_index[i])
+        {
+            weechat_hashtable_free (irc_ignore_index[i]);
+            irc_ignore_index[i] = NULL;
+        }
+        if (irc_ignore_index_lengths[i])
+        {
+            free (irc_ignore_index_lengths[i]);
+            irc_ignore_index_lengths[i] = NULL;
+        }
+        irc_ignore_index_lengths_count[i] = 0;
+    }
+    if (irc_ignore_index_others)
+    {
+        free (irc_ignore_index_others);
+        irc_ignore_index_others = NULL;
+    }
+    irc_ignore_index_others_count = 0;
+    irc_ignore_index_valid = 0;
+}
+
+/*
+ * Adds a length of string in lengths of index (if not already there).
+ */
+
+void
+irc_ignore_index_add_length (int match, int length)
+{
+    int i;
+
+    for (i = 0; i < irc_ignore_index_lengths_count[match]; i++)
+    {
+        if (irc_ignore_index_lengths[match][i] == length)
+            return;
+    }
+    irc_ignore_index_lengths[match][irc_ignore_index_lengths_count[match]] =
+        length;
+    irc_ignore_index_lengths_count[match]++;
+}
+
+/*
+ * Builds index of ignores.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+irc_ignore_index_build ()
+{
+    struct t_irc_ignore *ptr_ignore;
+    int i, count;
+
+    irc_ignore_index_free ();
+
+    count = (last_irc_ignore) ? last_irc_ignore->number : 0;
+    if (count == 0)
+    {
+        irc_ignore_index_valid = 1;
+        return 1;
+    }
+
+    for (i = IRC_IGNORE_MATCH_EXACT; i <= IRC_IGNORE_MATCH_SUFFIX; i++)
+    {
+        irc_ignore_index[i] = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        irc_ignore_index_lengths[i] = malloc (
+            count * sizeof (*irc_ignore_index_lengths[i]));
+        if (!irc_ignore_index[i] || !irc_ignore_index_lengths[i])
+            goto error;
+    }
+    irc_ignore_index_others = malloc (count *
+                                      sizeof (*irc_ignore_index_others));
+    if (!irc_ignore_index_others)
+        goto error;
+
+    for (ptr_ignore = irc_ignore_list; ptr_ignore;
+         ptr_ignore = ptr_ignore->next_ignore)
+    {
+        ptr_ignore->next_match = NULL;
+        switch (ptr_ignore->match)
+        {
+            case IRC_IGNORE_MATCH_EXACT:
+            case IRC_IGNORE_MATCH_PREFIX:
+            case IRC_IGNORE_MATCH_SUFFIX:
+                ptr_ignore->next_match = weechat_hashtable_get (
+                    irc_ignore_index[ptr_ignore->match],
+                    ptr_ignore->match_string);
+                weechat_hashtable_set (irc_ignore_index[ptr_ignore->match],
+                                       ptr_ignore->match_string,
+                                       ptr_ignore);
+                irc_ignore_index_add_length (
+                    ptr_ignore->match,
+                    strlen (ptr_ignore->match_string));
+                break;
+            default:
+                irc_ignore_index_others[irc_ignore_index_others_count] =
+                    ptr_ignore;
+                irc_ignore_index_others_count++;
+                break;
+        }
+    }
+
+    irc_ignore_index_valid = 1;
+    return 1;
+
+error:
+    irc_ignore_index_free ();
+    return 0;
+}
+
 /*
  * Adds a new ignore.
  *
@@ -147,6 +374,8 @@ irc_ignore_new (const char *mask, const char *server, const char *channel)
         new_ignore->number = (last_irc_ignore) ? last_irc_ignore->number + 1 : 1;
         new_ignore->mask = strdup (mask);
         new_ignore->regex_mask = regex;
+        irc_ignore_set_match (new_ignore);
+        new_ignore->next_match = NULL;
         new_ignore->server = (server) ? strdup (server) : strdup ("*");
         new_ignore->channel = (channel) ? strdup (channel) : strdup ("*");
 
@@ -158,11 +387,190 @@ irc_ignore_new (const char *mask, const char *server, const char *channel)
             irc_ignore_list = new_ignore;
         last_irc_ignore = new_ignore;
         new_ignore->next_ignore = NULL;
+
+        irc_ignore_index_valid = 0;
+
+        weechat_config_set_dirty (irc_config_file, irc_config_section_ignore);
     }
 
     return new_ignore;
 }
 
+/*
+ * Checks if server and channel of an ignore match the message.
+ *
+ * Returns:
+ *   1: server and channel match
+ *   0: server or channel does not match
+ */
+
+int
+irc_ignore_check_server_channel (struct t_irc_ignore *ignore,
+                                 struct t_irc_server *server,
+                                 const char *channel, const char *nick)
+{
+    if ((strcmp (ignore->server, "*") != 0)
+        && (weechat_strcasecmp (ignore->server, server->name) != 0))
+    {
+        return 0;
+    }
+
+    if (!channel || (strcmp (ignore->channel, "*") == 0))
+        return 1;
+
+    if (irc_channel_is_channel (server, channel))
+        return (weechat_strcasecmp (ignore->channel, channel) == 0);
+
+    if (nick)
+        return (weechat_strcasecmp (ignore->channel, nick) == 0);
+
+    return 0;
+}
+
+/*
+ * Checks if a list of ignores with same string (linked by "next_match")
+ * contains an ignore matching server and channel.
+ *
+ * If without_nick == 1, only ignores without nick in mask (no "!") are
+ * checked.
+ *
+ * Returns:
+ *   1: an ignore matches
+ *   0: no ignore matches
+ */
+
+int
+irc_ignore_check_list (struct t_irc_ignore *ignores,
+                       struct t_irc_server *server,
+                       const char *channel, const char *nick,
+                       int without_nick)
+{
+    struct t_irc_ignore *ptr_ignore;
+
+    for (ptr_ignore = ignores; ptr_ignore;
+         ptr_ignore = ptr_ignore->next_match)
+    {
+        if (without_nick && strchr (ptr_ignore->mask, '!'))
+            continue;
+        if (irc_ignore_check_server_channel (ptr_ignore, server, channel,
+                                             nick))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if a string (nick, host or user@host) matches an ignore
+ * (using the index of ignores).
+ *
+ * If without_nick == 1, only ignores without nick in mask (no "!") are
+ * checked.
+ *
+ * Returns:
+ *   1: string matches an ignore
+ *   0: string does not match any ignore
+ */
+
+int
+irc_ignore_check_string (const char *string, struct t_irc_server *server,
+                         const char *channel, const char *nick,
+                         int without_nick)
+{
+    struct t_irc_ignore *ptr_ignore;
+    char *string_lower, saved_char;
+    int i, length, length_match, rc;
+
+    string_lower = strdup (string);
+    if (!string_lower)
+        return 0;
+    for (length = 0; string_lower[length]; length++)
+    {
+        if ((string_lower[length] >= 'A') && (string_lower[length] <= 'Z'))
+            string_lower[length] += ('a' - 'A');
+    }
+
+    rc = 1;
+
+    /* exact string */
+    if (irc_ignore_index[IRC_IGNORE_MATCH_EXACT]
+        && irc_ignore_check_list (
+            weechat_hashtable_get (irc_ignore_index[IRC_IGNORE_MATCH_EXACT],
+                                   string_lower),
+            server, channel, nick, without_nick))
+    {
+        goto end;
+    }
+
+    /* prefix of string */
+    for (i = 0; i < irc_ignore_index_lengths_count[IRC_IGNORE_MATCH_PREFIX];
+         i++)
+    {
+        length_match = irc_ignore_index_lengths[IRC_IGNORE_MATCH_PREFIX][i];
+        if (length_match > length)
+            continue;
+        saved_char = string_lower[length_match];
+        string_lower[length_match] = '\0';
+        ptr_ignore = weechat_hashtable_get (
+            irc_ignore_index[IRC_IGNORE_MATCH_PREFIX], string_lower);
+        string_lower[length_match] = saved_char;
+        if (irc_ignore_check_list (ptr_ignore, server, channel, nick,
+                                   without_nick))
+        {
+            goto end;
+        }
+    }
+
+    /* suffix of string */
+    for (i = 0; i < irc_ignore_index_lengths_count[IRC_IGNORE_MATCH_SUFFIX];
+         i++)
+    {
+        length_match = irc_ignore_index_lengths[IRC_IGNORE_MATCH_SUFFIX][i];
+        if (length_match > length)
+            continue;
+        ptr_ignore = weechat_hashtable_get (
+            irc_ignore_index[IRC_IGNORE_MATCH_SUFFIX],
+            string_lower + length - length_match);
+        if (irc_ignore_check_list (ptr_ignore, server, channel, nick,
+                                   without_nick))
+        {
+            goto end;
+        }
+    }
+
+    /* other ignores (substring or regex) */
+    for (i = 0; i < irc_ignore_index_others_count; i++)
+    {
+        ptr_ignore = irc_ignore_index_others[i];
+        if (without_nick && strchr (ptr_ignore->mask, '!'))
+            continue;
+        if (ptr_ignore->match == IRC_IGNORE_MATCH_SUBSTRING)
+        {
+            if (!strstr (string_lower, ptr_ignore->match_string))
+                continue;
+        }
+        else
+        {
+            if (weechat_string_regexec (ptr_ignore->regex_mask, string,
+                                        0, NULL, 0) != 0)
+                continue;
+        }
+        if (irc_ignore_check_server_channel (ptr_ignore, server, channel,
+                                             nick))
+        {
+            goto end;
+        }
+    }
+
+    rc = 0;
+
+end:
+    free (string_lower);
+    return rc;
+}
+
 /*
  * Checks if a message (from an IRC server) should be ignored or not.
  *
@@ -175,11 +583,9 @@ int
 irc_ignore_check (struct t_irc_server *server, const char *channel,
                   const char *nick, const char *host)
 {
-    struct t_irc_ignore *ptr_ignore;
-    int server_match, channel_match;
     char *pos;
 
-    if (!server)
+    if (!server || !irc_ignore_list)
         return 0;
 
     /*
@@ -192,50 +598,20 @@ irc_ignore_check (struct t_irc_server *server, const char *channel,
         return 0;
     }
 
-    for (ptr_ignore = irc_ignore_list; ptr_ignore;
-         ptr_ignore = ptr_ignore->next_ignore)
-    {
-        if (strcmp (ptr_ignore->server, "*") == 0)
-            server_match = 1;
-        else
-            server_match = (weechat_strcasecmp (ptr_ignore->server,
-                                                server->name) == 0);
-
-        channel_match = 0;
-        if (!channel || (strcmp (ptr_ignore->channel, "*") == 0))
-            channel_match = 1;
-        else
-        {
-            if (irc_channel_is_channel (server, channel))
-            {
-                channel_match = (weechat_strcasecmp (ptr_ignore->channel,
-                                                     channel) == 0);
-            }
-            else if (nick)
-            {
-                channel_match = (weechat_strcasecmp (ptr_ignore->channel,
-                                                     nick) == 0);
-            }
-        }
+    if (!irc_ignore_index_valid && !irc_ignore_index_build ())
+        return 0;
 
-        if (server_match && channel_match)
+    if (nick && irc_ignore_check_string (nick, server, channel, nick, 0))
+        return 1;
+    if (host)
+    {
+        if (irc_ignore_check_string (host, server, channel, nick, 0))
+            return 1;
+        pos = strchr (host, '!');
+        if (pos
+            && irc_ignore_check_string (pos + 1, server, channel, nick, 1))
         {
-            if (nick && (regexec (ptr_ignore->regex_mask, nick, 0, NULL, 0) == 0))
-                return 1;
-            if (host)
-            {
-                if (regexec (ptr_ignore->regex_mask, host, 0, NULL, 0) == 0)
-                    return 1;
-                if (!strchr (ptr_ignore->mask, '!'))
-                {
-                    pos = strchr (host, '!');
-                    if (pos && (regexec (ptr_ignore->regex_mask, pos + 1,
-                                         0, NULL, 0) == 0))
-                    {
-                        return 1;
-                    }
-                }
-            }
+            return 1;
         }
     }
 
@@ -266,9 +642,11 @@ irc_ignore_free (struct t_irc_ignore *ignore)
         free (ignore->mask);
     if (ignore->regex_mask)
     {
-        regfree (ignore->regex_mask);
+        weechat_string_regfree (ignore->regex_mask);
         free (ignore->regex_mask);
     }
+    if (ignore->match_string)
+        free (ignore->match_string);
     if (ignore->server)
         free (ignore->server);
     if (ignore->channel)
@@ -286,6 +664,10 @@ irc_ignore_free (struct t_irc_ignore *ignore)
 
     free (ignore);
 
+    irc_ignore_index_valid = 0;
+
+    weechat_config_set_dirty (irc_config_file, irc_config_section_ignore);
+
     (void) weechat_hook_signal_send ("irc_ignore_removed",
                                      WEECHAT_HOOK_SIGNAL_STRING, NULL);
 }
@@ -301,6 +683,8 @@ irc_ignore_free_all ()
     {
         irc_ignore_free (irc_ignore_list);
     }
+
+    irc_ignore_index_free ();
 }
 
 /*
@@ -324,6 +708,9 @@ irc_ignore_hdata_ignore_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_ignore, number, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, mask, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, regex_mask, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_ignore, match, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_ignore, match_string, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_ignore, next_match, POINTER, 0, NULL, hdata_name);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, server, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, channel, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_ignore, prev_ignore, POINTER, 0, NULL, hdata_name);
@@ -382,6 +769,9 @@ irc_ignore_print_log ()
         weechat_log_printf ("  number . . . . . . . : %d",    ptr_ignore->number);
         weechat_log_printf ("  mask . . . . . . . . : '%s'",  ptr_ignore->mask);
         weechat_log_printf ("  regex_mask . . . . . : 0x%lx", ptr_ignore->regex_mask);
+        weechat_log_printf ("  match. . . . . . . . : %d",    ptr_ignore->match);
+        weechat_log_printf ("  match_string . . . . : '%s'",  ptr_ignore->match_string);
+        weechat_log_printf ("  next_match . . . . . : 0x%lx", ptr_ignore->next_match);
         weechat_log_printf ("  server . . . . . . . : '%s'",  ptr_ignore->server);
         weechat_log_printf ("  channel. . . . . . . : '%s'",  ptr_ignore->channel);
         weechat_log_printf ("  prev_ignore. . . . . : 0x%lx", ptr_ignore->prev_ignore);
@@ -25,11 +25,29 @@
 struct t_irc_server;
 struct t_irc_channel;
 
+/* how the mask of an ignore is matched */
+
+enum t_irc_ignore_match
+{
+    IRC_IGNORE_MATCH_REGEX = 0,        /* regex (regexec)                   */
+    IRC_IGNORE_MATCH_EXACT,            /* "^string$": exact string          */
+    IRC_IGNORE_MATCH_PREFIX,           /* "^string.*$": starts with string  */
+    IRC_IGNORE_MATCH_SUFFIX,           /* "^.*string$": ends with string    */
+    IRC_IGNORE_MATCH_SUBSTRING,        /* "^.*string.*$": contains string   */
+    /* number of match types */
+    IRC_IGNORE_NUM_MATCH,
+};
+
 struct t_irc_ignore
 {
     int number;                        /* ignore number                     */
     char *mask;                        /* nick / host mask                  */
     regex_t *regex_mask;               /* regex for mask                    */
+    int match;                         /* how mask is matched (enum above)  */
+    char *match_string;                /* string to match (lower case),     */
+                                       /* NULL for a regex                  */
+    struct t_irc_ignore *next_match;   /* next ignore with same string (in  */
+                                       /* index of ignores)                 */
     char *server;                      /* server name ("*" == any server)   */
     char *channel;                     /* channel name ("*" == any channel) */
     struct t_irc_ignore *prev_ignore;  /* link to previous ignore           */
@@ -25,6 +25,7 @@
 
 #include "../weechat-plugin.h"
 #include "irc.h"
+#include "irc-batch.h"
 #include "irc-channel.h"
 #include "irc-color.h"
 #include "irc-config.h"
@@ -945,6 +946,9 @@ irc_info_init ()
         &irc_info_infolist_irc_color_weechat_cb, NULL, NULL);
 
     /* hdata hooks */
+    weechat_hook_hdata (
+        "irc_batch", N_("irc batch"),
+        &irc_batch_hdata_batch_cb, NULL, NULL);
     weechat_hook_hdata (
         "irc_nick", N_("irc nick"),
         &irc_nick_hdata_nick_cb, NULL, NULL);
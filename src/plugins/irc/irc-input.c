@@ -138,9 +138,67 @@ irc_input_user_message_display (struct t_gui_buffer *buffer, int action,
         free (text_decoded);
 }
 
+/*
+ * Builds PRIVMSG messages for a channel, one by line of "message" (empty lines
+ * are ignored), separated by "\n".
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_input_build_privmsg_lines (const char *channel, const char *message)
+{
+    char **lines, *privmsg, *ptr_privmsg;
+    int i, num_lines, length, length_channel;
+
+    lines = weechat_string_split (message, "\n", 0, 0, &num_lines);
+    if (!lines)
+        return NULL;
+
+    length_channel = strlen (channel);
+    length = 1;
+    for (i = 0; i < num_lines; i++)
+    {
+        /* "PRIVMSG " + channel + " :" + line + "\n" */
+        length += 8 + length_channel + 2 + strlen (lines[i]) + 1;
+    }
+
+    privmsg = malloc (length);
+    if (privmsg)
+    {
+        ptr_privmsg = privmsg;
+        for (i = 0; i < num_lines; i++)
+        {
+            length = strlen (lines[i]);
+            if ((length > 0) && (lines[i][length - 1] == '\r'))
+                length--;
+            if (length == 0)
+                continue;
+            if (ptr_privmsg > privmsg)
+                *(ptr_privmsg++) = '\n';
+            memcpy (ptr_privmsg, "PRIVMSG ", 8);
+            ptr_privmsg += 8;
+            memcpy (ptr_privmsg, channel, length_channel);
+            ptr_privmsg += length_channel;
+            memcpy (ptr_privmsg, " :", 2);
+            ptr_privmsg += 2;
+            memcpy (ptr_privmsg, lines[i], length);
+            ptr_privmsg += length;
+        }
+        ptr_privmsg[0] = '\0';
+    }
+
+    weechat_string_free_split (lines);
+
+    return privmsg;
+}
+
 /*
  * Sends a PRIVMSG message, and split it if message size is > 512 bytes.
  *
+ * If message has many lines (buffer with flag "input_multiline"), one PRIVMSG
+ * is sent for each line, all queued with a single call to irc_server_sendf.
+ *
  * Warning: this function makes temporary changes in "message".
  */
 
@@ -149,7 +207,7 @@ irc_input_send_user_message (struct t_gui_buffer *buffer, int flags,
                              const char *tags, char *message)
 {
     int number, action;
-    char hash_key[32], *str_args;
+    char hash_key[32], *str_args, *privmsg_lines;
     struct t_hashtable *hashtable;
 
     IRC_BUFFER_GET_SERVER_CHANNEL(buffer);
@@ -164,11 +222,27 @@ irc_input_send_user_message (struct t_gui_buffer *buffer, int flags,
                         weechat_prefix ("error"), IRC_PLUGIN_NAME);
         return;
     }
-    hashtable = irc_server_sendf (ptr_server,
-                                  flags | IRC_SERVER_SEND_RETURN_HASHTABLE,
-                                  tags,
-                                  "PRIVMSG %s :%s",
-                                  ptr_channel->name, message);
+    if (strchr (message, '\n'))
+    {
+        privmsg_lines = irc_input_build_privmsg_lines (ptr_channel->name,
+                                                       message);
+        if (!privmsg_lines)
+            return;
+        hashtable = (privmsg_lines[0]) ?
+            irc_server_sendf (ptr_server,
+                              flags | IRC_SERVER_SEND_RETURN_HASHTABLE,
+                              tags,
+                              "%s", privmsg_lines) : NULL;
+        free (privmsg_lines);
+    }
+    else
+    {
+        hashtable = irc_server_sendf (ptr_server,
+                                      flags | IRC_SERVER_SEND_RETURN_HASHTABLE,
+                                      tags,
+                                      "PRIVMSG %s :%s",
+                                      ptr_channel->name, message);
+    }
     if (hashtable)
     {
         action = (strncmp (message, "\01ACTION ", 8) == 0);
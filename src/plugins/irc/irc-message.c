@@ -27,75 +27,59 @@
 #include "irc.h"
 #include "irc-server.h"
 #include "irc-channel.h"
+#include "irc-message.h"
 
 
 /*
- * Parses an IRC message and returns:
- *   - tags (string)
- *   - message without tags (string)
- *   - nick (string)
- *   - host (string)
- *   - command (string)
- *   - channel (string)
- *   - arguments (string)
- *   - text (string)
- *   - pos_command (integer: command index in message)
- *   - pos_arguments (integer: arguments index in message)
- *   - pos_channel (integer: channel index in message)
- *   - pos_text (integer: text index in message)
+ * Parses an IRC message and sets positions and lengths of fields in message
+ * (no memory is allocated, fields are not copied):
+ *   - tags
+ *   - message without tags
+ *   - nick
+ *   - host
+ *   - command
+ *   - arguments (until end of message)
+ *   - channel
+ *   - text (until end of message)
+ *
+ * Positions are set to -1 (and lengths to 0) for fields not found.
  *
  * Example:
  *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :hello!
  *
  * Result:
- *               tags: "time=2015-06-27T16:40:35.000Z"
- *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :hello!"
- *               nick: "nick"
- *               host: "nick!user@host"
- *            command: "PRIVMSG"
- *            channel: "#weechat"
- *          arguments: "#weechat :hello!"
- *               text: "hello!"
- *        pos_command: 47
- *      pos_arguments: 55
- *        pos_channel: 55
- *           pos_text: 65
+ *               pos_tags: 1    (length: 29)
+ *   pos_msg_without_tags: 31
+ *               pos_nick: 32   (length: 4)
+ *               pos_host: 32   (length: 14)
+ *            pos_command: 47   (length: 7)
+ *          pos_arguments: 55
+ *            pos_channel: 55   (length: 8)
+ *               pos_text: 65
  */
 
 void
-irc_message_parse (struct t_irc_server *server, const char *message,
-                   char **tags, char **message_without_tags, char **nick,
-                   char **host, char **command, char **channel,
-                   char **arguments, char **text,
-                   int *pos_command, int *pos_arguments, int *pos_channel,
-                   int *pos_text)
+irc_message_parse_positions (struct t_irc_server *server, const char *message,
+                             struct t_irc_message_parsed *parsed)
 {
     const char *ptr_message, *pos, *pos2, *pos3, *pos4, *ptr_channel_found;
 
-    if (tags)
-        *tags = NULL;
-    if (message_without_tags)
-        *message_without_tags = NULL;
-    if (nick)
-        *nick = NULL;
-    if (host)
-        *host = NULL;
-    if (command)
-        *command = NULL;
-    if (channel)
-        *channel = NULL;
-    if (arguments)
-        *arguments = NULL;
-    if (text)
-        *text = NULL;
-    if (pos_command)
-        *pos_command = -1;
-    if (pos_arguments)
-        *pos_arguments = -1;
-    if (pos_channel)
-        *pos_channel = -1;
-    if (pos_text)
-        *pos_text = -1;
+    if (!parsed)
+        return;
+
+    parsed->pos_tags = -1;
+    parsed->length_tags = 0;
+    parsed->pos_msg_without_tags = -1;
+    parsed->pos_nick = -1;
+    parsed->length_nick = 0;
+    parsed->pos_host = -1;
+    parsed->length_host = 0;
+    parsed->pos_command = -1;
+    parsed->length_command = 0;
+    parsed->pos_arguments = -1;
+    parsed->pos_channel = -1;
+    parsed->length_channel = 0;
+    parsed->pos_text = -1;
     ptr_channel_found = NULL;
 
     if (!message)
@@ -119,11 +103,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         pos = strchr (ptr_message, ' ');
         if (pos)
         {
-            if (tags)
-            {
-                *tags = weechat_strndup (ptr_message + 1,
-                                         pos - (ptr_message + 1));
-            }
+            parsed->pos_tags = 1;
+            parsed->length_tags = pos - (ptr_message + 1);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -132,8 +113,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
     }
 
-    if (message_without_tags)
-        *message_without_tags = strdup (ptr_message);
+    parsed->pos_msg_without_tags = ptr_message - message;
 
     /* now we have: ptr_message --> ":nick!user@host PRIVMSG #weechat :hello!" */
     if (ptr_message[0] == ':')
@@ -147,18 +127,18 @@ irc_message_parse (struct t_irc_server *server, const char *message,
             pos2 = pos3;
         if (pos2 && (!pos || pos > pos2))
         {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos2 - (ptr_message + 1));
+            parsed->pos_nick = ptr_message + 1 - message;
+            parsed->length_nick = pos2 - (ptr_message + 1);
         }
         else if (pos)
         {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
+            parsed->pos_nick = ptr_message + 1 - message;
+            parsed->length_nick = pos - (ptr_message + 1);
         }
+        parsed->pos_host = ptr_message + 1 - message;
         if (pos)
         {
-            if (host)
-                *host = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
+            parsed->length_host = pos - (ptr_message + 1);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -167,8 +147,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
         else
         {
-            if (host)
-                *host = strdup (ptr_message + 1);
+            parsed->length_host = strlen (ptr_message + 1);
             ptr_message += strlen (ptr_message);
         }
     }
@@ -176,23 +155,18 @@ irc_message_parse (struct t_irc_server *server, const char *message,
     /* now we have: ptr_message --> "PRIVMSG #weechat :hello!" */
     if (ptr_message[0])
     {
+        parsed->pos_command = ptr_message - message;
         pos = strchr (ptr_message, ' ');
         if (pos)
         {
-            if (command)
-                *command = weechat_strndup (ptr_message, pos - ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
+            parsed->length_command = pos - ptr_message;
             pos++;
             while (pos[0] == ' ')
             {
                 pos++;
             }
             /* now we have: pos --> "#weechat :hello!" */
-            if (arguments)
-                *arguments = strdup (pos);
-            if (pos_arguments)
-                *pos_arguments = pos - message;
+            parsed->pos_arguments = pos - message;
             if ((pos[0] == ':')
                 && ((strncmp (ptr_message, "JOIN ", 5) == 0)
                     || (strncmp (ptr_message, "PART ", 5) == 0)))
@@ -201,10 +175,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
             }
             if (pos[0] == ':')
             {
-                if (text)
-                    *text = strdup (pos + 1);
-                if (pos_text)
-                    *pos_text = pos - message + 1;
+                parsed->pos_text = pos - message + 1;
             }
             else
             {
@@ -212,15 +183,9 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                 {
                     ptr_channel_found = pos;
                     pos2 = strchr (pos, ' ');
-                    if (channel)
-                    {
-                        if (pos2)
-                            *channel = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *channel = strdup (pos);
-                    }
-                    if (pos_channel)
-                        *pos_channel = pos - message;
+                    parsed->pos_channel = pos - message;
+                    parsed->length_channel = (pos2) ?
+                        pos2 - pos : (int)strlen (pos);
                     if (pos2)
                     {
                         while (pos2[0] == ' ')
@@ -229,21 +194,17 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                         }
                         if (pos2[0] == ':')
                             pos2++;
-                        if (text)
-                            *text = strdup (pos2);
-                        if (pos_text)
-                            *pos_text = pos2 - message;
+                        parsed->pos_text = pos2 - message;
                     }
                 }
                 else
                 {
                     pos2 = strchr (pos, ' ');
-                    if (nick && !*nick)
+                    if (parsed->pos_nick < 0)
                     {
-                        if (pos2)
-                            *nick = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *nick = strdup (pos);
+                        parsed->pos_nick = pos - message;
+                        parsed->length_nick = (pos2) ?
+                            pos2 - pos : (int)strlen (pos);
                     }
                     if (pos2)
                     {
@@ -257,15 +218,9 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                         {
                             ptr_channel_found = pos2;
                             pos4 = strchr (pos2, ' ');
-                            if (channel)
-                            {
-                                if (pos4)
-                                    *channel = weechat_strndup (pos2, pos4 - pos2);
-                                else
-                                    *channel = strdup (pos2);
-                            }
-                            if (pos_channel)
-                                *pos_channel = pos2 - message;
+                            parsed->pos_channel = pos2 - message;
+                            parsed->length_channel = (pos4) ?
+                                pos4 - pos2 : (int)strlen (pos2);
                             if (pos4)
                             {
                                 while (pos4[0] == ' ')
@@ -274,10 +229,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                                 }
                                 if (pos4[0] == ':')
                                     pos4++;
-                                if (text)
-                                    *text = strdup (pos4);
-                                if (pos_text)
-                                    *pos_text = pos4 - message;
+                                parsed->pos_text = pos4 - message;
                             }
                         }
                         else
@@ -286,17 +238,12 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                             {
                                 if (pos[0] == ':')
                                     pos++;
-                                if (text)
-                                    *text = strdup (pos);
-                                if (pos_text)
-                                    *pos_text = pos - message;
+                                parsed->pos_text = pos - message;
                             }
                             else
                             {
-                                if (channel)
-                                    *channel = weechat_strndup (pos, pos3 - pos);
-                                if (pos_channel)
-                                    *pos_channel = pos - message;
+                                parsed->pos_channel = pos - message;
+                                parsed->length_channel = pos3 - pos;
                                 pos4 = strchr (pos3, ' ');
                                 if (pos4)
                                 {
@@ -306,10 +253,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
                                     }
                                     if (pos4[0] == ':')
                                         pos4++;
-                                    if (text)
-                                        *text = strdup (pos4);
-                                    if (pos_text)
-                                        *pos_text = pos4 - message;
+                                    parsed->pos_text = pos4 - message;
                                 }
                             }
                         }
@@ -319,14 +263,124 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
         else
         {
-            if (command)
-                *command = strdup (ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
+            parsed->length_command = strlen (ptr_message);
         }
     }
 }
 
+/*
+ * Returns a copy of a field in a parsed IRC message (position and length are
+ * those returned by function irc_message_parse_positions).
+ *
+ * Returns NULL if the field was not found in message.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_message_parsed_strndup (const char *message, int pos, int length)
+{
+    if (!message || (pos < 0))
+        return NULL;
+
+    return weechat_strndup (message + pos, length);
+}
+
+/*
+ * Parses an IRC message and returns:
+ *   - tags (string)
+ *   - message without tags (string)
+ *   - nick (string)
+ *   - host (string)
+ *   - command (string)
+ *   - channel (string)
+ *   - arguments (string)
+ *   - text (string)
+ *   - pos_command (integer: command index in message)
+ *   - pos_arguments (integer: arguments index in message)
+ *   - pos_channel (integer: channel index in message)
+ *   - pos_text (integer: text index in message)
+ *
+ * Example:
+ *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :hello!
+ *
+ * Result:
+ *               tags: "time=2015-06-27T16:40:35.000Z"
+ *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :hello!"
+ *               nick: "nick"
+ *               host: "nick!user@host"
+ *            command: "PRIVMSG"
+ *            channel: "#weechat"
+ *          arguments: "#weechat :hello!"
+ *               text: "hello!"
+ *        pos_command: 47
+ *      pos_arguments: 55
+ *        pos_channel: 55
+ *           pos_text: 65
+ */
+
+void
+irc_message_parse (struct t_irc_server *server, const char *message,
+                   char **tags, char **message_without_tags, char **nick,
+                   char **host, char **command, char **channel,
+                   char **arguments, char **text,
+                   int *pos_command, int *pos_arguments, int *pos_channel,
+                   int *pos_text)
+{
+    struct t_irc_message_parsed parsed;
+
+    irc_message_parse_positions (server, message, &parsed);
+
+    if (tags)
+    {
+        *tags = irc_message_parsed_strndup (message, parsed.pos_tags,
+                                            parsed.length_tags);
+    }
+    if (message_without_tags)
+    {
+        *message_without_tags = (parsed.pos_msg_without_tags >= 0) ?
+            strdup (message + parsed.pos_msg_without_tags) : NULL;
+    }
+    if (nick)
+    {
+        *nick = irc_message_parsed_strndup (message, parsed.pos_nick,
+                                            parsed.length_nick);
+    }
+    if (host)
+    {
+        *host = irc_message_parsed_strndup (message, parsed.pos_host,
+                                            parsed.length_host);
+    }
+    if (command)
+    {
+        *command = irc_message_parsed_strndup (message, parsed.pos_command,
+                                               parsed.length_command);
+    }
+    if (channel)
+    {
+        *channel = irc_message_parsed_strndup (message, parsed.pos_channel,
+                                               parsed.length_channel);
+    }
+    if (arguments)
+    {
+        *arguments = (parsed.pos_arguments >= 0) ?
+            strdup (message + parsed.pos_arguments) : NULL;
+    }
+    if (text)
+    {
+        *text = (parsed.pos_text >= 0) ?
+            strdup (message + parsed.pos_text) : NULL;
+    }
+    if (pos_command)
+        *pos_command = parsed.pos_command;
+    if (pos_arguments)
+        *pos_arguments = parsed.pos_arguments;
+    if (pos_channel)
+        *pos_channel = parsed.pos_channel;
+    if (pos_text)
+        *pos_text = parsed.pos_text;
+}
+
 /*
  * Parses an IRC message and returns hashtable with keys:
  *   - tags
@@ -359,10 +413,10 @@ irc_message_parse_to_hashtable (struct t_irc_server *server,
                        &host, &command, &channel, &arguments, &text,
                        &pos_command, &pos_arguments, &pos_channel, &pos_text);
 
-    hashtable = weechat_hashtable_new (32,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       NULL, NULL);
+    hashtable = weechat_hashtable_new (0,
+                                      WEECHAT_HASHTABLE_STRING,
+                                      WEECHAT_HASHTABLE_STRING,
+                                      NULL, NULL);
     if (!hashtable)
         return NULL;
 
@@ -580,50 +634,122 @@ irc_message_replace_vars (struct t_irc_server *server,
 }
 
 /*
- * Adds a message + arguments in hashtable.
+ * Initializes an iterator to split a string in chunks of at most
+ * "max_length" bytes, preferably on "delimiter" (and never in the middle of
+ * an UTF-8 char).
+ */
+
+void
+irc_message_split_iter_init (struct t_irc_message_split_iter *iter,
+                             const char *string, int max_length,
+                             char delimiter)
+{
+    iter->string = string;
+    iter->pos = 0;
+    iter->max_length = max_length;
+    iter->delimiter = delimiter;
+}
+
+/*
+ * Gets next chunk of string: the chunk starts at "offset" in string and has
+ * "length" bytes; the string is read only once and is not copied.
+ *
+ * If the chunk is split on a delimiter, the delimiter is not included in
+ * chunk and is skipped.
+ *
+ * Returns:
+ *   1: chunk found
+ *   0: end of string
+ */
+
+int
+irc_message_split_iter_next (struct t_irc_message_split_iter *iter,
+                             int *offset, int *length)
+{
+    const char *start, *pos, *pos_max, *pos_next, *pos_last_delim;
+
+    start = iter->string + iter->pos;
+    if (!start[0])
+        return 0;
+
+    pos = start;
+    pos_max = start + iter->max_length;
+    pos_last_delim = NULL;
+    while (pos[0])
+    {
+        if (pos[0] == iter->delimiter)
+            pos_last_delim = pos;
+        pos_next = weechat_utf8_next_char (pos);
+        if (pos_next > pos_max)
+            break;
+        pos = pos_next;
+    }
+    if (pos[0] && pos_last_delim)
+        pos = pos_last_delim;
+
+    /* first char is longer than max length: take it anyway */
+    if ((pos == start) && (pos != pos_last_delim))
+        pos = weechat_utf8_next_char (pos);
+
+    *offset = start - iter->string;
+    *length = pos - start;
+
+    iter->pos = ((pos == pos_last_delim) ? pos + 1 : pos) - iter->string;
+
+    return 1;
+}
+
+/*
+ * Adds a message + arguments in split context: the callback is called with
+ * the message (tags are added before message).
+ *
+ * If the callback returns 0, the split is stopped (next messages are
+ * ignored).
  */
 
 void
-irc_message_split_add (struct t_hashtable *hashtable, int number,
-                       const char *tags, const char *message,
+irc_message_split_add (struct t_irc_message_split_context *context,
+                       int number, const char *tags, const char *message,
                        const char *arguments)
 {
-    char key[32], value[32], *buf;
+    char *buf;
     int length;
 
-    if (message)
+    if (context->stop || !message)
+        return;
+
+    if (tags && tags[0])
     {
-        length = ((tags) ? strlen (tags) : 0) + strlen (message) + 1;
+        length = strlen (tags) + strlen (message) + 1;
         buf = malloc (length);
-        if (buf)
-        {
-            snprintf (key, sizeof (key), "msg%d", number);
-            snprintf (buf, length, "%s%s",
-                      (tags) ? tags : "",
-                      message);
-            weechat_hashtable_set (hashtable, key, buf);
-            if (weechat_irc_plugin->debug >= 2)
-            {
-                weechat_printf (NULL,
-                                "irc_message_split_add >> %s='%s' (%d bytes)",
-                                key, buf, length - 1);
-            }
-            free (buf);
-        }
+        if (!buf)
+            return;
+        snprintf (buf, length, "%s%s", tags, message);
     }
-    if (arguments)
+    else
     {
-        snprintf (key, sizeof (key), "args%d", number);
-        weechat_hashtable_set (hashtable, key, arguments);
-        if (weechat_irc_plugin->debug >= 2)
-        {
-            weechat_printf (NULL,
-                            "irc_message_split_add >> %s='%s'",
-                            key, arguments);
-        }
+        buf = NULL;
     }
-    snprintf (value, sizeof (value), "%d", number);
-    weechat_hashtable_set (hashtable, "count", value);
+
+    if (weechat_irc_plugin->debug >= 2)
+    {
+        weechat_printf (NULL,
+                        "irc_message_split_add >> msg%d='%s' (%d bytes), "
+                        "args%d='%s'",
+                        number, (buf) ? buf : message,
+                        (int)strlen ((buf) ? buf : message),
+                        number, arguments);
+    }
+
+    context->count = number;
+    if (!(context->callback) (context->callback_data, number,
+                              (buf) ? buf : message, arguments))
+    {
+        context->stop = 1;
+    }
+
+    if (buf)
+        free (buf);
 }
 
 /*
@@ -649,7 +775,7 @@ irc_message_split_add (struct t_hashtable *hashtable, int number,
  *     arguments: "is eating"
  *     suffix   : "\01"
  *
- * Messages added to hashtable are:
+ * Messages added are:
  *   host + command + target + prefix + XXX + suffix
  * (where XXX is part of "arguments")
  *
@@ -659,7 +785,7 @@ irc_message_split_add (struct t_hashtable *hashtable, int number,
  */
 
 int
-irc_message_split_string (struct t_hashtable *hashtable,
+irc_message_split_string (struct t_irc_message_split_context *context,
                           const char *tags,
                           const char *host,
                           const char *command,
@@ -670,9 +796,9 @@ irc_message_split_string (struct t_hashtable *hashtable,
                           const char delimiter,
                           int max_length_host)
 {
-    const char *pos, *pos_max, *pos_next, *pos_last_delim;
-    char message[1024], *dup_arguments;
-    int max_length, number;
+    struct t_irc_message_split_iter iter;
+    char message[1024], chunk[512];
+    int max_length, number, offset, length;
 
     max_length = 510;
     if (max_length_host >= 0)
@@ -687,7 +813,7 @@ irc_message_split_string (struct t_hashtable *hashtable,
     if (suffix)
         max_length -= strlen (suffix);
 
-    if (max_length < 2)
+    if ((max_length < 2) || (max_length >= (int)sizeof (chunk)))
         return 0;
 
     /* debug message */
@@ -713,44 +839,27 @@ irc_message_split_string (struct t_hashtable *hashtable,
                   (target && target[0]) ? " " : "",
                   (prefix) ? prefix : "",
                   (suffix) ? suffix : "");
-        irc_message_split_add (hashtable, 1, tags, message, "");
+        irc_message_split_add (context, 1, tags, message, "");
         return 1;
     }
 
-    while (arguments && arguments[0])
+    irc_message_split_iter_init (&iter, arguments, max_length, delimiter);
+    while (!context->stop
+           && irc_message_split_iter_next (&iter, &offset, &length))
     {
-        pos = arguments;
-        pos_max = pos + max_length;
-        pos_last_delim = NULL;
-        while (pos && pos[0])
-        {
-            if (pos[0] == delimiter)
-                pos_last_delim = pos;
-            pos_next = weechat_utf8_next_char (pos);
-            if (pos_next > pos_max)
-                break;
-            pos = pos_next;
-        }
-        if (pos[0] && pos_last_delim)
-            pos = pos_last_delim;
-        dup_arguments = weechat_strndup (arguments, pos - arguments);
-        if (dup_arguments)
-        {
-            snprintf (message, sizeof (message), "%s%s%s %s%s%s%s%s",
-                      (host) ? host : "",
-                      (host) ? " " : "",
-                      command,
-                      (target) ? target : "",
-                      (target && target[0]) ? " " : "",
-                      (prefix) ? prefix : "",
-                      dup_arguments,
-                      (suffix) ? suffix : "");
-            irc_message_split_add (hashtable, number, tags, message,
-                                   dup_arguments);
-            number++;
-            free (dup_arguments);
-        }
-        arguments = (pos == pos_last_delim) ? pos + 1 : pos;
+        memcpy (chunk, arguments + offset, length);
+        chunk[length] = '\0';
+        snprintf (message, sizeof (message), "%s%s%s %s%s%s%s%s",
+                  (host) ? host : "",
+                  (host) ? " " : "",
+                  command,
+                  (target) ? target : "",
+                  (target && target[0]) ? " " : "",
+                  (prefix) ? prefix : "",
+                  chunk,
+                  (suffix) ? suffix : "");
+        irc_message_split_add (context, number, tags, message, chunk);
+        number++;
     }
 
     return 1;
@@ -766,7 +875,7 @@ irc_message_split_string (struct t_hashtable *hashtable,
  */
 
 int
-irc_message_split_join (struct t_hashtable *hashtable,
+irc_message_split_join (struct t_irc_message_split_context *context,
                         const char *tags, const char *host,
                         const char *arguments)
 {
@@ -836,7 +945,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
         else
         {
             strcat (msg_to_send, keys_to_add);
-            irc_message_split_add (hashtable, number,
+            irc_message_split_add (context, number,
                                    tags,
                                    msg_to_send,
                                    msg_to_send + length_no_channel + 1);
@@ -852,7 +961,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
     if (length > length_no_channel)
     {
         strcat (msg_to_send, keys_to_add);
-        irc_message_split_add (hashtable, number,
+        irc_message_split_add (context, number,
                                tags,
                                msg_to_send,
                                msg_to_send + length_no_channel + 1);
@@ -876,7 +985,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
  */
 
 int
-irc_message_split_privmsg_notice (struct t_hashtable *hashtable,
+irc_message_split_privmsg_notice (struct t_irc_message_split_context *context,
                                   char *tags, char *host, char *command,
                                   char *target, char *arguments,
                                   int max_length_host)
@@ -916,7 +1025,7 @@ irc_message_split_privmsg_notice (struct t_hashtable *hashtable,
     if (!prefix[0])
         strcpy (prefix, ":");
 
-    rc = irc_message_split_string (hashtable, tags, host, command, target,
+    rc = irc_message_split_string (context, tags, host, command, target,
                                    prefix, arguments, suffix,
                                    ' ', max_length_host);
 
@@ -932,7 +1041,7 @@ irc_message_split_privmsg_notice (struct t_hashtable *hashtable,
  */
 
 int
-irc_message_split_005 (struct t_hashtable *hashtable,
+irc_message_split_005 (struct t_irc_message_split_context *context,
                        char *tags, char *host, char *command, char *target,
                        char *arguments)
 {
@@ -955,7 +1064,7 @@ irc_message_split_005 (struct t_hashtable *hashtable,
         pos[0] = '\0';
     }
 
-    return irc_message_split_string (hashtable, tags, host, command, target,
+    return irc_message_split_string (context, tags, host, command, target,
                                      NULL, arguments, suffix, ' ', -1);
 }
 
@@ -969,28 +1078,32 @@ irc_message_split_005 (struct t_hashtable *hashtable,
  * The split takes care about type of message to do a split at best place in
  * message.
  *
- * The hashtable returned contains keys "msg1", "msg2", ..., "msgN" with split
- * of message (these messages do not include the final "\r\n").
- *
- * Hashtable contains "args1", "args2", ..., "argsN" with split of arguments
- * only (no host/command here).
- *
- * Each message ("msgN") in hashtable has command and arguments, and then is
- * ready to be sent to IRC server.
- *
- * Returns hashtable with split message.
+ * The callback is called for each split message, in order, with the number
+ * of message (starting at 1), the message (without the final "\r\n") and
+ * the arguments only (no host/command here, can be NULL); each message has
+ * command and arguments, and then is ready to be sent to IRC server.
+ * If the callback returns 0, the split is stopped.
  *
- * Note: result must be freed after use.
+ * Returns number of messages given to the callback.
  */
 
-struct t_hashtable *
-irc_message_split (struct t_irc_server *server, const char *message)
+int
+irc_message_split_run (struct t_irc_server *server, const char *message,
+                       t_irc_message_split_func *callback,
+                       void *callback_data)
 {
-    struct t_hashtable *hashtable;
+    struct t_irc_message_split_context context;
+    struct t_irc_message_split_context *ptr_context;
     char **argv, **argv_eol, *tags, *host, *command, *arguments, target[512];
     char *pos, monitor_action[3];
     int split_ok, argc, index_args, max_length_nick, max_length_host;
 
+    context.callback = callback;
+    context.callback_data = callback_data;
+    context.count = 0;
+    context.stop = 0;
+    ptr_context = &context;
+
     split_ok = 0;
     tags = NULL;
     host = NULL;
@@ -1004,13 +1117,6 @@ irc_message_split (struct t_irc_server *server, const char *message)
     if (weechat_irc_plugin->debug >= 2)
         weechat_printf (NULL, "irc_message_split: message='%s'", message);
 
-    hashtable = weechat_hashtable_new (32,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       NULL, NULL);
-    if (!hashtable)
-        return NULL;
-
     if (!message || !message[0])
         goto end;
 
@@ -1062,7 +1168,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
          * WALLOPS :some text here
          */
         split_ok = irc_message_split_string (
-            hashtable, tags, host, command, NULL, ":",
+            ptr_context, tags, host, command, NULL, ":",
             (argv_eol[index_args][0] == ':') ?
             argv_eol[index_args] + 1 : argv_eol[index_args],
             NULL, ' ', max_length_host);
@@ -1079,13 +1185,13 @@ irc_message_split (struct t_irc_server *server, const char *message)
             snprintf (monitor_action, sizeof (monitor_action),
                       "%c ", argv_eol[index_args][0]);
             split_ok = irc_message_split_string (
-                hashtable, tags, host, command, NULL, monitor_action,
+                ptr_context, tags, host, command, NULL, monitor_action,
                 argv_eol[index_args] + 2, NULL, ',', max_length_host);
         }
         else
         {
             split_ok = irc_message_split_string (
-                hashtable, tags, host, command, NULL, ":",
+                ptr_context, tags, host, command, NULL, ":",
                 (argv_eol[index_args][0] == ':') ?
                 argv_eol[index_args] + 1 : argv_eol[index_args],
                 NULL, ',', max_length_host);
@@ -1097,7 +1203,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
         if (strlen (message) > 510)
         {
             /* split join if it's more than 510 bytes */
-            split_ok = irc_message_split_join (hashtable, tags, host,
+            split_ok = irc_message_split_join (ptr_context, tags, host,
                                                arguments);
         }
     }
@@ -1111,7 +1217,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
         if (index_args + 1 <= argc - 1)
         {
             split_ok = irc_message_split_privmsg_notice (
-                hashtable, tags, host, command, argv[index_args],
+                ptr_context, tags, host, command, argv[index_args],
                 (argv_eol[index_args + 1][0] == ':') ?
                 argv_eol[index_args + 1] + 1 : argv_eol[index_args + 1],
                 max_length_host);
@@ -1123,7 +1229,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
         if (index_args + 1 <= argc - 1)
         {
             split_ok = irc_message_split_005 (
-                hashtable, tags, host, command, argv[index_args],
+                ptr_context, tags, host, command, argv[index_args],
                 (argv_eol[index_args + 1][0] == ':') ?
                 argv_eol[index_args + 1] + 1 : argv_eol[index_args + 1]);
         }
@@ -1141,7 +1247,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
                 snprintf (target, sizeof (target), "%s %s",
                           argv[index_args], argv[index_args + 1]);
                 split_ok = irc_message_split_string (
-                    hashtable, tags, host, command, target, ":",
+                    ptr_context, tags, host, command, target, ":",
                     (argv_eol[index_args + 2][0] == ':') ?
                     argv_eol[index_args + 2] + 1 : argv_eol[index_args + 2],
                     NULL, ' ', -1);
@@ -1154,7 +1260,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
                               argv[index_args], argv[index_args + 1],
                               argv[index_args + 2]);
                     split_ok = irc_message_split_string (
-                        hashtable, tags, host, command, target, ":",
+                        ptr_context, tags, host, command, target, ":",
                         (argv_eol[index_args + 3][0] == ':') ?
                         argv_eol[index_args + 3] + 1 : argv_eol[index_args + 3],
                         NULL, ' ', -1);
@@ -1164,11 +1270,8 @@ irc_message_split (struct t_irc_server *server, const char *message)
     }
 
 end:
-    if (!split_ok
-        || (weechat_hashtable_get_integer (hashtable, "items_count") == 0))
-    {
-        irc_message_split_add (hashtable, 1, tags, message, arguments);
-    }
+    if (!split_ok || (context.count == 0))
+        irc_message_split_add (ptr_context, 1, tags, message, arguments);
 
     if (tags)
         free (tags);
@@ -1177,5 +1280,64 @@ end:
     if (argv_eol)
         weechat_string_free_split (argv_eol);
 
+    return context.count;
+}
+
+/*
+ * Callback for irc_message_split_run: adds a split message in hashtable.
+ */
+
+int
+irc_message_split_hashtable_cb (void *data, int number, const char *message,
+                                const char *arguments)
+{
+    struct t_hashtable *hashtable;
+    char key[32], value[32];
+
+    hashtable = (struct t_hashtable *)data;
+
+    snprintf (key, sizeof (key), "msg%d", number);
+    weechat_hashtable_set (hashtable, key, message);
+    if (arguments)
+    {
+        snprintf (key, sizeof (key), "args%d", number);
+        weechat_hashtable_set (hashtable, key, arguments);
+    }
+    snprintf (value, sizeof (value), "%d", number);
+    weechat_hashtable_set (hashtable, "count", value);
+
+    return 1;
+}
+
+/*
+ * Splits an IRC message about to be sent to IRC server (see function
+ * irc_message_split_run).
+ *
+ * The hashtable returned contains keys "msg1", "msg2", ..., "msgN" with split
+ * of message (these messages do not include the final "\r\n").
+ *
+ * Hashtable contains "args1", "args2", ..., "argsN" with split of arguments
+ * only (no host/command here).
+ *
+ * Returns hashtable with split message.
+ *
+ * Note: result must be freed after use.
+ */
+
+struct t_hashtable *
+irc_message_split (struct t_irc_server *server, const char *message)
+{
+    struct t_hashtable *hashtable;
+
+    hashtable = weechat_hashtable_new (0,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       NULL, NULL);
+    if (!hashtable)
+        return NULL;
+
+    irc_message_split_run (server, message,
+                           &irc_message_split_hashtable_cb, hashtable);
+
     return hashtable;
 }
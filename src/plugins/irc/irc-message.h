@@ -23,6 +23,63 @@
 struct t_irc_server;
 struct t_irc_channel;
 
+/*
+ * IRC message parsed: positions (and lengths) of fields in the message,
+ * so the message is parsed only once, without copy of fields
+ * (fields not found have position -1)
+ */
+
+struct t_irc_message_parsed
+{
+    int pos_tags;                      /* tags (without '@')                */
+    int length_tags;
+    int pos_msg_without_tags;          /* message without tags (until end)  */
+    int pos_nick;                      /* nick                              */
+    int length_nick;
+    int pos_host;                      /* host (without ':')                */
+    int length_host;
+    int pos_command;                   /* command                           */
+    int length_command;
+    int pos_arguments;                 /* arguments (until end)             */
+    int pos_channel;                   /* channel                           */
+    int length_channel;
+    int pos_text;                      /* text (until end)                  */
+};
+
+/*
+ * callback called for each message built by split of an IRC message
+ * (returns 0 to stop the split)
+ */
+
+typedef int (t_irc_message_split_func)(void *data, int number,
+                                       const char *message,
+                                       const char *arguments);
+
+/* iterator on chunks of a string (to split a message) */
+
+struct t_irc_message_split_iter
+{
+    const char *string;                /* string to split                   */
+    int pos;                           /* position of next chunk in string  */
+    int max_length;                    /* max length of a chunk (in bytes)  */
+    char delimiter;                    /* split on this char if possible    */
+};
+
+/* context of a message split */
+
+struct t_irc_message_split_context
+{
+    t_irc_message_split_func *callback; /* called for each split message    */
+    void *callback_data;               /* data sent to callback             */
+    int count;                         /* number of messages sent to cb     */
+    int stop;                          /* 1 if callback asked to stop       */
+};
+
+extern void irc_message_parse_positions (struct t_irc_server *server,
+                                         const char *message,
+                                         struct t_irc_message_parsed *parsed);
+extern char *irc_message_parsed_strndup (const char *message, int pos,
+                                         int length);
 extern void irc_message_parse (struct t_irc_server *server, const char *message,
                                char **tags, char **message_without_tags,
                                char **nick, char **host, char **command,
@@ -40,6 +97,15 @@ extern const char *irc_message_get_address_from_host (const char *host);
 extern char *irc_message_replace_vars (struct t_irc_server *server,
                                        const char *channel_name,
                                        const char *string);
+extern void irc_message_split_iter_init (struct t_irc_message_split_iter *iter,
+                                         const char *string, int max_length,
+                                         char delimiter);
+extern int irc_message_split_iter_next (struct t_irc_message_split_iter *iter,
+                                        int *offset, int *length);
+extern int irc_message_split_run (struct t_irc_server *server,
+                                  const char *message,
+                                  t_irc_message_split_func *callback,
+                                  void *callback_data);
 extern struct t_hashtable *irc_message_split (struct t_irc_server *server,
                                               const char *message);
 
@@ -321,13 +321,14 @@ irc_mode_channel_set (struct t_irc_server *server,
 {
     char *pos_args, *str_modes, set_flag, **argv, *pos, *ptr_arg, chanmode_type;
     int argc, current_arg, update_channel_modes, channel_modes_updated;
-    int smart_filter;
+    int smart_filter, nick_modes;
     struct t_irc_nick *ptr_nick;
 
     if (!server || !channel || !modes)
         return 0;
 
     channel_modes_updated = 0;
+    nick_modes = 0;
     argc = 0;
     argv = NULL;
     pos_args = strchr (modes, ' ');
@@ -444,6 +445,14 @@ irc_mode_channel_set (struct t_irc_server *server,
                                                         ptr_arg);
                             if (ptr_nick)
                             {
+                                /*
+                                 * many nick modes in this message (or in
+                                 * messages received): batch the changes in
+                                 * nicklist
+                                 */
+                                nick_modes++;
+                                irc_channel_nicklist_burst_add (
+                                    channel, (nick_modes > 1) ? 1 : 0);
                                 irc_nick_set_mode (server, channel, ptr_nick,
                                                    (set_flag == '+'), pos[0]);
                                 /*
@@ -443,6 +443,65 @@ irc_nick_nicklist_set_color_all ()
     }
 }
 
+/*
+ * Sets a string in a nick (name, host, account, ...): the string is a shared
+ * string, so that the same string is stored only once in memory for a user
+ * in many channels.
+ *
+ * The previous string (if set) is freed, and the string is set to NULL if
+ * "value" is NULL.
+ */
+
+void
+irc_nick_set_string (char **string, const char *value)
+{
+    if (*string)
+        weechat_string_shared_free (*string);
+    *string = (value) ? (char *)weechat_string_shared_get (value) : NULL;
+}
+
+/*
+ * Sets the nickname with case folded (used to search nicks), according to
+ * casemapping of server, and updates the hashtable with nicks of channel
+ * (creates the hashtable if needed).
+ */
+
+void
+irc_nick_set_name_fold (struct t_irc_server *server,
+                        struct t_irc_channel *channel,
+                        struct t_irc_nick *nick)
+{
+    char *name_fold;
+
+    if (nick->name_fold)
+    {
+        if (channel->nicks_hash
+            && (weechat_hashtable_get (channel->nicks_hash,
+                                       nick->name_fold) == nick))
+        {
+            weechat_hashtable_remove (channel->nicks_hash, nick->name_fold);
+        }
+    }
+
+    name_fold = irc_server_string_fold (server, nick->name, NULL, 0);
+    irc_nick_set_string (&nick->name_fold, name_fold);
+    if (name_fold)
+        free (name_fold);
+    if (!nick->name_fold)
+        return;
+
+    if (!channel->nicks_hash)
+    {
+        channel->nicks_hash = weechat_hashtable_new (
+            64,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+    }
+    if (channel->nicks_hash)
+        weechat_hashtable_set (channel->nicks_hash, nick->name_fold, nick);
+}
+
 /*
  * Adds a new nick in channel.
  *
@@ -473,12 +532,8 @@ irc_nick_new (struct t_irc_server *server, struct t_irc_channel *channel,
         /* update nick */
         irc_nick_set_prefixes (server, ptr_nick, prefixes);
         ptr_nick->away = away;
-        if (ptr_nick->account)
-            free (ptr_nick->account);
-        ptr_nick->account = (account) ? strdup (account) : NULL;
-        if (ptr_nick->realname)
-            free (ptr_nick->realname);
-        ptr_nick->realname = (realname) ? strdup (realname) : NULL;
+        irc_nick_set_string (&ptr_nick->account, account);
+        irc_nick_set_string (&ptr_nick->realname, realname);
 
         /* add new nick in nicklist */
         irc_nick_nicklist_add (server, channel, ptr_nick);
@@ -491,22 +546,24 @@ irc_nick_new (struct t_irc_server *server, struct t_irc_channel *channel,
         return NULL;
 
     /* initialize new nick */
-    new_nick->name = strdup (nickname);
-    new_nick->host = (host) ? strdup (host) : NULL;
-    new_nick->account = (account) ? strdup (account) : NULL;
-    new_nick->realname = (realname) ? strdup (realname) : NULL;
+    new_nick->name = NULL;
+    new_nick->name_fold = NULL;
+    new_nick->host = NULL;
+    new_nick->account = NULL;
+    new_nick->realname = NULL;
+    new_nick->color = NULL;
+    irc_nick_set_string (&new_nick->name, nickname);
+    irc_nick_set_string (&new_nick->host, host);
+    irc_nick_set_string (&new_nick->account, account);
+    irc_nick_set_string (&new_nick->realname, realname);
     length = strlen (irc_server_get_prefix_chars (server));
     new_nick->prefixes = malloc (length + 1);
     if (!new_nick->name || !new_nick->prefixes)
     {
-        if (new_nick->name)
-            free (new_nick->name);
-        if (new_nick->host)
-            free (new_nick->host);
-        if (new_nick->account)
-            free (new_nick->account);
-        if (new_nick->realname)
-            free (new_nick->realname);
+        irc_nick_set_string (&new_nick->name, NULL);
+        irc_nick_set_string (&new_nick->host, NULL);
+        irc_nick_set_string (&new_nick->account, NULL);
+        irc_nick_set_string (&new_nick->realname, NULL);
         if (new_nick->prefixes)
             free (new_nick->prefixes);
         free (new_nick);
@@ -517,14 +574,16 @@ irc_nick_new (struct t_irc_server *server, struct t_irc_channel *channel,
         memset (new_nick->prefixes, ' ', length);
         new_nick->prefixes[length] = '\0';
     }
+    irc_nick_set_name_fold (server, channel, new_nick);
     new_nick->prefix[0] = ' ';
     new_nick->prefix[1] = '\0';
     irc_nick_set_prefixes (server, new_nick, prefixes);
     new_nick->away = away;
     if (irc_server_strcasecmp (server, new_nick->name, server->nick) == 0)
-        new_nick->color = strdup (IRC_COLOR_CHAT_NICK_SELF);
+        irc_nick_set_string (&new_nick->color, IRC_COLOR_CHAT_NICK_SELF);
     else
-        new_nick->color = strdup (irc_nick_find_color (new_nick->name));
+        irc_nick_set_string (&new_nick->color,
+                             irc_nick_find_color (new_nick->name));
 
     /* add nick to end of list */
     new_nick->prev_nick = channel->last_nick;
@@ -565,15 +624,12 @@ irc_nick_change (struct t_irc_server *server, struct t_irc_channel *channel,
         irc_channel_nick_speaking_rename (channel, nick->name, new_nick);
 
     /* change nickname */
-    if (nick->name)
-        free (nick->name);
-    nick->name = strdup (new_nick);
-    if (nick->color)
-        free (nick->color);
+    irc_nick_set_string (&nick->name, new_nick);
+    irc_nick_set_name_fold (server, channel, nick);
     if (nick_is_me)
-        nick->color = strdup (IRC_COLOR_CHAT_NICK_SELF);
+        irc_nick_set_string (&nick->color, IRC_COLOR_CHAT_NICK_SELF);
     else
-        nick->color = strdup (irc_nick_find_color (nick->name));
+        irc_nick_set_string (&nick->color, irc_nick_find_color (nick->name));
 
     /* add nick in nicklist */
     irc_nick_nicklist_add (server, channel, nick);
@@ -641,18 +697,23 @@ irc_nick_free (struct t_irc_server *server, struct t_irc_channel *channel,
     channel->nicks_count--;
 
     /* free data */
-    if (nick->name)
-        free (nick->name);
-    if (nick->host)
-        free (nick->host);
+    irc_nick_set_string (&nick->name, NULL);
+    if (nick->name_fold)
+    {
+        if (channel->nicks_hash
+            && (weechat_hashtable_get (channel->nicks_hash,
+                                       nick->name_fold) == nick))
+        {
+            weechat_hashtable_remove (channel->nicks_hash, nick->name_fold);
+        }
+        irc_nick_set_string (&nick->name_fold, NULL);
+    }
+    irc_nick_set_string (&nick->host, NULL);
     if (nick->prefixes)
         free (nick->prefixes);
-    if (nick->account)
-        free (nick->account);
-    if (nick->realname)
-        free (nick->realname);
-    if (nick->color)
-        free (nick->color);
+    irc_nick_set_string (&nick->account, NULL);
+    irc_nick_set_string (&nick->realname, NULL);
+    irc_nick_set_string (&nick->color, NULL);
 
     free (nick);
 
@@ -678,6 +739,7 @@ irc_nick_free_all (struct t_irc_server *server, struct t_irc_channel *channel)
 
     /* remove all groups in nicklist */
     weechat_nicklist_remove_all (channel->buffer);
+    irc_channel_nicklist_batch (channel, 0);
 
     /* should be zero, but prevent any bug :D */
     channel->nicks_count = 0;
@@ -694,19 +756,39 @@ irc_nick_search (struct t_irc_server *server, struct t_irc_channel *channel,
                  const char *nickname)
 {
     struct t_irc_nick *ptr_nick;
+    char buffer[128], *nickname_fold;
 
     if (!channel || !nickname)
         return NULL;
 
+    nickname_fold = irc_server_string_fold (server, nickname,
+                                            buffer, sizeof (buffer));
+
+    /* fast search with hashtable */
+    if (nickname_fold && channel->nicks_hash)
+    {
+        ptr_nick = weechat_hashtable_get (channel->nicks_hash, nickname_fold);
+        if (nickname_fold != buffer)
+            free (nickname_fold);
+        return ptr_nick;
+    }
+
     for (ptr_nick = channel->nicks; ptr_nick;
          ptr_nick = ptr_nick->next_nick)
     {
-        if (irc_server_strcasecmp (server, ptr_nick->name, nickname) == 0)
-            return ptr_nick;
+        if (nickname_fold && ptr_nick->name_fold)
+        {
+            if (strcmp (ptr_nick->name_fold, nickname_fold) == 0)
+                break;
+        }
+        else if (irc_server_strcasecmp (server, ptr_nick->name, nickname) == 0)
+            break;
     }
 
-    /* nick not found */
-    return NULL;
+    if (nickname_fold && (nickname_fold != buffer))
+        free (nickname_fold);
+
+    return ptr_nick;
 }
 
 /*
@@ -949,6 +1031,36 @@ irc_nick_default_ban_mask (struct t_irc_nick *nick)
     return res;
 }
 
+/*
+ * Searches a nick by name with the index of nicks in channel (callback used by
+ * hdata_search): the channel is the one with this first nick.
+ */
+
+void *
+irc_nick_hdata_search_name_cb (void *data, struct t_hdata *hdata,
+                               void *pointer, const char *value)
+{
+    struct t_irc_server *ptr_server;
+    struct t_irc_channel *ptr_channel;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) hdata;
+
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        for (ptr_channel = ptr_server->channels; ptr_channel;
+             ptr_channel = ptr_channel->next_channel)
+        {
+            if (ptr_channel->nicks == pointer)
+                return irc_nick_search (ptr_server, ptr_channel, value);
+        }
+    }
+
+    return NULL;
+}
+
 /*
  * Returns hdata for nick.
  */
@@ -977,6 +1089,8 @@ irc_nick_hdata_nick_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_nick, color, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_nick, prev_nick, POINTER, 0, NULL, hdata_name);
         WEECHAT_HDATA_VAR(struct t_irc_nick, next_nick, POINTER, 0, NULL, hdata_name);
+        weechat_hdata_new_index (hdata, "name",
+                                 &irc_nick_hdata_search_name_cb, NULL);
     }
     return hdata;
 }
@@ -1031,6 +1145,7 @@ irc_nick_print_log (struct t_irc_nick *nick)
 {
     weechat_log_printf ("");
     weechat_log_printf ("    => nick %s (addr:0x%lx):",    nick->name, nick);
+    weechat_log_printf ("         name_fold. . . : '%s'",  nick->name_fold);
     weechat_log_printf ("         host . . . . . : '%s'",  nick->host);
     weechat_log_printf ("         prefixes . . . : '%s'",  nick->prefixes);
     weechat_log_printf ("         prefix . . . . : '%s'",  nick->prefix);
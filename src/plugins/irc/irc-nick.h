@@ -33,6 +33,7 @@ struct t_irc_channel;
 struct t_irc_nick
 {
     char *name;                     /* nickname                              */
+    char *name_fold;                /* nickname with case folded (casemap.)  */
     char *host;                     /* full hostname                         */
     char *prefixes;                 /* string with prefixes enabled for nick */
     char prefix[2];                 /* current prefix (higher prefix set in  */
@@ -59,6 +60,10 @@ extern const char *irc_nick_get_prefix_color_name (struct t_irc_server *server,
                                                    char prefix);
 extern void irc_nick_nicklist_set_prefix_color_all ();
 extern void irc_nick_nicklist_set_color_all ();
+extern void irc_nick_set_string (char **string, const char *value);
+extern void irc_nick_set_name_fold (struct t_irc_server *server,
+                                    struct t_irc_channel *channel,
+                                    struct t_irc_nick *nick);
 extern struct t_irc_nick *irc_nick_new (struct t_irc_server *server,
                                         struct t_irc_channel *channel,
                                         const char *nickname,
@@ -178,6 +178,22 @@ irc_notify_set_server_option (struct t_irc_server *server)
     }
 }
 
+/*
+ * Invalidates the ISON messages built for the notify list of server (they
+ * will be built again on next ISON check).
+ */
+
+void
+irc_notify_ison_invalidate (struct t_irc_server *server)
+{
+    if (server->notify_ison)
+    {
+        weechat_string_free_split (server->notify_ison);
+        server->notify_ison = NULL;
+    }
+    server->notify_ison_count = 0;
+}
+
 /*
  * Adds a new notify.
  *
@@ -216,6 +232,8 @@ irc_notify_new (struct t_irc_server *server, const char *nick, int check_away)
         new_notify->next_notify = NULL;
 
         server->notify_count++;
+
+        irc_notify_ison_invalidate (server);
     }
 
     return new_notify;
@@ -260,58 +278,128 @@ irc_notify_check_now (struct t_irc_notify *notify)
 }
 
 /*
- * Builds a message with nicks (ISON or MONITOR).
+ * Builds messages with nicks (ISON or MONITOR), so that each message fits in
+ * the 512 bytes allowed by IRC protocol; messages are separated by "\n".
  *
- * Argument "message" must be "ISON :" or "MONITOR + " or "MONITOR - ".
- * Argument "separator" must be " " for ISON and "," for MONITOR.
- * Argument "num_nicks" is set with the number of nicks added in message.
+ * Argument "irc_message" must be "ISON :" or "MONITOR + " or "MONITOR - ".
+ * Argument "separator" must be ' ' for ISON and ',' for MONITOR.
  *
  * Note: result must be freed after use.
  */
 
 char *
-irc_notify_build_message_with_nicks (struct t_irc_server *server,
-                                     const char *irc_message,
-                                     const char *separator,
-                                     int *num_nicks)
+irc_notify_build_messages (struct t_irc_server *server,
+                           const char *irc_message, char separator,
+                           const char **nicks, int num_nicks)
+{
+    char *messages;
+    int i, length_irc_message, length_nick, max_length, length_line;
+    int total_length, pos;
+
+    if (!nicks || (num_nicks <= 0))
+        return NULL;
+
+    length_irc_message = strlen (irc_message);
+
+    /* same max length as irc_message_split (host is added by server) */
+    max_length = 510 - length_irc_message
+        - (1 + ((server->nick_max_length > 0) ? server->nick_max_length : 16)
+           + 1 + 63 + 1);
+
+    /* worst case: one message for each nick */
+    total_length = 1;
+    for (i = 0; i < num_nicks; i++)
+    {
+        total_length += length_irc_message + strlen (nicks[i]) + 1;
+    }
+    messages = malloc (total_length);
+    if (!messages)
+        return NULL;
+
+    pos = 0;
+    length_line = -1;
+    for (i = 0; i < num_nicks; i++)
+    {
+        length_nick = strlen (nicks[i]);
+        if ((length_line >= 0)
+            && (length_line + 1 + length_nick <= max_length))
+        {
+            /* add nick in current message */
+            messages[pos++] = separator;
+            length_line += 1 + length_nick;
+        }
+        else
+        {
+            /* start a new message */
+            if (length_line >= 0)
+                messages[pos++] = '\n';
+            memcpy (messages + pos, irc_message, length_irc_message);
+            pos += length_irc_message;
+            length_line = length_nick;
+        }
+        memcpy (messages + pos, nicks[i], length_nick);
+        pos += length_nick;
+    }
+    messages[pos] = '\0';
+
+    return messages;
+}
+
+/*
+ * Sends messages built by function irc_notify_build_messages (one message
+ * by line).
+ */
+
+void
+irc_notify_send_messages (struct t_irc_server *server, const char *messages)
+{
+    const char *ptr_msg, *pos;
+
+    if (!messages)
+        return;
+
+    ptr_msg = messages;
+    while (ptr_msg && ptr_msg[0])
+    {
+        pos = strchr (ptr_msg, '\n');
+        irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+                          "%.*s",
+                          (pos) ? (int)(pos - ptr_msg) : (int)strlen (ptr_msg),
+                          ptr_msg);
+        ptr_msg = (pos) ? pos + 1 : NULL;
+    }
+}
+
+/*
+ * Returns an array with nicks of notify list of server.
+ *
+ * Note: result must be freed after use (but not the nicks).
+ */
+
+const char **
+irc_notify_get_nicks (struct t_irc_server *server, int *num_nicks)
 {
-    char *message, *message2;
-    int length, total_length, length_separator;
+    const char **nicks;
     struct t_irc_notify *ptr_notify;
 
     *num_nicks = 0;
 
-    length = strlen (irc_message) + 1;
-    total_length = length;
-    length_separator = strlen (separator);
+    if (server->notify_count <= 0)
+        return NULL;
 
-    message = malloc (length);
-    if (!message)
+    nicks = malloc (server->notify_count * sizeof (*nicks));
+    if (!nicks)
         return NULL;
-    snprintf (message, length, "%s", irc_message);
 
     for (ptr_notify = server->notify_list; ptr_notify;
          ptr_notify = ptr_notify->next_notify)
     {
-        length = strlen (ptr_notify->nick);
-        total_length += length + length_separator;
-        message2 = realloc (message, total_length);
-        if (!message2)
-        {
-            if (message)
-                free (message);
-            message = NULL;
+        if (*num_nicks >= server->notify_count)
             break;
-        }
-        message = message2;
-        if (*num_nicks > 0)
-            strcat (message, separator);
-        strcat (message, ptr_notify->nick);
-
-        (*num_nicks)++;
+        nicks[(*num_nicks)++] = ptr_notify->nick;
     }
 
-    return message;
+    return nicks;
 }
 
 /*
@@ -322,92 +410,161 @@ irc_notify_build_message_with_nicks (struct t_irc_server *server,
 void
 irc_notify_send_monitor (struct t_irc_server *server)
 {
-    struct t_hashtable *hashtable;
-    char *message, hash_key[32];
-    const char *str_message;
-    int num_nicks, number;
-
-    message = irc_notify_build_message_with_nicks (server,
-                                                   "MONITOR + ",
-                                                   ",",
-                                                   &num_nicks);
-    if (message && (num_nicks > 0))
+    const char **nicks;
+    char *messages;
+    int num_nicks;
+
+    nicks = irc_notify_get_nicks (server, &num_nicks);
+    if (!nicks)
+        return;
+
+    messages = irc_notify_build_messages (server, "MONITOR + ", ',',
+                                          nicks, num_nicks);
+    if (messages)
     {
-        hashtable = irc_message_split (server, message);
-        if (hashtable)
-        {
-            number = 1;
-            while (1)
-            {
-                snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                str_message = weechat_hashtable_get (hashtable,
-                                                     hash_key);
-                if (!str_message)
-                    break;
-                irc_server_sendf (server,
-                                  IRC_SERVER_SEND_OUTQ_PRIO_LOW,
-                                  NULL, "%s", str_message);
-                number++;
-            }
-            weechat_hashtable_free (hashtable);
-        }
+        irc_notify_send_messages (server, messages);
+        free (messages);
     }
-    if (message)
-        free (message);
+
+    free (nicks);
 }
 
 /*
- * Creates a notify list for server with option "irc.server.xxx.notify".
+ * Creates or updates the notify list for server with option
+ * "irc.server.xxx.notify".
+ *
+ * The list is updated incrementally: notify already in list are kept (with
+ * their current status), and if MONITOR is used, only nicks added/removed are
+ * sent to server (with as few messages as possible).
  */
 
 void
 irc_notify_new_for_server (struct t_irc_server *server)
 {
-    const char *notify;
-    char **items, *pos_params, **params;
-    int i, j, num_items, num_params, check_away;
-
-    irc_notify_free_all (server);
+    const char *notify, **nicks_added, **nicks_removed;
+    char **items, *pos_params, **params, *msg_added, *msg_removed;
+    int i, j, num_items, num_params, check_away, num_added, num_removed;
+    struct t_irc_notify *ptr_notify, *ptr_next_notify;
 
     notify = IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_NOTIFY);
     if (!notify || !notify[0])
+    {
+        irc_notify_free_all (server);
         return;
+    }
 
     items = weechat_string_split (notify, ",", 0, 0, &num_items);
-    if (items)
+    if (!items)
+    {
+        irc_notify_free_all (server);
+        return;
+    }
+
+    nicks_added = malloc (num_items * sizeof (*nicks_added));
+    nicks_removed = (server->notify_count > 0) ?
+        malloc (server->notify_count * sizeof (*nicks_removed)) : NULL;
+    num_added = 0;
+    num_removed = 0;
+
+    /* flag "ison_received" is used to mark notify still in option */
+    for (ptr_notify = server->notify_list; ptr_notify;
+         ptr_notify = ptr_notify->next_notify)
+    {
+        ptr_notify->ison_received = 0;
+    }
+
+    for (i = 0; i < num_items; i++)
     {
-        for (i = 0; i < num_items; i++)
+        check_away = 0;
+        pos_params = strchr (items[i], ' ');
+        if (pos_params)
         {
-            check_away = 0;
-            pos_params = strchr (items[i], ' ');
-            if (pos_params)
+            pos_params[0] = '\0';
+            pos_params++;
+            while (pos_params[0] == ' ')
             {
-                pos_params[0] = '\0';
                 pos_params++;
-                while (pos_params[0] == ' ')
+            }
+            params = weechat_string_split (pos_params, "/", 0, 0,
+                                           &num_params);
+            if (params)
+            {
+                for (j = 0; j < num_params; j++)
                 {
-                    pos_params++;
+                    if (weechat_strcasecmp (params[j], "away") == 0)
+                        check_away = 1;
                 }
-                params = weechat_string_split (pos_params, "/", 0, 0,
-                                               &num_params);
-                if (params)
+                weechat_string_free_split (params);
+            }
+        }
+        ptr_notify = irc_notify_search (server, items[i]);
+        if (ptr_notify)
+        {
+            ptr_notify->check_away = check_away;
+        }
+        else
+        {
+            ptr_notify = irc_notify_new (server, items[i], check_away);
+            if (ptr_notify && nicks_added)
+                nicks_added[num_added++] = ptr_notify->nick;
+        }
+        if (ptr_notify)
+            ptr_notify->ison_received = 1;
+    }
+
+    /* build MONITOR messages before notify are removed */
+    msg_added = NULL;
+    msg_removed = NULL;
+    if (server->is_connected && (server->monitor > 0))
+    {
+        if (nicks_removed)
+        {
+            for (ptr_notify = server->notify_list; ptr_notify;
+                 ptr_notify = ptr_notify->next_notify)
+            {
+                if (!ptr_notify->ison_received
+                    && (num_removed < server->notify_count))
                 {
-                    for (j = 0; j < num_params; j++)
-                    {
-                        if (weechat_strcasecmp (params[j], "away") == 0)
-                            check_away = 1;
-                    }
-                    weechat_string_free_split (params);
+                    nicks_removed[num_removed++] = ptr_notify->nick;
                 }
             }
-            irc_notify_new (server, items[i], check_away);
+            msg_removed = irc_notify_build_messages (server, "MONITOR - ", ',',
+                                                     nicks_removed,
+                                                     num_removed);
         }
-        weechat_string_free_split (items);
+        msg_added = irc_notify_build_messages (server, "MONITOR + ", ',',
+                                               nicks_added, num_added);
     }
 
-    /* if we are using MONITOR, send it now with new nicks monitored */
-    if (server->is_connected && (server->monitor > 0))
-        irc_notify_send_monitor (server);
+    /* remove notify which are not in option any more */
+    ptr_notify = server->notify_list;
+    while (ptr_notify)
+    {
+        ptr_next_notify = ptr_notify->next_notify;
+        if (ptr_notify->ison_received)
+            ptr_notify->ison_received = 0;
+        else
+            irc_notify_free (server, ptr_notify, 0);
+        ptr_notify = ptr_next_notify;
+    }
+
+    /* if we are using MONITOR, send changes in list now */
+    if (msg_removed)
+    {
+        irc_notify_send_messages (server, msg_removed);
+        free (msg_removed);
+    }
+    if (msg_added)
+    {
+        irc_notify_send_messages (server, msg_added);
+        free (msg_added);
+    }
+
+    if (nicks_added)
+        free (nicks_added);
+    if (nicks_removed)
+        free (nicks_removed);
+    weechat_string_free_split (items);
 }
 
 /*
@@ -454,6 +611,7 @@ irc_notify_free (struct t_irc_server *server, struct t_irc_notify *notify,
         free (notify->away_message);
 
     /* remove notify from list */
+    irc_notify_ison_invalidate (server);
     if (notify->prev_notify)
         (notify->prev_notify)->next_notify = notify->next_notify;
     if (notify->next_notify)
@@ -969,11 +1127,10 @@ irc_notify_hsignal_cb (const void *pointer, void *data, const char *signal,
 int
 irc_notify_timer_ison_cb (const void *pointer, void *data, int remaining_calls)
 {
-    char *message, hash_key[32];
-    const char *str_message;
-    int num_nicks, number;
+    const char **nicks;
+    char *messages;
+    int i, num_nicks;
     struct t_irc_server *ptr_server;
-    struct t_hashtable *hashtable;
 
     /* make C compiler happy */
     (void) pointer;
@@ -983,39 +1140,41 @@ irc_notify_timer_ison_cb (const void *pointer, void *data, int remaining_calls)
     for (ptr_server = irc_servers; ptr_server;
          ptr_server = ptr_server->next_server)
     {
+        /* ISON is used only if MONITOR is not supported by server */
         if (ptr_server->is_connected
             && ptr_server->notify_list
             && (ptr_server->monitor == 0))
         {
-            message = irc_notify_build_message_with_nicks (ptr_server,
-                                                           "ISON :",
-                                                           " ",
-                                                           &num_nicks);
-            if (message && (num_nicks > 0))
+            /* build ISON messages (only if notify list has changed) */
+            if (!ptr_server->notify_ison)
             {
-                hashtable = irc_message_split (ptr_server, message);
-                if (hashtable)
+                nicks = irc_notify_get_nicks (ptr_server, &num_nicks);
+                if (nicks)
                 {
-                    number = 1;
-                    while (1)
+                    messages = irc_notify_build_messages (ptr_server,
+                                                          "ISON :", ' ',
+                                                          nicks, num_nicks);
+                    if (messages)
                     {
-                        snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                        str_message = weechat_hashtable_get (hashtable,
-                                                             hash_key);
-                        if (!str_message)
-                            break;
-                        irc_redirect_new (ptr_server, "ison", "notify", 1,
-                                          NULL, 0, NULL);
-                        irc_server_sendf (ptr_server,
-                                          IRC_SERVER_SEND_OUTQ_PRIO_LOW,
-                                          NULL, "%s", str_message);
-                        number++;
+                        ptr_server->notify_ison = weechat_string_split (
+                            messages, "\n", 0, 0,
+                            &ptr_server->notify_ison_count);
+                        free (messages);
                     }
-                    weechat_hashtable_free (hashtable);
+                    free (nicks);
+                }
+            }
+            if (ptr_server->notify_ison)
+            {
+                for (i = 0; i < ptr_server->notify_ison_count; i++)
+                {
+                    irc_redirect_new (ptr_server, "ison", "notify", 1,
+                                      NULL, 0, NULL);
+                    irc_server_sendf (ptr_server,
+                                      IRC_SERVER_SEND_OUTQ_PRIO_LOW,
+                                      NULL, "%s", ptr_server->notify_ison[i]);
                 }
             }
-            if (message)
-                free (message);
         }
     }
 
@@ -1048,7 +1207,11 @@ irc_notify_timer_whois_cb (const void *pointer, void *data,
             {
                 ptr_next_notify = ptr_notify->next_notify;
 
-                if (ptr_notify->check_away)
+                /*
+                 * nick is not checked if it is known to be offline (the
+                 * away status will be checked when the nick is back)
+                 */
+                if (ptr_notify->check_away && (ptr_notify->is_on_server != 0))
                 {
                     /*
                      * redirect whois, and get only 2 messages:
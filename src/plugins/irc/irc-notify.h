@@ -38,6 +38,7 @@ struct t_irc_notify
                                        /* whois command)                    */
     /* internal stuff */
     int ison_received;                 /* used when receiving ison answer   */
+                                       /* and when notify list is updated   */
     struct t_irc_notify *prev_notify;  /* link to previous notify           */
     struct t_irc_notify *next_notify;  /* link to next notify               */
 };
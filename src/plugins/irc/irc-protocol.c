@@ -42,6 +42,7 @@
 #include "irc.h"
 #include "irc-protocol.h"
 #include "irc-bar-item.h"
+#include "irc-batch.h"
 #include "irc-buffer.h"
 #include "irc-channel.h"
 #include "irc-color.h"
@@ -59,7 +60,11 @@
 
 
 static const char irc_protocol_safe_caps[] =
-  "account-notify,away-notify,cap-notify,multi-prefix,server-time,znc.in/server-time-iso,znc.in/self-message";
+  "account-notify,away-notify,batch,cap-notify,multi-prefix,server-time,znc.in/server-time-iso,znc.in/self-message";
+
+/* caps requested when away is checked (instead of sending WHO on channels) */
+static const char irc_protocol_away_caps[] =
+  "away-notify,account-notify,extended-join";
 
 /*
  * Checks if a command is numeric.
@@ -222,10 +227,10 @@ IRC_PROTOCOL_CALLBACK(account)
         ptr_nick = irc_nick_search (server, ptr_channel, nick);
         if (ptr_nick)
         {
-            if (ptr_nick->account)
-                free (ptr_nick->account);
-            ptr_nick->account = (server->cap_account_notify && pos_account) ?
-                strdup (pos_account) : NULL;
+            irc_nick_set_string (
+                &ptr_nick->account,
+                (server->cap_account_notify && pos_account) ?
+                pos_account : NULL);
         }
     }
 
@@ -306,6 +311,40 @@ IRC_PROTOCOL_CALLBACK(authenticate)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Callback for the IRC message "BATCH": start or end of a batch of messages
+ * (with capability "batch").
+ *
+ * Message looks like:
+ *   :server BATCH +yXNAbvnRHTRBv netsplit irc.hub other.host
+ *   :server BATCH -yXNAbvnRHTRBv
+ */
+
+IRC_PROTOCOL_CALLBACK(batch)
+{
+    const char *ptr_ref;
+
+    IRC_PROTOCOL_MIN_ARGS(3);
+
+    ptr_ref = argv[2];
+
+    if (ptr_ref[0] == '+')
+    {
+        if (argc < 4)
+            return WEECHAT_RC_ERROR;
+        irc_batch_start_batch (
+            server, ptr_ref + 1, NULL, argv[3],
+            (argc > 4) ?
+            ((argv_eol[4][0] == ':') ? argv_eol[4] + 1 : argv_eol[4]) : NULL);
+    }
+    else if (ptr_ref[0] == '-')
+    {
+        irc_batch_end_batch (server, ptr_ref + 1);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Callback for the IRC message "AWAY": away info about a nick (with capability
  * "away-notify").
@@ -346,6 +385,7 @@ IRC_PROTOCOL_CALLBACK(cap)
 {
     char *ptr_caps, **caps_supported, **caps_requested, **caps_added, *capabilities;
     char **caps_removed, *cap_option, *cap_req, str_msg_auth[512], **cap_arr, *caps;
+    char *caps_away;
     const char *ptr_cap_option;
     int num_caps_supported, num_caps_requested, num_caps_added;
     int num_caps_removed, sasl_requested, sasl_to_do, sasl_mechanism;
@@ -373,6 +413,24 @@ IRC_PROTOCOL_CALLBACK(cap)
                 capabilities = string_replace (
                     IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_CAPABILITIES),
                     "*", irc_protocol_safe_caps);
+                if (capabilities
+                    && (IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK) > 0))
+                {
+                    /*
+                     * away is tracked with capabilities if the server
+                     * supports them (caps can still be disabled with "!xxx")
+                     */
+                    length = strlen (irc_protocol_away_caps) + 1
+                        + strlen (capabilities) + 1;
+                    caps_away = malloc (length);
+                    if (caps_away)
+                    {
+                        snprintf (caps_away, length, "%s,%s",
+                                  irc_protocol_away_caps, capabilities);
+                        free (capabilities);
+                        capabilities = caps_away;
+                    }
+                }
                 cap_arr = string_split (
                     capabilities,
                     ",", 0, 0, &cap_count);
@@ -391,6 +449,18 @@ IRC_PROTOCOL_CALLBACK(cap)
                         }
                         **(cap_arr + i) = '\0';
                     }
+                    else
+                    {
+                        /* remove duplicate caps */
+                        for (j = 0; j < i; j++)
+                        {
+                            if (strcmp(*(cap_arr + j), *(cap_arr + i)) == 0)
+                            {
+                                **(cap_arr + i) = '\0';
+                                break;
+                            }
+                        }
+                    }
                 }
                 caps = string_build_with_split_string ((const char**)cap_arr, ",");
                 string_free_split(cap_arr);
@@ -403,7 +473,6 @@ IRC_PROTOCOL_CALLBACK(cap)
                     cap_option[0] = '\0';
                     if (caps && caps[0])
                         strcat (cap_option, caps);
-                    free ((void *)caps);
                     if (sasl_requested)
                     {
                         if (cap_option[0])
@@ -888,6 +957,10 @@ IRC_PROTOCOL_CALLBACK(join)
         ptr_channel->checking_whox = 0;
     }
 
+    /* many joins received (netjoin)? then nicklist is updated once */
+    if (!local_join)
+        irc_channel_nicklist_burst_add (ptr_channel, 0);
+
     /* add nick in channel */
     ptr_nick = irc_nick_new (server, ptr_channel, nick, address, NULL, 0,
                              (pos_account) ? pos_account : NULL,
@@ -1301,6 +1374,7 @@ IRC_PROTOCOL_CALLBACK(nick)
                 {
                     free (ptr_channel->name);
                     ptr_channel->name = strdup (new_nick);
+                    irc_channel_set_name_fold (server, ptr_channel);
                     if (ptr_channel->pv_remote_nick_color)
                     {
                         free (ptr_channel->pv_remote_nick_color);
@@ -1329,7 +1403,7 @@ IRC_PROTOCOL_CALLBACK(nick)
 
                     /* set host in nick if needed */
                     if (!ptr_nick->host)
-                        ptr_nick->host = strdup (address);
+                        irc_nick_set_string (&ptr_nick->host, address);
 
                     /* change nick and display message on channel */
                     old_color = strdup (ptr_nick->color);
@@ -1961,7 +2035,7 @@ IRC_PROTOCOL_CALLBACK(privmsg)
             ptr_nick = irc_nick_search (server, ptr_channel, nick);
 
             if (ptr_nick && !ptr_nick->host)
-                ptr_nick->host = strdup (address);
+                irc_nick_set_string (&ptr_nick->host, address);
 
             if (status_msg[0])
             {
@@ -2107,6 +2181,45 @@ IRC_PROTOCOL_CALLBACK(privmsg)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Checks if a quit reason is a netsplit: two server names separated by a
+ * space, for example "irc.example.com hub.example.com" or "*.net *.split".
+ *
+ * Returns:
+ *   1: reason is a netsplit
+ *   0: reason is not a netsplit
+ */
+
+int
+irc_protocol_is_netsplit (const char *reason)
+{
+    const char *pos_space, *ptr_char;
+
+    if (!reason || !reason[0])
+        return 0;
+
+    pos_space = strchr (reason, ' ');
+    if (!pos_space || (pos_space == reason) || !pos_space[1]
+        || strchr (pos_space + 1, ' '))
+    {
+        return 0;
+    }
+
+    /* each server name must contain a dot, and not at beginning/end */
+    ptr_char = memchr (reason, '.', pos_space - reason);
+    if (!ptr_char || (ptr_char == reason) || (ptr_char == pos_space - 1))
+        return 0;
+    ptr_char = strchr (pos_space + 1, '.');
+    if (!ptr_char || (ptr_char == pos_space + 1) || !ptr_char[1])
+        return 0;
+
+    /* reject chars not allowed in server names (URLs, ...) */
+    if (strpbrk (reason, "/:@!"))
+        return 0;
+
+    return 1;
+}
+
 /*
  * Callback for the IRC message "QUIT".
  *
@@ -2120,7 +2233,7 @@ IRC_PROTOCOL_CALLBACK(quit)
     struct t_irc_channel *ptr_channel;
     struct t_irc_nick *ptr_nick;
     struct t_irc_channel_speaking *ptr_nick_speaking;
-    int local_quit, display_host;
+    int local_quit, display_host, netsplit;
 
     IRC_PROTOCOL_MIN_ARGS(2);
     IRC_PROTOCOL_CHECK_HOST;
@@ -2128,6 +2241,8 @@ IRC_PROTOCOL_CALLBACK(quit)
     pos_comment = (argc > 2) ?
         ((argv_eol[2][0] == ':') ? argv_eol[2] + 1 : argv_eol[2]) : NULL;
 
+    netsplit = irc_protocol_is_netsplit (pos_comment);
+
     for (ptr_channel = server->channels; ptr_channel;
          ptr_channel = ptr_channel->next_channel)
     {
@@ -2222,7 +2337,11 @@ IRC_PROTOCOL_CALLBACK(quit)
                                                         ptr_nick->name);
             }
             if (ptr_nick)
+            {
+                /* netsplit? then nicklist is updated once for all quits */
+                irc_channel_nicklist_burst_add (ptr_channel, netsplit);
                 irc_nick_free (server, ptr_channel, ptr_nick);
+            }
         }
     }
 
@@ -2633,7 +2752,7 @@ IRC_PROTOCOL_CALLBACK(005)
             pos2[0] = '\0';
         casemapping = irc_server_search_casemapping (pos);
         if (casemapping >= 0)
-            server->casemapping = casemapping;
+            irc_server_set_casemapping (server, casemapping);
         if (pos2)
             pos2[0] = ' ';
     }
@@ -3084,6 +3203,7 @@ IRC_PROTOCOL_CALLBACK(315)
     IRC_PROTOCOL_MIN_ARGS(5);
 
     ptr_channel = irc_channel_search (server, argv[3]);
+    irc_channel_nicklist_batch (ptr_channel, 0);
     if (ptr_channel && (ptr_channel->checking_whox > 0))
     {
         ptr_channel->checking_whox--;
@@ -3247,7 +3367,8 @@ IRC_PROTOCOL_CALLBACK(322)
         ((argv_eol[5][0] == ':') ? argv_eol[5] + 1 : argv_eol[5]) : NULL;
 
     if (!server->cmd_list_regexp ||
-        (regexec (server->cmd_list_regexp, argv[3], 0, NULL, 0) == 0))
+        (weechat_string_regexec (server->cmd_list_regexp, argv[3],
+                                 0, NULL, 0) == 0))
     {
         weechat_printf_date_tags (
             irc_msgbuffer_get_target_buffer (
@@ -4196,7 +4317,7 @@ IRC_PROTOCOL_CALLBACK(351)
 
 IRC_PROTOCOL_CALLBACK(352)
 {
-    char *pos_attr, *pos_hopcount, *pos_realname;
+    char *pos_attr, *pos_hopcount, *pos_realname, *str_host;
     int arg_start, length;
     struct t_irc_channel *ptr_channel;
     struct t_irc_nick *ptr_nick;
@@ -4232,15 +4353,23 @@ IRC_PROTOCOL_CALLBACK(352)
     ptr_nick = (ptr_channel) ?
         irc_nick_search (server, ptr_channel, argv[7]) : NULL;
 
+    /*
+     * during automatic check of away, nicklist is sorted and refreshed on
+     * end of who (message 315)
+     */
+    if (ptr_channel && (ptr_channel->checking_whox > 0))
+        irc_channel_nicklist_batch (ptr_channel, 1);
+
     /* update host in nick */
     if (ptr_nick)
     {
-        if (ptr_nick->host)
-            free (ptr_nick->host);
         length = strlen (argv[4]) + 1 + strlen (argv[5]) + 1;
-        ptr_nick->host = malloc (length);
-        if (ptr_nick->host)
-            snprintf (ptr_nick->host, length, "%s@%s", argv[4], argv[5]);
+        str_host = malloc (length);
+        if (str_host)
+            snprintf (str_host, length, "%s@%s", argv[4], argv[5]);
+        irc_nick_set_string (&ptr_nick->host, str_host);
+        if (str_host)
+            free (str_host);
     }
 
     /* update away flag in nick */
@@ -4253,10 +4382,10 @@ IRC_PROTOCOL_CALLBACK(352)
     /* update realname in nick */
     if (ptr_channel && ptr_nick && pos_realname)
     {
-        if (ptr_nick->realname)
-            free (ptr_nick->realname);
-        ptr_nick->realname = (pos_realname && server->cap_extended_join) ?
-            strdup (pos_realname) : NULL;
+        irc_nick_set_string (
+            &ptr_nick->realname,
+            (pos_realname && server->cap_extended_join) ?
+            pos_realname : NULL);
     }
 
     /* display output of who (manual who from user) */
@@ -4323,6 +4452,9 @@ IRC_PROTOCOL_CALLBACK(353)
     ptr_channel = irc_channel_search (server, pos_channel);
     str_nicks = NULL;
 
+    /* nicklist is sorted and refreshed on end of names (message 366) */
+    irc_channel_nicklist_batch (ptr_channel, 1);
+
     /*
      * for a channel without buffer, prepare a string that will be built
      * with nicks and colors (argc - args is the number of nicks)
@@ -4443,7 +4575,7 @@ IRC_PROTOCOL_CALLBACK(353)
 
 IRC_PROTOCOL_CALLBACK(354)
 {
-    char *pos_attr, *pos_hopcount, *pos_account, *pos_realname;
+    char *pos_attr, *pos_hopcount, *pos_account, *pos_realname, *str_host;
     int length;
     struct t_irc_channel *ptr_channel;
     struct t_irc_nick *ptr_nick;
@@ -4464,18 +4596,23 @@ IRC_PROTOCOL_CALLBACK(354)
     ptr_nick = (ptr_channel) ?
         irc_nick_search (server, ptr_channel, argv[7]) : NULL;
 
+    /*
+     * during automatic check of away, nicklist is sorted and refreshed on
+     * end of who (message 315)
+     */
+    if (ptr_channel && (ptr_channel->checking_whox > 0))
+        irc_channel_nicklist_batch (ptr_channel, 1);
+
     /* update host in nick */
     if (ptr_nick)
     {
-        if (ptr_nick->host)
-        {
-            free (ptr_nick->host);
-            ptr_nick->host = NULL;
-        }
         length = strlen (argv[4]) + 1 + strlen (argv[5]) + 1;
-        ptr_nick->host = malloc (length);
-        if (ptr_nick->host)
-            snprintf (ptr_nick->host, length, "%s@%s", argv[4], argv[5]);
+        str_host = malloc (length);
+        if (str_host)
+            snprintf (str_host, length, "%s@%s", argv[4], argv[5]);
+        irc_nick_set_string (&ptr_nick->host, str_host);
+        if (str_host)
+            free (str_host);
     }
 
     /* update away flag in nick */
@@ -4502,21 +4639,19 @@ IRC_PROTOCOL_CALLBACK(354)
     /* update account flag in nick */
     if (ptr_nick)
     {
-        if (ptr_nick->account)
-            free (ptr_nick->account);
-        ptr_nick->account = (ptr_channel && pos_account
-                             && server->cap_account_notify) ?
-            strdup (pos_account) : NULL;
+        irc_nick_set_string (
+            &ptr_nick->account,
+            (ptr_channel && pos_account && server->cap_account_notify) ?
+            pos_account : NULL);
     }
 
     /* update realname in nick */
     if (ptr_nick)
     {
-        if (ptr_nick->realname)
-            free (ptr_nick->realname);
-        ptr_nick->realname = (ptr_channel && pos_realname
-                              && server->cap_extended_join) ?
-            strdup (pos_realname) : NULL;
+        irc_nick_set_string (
+            &ptr_nick->realname,
+            (ptr_channel && pos_realname && server->cap_extended_join) ?
+            pos_realname : NULL);
     }
 
     /* display output of who (manual who from user) */
@@ -4575,6 +4710,7 @@ IRC_PROTOCOL_CALLBACK(366)
     IRC_PROTOCOL_MIN_ARGS(5);
 
     ptr_channel = irc_channel_search (server, argv[3]);
+    irc_channel_nicklist_batch (ptr_channel, 0);
     if (ptr_channel && ptr_channel->nicks)
     {
         /* display users on channel */
@@ -5612,42 +5748,48 @@ struct t_hashtable *
 irc_protocol_get_message_tags (const char *tags)
 {
     struct t_hashtable *hashtable;
-    char **items, *pos, *key;
-    int num_items, i;
+    const char *ptr_tags, *pos_end;
+    char *item, *pos;
+    int length;
 
     if (!tags || !tags[0])
         return NULL;
 
-    hashtable = weechat_hashtable_new (32,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       NULL, NULL);
+    hashtable = weechat_hashtable_new (0,
+                                      WEECHAT_HASHTABLE_STRING,
+                                      WEECHAT_HASHTABLE_STRING,
+                                      NULL, NULL);
     if (!hashtable)
         return NULL;
 
-    items = weechat_string_split (tags, ";", 0, 0, &num_items);
-    if (items)
+    ptr_tags = tags;
+    while (ptr_tags[0])
     {
-        for (i = 0; i < num_items; i++)
+        pos_end = strchr (ptr_tags, ';');
+        length = (pos_end) ? pos_end - ptr_tags : (int)strlen (ptr_tags);
+        if (length > 0)
         {
-            pos = strchr (items[i], '=');
-            if (pos)
+            item = weechat_strndup (ptr_tags, length);
+            if (item)
             {
-                /* format: "tag=value" */
-                key = weechat_strndup (items[i], pos - items[i]);
-                if (key)
+                pos = strchr (item, '=');
+                if (pos)
                 {
-                    weechat_hashtable_set (hashtable, key, pos + 1);
-                    free (key);
+                    /* format: "tag=value" */
+                    pos[0] = '\0';
+                    weechat_hashtable_set (hashtable, item, pos + 1);
                 }
-            }
-            else
-            {
-                /* format: "tag" */
-                weechat_hashtable_set (hashtable, items[i], NULL);
+                else
+                {
+                    /* format: "tag" */
+                    weechat_hashtable_set (hashtable, item, NULL);
+                }
+                free (item);
             }
         }
-        weechat_string_free_split (items);
+        if (!pos_end)
+            break;
+        ptr_tags = pos_end + 1;
     }
 
     return hashtable;
@@ -5703,6 +5845,275 @@ irc_protocol_get_message_tag_time (struct t_hashtable *tags)
     return time_value;
 }
 
+/*
+ * IRC messages received (commands and numerics) with their callbacks.
+ *
+ * The table is sorted by name on plugin init (see function
+ * irc_protocol_init), so that it can be searched with a binary search.
+ */
+
+struct t_irc_protocol_msg irc_protocol_messages[] =
+    { { "account", /* account (cap account-notify) */ 1, 0, &irc_protocol_cb_account },
+      { "authenticate", /* authenticate */ 1, 0, &irc_protocol_cb_authenticate },
+      { "away", /* away (cap away-notify) */ 1, 0, &irc_protocol_cb_away },
+      { "batch", /* batch (cap batch) */ 1, 0, &irc_protocol_cb_batch },
+      { "cap", /* client capability */ 1, 0, &irc_protocol_cb_cap },
+      { "error", /* error received from IRC server */ 1, 0, &irc_protocol_cb_error },
+      { "invite", /* invite a nick on a channel */ 1, 0, &irc_protocol_cb_invite },
+      { "join", /* join a channel */ 1, 0, &irc_protocol_cb_join },
+      { "kick", /* forcibly remove a user from a channel */ 1, 1, &irc_protocol_cb_kick },
+      { "kill", /* close client-server connection */ 1, 1, &irc_protocol_cb_kill },
+      { "mode", /* change channel or user mode */ 1, 0, &irc_protocol_cb_mode },
+      { "nick", /* change current nickname */ 1, 0, &irc_protocol_cb_nick },
+      { "notice", /* send notice message to user */ 1, 1, &irc_protocol_cb_notice },
+      { "part", /* leave a channel */ 1, 1, &irc_protocol_cb_part },
+      { "ping", /* ping server */ 1, 0, &irc_protocol_cb_ping },
+      { "pong", /* answer to a ping message */ 1, 0, &irc_protocol_cb_pong },
+      { "privmsg", /* message received */ 1, 1, &irc_protocol_cb_privmsg },
+      { "quit", /* close all connections and quit */ 1, 1, &irc_protocol_cb_quit },
+      { "topic", /* get/set channel topic */ 0, 1, &irc_protocol_cb_topic },
+      { "wallops", /* send a message to all currently connected users who have "
+                      "set the 'w' user mode "
+                      "for themselves */ 1, 1, &irc_protocol_cb_wallops },
+      { "001", /* a server message */ 1, 0, &irc_protocol_cb_001 },
+      { "005", /* a server message */ 1, 0, &irc_protocol_cb_005 },
+      { "008", /* server notice mask */ 1, 0, &irc_protocol_cb_008 },
+      { "221", /* user mode string */ 1, 0, &irc_protocol_cb_221 },
+      { "223", /* whois (charset is) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "264", /* whois (is using encrypted connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "275", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "276", /* whois (has client certificate fingerprint) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "301", /* away message */ 1, 1, &irc_protocol_cb_301 },
+      { "303", /* ison */ 1, 0, &irc_protocol_cb_303 },
+      { "305", /* unaway */ 1, 0, &irc_protocol_cb_305 },
+      { "306", /* now away */ 1, 0, &irc_protocol_cb_306 },
+      { "307", /* whois (registered nick) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "310", /* whois (help mode) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "311", /* whois (user) */ 1, 0, &irc_protocol_cb_311 },
+      { "312", /* whois (server) */ 1, 0, &irc_protocol_cb_312 },
+      { "313", /* whois (operator) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "314", /* whowas */ 1, 0, &irc_protocol_cb_314 },
+      { "315", /* end of /who list */ 1, 0, &irc_protocol_cb_315 },
+      { "317", /* whois (idle) */ 1, 0, &irc_protocol_cb_317 },
+      { "318", /* whois (end) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "319", /* whois (channels) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "320", /* whois (identified user) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "321", /* /list start */ 1, 0, &irc_protocol_cb_321 },
+      { "322", /* channel (for /list) */ 1, 0, &irc_protocol_cb_322 },
+      { "323", /* end of /list */ 1, 0, &irc_protocol_cb_323 },
+      { "324", /* channel mode */ 1, 0, &irc_protocol_cb_324 },
+      { "326", /* whois (has oper privs) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "327", /* whois (host) */ 1, 0, &irc_protocol_cb_327 },
+      { "328", /* channel url */ 1, 0, &irc_protocol_cb_328 },
+      { "329", /* channel creation date */ 1, 0, &irc_protocol_cb_329 },
+      { "330", /* is logged in as */ 1, 0, &irc_protocol_cb_330_343 },
+      { "331", /* no topic for channel */ 1, 0, &irc_protocol_cb_331 },
+      { "332", /* topic of channel */ 0, 1, &irc_protocol_cb_332 },
+      { "333", /* infos about topic (nick and date changed) */ 1, 0, &irc_protocol_cb_333 },
+      { "335", /* is a bot on */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "338", /* whois (host) */ 1, 0, &irc_protocol_cb_338 },
+      { "341", /* inviting */ 1, 0, &irc_protocol_cb_341 },
+      { "343", /* is opered as */ 1, 0, &irc_protocol_cb_330_343 },
+      { "344", /* channel reop */ 1, 0, &irc_protocol_cb_344 },
+      { "345", /* end of channel reop list */ 1, 0, &irc_protocol_cb_345 },
+      { "346", /* invite list */ 1, 0, &irc_protocol_cb_346 },
+      { "347", /* end of invite list */ 1, 0, &irc_protocol_cb_347 },
+      { "348", /* channel exception list */ 1, 0, &irc_protocol_cb_348 },
+      { "349", /* end of channel exception list */ 1, 0, &irc_protocol_cb_349 },
+      { "351", /* server version */ 1, 0, &irc_protocol_cb_351 },
+      { "352", /* who */ 1, 0, &irc_protocol_cb_352 },
+      { "353", /* list of nicks on channel */ 1, 0, &irc_protocol_cb_353 },
+      { "354", /* whox */ 1, 0, &irc_protocol_cb_354 },
+      { "366", /* end of /names list */ 1, 0, &irc_protocol_cb_366 },
+      { "367", /* banlist */ 1, 0, &irc_protocol_cb_367 },
+      { "368", /* end of banlist */ 1, 0, &irc_protocol_cb_368 },
+      { "369", /* whowas (end) */ 1, 0, &irc_protocol_cb_whowas_nick_msg },
+      { "378", /* whois (connecting from) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "379", /* whois (using modes) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "401", /* no such nick/channel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "402", /* no such server */ 1, 0, &irc_protocol_cb_generic_error },
+      { "403", /* no such channel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "404", /* cannot send to channel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "405", /* too many channels */ 1, 0, &irc_protocol_cb_generic_error },
+      { "406", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
+      { "407", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
+      { "409", /* no origin */ 1, 0, &irc_protocol_cb_generic_error },
+      { "410", /* no services */ 1, 0, &irc_protocol_cb_generic_error },
+      { "411", /* no recipient */ 1, 0, &irc_protocol_cb_generic_error },
+      { "412", /* no text to send */ 1, 0, &irc_protocol_cb_generic_error },
+      { "413", /* no toplevel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "414", /* wilcard in toplevel domain */ 1, 0, &irc_protocol_cb_generic_error },
+      { "421", /* unknown command */ 1, 0, &irc_protocol_cb_generic_error },
+      { "422", /* MOTD is missing */ 1, 0, &irc_protocol_cb_generic_error },
+      { "423", /* no administrative info */ 1, 0, &irc_protocol_cb_generic_error },
+      { "424", /* file error */ 1, 0, &irc_protocol_cb_generic_error },
+      { "431", /* no nickname given */ 1, 0, &irc_protocol_cb_generic_error },
+      { "432", /* erroneous nickname */ 1, 0, &irc_protocol_cb_432 },
+      { "433", /* nickname already in use */ 1, 0, &irc_protocol_cb_433 },
+      { "436", /* nickname collision */ 1, 0, &irc_protocol_cb_generic_error },
+      { "437", /* nick/channel unavailable */ 1, 0, &irc_protocol_cb_437 },
+      { "438", /* not authorized to change nickname */ 1, 0, &irc_protocol_cb_438 },
+      { "441", /* user not in channel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "442", /* not on channel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "443", /* user already on channel */ 1, 0, &irc_protocol_cb_generic_error },
+      { "444", /* user not logged in */ 1, 0, &irc_protocol_cb_generic_error },
+      { "445", /* summon has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
+      { "446", /* users has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
+      { "451", /* you are not registered */ 1, 0, &irc_protocol_cb_generic_error },
+      { "461", /* not enough parameters */ 1, 0, &irc_protocol_cb_generic_error },
+      { "462", /* you may not register */ 1, 0, &irc_protocol_cb_generic_error },
+      { "463", /* your host isn't among the privileged */ 1, 0, &irc_protocol_cb_generic_error },
+      { "464", /* password incorrect */ 1, 0, &irc_protocol_cb_generic_error },
+      { "465", /* you are banned from this server */ 1, 0, &irc_protocol_cb_generic_error },
+      { "467", /* channel key already set */ 1, 0, &irc_protocol_cb_generic_error },
+      { "470", /* forwarding to another channel */ 1, 0, &irc_protocol_cb_470 },
+      { "471", /* channel is already full */ 1, 0, &irc_protocol_cb_generic_error },
+      { "472", /* unknown mode char to me */ 1, 0, &irc_protocol_cb_generic_error },
+      { "473", /* cannot join channel (invite only) */ 1, 0, &irc_protocol_cb_generic_error },
+      { "474", /* cannot join channel (banned from channel) */ 1, 0, &irc_protocol_cb_generic_error },
+      { "475", /* cannot join channel (bad channel key) */ 1, 0, &irc_protocol_cb_generic_error },
+      { "476", /* bad channel mask */ 1, 0, &irc_protocol_cb_generic_error },
+      { "477", /* channel doesn't support modes */ 1, 0, &irc_protocol_cb_generic_error },
+      { "481", /* you're not an IRC operator */ 1, 0, &irc_protocol_cb_generic_error },
+      { "482", /* you're not channel operator */ 1, 0, &irc_protocol_cb_generic_error },
+      { "483", /* you can't kill a server! */ 1, 0, &irc_protocol_cb_generic_error },
+      { "484", /* your connection is restricted! */ 1, 0, &irc_protocol_cb_generic_error },
+      { "485", /* user is immune from kick/deop */ 1, 0, &irc_protocol_cb_generic_error },
+      { "487", /* network split */ 1, 0, &irc_protocol_cb_generic_error },
+      { "491", /* no O-lines for your host */ 1, 0, &irc_protocol_cb_generic_error },
+      { "501", /* unknown mode flag */ 1, 0, &irc_protocol_cb_generic_error },
+      { "502", /* can't change mode for other users */ 1, 0, &irc_protocol_cb_generic_error },
+      { "671", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
+      { "728", /* quietlist */ 1, 0, &irc_protocol_cb_728 },
+      { "729", /* end of quietlist */ 1, 0, &irc_protocol_cb_729 },
+      { "730", /* monitored nicks online */ 1, 0, &irc_protocol_cb_730 },
+      { "731", /* monitored nicks offline */ 1, 0, &irc_protocol_cb_731 },
+      { "732", /* list of monitored nicks */ 1, 0, &irc_protocol_cb_732 },
+      { "733", /* end of monitor list */ 1, 0, &irc_protocol_cb_733 },
+      { "734", /* monitor list is full */ 1, 0, &irc_protocol_cb_734 },
+      { "900", /* logged in as (SASL) */ 1, 0, &irc_protocol_cb_900 },
+      { "901", /* you are now logged in */ 1, 0, &irc_protocol_cb_901 },
+      { "902", /* SASL authentication failed (account locked/held) */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+      { "903", /* SASL authentication successful */ 1, 0, &irc_protocol_cb_sasl_end_ok },
+      { "904", /* SASL authentication failed */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+      { "905", /* SASL message too long */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+      { "906", /* SASL authentication aborted */ 1, 0, &irc_protocol_cb_sasl_end_fail },
+      { "907", /* You have already completed SASL authentication */ 1, 0, &irc_protocol_cb_sasl_end_ok },
+      { "936", /* censored word */ 1, 0, &irc_protocol_cb_generic_error },
+      { "973", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
+      { "974", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
+      { "975", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
+      { NULL, 0, 0, NULL }
+    };
+
+/* index of numeric commands ("000" to "999") in table above */
+struct t_irc_protocol_msg *irc_protocol_messages_numeric[IRC_PROTOCOL_NUMERIC_MAX];
+int irc_protocol_messages_count = 0;   /* number of messages in table       */
+
+
+/*
+ * Compares two IRC messages (for sort of table with IRC messages).
+ */
+
+int
+irc_protocol_messages_cmp_cb (const void *message1, const void *message2)
+{
+    return weechat_strcasecmp (
+        ((struct t_irc_protocol_msg *)message1)->name,
+        ((struct t_irc_protocol_msg *)message2)->name);
+}
+
+/*
+ * Compares a command with an IRC message (for binary search in table with
+ * IRC messages).
+ */
+
+int
+irc_protocol_messages_search_cb (const void *command, const void *message)
+{
+    return weechat_strcasecmp ((const char *)command,
+                               ((struct t_irc_protocol_msg *)message)->name);
+}
+
+/*
+ * Returns index of a numeric command with 3 digits ("000" to "999"), -1 if
+ * command is not numeric or does not have 3 digits.
+ */
+
+int
+irc_protocol_get_numeric_index (const char *command)
+{
+    if (!command
+        || !isdigit ((unsigned char)command[0])
+        || !isdigit ((unsigned char)command[1])
+        || !isdigit ((unsigned char)command[2])
+        || command[3])
+    {
+        return -1;
+    }
+
+    return ((command[0] - '0') * 100) + ((command[1] - '0') * 10)
+        + (command[2] - '0');
+}
+
+/*
+ * Searches for an IRC message received.
+ *
+ * Returns pointer to IRC message found, NULL if not found.
+ */
+
+struct t_irc_protocol_msg *
+irc_protocol_search_message (const char *command)
+{
+    int index;
+
+    if (!command)
+        return NULL;
+
+    /* numeric command: direct access */
+    index = irc_protocol_get_numeric_index (command);
+    if (index >= 0)
+        return irc_protocol_messages_numeric[index];
+
+    return bsearch (command, irc_protocol_messages,
+                    irc_protocol_messages_count,
+                    sizeof (irc_protocol_messages[0]),
+                    &irc_protocol_messages_search_cb);
+}
+
+/*
+ * Initializes the table with IRC messages received: sorts the messages by
+ * name and builds index of numeric commands.
+ */
+
+void
+irc_protocol_init ()
+{
+    int i, index;
+
+    for (i = 0; i < IRC_PROTOCOL_NUMERIC_MAX; i++)
+    {
+        irc_protocol_messages_numeric[i] = NULL;
+    }
+
+    irc_protocol_messages_count = 0;
+    while (irc_protocol_messages[irc_protocol_messages_count].name)
+    {
+        irc_protocol_messages_count++;
+    }
+
+    qsort (irc_protocol_messages, irc_protocol_messages_count,
+           sizeof (irc_protocol_messages[0]),
+           &irc_protocol_messages_cmp_cb);
+
+    for (i = 0; i < irc_protocol_messages_count; i++)
+    {
+        index = irc_protocol_get_numeric_index (irc_protocol_messages[i].name);
+        if (index >= 0)
+            irc_protocol_messages_numeric[index] = &irc_protocol_messages[i];
+    }
+}
+
 /*
  * Executes action when an IRC message is received.
  *
@@ -5716,8 +6127,9 @@ irc_protocol_recv_command (struct t_irc_server *server,
                            const char *msg_command,
                            const char *msg_channel)
 {
-    int i, cmd_found, return_code, argc, decode_color, keep_trailing_spaces;
+    int return_code, argc, decode_color, keep_trailing_spaces;
     int message_ignored;
+    struct t_irc_protocol_msg *ptr_message;
     char *dup_irc_message, *pos_space;
     struct t_irc_channel *ptr_channel;
     t_irc_recv_func *cmd_recv_func;
@@ -5727,158 +6139,6 @@ irc_protocol_recv_command (struct t_irc_server *server,
     char *nick, *address, *address_color, *host, *host_no_color, *host_color;
     char **argv, **argv_eol;
     struct t_hashtable *hash_tags;
-    struct t_irc_protocol_msg irc_protocol_messages[] =
-        { { "account", /* account (cap account-notify) */ 1, 0, &irc_protocol_cb_account },
-          { "authenticate", /* authenticate */ 1, 0, &irc_protocol_cb_authenticate },
-          { "away", /* away (cap away-notify) */ 1, 0, &irc_protocol_cb_away },
-          { "cap", /* client capability */ 1, 0, &irc_protocol_cb_cap },
-          { "error", /* error received from IRC server */ 1, 0, &irc_protocol_cb_error },
-          { "invite", /* invite a nick on a channel */ 1, 0, &irc_protocol_cb_invite },
-          { "join", /* join a channel */ 1, 0, &irc_protocol_cb_join },
-          { "kick", /* forcibly remove a user from a channel */ 1, 1, &irc_protocol_cb_kick },
-          { "kill", /* close client-server connection */ 1, 1, &irc_protocol_cb_kill },
-          { "mode", /* change channel or user mode */ 1, 0, &irc_protocol_cb_mode },
-          { "nick", /* change current nickname */ 1, 0, &irc_protocol_cb_nick },
-          { "notice", /* send notice message to user */ 1, 1, &irc_protocol_cb_notice },
-          { "part", /* leave a channel */ 1, 1, &irc_protocol_cb_part },
-          { "ping", /* ping server */ 1, 0, &irc_protocol_cb_ping },
-          { "pong", /* answer to a ping message */ 1, 0, &irc_protocol_cb_pong },
-          { "privmsg", /* message received */ 1, 1, &irc_protocol_cb_privmsg },
-          { "quit", /* close all connections and quit */ 1, 1, &irc_protocol_cb_quit },
-          { "topic", /* get/set channel topic */ 0, 1, &irc_protocol_cb_topic },
-          { "wallops", /* send a message to all currently connected users who have "
-                          "set the 'w' user mode "
-                          "for themselves */ 1, 1, &irc_protocol_cb_wallops },
-          { "001", /* a server message */ 1, 0, &irc_protocol_cb_001 },
-          { "005", /* a server message */ 1, 0, &irc_protocol_cb_005 },
-          { "008", /* server notice mask */ 1, 0, &irc_protocol_cb_008 },
-          { "221", /* user mode string */ 1, 0, &irc_protocol_cb_221 },
-          { "223", /* whois (charset is) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "264", /* whois (is using encrypted connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "275", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "276", /* whois (has client certificate fingerprint) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "301", /* away message */ 1, 1, &irc_protocol_cb_301 },
-          { "303", /* ison */ 1, 0, &irc_protocol_cb_303 },
-          { "305", /* unaway */ 1, 0, &irc_protocol_cb_305 },
-          { "306", /* now away */ 1, 0, &irc_protocol_cb_306 },
-          { "307", /* whois (registered nick) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "310", /* whois (help mode) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "311", /* whois (user) */ 1, 0, &irc_protocol_cb_311 },
-          { "312", /* whois (server) */ 1, 0, &irc_protocol_cb_312 },
-          { "313", /* whois (operator) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "314", /* whowas */ 1, 0, &irc_protocol_cb_314 },
-          { "315", /* end of /who list */ 1, 0, &irc_protocol_cb_315 },
-          { "317", /* whois (idle) */ 1, 0, &irc_protocol_cb_317 },
-          { "318", /* whois (end) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "319", /* whois (channels) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "320", /* whois (identified user) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "321", /* /list start */ 1, 0, &irc_protocol_cb_321 },
-          { "322", /* channel (for /list) */ 1, 0, &irc_protocol_cb_322 },
-          { "323", /* end of /list */ 1, 0, &irc_protocol_cb_323 },
-          { "324", /* channel mode */ 1, 0, &irc_protocol_cb_324 },
-          { "326", /* whois (has oper privs) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "327", /* whois (host) */ 1, 0, &irc_protocol_cb_327 },
-          { "328", /* channel url */ 1, 0, &irc_protocol_cb_328 },
-          { "329", /* channel creation date */ 1, 0, &irc_protocol_cb_329 },
-          { "330", /* is logged in as */ 1, 0, &irc_protocol_cb_330_343 },
-          { "331", /* no topic for channel */ 1, 0, &irc_protocol_cb_331 },
-          { "332", /* topic of channel */ 0, 1, &irc_protocol_cb_332 },
-          { "333", /* infos about topic (nick and date changed) */ 1, 0, &irc_protocol_cb_333 },
-          { "335", /* is a bot on */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "338", /* whois (host) */ 1, 0, &irc_protocol_cb_338 },
-          { "341", /* inviting */ 1, 0, &irc_protocol_cb_341 },
-          { "343", /* is opered as */ 1, 0, &irc_protocol_cb_330_343 },
-          { "344", /* channel reop */ 1, 0, &irc_protocol_cb_344 },
-          { "345", /* end of channel reop list */ 1, 0, &irc_protocol_cb_345 },
-          { "346", /* invite list */ 1, 0, &irc_protocol_cb_346 },
-          { "347", /* end of invite list */ 1, 0, &irc_protocol_cb_347 },
-          { "348", /* channel exception list */ 1, 0, &irc_protocol_cb_348 },
-          { "349", /* end of channel exception list */ 1, 0, &irc_protocol_cb_349 },
-          { "351", /* server version */ 1, 0, &irc_protocol_cb_351 },
-          { "352", /* who */ 1, 0, &irc_protocol_cb_352 },
-          { "353", /* list of nicks on channel */ 1, 0, &irc_protocol_cb_353 },
-          { "354", /* whox */ 1, 0, &irc_protocol_cb_354 },
-          { "366", /* end of /names list */ 1, 0, &irc_protocol_cb_366 },
-          { "367", /* banlist */ 1, 0, &irc_protocol_cb_367 },
-          { "368", /* end of banlist */ 1, 0, &irc_protocol_cb_368 },
-          { "369", /* whowas (end) */ 1, 0, &irc_protocol_cb_whowas_nick_msg },
-          { "378", /* whois (connecting from) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "379", /* whois (using modes) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "401", /* no such nick/channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "402", /* no such server */ 1, 0, &irc_protocol_cb_generic_error },
-          { "403", /* no such channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "404", /* cannot send to channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "405", /* too many channels */ 1, 0, &irc_protocol_cb_generic_error },
-          { "406", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
-          { "407", /* was no such nick */ 1, 0, &irc_protocol_cb_generic_error },
-          { "409", /* no origin */ 1, 0, &irc_protocol_cb_generic_error },
-          { "410", /* no services */ 1, 0, &irc_protocol_cb_generic_error },
-          { "411", /* no recipient */ 1, 0, &irc_protocol_cb_generic_error },
-          { "412", /* no text to send */ 1, 0, &irc_protocol_cb_generic_error },
-          { "413", /* no toplevel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "414", /* wilcard in toplevel domain */ 1, 0, &irc_protocol_cb_generic_error },
-          { "421", /* unknown command */ 1, 0, &irc_protocol_cb_generic_error },
-          { "422", /* MOTD is missing */ 1, 0, &irc_protocol_cb_generic_error },
-          { "423", /* no administrative info */ 1, 0, &irc_protocol_cb_generic_error },
-          { "424", /* file error */ 1, 0, &irc_protocol_cb_generic_error },
-          { "431", /* no nickname given */ 1, 0, &irc_protocol_cb_generic_error },
-          { "432", /* erroneous nickname */ 1, 0, &irc_protocol_cb_432 },
-          { "433", /* nickname already in use */ 1, 0, &irc_protocol_cb_433 },
-          { "436", /* nickname collision */ 1, 0, &irc_protocol_cb_generic_error },
-          { "437", /* nick/channel unavailable */ 1, 0, &irc_protocol_cb_437 },
-          { "438", /* not authorized to change nickname */ 1, 0, &irc_protocol_cb_438 },
-          { "441", /* user not in channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "442", /* not on channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "443", /* user already on channel */ 1, 0, &irc_protocol_cb_generic_error },
-          { "444", /* user not logged in */ 1, 0, &irc_protocol_cb_generic_error },
-          { "445", /* summon has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
-          { "446", /* users has been disabled */ 1, 0, &irc_protocol_cb_generic_error },
-          { "451", /* you are not registered */ 1, 0, &irc_protocol_cb_generic_error },
-          { "461", /* not enough parameters */ 1, 0, &irc_protocol_cb_generic_error },
-          { "462", /* you may not register */ 1, 0, &irc_protocol_cb_generic_error },
-          { "463", /* your host isn't among the privileged */ 1, 0, &irc_protocol_cb_generic_error },
-          { "464", /* password incorrect */ 1, 0, &irc_protocol_cb_generic_error },
-          { "465", /* you are banned from this server */ 1, 0, &irc_protocol_cb_generic_error },
-          { "467", /* channel key already set */ 1, 0, &irc_protocol_cb_generic_error },
-          { "470", /* forwarding to another channel */ 1, 0, &irc_protocol_cb_470 },
-          { "471", /* channel is already full */ 1, 0, &irc_protocol_cb_generic_error },
-          { "472", /* unknown mode char to me */ 1, 0, &irc_protocol_cb_generic_error },
-          { "473", /* cannot join channel (invite only) */ 1, 0, &irc_protocol_cb_generic_error },
-          { "474", /* cannot join channel (banned from channel) */ 1, 0, &irc_protocol_cb_generic_error },
-          { "475", /* cannot join channel (bad channel key) */ 1, 0, &irc_protocol_cb_generic_error },
-          { "476", /* bad channel mask */ 1, 0, &irc_protocol_cb_generic_error },
-          { "477", /* channel doesn't support modes */ 1, 0, &irc_protocol_cb_generic_error },
-          { "481", /* you're not an IRC operator */ 1, 0, &irc_protocol_cb_generic_error },
-          { "482", /* you're not channel operator */ 1, 0, &irc_protocol_cb_generic_error },
-          { "483", /* you can't kill a server! */ 1, 0, &irc_protocol_cb_generic_error },
-          { "484", /* your connection is restricted! */ 1, 0, &irc_protocol_cb_generic_error },
-          { "485", /* user is immune from kick/deop */ 1, 0, &irc_protocol_cb_generic_error },
-          { "487", /* network split */ 1, 0, &irc_protocol_cb_generic_error },
-          { "491", /* no O-lines for your host */ 1, 0, &irc_protocol_cb_generic_error },
-          { "501", /* unknown mode flag */ 1, 0, &irc_protocol_cb_generic_error },
-          { "502", /* can't change mode for other users */ 1, 0, &irc_protocol_cb_generic_error },
-          { "671", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_whois_nick_msg },
-          { "728", /* quietlist */ 1, 0, &irc_protocol_cb_728 },
-          { "729", /* end of quietlist */ 1, 0, &irc_protocol_cb_729 },
-          { "730", /* monitored nicks online */ 1, 0, &irc_protocol_cb_730 },
-          { "731", /* monitored nicks offline */ 1, 0, &irc_protocol_cb_731 },
-          { "732", /* list of monitored nicks */ 1, 0, &irc_protocol_cb_732 },
-          { "733", /* end of monitor list */ 1, 0, &irc_protocol_cb_733 },
-          { "734", /* monitor list is full */ 1, 0, &irc_protocol_cb_734 },
-          { "900", /* logged in as (SASL) */ 1, 0, &irc_protocol_cb_900 },
-          { "901", /* you are now logged in */ 1, 0, &irc_protocol_cb_901 },
-          { "902", /* SASL authentication failed (account locked/held) */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "903", /* SASL authentication successful */ 1, 0, &irc_protocol_cb_sasl_end_ok },
-          { "904", /* SASL authentication failed */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "905", /* SASL message too long */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "906", /* SASL authentication aborted */ 1, 0, &irc_protocol_cb_sasl_end_fail },
-          { "907", /* You have already completed SASL authentication */ 1, 0, &irc_protocol_cb_sasl_end_ok },
-          { "936", /* censored word */ 1, 0, &irc_protocol_cb_generic_error },
-          { "973", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
-          { "974", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
-          { "975", /* whois (secure connection) */ 1, 0, &irc_protocol_cb_server_mode_reason },
-          { NULL, 0, 0, NULL }
-        };
 
     if (!msg_command)
         return;
@@ -5897,6 +6157,15 @@ irc_protocol_recv_command (struct t_irc_server *server,
             date = irc_protocol_get_message_tag_time (hash_tags);
     }
 
+    /* message in a batch: it will be processed at the end of batch */
+    if (hash_tags
+        && irc_batch_add_message (server, hash_tags, msg_tags, msg_command,
+                                  msg_channel, irc_message))
+    {
+        weechat_hashtable_free (hash_tags);
+        return;
+    }
+
     /* get nick/host/address from IRC message */
     nick1 = NULL;
     address1 = NULL;
@@ -5909,11 +6178,12 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
     nick = (nick1) ? strdup (nick1) : NULL;
     address = (address1) ? strdup (address1) : NULL;
-    address_color = (address) ?
+    /* decode colors only if needed (otherwise use same pointer) */
+    address_color = (irc_color_search_code (address)) ?
         irc_color_decode (
             address,
             weechat_config_boolean (irc_config_network_colors_receive)) :
-        NULL;
+        address;
     host = (host1) ? strdup (host1) : NULL;
     if (host)
     {
@@ -5921,12 +6191,18 @@ irc_protocol_recv_command (struct t_irc_server *server,
         if (pos_space)
             pos_space[0] = '\0';
     }
-    host_no_color = (host) ? irc_color_decode (host, 0) : NULL;
-    host_color = (host) ?
-        irc_color_decode (
+    if (irc_color_search_code (host))
+    {
+        host_no_color = irc_color_decode (host, 0);
+        host_color = irc_color_decode (
             host,
-            weechat_config_boolean (irc_config_network_colors_receive)) :
-        NULL;
+            weechat_config_boolean (irc_config_network_colors_receive));
+    }
+    else
+    {
+        host_no_color = host;
+        host_color = host;
+    }
 
     /* check if message is ignored or not */
     ptr_channel = NULL;
@@ -5949,19 +6225,10 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
 
     /* look for IRC command */
-    cmd_found = -1;
-    for (i = 0; irc_protocol_messages[i].name; i++)
-    {
-        if (weechat_strcasecmp (irc_protocol_messages[i].name,
-                                msg_command) == 0)
-        {
-            cmd_found = i;
-            break;
-        }
-    }
+    ptr_message = irc_protocol_search_message (msg_command);
 
     /* command not found */
-    if (cmd_found < 0)
+    if (!ptr_message)
     {
         /* for numeric commands, we use default recv function */
         if (irc_protocol_is_numeric_command (msg_command))
@@ -5985,10 +6252,10 @@ irc_protocol_recv_command (struct t_irc_server *server,
     }
     else
     {
-        cmd_name = irc_protocol_messages[cmd_found].name;
-        decode_color = irc_protocol_messages[cmd_found].decode_color;
-        keep_trailing_spaces = irc_protocol_messages[cmd_found].keep_trailing_spaces;
-        cmd_recv_func = irc_protocol_messages[cmd_found].recv_function;
+        cmd_name = ptr_message->name;
+        decode_color = ptr_message->decode_color;
+        keep_trailing_spaces = ptr_message->keep_trailing_spaces;
+        cmd_recv_func = ptr_message->recv_function;
     }
 
     if (cmd_recv_func != NULL)
@@ -6008,9 +6275,9 @@ irc_protocol_recv_command (struct t_irc_server *server,
         }
         else
             dup_irc_message = NULL;
-        argv = weechat_string_split (dup_irc_message, " ", 0, 0, &argc);
-        argv_eol = weechat_string_split (dup_irc_message, " ",
-                                         1 + keep_trailing_spaces, 0, NULL);
+        argv = weechat_string_split_argv (dup_irc_message, " ",
+                                          1 + keep_trailing_spaces, 0,
+                                          &argc, &argv_eol);
 
         return_code = (int) (cmd_recv_func) (server,
                                              date, nick, address_color,
@@ -6045,22 +6312,20 @@ irc_protocol_recv_command (struct t_irc_server *server,
 end:
     if (nick)
         free (nick);
+    if (address_color && (address_color != address))
+        free (address_color);
     if (address)
         free (address);
-    if (address_color)
-        free (address_color);
-    if (host)
-        free (host);
-    if (host_no_color)
+    if (host_no_color && (host_no_color != host))
         free (host_no_color);
-    if (host_color)
+    if (host_color && (host_color != host))
         free (host_color);
+    if (host)
+        free (host);
     if (dup_irc_message)
         free (dup_irc_message);
     if (argv)
-        weechat_string_free_split (argv);
-    if (argv_eol)
-        weechat_string_free_split (argv_eol);
+        weechat_string_free_split_argv (argv);
     if (hash_tags)
         weechat_hashtable_free (hash_tags);
 }
@@ -22,6 +22,8 @@
 
 #include <time.h>
 
+#define IRC_PROTOCOL_NUMERIC_MAX 1000
+
 #define IRC_PROTOCOL_CALLBACK(__command)                                \
     int                                                                 \
     irc_protocol_cb_##__command (struct t_irc_server *server,           \
@@ -83,8 +85,13 @@ struct t_irc_protocol_msg
     t_irc_recv_func *recv_function; /* function called when msg is received  */
 };
 
+extern struct t_irc_protocol_msg irc_protocol_messages[];
+
 extern const char *irc_protocol_tags (const char *command, const char *tags,
                                       const char *nick, const char *address);
+extern struct t_irc_protocol_msg *irc_protocol_search_message (const char *command);
+extern int irc_protocol_is_netsplit (const char *reason);
+extern void irc_protocol_init ();
 extern void irc_protocol_recv_command (struct t_irc_server *server,
                                        const char *irc_message,
                                        const char *msg_tags,
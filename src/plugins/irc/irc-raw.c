@@ -35,9 +35,18 @@
 
 struct t_gui_buffer *irc_raw_buffer = NULL;
 
-int irc_raw_messages_count = 0;
-struct t_irc_raw_message *irc_raw_messages = NULL;
-struct t_irc_raw_message *last_irc_raw_message = NULL;
+char *irc_raw_ring = NULL;              /* ring with raw messages            */
+int irc_raw_ring_size = 0;             /* size of ring (in bytes)           */
+int irc_raw_ring_first = 0;            /* offset of oldest message          */
+int irc_raw_ring_last = 0;             /* offset of newest message          */
+int irc_raw_ring_end = 0;              /* offset after newest message       */
+int irc_raw_ring_wrap = -1;            /* end of data at end of ring when   */
+                                       /* data continues at beginning of    */
+                                       /* ring (-1 if data is contiguous)   */
+int irc_raw_messages_count = 0;        /* number of messages in ring        */
+
+char *irc_raw_escape_buf = NULL;       /* buffer used to escape messages    */
+int irc_raw_escape_buf_size = 0;       /* size of escape buffer             */
 
 
 /*
@@ -45,18 +54,51 @@ struct t_irc_raw_message *last_irc_raw_message = NULL;
  */
 
 void
-irc_raw_message_print (struct t_irc_raw_message *raw_message)
+irc_raw_message_print (time_t date, const char *prefix, const char *message)
 {
-    if (irc_raw_buffer && raw_message)
+    if (irc_raw_buffer)
     {
-        weechat_printf_date_tags (irc_raw_buffer,
-                                  raw_message->date, NULL,
-                                  "%s\t%s",
-                                  raw_message->prefix,
-                                  raw_message->message);
+        weechat_printf_date_tags (irc_raw_buffer, date, NULL,
+                                  "%s\t%s", prefix, message);
     }
 }
 
+/*
+ * Returns the oldest raw message in ring, NULL if ring is empty.
+ */
+
+struct t_irc_raw_message *
+irc_raw_message_get_first ()
+{
+    if (!irc_raw_ring || (irc_raw_messages_count == 0))
+        return NULL;
+
+    return (struct t_irc_raw_message *)(irc_raw_ring + irc_raw_ring_first);
+}
+
+/*
+ * Returns the raw message after this one in ring, NULL if it is the newest.
+ */
+
+struct t_irc_raw_message *
+irc_raw_message_get_next (struct t_irc_raw_message *raw_message)
+{
+    int offset;
+
+    if (!raw_message || !irc_raw_ring)
+        return NULL;
+
+    offset = (char *)raw_message - irc_raw_ring;
+    if (offset == irc_raw_ring_last)
+        return NULL;
+
+    offset += raw_message->size;
+    if ((irc_raw_ring_wrap >= 0) && (offset >= irc_raw_ring_wrap))
+        offset = 0;
+
+    return (struct t_irc_raw_message *)(irc_raw_ring + offset);
+}
+
 /*
  * Opens IRC raw buffer.
  */
@@ -97,11 +139,15 @@ irc_raw_open (int switch_to_buffer)
             /* disable all highlights on this buffer */
             weechat_buffer_set (irc_raw_buffer, "highlight_words", "-");
 
-            /* print messages in list */
-            for (ptr_raw_message = irc_raw_messages; ptr_raw_message;
-                 ptr_raw_message = ptr_raw_message->next_message)
+            /* print messages saved in ring */
+            for (ptr_raw_message = irc_raw_message_get_first ();
+                 ptr_raw_message;
+                 ptr_raw_message = irc_raw_message_get_next (ptr_raw_message))
             {
-                irc_raw_message_print (ptr_raw_message);
+                irc_raw_message_print (
+                    ptr_raw_message->date,
+                    IRC_RAW_MESSAGE_PREFIX(ptr_raw_message),
+                    IRC_RAW_MESSAGE_MESSAGE(ptr_raw_message));
             }
         }
     }
@@ -111,72 +157,77 @@ irc_raw_open (int switch_to_buffer)
 }
 
 /*
- * Frees a raw message and removes it from list.
+ * Removes the oldest raw message from ring.
  */
 
 void
-irc_raw_message_free (struct t_irc_raw_message *raw_message)
+irc_raw_ring_remove_first ()
 {
-    struct t_irc_raw_message *new_raw_messages;
-
-    /* remove message from raw messages list */
-    if (last_irc_raw_message == raw_message)
-        last_irc_raw_message = raw_message->prev_message;
-    if (raw_message->prev_message)
-    {
-        (raw_message->prev_message)->next_message = raw_message->next_message;
-        new_raw_messages = irc_raw_messages;
-    }
-    else
-        new_raw_messages = raw_message->next_message;
-
-    if (raw_message->next_message)
-        (raw_message->next_message)->prev_message = raw_message->prev_message;
-
-    /* free data */
-    if (raw_message->prefix)
-        free (raw_message->prefix);
-    if (raw_message->message)
-        free (raw_message->message);
-
-    free (raw_message);
+    struct t_irc_raw_message *ptr_raw_message;
 
-    irc_raw_messages = new_raw_messages;
+    if (irc_raw_messages_count == 0)
+        return;
 
     irc_raw_messages_count--;
-}
-
-/*
- * Frees all raw messages.
- */
+    if (irc_raw_messages_count == 0)
+    {
+        irc_raw_ring_first = 0;
+        irc_raw_ring_last = 0;
+        irc_raw_ring_end = 0;
+        irc_raw_ring_wrap = -1;
+        return;
+    }
 
-void
-irc_raw_message_free_all ()
-{
-    while (irc_raw_messages)
+    ptr_raw_message = (struct t_irc_raw_message *)(irc_raw_ring
+                                                   + irc_raw_ring_first);
+    irc_raw_ring_first += ptr_raw_message->size;
+    if ((irc_raw_ring_wrap >= 0) && (irc_raw_ring_first >= irc_raw_ring_wrap))
     {
-        irc_raw_message_free (irc_raw_messages);
+        /* all remaining messages are at beginning of ring */
+        irc_raw_ring_first = 0;
+        irc_raw_ring_wrap = -1;
     }
 }
 
 /*
- * Removes old raw messages if limit has been reached.
+ * Reserves space for a message in ring, removing oldest messages if needed.
+ *
+ * Returns offset of space reserved in ring, -1 if the message is too big for
+ * the ring.
  */
 
-void
-irc_raw_message_remove_old ()
+int
+irc_raw_ring_reserve (int size)
 {
-    int max_messages;
+    if (size > irc_raw_ring_size)
+        return -1;
 
-    max_messages = weechat_config_integer (irc_config_look_raw_messages);
-    while (irc_raw_messages && (irc_raw_messages_count >= max_messages))
+    while (1)
     {
-        irc_raw_message_free (irc_raw_messages);
+        if (irc_raw_messages_count == 0)
+            return 0;
+
+        if (irc_raw_ring_wrap < 0)
+        {
+            /* data is contiguous: [first, end) */
+            if (irc_raw_ring_end + size <= irc_raw_ring_size)
+                return irc_raw_ring_end;
+            /* not enough space at end of ring: go on at beginning */
+            irc_raw_ring_wrap = irc_raw_ring_end;
+            irc_raw_ring_end = 0;
+        }
+
+        /* data is wrapped: [first, wrap) + [0, end) */
+        if (irc_raw_ring_end + size <= irc_raw_ring_first)
+            return irc_raw_ring_end;
+
+        irc_raw_ring_remove_first ();
     }
 }
 
 /*
- * Adds a new raw message to list.
+ * Adds a new raw message in ring (oldest messages are removed if the ring is
+ * full).
  *
  * Returns pointer to new raw message, NULL if error.
  */
@@ -186,49 +237,132 @@ irc_raw_message_add_to_list (time_t date, const char *prefix,
                              const char *message)
 {
     struct t_irc_raw_message *new_raw_message;
+    int length_prefix, length_message, size, offset;
 
     if (!prefix || !message)
         return NULL;
 
-    irc_raw_message_remove_old ();
-
-    new_raw_message = malloc (sizeof (*new_raw_message));
-    if (new_raw_message)
+    if (!irc_raw_ring)
     {
-        new_raw_message->date = date;
-        new_raw_message->prefix = strdup (prefix);
-        new_raw_message->message = strdup (message);
-
-        /* add message to list */
-        new_raw_message->prev_message = last_irc_raw_message;
-        new_raw_message->next_message = NULL;
-        if (irc_raw_messages)
-            last_irc_raw_message->next_message = new_raw_message;
-        else
-            irc_raw_messages = new_raw_message;
-        last_irc_raw_message = new_raw_message;
-
-        irc_raw_messages_count++;
+        irc_raw_ring_size = weechat_config_integer (
+            irc_config_look_raw_messages_size);
+        if (irc_raw_ring_size <= 0)
+            return NULL;
+        irc_raw_ring = malloc (irc_raw_ring_size);
+        if (!irc_raw_ring)
+        {
+            irc_raw_ring_size = 0;
+            return NULL;
+        }
     }
 
+    length_prefix = strlen (prefix);
+    length_message = strlen (message);
+    size = sizeof (*new_raw_message) + length_prefix + 1 + length_message + 1;
+    size = (size + IRC_RAW_MESSAGE_ALIGN - 1) & ~(IRC_RAW_MESSAGE_ALIGN - 1);
+
+    offset = irc_raw_ring_reserve (size);
+    if (offset < 0)
+        return NULL;
+
+    new_raw_message = (struct t_irc_raw_message *)(irc_raw_ring + offset);
+    new_raw_message->date = date;
+    new_raw_message->size = size;
+    new_raw_message->prefix_length = length_prefix;
+    memcpy (IRC_RAW_MESSAGE_PREFIX(new_raw_message), prefix,
+            length_prefix + 1);
+    memcpy (IRC_RAW_MESSAGE_MESSAGE(new_raw_message), message,
+            length_message + 1);
+
+    if (irc_raw_messages_count == 0)
+        irc_raw_ring_first = offset;
+    irc_raw_ring_last = offset;
+    irc_raw_ring_end = offset + size;
+    irc_raw_messages_count++;
+
     return new_raw_message;
 }
 
 /*
- * Adds a new raw message to list.
- *
- * Returns pointer to new raw message, NULL if error.
+ * Resizes the ring with the size of option irc.look.raw_messages_size
+ * (newest messages are kept).
  */
 
-struct t_irc_raw_message *
+void
+irc_raw_ring_resize ()
+{
+    char *old_ring;
+    int old_first, old_wrap, old_count, offset, i;
+    struct t_irc_raw_message *ptr_raw_message;
+
+    old_ring = irc_raw_ring;
+    old_first = irc_raw_ring_first;
+    old_wrap = irc_raw_ring_wrap;
+    old_count = irc_raw_messages_count;
+
+    irc_raw_ring = NULL;
+    irc_raw_ring_size = 0;
+    irc_raw_ring_first = 0;
+    irc_raw_ring_last = 0;
+    irc_raw_ring_end = 0;
+    irc_raw_ring_wrap = -1;
+    irc_raw_messages_count = 0;
+
+    if (!old_ring)
+        return;
+
+    offset = old_first;
+    for (i = 0; i < old_count; i++)
+    {
+        ptr_raw_message = (struct t_irc_raw_message *)(old_ring + offset);
+        irc_raw_message_add_to_list (ptr_raw_message->date,
+                                     IRC_RAW_MESSAGE_PREFIX(ptr_raw_message),
+                                     IRC_RAW_MESSAGE_MESSAGE(ptr_raw_message));
+        offset += ptr_raw_message->size;
+        if ((old_wrap >= 0) && (offset >= old_wrap))
+            offset = 0;
+    }
+
+    free (old_ring);
+}
+
+/*
+ * Frees all raw messages.
+ */
+
+void
+irc_raw_message_free_all ()
+{
+    if (irc_raw_ring)
+        free (irc_raw_ring);
+    irc_raw_ring = NULL;
+    irc_raw_ring_size = 0;
+    irc_raw_ring_first = 0;
+    irc_raw_ring_last = 0;
+    irc_raw_ring_end = 0;
+    irc_raw_ring_wrap = -1;
+    irc_raw_messages_count = 0;
+
+    if (irc_raw_escape_buf)
+        free (irc_raw_escape_buf);
+    irc_raw_escape_buf = NULL;
+    irc_raw_escape_buf_size = 0;
+}
+
+/*
+ * Builds a raw message, prints it on raw buffer (if opened) and adds it in
+ * ring.
+ */
+
+void
 irc_raw_message_add (struct t_irc_server *server, int flags,
                      const char *message)
 {
-    char *buf, *buf2, prefix[256], prefix_arrow[16];
+    char *buf, *buf2, *new_buf2, prefix[256], prefix_arrow[16];
     const unsigned char *ptr_buf;
-    const char *hexa = "0123456789ABCDEF";
-    int pos_buf, pos_buf2, char_size, i;
-    struct t_irc_raw_message *new_raw_message;
+    const char *hexa = "0123456789ABCDEF", *ptr_message;
+    int pos_buf, pos_buf2, char_size, size, i;
+    time_t date;
 
     buf = NULL;
     buf2 = NULL;
@@ -242,10 +376,22 @@ irc_raw_message_add (struct t_irc_server *server, int flags,
     else
     {
         buf = weechat_iconv_to_internal (NULL, message);
-        buf2 = malloc ((strlen (buf) * 4) + 1);
-        if (buf2)
+        ptr_buf = (buf) ? (unsigned char *)buf : (unsigned char *)message;
+
+        /* escape buffer is kept and reused for next messages */
+        size = (strlen ((const char *)ptr_buf) * 4) + 1;
+        if (size > irc_raw_escape_buf_size)
+        {
+            new_buf2 = realloc (irc_raw_escape_buf, size);
+            if (new_buf2)
+            {
+                irc_raw_escape_buf = new_buf2;
+                irc_raw_escape_buf_size = size;
+            }
+        }
+        if (irc_raw_escape_buf && (size <= irc_raw_escape_buf_size))
         {
-            ptr_buf = (buf) ? (unsigned char *)buf : (unsigned char *)message;
+            buf2 = irc_raw_escape_buf;
             pos_buf = 0;
             pos_buf2 = 0;
             while (ptr_buf[pos_buf])
@@ -310,16 +456,14 @@ irc_raw_message_add (struct t_irc_server *server, int flags,
                   (server) ? server->name : "");
     }
 
-    new_raw_message = irc_raw_message_add_to_list (time (NULL),
-                                                   prefix,
-                                                   (buf2) ? buf2 : ((buf) ? buf : message));
+    date = time (NULL);
+    ptr_message = (buf2) ? buf2 : ((buf) ? buf : message);
+
+    irc_raw_message_print (date, prefix, ptr_message);
+    irc_raw_message_add_to_list (date, prefix, ptr_message);
 
     if (buf)
         free (buf);
-    if (buf2)
-        free (buf2);
-
-    return new_raw_message;
 }
 
 /*
@@ -330,8 +474,6 @@ void
 irc_raw_print (struct t_irc_server *server, int flags,
                const char *message)
 {
-    struct t_irc_raw_message *new_raw_message;
-
     if (!message)
         return;
 
@@ -339,28 +481,17 @@ irc_raw_print (struct t_irc_server *server, int flags,
     if (!irc_raw_buffer && (weechat_irc_plugin->debug >= 1))
         irc_raw_open (0);
 
-    new_raw_message = irc_raw_message_add (server, flags, message);
-    if (new_raw_message)
+    /* nothing to do if raw buffer is closed and messages are not saved */
+    if (!irc_raw_buffer
+        && (weechat_config_integer (irc_config_look_raw_messages_size) == 0))
     {
-        if (irc_raw_buffer)
-            irc_raw_message_print (new_raw_message);
-        if (weechat_config_integer (irc_config_look_raw_messages) == 0)
-            irc_raw_message_free (new_raw_message);
+        return;
     }
 
+    irc_raw_message_add (server, flags, message);
+
     if (weechat_irc_plugin->debug >= 2)
-    {
-        new_raw_message = irc_raw_message_add (server,
-                                               flags | IRC_RAW_FLAG_BINARY,
-                                               message);
-        if (new_raw_message)
-        {
-            if (irc_raw_buffer)
-                irc_raw_message_print (new_raw_message);
-            if (weechat_config_integer (irc_config_look_raw_messages) == 0)
-                irc_raw_message_free (new_raw_message);
-        }
-    }
+        irc_raw_message_add (server, flags | IRC_RAW_FLAG_BINARY, message);
 }
 
 /*
@@ -386,9 +517,11 @@ irc_raw_add_to_infolist (struct t_infolist *infolist,
 
     if (!weechat_infolist_new_var_time (ptr_item, "date", raw_message->date))
         return 0;
-    if (!weechat_infolist_new_var_string (ptr_item, "prefix", raw_message->prefix))
+    if (!weechat_infolist_new_var_string (ptr_item, "prefix",
+                                          IRC_RAW_MESSAGE_PREFIX(raw_message)))
         return 0;
-    if (!weechat_infolist_new_var_string (ptr_item, "message", raw_message->message))
+    if (!weechat_infolist_new_var_string (ptr_item, "message",
+                                          IRC_RAW_MESSAGE_MESSAGE(raw_message)))
         return 0;
 
     return 1;
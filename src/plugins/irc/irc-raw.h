@@ -36,27 +36,42 @@
 #define IRC_RAW_FLAG_REDIRECT 8
 #define IRC_RAW_FLAG_BINARY   16
 
+/*
+ * raw messages are stored in a ring of bytes (size is set by option
+ * irc.look.raw_messages_size); each message is a header followed by the
+ * prefix and the message (both ending with '\0'), and is never split at the
+ * end of ring
+ */
+
+#define IRC_RAW_MESSAGE_ALIGN 8
+
+#define IRC_RAW_MESSAGE_PREFIX(__raw_message)                           \
+    ((char *)(__raw_message) + sizeof (struct t_irc_raw_message))
+#define IRC_RAW_MESSAGE_MESSAGE(__raw_message)                          \
+    (IRC_RAW_MESSAGE_PREFIX(__raw_message)                              \
+     + (__raw_message)->prefix_length + 1)
+
 struct t_irc_raw_message
 {
     time_t date;                       /* date/time of message              */
-    char *prefix;                      /* prefix                            */
-    char *message;                     /* message                           */
-    struct t_irc_raw_message *prev_message; /* pointer to previous message  */
-    struct t_irc_raw_message *next_message; /* pointer to next message      */
+    int size;                          /* size in ring (header + strings)   */
+    int prefix_length;                 /* length of prefix (without '\0')   */
 };
 
 struct t_irc_server;
 
 extern struct t_gui_buffer *irc_raw_buffer;
 extern int irc_raw_messages_count;
-extern struct t_irc_raw_message *irc_raw_messages, *last_irc_raw_message;
 
 extern void irc_raw_open (int switch_to_buffer);
+extern struct t_irc_raw_message *irc_raw_message_get_first ();
+extern struct t_irc_raw_message *irc_raw_message_get_next (struct t_irc_raw_message *raw_message);
 extern struct t_irc_raw_message *irc_raw_message_add_to_list (time_t date,
                                                               const char *prefix,
                                                               const char *message);
 extern void irc_raw_print (struct t_irc_server *server, int flags,
                            const char *message);
+extern void irc_raw_ring_resize ();
 extern void irc_raw_message_free_all ();
 extern int irc_raw_add_to_infolist (struct t_infolist *infolist,
                                     struct t_irc_raw_message *raw_message);
@@ -0,0 +1,481 @@
+/*
+ * irc-reader.c - thread reading the socket of a server for IRC plugin
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When option irc.network.recv_thread is enabled, each connected server has
+ * a reader thread: it waits for data on the socket, reads it (and decrypts
+ * it with TLS), then queues the data received and wakes up the main thread
+ * (WeeChat) with a pipe watched by a fd hook.
+ *
+ * The main thread splits data in messages and processes them, so that
+ * modifiers, signals and protocol callbacks are always called by the main
+ * thread; the WeeChat API is never called by the reader thread.
+ *
+ * With TLS, the reader thread only receives data on the session while the
+ * main thread only sends data on it (this is allowed by GnuTLS once the
+ * handshake is done).
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "../weechat-plugin.h"
+#include "irc.h"
+#include "irc-reader.h"
+#include "irc-server.h"
+
+
+/*
+ * Adds a chunk of data received in queue of reader, wakes up the main thread
+ * and waits if too much data is queued.
+ *
+ * Returns:
+ *   1: OK
+ *   0: reader thread must stop
+ */
+
+int
+irc_reader_queue_chunk (struct t_irc_reader *reader,
+                        struct t_irc_reader_chunk *chunk)
+{
+    int quit;
+
+    pthread_mutex_lock (&reader->mutex);
+
+    chunk->next_chunk = NULL;
+    if (reader->last_chunk)
+        reader->last_chunk->next_chunk = chunk;
+    else
+        reader->chunks = chunk;
+    reader->last_chunk = chunk;
+    reader->queue_size += chunk->size;
+
+    if (!reader->wakeup_pending)
+    {
+        reader->wakeup_pending = 1;
+        if (write (reader->pipe_wakeup[1], "1", 1) < 0)
+        {
+            /* pipe full: main thread is already woken up */
+        }
+    }
+
+    while ((reader->queue_size >= IRC_READER_MAX_QUEUE_SIZE)
+           && !reader->quit)
+    {
+        pthread_cond_wait (&reader->cond_consumed, &reader->mutex);
+    }
+    quit = reader->quit;
+
+    pthread_mutex_unlock (&reader->mutex);
+
+    return (quit) ? 0 : 1;
+}
+
+/*
+ * Reads data available on socket, until there is no more data (EAGAIN).
+ *
+ * Returns:
+ *   1: OK (socket must be polled again)
+ *   0: reader thread must stop (error, connection closed or stop asked)
+ */
+
+int
+irc_reader_recv (struct t_irc_reader *reader, int *recv_size,
+                 int *num_read, int *error)
+{
+    struct t_irc_reader_chunk *chunk;
+
+    while (1)
+    {
+        chunk = malloc (sizeof (*chunk));
+        if (chunk)
+        {
+            chunk->data = malloc (*recv_size);
+            if (!chunk->data)
+            {
+                free (chunk);
+                chunk = NULL;
+            }
+        }
+        if (!chunk)
+        {
+            /* not enough memory: try again later */
+            usleep (100 * 1000);
+            return 1;
+        }
+
+#ifdef HAVE_GNUTLS
+        if (reader->ssl)
+            *num_read = gnutls_record_recv (reader->server->gnutls_sess,
+                                            chunk->data, *recv_size);
+        else
+#endif /* HAVE_GNUTLS */
+            *num_read = recv (reader->sock, chunk->data, *recv_size, 0);
+        *error = errno;
+
+        if (*num_read <= 0)
+        {
+            free (chunk->data);
+            free (chunk);
+#ifdef HAVE_GNUTLS
+            if (reader->ssl)
+            {
+                return ((*num_read == GNUTLS_E_AGAIN)
+                        || (*num_read == GNUTLS_E_INTERRUPTED)) ? 1 : 0;
+            }
+#endif /* HAVE_GNUTLS */
+            return ((*num_read < 0)
+                    && ((*error == EAGAIN) || (*error == EWOULDBLOCK))) ?
+                1 : 0;
+        }
+
+        chunk->size = *num_read;
+        gettimeofday (&chunk->date_recv, NULL);
+
+        /* adjust size of next read with amount of data received */
+        if ((*num_read == *recv_size)
+            && (*recv_size < IRC_SERVER_RECV_SIZE_MAX))
+        {
+            *recv_size *= 2;
+        }
+        else if ((*num_read < *recv_size / 4)
+                 && (*recv_size > IRC_SERVER_RECV_SIZE_MIN))
+        {
+            *recv_size /= 2;
+        }
+
+        if (!irc_reader_queue_chunk (reader, chunk))
+            return 0;
+    }
+}
+
+/*
+ * Runs the reader thread: waits for data on socket (or a stop request) and
+ * reads it.
+ */
+
+void *
+irc_reader_thread_run (void *arg)
+{
+    struct t_irc_reader *reader;
+    struct pollfd poll_fds[2];
+    int recv_size, num_read, error, rc;
+
+    reader = (struct t_irc_reader *)arg;
+
+    recv_size = IRC_SERVER_RECV_SIZE_MIN;
+    num_read = 1;
+    error = 0;
+
+    while (1)
+    {
+#ifdef HAVE_GNUTLS
+        /*
+         * data may be already decrypted in the gnutls buffers (the socket
+         * will not be readable for these data)
+         */
+        if (reader->ssl
+            && (gnutls_record_check_pending (reader->server->gnutls_sess) > 0))
+        {
+            if (!irc_reader_recv (reader, &recv_size, &num_read, &error))
+                break;
+            continue;
+        }
+#endif /* HAVE_GNUTLS */
+        poll_fds[0].fd = reader->sock;
+        poll_fds[0].events = POLLIN;
+        poll_fds[0].revents = 0;
+        poll_fds[1].fd = reader->pipe_stop[0];
+        poll_fds[1].events = POLLIN;
+        poll_fds[1].revents = 0;
+        rc = poll (poll_fds, 2, -1);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            num_read = -1;
+            error = errno;
+            break;
+        }
+        if (poll_fds[1].revents)
+            break;
+        if (poll_fds[0].revents
+            && !irc_reader_recv (reader, &recv_size, &num_read, &error))
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_lock (&reader->mutex);
+    reader->done = 1;
+    reader->num_read = num_read;
+    reader->error = error;
+    if (!reader->quit && !reader->wakeup_pending)
+    {
+        reader->wakeup_pending = 1;
+        if (write (reader->pipe_wakeup[1], "1", 1) < 0)
+        {
+            /* pipe full: main thread is already woken up */
+        }
+    }
+    pthread_mutex_unlock (&reader->mutex);
+
+    return NULL;
+}
+
+/*
+ * Takes chunks queued by reader thread and adds them to buffer with received
+ * data of server (messages are queued, but not processed).
+ */
+
+void
+irc_reader_take_chunks (struct t_irc_reader *reader)
+{
+    struct t_irc_reader_chunk *chunks, *ptr_next_chunk;
+    char *ptr_data;
+
+    pthread_mutex_lock (&reader->mutex);
+    chunks = reader->chunks;
+    reader->chunks = NULL;
+    reader->last_chunk = NULL;
+    reader->queue_size = 0;
+    reader->wakeup_pending = 0;
+    pthread_cond_signal (&reader->cond_consumed);
+    pthread_mutex_unlock (&reader->mutex);
+
+    while (chunks)
+    {
+        ptr_next_chunk = chunks->next_chunk;
+        reader->server->stats_bytes_recv += chunks->size;
+        ptr_data = irc_server_recv_buffer_reserve (reader->server,
+                                                   chunks->size);
+        if (ptr_data)
+        {
+            memcpy (ptr_data, chunks->data, chunks->size);
+            irc_server_msgq_add_received (reader->server, chunks->size,
+                                          &chunks->date_recv);
+        }
+        else
+        {
+            weechat_printf (reader->server->buffer,
+                            _("%s%s: not enough memory for received message"),
+                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
+        }
+        free (chunks->data);
+        free (chunks);
+        chunks = ptr_next_chunk;
+    }
+}
+
+/*
+ * Callback called when the reader thread wakes up the main thread: processes
+ * data received and handles end of connection.
+ */
+
+int
+irc_reader_wakeup_cb (const void *pointer, void *data, int fd)
+{
+    struct t_irc_reader *reader;
+    struct t_irc_server *server;
+    char buffer[64];
+    int done, num_read, error;
+
+    /* make C compiler happy */
+    (void) data;
+
+    reader = (struct t_irc_reader *)pointer;
+    if (!reader)
+        return WEECHAT_RC_ERROR;
+
+    while (read (fd, buffer, sizeof (buffer)) > 0)
+    {
+    }
+
+    irc_reader_take_chunks (reader);
+
+    pthread_mutex_lock (&reader->mutex);
+    done = reader->done;
+    num_read = reader->num_read;
+    error = reader->error;
+    pthread_mutex_unlock (&reader->mutex);
+
+    server = reader->server;
+
+    /* server may be disconnected while messages are processed */
+    irc_server_msgq_flush_partial ();
+
+    if (done && (server->reader == reader))
+        irc_server_recv_error (server, num_read, error);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Frees a reader (thread must be stopped).
+ */
+
+void
+irc_reader_free (struct t_irc_reader *reader)
+{
+    struct t_irc_reader_chunk *ptr_next_chunk;
+
+    while (reader->chunks)
+    {
+        ptr_next_chunk = reader->chunks->next_chunk;
+        free (reader->chunks->data);
+        free (reader->chunks);
+        reader->chunks = ptr_next_chunk;
+    }
+    if (reader->hook_fd)
+        weechat_unhook (reader->hook_fd);
+    if (reader->pipe_wakeup[0] >= 0)
+        close (reader->pipe_wakeup[0]);
+    if (reader->pipe_wakeup[1] >= 0)
+        close (reader->pipe_wakeup[1]);
+    if (reader->pipe_stop[0] >= 0)
+        close (reader->pipe_stop[0]);
+    if (reader->pipe_stop[1] >= 0)
+        close (reader->pipe_stop[1]);
+    pthread_mutex_destroy (&reader->mutex);
+    pthread_cond_destroy (&reader->cond_consumed);
+    free (reader);
+}
+
+/*
+ * Starts a reader thread for the socket of a server.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (thread not created, socket must be read by the main thread)
+ */
+
+int
+irc_reader_start (struct t_irc_server *server)
+{
+    struct t_irc_reader *new_reader;
+    int i, flags;
+
+    if (!server || (server->sock < 0) || server->reader)
+        return 0;
+
+    new_reader = malloc (sizeof (*new_reader));
+    if (!new_reader)
+        return 0;
+
+    new_reader->server = server;
+    new_reader->sock = server->sock;
+    new_reader->ssl = server->ssl_connected;
+    pthread_mutex_init (&new_reader->mutex, NULL);
+    pthread_cond_init (&new_reader->cond_consumed, NULL);
+    new_reader->pipe_wakeup[0] = -1;
+    new_reader->pipe_wakeup[1] = -1;
+    new_reader->pipe_stop[0] = -1;
+    new_reader->pipe_stop[1] = -1;
+    new_reader->hook_fd = NULL;
+    new_reader->chunks = NULL;
+    new_reader->last_chunk = NULL;
+    new_reader->queue_size = 0;
+    new_reader->wakeup_pending = 0;
+    new_reader->quit = 0;
+    new_reader->done = 0;
+    new_reader->num_read = 1;
+    new_reader->error = 0;
+
+    if ((pipe (new_reader->pipe_wakeup) < 0)
+        || (pipe (new_reader->pipe_stop) < 0))
+    {
+        irc_reader_free (new_reader);
+        return 0;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        flags = fcntl (new_reader->pipe_wakeup[i], F_GETFL);
+        if (flags == -1)
+            flags = 0;
+        fcntl (new_reader->pipe_wakeup[i], F_SETFL, flags | O_NONBLOCK);
+    }
+
+    new_reader->hook_fd = weechat_hook_fd (new_reader->pipe_wakeup[0],
+                                           1, 0, 0,
+                                           &irc_reader_wakeup_cb,
+                                           new_reader, NULL);
+    if (!new_reader->hook_fd)
+    {
+        irc_reader_free (new_reader);
+        return 0;
+    }
+
+    if (pthread_create (&new_reader->thread, NULL,
+                        &irc_reader_thread_run, new_reader) != 0)
+    {
+        irc_reader_free (new_reader);
+        return 0;
+    }
+
+    server->reader = new_reader;
+
+    return 1;
+}
+
+/*
+ * Stops the reader thread of a server and frees it.
+ *
+ * If keep_data == 1, data received and not yet taken by the main thread is
+ * added to buffer with received data of server (messages are queued, but
+ * not processed), otherwise it is discarded.
+ */
+
+void
+irc_reader_stop (struct t_irc_server *server, int keep_data)
+{
+    struct t_irc_reader *reader;
+
+    if (!server || !server->reader)
+        return;
+
+    reader = server->reader;
+    server->reader = NULL;
+
+    pthread_mutex_lock (&reader->mutex);
+    reader->quit = 1;
+    pthread_cond_signal (&reader->cond_consumed);
+    pthread_mutex_unlock (&reader->mutex);
+
+    if (write (reader->pipe_stop[1], "1", 1) < 0)
+    {
+        /* the thread is stopped anyway when it reads the socket again */
+    }
+
+    pthread_join (reader->thread, NULL);
+
+    if (keep_data)
+        irc_reader_take_chunks (reader);
+
+    irc_reader_free (reader);
+}
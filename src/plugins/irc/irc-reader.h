@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_IRC_READER_H
+#define WEECHAT_IRC_READER_H 1
+
+#include <pthread.h>
+#include <sys/time.h>
+
+/* reader thread waits for the main thread when this size of data is queued */
+#define IRC_READER_MAX_QUEUE_SIZE (4 * 1024 * 1024)
+
+struct t_irc_server;
+
+/* data received on socket, queued by the reader thread */
+
+struct t_irc_reader_chunk
+{
+    char *data;                           /* data received (not NUL-term.)  */
+    int size;                             /* size of data                   */
+    struct timeval date_recv;             /* date of reception of data      */
+    struct t_irc_reader_chunk *next_chunk; /* link to next chunk            */
+};
+
+/* thread reading the socket of a server */
+
+struct t_irc_reader
+{
+    struct t_irc_server *server;          /* server                         */
+    int sock;                             /* socket (copy of server->sock)  */
+    int ssl;                              /* 1 if TLS is used on socket     */
+    pthread_t thread;                     /* reader thread                  */
+    pthread_mutex_t mutex;                /* lock for fields below          */
+    pthread_cond_t cond_consumed;         /* signaled when data is taken    */
+    int pipe_wakeup[2];                   /* pipe to wake up main thread    */
+    int pipe_stop[2];                     /* pipe to stop reader thread     */
+    struct t_hook *hook_fd;               /* hook on pipe_wakeup[0]         */
+    struct t_irc_reader_chunk *chunks;    /* data received                  */
+    struct t_irc_reader_chunk *last_chunk; /* last chunk received           */
+    int queue_size;                       /* size of data in chunks         */
+    int wakeup_pending;                   /* 1 if main thread is woken up   */
+    int quit;                             /* 1 if thread must stop          */
+    int done;                             /* 1 if thread has stopped        */
+    int num_read;                         /* last value returned by recv    */
+                                          /* (0 or < 0 if thread stopped    */
+                                          /* on error)                      */
+    int error;                            /* errno of recv error            */
+};
+
+extern int irc_reader_start (struct t_irc_server *server);
+extern void irc_reader_stop (struct t_irc_server *server, int keep_data);
+
+#endif /* WEECHAT_IRC_READER_H */
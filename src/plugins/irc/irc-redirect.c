@@ -34,6 +34,8 @@
 
 struct t_irc_redirect_pattern *irc_redirect_patterns = NULL;
 struct t_irc_redirect_pattern *last_irc_redirect_pattern = NULL;
+struct t_hashtable *irc_redirect_hsignal = NULL; /* reused for hsignals    */
+int irc_redirect_hsignal_sending = 0;  /* > 0 if a hsignal is being sent    */
 
 /* default redirect patterns */
 struct t_irc_redirect_pattern irc_redirect_patterns_default[] =
@@ -389,6 +391,189 @@ irc_redirect_pattern_free_all ()
     }
 }
 
+/*
+ * Adds a redirect in index of server for a command (if not already added for
+ * this command).
+ */
+
+void
+irc_redirect_index_add_cmd (struct t_irc_redirect *redirect,
+                            const char *command)
+{
+    struct t_irc_server *server;
+    struct t_irc_redirect_cmd_list *ptr_list;
+    struct t_irc_redirect_cmd *ptr_cmd;
+    int i;
+
+    for (i = 0; i < redirect->index_cmds_count; i++)
+    {
+        if (strcmp (redirect->index_cmds[i].command, command) == 0)
+            return;
+    }
+
+    server = redirect->server;
+    if (!server->redirects_cmd)
+    {
+        server->redirects_cmd = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!server->redirects_cmd)
+            return;
+    }
+
+    ptr_list = weechat_hashtable_get (server->redirects_cmd, command);
+    if (!ptr_list)
+    {
+        ptr_list = malloc (sizeof (*ptr_list));
+        if (!ptr_list)
+            return;
+        ptr_list->cmds = NULL;
+        ptr_list->last_cmd = NULL;
+        weechat_hashtable_set (server->redirects_cmd, command, ptr_list);
+    }
+
+    ptr_cmd = &(redirect->index_cmds[redirect->index_cmds_count]);
+    ptr_cmd->command = strdup (command);
+    if (!ptr_cmd->command)
+        return;
+    ptr_cmd->redirect = redirect;
+
+    /* redirects are created in order, so they are added at the end of list */
+    ptr_cmd->prev_cmd = ptr_list->last_cmd;
+    ptr_cmd->next_cmd = NULL;
+    if (ptr_list->last_cmd)
+        (ptr_list->last_cmd)->next_cmd = ptr_cmd;
+    else
+        ptr_list->cmds = ptr_cmd;
+    ptr_list->last_cmd = ptr_cmd;
+
+    redirect->index_cmds_count++;
+}
+
+/*
+ * Adds commands of a hashtable in index of server.
+ */
+
+void
+irc_redirect_index_add_cb (void *data, struct t_hashtable *hashtable,
+                           const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) value;
+
+    irc_redirect_index_add_cmd ((struct t_irc_redirect *)data,
+                                (const char *)key);
+}
+
+/*
+ * Adds a redirect in index of server, with all commands it is waiting for
+ * (start, stop and extra commands).
+ */
+
+void
+irc_redirect_index_add (struct t_irc_redirect *redirect)
+{
+    struct t_hashtable *hash_cmd[3];
+    int i, count;
+
+    hash_cmd[0] = redirect->cmd_start;
+    hash_cmd[1] = redirect->cmd_stop;
+    hash_cmd[2] = redirect->cmd_extra;
+
+    count = 0;
+    for (i = 0; i < 3; i++)
+    {
+        if (hash_cmd[i])
+            count += weechat_hashtable_get_integer (hash_cmd[i], "items_count");
+    }
+    if (count == 0)
+        return;
+
+    redirect->index_cmds = malloc (count * sizeof (*redirect->index_cmds));
+    if (!redirect->index_cmds)
+        return;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (hash_cmd[i])
+            weechat_hashtable_map (hash_cmd[i], &irc_redirect_index_add_cb,
+                                   redirect);
+    }
+}
+
+/*
+ * Removes a redirect from index of server.
+ */
+
+void
+irc_redirect_index_remove (struct t_irc_redirect *redirect)
+{
+    struct t_irc_server *server;
+    struct t_irc_redirect_cmd_list *ptr_list;
+    struct t_irc_redirect_cmd *ptr_cmd;
+    int i;
+
+    server = redirect->server;
+
+    for (i = 0; i < redirect->index_cmds_count; i++)
+    {
+        ptr_cmd = &(redirect->index_cmds[i]);
+        ptr_list = (server->redirects_cmd) ?
+            weechat_hashtable_get (server->redirects_cmd,
+                                   ptr_cmd->command) : NULL;
+        if (ptr_list)
+        {
+            if (ptr_list->last_cmd == ptr_cmd)
+                ptr_list->last_cmd = ptr_cmd->prev_cmd;
+            if (ptr_cmd->prev_cmd)
+                (ptr_cmd->prev_cmd)->next_cmd = ptr_cmd->next_cmd;
+            else
+                ptr_list->cmds = ptr_cmd->next_cmd;
+            if (ptr_cmd->next_cmd)
+                (ptr_cmd->next_cmd)->prev_cmd = ptr_cmd->prev_cmd;
+            if (!ptr_list->cmds)
+            {
+                weechat_hashtable_remove (server->redirects_cmd,
+                                          ptr_cmd->command);
+                free (ptr_list);
+            }
+        }
+        free (ptr_cmd->command);
+    }
+
+    if (redirect->index_cmds)
+        free (redirect->index_cmds);
+    redirect->index_cmds = NULL;
+    redirect->index_cmds_count = 0;
+}
+
+/*
+ * Sets flags "cmd_start_received" and "cmd_stop_received" in a redirect
+ * (and updates the number of redirects in progress on server).
+ */
+
+void
+irc_redirect_set_received (struct t_irc_redirect *redirect,
+                           int cmd_start_received, int cmd_stop_received)
+{
+    int old_in_progress, new_in_progress;
+
+    if (!redirect)
+        return;
+
+    old_in_progress = (redirect->cmd_start_received
+                       || redirect->cmd_stop_received) ? 1 : 0;
+    redirect->cmd_start_received = cmd_start_received;
+    redirect->cmd_stop_received = cmd_stop_received;
+    new_in_progress = (redirect->cmd_start_received
+                       || redirect->cmd_stop_received) ? 1 : 0;
+
+    redirect->server->redirects_in_progress += new_in_progress - old_in_progress;
+}
+
 /*
  * Creates a new redirect for a command on a server (with start/stop/extra
  * commands in arguments).
@@ -481,6 +666,8 @@ irc_redirect_new_with_commands (struct t_irc_server *server,
     new_redirect->cmd_filter = hash_cmd[3];
     new_redirect->output = NULL;
     new_redirect->output_size = 0;
+    new_redirect->index_cmds = NULL;
+    new_redirect->index_cmds_count = 0;
 
     /* add redirect to end of list */
     new_redirect->prev_redirect = server->last_redirect;
@@ -491,6 +678,9 @@ irc_redirect_new_with_commands (struct t_irc_server *server,
     server->last_redirect = new_redirect;
     new_redirect->next_redirect = NULL;
 
+    /* add redirect in index (by commands waited) */
+    irc_redirect_index_add (new_redirect);
+
     return new_redirect;
 }
 
@@ -728,10 +918,25 @@ irc_redirect_stop (struct t_irc_redirect *redirect, const char *error)
          * error or max count reached, then we run callback and remove
          * redirect
          */
-        hashtable = weechat_hashtable_new (32,
-                                           WEECHAT_HASHTABLE_STRING,
-                                           WEECHAT_HASHTABLE_STRING,
-                                           NULL, NULL);
+        /*
+         * reuse the same hashtable for all redirections (a new one is used
+         * if a callback ends another redirection while the hsignal is sent)
+         */
+        hashtable = (irc_redirect_hsignal_sending) ?
+            NULL : irc_redirect_hsignal;
+        if (hashtable)
+        {
+            weechat_hashtable_remove_all (hashtable);
+        }
+        else
+        {
+            hashtable = weechat_hashtable_new (32,
+                                               WEECHAT_HASHTABLE_STRING,
+                                               WEECHAT_HASHTABLE_STRING,
+                                               NULL, NULL);
+            if (!irc_redirect_hsignal_sending)
+                irc_redirect_hsignal = hashtable;
+        }
         if (hashtable)
         {
             /* set error and output (main fields) */
@@ -751,9 +956,11 @@ irc_redirect_stop (struct t_irc_redirect *redirect, const char *error)
 
         snprintf (signal_name, sizeof (signal_name), "irc_redirection_%s_%s",
                   redirect->signal, redirect->pattern);
+        irc_redirect_hsignal_sending++;
         (void) weechat_hook_hsignal_send (signal_name, hashtable);
+        irc_redirect_hsignal_sending--;
 
-        if (hashtable)
+        if (hashtable && (hashtable != irc_redirect_hsignal))
             weechat_hashtable_free (hashtable);
 
         irc_redirect_free (redirect);
@@ -764,15 +971,125 @@ irc_redirect_stop (struct t_irc_redirect *redirect, const char *error)
          * max count not yet reached, then we prepare redirect to continue
          * redirection
          */
-        redirect->cmd_start_received = 0;
-        redirect->cmd_stop_received = 0;
+        irc_redirect_set_received (redirect, 0, 0);
+    }
+}
+
+/*
+ * Checks if a received message (from IRC server) is for a redirect.
+ *
+ * Returns:
+ *   1: message has been redirected (irc plugin will discard message)
+ *   0: message is not for this redirect
+ */
+
+int
+irc_redirect_message_check (struct t_irc_redirect *redirect,
+                            const char *message, const char *command,
+                            char **arguments_argv, int arguments_argc)
+{
+    int match_stop;
+
+    if (redirect->start_time > 0)
+    {
+        if (redirect->cmd_stop_received)
+        {
+            if (redirect->cmd_extra
+                && irc_redirect_message_match_hash (redirect,
+                                                    command,
+                                                    arguments_argv,
+                                                    arguments_argc,
+                                                    redirect->cmd_extra))
+            {
+                irc_redirect_message_add (redirect, message, command);
+                irc_redirect_stop (redirect, NULL);
+                return 1;
+            }
+            irc_redirect_stop (redirect, NULL);
+        }
+        else
+        {
+            /* message matches a start command? */
+            if (redirect->cmd_start
+                && !redirect->cmd_start_received
+                && irc_redirect_message_match_hash (redirect,
+                                                    command,
+                                                    arguments_argv,
+                                                    arguments_argc,
+                                                    redirect->cmd_start))
+            {
+                /*
+                 * message is a start command for redirection, then add
+                 * message to output for redirection and mark start
+                 * command as "received" for this redirect
+                 */
+                irc_redirect_message_add (redirect, message, command);
+                irc_redirect_set_received (redirect, 1,
+                                           redirect->cmd_stop_received);
+                return 1;
+            }
+            /*
+             * if matching stop command, or start command received, we are
+             * in redirection: add message to output and close redirection
+             * if matching stop command
+             */
+            match_stop = irc_redirect_message_match_hash (redirect,
+                                                          command,
+                                                          arguments_argv,
+                                                          arguments_argc,
+                                                          redirect->cmd_stop);
+            if (match_stop || redirect->cmd_start_received)
+            {
+                /*
+                 * add message to output if matching stop of if command
+                 * is numeric
+                 */
+                irc_redirect_message_add (redirect, message, command);
+                if (match_stop)
+                {
+                    irc_redirect_set_received (redirect,
+                                               redirect->cmd_start_received,
+                                               1);
+                    if (redirect->cmd_extra)
+                    {
+                        if (irc_redirect_message_match_hash (redirect,
+                                                             command,
+                                                             arguments_argv,
+                                                             arguments_argc,
+                                                             redirect->cmd_extra))
+                        {
+                            /*
+                             * this command is a stop and extra command,
+                             * then remove redirect
+                             */
+                            irc_redirect_stop (redirect, NULL);
+                        }
+                    }
+                    else
+                    {
+                        /*
+                         * no extra command after stop, then remove
+                         * redirect
+                         */
+                        irc_redirect_stop (redirect, NULL);
+                    }
+                }
+                return 1;
+            }
+        }
     }
+
+    return 0;
 }
 
 /*
  * Tries to redirect a received message (from IRC server) to a redirect in
  * server.
  *
+ * If no redirect is in progress (start or stop command received), only the
+ * redirects waiting for this command are checked (with the index of
+ * redirects by command).
+ *
  * Returns:
  *   1: message has been redirected (irc plugin will discard message)
  *   0: no matching redirect was found
@@ -783,12 +1100,23 @@ irc_redirect_message (struct t_irc_server *server, const char *message,
                       const char *command, const char *arguments)
 {
     struct t_irc_redirect *ptr_redirect, *ptr_next_redirect;
-    int rc, match_stop, arguments_argc;
+    struct t_irc_redirect_cmd_list *ptr_list;
+    struct t_irc_redirect_cmd *ptr_cmd, *ptr_next_cmd;
+    int rc, arguments_argc;
     char **arguments_argv;
 
     if (!server || !server->redirects || !message || !command)
         return 0;
 
+    ptr_list = NULL;
+    if (server->redirects_in_progress == 0)
+    {
+        ptr_list = (server->redirects_cmd) ?
+            weechat_hashtable_get (server->redirects_cmd, command) : NULL;
+        if (!ptr_list)
+            return 0;
+    }
+
     rc = 0;
 
     if (arguments && arguments[0])
@@ -802,104 +1130,40 @@ irc_redirect_message (struct t_irc_server *server, const char *message,
         arguments_argc = 0;
     }
 
-    ptr_redirect = server->redirects;
-    while (ptr_redirect)
+    if (ptr_list)
     {
-        ptr_next_redirect = ptr_redirect->next_redirect;
-
-        if (ptr_redirect->start_time > 0)
+        /* check only redirects waiting for this command */
+        ptr_cmd = ptr_list->cmds;
+        while (ptr_cmd)
         {
-            if (ptr_redirect->cmd_stop_received)
+            ptr_next_cmd = ptr_cmd->next_cmd;
+            if (irc_redirect_message_check (ptr_cmd->redirect, message,
+                                            command, arguments_argv,
+                                            arguments_argc))
             {
-                if (ptr_redirect->cmd_extra
-                    && irc_redirect_message_match_hash (ptr_redirect,
-                                                        command,
-                                                        arguments_argv,
-                                                        arguments_argc,
-                                                        ptr_redirect->cmd_extra))
-                {
-                    irc_redirect_message_add (ptr_redirect, message, command);
-                    irc_redirect_stop (ptr_redirect, NULL);
-                    rc = 1;
-                    goto end;
-                }
-                irc_redirect_stop (ptr_redirect, NULL);
+                rc = 1;
+                break;
             }
-            else
+            ptr_cmd = ptr_next_cmd;
+        }
+    }
+    else
+    {
+        /* a redirect is in progress: check all redirects */
+        ptr_redirect = server->redirects;
+        while (ptr_redirect)
+        {
+            ptr_next_redirect = ptr_redirect->next_redirect;
+            if (irc_redirect_message_check (ptr_redirect, message, command,
+                                            arguments_argv, arguments_argc))
             {
-                /* message matches a start command? */
-                if (ptr_redirect->cmd_start
-                    && !ptr_redirect->cmd_start_received
-                    && irc_redirect_message_match_hash (ptr_redirect,
-                                                        command,
-                                                        arguments_argv,
-                                                        arguments_argc,
-                                                        ptr_redirect->cmd_start))
-                {
-                    /*
-                     * message is a start command for redirection, then add
-                     * message to output for redirection and mark start
-                     * command as "received" for this redirect
-                     */
-                    irc_redirect_message_add (ptr_redirect, message, command);
-                    ptr_redirect->cmd_start_received = 1;
-                    rc = 1;
-                    goto end;
-                }
-                /*
-                 * if matching stop command, or start command received, we are
-                 * in redirection: add message to output and close redirection
-                 * if matching stop command
-                 */
-                match_stop = irc_redirect_message_match_hash (ptr_redirect,
-                                                              command,
-                                                              arguments_argv,
-                                                              arguments_argc,
-                                                              ptr_redirect->cmd_stop);
-                if (match_stop || ptr_redirect->cmd_start_received)
-                {
-                    /*
-                     * add message to output if matching stop of if command
-                     * is numeric
-                     */
-                    irc_redirect_message_add (ptr_redirect, message, command);
-                    if (match_stop)
-                    {
-                        ptr_redirect->cmd_stop_received = 1;
-                        if (ptr_redirect->cmd_extra)
-                        {
-                            if (irc_redirect_message_match_hash (ptr_redirect,
-                                                                 command,
-                                                                 arguments_argv,
-                                                                 arguments_argc,
-                                                                 ptr_redirect->cmd_extra))
-                            {
-                                /*
-                                 * this command is a stop and extra command,
-                                 * then remove redirect
-                                 */
-                                irc_redirect_stop (ptr_redirect, NULL);
-                            }
-                        }
-                        else
-                        {
-                            /*
-                             * no extra command after stop, then remove
-                             * redirect
-                             */
-                            irc_redirect_stop (ptr_redirect, NULL);
-                        }
-                    }
-                    rc = 1;
-                    goto end;
-                }
+                rc = 1;
+                break;
             }
+            ptr_redirect = ptr_next_redirect;
         }
-
-        ptr_redirect = ptr_next_redirect;
     }
 
-end:
     if (arguments_argv)
         weechat_string_free_split (arguments_argv);
 
@@ -923,6 +1187,11 @@ irc_redirect_free (struct t_irc_redirect *redirect)
 
     server = redirect->server;
 
+    /* remove redirect from index */
+    irc_redirect_index_remove (redirect);
+    if (redirect->cmd_start_received || redirect->cmd_stop_received)
+        server->redirects_in_progress--;
+
     /* remove redirect */
     if (server->last_redirect == redirect)
         server->last_redirect = redirect->prev_redirect;
@@ -1226,6 +1495,8 @@ irc_redirect_print_log (struct t_irc_server *server)
                             weechat_hashtable_get_string (ptr_redirect->cmd_filter, "keys_values"));
         weechat_log_printf ("       output. . . . . . . : '%s'",  ptr_redirect->output);
         weechat_log_printf ("       output_size . . . . : %d",    ptr_redirect->output_size);
+        weechat_log_printf ("       index_cmds. . . . . : 0x%lx", ptr_redirect->index_cmds);
+        weechat_log_printf ("       index_cmds_count. . : %d",    ptr_redirect->index_cmds_count);
         weechat_log_printf ("       prev_redirect . . . : 0x%lx", ptr_redirect->prev_redirect);
         weechat_log_printf ("       next_redirect . . . : 0x%lx", ptr_redirect->next_redirect);
     }
@@ -1392,11 +1663,17 @@ irc_redirect_init ()
 }
 
 /*
- * Frees all redirect patterns.
+ * Frees all redirect patterns and the hashtable used for hsignals.
  */
 
 void
 irc_redirect_end ()
 {
     irc_redirect_pattern_free_all ();
+
+    if (irc_redirect_hsignal)
+    {
+        weechat_hashtable_free (irc_redirect_hsignal);
+        irc_redirect_hsignal = NULL;
+    }
 }
@@ -43,6 +43,24 @@ struct t_irc_redirect_pattern
     struct t_irc_redirect_pattern *next_redirect; /* link to next redir.     */
 };
 
+/* redirect waiting for a command (index of redirects by command) */
+
+struct t_irc_redirect_cmd
+{
+    char *command;                  /* command (key in server index)         */
+    struct t_irc_redirect *redirect;     /* redirect waiting for command     */
+    struct t_irc_redirect_cmd *prev_cmd; /* previous redirect for command    */
+    struct t_irc_redirect_cmd *next_cmd; /* next redirect for command        */
+};
+
+/* redirects waiting for a command (value in server index) */
+
+struct t_irc_redirect_cmd_list
+{
+    struct t_irc_redirect_cmd *cmds;      /* redirects (in order of creation) */
+    struct t_irc_redirect_cmd *last_cmd;  /* last redirect for command        */
+};
+
 /* command redirection (created when a command is redirected) */
 
 struct t_irc_redirect
@@ -71,6 +89,9 @@ struct t_irc_redirect
     char *output;                   /* output of IRC command (gradually      */
                                     /* filled with IRC messages)             */
     int output_size;                /* size (in bytes) of output string      */
+    struct t_irc_redirect_cmd *index_cmds; /* entries in index of server     */
+                                    /* (one by command in start/stop/extra)  */
+    int index_cmds_count;           /* number of entries in index            */
     struct t_irc_redirect *prev_redirect; /* link to previous redirect       */
     struct t_irc_redirect *next_redirect; /* link to next redirect           */
 };
@@ -104,6 +125,9 @@ extern struct t_irc_redirect *irc_redirect_new (struct t_irc_server *server,
 extern struct t_irc_redirect *irc_redirect_search_available (struct t_irc_server *server);
 extern void irc_redirect_init_command (struct t_irc_redirect *redirect,
                                        const char *command);
+extern void irc_redirect_set_received (struct t_irc_redirect *redirect,
+                                       int cmd_start_received,
+                                       int cmd_stop_received);
 extern void irc_redirect_stop (struct t_irc_redirect *redirect,
                                const char *error);
 extern int irc_redirect_message (struct t_irc_server *server,
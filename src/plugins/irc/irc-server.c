@@ -46,12 +46,17 @@
 #ifdef HAVE_GNUTLS
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
+#if LIBGNUTLS_VERSION_NUMBER >= 0x030703 /* 3.7.3 */
+#include <gnutls/socket.h>
+#endif /* LIBGNUTLS_VERSION_NUMBER >= 0x030703 */
 #endif /* HAVE_GNUTLS */
 
 #include "../weechat-plugin.h"
+#include "../../core/wee-trace.h"
 #include "irc.h"
 #include "irc-server.h"
 #include "irc-bar-item.h"
+#include "irc-batch.h"
 #include "irc-buffer.h"
 #include "irc-channel.h"
 #include "irc-color.h"
@@ -63,16 +68,26 @@
 #include "irc-notify.h"
 #include "irc-protocol.h"
 #include "irc-raw.h"
+#include "irc-reader.h"
 #include "irc-redirect.h"
 #include "irc-sasl.h"
 
 
 struct t_irc_server *irc_servers = NULL;
 struct t_irc_server *last_irc_server = NULL;
+struct t_hashtable *irc_servers_hash = NULL; /* servers by name            */
 
 struct t_irc_message *irc_recv_msgq = NULL;
 struct t_irc_message *irc_msgq_last_msg = NULL;
 
+struct t_irc_outqueue *irc_server_outqueue_pool = NULL; /* entries freed,   */
+int irc_server_outqueue_pool_count = 0;                 /* kept for reuse   */
+
+struct t_hook *irc_server_hook_timer_connect_queue = NULL; /* start queued  */
+                                                           /* connections   */
+struct t_hook *irc_server_hook_timer_msgq = NULL; /* process received msgs  */
+int irc_server_msgq_processing = 0;               /* 1 if processing msgs   */
+
 char *irc_server_sasl_fail_string[IRC_SERVER_NUM_SASL_FAIL] =
 { "continue", "reconnect", "disconnect" };
 
@@ -111,6 +126,7 @@ char *irc_server_options[IRC_SERVER_NUM_OPTIONS][2] =
   { "connection_timeout",   "60"                      },
   { "anti_flood_prio_high", "2"                       },
   { "anti_flood_prio_low",  "2"                       },
+  { "anti_flood_burst",     "5"                       },
   { "away_check",           "0"                       },
   { "away_check_max_nicks", "25"                      },
   { "msg_kick",             ""                        },
@@ -121,6 +137,9 @@ char *irc_server_options[IRC_SERVER_NUM_OPTIONS][2] =
 
 char *irc_server_casemapping_string[IRC_SERVER_NUM_CASEMAPPING] =
 { "rfc1459", "strict-rfc1459", "ascii" };
+int irc_server_casemapping_range[IRC_SERVER_NUM_CASEMAPPING] =
+{ 30, 29, 26 };
+unsigned char irc_server_casemapping_fold[IRC_SERVER_NUM_CASEMAPPING][256];
 
 char *irc_server_prefix_modes_default = "ov";
 char *irc_server_prefix_chars_default = "@+";
@@ -138,6 +157,13 @@ int irc_fingerprint_digest_algos_size[IRC_FINGERPRINT_NUM_ALGOS] =
 { 160, 256, 512 };
 #endif /* HAVE_GNUTLS */
 
+#ifdef HAVE_TRACEPOINTS
+TRACE_SEMAPHORE(irc_recv);
+TRACE_SEMAPHORE(irc_parse);
+TRACE_SEMAPHORE(irc_dispatch_start);
+TRACE_SEMAPHORE(irc_dispatch_end);
+#endif /* HAVE_TRACEPOINTS */
+
 
 void irc_server_reconnect (struct t_irc_server *server);
 void irc_server_free_data (struct t_irc_server *server);
@@ -171,6 +197,43 @@ irc_server_valid (struct t_irc_server *server)
     return 0;
 }
 
+/*
+ * Adds a server in hashtable of servers (creates the hashtable if needed).
+ */
+
+void
+irc_server_hash_add (struct t_irc_server *server)
+{
+    if (!server->name)
+        return;
+
+    if (!irc_servers_hash)
+    {
+        irc_servers_hash = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+    }
+    if (irc_servers_hash)
+        weechat_hashtable_set (irc_servers_hash, server->name, server);
+}
+
+/*
+ * Removes a server from hashtable of servers.
+ */
+
+void
+irc_server_hash_remove (struct t_irc_server *server)
+{
+    if (irc_servers_hash
+        && server->name
+        && (weechat_hashtable_get (irc_servers_hash, server->name) == server))
+    {
+        weechat_hashtable_remove (irc_servers_hash, server->name);
+    }
+}
+
 /*
  * Searches for a server by name.
  *
@@ -185,6 +248,9 @@ irc_server_search (const char *server_name)
     if (!server_name)
         return NULL;
 
+    if (irc_servers_hash)
+        return weechat_hashtable_get (irc_servers_hash, server_name);
+
     for (ptr_server = irc_servers; ptr_server;
          ptr_server = ptr_server->next_server)
     {
@@ -267,9 +333,132 @@ irc_server_search_casemapping (const char *casemapping)
     return -1;
 }
 
+/*
+ * Initializes the tables used to fold case of strings, for each casemapping
+ * (only chars in range 'A' to 'A' + range are converted to lower case).
+ */
+
+void
+irc_server_casemapping_init ()
+{
+    int i, j;
+
+    for (i = 0; i < IRC_SERVER_NUM_CASEMAPPING; i++)
+    {
+        for (j = 0; j < 256; j++)
+        {
+            irc_server_casemapping_fold[i][j] =
+                ((j >= 'A') && (j < 'A' + irc_server_casemapping_range[i])) ?
+                j + ('a' - 'A') : j;
+        }
+    }
+}
+
+/*
+ * Gets the table used to fold case of strings on a server (depends on
+ * casemapping, default is "rfc1459").
+ */
+
+const unsigned char *
+irc_server_get_casemapping_fold (struct t_irc_server *server)
+{
+    if (server
+        && (server->casemapping >= 0)
+        && (server->casemapping < IRC_SERVER_NUM_CASEMAPPING))
+    {
+        return irc_server_casemapping_fold[server->casemapping];
+    }
+    return irc_server_casemapping_fold[IRC_SERVER_CASEMAPPING_RFC1459];
+}
+
+/*
+ * Sets casemapping on a server and updates the folded names of channels and
+ * nicks.
+ */
+
+void
+irc_server_set_casemapping (struct t_irc_server *server, int casemapping)
+{
+    struct t_irc_channel *ptr_channel;
+    struct t_irc_nick *ptr_nick;
+
+    if (!server
+        || (casemapping < 0) || (casemapping >= IRC_SERVER_NUM_CASEMAPPING)
+        || (casemapping == server->casemapping))
+    {
+        return;
+    }
+
+    server->casemapping = casemapping;
+
+    if (server->channels_hash)
+        weechat_hashtable_remove_all (server->channels_hash);
+
+    /* from last to first channel, so that the first is kept for a name */
+    for (ptr_channel = server->last_channel; ptr_channel;
+         ptr_channel = ptr_channel->prev_channel)
+    {
+        irc_channel_set_name_fold (server, ptr_channel);
+    }
+
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if (ptr_channel->nicks_hash)
+            weechat_hashtable_remove_all (ptr_channel->nicks_hash);
+        for (ptr_nick = ptr_channel->nicks; ptr_nick;
+             ptr_nick = ptr_nick->next_nick)
+        {
+            irc_nick_set_name_fold (server, ptr_channel, ptr_nick);
+        }
+        irc_channel_nick_speaking_time_rehash (server, ptr_channel);
+    }
+}
+
+/*
+ * Folds case of a string on server (depends on casemapping): the result can
+ * be compared to another folded string with strcmp.
+ *
+ * If "buffer" is not NULL and has enough room ("size" bytes), the result is
+ * stored in this buffer (which is returned), otherwise a new string is
+ * allocated (and must be freed after use).
+ *
+ * Returns folded string, NULL if error.
+ */
+
+char *
+irc_server_string_fold (struct t_irc_server *server, const char *string,
+                        char *buffer, int size)
+{
+    const unsigned char *fold;
+    char *result;
+    int i, length;
+
+    if (!string)
+        return NULL;
+
+    fold = irc_server_get_casemapping_fold (server);
+
+    length = strlen (string);
+    result = (buffer && (length < size)) ? buffer : malloc (length + 1);
+    if (!result)
+        return NULL;
+
+    for (i = 0; i < length; i++)
+    {
+        result[i] = fold[(unsigned char)string[i]];
+    }
+    result[length] = '\0';
+
+    return result;
+}
+
 /*
  * Compares two strings on server (case insensitive, depends on casemapping).
  *
+ * Bytes are compared with the table of casemapping: since only ASCII chars
+ * are converted, the order is the same as a comparison of UTF-8 chars.
+ *
  * Returns:
  *   < 0: string1 < string2
  *     0: string1 == string2
@@ -280,25 +469,26 @@ int
 irc_server_strcasecmp (struct t_irc_server *server,
                        const char *string1, const char *string2)
 {
-    int casemapping, rc;
+    const unsigned char *fold, *ptr_string1, *ptr_string2;
+    int diff;
+
+    if (!string1 || !string2)
+        return (string1) ? 1 : ((string2) ? -1 : 0);
 
-    casemapping = (server) ? server->casemapping : IRC_SERVER_CASEMAPPING_RFC1459;
-    switch (casemapping)
+    fold = irc_server_get_casemapping_fold (server);
+
+    ptr_string1 = (const unsigned char *)string1;
+    ptr_string2 = (const unsigned char *)string2;
+    while (ptr_string1[0] && ptr_string2[0])
     {
-        case IRC_SERVER_CASEMAPPING_RFC1459:
-            rc = weechat_strcasecmp_range (string1, string2, 30);
-            break;
-        case IRC_SERVER_CASEMAPPING_STRICT_RFC1459:
-            rc = weechat_strcasecmp_range (string1, string2, 29);
-            break;
-        case IRC_SERVER_CASEMAPPING_ASCII:
-            rc = weechat_strcasecmp (string1, string2);
-            break;
-        default:
-            rc = weechat_strcasecmp_range (string1, string2, 30);
-            break;
+        diff = fold[ptr_string1[0]] - fold[ptr_string2[0]];
+        if (diff != 0)
+            return (diff < 0) ? -1 : 1;
+        ptr_string1++;
+        ptr_string2++;
     }
-    return rc;
+
+    return (ptr_string1[0]) ? 1 : ((ptr_string2[0]) ? -1 : 0);
 }
 
 /*
@@ -315,25 +505,41 @@ int
 irc_server_strncasecmp (struct t_irc_server *server,
                         const char *string1, const char *string2, int max)
 {
-    int casemapping, rc;
+    const unsigned char *fold, *ptr_string1, *ptr_string2;
+    int count, diff;
+
+    if (!string1 || !string2)
+        return (string1) ? 1 : ((string2) ? -1 : 0);
 
-    casemapping = (server) ? server->casemapping : IRC_SERVER_CASEMAPPING_RFC1459;
-    switch (casemapping)
+    fold = irc_server_get_casemapping_fold (server);
+
+    count = 0;
+    ptr_string1 = (const unsigned char *)string1;
+    ptr_string2 = (const unsigned char *)string2;
+    while (ptr_string1[0] && ptr_string2[0])
     {
-        case IRC_SERVER_CASEMAPPING_RFC1459:
-            rc = weechat_strncasecmp_range (string1, string2, max, 30);
-            break;
-        case IRC_SERVER_CASEMAPPING_STRICT_RFC1459:
-            rc = weechat_strncasecmp_range (string1, string2, max, 29);
-            break;
-        case IRC_SERVER_CASEMAPPING_ASCII:
-            rc = weechat_strncasecmp (string1, string2, max);
-            break;
-        default:
-            rc = weechat_strncasecmp_range (string1, string2, max, 30);
-            break;
+        /* count UTF-8 chars (skip continuation bytes) */
+        if ((ptr_string1[0] & 0xC0) != 0x80)
+        {
+            if (count >= max)
+                return 0;
+            count++;
+        }
+        diff = fold[ptr_string1[0]] - fold[ptr_string2[0]];
+        if (diff != 0)
+            return (diff < 0) ? -1 : 1;
+        ptr_string1++;
+        ptr_string2++;
     }
-    return rc;
+
+    if ((count >= max)
+        && ((ptr_string1[0] & 0xC0) != 0x80)
+        && ((ptr_string2[0] & 0xC0) != 0x80))
+    {
+        return 0;
+    }
+
+    return (ptr_string1[0]) ? 1 : ((ptr_string2[0]) ? -1 : 0);
 }
 
 /*
@@ -467,6 +673,80 @@ irc_server_set_addresses (struct t_irc_server *server, const char *addresses)
     }
 }
 
+/*
+ * Sets TLS session data used to resume the session on next connection
+ * (data is copied; NULL or size 0 removes the session data).
+ */
+
+void
+irc_server_tls_session_set (struct t_irc_server *server,
+                            const void *data, int size)
+{
+#ifdef HAVE_GNUTLS
+    if (server->tls_session_data.data)
+    {
+        gnutls_free (server->tls_session_data.data);
+        server->tls_session_data.data = NULL;
+        server->tls_session_data.size = 0;
+    }
+    if (data && (size > 0))
+    {
+        server->tls_session_data.data = gnutls_malloc (size);
+        if (server->tls_session_data.data)
+        {
+            memcpy (server->tls_session_data.data, data, size);
+            server->tls_session_data.size = size;
+        }
+    }
+#else
+    /* make C compiler happy */
+    (void) server;
+    (void) data;
+    (void) size;
+#endif /* HAVE_GNUTLS */
+}
+
+/*
+ * Saves data of current TLS session (to resume it on next connection).
+ */
+
+#ifdef HAVE_GNUTLS
+void
+irc_server_tls_session_save (struct t_irc_server *server)
+{
+    gnutls_datum_t session_data;
+
+    if (gnutls_session_get_data2 (server->gnutls_sess,
+                                  &session_data) != GNUTLS_E_SUCCESS)
+        return;
+
+    irc_server_tls_session_set (server, NULL, 0);
+    server->tls_session_data = session_data;
+}
+#endif /* HAVE_GNUTLS */
+
+/*
+ * Returns number of servers with a connection in progress (connection or
+ * TLS handshake), excluding server "server" (if not NULL).
+ */
+
+int
+irc_server_count_connecting (struct t_irc_server *server)
+{
+    struct t_irc_server *ptr_server;
+    int count;
+
+    count = 0;
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if ((ptr_server != server) && ptr_server->hook_connect)
+            count++;
+    }
+
+    return count;
+}
+
 /*
  * Sets index of current address for server.
  */
@@ -474,6 +754,16 @@ irc_server_set_addresses (struct t_irc_server *server, const char *addresses)
 void
 irc_server_set_index_current_address (struct t_irc_server *server, int index)
 {
+    /* TLS session can only be resumed with the same address/port */
+    if ((server->addresses_count > 0)
+        && (!server->current_address
+            || (strcmp (server->current_address,
+                        server->addresses_array[index % server->addresses_count]) != 0)
+            || (server->current_port != server->ports_array[index % server->addresses_count])))
+    {
+        irc_server_tls_session_set (server, NULL, 0);
+    }
+
     if (server->current_address)
     {
         free (server->current_address);
@@ -1073,6 +1363,7 @@ irc_server_alloc (const char *name)
 
     /* set name */
     new_server->name = strdup (name);
+    irc_server_hash_add (new_server);
 
     /* internal vars */
     new_server->temp_server = 0;
@@ -1090,11 +1381,22 @@ irc_server_alloc (const char *name)
     new_server->sock = -1;
     new_server->hook_connect = NULL;
     new_server->hook_fd = NULL;
+    new_server->reader = NULL;
     new_server->hook_timer_connection = NULL;
     new_server->hook_timer_sasl = NULL;
+    new_server->hook_timer = NULL;
+    new_server->timer_next_time = 0;
     new_server->is_connected = 0;
     new_server->ssl_connected = 0;
+    new_server->ssl_ktls_send = 0;
     new_server->disconnected = 0;
+    new_server->connect_queued = 0;
+#ifdef HAVE_GNUTLS
+    new_server->tls_session_data.data = NULL;
+    new_server->tls_session_data.size = 0;
+#endif /* HAVE_GNUTLS */
+    new_server->recv_buffer = NULL;
+    new_server->recv_size = IRC_SERVER_RECV_SIZE_MIN;
     new_server->unterminated_message = NULL;
     new_server->nicks_count = 0;
     new_server->nicks_array = NULL;
@@ -1131,8 +1433,19 @@ irc_server_alloc (const char *name)
     new_server->lag_last_refresh = 0;
     new_server->cmd_list_regexp = NULL;
     new_server->last_user_message = 0;
+    new_server->anti_flood_tokens = 0;
+    new_server->anti_flood_refill_time = 0;
     new_server->last_away_check = 0;
     new_server->last_data_purge = 0;
+    new_server->stats_start = time (NULL);
+    new_server->stats_bytes_recv = 0;
+    new_server->stats_bytes_sent = 0;
+    new_server->stats_messages_recv = 0;
+    new_server->stats_time_msgq = 0;
+    new_server->stats_time_recv_command = 0;
+    new_server->stats_time_modifiers = 0;
+    new_server->stats_time_signals = 0;
+    new_server->stats_commands = NULL;
     for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
     {
         new_server->outqueue[i] = NULL;
@@ -1140,9 +1453,15 @@ irc_server_alloc (const char *name)
     }
     new_server->redirects = NULL;
     new_server->last_redirect = NULL;
+    new_server->redirects_cmd = NULL;
+    new_server->redirects_in_progress = 0;
+    new_server->batches = NULL;
+    new_server->last_batch = NULL;
     new_server->notify_list = NULL;
     new_server->last_notify = NULL;
     new_server->notify_count = 0;
+    new_server->notify_ison = NULL;
+    new_server->notify_ison_count = 0;
     new_server->join_manual = weechat_hashtable_new (
         32,
         WEECHAT_HASHTABLE_STRING,
@@ -1162,6 +1481,7 @@ irc_server_alloc (const char *name)
     new_server->buffer_as_string = NULL;
     new_server->channels = NULL;
     new_server->last_channel = NULL;
+    new_server->channels_hash = NULL;
 
     /* create options with null value */
     for (i = 0; i < IRC_SERVER_NUM_OPTIONS; i++)
@@ -1469,8 +1789,75 @@ irc_server_apply_command_line_options (struct t_irc_server *server,
     }
 }
 
+/*
+ * Gets an entry for out queue, with room for "data_size" bytes after the
+ * struct: an entry is reused from the pool if possible, otherwise a new
+ * entry is allocated.
+ *
+ * Returns pointer to entry, NULL if error.
+ */
+
+struct t_irc_outqueue *
+irc_server_outqueue_alloc (int data_size)
+{
+    struct t_irc_outqueue *ptr_outqueue, *prev_outqueue;
+
+    prev_outqueue = NULL;
+    for (ptr_outqueue = irc_server_outqueue_pool; ptr_outqueue;
+         ptr_outqueue = ptr_outqueue->next_outqueue)
+    {
+        if (ptr_outqueue->data_size >= data_size)
+        {
+            if (prev_outqueue)
+                prev_outqueue->next_outqueue = ptr_outqueue->next_outqueue;
+            else
+                irc_server_outqueue_pool = ptr_outqueue->next_outqueue;
+            irc_server_outqueue_pool_count--;
+            return ptr_outqueue;
+        }
+        prev_outqueue = ptr_outqueue;
+    }
+
+    if (data_size < IRC_SERVER_OUTQUEUE_DATA_SIZE)
+        data_size = IRC_SERVER_OUTQUEUE_DATA_SIZE;
+
+    ptr_outqueue = malloc (sizeof (*ptr_outqueue) + data_size);
+    if (!ptr_outqueue)
+        return NULL;
+
+    ptr_outqueue->data_size = data_size;
+
+    return ptr_outqueue;
+}
+
+/*
+ * Copies a string in data of an out queue entry.
+ *
+ * Returns pointer to string copied, NULL if string is NULL.
+ */
+
+char *
+irc_server_outqueue_copy_string (char **ptr_data, const char *string)
+{
+    char *ptr_string;
+    int length;
+
+    if (!string)
+        return NULL;
+
+    length = strlen (string) + 1;
+    memcpy (*ptr_data, string, length);
+    ptr_string = *ptr_data;
+    *ptr_data += length;
+
+    return ptr_string;
+}
+
 /*
  * Adds a message in out queue.
+ *
+ * Strings are copied in the entry itself (only one allocation per message,
+ * and entries are reused from the pool).
  */
 
 void
@@ -1480,15 +1867,33 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
                          struct t_irc_redirect *redirect)
 {
     struct t_irc_outqueue *new_outqueue;
+    char *ptr_data;
+    int data_size;
+
+    if (!command)
+        command = "unknown";
+
+    data_size = strlen (command) + 1;
+    if (msg1)
+        data_size += strlen (msg1) + 1;
+    if (msg2)
+        data_size += strlen (msg2) + 1;
+    if (tags)
+        data_size += strlen (tags) + 1;
 
-    new_outqueue = malloc (sizeof (*new_outqueue));
+    new_outqueue = irc_server_outqueue_alloc (data_size);
     if (new_outqueue)
     {
-        new_outqueue->command = (command) ? strdup (command) : strdup ("unknown");
-        new_outqueue->message_before_mod = (msg1) ? strdup (msg1) : NULL;
-        new_outqueue->message_after_mod = (msg2) ? strdup (msg2) : NULL;
+        ptr_data = (char *)(new_outqueue + 1);
+        new_outqueue->command = irc_server_outqueue_copy_string (&ptr_data,
+                                                                 command);
+        new_outqueue->message_before_mod = irc_server_outqueue_copy_string (
+            &ptr_data, msg1);
+        new_outqueue->message_after_mod = irc_server_outqueue_copy_string (
+            &ptr_data, msg2);
         new_outqueue->modified = modified;
-        new_outqueue->tags = (tags) ? strdup (tags) : NULL;
+        new_outqueue->tags = irc_server_outqueue_copy_string (&ptr_data,
+                                                              tags);
         new_outqueue->redirect = redirect;
 
         new_outqueue->prev_outqueue = server->last_outqueue[priority];
@@ -1502,7 +1907,8 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
 }
 
 /*
- * Frees a message in out queue.
+ * Frees a message in out queue (the entry is kept in the pool for reuse, if
+ * the pool is not full).
  */
 
 void
@@ -1526,21 +1932,41 @@ irc_server_outqueue_free (struct t_irc_server *server,
     if (outqueue->next_outqueue)
         (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
 
-    /* free data */
-    if (outqueue->command)
-        free (outqueue->command);
-    if (outqueue->message_before_mod)
-        free (outqueue->message_before_mod);
-    if (outqueue->message_after_mod)
-        free (outqueue->message_after_mod);
-    if (outqueue->tags)
-        free (outqueue->tags);
-    free (outqueue);
+    /* keep entry in pool or free it (strings are in the entry) */
+    if (irc_server_outqueue_pool_count < IRC_SERVER_OUTQUEUE_POOL_MAX)
+    {
+        outqueue->prev_outqueue = NULL;
+        outqueue->next_outqueue = irc_server_outqueue_pool;
+        irc_server_outqueue_pool = outqueue;
+        irc_server_outqueue_pool_count++;
+    }
+    else
+    {
+        free (outqueue);
+    }
 
     /* set new head */
     server->outqueue[priority] = new_outqueue;
 }
 
+/*
+ * Frees all entries in pool of out queue.
+ */
+
+void
+irc_server_outqueue_pool_free ()
+{
+    struct t_irc_outqueue *next_outqueue;
+
+    while (irc_server_outqueue_pool)
+    {
+        next_outqueue = irc_server_outqueue_pool->next_outqueue;
+        free (irc_server_outqueue_pool);
+        irc_server_outqueue_pool = next_outqueue;
+    }
+    irc_server_outqueue_pool_count = 0;
+}
+
 /*
  * Frees all messages in out queue.
  */
@@ -1573,10 +1999,23 @@ irc_server_free_data (struct t_irc_server *server)
         irc_server_outqueue_free_all (server, i);
     }
     irc_redirect_free_all (server);
+    if (server->redirects_cmd)
+    {
+        weechat_hashtable_free (server->redirects_cmd);
+        server->redirects_cmd = NULL;
+    }
+    irc_batch_free_all (server);
     irc_notify_free_all (server);
     irc_channel_free_all (server);
+    if (server->stats_commands)
+    {
+        weechat_hashtable_free (server->stats_commands);
+        server->stats_commands = NULL;
+    }
 
     /* free hashtables */
+    if (server->channels_hash)
+        weechat_hashtable_free (server->channels_hash);
     weechat_hashtable_free (server->join_manual);
     weechat_hashtable_free (server->join_channel_key);
     weechat_hashtable_free (server->join_noswitch);
@@ -1599,16 +2038,20 @@ irc_server_free_data (struct t_irc_server *server)
         free (server->current_address);
     if (server->current_ip)
         free (server->current_ip);
+    irc_server_tls_session_set (server, NULL, 0);
     if (server->hook_connect)
         weechat_unhook (server->hook_connect);
     if (server->hook_fd)
         weechat_unhook (server->hook_fd);
+    irc_reader_stop (server, 0);
     if (server->hook_timer_connection)
         weechat_unhook (server->hook_timer_connection);
     if (server->hook_timer_sasl)
         weechat_unhook (server->hook_timer_sasl);
-    if (server->unterminated_message)
-        free (server->unterminated_message);
+    if (server->hook_timer)
+        weechat_unhook (server->hook_timer);
+    if (server->recv_buffer)
+        irc_server_recv_buffer_unref (server->recv_buffer);
     if (server->nicks_array)
         weechat_string_free_split (server->nicks_array);
     if (server->nick)
@@ -1629,7 +2072,7 @@ irc_server_free_data (struct t_irc_server *server)
         free (server->away_message);
     if (server->cmd_list_regexp)
     {
-        regfree (server->cmd_list_regexp);
+        weechat_string_regfree (server->cmd_list_regexp);
         free (server->cmd_list_regexp);
     }
     if (server->buffer_as_string)
@@ -1670,6 +2113,8 @@ irc_server_free (struct t_irc_server *server)
     if (server->next_server)
         (server->next_server)->prev_server = server->prev_server;
 
+    irc_server_hash_remove (server);
+
     irc_server_free_data (server);
     free (server);
     irc_servers = new_irc_servers;
@@ -1687,6 +2132,12 @@ irc_server_free_all ()
     {
         irc_server_free (irc_servers);
     }
+
+    if (irc_servers_hash)
+    {
+        weechat_hashtable_free (irc_servers_hash);
+        irc_servers_hash = NULL;
+    }
 }
 
 /*
@@ -1810,9 +2261,11 @@ irc_server_rename (struct t_irc_server *server, const char *new_name)
     }
 
     /* rename server */
+    irc_server_hash_remove (server);
     if (server->name)
         free (server->name);
     server->name = strdup (new_name);
+    irc_server_hash_add (server);
 
     /* change name and local variables on buffers */
     for (ptr_channel = server->channels; ptr_channel;
@@ -1915,11 +2368,13 @@ irc_server_send_signal (struct t_irc_server *server, const char *signal,
 {
     int length;
     char *str_signal, *full_message_tags;
+    struct timeval tv_start, tv_end;
 
     length = strlen (server->name) + 1 + strlen (signal) + 1 + strlen (command) + 1;
     str_signal = malloc (length);
     if (str_signal)
     {
+        gettimeofday (&tv_start, NULL);
         snprintf (str_signal, length,
                   "%s,%s_%s", server->name, signal, command);
         if (tags)
@@ -1942,6 +2397,9 @@ irc_server_send_signal (struct t_irc_server *server, const char *signal,
                                              WEECHAT_HOOK_SIGNAL_STRING,
                                              (void *)full_message);
         }
+        gettimeofday (&tv_end, NULL);
+        server->stats_time_signals += weechat_util_timeval_diff (&tv_start,
+                                                                 &tv_end);
         free (str_signal);
     }
 }
@@ -1977,8 +2435,9 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
         return 0;
     }
 
+    /* with kernel TLS, data is encrypted by the kernel */
 #ifdef HAVE_GNUTLS
-    if (server->ssl_connected)
+    if (server->ssl_connected && !server->ssl_ktls_send)
         rc = gnutls_record_send (server->gnutls_sess, buffer, size_buf);
     else
 #endif /* HAVE_GNUTLS */
@@ -1987,7 +2446,7 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
     if (rc < 0)
     {
 #ifdef HAVE_GNUTLS
-        if (server->ssl_connected)
+        if (server->ssl_connected && !server->ssl_ktls_send)
         {
             weechat_printf (
                 server->buffer,
@@ -2005,6 +2464,10 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
                 errno, strerror (errno));
         }
     }
+    else
+    {
+        server->stats_bytes_sent += rc;
+    }
 
     return rc;
 }
@@ -2050,96 +2513,196 @@ irc_server_get_tags_to_send (const char *tags)
 }
 
 /*
- * Sends a message from out queue.
+ * Refills tokens of anti-flood (token bucket): one token is added after each
+ * delay of option "anti_flood_prio_high", up to option "anti_flood_burst"
+ * tokens.
  */
 
 void
-irc_server_outqueue_send (struct t_irc_server *server)
+irc_server_anti_flood_refill (struct t_irc_server *server, time_t time_now)
 {
-    time_t time_now;
-    char *pos, *tags_to_send;
-    int priority, anti_flood;
+    int burst, delay, tokens_added;
 
-    time_now = time (NULL);
-
-    /* detect if system clock has been changed (now lower than before) */
-    if (server->last_user_message > time_now)
-        server->last_user_message = time_now;
+    burst = IRC_SERVER_OPTION_INTEGER(server,
+                                      IRC_SERVER_OPTION_ANTI_FLOOD_BURST);
+    if (burst < 1)
+        burst = 1;
+    delay = IRC_SERVER_OPTION_INTEGER(server,
+                                      IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
 
-    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    /* first use or no delay: bucket is full */
+    if ((server->anti_flood_refill_time == 0) || (delay <= 0))
     {
-        switch (priority)
-        {
-            case 0:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(
-                    server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                break;
-            default:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(
-                    server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                break;
-        }
-        if (server->outqueue[priority]
-            && (time_now >= server->last_user_message + anti_flood))
-        {
-            if (server->outqueue[priority]->message_before_mod)
-            {
-                pos = strchr (server->outqueue[priority]->message_before_mod,
-                              '\r');
-                if (pos)
-                    pos[0] = '\0';
-                irc_raw_print (server, IRC_RAW_FLAG_SEND,
-                               server->outqueue[priority]->message_before_mod);
-                if (pos)
-                    pos[0] = '\r';
-            }
-            if (server->outqueue[priority]->message_after_mod)
-            {
-                pos = strchr (server->outqueue[priority]->message_after_mod,
-                              '\r');
-                if (pos)
-                    pos[0] = '\0';
-                irc_raw_print (server, IRC_RAW_FLAG_SEND |
-                               ((server->outqueue[priority]->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
-                               server->outqueue[priority]->message_after_mod);
-                if (pos)
-                    pos[0] = '\r';
+        server->anti_flood_tokens = burst;
+        server->anti_flood_refill_time = time_now;
+        return;
+    }
 
-                /* send signal with command that will be sent to server */
-                irc_server_send_signal (
-                    server, "irc_out",
-                    server->outqueue[priority]->command,
-                    server->outqueue[priority]->message_after_mod,
-                    NULL);
-                tags_to_send = irc_server_get_tags_to_send (
-                    server->outqueue[priority]->tags);
-                irc_server_send_signal (
-                    server, "irc_outtags",
-                    server->outqueue[priority]->command,
-                    server->outqueue[priority]->message_after_mod,
-                    (tags_to_send) ? tags_to_send : "");
-                if (tags_to_send)
-                    free (tags_to_send);
+    /* detect if system clock has been changed (now lower than before) */
+    if (server->anti_flood_refill_time > time_now)
+        server->anti_flood_refill_time = time_now;
 
-                /* send command */
-                irc_server_send (
-                    server, server->outqueue[priority]->message_after_mod,
-                    strlen (server->outqueue[priority]->message_after_mod));
-                server->last_user_message = time_now;
+    tokens_added = (time_now - server->anti_flood_refill_time) / delay;
+    if (tokens_added > 0)
+    {
+        server->anti_flood_tokens += tokens_added;
+        server->anti_flood_refill_time += tokens_added * delay;
+    }
+    if (server->anti_flood_tokens >= burst)
+    {
+        server->anti_flood_tokens = burst;
+        server->anti_flood_refill_time = time_now;
+    }
+}
 
-                /* start redirection if redirect is set */
-                if (server->outqueue[priority]->redirect)
-                {
-                    irc_redirect_init_command (
-                        server->outqueue[priority]->redirect,
-                        server->outqueue[priority]->message_after_mod);
-                }
-            }
-            irc_server_outqueue_free (server, priority,
-                                      server->outqueue[priority]);
-            break;
+/*
+ * Checks if a message with given priority can be sent now (anti-flood).
+ *
+ * Messages with high priority can be sent if there is a token available,
+ * messages with low priority need a token and the delay of option
+ * "anti_flood_prio_low" after the last message sent.
+ *
+ * Returns:
+ *   1: message can be sent now
+ *   0: message must be queued
+ */
+
+int
+irc_server_anti_flood_check (struct t_irc_server *server, int priority,
+                             time_t time_now)
+{
+    int anti_flood;
+
+    anti_flood = IRC_SERVER_OPTION_INTEGER(
+        server,
+        (priority == 0) ?
+        IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH :
+        IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
+    if (anti_flood <= 0)
+        return 1;
+
+    irc_server_anti_flood_refill (server, time_now);
+    if (server->anti_flood_tokens <= 0)
+        return 0;
+
+    if ((priority > 0)
+        && (time_now - server->last_user_message < anti_flood))
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Uses a token of anti-flood (message sent to server).
+ */
+
+void
+irc_server_anti_flood_use (struct t_irc_server *server, time_t time_now)
+{
+    irc_server_anti_flood_refill (server, time_now);
+    if (server->anti_flood_tokens > 0)
+        server->anti_flood_tokens--;
+    server->last_user_message = time_now;
+}
+
+/*
+ * Sends first message from out queue with given priority.
+ */
+
+void
+irc_server_outqueue_send_one (struct t_irc_server *server, int priority,
+                              time_t time_now)
+{
+    char *pos, *tags_to_send;
+
+    if (server->outqueue[priority]->message_before_mod)
+    {
+        pos = strchr (server->outqueue[priority]->message_before_mod, '\r');
+        if (pos)
+            pos[0] = '\0';
+        irc_raw_print (server, IRC_RAW_FLAG_SEND,
+                       server->outqueue[priority]->message_before_mod);
+        if (pos)
+            pos[0] = '\r';
+    }
+    if (server->outqueue[priority]->message_after_mod)
+    {
+        pos = strchr (server->outqueue[priority]->message_after_mod, '\r');
+        if (pos)
+            pos[0] = '\0';
+        irc_raw_print (server, IRC_RAW_FLAG_SEND |
+                       ((server->outqueue[priority]->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
+                       server->outqueue[priority]->message_after_mod);
+        if (pos)
+            pos[0] = '\r';
+
+        /* send signal with command that will be sent to server */
+        irc_server_send_signal (
+            server, "irc_out",
+            server->outqueue[priority]->command,
+            server->outqueue[priority]->message_after_mod,
+            NULL);
+        tags_to_send = irc_server_get_tags_to_send (
+            server->outqueue[priority]->tags);
+        irc_server_send_signal (
+            server, "irc_outtags",
+            server->outqueue[priority]->command,
+            server->outqueue[priority]->message_after_mod,
+            (tags_to_send) ? tags_to_send : "");
+        if (tags_to_send)
+            free (tags_to_send);
+
+        /* send command */
+        irc_server_send (
+            server, server->outqueue[priority]->message_after_mod,
+            strlen (server->outqueue[priority]->message_after_mod));
+        irc_server_anti_flood_use (server, time_now);
+
+        /* start redirection if redirect is set */
+        if (server->outqueue[priority]->redirect)
+        {
+            irc_redirect_init_command (
+                server->outqueue[priority]->redirect,
+                server->outqueue[priority]->message_after_mod);
         }
     }
+    irc_server_outqueue_free (server, priority, server->outqueue[priority]);
+}
+
+/*
+ * Sends messages from out queue, as many as allowed by anti-flood (high
+ * priority messages first).
+ */
+
+void
+irc_server_outqueue_send (struct t_irc_server *server)
+{
+    time_t time_now;
+    int priority, message_sent;
+
+    time_now = time (NULL);
+
+    /* detect if system clock has been changed (now lower than before) */
+    if (server->last_user_message > time_now)
+        server->last_user_message = time_now;
+
+    do
+    {
+        message_sent = 0;
+        for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO;
+             priority++)
+        {
+            if (server->outqueue[priority]
+                && irc_server_anti_flood_check (server, priority, time_now))
+            {
+                irc_server_outqueue_send_one (server, priority, time_now);
+                message_sent = 1;
+                break;
+            }
+        }
+    } while (message_sent && server->is_connected);
 }
 
 /*
@@ -2166,7 +2729,7 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     const char *ptr_msg, *ptr_chan_nick;
     char *new_msg, *pos, *tags_to_send, *msg_encoded;
     char str_modifier[128], modifier_data[256];
-    int rc, queue_msg, add_to_queue, first_message, anti_flood;
+    int rc, queue_msg, add_to_queue, first_message;
     int pos_channel, pos_text, pos_encode;
     time_t time_now;
     struct t_irc_redirect *ptr_redirect;
@@ -2177,9 +2740,9 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     snprintf (str_modifier, sizeof (str_modifier),
               "irc_out_%s",
               (command) ? command : "unknown");
-    new_msg = weechat_hook_modifier_exec (str_modifier,
-                                          server->name,
-                                          message);
+    new_msg = (weechat_hook_modifier_exists (str_modifier)) ?
+        weechat_hook_modifier_exec (str_modifier, server->name, message) :
+        NULL;
 
     /* no changes in new message */
     if (new_msg && (strcmp (message, new_msg) == 0))
@@ -2249,23 +2812,11 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
             else if (flags & IRC_SERVER_SEND_OUTQ_PRIO_LOW)
                 queue_msg = 2;
 
-            switch (queue_msg - 1)
-            {
-                case 0:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(
-                        server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                    break;
-                default:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(
-                        server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                    break;
-            }
-
             add_to_queue = 0;
             if ((queue_msg > 0)
                 && (server->outqueue[queue_msg - 1]
-                    || ((anti_flood > 0)
-                        && (time_now - server->last_user_message < anti_flood))))
+                    || !irc_server_anti_flood_check (server, queue_msg - 1,
+                                                     time_now)))
             {
                 add_to_queue = queue_msg;
             }
@@ -2315,7 +2866,7 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
                 else
                 {
                     if (queue_msg > 0)
-                        server->last_user_message = time_now;
+                        irc_server_anti_flood_use (server, time_now);
                 }
                 if (ptr_redirect)
                     irc_redirect_init_command (ptr_redirect, buffer);
@@ -2349,6 +2900,55 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     return rc;
 }
 
+/*
+ * Callback for split of a message sent by irc_server_sendf: sends a split
+ * message to server (the message is queued if needed).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (split is stopped)
+ */
+
+int
+irc_server_send_split_cb (void *data, int number, const char *message,
+                          const char *arguments)
+{
+    struct t_irc_server_send_split *send_split;
+    char hash_key[32];
+
+    /* make C compiler happy */
+    (void) number;
+
+    send_split = (struct t_irc_server_send_split *)data;
+
+    send_split->rc = irc_server_send_one_msg (send_split->server,
+                                              send_split->flags,
+                                              message,
+                                              send_split->nick,
+                                              send_split->command,
+                                              send_split->channel,
+                                              send_split->tags);
+    if (!send_split->rc)
+        return 0;
+
+    if (send_split->ret_hashtable)
+    {
+        snprintf (hash_key, sizeof (hash_key),
+                  "msg%d", send_split->ret_number);
+        weechat_hashtable_set (send_split->ret_hashtable, hash_key, message);
+        if (arguments)
+        {
+            snprintf (hash_key, sizeof (hash_key),
+                      "args%d", send_split->ret_number);
+            weechat_hashtable_set (send_split->ret_hashtable,
+                                   hash_key, arguments);
+        }
+    }
+    send_split->ret_number++;
+
+    return 1;
+}
+
 /*
  * Sends formatted data to IRC server.
  *
@@ -2365,11 +2965,10 @@ struct t_hashtable *
 irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
                   const char *format, ...)
 {
-    char **items, hash_key[32], value[32], *nick, *command, *channel, *new_msg;
+    char **items, value[32], *nick, *command, *channel, *new_msg;
     char str_modifier[128];
-    const char *str_message, *str_args;
-    int i, items_count, number, ret_number, rc;
-    struct t_hashtable *hashtable, *ret_hashtable;
+    int i, items_count;
+    struct t_irc_server_send_split send_split;
 
     if (!server)
         return NULL;
@@ -2378,17 +2977,21 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
     if (!vbuffer)
         return NULL;
 
-    ret_hashtable = NULL;
-    ret_number = 1;
+    send_split.server = server;
+    send_split.flags = flags;
+    send_split.tags = tags;
+    send_split.ret_hashtable = NULL;
+    send_split.ret_number = 1;
+    send_split.rc = 1;
     if (flags & IRC_SERVER_SEND_RETURN_HASHTABLE)
     {
-        ret_hashtable = weechat_hashtable_new (32,
-                                               WEECHAT_HASHTABLE_STRING,
-                                               WEECHAT_HASHTABLE_STRING,
-                                               NULL, NULL);
+        send_split.ret_hashtable = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_STRING,
+            NULL, NULL);
     }
 
-    rc = 1;
     items = weechat_string_split (vbuffer, "\n", 0, 0, &items_count);
     for (i = 0; i < items_count; i++)
     {
@@ -2399,9 +3002,10 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
         snprintf (str_modifier, sizeof (str_modifier),
                   "irc_out1_%s",
                   (command) ? command : "unknown");
-        new_msg = weechat_hook_modifier_exec (str_modifier,
-                                              server->name,
-                                              items[i]);
+        new_msg = (weechat_hook_modifier_exists (str_modifier)) ?
+            weechat_hook_modifier_exec (str_modifier, server->name,
+                                        items[i]) :
+            NULL;
 
         /* no changes in new message */
         if (new_msg && (strcmp (items[i], new_msg) == 0))
@@ -2419,52 +3023,17 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
                                     (new_msg) ? new_msg : items[i],
                                     NULL);
 
-            /* split message if needed (max is 512 bytes including final "\r\n") */
-            hashtable = irc_message_split (server,
-                                           (new_msg) ? new_msg : items[i]);
-            if (hashtable)
-            {
-                number = 1;
-                while (1)
-                {
-                    snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                    str_message = weechat_hashtable_get (hashtable, hash_key);
-                    if (!str_message)
-                        break;
-                    snprintf (hash_key, sizeof (hash_key), "args%d", number);
-                    str_args = weechat_hashtable_get (hashtable, hash_key);
-
-                    rc = irc_server_send_one_msg (server, flags, str_message,
-                                                  nick, command, channel, tags);
-                    if (!rc)
-                        break;
-
-                    if (ret_hashtable)
-                    {
-                        snprintf (hash_key, sizeof (hash_key),
-                                  "msg%d", ret_number);
-                        weechat_hashtable_set (ret_hashtable,
-                                               hash_key, str_message);
-                        if (str_args)
-                        {
-                            snprintf (hash_key, sizeof (hash_key),
-                                      "args%d", ret_number);
-                            weechat_hashtable_set (ret_hashtable,
-                                                   hash_key, str_args);
-                        }
-                        ret_number++;
-                    }
-                    number++;
-                }
-                if (ret_hashtable)
-                {
-                    snprintf (value, sizeof (value), "%d", ret_number - 1);
-                    weechat_hashtable_set (ret_hashtable, "count", value);
-                }
-                weechat_hashtable_free (hashtable);
-                if (!rc)
-                    break;
-            }
+            /*
+             * split message if needed (max is 512 bytes including final
+             * "\r\n") and send each split message to server
+             */
+            send_split.nick = nick;
+            send_split.command = command;
+            send_split.channel = channel;
+            irc_message_split_run (server,
+                                   (new_msg) ? new_msg : items[i],
+                                   &irc_server_send_split_cb,
+                                   &send_split);
         }
         if (nick)
             free (nick);
@@ -2474,27 +3043,151 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
             free (channel);
         if (new_msg)
             free (new_msg);
+        if (!send_split.rc)
+            break;
     }
     if (items)
         weechat_string_free_split (items);
 
+    if (send_split.ret_hashtable)
+    {
+        snprintf (value, sizeof (value), "%d", send_split.ret_number - 1);
+        weechat_hashtable_set (send_split.ret_hashtable, "count", value);
+    }
+
+    /* messages may be queued or redirects started */
+    irc_server_timer_schedule (server);
+
     free (vbuffer);
 
-    return ret_hashtable;
+    return send_split.ret_hashtable;
+}
+
+/*
+ * Decrements number of users of a buffer with received data, and frees it if
+ * it is not used any more.
+ */
+
+void
+irc_server_recv_buffer_unref (struct t_irc_recv_buffer *recv_buffer)
+{
+    if (!recv_buffer)
+        return;
+
+    recv_buffer->refcount--;
+    if (recv_buffer->refcount <= 0)
+    {
+        if (recv_buffer->data)
+            free (recv_buffer->data);
+        free (recv_buffer);
+    }
+}
+
+/*
+ * Reserves space at the end of buffer with received data of a server.
+ *
+ * If the buffer is used only by the server, the unterminated message is
+ * moved at beginning of buffer and the buffer is enlarged if needed;
+ * otherwise (messages in queue are pointers to data in buffer) a new buffer
+ * is allocated, with a copy of the unterminated message.
+ *
+ * Returns pointer to free space for "size" bytes (plus a final '\0'), NULL
+ * if error.
+ */
+
+char *
+irc_server_recv_buffer_reserve (struct t_irc_server *server, int size)
+{
+    struct t_irc_recv_buffer *ptr_recv_buffer, *new_recv_buffer;
+    int length_unterminated, new_size;
+    char *new_data;
+
+    ptr_recv_buffer = server->recv_buffer;
+
+    if (ptr_recv_buffer
+        && (ptr_recv_buffer->length + size + 1 <= ptr_recv_buffer->size))
+    {
+        return ptr_recv_buffer->data + ptr_recv_buffer->length;
+    }
+
+    length_unterminated = (ptr_recv_buffer) ?
+        ptr_recv_buffer->length - ptr_recv_buffer->pos_unterminated : 0;
+    new_size = IRC_SERVER_RECV_SIZE_MIN * 4;
+    while (new_size < length_unterminated + size + 1)
+    {
+        new_size *= 2;
+    }
+
+    if (ptr_recv_buffer && (ptr_recv_buffer->refcount == 1))
+    {
+        /* buffer used only by server: move unterminated message */
+        if (ptr_recv_buffer->pos_unterminated > 0)
+        {
+            memmove (ptr_recv_buffer->data,
+                     ptr_recv_buffer->data + ptr_recv_buffer->pos_unterminated,
+                     length_unterminated);
+            ptr_recv_buffer->length = length_unterminated;
+            ptr_recv_buffer->pos_unterminated = 0;
+        }
+        if (ptr_recv_buffer->length + size + 1 > ptr_recv_buffer->size)
+        {
+            new_data = realloc (ptr_recv_buffer->data, new_size);
+            if (!new_data)
+                return NULL;
+            ptr_recv_buffer->data = new_data;
+            ptr_recv_buffer->size = new_size;
+        }
+    }
+    else
+    {
+        /* new buffer (messages in queue still use the current buffer) */
+        new_recv_buffer = malloc (sizeof (*new_recv_buffer));
+        if (!new_recv_buffer)
+            return NULL;
+        new_recv_buffer->data = malloc (new_size);
+        if (!new_recv_buffer->data)
+        {
+            free (new_recv_buffer);
+            return NULL;
+        }
+        new_recv_buffer->size = new_size;
+        new_recv_buffer->length = length_unterminated;
+        new_recv_buffer->pos_unterminated = 0;
+        new_recv_buffer->refcount = 1;
+        if (length_unterminated > 0)
+        {
+            memcpy (new_recv_buffer->data,
+                    ptr_recv_buffer->data + ptr_recv_buffer->pos_unterminated,
+                    length_unterminated);
+        }
+        irc_server_recv_buffer_unref (ptr_recv_buffer);
+        server->recv_buffer = new_recv_buffer;
+        ptr_recv_buffer = new_recv_buffer;
+    }
+
+    ptr_recv_buffer->data[ptr_recv_buffer->length] = '\0';
+    server->unterminated_message = (length_unterminated > 0) ?
+        ptr_recv_buffer->data : NULL;
+
+    return ptr_recv_buffer->data + ptr_recv_buffer->length;
 }
 
 /*
  * Adds a message to received messages queue (at the end).
+ *
+ * The message must be in the buffer with received data of server (the
+ * message is not copied).
+ *
+ * Argument "date_recv" is the date of reception of message on socket (NULL
+ * if unknown), used by latency tracing (see command "/debug latency").
  */
 
 void
-irc_server_msgq_add_msg (struct t_irc_server *server, const char *msg)
+irc_server_msgq_add_msg (struct t_irc_server *server, char *msg,
+                         struct timeval *date_recv)
 {
     struct t_irc_message *message;
 
-    if (!server->unterminated_message && !msg[0])
-        return;
-
     message = malloc (sizeof (*message));
     if (!message)
     {
@@ -2504,27 +3197,18 @@ irc_server_msgq_add_msg (struct t_irc_server *server, const char *msg)
         return;
     }
     message->server = server;
-    if (server->unterminated_message)
+    message->recv_buffer = server->recv_buffer;
+    message->recv_buffer->refcount++;
+    message->data = msg;
+    if (date_recv)
     {
-        message->data = malloc (strlen (server->unterminated_message) +
-                                strlen (msg) + 1);
-        if (!message->data)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        }
-        else
-        {
-            strcpy (message->data, server->unterminated_message);
-            strcat (message->data, msg);
-        }
-        free (server->unterminated_message);
-        server->unterminated_message = NULL;
+        message->date_recv = *date_recv;
     }
     else
-        message->data = strdup (msg);
-
+    {
+        message->date_recv.tv_sec = 0;
+        message->date_recv.tv_usec = 0;
+    }
     message->next_message = NULL;
 
     if (irc_msgq_last_msg)
@@ -2540,102 +3224,408 @@ irc_server_msgq_add_msg (struct t_irc_server *server, const char *msg)
 }
 
 /*
- * Adds an unterminated message to queue.
+ * Splits data received (added at the end of buffer with received data of
+ * server, after a call to irc_server_recv_buffer_reserve), creating queued
+ * messages.
+ *
+ * Messages are terminated in place (chars '\r' are removed), and the end of
+ * data without '\n' is kept as unterminated message.
+ *
+ * Argument "date_recv" is the date of reception of data (NULL if unknown).
+ */
+
+void
+irc_server_msgq_add_received (struct t_irc_server *server, int length,
+                              struct timeval *date_recv)
+{
+    struct t_irc_recv_buffer *ptr_recv_buffer;
+    char *ptr_data, *ptr_end, *pos_lf, *ptr_msg, *ptr_src, *ptr_dst;
+
+    ptr_recv_buffer = server->recv_buffer;
+    if (!ptr_recv_buffer || (length <= 0))
+        return;
+
+    TRACE2(irc_recv, server->name, length);
+
+    ptr_data = ptr_recv_buffer->data + ptr_recv_buffer->length;
+    ptr_recv_buffer->length += length;
+    ptr_end = ptr_recv_buffer->data + ptr_recv_buffer->length;
+    ptr_end[0] = '\0';
+
+    while ((pos_lf = memchr (ptr_data, '\n', ptr_end - ptr_data)) != NULL)
+    {
+        /* terminate message, without chars '\r' */
+        ptr_msg = ptr_recv_buffer->data + ptr_recv_buffer->pos_unterminated;
+        ptr_dst = ptr_msg;
+        for (ptr_src = ptr_msg; ptr_src < pos_lf; ptr_src++)
+        {
+            if (ptr_src[0] != '\r')
+            {
+                ptr_dst[0] = ptr_src[0];
+                ptr_dst++;
+            }
+        }
+        ptr_dst[0] = '\0';
+        if (ptr_msg[0])
+            irc_server_msgq_add_msg (server, ptr_msg, date_recv);
+        ptr_data = pos_lf + 1;
+        ptr_recv_buffer->pos_unterminated = ptr_data - ptr_recv_buffer->data;
+    }
+
+    server->unterminated_message =
+        (ptr_recv_buffer->pos_unterminated < ptr_recv_buffer->length) ?
+        ptr_recv_buffer->data + ptr_recv_buffer->pos_unterminated : NULL;
+}
+
+/*
+ * Adds a buffer to buffer with received data of server, and splits it,
+ * creating queued messages.
+ */
+
+void
+irc_server_msgq_add_buffer (struct t_irc_server *server, const char *buffer)
+{
+    char *ptr_data;
+    int length;
+
+    length = strlen (buffer);
+    if (length == 0)
+        return;
+
+    ptr_data = irc_server_recv_buffer_reserve (server, length);
+    if (!ptr_data)
+    {
+        weechat_printf (server->buffer,
+                        _("%s%s: not enough memory for received message"),
+                        weechat_prefix ("error"), IRC_PLUGIN_NAME);
+        return;
+    }
+    memcpy (ptr_data, buffer, length);
+    irc_server_msgq_add_received (server, length, NULL);
+}
+
+/*
+ * Callback used to free stats of a command.
+ */
+
+void
+irc_server_stats_free_command_cb (struct t_hashtable *hashtable,
+                                  const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    free (value);
+}
+
+/*
+ * Adds processing cost of a received message in stats of server, command
+ * and channel.
+ */
+
+void
+irc_server_stats_add_message (struct t_irc_server *server,
+                              const char *command, const char *channel,
+                              int bytes, long time_usec)
+{
+    struct t_irc_server_stats_command *ptr_stats;
+    struct t_irc_channel *ptr_channel;
+
+    server->stats_time_recv_command += time_usec;
+
+    if (command)
+    {
+        if (!server->stats_commands)
+        {
+            server->stats_commands = weechat_hashtable_new (
+                32,
+                WEECHAT_HASHTABLE_STRING,
+                WEECHAT_HASHTABLE_POINTER,
+                NULL, NULL);
+            if (!server->stats_commands)
+                return;
+            weechat_hashtable_set_pointer (server->stats_commands,
+                                           "callback_free_value",
+                                           &irc_server_stats_free_command_cb);
+        }
+        ptr_stats = weechat_hashtable_get (server->stats_commands, command);
+        if (!ptr_stats)
+        {
+            ptr_stats = malloc (sizeof (*ptr_stats));
+            if (ptr_stats)
+            {
+                ptr_stats->count = 0;
+                ptr_stats->bytes = 0;
+                ptr_stats->time = 0;
+                weechat_hashtable_set (server->stats_commands, command,
+                                       ptr_stats);
+            }
+        }
+        if (ptr_stats)
+        {
+            ptr_stats->count++;
+            ptr_stats->bytes += bytes;
+            ptr_stats->time += time_usec;
+        }
+    }
+
+    if (channel)
+    {
+        /* channel is searched after the command (it may have been closed) */
+        ptr_channel = irc_channel_search (server, channel);
+        if (ptr_channel)
+        {
+            ptr_channel->stats_messages_recv++;
+            ptr_channel->stats_bytes_recv += bytes;
+            ptr_channel->stats_time_recv_command += time_usec;
+        }
+    }
+}
+
+/*
+ * Resets stats of a server and its channels.
  */
 
 void
-irc_server_msgq_add_unterminated (struct t_irc_server *server,
-                                  const char *string)
+irc_server_stats_reset (struct t_irc_server *server)
 {
-    char *unterminated_message2;
+    struct t_irc_channel *ptr_channel;
+
+    server->stats_start = time (NULL);
+    server->stats_bytes_recv = 0;
+    server->stats_bytes_sent = 0;
+    server->stats_messages_recv = 0;
+    server->stats_time_msgq = 0;
+    server->stats_time_recv_command = 0;
+    server->stats_time_modifiers = 0;
+    server->stats_time_signals = 0;
+    if (server->stats_commands)
+        weechat_hashtable_remove_all (server->stats_commands);
+
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        ptr_channel->stats_messages_recv = 0;
+        ptr_channel->stats_bytes_recv = 0;
+        ptr_channel->stats_time_recv_command = 0;
+    }
+}
+
+/*
+ * Compares two stats items (for sort by time spent, descending).
+ */
+
+int
+irc_server_stats_item_cmp_cb (const void *item1, const void *item2)
+{
+    long time1, time2;
+
+    time1 = ((struct t_irc_server_stats_item *)item1)->time;
+    time2 = ((struct t_irc_server_stats_item *)item2)->time;
+
+    if (time1 > time2)
+        return -1;
+    if (time1 < time2)
+        return 1;
+    return strcmp (((struct t_irc_server_stats_item *)item1)->name,
+                   ((struct t_irc_server_stats_item *)item2)->name);
+}
+
+/*
+ * Adds stats of a command in an array of stats items.
+ */
+
+void
+irc_server_stats_sort_commands_map_cb (void *data,
+                                       struct t_hashtable *hashtable,
+                                       const void *key, const void *value)
+{
+    struct t_irc_server_stats_item **ptr_item;
+    const struct t_irc_server_stats_command *ptr_stats;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    ptr_item = (struct t_irc_server_stats_item **)data;
+    ptr_stats = (const struct t_irc_server_stats_command *)value;
+
+    (*ptr_item)->name = (const char *)key;
+    (*ptr_item)->count = ptr_stats->count;
+    (*ptr_item)->bytes = ptr_stats->bytes;
+    (*ptr_item)->time = ptr_stats->time;
+    (*ptr_item)++;
+}
+
+/*
+ * Returns stats of commands received on server, sorted by time spent
+ * (most expensive first).
+ *
+ * Note: result must be freed after use (names are pointers to keys of
+ * hashtable "stats_commands" in server).
+ */
+
+struct t_irc_server_stats_item *
+irc_server_stats_sort_commands (struct t_irc_server *server, int *num_items)
+{
+    struct t_irc_server_stats_item *items, *ptr_item;
+
+    *num_items = (server->stats_commands) ?
+        weechat_hashtable_get_integer (server->stats_commands,
+                                       "items_count") : 0;
+    if (*num_items == 0)
+        return NULL;
+
+    items = malloc (*num_items * sizeof (*items));
+    if (!items)
+    {
+        *num_items = 0;
+        return NULL;
+    }
+
+    ptr_item = items;
+    weechat_hashtable_map (server->stats_commands,
+                           &irc_server_stats_sort_commands_map_cb,
+                           &ptr_item);
+
+    qsort (items, *num_items, sizeof (*items), &irc_server_stats_item_cmp_cb);
+
+    return items;
+}
+
+/*
+ * Returns stats of channels of server, sorted by time spent (most expensive
+ * first).
+ *
+ * Note: result must be freed after use (names are pointers to names of
+ * channels).
+ */
+
+struct t_irc_server_stats_item *
+irc_server_stats_sort_channels (struct t_irc_server *server, int *num_items)
+{
+    struct t_irc_server_stats_item *items;
+    struct t_irc_channel *ptr_channel;
+    int i;
+
+    *num_items = 0;
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        (*num_items)++;
+    }
+    if (*num_items == 0)
+        return NULL;
+
+    items = malloc (*num_items * sizeof (*items));
+    if (!items)
+    {
+        *num_items = 0;
+        return NULL;
+    }
+
+    i = 0;
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        items[i].name = ptr_channel->name;
+        items[i].count = ptr_channel->stats_messages_recv;
+        items[i].bytes = ptr_channel->stats_bytes_recv;
+        items[i].time = ptr_channel->stats_time_recv_command;
+        i++;
+    }
+
+    qsort (items, *num_items, sizeof (*items), &irc_server_stats_item_cmp_cb);
+
+    return items;
+}
+
+/*
+ * Executes a modifier on a received message (only if the modifier is hooked)
+ * and adds time spent in stats of server.
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+irc_server_recv_modifier_exec (struct t_irc_server *server,
+                               const char *modifier, const char *string)
+{
+    struct timeval tv_start, tv_end;
+    char *result;
+
+    if (!weechat_hook_modifier_exists (modifier))
+        return NULL;
 
-    if (!string[0])
-        return;
+    gettimeofday (&tv_start, NULL);
+    result = weechat_hook_modifier_exec (modifier, server->name, string);
+    gettimeofday (&tv_end, NULL);
+    server->stats_time_modifiers += weechat_util_timeval_diff (&tv_start,
+                                                               &tv_end);
 
-    if (server->unterminated_message)
-    {
-        unterminated_message2 =
-            realloc (server->unterminated_message,
-                     (strlen (server->unterminated_message) +
-                      strlen (string) + 1));
-        if (!unterminated_message2)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-            free (server->unterminated_message);
-            server->unterminated_message = NULL;
-            return;
-        }
-        server->unterminated_message = unterminated_message2;
-        strcat (server->unterminated_message, string);
-    }
-    else
-    {
-        server->unterminated_message = strdup (string);
-        if (!server->unterminated_message)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: not enough memory for received message"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        }
-    }
+    return result;
 }
 
 /*
- * Splits received buffer, creating queued messages.
+ * Removes received messages of a server which are not yet processed
+ * (messages are marked as empty and freed by irc_server_msgq_process).
+ *
+ * The message being processed (if any) is kept as-is.
  */
 
 void
-irc_server_msgq_add_buffer (struct t_irc_server *server, const char *buffer)
+irc_server_msgq_remove_server (struct t_irc_server *server)
 {
-    char *pos_cr, *pos_lf;
-
-    while (buffer[0])
-    {
-        pos_cr = strchr (buffer, '\r');
-        pos_lf = strchr (buffer, '\n');
+    struct t_irc_message *ptr_msg;
 
-        if (!pos_cr && !pos_lf)
-        {
-            /* no CR/LF found => add to unterminated and return */
-            irc_server_msgq_add_unterminated (server, buffer);
-            return;
-        }
+    ptr_msg = irc_recv_msgq;
+    if (ptr_msg && irc_server_msgq_processing)
+        ptr_msg = ptr_msg->next_message;
 
-        if (pos_cr && ((!pos_lf) || (pos_lf > pos_cr)))
-        {
-            /* found '\r' first => ignore this char */
-            pos_cr[0] = '\0';
-            irc_server_msgq_add_unterminated (server, buffer);
-            buffer = pos_cr + 1;
-        }
-        else
+    for (; ptr_msg; ptr_msg = ptr_msg->next_message)
+    {
+        if (ptr_msg->server == server)
         {
-            /* found: '\n' first => terminate message */
-            pos_lf[0] = '\0';
-            irc_server_msgq_add_msg (server, buffer);
-            buffer = pos_lf + 1;
+            ptr_msg->server = NULL;
+            ptr_msg->data = NULL;
         }
     }
 }
 
 /*
- * Flushes message queue.
+ * Processes received messages in message queue: at most "max_messages"
+ * messages are processed (0 = process all messages).
+ *
+ * Returns:
+ *   1: some messages are still in queue
+ *   0: queue is empty
  */
 
-void
-irc_server_msgq_flush ()
+int
+irc_server_msgq_process (int max_messages)
 {
     struct t_irc_message *next;
     char *ptr_data, *new_msg, *new_msg2, *ptr_msg, *ptr_msg2, *ptr_msg3, *pos;
-    char *tags, *nick, *host, *command, *channel, *arguments;
+    char *tags, *command, *channel;
+    const char *arguments;
     char *msg_decoded, *msg_decoded_without_color;
     char str_modifier[128], modifier_data[256];
-    int pos_channel, pos_text, pos_decode;
+    int pos_decode;
+    struct t_irc_message_parsed parsed, parsed_data;
+    struct timeval tv_start, tv_start_cmd, tv_end;
+    int count;
+
+    /* already processing messages (called by a message): nothing to do */
+    if (irc_server_msgq_processing)
+        return (irc_recv_msgq) ? 1 : 0;
+
+    irc_server_msgq_processing = 1;
 
-    while (irc_recv_msgq)
+    count = 0;
+    while (irc_recv_msgq
+           && ((max_messages <= 0) || (count < max_messages)))
     {
+        count++;
         if (irc_recv_msgq->data)
         {
             /* read message only if connection was not lost */
@@ -2649,22 +3639,33 @@ irc_server_msgq_flush ()
 
                 if (ptr_data[0])
                 {
+                    gettimeofday (&tv_start, NULL);
+
+                    /* lines displayed for the message are traced with it */
+                    weechat_latency_message_set (
+                        (irc_recv_msgq->date_recv.tv_sec != 0) ?
+                        &irc_recv_msgq->date_recv : NULL);
+
                     irc_raw_print (irc_recv_msgq->server, IRC_RAW_FLAG_RECV,
                                    ptr_data);
 
-                    irc_message_parse (irc_recv_msgq->server,
-                                       ptr_data, NULL, NULL, NULL, NULL,
-                                       &command, NULL, NULL, NULL, NULL, NULL,
-                                       NULL, NULL);
-                    snprintf (str_modifier, sizeof (str_modifier),
-                              "irc_in_%s",
-                              (command) ? command : "unknown");
-                    new_msg = weechat_hook_modifier_exec (
-                        str_modifier,
-                        irc_recv_msgq->server->name,
-                        ptr_data);
-                    if (command)
-                        free (command);
+                    TRACE2(irc_parse, irc_recv_msgq->server->name, ptr_data);
+                    irc_message_parse_positions (irc_recv_msgq->server,
+                                                 ptr_data, &parsed_data);
+                    if (parsed_data.pos_command >= 0)
+                    {
+                        snprintf (str_modifier, sizeof (str_modifier),
+                                  "irc_in_%.*s",
+                                  parsed_data.length_command,
+                                  ptr_data + parsed_data.pos_command);
+                    }
+                    else
+                    {
+                        snprintf (str_modifier, sizeof (str_modifier),
+                                  "irc_in_unknown");
+                    }
+                    new_msg = irc_server_recv_modifier_exec (
+                        irc_recv_msgq->server, str_modifier, ptr_data);
 
                     /* no changes in new message */
                     if (new_msg && (strcmp (ptr_data, new_msg) == 0))
@@ -2693,17 +3694,36 @@ irc_server_msgq_flush ()
                                     ptr_msg);
                             }
 
-                            irc_message_parse (irc_recv_msgq->server, ptr_msg,
-                                               &tags, NULL, &nick, &host,
-                                               &command, &channel, &arguments,
-                                               NULL, NULL, NULL,
-                                               &pos_channel, &pos_text);
+                            /*
+                             * message not changed by modifier and not split:
+                             * use message parsed above, otherwise parse it
+                             */
+                            if (!new_msg && !pos && (ptr_msg == ptr_data))
+                                parsed = parsed_data;
+                            else
+                            {
+                                irc_message_parse_positions (
+                                    irc_recv_msgq->server, ptr_msg, &parsed);
+                            }
+                            tags = irc_message_parsed_strndup (
+                                ptr_msg, parsed.pos_tags, parsed.length_tags);
+                            command = irc_message_parsed_strndup (
+                                ptr_msg, parsed.pos_command,
+                                parsed.length_command);
+                            channel = irc_message_parsed_strndup (
+                                ptr_msg, parsed.pos_channel,
+                                parsed.length_channel);
+                            arguments = (parsed.pos_arguments >= 0) ?
+                                ptr_msg + parsed.pos_arguments : NULL;
 
                             msg_decoded = NULL;
                             if (weechat_config_boolean (irc_config_network_channel_encode))
-                                pos_decode = (pos_channel >= 0) ? pos_channel : pos_text;
+                            {
+                                pos_decode = (parsed.pos_channel >= 0) ?
+                                    parsed.pos_channel : parsed.pos_text;
+                            }
                             else
-                                pos_decode = pos_text;
+                                pos_decode = parsed.pos_text;
                             if (pos_decode >= 0)
                             {
                                 /* convert charset for message */
@@ -2719,14 +3739,20 @@ irc_server_msgq_flush ()
                                 }
                                 else
                                 {
-                                    if (nick && (!host || (strcmp (nick, host) != 0)))
+                                    if ((parsed.pos_nick >= 0)
+                                        && ((parsed.pos_host < 0)
+                                            || (parsed.length_nick != parsed.length_host)
+                                            || (strncmp (ptr_msg + parsed.pos_nick,
+                                                         ptr_msg + parsed.pos_host,
+                                                         parsed.length_nick) != 0)))
                                     {
                                         snprintf (modifier_data,
                                                   sizeof (modifier_data),
-                                                  "%s.%s.%s",
+                                                  "%s.%s.%.*s",
                                                   weechat_plugin->name,
                                                   irc_recv_msgq->server->name,
-                                                  nick);
+                                                  parsed.length_nick,
+                                                  ptr_msg + parsed.pos_nick);
                                     }
                                     else
                                     {
@@ -2754,9 +3780,8 @@ irc_server_msgq_flush ()
                             snprintf (str_modifier, sizeof (str_modifier),
                                       "irc_in2_%s",
                                       (command) ? command : "unknown");
-                            new_msg2 = weechat_hook_modifier_exec (
-                                str_modifier,
-                                irc_recv_msgq->server->name,
+                            new_msg2 = irc_server_recv_modifier_exec (
+                                irc_recv_msgq->server, str_modifier,
                                 ptr_msg2);
                             if (new_msg2 && (strcmp (ptr_msg2, new_msg2) == 0))
                             {
@@ -2796,27 +3821,38 @@ irc_server_msgq_flush ()
                                         else
                                             ptr_msg3 = ptr_msg2;
                                     }
+                                    gettimeofday (&tv_start_cmd, NULL);
+                                    TRACE3(irc_dispatch_start,
+                                           irc_recv_msgq->server->name,
+                                           command, channel);
                                     irc_protocol_recv_command (
                                         irc_recv_msgq->server,
                                         ptr_msg3,
                                         tags,
                                         command,
                                         channel);
+                                    TRACE3(irc_dispatch_end,
+                                           irc_recv_msgq->server->name,
+                                           command, channel);
+                                    gettimeofday (&tv_end, NULL);
+                                    irc_server_stats_add_message (
+                                        irc_recv_msgq->server,
+                                        command,
+                                        channel,
+                                        strlen (ptr_msg2),
+                                        weechat_util_timeval_diff (
+                                            &tv_start_cmd, &tv_end));
                                 }
                             }
 
                             if (new_msg2)
                                 free (new_msg2);
-                            if (nick)
-                                free (nick);
-                            if (host)
-                                free (host);
+                            if (tags)
+                                free (tags);
                             if (command)
                                 free (command);
                             if (channel)
                                 free (channel);
-                            if (arguments)
-                                free (arguments);
                             if (msg_decoded)
                                 free (msg_decoded);
                             if (msg_decoded_without_color)
@@ -2839,17 +3875,123 @@ irc_server_msgq_flush ()
                     }
                     if (new_msg)
                         free (new_msg);
+
+                    weechat_latency_message_set (NULL);
+
+                    gettimeofday (&tv_end, NULL);
+                    irc_recv_msgq->server->stats_messages_recv++;
+                    irc_recv_msgq->server->stats_time_msgq +=
+                        weechat_util_timeval_diff (&tv_start, &tv_end);
                 }
             }
-            free (irc_recv_msgq->data);
         }
 
+        /* message may have changed time of next events (lag, ...) */
+        if (irc_recv_msgq->server)
+            irc_server_timer_schedule (irc_recv_msgq->server);
+
+        irc_server_recv_buffer_unref (irc_recv_msgq->recv_buffer);
         next = irc_recv_msgq->next_message;
         free (irc_recv_msgq);
         irc_recv_msgq = next;
         if (!irc_recv_msgq)
             irc_msgq_last_msg = NULL;
     }
+
+    /* update nicklists once for bursts of joins/quits (netsplit/netjoin) */
+    irc_channel_nicklist_burst_end_all ();
+
+    irc_server_msgq_processing = 0;
+
+    return (irc_recv_msgq) ? 1 : 0;
+}
+
+/*
+ * Flushes message queue (all messages are processed).
+ */
+
+void
+irc_server_msgq_flush ()
+{
+    irc_server_msgq_process (0);
+}
+
+/*
+ * Callback for processing of received messages which are still in queue.
+ */
+
+int
+irc_server_msgq_timer_cb (const void *pointer, void *data,
+                          int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    irc_server_hook_timer_msgq = NULL;
+
+    irc_server_msgq_flush_partial ();
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Processes some received messages (at most IRC_SERVER_MSGQ_FLUSH_MAX), so
+ * that a server sending many messages does not block WeeChat: other
+ * messages are processed in next main loop iteration.
+ */
+
+void
+irc_server_msgq_flush_partial ()
+{
+    if (irc_server_msgq_process (IRC_SERVER_MSGQ_FLUSH_MAX)
+        && !irc_server_hook_timer_msgq)
+    {
+        irc_server_hook_timer_msgq = weechat_hook_timer (
+            1, 0, 1,
+            &irc_server_msgq_timer_cb, NULL, NULL);
+    }
+}
+
+/*
+ * Displays an error on read of server socket, and disconnects from server.
+ *
+ * Argument "num_read" is the value returned by the read (0 if connection was
+ * closed by peer, a GnuTLS error code if TLS is used), "error" is the errno
+ * of read (used without TLS).
+ */
+
+void
+irc_server_recv_error (struct t_irc_server *server, int num_read, int error)
+{
+#ifdef HAVE_GNUTLS
+    if (server->ssl_connected)
+    {
+        weechat_printf (
+            server->buffer,
+            _("%s%s: reading data on socket: error %d %s"),
+            weechat_prefix ("error"), IRC_PLUGIN_NAME,
+            num_read,
+            (num_read == 0) ? _("(connection closed by peer)") :
+            gnutls_strerror (num_read));
+    }
+    else
+#endif /* HAVE_GNUTLS */
+    {
+        weechat_printf (
+            server->buffer,
+            _("%s%s: reading data on socket: error %d %s"),
+            weechat_prefix ("error"), IRC_PLUGIN_NAME,
+            error,
+            (num_read == 0) ? _("(connection closed by peer)") :
+            strerror (error));
+    }
+    weechat_printf (
+        server->buffer,
+        _("%s%s: disconnecting from server..."),
+        weechat_prefix ("network"), IRC_PLUGIN_NAME);
+    irc_server_disconnect (server, !server->is_connected, 1);
 }
 
 /*
@@ -2860,7 +4002,8 @@ int
 irc_server_recv_cb (const void *pointer, void *data, int fd)
 {
     struct t_irc_server *server;
-    static char buffer[4096 + 2];
+    struct timeval tv_start, tv_now;
+    char *ptr_buffer;
     int num_read, msgq_flush, end_recv;
 
     /* make C compiler happy */
@@ -2874,30 +4017,68 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
     msgq_flush = 0;
     end_recv = 0;
 
+    gettimeofday (&tv_start, NULL);
+
     while (!end_recv)
     {
         end_recv = 1;
 
+        /* data is read directly in buffer with received data of server */
+        ptr_buffer = irc_server_recv_buffer_reserve (server,
+                                                     server->recv_size);
+        if (!ptr_buffer)
+        {
+            weechat_printf (server->buffer,
+                            _("%s%s: not enough memory for received message"),
+                            weechat_prefix ("error"), IRC_PLUGIN_NAME);
+            break;
+        }
+
 #ifdef HAVE_GNUTLS
         if (server->ssl_connected)
-            num_read = gnutls_record_recv (server->gnutls_sess, buffer,
-                                           sizeof (buffer) - 2);
+            num_read = gnutls_record_recv (server->gnutls_sess, ptr_buffer,
+                                           server->recv_size);
         else
 #endif /* HAVE_GNUTLS */
-            num_read = recv (server->sock, buffer, sizeof (buffer) - 2, 0);
+            num_read = recv (server->sock, ptr_buffer, server->recv_size, 0);
 
         if (num_read > 0)
         {
-            buffer[num_read] = '\0';
-            irc_server_msgq_add_buffer (server, buffer);
+            gettimeofday (&tv_now, NULL);
+            server->stats_bytes_recv += num_read;
+            irc_server_msgq_add_received (server, num_read, &tv_now);
             msgq_flush = 1;  /* the flush will be done after the loop */
+
+            /* adjust size of next read with amount of data received */
+            if ((num_read == server->recv_size)
+                && (server->recv_size < IRC_SERVER_RECV_SIZE_MAX))
+            {
+                server->recv_size *= 2;
+            }
+            else if ((num_read < server->recv_size / 4)
+                     && (server->recv_size > IRC_SERVER_RECV_SIZE_MIN))
+            {
+                server->recv_size /= 2;
+            }
+
+            /*
+             * read again until there is no more data on socket (EAGAIN),
+             * unless the time spent reading the socket is too long (the
+             * socket will be read again on next main loop iteration)
+             */
+            if (weechat_util_timeval_diff (&tv_start, &tv_now) <
+                IRC_SERVER_RECV_TIME_MAX * 1000)
+            {
+                end_recv = 0;
+            }
 #ifdef HAVE_GNUTLS
-            if (server->ssl_connected
-                && (gnutls_record_check_pending (server->gnutls_sess) > 0))
+            else if (server->ssl_connected
+                     && (gnutls_record_check_pending (server->gnutls_sess) > 0))
             {
                 /*
                  * if there are unread data in the gnutls buffers,
-                 * go on with recv
+                 * go on with recv (the socket will not be readable for
+                 * these data)
                  */
                 end_recv = 0;
             }
@@ -2912,18 +4093,7 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
                     || ((num_read != GNUTLS_E_AGAIN)
                         && (num_read != GNUTLS_E_INTERRUPTED)))
                 {
-                    weechat_printf (
-                        server->buffer,
-                        _("%s%s: reading data on socket: error %d %s"),
-                        weechat_prefix ("error"), IRC_PLUGIN_NAME,
-                        num_read,
-                        (num_read == 0) ? _("(connection closed by peer)") :
-                        gnutls_strerror (num_read));
-                    weechat_printf (
-                        server->buffer,
-                        _("%s%s: disconnecting from server..."),
-                        weechat_prefix ("network"), IRC_PLUGIN_NAME);
-                    irc_server_disconnect (server, !server->is_connected, 1);
+                    irc_server_recv_error (server, num_read, errno);
                 }
             }
             else
@@ -2932,29 +4102,38 @@ irc_server_recv_cb (const void *pointer, void *data, int fd)
                 if ((num_read == 0)
                     || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
                 {
-                    weechat_printf (
-                        server->buffer,
-                        _("%s%s: reading data on socket: error %d %s"),
-                        weechat_prefix ("error"), IRC_PLUGIN_NAME,
-                        errno,
-                        (num_read == 0) ? _("(connection closed by peer)") :
-                        strerror (errno));
-                    weechat_printf (
-                        server->buffer,
-                        _("%s%s: disconnecting from server..."),
-                        weechat_prefix ("network"), IRC_PLUGIN_NAME);
-                    irc_server_disconnect (server, !server->is_connected, 1);
+                    irc_server_recv_error (server, num_read, errno);
                 }
             }
         }
     }
 
     if (msgq_flush)
-        irc_server_msgq_flush ();
+        irc_server_msgq_flush_partial ();
 
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Starts reading the socket of a server: with a reader thread if option
+ * irc.network.recv_thread is enabled, otherwise in the main thread.
+ */
+
+void
+irc_server_recv_start (struct t_irc_server *server)
+{
+    if (weechat_config_boolean (irc_config_network_recv_thread)
+        && irc_reader_start (server))
+    {
+        return;
+    }
+
+    server->hook_fd = weechat_hook_fd (server->sock,
+                                       1, 0, 0,
+                                       &irc_server_recv_cb,
+                                       server, NULL);
+}
+
 /*
  * Callback for server connection: it is called if WeeChat is TCP-connected to
  * server, but did not receive message 001.
@@ -3022,250 +4201,406 @@ irc_server_timer_sasl_cb (const void *pointer, void *data, int remaining_calls)
         if ((sasl_fail == IRC_SERVER_SASL_FAIL_RECONNECT)
             || (sasl_fail == IRC_SERVER_SASL_FAIL_DISCONNECT))
         {
-            irc_server_disconnect (
-                server, 0,
-                (sasl_fail == IRC_SERVER_SASL_FAIL_RECONNECT) ? 1 : 0);
+            irc_server_disconnect (
+                server, 0,
+                (sasl_fail == IRC_SERVER_SASL_FAIL_RECONNECT) ? 1 : 0);
+        }
+        else
+            irc_server_sendf (server, 0, NULL, "CAP END");
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback called for each manual join of a server: deletes old channels in the
+ * hashtable.
+ */
+
+void
+irc_server_check_join_manual_cb (void *data,
+                                 struct t_hashtable *hashtable,
+                                 const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    if (*((time_t *)value) + (60 * 10) < time (NULL))
+        weechat_hashtable_remove (hashtable, key);
+}
+
+/*
+ * Callback called for each join without switch of a server: deletes old channel
+ * in the hashtable.
+ */
+
+void
+irc_server_check_join_noswitch_cb (void *data,
+                                   struct t_hashtable *hashtable,
+                                   const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    if (*((time_t *)value) + (60 * 10) < time (NULL))
+        weechat_hashtable_remove (hashtable, key);
+}
+
+/*
+ * Callback called for each smart filtered join of a channel: deletes old
+ * entries in the hashtable.
+ */
+
+void
+irc_server_check_join_smart_filtered_cb (void *data,
+                                         struct t_hashtable *hashtable,
+                                         const void *key, const void *value)
+{
+    int unmask_delay;
+
+    /* make C compiler happy */
+    (void) data;
+
+    unmask_delay = weechat_config_integer (irc_config_look_smart_filter_join_unmask);
+    if ((unmask_delay == 0)
+        || (*((time_t *)value) < time (NULL) - (unmask_delay * 60)))
+    {
+        weechat_hashtable_remove (hashtable, key);
+    }
+}
+
+/*
+ * Returns time of next event for a server (0 if no event is planned):
+ * reconnection, messages in out queue, lag check, away check, autojoin,
+ * MONITOR command, timeout of redirects, purge of data.
+ */
+
+time_t
+irc_server_timer_next_time (struct t_irc_server *server)
+{
+    struct t_irc_redirect *ptr_redirect;
+    time_t current_time, next_time, event_time;
+    int i, away_check_delay;
+
+    next_time = 0;
+
+    if (!server->is_connected)
+    {
+        if (server->reconnect_start > 0)
+            next_time = server->reconnect_start + server->reconnect_delay;
+        return next_time;
+    }
+
+    current_time = time (NULL);
+
+#define IRC_SERVER_TIMER_EVENT(__time)                                  \
+    event_time = __time;                                                \
+    if ((next_time == 0) || (event_time < next_time))                   \
+        next_time = event_time;
+
+    /* messages in out queue or lag counting: check each second */
+    for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
+    {
+        if (server->outqueue[i])
+        {
+            IRC_SERVER_TIMER_EVENT(current_time + 1);
+            break;
+        }
+    }
+    if (server->lag_check_time.tv_sec != 0)
+    {
+        IRC_SERVER_TIMER_EVENT(current_time + 1);
+    }
+    else if (weechat_config_integer (irc_config_network_lag_check) > 0)
+    {
+        IRC_SERVER_TIMER_EVENT(server->lag_next_check);
+    }
+
+    away_check_delay = irc_server_away_check_delay (server);
+    if (away_check_delay > 0)
+    {
+        IRC_SERVER_TIMER_EVENT(
+            (server->last_away_check == 0) ?
+            current_time : server->last_away_check + away_check_delay);
+    }
+
+    if (server->command_time != 0)
+    {
+        IRC_SERVER_TIMER_EVENT(
+            server->command_time +
+            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_COMMAND_DELAY));
+    }
+
+    if (server->monitor_time != 0)
+    {
+        IRC_SERVER_TIMER_EVENT(server->monitor_time);
+    }
+
+    for (ptr_redirect = server->redirects; ptr_redirect;
+         ptr_redirect = ptr_redirect->next_redirect)
+    {
+        if (ptr_redirect->start_time > 0)
+        {
+            IRC_SERVER_TIMER_EVENT(ptr_redirect->start_time +
+                                   ptr_redirect->timeout + 1);
         }
-        else
-            irc_server_sendf (server, 0, NULL, "CAP END");
     }
 
-    return WEECHAT_RC_OK;
+    IRC_SERVER_TIMER_EVENT(server->last_data_purge + (60 * 10) + 1);
+
+#undef IRC_SERVER_TIMER_EVENT
+
+    return next_time;
 }
 
 /*
- * Callback called for each manual join of a server: deletes old channels in the
- * hashtable.
+ * Schedules the timer of a server for its next event.
+ *
+ * The timer is hooked again only if the next event is before the time
+ * already scheduled: if an event is cancelled or delayed, the timer is
+ * called earlier than needed and it is scheduled again.
+ *
+ * This function must be called when the time of an event is changed.
  */
 
 void
-irc_server_check_join_manual_cb (void *data,
-                                 struct t_hashtable *hashtable,
-                                 const void *key, const void *value)
+irc_server_timer_schedule (struct t_irc_server *server)
 {
-    /* make C compiler happy */
-    (void) data;
+    time_t next_time;
+    struct timeval tv_now;
+    long interval;
 
-    if (*((time_t *)value) + (60 * 10) < time (NULL))
-        weechat_hashtable_remove (hashtable, key);
-}
+    next_time = irc_server_timer_next_time (server);
 
-/*
- * Callback called for each join without switch of a server: deletes old channel
- * in the hashtable.
- */
+    if (server->hook_timer)
+    {
+        if ((next_time == 0) || (next_time >= server->timer_next_time))
+            return;
+        weechat_unhook (server->hook_timer);
+        server->hook_timer = NULL;
+    }
 
-void
-irc_server_check_join_noswitch_cb (void *data,
-                                   struct t_hashtable *hashtable,
-                                   const void *key, const void *value)
-{
-    /* make C compiler happy */
-    (void) data;
+    server->timer_next_time = next_time;
 
-    if (*((time_t *)value) + (60 * 10) < time (NULL))
-        weechat_hashtable_remove (hashtable, key);
+    if (next_time == 0)
+        return;
+
+    gettimeofday (&tv_now, NULL);
+    interval = ((long)(next_time - tv_now.tv_sec) * 1000) -
+        (tv_now.tv_usec / 1000);
+    if (interval < 1)
+        interval = 1;
+
+    server->hook_timer = weechat_hook_timer (interval, 0, 1,
+                                             &irc_server_timer_cb,
+                                             server, NULL);
 }
 
 /*
- * Callback called for each smart filtered join of a channel: deletes old
- * entries in the hashtable.
+ * Schedules the timer of all servers.
  */
 
 void
-irc_server_check_join_smart_filtered_cb (void *data,
-                                         struct t_hashtable *hashtable,
-                                         const void *key, const void *value)
+irc_server_timer_schedule_all ()
 {
-    int unmask_delay;
-
-    /* make C compiler happy */
-    (void) data;
+    struct t_irc_server *ptr_server;
 
-    unmask_delay = weechat_config_integer (irc_config_look_smart_filter_join_unmask);
-    if ((unmask_delay == 0)
-        || (*((time_t *)value) < time (NULL) - (unmask_delay * 60)))
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
     {
-        weechat_hashtable_remove (hashtable, key);
+        irc_server_timer_schedule (ptr_server);
     }
 }
 
 /*
- * Timer called each second to perform some operations on servers.
+ * Performs operations due on a server (reconnection, lag check, ...).
  */
 
-int
-irc_server_timer_cb (const void *pointer, void *data, int remaining_calls)
+void
+irc_server_timer_run (struct t_irc_server *server)
 {
-    struct t_irc_server *ptr_server;
     struct t_irc_channel *ptr_channel;
     struct t_irc_redirect *ptr_redirect, *ptr_next_redirect;
     time_t current_time;
     static struct timeval tv;
-    int away_check;
-
-    /* make C compiler happy */
-    (void) pointer;
-    (void) data;
-    (void) remaining_calls;
+    int away_check_delay;
 
     current_time = time (NULL);
 
-    for (ptr_server = irc_servers; ptr_server;
-         ptr_server = ptr_server->next_server)
+    /* check if reconnection is pending */
+    if ((!server->is_connected)
+        && (server->reconnect_start > 0)
+        && (current_time >= (server->reconnect_start + server->reconnect_delay)))
+    {
+        irc_server_reconnect (server);
+    }
+    else
     {
-        /* check if reconnection is pending */
-        if ((!ptr_server->is_connected)
-            && (ptr_server->reconnect_start > 0)
-            && (current_time >= (ptr_server->reconnect_start + ptr_server->reconnect_delay)))
+        if (!server->is_connected)
+            return;
+
+        /* send queued messages */
+        irc_server_outqueue_send (server);
+
+        /* check for lag */
+        if ((weechat_config_integer (irc_config_network_lag_check) > 0)
+            && (server->lag_check_time.tv_sec == 0)
+            && (current_time >= server->lag_next_check))
         {
-            irc_server_reconnect (ptr_server);
+            irc_server_sendf (server, 0, NULL, "PING %s",
+                              (server->current_address) ?
+                              server->current_address : "weechat");
+            gettimeofday (&(server->lag_check_time), NULL);
+            server->lag = 0;
+            server->lag_last_refresh = 0;
         }
         else
         {
-            if (!ptr_server->is_connected)
-                continue;
-
-            /* send queued messages */
-            irc_server_outqueue_send (ptr_server);
-
-            /* check for lag */
-            if ((weechat_config_integer (irc_config_network_lag_check) > 0)
-                && (ptr_server->lag_check_time.tv_sec == 0)
-                && (current_time >= ptr_server->lag_next_check))
+            /* check away (only if lag check was not done) */
+            away_check_delay = irc_server_away_check_delay (server);
+            if ((away_check_delay > 0)
+                && ((server->last_away_check == 0)
+                    || (current_time >= server->last_away_check + away_check_delay)))
             {
-                irc_server_sendf (ptr_server, 0, NULL, "PING %s",
-                                  (ptr_server->current_address) ?
-                                  ptr_server->current_address : "weechat");
-                gettimeofday (&(ptr_server->lag_check_time), NULL);
-                ptr_server->lag = 0;
-                ptr_server->lag_last_refresh = 0;
+                irc_server_check_away_next (server);
             }
-            else
+        }
+
+        /* check if it's time to autojoin channels (after command delay) */
+        if ((server->command_time != 0)
+            && (current_time >= server->command_time +
+                IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_COMMAND_DELAY)))
+        {
+            irc_server_autojoin_channels (server);
+            server->command_time = 0;
+        }
+
+        /* check if it's time to send MONITOR command */
+        if ((server->monitor_time != 0)
+            && (current_time >= server->monitor_time))
+        {
+            if (server->monitor > 0)
+                irc_notify_send_monitor (server);
+            server->monitor_time = 0;
+        }
+
+        /* compute lag */
+        if (server->lag_check_time.tv_sec != 0)
+        {
+            gettimeofday (&tv, NULL);
+            server->lag = (int)(weechat_util_timeval_diff (&(server->lag_check_time),
+                                                               &tv) / 1000);
+            /* refresh lag item if needed */
+            if (((server->lag_last_refresh == 0)
+                 || (current_time >= server->lag_last_refresh + weechat_config_integer (irc_config_network_lag_refresh_interval)))
+                && (server->lag >= weechat_config_integer (irc_config_network_lag_min_show)))
             {
-                /* check away (only if lag check was not done) */
-                away_check = IRC_SERVER_OPTION_INTEGER(
-                    ptr_server, IRC_SERVER_OPTION_AWAY_CHECK);
-                if (!ptr_server->cap_away_notify
-                    && (away_check > 0)
-                    && ((ptr_server->last_away_check == 0)
-                        || (current_time >= ptr_server->last_away_check + (away_check * 60))))
+                server->lag_last_refresh = current_time;
+                if (server->lag != server->lag_displayed)
                 {
-                    irc_server_check_away (ptr_server);
+                    server->lag_displayed = server->lag;
+                    weechat_bar_item_update ("lag");
                 }
             }
-
-            /* check if it's time to autojoin channels (after command delay) */
-            if ((ptr_server->command_time != 0)
-                && (current_time >= ptr_server->command_time +
-                    IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_COMMAND_DELAY)))
-            {
-                irc_server_autojoin_channels (ptr_server);
-                ptr_server->command_time = 0;
-            }
-
-            /* check if it's time to send MONITOR command */
-            if ((ptr_server->monitor_time != 0)
-                && (current_time >= ptr_server->monitor_time))
+            /* lag timeout? => disconnect */
+            if ((weechat_config_integer (irc_config_network_lag_reconnect) > 0)
+                && (server->lag >= weechat_config_integer (irc_config_network_lag_reconnect) * 1000))
             {
-                if (ptr_server->monitor > 0)
-                    irc_notify_send_monitor (ptr_server);
-                ptr_server->monitor_time = 0;
+                weechat_printf (
+                    server->buffer,
+                    _("%s%s: lag is high, reconnecting to server %s%s%s"),
+                    weechat_prefix ("network"),
+                    IRC_PLUGIN_NAME,
+                    IRC_COLOR_CHAT_SERVER,
+                    server->name,
+                    IRC_COLOR_RESET);
+                irc_server_disconnect (server, 0, 1);
             }
-
-            /* compute lag */
-            if (ptr_server->lag_check_time.tv_sec != 0)
+            else
             {
-                gettimeofday (&tv, NULL);
-                ptr_server->lag = (int)(weechat_util_timeval_diff (&(ptr_server->lag_check_time),
-                                                                   &tv) / 1000);
-                /* refresh lag item if needed */
-                if (((ptr_server->lag_last_refresh == 0)
-                     || (current_time >= ptr_server->lag_last_refresh + weechat_config_integer (irc_config_network_lag_refresh_interval)))
-                    && (ptr_server->lag >= weechat_config_integer (irc_config_network_lag_min_show)))
+                /* stop lag counting if max lag is reached */
+                if ((weechat_config_integer (irc_config_network_lag_max) > 0)
+                    && (server->lag >= (weechat_config_integer (irc_config_network_lag_max) * 1000)))
                 {
-                    ptr_server->lag_last_refresh = current_time;
-                    if (ptr_server->lag != ptr_server->lag_displayed)
+                    /* refresh lag item */
+                    server->lag_last_refresh = current_time;
+                    if (server->lag != server->lag_displayed)
                     {
-                        ptr_server->lag_displayed = ptr_server->lag;
+                        server->lag_displayed = server->lag;
                         weechat_bar_item_update ("lag");
                     }
-                }
-                /* lag timeout? => disconnect */
-                if ((weechat_config_integer (irc_config_network_lag_reconnect) > 0)
-                    && (ptr_server->lag >= weechat_config_integer (irc_config_network_lag_reconnect) * 1000))
-                {
-                    weechat_printf (
-                        ptr_server->buffer,
-                        _("%s%s: lag is high, reconnecting to server %s%s%s"),
-                        weechat_prefix ("network"),
-                        IRC_PLUGIN_NAME,
-                        IRC_COLOR_CHAT_SERVER,
-                        ptr_server->name,
-                        IRC_COLOR_RESET);
-                    irc_server_disconnect (ptr_server, 0, 1);
-                }
-                else
-                {
-                    /* stop lag counting if max lag is reached */
-                    if ((weechat_config_integer (irc_config_network_lag_max) > 0)
-                        && (ptr_server->lag >= (weechat_config_integer (irc_config_network_lag_max) * 1000)))
-                    {
-                        /* refresh lag item */
-                        ptr_server->lag_last_refresh = current_time;
-                        if (ptr_server->lag != ptr_server->lag_displayed)
-                        {
-                            ptr_server->lag_displayed = ptr_server->lag;
-                            weechat_bar_item_update ("lag");
-                        }
 
-                        /* schedule next lag check in 5 seconds */
-                        ptr_server->lag_check_time.tv_sec = 0;
-                        ptr_server->lag_check_time.tv_usec = 0;
-                        ptr_server->lag_next_check = time (NULL) +
-                            weechat_config_integer (irc_config_network_lag_check);
-                    }
+                    /* schedule next lag check in 5 seconds */
+                    server->lag_check_time.tv_sec = 0;
+                    server->lag_check_time.tv_usec = 0;
+                    server->lag_next_check = time (NULL) +
+                        weechat_config_integer (irc_config_network_lag_check);
                 }
             }
+        }
 
-            /* remove redirects if timeout occurs */
-            ptr_redirect = ptr_server->redirects;
-            while (ptr_redirect)
-            {
-                ptr_next_redirect = ptr_redirect->next_redirect;
-
-                if ((ptr_redirect->start_time > 0)
-                    && (ptr_redirect->start_time + ptr_redirect->timeout < current_time))
-                {
-                    irc_redirect_stop (ptr_redirect, "timeout");
-                }
+        /* remove redirects if timeout occurs */
+        ptr_redirect = server->redirects;
+        while (ptr_redirect)
+        {
+            ptr_next_redirect = ptr_redirect->next_redirect;
 
-                ptr_redirect = ptr_next_redirect;
+            if ((ptr_redirect->start_time > 0)
+                && (ptr_redirect->start_time + ptr_redirect->timeout < current_time))
+            {
+                irc_redirect_stop (ptr_redirect, "timeout");
             }
 
-            /* purge some data (every 10 minutes) */
-            if (current_time > ptr_server->last_data_purge + (60 * 10))
+            ptr_redirect = ptr_next_redirect;
+        }
+
+        /* purge some data (every 10 minutes) */
+        if (current_time > server->last_data_purge + (60 * 10))
+        {
+            weechat_hashtable_map (server->join_manual,
+                                   &irc_server_check_join_manual_cb,
+                                   NULL);
+            weechat_hashtable_map (server->join_noswitch,
+                                   &irc_server_check_join_noswitch_cb,
+                                   NULL);
+            for (ptr_channel = server->channels; ptr_channel;
+                 ptr_channel = ptr_channel->next_channel)
             {
-                weechat_hashtable_map (ptr_server->join_manual,
-                                       &irc_server_check_join_manual_cb,
-                                       NULL);
-                weechat_hashtable_map (ptr_server->join_noswitch,
-                                       &irc_server_check_join_noswitch_cb,
-                                       NULL);
-                for (ptr_channel = ptr_server->channels; ptr_channel;
-                     ptr_channel = ptr_channel->next_channel)
+                if (ptr_channel->join_smart_filtered)
                 {
-                    if (ptr_channel->join_smart_filtered)
-                    {
-                        weechat_hashtable_map (ptr_channel->join_smart_filtered,
-                                               &irc_server_check_join_smart_filtered_cb,
-                                               NULL);
-                    }
+                    weechat_hashtable_map (ptr_channel->join_smart_filtered,
+                                           &irc_server_check_join_smart_filtered_cb,
+                                           NULL);
                 }
-                ptr_server->last_data_purge = current_time;
             }
+            server->last_data_purge = current_time;
         }
     }
+}
+
+/*
+ * Timer called for the next event of a server (see function
+ * irc_server_timer_schedule).
+ */
+
+int
+irc_server_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    server = (struct t_irc_server *)pointer;
+
+    /* the timer is removed after this call (only one call) */
+    server->hook_timer = NULL;
+    server->timer_next_time = 0;
+
+    irc_server_timer_run (server);
+
+    irc_server_timer_schedule (server);
 
     return WEECHAT_RC_OK;
 }
@@ -3297,10 +4632,16 @@ irc_server_close_connection (struct t_irc_server *server)
         server->hook_fd = NULL;
     }
 
+    irc_reader_stop (server, 0);
+
+    server->connect_queued = 0;
+
     if (server->hook_connect)
     {
         weechat_unhook (server->hook_connect);
         server->hook_connect = NULL;
+        /* a slot is free: start next queued connection (if any) */
+        irc_server_connect_queue_schedule ();
     }
     else
     {
@@ -3308,6 +4649,9 @@ irc_server_close_connection (struct t_irc_server *server)
         /* close SSL connection */
         if (server->ssl_connected)
         {
+            /* keep session data to resume the session on next connection */
+            if (server->is_connected)
+                irc_server_tls_session_save (server);
             if (server->sock != -1)
                 gnutls_bye (server->gnutls_sess, GNUTLS_SHUT_WR);
             gnutls_deinit (server->gnutls_sess);
@@ -3325,11 +4669,13 @@ irc_server_close_connection (struct t_irc_server *server)
     }
 
     /* free any pending message */
-    if (server->unterminated_message)
+    irc_server_msgq_remove_server (server);
+    if (server->recv_buffer)
     {
-        free (server->unterminated_message);
-        server->unterminated_message = NULL;
+        irc_server_recv_buffer_unref (server->recv_buffer);
+        server->recv_buffer = NULL;
     }
+    server->unterminated_message = NULL;
     for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
     {
         irc_server_outqueue_free_all (server, i);
@@ -3338,6 +4684,9 @@ irc_server_close_connection (struct t_irc_server *server)
     /* remove all redirects */
     irc_redirect_free_all (server);
 
+    /* remove all batches */
+    irc_batch_free_all (server);
+
     /* remove all manual joins */
     weechat_hashtable_remove_all (server->join_manual);
 
@@ -3350,6 +4699,7 @@ irc_server_close_connection (struct t_irc_server *server)
     /* server is now disconnected */
     server->is_connected = 0;
     server->ssl_connected = 0;
+    server->ssl_ktls_send = 0;
 }
 
 /*
@@ -3373,6 +4723,7 @@ irc_server_reconnect_schedule (struct t_irc_server *server)
             server->reconnect_delay = weechat_config_integer (irc_config_network_autoreconnect_delay_max);
 
         server->reconnect_start = time (NULL);
+        irc_server_timer_schedule (server);
 
         minutes = server->reconnect_delay / 60;
         seconds = server->reconnect_delay % 60;
@@ -3460,7 +4811,8 @@ irc_server_login (struct t_irc_server *server)
 
     server->nick_alternate_number = -1;
 
-    if (irc_server_sasl_enabled (server) || (capabilities && capabilities[0]))
+    if (irc_server_sasl_enabled (server) || (capabilities && capabilities[0])
+        || (IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK) > 0))
     {
         irc_server_sendf (server, 0, NULL, "CAP LS");
     }
@@ -3539,6 +4891,7 @@ irc_server_connect_cb (const void *pointer, void *data,
 {
     struct t_irc_server *server;
     const char *proxy;
+    int flags;
 
     /* make C compiler happy */
     (void) data;
@@ -3549,11 +4902,30 @@ irc_server_connect_cb (const void *pointer, void *data,
 
     server->hook_connect = NULL;
 
+    /* a slot is free: start next queued connection (if any) */
+    irc_server_connect_queue_schedule ();
+
     server->sock = sock;
 
     switch (status)
     {
         case WEECHAT_HOOK_CONNECT_OK:
+            /* socket is read until there is no more data (EAGAIN) */
+            flags = fcntl (server->sock, F_GETFL);
+            if (flags == -1)
+                flags = 0;
+            fcntl (server->sock, F_SETFL, flags | O_NONBLOCK);
+#if LIBGNUTLS_VERSION_NUMBER >= 0x030703 /* 3.7.3 */
+            /*
+             * if kernel TLS is enabled (in GnuTLS configuration), data sent
+             * is encrypted by the kernel
+             */
+            if (server->ssl_connected
+                && (gnutls_transport_is_ktls_enabled (server->gnutls_sess) & GNUTLS_KTLS_SEND))
+            {
+                server->ssl_ktls_send = 1;
+            }
+#endif /* LIBGNUTLS_VERSION_NUMBER >= 0x030703 */
             /* set IP */
             if (server->current_ip)
                 free (server->current_ip);
@@ -3566,10 +4938,7 @@ irc_server_connect_cb (const void *pointer, void *data,
                 server->current_address,
                 server->current_port,
                 (server->current_ip) ? server->current_ip : "?");
-            server->hook_fd = weechat_hook_fd (server->sock,
-                                               1, 0, 0,
-                                               &irc_server_recv_cb,
-                                               server, NULL);
+            irc_server_recv_start (server);
             /* login to server */
             irc_server_login (server);
             break;
@@ -3679,6 +5048,8 @@ irc_server_connect_cb (const void *pointer, void *data,
                 server->buffer,
                 _("%s%s: TLS handshake failed"),
                 weechat_prefix ("error"), IRC_PLUGIN_NAME);
+            /* do not try to resume the session again */
+            irc_server_tls_session_set (server, NULL, 0);
             if (error && error[0])
             {
                 weechat_printf (
@@ -4593,6 +5964,25 @@ irc_server_connect (struct t_irc_server *server)
         return 0;
     }
 #endif /* HAVE_GNUTLS */
+
+    /* wait if too many connections are in progress */
+    server->connect_queued = 0;
+    if ((weechat_config_integer (irc_config_network_connect_max) > 0)
+        && (irc_server_count_connecting (server) >=
+            weechat_config_integer (irc_config_network_connect_max)))
+    {
+        server->connect_queued = 1;
+        weechat_printf (
+            server->buffer,
+            _("%s%s: connection to server %s/%d is queued (too many "
+              "connections in progress)"),
+            weechat_prefix ("network"),
+            IRC_PLUGIN_NAME,
+            server->current_address,
+            server->current_port);
+        return 1;
+    }
+
     if (proxy_type)
     {
         weechat_printf (
@@ -4669,6 +6059,17 @@ irc_server_connect (struct t_irc_server *server)
         &irc_server_connect_cb,
         server,
         NULL);
+    /*
+     * the TLS session is initialized by hook_connect but the handshake
+     * is not yet started: try to resume the last session
+     */
+    if (server->hook_connect && server->ssl_connected
+        && server->tls_session_data.data)
+    {
+        gnutls_session_set_data (server->gnutls_sess,
+                                 server->tls_session_data.data,
+                                 server->tls_session_data.size);
+    }
 #else
     server->hook_connect = weechat_hook_connect (
         proxy,
@@ -4741,6 +6142,61 @@ irc_server_auto_connect_timer_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Callback for queued connections: starts connections waiting for a slot
+ * (according to option irc.network.connect_max).
+ */
+
+int
+irc_server_connect_queue_timer_cb (const void *pointer, void *data,
+                                   int remaining_calls)
+{
+    struct t_irc_server *ptr_server;
+    int connect_max;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    irc_server_hook_timer_connect_queue = NULL;
+
+    connect_max = weechat_config_integer (irc_config_network_connect_max);
+
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if ((connect_max > 0)
+            && (irc_server_count_connecting (NULL) >= connect_max))
+        {
+            break;
+        }
+        if (ptr_server->connect_queued)
+        {
+            ptr_server->connect_queued = 0;
+            if (!irc_server_connect (ptr_server))
+                irc_server_reconnect_schedule (ptr_server);
+        }
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Schedules start of queued connections (on next main loop iteration).
+ */
+
+void
+irc_server_connect_queue_schedule ()
+{
+    if (irc_server_hook_timer_connect_queue)
+        return;
+
+    irc_server_hook_timer_connect_queue = weechat_hook_timer (
+        1, 0, 1,
+        &irc_server_connect_queue_timer_cb, NULL, NULL);
+}
+
 /*
  * Auto-connects to servers (called at startup).
  *
@@ -5072,6 +6528,7 @@ irc_server_remove_away (struct t_irc_server *server)
                 irc_channel_remove_away (server, ptr_channel);
         }
         server->last_away_check = 0;
+        irc_server_timer_schedule (server);
     }
 }
 
@@ -5093,7 +6550,79 @@ irc_server_check_away (struct t_irc_server *server)
                 irc_channel_check_whox (server, ptr_channel);
         }
         server->last_away_check = time (NULL);
+        irc_server_timer_schedule (server);
+    }
+}
+
+/*
+ * Returns delay (in seconds) between two checks of away on channels of a
+ * server: the channels are checked one by one, so that each channel is
+ * checked once per "away_check" minutes, without sending a burst of WHO.
+ *
+ * Returns 0 if away must not be checked with WHO: option "away_check" is
+ * disabled, there is no channel, or capability "away-notify" is enabled
+ * (away status is then received for each nick, see function
+ * irc_protocol_cb_away).
+ */
+
+int
+irc_server_away_check_delay (struct t_irc_server *server)
+{
+    struct t_irc_channel *ptr_channel;
+    int away_check, channels, delay;
+
+    if (server->cap_away_notify)
+        return 0;
+
+    away_check = IRC_SERVER_OPTION_INTEGER(server,
+                                           IRC_SERVER_OPTION_AWAY_CHECK);
+    if (away_check <= 0)
+        return 0;
+
+    channels = 0;
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if (ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
+            channels++;
+    }
+    if (channels == 0)
+        return 0;
+
+    delay = (away_check * 60) / channels;
+
+    return (delay > 0) ? delay : 1;
+}
+
+/*
+ * Checks for away on the channel of a server checked for the longest time.
+ */
+
+void
+irc_server_check_away_next (struct t_irc_server *server)
+{
+    struct t_irc_channel *ptr_channel, *ptr_channel_check;
+
+    if (!server->is_connected)
+        return;
+
+    ptr_channel_check = NULL;
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if ((ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
+            && (ptr_channel->checking_whox <= 0)
+            && (!ptr_channel_check
+                || (ptr_channel->away_check_time < ptr_channel_check->away_check_time)))
+        {
+            ptr_channel_check = ptr_channel;
+        }
     }
+
+    if (ptr_channel_check)
+        irc_channel_check_whox (server, ptr_channel_check);
+    server->last_away_check = time (NULL);
+    irc_server_timer_schedule (server);
 }
 
 /*
@@ -5357,6 +6886,24 @@ irc_server_xfer_send_accept_resume_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Searches a server by name with the index (callback used by hdata_search).
+ */
+
+void *
+irc_server_hdata_search_name_cb (void *data, struct t_hdata *hdata,
+                                 void *pointer, const char *value)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) hdata;
+
+    if (pointer != irc_servers)
+        return NULL;
+
+    return irc_server_search (value);
+}
+
 /*
  * Returns hdata for server.
  */
@@ -5394,13 +6941,17 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_fd, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_connection, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_sasl, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, timer_next_time, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, is_connected, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, ssl_connected, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, disconnected, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_queued, INTEGER, 0, NULL, NULL);
 #ifdef HAVE_GNUTLS
         WEECHAT_HDATA_VAR(struct t_irc_server, gnutls_sess, OTHER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert, OTHER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert_key, OTHER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, tls_session_data, OTHER, 0, NULL, NULL);
 #endif /* HAVE_GNUTLS */
         WEECHAT_HDATA_VAR(struct t_irc_server, unterminated_message, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nicks_count, INTEGER, 0, NULL, NULL);
@@ -5436,12 +6987,27 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, lag_last_refresh, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, cmd_list_regexp, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_user_message, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, anti_flood_tokens, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, anti_flood_refill_time, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_away_check, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_data_purge, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_start, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_bytes_recv, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_bytes_sent, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_messages_recv, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_time_msgq, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_time_recv_command, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_time_modifiers, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_time_signals, LONG, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, stats_commands, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, outqueue, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_outqueue, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, redirects, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_redirect, POINTER, 0, NULL, "irc_redirect");
+        WEECHAT_HDATA_VAR(struct t_irc_server, redirects_cmd, HASHTABLE, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, redirects_in_progress, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, batches, POINTER, 0, NULL, "irc_batch");
+        WEECHAT_HDATA_VAR(struct t_irc_server, last_batch, POINTER, 0, NULL, "irc_batch");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_list, POINTER, 0, NULL, "irc_notify");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_notify, POINTER, 0, NULL, "irc_notify");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_count, INTEGER, 0, NULL, NULL);
@@ -5452,10 +7018,13 @@ irc_server_hdata_server_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_server, buffer_as_string, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, channels, POINTER, 0, NULL, "irc_channel");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_channel, POINTER, 0, NULL, "irc_channel");
+        WEECHAT_HDATA_VAR(struct t_irc_server, channels_hash, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, prev_server, POINTER, 0, NULL, hdata_name);
         WEECHAT_HDATA_VAR(struct t_irc_server, next_server, POINTER, 0, NULL, hdata_name);
         WEECHAT_HDATA_LIST(irc_servers, WEECHAT_HDATA_LIST_CHECK_POINTERS);
         WEECHAT_HDATA_LIST(last_irc_server, 0);
+        weechat_hdata_new_index (hdata, "name",
+                                 &irc_server_hdata_search_name_cb, NULL);
     }
     return hdata;
 }
@@ -5592,6 +7161,9 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
     if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_prio_low",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW)))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_burst",
+                                           IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST)))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "away_check",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK)))
         return 0;
@@ -5627,6 +7199,15 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "disconnected", server->disconnected))
         return 0;
+#ifdef HAVE_GNUTLS
+    if (server->tls_session_data.data)
+    {
+        if (!weechat_infolist_new_var_buffer (ptr_item, "tls_session_data",
+                                              server->tls_session_data.data,
+                                              server->tls_session_data.size))
+            return 0;
+    }
+#endif /* HAVE_GNUTLS */
     if (!weechat_infolist_new_var_string (ptr_item, "unterminated_message", server->unterminated_message))
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "nick", server->nick))
@@ -5950,6 +7531,13 @@ irc_server_print_log ()
         else
             weechat_log_printf ("  anti_flood_prio_low. : %d",
                                 weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]));
+        /* anti_flood_burst */
+        if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]))
+            weechat_log_printf ("  anti_flood_burst . . : null (%d)",
+                                IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST));
+        else
+            weechat_log_printf ("  anti_flood_burst . . : %d",
+                                weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]));
         /* away_check */
         if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_log_printf ("  away_check . . . . . : null (%d)",
@@ -6001,14 +7589,32 @@ irc_server_print_log ()
         weechat_log_printf ("  sock . . . . . . . . : %d",    ptr_server->sock);
         weechat_log_printf ("  hook_connect . . . . : 0x%lx", ptr_server->hook_connect);
         weechat_log_printf ("  hook_fd. . . . . . . : 0x%lx", ptr_server->hook_fd);
+        weechat_log_printf ("  reader . . . . . . . : 0x%lx", ptr_server->reader);
         weechat_log_printf ("  hook_timer_connection: 0x%lx", ptr_server->hook_timer_connection);
         weechat_log_printf ("  hook_timer_sasl. . . : 0x%lx", ptr_server->hook_timer_sasl);
+        weechat_log_printf ("  hook_timer . . . . . : 0x%lx", ptr_server->hook_timer);
+        weechat_log_printf ("  timer_next_time. . . : %ld",   ptr_server->timer_next_time);
         weechat_log_printf ("  is_connected . . . . : %d",    ptr_server->is_connected);
         weechat_log_printf ("  ssl_connected. . . . : %d",    ptr_server->ssl_connected);
+        weechat_log_printf ("  ssl_ktls_send. . . . : %d",    ptr_server->ssl_ktls_send);
         weechat_log_printf ("  disconnected . . . . : %d",    ptr_server->disconnected);
+        weechat_log_printf ("  connect_queued . . . : %d",    ptr_server->connect_queued);
 #ifdef HAVE_GNUTLS
         weechat_log_printf ("  gnutls_sess. . . . . : 0x%lx", ptr_server->gnutls_sess);
+        weechat_log_printf ("  tls_session_data . . : 0x%lx (size: %d)",
+                            ptr_server->tls_session_data.data,
+                            ptr_server->tls_session_data.size);
 #endif /* HAVE_GNUTLS */
+        weechat_log_printf ("  recv_buffer. . . . . : 0x%lx", ptr_server->recv_buffer);
+        if (ptr_server->recv_buffer)
+        {
+            weechat_log_printf ("    data . . . . . . . : 0x%lx", ptr_server->recv_buffer->data);
+            weechat_log_printf ("    size . . . . . . . : %d",    ptr_server->recv_buffer->size);
+            weechat_log_printf ("    length . . . . . . : %d",    ptr_server->recv_buffer->length);
+            weechat_log_printf ("    pos_unterminated . : %d",    ptr_server->recv_buffer->pos_unterminated);
+            weechat_log_printf ("    refcount . . . . . : %d",    ptr_server->recv_buffer->refcount);
+        }
+        weechat_log_printf ("  recv_size. . . . . . : %d",    ptr_server->recv_size);
         weechat_log_printf ("  unterminated_message : '%s'",  ptr_server->unterminated_message);
         weechat_log_printf ("  nicks_count. . . . . : %d",    ptr_server->nicks_count);
         weechat_log_printf ("  nicks_array. . . . . : 0x%lx", ptr_server->nicks_array);
@@ -6047,8 +7653,19 @@ irc_server_print_log ()
         weechat_log_printf ("  lag_last_refresh . . : %ld",   ptr_server->lag_last_refresh);
         weechat_log_printf ("  cmd_list_regexp. . . : 0x%lx", ptr_server->cmd_list_regexp);
         weechat_log_printf ("  last_user_message. . : %ld",   ptr_server->last_user_message);
+        weechat_log_printf ("  anti_flood_tokens. . : %d",    ptr_server->anti_flood_tokens);
+        weechat_log_printf ("  anti_flood_refill. . : %ld",   ptr_server->anti_flood_refill_time);
         weechat_log_printf ("  last_away_check. . . : %ld",   ptr_server->last_away_check);
         weechat_log_printf ("  last_data_purge. . . : %ld",   ptr_server->last_data_purge);
+        weechat_log_printf ("  stats_start. . . . . : %ld",   ptr_server->stats_start);
+        weechat_log_printf ("  stats_bytes_recv . . : %ld",   ptr_server->stats_bytes_recv);
+        weechat_log_printf ("  stats_bytes_sent . . : %ld",   ptr_server->stats_bytes_sent);
+        weechat_log_printf ("  stats_messages_recv. : %ld",   ptr_server->stats_messages_recv);
+        weechat_log_printf ("  stats_time_msgq. . . : %ld",   ptr_server->stats_time_msgq);
+        weechat_log_printf ("  stats_time_recv_cmd. : %ld",   ptr_server->stats_time_recv_command);
+        weechat_log_printf ("  stats_time_modifiers : %ld",   ptr_server->stats_time_modifiers);
+        weechat_log_printf ("  stats_time_signals . : %ld",   ptr_server->stats_time_signals);
+        weechat_log_printf ("  stats_commands . . . : 0x%lx", ptr_server->stats_commands);
         for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
         {
             weechat_log_printf ("  outqueue[%02d] . . . . : 0x%lx", i, ptr_server->outqueue[i]);
@@ -6056,9 +7673,18 @@ irc_server_print_log ()
         }
         weechat_log_printf ("  redirects. . . . . . : 0x%lx", ptr_server->redirects);
         weechat_log_printf ("  last_redirect. . . . : 0x%lx", ptr_server->last_redirect);
+        weechat_log_printf ("  redirects_cmd. . . . : 0x%lx (hashtable: '%s')",
+                            ptr_server->redirects_cmd,
+                            weechat_hashtable_get_string (ptr_server->redirects_cmd,
+                                                          "keys_values"));
+        weechat_log_printf ("  redirects_in_progress: %d",    ptr_server->redirects_in_progress);
+        weechat_log_printf ("  batches. . . . . . . : 0x%lx", ptr_server->batches);
+        weechat_log_printf ("  last_batch . . . . . : 0x%lx", ptr_server->last_batch);
         weechat_log_printf ("  notify_list. . . . . : 0x%lx", ptr_server->notify_list);
         weechat_log_printf ("  last_notify. . . . . : 0x%lx", ptr_server->last_notify);
         weechat_log_printf ("  notify_count . . . . : %d",    ptr_server->notify_count);
+        weechat_log_printf ("  notify_ison. . . . . : 0x%lx", ptr_server->notify_ison);
+        weechat_log_printf ("  notify_ison_count. . : %d",    ptr_server->notify_ison_count);
         weechat_log_printf ("  join_manual. . . . . : 0x%lx (hashtable: '%s')",
                             ptr_server->join_manual,
                             weechat_hashtable_get_string (ptr_server->join_manual, "keys_values"));
@@ -6072,11 +7698,14 @@ irc_server_print_log ()
         weechat_log_printf ("  buffer_as_string . . : 0x%lx", ptr_server->buffer_as_string);
         weechat_log_printf ("  channels . . . . . . : 0x%lx", ptr_server->channels);
         weechat_log_printf ("  last_channel . . . . : 0x%lx", ptr_server->last_channel);
+        weechat_log_printf ("  channels_hash. . . . : 0x%lx", ptr_server->channels_hash);
         weechat_log_printf ("  prev_server. . . . . : 0x%lx", ptr_server->prev_server);
         weechat_log_printf ("  next_server. . . . . : 0x%lx", ptr_server->next_server);
 
         irc_redirect_print_log (ptr_server);
 
+        irc_batch_print_log (ptr_server);
+
         irc_notify_print_log (ptr_server);
 
         for (ptr_channel = ptr_server->channels; ptr_channel;
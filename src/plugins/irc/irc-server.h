@@ -78,6 +78,7 @@ enum t_irc_server_option
     IRC_SERVER_OPTION_CONNECTION_TIMEOUT,   /* timeout for connection        */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH, /* anti-flood (high priority)    */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW,  /* anti-flood (low priority)     */
+    IRC_SERVER_OPTION_ANTI_FLOOD_BURST,     /* anti-flood: msgs sent at once */
     IRC_SERVER_OPTION_AWAY_CHECK,           /* delay between away checks     */
     IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS, /* max nicks for away check      */
     IRC_SERVER_OPTION_MSG_KICK,             /* default kick message          */
@@ -116,6 +117,19 @@ enum t_irc_server_option
 /* number of queues for sending messages */
 #define IRC_SERVER_NUM_OUTQUEUES_PRIO 2
 
+/* size of data read on socket (adjusted with amount of data received) */
+#define IRC_SERVER_RECV_SIZE_MIN 4096
+#define IRC_SERVER_RECV_SIZE_MAX 65536
+
+/* max time reading data on socket in one call (in milliseconds) */
+#define IRC_SERVER_RECV_TIME_MAX 20
+
+/* max number of received messages processed before giving hand to WeeChat */
+#define IRC_SERVER_MSGQ_FLUSH_MAX 256
+
+/* number of commands/channels displayed by /server stats */
+#define IRC_SERVER_STATS_TOP 10
+
 /* flags for irc_server_sendf() */
 #define IRC_SERVER_SEND_OUTQ_PRIO_HIGH   1
 #define IRC_SERVER_SEND_OUTQ_PRIO_LOW    2
@@ -133,6 +147,9 @@ enum t_irc_server_casemapping
 
 /* output queue of messages to server (for sending slowly to server) */
 
+#define IRC_SERVER_OUTQUEUE_DATA_SIZE 1024
+#define IRC_SERVER_OUTQUEUE_POOL_MAX  64
+
 struct t_irc_outqueue
 {
     char *command;                        /* IRC command                     */
@@ -141,10 +158,48 @@ struct t_irc_outqueue
     int modified;                         /* msg was modified by modifier(s) */
     char *tags;                           /* tags (used by Relay plugin)     */
     struct t_irc_redirect *redirect;      /* command redirection             */
+    int data_size;                        /* size allocated after struct for */
+                                          /* strings (command, msgs, tags)   */
     struct t_irc_outqueue *next_outqueue; /* link to next msg in queue       */
     struct t_irc_outqueue *prev_outqueue; /* link to prev msg in queue       */
 };
 
+/* split messages sent to server by irc_server_sendf (sent directly) */
+
+struct t_irc_server_send_split
+{
+    struct t_irc_server *server;          /* server                          */
+    int flags;                            /* flags for irc_server_sendf      */
+    const char *nick;                     /* nick in message                 */
+    const char *command;                  /* IRC command                     */
+    const char *channel;                  /* channel in message              */
+    const char *tags;                     /* tags (used by Relay plugin)     */
+    struct t_hashtable *ret_hashtable;    /* split messages (if asked)       */
+    int ret_number;                       /* number of split messages        */
+    int rc;                               /* 0 if a message was not sent     */
+};
+
+/* processing cost of a command received (stats) */
+
+struct t_irc_server_stats_command
+{
+    long count;                           /* number of messages received     */
+    long bytes;                           /* bytes received                  */
+    long time;                            /* time spent (in microseconds)    */
+};
+
+/* item of a list of stats sorted by time (for /server stats) */
+
+struct t_irc_server_stats_item
+{
+    const char *name;                     /* command or channel name         */
+    long count;                           /* number of messages received     */
+    long bytes;                           /* bytes received                  */
+    long time;                            /* time spent (in microseconds)    */
+};
+
+struct t_irc_reader;
+
 struct t_irc_server
 {
     /* user choices */
@@ -168,17 +223,28 @@ struct t_irc_server
     int sock;                       /* socket for server                     */
     struct t_hook *hook_connect;    /* connection hook                       */
     struct t_hook *hook_fd;         /* hook for server socket                */
+    struct t_irc_reader *reader;    /* thread reading socket (if enabled)    */
     struct t_hook *hook_timer_connection; /* timer for connection            */
     struct t_hook *hook_timer_sasl; /* timer for SASL authentication         */
+    struct t_hook *hook_timer;      /* timer for next event (lag, reconnect) */
+    time_t timer_next_time;         /* time of next event (0 = no event)     */
     int is_connected;               /* 1 if WeeChat is connected to server   */
     int ssl_connected;              /* = 1 if connected with SSL             */
+    int ssl_ktls_send;              /* = 1 if kernel TLS is used to send     */
     int disconnected;               /* 1 if server has been disconnected     */
+    int connect_queued;             /* 1 if connection is waiting for a slot */
+                                    /* (see option irc.network.connect_max)  */
 #ifdef HAVE_GNUTLS
     gnutls_session_t gnutls_sess;   /* gnutls session (only if SSL is used)  */
     gnutls_x509_crt_t tls_cert;     /* certificate used if ssl_cert is set   */
     gnutls_x509_privkey_t tls_cert_key; /* key used if ssl_cert is set       */
+    gnutls_datum_t tls_session_data; /* TLS session data saved on disconnect */
+                                    /* (to resume session on reconnection)   */
 #endif /* HAVE_GNUTLS */
+    struct t_irc_recv_buffer *recv_buffer; /* buffer for data received   */
+    int recv_size;                  /* size of next read on socket           */
     char *unterminated_message;     /* beginning of a message in input buf   */
+                                    /* (pointer in recv_buffer)              */
     int nicks_count;                /* number of nicknames                   */
     char **nicks_array;             /* nicknames (after split)               */
     int nick_first_tried;           /* first nick tried in list of nicks     */
@@ -216,16 +282,35 @@ struct t_irc_server
     time_t lag_last_refresh;        /* last refresh of lag item              */
     regex_t *cmd_list_regexp;       /* compiled Regular Expression for /list */
     time_t last_user_message;       /* time of last user message (anti flood)*/
+    int anti_flood_tokens;          /* msgs that can be sent now (anti flood)*/
+    time_t anti_flood_refill_time;  /* last refill of anti flood tokens      */
     time_t last_away_check;         /* time of last away check on server     */
     time_t last_data_purge;         /* time of last purge (some hashtables)  */
+    time_t stats_start;             /* start time of stats (or last reset)   */
+    long stats_bytes_recv;          /* bytes received on socket              */
+    long stats_bytes_sent;          /* bytes sent on socket                  */
+    long stats_messages_recv;       /* messages received and parsed          */
+    long stats_time_msgq;           /* time processing msgs (microseconds)   */
+    long stats_time_recv_command;   /* time in commands callbacks (microsec) */
+    long stats_time_modifiers;      /* time in modifiers irc_in/2 (microsec) */
+    long stats_time_signals;        /* time in signals sent (microseconds)   */
+    struct t_hashtable *stats_commands; /* stats by command received     */
     struct t_irc_outqueue *outqueue[2];      /* queue for outgoing messages  */
                                              /* with 2 priorities (high/low) */
     struct t_irc_outqueue *last_outqueue[2]; /* last outgoing message        */
     struct t_irc_redirect *redirects;        /* command redirections         */
     struct t_irc_redirect *last_redirect;    /* last command redirection     */
+    struct t_hashtable *redirects_cmd;       /* redirects by command waited  */
+    int redirects_in_progress;               /* number of redirects with     */
+                                             /* start or stop cmd received   */
+    struct t_irc_batch *batches;             /* batches of messages received */
+    struct t_irc_batch *last_batch;          /* last batch                   */
     struct t_irc_notify *notify_list;        /* list of notify               */
     struct t_irc_notify *last_notify;        /* last notify                  */
     int notify_count;                        /* number of notify in list     */
+    char **notify_ison;                      /* ISON messages for notify list*/
+                                             /* (NULL if list has changed)   */
+    int notify_ison_count;                   /* number of ISON messages      */
     struct t_hashtable *join_manual;         /* manual joins pending         */
     struct t_hashtable *join_channel_key;    /* keys pending for joins       */
     struct t_hashtable *join_noswitch;       /* joins w/o switch to buffer   */
@@ -233,16 +318,34 @@ struct t_irc_server
     char *buffer_as_string;               /* used to return buffer info      */
     struct t_irc_channel *channels;       /* opened channels on server       */
     struct t_irc_channel *last_channel;   /* last opened channel on server   */
+    struct t_hashtable *channels_hash;    /* channels by name (case folded)  */
     struct t_irc_server *prev_server;     /* link to previous server         */
     struct t_irc_server *next_server;     /* link to next server             */
 };
 
 /* IRC messages */
 
+/*
+ * buffer for data received from a server: messages in queue are pointers
+ * to data in this buffer, so the buffer is freed when it is not used any
+ * more by the server and by messages in queue
+ */
+
+struct t_irc_recv_buffer
+{
+    char *data;                         /* data received                     */
+    int size;                           /* allocated size of data            */
+    int length;                         /* length of data (without '\0')     */
+    int pos_unterminated;               /* start of unterminated message     */
+    int refcount;                       /* number of users of this buffer    */
+};
+
 struct t_irc_message
 {
     struct t_irc_server *server;        /* server pointer for received msg   */
-    char *data;                         /* message content                   */
+    struct t_irc_recv_buffer *recv_buffer; /* buffer with message content   */
+    char *data;                         /* message content (in recv_buffer)  */
+    struct timeval date_recv;           /* date of reception (0 if unknown)  */
     struct t_irc_message *next_message; /* link to next message              */
 };
 
@@ -260,19 +363,32 @@ enum t_irc_fingerprint_digest_algo
 #endif /* HAVE_GNUTLS */
 
 extern struct t_irc_server *irc_servers;
+extern struct t_hashtable *irc_servers_hash;
 #ifdef HAVE_GNUTLS
 extern const int gnutls_cert_type_prio[];
 extern const int gnutls_prot_prio[];
 #endif /* HAVE_GNUTLS */
 extern struct t_irc_message *irc_recv_msgq, *irc_msgq_last_msg;
 extern char *irc_server_sasl_fail_string[];
+extern char *irc_server_casemapping_string[];
+extern int irc_server_casemapping_range[];
+extern unsigned char irc_server_casemapping_fold[][256];
 extern char *irc_server_options[][2];
 
 extern int irc_server_valid (struct t_irc_server *server);
+extern void irc_server_hash_add (struct t_irc_server *server);
+extern void irc_server_hash_remove (struct t_irc_server *server);
 extern struct t_irc_server *irc_server_search (const char *server_name);
 extern struct t_irc_server *irc_server_casesearch (const char *server_name);
 extern int irc_server_search_option (const char *option_name);
 extern int irc_server_search_casemapping (const char *casemapping);
+extern void irc_server_casemapping_init ();
+extern const unsigned char *irc_server_get_casemapping_fold (struct t_irc_server *server);
+extern void irc_server_set_casemapping (struct t_irc_server *server,
+                                        int casemapping);
+extern char *irc_server_string_fold (struct t_irc_server *server,
+                                     const char *string, char *buffer,
+                                     int size);
 extern int irc_server_strcasecmp (struct t_irc_server *server,
                                   const char *string1, const char *string2);
 extern int irc_server_strncasecmp (struct t_irc_server *server,
@@ -324,23 +440,53 @@ extern struct t_hashtable *irc_server_sendf (struct t_irc_server *server,
                                              int flags,
                                              const char *tags,
                                              const char *format, ...);
+extern char *irc_server_recv_buffer_reserve (struct t_irc_server *server,
+                                             int size);
+extern void irc_server_recv_buffer_unref (struct t_irc_recv_buffer *recv_buffer);
+extern void irc_server_msgq_add_received (struct t_irc_server *server,
+                                          int length,
+                                          struct timeval *date_recv);
 extern void irc_server_msgq_add_buffer (struct t_irc_server *server,
                                         const char *buffer);
+extern void irc_server_stats_add_message (struct t_irc_server *server,
+                                         const char *command,
+                                         const char *channel,
+                                         int bytes, long time_usec);
+extern void irc_server_stats_reset (struct t_irc_server *server);
+extern struct t_irc_server_stats_item *irc_server_stats_sort_commands (struct t_irc_server *server,
+                                                                       int *num_items);
+extern struct t_irc_server_stats_item *irc_server_stats_sort_channels (struct t_irc_server *server,
+                                                                       int *num_items);
+extern char *irc_server_recv_modifier_exec (struct t_irc_server *server,
+                                           const char *modifier,
+                                           const char *string);
+extern int irc_server_msgq_process (int max_messages);
 extern void irc_server_msgq_flush ();
+extern void irc_server_msgq_flush_partial ();
+extern void irc_server_msgq_remove_server (struct t_irc_server *server);
 extern void irc_server_set_buffer_title (struct t_irc_server *server);
 extern struct t_gui_buffer *irc_server_create_buffer (struct t_irc_server *server);
 #ifdef HAVE_GNUTLS
 int irc_server_fingerprint_search_algo_with_size (int size);
 char *irc_server_fingerprint_str_sizes ();
 #endif /* HAVE_GNUTLS */
+extern void irc_server_tls_session_set (struct t_irc_server *server,
+                                        const void *data, int size);
 extern int irc_server_connect (struct t_irc_server *server);
+extern void irc_server_connect_queue_schedule ();
 extern void irc_server_auto_connect (int auto_connect);
 extern void irc_server_autojoin_channels ();
+extern void irc_server_recv_error (struct t_irc_server *server, int num_read,
+                                   int error);
 extern int irc_server_recv_cb (const void *pointer, void *data, int fd);
+extern void irc_server_recv_start (struct t_irc_server *server);
 extern int irc_server_timer_sasl_cb (const void *pointer, void *data,
                                      int remaining_calls);
+extern void irc_server_timer_schedule (struct t_irc_server *server);
+extern void irc_server_timer_schedule_all ();
 extern int irc_server_timer_cb (const void *pointer, void *data,
                                 int remaining_calls);
+extern void irc_server_outqueue_pool_free ();
 extern void irc_server_outqueue_free_all (struct t_irc_server *server,
                                           int priority);
 extern int irc_server_get_channel_count (struct t_irc_server *server);
@@ -349,6 +495,8 @@ extern void irc_server_set_away (struct t_irc_server *server, const char *nick,
                                  int is_away);
 extern void irc_server_remove_away (struct t_irc_server *server);
 extern void irc_server_check_away (struct t_irc_server *server);
+extern int irc_server_away_check_delay (struct t_irc_server *server);
+extern void irc_server_check_away_next (struct t_irc_server *server);
 extern void irc_server_switch_address (struct t_irc_server *server,
                                        int connection);
 extern void irc_server_disconnect (struct t_irc_server *server,
@@ -164,8 +164,8 @@ irc_upgrade_save_all_data (struct t_upgrade_file *upgrade_file)
     }
 
     /* save raw messages */
-    for (ptr_raw_message = irc_raw_messages; ptr_raw_message;
-         ptr_raw_message = ptr_raw_message->next_message)
+    for (ptr_raw_message = irc_raw_message_get_first (); ptr_raw_message;
+         ptr_raw_message = irc_raw_message_get_next (ptr_raw_message))
     {
         infolist = weechat_infolist_new ();
         if (!infolist)
@@ -353,22 +353,20 @@ irc_upgrade_read_cb (const void *pointer, void *data,
                     if (str)
                         irc_upgrade_current_server->current_ip = strdup (str);
                     sock = weechat_infolist_integer (infolist, "sock");
+                    irc_upgrade_current_server->is_connected = weechat_infolist_integer (infolist, "is_connected");
+                    irc_upgrade_current_server->ssl_connected = weechat_infolist_integer (infolist, "ssl_connected");
                     if (sock >= 0)
                     {
                         irc_upgrade_current_server->sock = sock;
-                        irc_upgrade_current_server->hook_fd = weechat_hook_fd (
-                            irc_upgrade_current_server->sock,
-                            1, 0, 0,
-                            &irc_server_recv_cb,
-                            irc_upgrade_current_server,
-                            NULL);
+                        irc_server_recv_start (irc_upgrade_current_server);
                     }
-                    irc_upgrade_current_server->is_connected = weechat_infolist_integer (infolist, "is_connected");
-                    irc_upgrade_current_server->ssl_connected = weechat_infolist_integer (infolist, "ssl_connected");
                     irc_upgrade_current_server->disconnected = weechat_infolist_integer (infolist, "disconnected");
+                    buf = weechat_infolist_buffer (infolist, "tls_session_data", &size);
+                    if (buf)
+                        irc_server_tls_session_set (irc_upgrade_current_server, buf, size);
                     str = weechat_infolist_string (infolist, "unterminated_message");
                     if (str)
-                        irc_upgrade_current_server->unterminated_message = strdup (str);
+                        irc_server_msgq_add_buffer (irc_upgrade_current_server, str);
                     str = weechat_infolist_string (infolist, "nick");
                     if (str)
                         irc_server_set_nick (irc_upgrade_current_server, str);
@@ -495,6 +493,7 @@ irc_upgrade_read_cb (const void *pointer, void *data,
                             }
                         }
                         irc_upgrade_current_channel->checking_whox = weechat_infolist_integer (infolist, "checking_whox");
+                        irc_upgrade_current_channel->away_check_time = weechat_infolist_time (infolist, "away_check_time");
                         str = weechat_infolist_string (infolist, "away_message");
                         if (str)
                             irc_upgrade_current_channel->away_message = strdup (str);
@@ -679,8 +678,10 @@ irc_upgrade_read_cb (const void *pointer, void *data,
                             ptr_redirect->command = strdup (str);
                         ptr_redirect->assigned_to_command = weechat_infolist_integer (infolist, "assigned_to_command");
                         ptr_redirect->start_time = weechat_infolist_time (infolist, "start_time");
-                        ptr_redirect->cmd_start_received = weechat_infolist_integer (infolist, "cmd_start_received");
-                        ptr_redirect->cmd_stop_received = weechat_infolist_integer (infolist, "cmd_stop_received");
+                        irc_redirect_set_received (
+                            ptr_redirect,
+                            weechat_infolist_integer (infolist, "cmd_start_received"),
+                            weechat_infolist_integer (infolist, "cmd_stop_received"));
                         str = weechat_infolist_string (infolist, "output");
                         if (str)
                             ptr_redirect->output = strdup (str);
@@ -40,6 +40,7 @@
 #include "irc-notify.h"
 #include "irc-protocol.h"
 #include "irc-raw.h"
+#include "irc-reader.h"
 #include "irc-redirect.h"
 #include "irc-server.h"
 #include "irc-upgrade.h"
@@ -54,7 +55,6 @@ WEECHAT_PLUGIN_PRIORITY(5000);
 
 struct t_weechat_plugin *weechat_irc_plugin = NULL;
 
-struct t_hook *irc_hook_timer = NULL;
 
 int irc_signal_upgrade_received = 0;   /* signal "upgrade" received ?       */
 
@@ -168,6 +168,10 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_plugin = plugin;
 
+    irc_server_casemapping_init ();
+
+    irc_protocol_init ();
+
     if (!irc_config_init ())
         return WEECHAT_RC_ERROR;
 
@@ -259,9 +263,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
         irc_server_auto_connect (auto_connect);
     }
 
-    irc_hook_timer = weechat_hook_timer (1 * 1000, 0, 0,
-                                         &irc_server_timer_cb,
-                                         NULL, NULL);
+    /* schedule timers of servers (for servers restored by upgrade) */
+    irc_server_timer_schedule_all ();
 
     return WEECHAT_RC_OK;
 }
@@ -273,11 +276,20 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 int
 weechat_plugin_end (struct t_weechat_plugin *plugin)
 {
+    struct t_irc_server *ptr_server;
+
     /* make C compiler happy */
     (void) plugin;
 
-    if (irc_hook_timer)
-        weechat_unhook (irc_hook_timer);
+    /* stop reader threads (data received is added to messages queue) */
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        irc_reader_stop (ptr_server, 1);
+    }
+
+    /* process messages received and not yet processed */
+    irc_server_msgq_flush ();
 
     if (irc_signal_upgrade_received)
     {
@@ -296,6 +308,11 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     irc_server_free_all ();
 
+    /* free messages of servers disconnected above */
+    irc_server_msgq_flush ();
+
+    irc_server_outqueue_pool_free ();
+
     irc_config_free ();
 
     irc_notify_end ();
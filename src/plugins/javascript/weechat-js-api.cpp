@@ -1776,6 +1776,28 @@ API_FUNC(print_date_tags)
     API_RETURN_OK;
 }
 
+API_FUNC(print_lines)
+{
+    int date;
+
+    API_INIT_FUNC(1, "print_lines", "siss", API_RETURN_ERROR);
+
+    v8::String::Utf8Value buffer(args[0]);
+    date = args[1]->IntegerValue();
+    v8::String::Utf8Value tags(args[2]);
+    v8::String::Utf8Value lines(args[3]);
+
+    plugin_script_api_print_lines (
+        weechat_js_plugin,
+        js_current_script,
+        (struct t_gui_buffer *)API_STR2PTR(*buffer),
+        date,
+        *tags,
+        *lines);
+
+    API_RETURN_OK;
+}
+
 API_FUNC(print_y)
 {
     int y;
@@ -4572,6 +4594,52 @@ API_FUNC(hdata_hashtable)
     return result_obj;
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * object with the variables of object in the array.
+ */
+
+void
+weechat_js_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                               void *pointer, struct t_hashtable *record)
+{
+    v8::Handle<v8::Array> *array;
+
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    array = (v8::Handle<v8::Array> *)data;
+
+    (*array)->Set ((*array)->Length (),
+                   weechat_js_hashtable_to_object (record));
+}
+
+API_FUNC(hdata_fetch)
+{
+    int count;
+    v8::Handle<v8::Array> result_array;
+
+    API_INIT_FUNC(1, "hdata_fetch", "sssi", API_RETURN_EMPTY);
+
+    v8::String::Utf8Value hdata(args[0]);
+    v8::String::Utf8Value pointer(args[1]);
+    v8::String::Utf8Value fields(args[2]);
+    count = args[3]->IntegerValue();
+
+    result_array = v8::Array::New ();
+
+    weechat_hdata_fetch (
+        (struct t_hdata *)API_STR2PTR(*hdata),
+        API_STR2PTR(*pointer),
+        *fields,
+        count,
+        &weechat_js_api_hdata_fetch_cb,
+        &result_array);
+
+    return result_array;
+}
+
 API_FUNC(hdata_update)
 {
     struct t_hashtable *hashtable;
@@ -4727,9 +4795,22 @@ API_FUNC(upgrade_close)
     API_RETURN_OK;
 }
 
+/*
+ * Loads weechat API in the global template of script.
+ *
+ * The template is built only once, on first call, then it is shared by all
+ * scripts (each script still has its own context).
+ */
+
 void
 WeechatJsV8::loadLibs()
 {
+    if (!globalLibs.IsEmpty())
+    {
+        this->global = globalLibs;
+        return;
+    }
+
     v8::Local<v8::ObjectTemplate> weechat_obj = v8::ObjectTemplate::New();
 
     /* constants */
@@ -4858,6 +4939,7 @@ WeechatJsV8::loadLibs()
     API_DEF_FUNC(color);
     API_DEF_FUNC(print);
     API_DEF_FUNC(print_date_tags);
+    API_DEF_FUNC(print_lines);
     API_DEF_FUNC(print_y);
     API_DEF_FUNC(log_print);
     API_DEF_FUNC(hook_command);
@@ -4966,6 +5048,7 @@ WeechatJsV8::loadLibs()
     API_DEF_FUNC(hdata_pointer);
     API_DEF_FUNC(hdata_time);
     API_DEF_FUNC(hdata_hashtable);
+    API_DEF_FUNC(hdata_fetch);
     API_DEF_FUNC(hdata_update);
     API_DEF_FUNC(hdata_get_string);
     API_DEF_FUNC(upgrade_new);
@@ -4974,4 +5057,6 @@ WeechatJsV8::loadLibs()
     API_DEF_FUNC(upgrade_close);
 
     this->addGlobal ("weechat", weechat_obj);
+
+    globalLibs = v8::Persistent<v8::ObjectTemplate>::New(this->global);
 }
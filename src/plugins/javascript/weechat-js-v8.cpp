@@ -43,6 +43,10 @@ extern "C"
 using namespace v8;
 
 
+/* global template with weechat API, shared by all scripts */
+Persistent<ObjectTemplate> WeechatJsV8::globalLibs;
+
+
 /*
  * Constructor.
  */
@@ -172,3 +176,17 @@ WeechatJsV8::addGlobal(const char *key, Handle<Template> val)
 {
     this->addGlobal(String::New(key), val);
 }
+
+/*
+ * Frees the global template with weechat API (shared by all scripts).
+ */
+
+void
+WeechatJsV8::freeLibs()
+{
+    if (!globalLibs.IsEmpty())
+    {
+        globalLibs.Dispose();
+        globalLibs.Clear();
+    }
+}
@@ -42,8 +42,11 @@ public:
     void addGlobal(const char *, v8::Handle<v8::Template>);
 
     void loadLibs(void);
+    static void freeLibs(void);
 
 private:
+    static v8::Persistent<v8::ObjectTemplate> globalLibs;
+
     v8::HandleScope handle_scope;
     v8::Handle<v8::ObjectTemplate> global;
     v8::Persistent<v8::Context> context;
@@ -857,6 +857,7 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
         free (js_action_remove_list);
     if (js_action_autoload_list)
         free (js_action_autoload_list);
+    WeechatJsV8::freeLibs();
 
     return WEECHAT_RC_OK;
 }
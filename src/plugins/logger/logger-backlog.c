@@ -0,0 +1,354 @@
+/*
+ * logger-backlog.c - threads reading backlog of buffers for logger plugin
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When a buffer is opened, the end of its log file is read by a pool of
+ * threads (started on first backlog), so that opening many buffers (for
+ * example on autojoin) is not blocked by reads of log files; rotated and
+ * compressed log files are read by the threads as well.
+ *
+ * Lines read are displayed by the main thread (woken up with an async event),
+ * in a batch of lines moved on top of buffer: lines displayed in the buffer
+ * while the backlog was read stay after the backlog.
+ *
+ * Only the size of log file when the backlog is asked is read, so that lines
+ * logged after are not displayed in backlog. The WeeChat API is never called
+ * by the threads (except to post the async event).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "../weechat-plugin.h"
+#include "logger.h"
+#include "logger-backlog.h"
+#include "logger-buffer.h"
+#include "logger-tail.h"
+#include "logger-writer.h"
+
+
+pthread_t logger_backlog_threads[LOGGER_BACKLOG_THREADS];
+int logger_backlog_threads_count = 0;   /* number of threads running         */
+int logger_backlog_threads_started = 0; /* 1 if threads have been started    */
+pthread_mutex_t logger_backlog_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t logger_backlog_cond_queued = PTHREAD_COND_INITIALIZER;
+
+/* variables below are protected by the mutex */
+struct t_logger_backlog_job *logger_backlog_jobs = NULL; /* jobs (in order) */
+struct t_logger_backlog_job *logger_backlog_last_job = NULL;
+int logger_backlog_event_pending = 0;   /* 1 if async event has been posted */
+int logger_backlog_quit = 0;            /* 1 if threads must stop            */
+
+
+/*
+ * Frees a job.
+ */
+
+void
+logger_backlog_job_free (struct t_logger_backlog_job *job)
+{
+    if (job->filename)
+        free (job->filename);
+    if (job->last_lines)
+        logger_tail_free (job->last_lines);
+    free (job);
+}
+
+/*
+ * Callback for async event posted by reader threads: displays backlog of all
+ * jobs done.
+ */
+
+int
+logger_backlog_reader_display_cb (const void *pointer, void *data)
+{
+    struct t_logger_backlog_job *jobs_done, *last_job_done, *ptr_job;
+    struct t_logger_backlog_job *prev_job, *next_job;
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    pthread_mutex_lock (&logger_backlog_mutex);
+
+    logger_backlog_event_pending = 0;
+
+    /* take jobs done (other jobs stay in list) */
+    jobs_done = NULL;
+    last_job_done = NULL;
+    prev_job = NULL;
+    ptr_job = logger_backlog_jobs;
+    while (ptr_job)
+    {
+        next_job = ptr_job->next_job;
+        if (ptr_job->status == LOGGER_BACKLOG_JOB_DONE)
+        {
+            if (prev_job)
+                prev_job->next_job = next_job;
+            else
+                logger_backlog_jobs = next_job;
+            ptr_job->next_job = NULL;
+            if (last_job_done)
+                last_job_done->next_job = ptr_job;
+            else
+                jobs_done = ptr_job;
+            last_job_done = ptr_job;
+        }
+        else
+        {
+            prev_job = ptr_job;
+        }
+        ptr_job = next_job;
+    }
+    logger_backlog_last_job = prev_job;
+
+    pthread_mutex_unlock (&logger_backlog_mutex);
+
+    while (jobs_done)
+    {
+        ptr_job = jobs_done;
+        jobs_done = jobs_done->next_job;
+        if (ptr_job->buffer && ptr_job->last_lines)
+        {
+            /* do not log the backlog in the log file */
+            ptr_logger_buffer = logger_buffer_search_buffer (ptr_job->buffer);
+            if (ptr_logger_buffer)
+                ptr_logger_buffer->log_enabled = 0;
+            logger_backlog_display (ptr_job->buffer, ptr_job->last_lines, 1);
+            if (ptr_logger_buffer)
+                ptr_logger_buffer->log_enabled = 1;
+        }
+        logger_backlog_job_free (ptr_job);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Main function of a reader thread: reads backlog of jobs queued, then posts
+ * an async event to display lines (one event for all jobs done until the main
+ * thread displays them).
+ */
+
+void *
+logger_backlog_thread_run (void *arg)
+{
+    struct t_logger_backlog_job *ptr_job;
+    struct t_logger_line *last_lines;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&logger_backlog_mutex);
+
+    while (!logger_backlog_quit)
+    {
+        for (ptr_job = logger_backlog_jobs; ptr_job;
+             ptr_job = ptr_job->next_job)
+        {
+            if (ptr_job->status == LOGGER_BACKLOG_JOB_QUEUED)
+                break;
+        }
+        if (!ptr_job)
+        {
+            pthread_cond_wait (&logger_backlog_cond_queued,
+                               &logger_backlog_mutex);
+            continue;
+        }
+
+        ptr_job->status = LOGGER_BACKLOG_JOB_READING;
+
+        pthread_mutex_unlock (&logger_backlog_mutex);
+
+        /* read log files (without lock, the job is not freed while read) */
+        last_lines = logger_backlog_tail (ptr_job->filename, ptr_job->lines,
+                                          ptr_job->size);
+
+        pthread_mutex_lock (&logger_backlog_mutex);
+
+        ptr_job->last_lines = last_lines;
+        ptr_job->status = LOGGER_BACKLOG_JOB_DONE;
+        if (!logger_backlog_event_pending && !logger_backlog_quit)
+        {
+            logger_backlog_event_pending = 1;
+            weechat_async_post (&logger_backlog_reader_display_cb, NULL, NULL);
+        }
+    }
+
+    pthread_mutex_unlock (&logger_backlog_mutex);
+
+    return NULL;
+}
+
+/*
+ * Starts the reader threads.
+ *
+ * Returns:
+ *   1: OK (at least one thread started)
+ *   0: error (no thread started)
+ */
+
+int
+logger_backlog_reader_init ()
+{
+    int i;
+
+    logger_backlog_threads_started = 1;
+    logger_backlog_quit = 0;
+
+    for (i = 0; i < LOGGER_BACKLOG_THREADS; i++)
+    {
+        if (pthread_create (&logger_backlog_threads[logger_backlog_threads_count],
+                            NULL, &logger_backlog_thread_run, NULL) == 0)
+        {
+            logger_backlog_threads_count++;
+        }
+    }
+
+    return (logger_backlog_threads_count > 0) ? 1 : 0;
+}
+
+/*
+ * Queues the read of backlog for a buffer: lines are read by a thread, then
+ * displayed on top of buffer.
+ *
+ * Returns:
+ *   1: OK (backlog will be displayed later)
+ *   0: error (no thread is running, backlog must be read by caller)
+ */
+
+int
+logger_backlog_reader_queue (struct t_gui_buffer *buffer,
+                             const char *filename, int lines)
+{
+    struct t_logger_backlog_job *new_job;
+    struct stat st;
+
+    if (!buffer || !filename || (lines <= 0))
+        return 0;
+
+    if (!logger_backlog_threads_started)
+        logger_backlog_reader_init ();
+    if (logger_backlog_threads_count == 0)
+        return 0;
+
+    new_job = malloc (sizeof (*new_job));
+    if (!new_job)
+        return 0;
+    new_job->filename = strdup (filename);
+    if (!new_job->filename)
+    {
+        free (new_job);
+        return 0;
+    }
+
+    /* lines queued for the file must be written before getting its size */
+    logger_flush ();
+    logger_writer_sync ();
+
+    new_job->buffer = buffer;
+    new_job->lines = lines;
+    new_job->size = (stat (filename, &st) == 0) ? st.st_size : 0;
+    new_job->status = LOGGER_BACKLOG_JOB_QUEUED;
+    new_job->last_lines = NULL;
+    new_job->next_job = NULL;
+
+    pthread_mutex_lock (&logger_backlog_mutex);
+
+    if (logger_backlog_last_job)
+        logger_backlog_last_job->next_job = new_job;
+    else
+        logger_backlog_jobs = new_job;
+    logger_backlog_last_job = new_job;
+
+    pthread_cond_signal (&logger_backlog_cond_queued);
+
+    pthread_mutex_unlock (&logger_backlog_mutex);
+
+    return 1;
+}
+
+/*
+ * Cancels display of backlog for a buffer (called when the buffer is closed):
+ * files are still read by threads if they are being read, but the lines are
+ * not displayed.
+ */
+
+void
+logger_backlog_reader_cancel (struct t_gui_buffer *buffer)
+{
+    struct t_logger_backlog_job *ptr_job;
+
+    if (!buffer || !logger_backlog_threads_started)
+        return;
+
+    pthread_mutex_lock (&logger_backlog_mutex);
+
+    for (ptr_job = logger_backlog_jobs; ptr_job;
+         ptr_job = ptr_job->next_job)
+    {
+        if (ptr_job->buffer == buffer)
+            ptr_job->buffer = NULL;
+    }
+
+    pthread_mutex_unlock (&logger_backlog_mutex);
+}
+
+/*
+ * Stops the reader threads (files being read are read until the end) and
+ * frees all jobs.
+ */
+
+void
+logger_backlog_reader_end ()
+{
+    struct t_logger_backlog_job *ptr_next_job;
+    int i;
+
+    if (!logger_backlog_threads_started)
+        return;
+
+    pthread_mutex_lock (&logger_backlog_mutex);
+    logger_backlog_quit = 1;
+    pthread_cond_broadcast (&logger_backlog_cond_queued);
+    pthread_mutex_unlock (&logger_backlog_mutex);
+
+    for (i = 0; i < logger_backlog_threads_count; i++)
+    {
+        pthread_join (logger_backlog_threads[i], NULL);
+    }
+    logger_backlog_threads_count = 0;
+    logger_backlog_threads_started = 0;
+
+    /* jobs not read or not displayed are discarded */
+    while (logger_backlog_jobs)
+    {
+        ptr_next_job = logger_backlog_jobs->next_job;
+        logger_backlog_job_free (logger_backlog_jobs);
+        logger_backlog_jobs = ptr_next_job;
+    }
+    logger_backlog_last_job = NULL;
+    logger_backlog_event_pending = 0;
+}
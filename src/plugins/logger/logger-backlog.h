@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_BACKLOG_H
+#define WEECHAT_LOGGER_BACKLOG_H 1
+
+#include <sys/types.h>
+
+/* number of threads reading backlog */
+#define LOGGER_BACKLOG_THREADS 4
+
+enum t_logger_backlog_job_status
+{
+    LOGGER_BACKLOG_JOB_QUEUED = 0,     /* waiting for a thread              */
+    LOGGER_BACKLOG_JOB_READING,        /* file is read by a thread          */
+    LOGGER_BACKLOG_JOB_DONE,           /* lines read, display pending       */
+};
+
+/* backlog to read for a buffer */
+
+struct t_logger_backlog_job
+{
+    struct t_gui_buffer *buffer;          /* buffer (NULL if closed)        */
+    char *filename;                       /* log filename                   */
+    int lines;                            /* max number of lines to read    */
+    off_t size;                           /* size of log file when queued   */
+    enum t_logger_backlog_job_status status; /* status of job               */
+    struct t_logger_line *last_lines;     /* lines read (if done)           */
+    struct t_logger_backlog_job *next_job; /* link to next job              */
+};
+
+extern int logger_backlog_reader_queue (struct t_gui_buffer *buffer,
+                                        const char *filename, int lines);
+extern void logger_backlog_reader_cancel (struct t_gui_buffer *buffer);
+extern void logger_backlog_reader_end ();
+
+#endif /* WEECHAT_LOGGER_BACKLOG_H */
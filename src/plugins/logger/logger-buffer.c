@@ -30,10 +30,13 @@
 #include "../weechat-plugin.h"
 #include "logger.h"
 #include "logger-buffer.h"
+#include "logger-index.h"
+#include "logger-writer.h"
 
 
 struct t_logger_buffer *logger_buffers = NULL;
 struct t_logger_buffer *last_logger_buffer = NULL;
+struct t_hashtable *logger_buffers_by_buffer = NULL; /* index by buffer   */
 
 
 /*
@@ -85,16 +88,34 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
                                   weechat_buffer_get_string (buffer, "name"));
     }
 
+    if (!logger_buffers_by_buffer)
+    {
+        logger_buffers_by_buffer = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!logger_buffers_by_buffer)
+            return NULL;
+    }
+
     new_logger_buffer = malloc (sizeof (*new_logger_buffer));
     if (new_logger_buffer)
     {
         new_logger_buffer->buffer = buffer;
         new_logger_buffer->log_filename = NULL;
+        new_logger_buffer->log_mask = NULL;
         new_logger_buffer->log_file = NULL;
         new_logger_buffer->log_enabled = 1;
         new_logger_buffer->log_level = log_level;
         new_logger_buffer->write_start_info_line = 1;
         new_logger_buffer->flush_needed = 0;
+        new_logger_buffer->log_size = 0;
+        new_logger_buffer->compressing = 0;
+        new_logger_buffer->index_file = NULL;
+        new_logger_buffer->index_lines = 0;
+        new_logger_buffer->index_last_line = -1;
+        new_logger_buffer->index_last_date = 0;
 
         new_logger_buffer->prev_buffer = last_logger_buffer;
         new_logger_buffer->next_buffer = NULL;
@@ -103,6 +124,9 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
         else
             logger_buffers = new_logger_buffer;
         last_logger_buffer = new_logger_buffer;
+
+        weechat_hashtable_set (logger_buffers_by_buffer,
+                               buffer, new_logger_buffer);
     }
 
     return new_logger_buffer;
@@ -117,17 +141,10 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
 struct t_logger_buffer *
 logger_buffer_search_buffer (struct t_gui_buffer *buffer)
 {
-    struct t_logger_buffer *ptr_logger_buffer;
-
-    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
-         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
-    {
-        if (ptr_logger_buffer->buffer == buffer)
-            return ptr_logger_buffer;
-    }
+    if (!buffer || !logger_buffers_by_buffer)
+        return NULL;
 
-    /* logger buffer not found */
-    return NULL;
+    return weechat_hashtable_get (logger_buffers_by_buffer, buffer);
 }
 
 /*
@@ -184,16 +201,27 @@ logger_buffer_free (struct t_logger_buffer *logger_buffer)
     if (logger_buffer->next_buffer)
         (logger_buffer->next_buffer)->prev_buffer = logger_buffer->prev_buffer;
 
+    weechat_hashtable_remove (logger_buffers_by_buffer, ptr_buffer);
+
     /* free data */
     if (logger_buffer->log_filename)
         free (logger_buffer->log_filename);
+    if (logger_buffer->log_mask)
+        free (logger_buffer->log_mask);
     if (logger_buffer->log_file)
-        fclose (logger_buffer->log_file);
+        logger_writer_close (logger_buffer->log_file);
+    logger_index_close (logger_buffer);
 
     free (logger_buffer);
 
     logger_buffers = new_logger_buffers;
 
+    if (!logger_buffers)
+    {
+        weechat_hashtable_free (logger_buffers_by_buffer);
+        logger_buffers_by_buffer = NULL;
+    }
+
     if (weechat_logger_plugin->debug)
     {
         weechat_printf_date_tags (
@@ -204,6 +232,27 @@ logger_buffer_free (struct t_logger_buffer *logger_buffer)
     }
 }
 
+/*
+ * Resets filename mask of all logger buffers (called when a mask option is
+ * changed): the mask is searched again when it is needed.
+ */
+
+void
+logger_buffer_reset_mask_all ()
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
+         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
+    {
+        if (ptr_logger_buffer->log_mask)
+        {
+            free (ptr_logger_buffer->log_mask);
+            ptr_logger_buffer->log_mask = NULL;
+        }
+    }
+}
+
 /*
  * Adds a logger buffer in an infolist.
  *
@@ -239,6 +288,10 @@ logger_buffer_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "flush_needed", logger_buffer->flush_needed))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "compressing", logger_buffer->compressing))
+        return 0;
+    if (!weechat_infolist_new_var_pointer (ptr_item, "index_file", logger_buffer->index_file))
+        return 0;
 
     return 1;
 }
@@ -21,23 +21,35 @@
 #define WEECHAT_LOGGER_BUFFER_H 1
 
 struct t_infolist;
+struct t_logger_writer_file;
 
 struct t_logger_buffer
 {
     struct t_gui_buffer *buffer;          /* pointer to buffer              */
     char *log_filename;                   /* log filename                   */
-    FILE *log_file;                       /* log file                       */
+    char *log_mask;                       /* filename mask (NULL if not     */
+                                          /* searched yet)                  */
+    struct t_logger_writer_file *log_file; /* log file                      */
     int log_enabled;                      /* log enabled ?                  */
     int log_level;                        /* log level (0..9)               */
     int write_start_info_line;            /* 1 if start info line must be   */
                                           /* written in file                */
     int flush_needed;                     /* flush needed?                  */
+    unsigned long long log_size;          /* size of log file (with lines   */
+                                          /* queued for writing)            */
+    int compressing;                      /* 1 if rotated log file is being */
+                                          /* compressed                     */
+    struct t_logger_writer_file *index_file; /* index of log file           */
+    long long index_lines;                /* number of lines in log file    */
+    long long index_last_line;            /* line of last entry in index    */
+    time_t index_last_date;               /* date of last entry in index    */
     struct t_logger_buffer *prev_buffer;  /* link to previous buffer        */
     struct t_logger_buffer *next_buffer;  /* link to next buffer            */
 };
 
 extern struct t_logger_buffer *logger_buffers;
 extern struct t_logger_buffer *last_logger_buffer;
+extern struct t_hashtable *logger_buffers_by_buffer;
 
 extern int logger_buffer_valid (struct t_logger_buffer *logger_buffer);
 extern struct t_logger_buffer *logger_buffer_add (struct t_gui_buffer *,
@@ -45,6 +57,7 @@ extern struct t_logger_buffer *logger_buffer_add (struct t_gui_buffer *,
 extern struct t_logger_buffer *logger_buffer_search_buffer (struct t_gui_buffer *buffer);
 extern struct t_logger_buffer *logger_buffer_search_log_filename (const char *log_filename);
 extern void logger_buffer_free (struct t_logger_buffer *logger_buffer);
+extern void logger_buffer_reset_mask_all ();
 extern int logger_buffer_add_to_infolist (struct t_infolist *infolist,
                                           struct t_logger_buffer *logger_buffer);
 
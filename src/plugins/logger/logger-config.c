@@ -20,11 +20,16 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include <limits.h>
 
 #include "../weechat-plugin.h"
 #include "logger.h"
 #include "logger-config.h"
+#include "logger-buffer.h"
+#include "logger-index.h"
+#include "logger-writer.h"
 
 
 struct t_config_file *logger_config_file = NULL;
@@ -46,15 +51,23 @@ struct t_config_option *logger_config_color_backlog_line;
 
 struct t_config_option *logger_config_file_auto_log;
 struct t_config_option *logger_config_file_flush_delay;
+struct t_config_option *logger_config_file_fsync;
+struct t_config_option *logger_config_file_index_lines;
 struct t_config_option *logger_config_file_info_lines;
 struct t_config_option *logger_config_file_mask;
+struct t_config_option *logger_config_file_max_open_files;
 struct t_config_option *logger_config_file_name_lower_case;
 struct t_config_option *logger_config_file_nick_prefix;
 struct t_config_option *logger_config_file_nick_suffix;
 struct t_config_option *logger_config_file_path;
 struct t_config_option *logger_config_file_replacement_char;
+struct t_config_option *logger_config_file_rotation_compression_level;
+struct t_config_option *logger_config_file_rotation_compression_type;
+struct t_config_option *logger_config_file_rotation_size;
 struct t_config_option *logger_config_file_time_format;
 
+unsigned long long logger_config_rotation_size = 0;
+
 
 /*
  * Callback for changes on option that require a restart of logging for all
@@ -70,10 +83,60 @@ logger_config_change_file_option_restart_log (const void *pointer, void *data,
     (void) data;
     (void) option;
 
+    logger_buffer_reset_mask_all ();
+
     if (!logger_config_loading)
         logger_adjust_log_filenames ();
 }
 
+/*
+ * Callback for changes on option "logger.file.index_lines".
+ */
+
+void
+logger_config_index_lines_change (const void *pointer, void *data,
+                                  struct t_config_option *option)
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    if (logger_config_loading)
+        return;
+
+    /* log files must be up-to-date before they are indexed */
+    logger_flush ();
+    logger_writer_sync ();
+
+    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
+         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
+    {
+        logger_index_close (ptr_logger_buffer);
+        if (ptr_logger_buffer->log_file)
+            logger_index_open (ptr_logger_buffer);
+    }
+}
+
+/*
+ * Callback for changes on option "logger.file.max_open_files".
+ */
+
+void
+logger_config_max_open_files_change (const void *pointer, void *data,
+                                     struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    logger_writer_set_max_open (
+        weechat_config_integer (logger_config_file_max_open_files));
+}
+
 /*
  * Callback for changes on option "logger.file.flush_delay".
  */
@@ -118,6 +181,122 @@ logger_config_flush_delay_change (const void *pointer, void *data,
     }
 }
 
+/*
+ * Callback for changes on option "logger.file.fsync".
+ */
+
+void
+logger_config_fsync_change (const void *pointer, void *data,
+                            struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    logger_writer_set_fsync (weechat_config_boolean (logger_config_file_fsync));
+}
+
+/*
+ * Parses a size with an optional unit: "b" = bytes (default), "k" =
+ * kilobytes, "m" = megabytes, "g" = gigabytes, "t" = terabytes
+ * (example: "500m").
+ *
+ * Returns:
+ *   1: size OK (stored in *size)
+ *   0: invalid size
+ */
+
+int
+logger_config_parse_size (const char *value, unsigned long long *size)
+{
+    unsigned long long number, factor;
+    char *error;
+
+    if (!value || !value[0] || !isdigit ((unsigned char)value[0]))
+        return 0;
+
+    error = NULL;
+    number = strtoull (value, &error, 10);
+    if (!error)
+        return 0;
+
+    factor = 1ULL;
+    if (error[0])
+    {
+        switch (tolower ((unsigned char)error[0]))
+        {
+            case 'b':
+                factor = 1ULL;
+                break;
+            case 'k':
+                factor = 1000ULL;
+                break;
+            case 'm':
+                factor = 1000ULL * 1000ULL;
+                break;
+            case 'g':
+                factor = 1000ULL * 1000ULL * 1000ULL;
+                break;
+            case 't':
+                factor = 1000ULL * 1000ULL * 1000ULL * 1000ULL;
+                break;
+            default:
+                return 0;
+        }
+        if (error[1])
+            return 0;
+    }
+
+    *size = number * factor;
+
+    return 1;
+}
+
+/*
+ * Checks value of option "logger.file.rotation_size".
+ *
+ * Returns:
+ *   1: value is valid
+ *   0: value is not valid
+ */
+
+int
+logger_config_rotation_size_check (const void *pointer, void *data,
+                                   struct t_config_option *option,
+                                   const char *value)
+{
+    unsigned long long size;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    return logger_config_parse_size (value, &size);
+}
+
+/*
+ * Callback for changes on option "logger.file.rotation_size".
+ */
+
+void
+logger_config_rotation_size_change (const void *pointer, void *data,
+                                    struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    if (!logger_config_parse_size (
+            weechat_config_string (logger_config_file_rotation_size),
+            &logger_config_rotation_size))
+    {
+        logger_config_rotation_size = 0;
+    }
+}
+
 /*
  * Callback for changes on a level option.
  */
@@ -258,6 +437,8 @@ logger_config_mask_change (const void *pointer, void *data,
     (void) data;
     (void) option;
 
+    logger_buffer_reset_mask_all ();
+
     if (!logger_config_loading)
         logger_adjust_log_filenames ();
 }
@@ -280,6 +461,7 @@ logger_config_mask_delete_option (const void *pointer, void *data,
 
     weechat_config_option_free (option);
 
+    logger_buffer_reset_mask_all ();
     logger_adjust_log_filenames ();
 
     return WEECHAT_CONFIG_OPTION_UNSET_OK_REMOVED;
@@ -340,6 +522,8 @@ logger_config_mask_create_option (const void *pointer, void *data,
         }
     }
 
+    logger_buffer_reset_mask_all ();
+
     if (!logger_config_loading)
         logger_adjust_log_filenames ();
 
@@ -455,6 +639,27 @@ logger_config_init ()
         NULL, NULL, NULL,
         &logger_config_flush_delay_change, NULL, NULL,
         NULL, NULL, NULL);
+    logger_config_file_fsync = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "fsync", "boolean",
+        N_("use fsync to synchronize the log file with the storage device "
+           "after each write by the writer thread (see man fsync); this is "
+           "slower but should prevent any data loss in case of power failure"),
+        NULL, 0, 0, "off", NULL, 0,
+        NULL, NULL, NULL,
+        &logger_config_fsync_change, NULL, NULL,
+        NULL, NULL, NULL);
+    logger_config_file_index_lines = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "index_lines", "integer",
+        N_("write an index of each log file (in a file with extension "
+           ".idx), with an entry every N lines and at least every 10 "
+           "minutes; the index is used to quickly find lines by date or "
+           "count lines in log file (0 = no index)"),
+        NULL, 0, 1000000, "0", NULL, 0,
+        NULL, NULL, NULL,
+        &logger_config_index_lines_change, NULL, NULL,
+        NULL, NULL, NULL);
     logger_config_file_info_lines = weechat_config_new_option (
         logger_config_file, ptr_section,
         "info_lines", "boolean",
@@ -476,6 +681,18 @@ logger_config_init ()
         NULL, NULL, NULL,
         &logger_config_change_file_option_restart_log, NULL, NULL,
         NULL, NULL, NULL);
+    logger_config_file_max_open_files = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "max_open_files", "integer",
+        N_("maximum number of files kept open by logger (log files and "
+           "their index): when this limit is reached, the least recently "
+           "used file is closed, and it is opened again on next write "
+           "(0 = no limit); this is useful if there are many buffers, to "
+           "keep file descriptors for sockets"),
+        NULL, 0, 1000000, "0", NULL, 0,
+        NULL, NULL, NULL,
+        &logger_config_max_open_files_change, NULL, NULL,
+        NULL, NULL, NULL);
     logger_config_file_name_lower_case = weechat_config_new_option (
         logger_config_file, ptr_section,
         "name_lower_case", "boolean",
@@ -516,6 +733,44 @@ logger_config_init ()
         NULL, NULL, NULL,
         &logger_config_change_file_option_restart_log, NULL, NULL,
         NULL, NULL, NULL);
+    logger_config_file_rotation_compression_level = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "rotation_compression_level", "integer",
+        N_("compression level for rotated log files (with extension \".1\", "
+           "\".2\", etc.), if option logger.file.rotation_compression_type "
+           "is enabled: 1 = low compression / fast ... 100 = best compression "
+           "/ slow; the value is a percentage converted to 1-9 for gzip and "
+           "1-19 for zstd; the default value is recommended, it offers a "
+           "good compromise between compression and speed"),
+        NULL, 1, 100, "20", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    logger_config_file_rotation_compression_type = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "rotation_compression_type", "integer",
+        N_("compression type for rotated log files; if set to \"none\", "
+           "rotated log files are not compressed; the compression is done "
+           "in a separate process, and the backlog can be read from "
+           "compressed files; zstd is used only if WeeChat is compiled with "
+           "zstd support (gzip is used otherwise)"),
+        "none|gzip|zstd", 0, 0, "none", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    logger_config_file_rotation_size = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "rotation_size", "string",
+        N_("when this size is reached, a rotation of log files is performed: "
+           "the existing rotated log files are renamed (.1 becomes .2, .2 "
+           "becomes .3, etc.) and the current file is renamed with extension "
+           ".1; an integer number with a suffix is allowed: b = bytes "
+           "(default if no unit given), k = kilobytes, m = megabytes, "
+           "g = gigabytes, t = terabytes; example: \"2g\" causes a rotation "
+           "if the file size is > 2,000,000,000 bytes; if set to \"0\", no "
+           "rotation is performed (unlimited log size); WARNING: before "
+           "changing this option, you should first set the compression type "
+           "via option logger.file.rotation_compression_type"),
+        NULL, 0, 0, "0", NULL, 0,
+        &logger_config_rotation_size_check, NULL, NULL,
+        &logger_config_rotation_size_change, NULL, NULL,
+        NULL, NULL, NULL);
     logger_config_file_time_format = weechat_config_new_option (
         logger_config_file, ptr_section,
         "time_format", "string",
@@ -575,6 +830,7 @@ logger_config_read ()
     logger_config_loading = 0;
 
     logger_config_flush_delay_change (NULL, NULL, NULL);
+    logger_config_rotation_size_change (NULL, NULL, NULL);
 
     return rc;
 }
@@ -30,15 +30,25 @@ extern struct t_config_option *logger_config_color_backlog_line;
 
 extern struct t_config_option *logger_config_file_auto_log;
 extern struct t_config_option *logger_config_file_flush_delay;
+extern struct t_config_option *logger_config_file_fsync;
+extern struct t_config_option *logger_config_file_index_lines;
 extern struct t_config_option *logger_config_file_info_lines;
 extern struct t_config_option *logger_config_file_mask;
+extern struct t_config_option *logger_config_file_max_open_files;
 extern struct t_config_option *logger_config_file_name_lower_case;
 extern struct t_config_option *logger_config_file_nick_prefix;
 extern struct t_config_option *logger_config_file_nick_suffix;
 extern struct t_config_option *logger_config_file_path;
 extern struct t_config_option *logger_config_file_replacement_char;
+extern struct t_config_option *logger_config_file_rotation_compression_level;
+extern struct t_config_option *logger_config_file_rotation_compression_type;
+extern struct t_config_option *logger_config_file_rotation_size;
 extern struct t_config_option *logger_config_file_time_format;
 
+extern unsigned long long logger_config_rotation_size;
+
+extern int logger_config_parse_size (const char *value,
+                                     unsigned long long *size);
 extern struct t_config_option *logger_config_get_level (const char *name);
 extern int logger_config_set_level (const char *name, const char *value);
 extern struct t_config_option *logger_config_get_mask (const char *name);
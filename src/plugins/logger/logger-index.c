@@ -0,0 +1,641 @@
+/*
+ * logger-index.c - index of log files (offset of lines by date)
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When option logger.file.index_lines is set, an index is written for each
+ * log file, in a file with same name and extension ".idx".
+ *
+ * The index file starts with a magic string, followed by entries of fixed
+ * size (date, offset of line in log file, line number): an entry is added
+ * every N lines (and at least every 10 minutes), so that a line can be found
+ * by date or line number with a binary search in index, without reading the
+ * whole log file.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "../weechat-plugin.h"
+#include "logger.h"
+#include "logger-index.h"
+#include "logger-buffer.h"
+#include "logger-config.h"
+#include "logger-tail.h"
+#include "logger-writer.h"
+
+
+/* size of buffer used to read log files */
+#define LOGGER_INDEX_READ_SIZE (64 * 1024)
+
+
+/*
+ * Builds index filename for a log file.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_index_get_filename (const char *filename)
+{
+    char *index_filename;
+    int length;
+
+    if (!filename)
+        return NULL;
+
+    length = strlen (filename) + strlen (LOGGER_INDEX_EXTENSION) + 1;
+    index_filename = malloc (length);
+    if (!index_filename)
+        return NULL;
+
+    snprintf (index_filename, length, "%s%s", filename, LOGGER_INDEX_EXTENSION);
+
+    return index_filename;
+}
+
+/*
+ * Counts end of lines in a file, between two offsets.
+ *
+ * Returns number of end of lines, -1 if error.
+ */
+
+long long
+logger_index_count_eol (int fd, off_t offset, off_t offset_end)
+{
+    char *buffer, *ptr_buffer, *pos_eol;
+    ssize_t bytes_read;
+    size_t to_read;
+    long long count;
+
+    buffer = malloc (LOGGER_INDEX_READ_SIZE);
+    if (!buffer)
+        return -1;
+
+    count = 0;
+    while (offset < offset_end)
+    {
+        to_read = (offset_end - offset > LOGGER_INDEX_READ_SIZE) ?
+            LOGGER_INDEX_READ_SIZE : (size_t)(offset_end - offset);
+        bytes_read = pread (fd, buffer, to_read, offset);
+        if (bytes_read <= 0)
+        {
+            if ((bytes_read < 0) && (errno == EINTR))
+                continue;
+            break;
+        }
+        ptr_buffer = buffer;
+        while ((pos_eol = memchr (ptr_buffer, '\n',
+                                  buffer + bytes_read - ptr_buffer)))
+        {
+            count++;
+            ptr_buffer = pos_eol + 1;
+        }
+        offset += bytes_read;
+    }
+
+    free (buffer);
+
+    return count;
+}
+
+/*
+ * Returns number of entries in an index file, -1 if the file is not a valid
+ * index.
+ */
+
+long long
+logger_index_get_count (int fd_index)
+{
+    struct stat st;
+    char magic[LOGGER_INDEX_MAGIC_SIZE];
+
+    if (fstat (fd_index, &st) != 0)
+        return -1;
+
+    if ((st.st_size < LOGGER_INDEX_MAGIC_SIZE)
+        || ((st.st_size - LOGGER_INDEX_MAGIC_SIZE)
+            % sizeof (struct t_logger_index_entry) != 0))
+    {
+        return -1;
+    }
+
+    if ((pread (fd_index, magic, sizeof (magic), 0) != sizeof (magic))
+        || (memcmp (magic, LOGGER_INDEX_MAGIC, LOGGER_INDEX_MAGIC_SIZE) != 0))
+    {
+        return -1;
+    }
+
+    return (st.st_size - LOGGER_INDEX_MAGIC_SIZE)
+        / sizeof (struct t_logger_index_entry);
+}
+
+/*
+ * Reads an entry in an index file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_index_read_entry (int fd_index, long long number,
+                         struct t_logger_index_entry *entry)
+{
+    off_t offset;
+
+    offset = LOGGER_INDEX_MAGIC_SIZE + (number * sizeof (*entry));
+
+    return (pread (fd_index, entry, sizeof (*entry), offset)
+            == sizeof (*entry)) ? 1 : 0;
+}
+
+/*
+ * Opens index of a log file and returns number of entries (-1 if the index
+ * does not exist, is invalid or does not match the log file).
+ *
+ * If there is at least one entry in index, the last entry is stored in
+ * "last_entry".
+ */
+
+long long
+logger_index_open_file (const char *filename, int *fd_index, off_t *log_size,
+                        struct t_logger_index_entry *last_entry)
+{
+    char *index_filename;
+    struct stat st;
+    long long count;
+
+    *fd_index = -1;
+
+    if (stat (filename, &st) != 0)
+        return -1;
+    *log_size = st.st_size;
+
+    index_filename = logger_index_get_filename (filename);
+    if (!index_filename)
+        return -1;
+    *fd_index = open (index_filename, O_RDONLY);
+    free (index_filename);
+    if (*fd_index < 0)
+        return -1;
+
+    count = logger_index_get_count (*fd_index);
+    if (count > 0)
+    {
+        if (!logger_index_read_entry (*fd_index, count - 1, last_entry)
+            || (last_entry->offset > *log_size))
+        {
+            count = -1;
+        }
+    }
+    if (count < 0)
+    {
+        close (*fd_index);
+        *fd_index = -1;
+    }
+
+    return count;
+}
+
+/*
+ * Opens index of the log file of a logger buffer (the log file must be
+ * opened): the number of lines in log file is computed with the last entry
+ * of index; if the index is missing or invalid, lines of log file are
+ * counted and a new index is created.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (or index disabled)
+ */
+
+int
+logger_index_open (struct t_logger_buffer *logger_buffer)
+{
+    char *index_filename;
+    struct t_logger_index_entry last_entry;
+    struct stat st;
+    long long count, lines;
+    off_t log_size;
+    int fd_index, fd_log, rc;
+
+    if (!logger_buffer || !logger_buffer->log_filename
+        || logger_buffer->index_file
+        || (weechat_config_integer (logger_config_file_index_lines) <= 0))
+    {
+        return 0;
+    }
+
+    index_filename = logger_index_get_filename (logger_buffer->log_filename);
+    if (!index_filename)
+        return 0;
+
+    fd_log = open (logger_buffer->log_filename, O_RDONLY);
+    if (fd_log < 0)
+    {
+        free (index_filename);
+        return 0;
+    }
+
+    count = logger_index_open_file (logger_buffer->log_filename, &fd_index,
+                                    &log_size, &last_entry);
+    if (fd_index >= 0)
+        close (fd_index);
+
+    if (count < 0)
+    {
+        /* index is missing or invalid: create a new index */
+        rc = 0;
+        if (fstat (fd_log, &st) == 0)
+        {
+            log_size = st.st_size;
+            fd_index = open (index_filename, O_WRONLY | O_CREAT | O_TRUNC,
+                             0666);
+            if (fd_index >= 0)
+            {
+                rc = (write (fd_index, LOGGER_INDEX_MAGIC,
+                             LOGGER_INDEX_MAGIC_SIZE) == LOGGER_INDEX_MAGIC_SIZE);
+                close (fd_index);
+                if (!rc)
+                    unlink (index_filename);
+            }
+        }
+        if (!rc)
+        {
+            close (fd_log);
+            free (index_filename);
+            return 0;
+        }
+    }
+
+    if (count > 0)
+    {
+        /* count lines added after the last entry of index */
+        lines = logger_index_count_eol (fd_log, last_entry.offset, log_size);
+        logger_buffer->index_lines = last_entry.line + ((lines > 0) ? lines : 0);
+        logger_buffer->index_last_line = last_entry.line;
+        logger_buffer->index_last_date = last_entry.date;
+    }
+    else
+    {
+        /* no entry in index: count lines in log file */
+        lines = logger_index_count_eol (fd_log, 0, log_size);
+        logger_buffer->index_lines = (lines > 0) ? lines : 0;
+        logger_buffer->index_last_line = -1;
+        logger_buffer->index_last_date = 0;
+    }
+
+    close (fd_log);
+
+    logger_buffer->index_file = logger_writer_open (index_filename);
+
+    free (index_filename);
+
+    return (logger_buffer->index_file) ? 1 : 0;
+}
+
+/*
+ * Adds a line in index of a logger buffer (must be called before the line
+ * is written in log file): an entry is written in index every N lines (or if
+ * the last entry is too old).
+ */
+
+void
+logger_index_add_line (struct t_logger_buffer *logger_buffer, int flush)
+{
+    struct t_logger_index_entry entry;
+    time_t date_now;
+
+    if (!logger_buffer->index_file)
+        return;
+
+    date_now = time (NULL);
+    if ((logger_buffer->index_last_line < 0)
+        || (logger_buffer->index_lines - logger_buffer->index_last_line
+            >= weechat_config_integer (logger_config_file_index_lines))
+        || (date_now - logger_buffer->index_last_date
+            >= LOGGER_INDEX_MAX_DELAY))
+    {
+        /* dates in index must be sorted, even if system clock goes back */
+        if (date_now < logger_buffer->index_last_date)
+            date_now = logger_buffer->index_last_date;
+        entry.date = date_now;
+        entry.offset = logger_buffer->log_size;
+        entry.line = logger_buffer->index_lines;
+        logger_writer_write_data (logger_buffer->index_file,
+                                  &entry, sizeof (entry), flush);
+        logger_buffer->index_last_line = entry.line;
+        logger_buffer->index_last_date = entry.date;
+    }
+
+    logger_buffer->index_lines++;
+}
+
+/*
+ * Closes index of a logger buffer.
+ */
+
+void
+logger_index_close (struct t_logger_buffer *logger_buffer)
+{
+    if (!logger_buffer || !logger_buffer->index_file)
+        return;
+
+    logger_writer_close (logger_buffer->index_file);
+    logger_buffer->index_file = NULL;
+    logger_buffer->index_lines = 0;
+    logger_buffer->index_last_line = -1;
+    logger_buffer->index_last_date = 0;
+}
+
+/*
+ * Removes index of a log file.
+ */
+
+void
+logger_index_remove (const char *filename)
+{
+    char *index_filename;
+
+    index_filename = logger_index_get_filename (filename);
+    if (index_filename)
+    {
+        unlink (index_filename);
+        free (index_filename);
+    }
+}
+
+/*
+ * Searches the last entry in index of a log file with a date (if "by_date"
+ * is 1) or a line number (if "by_date" is 0) lower or equal to "value"
+ * (binary search in index file).
+ *
+ * Returns:
+ *   1: entry found (stored in "entry")
+ *   0: entry not found or no valid index
+ */
+
+int
+logger_index_search (const char *filename, int by_date, int64_t value,
+                     struct t_logger_index_entry *entry)
+{
+    struct t_logger_index_entry last_entry, middle_entry;
+    long long count, low, high, middle;
+    off_t log_size;
+    int fd_index, found;
+
+    count = logger_index_open_file (filename, &fd_index, &log_size,
+                                    &last_entry);
+    if (count <= 0)
+    {
+        if (fd_index >= 0)
+            close (fd_index);
+        return 0;
+    }
+
+    found = 0;
+    low = 0;
+    high = count - 1;
+    while (low <= high)
+    {
+        middle = low + ((high - low) / 2);
+        if (!logger_index_read_entry (fd_index, middle, &middle_entry))
+            break;
+        if (((by_date) ? middle_entry.date : middle_entry.line) <= value)
+        {
+            memcpy (entry, &middle_entry, sizeof (*entry));
+            found = 1;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    close (fd_index);
+
+    return found;
+}
+
+/*
+ * Returns number of lines in a log file, using its index (only lines after
+ * the last entry of index are read).
+ *
+ * Returns -1 if there is no valid index for the log file.
+ */
+
+long long
+logger_index_count_lines (const char *filename)
+{
+    struct t_logger_index_entry last_entry;
+    long long count, lines;
+    off_t log_size;
+    int fd_index, fd_log;
+
+    count = logger_index_open_file (filename, &fd_index, &log_size,
+                                    &last_entry);
+    if (fd_index >= 0)
+        close (fd_index);
+    if (count < 0)
+        return -1;
+
+    fd_log = open (filename, O_RDONLY);
+    if (fd_log < 0)
+        return -1;
+
+    if (count > 0)
+    {
+        lines = logger_index_count_eol (fd_log, last_entry.offset, log_size);
+        if (lines >= 0)
+            lines += last_entry.line;
+    }
+    else
+    {
+        lines = logger_index_count_eol (fd_log, 0, log_size);
+    }
+
+    close (fd_log);
+
+    return lines;
+}
+
+/*
+ * Adds a line read in log file to a list of lines, if its date is in range.
+ *
+ * Lines without date are kept only after a line in range.
+ *
+ * Returns:
+ *    1: line added
+ *    0: line skipped (empty line or date before "date_min")
+ *   -1: end of range reached (date after "date_max") or error
+ */
+
+int
+logger_index_add_line_in_range (struct t_logger_line **lines,
+                                struct t_logger_line **last_line,
+                                const char *data, int length,
+                                time_t date_min, time_t date_max)
+{
+    struct t_logger_line *new_line;
+    time_t date;
+
+    if (length <= 0)
+        return 0;
+
+    new_line = logger_tail_line_new (data, length);
+    if (!new_line)
+        return -1;
+
+    date = logger_get_line_date (new_line->data);
+    if (((date == 0) && !*lines) || ((date != 0) && (date < date_min)))
+    {
+        free (new_line);
+        return 0;
+    }
+    if ((date != 0) && (date_max > 0) && (date > date_max))
+    {
+        free (new_line);
+        return -1;
+    }
+
+    if (*last_line)
+        (*last_line)->next_line = new_line;
+    else
+        *lines = new_line;
+    *last_line = new_line;
+
+    return 1;
+}
+
+/*
+ * Reads lines of a log file with a date between "date_min" and "date_max"
+ * (if "date_max" is 0, there is no max date), returning at most "max_lines"
+ * lines (0 = no limit).
+ *
+ * If the log file has an index, lines are read from the last entry of index
+ * before "date_min", otherwise the whole log file is read.
+ *
+ * Note: result must be freed after use with function logger_tail_free().
+ */
+
+struct t_logger_line *
+logger_index_read_lines (const char *filename, time_t date_min,
+                         time_t date_max, int max_lines)
+{
+    struct t_logger_index_entry entry;
+    struct t_logger_line *lines, *last_line;
+    char *buffer, *ptr_buffer, *pos_eol;
+    ssize_t bytes_read;
+    off_t offset;
+    int fd, size, length, count, end_of_range, rc;
+
+    if (!filename)
+        return NULL;
+
+    offset = (logger_index_search (filename, 1, date_min, &entry)) ?
+        entry.offset : 0;
+
+    fd = open (filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    buffer = malloc (LOGGER_INDEX_READ_SIZE);
+    if (!buffer)
+    {
+        close (fd);
+        return NULL;
+    }
+
+    lines = NULL;
+    last_line = NULL;
+    count = 0;
+    end_of_range = 0;
+    size = 0;
+    while (!end_of_range)
+    {
+        bytes_read = pread (fd, buffer + size, LOGGER_INDEX_READ_SIZE - size,
+                            offset);
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        offset += bytes_read;
+        size += bytes_read;
+        if (bytes_read == 0)
+        {
+            /* last line (without end of line) */
+            if ((size > 0) && ((max_lines <= 0) || (count < max_lines)))
+            {
+                logger_index_add_line_in_range (&lines, &last_line,
+                                                buffer, size,
+                                                date_min, date_max);
+            }
+            break;
+        }
+        ptr_buffer = buffer;
+        while ((pos_eol = memchr (ptr_buffer, '\n',
+                                  buffer + size - ptr_buffer)))
+        {
+            length = pos_eol - ptr_buffer;
+            if ((length > 0) && (ptr_buffer[length - 1] == '\r'))
+                length--;
+            rc = logger_index_add_line_in_range (&lines, &last_line,
+                                                 ptr_buffer, length,
+                                                 date_min, date_max);
+            if (rc > 0)
+                count++;
+            if ((rc < 0) || ((max_lines > 0) && (count >= max_lines)))
+            {
+                end_of_range = 1;
+                break;
+            }
+            ptr_buffer = pos_eol + 1;
+        }
+        /* keep incomplete line at beginning of buffer */
+        size = buffer + size - ptr_buffer;
+        if (size >= LOGGER_INDEX_READ_SIZE)
+        {
+            /* line too long: it is truncated */
+            logger_index_add_line_in_range (&lines, &last_line,
+                                            buffer, size,
+                                            date_min, date_max);
+            size = 0;
+        }
+        else if (size > 0)
+        {
+            memmove (buffer, ptr_buffer, size);
+        }
+    }
+
+    free (buffer);
+    close (fd);
+
+    return lines;
+}
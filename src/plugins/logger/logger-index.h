@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_INDEX_H
+#define WEECHAT_LOGGER_INDEX_H 1
+
+#include <stdint.h>
+#include <time.h>
+
+/* index of a log file: "file.idx" */
+#define LOGGER_INDEX_EXTENSION ".idx"
+#define LOGGER_INDEX_MAGIC "WLOGIDX1"
+#define LOGGER_INDEX_MAGIC_SIZE 8
+
+/* an entry is added in index at least every 10 minutes */
+#define LOGGER_INDEX_MAX_DELAY 600
+
+/* entry in index file (written in binary, native byte order) */
+
+struct t_logger_index_entry
+{
+    int64_t date;                      /* date of line (time of write)      */
+    int64_t offset;                    /* offset of line in log file        */
+    int64_t line;                      /* line number (first line is 0)     */
+};
+
+struct t_logger_buffer;
+struct t_logger_line;
+
+extern int logger_index_open (struct t_logger_buffer *logger_buffer);
+extern void logger_index_add_line (struct t_logger_buffer *logger_buffer,
+                                   int flush);
+extern void logger_index_close (struct t_logger_buffer *logger_buffer);
+extern void logger_index_remove (const char *filename);
+extern int logger_index_search (const char *filename, int by_date,
+                                int64_t value,
+                                struct t_logger_index_entry *entry);
+extern long long logger_index_count_lines (const char *filename);
+extern struct t_logger_line *logger_index_read_lines (const char *filename,
+                                                      time_t date_min,
+                                                      time_t date_max,
+                                                      int max_lines);
+
+#endif /* WEECHAT_LOGGER_INDEX_H */
@@ -21,10 +21,174 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "../weechat-plugin.h"
 #include "logger.h"
 #include "logger-buffer.h"
+#include "logger-index.h"
+#include "logger-tail.h"
+#include "logger-writer.h"
+
+
+/*
+ * Returns log filename of a buffer: the filename of the logger buffer if the
+ * buffer is logged, otherwise the filename built with mask.
+ *
+ * Lines queued for log files are written before return, so that the log file
+ * can be read.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_info_get_log_filename (struct t_gui_buffer *buffer)
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    if (!buffer)
+        return NULL;
+
+    logger_flush ();
+    logger_writer_sync ();
+
+    ptr_logger_buffer = logger_buffer_search_buffer (buffer);
+    if (ptr_logger_buffer && ptr_logger_buffer->log_filename)
+        return strdup (ptr_logger_buffer->log_filename);
+
+    return logger_get_filename (buffer);
+}
+
+/*
+ * Returns logger info "logger_log_lines_count".
+ */
+
+const char *
+logger_info_info_log_lines_count_cb (const void *pointer, void *data,
+                                     const char *info_name,
+                                     const char *arguments)
+{
+    static char str_count[32];
+    int rc;
+    long unsigned int value;
+    struct t_gui_buffer *buffer;
+    char *filename;
+    long long count;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) info_name;
+
+    if (!arguments)
+        return NULL;
+
+    buffer = NULL;
+    if (strncmp (arguments, "0x", 2) == 0)
+    {
+        rc = sscanf (arguments, "%lx", &value);
+        if ((rc != EOF) && (rc != 0))
+            buffer = (struct t_gui_buffer *)value;
+    }
+    else
+        buffer = weechat_buffer_search ("==", arguments);
+
+    filename = logger_info_get_log_filename (buffer);
+    if (!filename)
+        return NULL;
+
+    count = logger_index_count_lines (filename);
+    free (filename);
+
+    if (count < 0)
+        return NULL;
+
+    snprintf (str_count, sizeof (str_count), "%lld", count);
+
+    return str_count;
+}
+
+/*
+ * Returns logger infolist "logger_log_lines".
+ */
+
+struct t_infolist *
+logger_info_infolist_logger_log_lines_cb (const void *pointer, void *data,
+                                          const char *infolist_name,
+                                          void *obj_pointer,
+                                          const char *arguments)
+{
+    struct t_infolist *ptr_infolist;
+    struct t_infolist_item *ptr_item;
+    struct t_logger_line *lines, *ptr_line;
+    const char *charset;
+    char *filename, *pos_message, *message;
+    long long date_min, date_max;
+    int max_lines;
+    time_t date;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) infolist_name;
+
+    if (!obj_pointer)
+        return NULL;
+
+    date_min = 0;
+    date_max = 0;
+    max_lines = 0;
+    if (arguments && arguments[0])
+    {
+        if (sscanf (arguments, "%lld,%lld,%d",
+                    &date_min, &date_max, &max_lines) < 1)
+        {
+            return NULL;
+        }
+    }
+
+    filename = logger_info_get_log_filename (obj_pointer);
+    if (!filename)
+        return NULL;
+
+    ptr_infolist = weechat_infolist_new ();
+    if (!ptr_infolist)
+    {
+        free (filename);
+        return NULL;
+    }
+
+    charset = weechat_info_get ("charset_terminal", "");
+
+    lines = logger_index_read_lines (filename, date_min, date_max, max_lines);
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        ptr_item = weechat_infolist_new_item (ptr_infolist);
+        if (!ptr_item)
+            break;
+        date = logger_get_line_date (ptr_line->data);
+        pos_message = strchr (ptr_line->data, '\t');
+        pos_message = (pos_message && (date != 0)) ?
+            pos_message + 1 : ptr_line->data;
+        message = (charset) ?
+            weechat_iconv_to_internal (charset, pos_message) : NULL;
+        if (!weechat_infolist_new_var_time (ptr_item, "date", date)
+            || !weechat_infolist_new_var_string (ptr_item, "line",
+                                                 (message) ? message : pos_message))
+        {
+            if (message)
+                free (message);
+            break;
+        }
+        if (message)
+            free (message);
+    }
+
+    logger_tail_free (lines);
+    free (filename);
+
+    return ptr_infolist;
+}
 
 
 /*
@@ -83,15 +247,32 @@ logger_info_infolist_logger_buffer_cb (const void *pointer, void *data,
 }
 
 /*
- * Hooks infolist for logger plugin.
+ * Hooks info and infolist for logger plugin.
  */
 
 void
 logger_info_init ()
 {
+    /* info hooks */
+    weechat_hook_info (
+        "logger_log_lines_count",
+        N_("number of lines in log file of a buffer (only if log file has "
+           "an index, see option logger.file.index_lines)"),
+        N_("buffer pointer (\"0x12345678\") or buffer full name "
+           "(\"irc.freenode.#weechat\")"),
+        &logger_info_info_log_lines_count_cb, NULL, NULL);
+
+    /* infolist hooks */
     weechat_hook_infolist (
         "logger_buffer", N_("list of logger buffers"),
         N_("logger pointer (optional)"),
         NULL,
         &logger_info_infolist_logger_buffer_cb, NULL, NULL);
+    weechat_hook_infolist (
+        "logger_log_lines", N_("lines of log file of a buffer"),
+        N_("buffer pointer (required)"),
+        N_("\"date_min,date_max,max_lines\": min date and max date of lines "
+           "(timestamps, 0 = no limit) and max number of lines (0 = no "
+           "limit), all optional"),
+        &logger_info_infolist_logger_log_lines_cb, NULL, NULL);
 }
@@ -0,0 +1,497 @@
+/*
+ * logger-rotate.c - rotation and compression of log files
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When a log file reaches the size defined in option
+ * logger.file.rotation_size, rotated files are renamed ("file.1" becomes
+ * "file.2", etc.), then the log file is renamed to "file.1" and compressed
+ * (if enabled) in a child process, so that WeeChat is not blocked.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "../weechat-plugin.h"
+#include "logger.h"
+#include "logger-rotate.h"
+#include "logger-buffer.h"
+#include "logger-config.h"
+#include "logger-index.h"
+#include "logger-writer.h"
+
+
+/* extension of rotated log files, by compression type */
+char *logger_rotate_extension[LOGGER_ROTATE_NUM_COMPRESSION] =
+{ "", ".gz", ".zst" };
+
+
+/*
+ * Searches a rotated log file "filename.N", uncompressed or compressed
+ * (with extension ".gz" or ".zst").
+ *
+ * Returns path to the rotated file, NULL if not found.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_rotate_search_file (const char *filename, int number)
+{
+    char *path;
+    int length, i;
+    struct stat st;
+
+    if (!filename || (number < 1))
+        return NULL;
+
+    length = strlen (filename) + 32;
+    path = malloc (length);
+    if (!path)
+        return NULL;
+
+    for (i = 0; i < LOGGER_ROTATE_NUM_COMPRESSION; i++)
+    {
+        snprintf (path, length, "%s.%d%s",
+                  filename, number, logger_rotate_extension[i]);
+        if (stat (path, &st) == 0)
+            return path;
+    }
+
+    free (path);
+
+    return NULL;
+}
+
+/*
+ * Returns compression type to use for rotated log files (zstd is replaced
+ * by gzip if WeeChat is compiled without zstd).
+ */
+
+int
+logger_rotate_get_compression_type ()
+{
+    int compression_type;
+
+    compression_type = weechat_config_integer (
+        logger_config_file_rotation_compression_type);
+
+#ifndef HAVE_ZSTD
+    if (compression_type == LOGGER_ROTATE_COMPRESSION_ZSTD)
+        compression_type = LOGGER_ROTATE_COMPRESSION_GZIP;
+#endif /* HAVE_ZSTD */
+
+    return compression_type;
+}
+
+/*
+ * Compresses a file with gzip.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_rotate_compress_gzip (int fd_from, const char *filename_to,
+                             int compression_level)
+{
+    gzFile file_to;
+    char mode[16], *buffer;
+    ssize_t num_read;
+    int rc;
+
+    buffer = malloc (LOGGER_ROTATE_BUFFER_SIZE);
+    if (!buffer)
+        return 0;
+
+    snprintf (mode, sizeof (mode), "wb%d", compression_level);
+    file_to = gzopen (filename_to, mode);
+    if (!file_to)
+    {
+        free (buffer);
+        return 0;
+    }
+
+    rc = 1;
+    while (1)
+    {
+        num_read = read (fd_from, buffer, LOGGER_ROTATE_BUFFER_SIZE);
+        if (num_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            rc = 0;
+            break;
+        }
+        if (num_read == 0)
+            break;
+        if (gzwrite (file_to, buffer, (unsigned int)num_read) != num_read)
+        {
+            rc = 0;
+            break;
+        }
+    }
+
+    if (gzclose (file_to) != Z_OK)
+        rc = 0;
+
+    free (buffer);
+
+    return rc;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Compresses a file with zstd.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_rotate_compress_zstd (int fd_from, const char *filename_to,
+                             int compression_level)
+{
+    FILE *file_to;
+    ZSTD_CCtx *cctx;
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    char *buffer_in, *buffer_out;
+    size_t size_out, rc_zstd;
+    ssize_t num_read;
+    int rc, last_chunk;
+
+    rc = 0;
+    file_to = NULL;
+    cctx = NULL;
+
+    size_out = ZSTD_CStreamOutSize ();
+    buffer_in = malloc (LOGGER_ROTATE_BUFFER_SIZE);
+    buffer_out = malloc (size_out);
+    if (!buffer_in || !buffer_out)
+        goto end;
+
+    cctx = ZSTD_createCCtx ();
+    if (!cctx)
+        goto end;
+    ZSTD_CCtx_setParameter (cctx, ZSTD_c_compressionLevel, compression_level);
+
+    file_to = fopen (filename_to, "wb");
+    if (!file_to)
+        goto end;
+
+    while (1)
+    {
+        num_read = read (fd_from, buffer_in, LOGGER_ROTATE_BUFFER_SIZE);
+        if (num_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            goto end;
+        }
+        last_chunk = (num_read == 0);
+        input.src = buffer_in;
+        input.size = num_read;
+        input.pos = 0;
+        do
+        {
+            output.dst = buffer_out;
+            output.size = size_out;
+            output.pos = 0;
+            rc_zstd = ZSTD_compressStream2 (
+                cctx, &output, &input,
+                (last_chunk) ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError (rc_zstd))
+                goto end;
+            if (fwrite (buffer_out, 1, output.pos, file_to) != output.pos)
+                goto end;
+        } while ((last_chunk) ? (rc_zstd != 0) : (input.pos < input.size));
+        if (last_chunk)
+            break;
+    }
+
+    rc = 1;
+
+end:
+    if (file_to && (fclose (file_to) != 0))
+        rc = 0;
+    if (cctx)
+        ZSTD_freeCCtx (cctx);
+    if (buffer_in)
+        free (buffer_in);
+    if (buffer_out)
+        free (buffer_out);
+
+    return rc;
+}
+#endif /* HAVE_ZSTD */
+
+/*
+ * Compresses a file.
+ *
+ * The compression level is a percentage (1-100), converted to the level of
+ * the compression type (1-9 for gzip, 1-19 for zstd).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (file "filename_to" is removed)
+ */
+
+int
+logger_rotate_compress_file (const char *filename_from,
+                             const char *filename_to,
+                             int compression_type,
+                             int compression_level)
+{
+    int fd_from, rc, level;
+
+    if (!filename_from || !filename_to)
+        return 0;
+
+    fd_from = open (filename_from, O_RDONLY);
+    if (fd_from < 0)
+        return 0;
+
+    rc = 0;
+    switch (compression_type)
+    {
+        case LOGGER_ROTATE_COMPRESSION_GZIP:
+            level = (compression_level * 9) / 100;
+            rc = logger_rotate_compress_gzip (fd_from, filename_to,
+                                              (level < 1) ? 1 : level);
+            break;
+        case LOGGER_ROTATE_COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+            level = (compression_level * 19) / 100;
+            rc = logger_rotate_compress_zstd (fd_from, filename_to,
+                                              (level < 1) ? 1 : level);
+#endif /* HAVE_ZSTD */
+            break;
+    }
+
+    close (fd_from);
+
+    if (!rc)
+        unlink (filename_to);
+
+    return rc;
+}
+
+/*
+ * Callback of process compressing a rotated log file.
+ *
+ * The command is "func:" followed by the log filename: the child process
+ * compresses the file "filename.1".
+ */
+
+int
+logger_rotate_compress_cb (const void *pointer, void *data,
+                           const char *command, int return_code,
+                           const char *out, const char *err)
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+    const char *filename;
+    char *filename_from, *filename_to;
+    int length, compression_type, rc;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) out;
+    (void) err;
+
+    filename = command + 5;
+
+    if (return_code == WEECHAT_HOOK_PROCESS_CHILD)
+    {
+        /* child process: compress file, return code is the exit status */
+        length = strlen (filename) + 32;
+        filename_from = malloc (length);
+        filename_to = malloc (length);
+        rc = 0;
+        if (filename_from && filename_to)
+        {
+            compression_type = logger_rotate_get_compression_type ();
+            snprintf (filename_from, length, "%s.1", filename);
+            snprintf (filename_to, length, "%s.1%s",
+                      filename, logger_rotate_extension[compression_type]);
+            rc = logger_rotate_compress_file (
+                filename_from, filename_to, compression_type,
+                weechat_config_integer (
+                    logger_config_file_rotation_compression_level));
+            if (rc)
+                unlink (filename_from);
+        }
+        if (filename_from)
+            free (filename_from);
+        if (filename_to)
+            free (filename_to);
+        return (rc) ? 0 : 1;
+    }
+
+    if (return_code == WEECHAT_HOOK_PROCESS_RUNNING)
+        return WEECHAT_RC_OK;
+
+    ptr_logger_buffer = logger_buffer_search_log_filename (filename);
+    if (ptr_logger_buffer)
+        ptr_logger_buffer->compressing = 0;
+
+    if (return_code != 0)
+    {
+        weechat_printf_date_tags (
+            NULL, 0, "no_log",
+            _("%s%s: unable to compress rotated log file \"%s.1\""),
+            weechat_prefix ("error"), LOGGER_PLUGIN_NAME, filename);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Rotates log file of a logger buffer: rotated files are renamed ("file.1"
+ * becomes "file.2", etc.), then log file is renamed to "file.1" and
+ * compressed in a child process (if compression is enabled).
+ *
+ * The log file is closed and is opened again on next line written.
+ *
+ * Rotation is delayed if the previous rotated file is still being
+ * compressed.
+ */
+
+void
+logger_rotate_buffer (struct t_logger_buffer *logger_buffer)
+{
+    char *filename, *filename_from, *filename_to, *ptr_file, *command;
+    int length, last, i, j;
+
+    if (!logger_buffer || !logger_buffer->log_filename
+        || logger_buffer->compressing)
+    {
+        return;
+    }
+
+    filename = logger_buffer->log_filename;
+
+    if (weechat_logger_plugin->debug)
+    {
+        weechat_printf_date_tags (NULL, 0, "no_log",
+                                  "%s: rotating log file %s",
+                                  LOGGER_PLUGIN_NAME, filename);
+    }
+
+    /* lines queued must be written in the file before it is renamed */
+    logger_writer_close (logger_buffer->log_file);
+    logger_buffer->log_file = NULL;
+    logger_buffer->flush_needed = 0;
+    logger_buffer->log_size = 0;
+    logger_index_close (logger_buffer);
+    logger_writer_sync ();
+
+    /* rotated files are not indexed: index is created again with log file */
+    logger_index_remove (filename);
+
+    length = strlen (filename) + 32;
+    filename_from = malloc (length);
+    filename_to = malloc (length);
+    command = malloc (length);
+    if (!filename_from || !filename_to || !command)
+        goto end;
+
+    /* search last rotated file */
+    last = 0;
+    while (1)
+    {
+        ptr_file = logger_rotate_search_file (filename, last + 1);
+        if (!ptr_file)
+            break;
+        free (ptr_file);
+        last++;
+    }
+
+    /* rename rotated files: ".N" becomes ".N+1" */
+    for (i = last; i >= 1; i--)
+    {
+        for (j = 0; j < LOGGER_ROTATE_NUM_COMPRESSION; j++)
+        {
+            snprintf (filename_from, length, "%s.%d%s",
+                      filename, i, logger_rotate_extension[j]);
+            if (access (filename_from, F_OK) != 0)
+                continue;
+            snprintf (filename_to, length, "%s.%d%s",
+                      filename, i + 1, logger_rotate_extension[j]);
+            if (rename (filename_from, filename_to) != 0)
+            {
+                weechat_printf_date_tags (
+                    NULL, 0, "no_log",
+                    _("%s%s: unable to rename file \"%s\" to \"%s\": %s"),
+                    weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+                    filename_from, filename_to, strerror (errno));
+            }
+        }
+    }
+
+    /* rename log file to ".1" */
+    snprintf (filename_to, length, "%s.1", filename);
+    if (rename (filename, filename_to) != 0)
+    {
+        weechat_printf_date_tags (
+            NULL, 0, "no_log",
+            _("%s%s: unable to rename file \"%s\" to \"%s\": %s"),
+            weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+            filename, filename_to, strerror (errno));
+        goto end;
+    }
+
+    /* compress rotated file in a child process */
+    if (weechat_config_integer (logger_config_file_rotation_compression_type)
+        != LOGGER_ROTATE_COMPRESSION_NONE)
+    {
+        snprintf (command, length, "func:%s", filename);
+        if (weechat_hook_process (command, 0,
+                                  &logger_rotate_compress_cb, NULL, NULL))
+        {
+            logger_buffer->compressing = 1;
+        }
+    }
+
+end:
+    if (filename_from)
+        free (filename_from);
+    if (filename_to)
+        free (filename_to);
+    if (command)
+        free (command);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_ROTATE_H
+#define WEECHAT_LOGGER_ROTATE_H 1
+
+/* compression of rotated log files */
+
+enum t_logger_rotate_compression
+{
+    LOGGER_ROTATE_COMPRESSION_NONE = 0,
+    LOGGER_ROTATE_COMPRESSION_GZIP,
+    LOGGER_ROTATE_COMPRESSION_ZSTD,
+    /* number of compression types */
+    LOGGER_ROTATE_NUM_COMPRESSION,
+};
+
+/* size of buffer used to compress/decompress files */
+#define LOGGER_ROTATE_BUFFER_SIZE (64 * 1024)
+
+struct t_logger_buffer;
+
+extern char *logger_rotate_search_file (const char *filename, int number);
+extern int logger_rotate_compress_file (const char *filename_from,
+                                        const char *filename_to,
+                                        int compression_type,
+                                        int compression_level);
+extern void logger_rotate_buffer (struct t_logger_buffer *logger_buffer);
+
+#endif /* WEECHAT_LOGGER_ROTATE_H */
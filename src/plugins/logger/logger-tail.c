@@ -19,6 +19,12 @@
  * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+ * The end of the log file is read by windows growing from the end of file
+ * (big windows are mapped in memory), lines are searched backward directly
+ * in the window and only the last lines returned are copied.
+ */
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -27,186 +33,557 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <string.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "logger.h"
 #include "logger-tail.h"
+#include "logger-index.h"
+#include "logger-rotate.h"
+
 
+/* size of first window read at end of file (doubled if needed) */
+#define LOGGER_TAIL_WINDOW_SIZE (8 * 1024)
 
-#define LOGGER_TAIL_BUFSIZE 4096
+/* windows bigger than this size are mapped in memory instead of read */
+#define LOGGER_TAIL_MAP_MIN_SIZE (64 * 1024)
 
 
 /*
- * Searches for last EOL in a string.
+ * Searches for last EOL ('\n') in a string, before "string_end" (excluded).
+ *
+ * Returns pointer to EOL, NULL if not found.
  */
 
 const char *
-logger_tail_last_eol (const char *string_start, const char *string_ptr)
+logger_tail_last_eol (const char *string_start, const char *string_end)
 {
-    while (string_ptr >= string_start)
+#if defined(__GLIBC__) || defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    return memrchr (string_start, '\n', string_end - string_start);
+#else
+    while (string_end > string_start)
     {
-        if ((string_ptr[0] == '\n') || (string_ptr[0] == '\r'))
-            return string_ptr;
-        string_ptr--;
+        string_end--;
+        if (string_end[0] == '\n')
+            return string_end;
     }
 
     /* no end-of-line found in string */
     return NULL;
+#endif
+}
+
+/*
+ * Allocates a line with a copy of data (the line and its data are allocated
+ * in a single block).
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_logger_line *
+logger_tail_line_new (const char *data, int length)
+{
+    struct t_logger_line *new_line;
+
+    new_line = malloc (sizeof (*new_line) + length + 1);
+    if (!new_line)
+        return NULL;
+
+    new_line->data = (char *)(new_line + 1);
+    memcpy (new_line->data, data, length);
+    new_line->data[length] = '\0';
+    new_line->next_line = NULL;
+
+    return new_line;
+}
+
+/*
+ * Adds the line being read in the ring of last lines (the oldest line is
+ * removed if the ring is full).
+ *
+ * Empty lines are ignored.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+logger_tail_ring_add_line (struct t_logger_tail_ring *ring)
+{
+    char *new_line;
+
+    /* remove "\r" at end of line */
+    while ((ring->line_length > 0)
+           && (ring->line[ring->line_length - 1] == '\r'))
+    {
+        ring->line_length--;
+    }
+
+    if (ring->line_length == 0)
+        return 1;
+
+    new_line = malloc (ring->line_length + 1);
+    if (!new_line)
+        return 0;
+    memcpy (new_line, ring->line, ring->line_length);
+    new_line[ring->line_length] = '\0';
+
+    if (ring->lines[ring->index])
+        free (ring->lines[ring->index]);
+    ring->lines[ring->index] = new_line;
+    ring->index = (ring->index + 1) % ring->size;
+    if (ring->count < ring->size)
+        ring->count++;
+
+    ring->line_length = 0;
+
+    return 1;
+}
+
+/*
+ * Adds decompressed data in the ring of last lines.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+logger_tail_ring_add_data (struct t_logger_tail_ring *ring,
+                           const char *data, int size)
+{
+    const char *ptr_data, *pos_eol;
+    char *new_line;
+    int length, new_alloc;
+
+    ptr_data = data;
+    while (size > 0)
+    {
+        pos_eol = memchr (ptr_data, '\n', size);
+        length = (pos_eol) ? pos_eol - ptr_data : size;
+        if (ring->line_length + length > ring->line_alloc)
+        {
+            new_alloc = (ring->line_length + length) * 2;
+            new_line = realloc (ring->line, new_alloc);
+            if (!new_line)
+                return 0;
+            ring->line = new_line;
+            ring->line_alloc = new_alloc;
+        }
+        memcpy (ring->line + ring->line_length, ptr_data, length);
+        ring->line_length += length;
+        if (!pos_eol)
+            break;
+        if (!logger_tail_ring_add_line (ring))
+            return 0;
+        ptr_data = pos_eol + 1;
+        size -= length + 1;
+    }
+
+    return 1;
+}
+
+/*
+ * Reads a file compressed with gzip and adds its lines in the ring.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_tail_read_gzip (const char *filename, struct t_logger_tail_ring *ring)
+{
+    gzFile file;
+    char *buffer;
+    int bytes_read, rc;
+
+    buffer = malloc (LOGGER_ROTATE_BUFFER_SIZE);
+    if (!buffer)
+        return 0;
+
+    file = gzopen (filename, "rb");
+    if (!file)
+    {
+        free (buffer);
+        return 0;
+    }
+
+    rc = 1;
+    while (1)
+    {
+        bytes_read = gzread (file, buffer, LOGGER_ROTATE_BUFFER_SIZE);
+        if (bytes_read < 0)
+        {
+            rc = 0;
+            break;
+        }
+        if (bytes_read == 0)
+            break;
+        if (!logger_tail_ring_add_data (ring, buffer, bytes_read))
+        {
+            rc = 0;
+            break;
+        }
+    }
+
+    gzclose (file);
+    free (buffer);
+
+    return rc;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Reads a file compressed with zstd and adds its lines in the ring.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_tail_read_zstd (const char *filename, struct t_logger_tail_ring *ring)
+{
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    char *buffer_in, *buffer_out;
+    size_t size_out, rc_zstd;
+    ssize_t bytes_read;
+    int fd, rc;
+
+    rc = 0;
+    fd = -1;
+    dctx = NULL;
+
+    size_out = ZSTD_DStreamOutSize ();
+    buffer_in = malloc (LOGGER_ROTATE_BUFFER_SIZE);
+    buffer_out = malloc (size_out);
+    if (!buffer_in || !buffer_out)
+        goto end;
+
+    dctx = ZSTD_createDCtx ();
+    if (!dctx)
+        goto end;
+
+    fd = open (filename, O_RDONLY);
+    if (fd < 0)
+        goto end;
+
+    while (1)
+    {
+        bytes_read = read (fd, buffer_in, LOGGER_ROTATE_BUFFER_SIZE);
+        if (bytes_read < 0)
+            goto end;
+        if (bytes_read == 0)
+            break;
+        input.src = buffer_in;
+        input.size = bytes_read;
+        input.pos = 0;
+        while (input.pos < input.size)
+        {
+            output.dst = buffer_out;
+            output.size = size_out;
+            output.pos = 0;
+            rc_zstd = ZSTD_decompressStream (dctx, &output, &input);
+            if (ZSTD_isError (rc_zstd))
+                goto end;
+            if (!logger_tail_ring_add_data (ring, buffer_out, output.pos))
+                goto end;
+        }
+    }
+
+    rc = 1;
+
+end:
+    if (fd >= 0)
+        close (fd);
+    if (dctx)
+        ZSTD_freeDCtx (dctx);
+    if (buffer_in)
+        free (buffer_in);
+    if (buffer_out)
+        free (buffer_out);
+
+    return rc;
+}
+#endif /* HAVE_ZSTD */
+
+/*
+ * Returns last lines of a compressed file (rotated log file with extension
+ * ".gz" or ".zst").
+ *
+ * The whole file is decompressed, only the last "n_lines" lines are kept.
+ *
+ * Note: result must be freed after use with function logger_tail_free().
+ */
+
+struct t_logger_line *
+logger_tail_compressed_file (const char *filename, int n_lines,
+                             int compression_type)
+{
+    struct t_logger_tail_ring ring;
+    struct t_logger_line *ptr_line, *new_line;
+    int i, index, rc;
+
+    if (n_lines <= 0)
+        return NULL;
+
+    memset (&ring, 0, sizeof (ring));
+    ring.lines = calloc (n_lines, sizeof (*ring.lines));
+    if (!ring.lines)
+        return NULL;
+    ring.size = n_lines;
+
+    rc = 0;
+    switch (compression_type)
+    {
+        case LOGGER_ROTATE_COMPRESSION_GZIP:
+            rc = logger_tail_read_gzip (filename, &ring);
+            break;
+        case LOGGER_ROTATE_COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+            rc = logger_tail_read_zstd (filename, &ring);
+#endif /* HAVE_ZSTD */
+            break;
+    }
+
+    /* last line without end-of-line */
+    if (rc && (ring.line_length > 0))
+        rc = logger_tail_ring_add_line (&ring);
+
+    /* build list of lines, from newest to oldest */
+    ptr_line = NULL;
+    if (rc)
+    {
+        for (i = 0; i < ring.count; i++)
+        {
+            index = (ring.index - 1 - i + ring.size) % ring.size;
+            new_line = logger_tail_line_new (ring.lines[index],
+                                             strlen (ring.lines[index]));
+            if (!new_line)
+            {
+                logger_tail_free (ptr_line);
+                ptr_line = NULL;
+                break;
+            }
+            new_line->next_line = ptr_line;
+            ptr_line = new_line;
+        }
+    }
+
+    for (i = 0; i < ring.size; i++)
+    {
+        if (ring.lines[i])
+            free (ring.lines[i]);
+    }
+    free (ring.lines);
+    if (ring.line)
+        free (ring.line);
+
+    return ptr_line;
+}
+
+/*
+ * Searches last lines in a window of file (read or mapped in memory).
+ *
+ * Lines found are stored in "lines" (start of line and length), from the
+ * newest to the oldest. If the window does not start at beginning of file,
+ * the first line of window (which may be incomplete) is ignored.
+ *
+ * Empty lines are ignored, "\r" at end of line is removed.
+ *
+ * Returns number of lines found.
+ */
+
+int
+logger_tail_scan (const char *data, size_t size, int start_of_file,
+                  struct t_logger_tail_slice *lines, int n_lines)
+{
+    const char *ptr_end, *pos_eol, *line_start, *line_end;
+    int count;
+
+    count = 0;
+    ptr_end = data + size;
+    while ((count < n_lines) && (ptr_end > data))
+    {
+        pos_eol = logger_tail_last_eol (data, ptr_end);
+        if (!pos_eol && !start_of_file)
+            break;
+        line_start = (pos_eol) ? pos_eol + 1 : data;
+        line_end = ptr_end;
+        while ((line_end > line_start) && (line_end[-1] == '\r'))
+        {
+            line_end--;
+        }
+        if (line_end > line_start)
+        {
+            lines[count].data = line_start;
+            lines[count].length = line_end - line_start;
+            count++;
+        }
+        if (!pos_eol)
+            break;
+        ptr_end = pos_eol;
+    }
+
+    return count;
 }
 
 /*
  * Returns last lines of a file.
  *
+ * Files with extension ".gz" or ".zst" (compressed rotated log files) are
+ * decompressed.
+ *
+ * If max_size >= 0, only the first "max_size" bytes of file are read (lines
+ * added after are ignored); this is ignored for compressed files.
+ *
  * Note: result must be freed after use with function logger_tail_free().
  */
 
 struct t_logger_line *
-logger_tail_file (const char *filename, int n_lines)
+logger_tail_file (const char *filename, int n_lines, off_t max_size)
 {
-    int fd;
-    off_t file_length, file_pos;
-    size_t to_read;
-    ssize_t bytes_read;
-    char buf[LOGGER_TAIL_BUFSIZE + 1];
-    char *ptr_buf, *pos_eol, *part_of_line, *new_part_of_line;
+    int fd, length, count, i, mapped, done;
+    struct stat st;
+    off_t offset, window_size;
+    long page_size;
+    size_t size;
+    void *data;
+    struct t_logger_tail_slice *lines;
     struct t_logger_line *ptr_line, *new_line;
+    struct t_logger_index_entry entry;
+    long long total_lines;
+
+    if (n_lines <= 0)
+        return NULL;
+
+    /* compressed file */
+    length = strlen (filename);
+    if ((length > 3) && (strcmp (filename + length - 3, ".gz") == 0))
+    {
+        return logger_tail_compressed_file (filename, n_lines,
+                                            LOGGER_ROTATE_COMPRESSION_GZIP);
+    }
+    if ((length > 4) && (strcmp (filename + length - 4, ".zst") == 0))
+    {
+        return logger_tail_compressed_file (filename, n_lines,
+                                            LOGGER_ROTATE_COMPRESSION_ZSTD);
+    }
 
-    /* open file */
     fd = open (filename, O_RDONLY);
     if (fd == -1)
         return NULL;
 
-    /* seek to the end of file */
-    file_length = lseek (fd, (off_t)0, SEEK_END);
-    if (file_length <= 0)
+    if (fstat (fd, &st) != 0)
+    {
+        close (fd);
+        return NULL;
+    }
+    if ((max_size >= 0) && (st.st_size > max_size))
+        st.st_size = max_size;
+    if (st.st_size <= 0)
     {
         close (fd);
         return NULL;
     }
-    to_read = file_length;
-    file_pos = file_length - LOGGER_TAIL_BUFSIZE;
-    if (file_pos < 0)
-        file_pos = 0;
-    else
-        to_read = LOGGER_TAIL_BUFSIZE;
-    lseek (fd, file_pos, SEEK_SET);
 
-    /* loop until we have "n_lines" lines in list */
-    part_of_line = NULL;
+    /* a line has at least one char and one EOL */
+    if (n_lines > st.st_size / 2 + 1)
+        n_lines = st.st_size / 2 + 1;
+
+    lines = malloc (n_lines * sizeof (*lines));
+    if (!lines)
+    {
+        close (fd);
+        return NULL;
+    }
+
+    page_size = sysconf (_SC_PAGESIZE);
+    if (page_size <= 0)
+        page_size = 4096;
+
+    /*
+     * read a window at end of file, and double its size until enough lines
+     * are found (or beginning of file is reached); big windows are mapped
+     * in memory (only pages with the lines scanned are read)
+     */
     ptr_line = NULL;
-    while (n_lines > 0)
+    window_size = LOGGER_TAIL_WINDOW_SIZE;
+
+    /* if the log file has an index, use it to get size of first window */
+    total_lines = logger_index_count_lines (filename);
+    if ((total_lines > n_lines)
+        && logger_index_search (filename, 0, total_lines - n_lines, &entry)
+        && (entry.offset < st.st_size)
+        && (st.st_size - entry.offset > window_size))
+    {
+        window_size = st.st_size - entry.offset;
+    }
+    while (1)
     {
-        lseek (fd, file_pos, SEEK_SET);
-        bytes_read = read (fd, buf, to_read);
-        if (bytes_read <= 0)
+        offset = (st.st_size > window_size) ? st.st_size - window_size : 0;
+        offset -= offset % page_size;
+        size = st.st_size - offset;
+        mapped = (size >= LOGGER_TAIL_MAP_MIN_SIZE);
+        if (mapped)
         {
-            if (part_of_line)
-                free (part_of_line);
-            logger_tail_free (ptr_line);
-            close (fd);
-            return NULL;
+            data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, offset);
+            if (data == MAP_FAILED)
+                break;
         }
-        buf[bytes_read] = '\0';
-        ptr_buf = buf + bytes_read - 1;
-        while (ptr_buf && (ptr_buf >= buf))
+        else
         {
-            pos_eol = (char *)logger_tail_last_eol (buf, ptr_buf);
-            if ((pos_eol && (pos_eol[1] || part_of_line)) || (file_pos == 0))
+            data = malloc (size);
+            if (!data)
+                break;
+            if (pread (fd, data, size, offset) != (ssize_t)size)
             {
-                /* use data and part_of_line (if existing) to build a new line */
-                if (!pos_eol)
-                {
-                    ptr_buf = NULL;
-                    pos_eol = buf;
-                }
-                else
-                {
-                    ptr_buf = pos_eol - 1;
-                    pos_eol[0] = '\0';
-                    pos_eol++;
-                }
-                if (part_of_line || pos_eol[0])
-                {
-                    new_line = malloc (sizeof (*new_line));
-                    if (!new_line)
-                    {
-                        logger_tail_free (ptr_line);
-                        ptr_line = NULL;
-                        break;
-                    }
-                    if (part_of_line)
-                    {
-                        new_line->data = malloc ((strlen (pos_eol) +
-                                                  strlen (part_of_line) + 1));
-                        if (!new_line->data)
-                        {
-                            free (part_of_line);
-                            free (new_line);
-                            logger_tail_free (ptr_line);
-                            close (fd);
-                            return NULL;
-                        }
-                        strcpy (new_line->data, pos_eol);
-                        strcat (new_line->data, part_of_line);
-                        free (part_of_line);
-                        part_of_line = NULL;
-                    }
-                    else
-                    {
-                        new_line->data = strdup (pos_eol);
-                    }
-                    new_line->next_line = ptr_line;
-                    ptr_line = new_line;
-                    n_lines--;
-                    if (n_lines <= 0)
-                        break;
-                }
+                free (data);
+                break;
             }
-            else if (!pos_eol)
+        }
+        count = logger_tail_scan (data, size, (offset == 0), lines, n_lines);
+        if ((count >= n_lines) || (offset == 0))
+        {
+            /* copy lines found, from the newest to the oldest */
+            for (i = 0; i < count; i++)
             {
-                /*
-                 * beginning of read buffer reached without EOL, then we
-                 * add string to part_of_line, we'll use that later
-                 */
-                if (part_of_line)
+                new_line = logger_tail_line_new (lines[i].data,
+                                                 lines[i].length);
+                if (!new_line)
                 {
-                    new_part_of_line = malloc (strlen (buf) + strlen (part_of_line) + 1);
-                    if (!new_part_of_line)
-                    {
-                        free (part_of_line);
-                        logger_tail_free (ptr_line);
-                        close (fd);
-                        return NULL;
-                    }
-                    strcpy (new_part_of_line, buf);
-                    strcat (new_part_of_line, part_of_line);
-                    free (part_of_line);
-                    part_of_line = new_part_of_line;
+                    logger_tail_free (ptr_line);
+                    ptr_line = NULL;
+                    break;
                 }
-                else
-                {
-                    part_of_line = malloc (strlen (buf) + 1);
-                    strcpy (part_of_line, buf);
-                }
-                ptr_buf = NULL;
+                new_line->next_line = ptr_line;
+                ptr_line = new_line;
             }
-            else
-                ptr_buf = pos_eol - 1;
+            done = 1;
         }
-        if (file_pos == 0)
-            break;
-        to_read = file_pos;
-        file_pos -= LOGGER_TAIL_BUFSIZE;
-        if (file_pos < 0)
-            file_pos = 0;
         else
-            to_read = LOGGER_TAIL_BUFSIZE;
+        {
+            done = 0;
+        }
+        if (mapped)
+            munmap (data, size);
+        else
+            free (data);
+        if (done)
+            break;
+        window_size *= 2;
     }
 
-    if (part_of_line)
-        free (part_of_line);
-
+    free (lines);
     close (fd);
 
     return ptr_line;
@@ -229,8 +606,7 @@ logger_tail_free (struct t_logger_line *lines)
     {
         next_line = ptr_line->next_line;
 
-        if (ptr_line->data)
-            free (ptr_line->data);
+        /* data is allocated with the line */
         free (ptr_line);
 
         ptr_line = next_line;
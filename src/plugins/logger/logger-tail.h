@@ -20,14 +20,39 @@
 #ifndef WEECHAT_LOGGER_TAIL_H
 #define WEECHAT_LOGGER_TAIL_H 1
 
+#include <sys/types.h>
+
 struct t_logger_line
 {
     char *data;                        /* line content                      */
     struct t_logger_line *next_line;   /* link to next line                 */
 };
 
+/* line found in a window of log file */
+
+struct t_logger_tail_slice
+{
+    const char *data;                  /* start of line (not NUL-term.)     */
+    int length;                        /* length of line                    */
+};
+
+/* last lines read in a compressed log file */
+
+struct t_logger_tail_ring
+{
+    char **lines;                      /* last lines read (ring)            */
+    int size;                          /* max number of lines in ring       */
+    int count;                         /* number of lines in ring           */
+    int index;                         /* index of next line to add         */
+    char *line;                        /* line being read                   */
+    int line_length;                   /* length of line being read         */
+    int line_alloc;                    /* size allocated for line           */
+};
+
+extern struct t_logger_line *logger_tail_line_new (const char *data,
+                                                   int length);
 extern struct t_logger_line *logger_tail_file (const char *filename,
-                                               int n_lines);
+                                               int n_lines, off_t max_size);
 extern void logger_tail_free (struct t_logger_line *lines);
 
 #endif /* WEECHAT_LOGGER_TAIL_H */
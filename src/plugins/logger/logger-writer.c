@@ -0,0 +1,742 @@
+/*
+ * logger-writer.c - thread writing log files for logger plugin
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lines are formatted by the main thread (WeeChat), then queued in the log
+ * file; the writer thread writes queued lines of each file with writev(),
+ * so that a slow disk does not block WeeChat.
+ *
+ * Only the writer thread writes in files and closes them; the WeeChat API is
+ * never called by the writer thread.
+ *
+ * Files are kept in a list sorted by last use (most recently used first):
+ * when there are more files open than option logger.file.max_open_files,
+ * the file descriptor of least recently used files is closed (files are
+ * still valid and opened again in append mode on next write).
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+
+#include "../weechat-plugin.h"
+#include "logger.h"
+#include "logger-writer.h"
+
+
+pthread_t logger_writer_thread;         /* writer thread                     */
+int logger_writer_running = 0;          /* 1 if writer thread is running     */
+pthread_mutex_t logger_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t logger_writer_cond_ready = PTHREAD_COND_INITIALIZER;
+pthread_cond_t logger_writer_cond_done = PTHREAD_COND_INITIALIZER;
+
+/* variables below are protected by the mutex */
+struct t_logger_writer_file *logger_writer_ready_files = NULL;
+struct t_logger_writer_file *logger_writer_last_ready_file = NULL;
+int logger_writer_queue_records = 0;    /* number of records queued          */
+int logger_writer_queue_size = 0;       /* size of data queued               */
+int logger_writer_busy = 0;             /* 1 if writer is writing files      */
+int logger_writer_quit = 0;             /* 1 if writer thread must stop      */
+int logger_writer_fsync = 0;            /* 1 if fsync is done after write    */
+struct t_logger_writer_file *logger_writer_lru_files = NULL;
+struct t_logger_writer_file *logger_writer_last_lru_file = NULL;
+int logger_writer_lru_count = 0;        /* number of files open              */
+int logger_writer_max_open = 0;         /* max files open (0 = no limit)     */
+
+
+/*
+ * Writes a list of records in a file descriptor, using writev() to write
+ * many records with a single system call.
+ *
+ * Returns:
+ *   0: OK
+ *   > 0: error (errno)
+ */
+
+int
+logger_writer_write_records (int fd, struct t_logger_writer_record *records)
+{
+    struct iovec iov[LOGGER_WRITER_MAX_IOVEC];
+    struct t_logger_writer_record *ptr_record;
+    ssize_t num_written;
+    int count, offset;
+
+    offset = 0;
+
+    while (records)
+    {
+        count = 0;
+        for (ptr_record = records;
+             ptr_record && (count < LOGGER_WRITER_MAX_IOVEC);
+             ptr_record = ptr_record->next_record)
+        {
+            iov[count].iov_base = ptr_record->data + ((count == 0) ? offset : 0);
+            iov[count].iov_len = ptr_record->size - ((count == 0) ? offset : 0);
+            count++;
+        }
+
+        num_written = writev (fd, iov, count);
+        if (num_written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+
+        /* skip records written (the last one may be partially written) */
+        while (records && (num_written >= records->size - offset))
+        {
+            num_written -= records->size - offset;
+            offset = 0;
+            records = records->next_record;
+        }
+        if (records)
+            offset += num_written;
+    }
+
+    return 0;
+}
+
+/*
+ * Frees a list of records.
+ */
+
+void
+logger_writer_free_records (struct t_logger_writer_record *records)
+{
+    struct t_logger_writer_record *ptr_next_record;
+
+    while (records)
+    {
+        ptr_next_record = records->next_record;
+        free (records);
+        records = ptr_next_record;
+    }
+}
+
+/*
+ * Frees a file (file descriptor must be closed).
+ */
+
+void
+logger_writer_free_file (struct t_logger_writer_file *file)
+{
+    if (file->filename)
+        free (file->filename);
+    free (file);
+}
+
+/*
+ * Reopens the file descriptor of a file closed because it was idle.
+ *
+ * Returns:
+ *   0: OK
+ *   > 0: error (errno)
+ */
+
+int
+logger_writer_reopen (struct t_logger_writer_file *file)
+{
+    if (file->fd >= 0)
+        return 0;
+
+    file->fd = open (file->filename, O_WRONLY | O_APPEND | O_CREAT, 0666);
+
+    return (file->fd < 0) ? errno : 0;
+}
+
+/*
+ * Main function of writer thread: waits for files ready to be written, then
+ * writes them (all files ready are taken at once, and the mutex is unlocked
+ * during writes).
+ */
+
+void *
+logger_writer_thread_run (void *arg)
+{
+    struct t_logger_writer_job *jobs, *new_jobs;
+    struct t_logger_writer_file *ptr_file;
+    int num_jobs, jobs_alloc, i, fsync_enabled;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    jobs = NULL;
+    jobs_alloc = 0;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+
+    while (1)
+    {
+        while (!logger_writer_ready_files && !logger_writer_quit)
+        {
+            pthread_cond_wait (&logger_writer_cond_ready,
+                               &logger_writer_mutex);
+        }
+        if (!logger_writer_ready_files)
+            break;
+
+        num_jobs = 0;
+        for (ptr_file = logger_writer_ready_files; ptr_file;
+             ptr_file = ptr_file->next_ready)
+        {
+            num_jobs++;
+        }
+        if (num_jobs > jobs_alloc)
+        {
+            new_jobs = realloc (jobs, num_jobs * 2 * sizeof (*jobs));
+            if (!new_jobs)
+            {
+                /* not enough memory: try again later */
+                pthread_mutex_unlock (&logger_writer_mutex);
+                usleep (100 * 1000);
+                pthread_mutex_lock (&logger_writer_mutex);
+                continue;
+            }
+            jobs = new_jobs;
+            jobs_alloc = num_jobs * 2;
+        }
+
+        /* take all files ready, with their records */
+        num_jobs = 0;
+        for (ptr_file = logger_writer_ready_files; ptr_file;
+             ptr_file = ptr_file->next_ready)
+        {
+            jobs[num_jobs].file = ptr_file;
+            jobs[num_jobs].records = ptr_file->records;
+            jobs[num_jobs].num_records = ptr_file->queue_records;
+            jobs[num_jobs].size = ptr_file->queue_size;
+            jobs[num_jobs].closing = ptr_file->closing;
+            jobs[num_jobs].idle_close = ptr_file->idle_close;
+            jobs[num_jobs].error = 0;
+            ptr_file->records = NULL;
+            ptr_file->last_record = NULL;
+            ptr_file->queue_records = 0;
+            ptr_file->queue_size = 0;
+            ptr_file->ready = 0;
+            ptr_file->idle_close = 0;
+            num_jobs++;
+        }
+        logger_writer_ready_files = NULL;
+        logger_writer_last_ready_file = NULL;
+        logger_writer_busy = 1;
+        fsync_enabled = logger_writer_fsync;
+
+        pthread_mutex_unlock (&logger_writer_mutex);
+
+        /* write records and close files (without lock) */
+        for (i = 0; i < num_jobs; i++)
+        {
+            if (jobs[i].records)
+            {
+                jobs[i].error = logger_writer_reopen (jobs[i].file);
+                if (!jobs[i].error)
+                {
+                    jobs[i].error = logger_writer_write_records (
+                        jobs[i].file->fd, jobs[i].records);
+                }
+                if (!jobs[i].error && fsync_enabled)
+                    fsync (jobs[i].file->fd);
+                logger_writer_free_records (jobs[i].records);
+            }
+            if ((jobs[i].closing || jobs[i].idle_close)
+                && (jobs[i].file->fd >= 0))
+            {
+                close (jobs[i].file->fd);
+                jobs[i].file->fd = -1;
+            }
+        }
+
+        pthread_mutex_lock (&logger_writer_mutex);
+
+        for (i = 0; i < num_jobs; i++)
+        {
+            logger_writer_queue_records -= jobs[i].num_records;
+            logger_writer_queue_size -= jobs[i].size;
+            if (jobs[i].closing)
+                logger_writer_free_file (jobs[i].file);
+            else if (jobs[i].error)
+                jobs[i].file->error = jobs[i].error;
+        }
+        logger_writer_busy = 0;
+        pthread_cond_broadcast (&logger_writer_cond_done);
+    }
+
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    if (jobs)
+        free (jobs);
+
+    return NULL;
+}
+
+/*
+ * Starts the writer thread.
+ *
+ * If the thread can not be created, log files are written directly by the
+ * main thread.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (thread not created)
+ */
+
+int
+logger_writer_init ()
+{
+    logger_writer_quit = 0;
+    logger_writer_running = (pthread_create (&logger_writer_thread, NULL,
+                                             &logger_writer_thread_run,
+                                             NULL) == 0) ? 1 : 0;
+    return logger_writer_running;
+}
+
+/*
+ * Adds a file in list of files ready to be written, and wakes up the writer
+ * thread.
+ *
+ * Note: mutex must be locked when this function is called.
+ */
+
+void
+logger_writer_set_ready (struct t_logger_writer_file *file)
+{
+    if (!file->ready)
+    {
+        file->ready = 1;
+        file->next_ready = NULL;
+        if (logger_writer_last_ready_file)
+            logger_writer_last_ready_file->next_ready = file;
+        else
+            logger_writer_ready_files = file;
+        logger_writer_last_ready_file = file;
+    }
+    pthread_cond_signal (&logger_writer_cond_ready);
+}
+
+/*
+ * Removes a file from list of open files.
+ *
+ * Note: mutex must be locked when this function is called.
+ */
+
+void
+logger_writer_lru_remove (struct t_logger_writer_file *file)
+{
+    if (!file->lru)
+        return;
+
+    if (file->prev_lru)
+        (file->prev_lru)->next_lru = file->next_lru;
+    if (file->next_lru)
+        (file->next_lru)->prev_lru = file->prev_lru;
+    if (logger_writer_lru_files == file)
+        logger_writer_lru_files = file->next_lru;
+    if (logger_writer_last_lru_file == file)
+        logger_writer_last_lru_file = file->prev_lru;
+    file->prev_lru = NULL;
+    file->next_lru = NULL;
+    file->lru = 0;
+    logger_writer_lru_count--;
+}
+
+/*
+ * Closes file descriptors of least recently used files, until the number of
+ * files open is lower or equal to the max (the file "file_kept" is never
+ * closed).
+ *
+ * With the writer thread, the file descriptor is closed by the thread after
+ * write of data queued.
+ *
+ * Note: mutex must be locked when this function is called.
+ */
+
+void
+logger_writer_lru_close_idle (struct t_logger_writer_file *file_kept)
+{
+    struct t_logger_writer_file *ptr_file;
+
+    if (logger_writer_max_open <= 0)
+        return;
+
+    while ((logger_writer_lru_count > logger_writer_max_open)
+           && logger_writer_last_lru_file
+           && (logger_writer_last_lru_file != file_kept))
+    {
+        ptr_file = logger_writer_last_lru_file;
+        logger_writer_lru_remove (ptr_file);
+        if (logger_writer_running)
+        {
+            ptr_file->idle_close = 1;
+            logger_writer_set_ready (ptr_file);
+        }
+        else if (ptr_file->fd >= 0)
+        {
+            close (ptr_file->fd);
+            ptr_file->fd = -1;
+        }
+    }
+}
+
+/*
+ * Marks a file as the most recently used (it is added in list of open files
+ * if needed), and closes least recently used files if there are too many
+ * files open.
+ *
+ * Note: mutex must be locked when this function is called.
+ */
+
+void
+logger_writer_lru_use (struct t_logger_writer_file *file)
+{
+    if (file->lru)
+    {
+        if (logger_writer_lru_files == file)
+            return;
+        logger_writer_lru_remove (file);
+    }
+
+    file->prev_lru = NULL;
+    file->next_lru = logger_writer_lru_files;
+    if (logger_writer_lru_files)
+        logger_writer_lru_files->prev_lru = file;
+    else
+        logger_writer_last_lru_file = file;
+    logger_writer_lru_files = file;
+    file->lru = 1;
+    logger_writer_lru_count++;
+
+    logger_writer_lru_close_idle (file);
+}
+
+/*
+ * Opens a log file (in append mode, file is created if it does not exist).
+ *
+ * Returns pointer to file, NULL if error (errno is set).
+ */
+
+struct t_logger_writer_file *
+logger_writer_open (const char *filename)
+{
+    struct t_logger_writer_file *new_file;
+    int fd;
+
+    fd = open (filename, O_WRONLY | O_APPEND | O_CREAT, 0666);
+    if (fd < 0)
+        return NULL;
+
+    new_file = calloc (1, sizeof (*new_file));
+    if (!new_file)
+    {
+        close (fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    new_file->filename = strdup (filename);
+    new_file->fd = fd;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_lru_use (new_file);
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return new_file;
+}
+
+/*
+ * Queues a record to write in a file.
+ *
+ * If "flush" is 1, the file is written as soon as possible, otherwise data
+ * stays in queue until the file is flushed or the size of data queued for
+ * the file is greater than LOGGER_WRITER_FILE_BUFFER_SIZE.
+ *
+ * Returns:
+ *   0: OK
+ *   > 0: error (errno): a previous write failed (a write error is returned
+ *        only once for a file)
+ */
+
+int
+logger_writer_queue_record (struct t_logger_writer_file *file,
+                            struct t_logger_writer_record *new_record,
+                            int flush)
+{
+    int error;
+
+    /* no writer thread: write immediately */
+    if (!logger_writer_running)
+    {
+        logger_writer_lru_use (file);
+        error = logger_writer_reopen (file);
+        if (!error)
+            error = logger_writer_write_records (file->fd, new_record);
+        if (!error && logger_writer_fsync)
+            fsync (file->fd);
+        free (new_record);
+        if (error && !file->error_displayed)
+        {
+            file->error_displayed = 1;
+            return error;
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock (&logger_writer_mutex);
+
+    logger_writer_lru_use (file);
+
+    if (file->last_record)
+        file->last_record->next_record = new_record;
+    else
+        file->records = new_record;
+    file->last_record = new_record;
+    file->queue_records++;
+    file->queue_size += new_record->size;
+    logger_writer_queue_records++;
+    logger_writer_queue_size += new_record->size;
+
+    if (flush || (file->queue_size >= LOGGER_WRITER_FILE_BUFFER_SIZE))
+        logger_writer_set_ready (file);
+
+    /* too much data queued (disk is slow?): wait for the writer */
+    while ((logger_writer_queue_size > LOGGER_WRITER_MAX_QUEUE_SIZE)
+           && (logger_writer_ready_files || logger_writer_busy))
+    {
+        pthread_cond_wait (&logger_writer_cond_done, &logger_writer_mutex);
+    }
+
+    error = 0;
+    if (file->error && !file->error_displayed)
+    {
+        error = file->error;
+        file->error_displayed = 1;
+    }
+
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return error;
+}
+
+/*
+ * Queues a line to write in a log file (a new line is added after the line).
+ *
+ * Returns:
+ *   0: OK
+ *   > 0: error (errno): line could not be queued or a previous write failed
+ *        (a write error is returned only once for a file)
+ */
+
+int
+logger_writer_write_line (struct t_logger_writer_file *file,
+                          const char *line, int flush)
+{
+    struct t_logger_writer_record *new_record;
+    int size;
+
+    if (!file || !line)
+        return 0;
+
+    size = strlen (line) + 1;
+    new_record = malloc (sizeof (*new_record) + size);
+    if (!new_record)
+        return ENOMEM;
+    new_record->data = (char *)(new_record + 1);
+    memcpy (new_record->data, line, size - 1);
+    new_record->data[size - 1] = '\n';
+    new_record->size = size;
+    new_record->next_record = NULL;
+
+    return logger_writer_queue_record (file, new_record, flush);
+}
+
+/*
+ * Queues binary data to write in a file.
+ *
+ * Returns:
+ *   0: OK
+ *   > 0: error (errno): data could not be queued or a previous write failed
+ *        (a write error is returned only once for a file)
+ */
+
+int
+logger_writer_write_data (struct t_logger_writer_file *file,
+                          const void *data, int size, int flush)
+{
+    struct t_logger_writer_record *new_record;
+
+    if (!file || !data || (size <= 0))
+        return 0;
+
+    new_record = malloc (sizeof (*new_record) + size);
+    if (!new_record)
+        return ENOMEM;
+    new_record->data = (char *)(new_record + 1);
+    memcpy (new_record->data, data, size);
+    new_record->size = size;
+    new_record->next_record = NULL;
+
+    return logger_writer_queue_record (file, new_record, flush);
+}
+
+/*
+ * Asks the writer thread to write data queued for a file.
+ */
+
+void
+logger_writer_flush_file (struct t_logger_writer_file *file)
+{
+    if (!file || !logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    if (file->records)
+        logger_writer_set_ready (file);
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Closes a log file: data queued is written, then the file is closed and
+ * freed by the writer thread.
+ *
+ * The file must not be used any more after call to this function.
+ */
+
+void
+logger_writer_close (struct t_logger_writer_file *file)
+{
+    if (!file)
+        return;
+
+    if (!logger_writer_running)
+    {
+        logger_writer_lru_remove (file);
+        if (file->fd >= 0)
+            close (file->fd);
+        logger_writer_free_file (file);
+        return;
+    }
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_lru_remove (file);
+    file->closing = 1;
+    logger_writer_set_ready (file);
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Waits until all files ready have been written by the writer thread.
+ */
+
+void
+logger_writer_sync ()
+{
+    if (!logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    while (logger_writer_ready_files || logger_writer_busy)
+    {
+        pthread_cond_wait (&logger_writer_cond_done, &logger_writer_mutex);
+    }
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Enables/disables call to fsync after write of log files.
+ */
+
+void
+logger_writer_set_fsync (int fsync_enabled)
+{
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_fsync = fsync_enabled;
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Sets max number of files open (0 = no limit): file descriptors of least
+ * recently used files are closed if there are too many files open.
+ */
+
+void
+logger_writer_set_max_open (int max_open)
+{
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_max_open = max_open;
+    logger_writer_lru_close_idle (NULL);
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Gets number of records and size of data queued.
+ */
+
+void
+logger_writer_get_queue (int *records, int *size)
+{
+    pthread_mutex_lock (&logger_writer_mutex);
+    if (records)
+        *records = logger_writer_queue_records;
+    if (size)
+        *size = logger_writer_queue_size;
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Returns number of files open (files with a file descriptor closed because
+ * they were idle are not counted).
+ */
+
+int
+logger_writer_get_open_count ()
+{
+    int count;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    count = logger_writer_lru_count;
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return count;
+}
+
+/*
+ * Stops the writer thread: files ready are written before the thread ends.
+ */
+
+void
+logger_writer_end ()
+{
+    if (!logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_quit = 1;
+    pthread_cond_signal (&logger_writer_cond_ready);
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    pthread_join (logger_writer_thread, NULL);
+    logger_writer_running = 0;
+}
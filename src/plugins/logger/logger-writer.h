@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_WRITER_H
+#define WEECHAT_LOGGER_WRITER_H 1
+
+/* size of data queued for a file before it is written (if flush delayed) */
+#define LOGGER_WRITER_FILE_BUFFER_SIZE 8192
+
+/* main thread waits for the writer when this size of data is queued */
+#define LOGGER_WRITER_MAX_QUEUE_SIZE (16 * 1024 * 1024)
+
+/* max number of records written with a single call to writev() */
+#define LOGGER_WRITER_MAX_IOVEC 64
+
+/* formatted line to write in a log file */
+
+struct t_logger_writer_record
+{
+    char *data;                           /* data to write (not NUL-term.)  */
+    int size;                             /* size of data                   */
+    struct t_logger_writer_record *next_record; /* link to next record      */
+};
+
+/* log file written by the writer thread */
+
+struct t_logger_writer_file
+{
+    char *filename;                       /* log filename                   */
+    int fd;                               /* file descriptor                */
+    struct t_logger_writer_record *records;     /* records to write         */
+    struct t_logger_writer_record *last_record; /* last record to write     */
+    int queue_records;                    /* number of records              */
+    int queue_size;                       /* size of data in records        */
+    int ready;                            /* 1 if records must be written   */
+                                          /* by writer thread               */
+    int closing;                          /* 1 if file must be closed after */
+                                          /* write of records               */
+    int idle_close;                       /* 1 if fd must be closed after   */
+                                          /* write (too many files open),   */
+                                          /* it is opened again on write    */
+    int lru;                              /* 1 if file is in list of open   */
+                                          /* files                          */
+    int error;                            /* errno of last write error      */
+    int error_displayed;                  /* 1 if error has been displayed  */
+    struct t_logger_writer_file *next_ready; /* next file ready to write    */
+    struct t_logger_writer_file *prev_lru;   /* more recently used file     */
+    struct t_logger_writer_file *next_lru;   /* less recently used file     */
+};
+
+/* records of a file taken by the writer thread */
+
+struct t_logger_writer_job
+{
+    struct t_logger_writer_file *file;    /* file                           */
+    struct t_logger_writer_record *records; /* records to write             */
+    int num_records;                      /* number of records              */
+    int size;                             /* size of data in records        */
+    int closing;                          /* 1 if file is closed after write*/
+    int idle_close;                       /* 1 if fd is closed after write  */
+    int error;                            /* errno of write error (0 if OK) */
+};
+
+extern int logger_writer_init ();
+extern struct t_logger_writer_file *logger_writer_open (const char *filename);
+extern int logger_writer_write_line (struct t_logger_writer_file *file,
+                                     const char *line, int flush);
+extern int logger_writer_write_data (struct t_logger_writer_file *file,
+                                     const void *data, int size, int flush);
+extern void logger_writer_flush_file (struct t_logger_writer_file *file);
+extern void logger_writer_close (struct t_logger_writer_file *file);
+extern void logger_writer_sync ();
+extern void logger_writer_set_fsync (int fsync_enabled);
+extern void logger_writer_set_max_open (int max_open);
+extern void logger_writer_get_queue (int *records, int *size);
+extern int logger_writer_get_open_count ();
+extern void logger_writer_end ();
+
+#endif /* WEECHAT_LOGGER_WRITER_H */
@@ -39,10 +39,14 @@
 
 #include "../weechat-plugin.h"
 #include "logger.h"
+#include "logger-backlog.h"
 #include "logger-buffer.h"
 #include "logger-config.h"
+#include "logger-index.h"
 #include "logger-info.h"
+#include "logger-rotate.h"
 #include "logger-tail.h"
+#include "logger-writer.h"
 
 
 WEECHAT_PLUGIN_NAME(LOGGER_PLUGIN_NAME);
@@ -399,6 +403,7 @@ logger_get_filename (struct t_gui_buffer *buffer)
     const char *mask;
     const char *dir_separator, *weechat_dir;
     int length;
+    struct t_logger_buffer *ptr_logger_buffer;
 
     res = NULL;
     mask_expanded = NULL;
@@ -411,8 +416,21 @@ logger_get_filename (struct t_gui_buffer *buffer)
     if (!weechat_dir)
         return NULL;
 
-    /* get filename mask for buffer */
-    mask = logger_get_mask_for_buffer (buffer);
+    /*
+     * get filename mask for buffer (the mask found is cached in logger
+     * buffer, until a mask option is changed)
+     */
+    ptr_logger_buffer = logger_buffer_search_buffer (buffer);
+    if (ptr_logger_buffer && ptr_logger_buffer->log_mask)
+    {
+        mask = ptr_logger_buffer->log_mask;
+    }
+    else
+    {
+        mask = logger_get_mask_for_buffer (buffer);
+        if (mask && ptr_logger_buffer)
+            ptr_logger_buffer->log_mask = strdup (mask);
+    }
     if (!mask)
     {
         weechat_printf_date_tags (
@@ -509,6 +527,33 @@ logger_set_log_filename (struct t_logger_buffer *logger_buffer)
     logger_buffer->log_filename = log_filename;
 }
 
+/*
+ * Queues a line (already converted to charset) in log file of a logger
+ * buffer: the line is written by the writer thread, immediately if there is
+ * no flush delay.
+ */
+
+void
+logger_write_file (struct t_logger_buffer *logger_buffer, const char *line)
+{
+    int error;
+
+    logger_index_add_line (logger_buffer, (logger_timer) ? 0 : 1);
+
+    error = logger_writer_write_line (logger_buffer->log_file, line,
+                                      (logger_timer) ? 0 : 1);
+    if (error)
+    {
+        weechat_printf_date_tags (
+            NULL, 0, "no_log",
+            _("%s%s: unable to write log file \"%s\": %s"),
+            weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+            logger_buffer->log_filename, strerror (error));
+    }
+    logger_buffer->flush_needed = (logger_timer) ? 1 : 0;
+    logger_buffer->log_size += strlen (line) + 1;
+}
+
 /*
  * Writes a line to log file.
  */
@@ -521,10 +566,19 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
     const char *charset;
     time_t seconds;
     struct tm *date_tmp;
+    struct stat st;
     int log_level;
 
     charset = weechat_info_get ("charset_terminal", "");
 
+    /* rotate log file if its size is too big (it is opened again below) */
+    if (logger_buffer->log_file
+        && (logger_config_rotation_size > 0)
+        && (logger_buffer->log_size >= logger_config_rotation_size))
+    {
+        logger_rotate_buffer (logger_buffer);
+    }
+
     if (!logger_buffer->log_file)
     {
         log_level = logger_get_level_for_buffer (logger_buffer->buffer);
@@ -553,7 +607,7 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
         }
 
         logger_buffer->log_file =
-            fopen (logger_buffer->log_filename, "a");
+            logger_writer_open (logger_buffer->log_filename);
         if (!logger_buffer->log_file)
         {
             weechat_printf_date_tags (
@@ -564,6 +618,9 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
             logger_buffer_free (logger_buffer);
             return;
         }
+        logger_buffer->log_size =
+            (stat (logger_buffer->log_filename, &st) == 0) ? st.st_size : 0;
+        logger_index_open (logger_buffer);
 
         if (weechat_config_boolean (logger_config_file_info_lines)
             && logger_buffer->write_start_info_line)
@@ -582,11 +639,10 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
                       buf_time);
             message = (charset) ?
                 weechat_iconv_from_internal (charset, buf_beginning) : NULL;
-            fprintf (logger_buffer->log_file,
-                     "%s\n", (message) ? message : buf_beginning);
+            logger_write_file (logger_buffer,
+                               (message) ? message : buf_beginning);
             if (message)
                 free (message);
-            logger_buffer->flush_needed = 1;
         }
         logger_buffer->write_start_info_line = 0;
     }
@@ -596,16 +652,9 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
     {
         message = (charset) ?
             weechat_iconv_from_internal (charset, vbuffer) : NULL;
-        fprintf (logger_buffer->log_file,
-                 "%s\n", (message) ? message : vbuffer);
+        logger_write_file (logger_buffer, (message) ? message : vbuffer);
         if (message)
             free (message);
-        logger_buffer->flush_needed = 1;
-        if (!logger_timer)
-        {
-            fflush (logger_buffer->log_file);
-            logger_buffer->flush_needed = 0;
-        }
         free (vbuffer);
     }
 }
@@ -641,8 +690,9 @@ logger_stop (struct t_logger_buffer *logger_buffer, int write_info_line)
                                _("%s\t****  End of log  ****"),
                                buf_time);
         }
-        fclose (logger_buffer->log_file);
+        logger_writer_close (logger_buffer->log_file);
         logger_buffer->log_file = NULL;
+        logger_index_close (logger_buffer);
     }
     logger_buffer_free (logger_buffer);
 }
@@ -701,8 +751,9 @@ logger_start_buffer (struct t_gui_buffer *buffer, int write_info_line)
                 {
                     if (ptr_logger_buffer->log_file)
                     {
-                        fclose (ptr_logger_buffer->log_file);
+                        logger_writer_close (ptr_logger_buffer->log_file);
                         ptr_logger_buffer->log_file = NULL;
+                        logger_index_close (ptr_logger_buffer);
                     }
                 }
             }
@@ -745,6 +796,7 @@ logger_list ()
     struct t_logger_buffer *ptr_logger_buffer;
     struct t_gui_buffer *ptr_buffer;
     char status[128];
+    int queue_records, queue_size;
 
     weechat_printf (NULL, "");
     weechat_printf (NULL, _("Logging on buffers:"));
@@ -789,6 +841,15 @@ logger_list ()
         }
         weechat_infolist_free (ptr_infolist);
     }
+
+    logger_writer_get_queue (&queue_records, &queue_size);
+    weechat_printf (NULL,
+                    _("Lines queued for writing in log files: %d "
+                      "(%d bytes)"),
+                    queue_records, queue_size);
+    weechat_printf (NULL,
+                    _("Files open: %d"),
+                    logger_writer_get_open_count ());
 }
 
 /*
@@ -840,7 +901,9 @@ logger_flush ()
                                           LOGGER_PLUGIN_NAME,
                                           ptr_logger_buffer->log_filename);
             }
-            fflush (ptr_logger_buffer->log_file);
+            logger_writer_flush_file (ptr_logger_buffer->log_file);
+            if (ptr_logger_buffer->index_file)
+                logger_writer_flush_file (ptr_logger_buffer->index_file);
             ptr_logger_buffer->flush_needed = 0;
         }
     }
@@ -877,6 +940,7 @@ logger_command_cb (const void *pointer, void *data,
     if (weechat_strcasecmp (argv[1], "flush") == 0)
     {
         logger_flush ();
+        logger_writer_sync ();
         return WEECHAT_RC_OK;
     }
 
@@ -924,6 +988,8 @@ logger_buffer_closing_signal_cb (const void *pointer, void *data,
     (void) signal;
     (void) type_data;
 
+    logger_backlog_reader_cancel (signal_data);
+
     logger_stop (logger_buffer_search_buffer (signal_data), 1);
 
     return WEECHAT_RC_OK;
@@ -951,49 +1017,142 @@ logger_buffer_renamed_signal_cb (const void *pointer, void *data,
 }
 
 /*
- * Displays backlog for a buffer (by reading end of log file).
+ * Returns date of a line read in a log file (date before the first tab,
+ * with format of option logger.file.time_format).
+ *
+ * Returns 0 if the line has no valid date.
+ */
+
+time_t
+logger_get_line_date (const char *line)
+{
+    const char *pos_tab;
+    char str_date[256], *error;
+    time_t time_now;
+    struct tm tm_line;
+    int length;
+
+    if (!line)
+        return 0;
+
+    pos_tab = strchr (line, '\t');
+    if (!pos_tab)
+        return 0;
+
+    length = pos_tab - line;
+    if (length >= (int)sizeof (str_date))
+        return 0;
+    memcpy (str_date, line, length);
+    str_date[length] = '\0';
+
+    /* initialize structure, because strptime does not do it */
+    memset (&tm_line, 0, sizeof (struct tm));
+    /*
+     * we get current time to initialize daylight saving time in
+     * structure tm_line, otherwise printed time will be shifted
+     * and will not use DST used on machine
+     */
+    time_now = time (NULL);
+    localtime_r (&time_now, &tm_line);
+    error = strptime (str_date,
+                      weechat_config_string (logger_config_file_time_format),
+                      &tm_line);
+    if (error && !error[0] && (tm_line.tm_year > 0))
+        return mktime (&tm_line);
+
+    return 0;
+}
+
+/*
+ * Returns last lines of a log file: if the log file has less than "lines"
+ * lines, lines are read in rotated log files ("file.1", "file.2", ...),
+ * which can be compressed.
+ *
+ * If size >= 0, only the first "size" bytes of log file are read.
+ *
+ * This function can be called by any thread (the WeeChat API is not used).
+ *
+ * Note: result must be freed after use with function logger_tail_free().
+ */
+
+struct t_logger_line *
+logger_backlog_tail (const char *filename, int lines, off_t size)
+{
+    struct t_logger_line *last_lines, *rotated_lines, *ptr_line;
+    char *rotated_filename;
+    int num_lines, number;
+
+    last_lines = logger_tail_file (filename, lines, size);
+
+    num_lines = 0;
+    for (ptr_line = last_lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        num_lines++;
+    }
+
+    number = 1;
+    while (num_lines < lines)
+    {
+        rotated_filename = logger_rotate_search_file (filename, number);
+        if (!rotated_filename)
+            break;
+        rotated_lines = logger_tail_file (rotated_filename,
+                                          lines - num_lines, -1);
+        free (rotated_filename);
+        if (!rotated_lines)
+            break;
+        /* insert lines of rotated file before lines already read */
+        ptr_line = rotated_lines;
+        num_lines++;
+        while (ptr_line->next_line)
+        {
+            ptr_line = ptr_line->next_line;
+            num_lines++;
+        }
+        ptr_line->next_line = last_lines;
+        last_lines = rotated_lines;
+        number++;
+    }
+
+    return last_lines;
+}
+
+/*
+ * Displays lines of backlog in a buffer.
+ *
+ * If top == 1, lines are moved on top of buffer (before lines already
+ * displayed in buffer).
  */
 
 void
-logger_backlog (struct t_gui_buffer *buffer, const char *filename, int lines)
+logger_backlog_display (struct t_gui_buffer *buffer,
+                        struct t_logger_line *last_lines, int top)
 {
     const char *charset;
-    struct t_logger_line *last_lines, *ptr_lines;
-    char *pos_message, *pos_tab, *error, *message;
-    time_t datetime, time_now;
-    struct tm tm_line;
-    int num_lines;
+    struct t_logger_line *ptr_lines;
+    char *pos_message, *pos_tab, *message;
+    time_t datetime;
+    int num_lines, batch_started;
 
     charset = weechat_info_get ("charset_terminal", "");
 
     weechat_buffer_set (buffer, "print_hooks_enabled", "0");
 
+    /* lines of backlog are added in a batch (one hotlist update/refresh) */
+    batch_started = 0;
+    if (!weechat_buffer_get_integer (buffer, "lines_batch"))
+    {
+        weechat_buffer_set (buffer, "lines_batch", (top) ? "top" : "1");
+        batch_started = 1;
+    }
+
     num_lines = 0;
-    last_lines = logger_tail_file (filename, lines);
+    datetime = 0;
     ptr_lines = last_lines;
     while (ptr_lines)
     {
-        datetime = 0;
+        datetime = logger_get_line_date (ptr_lines->data);
         pos_message = strchr (ptr_lines->data, '\t');
-        if (pos_message)
-        {
-            /* initialize structure, because strptime does not do it */
-            memset (&tm_line, 0, sizeof (struct tm));
-            /*
-             * we get current time to initialize daylight saving time in
-             * structure tm_line, otherwise printed time will be shifted
-             * and will not use DST used on machine
-             */
-            time_now = time (NULL);
-            localtime_r (&time_now, &tm_line);
-            pos_message[0] = '\0';
-            error = strptime (ptr_lines->data,
-                              weechat_config_string (logger_config_file_time_format),
-                              &tm_line);
-            if (error && !error[0] && (tm_line.tm_year > 0))
-                datetime = mktime (&tm_line);
-            pos_message[0] = '\t';
-        }
         pos_message = (pos_message && (datetime != 0)) ?
             pos_message + 1 : ptr_lines->data;
         message = (charset) ?
@@ -1018,8 +1177,6 @@ logger_backlog (struct t_gui_buffer *buffer, const char *filename, int lines)
         num_lines++;
         ptr_lines = ptr_lines->next_line;
     }
-    if (last_lines)
-        logger_tail_free (last_lines);
     if (num_lines > 0)
     {
         weechat_printf_date_tags (buffer, datetime,
@@ -1030,9 +1187,32 @@ logger_backlog (struct t_gui_buffer *buffer, const char *filename, int lines)
                                   num_lines);
         weechat_buffer_set (buffer, "unread", "");
     }
+    if (batch_started)
+        weechat_buffer_set (buffer, "lines_batch", "0");
     weechat_buffer_set (buffer, "print_hooks_enabled", "1");
 }
 
+/*
+ * Displays backlog for a buffer (by reading end of log file).
+ */
+
+void
+logger_backlog (struct t_gui_buffer *buffer, const char *filename, int lines)
+{
+    struct t_logger_line *last_lines;
+
+    /* lines queued for the file must be written before reading it */
+    logger_flush ();
+    logger_writer_sync ();
+
+    last_lines = logger_backlog_tail (filename, lines, -1);
+    if (last_lines)
+    {
+        logger_backlog_display (buffer, last_lines, 0);
+        logger_tail_free (last_lines);
+    }
+}
+
 /*
  * Callback for signal "logger_backlog".
  */
@@ -1058,7 +1238,12 @@ logger_backlog_signal_cb (const void *pointer, void *data,
             if (!ptr_logger_buffer->log_filename)
                 logger_set_log_filename (ptr_logger_buffer);
 
-            if (ptr_logger_buffer->log_filename)
+            /* backlog is read by a thread, or now if no thread is running */
+            if (ptr_logger_buffer->log_filename
+                && !logger_backlog_reader_queue (
+                    signal_data,
+                    ptr_logger_buffer->log_filename,
+                    weechat_config_integer (logger_config_look_backlog)))
             {
                 ptr_logger_buffer->log_enabled = 0;
 
@@ -1321,6 +1506,17 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     logger_config_read ();
 
+    if (!logger_writer_init ())
+    {
+        weechat_printf (NULL,
+                        _("%s%s: unable to start writer thread, log files "
+                          "will be written by main thread"),
+                        weechat_prefix ("error"), LOGGER_PLUGIN_NAME);
+    }
+    logger_writer_set_fsync (weechat_config_boolean (logger_config_file_fsync));
+    logger_writer_set_max_open (
+        weechat_config_integer (logger_config_file_max_open_files));
+
     /* command /logger */
     weechat_hook_command (
         "logger",
@@ -1405,8 +1601,12 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     logger_config_write ();
 
+    logger_backlog_reader_end ();
+
     logger_stop_all (1);
 
+    logger_writer_end ();
+
     logger_config_free ();
 
     return WEECHAT_RC_OK;
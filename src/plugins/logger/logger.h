@@ -25,13 +25,26 @@
 
 #define LOGGER_LEVEL_DEFAULT 9
 
+#include <sys/types.h>
+
+struct t_gui_buffer;
+struct t_logger_line;
+
 extern struct t_weechat_plugin *weechat_logger_plugin;
 
 extern struct t_hook *logger_timer;
 
+extern char *logger_get_filename (struct t_gui_buffer *buffer);
 extern void logger_start_buffer_all (int write_info_line);
 extern void logger_stop_all (int write_info_line);
+extern void logger_flush ();
 extern void logger_adjust_log_filenames ();
+extern time_t logger_get_line_date (const char *line);
+extern struct t_logger_line *logger_backlog_tail (const char *filename,
+                                                  int lines, off_t size);
+extern void logger_backlog_display (struct t_gui_buffer *buffer,
+                                    struct t_logger_line *last_lines,
+                                    int top);
 extern int logger_timer_cb (const void *pointer, void *data,
                             int remaining_calls);
 
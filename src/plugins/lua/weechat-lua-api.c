@@ -1955,6 +1955,30 @@ API_FUNC(print_date_tags)
     API_RETURN_OK;
 }
 
+API_FUNC(print_lines)
+{
+    const char *buffer, *tags, *lines;
+    int date;
+
+    API_INIT_FUNC(1, "print_lines", API_RETURN_ERROR);
+    if (lua_gettop (L) < 4)
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    buffer = lua_tostring (L, -4);
+    date = lua_tonumber (L, -3);
+    tags = lua_tostring (L, -2);
+    lines = lua_tostring (L, -1);
+
+    plugin_script_api_print_lines (weechat_lua_plugin,
+                                   lua_current_script,
+                                   API_STR2PTR(buffer),
+                                   date,
+                                   tags,
+                                   lines);
+
+    API_RETURN_OK;
+}
+
 API_FUNC(print_y)
 {
     const char *buffer, *message;
@@ -4933,6 +4957,61 @@ API_FUNC(hdata_hashtable)
     return 1;
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * table with the variables of object in the table on the stack.
+ */
+
+void
+weechat_lua_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                                void *pointer, struct t_hashtable *record)
+{
+    lua_State *interpreter;
+    int *index;
+
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    interpreter = (lua_State *)(((void **)data)[0]);
+    index = (int *)(((void **)data)[1]);
+
+    weechat_lua_pushhashtable (interpreter, record);
+    (*index)++;
+    lua_rawseti (interpreter, -2, *index);
+}
+
+API_FUNC(hdata_fetch)
+{
+    const char *hdata, *pointer, *fields;
+    int count, index;
+    void *data[2];
+
+    API_INIT_FUNC(1, "hdata_fetch", API_RETURN_EMPTY);
+    if (lua_gettop (L) < 4)
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    hdata = lua_tostring (L, -4);
+    pointer = lua_tostring (L, -3);
+    fields = lua_tostring (L, -2);
+    count = lua_tonumber (L, -1);
+
+    lua_newtable (L);
+
+    index = 0;
+    data[0] = L;
+    data[1] = &index;
+
+    weechat_hdata_fetch (API_STR2PTR(hdata),
+                         API_STR2PTR(pointer),
+                         fields,
+                         count,
+                         &weechat_lua_api_hdata_fetch_cb,
+                         data);
+
+    return 1;
+}
+
 API_FUNC(hdata_update)
 {
     const char *hdata, *pointer;
@@ -5181,6 +5260,7 @@ const struct luaL_Reg weechat_lua_api_funcs[] = {
     API_DEF_FUNC(color),
     API_DEF_FUNC(print),
     API_DEF_FUNC(print_date_tags),
+    API_DEF_FUNC(print_lines),
     API_DEF_FUNC(print_y),
     API_DEF_FUNC(log_print),
     API_DEF_FUNC(hook_command),
@@ -5289,6 +5369,7 @@ const struct luaL_Reg weechat_lua_api_funcs[] = {
     API_DEF_FUNC(hdata_pointer),
     API_DEF_FUNC(hdata_time),
     API_DEF_FUNC(hdata_hashtable),
+    API_DEF_FUNC(hdata_fetch),
     API_DEF_FUNC(hdata_update),
     API_DEF_FUNC(hdata_get_string),
     API_DEF_FUNC(upgrade_new),
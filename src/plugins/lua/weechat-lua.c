@@ -25,8 +25,12 @@
 #include <lua.h>
 #include <lualib.h>
 #include <lauxlib.h>
+#ifdef LUA_JITLIBNAME /* defined only in LuaJIT */
+#include <luajit.h>
+#endif /* LUA_JITLIBNAME */
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "../weechat-plugin.h"
 #include "../plugin-script.h"
@@ -50,6 +54,9 @@ struct t_plugin_script *lua_current_script = NULL;
 struct t_plugin_script *lua_registered_script = NULL;
 const char *lua_current_script_filename = NULL;
 lua_State *lua_current_interpreter = NULL;
+int lua_exec_depth = 0;                /* depth of nested calls of functions */
+int lua_exec_timeout = 0;              /* max time for a callback (ms)      */
+struct timeval lua_exec_start;         /* start of first (not nested) call  */
 
 /*
  * string used to execute action "install":
@@ -154,6 +161,34 @@ weechat_lua_tohashtable (lua_State *interpreter, int index, int size,
     return hashtable;
 }
 
+/*
+ * Lua hook called every LUA_EXEC_TIMEOUT_COUNT instructions while a function
+ * is running: interrupts the function if it runs for too long (option
+ * weechat.plugin.script_callback_timeout).
+ *
+ * The hook is kept, so that the error is raised again if the script catches
+ * it (with pcall).
+ */
+
+void
+weechat_lua_exec_timeout_hook (lua_State *interpreter, lua_Debug *ar)
+{
+    struct timeval now;
+
+    /* make C compiler happy */
+    (void) ar;
+
+    gettimeofday (&now, NULL);
+    if (weechat_util_timeval_diff (&lua_exec_start, &now) >=
+        (long long)lua_exec_timeout * 1000)
+    {
+        luaL_error (interpreter,
+                    "function interrupted after %d ms (option "
+                    "weechat.plugin.script_callback_timeout)",
+                    lua_exec_timeout);
+    }
+}
+
 /*
  * Executes a lua function.
  */
@@ -163,7 +198,7 @@ weechat_lua_exec (struct t_plugin_script *script, int ret_type,
                   const char *function, const char *format, void **argv)
 {
     void *ret_value;
-    int argc, i, *ret_i;
+    int argc, i, *ret_i, rc;
     lua_State *old_lua_current_interpreter;
     struct t_plugin_script *old_lua_current_script;
 
@@ -204,7 +239,32 @@ weechat_lua_exec (struct t_plugin_script *script, int ret_type,
 
     ret_value = NULL;
 
-    if (lua_pcall (lua_current_interpreter, argc, 1, 0) == 0)
+    /* interrupt the function if it runs for too long */
+    if (lua_exec_depth == 0)
+    {
+        lua_exec_timeout = plugin_script_callback_timeout (weechat_lua_plugin);
+        if (lua_exec_timeout > 0)
+            gettimeofday (&lua_exec_start, NULL);
+    }
+    if (lua_exec_timeout > 0)
+    {
+        lua_sethook (lua_current_interpreter, &weechat_lua_exec_timeout_hook,
+                     LUA_MASKCOUNT, LUA_EXEC_TIMEOUT_COUNT);
+    }
+
+    lua_exec_depth++;
+    rc = lua_pcall (lua_current_interpreter, argc, 1, 0);
+    lua_exec_depth--;
+
+    /* remove hook (unless an outer function is running in same interpreter) */
+    if ((lua_exec_timeout > 0)
+        && ((lua_exec_depth == 0)
+            || (lua_current_interpreter != old_lua_current_interpreter)))
+    {
+        lua_sethook (lua_current_interpreter, NULL, 0, 0);
+    }
+
+    if (rc == 0)
     {
         if (ret_type == WEECHAT_SCRIPT_EXEC_STRING)
         {
@@ -812,6 +872,38 @@ weechat_lua_signal_debug_dump_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Displays memory used by lua interpreters (one by script).
+ */
+
+int
+weechat_lua_signal_debug_memory_cb (const void *pointer, void *data,
+                                    const char *signal,
+                                    const char *type_data, void *signal_data)
+{
+    struct t_plugin_script *ptr_script;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    weechat_printf (NULL, "");
+    weechat_printf (NULL, "%s:", LUA_PLUGIN_NAME);
+    for (ptr_script = lua_scripts; ptr_script;
+         ptr_script = ptr_script->next_script)
+    {
+        weechat_printf (NULL, "  %s: %d KB",
+                        ptr_script->name,
+                        lua_gc ((lua_State *)(ptr_script->interpreter),
+                                LUA_GCCOUNT, 0));
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Display infos about external libraries used.
  */
@@ -828,11 +920,14 @@ weechat_lua_signal_debug_libs_cb (const void *pointer, void *data,
     (void) type_data;
     (void) signal_data;
 
-#ifdef LUA_VERSION
+#if defined(LUAJIT_VERSION)
+    weechat_printf (NULL, "  %s: %s (%s API)",
+                    LUA_PLUGIN_NAME, LUAJIT_VERSION, LUA_VERSION);
+#elif defined(LUA_VERSION)
     weechat_printf (NULL, "  %s: %s", LUA_PLUGIN_NAME, LUA_VERSION);
 #else
     weechat_printf (NULL, "  %s: (?)", LUA_PLUGIN_NAME);
-#endif /* LUA_VERSION */
+#endif /* defined(LUAJIT_VERSION) */
 
     return WEECHAT_RC_OK;
 }
@@ -951,6 +1046,9 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
     plugin_script_display_short_list (weechat_lua_plugin,
                                       lua_scripts);
 
+    weechat_hook_signal ("debug_memory",
+                         &weechat_lua_signal_debug_memory_cb, NULL, NULL);
+
     /* init OK */
     return WEECHAT_RC_OK;
 }
@@ -26,6 +26,9 @@
 
 #define LUA_CURRENT_SCRIPT_NAME ((lua_current_script) ? lua_current_script->name : "-")
 
+/* number of instructions between two checks of callback timeout */
+#define LUA_EXEC_TIMEOUT_COUNT 1000
+
 struct t_lua_const
 {
     char *name;
@@ -42,6 +45,9 @@ extern struct t_plugin_script *lua_current_script;
 extern struct t_plugin_script *lua_registered_script;
 extern const char *lua_current_script_filename;
 extern lua_State *lua_current_interpreter;
+extern int lua_exec_depth;
+extern int lua_exec_timeout;
+extern struct timeval lua_exec_start;
 
 extern void weechat_lua_pushhashtable (lua_State *interpreter,
                                        struct t_hashtable *hashtable);
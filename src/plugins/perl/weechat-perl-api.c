@@ -165,10 +165,11 @@ API_FUNC(register)
                             PERL_PLUGIN_NAME, name, version, description);
         }
 #ifdef MULTIPLICITY
-        perl_current_script->interpreter = perl_current_interpreter;
-#else
-        perl_current_script->interpreter = SvPV_nolen (eval_pv ("__PACKAGE__", TRUE));
+        if (!perl_shared)
+            perl_current_script->interpreter = perl_current_interpreter;
+        else
 #endif /* MULTIPLICITY */
+            perl_current_script->interpreter = SvPV_nolen (eval_pv ("__PACKAGE__", TRUE));
     }
     else
     {
@@ -1893,6 +1894,29 @@ API_FUNC(print_date_tags)
     API_RETURN_OK;
 }
 
+API_FUNC(print_lines)
+{
+    char *buffer, *tags, *lines;
+    dXSARGS;
+
+    API_INIT_FUNC(1, "print_lines", API_RETURN_ERROR);
+    if (items < 4)
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    buffer = SvPV_nolen (ST (0));
+    tags = SvPV_nolen (ST (2));
+    lines = SvPV_nolen (ST (3));
+
+    plugin_script_api_print_lines (weechat_perl_plugin,
+                                   perl_current_script,
+                                   API_STR2PTR(buffer),
+                                   SvIV (ST (1)),
+                                   tags,
+                                   lines);
+
+    API_RETURN_OK;
+}
+
 API_FUNC(print_y)
 {
     char *buffer, *message;
@@ -4861,6 +4885,54 @@ API_FUNC(hdata_hashtable)
     API_RETURN_OBJ(result_hash);
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * hash with the variables of object in the array.
+ */
+
+void
+weechat_perl_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                                 void *pointer, struct t_hashtable *record)
+{
+    HV *hash;
+
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    hash = weechat_perl_hashtable_to_hash (record);
+    if (hash)
+        av_push ((AV *)data, newRV_noinc ((SV *)hash));
+}
+
+API_FUNC(hdata_fetch)
+{
+    char *hdata, *pointer, *fields;
+    AV *result_array;
+    dXSARGS;
+
+    API_INIT_FUNC(1, "hdata_fetch", API_RETURN_EMPTY);
+    if (items < 4)
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    hdata = SvPV_nolen (ST (0));
+    pointer = SvPV_nolen (ST (1));
+    fields = SvPV_nolen (ST (2));
+
+    result_array = newAV ();
+
+    weechat_hdata_fetch (API_STR2PTR(hdata),
+                         API_STR2PTR(pointer),
+                         fields,
+                         SvIV (ST (3)),
+                         &weechat_perl_api_hdata_fetch_cb,
+                         result_array);
+
+    /* the array (and hashes in it) are owned by the reference returned */
+    ST (0) = sv_2mortal (newRV_noinc ((SV *)result_array));
+    XSRETURN (1);
+}
+
 API_FUNC(hdata_update)
 {
     char *hdata, *pointer;
@@ -5121,6 +5193,7 @@ weechat_perl_api_init (pTHX)
     API_DEF_FUNC(color);
     API_DEF_FUNC(print);
     API_DEF_FUNC(print_date_tags);
+    API_DEF_FUNC(print_lines);
     API_DEF_FUNC(print_y);
     API_DEF_FUNC(log_print);
     API_DEF_FUNC(hook_command);
@@ -5229,6 +5302,7 @@ weechat_perl_api_init (pTHX)
     API_DEF_FUNC(hdata_pointer);
     API_DEF_FUNC(hdata_time);
     API_DEF_FUNC(hdata_hashtable);
+    API_DEF_FUNC(hdata_fetch);
     API_DEF_FUNC(hdata_update);
     API_DEF_FUNC(hdata_get_string);
     API_DEF_FUNC(upgrade_new);
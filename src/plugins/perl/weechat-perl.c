@@ -80,10 +80,27 @@ char *perl_action_autoload_list = NULL;
 #undef MULTIPLICITY
 #endif /* NO_PERL_MULTIPLICITY */
 
-#ifndef MULTIPLICITY
+#define PERL_OPTION_SHARED_INTERPRETER "shared_interpreter"
+
+/*
+ * with a shared interpreter (always used without MULTIPLICITY), each script
+ * is loaded in its own package, deleted when the script is unloaded;
+ * otherwise each script has its own interpreter
+ */
+#ifdef MULTIPLICITY
+int perl_shared = 0;                    /* 1 if scripts share perl_main      */
+#else
+int perl_shared = 1;                    /* 1 if scripts share perl_main      */
+#endif /* MULTIPLICITY */
+
 #define PKG_NAME_PREFIX "WeechatPerlPackage"
 static PerlInterpreter *perl_main = NULL;
 int perl_num = 0;
+
+#ifdef MULTIPLICITY
+#define PERL_SCRIPT_INTERPRETER(__script)                               \
+    ((perl_shared) ?                                                    \
+     perl_main : (PerlInterpreter *)((__script)->interpreter))
 #endif /* MULTIPLICITY */
 
 char *perl_args[] = { "", "-e", "0", "-w", NULL };
@@ -91,9 +108,7 @@ int perl_args_count = 4;
 
 char *perl_weechat_code =
 {
-#ifndef MULTIPLICITY
     "package %s;"
-#endif /* MULTIPLICITY */
     "$SIG{__WARN__} = sub { weechat::print('', 'perl\twarning: '.$_[0]) };"
     "$SIG{__DIE__} = sub { weechat::print('', 'perl\terror: '.$_[0]) };"
     "do '%s';"
@@ -185,6 +200,109 @@ weechat_perl_hash_to_hashtable (SV *hash, int size, const char *type_keys,
     return hashtable;
 }
 
+/*
+ * Callback called to free a reference to a perl function.
+ */
+
+void
+weechat_perl_function_ref_free_cb (struct t_hashtable *hashtable,
+                                   const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    SvREFCNT_dec ((SV *)value);
+}
+
+/*
+ * Gets full name of a perl function: with a shared interpreter, the function
+ * is in the package of script.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+weechat_perl_function_name (struct t_plugin_script *script,
+                            const char *function)
+{
+    char *func;
+    int length;
+
+    if (!perl_shared || !script->interpreter)
+        return strdup (function);
+
+    length = strlen ((char *)script->interpreter) + strlen (function) + 3;
+    func = malloc (length);
+    if (!func)
+        return NULL;
+    snprintf (func, length, "%s::%s", (char *)script->interpreter, function);
+
+    return func;
+}
+
+/*
+ * Deletes the package of a script in the shared interpreter (all subs and
+ * variables of script are freed).
+ */
+
+void
+weechat_perl_delete_package (const char *package)
+{
+    char *perl_code;
+    int length;
+
+    length = strlen (package) + 64;
+    perl_code = malloc (length);
+    if (!perl_code)
+        return;
+    snprintf (perl_code, length,
+              "require Symbol; Symbol::delete_package('%s');", package);
+    eval_pv (perl_code, FALSE);
+    free (perl_code);
+}
+
+/*
+ * Gets glob of a perl function (the glob is cached in script, so that the
+ * function name is not searched again in symbol table on next calls).
+ *
+ * The glob is cached (and not the sub itself), so that a sub redefined by
+ * the script is used.
+ *
+ * Returns glob, NULL if not found.
+ */
+
+GV *
+weechat_perl_function_gv (struct t_plugin_script *script, const char *function)
+{
+    GV *gv;
+    char *func;
+
+    gv = (GV *)plugin_script_function_ref_get (weechat_perl_plugin,
+                                               script, function);
+    if (gv)
+        return gv;
+
+    func = weechat_perl_function_name (script, function);
+    if (!func)
+        return NULL;
+    gv = gv_fetchpv (func, 0, SVt_PVCV);
+    free (func);
+
+    if (!gv)
+        return NULL;
+
+    SvREFCNT_inc ((SV *)gv);
+    if (!plugin_script_function_ref_set (weechat_perl_plugin,
+                                         script, function, gv,
+                                         &weechat_perl_function_ref_free_cb))
+    {
+        SvREFCNT_dec ((SV *)gv);
+    }
+
+    return gv;
+}
+
 /*
  * Executes a perl function.
  */
@@ -197,9 +315,10 @@ weechat_perl_exec (struct t_plugin_script *script,
     char *func;
     unsigned int count;
     void *ret_value;
-    int *ret_i, mem_err, length, i, argc;
+    int *ret_i, mem_err, i, argc;
     SV *ret_s;
     HV *hash;
+    GV *gv;
     struct t_plugin_script *old_perl_current_script;
 #ifdef MULTIPLICITY
     void *old_context;
@@ -209,22 +328,27 @@ weechat_perl_exec (struct t_plugin_script *script,
     perl_current_script = script;
 
 #ifdef MULTIPLICITY
-    (void) length;
-    func = (char *) function;
     old_context = PERL_GET_CONTEXT;
-    if (script->interpreter)
-        PERL_SET_CONTEXT (script->interpreter);
-#else
-    length = strlen ((script->interpreter) ? script->interpreter : perl_main) +
-        strlen (function) + 3;
-    func = (char *) malloc (length);
-    if (!func)
-        return NULL;
-    snprintf (func, length, "%s::%s",
-              (char *) ((script->interpreter) ? script->interpreter : perl_main),
-              function);
+    if (PERL_SCRIPT_INTERPRETER(script))
+        PERL_SET_CONTEXT (PERL_SCRIPT_INTERPRETER(script));
 #endif /* MULTIPLICITY */
 
+    /* if the sub is found, call it directly, otherwise call it by name */
+    func = NULL;
+    gv = weechat_perl_function_gv (script, function);
+    if (!gv || !GvCV(gv))
+    {
+        func = weechat_perl_function_name (script, function);
+        if (!func)
+        {
+            perl_current_script = old_perl_current_script;
+#ifdef MULTIPLICITY
+            PERL_SET_CONTEXT (old_context);
+#endif /* MULTIPLICITY */
+            return NULL;
+        }
+    }
+
     dSP;
     ENTER;
     SAVETMPS;
@@ -251,7 +375,10 @@ weechat_perl_exec (struct t_plugin_script *script,
         }
     }
     PUTBACK;
-    count = call_pv (func, G_EVAL | G_SCALAR);
+    if (func)
+        count = call_pv (func, G_EVAL | G_SCALAR);
+    else
+        count = call_sv ((SV *)GvCV(gv), G_EVAL | G_SCALAR);
 
     ret_value = NULL;
     mem_err = 1;
@@ -319,9 +446,9 @@ weechat_perl_exec (struct t_plugin_script *script,
     perl_current_script = old_perl_current_script;
 #ifdef MULTIPLICITY
     PERL_SET_CONTEXT (old_context);
-#else
-    free (func);
 #endif /* MULTIPLICITY */
+    if (func)
+        free (func);
 
     if (!ret_value && (mem_err == 1))
     {
@@ -335,6 +462,26 @@ weechat_perl_exec (struct t_plugin_script *script,
     return ret_value;
 }
 
+/*
+ * Frees interpreter of a script which failed to load: with a shared
+ * interpreter, only the package of script is deleted.
+ */
+
+void
+weechat_perl_free_interpreter (const char *package)
+{
+    if (perl_shared)
+    {
+        weechat_perl_delete_package (package);
+        return;
+    }
+
+#ifdef MULTIPLICITY
+    perl_destruct (perl_current_interpreter);
+    perl_free (perl_current_interpreter);
+#endif /* MULTIPLICITY */
+}
+
 /*
  * Loads a perl script.
  *
@@ -348,11 +495,8 @@ weechat_perl_load (const char *filename)
 {
     struct t_plugin_script temp_script;
     struct stat buf;
-    char *perl_code;
+    char *perl_code, pkgname[64];
     int length;
-#ifndef MULTIPLICITY
-    char pkgname[64];
-#endif /* MULTIPLICITY */
 
     temp_script.filename = NULL;
     temp_script.interpreter = NULL;
@@ -383,37 +527,47 @@ weechat_perl_load (const char *filename)
     perl_current_script_filename = filename;
     perl_registered_script = NULL;
 
+    if (perl_shared)
+    {
+        /* load script in a new package of the shared interpreter */
 #ifdef MULTIPLICITY
-    perl_current_interpreter = perl_alloc();
+        PERL_SET_CONTEXT (perl_main);
+#endif /* MULTIPLICITY */
+        snprintf (pkgname, sizeof (pkgname), "%s%d", PKG_NAME_PREFIX, perl_num);
+        perl_num++;
+    }
+    else
+    {
+        snprintf (pkgname, sizeof (pkgname), "main");
+    }
 
-    if (!perl_current_interpreter)
+#ifdef MULTIPLICITY
+    if (!perl_shared)
     {
-        weechat_printf (NULL,
-                        weechat_gettext ("%s%s: unable to create new "
-                                         "sub-interpreter"),
-                        weechat_prefix ("error"), PERL_PLUGIN_NAME);
-        return 0;
+        perl_current_interpreter = perl_alloc();
+
+        if (!perl_current_interpreter)
+        {
+            weechat_printf (NULL,
+                            weechat_gettext ("%s%s: unable to create new "
+                                             "sub-interpreter"),
+                            weechat_prefix ("error"), PERL_PLUGIN_NAME);
+            return 0;
+        }
+
+        PERL_SET_CONTEXT (perl_current_interpreter);
+        perl_construct (perl_current_interpreter);
+        temp_script.interpreter = (PerlInterpreter *) perl_current_interpreter;
+        perl_parse (perl_current_interpreter, weechat_perl_api_init,
+                    perl_args_count, perl_args, NULL);
     }
+#endif /* MULTIPLICITY */
 
-    PERL_SET_CONTEXT (perl_current_interpreter);
-    perl_construct (perl_current_interpreter);
-    temp_script.interpreter = (PerlInterpreter *) perl_current_interpreter;
-    perl_parse (perl_current_interpreter, weechat_perl_api_init,
-                perl_args_count, perl_args, NULL);
-    length = strlen (perl_weechat_code) - 2 + strlen (filename) + 1;
-    perl_code = malloc (length);
-    if (!perl_code)
-        return 0;
-    snprintf (perl_code, length, perl_weechat_code, filename);
-#else
-    snprintf (pkgname, sizeof (pkgname), "%s%d", PKG_NAME_PREFIX, perl_num);
-    perl_num++;
     length = strlen (perl_weechat_code) - 4 + strlen (pkgname) + strlen (filename) + 1;
     perl_code = malloc (length);
     if (!perl_code)
         return 0;
     snprintf (perl_code, length, perl_weechat_code, pkgname, filename);
-#endif /* MULTIPLICITY */
     eval_pv (perl_code, TRUE);
     free (perl_code);
 
@@ -428,10 +582,6 @@ weechat_perl_load (const char *filename)
                         weechat_gettext ("%s%s: error: %s"),
                         weechat_prefix ("error"), PERL_PLUGIN_NAME,
                         SvPV_nolen(ERRSV));
-#ifdef MULTIPLICITY
-        perl_destruct (perl_current_interpreter);
-        perl_free (perl_current_interpreter);
-#endif /* MULTIPLICITY */
         if (perl_current_script && (perl_current_script != &temp_script))
         {
             plugin_script_remove (weechat_perl_plugin,
@@ -439,6 +589,7 @@ weechat_perl_load (const char *filename)
                                   perl_current_script);
             perl_current_script = NULL;
         }
+        weechat_perl_free_interpreter (pkgname);
 
         return 0;
     }
@@ -449,17 +600,13 @@ weechat_perl_load (const char *filename)
                         weechat_gettext ("%s%s: function \"register\" not "
                                          "found (or failed) in file \"%s\""),
                         weechat_prefix ("error"), PERL_PLUGIN_NAME, filename);
-#ifdef MULTIPLICITY
-        perl_destruct (perl_current_interpreter);
-        perl_free (perl_current_interpreter);
-#endif /* MULTIPLICITY */
+        weechat_perl_free_interpreter (pkgname);
         return 0;
     }
     perl_current_script = perl_registered_script;
 
-#ifndef MULTIPLICITY
-    perl_current_script->interpreter = strdup (pkgname);
-#endif /* MULTIPLICITY */
+    if (perl_shared)
+        perl_current_script->interpreter = strdup (pkgname);
 
     /*
      * set input/close callbacks for buffers created by this script
@@ -510,7 +657,7 @@ weechat_perl_unload (struct t_plugin_script *script)
     }
 
 #ifdef MULTIPLICITY
-    PERL_SET_CONTEXT (script->interpreter);
+    PERL_SET_CONTEXT (PERL_SCRIPT_INTERPRETER(script));
 #endif /* MULTIPLICITY */
 
     if (script->shutdown_func && script->shutdown_func[0])
@@ -535,19 +682,27 @@ weechat_perl_unload (struct t_plugin_script *script)
     plugin_script_remove (weechat_perl_plugin, &perl_scripts, &last_perl_script,
                           script);
 
-#ifdef MULTIPLICITY
-    if (interpreter)
+    if (perl_shared)
     {
-        perl_destruct (interpreter);
-        perl_free (interpreter);
+        if (interpreter)
+        {
+            weechat_perl_delete_package (interpreter);
+            free (interpreter);
+        }
     }
-    if (perl_current_script)
+#ifdef MULTIPLICITY
+    if (!perl_shared)
     {
-        PERL_SET_CONTEXT (perl_current_script->interpreter);
+        if (interpreter)
+        {
+            perl_destruct (interpreter);
+            perl_free (interpreter);
+        }
+        if (perl_current_script)
+        {
+            PERL_SET_CONTEXT (perl_current_script->interpreter);
+        }
     }
-#else
-    if (interpreter)
-        free (interpreter);
 #endif /* MULTIPLICITY */
 
     (void) weechat_hook_signal_send ("perl_script_unloaded",
@@ -965,6 +1120,9 @@ int
 weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 {
     struct t_plugin_script_init init;
+#ifdef MULTIPLICITY
+    const char *ptr_shared;
+#endif /* MULTIPLICITY */
 #ifdef PERL_SYS_INIT3
     int a;
     char **perl_args_local;
@@ -977,22 +1135,45 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_perl_plugin = plugin;
 
-#ifndef MULTIPLICITY
-    perl_main = perl_alloc ();
-
-    if (!perl_main)
+#ifdef MULTIPLICITY
+    /* interpreter mode is read once (used until the plugin is reloaded) */
+    ptr_shared = weechat_config_get_plugin (PERL_OPTION_SHARED_INTERPRETER);
+    if (!ptr_shared)
     {
-        weechat_printf (NULL,
-                        weechat_gettext ("%s%s: unable to initialize %s"),
-                        weechat_prefix ("error"), PERL_PLUGIN_NAME,
-                        PERL_PLUGIN_NAME);
-        return WEECHAT_RC_ERROR;
+        weechat_config_set_plugin (PERL_OPTION_SHARED_INTERPRETER, "off");
+        weechat_config_set_desc_plugin (
+            PERL_OPTION_SHARED_INTERPRETER,
+            "load all scripts in one perl interpreter (one package per "
+            "script) instead of one interpreter per script, to use less "
+            "memory and load scripts faster (the perl plugin must be "
+            "reloaded to apply a change)");
+        ptr_shared = weechat_config_get_plugin (PERL_OPTION_SHARED_INTERPRETER);
     }
+    perl_shared = (ptr_shared
+                   && (weechat_config_string_to_boolean (ptr_shared) > 0)) ?
+        1 : 0;
+#endif /* MULTIPLICITY */
+
+    if (perl_shared)
+    {
+        perl_main = perl_alloc ();
+
+        if (!perl_main)
+        {
+            weechat_printf (NULL,
+                            weechat_gettext ("%s%s: unable to initialize %s"),
+                            weechat_prefix ("error"), PERL_PLUGIN_NAME,
+                            PERL_PLUGIN_NAME);
+            return WEECHAT_RC_ERROR;
+        }
 
-    perl_construct (perl_main);
-    perl_parse (perl_main, weechat_perl_api_init, perl_args_count,
-                perl_args, NULL);
+#ifdef MULTIPLICITY
+        PERL_SET_CONTEXT (perl_main);
 #endif /* MULTIPLICITY */
+        perl_construct (perl_main);
+        perl_parse (perl_main, weechat_perl_api_init, perl_args_count,
+                    perl_args, NULL);
+    }
 
     init.callback_command = &weechat_perl_command_cb;
     init.callback_completion = &weechat_perl_completion_cb;
@@ -1031,15 +1212,16 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
     plugin_script_end (plugin, &perl_scripts, &weechat_perl_unload_all);
     perl_quiet = 0;
 
-#ifndef MULTIPLICITY
-    /* free perl interpreter */
+    /* free shared perl interpreter */
     if (perl_main)
     {
+#ifdef MULTIPLICITY
+        PERL_SET_CONTEXT (perl_main);
+#endif /* MULTIPLICITY */
         perl_destruct (perl_main);
         perl_free (perl_main);
         perl_main = NULL;
     }
-#endif /* MULTIPLICITY */
 
 #if defined(PERL_SYS_TERM) && !defined(__FreeBSD__) && !defined(WIN32) && !defined(__CYGWIN__) && !(defined(__APPLE__) && defined(__MACH__))
     /*
@@ -33,6 +33,7 @@ extern struct t_plugin_script *last_perl_script;
 extern struct t_plugin_script *perl_current_script;
 extern struct t_plugin_script *perl_registered_script;
 extern const char *perl_current_script_filename;
+extern int perl_shared;
 #ifdef MULTIPLICITY
 extern PerlInterpreter *perl_current_interpreter;
 #endif /* MULTIPLICITY */
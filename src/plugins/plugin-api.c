@@ -40,6 +40,7 @@
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-input.h"
+#include "../core/wee-metrics.h"
 #include "../core/wee-proxy.h"
 #include "../core/wee-string.h"
 #include "../core/wee-url.h"
@@ -59,6 +60,7 @@
 #include "../gui/gui-key.h"
 #include "../gui/gui-layout.h"
 #include "../gui/gui-line.h"
+#include "../gui/gui-line-cursor.h"
 #include "../gui/gui-nick.h"
 #include "../gui/gui-nicklist.h"
 #include "../gui/gui-window.h"
@@ -887,6 +889,71 @@ plugin_api_info_uptime_cb (const void *pointer, void *data,
     return NULL;
 }
 
+/*
+ * Returns WeeChat info "process_running" or "process_queued".
+ */
+
+const char *
+plugin_api_info_process_cb (const void *pointer, void *data,
+                            const char *info_name,
+                            const char *arguments)
+{
+    static char value[32];
+    struct t_weechat_plugin *ptr_plugin;
+    int queued, count;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    queued = (strcmp (info_name, "process_queued") == 0) ? 1 : 0;
+
+    if (!arguments || !arguments[0])
+    {
+        count = hook_process_count (NULL, 1, queued);
+    }
+    else
+    {
+        ptr_plugin = NULL;
+        if (strcmp (arguments, PLUGIN_CORE) != 0)
+        {
+            ptr_plugin = plugin_search (arguments);
+            if (!ptr_plugin)
+                return NULL;
+        }
+        count = hook_process_count (ptr_plugin, 0, queued);
+    }
+
+    snprintf (value, sizeof (value), "%d", count);
+    return value;
+}
+
+/*
+ * Returns WeeChat info "metrics".
+ *
+ * The string returned is kept until next call to this function.
+ */
+
+const char *
+plugin_api_info_metrics_cb (const void *pointer, void *data,
+                            const char *info_name,
+                            const char *arguments)
+{
+    static char *metrics = NULL;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) info_name;
+    (void) arguments;
+
+    if (metrics)
+        free (metrics);
+    metrics = metrics_build ();
+
+    return metrics;
+}
+
 /*
  * Returns WeeChat infolist "bar".
  *
@@ -1137,9 +1204,50 @@ plugin_api_infolist_buffer_cb (const void *pointer, void *data,
     return NULL;
 }
 
+/*
+ * Callback for streamed infolist "buffer_lines": builds item for the next or
+ * previous line.
+ *
+ * Returns:
+ *   1: item added
+ *   0: no more line (or error)
+ */
+
+int
+plugin_api_infolist_buffer_lines_stream_cb (void *stream_data,
+                                            struct t_infolist *infolist,
+                                            int direction)
+{
+    struct t_gui_line_cursor *ptr_cursor;
+    struct t_gui_lines *ptr_lines;
+    struct t_gui_line *ptr_line;
+
+    ptr_cursor = (struct t_gui_line_cursor *)stream_data;
+
+    ptr_lines = ptr_cursor->lines;
+    ptr_line = gui_line_cursor_move (ptr_cursor, direction);
+    if (!ptr_line)
+        return 0;
+
+    return gui_line_add_to_infolist (infolist, ptr_lines, ptr_line);
+}
+
+/*
+ * Callback to free data of streamed infolist "buffer_lines".
+ */
+
+void
+plugin_api_infolist_buffer_lines_stream_free_cb (void *stream_data)
+{
+    gui_line_cursor_free ((struct t_gui_line_cursor *)stream_data);
+}
+
 /*
  * Returns WeeChat infolist "buffer_lines".
  *
+ * Lines are not all copied in the infolist: the infolist is streamed, an
+ * item is built for each line when the caller moves in the infolist.
+ *
  * Note: result must be freed after use with function weechat_infolist_free().
  */
 
@@ -1149,7 +1257,7 @@ plugin_api_infolist_buffer_lines_cb (const void *pointer, void *data,
                                      void *obj_pointer, const char *arguments)
 {
     struct t_infolist *ptr_infolist;
-    struct t_gui_line *ptr_line;
+    struct t_gui_line_cursor *ptr_cursor;
 
     /* make C compiler happy */
     (void) pointer;
@@ -1166,21 +1274,69 @@ plugin_api_infolist_buffer_lines_cb (const void *pointer, void *data,
             return NULL;
     }
 
+    ptr_cursor = gui_line_cursor_new (
+        ((struct t_gui_buffer *)obj_pointer)->own_lines);
+    if (!ptr_cursor)
+        return NULL;
+
+    ptr_infolist = infolist_new (NULL);
+    if (!ptr_infolist)
+    {
+        gui_line_cursor_free (ptr_cursor);
+        return NULL;
+    }
+
+    infolist_set_stream (ptr_infolist,
+                         &plugin_api_infolist_buffer_lines_stream_cb,
+                         &plugin_api_infolist_buffer_lines_stream_free_cb,
+                         ptr_cursor);
+
+    return ptr_infolist;
+}
+
+/*
+ * Returns WeeChat infolist "buffer_memory".
+ *
+ * Note: result must be freed after use with function weechat_infolist_free().
+ */
+
+struct t_infolist *
+plugin_api_infolist_buffer_memory_cb (const void *pointer, void *data,
+                                      const char *infolist_name,
+                                      void *obj_pointer, const char *arguments)
+{
+    struct t_infolist *ptr_infolist;
+    struct t_gui_buffer *ptr_buffer;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) infolist_name;
+
+    /* invalid buffer pointer ? */
+    if (obj_pointer && (!gui_buffer_valid (obj_pointer)))
+        return NULL;
+
     ptr_infolist = infolist_new (NULL);
     if (!ptr_infolist)
         return NULL;
 
-    for (ptr_line = ((struct t_gui_buffer *)obj_pointer)->own_lines->first_line;
-         ptr_line; ptr_line = ptr_line->next_line)
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
     {
-        if (!gui_line_add_to_infolist (ptr_infolist,
-                                       ((struct t_gui_buffer *)obj_pointer)->own_lines,
-                                       ptr_line))
+        if ((obj_pointer && (ptr_buffer != obj_pointer))
+            || (!obj_pointer && arguments && arguments[0]
+                && !string_match (ptr_buffer->full_name, arguments, 0)))
+        {
+            continue;
+        }
+        if (!gui_buffer_memory_add_to_infolist (ptr_infolist, ptr_buffer))
         {
             infolist_free (ptr_infolist);
             return NULL;
         }
     }
+
     return ptr_infolist;
 }
 
@@ -1973,6 +2129,23 @@ plugin_api_init ()
                N_("\"days\" (number of days) or \"seconds\" (number of "
                   "seconds) (optional)"),
                &plugin_api_info_uptime_cb, NULL, NULL);
+    hook_info (NULL, "process_running",
+               N_("number of processes running (hook_process)"),
+               N_("plugin name (\"core\" for WeeChat core) (optional, all "
+                  "plugins if not set)"),
+               &plugin_api_info_process_cb, NULL, NULL);
+    hook_info (NULL, "process_queued",
+               N_("number of processes waiting in queue (hook_process), "
+                  "see option weechat.plugin.process_max_running"),
+               N_("plugin name (\"core\" for WeeChat core) (optional, all "
+                  "plugins if not set)"),
+               &plugin_api_info_process_cb, NULL, NULL);
+    hook_info (NULL, "metrics",
+               N_("metrics of WeeChat core in Prometheus text format "
+                  "(main loop, hook callbacks, lines added in buffers, "
+                  "memory)"),
+               NULL,
+               &plugin_api_info_metrics_cb, NULL, NULL);
 
     /* WeeChat core infolist hooks */
     hook_infolist (NULL, "bar",
@@ -2000,6 +2173,11 @@ plugin_api_init ()
                    N_("buffer pointer"),
                    NULL,
                    &plugin_api_infolist_buffer_lines_cb, NULL, NULL);
+    hook_infolist (NULL, "buffer_memory",
+                   N_("memory used by buffers (lines and nicklist)"),
+                   N_("buffer pointer (optional)"),
+                   N_("buffer name (wildcard \"*\" is allowed) (optional)"),
+                   &plugin_api_infolist_buffer_memory_cb, NULL, NULL);
     hook_infolist (NULL, "filter",
                    N_("list of filters"),
                    NULL,
@@ -2086,6 +2264,8 @@ plugin_api_init ()
                 &config_file_hdata_config_option_cb, NULL, NULL);
     hook_hdata (NULL, "filter", N_("filter"),
                 &gui_filter_hdata_filter_cb, NULL, NULL);
+    hook_hdata (NULL, "hook", N_("hook"),
+                &hook_hdata_hook_cb, NULL, NULL);
     hook_hdata (NULL, "history", N_("history of commands in buffer"),
                 &gui_history_hdata_history_cb, NULL, NULL);
     hook_hdata (NULL, "hotlist", N_("hotlist"),
@@ -307,6 +307,31 @@ plugin_script_api_printf_date_tags (struct t_weechat_plugin *weechat_plugin,
     free (vbuffer);
 }
 
+/*
+ * Prints lines (separated by "\n") on a buffer, in a batch of lines.
+ */
+
+void
+plugin_script_api_print_lines (struct t_weechat_plugin *weechat_plugin,
+                               struct t_plugin_script *script,
+                               struct t_gui_buffer *buffer,
+                               time_t date, const char *tags,
+                               const char *lines)
+{
+    char *buf2;
+    const char *ptr_lines;
+
+    if (!lines)
+        return;
+
+    buf2 = (script->charset && script->charset[0]) ?
+        weechat_iconv_to_internal (script->charset, lines) : NULL;
+    ptr_lines = (buf2) ? buf2 : lines;
+    weechat_print_lines (buffer, date, tags, &ptr_lines, 1);
+    if (buf2)
+        free (buf2);
+}
+
 /*
  * Prints a message on a buffer with free content.
  */
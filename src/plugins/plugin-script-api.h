@@ -111,6 +111,11 @@ extern void plugin_script_api_printf_date_tags (struct t_weechat_plugin *weechat
                                                 struct t_gui_buffer *buffer,
                                                 time_t date, const char *tags,
                                                 const char *format, ...);
+extern void plugin_script_api_print_lines (struct t_weechat_plugin *weechat_plugin,
+                                           struct t_plugin_script *script,
+                                           struct t_gui_buffer *buffer,
+                                           time_t date, const char *tags,
+                                           const char *lines);
 extern void plugin_script_api_printf_y (struct t_weechat_plugin *weechat_plugin,
                                         struct t_plugin_script *script,
                                         struct t_gui_buffer *buffer,
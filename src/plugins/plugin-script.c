@@ -395,6 +395,91 @@ plugin_script_get_function_and_data (void *callback_data,
     }
 }
 
+/*
+ * Searches a reference to a function of a script, cached by the language
+ * plugin with function plugin_script_function_ref_set.
+ *
+ * Returns pointer to reference, NULL if not found.
+ */
+
+void *
+plugin_script_function_ref_get (struct t_weechat_plugin *weechat_plugin,
+                                struct t_plugin_script *script,
+                                const char *function)
+{
+    if (!script || !script->function_refs || !function)
+        return NULL;
+
+    return weechat_hashtable_get (script->function_refs, function);
+}
+
+/*
+ * Caches a reference to a function of a script (for example an object of
+ * the language which is faster to call than a lookup by name).
+ *
+ * The callback "callback_free_ref" (can be NULL) is called to free the
+ * reference when the script is removed (the interpreter of script is still
+ * valid at this time).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (then the reference must be freed by the caller)
+ */
+
+int
+plugin_script_function_ref_set (struct t_weechat_plugin *weechat_plugin,
+                                struct t_plugin_script *script,
+                                const char *function,
+                                void *ref,
+                                void (*callback_free_ref)(struct t_hashtable *hashtable,
+                                                          const void *key,
+                                                          void *value))
+{
+    if (!script || !function || !ref)
+        return 0;
+
+    if (!script->function_refs)
+    {
+        script->function_refs = weechat_hashtable_new (32,
+                                                       WEECHAT_HASHTABLE_STRING,
+                                                       WEECHAT_HASHTABLE_POINTER,
+                                                       NULL, NULL);
+        if (!script->function_refs)
+            return 0;
+        if (callback_free_ref)
+        {
+            weechat_hashtable_set_pointer (script->function_refs,
+                                           "callback_free_value",
+                                           callback_free_ref);
+        }
+    }
+
+    return (weechat_hashtable_set (script->function_refs,
+                                   function, ref)) ? 1 : 0;
+}
+
+/*
+ * Gets max time for a callback of a script (in milliseconds), after which
+ * the callback must be interrupted (option
+ * weechat.plugin.script_callback_timeout).
+ *
+ * Returns 0 if there is no limit.
+ */
+
+int
+plugin_script_callback_timeout (struct t_weechat_plugin *weechat_plugin)
+{
+    static struct t_config_option *ptr_option = NULL;
+
+    if (!ptr_option)
+    {
+        ptr_option = weechat_config_get (
+            "weechat.plugin.script_callback_timeout");
+    }
+
+    return (ptr_option) ? weechat_config_integer (ptr_option) : 0;
+}
+
 /*
  * Auto-loads all scripts in a directory.
  */
@@ -668,6 +753,7 @@ plugin_script_add (struct t_weechat_plugin *weechat_plugin,
         new_script->shutdown_func = (shutdown_func) ?
             strdup (shutdown_func) : NULL;
         new_script->charset = (charset) ? strdup (charset) : NULL;
+        new_script->function_refs = NULL;
         new_script->unloading = 0;
 
         plugin_script_insert_sorted (weechat_plugin, scripts, last_script,
@@ -930,6 +1016,10 @@ plugin_script_remove (struct t_weechat_plugin *weechat_plugin,
     /* remove all hooks created by this script */
     weechat_unhook_all (script->name);
 
+    /* free references to functions (interpreter is still valid) */
+    if (script->function_refs)
+        weechat_hashtable_free (script->function_refs);
+
     /* free data */
     if (script->filename)
         free (script->filename);
@@ -1692,6 +1782,7 @@ plugin_script_print_log (struct t_weechat_plugin *weechat_plugin,
         weechat_log_printf ("  description . . . . : '%s'",  ptr_script->description);
         weechat_log_printf ("  shutdown_func . . . : '%s'",  ptr_script->shutdown_func);
         weechat_log_printf ("  charset . . . . . . : '%s'",  ptr_script->charset);
+        weechat_log_printf ("  function_refs . . . : 0x%lx", ptr_script->function_refs);
         weechat_log_printf ("  unloading . . . . . : %d",    ptr_script->unloading);
         weechat_log_printf ("  prev_script . . . . : 0x%lx", ptr_script->prev_script);
         weechat_log_printf ("  next_script . . . . : 0x%lx", ptr_script->next_script);
@@ -61,6 +61,8 @@ struct t_plugin_script
     char *description;                   /* plugin description              */
     char *shutdown_func;                 /* function when script is unloaded*/
     char *charset;                       /* script charset                  */
+    struct t_hashtable *function_refs;   /* refs to functions, cached by    */
+                                         /* the language plugin (by name)   */
     int unloading;                       /* script is being unloaded        */
     struct t_plugin_script *prev_script; /* link to previous script         */
     struct t_plugin_script *next_script; /* link to next script             */
@@ -113,6 +115,17 @@ extern char *plugin_script_build_function_and_data (const char *function,
 extern void plugin_script_get_function_and_data (void *callback_data,
                                                  const char **function,
                                                  const char **data);
+extern void *plugin_script_function_ref_get (struct t_weechat_plugin *weechat_plugin,
+                                             struct t_plugin_script *script,
+                                             const char *function);
+extern int plugin_script_function_ref_set (struct t_weechat_plugin *weechat_plugin,
+                                           struct t_plugin_script *script,
+                                           const char *function,
+                                           void *ref,
+                                           void (*callback_free_ref)(struct t_hashtable *hashtable,
+                                                                     const void *key,
+                                                                     void *value));
+extern int plugin_script_callback_timeout (struct t_weechat_plugin *weechat_plugin);
 extern void plugin_script_auto_load (struct t_weechat_plugin *weechat_plugin,
                                      void (*callback)(void *data,
                                                       const char *filename));
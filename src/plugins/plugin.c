@@ -34,15 +34,20 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <dlfcn.h>
+#include <sys/time.h>
 
 #include "../core/weechat.h"
 #include "../core/wee-arraylist.h"
+#include "../core/wee-async.h"
 #include "../core/wee-config.h"
+#include "../core/wee-debug.h"
 #include "../core/wee-eval.h"
 #include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
+#include "../core/wee-input.h"
+#include "../core/wee-latency.h"
 #include "../core/wee-list.h"
 #include "../core/wee-log.h"
 #include "../core/wee-network.h"
@@ -78,8 +83,18 @@ int plugin_autoload_count = 0;         /* number of items in autoload_array */
 char **plugin_autoload_array = NULL;   /* autoload array, this is split of  */
                                        /* option "weechat.plugin.autoload"  */
 
+int plugin_lazy_count = 0;             /* number of items in lazy_array     */
+char **plugin_lazy_array = NULL;       /* lazy array, this is split of      */
+                                       /* option "weechat.plugin.lazy_load" */
+struct t_plugin_lazy *plugin_lazy_plugins = NULL; /* plugins loaded on      */
+struct t_plugin_lazy *last_plugin_lazy = NULL;    /* first use              */
+int plugin_lazy_argc = 0;              /* arguments given to plugins loaded */
+char **plugin_lazy_argv = NULL;        /* on first use                      */
+
 
 void plugin_remove (struct t_weechat_plugin *plugin);
+struct t_plugin_lazy *plugin_lazy_search (const char *name);
+void plugin_lazy_free (struct t_plugin_lazy *lazy);
 
 
 /*
@@ -184,43 +199,35 @@ plugin_check_extension_allowed (const char *filename)
 }
 
 /*
- * Checks if a plugin can be autoloaded.
+ * Gets short name of plugin with a filename (filename without path and
+ * extension).
  *
- * List of autoloaded plugins is set in option "weechat.plugin.autoload".
- *
- * Returns:
- *   1: plugin can be autoloaded
- *   0: plugin can not be autoloaded
+ * Note: result must be freed after use.
  */
 
-int
-plugin_check_autoload (const char *filename)
+char *
+plugin_get_name_from_filename (const char *filename)
 {
-    int i, plugin_authorized, plugin_blacklisted, length, length_ext;
+    int i, length, length_ext;
     char *full_name, *ptr_base_name, *base_name, *plugin_name;
 
-    /* by default we can auto load all plugins */
-    if (!plugin_autoload_array)
-        return 1;
-
     full_name = strdup (filename);
     if (!full_name)
-        return 0;
+        return NULL;
 
-    /* get short name of plugin (filename without extension) */
     plugin_name = NULL;
     ptr_base_name = basename (full_name);
     if (!ptr_base_name)
     {
         free (full_name);
-        return 1;
+        return NULL;
     }
 
     base_name = strdup (ptr_base_name);
     if (!base_name)
     {
         free (full_name);
-        return 1;
+        return NULL;
     }
 
     free (full_name);
@@ -249,6 +256,31 @@ plugin_check_autoload (const char *filename)
 
     free (base_name);
 
+    return plugin_name;
+}
+
+/*
+ * Checks if a plugin can be autoloaded.
+ *
+ * List of autoloaded plugins is set in option "weechat.plugin.autoload".
+ *
+ * Returns:
+ *   1: plugin can be autoloaded
+ *   0: plugin can not be autoloaded
+ */
+
+int
+plugin_check_autoload (const char *filename)
+{
+    int i, plugin_authorized, plugin_blacklisted;
+    char *plugin_name;
+
+    /* by default we can auto load all plugins */
+    if (!plugin_autoload_array)
+        return 1;
+
+    /* get short name of plugin (filename without extension) */
+    plugin_name = plugin_get_name_from_filename (filename);
     if (!plugin_name)
         return 1;
 
@@ -344,7 +376,8 @@ plugin_call_init (struct t_weechat_plugin *plugin, int argc, char **argv)
 {
     t_weechat_init_func *init_func;
     int plugin_argc, rc;
-    char **plugin_argv;
+    char **plugin_argv, str_phase[256];
+    struct timeval time_start;
 
     if (plugin->initialized)
         return 1;
@@ -365,8 +398,11 @@ plugin_call_init (struct t_weechat_plugin *plugin, int argc, char **argv)
                          plugin->name,
                          plugin->priority);
     }
+    gettimeofday (&time_start, NULL);
     rc = ((t_weechat_init_func *)init_func) (plugin,
                                              plugin_argc, plugin_argv);
+    snprintf (str_phase, sizeof (str_phase), "%s: init", plugin->name);
+    debug_startup_time (str_phase, 1, &time_start);
     if (rc == WEECHAT_RC_OK)
     {
         plugin->initialized = 1;
@@ -400,11 +436,12 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
 {
     void *handle;
     char *name, *api_version, *author, *description, *version;
-    char *license, *charset;
+    char *license, *charset, str_phase[256];
     t_weechat_init_func *init_func;
     int *priority;
     struct t_weechat_plugin *new_plugin;
     struct t_config_option *ptr_option;
+    struct timeval time_start;
 
     if (!filename)
         return NULL;
@@ -417,6 +454,8 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
     if (plugin_autoload_array && !plugin_check_autoload (filename))
         return NULL;
 
+    gettimeofday (&time_start, NULL);
+
     handle = dlopen (filename, RTLD_GLOBAL | RTLD_NOW);
     if (!handle)
     {
@@ -621,12 +660,16 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->string_mask_to_regex = &string_mask_to_regex;
         new_plugin->string_regex_flags = &string_regex_flags;
         new_plugin->string_regcomp = &string_regcomp;
+        new_plugin->string_regexec = &string_regexec;
+        new_plugin->string_regfree = &string_regfree;
         new_plugin->string_has_highlight = &string_has_highlight;
         new_plugin->string_has_highlight_regex = &string_has_highlight_regex;
         new_plugin->string_replace_regex = &string_replace_regex;
         new_plugin->string_split = &string_split;
         new_plugin->string_split_shell = &string_split_shell;
+        new_plugin->string_split_argv = &string_split_argv;
         new_plugin->string_free_split = &string_free_split;
+        new_plugin->string_free_split_argv = &string_free_split_argv;
         new_plugin->string_build_with_split_string = &string_build_with_split_string;
         new_plugin->string_split_command = &string_split_command;
         new_plugin->string_free_split_command = &string_free_split_command;
@@ -638,6 +681,8 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->string_is_command_char = &string_is_command_char;
         new_plugin->string_input_for_buffer = &string_input_for_buffer;
         new_plugin->string_eval_expression = &eval_expression;
+        new_plugin->string_shared_get = &string_shared_get;
+        new_plugin->string_shared_free = &string_shared_free;
 
         new_plugin->utf8_has_8bits = &utf8_has_8bits;
         new_plugin->utf8_is_valid = &utf8_is_valid;
@@ -668,6 +713,9 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->util_timeval_add = &util_timeval_add;
         new_plugin->util_get_time_string = &util_get_time_string;
         new_plugin->util_version_number = &util_version_number;
+        new_plugin->latency_message_set = &latency_message_set;
+        new_plugin->latency_message_get = &latency_message_get;
+        new_plugin->latency_add = &latency_add;
 
         new_plugin->list_new = &weelist_new;
         new_plugin->list_add = &weelist_add;
@@ -728,6 +776,8 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->config_write_option = &config_file_write_option;
         new_plugin->config_write_line = &config_file_write_line;
         new_plugin->config_write = &config_file_write;
+        new_plugin->config_set_dirty = &config_file_set_dirty;
+        new_plugin->config_is_dirty = &config_file_is_dirty;
         new_plugin->config_read = &config_file_read;
         new_plugin->config_reload = &config_file_reload;
         new_plugin->config_option_free = &config_file_option_free;
@@ -747,6 +797,7 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->prefix = &plugin_api_prefix;
         new_plugin->color = &plugin_api_color;
         new_plugin->printf_date_tags = &gui_chat_printf_date_tags;
+        new_plugin->print_lines = &gui_chat_print_lines;
         new_plugin->printf_y = &gui_chat_printf_y;
         new_plugin->log_printf = &log_printf;
 
@@ -768,6 +819,7 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->hook_completion_list_add = &hook_completion_list_add;
         new_plugin->hook_modifier = &hook_modifier;
         new_plugin->hook_modifier_exec = &hook_modifier_exec;
+        new_plugin->hook_modifier_exists = &hook_modifier_exists;
         new_plugin->hook_info = &hook_info;
         new_plugin->hook_info_hashtable = &hook_info_hashtable;
         new_plugin->hook_infolist = &hook_infolist;
@@ -776,6 +828,7 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->hook_set = &hook_set;
         new_plugin->unhook = &unhook;
         new_plugin->unhook_all = &unhook_all_plugin;
+        new_plugin->async_post = &async_post;
 
         new_plugin->buffer_new = &gui_buffer_new;
         new_plugin->buffer_search = &gui_buffer_search_by_name;
@@ -787,6 +840,10 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->buffer_get_integer = &gui_buffer_get_integer;
         new_plugin->buffer_get_string = &gui_buffer_get_string;
         new_plugin->buffer_get_pointer = &gui_buffer_get_pointer;
+        new_plugin->buffer_search_property = &gui_buffer_search_property;
+        new_plugin->buffer_get_integer_id = &gui_buffer_get_integer_id;
+        new_plugin->buffer_get_string_id = &gui_buffer_get_string_id;
+        new_plugin->buffer_get_pointer_id = &gui_buffer_get_pointer_id;
         new_plugin->buffer_set = &gui_buffer_set;
         new_plugin->buffer_set_pointer = &gui_buffer_set_pointer;
         new_plugin->buffer_string_replace_local_var = &gui_buffer_string_replace_local_var;
@@ -856,6 +913,7 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->hdata_new = &hdata_new;
         new_plugin->hdata_new_var = &hdata_new_var;
         new_plugin->hdata_new_list = &hdata_new_list;
+        new_plugin->hdata_new_index = &hdata_new_index;
         new_plugin->hdata_get = &hook_hdata_get;
         new_plugin->hdata_get_var_offset = &hdata_get_var_offset;
         new_plugin->hdata_get_var_type = &hdata_get_var_type;
@@ -876,6 +934,19 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
         new_plugin->hdata_pointer = &hdata_pointer;
         new_plugin->hdata_time = &hdata_time;
         new_plugin->hdata_hashtable = &hdata_hashtable;
+        new_plugin->hdata_fetch = &hdata_fetch;
+        new_plugin->hdata_field_new = &hdata_field_new;
+        new_plugin->hdata_field_type = &hdata_field_type;
+        new_plugin->hdata_field_array_size = &hdata_field_array_size;
+        new_plugin->hdata_field_char = &hdata_field_char;
+        new_plugin->hdata_field_integer = &hdata_field_integer;
+        new_plugin->hdata_field_long = &hdata_field_long;
+        new_plugin->hdata_field_string = &hdata_field_string;
+        new_plugin->hdata_field_pointer = &hdata_field_pointer;
+        new_plugin->hdata_field_time = &hdata_field_time;
+        new_plugin->hdata_field_hashtable = &hdata_field_hashtable;
+        new_plugin->hdata_field_read = &hdata_field_read;
+        new_plugin->hdata_field_free = &hdata_field_free;
         new_plugin->hdata_set = &hdata_set;
         new_plugin->hdata_update = &hdata_update;
         new_plugin->hdata_get_string = &hdata_get_string;
@@ -900,6 +971,12 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
          */
         gui_buffer_set_plugin_for_upgrade (name, new_plugin);
 
+        /* plugin is loaded now, it is not loaded on first use any more */
+        plugin_lazy_free (plugin_lazy_search (name));
+
+        snprintf (str_phase, sizeof (str_phase), "%s: load", name);
+        debug_startup_time (str_phase, 1, &time_start);
+
         if (init_plugin)
         {
             if (!plugin_call_init (new_plugin, argc, argv))
@@ -933,6 +1010,325 @@ plugin_load (const char *filename, int init_plugin, int argc, char **argv)
     return new_plugin;
 }
 
+/*
+ * Searches for a plugin loaded on first use, by name.
+ *
+ * Returns pointer to lazy plugin found, NULL if not found.
+ */
+
+struct t_plugin_lazy *
+plugin_lazy_search (const char *name)
+{
+    struct t_plugin_lazy *ptr_lazy;
+
+    if (!name)
+        return NULL;
+
+    for (ptr_lazy = plugin_lazy_plugins; ptr_lazy;
+         ptr_lazy = ptr_lazy->next_lazy)
+    {
+        if (string_strcasecmp (ptr_lazy->name, name) == 0)
+            return ptr_lazy;
+    }
+
+    /* lazy plugin not found */
+    return NULL;
+}
+
+/*
+ * Checks if a name (of command, info, infolist, signal or bar item) belongs
+ * to a plugin loaded on first use: the name must be the plugin name, or begin
+ * with plugin name followed by an underscore.
+ *
+ * Returns:
+ *   1: name belongs to the plugin
+ *   0: name does not belong to the plugin
+ */
+
+int
+plugin_lazy_match (struct t_plugin_lazy *lazy, const char *name)
+{
+    int length;
+
+    length = strlen (lazy->name);
+
+    return ((string_strncasecmp (name, lazy->name, length) == 0)
+            && (!name[length] || (name[length] == '_'))) ? 1 : 0;
+}
+
+/*
+ * Loads a plugin which was waiting for its first use.
+ *
+ * Note: the lazy plugin is freed by this function.
+ *
+ * Returns pointer to plugin loaded, NULL if error.
+ */
+
+struct t_weechat_plugin *
+plugin_lazy_load (struct t_plugin_lazy *lazy)
+{
+    struct t_weechat_plugin *ptr_plugin;
+    char *filename;
+
+    filename = strdup (lazy->filename);
+
+    plugin_lazy_free (lazy);
+
+    if (!filename)
+        return NULL;
+
+    ptr_plugin = plugin_load (filename, 1, plugin_lazy_argc, plugin_lazy_argv);
+
+    free (filename);
+
+    return ptr_plugin;
+}
+
+/*
+ * Callback for the command of a plugin loaded on first use: loads the plugin
+ * and executes the command again (now handled by the plugin).
+ */
+
+int
+plugin_lazy_command_cb (const void *pointer, void *data,
+                        struct t_gui_buffer *buffer,
+                        int argc, char **argv, char **argv_eol)
+{
+    char *command;
+    int rc;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) argc;
+    (void) argv;
+
+    command = strdup (argv_eol[0]);
+    if (!command)
+        return WEECHAT_RC_ERROR;
+
+    rc = WEECHAT_RC_ERROR;
+    if (plugin_lazy_load ((struct t_plugin_lazy *)pointer))
+        rc = input_exec_command (buffer, 1, NULL, command);
+
+    free (command);
+
+    return rc;
+}
+
+/*
+ * Callback for timer used to load a plugin on first use of one of its bar
+ * items (the plugin is not loaded while the bars are drawn).
+ */
+
+int
+plugin_lazy_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    struct t_plugin_lazy *ptr_lazy;
+    struct t_gui_bar *ptr_bar;
+    char *name;
+    int i, j, length;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    ptr_lazy = (struct t_plugin_lazy *)pointer;
+
+    /* timer is removed after this call */
+    ptr_lazy->hook_timer = NULL;
+
+    name = strdup (ptr_lazy->name);
+    if (!name)
+        return WEECHAT_RC_ERROR;
+
+    if (plugin_lazy_load (ptr_lazy))
+    {
+        /* update bar items of plugin displayed in bars */
+        length = strlen (name);
+        for (ptr_bar = gui_bars; ptr_bar; ptr_bar = ptr_bar->next_bar)
+        {
+            for (i = 0; i < ptr_bar->items_count; i++)
+            {
+                for (j = 0; j < ptr_bar->items_subcount[i]; j++)
+                {
+                    if (ptr_bar->items_name[i][j]
+                        && (strncmp (ptr_bar->items_name[i][j], name,
+                                     length) == 0))
+                    {
+                        gui_bar_item_update (ptr_bar->items_name[i][j]);
+                    }
+                }
+            }
+        }
+    }
+
+    free (name);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Loads a plugin on first use of a name (of command, info, infolist, signal
+ * or bar item) which belongs to the plugin.
+ *
+ * If delayed == 1, the plugin is loaded a bit later, in a timer (this is used
+ * for bar items, which are searched when bars are drawn).
+ *
+ * Returns:
+ *   1: a plugin is loaded (or will be loaded if delayed == 1)
+ *   0: no plugin loaded
+ */
+
+int
+plugin_lazy_load_name (const char *name, int delayed)
+{
+    struct t_plugin_lazy *ptr_lazy;
+
+    if (!plugin_lazy_plugins || !name || !name[0])
+        return 0;
+
+    for (ptr_lazy = plugin_lazy_plugins; ptr_lazy;
+         ptr_lazy = ptr_lazy->next_lazy)
+    {
+        if (plugin_lazy_match (ptr_lazy, name))
+        {
+            if (delayed)
+            {
+                if (!ptr_lazy->hook_timer)
+                {
+                    ptr_lazy->hook_timer = hook_timer (
+                        NULL, 1, 0, 1,
+                        &plugin_lazy_timer_cb, ptr_lazy, NULL);
+                }
+                return 1;
+            }
+            return (plugin_lazy_load (ptr_lazy)) ? 1 : 0;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Adds a plugin to load on first use, if its name is in option
+ * "weechat.plugin.lazy_load" (a command with the name of plugin is created,
+ * it loads the plugin when it is used).
+ *
+ * Returns:
+ *   1: plugin will be loaded on first use (or is already waiting for it)
+ *   0: plugin must be loaded now
+ */
+
+int
+plugin_lazy_add (const char *filename)
+{
+    struct t_plugin_lazy *new_lazy;
+    char *plugin_name;
+    int i, lazy;
+
+    if (!plugin_lazy_array)
+        return 0;
+
+    plugin_name = plugin_get_name_from_filename (filename);
+    if (!plugin_name)
+        return 0;
+
+    lazy = 0;
+    for (i = 0; i < plugin_lazy_count; i++)
+    {
+        if (string_match (plugin_name, plugin_lazy_array[i], 0))
+        {
+            lazy = 1;
+            break;
+        }
+    }
+
+    if (!lazy || plugin_search (plugin_name))
+    {
+        free (plugin_name);
+        return 0;
+    }
+
+    if (plugin_lazy_search (plugin_name))
+    {
+        free (plugin_name);
+        return 1;
+    }
+
+    new_lazy = malloc (sizeof (*new_lazy));
+    if (!new_lazy)
+    {
+        free (plugin_name);
+        return 0;
+    }
+
+    new_lazy->name = plugin_name;
+    new_lazy->filename = strdup (filename);
+    new_lazy->hook_timer = NULL;
+    new_lazy->hook_command = hook_command (
+        NULL, plugin_name,
+        N_("load the plugin with same name (loaded on first use, see "
+           "/help weechat.plugin.lazy_load), then run its command"),
+        NULL, NULL, NULL,
+        &plugin_lazy_command_cb, new_lazy, NULL);
+
+    new_lazy->prev_lazy = last_plugin_lazy;
+    new_lazy->next_lazy = NULL;
+    if (plugin_lazy_plugins)
+        last_plugin_lazy->next_lazy = new_lazy;
+    else
+        plugin_lazy_plugins = new_lazy;
+    last_plugin_lazy = new_lazy;
+
+    return 1;
+}
+
+/*
+ * Frees a plugin waiting for its first use.
+ */
+
+void
+plugin_lazy_free (struct t_plugin_lazy *lazy)
+{
+    if (!lazy)
+        return;
+
+    /* remove lazy plugin from list */
+    if (last_plugin_lazy == lazy)
+        last_plugin_lazy = lazy->prev_lazy;
+    if (lazy->prev_lazy)
+        (lazy->prev_lazy)->next_lazy = lazy->next_lazy;
+    else
+        plugin_lazy_plugins = lazy->next_lazy;
+    if (lazy->next_lazy)
+        (lazy->next_lazy)->prev_lazy = lazy->prev_lazy;
+
+    /* free data */
+    if (lazy->hook_command)
+        unhook (lazy->hook_command);
+    if (lazy->hook_timer)
+        unhook (lazy->hook_timer);
+    if (lazy->name)
+        free (lazy->name);
+    if (lazy->filename)
+        free (lazy->filename);
+
+    free (lazy);
+}
+
+/*
+ * Frees all plugins waiting for their first use.
+ */
+
+void
+plugin_lazy_free_all ()
+{
+    while (plugin_lazy_plugins)
+    {
+        plugin_lazy_free (plugin_lazy_plugins);
+    }
+}
+
 /*
  * Loads a file found by function plugin_auto_load, but only if this is really a
  * dynamic library.
@@ -945,8 +1341,18 @@ plugin_auto_load_file (void *data, const char *filename)
 
     plugin_args = (struct t_plugin_args *)data;
 
-    if (plugin_check_extension_allowed (filename))
-        plugin_load (filename, 0, plugin_args->argc, plugin_args->argv);
+    if (!plugin_check_extension_allowed (filename))
+        return;
+
+    /* plugin loaded on first use? */
+    if (plugin_lazy_array
+        && (!plugin_autoload_array || plugin_check_autoload (filename))
+        && plugin_lazy_add (filename))
+    {
+        return;
+    }
+
+    plugin_load (filename, 0, plugin_args->argc, plugin_args->argv);
 }
 
 /*
@@ -989,6 +1395,8 @@ plugin_auto_load (int argc, char **argv)
 
     plugin_autoload_array = NULL;
     plugin_autoload_count = 0;
+    plugin_lazy_array = NULL;
+    plugin_lazy_count = 0;
 
     if (CONFIG_STRING(config_plugin_autoload)
         && CONFIG_STRING(config_plugin_autoload)[0])
@@ -998,6 +1406,19 @@ plugin_auto_load (int argc, char **argv)
                                               &plugin_autoload_count);
     }
 
+    /*
+     * plugins loaded on first use (not during upgrade: all plugins must be
+     * loaded to restore their data from the upgrade files)
+     */
+    if (!weechat_upgrading
+        && CONFIG_STRING(config_plugin_lazy_load)
+        && CONFIG_STRING(config_plugin_lazy_load)[0])
+    {
+        plugin_lazy_array = string_split (CONFIG_STRING(config_plugin_lazy_load),
+                                          ",", 0, 0,
+                                          &plugin_lazy_count);
+    }
+
     /* auto-load plugins in WeeChat home dir */
     if (CONFIG_STRING(config_plugin_path)
         && CONFIG_STRING(config_plugin_path)[0])
@@ -1036,6 +1457,14 @@ plugin_auto_load (int argc, char **argv)
     }
     plugin_autoload_count = 0;
 
+    /* free lazy array */
+    if (plugin_lazy_array)
+    {
+        string_free_split (plugin_lazy_array);
+        plugin_lazy_array = NULL;
+    }
+    plugin_lazy_count = 0;
+
     /* initialize all uninitialized plugins */
     arraylist = arraylist_new (10, 1, 1,
                                &plugin_arraylist_cmp_cb, NULL, NULL, NULL);
@@ -1109,6 +1538,9 @@ plugin_remove (struct t_weechat_plugin *plugin)
     /* remove all hooks */
     unhook_all_plugin (plugin, NULL);
 
+    /* remove all events posted by threads and not yet executed */
+    async_remove_plugin (plugin);
+
     /* remove all infolists */
     infolist_free_all_plugin (plugin);
 
@@ -1260,6 +1692,7 @@ plugin_display_short_list ()
     char *buf;
     int length;
     struct t_weechat_plugin *ptr_plugin;
+    struct t_plugin_lazy *ptr_lazy;
     struct t_weelist *list;
     struct t_weelist_item *ptr_item;
 
@@ -1298,6 +1731,42 @@ plugin_display_short_list ()
             weelist_free (list);
         }
     }
+
+    if (plugin_lazy_plugins)
+    {
+        list = weelist_new ();
+        if (list)
+        {
+            plugins_loaded = _("Plugins loaded on first use:");
+
+            length = strlen (plugins_loaded) + 1;
+
+            for (ptr_lazy = plugin_lazy_plugins; ptr_lazy;
+                 ptr_lazy = ptr_lazy->next_lazy)
+            {
+                length += strlen (ptr_lazy->name) + 2;
+                weelist_add (list, ptr_lazy->name, WEECHAT_LIST_POS_SORT, NULL);
+            }
+            length++;
+
+            buf = malloc (length);
+            if (buf)
+            {
+                strcpy (buf, plugins_loaded);
+                strcat (buf, " ");
+                for (ptr_item = list->items; ptr_item;
+                     ptr_item = ptr_item->next_item)
+                {
+                    strcat (buf, ptr_item->data);
+                    if (ptr_item->next_item)
+                        strcat (buf, ", ");
+                }
+                gui_chat_printf (NULL, "%s", buf);
+                free (buf);
+            }
+            weelist_free (list);
+        }
+    }
 }
 
 /*
@@ -1311,6 +1780,10 @@ plugin_init (int auto_load, int argc, char *argv[])
     plugin_config_init ();
     plugin_config_read ();
 
+    /* arguments given to plugins loaded later, on first use */
+    plugin_lazy_argc = argc;
+    plugin_lazy_argv = argv;
+
     /* auto-load plugins if asked */
     if (auto_load)
     {
@@ -1328,6 +1801,9 @@ plugin_init (int auto_load, int argc, char *argv[])
 void
 plugin_end ()
 {
+    /* plugins not loaded yet will not be loaded any more */
+    plugin_lazy_free_all ();
+
     /* write plugins configuration options */
     plugin_config_write ();
 
@@ -1436,6 +1912,7 @@ void
 plugin_print_log ()
 {
     struct t_weechat_plugin *ptr_plugin;
+    struct t_plugin_lazy *ptr_lazy;
 
     for (ptr_plugin = weechat_plugins; ptr_plugin;
          ptr_plugin = ptr_plugin->next_plugin)
@@ -1454,4 +1931,17 @@ plugin_print_log ()
         log_printf ("  prev_plugin. . . . . . : 0x%lx", ptr_plugin->prev_plugin);
         log_printf ("  next_plugin. . . . . . : 0x%lx", ptr_plugin->next_plugin);
     }
+
+    for (ptr_lazy = plugin_lazy_plugins; ptr_lazy;
+         ptr_lazy = ptr_lazy->next_lazy)
+    {
+        log_printf ("");
+        log_printf ("[plugin lazy (addr:0x%lx)]", ptr_lazy);
+        log_printf ("  name . . . . . . . . . : '%s'",  ptr_lazy->name);
+        log_printf ("  filename . . . . . . . : '%s'",  ptr_lazy->filename);
+        log_printf ("  hook_command . . . . . : 0x%lx", ptr_lazy->hook_command);
+        log_printf ("  hook_timer . . . . . . : 0x%lx", ptr_lazy->hook_timer);
+        log_printf ("  prev_lazy. . . . . . . : 0x%lx", ptr_lazy->prev_lazy);
+        log_printf ("  next_lazy. . . . . . . : 0x%lx", ptr_lazy->next_lazy);
+    }
 }
@@ -30,8 +30,21 @@ typedef int (t_weechat_init_func) (struct t_weechat_plugin *plugin,
                                    int argc, char *argv[]);
 typedef int (t_weechat_end_func) (struct t_weechat_plugin *plugin);
 
+/* plugin loaded on first use (option weechat.plugin.lazy_load) */
+
+struct t_plugin_lazy
+{
+    char *name;                        /* plugin name (eg: "xfer")          */
+    char *filename;                    /* full path of plugin library       */
+    struct t_hook *hook_command;       /* command which loads the plugin    */
+    struct t_hook *hook_timer;         /* timer to load plugin (bar item)   */
+    struct t_plugin_lazy *prev_lazy;   /* link to previous lazy plugin      */
+    struct t_plugin_lazy *next_lazy;   /* link to next lazy plugin          */
+};
+
 extern struct t_weechat_plugin *weechat_plugins;
 extern struct t_weechat_plugin *last_weechat_plugin;
+extern struct t_plugin_lazy *plugin_lazy_plugins;
 
 extern int plugin_valid (struct t_weechat_plugin *plugin);
 extern struct t_weechat_plugin *plugin_search (const char *name);
@@ -40,6 +53,7 @@ extern struct t_weechat_plugin *plugin_load (const char *filename,
                                              int init_plugin,
                                              int argc, char **argv);
 extern void plugin_auto_load (int argc, char **argv);
+extern int plugin_lazy_load_name (const char *name, int delayed);
 extern void plugin_unload (struct t_weechat_plugin *plugin);
 extern void plugin_unload_name (const char *name);
 extern void plugin_unload_all ();
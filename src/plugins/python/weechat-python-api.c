@@ -1889,6 +1889,29 @@ API_FUNC(prnt_date_tags)
     API_RETURN_OK;
 }
 
+API_FUNC(prnt_lines)
+{
+    char *buffer, *tags, *lines;
+    int date;
+
+    API_INIT_FUNC(1, "prnt_lines", API_RETURN_ERROR);
+    buffer = NULL;
+    date = 0;
+    tags = NULL;
+    lines = NULL;
+    if (!PyArg_ParseTuple (args, "siss", &buffer, &date, &tags, &lines))
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    plugin_script_api_print_lines (weechat_python_plugin,
+                                   python_current_script,
+                                   API_STR2PTR(buffer),
+                                   date,
+                                   tags,
+                                   lines);
+
+    API_RETURN_OK;
+}
+
 API_FUNC(prnt_y)
 {
     char *buffer, *message;
@@ -4851,6 +4874,56 @@ API_FUNC(hdata_hashtable)
     return result_dict;
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * dict with the variables of object in the list.
+ */
+
+void
+weechat_python_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                                   void *pointer, struct t_hashtable *record)
+{
+    PyObject *dict;
+
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    dict = weechat_python_hashtable_to_dict (record);
+    PyList_Append ((PyObject *)data, dict);
+    Py_XDECREF(dict);
+}
+
+API_FUNC(hdata_fetch)
+{
+    char *hdata, *pointer, *fields;
+    int count;
+    PyObject *result_list;
+
+    API_INIT_FUNC(1, "hdata_fetch", API_RETURN_EMPTY);
+    hdata = NULL;
+    pointer = NULL;
+    fields = NULL;
+    count = 0;
+    if (!PyArg_ParseTuple (args, "sssi", &hdata, &pointer, &fields, &count))
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    result_list = PyList_New (0);
+    if (!result_list)
+    {
+        API_RETURN_EMPTY;
+    }
+
+    weechat_hdata_fetch (API_STR2PTR(hdata),
+                         API_STR2PTR(pointer),
+                         fields,
+                         count,
+                         &weechat_python_api_hdata_fetch_cb,
+                         result_list);
+
+    return result_list;
+}
+
 API_FUNC(hdata_update)
 {
     char *hdata, *pointer;
@@ -5097,6 +5170,7 @@ PyMethodDef weechat_python_funcs[] =
     API_DEF_FUNC(color),
     API_DEF_FUNC(prnt),
     API_DEF_FUNC(prnt_date_tags),
+    API_DEF_FUNC(prnt_lines),
     API_DEF_FUNC(prnt_y),
     API_DEF_FUNC(log_print),
     API_DEF_FUNC(hook_command),
@@ -5205,6 +5279,7 @@ PyMethodDef weechat_python_funcs[] =
     API_DEF_FUNC(hdata_pointer),
     API_DEF_FUNC(hdata_time),
     API_DEF_FUNC(hdata_hashtable),
+    API_DEF_FUNC(hdata_fetch),
     API_DEF_FUNC(hdata_update),
     API_DEF_FUNC(hdata_get_string),
     API_DEF_FUNC(upgrade_new),
@@ -53,6 +53,9 @@ PyThreadState *python_mainThreadState = NULL;
 PyThreadState *python_current_interpreter = NULL;
 char *python2_bin = NULL;
 
+/* cache used to run functions (key: interpreter, value: exec cache) */
+struct t_hashtable *python_exec_caches = NULL;
+
 /* outputs subroutines */
 static PyObject *weechat_python_output (PyObject *self, PyObject *args);
 static PyMethodDef weechat_python_output_funcs[] = {
@@ -307,6 +310,243 @@ weechat_python_dict_to_hashtable (PyObject *dict, int size,
     return hashtable;
 }
 
+/*
+ * Callback called to free a python object in a hashtable.
+ */
+
+void
+weechat_python_exec_cache_free_object_cb (struct t_hashtable *hashtable,
+                                          const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    Py_XDECREF((PyObject *)value);
+}
+
+/*
+ * Callback called to free an exec cache in hashtable "python_exec_caches".
+ *
+ * The interpreter of the cache must be the current one.
+ */
+
+void
+weechat_python_exec_cache_free_value_cb (struct t_hashtable *hashtable,
+                                         const void *key, void *value)
+{
+    struct t_python_exec_cache *exec_cache;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    exec_cache = (struct t_python_exec_cache *)value;
+    if (!exec_cache)
+        return;
+
+    if (exec_cache->functions)
+        weechat_hashtable_free (exec_cache->functions);
+    if (exec_cache->strings)
+        weechat_hashtable_free (exec_cache->strings);
+    Py_XDECREF(exec_cache->main_dict);
+
+    free (exec_cache);
+}
+
+/*
+ * Creates a hashtable with python objects as values.
+ */
+
+struct t_hashtable *
+weechat_python_exec_cache_hashtable_new ()
+{
+    struct t_hashtable *hashtable;
+
+    hashtable = weechat_hashtable_new (32,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_POINTER,
+                                       NULL, NULL);
+    if (hashtable)
+    {
+        weechat_hashtable_set_pointer (hashtable,
+                                       "callback_free_value",
+                                       &weechat_python_exec_cache_free_object_cb);
+    }
+
+    return hashtable;
+}
+
+/*
+ * Gets exec cache of a script interpreter (creates it if not found).
+ *
+ * The interpreter of script must be the current one.
+ *
+ * Returns pointer to exec cache, NULL if error.
+ */
+
+struct t_python_exec_cache *
+weechat_python_exec_cache_get (struct t_plugin_script *script)
+{
+    struct t_python_exec_cache *exec_cache;
+    PyObject *main_module;
+
+    if (!python_exec_caches)
+    {
+        python_exec_caches = weechat_hashtable_new (32,
+                                                    WEECHAT_HASHTABLE_POINTER,
+                                                    WEECHAT_HASHTABLE_POINTER,
+                                                    NULL, NULL);
+        if (!python_exec_caches)
+            return NULL;
+        weechat_hashtable_set_pointer (python_exec_caches,
+                                       "callback_free_value",
+                                       &weechat_python_exec_cache_free_value_cb);
+    }
+
+    exec_cache = weechat_hashtable_get (python_exec_caches,
+                                        script->interpreter);
+    if (exec_cache)
+        return exec_cache;
+
+    main_module = PyImport_AddModule ((char *) "__main__");
+    if (!main_module)
+        return NULL;
+
+    exec_cache = malloc (sizeof (*exec_cache));
+    if (!exec_cache)
+        return NULL;
+
+    exec_cache->main_dict = PyModule_GetDict (main_module);
+    Py_XINCREF(exec_cache->main_dict);
+    exec_cache->functions = weechat_python_exec_cache_hashtable_new ();
+    exec_cache->strings = weechat_python_exec_cache_hashtable_new ();
+
+    if (!exec_cache->main_dict || !exec_cache->functions
+        || !exec_cache->strings)
+    {
+        weechat_python_exec_cache_free_value_cb (NULL, NULL, exec_cache);
+        return NULL;
+    }
+
+    if (!weechat_hashtable_set (python_exec_caches, script->interpreter,
+                                exec_cache))
+    {
+        weechat_python_exec_cache_free_value_cb (NULL, NULL, exec_cache);
+        return NULL;
+    }
+
+    return exec_cache;
+}
+
+/*
+ * Frees exec cache of an interpreter (if there is one).
+ *
+ * This function must be called before the end of interpreter, when this
+ * interpreter is the current one.
+ */
+
+void
+weechat_python_exec_cache_free (void *interpreter)
+{
+    if (python_exec_caches && interpreter)
+        weechat_hashtable_remove (python_exec_caches, interpreter);
+}
+
+/*
+ * Builds a python string with a C string (same type as format "s" in function
+ * Py_BuildValue).
+ *
+ * Short strings (like data of callback, signal names, pointers) are kept in
+ * the exec cache so they are not built again on next calls.
+ *
+ * Returns a new reference, NULL if error.
+ */
+
+PyObject *
+weechat_python_exec_cache_string (struct t_python_exec_cache *exec_cache,
+                                  const char *string)
+{
+    PyObject *object;
+
+    if (!string)
+    {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    if (strlen (string) > PYTHON_EXEC_CACHE_STRING_MAX_LENGTH)
+        return PY_STRING_FROM_STRING(string);
+
+    object = weechat_hashtable_get (exec_cache->strings, string);
+    if (!object)
+    {
+        object = PY_STRING_FROM_STRING(string);
+        if (!object)
+            return NULL;
+        if (weechat_hashtable_get_integer (exec_cache->strings,
+                                           "items_count") >= PYTHON_EXEC_CACHE_STRINGS_MAX)
+        {
+            weechat_hashtable_remove_all (exec_cache->strings);
+        }
+        weechat_hashtable_set (exec_cache->strings, string, object);
+    }
+
+    Py_INCREF(object);
+    return object;
+}
+
+/*
+ * Builds the tuple of arguments for a python function, using strings of exec
+ * cache.
+ *
+ * Returns a new reference, NULL if error (then the arguments must be built
+ * with Py_BuildValue).
+ */
+
+PyObject *
+weechat_python_exec_build_args (struct t_python_exec_cache *exec_cache,
+                                const char *format, void **argv)
+{
+    PyObject *args, *object;
+    int i, argc;
+
+    argc = strlen (format);
+    if (argc > 16)
+        return NULL;
+
+    args = PyTuple_New (argc);
+    if (!args)
+        return NULL;
+
+    for (i = 0; i < argc; i++)
+    {
+        switch (format[i])
+        {
+            case 's':
+                object = weechat_python_exec_cache_string (
+                    exec_cache, (const char *)argv[i]);
+                break;
+            case 'O':
+                object = (PyObject *)argv[i];
+                Py_XINCREF(object);
+                break;
+            default:
+                object = NULL;
+                break;
+        }
+        if (!object)
+        {
+            PyErr_Clear ();
+            Py_DECREF(args);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(args, i, object);
+    }
+
+    return args;
+}
+
 /*
  * Executes a python function.
  */
@@ -318,7 +558,8 @@ weechat_python_exec (struct t_plugin_script *script,
 {
     struct t_plugin_script *old_python_current_script;
     PyThreadState *old_interpreter;
-    PyObject *evMain, *evDict, *evFunc, *rc;
+    struct t_python_exec_cache *exec_cache;
+    PyObject *evMain, *evDict, *evFunc, *evKey, *args, *rc;
     void *argv2[16], *ret_value;
     int i, argc, *ret_int;
 
@@ -335,9 +576,31 @@ weechat_python_exec (struct t_plugin_script *script,
         PyThreadState_Swap (script->interpreter);
     }
 
-    evMain = PyImport_AddModule ((char *) "__main__");
-    evDict = PyModule_GetDict (evMain);
-    evFunc = PyDict_GetItemString (evDict, function);
+    /*
+     * look for function with its name built only once (the function itself
+     * is not cached, so a function redefined by the script is used)
+     */
+    exec_cache = (script->interpreter) ?
+        weechat_python_exec_cache_get (script) : NULL;
+    if (exec_cache)
+    {
+        evKey = weechat_hashtable_get (exec_cache->functions, function);
+        if (!evKey)
+        {
+            evKey = PY_STRING_FROM_STRING(function);
+            if (evKey)
+                weechat_hashtable_set (exec_cache->functions, function, evKey);
+            else
+                PyErr_Clear ();
+        }
+        evFunc = (evKey) ? PyDict_GetItem (exec_cache->main_dict, evKey) : NULL;
+    }
+    else
+    {
+        evMain = PyImport_AddModule ((char *) "__main__");
+        evDict = PyModule_GetDict (evMain);
+        evFunc = PyDict_GetItemString (evDict, function);
+    }
 
     if ( !(evFunc && PyCallable_Check (evFunc)) )
     {
@@ -348,7 +611,16 @@ weechat_python_exec (struct t_plugin_script *script,
         goto end;
     }
 
-    if (argv && argv[0])
+    args = NULL;
+    if (exec_cache && argv && argv[0])
+        args = weechat_python_exec_build_args (exec_cache, format, argv);
+
+    if (args)
+    {
+        rc = PyObject_Call (evFunc, args, NULL);
+        Py_DECREF(args);
+    }
+    else if (argv && argv[0])
     {
         argc = strlen (format);
         for (i = 0; i < 16; i++)
@@ -733,6 +1005,7 @@ weechat_python_load (const char *filename)
             python_current_script = NULL;
         }
 
+        weechat_python_exec_cache_free (python_current_interpreter);
         Py_EndInterpreter (python_current_interpreter);
         /* PyEval_ReleaseLock (); */
 
@@ -753,6 +1026,7 @@ weechat_python_load (const char *filename)
 
         if (PyErr_Occurred ())
             PyErr_Print ();
+        weechat_python_exec_cache_free (python_current_interpreter);
         Py_EndInterpreter (python_current_interpreter);
         /* PyEval_ReleaseLock (); */
 
@@ -833,6 +1107,7 @@ weechat_python_unload (struct t_plugin_script *script)
     if (interpreter)
     {
         PyThreadState_Swap (interpreter);
+        weechat_python_exec_cache_free (interpreter);
         Py_EndInterpreter (interpreter);
     }
 
@@ -1343,6 +1618,12 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
     plugin_script_end (plugin, &python_scripts, &weechat_python_unload_all);
     python_quiet = 0;
 
+    if (python_exec_caches)
+    {
+        weechat_hashtable_free (python_exec_caches);
+        python_exec_caches = NULL;
+    }
+
     /* free python interpreter */
     if (python_mainThreadState != NULL)
     {
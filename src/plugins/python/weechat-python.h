@@ -37,11 +37,26 @@
 #if PY_MAJOR_VERSION >= 3
 /* check of integer with Python >= 3.x */
 #define PY_INTEGER_CHECK(x) (PyLong_Check(x))
+/* build of string (like format "s" in Py_BuildValue) with Python >= 3.x */
+#define PY_STRING_FROM_STRING(x) (PyUnicode_FromString(x))
 #else
 /* check of integer with Python <= 2.x */
 #define PY_INTEGER_CHECK(x) (PyInt_Check(x) || PyLong_Check(x))
+/* build of string (like format "s" in Py_BuildValue) with Python <= 2.x */
+#define PY_STRING_FROM_STRING(x) (PyBytes_FromString(x))
 #endif /* PY_MAJOR_VERSION >= 3 */
 
+/* strings kept in exec cache (arguments of functions) */
+#define PYTHON_EXEC_CACHE_STRINGS_MAX       1024
+#define PYTHON_EXEC_CACHE_STRING_MAX_LENGTH 64
+
+struct t_python_exec_cache
+{
+    PyObject *main_dict;               /* dict of module "__main__"         */
+    struct t_hashtable *functions;     /* function name -> python string    */
+    struct t_hashtable *strings;       /* short argument -> python string   */
+};
+
 extern struct t_weechat_plugin *weechat_python_plugin;
 
 extern int python_quiet;
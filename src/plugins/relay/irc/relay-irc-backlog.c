@@ -0,0 +1,906 @@
+/*
+ * relay-irc-backlog.c - backlog of IRC buffers for IRC protocol
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The backlog of a buffer is built when it is sent for the first time to a
+ * client, then it is updated with lines added in buffer: it contains only
+ * lines that can be sent to clients (according to tags in option
+ * relay.irc.backlog_tags), sorted by date, with the IRC messages sent to
+ * clients (built once and shared by all clients).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "../../weechat-plugin.h"
+#include "../relay.h"
+#include "relay-irc.h"
+#include "relay-irc-backlog.h"
+#include "../relay-client.h"
+#include "../relay-config.h"
+#include "../relay-server.h"
+
+
+#define RELAY_IRC_BACKLOG_LINE(__backlog, __index)                      \
+    ((__backlog)->lines[((__backlog)->start + (__index)) % (__backlog)->size])
+
+struct t_hashtable *relay_irc_backlog_buffers = NULL; /* backlog by buffer  */
+struct t_hook *relay_irc_backlog_hook_signal[3] = { NULL, NULL, NULL };
+char *relay_irc_backlog_signals[3] =
+{ "buffer_line_added", "buffer_cleared", "buffer_closing" };
+
+
+/*
+ * Creates a backlog line with a line of buffer.
+ *
+ * Returns pointer to new line, NULL if the line can not be sent to clients
+ * (no supported tag, or join/part/quit from self nick).
+ */
+
+struct t_relay_irc_backlog_line *
+relay_irc_backlog_line_new (struct t_gui_buffer *buffer,
+                            struct t_hdata *hdata_line_data, void *line_data)
+{
+    struct t_relay_irc_backlog_line *new_line;
+    int i, num_tags, command, action, all_tags;
+    char str_tag[256], *pos, *message_no_color;
+    const char *ptr_tag, *ptr_message, *ptr_nick, *ptr_nick1, *ptr_nick2;
+    const char *ptr_host, *localvar_nick;
+
+    num_tags = weechat_hdata_get_var_array_size (hdata_line_data, line_data,
+                                                 "tags_array");
+    ptr_message = weechat_hdata_pointer (hdata_line_data, line_data, "message");
+
+    /* no tag found, or no message? just exit */
+    if ((num_tags <= 0) || !ptr_message)
+        return NULL;
+
+    command = -1;
+    action = 0;
+    ptr_nick = NULL;
+    ptr_nick1 = NULL;
+    ptr_nick2 = NULL;
+    ptr_host = NULL;
+    all_tags = weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
+                                          "*");
+    for (i = 0; i < num_tags; i++)
+    {
+        snprintf (str_tag, sizeof (str_tag), "%d|tags_array", i);
+        ptr_tag = weechat_hdata_string (hdata_line_data, line_data, str_tag);
+        if (ptr_tag)
+        {
+            if (strcmp (ptr_tag, "irc_action") == 0)
+                action = 1;
+            else if (strncmp (ptr_tag, "nick_", 5) == 0)
+                ptr_nick = ptr_tag + 5;
+            else if (strncmp (ptr_tag, "irc_nick1_", 10) == 0)
+                ptr_nick1 = ptr_tag + 10;
+            else if (strncmp (ptr_tag, "irc_nick2_", 10) == 0)
+                ptr_nick2 = ptr_tag + 10;
+            else if (strncmp (ptr_tag, "host_", 5) == 0)
+                ptr_host = ptr_tag + 5;
+            else if ((command < 0)
+                     && (all_tags
+                         || (weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
+                                                        ptr_tag))))
+            {
+                command = relay_irc_search_backlog_commands_tags (ptr_tag);
+            }
+        }
+    }
+
+    /* not a supported IRC command? */
+    if (command < 0)
+        return NULL;
+
+    /* ignore join/part/quit from self nick */
+    if ((command == RELAY_IRC_CMD_JOIN) || (command == RELAY_IRC_CMD_PART)
+        || (command == RELAY_IRC_CMD_QUIT))
+    {
+        localvar_nick = weechat_buffer_get_string (buffer, "localvar_nick");
+        if (localvar_nick && localvar_nick[0]
+            && ptr_nick && (strcmp (ptr_nick, localvar_nick) == 0))
+        {
+            return NULL;
+        }
+    }
+
+    new_line = malloc (sizeof (*new_line));
+    if (!new_line)
+        return NULL;
+
+    new_line->date = weechat_hdata_time (hdata_line_data, line_data, "date");
+    new_line->command = command;
+    new_line->action = action;
+    new_line->nick = (ptr_nick) ? strdup (ptr_nick) : NULL;
+    new_line->nick1 = (ptr_nick1) ? strdup (ptr_nick1) : NULL;
+    new_line->nick2 = (ptr_nick2) ? strdup (ptr_nick2) : NULL;
+    new_line->host = (ptr_host) ? strdup (ptr_host) : NULL;
+    new_line->message = NULL;
+    new_line->encoded[0] = NULL;
+    new_line->encoded[1] = NULL;
+
+    if (command == RELAY_IRC_CMD_PRIVMSG)
+    {
+        message_no_color = weechat_string_remove_color (ptr_message, NULL);
+        if (message_no_color)
+        {
+            pos = message_no_color;
+            if (action)
+            {
+                /* skip nick at beginning of action */
+                pos = strchr (message_no_color, ' ');
+                if (pos)
+                {
+                    while (pos[0] == ' ')
+                    {
+                        pos++;
+                    }
+                }
+                else
+                    pos = message_no_color;
+            }
+            new_line->message = strdup (pos);
+            free (message_no_color);
+        }
+    }
+
+    return new_line;
+}
+
+/*
+ * Frees IRC messages built for a backlog line.
+ */
+
+void
+relay_irc_backlog_line_free_encoded (struct t_relay_irc_backlog_line *line)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if (line->encoded[i])
+        {
+            free (line->encoded[i]);
+            line->encoded[i] = NULL;
+        }
+    }
+}
+
+/*
+ * Frees a backlog line.
+ */
+
+void
+relay_irc_backlog_line_free (struct t_relay_irc_backlog_line *line)
+{
+    if (!line)
+        return;
+
+    if (line->nick)
+        free (line->nick);
+    if (line->nick1)
+        free (line->nick1);
+    if (line->nick2)
+        free (line->nick2);
+    if (line->host)
+        free (line->host);
+    if (line->message)
+        free (line->message);
+    relay_irc_backlog_line_free_encoded (line);
+
+    free (line);
+}
+
+/*
+ * Formats an IRC message and splits it (like it would be sent to the IRC
+ * server).
+ *
+ * Returns the messages ready to be sent to a client (each one ends with
+ * "\r\n"), NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_irc_backlog_encode (struct t_relay_client *client,
+                          const char *format, ...)
+{
+    struct t_hashtable *hashtable_in, *hashtable_out;
+    char *pos, hash_key[32], *result;
+    const char *str_message;
+    int number, length;
+
+    weechat_va_format (format);
+    if (!vbuffer)
+        return NULL;
+
+    pos = strchr (vbuffer, '\r');
+    if (pos)
+        pos[0] = '\0';
+    pos = strchr (vbuffer, '\n');
+    if (pos)
+        pos[0] = '\0';
+
+    result = NULL;
+
+    hashtable_in = weechat_hashtable_new (32,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          NULL, NULL);
+    if (hashtable_in)
+    {
+        weechat_hashtable_set (hashtable_in, "server", client->protocol_args);
+        weechat_hashtable_set (hashtable_in, "message", vbuffer);
+        hashtable_out = weechat_info_get_hashtable ("irc_message_split",
+                                                    hashtable_in);
+        if (hashtable_out)
+        {
+            /* compute length of all messages */
+            length = 0;
+            number = 1;
+            while (1)
+            {
+                snprintf (hash_key, sizeof (hash_key), "msg%d", number);
+                str_message = weechat_hashtable_get (hashtable_out, hash_key);
+                if (!str_message)
+                    break;
+                length += strlen (str_message) + 2;
+                number++;
+            }
+            if (length > 0)
+            {
+                result = malloc (length + 1);
+                if (result)
+                {
+                    result[0] = '\0';
+                    for (number = 1; ; number++)
+                    {
+                        snprintf (hash_key, sizeof (hash_key),
+                                  "msg%d", number);
+                        str_message = weechat_hashtable_get (hashtable_out,
+                                                             hash_key);
+                        if (!str_message)
+                            break;
+                        strcat (result, str_message);
+                        strcat (result, "\r\n");
+                    }
+                }
+            }
+            weechat_hashtable_free (hashtable_out);
+        }
+        weechat_hashtable_free (hashtable_in);
+    }
+
+    free (vbuffer);
+
+    return result;
+}
+
+/*
+ * Gets the IRC messages of a backlog line sent to client (they are built on
+ * first call, then reused for all clients).
+ *
+ * Argument "server_time" is 1 if the client enabled the capability
+ * "server-time" (then time is sent as irc tag), 0 otherwise (then time is
+ * added before message, according to option relay.irc.backlog_time_format).
+ *
+ * Returns IRC messages, NULL if nothing must be sent for this line.
+ */
+
+const char *
+relay_irc_backlog_line_get_encoded (struct t_relay_client *client,
+                                    struct t_relay_irc_backlog_line *line,
+                                    const char *channel, int server_time)
+{
+    char str_tags[256], str_time[256], *message;
+    const char *time_format;
+    int length;
+    struct tm *tm;
+
+    if (line->encoded[server_time])
+        return line->encoded[server_time];
+
+    /* if server capability "server-time" is enabled, add an irc tag with time */
+    str_tags[0] = '\0';
+    if (server_time)
+    {
+        tm = gmtime (&line->date);
+        strftime (str_time, sizeof (str_time), "%Y-%m-%dT%H:%M:%S", tm);
+        snprintf (str_tags, sizeof (str_tags), "@time=%s.000Z ", str_time);
+    }
+
+    switch (line->command)
+    {
+        case RELAY_IRC_CMD_JOIN:
+            line->encoded[server_time] = relay_irc_backlog_encode (
+                client,
+                "%s:%s%s%s JOIN :%s",
+                str_tags,
+                (line->nick) ? line->nick : "",
+                (line->host) ? "!" : "",
+                (line->host) ? line->host : "",
+                channel);
+            break;
+        case RELAY_IRC_CMD_PART:
+            line->encoded[server_time] = relay_irc_backlog_encode (
+                client,
+                "%s:%s%s%s PART %s",
+                str_tags,
+                (line->nick) ? line->nick : "",
+                (line->host) ? "!" : "",
+                (line->host) ? line->host : "",
+                channel);
+            break;
+        case RELAY_IRC_CMD_QUIT:
+            line->encoded[server_time] = relay_irc_backlog_encode (
+                client,
+                "%s:%s%s%s QUIT",
+                str_tags,
+                (line->nick) ? line->nick : "",
+                (line->host) ? "!" : "",
+                (line->host) ? line->host : "");
+            break;
+        case RELAY_IRC_CMD_NICK:
+            if (line->nick1 && line->nick2)
+            {
+                line->encoded[server_time] = relay_irc_backlog_encode (
+                    client,
+                    "%s:%s NICK :%s",
+                    str_tags,
+                    line->nick1,
+                    line->nick2);
+            }
+            break;
+        case RELAY_IRC_CMD_PRIVMSG:
+            if (line->nick && line->message)
+            {
+                /*
+                 * if server capability "server-time" is NOT enabled, and if
+                 * the time format is not empty, add time inside message
+                 * (before message)
+                 */
+                message = NULL;
+                time_format = weechat_config_string (relay_config_irc_backlog_time_format);
+                if (!server_time && time_format && time_format[0])
+                {
+                    tm = localtime (&line->date);
+                    strftime (str_time, sizeof (str_time), time_format, tm);
+                    length = strlen (str_time) + strlen (line->message) + 1;
+                    message = malloc (length);
+                    if (message)
+                        snprintf (message, length, "%s%s", str_time, line->message);
+                }
+                line->encoded[server_time] = relay_irc_backlog_encode (
+                    client,
+                    "%s:%s%s%s PRIVMSG %s :%s%s%s",
+                    str_tags,
+                    line->nick,
+                    (line->host) ? "!" : "",
+                    (line->host) ? line->host : "",
+                    channel,
+                    (line->action) ? "\01ACTION " : "",
+                    (message) ? message : line->message,
+                    (line->action) ? "\01": "");
+                if (message)
+                    free (message);
+            }
+            break;
+        case RELAY_IRC_NUM_CMD:
+            /* make C compiler happy */
+            break;
+    }
+
+    return line->encoded[server_time];
+}
+
+/*
+ * Removes lines older than the max minutes of backlog (option
+ * relay.irc.backlog_max_minutes) at beginning of a backlog.
+ */
+
+void
+relay_irc_backlog_remove_old_lines (struct t_relay_irc_backlog *backlog)
+{
+    int max_minutes;
+    time_t date_min;
+
+    max_minutes = weechat_config_integer (relay_config_irc_backlog_max_minutes);
+    if (max_minutes <= 0)
+        return;
+
+    date_min = time (NULL) - (max_minutes * 60);
+    while ((backlog->count > 0)
+           && (RELAY_IRC_BACKLOG_LINE(backlog, 0)->date < date_min))
+    {
+        relay_irc_backlog_line_free (RELAY_IRC_BACKLOG_LINE(backlog, 0));
+        backlog->start = (backlog->start + 1) % backlog->size;
+        backlog->count--;
+    }
+}
+
+/*
+ * Adds a line at the end of a backlog.
+ *
+ * If the max number of lines is reached (option relay.irc.backlog_max_number),
+ * the oldest line is removed.
+ */
+
+void
+relay_irc_backlog_add_line (struct t_relay_irc_backlog *backlog,
+                            struct t_relay_irc_backlog_line *line)
+{
+    struct t_relay_irc_backlog_line **new_lines;
+    int max_number, new_size, i;
+
+    max_number = weechat_config_integer (relay_config_irc_backlog_max_number);
+
+    if (backlog->count == backlog->size)
+    {
+        if ((max_number > 0) && (backlog->size >= max_number))
+        {
+            /* ring is full: remove oldest line */
+            relay_irc_backlog_line_free (RELAY_IRC_BACKLOG_LINE(backlog, 0));
+            backlog->start = (backlog->start + 1) % backlog->size;
+            backlog->count--;
+        }
+        else
+        {
+            /* grow ring */
+            new_size = (backlog->size < RELAY_IRC_BACKLOG_MIN_SIZE) ?
+                RELAY_IRC_BACKLOG_MIN_SIZE : backlog->size * 2;
+            if ((max_number > 0) && (new_size > max_number))
+                new_size = max_number;
+            new_lines = malloc (new_size * sizeof (*new_lines));
+            if (!new_lines)
+            {
+                relay_irc_backlog_line_free (line);
+                return;
+            }
+            for (i = 0; i < backlog->count; i++)
+            {
+                new_lines[i] = RELAY_IRC_BACKLOG_LINE(backlog, i);
+            }
+            if (backlog->lines)
+                free (backlog->lines);
+            backlog->lines = new_lines;
+            backlog->size = new_size;
+            backlog->start = 0;
+        }
+    }
+
+    RELAY_IRC_BACKLOG_LINE(backlog, backlog->count) = line;
+    backlog->count++;
+}
+
+/*
+ * Removes all lines in a backlog.
+ */
+
+void
+relay_irc_backlog_clear (struct t_relay_irc_backlog *backlog)
+{
+    int i;
+
+    for (i = 0; i < backlog->count; i++)
+    {
+        relay_irc_backlog_line_free (RELAY_IRC_BACKLOG_LINE(backlog, i));
+    }
+    backlog->start = 0;
+    backlog->count = 0;
+}
+
+/*
+ * Frees a backlog.
+ */
+
+void
+relay_irc_backlog_free (struct t_relay_irc_backlog *backlog)
+{
+    if (!backlog)
+        return;
+
+    relay_irc_backlog_clear (backlog);
+    if (backlog->lines)
+        free (backlog->lines);
+    if (backlog->server)
+        free (backlog->server);
+    if (backlog->channel)
+        free (backlog->channel);
+
+    free (backlog);
+}
+
+/*
+ * Callback called to free a value in hashtable "relay_irc_backlog_buffers".
+ */
+
+void
+relay_irc_backlog_free_value_cb (struct t_hashtable *hashtable,
+                                 const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    relay_irc_backlog_free ((struct t_relay_irc_backlog *)value);
+}
+
+/*
+ * Creates the backlog of a buffer with lines in buffer.
+ *
+ * Returns pointer to new backlog, NULL if error.
+ */
+
+struct t_relay_irc_backlog *
+relay_irc_backlog_new (struct t_gui_buffer *buffer)
+{
+    struct t_relay_irc_backlog *new_backlog;
+    struct t_relay_irc_backlog_line *new_line, **lines, **lines2;
+    void *ptr_own_lines, *ptr_line, *ptr_line_data;
+    struct t_hdata *ptr_hdata_line, *ptr_hdata_line_data;
+    int max_number, max_minutes, count, size, i;
+    time_t date_min;
+
+    ptr_hdata_line = weechat_hdata_get ("line");
+    ptr_hdata_line_data = weechat_hdata_get ("line_data");
+    if (!ptr_hdata_line || !ptr_hdata_line_data)
+        return NULL;
+
+    new_backlog = malloc (sizeof (*new_backlog));
+    if (!new_backlog)
+        return NULL;
+
+    new_backlog->buffer = buffer;
+    new_backlog->lines = NULL;
+    new_backlog->size = 0;
+    new_backlog->start = 0;
+    new_backlog->count = 0;
+    new_backlog->server = NULL;
+    new_backlog->channel = NULL;
+
+    /* get pointer on "own_lines" in buffer */
+    ptr_own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
+                                           buffer, "own_lines");
+    if (!ptr_own_lines)
+        return new_backlog;
+
+    /* get pointer on "last_line" in lines */
+    ptr_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
+                                      ptr_own_lines, "last_line");
+
+    max_number = weechat_config_integer (relay_config_irc_backlog_max_number);
+    max_minutes = weechat_config_integer (relay_config_irc_backlog_max_minutes);
+    date_min = (max_minutes > 0) ? time (NULL) - (max_minutes * 60) : 0;
+
+    /*
+     * loop on lines in buffer, from last to first, and stop when we have
+     * reached max number of lines (or max minutes)
+     */
+    lines = NULL;
+    count = 0;
+    size = 0;
+    while (ptr_line && ((max_number <= 0) || (count < max_number)))
+    {
+        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line,
+                                               ptr_line, "data");
+        if (ptr_line_data)
+        {
+            new_line = relay_irc_backlog_line_new (buffer,
+                                                   ptr_hdata_line_data,
+                                                   ptr_line_data);
+            if (new_line)
+            {
+                /* if we have reached max minutes, exit loop */
+                if ((date_min > 0) && (new_line->date < date_min))
+                {
+                    relay_irc_backlog_line_free (new_line);
+                    break;
+                }
+                if (count == size)
+                {
+                    size = (size < RELAY_IRC_BACKLOG_MIN_SIZE) ?
+                        RELAY_IRC_BACKLOG_MIN_SIZE : size * 2;
+                    lines2 = realloc (lines, size * sizeof (*lines2));
+                    if (!lines2)
+                    {
+                        relay_irc_backlog_line_free (new_line);
+                        break;
+                    }
+                    lines = lines2;
+                }
+                lines[count++] = new_line;
+            }
+        }
+        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, -1);
+    }
+
+    /* add lines in backlog, from oldest to newest */
+    for (i = count - 1; i >= 0; i--)
+    {
+        relay_irc_backlog_add_line (new_backlog, lines[i]);
+    }
+    if (lines)
+        free (lines);
+
+    return new_backlog;
+}
+
+/*
+ * Callback for signals "buffer_line_added", "buffer_cleared" and
+ * "buffer_closing": updates the backlog of buffer (if it has been built).
+ */
+
+int
+relay_irc_backlog_signal_buffer_cb (const void *pointer, void *data,
+                                    const char *signal,
+                                    const char *type_data, void *signal_data)
+{
+    struct t_relay_irc_backlog *ptr_backlog;
+    struct t_relay_irc_backlog_line *new_line;
+    struct t_gui_buffer *ptr_buffer;
+    struct t_hdata *ptr_hdata_line, *ptr_hdata_line_data;
+    void *ptr_line_data;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) type_data;
+
+    if (!relay_irc_backlog_buffers)
+        return WEECHAT_RC_OK;
+
+    if (strcmp (signal, "buffer_line_added") == 0)
+    {
+        ptr_hdata_line = weechat_hdata_get ("line");
+        ptr_hdata_line_data = weechat_hdata_get ("line_data");
+        if (!signal_data || !ptr_hdata_line || !ptr_hdata_line_data)
+            return WEECHAT_RC_OK;
+        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line, signal_data,
+                                               "data");
+        if (!ptr_line_data)
+            return WEECHAT_RC_OK;
+        ptr_buffer = weechat_hdata_pointer (ptr_hdata_line_data, ptr_line_data,
+                                            "buffer");
+        ptr_backlog = weechat_hashtable_get (relay_irc_backlog_buffers,
+                                             ptr_buffer);
+        if (!ptr_backlog)
+            return WEECHAT_RC_OK;
+        new_line = relay_irc_backlog_line_new (ptr_buffer,
+                                               ptr_hdata_line_data,
+                                               ptr_line_data);
+        if (new_line)
+        {
+            relay_irc_backlog_remove_old_lines (ptr_backlog);
+            relay_irc_backlog_add_line (ptr_backlog, new_line);
+        }
+    }
+    else if (strcmp (signal, "buffer_cleared") == 0)
+    {
+        ptr_backlog = weechat_hashtable_get (relay_irc_backlog_buffers,
+                                             signal_data);
+        if (ptr_backlog)
+            relay_irc_backlog_clear (ptr_backlog);
+    }
+    else if (strcmp (signal, "buffer_closing") == 0)
+    {
+        weechat_hashtable_remove (relay_irc_backlog_buffers, signal_data);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Gets the backlog of a buffer (it is built if it does not exist yet).
+ *
+ * Returns pointer to backlog, NULL if error.
+ */
+
+struct t_relay_irc_backlog *
+relay_irc_backlog_get (struct t_gui_buffer *buffer)
+{
+    struct t_relay_irc_backlog *ptr_backlog;
+    int i;
+
+    if (!relay_irc_backlog_buffers)
+    {
+        relay_irc_backlog_buffers = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL, NULL);
+        if (!relay_irc_backlog_buffers)
+            return NULL;
+        weechat_hashtable_set_pointer (relay_irc_backlog_buffers,
+                                       "callback_free_value",
+                                       &relay_irc_backlog_free_value_cb);
+        for (i = 0; i < 3; i++)
+        {
+            relay_irc_backlog_hook_signal[i] = weechat_hook_signal (
+                relay_irc_backlog_signals[i],
+                &relay_irc_backlog_signal_buffer_cb, NULL, NULL);
+        }
+    }
+
+    ptr_backlog = weechat_hashtable_get (relay_irc_backlog_buffers, buffer);
+    if (!ptr_backlog)
+    {
+        ptr_backlog = relay_irc_backlog_new (buffer);
+        if (!ptr_backlog)
+            return NULL;
+        weechat_hashtable_set (relay_irc_backlog_buffers, buffer, ptr_backlog);
+    }
+
+    return ptr_backlog;
+}
+
+/*
+ * Searches the first line in backlog with a date greater than or equal to
+ * "date" (binary search, lines are sorted by date).
+ *
+ * Returns index of line, backlog->count if all lines are older.
+ */
+
+int
+relay_irc_backlog_search_date (struct t_relay_irc_backlog *backlog,
+                               time_t date)
+{
+    int low, high, middle;
+
+    low = 0;
+    high = backlog->count;
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+        if (RELAY_IRC_BACKLOG_LINE(backlog, middle)->date < date)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/*
+ * Sends backlog of a channel to client.
+ */
+
+void
+relay_irc_backlog_send (struct t_relay_client *client,
+                        const char *channel,
+                        struct t_gui_buffer *buffer)
+{
+    struct t_relay_irc_backlog *ptr_backlog;
+    struct t_relay_irc_backlog_line *ptr_line;
+    struct t_relay_server *ptr_server;
+    const char *localvar_nick, *ptr_encoded;
+    int i, first, max_number, max_minutes, server_time;
+    time_t date_min, date_min2;
+
+    ptr_backlog = relay_irc_backlog_get (buffer);
+    if (!ptr_backlog)
+        return;
+
+    relay_irc_backlog_remove_old_lines (ptr_backlog);
+    if (ptr_backlog->count == 0)
+        return;
+
+    max_number = weechat_config_integer (relay_config_irc_backlog_max_number);
+    max_minutes = weechat_config_integer (relay_config_irc_backlog_max_minutes);
+    date_min = (max_minutes > 0) ? time (NULL) - (max_minutes * 60) : 0;
+    if (weechat_config_boolean (relay_config_irc_backlog_since_last_disconnect))
+    {
+        ptr_server = relay_server_search (client->protocol_string);
+        if (ptr_server && (ptr_server->last_client_disconnect > 0))
+        {
+            date_min2 = ptr_server->last_client_disconnect;
+            if (date_min2 > date_min)
+                date_min = date_min2;
+        }
+    }
+
+    /* first line to send: according to max minutes and max number of lines */
+    first = (date_min > 0) ?
+        relay_irc_backlog_search_date (ptr_backlog, date_min) : 0;
+    if ((max_number > 0) && (ptr_backlog->count - first > max_number))
+        first = ptr_backlog->count - max_number;
+
+    /* start from the last line sent by the current nick (included) */
+    if (weechat_config_boolean (relay_config_irc_backlog_since_last_message))
+    {
+        localvar_nick = weechat_buffer_get_string (buffer, "localvar_nick");
+        if (localvar_nick && localvar_nick[0])
+        {
+            for (i = ptr_backlog->count - 1; i >= first; i--)
+            {
+                ptr_line = RELAY_IRC_BACKLOG_LINE(ptr_backlog, i);
+                if (ptr_line->nick
+                    && (strcmp (ptr_line->nick, localvar_nick) == 0))
+                {
+                    first = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    /* IRC messages already built are valid only for same server/channel */
+    if (!ptr_backlog->server
+        || (strcmp (ptr_backlog->server, client->protocol_args) != 0)
+        || !ptr_backlog->channel
+        || (strcmp (ptr_backlog->channel, channel) != 0))
+    {
+        for (i = 0; i < ptr_backlog->count; i++)
+        {
+            relay_irc_backlog_line_free_encoded (
+                RELAY_IRC_BACKLOG_LINE(ptr_backlog, i));
+        }
+        if (ptr_backlog->server)
+            free (ptr_backlog->server);
+        ptr_backlog->server = strdup (client->protocol_args);
+        if (ptr_backlog->channel)
+            free (ptr_backlog->channel);
+        ptr_backlog->channel = strdup (channel);
+    }
+
+    server_time = (RELAY_IRC_DATA(client, server_capabilities) & (1 << RELAY_IRC_CAPAB_SERVER_TIME)) ?
+        1 : 0;
+
+    for (i = first; i < ptr_backlog->count; i++)
+    {
+        ptr_encoded = relay_irc_backlog_line_get_encoded (
+            client, RELAY_IRC_BACKLOG_LINE(ptr_backlog, i), channel,
+            server_time);
+        if (ptr_encoded)
+        {
+            relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
+                               ptr_encoded, strlen (ptr_encoded), NULL, NULL);
+        }
+    }
+}
+
+/*
+ * Frees backlog of all buffers (it will be built again when needed).
+ */
+
+void
+relay_irc_backlog_free_all ()
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (relay_irc_backlog_hook_signal[i])
+        {
+            weechat_unhook (relay_irc_backlog_hook_signal[i]);
+            relay_irc_backlog_hook_signal[i] = NULL;
+        }
+    }
+
+    if (relay_irc_backlog_buffers)
+    {
+        weechat_hashtable_free (relay_irc_backlog_buffers);
+        relay_irc_backlog_buffers = NULL;
+    }
+}
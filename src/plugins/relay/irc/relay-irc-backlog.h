@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_IRC_BACKLOG_H
+#define WEECHAT_RELAY_IRC_BACKLOG_H 1
+
+#include <time.h>
+
+struct t_relay_client;
+
+#define RELAY_IRC_BACKLOG_MIN_SIZE 64  /* min size of ring (no max number)  */
+
+/* line of backlog (line of buffer which can be sent to clients) */
+
+struct t_relay_irc_backlog_line
+{
+    time_t date;                       /* date of line                      */
+    int command;                       /* IRC command (RELAY_IRC_CMD_xxx)   */
+    int action;                        /* 1 if action (/me)                 */
+    char *nick;                        /* nick (can be NULL)                */
+    char *nick1;                       /* old nick for "NICK" (can be NULL) */
+    char *nick2;                       /* new nick for "NICK" (can be NULL) */
+    char *host;                        /* host (can be NULL)                */
+    char *message;                     /* message without colors (privmsg)  */
+    char *encoded[2];                  /* IRC messages sent to client,      */
+                                       /* without/with capability           */
+                                       /* "server-time" (NULL if not built) */
+};
+
+/* backlog of a buffer (ring of lines, sorted by date) */
+
+struct t_relay_irc_backlog
+{
+    struct t_gui_buffer *buffer;       /* IRC buffer (channel or private)   */
+    struct t_relay_irc_backlog_line **lines; /* ring of lines               */
+    int size;                          /* size of ring                      */
+    int start;                         /* index of oldest line in ring      */
+    int count;                         /* number of lines in ring           */
+    char *server;                      /* server used in encoded messages   */
+    char *channel;                     /* channel used in encoded messages  */
+};
+
+extern void relay_irc_backlog_send (struct t_relay_client *client,
+                                    const char *channel,
+                                    struct t_gui_buffer *buffer);
+extern void relay_irc_backlog_free_all ();
+
+#endif /* WEECHAT_RELAY_IRC_BACKLOG_H */
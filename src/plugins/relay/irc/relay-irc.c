@@ -31,6 +31,7 @@
 #include "../../weechat-plugin.h"
 #include "../relay.h"
 #include "relay-irc.h"
+#include "relay-irc-backlog.h"
 #include "../relay-buffer.h"
 #include "../relay-client.h"
 #include "../relay-config.h"
@@ -45,6 +46,10 @@ char *relay_irc_backlog_commands_tags[RELAY_IRC_NUM_CMD] =
 char *relay_irc_server_capabilities[RELAY_IRC_NUM_CAPAB] =
 { "server-time" };
 
+/* signals shared by all clients (message parsed once for all clients) */
+struct t_hook *relay_irc_hook_signal_irc_in2 = NULL;
+struct t_hook *relay_irc_hook_signal_irc_outtags = NULL;
+
 
 /*
  * Checks if IRC command has to be relayed to client.
@@ -185,74 +190,184 @@ end:
 }
 
 /*
- * Sends formatted data to client.
+ * Splits a message for a server (message is truncated on first "\r" or
+ * "\n").
+ *
+ * Returns hashtable with split message ("msg1", "msg2", ...), NULL if error.
+ *
+ * Note: result must be freed after use.
  */
 
-void
-relay_irc_sendf (struct t_relay_client *client, const char *format, ...)
+struct t_hashtable *
+relay_irc_message_split (const char *server, const char *message)
 {
-    int length, number;
-    char *pos, hash_key[32], *message;
-    const char *str_message;
+    char *message2, *pos;
     struct t_hashtable *hashtable_in, *hashtable_out;
 
-    if (!client)
-        return;
+    message2 = strdup (message);
+    if (!message2)
+        return NULL;
 
-    weechat_va_format (format);
-    if (!vbuffer)
-        return;
-
-    pos = strchr (vbuffer, '\r');
+    pos = strchr (message2, '\r');
     if (pos)
         pos[0] = '\0';
-    pos = strchr (vbuffer, '\n');
+    pos = strchr (message2, '\n');
     if (pos)
         pos[0] = '\0';
 
+    hashtable_out = NULL;
+
     hashtable_in = weechat_hashtable_new (32,
                                           WEECHAT_HASHTABLE_STRING,
                                           WEECHAT_HASHTABLE_STRING,
                                           NULL, NULL);
     if (hashtable_in)
     {
-        weechat_hashtable_set (hashtable_in, "server", client->protocol_args);
-        weechat_hashtable_set (hashtable_in, "message", vbuffer);
+        weechat_hashtable_set (hashtable_in, "server", server);
+        weechat_hashtable_set (hashtable_in, "message", message2);
         hashtable_out = weechat_info_get_hashtable ("irc_message_split",
                                                     hashtable_in);
-        if (hashtable_out)
+        weechat_hashtable_free (hashtable_in);
+    }
+
+    free (message2);
+
+    return hashtable_out;
+}
+
+/*
+ * Sends a split message (hashtable returned by relay_irc_message_split) to
+ * client.
+ */
+
+void
+relay_irc_send_split (struct t_relay_client *client,
+                      struct t_hashtable *hash_split)
+{
+    int length, number;
+    char hash_key[32], *message;
+    const char *str_message;
+
+    number = 1;
+    while (1)
+    {
+        snprintf (hash_key, sizeof (hash_key), "msg%d", number);
+        str_message = weechat_hashtable_get (hash_split, hash_key);
+        if (!str_message)
+            break;
+        length = strlen (str_message) + 16 + 1;
+        message = malloc (length);
+        if (message)
         {
-            number = 1;
-            while (1)
-            {
-                snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                str_message = weechat_hashtable_get (hashtable_out, hash_key);
-                if (!str_message)
-                    break;
-                length = strlen (str_message) + 16 + 1;
-                message = malloc (length);
-                if (message)
-                {
-                    snprintf (message, length, "%s\r\n", str_message);
-                    relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                                       message, strlen (message), NULL);
-                    free (message);
-                }
-                number++;
-            }
-            weechat_hashtable_free (hashtable_out);
+            snprintf (message, length, "%s\r\n", str_message);
+            relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
+                               message, strlen (message), NULL, NULL);
+            free (message);
         }
-        weechat_hashtable_free (hashtable_in);
+        number++;
+    }
+}
+
+/*
+ * Sends formatted data to client.
+ */
+
+void
+relay_irc_sendf (struct t_relay_client *client, const char *format, ...)
+{
+    struct t_hashtable *hash_split;
+
+    if (!client)
+        return;
+
+    weechat_va_format (format);
+    if (!vbuffer)
+        return;
+
+    hash_split = relay_irc_message_split (client->protocol_args, vbuffer);
+    if (hash_split)
+    {
+        relay_irc_send_split (client, hash_split);
+        weechat_hashtable_free (hash_split);
     }
 
     free (vbuffer);
 }
 
 /*
- * Callback for signal "irc_in2".
+ * Sends a message to a client, when the same message is sent to many clients
+ * of a server: the message is split only once, the split message is kept in
+ * "cache_message" and "cache_split" and reused as long as the message is the
+ * same.
+ *
+ * Cached variables must be initialized to NULL by caller, and freed by caller
+ * after the last call.
+ */
+
+void
+relay_irc_send_cached (struct t_relay_client *client, const char *message,
+                       char **cache_message, struct t_hashtable **cache_split)
+{
+    if (!*cache_message || (strcmp (*cache_message, message) != 0))
+    {
+        if (*cache_message)
+            free (*cache_message);
+        if (*cache_split)
+            weechat_hashtable_free (*cache_split);
+        *cache_message = strdup (message);
+        *cache_split = relay_irc_message_split (client->protocol_args,
+                                                message);
+    }
+
+    if (*cache_split)
+        relay_irc_send_split (client, *cache_split);
+}
+
+/*
+ * Gets server name from a signal name "server,irc_xxx_yyy".
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_irc_get_signal_server (const char *signal)
+{
+    const char *pos;
+
+    pos = strchr (signal, ',');
+    if (!pos || (pos == signal))
+        return NULL;
+
+    return weechat_strndup (signal, pos - signal);
+}
+
+/*
+ * Checks if IRC messages received/sent on a server must be relayed to a
+ * client.
+ *
+ * Returns:
+ *   1: messages must be relayed to client
+ *   0: messages must not be relayed to client
+ */
+
+int
+relay_irc_client_relays_server (struct t_relay_client *client,
+                                const char *server)
+{
+    return ((client->protocol == RELAY_PROTOCOL_IRC)
+            && client->protocol_data
+            && RELAY_IRC_DATA(client, relay_messages)
+            && client->protocol_args
+            && (weechat_strcasecmp (client->protocol_args, server) == 0)) ?
+        1 : 0;
+}
+
+/*
+ * Callback for signal "irc_in2" (shared by all clients).
  *
  * This is called when something is received on IRC server, and message can be
- * relayed (or not) to client.
+ * relayed (or not) to clients: the message is parsed only once, then sent to
+ * all clients connected to this server.
  */
 
 int
@@ -260,31 +375,56 @@ relay_irc_signal_irc_in2_cb (const void *pointer, void *data,
                              const char *signal,
                              const char *type_data, void *signal_data)
 {
-    struct t_relay_client *client;
+    struct t_relay_client *ptr_client, *ptr_next_client;
     const char *ptr_msg, *irc_nick, *irc_host, *irc_command, *irc_args;
-    struct t_hashtable *hash_parsed;
+    char *server, *message, *cache_message;
+    struct t_hashtable *hash_parsed, *cache_split;
+    int length;
 
     /* make C compiler happy */
+    (void) pointer;
     (void) data;
-    (void) signal;
     (void) type_data;
 
-    client = (struct t_relay_client *)pointer;
     ptr_msg = (const char *)signal_data;
 
-    if (weechat_relay_plugin->debug >= 2)
-    {
-        weechat_printf (NULL, "%s: irc_in2: client: %s%s%s, data: %s",
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        ptr_msg);
-    }
+    server = relay_irc_get_signal_server (signal);
+    if (!server)
+        return WEECHAT_RC_OK;
 
-    hash_parsed = relay_irc_message_parse (ptr_msg);
-    if (hash_parsed)
+    hash_parsed = NULL;
+    cache_message = NULL;
+    cache_split = NULL;
+
+    ptr_client = relay_clients;
+    while (ptr_client)
     {
+        ptr_next_client = ptr_client->next_client;
+
+        if (!relay_irc_client_relays_server (ptr_client, server))
+        {
+            ptr_client = ptr_next_client;
+            continue;
+        }
+
+        if (weechat_relay_plugin->debug >= 2)
+        {
+            weechat_printf (NULL, "%s: irc_in2: client: %s%s%s, data: %s",
+                            RELAY_PLUGIN_NAME,
+                            RELAY_COLOR_CHAT_CLIENT,
+                            ptr_client->desc,
+                            RELAY_COLOR_CHAT,
+                            ptr_msg);
+        }
+
+        /* parse message (only once, for the first client) */
+        if (!hash_parsed)
+        {
+            hash_parsed = relay_irc_message_parse (ptr_msg);
+            if (!hash_parsed)
+                break;
+        }
+
         irc_nick = weechat_hashtable_get (hash_parsed, "nick");
         irc_host = weechat_hashtable_get (hash_parsed, "host");
         irc_command = weechat_hashtable_get (hash_parsed, "command");
@@ -294,12 +434,13 @@ relay_irc_signal_irc_in2_cb (const void *pointer, void *data,
         if (irc_command && (weechat_strcasecmp (irc_command, "nick") == 0)
             && irc_nick && irc_nick[0]
             && irc_args && irc_args[0]
-            && (weechat_strcasecmp (irc_nick, RELAY_IRC_DATA(client, nick)) == 0))
+            && (weechat_strcasecmp (irc_nick,
+                                    RELAY_IRC_DATA(ptr_client, nick)) == 0))
         {
-            if (RELAY_IRC_DATA(client, nick))
-                free (RELAY_IRC_DATA(client, nick));
-            RELAY_IRC_DATA(client, nick) = strdup ((irc_args[0] == ':') ?
-                                                   irc_args + 1 : irc_args);
+            if (RELAY_IRC_DATA(ptr_client, nick))
+                free (RELAY_IRC_DATA(ptr_client, nick));
+            RELAY_IRC_DATA(ptr_client, nick) = strdup (
+                (irc_args[0] == ':') ? irc_args + 1 : irc_args);
         }
 
         /* relay all commands to client, but not ping/pong */
@@ -307,15 +448,34 @@ relay_irc_signal_irc_in2_cb (const void *pointer, void *data,
             && (weechat_strcasecmp (irc_command, "ping") != 0)
             && (weechat_strcasecmp (irc_command, "pong") != 0))
         {
-            relay_irc_sendf (client, ":%s %s %s",
-                             (irc_host && irc_host[0]) ? irc_host : RELAY_IRC_DATA(client, address),
-                             irc_command,
-                             irc_args);
+            if (!irc_host || !irc_host[0])
+                irc_host = RELAY_IRC_DATA(ptr_client, address);
+            if (!irc_args)
+                irc_args = "";
+            length = 1 + strlen (irc_host) + 1 + strlen (irc_command) + 1
+                + strlen (irc_args) + 1;
+            message = malloc (length);
+            if (message)
+            {
+                snprintf (message, length, ":%s %s %s",
+                          irc_host, irc_command, irc_args);
+                relay_irc_send_cached (ptr_client, message,
+                                       &cache_message, &cache_split);
+                free (message);
+            }
         }
 
-        weechat_hashtable_free (hash_parsed);
+        ptr_client = ptr_next_client;
     }
 
+    if (hash_parsed)
+        weechat_hashtable_free (hash_parsed);
+    if (cache_message)
+        free (cache_message);
+    if (cache_split)
+        weechat_hashtable_free (cache_split);
+    free (server);
+
     return WEECHAT_RC_OK;
 }
 
@@ -361,10 +521,11 @@ relay_irc_tag_relay_client_id (const char *tags)
 }
 
 /*
- * Callback for signal "irc_outtags".
+ * Callback for signal "irc_outtags" (shared by all clients).
  *
  * This is called when a message is sent to IRC server (by irc plugin or any
- * other plugin/script).
+ * other plugin/script): the message is parsed only once, then sent to all
+ * clients connected to this server.
  */
 
 int
@@ -373,21 +534,33 @@ relay_irc_signal_irc_outtags_cb (const void *pointer, void *data,
                                  const char *type_data,
                                  void *signal_data)
 {
-    struct t_relay_client *client;
-    struct t_hashtable *hash_parsed;
+    struct t_relay_client *ptr_client, *ptr_next_client;
+    struct t_hashtable *hash_parsed, *cache_split;
     const char *irc_command, *irc_args, *host, *ptr_message;
-    char *pos, *tags, *irc_channel, *message;
+    char *pos, *tags, *irc_channel, *message, *server, *message_client;
+    char *cache_message, *host_nick, *host_found;
     struct t_infolist *infolist_nick;
     char str_infolist_args[256];
+    int client_id, parsed, length;
 
     /* make C compiler happy */
+    (void) pointer;
     (void) data;
-    (void) signal;
     (void) type_data;
 
-    client = (struct t_relay_client *)pointer;
-
     tags = NULL;
+    hash_parsed = NULL;
+    parsed = 0;
+    irc_command = NULL;
+    irc_channel = NULL;
+    host_nick = NULL;
+    host_found = NULL;
+    cache_message = NULL;
+    cache_split = NULL;
+
+    server = relay_irc_get_signal_server (signal);
+    if (!server)
+        return WEECHAT_RC_OK;
 
     message = strdup ((char *)signal_data);
     if (!message)
@@ -398,16 +571,6 @@ relay_irc_signal_irc_outtags_cb (const void *pointer, void *data,
 
     ptr_message = message;
 
-    if (weechat_relay_plugin->debug >= 2)
-    {
-        weechat_printf (NULL, "%s: irc_outtags: client: %s%s%s, message: %s",
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        message);
-    }
-
     pos = strchr (ptr_message, ';');
     if (pos)
     {
@@ -416,64 +579,146 @@ relay_irc_signal_irc_outtags_cb (const void *pointer, void *data,
         ptr_message = pos + 1;
     }
 
-    /*
-     * We check if there is a tag "relay_client_NNN" and if NNN (numeric)
-     * is equal to current client, then we ignore message, because message
-     * was sent from this same client!
-     * This is to prevent message from being displayed twice on client.
-     */
-    if (relay_irc_tag_relay_client_id (tags) == client->id)
-        goto end;
+    client_id = relay_irc_tag_relay_client_id (tags);
 
-    hash_parsed = relay_irc_message_parse (ptr_message);
-    if (hash_parsed)
+    ptr_client = relay_clients;
+    while (ptr_client)
     {
-        irc_command = weechat_hashtable_get (hash_parsed, "command");
-        irc_args = weechat_hashtable_get (hash_parsed, "arguments");
+        ptr_next_client = ptr_client->next_client;
 
-        pos = strchr (irc_args, ' ');
-        irc_channel = (pos) ?
-            weechat_strndup (irc_args, pos - irc_args) : strdup (irc_args);
+        if (!relay_irc_client_relays_server (ptr_client, server))
+        {
+            ptr_client = ptr_next_client;
+            continue;
+        }
 
-        /* if command has to be relayed, relay it to client */
-        if (irc_command && irc_command[0]
-            && irc_channel && irc_channel[0]
-            && relay_irc_command_relayed (irc_command))
+        if (weechat_relay_plugin->debug >= 2)
         {
-            /* get host for nick (it is self nick) */
+            weechat_printf (NULL,
+                            "%s: irc_outtags: client: %s%s%s, message: %s",
+                            RELAY_PLUGIN_NAME,
+                            RELAY_COLOR_CHAT_CLIENT,
+                            ptr_client->desc,
+                            RELAY_COLOR_CHAT,
+                            message);
+        }
+
+        /*
+         * We check if there is a tag "relay_client_NNN" and if NNN (numeric)
+         * is equal to current client, then we ignore message, because message
+         * was sent from this same client!
+         * This is to prevent message from being displayed twice on client.
+         */
+        if (client_id == ptr_client->id)
+        {
+            ptr_client = ptr_next_client;
+            continue;
+        }
+
+        /* parse message (only once, for the first client) */
+        if (!parsed)
+        {
+            parsed = 1;
+            hash_parsed = relay_irc_message_parse (ptr_message);
+            if (!hash_parsed)
+                break;
+            irc_command = weechat_hashtable_get (hash_parsed, "command");
+            irc_args = weechat_hashtable_get (hash_parsed, "arguments");
+            if (irc_args)
+            {
+                pos = strchr (irc_args, ' ');
+                irc_channel = (pos) ?
+                    weechat_strndup (irc_args, pos - irc_args) :
+                    strdup (irc_args);
+            }
+            /* if command has not to be relayed, do nothing */
+            if (!irc_command || !irc_command[0]
+                || !irc_channel || !irc_channel[0]
+                || !relay_irc_command_relayed (irc_command))
+            {
+                break;
+            }
+        }
+
+        /*
+         * get host for nick (it is self nick); the host is kept for next
+         * clients using the same nick
+         */
+        if (!host_nick
+            || !RELAY_IRC_DATA(ptr_client, nick)
+            || (strcmp (host_nick, RELAY_IRC_DATA(ptr_client, nick)) != 0))
+        {
+            if (host_nick)
+            {
+                free (host_nick);
+                host_nick = NULL;
+            }
+            if (host_found)
+            {
+                free (host_found);
+                host_found = NULL;
+            }
             snprintf (str_infolist_args, sizeof (str_infolist_args),
                       "%s,%s,%s",
-                      client->protocol_args,
+                      ptr_client->protocol_args,
                       irc_channel,
-                      RELAY_IRC_DATA(client, nick));
-
-            host = NULL;
+                      RELAY_IRC_DATA(ptr_client, nick));
             infolist_nick = weechat_infolist_get ("irc_nick", NULL,
                                                   str_infolist_args);
-            if (infolist_nick && weechat_infolist_next (infolist_nick))
-                host = weechat_infolist_string (infolist_nick, "host");
-
-            /* send message to client */
-            relay_irc_sendf (client,
-                             ":%s%s%s %s",
-                             RELAY_IRC_DATA(client, nick),
-                             (host && host[0]) ? "!" : "",
-                             (host && host[0]) ? host : "",
-                             ptr_message);
-
             if (infolist_nick)
+            {
+                if (weechat_infolist_next (infolist_nick))
+                {
+                    host = weechat_infolist_string (infolist_nick, "host");
+                    if (host)
+                        host_found = strdup (host);
+                }
                 weechat_infolist_free (infolist_nick);
+            }
+            if (RELAY_IRC_DATA(ptr_client, nick))
+                host_nick = strdup (RELAY_IRC_DATA(ptr_client, nick));
         }
-        if (irc_channel)
-            free (irc_channel);
-        weechat_hashtable_free (hash_parsed);
+
+        /* send message to client */
+        length = 1 + ((RELAY_IRC_DATA(ptr_client, nick)) ?
+                      strlen (RELAY_IRC_DATA(ptr_client, nick)) : 6)
+            + 1 + ((host_found) ? strlen (host_found) : 0)
+            + 1 + strlen (ptr_message) + 1;
+        message_client = malloc (length);
+        if (message_client)
+        {
+            snprintf (message_client, length,
+                      ":%s%s%s %s",
+                      RELAY_IRC_DATA(ptr_client, nick),
+                      (host_found && host_found[0]) ? "!" : "",
+                      (host_found && host_found[0]) ? host_found : "",
+                      ptr_message);
+            relay_irc_send_cached (ptr_client, message_client,
+                                   &cache_message, &cache_split);
+            free (message_client);
+        }
+
+        ptr_client = ptr_next_client;
     }
 
 end:
+    if (hash_parsed)
+        weechat_hashtable_free (hash_parsed);
+    if (irc_channel)
+        free (irc_channel);
+    if (host_nick)
+        free (host_nick);
+    if (host_found)
+        free (host_found);
+    if (cache_message)
+        free (cache_message);
+    if (cache_split)
+        weechat_hashtable_free (cache_split);
     if (message)
         free (message);
     if (tags)
         free (tags);
+    free (server);
 
     return WEECHAT_RC_OK;
 }
@@ -574,384 +819,6 @@ relay_irc_hsignal_irc_redir_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
-/*
- * Gets info about a line in a buffer:
- *   - irc command
- *   - date
- *   - nick
- *   - nick1 and nick2 (old and new nick for irc "nick" command)
- *   - host
- *   - message (without colors).
- *
- * Arguments hdata_line_data and line_data must be non NULL, the other arguments
- * can be NULL.
- *
- * Note: tags and message (if given and filled) must be freed after use.
- */
-
-void
-relay_irc_get_line_info (struct t_relay_client *client,
-                         struct t_gui_buffer *buffer,
-                         struct t_hdata *hdata_line_data, void *line_data,
-                         int *irc_command, int *irc_action, time_t *date,
-                         const char **nick, const char **nick1,
-                         const char **nick2, const char **host,
-                         char **tags, char **message)
-{
-    int i, num_tags, command, action, all_tags, length;
-    char str_tag[256], *pos, *message_no_color, str_time[256];
-    const char *ptr_tag, *ptr_message, *ptr_nick, *ptr_nick1, *ptr_nick2;
-    const char *ptr_host, *localvar_nick, *time_format;
-    time_t msg_date;
-    struct tm *tm;
-
-    if (irc_command)
-        *irc_command = -1;
-    if (irc_action)
-        *irc_action = 0;
-    if (date)
-        *date = 0;
-    if (nick)
-        *nick = NULL;
-    if (nick1)
-        *nick1 = NULL;
-    if (nick2)
-        *nick2 = NULL;
-    if (host)
-        *host = NULL;
-    if (tags)
-        *tags = NULL;
-    if (message)
-        *message = NULL;
-
-    msg_date = weechat_hdata_time (hdata_line_data, line_data, "date");
-    num_tags = weechat_hdata_get_var_array_size (hdata_line_data, line_data,
-                                                 "tags_array");
-    ptr_message = weechat_hdata_pointer (hdata_line_data, line_data, "message");
-
-    /* no tag found, or no message? just exit */
-    if ((num_tags <= 0) || !ptr_message)
-        return;
-
-    command = -1;
-    action = 0;
-    ptr_nick = NULL;
-    ptr_nick1 = NULL;
-    ptr_nick2 = NULL;
-    ptr_host = NULL;
-    all_tags = weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
-                                          "*");
-    for (i = 0; i < num_tags; i++)
-    {
-        snprintf (str_tag, sizeof (str_tag), "%d|tags_array", i);
-        ptr_tag = weechat_hdata_string (hdata_line_data, line_data, str_tag);
-        if (ptr_tag)
-        {
-            if (strcmp (ptr_tag, "irc_action") == 0)
-                action = 1;
-            else if (strncmp (ptr_tag, "nick_", 5) == 0)
-                ptr_nick = ptr_tag + 5;
-            else if (strncmp (ptr_tag, "irc_nick1_", 10) == 0)
-                ptr_nick1 = ptr_tag + 10;
-            else if (strncmp (ptr_tag, "irc_nick2_", 10) == 0)
-                ptr_nick2 = ptr_tag + 10;
-            else if (strncmp (ptr_tag, "host_", 5) == 0)
-                ptr_host = ptr_tag + 5;
-            else if ((command < 0)
-                     && (all_tags
-                         || (weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
-                                                        ptr_tag))))
-            {
-                command = relay_irc_search_backlog_commands_tags (ptr_tag);
-            }
-        }
-    }
-
-    /* not a supported IRC command? */
-    if (command < 0)
-        return;
-
-    /* ignore join/part/quit from self nick */
-    if ((command == RELAY_IRC_CMD_JOIN) || (command == RELAY_IRC_CMD_PART)
-        || (command == RELAY_IRC_CMD_QUIT))
-    {
-        localvar_nick = weechat_buffer_get_string (buffer, "localvar_nick");
-        if (localvar_nick && localvar_nick[0]
-            && ptr_nick && (strcmp (ptr_nick, localvar_nick) == 0))
-        {
-            return;
-        }
-    }
-
-    /* fills variables with the line data */
-    if (irc_command)
-        *irc_command = command;
-    if (irc_action)
-        *irc_action = action;
-    if (date)
-        *date = msg_date;
-    if (nick)
-        *nick = ptr_nick;
-    if (nick1)
-        *nick1 = ptr_nick1;
-    if (nick2)
-        *nick2 = ptr_nick2;
-    if (host)
-        *host = ptr_host;
-    message_no_color = (ptr_message) ?
-        weechat_string_remove_color (ptr_message, NULL) : NULL;
-
-    if ((command == RELAY_IRC_CMD_PRIVMSG) && message && message_no_color)
-    {
-        pos = message_no_color;
-        if (action)
-        {
-            pos = strchr (message_no_color, ' ');
-            if (pos)
-            {
-                while (pos[0] == ' ')
-                {
-                    pos++;
-                }
-            }
-            else
-                pos = message_no_color;
-        }
-        /*
-         * if server capability "server-time" is NOT enabled, and if the time
-         * format is not empty, add time inside message (before message)
-         */
-        time_format = weechat_config_string (relay_config_irc_backlog_time_format);
-        if (!(RELAY_IRC_DATA(client, server_capabilities) & (1 << RELAY_IRC_CAPAB_SERVER_TIME))
-            && time_format && time_format[0])
-        {
-            tm = localtime (&msg_date);
-            strftime (str_time, sizeof (str_time), time_format, tm);
-            length = strlen (str_time) + strlen (pos) + 1;
-            *message = malloc (length);
-            if (*message)
-                snprintf (*message, length, "%s%s", str_time, pos);
-        }
-        else
-            *message = strdup (pos);
-    }
-
-    /* if server capability "server-time" is enabled, add an irc tag with time */
-    if (tags
-        && (RELAY_IRC_DATA(client, server_capabilities) & (1 << RELAY_IRC_CAPAB_SERVER_TIME)))
-    {
-        tm = gmtime (&msg_date);
-        strftime (str_time, sizeof (str_time), "%Y-%m-%dT%H:%M:%S", tm);
-        snprintf (str_tag, sizeof (str_tag), "@time=%s.000Z ", str_time);
-        *tags = strdup (str_tag);
-    }
-
-    if (message_no_color)
-        free (message_no_color);
-}
-
-/*
- * Sends channel backlog to client.
- */
-
-void
-relay_irc_send_channel_backlog (struct t_relay_client *client,
-                                const char *channel,
-                                struct t_gui_buffer *buffer)
-{
-    struct t_relay_server *ptr_server;
-    void *ptr_own_lines, *ptr_line, *ptr_line_data;
-    void *ptr_hdata_line, *ptr_hdata_line_data;
-    char *tags, *message;
-    const char *ptr_nick, *ptr_nick1, *ptr_nick2, *ptr_host, *localvar_nick;
-    int irc_command, irc_action, count, max_number, max_minutes;
-    time_t date_min, date_min2, date;
-
-    /* get pointer on "own_lines" in buffer */
-    ptr_own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
-                                           buffer, "own_lines");
-    if (!ptr_own_lines)
-        return;
-
-    /* get pointer on "last_line" in lines */
-    ptr_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
-                                      ptr_own_lines, "last_line");
-    if (!ptr_line)
-        return;
-
-    /* get hdata "line" */
-    ptr_hdata_line = weechat_hdata_get ("line");
-    if (!ptr_hdata_line)
-        return;
-
-    /* get hdata "line_data" */
-    ptr_hdata_line_data = weechat_hdata_get ("line_data");
-    if (!ptr_hdata_line_data)
-        return;
-
-    localvar_nick = NULL;
-    if (weechat_config_boolean (relay_config_irc_backlog_since_last_message))
-        localvar_nick = weechat_buffer_get_string (buffer, "localvar_nick");
-
-    max_number = weechat_config_integer (relay_config_irc_backlog_max_number);
-    max_minutes = weechat_config_integer (relay_config_irc_backlog_max_minutes);
-    date_min = (max_minutes > 0) ? time (NULL) - (max_minutes * 60) : 0;
-    if (weechat_config_boolean (relay_config_irc_backlog_since_last_disconnect))
-    {
-        ptr_server = relay_server_search (client->protocol_string);
-        if (ptr_server && (ptr_server->last_client_disconnect > 0))
-        {
-            date_min2 = ptr_server->last_client_disconnect;
-            if (date_min2 > date_min)
-                date_min = date_min2;
-        }
-    }
-
-    /*
-     * loop on lines in buffer, from last to first, and stop when we have
-     * reached max number of lines (or max minutes)
-     */
-    count = 0;
-    while (ptr_line)
-    {
-        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line,
-                                               ptr_line, "data");
-        if (ptr_line_data)
-        {
-            relay_irc_get_line_info (client, buffer,
-                                     ptr_hdata_line_data, ptr_line_data,
-                                     &irc_command,
-                                     NULL, /* irc_action */
-                                     &date,
-                                     &ptr_nick,
-                                     NULL, /* nick1 */
-                                     NULL, /* nick2 */
-                                     NULL, /* host */
-                                     NULL, /* tags */
-                                     NULL); /* message */
-            if (irc_command >= 0)
-            {
-                /* if we have reached max minutes, exit loop */
-                if ((date_min > 0) && (date < date_min))
-                    break;
-                count++;
-            }
-            /* if we have reached max number of messages, exit loop */
-            if ((max_number > 0) && (count > max_number))
-                break;
-
-            if (localvar_nick && localvar_nick[0]
-                && ptr_nick && (strcmp (ptr_nick, localvar_nick) == 0))
-            {
-                /*
-                 * stop when we find a line sent by the current nick
-                 * (and include this line)
-                 */
-                ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, -1);
-                break;
-            }
-        }
-        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, -1);
-    }
-
-    if (!ptr_line)
-    {
-        /* if we have reached beginning of buffer, start from first line */
-        ptr_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
-                                          ptr_own_lines, "first_line");
-    }
-    else
-    {
-        /* start from line + 1 (the current line must not be sent) */
-        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
-    }
-
-    /*
-     * loop on lines from line pointer until last line of buffer, and for each
-     * irc message, sends it to client
-     */
-    while (ptr_line)
-    {
-        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line,
-                                               ptr_line, "data");
-        if (ptr_line_data)
-        {
-            relay_irc_get_line_info (client, buffer,
-                                     ptr_hdata_line_data, ptr_line_data,
-                                     &irc_command,
-                                     &irc_action,
-                                     &date,
-                                     &ptr_nick,
-                                     &ptr_nick1,
-                                     &ptr_nick2,
-                                     &ptr_host,
-                                     &tags,
-                                     &message);
-            switch (irc_command)
-            {
-                case RELAY_IRC_CMD_JOIN:
-                    relay_irc_sendf (client,
-                                     "%s:%s%s%s JOIN :%s",
-                                     (tags) ? tags : "",
-                                     ptr_nick,
-                                     (ptr_host) ? "!" : "",
-                                     (ptr_host) ? ptr_host : "",
-                                     channel);
-                    break;
-                case RELAY_IRC_CMD_PART:
-                    relay_irc_sendf (client,
-                                     "%s:%s%s%s PART %s",
-                                     (tags) ? tags : "",
-                                     ptr_nick,
-                                     (ptr_host) ? "!" : "",
-                                     (ptr_host) ? ptr_host : "",
-                                     channel);
-                case RELAY_IRC_CMD_QUIT:
-                    relay_irc_sendf (client,
-                                     "%s:%s%s%s QUIT",
-                                     (tags) ? tags : "",
-                                     ptr_nick,
-                                     (ptr_host) ? "!" : "",
-                                     (ptr_host) ? ptr_host : "");
-                    break;
-                case RELAY_IRC_CMD_NICK:
-                    if (ptr_nick1 && ptr_nick2)
-                    {
-                        relay_irc_sendf (client,
-                                         "%s:%s NICK :%s",
-                                         (tags) ? tags : "",
-                                         ptr_nick1,
-                                         ptr_nick2);
-                    }
-                    break;
-                case RELAY_IRC_CMD_PRIVMSG:
-                    if (ptr_nick && message)
-                    {
-                        relay_irc_sendf (client,
-                                         "%s:%s%s%s PRIVMSG %s :%s%s%s",
-                                         (tags) ? tags : "",
-                                         ptr_nick,
-                                         (ptr_host) ? "!" : "",
-                                         (ptr_host) ? ptr_host : "",
-                                         channel,
-                                         (irc_action) ? "\01ACTION " : "",
-                                         message,
-                                         (irc_action) ? "\01": "");
-                    }
-                    break;
-                case RELAY_IRC_NUM_CMD:
-                    /* make C compiler happy */
-                    break;
-            }
-            if (tags)
-                free (tags);
-            if (message)
-                free (message);
-        }
-        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
-    }
-}
-
 /*
  * Sends IRC "JOIN" for a channel to client.
  */
@@ -1076,7 +943,7 @@ relay_irc_send_join (struct t_relay_client *client,
 
         /* send backlog to client */
         if (buffer)
-            relay_irc_send_channel_backlog (client, channel, buffer);
+            relay_irc_backlog_send (client, channel, buffer);
     }
 }
 
@@ -1113,7 +980,7 @@ relay_irc_send_join_channels (struct t_relay_client *client)
             else if (type == 1)
             {
                 /* private */
-                relay_irc_send_channel_backlog (client, name, buffer);
+                relay_irc_backlog_send (client, name, buffer);
             }
         }
         weechat_infolist_free (infolist_channels);
@@ -1164,6 +1031,63 @@ relay_irc_input_send (struct t_relay_client *client, const char *irc_channel,
     free (vbuffer);
 }
 
+/*
+ * Hooks or unhooks the signals shared by all clients ("irc_in2" and
+ * "irc_outtags"): they are hooked if at least one client relays IRC
+ * messages, and unhooked when no client relays messages any more.
+ */
+
+void
+relay_irc_check_hook_signals_shared ()
+{
+    struct t_relay_client *ptr_client;
+    int relay_messages;
+
+    relay_messages = 0;
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if ((ptr_client->protocol == RELAY_PROTOCOL_IRC)
+            && ptr_client->protocol_data
+            && RELAY_IRC_DATA(ptr_client, relay_messages))
+        {
+            relay_messages = 1;
+            break;
+        }
+    }
+
+    if (relay_messages)
+    {
+        /* hook signal "xxx,irc_in2_*" to catch IRC data received */
+        if (!relay_irc_hook_signal_irc_in2)
+        {
+            relay_irc_hook_signal_irc_in2 = weechat_hook_signal (
+                "*,irc_in2_*",
+                &relay_irc_signal_irc_in2_cb, NULL, NULL);
+        }
+        /* hook signal "xxx,irc_outtags_*" to catch IRC data sent */
+        if (!relay_irc_hook_signal_irc_outtags)
+        {
+            relay_irc_hook_signal_irc_outtags = weechat_hook_signal (
+                "*,irc_outtags_*",
+                &relay_irc_signal_irc_outtags_cb, NULL, NULL);
+        }
+    }
+    else
+    {
+        if (relay_irc_hook_signal_irc_in2)
+        {
+            weechat_unhook (relay_irc_hook_signal_irc_in2);
+            relay_irc_hook_signal_irc_in2 = NULL;
+        }
+        if (relay_irc_hook_signal_irc_outtags)
+        {
+            weechat_unhook (relay_irc_hook_signal_irc_outtags);
+            relay_irc_hook_signal_irc_outtags = NULL;
+        }
+    }
+}
+
 /*
  * Hooks signals for a client.
  */
@@ -1171,35 +1095,17 @@ relay_irc_input_send (struct t_relay_client *client, const char *irc_channel,
 void
 relay_irc_hook_signals (struct t_relay_client *client)
 {
-    char str_signal_name[128];
-
     /* do nothing if "protocol_args" (irc server name) is not yet initialized */
     if (!client->protocol_args)
         return;
 
     /*
-     * hook signal "xxx,irc_in2_*" to catch IRC data received from
-     * this server
-     */
-    snprintf (str_signal_name, sizeof (str_signal_name),
-              "%s,irc_in2_*",
-              client->protocol_args);
-    RELAY_IRC_DATA(client, hook_signal_irc_in2) =
-        weechat_hook_signal (str_signal_name,
-                             &relay_irc_signal_irc_in2_cb,
-                             client, NULL);
-
-    /*
-     * hook signal "xxx,irc_outtags_*" to catch IRC data sent to
-     * this server
+     * relay IRC data received from/sent to this server (signals
+     * "xxx,irc_in2_*" and "xxx,irc_outtags_*" are hooked once for all
+     * clients)
      */
-    snprintf (str_signal_name, sizeof (str_signal_name),
-              "%s,irc_outtags_*",
-              client->protocol_args);
-    RELAY_IRC_DATA(client, hook_signal_irc_outtags) =
-        weechat_hook_signal (str_signal_name,
-                             &relay_irc_signal_irc_outtags_cb,
-                             client, NULL);
+    RELAY_IRC_DATA(client, relay_messages) = 1;
+    relay_irc_check_hook_signals_shared ();
 
     /*
      * hook signal "irc_server_disconnected" to disconnect client if
@@ -1756,15 +1662,10 @@ relay_irc_close_connection (struct t_relay_client *client)
 {
     RELAY_IRC_DATA(client, connected) = 0;
 
-    if (RELAY_IRC_DATA(client, hook_signal_irc_in2))
-    {
-        weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_in2));
-        RELAY_IRC_DATA(client, hook_signal_irc_in2) = NULL;
-    }
-    if (RELAY_IRC_DATA(client, hook_signal_irc_outtags))
+    if (RELAY_IRC_DATA(client, relay_messages))
     {
-        weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_outtags));
-        RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
+        RELAY_IRC_DATA(client, relay_messages) = 0;
+        relay_irc_check_hook_signals_shared ();
     }
     if (RELAY_IRC_DATA(client, hook_signal_irc_disc))
     {
@@ -1802,8 +1703,7 @@ relay_irc_alloc (struct t_relay_client *client)
         RELAY_IRC_DATA(client, cap_end_received) = 0;
         RELAY_IRC_DATA(client, connected) = 0;
         RELAY_IRC_DATA(client, server_capabilities) = 0;
-        RELAY_IRC_DATA(client, hook_signal_irc_in2) = NULL;
-        RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
+        RELAY_IRC_DATA(client, relay_messages) = 0;
         RELAY_IRC_DATA(client, hook_signal_irc_disc) = NULL;
         RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
     }
@@ -1838,14 +1738,13 @@ relay_irc_alloc_with_infolist (struct t_relay_client *client,
         RELAY_IRC_DATA(client, cap_end_received) = weechat_infolist_integer (infolist, "cap_end_received");
         RELAY_IRC_DATA(client, connected) = weechat_infolist_integer (infolist, "connected");
         RELAY_IRC_DATA(client, server_capabilities) = weechat_infolist_integer (infolist, "server_capabilities");
+        RELAY_IRC_DATA(client, relay_messages) = 0;
         if (RELAY_IRC_DATA(client, connected))
         {
             relay_irc_hook_signals (client);
         }
         else
         {
-            RELAY_IRC_DATA(client, hook_signal_irc_in2) = NULL;
-            RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
             RELAY_IRC_DATA(client, hook_signal_irc_disc) = NULL;
             RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
         }
@@ -1865,10 +1764,6 @@ relay_irc_free (struct t_relay_client *client)
             free (RELAY_IRC_DATA(client, address));
         if (RELAY_IRC_DATA(client, nick))
             free (RELAY_IRC_DATA(client, nick));
-        if (RELAY_IRC_DATA(client, hook_signal_irc_in2))
-            weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_in2));
-        if (RELAY_IRC_DATA(client, hook_signal_irc_outtags))
-            weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_outtags));
         if (RELAY_IRC_DATA(client, hook_signal_irc_disc))
             weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_disc));
         if (RELAY_IRC_DATA(client, hook_hsignal_irc_redir))
@@ -1877,6 +1772,8 @@ relay_irc_free (struct t_relay_client *client)
         free (client->protocol_data);
 
         client->protocol_data = NULL;
+
+        relay_irc_check_hook_signals_shared ();
     }
 }
 
@@ -1911,9 +1808,7 @@ relay_irc_add_to_infolist (struct t_infolist_item *item,
         return 0;
     if (!weechat_infolist_new_var_integer (item, "server_capabilities", RELAY_IRC_DATA(client, server_capabilities)))
         return 0;
-    if (!weechat_infolist_new_var_pointer (item, "hook_signal_irc_in2", RELAY_IRC_DATA(client, hook_signal_irc_in2)))
-        return 0;
-    if (!weechat_infolist_new_var_pointer (item, "hook_signal_irc_outtags", RELAY_IRC_DATA(client, hook_signal_irc_outtags)))
+    if (!weechat_infolist_new_var_integer (item, "relay_messages", RELAY_IRC_DATA(client, relay_messages)))
         return 0;
     if (!weechat_infolist_new_var_pointer (item, "hook_signal_irc_disc", RELAY_IRC_DATA(client, hook_signal_irc_disc)))
         return 0;
@@ -1940,8 +1835,7 @@ relay_irc_print_log (struct t_relay_client *client)
         weechat_log_printf ("    cap_end_received. . . . : %d",    RELAY_IRC_DATA(client, cap_end_received));
         weechat_log_printf ("    connected . . . . . . . : %d",    RELAY_IRC_DATA(client, connected));
         weechat_log_printf ("    server_capabilities . . : %d",    RELAY_IRC_DATA(client, server_capabilities));
-        weechat_log_printf ("    hook_signal_irc_in2 . . : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_in2));
-        weechat_log_printf ("    hook_signal_irc_outtags : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_outtags));
+        weechat_log_printf ("    relay_messages. . . . . : %d",    RELAY_IRC_DATA(client, relay_messages));
         weechat_log_printf ("    hook_signal_irc_disc. . : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_disc));
         weechat_log_printf ("    hook_hsignal_irc_redir. : 0x%lx", RELAY_IRC_DATA(client, hook_hsignal_irc_redir));
     }
@@ -38,8 +38,9 @@ struct t_relay_irc_data
                                        /* client                            */
     int server_capabilities;           /* server capabilities enabled (one  */
                                        /* bit per capability)               */
-    struct t_hook *hook_signal_irc_in2;     /* signal "irc_in2"             */
-    struct t_hook *hook_signal_irc_outtags; /* signal "irc_outtags"         */
+    int relay_messages;                /* 1 if IRC messages of server are   */
+                                       /* relayed to client (signals        */
+                                       /* "irc_in2" and "irc_outtags")      */
     struct t_hook *hook_signal_irc_disc;    /* signal "irc_disconnected"    */
     struct t_hook *hook_hsignal_irc_redir;  /* hsignal "irc_redirection_..."*/
 };
@@ -0,0 +1,591 @@
+/*
+ * relay-metrics.c - metrics protocol for relay to client (HTTP endpoint
+ *                   "/metrics" in Prometheus text format)
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "../../weechat-plugin.h"
+#include "../relay.h"
+#include "relay-metrics.h"
+#include "../relay-client.h"
+#include "../relay-config.h"
+
+
+char *relay_metrics_string = NULL;     /* metrics being built               */
+int relay_metrics_string_size = 0;     /* size allocated for metrics        */
+int relay_metrics_string_length = 0;   /* length of metrics                 */
+
+
+/*
+ * Adds a formatted string to metrics being built.
+ */
+
+void
+relay_metrics_printf (const char *format, ...)
+{
+    char *new_string;
+    int length, new_size;
+
+    weechat_va_format (format);
+    if (!vbuffer)
+        return;
+
+    length = strlen (vbuffer);
+    if (relay_metrics_string_length + length + 1 > relay_metrics_string_size)
+    {
+        new_size = (relay_metrics_string_size > 0) ?
+            relay_metrics_string_size * 2 : 4096;
+        while (relay_metrics_string_length + length + 1 > new_size)
+        {
+            new_size *= 2;
+        }
+        new_string = realloc (relay_metrics_string, new_size);
+        if (!new_string)
+        {
+            free (vbuffer);
+            return;
+        }
+        relay_metrics_string = new_string;
+        relay_metrics_string_size = new_size;
+    }
+    memcpy (relay_metrics_string + relay_metrics_string_length,
+            vbuffer, length + 1);
+    relay_metrics_string_length += length;
+
+    free (vbuffer);
+}
+
+/*
+ * Escapes a label value: backslash, double quote and new line are escaped
+ * with a backslash.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_metrics_escape_label (const char *value)
+{
+    char *result;
+    int i, j;
+
+    if (!value)
+        return strdup ("");
+
+    result = malloc ((strlen (value) * 2) + 1);
+    if (!result)
+        return NULL;
+
+    j = 0;
+    for (i = 0; value[i]; i++)
+    {
+        switch (value[i])
+        {
+            case '\\':
+            case '"':
+                result[j++] = '\\';
+                result[j++] = value[i];
+                break;
+            case '\n':
+                result[j++] = '\\';
+                result[j++] = 'n';
+                break;
+            default:
+                result[j++] = value[i];
+                break;
+        }
+    }
+    result[j] = '\0';
+
+    return result;
+}
+
+/*
+ * Adds metrics of relay clients (number of clients by protocol and status,
+ * size of out queues by protocol).
+ */
+
+void
+relay_metrics_build_relay ()
+{
+    struct t_relay_client *ptr_client;
+    int protocol, status, count;
+    unsigned long long outqueue_size;
+    long long outqueue_count;
+
+    relay_metrics_printf ("# HELP weechat_relay_clients Number of relay "
+                          "clients.\n"
+                          "# TYPE weechat_relay_clients gauge\n");
+    for (protocol = 0; protocol < RELAY_NUM_PROTOCOLS; protocol++)
+    {
+        for (status = 0; status < RELAY_NUM_STATUS; status++)
+        {
+            count = 0;
+            for (ptr_client = relay_clients; ptr_client;
+                 ptr_client = ptr_client->next_client)
+            {
+                if (((int)ptr_client->protocol == protocol)
+                    && ((int)ptr_client->status == status))
+                {
+                    count++;
+                }
+            }
+            relay_metrics_printf ("weechat_relay_clients"
+                                  "{protocol=\"%s\",status=\"%s\"} %d\n",
+                                  relay_protocol_string[protocol],
+                                  relay_client_status_name[status],
+                                  count);
+        }
+    }
+
+    relay_metrics_printf ("# HELP weechat_relay_outqueue_bytes Bytes waiting "
+                          "in out queue of relay clients.\n"
+                          "# TYPE weechat_relay_outqueue_bytes gauge\n");
+    for (protocol = 0; protocol < RELAY_NUM_PROTOCOLS; protocol++)
+    {
+        outqueue_size = 0;
+        for (ptr_client = relay_clients; ptr_client;
+             ptr_client = ptr_client->next_client)
+        {
+            if ((int)ptr_client->protocol == protocol)
+                outqueue_size += ptr_client->outqueue_size;
+        }
+        relay_metrics_printf ("weechat_relay_outqueue_bytes"
+                              "{protocol=\"%s\"} %llu\n",
+                              relay_protocol_string[protocol],
+                              outqueue_size);
+    }
+
+    relay_metrics_printf ("# HELP weechat_relay_outqueue_messages Messages "
+                          "waiting in out queue of relay clients.\n"
+                          "# TYPE weechat_relay_outqueue_messages gauge\n");
+    for (protocol = 0; protocol < RELAY_NUM_PROTOCOLS; protocol++)
+    {
+        outqueue_count = 0;
+        for (ptr_client = relay_clients; ptr_client;
+             ptr_client = ptr_client->next_client)
+        {
+            if ((int)ptr_client->protocol == protocol)
+                outqueue_count += ptr_client->outqueue_count;
+        }
+        relay_metrics_printf ("weechat_relay_outqueue_messages"
+                              "{protocol=\"%s\"} %lld\n",
+                              relay_protocol_string[protocol],
+                              outqueue_count);
+    }
+}
+
+/*
+ * Adds metrics of IRC servers (connection, lag, bytes received/sent).
+ *
+ * Servers are read with hdata "irc_server", so nothing is added if the irc
+ * plugin is not loaded.
+ */
+
+void
+relay_metrics_build_irc ()
+{
+    struct t_hdata *hdata;
+    void *ptr_server;
+    char *name;
+    int i;
+    const char *help[4][3] = {
+        { "weechat_irc_server_connected", "gauge",
+          "1 if connected to IRC server." },
+        { "weechat_irc_server_lag_seconds", "gauge",
+          "Lag with IRC server." },
+        { "weechat_irc_server_received_bytes_total", "counter",
+          "Bytes received from IRC server." },
+        { "weechat_irc_server_sent_bytes_total", "counter",
+          "Bytes sent to IRC server." },
+    };
+
+    hdata = weechat_hdata_get ("irc_server");
+    if (!hdata)
+        return;
+
+    for (i = 0; i < 4; i++)
+    {
+        relay_metrics_printf ("# HELP %s %s\n"
+                              "# TYPE %s %s\n",
+                              help[i][0], help[i][2],
+                              help[i][0], help[i][1]);
+        ptr_server = weechat_hdata_get_list (hdata, "irc_servers");
+        while (ptr_server)
+        {
+            name = relay_metrics_escape_label (
+                weechat_hdata_string (hdata, ptr_server, "name"));
+            if (name)
+            {
+                switch (i)
+                {
+                    case 0:
+                        relay_metrics_printf (
+                            "%s{server=\"%s\"} %d\n",
+                            help[i][0], name,
+                            weechat_hdata_integer (hdata, ptr_server,
+                                                   "is_connected"));
+                        break;
+                    case 1:
+                        relay_metrics_printf (
+                            "%s{server=\"%s\"} %.3f\n",
+                            help[i][0], name,
+                            ((double)weechat_hdata_integer (hdata, ptr_server,
+                                                            "lag")) / 1000);
+                        break;
+                    case 2:
+                        relay_metrics_printf (
+                            "%s{server=\"%s\"} %ld\n",
+                            help[i][0], name,
+                            weechat_hdata_long (hdata, ptr_server,
+                                                "stats_bytes_recv"));
+                        break;
+                    case 3:
+                        relay_metrics_printf (
+                            "%s{server=\"%s\"} %ld\n",
+                            help[i][0], name,
+                            weechat_hdata_long (hdata, ptr_server,
+                                                "stats_bytes_sent"));
+                        break;
+                }
+                free (name);
+            }
+            ptr_server = weechat_hdata_move (hdata, ptr_server, 1);
+        }
+    }
+}
+
+/*
+ * Builds all metrics: WeeChat core (info "metrics"), relay and IRC.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_metrics_build ()
+{
+    const char *ptr_core_metrics;
+    char *result;
+
+    relay_metrics_string = NULL;
+    relay_metrics_string_size = 0;
+    relay_metrics_string_length = 0;
+
+    ptr_core_metrics = weechat_info_get ("metrics", NULL);
+    if (ptr_core_metrics)
+        relay_metrics_printf ("%s", ptr_core_metrics);
+    relay_metrics_build_relay ();
+    relay_metrics_build_irc ();
+
+    result = relay_metrics_string;
+    relay_metrics_string = NULL;
+    relay_metrics_string_size = 0;
+    relay_metrics_string_length = 0;
+
+    return result;
+}
+
+/*
+ * Sends a HTTP response to client, then closes the connection (immediately
+ * if everything was sent, otherwise when the out queue is empty).
+ */
+
+void
+relay_metrics_send_response (struct t_relay_client *client,
+                             const char *http, const char *body)
+{
+    char *message;
+    int length, length_body;
+
+    length_body = (body) ? strlen (body) : 0;
+    length = 256 + strlen (http) + length_body + 1;
+    message = malloc (length);
+    if (message)
+    {
+        snprintf (message, length,
+                  "HTTP/1.1 %s\r\n"
+                  "Content-Type: %s\r\n"
+                  "Content-Length: %d\r\n"
+                  "Connection: close\r\n"
+                  "\r\n"
+                  "%s",
+                  http,
+                  RELAY_METRICS_CONTENT_TYPE,
+                  length_body,
+                  (body) ? body : "");
+        relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
+                           message, strlen (message), NULL, NULL);
+        free (message);
+    }
+
+    RELAY_METRICS_DATA(client, response_sent) = 1;
+
+    if (!client->outqueue)
+        relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+}
+
+/*
+ * Checks if the client is authorized to read metrics: if a password is
+ * defined, the client must send header "Authorization: Bearer <password>".
+ *
+ * Returns:
+ *   1: client is authorized
+ *   0: client is NOT authorized
+ */
+
+int
+relay_metrics_check_auth (struct t_relay_client *client)
+{
+    char *password;
+    const char *ptr_auth;
+    int rc;
+
+    password = weechat_string_eval_expression (weechat_config_string (relay_config_network_password),
+                                               NULL, NULL, NULL);
+    if (!password || !password[0])
+    {
+        if (password)
+            free (password);
+        return 1;
+    }
+
+    rc = 0;
+    ptr_auth = RELAY_METRICS_DATA(client, authorization);
+    if (ptr_auth && (weechat_strncasecmp (ptr_auth, "bearer ", 7) == 0))
+    {
+        ptr_auth += 7;
+        while (ptr_auth[0] == ' ')
+        {
+            ptr_auth++;
+        }
+        rc = (strcmp (ptr_auth, password) == 0) ? 1 : 0;
+    }
+
+    free (password);
+
+    return rc;
+}
+
+/*
+ * Sends response to a HTTP request received from client.
+ */
+
+void
+relay_metrics_send (struct t_relay_client *client)
+{
+    char *metrics;
+
+    if (!RELAY_METRICS_DATA(client, request_ok))
+    {
+        relay_metrics_send_response (client, "404 Not Found", NULL);
+        return;
+    }
+
+    if (!relay_metrics_check_auth (client))
+    {
+        relay_metrics_send_response (client, "401 Unauthorized", NULL);
+        return;
+    }
+
+    metrics = relay_metrics_build ();
+    relay_metrics_send_response (client, "200 OK", metrics);
+    if (metrics)
+        free (metrics);
+}
+
+/*
+ * Reads one line of HTTP request from client.
+ */
+
+void
+relay_metrics_recv (struct t_relay_client *client, const char *data)
+{
+    const char *pos;
+
+    if (RELAY_METRICS_DATA(client, response_sent))
+        return;
+
+    if (!RELAY_METRICS_DATA(client, request_received))
+    {
+        /* request line: only "GET /metrics" is allowed */
+        RELAY_METRICS_DATA(client, request_received) = 1;
+        RELAY_METRICS_DATA(client, request_ok) =
+            ((strncmp (data, "GET /metrics", 12) == 0)
+             && ((data[12] == '\0') || (data[12] == ' ')
+                 || (data[12] == '?'))) ? 1 : 0;
+        return;
+    }
+
+    if (data[0])
+    {
+        /* HTTP header: only "Authorization" is used */
+        if (weechat_strncasecmp (data, "authorization:", 14) == 0)
+        {
+            pos = data + 14;
+            while (pos[0] == ' ')
+            {
+                pos++;
+            }
+            if (RELAY_METRICS_DATA(client, authorization))
+                free (RELAY_METRICS_DATA(client, authorization));
+            RELAY_METRICS_DATA(client, authorization) = strdup (pos);
+        }
+        return;
+    }
+
+    /* empty line: end of HTTP headers */
+    relay_metrics_send (client);
+}
+
+/*
+ * Checks if the response has been sent to the client and if the out queue
+ * is empty (then the connection can be closed).
+ *
+ * Returns:
+ *   1: response sent
+ *   0: response not (fully) sent
+ */
+
+int
+relay_metrics_response_done (struct t_relay_client *client)
+{
+    return (client->protocol_data
+            && RELAY_METRICS_DATA(client, response_sent)
+            && !client->outqueue) ? 1 : 0;
+}
+
+/*
+ * Closes connection with client.
+ */
+
+void
+relay_metrics_close_connection (struct t_relay_client *client)
+{
+    /* make C compiler happy */
+    (void) client;
+}
+
+/*
+ * Initializes relay data specific to metrics protocol.
+ */
+
+void
+relay_metrics_alloc (struct t_relay_client *client)
+{
+    struct t_relay_metrics_data *metrics_data;
+
+    client->protocol_data = malloc (sizeof (*metrics_data));
+    if (client->protocol_data)
+    {
+        RELAY_METRICS_DATA(client, request_received) = 0;
+        RELAY_METRICS_DATA(client, request_ok) = 0;
+        RELAY_METRICS_DATA(client, authorization) = NULL;
+        RELAY_METRICS_DATA(client, response_sent) = 0;
+    }
+}
+
+/*
+ * Initializes relay data specific to metrics protocol using an infolist.
+ *
+ * This is called after /upgrade.
+ */
+
+void
+relay_metrics_alloc_with_infolist (struct t_relay_client *client,
+                                   struct t_infolist *infolist)
+{
+    struct t_relay_metrics_data *metrics_data;
+    const char *str;
+
+    client->protocol_data = malloc (sizeof (*metrics_data));
+    if (client->protocol_data)
+    {
+        RELAY_METRICS_DATA(client, request_received) = weechat_infolist_integer (infolist, "request_received");
+        RELAY_METRICS_DATA(client, request_ok) = weechat_infolist_integer (infolist, "request_ok");
+        str = weechat_infolist_string (infolist, "authorization");
+        RELAY_METRICS_DATA(client, authorization) = (str) ? strdup (str) : NULL;
+        RELAY_METRICS_DATA(client, response_sent) = weechat_infolist_integer (infolist, "response_sent");
+    }
+}
+
+/*
+ * Frees relay data specific to metrics protocol.
+ */
+
+void
+relay_metrics_free (struct t_relay_client *client)
+{
+    if (client->protocol_data)
+    {
+        if (RELAY_METRICS_DATA(client, authorization))
+            free (RELAY_METRICS_DATA(client, authorization));
+
+        free (client->protocol_data);
+
+        client->protocol_data = NULL;
+    }
+}
+
+/*
+ * Adds client metrics data in an infolist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_metrics_add_to_infolist (struct t_infolist_item *item,
+                               struct t_relay_client *client)
+{
+    if (!item || !client)
+        return 0;
+
+    if (!weechat_infolist_new_var_integer (item, "request_received", RELAY_METRICS_DATA(client, request_received)))
+        return 0;
+    if (!weechat_infolist_new_var_integer (item, "request_ok", RELAY_METRICS_DATA(client, request_ok)))
+        return 0;
+    if (!weechat_infolist_new_var_string (item, "authorization", RELAY_METRICS_DATA(client, authorization)))
+        return 0;
+    if (!weechat_infolist_new_var_integer (item, "response_sent", RELAY_METRICS_DATA(client, response_sent)))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Prints client metrics data in WeeChat log file (usually for crash dump).
+ */
+
+void
+relay_metrics_print_log (struct t_relay_client *client)
+{
+    if (client->protocol_data)
+    {
+        weechat_log_printf ("    request_received. . . . : %d",   RELAY_METRICS_DATA(client, request_received));
+        weechat_log_printf ("    request_ok. . . . . . . : %d",   RELAY_METRICS_DATA(client, request_ok));
+        weechat_log_printf ("    authorization . . . . . : %s",
+                            (RELAY_METRICS_DATA(client, authorization)) ? "(hidden)" : "(null)");
+        weechat_log_printf ("    response_sent . . . . . : %d",   RELAY_METRICS_DATA(client, response_sent));
+    }
+}
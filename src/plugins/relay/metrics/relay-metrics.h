@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_METRICS_H
+#define WEECHAT_RELAY_METRICS_H 1
+
+struct t_relay_client;
+
+#define RELAY_METRICS_DATA(client, var)                          \
+    (((struct t_relay_metrics_data *)client->protocol_data)->var)
+
+#define RELAY_METRICS_CONTENT_TYPE "text/plain; version=0.0.4"
+
+struct t_relay_metrics_data
+{
+    int request_received;              /* 1 if HTTP request line received   */
+    int request_ok;                    /* 1 if request is "GET /metrics"    */
+    char *authorization;               /* value of header "Authorization"   */
+    int response_sent;                 /* 1 if HTTP response has been sent  */
+};
+
+extern void relay_metrics_recv (struct t_relay_client *client,
+                                const char *data);
+extern int relay_metrics_response_done (struct t_relay_client *client);
+extern void relay_metrics_close_connection (struct t_relay_client *client);
+extern void relay_metrics_alloc (struct t_relay_client *client);
+extern void relay_metrics_alloc_with_infolist (struct t_relay_client *client,
+                                               struct t_infolist *infolist);
+extern void relay_metrics_free (struct t_relay_client *client);
+extern int relay_metrics_add_to_infolist (struct t_infolist_item *item,
+                                          struct t_relay_client *client);
+extern void relay_metrics_print_log (struct t_relay_client *client);
+
+#endif /* WEECHAT_RELAY_METRICS_H */
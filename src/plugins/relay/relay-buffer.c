@@ -34,6 +34,9 @@
 
 struct t_gui_buffer *relay_buffer = NULL;
 int relay_buffer_selected_line = 0;
+struct t_hook *relay_buffer_hook_timer_refresh = NULL; /* delayed refresh */
+const char *relay_buffer_refresh_hotlist = NULL; /* hotlist for delayed    */
+                                                 /* refresh                */
 
 
 /*
@@ -147,6 +150,76 @@ relay_buffer_refresh (const char *hotlist)
     }
 }
 
+/*
+ * Returns priority of a hotlist (-1 if hotlist is NULL).
+ */
+
+int
+relay_buffer_hotlist_priority (const char *hotlist)
+{
+    if (!hotlist)
+        return -1;
+    if (strcmp (hotlist, WEECHAT_HOTLIST_HIGHLIGHT) == 0)
+        return 3;
+    if (strcmp (hotlist, WEECHAT_HOTLIST_PRIVATE) == 0)
+        return 2;
+    if (strcmp (hotlist, WEECHAT_HOTLIST_MESSAGE) == 0)
+        return 1;
+    return 0;
+}
+
+/*
+ * Callback for timer used to refresh relay buffer.
+ */
+
+int
+relay_buffer_refresh_timer_cb (const void *pointer, void *data,
+                               int remaining_calls)
+{
+    const char *hotlist;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    relay_buffer_hook_timer_refresh = NULL;
+    hotlist = relay_buffer_refresh_hotlist;
+    relay_buffer_refresh_hotlist = NULL;
+
+    relay_buffer_refresh (hotlist);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Schedules a refresh of relay buffer (done in next main loop).
+ *
+ * Many refreshes asked in same main loop (for example when many clients are
+ * connecting at same time) are merged into a single one, with the highest
+ * hotlist asked.
+ */
+
+void
+relay_buffer_refresh_delayed (const char *hotlist)
+{
+    if (!relay_buffer)
+        return;
+
+    if (relay_buffer_hotlist_priority (hotlist) >
+        relay_buffer_hotlist_priority (relay_buffer_refresh_hotlist))
+    {
+        relay_buffer_refresh_hotlist = hotlist;
+    }
+
+    if (!relay_buffer_hook_timer_refresh)
+    {
+        relay_buffer_hook_timer_refresh = weechat_hook_timer (
+            1, 0, 1,
+            &relay_buffer_refresh_timer_cb, NULL, NULL);
+    }
+}
+
 /*
  * Callback for input data in relay buffer.
  */
@@ -26,6 +26,7 @@ extern struct t_gui_buffer *relay_buffer;
 extern int relay_buffer_selected_line;
 
 extern void relay_buffer_refresh (const char *hotlist);
+extern void relay_buffer_refresh_delayed (const char *hotlist);
 extern int relay_buffer_input_cb (const void *pointer, void *data,
                                   struct t_gui_buffer *buffer,
                                   const char *input_data);
@@ -28,15 +28,21 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #ifdef HAVE_GNUTLS
 #include <gnutls/gnutls.h>
+#if LIBGNUTLS_VERSION_NUMBER >= 0x030703 /* 3.7.3 */
+#include <gnutls/socket.h>
+#endif /* LIBGNUTLS_VERSION_NUMBER >= 0x030703 */
 #endif
 
 #include "../weechat-plugin.h"
+#include "../../core/wee-trace.h"
 #include "relay.h"
 #include "relay-client.h"
 #include "irc/relay-irc.h"
+#include "metrics/relay-metrics.h"
 #include "weechat/relay-weechat.h"
 #include "relay-config.h"
 #include "relay-buffer.h"
@@ -65,6 +71,11 @@ struct t_relay_client *relay_clients = NULL;
 struct t_relay_client *last_relay_client = NULL;
 int relay_client_count = 0;            /* number of clients                 */
 
+#ifdef HAVE_TRACEPOINTS
+TRACE_SEMAPHORE(relay_send);
+TRACE_SEMAPHORE(relay_flush);
+#endif /* HAVE_TRACEPOINTS */
+
 
 /*
  * Checks if a client pointer is valid.
@@ -250,6 +261,28 @@ relay_client_handshake_timer_cb (const void *pointer, void *data,
         weechat_unhook (client->hook_timer_handshake);
         client->hook_timer_handshake = NULL;
         client->gnutls_handshake_ok = 1;
+#if LIBGNUTLS_VERSION_NUMBER >= 0x030703 /* 3.7.3 */
+        /*
+         * if kernel TLS is enabled (in GnuTLS configuration), data is
+         * encrypted by the kernel: then it is sent directly on socket
+         * (many messages with a single system call, see function
+         * relay_client_outqueue_send)
+         */
+        if (gnutls_transport_is_ktls_enabled (client->gnutls_sess) & GNUTLS_KTLS_SEND)
+        {
+            client->gnutls_ktls_send = 1;
+            if (weechat_relay_plugin->debug >= 1)
+            {
+                weechat_printf_date_tags (
+                    NULL, 0, "relay_client",
+                    _("%s: kernel TLS enabled for client %s%s%s"),
+                    RELAY_PLUGIN_NAME,
+                    RELAY_COLOR_CHAT_CLIENT,
+                    client->desc,
+                    RELAY_COLOR_CHAT);
+            }
+        }
+#endif /* LIBGNUTLS_VERSION_NUMBER >= 0x030703 */
         relay_client_set_status (client, RELAY_STATUS_CONNECTED);
         return WEECHAT_RC_OK;
     }
@@ -373,7 +406,8 @@ relay_client_recv_text (struct t_relay_client *client, const char *data)
                                 relay_client_send (client,
                                                    RELAY_CLIENT_MSG_STANDARD,
                                                    handshake,
-                                                   strlen (handshake), NULL);
+                                                   strlen (handshake), NULL,
+                                                   NULL);
                                 free (handshake);
                                 client->websocket = 2;
                             }
@@ -461,6 +495,9 @@ relay_client_recv_text (struct t_relay_client *client, const char *data)
                         case RELAY_PROTOCOL_IRC:
                             relay_irc_recv (client, lines[i]);
                             break;
+                        case RELAY_PROTOCOL_METRICS:
+                            relay_metrics_recv (client, lines[i]);
+                            break;
                         case RELAY_NUM_PROTOCOLS:
                             break;
                     }
@@ -518,7 +555,7 @@ relay_client_recv_text_buffer (struct t_relay_client *client,
                                    RELAY_CLIENT_MSG_PONG,
                                    buffer + index + 1,
                                    strlen (buffer + index + 1),
-                                   NULL);
+                                   NULL, NULL);
             }
             index++;
         }
@@ -538,7 +575,8 @@ int
 relay_client_recv_cb (const void *pointer, void *data, int fd)
 {
     struct t_relay_client *client;
-    static char buffer[4096], decoded[8192 + 1];
+    static char buffer[4096], decoded[65536 + 1];
+    char *ptr_decoded;
     const char *ptr_buffer;
     int num_read, rc;
     unsigned long long decoded_length, length_buffer;
@@ -592,11 +630,18 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
 
         if (client->websocket == 2)
         {
-            /* websocket used, decode message */
-            rc = relay_websocket_decode_frame ((unsigned char *)buffer,
-                                               (unsigned long long)num_read,
-                                               (unsigned char *)decoded,
-                                               &decoded_length);
+            /*
+             * websocket used, decode message (in place if client does not
+             * compress frames: decoded data is never longer than frames)
+             */
+            ptr_decoded = (client->ws_deflate) ? decoded : buffer;
+            rc = relay_websocket_decode_frame (
+                client,
+                (unsigned char *)buffer,
+                (unsigned long long)num_read,
+                (unsigned char *)ptr_decoded,
+                (client->ws_deflate) ? sizeof (decoded) - 1 : sizeof (buffer) - 1,
+                &decoded_length);
             if (decoded_length == 0)
             {
                 /*
@@ -624,7 +669,7 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
                 relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
                 return WEECHAT_RC_OK;
             }
-            ptr_buffer = decoded;
+            ptr_buffer = ptr_decoded;
             length_buffer = decoded_length;
         }
 
@@ -639,7 +684,7 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
             /* receive buffer as-is (binary data) */
             /* currently, all supported protocols receive only text, no binary */
         }
-        relay_buffer_refresh (NULL);
+        relay_buffer_refresh_delayed (NULL);
     }
     else
     {
@@ -688,35 +733,200 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Frees a message in out queue.
+ */
+
+void
+relay_client_outqueue_free (struct t_relay_client *client,
+                            struct t_relay_client_outqueue *outqueue)
+{
+    struct t_relay_client_outqueue *new_outqueue;
+
+    /* remove outqueue message */
+    if (client->last_outqueue == outqueue)
+        client->last_outqueue = outqueue->prev_outqueue;
+    if (outqueue->prev_outqueue)
+    {
+        (outqueue->prev_outqueue)->next_outqueue = outqueue->next_outqueue;
+        new_outqueue = client->outqueue;
+    }
+    else
+        new_outqueue = outqueue->next_outqueue;
+
+    if (outqueue->next_outqueue)
+        (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
+
+    client->outqueue_count--;
+    client->outqueue_size -= outqueue->header_size + outqueue->data_size
+        - outqueue->sent;
+
+    /* free data */
+    if (outqueue->data)
+        free (outqueue->data);
+    if (outqueue->raw_message[0])
+        free (outqueue->raw_message[0]);
+    if (outqueue->raw_message[1])
+        free (outqueue->raw_message[1]);
+    if (outqueue->coalesce_key)
+        free (outqueue->coalesce_key);
+    free (outqueue);
+
+    /* set new head */
+    client->outqueue = new_outqueue;
+}
+
+/*
+ * Frees all messages in out queue.
+ */
+
+void
+relay_client_outqueue_free_all (struct t_relay_client *client)
+{
+    while (client->outqueue)
+    {
+        relay_client_outqueue_free (client, client->outqueue);
+    }
+}
+
+/*
+ * Checks if messages not yet sent can be removed from out queue of client.
+ *
+ * It is not possible if data sent is compressed with a context kept between
+ * messages (the client needs all messages to decompress next ones).
+ *
+ * Returns:
+ *   1: messages can be removed
+ *   0: messages must all be sent
+ */
+
+int
+relay_client_outqueue_can_drop (struct t_relay_client *client)
+{
+    if (client->ws_deflate && !client->ws_deflate->server_no_context_takeover)
+        return 0;
+
+    if ((client->protocol == RELAY_PROTOCOL_WEECHAT)
+        && client->protocol_data
+        && relay_weechat_compression_is_stream (client))
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Searches a message not yet sent with a coalesce key in out queue.
+ *
+ * Returns:
+ *   1: message found (it would be replaced by a message with same key)
+ *   0: message not found
+ */
+
+int
+relay_client_outqueue_search_key (struct t_relay_client *client,
+                                  const char *coalesce_key)
+{
+    struct t_relay_client_outqueue *ptr_outqueue;
+
+    if (!client || !coalesce_key || !relay_client_outqueue_can_drop (client))
+        return 0;
+
+    for (ptr_outqueue = client->outqueue; ptr_outqueue;
+         ptr_outqueue = ptr_outqueue->next_outqueue)
+    {
+        if ((ptr_outqueue->sent == 0)
+            && ptr_outqueue->coalesce_key
+            && (strcmp (ptr_outqueue->coalesce_key, coalesce_key) == 0))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Adds a message in out queue.
+ *
+ * The message is made of a header (for example a websocket frame header, can
+ * be NULL) followed by data; the first "sent" bytes (of header and data) have
+ * already been sent (such message is never removed before the end is sent).
+ *
+ * If "coalesce_key" is not NULL, the messages with same key not yet sent are
+ * removed from queue (they are replaced by this one).
+ *
+ * If "date_recv" is not NULL, the latency of message is traced when it is
+ * fully sent (see command "/debug latency").
  */
 
 void
 relay_client_outqueue_add (struct t_relay_client *client,
+                           const char *header, int header_size,
                            const char *data, int data_size,
+                           int sent,
                            enum t_relay_client_msg_type raw_msg_type[2],
                            int raw_flags[2],
                            const char *raw_message[2],
-                           int raw_size[2])
+                           int raw_size[2],
+                           const char *coalesce_key,
+                           const struct timeval *date_recv)
 {
-    struct t_relay_client_outqueue *new_outqueue;
-    int i;
+    struct t_relay_client_outqueue *new_outqueue, *ptr_outqueue;
+    struct t_relay_client_outqueue *ptr_next_outqueue;
+    int i, max_size;
 
-    if (!client || !data || (data_size <= 0))
+    if (!client || (header_size + data_size - sent <= 0))
         return;
 
+    /* remove messages replaced by this one */
+    if (coalesce_key && relay_client_outqueue_can_drop (client))
+    {
+        ptr_outqueue = client->outqueue;
+        while (ptr_outqueue)
+        {
+            ptr_next_outqueue = ptr_outqueue->next_outqueue;
+            if ((ptr_outqueue->sent == 0)
+                && ptr_outqueue->coalesce_key
+                && (strcmp (ptr_outqueue->coalesce_key, coalesce_key) == 0))
+            {
+                relay_client_outqueue_free (client, ptr_outqueue);
+            }
+            ptr_outqueue = ptr_next_outqueue;
+        }
+    }
+
     new_outqueue = malloc (sizeof (*new_outqueue));
     if (new_outqueue)
     {
-        new_outqueue->data = malloc (data_size);
-        if (!new_outqueue->data)
+        /*
+         * with SSL (without kernel TLS), header and data are sent in a single
+         * record (so they are stored together in data)
+         */
+        new_outqueue->header_size = 0;
+        if ((header_size > 0) && !RELAY_CLIENT_GNUTLS_SEND(client))
         {
-            free (new_outqueue);
-            return;
+            memcpy (new_outqueue->header, header, header_size);
+            new_outqueue->header_size = header_size;
+            header_size = 0;
         }
-        memcpy (new_outqueue->data, data, data_size);
-        new_outqueue->data_size = data_size;
+        new_outqueue->data = NULL;
+        new_outqueue->data_size = header_size + data_size;
+        if (new_outqueue->data_size > 0)
+        {
+            new_outqueue->data = malloc (new_outqueue->data_size);
+            if (!new_outqueue->data)
+            {
+                free (new_outqueue);
+                return;
+            }
+            if (header_size > 0)
+                memcpy (new_outqueue->data, header, header_size);
+            if (data_size > 0)
+                memcpy (new_outqueue->data + header_size, data, data_size);
+        }
+        new_outqueue->sent = sent;
         for (i = 0; i < 2; i++)
         {
             new_outqueue->raw_msg_type[i] = RELAY_CLIENT_MSG_STANDARD;
@@ -736,6 +946,17 @@ relay_client_outqueue_add (struct t_relay_client *client,
                 }
             }
         }
+        new_outqueue->coalesce_key = (coalesce_key) ?
+            strdup (coalesce_key) : NULL;
+        if (date_recv)
+        {
+            new_outqueue->date_recv = *date_recv;
+        }
+        else
+        {
+            new_outqueue->date_recv.tv_sec = 0;
+            new_outqueue->date_recv.tv_usec = 0;
+        }
 
         new_outqueue->prev_outqueue = client->last_outqueue;
         new_outqueue->next_outqueue = NULL;
@@ -744,57 +965,142 @@ relay_client_outqueue_add (struct t_relay_client *client,
         else
             client->outqueue = new_outqueue;
         client->last_outqueue = new_outqueue;
+
+        client->outqueue_count++;
+        client->outqueue_size += new_outqueue->header_size
+            + new_outqueue->data_size - sent;
+
+        /*
+         * if the client does not read data fast enough, the max size of queue
+         * is reached: next messages are dropped and the action is done in
+         * the timer (see function relay_client_outqueue_full)
+         */
+        max_size = weechat_config_integer (relay_config_network_client_outqueue_max_size);
+        if ((max_size > 0)
+            && (client->outqueue_size > (unsigned long long)max_size * 1024))
+        {
+            client->outqueue_full = 1;
+        }
     }
 }
 
 /*
- * Frees a message in out queue.
+ * Sends a header (can be NULL) and data to client, with a single system call
+ * (data is not copied after the header, except with SSL without kernel TLS).
+ *
+ * Returns number of bytes sent, negative value if error (with SSL: gnutls
+ * error code, otherwise errno is set).
  */
 
-void
-relay_client_outqueue_free (struct t_relay_client *client,
-                            struct t_relay_client_outqueue *outqueue)
+int
+relay_client_send_data (struct t_relay_client *client,
+                        const char *header, int header_size,
+                        const char *data, int data_size)
 {
-    struct t_relay_client_outqueue *new_outqueue;
+    struct iovec iov[2];
+    int num_iov;
+#ifdef HAVE_GNUTLS
+    char *buf;
+    int num_sent;
 
-    /* remove outqueue message */
-    if (client->last_outqueue == outqueue)
-        client->last_outqueue = outqueue->prev_outqueue;
-    if (outqueue->prev_outqueue)
+    if (RELAY_CLIENT_GNUTLS_SEND(client))
     {
-        (outqueue->prev_outqueue)->next_outqueue = outqueue->next_outqueue;
-        new_outqueue = client->outqueue;
+        if (header_size <= 0)
+            return gnutls_record_send (client->gnutls_sess, data, data_size);
+
+        /* send header and data in a single record */
+        buf = malloc (header_size + data_size);
+        if (!buf)
+            return GNUTLS_E_MEMORY_ERROR;
+        memcpy (buf, header, header_size);
+        memcpy (buf + header_size, data, data_size);
+        num_sent = gnutls_record_send (client->gnutls_sess, buf,
+                                       header_size + data_size);
+        free (buf);
+        return num_sent;
     }
-    else
-        new_outqueue = outqueue->next_outqueue;
-
-    if (outqueue->next_outqueue)
-        (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
+#endif /* HAVE_GNUTLS */
 
-    /* free data */
-    if (outqueue->data)
-        free (outqueue->data);
-    if (outqueue->raw_message[0])
-        free (outqueue->raw_message[0]);
-    if (outqueue->raw_message[1])
-        free (outqueue->raw_message[1]);
-    free (outqueue);
+    num_iov = 0;
+    if (header_size > 0)
+    {
+        iov[num_iov].iov_base = (void *)header;
+        iov[num_iov].iov_len = header_size;
+        num_iov++;
+    }
+    if (data_size > 0)
+    {
+        iov[num_iov].iov_base = (void *)data;
+        iov[num_iov].iov_len = data_size;
+        num_iov++;
+    }
 
-    /* set new head */
-    client->outqueue = new_outqueue;
+    return writev (client->sock, iov, num_iov);
 }
 
 /*
- * Frees all messages in out queue.
+ * Displays an error when sending data to client, and disconnects the client.
  */
 
 void
-relay_client_outqueue_free_all (struct t_relay_client *client)
+relay_client_send_error (struct t_relay_client *client, int error)
 {
-    while (client->outqueue)
+#ifdef HAVE_GNUTLS
+    if (RELAY_CLIENT_GNUTLS_SEND(client))
     {
-        relay_client_outqueue_free (client, client->outqueue);
+        weechat_printf_date_tags (
+            NULL, 0, "relay_client",
+            _("%s%s: sending data to client %s%s%s: error %d %s"),
+            weechat_prefix ("error"),
+            RELAY_PLUGIN_NAME,
+            RELAY_COLOR_CHAT_CLIENT,
+            client->desc,
+            RELAY_COLOR_CHAT,
+            error,
+            gnutls_strerror (error));
+    }
+    else
+#endif /* HAVE_GNUTLS */
+    {
+        weechat_printf_date_tags (
+            NULL, 0, "relay_client",
+            _("%s%s: sending data to client %s%s%s: error %d %s"),
+            weechat_prefix ("error"),
+            RELAY_PLUGIN_NAME,
+            RELAY_COLOR_CHAT_CLIENT,
+            client->desc,
+            RELAY_COLOR_CHAT,
+            error,
+            strerror (error));
+    }
+    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+}
+
+/*
+ * Checks if an error when sending data is temporary (socket not ready): then
+ * data must be sent later.
+ *
+ * Returns:
+ *   1: data must be sent later
+ *   0: fatal error
+ */
+
+int
+relay_client_send_again (struct t_relay_client *client, int num_sent)
+{
+#ifdef HAVE_GNUTLS
+    if (RELAY_CLIENT_GNUTLS_SEND(client))
+    {
+        return ((num_sent == GNUTLS_E_AGAIN)
+                || (num_sent == GNUTLS_E_INTERRUPTED)) ? 1 : 0;
     }
+#else
+    /* make C compiler happy */
+    (void) client;
+    (void) num_sent;
+#endif /* HAVE_GNUTLS */
+
+    return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 1 : 0;
 }
 
 /*
@@ -803,6 +1109,12 @@ relay_client_outqueue_free_all (struct t_relay_client *client)
  * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
  * and replaces display of data, which is default.
  *
+ * If "coalesce_key" is not NULL and if the message is queued, it replaces the
+ * messages with same key still in queue (for example a full nicklist replaces
+ * the previous ones not yet sent for the same buffer).
+ *
+ * If the out queue of client is full, the message is dropped.
+ *
  * Returns number of bytes sent to client, -1 if error.
  */
 
@@ -810,19 +1122,26 @@ int
 relay_client_send (struct t_relay_client *client,
                    enum t_relay_client_msg_type msg_type,
                    const char *data,
-                   int data_size, const char *message_raw_buffer)
+                   int data_size, const char *message_raw_buffer,
+                   const char *coalesce_key)
 {
-    int num_sent, raw_size[2], raw_flags[2], opcode, i;
+    int num_sent, raw_size[2], raw_flags[2], opcode, i, header_size;
+    int compressed_size;
     enum t_relay_client_msg_type raw_msg_type[2];
-    char *websocket_frame;
-    unsigned long long length_frame;
-    const char *ptr_data, *raw_msg[2];
+    unsigned char header[RELAY_CLIENT_OUTQUEUE_HEADER_MAX];
+    const char *raw_msg[2];
+    char *compressed;
+    const struct timeval *date_recv;
 
-    if (client->sock < 0)
+    if ((client->sock < 0) || client->outqueue_full)
         return -1;
 
-    ptr_data = data;
-    websocket_frame = NULL;
+    TRACE3(relay_send, client->desc, msg_type, data_size);
+
+    /* date of reception of message being processed (if latency is traced) */
+    date_recv = weechat_latency_message_get ();
+
+    compressed = NULL;
 
     /* set raw messages */
     for (i = 0; i < 2; i++)
@@ -876,7 +1195,11 @@ relay_client_send (struct t_relay_client *client,
         }
     }
 
-    /* if websocket is initialized, encode data in a websocket frame */
+    /*
+     * if websocket is initialized, build header of websocket frame (sent
+     * before data)
+     */
+    header_size = 0;
     if (client->websocket == 2)
     {
         switch (msg_type)
@@ -892,14 +1215,26 @@ relay_client_send (struct t_relay_client *client,
                     WEBSOCKET_FRAME_OPCODE_TEXT : WEBSOCKET_FRAME_OPCODE_BINARY;
                 break;
         }
-        websocket_frame = relay_websocket_encode_frame (opcode, data,
-                                                        data_size,
-                                                        &length_frame);
-        if (websocket_frame)
+        /*
+         * with extension "permessage-deflate", data messages are compressed
+         * (raw buffer still displays the data not compressed)
+         */
+        if (client->ws_deflate
+            && (msg_type != RELAY_CLIENT_MSG_PING)
+            && (msg_type != RELAY_CLIENT_MSG_PONG))
         {
-            ptr_data = websocket_frame;
-            data_size = length_frame;
+            compressed = relay_websocket_deflate (client, data, data_size,
+                                                  &compressed_size);
+            if (compressed)
+            {
+                data = compressed;
+                data_size = compressed_size;
+            }
         }
+        header_size = relay_websocket_encode_frame_header (
+            opcode, (unsigned long long)data_size, header);
+        if (compressed)
+            header[0] |= RELAY_WEBSOCKET_FRAME_RSV1;
     }
 
     num_sent = -1;
@@ -910,17 +1245,16 @@ relay_client_send (struct t_relay_client *client,
      */
     if (client->outqueue)
     {
-        relay_client_outqueue_add (client, ptr_data, data_size,
-                                   raw_msg_type, raw_flags, raw_msg, raw_size);
+        relay_client_outqueue_add (client, (const char *)header, header_size,
+                                   data, data_size, 0,
+                                   raw_msg_type, raw_flags, raw_msg, raw_size,
+                                   coalesce_key, date_recv);
     }
     else
     {
-#ifdef HAVE_GNUTLS
-        if (client->ssl)
-            num_sent = gnutls_record_send (client->gnutls_sess, ptr_data, data_size);
-        else
-#endif /* HAVE_GNUTLS */
-            num_sent = send (client->sock, ptr_data, data_size, 0);
+        num_sent = relay_client_send_data (client,
+                                           (const char *)header, header_size,
+                                           data, data_size);
 
         if (num_sent >= 0)
         {
@@ -935,78 +1269,232 @@ relay_client_send (struct t_relay_client *client,
             if (num_sent > 0)
             {
                 client->bytes_sent += num_sent;
-                relay_buffer_refresh (NULL);
+                relay_buffer_refresh_delayed (NULL);
             }
-            if (num_sent < data_size)
+            if (num_sent < header_size + data_size)
             {
                 /* some data was not sent, add it to outqueue */
                 relay_client_outqueue_add (client,
-                                           ptr_data + num_sent,
-                                           data_size - num_sent,
-                                           NULL, NULL, NULL, NULL);
+                                           (const char *)header, header_size,
+                                           data, data_size, num_sent,
+                                           NULL, NULL, NULL, NULL, NULL,
+                                           date_recv);
             }
+            else if (date_recv)
+            {
+                weechat_latency_add ("relay", date_recv);
+            }
+        }
+        else if (relay_client_send_again (client, num_sent))
+        {
+            /* add message to queue (will be sent later) */
+            relay_client_outqueue_add (client,
+                                       (const char *)header, header_size,
+                                       data, data_size, 0,
+                                       raw_msg_type, raw_flags,
+                                       raw_msg, raw_size, coalesce_key,
+                                       date_recv);
         }
-        else if (num_sent < 0)
+        else
         {
+            relay_client_send_error (client,
+                                     (RELAY_CLIENT_GNUTLS_SEND(client)) ? num_sent : errno);
+        }
+    }
+
+    if (compressed)
+        free (compressed);
+
+    return num_sent;
+}
+
+/*
+ * Sends messages in out queue of client, until the socket is not ready for
+ * more data.
+ *
+ * Without SSL (or with kernel TLS), many messages are sent with a single
+ * system call (writev).
+ */
+
+void
+relay_client_outqueue_send (struct t_relay_client *client)
+{
+    struct t_relay_client_outqueue *ptr_outqueue, *ptr_next_outqueue;
+    struct iovec iov[RELAY_CLIENT_OUTQUEUE_MAX_IOV];
+    int num_iov, num_sent, size, remaining, i;
+
+    TRACE1(relay_flush, client->desc);
+
+    while (client->outqueue && (client->sock >= 0))
+    {
 #ifdef HAVE_GNUTLS
-            if (client->ssl)
+        if (RELAY_CLIENT_GNUTLS_SEND(client))
+        {
+            num_sent = gnutls_record_send (
+                client->gnutls_sess,
+                client->outqueue->data + client->outqueue->sent,
+                client->outqueue->data_size - client->outqueue->sent);
+        }
+        else
+#endif /* HAVE_GNUTLS */
+        {
+            /* send as many messages as possible with a single writev */
+            num_iov = 0;
+            for (ptr_outqueue = client->outqueue;
+                 ptr_outqueue && (num_iov < RELAY_CLIENT_OUTQUEUE_MAX_IOV - 1);
+                 ptr_outqueue = ptr_outqueue->next_outqueue)
             {
-                if ((num_sent == GNUTLS_E_AGAIN)
-                    || (num_sent == GNUTLS_E_INTERRUPTED))
+                if (ptr_outqueue->sent < ptr_outqueue->header_size)
                 {
-                    /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client,
-                                               ptr_data, data_size,
-                                               raw_msg_type, raw_flags,
-                                               raw_msg, raw_size);
+                    iov[num_iov].iov_base = ptr_outqueue->header
+                        + ptr_outqueue->sent;
+                    iov[num_iov].iov_len = ptr_outqueue->header_size
+                        - ptr_outqueue->sent;
+                    num_iov++;
+                    if (ptr_outqueue->data_size > 0)
+                    {
+                        iov[num_iov].iov_base = ptr_outqueue->data;
+                        iov[num_iov].iov_len = ptr_outqueue->data_size;
+                        num_iov++;
+                    }
                 }
                 else
                 {
-                    weechat_printf_date_tags (
-                        NULL, 0, "relay_client",
-                        _("%s%s: sending data to client %s%s%s: error %d %s"),
-                        weechat_prefix ("error"),
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        num_sent,
-                        gnutls_strerror (num_sent));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                    iov[num_iov].iov_base = ptr_outqueue->data
+                        + (ptr_outqueue->sent - ptr_outqueue->header_size);
+                    iov[num_iov].iov_len = ptr_outqueue->data_size
+                        - (ptr_outqueue->sent - ptr_outqueue->header_size);
+                    num_iov++;
                 }
             }
-            else
-#endif /* HAVE_GNUTLS */
+            num_sent = writev (client->sock, iov, num_iov);
+        }
+
+        if (num_sent < 0)
+        {
+            /* if socket is not ready, we will retry later this queue */
+            if (!relay_client_send_again (client, num_sent))
             {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client, ptr_data, data_size,
-                                               raw_msg_type, raw_flags,
-                                               raw_msg, raw_size);
-                }
-                else
+                relay_client_send_error (client,
+                                         (RELAY_CLIENT_GNUTLS_SEND(client)) ? num_sent : errno);
+            }
+            return;
+        }
+
+        if (num_sent > 0)
+        {
+            client->bytes_sent += num_sent;
+            relay_buffer_refresh_delayed (NULL);
+        }
+
+        /* remove messages sent from queue */
+        remaining = num_sent;
+        ptr_outqueue = client->outqueue;
+        while (ptr_outqueue)
+        {
+            ptr_next_outqueue = ptr_outqueue->next_outqueue;
+            for (i = 0; i < 2; i++)
+            {
+                if (ptr_outqueue->raw_message[i])
                 {
-                    weechat_printf_date_tags (
-                        NULL, 0, "relay_client",
-                        _("%s%s: sending data to client %s%s%s: error %d %s"),
-                        weechat_prefix ("error"),
-                        RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
-                        errno,
-                        strerror (errno));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                    /*
+                     * print raw message and remove it from outqueue
+                     * (so that it is displayed only one time, even if
+                     * message is sent in many chunks)
+                     */
+                    relay_raw_print (client,
+                                     ptr_outqueue->raw_msg_type[i],
+                                     ptr_outqueue->raw_flags[i],
+                                     ptr_outqueue->raw_message[i],
+                                     ptr_outqueue->raw_size[i]);
+                    ptr_outqueue->raw_flags[i] = 0;
+                    free (ptr_outqueue->raw_message[i]);
+                    ptr_outqueue->raw_message[i] = NULL;
+                    ptr_outqueue->raw_size[i] = 0;
                 }
             }
+            size = ptr_outqueue->header_size + ptr_outqueue->data_size
+                - ptr_outqueue->sent;
+            if (remaining < size)
+            {
+                /*
+                 * some data was not sent, update outqueue and stop sending
+                 * data from outqueue
+                 */
+                ptr_outqueue->sent += remaining;
+                client->outqueue_size -= remaining;
+                return;
+            }
+            remaining -= size;
+            if (ptr_outqueue->date_recv.tv_sec != 0)
+                weechat_latency_add ("relay", &ptr_outqueue->date_recv);
+            relay_client_outqueue_free (client, ptr_outqueue);
+            if (remaining == 0)
+                break;
+            ptr_outqueue = ptr_next_outqueue;
         }
     }
+}
 
-    if (websocket_frame)
-        free (websocket_frame);
+/*
+ * Does the action when the out queue of client is full (the client does not
+ * read data fast enough): with weechat protocol, the messages not sent are
+ * removed and the client must synchronize again with buffers (if option
+ * relay.network.client_outqueue_full is "resync"), otherwise the client is
+ * disconnected.
+ */
 
-    return num_sent;
+void
+relay_client_outqueue_full (struct t_relay_client *client)
+{
+    struct t_relay_client_outqueue *ptr_outqueue, *ptr_next_outqueue;
+    char *str_size;
+
+    client->outqueue_full = 0;
+
+    str_size = weechat_string_format_size (client->outqueue_size);
+
+    if ((weechat_config_integer (relay_config_network_client_outqueue_full) ==
+         RELAY_CONFIG_CLIENT_OUTQUEUE_FULL_RESYNC)
+        && (client->protocol == RELAY_PROTOCOL_WEECHAT)
+        && relay_client_outqueue_can_drop (client))
+    {
+        /* remove messages not sent (a message partially sent is kept) */
+        ptr_outqueue = client->outqueue;
+        while (ptr_outqueue)
+        {
+            ptr_next_outqueue = ptr_outqueue->next_outqueue;
+            if (ptr_outqueue->sent == 0)
+                relay_client_outqueue_free (client, ptr_outqueue);
+            ptr_outqueue = ptr_next_outqueue;
+        }
+        weechat_printf_date_tags (
+            NULL, 0, "relay_client",
+            _("%s%s: out queue of client %s%s%s is full (%s), messages "
+              "removed, the client must synchronize again"),
+            weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+            RELAY_COLOR_CHAT_CLIENT,
+            client->desc,
+            RELAY_COLOR_CHAT,
+            (str_size) ? str_size : "?");
+        relay_weechat_resync (client);
+    }
+    else
+    {
+        weechat_printf_date_tags (
+            NULL, 0, "relay_client",
+            _("%s%s: out queue of client %s%s%s is full (%s), "
+              "disconnecting"),
+            weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+            RELAY_COLOR_CHAT_CLIENT,
+            client->desc,
+            RELAY_COLOR_CHAT,
+            (str_size) ? str_size : "?");
+        relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+    }
+
+    if (str_size)
+        free (str_size);
 }
 
 /*
@@ -1017,8 +1505,7 @@ int
 relay_client_timer_cb (const void *pointer, void *data, int remaining_calls)
 {
     struct t_relay_client *ptr_client, *ptr_next_client;
-    int num_sent, i, purge_delay;
-    char *buf;
+    int purge_delay;
     time_t current_time;
 
     /* make C compiler happy */
@@ -1037,141 +1524,24 @@ relay_client_timer_cb (const void *pointer, void *data, int remaining_calls)
 
         if (RELAY_CLIENT_HAS_ENDED(ptr_client))
         {
-            if ((purge_delay >= 0)
-                && (current_time >= ptr_client->end_time + (purge_delay * 60)))
+            if ((ptr_client->protocol == RELAY_PROTOCOL_METRICS)
+                || ((purge_delay >= 0)
+                    && (current_time >= ptr_client->end_time + (purge_delay * 60))))
             {
                 relay_client_free (ptr_client);
-                relay_buffer_refresh (NULL);
+                relay_buffer_refresh_delayed (NULL);
             }
         }
         else if (ptr_client->sock >= 0)
         {
-            while (ptr_client->outqueue)
+            if (ptr_client->outqueue_full)
+                relay_client_outqueue_full (ptr_client);
+            if (ptr_client->sock >= 0)
+                relay_client_outqueue_send (ptr_client);
+            if ((ptr_client->protocol == RELAY_PROTOCOL_METRICS)
+                && relay_metrics_response_done (ptr_client))
             {
-#ifdef HAVE_GNUTLS
-                if (ptr_client->ssl)
-                {
-                    num_sent = gnutls_record_send (ptr_client->gnutls_sess,
-                                                   ptr_client->outqueue->data,
-                                                   ptr_client->outqueue->data_size);
-                }
-                else
-#endif /* HAVE_GNUTLS */
-                {
-                    num_sent = send (ptr_client->sock,
-                                     ptr_client->outqueue->data,
-                                     ptr_client->outqueue->data_size, 0);
-                }
-                if (num_sent >= 0)
-                {
-                    for (i = 0; i < 2; i++)
-                    {
-                        if (ptr_client->outqueue->raw_message[i])
-                        {
-                            /*
-                             * print raw message and remove it from outqueue
-                             * (so that it is displayed only one time, even if
-                             * message is sent in many chunks)
-                             */
-                            relay_raw_print (
-                                ptr_client,
-                                ptr_client->outqueue->raw_msg_type[i],
-                                ptr_client->outqueue->raw_flags[i],
-                                ptr_client->outqueue->raw_message[i],
-                                ptr_client->outqueue->raw_size[i]);
-                            ptr_client->outqueue->raw_flags[i] = 0;
-                            free (ptr_client->outqueue->raw_message[i]);
-                            ptr_client->outqueue->raw_message[i] = NULL;
-                            ptr_client->outqueue->raw_size[i] = 0;
-                        }
-                    }
-                    if (num_sent > 0)
-                    {
-                        ptr_client->bytes_sent += num_sent;
-                        relay_buffer_refresh (NULL);
-                    }
-                    if (num_sent == ptr_client->outqueue->data_size)
-                    {
-                        /* whole data sent, remove outqueue */
-                        relay_client_outqueue_free (ptr_client,
-                                                    ptr_client->outqueue);
-                    }
-                    else
-                    {
-                        /*
-                         * some data was not sent, update outqueue and stop
-                         * sending data from outqueue
-                         */
-                        if (num_sent > 0)
-                        {
-                            buf = malloc (ptr_client->outqueue->data_size - num_sent);
-                            if (buf)
-                            {
-                                memcpy (buf,
-                                        ptr_client->outqueue->data + num_sent,
-                                        ptr_client->outqueue->data_size - num_sent);
-                                free (ptr_client->outqueue->data);
-                                ptr_client->outqueue->data = buf;
-                                ptr_client->outqueue->data_size = ptr_client->outqueue->data_size - num_sent;
-                            }
-                        }
-                        break;
-                    }
-                }
-                else if (num_sent < 0)
-                {
-#ifdef HAVE_GNUTLS
-                    if (ptr_client->ssl)
-                    {
-                        if ((num_sent == GNUTLS_E_AGAIN)
-                            || (num_sent == GNUTLS_E_INTERRUPTED))
-                        {
-                            /* we will retry later this client's queue */
-                            break;
-                        }
-                        else
-                        {
-                            weechat_printf_date_tags (
-                                NULL, 0, "relay_client",
-                                _("%s%s: sending data to client %s%s%s: "
-                                  "error %d %s"),
-                                weechat_prefix ("error"),
-                                RELAY_PLUGIN_NAME,
-                                RELAY_COLOR_CHAT_CLIENT,
-                                ptr_client->desc,
-                                RELAY_COLOR_CHAT,
-                                num_sent,
-                                gnutls_strerror (num_sent));
-                            relay_client_set_status (ptr_client,
-                                                     RELAY_STATUS_DISCONNECTED);
-                        }
-                    }
-                    else
-#endif /* HAVE_GNUTLS */
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            /* we will retry later this client's queue */
-                            break;
-                        }
-                        else
-                        {
-                            weechat_printf_date_tags (
-                                NULL, 0, "relay_client",
-                                _("%s%s: sending data to client %s%s%s: "
-                                  "error %d %s"),
-                                weechat_prefix ("error"),
-                                RELAY_PLUGIN_NAME,
-                                RELAY_COLOR_CHAT_CLIENT,
-                                ptr_client->desc,
-                                RELAY_COLOR_CHAT,
-                                errno,
-                                strerror (errno));
-                            relay_client_set_status (ptr_client,
-                                                     RELAY_STATUS_DISCONNECTED);
-                        }
-                    }
-                }
+                relay_client_set_status (ptr_client, RELAY_STATUS_DISCONNECTED);
             }
         }
 
@@ -1207,9 +1577,11 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
 #ifdef HAVE_GNUTLS
         new_client->hook_timer_handshake = NULL;
         new_client->gnutls_handshake_ok = 0;
+        new_client->gnutls_ktls_send = 0;
 #endif /* HAVE_GNUTLS */
         new_client->websocket = 0;
         new_client->http_headers = NULL;
+        new_client->ws_deflate = NULL;
         new_client->address = strdup ((address) ? address : "?");
         new_client->status = RELAY_STATUS_CONNECTED;
         new_client->protocol = server->protocol;
@@ -1303,12 +1675,18 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
             case RELAY_PROTOCOL_IRC:
                 relay_irc_alloc (new_client);
                 break;
+            case RELAY_PROTOCOL_METRICS:
+                relay_metrics_alloc (new_client);
+                break;
             case RELAY_NUM_PROTOCOLS:
                 break;
         }
 
         new_client->outqueue = NULL;
         new_client->last_outqueue = NULL;
+        new_client->outqueue_count = 0;
+        new_client->outqueue_size = 0;
+        new_client->outqueue_full = 0;
 
         new_client->prev_client = NULL;
         new_client->next_client = relay_clients;
@@ -1318,13 +1696,17 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
             last_relay_client = new_client;
         relay_clients = new_client;
 
-        weechat_printf_date_tags (NULL, 0, "relay_client",
-                                  _("%s: new client on port %d: %s%s%s"),
-                                  RELAY_PLUGIN_NAME,
-                                  server->port,
-                                  RELAY_COLOR_CHAT_CLIENT,
-                                  new_client->desc,
-                                  RELAY_COLOR_CHAT);
+        /* clients of metrics protocol are not displayed (one per scrape) */
+        if (new_client->protocol != RELAY_PROTOCOL_METRICS)
+        {
+            weechat_printf_date_tags (NULL, 0, "relay_client",
+                                      _("%s: new client on port %d: %s%s%s"),
+                                      RELAY_PLUGIN_NAME,
+                                      server->port,
+                                      RELAY_COLOR_CHAT_CLIENT,
+                                      new_client->desc,
+                                      RELAY_COLOR_CHAT);
+        }
 
         new_client->hook_fd = weechat_hook_fd (new_client->sock,
                                                1, 0, 0,
@@ -1334,6 +1716,7 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
         relay_client_count++;
 
         if (!relay_buffer
+            && (new_client->protocol != RELAY_PROTOCOL_METRICS)
             && weechat_config_boolean (relay_config_look_auto_open_buffer))
         {
             relay_buffer_open ();
@@ -1341,7 +1724,7 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
 
         relay_client_send_signal (new_client);
 
-        relay_buffer_refresh (WEECHAT_HOTLIST_PRIVATE);
+        relay_buffer_refresh_delayed (WEECHAT_HOTLIST_PRIVATE);
     }
     else
     {
@@ -1377,9 +1760,25 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
         new_client->gnutls_sess = NULL;
         new_client->hook_timer_handshake = NULL;
         new_client->gnutls_handshake_ok = 0;
+        new_client->gnutls_ktls_send = 0;
 #endif /* HAVE_GNUTLS */
         new_client->websocket = weechat_infolist_integer (infolist, "websocket");
         new_client->http_headers = NULL;
+        new_client->ws_deflate = NULL;
+        if (weechat_infolist_integer (infolist, "ws_deflate"))
+        {
+            /* compression streams are created again on first use */
+            new_client->ws_deflate = relay_websocket_deflate_new ();
+            if (new_client->ws_deflate)
+            {
+                new_client->ws_deflate->server_no_context_takeover =
+                    weechat_infolist_integer (infolist, "ws_deflate_server_no_context_takeover");
+                new_client->ws_deflate->client_no_context_takeover =
+                    weechat_infolist_integer (infolist, "ws_deflate_client_no_context_takeover");
+                new_client->ws_deflate->server_max_window_bits =
+                    weechat_infolist_integer (infolist, "ws_deflate_server_max_window_bits");
+            }
+        }
         new_client->address = strdup (weechat_infolist_string (infolist, "address"));
         new_client->status = weechat_infolist_integer (infolist, "status");
         new_client->protocol = weechat_infolist_integer (infolist, "protocol");
@@ -1426,12 +1825,19 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
                 relay_irc_alloc_with_infolist (new_client,
                                                infolist);
                 break;
+            case RELAY_PROTOCOL_METRICS:
+                relay_metrics_alloc_with_infolist (new_client,
+                                                   infolist);
+                break;
             case RELAY_NUM_PROTOCOLS:
                 break;
         }
 
         new_client->outqueue = NULL;
         new_client->last_outqueue = NULL;
+        new_client->outqueue_count = 0;
+        new_client->outqueue_size = 0;
+        new_client->outqueue_full = 0;
 
         new_client->prev_client = NULL;
         new_client->next_client = relay_clients;
@@ -1476,6 +1882,7 @@ relay_client_set_status (struct t_relay_client *client,
             client->hook_timer_handshake = NULL;
         }
         client->gnutls_handshake_ok = 0;
+        client->gnutls_ktls_send = 0;
 #endif /* HAVE_GNUTLS */
         if (client->hook_fd)
         {
@@ -1490,6 +1897,9 @@ relay_client_set_status (struct t_relay_client *client,
             case RELAY_PROTOCOL_IRC:
                 relay_irc_close_connection (client);
                 break;
+            case RELAY_PROTOCOL_METRICS:
+                relay_metrics_close_connection (client);
+                break;
             case RELAY_NUM_PROTOCOLS:
                 break;
         }
@@ -1506,13 +1916,16 @@ relay_client_set_status (struct t_relay_client *client,
                                           RELAY_COLOR_CHAT);
                 break;
             case RELAY_STATUS_DISCONNECTED:
-                weechat_printf_date_tags (
-                    NULL, 0, "relay_client",
-                    _("%s: disconnected from client %s%s%s"),
-                    RELAY_PLUGIN_NAME,
-                    RELAY_COLOR_CHAT_CLIENT,
-                    client->desc,
-                    RELAY_COLOR_CHAT);
+                if (client->protocol != RELAY_PROTOCOL_METRICS)
+                {
+                    weechat_printf_date_tags (
+                        NULL, 0, "relay_client",
+                        _("%s: disconnected from client %s%s%s"),
+                        RELAY_PLUGIN_NAME,
+                        RELAY_COLOR_CHAT_CLIENT,
+                        client->desc,
+                        RELAY_COLOR_CHAT);
+                }
                 break;
             default:
                 break;
@@ -1535,7 +1948,7 @@ relay_client_set_status (struct t_relay_client *client,
 
     relay_client_send_signal (client);
 
-    relay_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+    relay_buffer_refresh_delayed (WEECHAT_HOTLIST_MESSAGE);
 }
 
 /*
@@ -1578,6 +1991,8 @@ relay_client_free (struct t_relay_client *client)
 #endif /* HAVE_GNUTLS */
     if (client->http_headers)
         weechat_hashtable_free (client->http_headers);
+    if (client->ws_deflate)
+        relay_websocket_deflate_free (client->ws_deflate);
     if (client->hook_fd)
         weechat_unhook (client->hook_fd);
     if (client->partial_message)
@@ -1592,6 +2007,9 @@ relay_client_free (struct t_relay_client *client)
             case RELAY_PROTOCOL_IRC:
                 relay_irc_free (client);
                 break;
+            case RELAY_PROTOCOL_METRICS:
+                relay_metrics_free (client);
+                break;
             case RELAY_NUM_PROTOCOLS:
                 break;
         }
@@ -1689,9 +2107,25 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "gnutls_handshake_ok", client->gnutls_handshake_ok))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "gnutls_ktls_send", client->gnutls_ktls_send))
+        return 0;
 #endif /* HAVE_GNUTLS */
     if (!weechat_infolist_new_var_integer (ptr_item, "websocket", client->websocket))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate", (client->ws_deflate) ? 1 : 0))
+        return 0;
+    if (client->ws_deflate)
+    {
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_server_no_context_takeover",
+                                               client->ws_deflate->server_no_context_takeover))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_client_no_context_takeover",
+                                               client->ws_deflate->client_no_context_takeover))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_server_max_window_bits",
+                                               client->ws_deflate->server_max_window_bits))
+            return 0;
+    }
     if (!weechat_infolist_new_var_string (ptr_item, "address", client->address))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "status", client->status))
@@ -1722,6 +2156,11 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
     snprintf (value, sizeof (value), "%llu", client->bytes_sent);
     if (!weechat_infolist_new_var_string (ptr_item, "bytes_sent", value))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "outqueue_count", client->outqueue_count))
+        return 0;
+    snprintf (value, sizeof (value), "%llu", client->outqueue_size);
+    if (!weechat_infolist_new_var_string (ptr_item, "outqueue_size", value))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "recv_data_type", client->recv_data_type))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "send_data_type", client->send_data_type))
@@ -1737,6 +2176,9 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         case RELAY_PROTOCOL_IRC:
             relay_irc_add_to_infolist (ptr_item, client);
             break;
+        case RELAY_PROTOCOL_METRICS:
+            relay_metrics_add_to_infolist (ptr_item, client);
+            break;
         case RELAY_NUM_PROTOCOLS:
             break;
     }
@@ -1767,11 +2209,26 @@ relay_client_print_log ()
         weechat_log_printf ("  gnutls_sess . . . . . : 0x%lx", ptr_client->gnutls_sess);
         weechat_log_printf ("  hook_timer_handshake. : 0x%lx", ptr_client->hook_timer_handshake);
         weechat_log_printf ("  gnutls_handshake_ok . : 0x%lx", ptr_client->gnutls_handshake_ok);
+        weechat_log_printf ("  gnutls_ktls_send. . . : %d",   ptr_client->gnutls_ktls_send);
 #endif /* HAVE_GNUTLS */
         weechat_log_printf ("  websocket . . . . . . : %d",   ptr_client->websocket);
         weechat_log_printf ("  http_headers. . . . . : 0x%lx (hashtable: '%s')",
                             ptr_client->http_headers,
                             weechat_hashtable_get_string (ptr_client->http_headers, "keys_values"));
+        weechat_log_printf ("  ws_deflate. . . . . . : 0x%lx", ptr_client->ws_deflate);
+        if (ptr_client->ws_deflate)
+        {
+            weechat_log_printf ("    server_no_context_takeover: %d",
+                                ptr_client->ws_deflate->server_no_context_takeover);
+            weechat_log_printf ("    client_no_context_takeover: %d",
+                                ptr_client->ws_deflate->client_no_context_takeover);
+            weechat_log_printf ("    server_max_window_bits. . : %d",
+                                ptr_client->ws_deflate->server_max_window_bits);
+            weechat_log_printf ("    strm_deflate. . . . . . . : 0x%lx",
+                                ptr_client->ws_deflate->strm_deflate);
+            weechat_log_printf ("    strm_inflate. . . . . . . : 0x%lx",
+                                ptr_client->ws_deflate->strm_inflate);
+        }
         weechat_log_printf ("  address . . . . . . . : '%s'", ptr_client->address);
         weechat_log_printf ("  status. . . . . . . . : %d (%s)",
                             ptr_client->status,
@@ -1804,11 +2261,17 @@ relay_client_print_log ()
             case RELAY_PROTOCOL_IRC:
                 relay_irc_print_log (ptr_client);
                 break;
+            case RELAY_PROTOCOL_METRICS:
+                relay_metrics_print_log (ptr_client);
+                break;
             case RELAY_NUM_PROTOCOLS:
                 break;
         }
         weechat_log_printf ("  outqueue. . . . . . . : 0x%lx", ptr_client->outqueue);
         weechat_log_printf ("  last_outqueue . . . . : 0x%lx", ptr_client->last_outqueue);
+        weechat_log_printf ("  outqueue_count. . . . : %d",   ptr_client->outqueue_count);
+        weechat_log_printf ("  outqueue_size . . . . : %llu", ptr_client->outqueue_size);
+        weechat_log_printf ("  outqueue_full . . . . : %d",   ptr_client->outqueue_full);
         weechat_log_printf ("  prev_client . . . . . : 0x%lx", ptr_client->prev_client);
         weechat_log_printf ("  next_client . . . . . : 0x%lx", ptr_client->next_client);
     }
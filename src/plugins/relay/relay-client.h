@@ -21,12 +21,14 @@
 #define WEECHAT_RELAY_CLIENT_H 1
 
 #include <time.h>
+#include <sys/time.h>
 
 #ifdef HAVE_GNUTLS
 #include <gnutls/gnutls.h>
 #endif /* HAVE_GNUTLS */
 
 struct t_relay_server;
+struct t_relay_websocket_deflate;
 
 /* relay status */
 
@@ -68,16 +70,39 @@ enum t_relay_client_msg_type
     ((client->status == RELAY_STATUS_AUTH_FAILED) ||                    \
      (client->status == RELAY_STATUS_DISCONNECTED))
 
+/* data sent with gnutls (SSL, unless kernel TLS encrypts data sent) */
+
+#ifdef HAVE_GNUTLS
+#define RELAY_CLIENT_GNUTLS_SEND(client)                                \
+    (client->ssl && !client->gnutls_ktls_send)
+#else
+#define RELAY_CLIENT_GNUTLS_SEND(client) 0
+#endif /* HAVE_GNUTLS */
+
 /* output queue of messages to client */
 
+#define RELAY_CLIENT_OUTQUEUE_HEADER_MAX 16 /* max size of header (frame)   */
+#define RELAY_CLIENT_OUTQUEUE_MAX_IOV    64 /* max buffers sent with writev */
+
 struct t_relay_client_outqueue
 {
+    char header[RELAY_CLIENT_OUTQUEUE_HEADER_MAX]; /* header sent before    */
+                                        /* data (websocket frame header)    */
+    int header_size;                    /* size of header (0 = no header)   */
     char *data;                         /* data to send                     */
     int data_size;                      /* number of bytes                  */
+    int sent;                           /* bytes already sent (header and   */
+                                        /* data)                            */
     int raw_msg_type[2];                /* msgs types                       */
     int raw_flags[2];                   /* flags for raw messages           */
     char *raw_message[2];               /* msgs for raw buffer (can be NULL)*/
     int raw_size[2];                    /* size (in bytes) of raw messages  */
+    char *coalesce_key;                 /* msg is replaced by next msg with */
+                                        /* same key if not sent (can be     */
+                                        /* NULL)                            */
+    struct timeval date_recv;           /* date of reception of message     */
+                                        /* displayed (for latency tracing,  */
+                                        /* tv_sec = 0 if not traced)        */
     struct t_relay_client_outqueue *next_outqueue; /* next msg in queue     */
     struct t_relay_client_outqueue *prev_outqueue; /* prev msg in queue     */
 };
@@ -95,9 +120,11 @@ struct t_relay_client
     gnutls_session_t gnutls_sess;      /* gnutls session (only if SSL used) */
     struct t_hook *hook_timer_handshake; /* timer for doing gnutls handshake*/
     int gnutls_handshake_ok;           /* 1 if handshake was done and OK    */
+    int gnutls_ktls_send;              /* 1 if kernel TLS is used to send   */
 #endif /* HAVE_GNUTLS */
     int websocket;                     /* 0=not a ws, 1=init ws, 2=ws ready */
     struct t_hashtable *http_headers;  /* HTTP headers for websocket        */
+    struct t_relay_websocket_deflate *ws_deflate; /* "permessage-deflate"   */
     char *address;                     /* string with IP address            */
     enum t_relay_status status;        /* status (connecting, active,..)    */
     enum t_relay_protocol protocol;    /* protocol (irc,..)                 */
@@ -117,11 +144,15 @@ struct t_relay_client
     void *protocol_data;               /* data depending on protocol used   */
     struct t_relay_client_outqueue *outqueue; /* queue for outgoing msgs    */
     struct t_relay_client_outqueue *last_outqueue; /* last outgoing msg     */
+    int outqueue_count;                /* number of messages in out queue   */
+    unsigned long long outqueue_size;  /* bytes not yet sent in out queue   */
+    int outqueue_full;                 /* 1 if max size of queue reached    */
     struct t_relay_client *prev_client;/* link to previous client           */
     struct t_relay_client *next_client;/* link to next client               */
 };
 
 extern char *relay_client_status_string[];
+extern char *relay_client_status_name[];
 extern char *relay_client_msg_type_string[];
 extern struct t_relay_client *relay_clients;
 extern struct t_relay_client *last_relay_client;
@@ -134,10 +165,13 @@ extern int relay_client_status_search (const char *name);
 extern int relay_client_count_active_by_port (int server_port);
 extern void relay_client_set_desc (struct t_relay_client *client);
 extern int relay_client_recv_cb (const void *pointer, void *data, int fd);
+extern int relay_client_outqueue_search_key (struct t_relay_client *client,
+                                             const char *coalesce_key);
 extern int relay_client_send (struct t_relay_client *client,
                               enum t_relay_client_msg_type msg_type,
                               const char *data,
-                              int data_size, const char *message_raw_buffer);
+                              int data_size, const char *message_raw_buffer,
+                              const char *coalesce_key);
 extern int relay_client_timer_cb (const void *pointer, void *data,
                                   int remaining_calls);
 extern struct t_relay_client *relay_client_new (int sock, const char *address,
@@ -388,11 +388,15 @@ relay_command_init ()
            "(optional, if not given, the server name must be sent by client in "
            "command \"PASS\", with format: \"PASS server:password\")\n"
            "                 - protocol \"weechat\" (name is not used)\n"
+           "                 - protocol \"metrics\" (name is not used)\n"
            "\n"
            "The \"irc\" protocol allows any IRC client (including WeeChat "
            "itself) to connect on the port.\n"
            "The \"weechat\" protocol allows a remote interface to connect on "
            "the port, see the list here: https://weechat.org/download/\n"
+           "The \"metrics\" protocol answers to HTTP request \"GET /metrics\" "
+           "with metrics in Prometheus text format; if a password is set, "
+           "the header \"Authorization: Bearer <password>\" is required.\n"
            "\n"
            "Without argument, this command opens buffer with list of relay "
            "clients.\n"
@@ -413,7 +417,9 @@ relay_command_init ()
            "  weechat protocol with SSL, using only IPv6:\n"
            "    /relay add ipv6.ssl.weechat 9001\n"
            "  weechat protocol with SSL, using IPv4 + IPv6:\n"
-           "    /relay add ipv4.ipv6.ssl.weechat 9001"),
+           "    /relay add ipv4.ipv6.ssl.weechat 9001\n"
+           "  metrics (HTTP endpoint \"/metrics\"):\n"
+           "    /relay add metrics 9100"),
         "list %(relay_relays)"
         " || listfull %(relay_relays)"
         " || listrelay"
@@ -68,6 +68,10 @@ relay_completion_protocol_name_cb (const void *pointer, void *data,
                                       0, WEECHAT_LIST_POS_SORT);
     weechat_hook_completion_list_add (completion, "ssl.weechat",
                                       0, WEECHAT_LIST_POS_SORT);
+    weechat_hook_completion_list_add (completion, "metrics",
+                                      0, WEECHAT_LIST_POS_SORT);
+    weechat_hook_completion_list_add (completion, "ssl.metrics",
+                                      0, WEECHAT_LIST_POS_SORT);
 
     return WEECHAT_RC_OK;
 }
@@ -28,6 +28,7 @@
 #include "relay.h"
 #include "relay-config.h"
 #include "irc/relay-irc.h"
+#include "irc/relay-irc-backlog.h"
 #include "relay-client.h"
 #include "relay-buffer.h"
 #include "relay-network.h"
@@ -56,6 +57,8 @@ struct t_config_option *relay_config_network_allow_empty_password;
 struct t_config_option *relay_config_network_allowed_ips;
 struct t_config_option *relay_config_network_bind_address;
 struct t_config_option *relay_config_network_bind_path;
+struct t_config_option *relay_config_network_client_outqueue_full;
+struct t_config_option *relay_config_network_client_outqueue_max_size;
 struct t_config_option *relay_config_network_clients_purge_delay;
 struct t_config_option *relay_config_network_compression_level;
 struct t_config_option *relay_config_network_ipv6;
@@ -64,6 +67,7 @@ struct t_config_option *relay_config_network_password;
 struct t_config_option *relay_config_network_ssl_cert_key;
 struct t_config_option *relay_config_network_ssl_priorities;
 struct t_config_option *relay_config_network_websocket_allowed_origins;
+struct t_config_option *relay_config_network_websocket_permessage_deflate;
 
 /* relay config, irc section */
 
@@ -115,7 +119,7 @@ relay_config_change_network_allowed_ips (const void *pointer, void *data,
 
     if (relay_config_regex_allowed_ips)
     {
-        regfree (relay_config_regex_allowed_ips);
+        weechat_string_regfree (relay_config_regex_allowed_ips);
         free (relay_config_regex_allowed_ips);
         relay_config_regex_allowed_ips = NULL;
     }
@@ -290,7 +294,7 @@ relay_config_change_network_websocket_allowed_origins (const void *pointer, void
 
     if (relay_config_regex_websocket_allowed_origins)
     {
-        regfree (relay_config_regex_websocket_allowed_origins);
+        weechat_string_regfree (relay_config_regex_websocket_allowed_origins);
         free (relay_config_regex_websocket_allowed_origins);
         relay_config_regex_websocket_allowed_origins = NULL;
     }
@@ -357,6 +361,23 @@ relay_config_check_irc_backlog_tags (const void *pointer, void *data,
     return rc;
 }
 
+/*
+ * Callback for changes on options "relay.irc.backlog_max_minutes",
+ * "relay.irc.backlog_max_number" and "relay.irc.backlog_time_format".
+ */
+
+void
+relay_config_change_irc_backlog (const void *pointer, void *data,
+                                 struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    relay_irc_backlog_free_all ();
+}
+
 /*
  * Callback for changes on option "relay.irc.backlog_tags".
  */
@@ -396,6 +417,8 @@ relay_config_change_irc_backlog_tags (const void *pointer, void *data,
         }
         weechat_string_free_split (items);
     }
+
+    relay_irc_backlog_free_all ();
 }
 
 /*
@@ -527,7 +550,9 @@ relay_config_create_option_port (const void *pointer, void *data,
             rc = WEECHAT_CONFIG_OPTION_SET_ERROR;
         }
 
-        if ((protocol_number == RELAY_PROTOCOL_WEECHAT) && protocol_args)
+        if (((protocol_number == RELAY_PROTOCOL_WEECHAT)
+             || (protocol_number == RELAY_PROTOCOL_METRICS))
+            && protocol_args)
         {
             weechat_printf (NULL, _("%s%s: error: name is not allowed for "
                                     "protocol \"%s\""),
@@ -784,6 +809,28 @@ relay_config_init ()
         N_("path to listen on for unix domain sockets"),
         NULL, 0, 0, "%h/relay", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_client_outqueue_full = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "client_outqueue_full", "integer",
+        N_("action when the size of data waiting to be sent to a client "
+           "reaches the limit set in option "
+           "relay.network.client_outqueue_max_size: disconnect = disconnect "
+           "the client, resync = remove data not sent and send the event "
+           "\"_resync\" (weechat protocol only, the client is not "
+           "synchronized any more with buffers and must send command "
+           "\"sync\" again; the client is disconnected if data is "
+           "compressed with a stream)"),
+        "disconnect|resync", 0, 0, "disconnect", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_client_outqueue_max_size = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "client_outqueue_max_size", "integer",
+        N_("maximum size of data waiting to be sent to a client which does "
+           "not read data fast enough (in kilobytes, 0 = no limit); when "
+           "this size is reached, the action set in option "
+           "relay.network.client_outqueue_full is done"),
+        NULL, 0, INT_MAX, "0", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     relay_config_network_clients_purge_delay = weechat_config_new_option (
         relay_config_file, ptr_section,
         "clients_purge_delay", "integer",
@@ -855,6 +902,15 @@ relay_config_init ()
         NULL, NULL, NULL,
         &relay_config_change_network_websocket_allowed_origins, NULL, NULL,
         NULL, NULL, NULL);
+    relay_config_network_websocket_permessage_deflate = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "websocket_permessage_deflate", "boolean",
+        N_("accept the websocket extension \"permessage-deflate\" (RFC 7692) "
+           "if the client offers it: messages are then compressed with the "
+           "level set in option relay.network.compression_level (the "
+           "extension is not used if the level is 0)"),
+        NULL, 0, 0, "on", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* section irc */
     ptr_section = weechat_config_new_section (relay_config_file, "irc",
@@ -877,14 +933,18 @@ relay_config_init ()
            "(0 = unlimited, examples: 1440 = one day, 10080 = one week, "
            "43200 = one month, 525600 = one year)"),
         NULL, 0, INT_MAX, "1440", NULL, 0,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        NULL, NULL, NULL,
+        &relay_config_change_irc_backlog, NULL, NULL,
+        NULL, NULL, NULL);
     relay_config_irc_backlog_max_number = weechat_config_new_option (
         relay_config_file, ptr_section,
         "backlog_max_number", "integer",
         N_("maximum number of lines in backlog per IRC channel "
            "(0 = unlimited)"),
         NULL, 0, INT_MAX, "256", NULL, 0,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        NULL, NULL, NULL,
+        &relay_config_change_irc_backlog, NULL, NULL,
+        NULL, NULL, NULL);
     relay_config_irc_backlog_since_last_disconnect = weechat_config_new_option (
         relay_config_file, ptr_section,
         "backlog_since_last_disconnect", "boolean",
@@ -916,7 +976,9 @@ relay_config_init ()
            "client, because time is sent as irc tag); empty string = disable "
            "time in backlog messages"),
         NULL, 0, 0, "[%H:%M] ", NULL, 0,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        NULL, NULL, NULL,
+        &relay_config_change_irc_backlog, NULL, NULL,
+        NULL, NULL, NULL);
 
     /* section port */
     ptr_section = weechat_config_new_section (
@@ -977,14 +1039,14 @@ relay_config_free ()
 
     if (relay_config_regex_allowed_ips)
     {
-        regfree (relay_config_regex_allowed_ips);
+        weechat_string_regfree (relay_config_regex_allowed_ips);
         free (relay_config_regex_allowed_ips);
         relay_config_regex_allowed_ips = NULL;
     }
 
     if (relay_config_regex_websocket_allowed_origins)
     {
-        regfree (relay_config_regex_websocket_allowed_origins);
+        weechat_string_regfree (relay_config_regex_websocket_allowed_origins);
         free (relay_config_regex_websocket_allowed_origins);
         relay_config_regex_websocket_allowed_origins = NULL;
     }
@@ -24,6 +24,12 @@
 
 #define RELAY_CONFIG_NAME "relay"
 
+enum t_relay_config_client_outqueue_full
+{
+    RELAY_CONFIG_CLIENT_OUTQUEUE_FULL_DISCONNECT = 0,
+    RELAY_CONFIG_CLIENT_OUTQUEUE_FULL_RESYNC,
+};
+
 extern struct t_config_file *relay_config_file;
 extern struct t_config_section *relay_config_section_port;
 
@@ -40,6 +46,8 @@ extern struct t_config_option *relay_config_network_allow_empty_password;
 extern struct t_config_option *relay_config_network_allowed_ips;
 extern struct t_config_option *relay_config_network_bind_address;
 extern struct t_config_option *relay_config_network_bind_path;
+extern struct t_config_option *relay_config_network_client_outqueue_full;
+extern struct t_config_option *relay_config_network_client_outqueue_max_size;
 extern struct t_config_option *relay_config_network_clients_purge_delay;
 extern struct t_config_option *relay_config_network_compression_level;
 extern struct t_config_option *relay_config_network_ipv6;
@@ -48,6 +56,7 @@ extern struct t_config_option *relay_config_network_password;
 extern struct t_config_option *relay_config_network_ssl_cert_key;
 extern struct t_config_option *relay_config_network_ssl_priorities;
 extern struct t_config_option *relay_config_network_websocket_allowed_origins;
+extern struct t_config_option *relay_config_network_websocket_permessage_deflate;
 
 extern struct t_config_option *relay_config_irc_backlog_max_minutes;
 extern struct t_config_option *relay_config_irc_backlog_max_number;
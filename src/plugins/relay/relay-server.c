@@ -220,27 +220,24 @@ relay_server_close_socket (struct t_relay_server *server)
 }
 
 /*
- * Reads data from a client which is connecting on socket.
+ * Accepts a client which is connecting on socket.
+ *
+ * Returns:
+ *   1: a client was accepted (or rejected)
+ *   0: no more client is waiting on socket (or error)
  */
 
 int
-relay_server_sock_cb (const void *pointer, void *data, int fd)
+relay_server_accept_client (struct t_relay_server *server,
+                            const char *relay_password, int max_clients)
 {
-    struct t_relay_server *server;
     struct sockaddr_in client_addr;
     struct sockaddr_in6 client_addr6;
     socklen_t client_addr_size;
     void *ptr_addr;
-    int client_fd, flags, set, max_clients, num_clients_on_port;
+    int client_fd, flags, set, num_clients_on_port;
     char ipv4_address[INET_ADDRSTRLEN + 1], ipv6_address[INET6_ADDRSTRLEN + 1];
     char *ptr_ip_address;
-    const char *relay_password;
-
-    /* make C compiler happy */
-    (void) data;
-    (void) fd;
-
-    server = (struct t_relay_server *)pointer;
 
     if (server->ipv6)
     {
@@ -259,18 +256,21 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
                         &client_addr_size);
     if (client_fd < 0)
     {
+        /* no more client waiting on socket? */
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            return 0;
+        /* client aborted connection before it was accepted? */
+        if ((errno == EINTR) || (errno == ECONNABORTED))
+            return 1;
         weechat_printf (NULL,
                         _("%s%s: cannot accept client on port %d (%s): error %d %s"),
                         weechat_prefix ("error"), RELAY_PLUGIN_NAME,
                         server->port, server->protocol_string,
                         errno, strerror (errno));
-        return WEECHAT_RC_OK;
+        return 0;
     }
 
     /* check if relay password is empty and if it is not allowed */
-    relay_password = weechat_string_eval_expression (
-        weechat_config_string (relay_config_network_password),
-        NULL, NULL, NULL);
     if ((server->ipv4 || server->ipv6) && !weechat_config_boolean (relay_config_network_allow_empty_password)
         && (!relay_password || !relay_password[0]))
     {
@@ -280,11 +280,10 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
                           "relay.network.allow_empty_password is off"),
                         weechat_prefix ("error"), RELAY_PLUGIN_NAME);
         close (client_fd);
-        return WEECHAT_RC_OK;
+        return 1;
     }
 
     /* check if we have reached the max number of clients on this port */
-    max_clients = weechat_config_integer (relay_config_network_max_clients);
     if (max_clients > 0)
     {
         num_clients_on_port = relay_client_count_active_by_port (server->port);
@@ -300,7 +299,7 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
                 weechat_prefix ("error"), RELAY_PLUGIN_NAME,
                 max_clients);
             close (client_fd);
-            return WEECHAT_RC_OK;
+            return 1;
         }
     }
 
@@ -335,7 +334,8 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
 
     /* check if IP is allowed, if not, just close socket */
     if (relay_config_regex_allowed_ips
-        && (regexec (relay_config_regex_allowed_ips, ptr_ip_address, 0, NULL, 0) != 0))
+        && (weechat_string_regexec (relay_config_regex_allowed_ips,
+                                    ptr_ip_address, 0, NULL, 0) != 0))
     {
         if (weechat_relay_plugin->debug >= 1)
         {
@@ -346,7 +346,7 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
                             ptr_ip_address);
         }
         close (client_fd);
-        return WEECHAT_RC_OK;
+        return 1;
     }
 
     /* set non-blocking mode for socket */
@@ -366,12 +366,53 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
                         weechat_prefix ("error"), RELAY_PLUGIN_NAME,
                         "SO_REUSEADDR", set, errno, strerror (errno));
         close (client_fd);
-        return WEECHAT_RC_OK;
+        return 1;
     }
 
     /* add the client */
     relay_client_new (client_fd, ptr_ip_address, server);
 
+    return 1;
+}
+
+/*
+ * Accepts clients which are connecting on socket.
+ *
+ * The listening socket is non-blocking, so all clients waiting on socket are
+ * accepted in a loop (until accept returns EAGAIN), with a max of
+ * RELAY_SERVER_ACCEPT_MAX_CLIENTS clients per call, so that WeeChat remains
+ * responsive when many clients are connecting at same time.
+ */
+
+int
+relay_server_sock_cb (const void *pointer, void *data, int fd)
+{
+    struct t_relay_server *server;
+    char *relay_password;
+    int i, max_clients;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) fd;
+
+    server = (struct t_relay_server *)pointer;
+
+    relay_password = weechat_string_eval_expression (
+        weechat_config_string (relay_config_network_password),
+        NULL, NULL, NULL);
+    max_clients = weechat_config_integer (relay_config_network_max_clients);
+
+    for (i = 0; i < RELAY_SERVER_ACCEPT_MAX_CLIENTS; i++)
+    {
+        if (server->sock < 0)
+            break;
+        if (!relay_server_accept_client (server, relay_password, max_clients))
+            break;
+    }
+
+    if (relay_password)
+        free (relay_password);
+
     return WEECHAT_RC_OK;
 }
 
@@ -386,7 +427,7 @@ relay_server_sock_cb (const void *pointer, void *data, int fd)
 int
 relay_server_create_socket (struct t_relay_server *server)
 {
-    int domain, set, max_clients, addr_size;
+    int domain, set, flags, max_clients, addr_size;
     struct sockaddr_in server_addr;
     struct sockaddr_in6 server_addr6;
     struct sockaddr_un server_addru;
@@ -514,6 +555,12 @@ relay_server_create_socket (struct t_relay_server *server)
     }
 #endif /* IPV6_V6ONLY */
 
+    /* set non-blocking mode for socket (clients are accepted in a loop) */
+    flags = fcntl (server->sock, F_GETFL);
+    if (flags == -1)
+        flags = 0;
+    fcntl (server->sock, F_SETFL, flags | O_NONBLOCK);
+
     /* set option SO_REUSEADDR to 1 */
     set = 1;
     if (setsockopt (server->sock, SOL_SOCKET, SO_REUSEADDR,
@@ -22,6 +22,8 @@
 
 #include <time.h>
 
+#define RELAY_SERVER_ACCEPT_MAX_CLIENTS 64 /* max clients accepted at once  */
+
 #ifdef HAVE_GNUTLS
 #define RELAY_SERVER_GNUTLS_DH_BITS 1024
 #endif /* HAVE_GNUTLS */
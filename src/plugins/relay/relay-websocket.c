@@ -20,10 +20,12 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include <gcrypt.h>
+#include <zlib.h>
 
 #include "../weechat-plugin.h"
 #include "relay.h"
@@ -160,8 +162,8 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
         value = weechat_hashtable_get (client->http_headers, "origin");
         if (!value || !value[0])
             return -2;
-        if (regexec (relay_config_regex_websocket_allowed_origins, value, 0,
-                     NULL, 0) != 0)
+        if (weechat_string_regexec (relay_config_regex_websocket_allowed_origins,
+                                    value, 0, NULL, 0) != 0)
         {
             return -2;
         }
@@ -171,6 +173,212 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
     return 0;
 }
 
+/*
+ * Creates a new structure for extension "permessage-deflate".
+ *
+ * Returns pointer to new structure, NULL if error.
+ */
+
+struct t_relay_websocket_deflate *
+relay_websocket_deflate_new ()
+{
+    struct t_relay_websocket_deflate *new_ws_deflate;
+
+    new_ws_deflate = malloc (sizeof (*new_ws_deflate));
+    if (!new_ws_deflate)
+        return NULL;
+
+    new_ws_deflate->server_no_context_takeover = 0;
+    new_ws_deflate->client_no_context_takeover = 0;
+    new_ws_deflate->server_max_window_bits = 15;
+    new_ws_deflate->strm_deflate = NULL;
+    new_ws_deflate->strm_inflate = NULL;
+
+    return new_ws_deflate;
+}
+
+/*
+ * Frees a structure for extension "permessage-deflate".
+ */
+
+void
+relay_websocket_deflate_free (struct t_relay_websocket_deflate *ws_deflate)
+{
+    if (!ws_deflate)
+        return;
+
+    if (ws_deflate->strm_deflate)
+    {
+        deflateEnd (ws_deflate->strm_deflate);
+        free (ws_deflate->strm_deflate);
+    }
+    if (ws_deflate->strm_inflate)
+    {
+        inflateEnd (ws_deflate->strm_inflate);
+        free (ws_deflate->strm_inflate);
+    }
+
+    free (ws_deflate);
+}
+
+/*
+ * Parses the parameters of an offer "permessage-deflate" sent by client in
+ * HTTP header "Sec-WebSocket-Extensions", for example:
+ *   "permessage-deflate; client_max_window_bits; server_no_context_takeover"
+ *
+ * Returns a new structure if the offer is accepted, NULL if it is declined
+ * (unknown or unsupported parameter).
+ */
+
+struct t_relay_websocket_deflate *
+relay_websocket_parse_deflate_offer (const char *offer)
+{
+    struct t_relay_websocket_deflate *ws_deflate;
+    char **params, *name, *value, *pos, *error;
+    int i, num_params, rc;
+    long number;
+
+    params = weechat_string_split (offer, ";", 0, 0, &num_params);
+    if (!params)
+        return NULL;
+
+    ws_deflate = NULL;
+    rc = 0;
+
+    for (i = 0; i < num_params; i++)
+    {
+        value = NULL;
+        pos = strchr (params[i], '=');
+        if (pos)
+        {
+            pos[0] = '\0';
+            value = weechat_string_strip (pos + 1, 1, 1, " \"");
+        }
+        name = weechat_string_strip (params[i], 1, 1, " ");
+        if (!name)
+        {
+            if (value)
+                free (value);
+            rc = 0;
+            goto end;
+        }
+        if (i == 0)
+        {
+            /* name of extension */
+            if (strcmp (name, "permessage-deflate") == 0)
+                ws_deflate = relay_websocket_deflate_new ();
+            rc = (ws_deflate) ? 1 : 0;
+        }
+        else if (strcmp (name, "server_no_context_takeover") == 0)
+        {
+            ws_deflate->server_no_context_takeover = 1;
+        }
+        else if (strcmp (name, "client_no_context_takeover") == 0)
+        {
+            ws_deflate->client_no_context_takeover = 1;
+        }
+        else if (strcmp (name, "server_max_window_bits") == 0)
+        {
+            /* a window of 8 bits is not supported by zlib for raw deflate */
+            error = NULL;
+            number = (value) ? strtol (value, &error, 10) : 0;
+            if (error && !error[0] && (number >= 9) && (number <= 15))
+                ws_deflate->server_max_window_bits = number;
+            else
+                rc = 0;
+        }
+        else if (strcmp (name, "client_max_window_bits") != 0)
+        {
+            /* unknown parameter: decline the offer */
+            rc = 0;
+        }
+        free (name);
+        if (value)
+            free (value);
+        if (!rc)
+            break;
+    }
+
+end:
+    weechat_string_free_split (params);
+    if (!rc && ws_deflate)
+    {
+        relay_websocket_deflate_free (ws_deflate);
+        ws_deflate = NULL;
+    }
+    return ws_deflate;
+}
+
+/*
+ * Negotiates the extension "permessage-deflate" with the client: if an offer
+ * is accepted, the client uses compression of messages and the header
+ * "Sec-WebSocket-Extensions" of the response is written in "header" (it is
+ * set to empty string if no offer is accepted).
+ *
+ * The parameter "client_max_window_bits" is never sent in response: the
+ * inflate stream uses a window of 15 bits, which can decompress data
+ * compressed with any window.
+ */
+
+void
+relay_websocket_negotiate_deflate (struct t_relay_client *client,
+                                   char *header, int header_size)
+{
+    const char *extensions;
+    char **offers, str_window_bits[64];
+    int i, num_offers;
+
+    header[0] = '\0';
+
+    if (client->ws_deflate)
+    {
+        relay_websocket_deflate_free (client->ws_deflate);
+        client->ws_deflate = NULL;
+    }
+
+    if (!weechat_config_boolean (relay_config_network_websocket_permessage_deflate)
+        || (weechat_config_integer (relay_config_network_compression_level) == 0))
+    {
+        return;
+    }
+
+    extensions = weechat_hashtable_get (client->http_headers,
+                                        "sec-websocket-extensions");
+    if (!extensions || !extensions[0])
+        return;
+
+    /* use the first offer accepted */
+    offers = weechat_string_split (extensions, ",", 0, 0, &num_offers);
+    if (!offers)
+        return;
+    for (i = 0; i < num_offers; i++)
+    {
+        client->ws_deflate = relay_websocket_parse_deflate_offer (offers[i]);
+        if (client->ws_deflate)
+            break;
+    }
+    weechat_string_free_split (offers);
+
+    if (!client->ws_deflate)
+        return;
+
+    str_window_bits[0] = '\0';
+    if (client->ws_deflate->server_max_window_bits < 15)
+    {
+        snprintf (str_window_bits, sizeof (str_window_bits),
+                  "; server_max_window_bits=%d",
+                  client->ws_deflate->server_max_window_bits);
+    }
+
+    snprintf (header, header_size,
+              "Sec-WebSocket-Extensions: permessage-deflate%s%s%s\r\n",
+              (client->ws_deflate->server_no_context_takeover) ?
+              "; server_no_context_takeover" : "",
+              (client->ws_deflate->client_no_context_takeover) ?
+              "; client_no_context_takeover" : "",
+              str_window_bits);
+}
+
 /*
  * Builds the handshake that will be returned to client, to initialize and use
  * the websocket.
@@ -180,6 +388,9 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
  *   Upgrade: websocket
  *   Connection: Upgrade
  *   Sec-WebSocket-Accept: 73OzoF/IyV9znm7Tsb4EtlEEmn4=
+ *   Sec-WebSocket-Extensions: permessage-deflate
+ * (the last header is sent only if the extension "permessage-deflate" is
+ * negotiated).
  *
  * Note: result must be freed after use.
  */
@@ -188,7 +399,7 @@ char *
 relay_websocket_build_handshake (struct t_relay_client *client)
 {
     const char *sec_websocket_key;
-    char *key, sec_websocket_accept[128], handshake[1024];
+    char *key, sec_websocket_accept[128], extensions[256], handshake[1024];
     unsigned char *result;
     gcry_md_hd_t hd;
     int length;
@@ -219,6 +430,9 @@ relay_websocket_build_handshake (struct t_relay_client *client)
 
     free (key);
 
+    /* negotiate compression of messages (extension "permessage-deflate") */
+    relay_websocket_negotiate_deflate (client, extensions, sizeof (extensions));
+
     /* build the handshake (it will be sent as-is to client) */
     snprintf (handshake, sizeof (handshake),
               "HTTP/1.1 101 Switching Protocols\r\n"
@@ -226,8 +440,10 @@ relay_websocket_build_handshake (struct t_relay_client *client)
               "Connection: Upgrade\r\n"
               //"Sec-WebSocket-Protocol: chat\r\n"
               "Sec-WebSocket-Accept: %s\r\n"
+              "%s"
               "\r\n",
-              sec_websocket_accept);
+              sec_websocket_accept,
+              extensions);
 
     return strdup (handshake);
 }
@@ -252,27 +468,145 @@ relay_websocket_send_http (struct t_relay_client *client,
     {
         snprintf (message, length, "HTTP/1.1 %s\r\n\r\n", http);
         relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                           message, strlen (message), NULL);
+                           message, strlen (message), NULL, NULL);
         free (message);
     }
 }
 
+/*
+ * Decompresses data of a message received (extension "permessage-deflate");
+ * the 4 bytes 0x00 0x00 0xff 0xff removed by client at the end of data
+ * (RFC 7692) are given to zlib after the data.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid data or decompressed data too long)
+ */
+
+int
+relay_websocket_inflate (struct t_relay_client *client,
+                         unsigned char *data, unsigned long long size,
+                         unsigned char *inflated,
+                         unsigned long long inflated_size,
+                         unsigned long long *inflated_length)
+{
+    z_stream *strm;
+    unsigned char tail[4] = { 0x00, 0x00, 0xff, 0xff };
+    int rc;
+
+    *inflated_length = 0;
+
+    strm = client->ws_deflate->strm_inflate;
+    if (!strm)
+    {
+        strm = calloc (1, sizeof (*strm));
+        if (!strm)
+            return 0;
+        /* the client may use any window (up to 15 bits) */
+        if (inflateInit2 (strm, -15) != Z_OK)
+        {
+            free (strm);
+            return 0;
+        }
+        client->ws_deflate->strm_inflate = strm;
+    }
+
+    strm->next_in = (Bytef *)data;
+    strm->avail_in = size;
+    strm->next_out = (Bytef *)inflated;
+    strm->avail_out = inflated_size;
+
+    rc = inflate (strm, Z_NO_FLUSH);
+    if (((rc != Z_OK) && (rc != Z_BUF_ERROR))
+        || (strm->avail_in > 0) || (strm->avail_out == 0))
+    {
+        return 0;
+    }
+
+    strm->next_in = (Bytef *)tail;
+    strm->avail_in = sizeof (tail);
+
+    rc = inflate (strm, Z_SYNC_FLUSH);
+    if (((rc != Z_OK) && (rc != Z_BUF_ERROR))
+        || (strm->avail_in > 0) || (strm->avail_out == 0))
+    {
+        return 0;
+    }
+
+    *inflated_length = inflated_size - strm->avail_out;
+
+    if (client->ws_deflate->client_no_context_takeover)
+        inflateReset (strm);
+
+    return 1;
+}
+
+/*
+ * Unmasks data of a frame received from client: each byte is XOR'ed with
+ * the byte of mask at the same position (modulo 4).
+ *
+ * Data is unmasked 8 bytes at a time (with the mask replicated on 64 bits),
+ * then byte by byte for the remaining bytes.
+ *
+ * Unmasking can be done in place: "dest" can be the same as "src", or
+ * before "src" in the same buffer (each word is read before being written).
+ */
+
+void
+relay_websocket_unmask (unsigned char *dest, const unsigned char *src,
+                        unsigned long long length, const unsigned char *mask)
+{
+    unsigned char mask8[8];
+    uint64_t mask64, word;
+    unsigned long long i;
+
+    memcpy (mask8, mask, 4);
+    memcpy (mask8 + 4, mask, 4);
+    memcpy (&mask64, mask8, sizeof (mask64));
+
+    i = 0;
+    while (i + 8 <= length)
+    {
+        memcpy (&word, src + i, sizeof (word));
+        word ^= mask64;
+        memcpy (dest + i, &word, sizeof (word));
+        i += 8;
+    }
+    while (i < length)
+    {
+        dest[i] = src[i] ^ mask[i % 4];
+        i++;
+    }
+}
+
 /*
  * Decodes a websocket frame.
  *
+ * Each frame is written in "decoded" (which has a size of "decoded_size"
+ * bytes), as: message type (one byte), data, final '\0'. Data of frames
+ * compressed by client (extension "permessage-deflate") is decompressed.
+ *
+ * Data of frames is unmasked in place in "buffer" (so the content of buffer
+ * is changed). When the client does not compress frames, "decoded" can be
+ * the same as "buffer": the decoded data is never longer than the frames.
+ *
  * Returns:
  *   1: frame decoded successfully
  *   0: error decoding frame (connection must be closed if it happens)
  */
 
 int
-relay_websocket_decode_frame (const unsigned char *buffer,
+relay_websocket_decode_frame (struct t_relay_client *client,
+                              unsigned char *buffer,
                               unsigned long long buffer_length,
                               unsigned char *decoded,
+                              unsigned long long decoded_size,
                               unsigned long long *decoded_length)
 {
     unsigned long long i, index_buffer, length_frame_size, length_frame;
-    unsigned char opcode;
+    unsigned long long length_inflated;
+    unsigned char opcode, masks[4];
+    int compressed;
 
     *decoded_length = 0;
     index_buffer = 0;
@@ -282,6 +616,15 @@ relay_websocket_decode_frame (const unsigned char *buffer,
     {
         opcode = buffer[index_buffer] & 15;
 
+        /*
+         * a compressed frame is allowed only if the extension
+         * "permessage-deflate" was negotiated (and never for control frames)
+         */
+        compressed = (buffer[index_buffer] & RELAY_WEBSOCKET_FRAME_RSV1) ?
+            1 : 0;
+        if (compressed && (!client->ws_deflate || (opcode & 8)))
+            return 0;
+
         /*
          * check if frame is masked: client MUST send a masked frame; if frame is
          * not masked, we MUST reject it and close the connection (see RFC 6455)
@@ -296,7 +639,7 @@ relay_websocket_decode_frame (const unsigned char *buffer,
         if ((length_frame == 126) || (length_frame == 127))
         {
             length_frame_size = (length_frame == 126) ? 2 : 8;
-            if (buffer_length < 1 + length_frame_size)
+            if (index_buffer + length_frame_size > buffer_length)
                 return 0;
             length_frame = 0;
             for (i = 0; i < length_frame_size; i++)
@@ -306,29 +649,51 @@ relay_websocket_decode_frame (const unsigned char *buffer,
             index_buffer += length_frame_size;
         }
 
-        if (buffer_length < 1 + length_frame_size + 4 + length_frame)
+        if ((index_buffer + 4 > buffer_length)
+            || (length_frame > buffer_length - index_buffer - 4))
+        {
             return 0;
+        }
 
         /* read masks (4 bytes) */
-        int masks[4];
-        for (i = 0; i < 4; i++)
-        {
-            masks[i] = (int)((unsigned char)buffer[index_buffer + i]);
-        }
+        memcpy (masks, buffer + index_buffer, 4);
         index_buffer += 4;
 
+        /* check that there is enough space for message type, data and '\0' */
+        if (*decoded_length + 1 + ((compressed) ? 0 : length_frame) + 1 > decoded_size)
+            return 0;
+
         /* copy opcode in decoded data */
         decoded[*decoded_length] = (opcode == WEBSOCKET_FRAME_OPCODE_PING) ?
             RELAY_CLIENT_MSG_PING : RELAY_CLIENT_MSG_STANDARD;
         *decoded_length += 1;
 
-        /* decode data using masks */
-        for (i = 0; i < length_frame; i++)
+        if (compressed)
+        {
+            /* decode data in place using masks, then decompress it */
+            relay_websocket_unmask (buffer + index_buffer,
+                                    buffer + index_buffer,
+                                    length_frame, masks);
+            if (!relay_websocket_inflate (client,
+                                          buffer + index_buffer, length_frame,
+                                          decoded + *decoded_length,
+                                          decoded_size - *decoded_length - 1,
+                                          &length_inflated))
+            {
+                return 0;
+            }
+            decoded[*decoded_length + length_inflated] = '\0';
+            *decoded_length += length_inflated + 1;
+        }
+        else
         {
-            decoded[*decoded_length + i] = (int)((unsigned char)buffer[index_buffer + i]) ^ masks[i % 4];
+            /* decode data using masks */
+            relay_websocket_unmask (decoded + *decoded_length,
+                                    buffer + index_buffer,
+                                    length_frame, masks);
+            decoded[*decoded_length + length_frame] = '\0';
+            *decoded_length += length_frame + 1;
         }
-        decoded[*decoded_length + length_frame] = '\0';
-        *decoded_length += length_frame + 1;
         index_buffer += length_frame;
     }
 
@@ -336,65 +701,128 @@ relay_websocket_decode_frame (const unsigned char *buffer,
 }
 
 /*
- * Encodes data in a websocket frame.
+ * Compresses data of a message to send (extension "permessage-deflate").
  *
- * Returns websocket frame, NULL if error.
- * Argument "length_frame" is set with the length of frame built.
+ * Returns compressed data, NULL if error (then data must be sent without
+ * compression).
+ * Argument "compressed_size" is set with the size of compressed data.
  *
  * Note: result must be freed after use.
  */
 
 char *
-relay_websocket_encode_frame (int opcode,
-                              const char *buffer,
-                              unsigned long long length,
-                              unsigned long long *length_frame)
+relay_websocket_deflate (struct t_relay_client *client,
+                         const char *data, int size, int *compressed_size)
 {
-    unsigned char *frame;
-    unsigned long long index;
+    z_stream *strm;
+    char *dest;
+    int dest_size, level;
 
-    *length_frame = 0;
+    *compressed_size = 0;
 
-    frame = malloc (length + 10);
-    if (!frame)
+    strm = client->ws_deflate->strm_deflate;
+    if (!strm)
+    {
+        strm = calloc (1, sizeof (*strm));
+        if (!strm)
+            return NULL;
+        level = weechat_config_integer (relay_config_network_compression_level);
+        if (deflateInit2 (strm, (level > 0) ? level : Z_DEFAULT_COMPRESSION,
+                          Z_DEFLATED,
+                          -(client->ws_deflate->server_max_window_bits),
+                          8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            free (strm);
+            return NULL;
+        }
+        client->ws_deflate->strm_deflate = strm;
+    }
+
+    /* the sync flush adds at most a few bytes to the bound */
+    dest_size = deflateBound (strm, size) + 16;
+    dest = malloc (dest_size);
+    if (!dest)
         return NULL;
 
-    frame[0] = 0x80;
-    frame[0] |= opcode;
+    strm->next_in = (Bytef *)data;
+    strm->avail_in = size;
+    strm->next_out = (Bytef *)dest;
+    strm->avail_out = dest_size;
 
-    if (length <= 125)
+    if ((deflate (strm, Z_SYNC_FLUSH) != Z_OK)
+        || (strm->avail_in > 0) || (strm->avail_out == 0))
     {
-        /* length on one byte */
-        frame[1] = length;
-        index = 2;
+        /* the stream can not be used any more */
+        deflateEnd (strm);
+        free (strm);
+        client->ws_deflate->strm_deflate = NULL;
+        free (dest);
+        return NULL;
     }
-    else if ((length >= 126) && (length <= 65535))
+
+    *compressed_size = dest_size - strm->avail_out;
+
+    /* remove the 4 bytes 0x00 0x00 0xff 0xff at the end (RFC 7692) */
+    if ((*compressed_size >= 4)
+        && (memcmp (dest + *compressed_size - 4, "\x00\x00\xff\xff", 4) == 0))
     {
-        /* length on 2 bytes */
-        frame[1] = 126;
-        frame[2] = (length >> 8) & 0xFF;
-        frame[3] = length & 0xFF;
-        index = 4;
+        *compressed_size -= 4;
     }
-    else
+    if (*compressed_size == 0)
     {
-        /* length on 8 bytes */
-        frame[1] = 127;
-        frame[2] = (length >> 56) & 0xFF;
-        frame[3] = (length >> 48) & 0xFF;
-        frame[4] = (length >> 40) & 0xFF;
-        frame[5] = (length >> 32) & 0xFF;
-        frame[6] = (length >> 24) & 0xFF;
-        frame[7] = (length >> 16) & 0xFF;
-        frame[8] = (length >> 8) & 0xFF;
-        frame[9] = length & 0xFF;
-        index = 10;
+        /* empty message: a single byte 0x00 is sent */
+        dest[0] = 0;
+        *compressed_size = 1;
     }
 
-    /* copy buffer after length */
-    memcpy (frame + index, buffer, length);
+    if (client->ws_deflate->server_no_context_takeover)
+        deflateReset (strm);
+
+    return dest;
+}
+
+/*
+ * Builds the header of a websocket frame (the payload of frame is sent after
+ * this header, so that data is not copied in a frame).
+ *
+ * Argument "header" must have at least RELAY_WEBSOCKET_FRAME_HEADER_MAX
+ * bytes.
+ *
+ * Returns the size of header.
+ */
+
+int
+relay_websocket_encode_frame_header (int opcode, unsigned long long length,
+                                     unsigned char *header)
+{
+    header[0] = 0x80;
+    header[0] |= opcode;
 
-    *length_frame = index + length;
+    if (length <= 125)
+    {
+        /* length on one byte */
+        header[1] = length;
+        return 2;
+    }
+
+    if ((length >= 126) && (length <= 65535))
+    {
+        /* length on 2 bytes */
+        header[1] = 126;
+        header[2] = (length >> 8) & 0xFF;
+        header[3] = length & 0xFF;
+        return 4;
+    }
 
-    return (char *)frame;
+    /* length on 8 bytes */
+    header[1] = 127;
+    header[2] = (length >> 56) & 0xFF;
+    header[3] = (length >> 48) & 0xFF;
+    header[4] = (length >> 40) & 0xFF;
+    header[5] = (length >> 32) & 0xFF;
+    header[6] = (length >> 24) & 0xFF;
+    header[7] = (length >> 16) & 0xFF;
+    header[8] = (length >> 8) & 0xFF;
+    header[9] = length & 0xFF;
+    return 10;
 }
@@ -20,6 +20,8 @@
 #ifndef WEECHAT_RELAY_WEBSOCKET_H
 #define WEECHAT_RELAY_WEBSOCKET_H 1
 
+#include <zlib.h>
+
 #define WEBSOCKET_FRAME_OPCODE_CONTINUATION 0x00
 #define WEBSOCKET_FRAME_OPCODE_TEXT         0x01
 #define WEBSOCKET_FRAME_OPCODE_BINARY       0x02
@@ -27,6 +29,22 @@
 #define WEBSOCKET_FRAME_OPCODE_PING         0x09
 #define WEBSOCKET_FRAME_OPCODE_PONG         0x0A
 
+/* max size of a frame header (without mask, which is not used by server) */
+#define RELAY_WEBSOCKET_FRAME_HEADER_MAX    10
+
+/* websocket extension "permessage-deflate" (RFC 7692) */
+
+#define RELAY_WEBSOCKET_FRAME_RSV1          0x40
+
+struct t_relay_websocket_deflate
+{
+    int server_no_context_takeover;    /* 1 = reset deflate after each msg  */
+    int client_no_context_takeover;    /* 1 = reset inflate after each msg  */
+    int server_max_window_bits;        /* window bits for deflate (9-15)    */
+    z_stream *strm_deflate;            /* stream to compress sent messages  */
+    z_stream *strm_inflate;            /* stream to decompress received msgs*/
+};
+
 extern int relay_websocket_is_http_get_weechat (const char *message);
 extern void relay_websocket_save_header (struct t_relay_client *client,
                                          const char *message);
@@ -34,13 +52,23 @@ extern int relay_websocket_client_handshake_valid (struct t_relay_client *client
 extern char *relay_websocket_build_handshake (struct t_relay_client *client);
 extern void relay_websocket_send_http (struct t_relay_client *client,
                                        const char *http);
-extern int relay_websocket_decode_frame (const unsigned char *buffer,
+extern struct t_relay_websocket_deflate *relay_websocket_deflate_new ();
+extern void relay_websocket_deflate_free (struct t_relay_websocket_deflate *ws_deflate);
+extern void relay_websocket_unmask (unsigned char *dest,
+                                   const unsigned char *src,
+                                   unsigned long long length,
+                                   const unsigned char *mask);
+extern int relay_websocket_decode_frame (struct t_relay_client *client,
+                                         unsigned char *buffer,
                                          unsigned long long length,
                                          unsigned char *decoded,
+                                         unsigned long long decoded_size,
                                          unsigned long long *decoded_length);
-extern char *relay_websocket_encode_frame (int opcode,
-                                           const char *buffer,
-                                           unsigned long long length,
-                                           unsigned long long *length_frame);
+extern char *relay_websocket_deflate (struct t_relay_client *client,
+                                      const char *data, int size,
+                                      int *compressed_size);
+extern int relay_websocket_encode_frame_header (int opcode,
+                                                unsigned long long length,
+                                                unsigned char *header);
 
 #endif /* WEECHAT_RELAY_WEBSOCKET_H */
@@ -34,6 +34,7 @@
 #include "relay-raw.h"
 #include "relay-server.h"
 #include "relay-upgrade.h"
+#include "irc/relay-irc-backlog.h"
 
 
 WEECHAT_PLUGIN_NAME(RELAY_PLUGIN_NAME);
@@ -49,7 +50,7 @@ struct t_weechat_plugin *weechat_relay_plugin = NULL;
 int relay_signal_upgrade_received = 0; /* signal "upgrade" received ?       */
 
 char *relay_protocol_string[] =        /* strings for protocols             */
-{ "weechat", "irc" };
+{ "weechat", "irc", "metrics" };
 
 struct t_hook *relay_hook_timer = NULL;
 
@@ -180,6 +181,39 @@ relay_debug_dump_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Callback for signal "debug_memory".
+ */
+
+int
+relay_debug_memory_cb (const void *pointer, void *data,
+                       const char *signal, const char *type_data,
+                       void *signal_data)
+{
+    struct t_relay_client *ptr_client;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    weechat_printf (NULL, "");
+    weechat_printf (NULL, "%s:", RELAY_PLUGIN_NAME);
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        weechat_printf (NULL,
+                        "  %s: out queue: %d messages (%llu bytes)",
+                        ptr_client->desc,
+                        ptr_client->outqueue_count,
+                        ptr_client->outqueue_size);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Initializes relay plugin.
  */
@@ -209,6 +243,7 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_hook_signal ("upgrade", &relay_signal_upgrade_cb, NULL, NULL);
     weechat_hook_signal ("debug_dump", &relay_debug_dump_cb, NULL, NULL);
+    weechat_hook_signal ("debug_memory", &relay_debug_memory_cb, NULL, NULL);
 
     relay_info_init ();
 
@@ -262,6 +297,8 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
         relay_client_free_all ();
     }
 
+    relay_irc_backlog_free_all ();
+
     relay_network_end ();
 
     relay_config_free ();
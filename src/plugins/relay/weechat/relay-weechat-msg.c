@@ -41,6 +41,10 @@
 #include "../relay-raw.h"
 
 
+struct t_relay_weechat_msg_shared relay_weechat_msg_shared =
+{ NULL, NULL, { NULL }, { 0 } };       /* message shared by all clients     */
+
+
 /*
  * Builds a new message (for sending to client).
  *
@@ -57,6 +61,7 @@ relay_weechat_msg_new (const char *id)
         return NULL;
 
     new_msg->id = (id) ? strdup (id) : NULL;
+    new_msg->coalesce_key = NULL;
     new_msg->data = malloc (RELAY_WEECHAT_MSG_INITIAL_ALLOC);
     if (!new_msg->data)
     {
@@ -76,6 +81,21 @@ relay_weechat_msg_new (const char *id)
     return new_msg;
 }
 
+/*
+ * Sets the coalesce key of a message: if the message is queued for a client,
+ * it replaces the messages with same key not yet sent (the message must
+ * contain the whole state, for example full nicklist of a buffer).
+ */
+
+void
+relay_weechat_msg_set_coalesce_key (struct t_relay_weechat_msg *msg,
+                                    const char *coalesce_key)
+{
+    if (msg->coalesce_key)
+        free (msg->coalesce_key);
+    msg->coalesce_key = (coalesce_key) ? strdup (coalesce_key) : NULL;
+}
+
 /*
  * Adds some bytes to a message.
  */
@@ -319,6 +339,121 @@ relay_weechat_msg_add_hashtable (struct t_relay_weechat_msg *msg,
                            &relay_weechat_msg_hashtable_map_cb, msg);
 }
 
+/*
+ * Checks if an object of hdata matches the filters of options (tags, dates,
+ * condition).
+ *
+ * Returns:
+ *   1: object matches filters
+ *   0: object does not match filters
+ */
+
+int
+relay_weechat_msg_hdata_match (struct t_hdata *hdata, void *pointer,
+                               int index_path, void **path_pointers,
+                               struct t_relay_weechat_msg_hdata_options *options)
+{
+    int i, j, num_tags, match;
+    char str_tag[512], *result;
+    const char *ptr_tag;
+    time_t date;
+    struct t_hashtable *pointers, *eval_options;
+
+    /* filter on dates */
+    if ((options->date_min > 0) || (options->date_max > 0))
+    {
+        if (weechat_hdata_get_var_type (hdata, "date") != WEECHAT_HDATA_TIME)
+            return 0;
+        date = weechat_hdata_time (hdata, pointer, "date");
+        if ((options->date_min > 0) && (date < options->date_min))
+            return 0;
+        if ((options->date_max > 0) && (date > options->date_max))
+            return 0;
+    }
+
+    /* filter on tags: object must have at least one of the tags */
+    if (options->num_tags > 0)
+    {
+        num_tags = weechat_hdata_get_var_array_size (hdata, pointer,
+                                                     "tags_array");
+        match = 0;
+        for (i = 0; !match && (i < num_tags); i++)
+        {
+            snprintf (str_tag, sizeof (str_tag), "%d|tags_array", i);
+            ptr_tag = weechat_hdata_string (hdata, pointer, str_tag);
+            if (!ptr_tag)
+                continue;
+            for (j = 0; j < options->num_tags; j++)
+            {
+                if (weechat_string_match (ptr_tag, options->tags[j], 0))
+                {
+                    match = 1;
+                    break;
+                }
+            }
+        }
+        if (!match)
+            return 0;
+    }
+
+    /* filter on condition, with pointers of all hdata in path */
+    if (options->condition && options->condition[0])
+    {
+        pointers = weechat_hashtable_new (32,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          WEECHAT_HASHTABLE_POINTER,
+                                          NULL, NULL);
+        eval_options = weechat_hashtable_new (32,
+                                              WEECHAT_HASHTABLE_STRING,
+                                              WEECHAT_HASHTABLE_STRING,
+                                              NULL, NULL);
+        if (pointers && options->hdata_names)
+        {
+            for (i = 0; (i <= index_path) && options->hdata_names[i]; i++)
+            {
+                weechat_hashtable_set (pointers, options->hdata_names[i],
+                                       path_pointers[i]);
+            }
+        }
+        if (eval_options)
+            weechat_hashtable_set (eval_options, "type", "condition");
+        result = weechat_string_eval_expression (options->condition,
+                                                 pointers, NULL,
+                                                 eval_options);
+        match = (result && (strcmp (result, "1") == 0)) ? 1 : 0;
+        if (result)
+            free (result);
+        if (pointers)
+            weechat_hashtable_free (pointers);
+        if (eval_options)
+            weechat_hashtable_free (eval_options);
+        if (!match)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Sends the objects of hdata added so far in a message (chunk), then removes
+ * them from message (the hdata header is kept for next objects).
+ */
+
+void
+relay_weechat_msg_hdata_send_chunk (struct t_relay_weechat_msg *msg,
+                                    struct t_relay_weechat_msg_hdata_options *options)
+{
+    uint32_t count32;
+
+    count32 = htonl ((uint32_t)options->count_msg);
+    relay_weechat_msg_set_bytes (msg, options->pos_count, &count32, 4);
+
+    relay_weechat_msg_send (options->client, msg);
+
+    msg->data_size = options->pos_objects;
+    options->count_msg = 0;
+}
+
 /*
  * Adds recursively hdata for a path to a message.
  *
@@ -332,11 +467,12 @@ relay_weechat_msg_add_hdata_path (struct t_relay_weechat_msg *msg,
                                   void **path_pointers,
                                   struct t_hdata *hdata,
                                   void *pointer,
-                                  char **list_keys)
+                                  struct t_hdata_field **fields,
+                                  int num_fields,
+                                  struct t_relay_weechat_msg_hdata_options *options)
 {
     int num_added, i, j, count, count_all, var_type, array_size, max_array_size;
-    int length;
-    char *pos, *pos2, *str_count, *error, *name;
+    char *pos, *pos2, *str_count, *error;
     void *sub_pointer;
     struct t_hdata *sub_hdata;
     const char *sub_hdata_name;
@@ -356,6 +492,8 @@ relay_weechat_msg_add_hdata_path (struct t_relay_weechat_msg *msg,
             {
                 if (strcmp (str_count, "*") == 0)
                     count_all = 1;
+                else if (strcmp (str_count, "-*") == 0)
+                    count_all = -1;
                 else
                 {
                     error = NULL;
@@ -377,6 +515,10 @@ relay_weechat_msg_add_hdata_path (struct t_relay_weechat_msg *msg,
 
     while (pointer)
     {
+        /* max number of objects reached? */
+        if ((options->max > 0) && (options->count_total >= options->max))
+            break;
+
         path_pointers[index_path] = pointer;
 
         if (list_path[index_path + 1])
@@ -400,119 +542,125 @@ relay_weechat_msg_add_hdata_path (struct t_relay_weechat_msg *msg,
                                                                    path_pointers,
                                                                    sub_hdata,
                                                                    sub_pointer,
-                                                                   list_keys);
+                                                                   fields,
+                                                                   num_fields,
+                                                                   options);
                 }
             }
         }
-        else
+        else if (options->after && !options->after_found)
+        {
+            /* skip objects until the object "after" is found (excluded) */
+            if (pointer == options->after)
+                options->after_found = 1;
+        }
+        else if (relay_weechat_msg_hdata_match (hdata, pointer, index_path,
+                                                path_pointers, options))
         {
             /* last path? then get pointer + values and fill message with them */
             for (i = 0; list_path[i]; i++)
             {
                 relay_weechat_msg_add_pointer (msg, path_pointers[i]);
             }
-            for (i = 0; list_keys[i]; i++)
+            for (i = 0; i < num_fields; i++)
             {
-                var_type = weechat_hdata_get_var_type (hdata, list_keys[i]);
-                if ((var_type >= 0) && (var_type != WEECHAT_HDATA_OTHER))
+                if (!fields[i])
+                    continue;
+                var_type = weechat_hdata_field_type (fields[i]);
+                max_array_size = 1;
+                array_size = weechat_hdata_field_array_size (fields[i], pointer);
+                if (array_size >= 0)
                 {
-                    max_array_size = 1;
-                    array_size = weechat_hdata_get_var_array_size (hdata,
-                                                                   pointer,
-                                                                   list_keys[i]);
-                    if (array_size >= 0)
+                    switch (var_type)
                     {
-                        switch (var_type)
-                        {
-                            case WEECHAT_HDATA_CHAR:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_CHAR);
-                                break;
-                            case WEECHAT_HDATA_INTEGER:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_INT);
-                                break;
-                            case WEECHAT_HDATA_LONG:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_LONG);
-                                break;
-                            case WEECHAT_HDATA_STRING:
-                            case WEECHAT_HDATA_SHARED_STRING:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_STRING);
-                                break;
-                            case WEECHAT_HDATA_POINTER:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_POINTER);
-                                break;
-                            case WEECHAT_HDATA_TIME:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_TIME);
-                                break;
-                            case WEECHAT_HDATA_HASHTABLE:
-                                relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_HASHTABLE);
-                                break;
-                        }
-                        relay_weechat_msg_add_int (msg, array_size);
-                        max_array_size = array_size;
+                        case WEECHAT_HDATA_CHAR:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_CHAR);
+                            break;
+                        case WEECHAT_HDATA_INTEGER:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_INT);
+                            break;
+                        case WEECHAT_HDATA_LONG:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_LONG);
+                            break;
+                        case WEECHAT_HDATA_STRING:
+                        case WEECHAT_HDATA_SHARED_STRING:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_STRING);
+                            break;
+                        case WEECHAT_HDATA_POINTER:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_POINTER);
+                            break;
+                        case WEECHAT_HDATA_TIME:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_TIME);
+                            break;
+                        case WEECHAT_HDATA_HASHTABLE:
+                            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_HASHTABLE);
+                            break;
                     }
-                    length = 16 + strlen (list_keys[i]) + 1;
-                    name = malloc (length);
-                    if (name)
+                    relay_weechat_msg_add_int (msg, array_size);
+                    max_array_size = array_size;
+                }
+                for (j = 0; j < max_array_size; j++)
+                {
+                    switch (var_type)
                     {
-                        for (j = 0; j < max_array_size; j++)
-                        {
-                            snprintf (name, length, "%d|%s", j, list_keys[i]);
-                            switch (var_type)
-                            {
-                                case WEECHAT_HDATA_CHAR:
-                                    relay_weechat_msg_add_char (msg,
-                                                                weechat_hdata_char (hdata,
+                        case WEECHAT_HDATA_CHAR:
+                            relay_weechat_msg_add_char (msg,
+                                                        weechat_hdata_field_char (fields[i],
+                                                                                  pointer,
+                                                                                  j));
+                            break;
+                        case WEECHAT_HDATA_INTEGER:
+                            relay_weechat_msg_add_int (msg,
+                                                       weechat_hdata_field_integer (fields[i],
                                                                                     pointer,
-                                                                                    name));
-                                    break;
-                                case WEECHAT_HDATA_INTEGER:
-                                    relay_weechat_msg_add_int (msg,
-                                                               weechat_hdata_integer (hdata,
+                                                                                    j));
+                            break;
+                        case WEECHAT_HDATA_LONG:
+                            relay_weechat_msg_add_long (msg,
+                                                        weechat_hdata_field_long (fields[i],
+                                                                                  pointer,
+                                                                                  j));
+                            break;
+                        case WEECHAT_HDATA_STRING:
+                        case WEECHAT_HDATA_SHARED_STRING:
+                            relay_weechat_msg_add_string (msg,
+                                                          weechat_hdata_field_string (fields[i],
                                                                                       pointer,
-                                                                                      name));
-                                    break;
-                                case WEECHAT_HDATA_LONG:
-                                    relay_weechat_msg_add_long (msg,
-                                                                weechat_hdata_long (hdata,
-                                                                                    pointer,
-                                                                                    name));
-                                    break;
-                                case WEECHAT_HDATA_STRING:
-                                case WEECHAT_HDATA_SHARED_STRING:
-                                    relay_weechat_msg_add_string (msg,
-                                                                  weechat_hdata_string (hdata,
+                                                                                      j));
+                            break;
+                        case WEECHAT_HDATA_POINTER:
+                            relay_weechat_msg_add_pointer (msg,
+                                                           weechat_hdata_field_pointer (fields[i],
                                                                                         pointer,
-                                                                                        name));
-                                    break;
-                                case WEECHAT_HDATA_POINTER:
-                                    relay_weechat_msg_add_pointer (msg,
-                                                                   weechat_hdata_pointer (hdata,
-                                                                                          pointer,
-                                                                                          name));
-                                    break;
-                                case WEECHAT_HDATA_TIME:
-                                    relay_weechat_msg_add_time (msg,
-                                                                weechat_hdata_time (hdata,
-                                                                                    pointer,
-                                                                                    name));
-                                    break;
-                                case WEECHAT_HDATA_HASHTABLE:
-                                    relay_weechat_msg_add_hashtable (msg,
-                                                                     weechat_hdata_hashtable (hdata,
-                                                                                              pointer,
-                                                                                              name));
-                                    break;
-                            }
-                        }
-                        free (name);
+                                                                                        j));
+                            break;
+                        case WEECHAT_HDATA_TIME:
+                            relay_weechat_msg_add_time (msg,
+                                                        weechat_hdata_field_time (fields[i],
+                                                                                  pointer,
+                                                                                  j));
+                            break;
+                        case WEECHAT_HDATA_HASHTABLE:
+                            relay_weechat_msg_add_hashtable (msg,
+                                                             weechat_hdata_field_hashtable (fields[i],
+                                                                                            pointer,
+                                                                                            j));
+                            break;
                     }
                 }
             }
             num_added++;
+            options->count_msg++;
+            options->count_total++;
+            if (options->client && (options->chunk > 0)
+                && (options->count_msg >= options->chunk))
+            {
+                relay_weechat_msg_hdata_send_chunk (msg, options);
+            }
         }
         if (count_all)
         {
-            pointer = weechat_hdata_move (hdata, pointer, 1);
+            pointer = weechat_hdata_move (hdata, pointer, count_all);
         }
         else if (count == 0)
             pointer = NULL;
@@ -534,7 +682,8 @@ relay_weechat_msg_add_hdata_path (struct t_relay_weechat_msg *msg,
 }
 
 /*
- * Adds a hdata to a message.
+ * Adds a hdata to a message, with options (filters on objects, max number of
+ * objects, chunks).
  *
  * Argument path has format:
  *   hdata_head:ptr->var->var->...->var
@@ -543,22 +692,29 @@ relay_weechat_msg_add_hdata_path (struct t_relay_weechat_msg *msg,
  * Argument keys is optional: if not NULL, comma-separated list of keys to
  * return for hdata.
  *
+ * Argument options is optional (can be NULL). If the option "chunk" is set,
+ * some objects may be sent to the client during the call (in messages with
+ * at most "chunk" objects); the remaining objects are in the message.
+ *
  * Returns:
  *   1: hdata added to message
  *   0: error (hdata NOT added to message)
  */
 
 int
-relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
-                             const char *path, const char *keys)
+relay_weechat_msg_add_hdata_options (struct t_relay_weechat_msg *msg,
+                                     const char *path, const char *keys,
+                                     struct t_relay_weechat_msg_hdata_options *options)
 {
+    struct t_relay_weechat_msg_hdata_options default_options;
     struct t_hdata *ptr_hdata_head, *ptr_hdata;
+    struct t_hdata_field **fields;
     char *hdata_head, *pos, **list_keys, *keys_types, **list_path;
-    char *path_returned;
+    char *path_returned, **hdata_names;
     const char *hdata_name, *array_size;
     void *pointer, **path_pointers;
     long unsigned int value;
-    int rc, num_keys, num_path, i, type, pos_count, count, rc_sscanf;
+    int rc, num_keys, num_path, i, type, rc_sscanf;
     uint32_t count32;
 
     rc = 0;
@@ -567,9 +723,17 @@ relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
     list_keys = NULL;
     num_keys = 0;
     keys_types = NULL;
+    fields = NULL;
     list_path = NULL;
     num_path = 0;
     path_returned = NULL;
+    hdata_names = NULL;
+
+    if (!options)
+    {
+        memset (&default_options, 0, sizeof (default_options));
+        options = &default_options;
+    }
 
     /* extract hdata name (head) from path */
     pos = strchr (path, ':');
@@ -627,10 +791,15 @@ relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
     path_returned = malloc (strlen (path) * 2);
     if (!path_returned)
         goto end;
+    hdata_names = malloc (sizeof (*hdata_names) * (num_path + 1));
+    if (!hdata_names)
+        goto end;
+    hdata_names[0] = hdata_head;
     ptr_hdata = ptr_hdata_head;
     strcpy (path_returned, hdata_head);
     for (i = 1; i < num_path; i++)
     {
+        hdata_names[i] = NULL;
         pos = strchr (list_path[i], '(');
         if (pos)
             pos[0] = '\0';
@@ -640,11 +809,13 @@ relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
         ptr_hdata = weechat_hdata_get (hdata_name);
         if (!ptr_hdata)
             goto end;
+        hdata_names[i] = (char *)hdata_name;
         strcat (path_returned, "/");
         strcat (path_returned, hdata_name);
         if (pos)
             pos[0] = '(';
     }
+    hdata_names[num_path] = NULL;
 
     /* split keys */
     if (!keys)
@@ -658,10 +829,18 @@ relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
     if (!keys_types)
         goto end;
     keys_types[0] = '\0';
+
+    /* search variables only once (they are read for each object) */
+    fields = calloc (num_keys, sizeof (*fields));
+    if (!fields)
+        goto end;
+
     for (i = 0; i < num_keys; i++)
     {
         type = weechat_hdata_get_var_type (ptr_hdata, list_keys[i]);
         if ((type >= 0) && (type != WEECHAT_HDATA_OTHER))
+            fields[i] = weechat_hdata_field_new (ptr_hdata, list_keys[i]);
+        if (fields[i])
         {
             if (keys_types[0])
                 strcat (keys_types, ",");
@@ -711,27 +890,42 @@ relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
     relay_weechat_msg_add_string (msg, keys_types);
 
     /* "count" will be set later, with number of objects in hdata */
-    pos_count = msg->data_size;
-    count = 0;
+    options->hdata_names = hdata_names;
+    options->after_found = 0;
+    options->pos_count = msg->data_size;
+    options->count_msg = 0;
+    options->count_total = 0;
     relay_weechat_msg_add_int (msg, 0);
+    options->pos_objects = msg->data_size;
     path_pointers = malloc (sizeof (*path_pointers) * num_path);
     if (path_pointers)
     {
-        count = relay_weechat_msg_add_hdata_path (msg,
-                                                  list_path,
-                                                  0,
-                                                  path_pointers,
-                                                  ptr_hdata_head,
-                                                  pointer,
-                                                  list_keys);
+        relay_weechat_msg_add_hdata_path (msg,
+                                          list_path,
+                                          0,
+                                          path_pointers,
+                                          ptr_hdata_head,
+                                          pointer,
+                                          fields,
+                                          num_keys,
+                                          options);
         free (path_pointers);
     }
-    count32 = htonl ((uint32_t)count);
-    relay_weechat_msg_set_bytes (msg, pos_count, &count32, 4);
+    options->hdata_names = NULL;
+    count32 = htonl ((uint32_t)options->count_msg);
+    relay_weechat_msg_set_bytes (msg, options->pos_count, &count32, 4);
 
     rc = 1;
 
 end:
+    if (fields)
+    {
+        for (i = 0; i < num_keys; i++)
+        {
+            weechat_hdata_field_free (fields[i]);
+        }
+        free (fields);
+    }
     if (list_keys)
         weechat_string_free_split (list_keys);
     if (keys_types)
@@ -740,12 +934,36 @@ end:
         weechat_string_free_split (list_path);
     if (path_returned)
         free (path_returned);
+    if (hdata_names)
+        free (hdata_names);
     if (hdata_head)
         free (hdata_head);
 
     return rc;
 }
 
+/*
+ * Adds a hdata to a message.
+ *
+ * Argument path has format:
+ *   hdata_head:ptr->var->var->...->var
+ * where ptr can be a list name or a pointer (0x12345)
+ *
+ * Argument keys is optional: if not NULL, comma-separated list of keys to
+ * return for hdata.
+ *
+ * Returns:
+ *   1: hdata added to message
+ *   0: error (hdata NOT added to message)
+ */
+
+int
+relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
+                             const char *path, const char *keys)
+{
+    return relay_weechat_msg_add_hdata_options (msg, path, keys, NULL);
+}
+
 /*
  * Adds an infolist to a message.
  */
@@ -1010,6 +1228,476 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
     relay_weechat_msg_set_bytes (msg, pos_count, &count32, 4);
 }
 
+/*
+ * Adds a string with compact length to a message: one byte if length is
+ * lower than 255, otherwise byte 255 followed by length on 4 bytes.
+ */
+
+void
+relay_weechat_msg_add_string_compact (struct t_relay_weechat_msg *msg,
+                                      const char *string)
+{
+    int length;
+
+    length = (string) ? strlen (string) : 0;
+    if (length < 255)
+    {
+        relay_weechat_msg_add_char (msg, (char)length);
+    }
+    else
+    {
+        relay_weechat_msg_add_char (msg, (char)255);
+        relay_weechat_msg_add_int (msg, length);
+    }
+    if (length > 0)
+        relay_weechat_msg_add_bytes (msg, string, length);
+}
+
+/*
+ * Compares two strings of nicklist items (NULL is same as empty string).
+ *
+ * Returns 1 if strings are equal, 0 if they are different.
+ */
+
+int
+relay_weechat_msg_nicklist_string_equal (const char *string1,
+                                         const char *string2)
+{
+    return (strcmp ((string1) ? string1 : "", (string2) ? string2 : "") == 0) ?
+        1 : 0;
+}
+
+/*
+ * Adds nicklist diffs for a buffer, as pointer to buffer and compact buffer
+ * object (message "_nicklist_delta").
+ *
+ * Diffs on same nick/group are merged: a nick added then removed is not sent
+ * at all, a nick added then changed is sent as added with last values, a
+ * nick changed many times is sent once with last values.
+ *
+ * Content of buffer (integers are big-endian):
+ *   int: number of groups
+ *   for each group: pointer (like object "ptr") and name (compact string)
+ *   int: number of items
+ *   for each item:
+ *     char: diff ('+', '-' or '*')
+ *     char: flags (see RELAY_WEECHAT_MSG_DELTA_* in relay-weechat-msg.h)
+ *     uint16: index of parent group in groups (65535 if no parent group)
+ *     pointer (like object "ptr")
+ *     only for '+' and '*', fields present in flags: level (int), name,
+ *     color, prefix, prefix_color (compact strings); a missing field has
+ *     same value as in previous item with '+' or '*' (first item: level 0
+ *     and empty strings)
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (too many groups)
+ */
+
+int
+relay_weechat_msg_add_nicklist_compact (struct t_relay_weechat_msg *msg,
+                                        struct t_gui_buffer *buffer,
+                                        struct t_relay_weechat_nicklist *nicklist)
+{
+    struct t_relay_weechat_msg_delta *entries;
+    struct t_relay_weechat_nicklist_item *ptr_item, *ptr_prev;
+    struct t_hashtable *hashtable_entries, *hashtable_groups;
+    int i, rc, parent, count_entries, count_groups, *ptr_index, index;
+    int pos_length, pos_count, count;
+    char flags;
+    uint16_t parent16;
+    uint32_t length32, count32;
+
+    rc = 0;
+    entries = NULL;
+    hashtable_entries = NULL;
+    hashtable_groups = NULL;
+
+    entries = malloc (nicklist->items_count * sizeof (entries[0]));
+    if (!entries)
+        goto end;
+    hashtable_entries = weechat_hashtable_new (32,
+                                               WEECHAT_HASHTABLE_POINTER,
+                                               WEECHAT_HASHTABLE_INTEGER,
+                                               NULL, NULL);
+    if (!hashtable_entries)
+        goto end;
+    hashtable_groups = weechat_hashtable_new (32,
+                                              WEECHAT_HASHTABLE_POINTER,
+                                              WEECHAT_HASHTABLE_INTEGER,
+                                              NULL, NULL);
+    if (!hashtable_groups)
+        goto end;
+
+    /* merge diffs on same nick/group */
+    count_entries = 0;
+    parent = -1;
+    for (i = 0; i < nicklist->items_count; i++)
+    {
+        ptr_item = &(nicklist->items[i]);
+        if (ptr_item->diff == RELAY_WEECHAT_NICKLIST_DIFF_PARENT)
+        {
+            parent = i;
+            continue;
+        }
+        if ((ptr_item->diff != RELAY_WEECHAT_NICKLIST_DIFF_ADDED)
+            && (ptr_item->diff != RELAY_WEECHAT_NICKLIST_DIFF_REMOVED)
+            && (ptr_item->diff != RELAY_WEECHAT_NICKLIST_DIFF_CHANGED))
+        {
+            continue;
+        }
+        ptr_index = weechat_hashtable_get (hashtable_entries,
+                                           ptr_item->pointer);
+        index = (ptr_index) ? *ptr_index : -1;
+        if ((index >= 0)
+            && (entries[index].diff != RELAY_WEECHAT_NICKLIST_DIFF_REMOVED))
+        {
+            if (ptr_item->diff == RELAY_WEECHAT_NICKLIST_DIFF_REMOVED)
+            {
+                if (entries[index].diff == RELAY_WEECHAT_NICKLIST_DIFF_ADDED)
+                {
+                    /* added then removed: nothing is sent */
+                    entries[index].diff = RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN;
+                    weechat_hashtable_remove (hashtable_entries,
+                                              ptr_item->pointer);
+                    continue;
+                }
+                /* changed then removed: only removed is sent */
+                entries[index].diff = RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN;
+            }
+            else
+            {
+                /* added/changed then changed: keep diff, use last values */
+                entries[index].item = i;
+                entries[index].parent = parent;
+                continue;
+            }
+        }
+        entries[count_entries].item = i;
+        entries[count_entries].diff = ptr_item->diff;
+        entries[count_entries].parent = parent;
+        weechat_hashtable_set (hashtable_entries, ptr_item->pointer,
+                               &count_entries);
+        count_entries++;
+    }
+
+    relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_POINTER);
+    relay_weechat_msg_add_pointer (msg, buffer);
+
+    relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_BUFFER);
+
+    /* length of buffer will be set later */
+    pos_length = msg->data_size;
+    relay_weechat_msg_add_int (msg, 0);
+
+    /* table of parent groups */
+    pos_count = msg->data_size;
+    relay_weechat_msg_add_int (msg, 0);
+    count_groups = 0;
+    for (i = 0; i < count_entries; i++)
+    {
+        if ((entries[i].diff == RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+            || (entries[i].parent < 0))
+        {
+            continue;
+        }
+        ptr_item = &(nicklist->items[entries[i].parent]);
+        if (weechat_hashtable_has_key (hashtable_groups, ptr_item->pointer))
+            continue;
+        if (count_groups >= 65535)
+            goto end;
+        weechat_hashtable_set (hashtable_groups, ptr_item->pointer,
+                               &count_groups);
+        relay_weechat_msg_add_pointer (msg, ptr_item->pointer);
+        relay_weechat_msg_add_string_compact (msg, ptr_item->name);
+        count_groups++;
+    }
+    count32 = htonl ((uint32_t)count_groups);
+    relay_weechat_msg_set_bytes (msg, pos_count, &count32, 4);
+
+    /* items */
+    pos_count = msg->data_size;
+    relay_weechat_msg_add_int (msg, 0);
+    count = 0;
+    ptr_prev = NULL;
+    for (i = 0; i < count_entries; i++)
+    {
+        if (entries[i].diff == RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+            continue;
+        ptr_item = &(nicklist->items[entries[i].item]);
+        flags = 0;
+        if (ptr_item->group)
+            flags |= RELAY_WEECHAT_MSG_DELTA_GROUP;
+        if (ptr_item->visible)
+            flags |= RELAY_WEECHAT_MSG_DELTA_VISIBLE;
+        if (entries[i].diff != RELAY_WEECHAT_NICKLIST_DIFF_REMOVED)
+        {
+            if (ptr_item->level != ((ptr_prev) ? ptr_prev->level : 0))
+                flags |= RELAY_WEECHAT_MSG_DELTA_LEVEL;
+            if (!relay_weechat_msg_nicklist_string_equal (
+                    ptr_item->name, (ptr_prev) ? ptr_prev->name : NULL))
+                flags |= RELAY_WEECHAT_MSG_DELTA_NAME;
+            if (!relay_weechat_msg_nicklist_string_equal (
+                    ptr_item->color, (ptr_prev) ? ptr_prev->color : NULL))
+                flags |= RELAY_WEECHAT_MSG_DELTA_COLOR;
+            if (!relay_weechat_msg_nicklist_string_equal (
+                    ptr_item->prefix, (ptr_prev) ? ptr_prev->prefix : NULL))
+                flags |= RELAY_WEECHAT_MSG_DELTA_PREFIX;
+            if (!relay_weechat_msg_nicklist_string_equal (
+                    ptr_item->prefix_color,
+                    (ptr_prev) ? ptr_prev->prefix_color : NULL))
+                flags |= RELAY_WEECHAT_MSG_DELTA_PREFIX_COLOR;
+        }
+        relay_weechat_msg_add_char (msg, entries[i].diff);
+        relay_weechat_msg_add_char (msg, flags);
+        ptr_index = (entries[i].parent >= 0) ?
+            weechat_hashtable_get (hashtable_groups,
+                                   nicklist->items[entries[i].parent].pointer) :
+            NULL;
+        parent16 = htons ((uint16_t)((ptr_index) ? *ptr_index : 65535));
+        relay_weechat_msg_add_bytes (msg, &parent16, 2);
+        relay_weechat_msg_add_pointer (msg, ptr_item->pointer);
+        if (flags & RELAY_WEECHAT_MSG_DELTA_LEVEL)
+            relay_weechat_msg_add_int (msg, ptr_item->level);
+        if (flags & RELAY_WEECHAT_MSG_DELTA_NAME)
+            relay_weechat_msg_add_string_compact (msg, ptr_item->name);
+        if (flags & RELAY_WEECHAT_MSG_DELTA_COLOR)
+            relay_weechat_msg_add_string_compact (msg, ptr_item->color);
+        if (flags & RELAY_WEECHAT_MSG_DELTA_PREFIX)
+            relay_weechat_msg_add_string_compact (msg, ptr_item->prefix);
+        if (flags & RELAY_WEECHAT_MSG_DELTA_PREFIX_COLOR)
+            relay_weechat_msg_add_string_compact (msg, ptr_item->prefix_color);
+        if (entries[i].diff != RELAY_WEECHAT_NICKLIST_DIFF_REMOVED)
+            ptr_prev = ptr_item;
+        count++;
+    }
+    count32 = htonl ((uint32_t)count);
+    relay_weechat_msg_set_bytes (msg, pos_count, &count32, 4);
+
+    length32 = htonl ((uint32_t)(msg->data_size - pos_length - 4));
+    relay_weechat_msg_set_bytes (msg, pos_length, &length32, 4);
+
+    rc = 1;
+
+end:
+    if (entries)
+        free (entries);
+    if (hashtable_entries)
+        weechat_hashtable_free (hashtable_entries);
+    if (hashtable_groups)
+        weechat_hashtable_free (hashtable_groups);
+
+    return rc;
+}
+
+/*
+ * Compresses data of a message with zlib (the 5 first bytes are reserved for
+ * size and compression flag).
+ *
+ * Returns compressed data, NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_weechat_msg_compress_zlib (struct t_relay_weechat_msg *msg,
+                                 int *compressed_size)
+{
+    Bytef *dest;
+    uLongf dest_size;
+    int rc;
+
+    dest_size = compressBound (msg->data_size - 5);
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return NULL;
+
+    rc = compress2 (dest + 5, &dest_size,
+                    (Bytef *)(msg->data + 5), msg->data_size - 5,
+                    weechat_config_integer (relay_config_network_compression_level));
+    if (rc != Z_OK)
+    {
+        free (dest);
+        return NULL;
+    }
+
+    *compressed_size = (int)dest_size + 5;
+
+    return (char *)dest;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Compresses data of a message with Zstandard (the 5 first bytes are reserved
+ * for size and compression flag).
+ *
+ * The compression context is kept in client and reused for next messages.
+ *
+ * Returns compressed data, NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_weechat_msg_compress_zstd (struct t_relay_client *client,
+                                 struct t_relay_weechat_msg *msg,
+                                 int *compressed_size)
+{
+    char *dest;
+    size_t dest_size;
+
+    if (!RELAY_WEECHAT_DATA(client, zstd_cctx))
+    {
+        RELAY_WEECHAT_DATA(client, zstd_cctx) = ZSTD_createCCtx ();
+        if (!RELAY_WEECHAT_DATA(client, zstd_cctx))
+            return NULL;
+    }
+
+    dest_size = ZSTD_compressBound (msg->data_size - 5);
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return NULL;
+
+    dest_size = ZSTD_compressCCtx (
+        RELAY_WEECHAT_DATA(client, zstd_cctx),
+        dest + 5, dest_size,
+        msg->data + 5, msg->data_size - 5,
+        weechat_config_integer (relay_config_network_compression_level));
+    if (ZSTD_isError (dest_size))
+    {
+        free (dest);
+        return NULL;
+    }
+
+    *compressed_size = (int)dest_size + 5;
+
+    return dest;
+}
+#endif /* HAVE_ZSTD */
+
+/*
+ * Compresses data of a message with the zlib stream of client, flushed after
+ * the message (Z_SYNC_FLUSH): the history of previous messages is used, so
+ * the client must decompress all messages with the same stream.
+ *
+ * Returns compressed data, NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_weechat_msg_compress_zlib_stream (struct t_relay_client *client,
+                                        struct t_relay_weechat_msg *msg,
+                                        int *compressed_size)
+{
+    z_stream *ptr_stream;
+    char *dest;
+    uLong dest_size;
+    int rc;
+
+    ptr_stream = RELAY_WEECHAT_DATA(client, zlib_stream);
+    if (!ptr_stream)
+    {
+        ptr_stream = malloc (sizeof (*ptr_stream));
+        if (!ptr_stream)
+            return NULL;
+        ptr_stream->zalloc = Z_NULL;
+        ptr_stream->zfree = Z_NULL;
+        ptr_stream->opaque = Z_NULL;
+        if (deflateInit (ptr_stream,
+                         weechat_config_integer (relay_config_network_compression_level)) != Z_OK)
+        {
+            free (ptr_stream);
+            return NULL;
+        }
+        RELAY_WEECHAT_DATA(client, zlib_stream) = ptr_stream;
+    }
+
+    /* the sync flush adds a few bytes after the compressed data */
+    dest_size = deflateBound (ptr_stream, msg->data_size - 5) + 16;
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return NULL;
+
+    ptr_stream->next_in = (Bytef *)(msg->data + 5);
+    ptr_stream->avail_in = msg->data_size - 5;
+    ptr_stream->next_out = (Bytef *)(dest + 5);
+    ptr_stream->avail_out = dest_size;
+    rc = deflate (ptr_stream, Z_SYNC_FLUSH);
+    if ((rc != Z_OK) || (ptr_stream->avail_in > 0)
+        || (ptr_stream->avail_out == 0))
+    {
+        /* stream is now unusable: start a new one with next message */
+        free (dest);
+        relay_weechat_free_compression_streams (client);
+        return NULL;
+    }
+
+    *compressed_size = (int)(dest_size - ptr_stream->avail_out) + 5;
+
+    return dest;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Compresses data of a message with the Zstandard stream of client, flushed
+ * after the message (ZSTD_e_flush): the history of previous messages is used,
+ * so the client must decompress all messages with the same stream.
+ *
+ * Returns compressed data, NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_weechat_msg_compress_zstd_stream (struct t_relay_client *client,
+                                        struct t_relay_weechat_msg *msg,
+                                        int *compressed_size)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    char *dest;
+    size_t dest_size, rc;
+
+    if (!RELAY_WEECHAT_DATA(client, zstd_cstream))
+    {
+        RELAY_WEECHAT_DATA(client, zstd_cstream) = ZSTD_createCStream ();
+        if (!RELAY_WEECHAT_DATA(client, zstd_cstream))
+            return NULL;
+        ZSTD_CCtx_setParameter (
+            RELAY_WEECHAT_DATA(client, zstd_cstream),
+            ZSTD_c_compressionLevel,
+            weechat_config_integer (relay_config_network_compression_level));
+    }
+
+    /* the flush adds a block header after the compressed data */
+    dest_size = ZSTD_compressBound (msg->data_size - 5) + 16;
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return NULL;
+
+    input.src = msg->data + 5;
+    input.size = msg->data_size - 5;
+    input.pos = 0;
+    output.dst = dest + 5;
+    output.size = dest_size;
+    output.pos = 0;
+    rc = ZSTD_compressStream2 (RELAY_WEECHAT_DATA(client, zstd_cstream),
+                               &output, &input, ZSTD_e_flush);
+    if (ZSTD_isError (rc) || (rc != 0))
+    {
+        /* stream is now unusable: start a new one with next message */
+        free (dest);
+        relay_weechat_free_compression_streams (client);
+        return NULL;
+    }
+
+    *compressed_size = (int)output.pos + 5;
+
+    return dest;
+}
+#endif /* HAVE_ZSTD */
+
 /*
  * Sends a message.
  */
@@ -1019,57 +1707,96 @@ relay_weechat_msg_send (struct t_relay_client *client,
                         struct t_relay_weechat_msg *msg)
 {
     uint32_t size32;
-    char compression, raw_message[1024];
-    int rc;
-    Bytef *dest;
-    uLongf dest_size;
+    char compression, raw_message[1024], *dest;
+    int dest_size, stream, shared;
     struct timeval tv1, tv2;
     long long time_diff;
 
     if (weechat_config_integer (relay_config_network_compression_level) > 0)
     {
-        switch (RELAY_WEECHAT_DATA(client, compression))
+        compression = RELAY_WEECHAT_DATA(client, compression);
+        dest = NULL;
+        dest_size = 0;
+        stream = 0;
+        shared = (msg == relay_weechat_msg_shared.msg);
+        gettimeofday (&tv1, NULL);
+        if (shared && relay_weechat_msg_shared.compressed[(int)compression])
         {
-            case RELAY_WEECHAT_COMPRESSION_ZLIB:
-                dest_size = compressBound (msg->data_size - 5);
-                dest = malloc (dest_size + 5);
-                if (dest)
-                {
-                    gettimeofday (&tv1, NULL);
-                    rc = compress2 (dest + 5, &dest_size,
-                                    (Bytef *)(msg->data + 5), msg->data_size - 5,
-                                    weechat_config_integer (relay_config_network_compression_level));
-                    gettimeofday (&tv2, NULL);
-                    time_diff = weechat_util_timeval_diff (&tv1, &tv2);
-                    if ((rc == Z_OK) && ((int)dest_size + 5 < msg->data_size))
-                    {
-                        /* set size and compression flag */
-                        size32 = htonl ((uint32_t)(dest_size + 5));
-                        memcpy (dest, &size32, 4);
-                        dest[4] = RELAY_WEECHAT_COMPRESSION_ZLIB;
-
-                        /* display message in raw buffer */
-                        snprintf (raw_message, sizeof (raw_message),
-                                  "obj: %d/%d bytes (%d%%, %.2fms), id: %s",
-                                  (int)dest_size + 5,
-                                  msg->data_size,
-                                  100 - ((((int)dest_size + 5) * 100) / msg->data_size),
-                                  ((float)time_diff) / 1000,
-                                  msg->id);
-
-                        /* send compressed data */
-                        relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                                           (const char *)dest, dest_size + 5,
-                                           raw_message);
-
-                        free (dest);
-                        return;
-                    }
+            /* shared message already compressed for another client */
+            dest = relay_weechat_msg_shared.compressed[(int)compression];
+            dest_size = relay_weechat_msg_shared.compressed_size[(int)compression];
+        }
+        else
+        {
+            switch (RELAY_WEECHAT_DATA(client, compression))
+            {
+                case RELAY_WEECHAT_COMPRESSION_ZLIB:
+                    dest = relay_weechat_msg_compress_zlib (msg, &dest_size);
+                    break;
+                case RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM:
+                    dest = relay_weechat_msg_compress_zlib_stream (client, msg,
+                                                                   &dest_size);
+                    stream = 1;
+                    break;
+#ifdef HAVE_ZSTD
+                case RELAY_WEECHAT_COMPRESSION_ZSTD:
+                    dest = relay_weechat_msg_compress_zstd (client, msg,
+                                                            &dest_size);
+                    break;
+                case RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM:
+                    dest = relay_weechat_msg_compress_zstd_stream (client, msg,
+                                                                   &dest_size);
+                    stream = 1;
+                    break;
+#endif /* HAVE_ZSTD */
+                default:
+                    break;
+            }
+            /* keep compressed data for other clients (except streams) */
+            if (shared && dest && !stream)
+            {
+                relay_weechat_msg_shared.compressed[(int)compression] = dest;
+                relay_weechat_msg_shared.compressed_size[(int)compression] = dest_size;
+            }
+            else
+                shared = 0;
+        }
+        gettimeofday (&tv2, NULL);
+        time_diff = weechat_util_timeval_diff (&tv1, &tv2);
+        if (dest)
+        {
+            /*
+             * data compressed in a stream is always sent (the client needs
+             * it to decompress next messages)
+             */
+            if (stream || (dest_size < msg->data_size))
+            {
+                /* set size and compression flag */
+                size32 = htonl ((uint32_t)dest_size);
+                memcpy (dest, &size32, 4);
+                dest[4] = compression;
+
+                /* display message in raw buffer */
+                snprintf (raw_message, sizeof (raw_message),
+                          "obj: %d/%d bytes (%s: %d%%, %.2fms), id: %s",
+                          dest_size,
+                          msg->data_size,
+                          relay_weechat_compression_string[(int)compression],
+                          100 - ((dest_size * 100) / msg->data_size),
+                          ((float)time_diff) / 1000,
+                          msg->id);
+
+                /* send compressed data */
+                relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
+                                   dest, dest_size, raw_message,
+                                   msg->coalesce_key);
+
+                if (!shared)
                     free (dest);
-                }
-                break;
-            default:
-                break;
+                return;
+            }
+            if (!shared)
+                free (dest);
         }
     }
 
@@ -1085,7 +1812,8 @@ relay_weechat_msg_send (struct t_relay_client *client,
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d bytes, id: %s", msg->data_size, msg->id);
     relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                       msg->data, msg->data_size, raw_message);
+                       msg->data, msg->data_size, raw_message,
+                       msg->coalesce_key);
 }
 
 /*
@@ -1097,8 +1825,81 @@ relay_weechat_msg_free (struct t_relay_weechat_msg *msg)
 {
     if (msg->id)
         free (msg->id);
+    if (msg->coalesce_key)
+        free (msg->coalesce_key);
     if (msg->data)
         free (msg->data);
 
     free (msg);
 }
+
+/*
+ * Gets the message shared by all clients, if its key is "key".
+ *
+ * Returns pointer to message, NULL if the shared message has another key.
+ */
+
+struct t_relay_weechat_msg *
+relay_weechat_msg_shared_get (const char *key)
+{
+    if (!key || !relay_weechat_msg_shared.key
+        || (strcmp (relay_weechat_msg_shared.key, key) != 0))
+    {
+        return NULL;
+    }
+
+    return relay_weechat_msg_shared.msg;
+}
+
+/*
+ * Sets the message shared by all clients (the previous one is freed).
+ *
+ * The message is then freed by relay (the caller must not free it).
+ */
+
+void
+relay_weechat_msg_shared_set (const char *key, struct t_relay_weechat_msg *msg)
+{
+    relay_weechat_msg_shared_free ();
+
+    if (!key || !msg)
+        return;
+
+    relay_weechat_msg_shared.key = strdup (key);
+    if (!relay_weechat_msg_shared.key)
+    {
+        relay_weechat_msg_free (msg);
+        return;
+    }
+    relay_weechat_msg_shared.msg = msg;
+}
+
+/*
+ * Frees the message shared by all clients.
+ */
+
+void
+relay_weechat_msg_shared_free ()
+{
+    int i;
+
+    if (relay_weechat_msg_shared.key)
+    {
+        free (relay_weechat_msg_shared.key);
+        relay_weechat_msg_shared.key = NULL;
+    }
+    if (relay_weechat_msg_shared.msg)
+    {
+        relay_weechat_msg_free (relay_weechat_msg_shared.msg);
+        relay_weechat_msg_shared.msg = NULL;
+    }
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        if (relay_weechat_msg_shared.compressed[i])
+        {
+            free (relay_weechat_msg_shared.compressed[i]);
+            relay_weechat_msg_shared.compressed[i] = NULL;
+        }
+        relay_weechat_msg_shared.compressed_size[i] = 0;
+    }
+}
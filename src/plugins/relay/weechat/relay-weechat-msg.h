@@ -40,15 +40,78 @@ struct t_relay_weechat_nicklist;
 #define RELAY_WEECHAT_MSG_OBJ_INFOLIST  "inl"
 #define RELAY_WEECHAT_MSG_OBJ_ARRAY     "arr"
 
+/* flags of items in compact nicklist diffs (message "_nicklist_delta") */
+#define RELAY_WEECHAT_MSG_DELTA_GROUP        (1 << 0)
+#define RELAY_WEECHAT_MSG_DELTA_VISIBLE      (1 << 1)
+#define RELAY_WEECHAT_MSG_DELTA_LEVEL        (1 << 2)
+#define RELAY_WEECHAT_MSG_DELTA_NAME         (1 << 3)
+#define RELAY_WEECHAT_MSG_DELTA_COLOR        (1 << 4)
+#define RELAY_WEECHAT_MSG_DELTA_PREFIX       (1 << 5)
+#define RELAY_WEECHAT_MSG_DELTA_PREFIX_COLOR (1 << 6)
+
 struct t_relay_weechat_msg
 {
     char *id;                          /* message id                        */
+    char *coalesce_key;                /* replaces queued msgs with same key*/
     char *data;                        /* binary buffer                     */
     int data_alloc;                    /* currently allocated size          */
     int data_size;                     /* current size of buffer            */
 };
 
+/*
+ * message shared by all clients (for example a new line sent to all clients
+ * synchronized with the buffer): it is built only once, and compressed only
+ * once for each compression (except streams, which are specific to a client)
+ */
+
+struct t_relay_weechat_msg_shared
+{
+    char *key;                         /* key of message (NULL if not set)  */
+    struct t_relay_weechat_msg *msg;   /* message (not compressed)          */
+    char *compressed[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* compressed data    */
+    int compressed_size[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* size of data    */
+};
+
+/*
+ * options for a hdata added in a message (used by command "hdata"): filters
+ * on objects returned, max number of objects, and split of hdata in many
+ * messages (chunks)
+ */
+
+struct t_relay_weechat_msg_hdata_options
+{
+    char **tags;                       /* objects with one of these tags    */
+    int num_tags;                      /* number of tags (0 = no filter)    */
+    time_t date_min;                   /* min date of objects (0 = no min)  */
+    time_t date_max;                   /* max date of objects (0 = no max)  */
+    const char *condition;             /* condition (evaluated)             */
+    int max;                           /* max objects returned (0 = all)    */
+    void *after;                       /* return objects after this one     */
+    int chunk;                         /* max objects per message (0 = all) */
+    struct t_relay_client *client;     /* client (to send chunks)           */
+    /* internal state (set when hdata is added) */
+    char **hdata_names;                /* hdata name for each var in path   */
+    int after_found;                   /* 1 if object "after" was found     */
+    int pos_count;                     /* position of count in message      */
+    int pos_objects;                   /* position of first object in msg   */
+    int count_msg;                     /* number of objects in message      */
+    int count_total;                   /* number of objects (all messages)  */
+};
+
+/* diff on a nick/group sent in compact nicklist diffs (after merge) */
+
+struct t_relay_weechat_msg_delta
+{
+    int item;                          /* index of item in nicklist         */
+    char diff;                         /* diff sent (' ' = nothing sent)    */
+    int parent;                        /* index of parent item (-1 if none) */
+};
+
+extern struct t_relay_weechat_msg_shared relay_weechat_msg_shared;
+
 extern struct t_relay_weechat_msg *relay_weechat_msg_new (const char *id);
+extern void relay_weechat_msg_set_coalesce_key (struct t_relay_weechat_msg *msg,
+                                                const char *coalesce_key);
 extern void relay_weechat_msg_add_bytes (struct t_relay_weechat_msg *msg,
                                          const void *buffer, int size);
 extern void relay_weechat_msg_set_bytes (struct t_relay_weechat_msg *msg,
@@ -72,6 +135,10 @@ extern void relay_weechat_msg_add_time (struct t_relay_weechat_msg *msg,
                                         time_t time);
 extern int relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
                                         const char *path, const char *keys);
+extern int relay_weechat_msg_add_hdata_options (struct t_relay_weechat_msg *msg,
+                                                const char *path,
+                                                const char *keys,
+                                                struct t_relay_weechat_msg_hdata_options *options);
 extern void relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
                                             const char *name,
                                             void *pointer,
@@ -79,8 +146,28 @@ extern void relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
 extern void relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
                                             struct t_gui_buffer *buffer,
                                             struct t_relay_weechat_nicklist *nicklist);
+extern int relay_weechat_msg_add_nicklist_compact (struct t_relay_weechat_msg *msg,
+                                                   struct t_gui_buffer *buffer,
+                                                   struct t_relay_weechat_nicklist *nicklist);
+extern char *relay_weechat_msg_compress_zlib (struct t_relay_weechat_msg *msg,
+                                              int *compressed_size);
+extern char *relay_weechat_msg_compress_zlib_stream (struct t_relay_client *client,
+                                                     struct t_relay_weechat_msg *msg,
+                                                     int *compressed_size);
+#ifdef HAVE_ZSTD
+extern char *relay_weechat_msg_compress_zstd (struct t_relay_client *client,
+                                              struct t_relay_weechat_msg *msg,
+                                              int *compressed_size);
+extern char *relay_weechat_msg_compress_zstd_stream (struct t_relay_client *client,
+                                                     struct t_relay_weechat_msg *msg,
+                                                     int *compressed_size);
+#endif /* HAVE_ZSTD */
 extern void relay_weechat_msg_send (struct t_relay_client *client,
                                     struct t_relay_weechat_msg *msg);
 extern void relay_weechat_msg_free (struct t_relay_weechat_msg *msg);
+extern struct t_relay_weechat_msg *relay_weechat_msg_shared_get (const char *key);
+extern void relay_weechat_msg_shared_set (const char *key,
+                                          struct t_relay_weechat_msg *msg);
+extern void relay_weechat_msg_shared_free ();
 
 #endif /* WEECHAT_RELAY_WEECHAT_MSG_H */
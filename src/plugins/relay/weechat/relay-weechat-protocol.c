@@ -158,13 +158,76 @@ relay_weechat_protocol_is_sync (struct t_relay_client *ptr_client,
     return 0;
 }
 
+/*
+ * Sends a line to client, with message id "id" (for example
+ * "_buffer_line_added").
+ *
+ * If "shared" is 1, the message is built only once for a line and then used
+ * for all clients (message shared by all clients, see
+ * relay_weechat_msg_shared_get); this must be used only for a new line, which
+ * is sent to all clients at same time.
+ */
+
+void
+relay_weechat_protocol_send_line (struct t_relay_client *ptr_client,
+                                  const char *id, void *line_data,
+                                  int shared)
+{
+    struct t_hdata *ptr_hdata;
+    struct t_relay_weechat_msg *msg;
+    char cmd_hdata[64], key[128];
+
+    key[0] = '\0';
+    msg = NULL;
+    if (shared)
+    {
+        ptr_hdata = weechat_hdata_get ("line_data");
+        if (!ptr_hdata)
+            return;
+        snprintf (key, sizeof (key),
+                  "%s:%ld",
+                  id,
+                  weechat_hdata_long (ptr_hdata, line_data, "id"));
+        msg = relay_weechat_msg_shared_get (key);
+    }
+
+    if (!msg)
+    {
+        msg = relay_weechat_msg_new (id);
+        if (!msg)
+            return;
+        snprintf (cmd_hdata, sizeof (cmd_hdata),
+                  "line_data:0x%lx",
+                  (long unsigned int)line_data);
+        relay_weechat_msg_add_hdata (msg, cmd_hdata,
+                                     "buffer,id,date,date_printed,"
+                                     "displayed,highlight,tags_array,"
+                                     "prefix,message");
+        if (shared)
+        {
+            relay_weechat_msg_shared_set (key, msg);
+            msg = relay_weechat_msg_shared_get (key);
+            if (!msg)
+                return;
+        }
+    }
+
+    relay_weechat_msg_send (ptr_client, msg);
+
+    if (!shared)
+        relay_weechat_msg_free (msg);
+}
+
 /*
  * Callback for command "init" (from client).
  *
  * Message looks like:
  *   init password=mypass
  *   init password=mypass,compression=zlib
+ *   init password=mypass,compression=zstd
+ *   init password=mypass,compression=zlib_stream
  *   init password=mypass,compression=off
+ *   init password=mypass,nicklist=compact
  */
 
 RELAY_WEECHAT_PROTOCOL_CALLBACK(init)
@@ -204,7 +267,15 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(init)
                 {
                     compression = relay_weechat_compression_search (pos);
                     if (compression >= 0)
+                    {
                         RELAY_WEECHAT_DATA(client, compression) = compression;
+                        relay_weechat_free_compression_streams (client);
+                    }
+                }
+                else if (strcmp (options[i], "nicklist") == 0)
+                {
+                    RELAY_WEECHAT_DATA(client, nicklist_compact) =
+                        (strcmp (pos, "compact") == 0) ? 1 : 0;
                 }
             }
         }
@@ -223,19 +294,93 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(init)
  * Message looks like:
  *   hdata buffer:gui_buffers(*) number,name,type,nicklist,title
  *   hdata buffer:gui_buffers(*)/own_lines/first_line(*)/data date,displayed,prefix,message
+ *   hdata buffer:0x1234/own_lines/last_line(-*)/data date,message tags=irc_privmsg max=200
+ *   hdata buffer:0x1234/own_lines/first_line(*)/data date,message chunk=100 cond=${line_data.highlight}
  */
 
 RELAY_WEECHAT_PROTOCOL_CALLBACK(hdata)
 {
     struct t_relay_weechat_msg *msg;
+    struct t_relay_weechat_msg_hdata_options options;
+    const char *keys;
+    char *error;
+    long number;
+    long unsigned int value;
+    int i, first_option, has_options, rc_sscanf;
 
     RELAY_WEECHAT_PROTOCOL_MIN_ARGS(1);
 
+    memset (&options, 0, sizeof (options));
+    options.client = client;
+
+    /* options have format "name=value" (keys never contain "=") */
+    has_options = 0;
+    for (i = 1; i < argc; i++)
+    {
+        if (strchr (argv[i], '='))
+        {
+            has_options = 1;
+            break;
+        }
+    }
+
+    keys = NULL;
+    first_option = 1;
+    if (argc > 1)
+    {
+        if (!has_options)
+            keys = argv_eol[1];
+        else if (!strchr (argv[1], '='))
+        {
+            keys = argv[1];
+            first_option = 2;
+        }
+    }
+
+    for (i = first_option; has_options && (i < argc); i++)
+    {
+        if (strncmp (argv[i], "cond=", 5) == 0)
+        {
+            /* condition is the last option (it can contain spaces) */
+            options.condition = argv_eol[i] + 5;
+            break;
+        }
+        else if (strncmp (argv[i], "tags=", 5) == 0)
+        {
+            if (!options.tags)
+            {
+                options.tags = weechat_string_split (argv[i] + 5, ",", 0, 0,
+                                                     &options.num_tags);
+            }
+        }
+        else if (strncmp (argv[i], "after=", 6) == 0)
+        {
+            rc_sscanf = sscanf (argv[i] + 6, "%lx", &value);
+            if ((rc_sscanf != EOF) && (rc_sscanf != 0))
+                options.after = (void *)value;
+        }
+        else
+        {
+            error = NULL;
+            number = strtol (strchr (argv[i], '=') + 1, &error, 10);
+            if (!error || error[0] || (number < 0))
+                continue;
+            if (strncmp (argv[i], "max=", 4) == 0)
+                options.max = number;
+            else if (strncmp (argv[i], "chunk=", 6) == 0)
+                options.chunk = number;
+            else if (strncmp (argv[i], "date_min=", 9) == 0)
+                options.date_min = (time_t)number;
+            else if (strncmp (argv[i], "date_max=", 9) == 0)
+                options.date_max = (time_t)number;
+        }
+    }
+
     msg = relay_weechat_msg_new (id);
     if (msg)
     {
-        if (!relay_weechat_msg_add_hdata (msg, argv[0],
-                                          (argc > 1) ? argv_eol[1] : NULL))
+        if (!relay_weechat_msg_add_hdata_options (msg, argv[0], keys,
+                                                  &options))
         {
             relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_HDATA);
             relay_weechat_msg_add_string (msg, NULL);  /* h-path */
@@ -246,6 +391,9 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(hdata)
         relay_weechat_msg_free (msg);
     }
 
+    if (options.tags)
+        weechat_string_free_split (options.tags);
+
     return WEECHAT_RC_OK;
 }
 
@@ -647,6 +795,10 @@ relay_weechat_protocol_signal_buffer_cb (const void *pointer, void *data,
                           "buffer:0x%lx", (long unsigned int)ptr_buffer);
                 relay_weechat_msg_add_hdata (msg, cmd_hdata,
                                              "number,full_name,title");
+                /* title replaces previous one not yet sent to client */
+                snprintf (cmd_hdata, sizeof (cmd_hdata),
+                          "title:0x%lx", (long unsigned int)ptr_buffer);
+                relay_weechat_msg_set_coalesce_key (msg, cmd_hdata);
                 relay_weechat_msg_send (ptr_client, msg);
                 relay_weechat_msg_free (msg);
             }
@@ -724,19 +876,8 @@ relay_weechat_protocol_signal_buffer_cb (const void *pointer, void *data,
         if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
                                             RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "line_data:0x%lx",
-                          (long unsigned int)ptr_line_data);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "buffer,date,date_printed,"
-                                             "displayed,highlight,tags_array,"
-                                             "prefix,message");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
+            relay_weechat_protocol_send_line (ptr_client, str_signal,
+                                              ptr_line_data, 1);
         }
     }
     else if (strcmp (signal, "buffer_closing") == 0)
@@ -784,6 +925,7 @@ relay_weechat_protocol_nicklist_map_cb (void *data,
     struct t_relay_weechat_nicklist *ptr_nicklist;
     struct t_hdata *ptr_hdata;
     struct t_relay_weechat_msg *msg;
+    char coalesce_key[64];
 
     /* make C compiler happy */
     (void) hashtable;
@@ -792,6 +934,9 @@ relay_weechat_protocol_nicklist_map_cb (void *data,
     ptr_buffer = (struct t_gui_buffer *)key;
     ptr_nicklist = (struct t_relay_weechat_nicklist *)value;
 
+    snprintf (coalesce_key, sizeof (coalesce_key),
+              "nicklist:0x%lx", (long unsigned int)ptr_buffer);
+
     ptr_hdata = weechat_hdata_get ("buffer");
     if (ptr_hdata)
     {
@@ -810,11 +955,42 @@ relay_weechat_protocol_nicklist_map_cb (void *data,
                 ptr_nicklist = NULL;
             }
 
+            /*
+             * if nicklist messages for this buffer are still waiting in out
+             * queue of client (slow client), send whole nicklist, which
+             * replaces them in queue
+             */
+            if (ptr_nicklist
+                && relay_client_outqueue_search_key (ptr_client, coalesce_key))
+            {
+                ptr_nicklist = NULL;
+            }
+
+            /* send compact nicklist diffs (if asked by client) */
+            if (ptr_nicklist && RELAY_WEECHAT_DATA(ptr_client, nicklist_compact))
+            {
+                msg = relay_weechat_msg_new ("_nicklist_delta");
+                if (msg)
+                {
+                    if (relay_weechat_msg_add_nicklist_compact (msg, ptr_buffer,
+                                                                ptr_nicklist))
+                    {
+                        relay_weechat_msg_set_coalesce_key (msg, coalesce_key);
+                        relay_weechat_msg_send (ptr_client, msg);
+                        relay_weechat_msg_free (msg);
+                        return;
+                    }
+                    relay_weechat_msg_free (msg);
+                }
+                ptr_nicklist = NULL;
+            }
+
             /* send nicklist diffs or full nicklist */
             msg = relay_weechat_msg_new ((ptr_nicklist) ? "_nicklist_diff" : "_nicklist");
             if (msg)
             {
                 relay_weechat_msg_add_nicklist (msg, ptr_buffer, ptr_nicklist);
+                relay_weechat_msg_set_coalesce_key (msg, coalesce_key);
                 relay_weechat_msg_send (ptr_client, msg);
                 relay_weechat_msg_free (msg);
             }
@@ -880,6 +1056,31 @@ relay_weechat_protocol_hsignal_nicklist_cb (const void *pointer, void *data,
                                          RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
         return WEECHAT_RC_OK;
 
+    /*
+     * end of a batch of changes in nicklist: diffs are not sent (signals
+     * were not sent during the batch), the whole nicklist will be sent
+     */
+    if (strcmp (signal, "nicklist_batch_end") == 0)
+    {
+        weechat_hashtable_remove (RELAY_WEECHAT_DATA(ptr_client,
+                                                     buffers_nicklist),
+                                  ptr_buffer);
+        ptr_nicklist = relay_weechat_nicklist_new ();
+        if (!ptr_nicklist)
+            return WEECHAT_RC_OK;
+        ptr_nicklist->nicklist_count = 0;
+        weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                               ptr_buffer,
+                               ptr_nicklist);
+        if (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist))
+        {
+            weechat_unhook (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist));
+            RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist) = NULL;
+        }
+        relay_weechat_hook_timer_nicklist (ptr_client);
+        return WEECHAT_RC_OK;
+    }
+
     parent_group = weechat_hashtable_get (hashtable, "parent_group");
     group = weechat_hashtable_get (hashtable, "group");
     nick = weechat_hashtable_get (hashtable, "nick");
@@ -992,6 +1193,95 @@ relay_weechat_protocol_signal_upgrade_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Sends to client the changes in a buffer since a line id (for a client
+ * resuming a sync after a reconnection):
+ *   - lines with an id greater than "since" (oldest line first), if buffer is
+ *     synchronized with flag "buffer"
+ *   - whole nicklist, if buffer is synchronized with flag "nicklist".
+ *
+ * Only lines still in buffer are sent (lines removed by options
+ * weechat.history.max_buffer_lines_* are lost for the client).
+ */
+
+void
+relay_weechat_protocol_sync_since (struct t_relay_client *ptr_client,
+                                   struct t_gui_buffer *ptr_buffer,
+                                   long since)
+{
+    struct t_hdata *ptr_hdata_buffer, *ptr_hdata_lines, *ptr_hdata_line;
+    struct t_hdata *ptr_hdata_line_data;
+    struct t_relay_weechat_nicklist *ptr_nicklist;
+    void *ptr_lines, *ptr_line, *ptr_line_data, *ptr_first_line;
+
+    if (relay_weechat_is_relay_buffer (ptr_buffer))
+        return;
+
+    if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
+                                        RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+    {
+        ptr_hdata_buffer = weechat_hdata_get ("buffer");
+        ptr_hdata_lines = weechat_hdata_get ("lines");
+        ptr_hdata_line = weechat_hdata_get ("line");
+        ptr_hdata_line_data = weechat_hdata_get ("line_data");
+        if (!ptr_hdata_buffer || !ptr_hdata_lines || !ptr_hdata_line
+            || !ptr_hdata_line_data)
+        {
+            return;
+        }
+
+        /* search first line with id greater than "since" */
+        ptr_lines = weechat_hdata_pointer (ptr_hdata_buffer, ptr_buffer,
+                                           "own_lines");
+        ptr_line = (ptr_lines) ?
+            weechat_hdata_pointer (ptr_hdata_lines, ptr_lines,
+                                   "last_line") : NULL;
+        ptr_first_line = NULL;
+        while (ptr_line)
+        {
+            ptr_line_data = weechat_hdata_pointer (ptr_hdata_line, ptr_line,
+                                                   "data");
+            if (ptr_line_data
+                && (weechat_hdata_long (ptr_hdata_line_data, ptr_line_data,
+                                        "id") <= since))
+            {
+                break;
+            }
+            ptr_first_line = ptr_line;
+            ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, -1);
+        }
+
+        /* send lines, oldest first */
+        for (ptr_line = ptr_first_line; ptr_line;
+             ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1))
+        {
+            ptr_line_data = weechat_hdata_pointer (ptr_hdata_line, ptr_line,
+                                                   "data");
+            if (ptr_line_data)
+            {
+                relay_weechat_protocol_send_line (ptr_client,
+                                                  "_buffer_line_added",
+                                                  ptr_line_data, 0);
+            }
+        }
+    }
+
+    /* send whole nicklist with the nicklist timer */
+    if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
+                                        RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
+    {
+        ptr_nicklist = relay_weechat_nicklist_new ();
+        if (!ptr_nicklist)
+            return;
+        ptr_nicklist->nicklist_count = 0;
+        weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                               ptr_buffer,
+                               ptr_nicklist);
+        if (!RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist))
+            relay_weechat_hook_timer_nicklist (ptr_client);
+    }
+}
+
 /*
  * Callback for command "sync" (from client).
  *
@@ -999,14 +1289,18 @@ relay_weechat_protocol_signal_upgrade_cb (const void *pointer, void *data,
  *   sync
  *   sync * buffer
  *   sync irc.freenode.#weechat buffer,nicklist
+ *   sync * buffer,nicklist,since=1234
  */
 
 RELAY_WEECHAT_PROTOCOL_CALLBACK(sync)
 {
-    char **buffers, **flags, *full_name;
+    char **buffers, **flags, *full_name, *error;
     int num_buffers, num_flags, i, add_flags, mask, *ptr_old_flags, new_flags;
     int rc;
     long unsigned int value;
+    long since, number;
+    struct t_hdata *ptr_hdata;
+    struct t_gui_buffer *ptr_buffer;
 
     RELAY_WEECHAT_PROTOCOL_MIN_ARGS(0);
 
@@ -1015,6 +1309,7 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(sync)
     if (buffers)
     {
         add_flags = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
+        since = -1;
         if (argc > 1)
         {
             add_flags = 0;
@@ -1023,10 +1318,23 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(sync)
             {
                 for (i = 0; i < num_flags; i++)
                 {
-                    add_flags |= relay_weechat_protocol_sync_flag (flags[i]);
+                    if (strncmp (flags[i], "since=", 6) == 0)
+                    {
+                        error = NULL;
+                        number = strtol (flags[i] + 6, &error, 10);
+                        if (error && !error[0] && (number >= 0))
+                            since = number;
+                    }
+                    else
+                    {
+                        add_flags |= relay_weechat_protocol_sync_flag (flags[i]);
+                    }
                 }
                 weechat_string_free_split (flags);
             }
+            /* only "since=xxx" given: sync with all flags */
+            if (!add_flags && (since >= 0))
+                add_flags = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
         }
         if (add_flags)
         {
@@ -1065,6 +1373,38 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(sync)
                     free (full_name);
                 }
             }
+
+            /* send changes since a line id (client resuming its sync) */
+            if (since >= 0)
+            {
+                for (i = 0; i < num_buffers; i++)
+                {
+                    if (strcmp (buffers[i], "*") == 0)
+                    {
+                        ptr_hdata = weechat_hdata_get ("buffer");
+                        ptr_buffer = weechat_hdata_get_list (ptr_hdata,
+                                                             "gui_buffers");
+                        while (ptr_buffer)
+                        {
+                            relay_weechat_protocol_sync_since (client,
+                                                               ptr_buffer,
+                                                               since);
+                            ptr_buffer = weechat_hdata_move (ptr_hdata,
+                                                             ptr_buffer, 1);
+                        }
+                    }
+                    else
+                    {
+                        ptr_buffer = relay_weechat_protocol_get_buffer (buffers[i]);
+                        if (ptr_buffer)
+                        {
+                            relay_weechat_protocol_sync_since (client,
+                                                               ptr_buffer,
+                                                               since);
+                        }
+                    }
+                }
+            }
         }
         weechat_string_free_split (buffers);
     }
@@ -33,6 +33,7 @@
 #include "../../weechat-plugin.h"
 #include "../relay.h"
 #include "relay-weechat.h"
+#include "relay-weechat-msg.h"
 #include "relay-weechat-nicklist.h"
 #include "relay-weechat-protocol.h"
 #include "../relay-client.h"
@@ -41,7 +42,7 @@
 
 
 char *relay_weechat_compression_string[] = /* strings for compressions      */
-{ "off", "zlib" };
+{ "off", "zlib", "zstd", "zlib_stream", "zstd_stream" };
 
 
 /*
@@ -58,6 +59,14 @@ relay_weechat_compression_search (const char *compression)
 
     for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
     {
+#ifndef HAVE_ZSTD
+        /* zstd is not available if WeeChat is built without it */
+        if ((i == RELAY_WEECHAT_COMPRESSION_ZSTD)
+            || (i == RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM))
+        {
+            continue;
+        }
+#endif /* HAVE_ZSTD */
         if (weechat_strcasecmp (relay_weechat_compression_string[i], compression) == 0)
             return i;
     }
@@ -66,6 +75,46 @@ relay_weechat_compression_search (const char *compression)
     return -1;
 }
 
+/*
+ * Checks if a client uses a compression stream (the context is kept between
+ * messages).
+ *
+ * Returns:
+ *   1: compression with a stream
+ *   0: no compression or compression of each message
+ */
+
+int
+relay_weechat_compression_is_stream (struct t_relay_client *client)
+{
+    return ((RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM)
+            || (RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM)) ?
+        1 : 0;
+}
+
+/*
+ * Frees compression streams of a client (a new stream is started with next
+ * message sent).
+ */
+
+void
+relay_weechat_free_compression_streams (struct t_relay_client *client)
+{
+    if (RELAY_WEECHAT_DATA(client, zlib_stream))
+    {
+        deflateEnd (RELAY_WEECHAT_DATA(client, zlib_stream));
+        free (RELAY_WEECHAT_DATA(client, zlib_stream));
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+    }
+#ifdef HAVE_ZSTD
+    if (RELAY_WEECHAT_DATA(client, zstd_cstream))
+    {
+        ZSTD_freeCStream (RELAY_WEECHAT_DATA(client, zstd_cstream));
+        RELAY_WEECHAT_DATA(client, zstd_cstream) = NULL;
+    }
+#endif /* HAVE_ZSTD */
+}
+
 /*
  * Hooks signals for a client.
  */
@@ -124,6 +173,29 @@ relay_weechat_hook_timer_nicklist (struct t_relay_client *client)
                             client, NULL);
 }
 
+/*
+ * Removes synchronization of all buffers for a client and sends the event
+ * "_resync" (used when messages for the client have been removed from its
+ * out queue): the client must send command "sync" again (for example with
+ * option "since" to get only lines not received).
+ */
+
+void
+relay_weechat_resync (struct t_relay_client *client)
+{
+    struct t_relay_weechat_msg *msg;
+
+    weechat_hashtable_remove_all (RELAY_WEECHAT_DATA(client, buffers_sync));
+    weechat_hashtable_remove_all (RELAY_WEECHAT_DATA(client, buffers_nicklist));
+
+    msg = relay_weechat_msg_new ("_resync");
+    if (msg)
+    {
+        relay_weechat_msg_send (client, msg);
+        relay_weechat_msg_free (msg);
+    }
+}
+
 /*
  * Reads data from a client.
  */
@@ -177,6 +249,12 @@ relay_weechat_alloc (struct t_relay_client *client)
     {
         RELAY_WEECHAT_DATA(client, password_ok) = (password && password[0]) ? 0 : 1;
         RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+#ifdef HAVE_ZSTD
+        RELAY_WEECHAT_DATA(client, zstd_cctx) = NULL;
+        RELAY_WEECHAT_DATA(client, zstd_cstream) = NULL;
+#endif /* HAVE_ZSTD */
+        RELAY_WEECHAT_DATA(client, nicklist_compact) = 0;
         RELAY_WEECHAT_DATA(client, buffers_sync) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_STRING,
@@ -225,6 +303,22 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
             infolist, "password_ok");
         RELAY_WEECHAT_DATA(client, compression) = weechat_infolist_integer (
             infolist, "compression");
+        /*
+         * compression streams are lost on upgrade: messages are now
+         * compressed one by one (the client sees it with the compression
+         * flag of each message)
+         */
+        if (RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM)
+            RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+        else if (RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM)
+            RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZSTD;
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+#ifdef HAVE_ZSTD
+        RELAY_WEECHAT_DATA(client, zstd_cctx) = NULL;
+        RELAY_WEECHAT_DATA(client, zstd_cstream) = NULL;
+#endif /* HAVE_ZSTD */
+        RELAY_WEECHAT_DATA(client, nicklist_compact) = weechat_infolist_integer (
+            infolist, "nicklist_compact");
 
         /* sync of buffers */
         RELAY_WEECHAT_DATA(client, buffers_sync) = weechat_hashtable_new (
@@ -289,6 +383,14 @@ relay_weechat_free (struct t_relay_client *client)
             weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
         if (RELAY_WEECHAT_DATA(client, buffers_nicklist))
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_nicklist));
+        relay_weechat_free_compression_streams (client);
+#ifdef HAVE_ZSTD
+        if (RELAY_WEECHAT_DATA(client, zstd_cctx))
+            ZSTD_freeCCtx (RELAY_WEECHAT_DATA(client, zstd_cctx));
+#endif /* HAVE_ZSTD */
+
+        /* message may have been compressed with data of this client */
+        relay_weechat_msg_shared_free ();
 
         free (client->protocol_data);
 
@@ -315,6 +417,8 @@ relay_weechat_add_to_infolist (struct t_infolist_item *item,
         return 0;
     if (!weechat_infolist_new_var_integer (item, "compression", RELAY_WEECHAT_DATA(client, compression)))
         return 0;
+    if (!weechat_infolist_new_var_integer (item, "nicklist_compact", RELAY_WEECHAT_DATA(client, nicklist_compact)))
+        return 0;
     if (!weechat_hashtable_add_to_infolist (RELAY_WEECHAT_DATA(client, buffers_sync), item, "buffers_sync"))
         return 0;
 
@@ -332,6 +436,12 @@ relay_weechat_print_log (struct t_relay_client *client)
     {
         weechat_log_printf ("    password_ok. . . . . . : %d",   RELAY_WEECHAT_DATA(client, password_ok));
         weechat_log_printf ("    compression. . . . . . : %d",   RELAY_WEECHAT_DATA(client, compression));
+        weechat_log_printf ("    zlib_stream. . . . . . : 0x%lx", RELAY_WEECHAT_DATA(client, zlib_stream));
+#ifdef HAVE_ZSTD
+        weechat_log_printf ("    zstd_cctx. . . . . . . : 0x%lx", RELAY_WEECHAT_DATA(client, zstd_cctx));
+        weechat_log_printf ("    zstd_cstream . . . . . : 0x%lx", RELAY_WEECHAT_DATA(client, zstd_cstream));
+#endif /* HAVE_ZSTD */
+        weechat_log_printf ("    nicklist_compact . . . : %d",   RELAY_WEECHAT_DATA(client, nicklist_compact));
         weechat_log_printf ("    buffers_sync . . . . . : 0x%lx (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_sync),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_sync),
@@ -20,6 +20,11 @@
 #ifndef WEECHAT_RELAY_WEECHAT_H
 #define WEECHAT_RELAY_WEECHAT_H 1
 
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
 struct t_relay_client;
 
 #define RELAY_WEECHAT_DATA(client, var)                          \
@@ -29,6 +34,9 @@ enum t_relay_weechat_compression
 {
     RELAY_WEECHAT_COMPRESSION_OFF = 0, /* no compression of binary objects  */
     RELAY_WEECHAT_COMPRESSION_ZLIB,    /* zlib compression                  */
+    RELAY_WEECHAT_COMPRESSION_ZSTD,    /* Zstandard compression             */
+    RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM, /* zlib stream (sync flush)      */
+    RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM, /* Zstandard stream (flush)      */
     /* number of compressions */
     RELAY_WEECHAT_NUM_COMPRESSIONS,
 };
@@ -37,6 +45,13 @@ struct t_relay_weechat_data
 {
     int password_ok;                   /* password received and OK?         */
     enum t_relay_weechat_compression compression; /* compression type       */
+    z_stream *zlib_stream;             /* zlib stream (kept for all msgs)   */
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *zstd_cctx;              /* zstd context (reused for messages)*/
+    ZSTD_CStream *zstd_cstream;        /* zstd stream (kept for all msgs)   */
+#endif /* HAVE_ZSTD */
+    int nicklist_compact;              /* 1 if nicklist diffs are sent with */
+                                       /* compact format ("_nicklist_delta")*/
 
     /* sync of buffers */
     struct t_hashtable *buffers_sync;  /* buffers synchronized (events      */
@@ -48,10 +63,15 @@ struct t_relay_weechat_data
     struct t_hook *hook_timer_nicklist;   /* timer for sending nicklist     */
 };
 
+extern char *relay_weechat_compression_string[];
+
 extern int relay_weechat_compression_search (const char *compression);
+extern int relay_weechat_compression_is_stream (struct t_relay_client *client);
+extern void relay_weechat_free_compression_streams (struct t_relay_client *client);
 extern void relay_weechat_hook_signals (struct t_relay_client *client);
 extern void relay_weechat_unhook_signals (struct t_relay_client *client);
 extern void relay_weechat_hook_timer_nicklist (struct t_relay_client *client);
+extern void relay_weechat_resync (struct t_relay_client *client);
 extern void relay_weechat_recv (struct t_relay_client *client,
                                 const char *data);
 extern void relay_weechat_close_connection (struct t_relay_client *client);
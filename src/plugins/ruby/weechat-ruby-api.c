@@ -2314,6 +2314,37 @@ weechat_ruby_api_print_date_tags (VALUE class, VALUE buffer, VALUE date,
     API_RETURN_OK;
 }
 
+static VALUE
+weechat_ruby_api_print_lines (VALUE class, VALUE buffer, VALUE date,
+                              VALUE tags, VALUE lines)
+{
+    char *c_buffer, *c_tags, *c_lines;
+    int c_date;
+
+    API_INIT_FUNC(1, "print_lines", API_RETURN_ERROR);
+    if (NIL_P (buffer) || NIL_P (date) || NIL_P (tags) || NIL_P (lines))
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    Check_Type (buffer, T_STRING);
+    Check_Type (date, T_FIXNUM);
+    Check_Type (tags, T_STRING);
+    Check_Type (lines, T_STRING);
+
+    c_buffer = StringValuePtr (buffer);
+    c_date = FIX2INT (date);
+    c_tags = StringValuePtr (tags);
+    c_lines = StringValuePtr (lines);
+
+    plugin_script_api_print_lines (weechat_ruby_plugin,
+                                   ruby_current_script,
+                                   API_STR2PTR(c_buffer),
+                                   c_date,
+                                   c_tags,
+                                   c_lines);
+
+    API_RETURN_OK;
+}
+
 static VALUE
 weechat_ruby_api_print_y (VALUE class, VALUE buffer, VALUE y, VALUE message)
 {
@@ -5916,6 +5947,56 @@ weechat_ruby_api_hdata_hashtable (VALUE class, VALUE hdata, VALUE pointer,
     return result_hash;
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * hash with the variables of object in the array.
+ */
+
+void
+weechat_ruby_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                                 void *pointer, struct t_hashtable *record)
+{
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    rb_ary_push (*((VALUE *)data), weechat_ruby_hashtable_to_hash (record));
+}
+
+static VALUE
+weechat_ruby_api_hdata_fetch (VALUE class, VALUE hdata, VALUE pointer,
+                              VALUE fields, VALUE count)
+{
+    char *c_hdata, *c_pointer, *c_fields;
+    int c_count;
+    VALUE result_array;
+
+    API_INIT_FUNC(1, "hdata_fetch", API_RETURN_EMPTY);
+    if (NIL_P (hdata) || NIL_P (pointer) || NIL_P (fields) || NIL_P (count))
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    Check_Type (hdata, T_STRING);
+    Check_Type (pointer, T_STRING);
+    Check_Type (fields, T_STRING);
+    Check_Type (count, T_FIXNUM);
+
+    c_hdata = StringValuePtr (hdata);
+    c_pointer = StringValuePtr (pointer);
+    c_fields = StringValuePtr (fields);
+    c_count = FIX2INT (count);
+
+    result_array = rb_ary_new ();
+
+    weechat_hdata_fetch (API_STR2PTR(c_hdata),
+                         API_STR2PTR(c_pointer),
+                         c_fields,
+                         c_count,
+                         &weechat_ruby_api_hdata_fetch_cb,
+                         &result_array);
+
+    return result_array;
+}
+
 static VALUE
 weechat_ruby_api_hdata_update (VALUE class, VALUE hdata, VALUE pointer,
                                VALUE hashtable)
@@ -6243,6 +6324,7 @@ weechat_ruby_api_init (VALUE ruby_mWeechat)
     API_DEF_FUNC(color, 1);
     API_DEF_FUNC(print, 2);
     API_DEF_FUNC(print_date_tags, 4);
+    API_DEF_FUNC(print_lines, 4);
     API_DEF_FUNC(print_y, 3);
     API_DEF_FUNC(log_print, 1);
     API_DEF_FUNC(hook_command, 7);
@@ -6351,6 +6433,7 @@ weechat_ruby_api_init (VALUE ruby_mWeechat)
     API_DEF_FUNC(hdata_pointer, 3);
     API_DEF_FUNC(hdata_time, 3);
     API_DEF_FUNC(hdata_hashtable, 3);
+    API_DEF_FUNC(hdata_fetch, 4);
     API_DEF_FUNC(hdata_update, 3);
     API_DEF_FUNC(hdata_get_string, 2);
     API_DEF_FUNC(upgrade_new, 3);
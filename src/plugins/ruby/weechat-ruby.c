@@ -318,6 +318,28 @@ weechat_ruby_print_exception (VALUE err)
     return 0;
 }
 
+/*
+ * Gets ID of a ruby function (the ID is cached in script, so that the
+ * function name is not searched again in ruby symbols on next calls).
+ */
+
+ID
+weechat_ruby_function_id (struct t_plugin_script *script, const char *function)
+{
+    ID method_id;
+
+    method_id = (ID)plugin_script_function_ref_get (weechat_ruby_plugin,
+                                                    script, function);
+    if (!method_id)
+    {
+        method_id = rb_intern (function);
+        plugin_script_function_ref_set (weechat_ruby_plugin, script, function,
+                                        (void *)method_id, NULL);
+    }
+
+    return method_id;
+}
+
 /*
  * Executes a ruby function.
  */
@@ -360,13 +382,13 @@ weechat_ruby_exec (struct t_plugin_script *script,
     if (argc > 0)
     {
         rc = rb_protect_funcall ((VALUE) script->interpreter,
-                                 rb_intern(function),
+                                 weechat_ruby_function_id (script, function),
                                  &ruby_error, argc, argv2);
     }
     else
     {
         rc = rb_protect_funcall ((VALUE) script->interpreter,
-                                 rb_intern(function),
+                                 weechat_ruby_function_id (script, function),
                                  &ruby_error, 0, NULL);
     }
 
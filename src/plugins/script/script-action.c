@@ -92,6 +92,158 @@ script_action_list ()
     }
 }
 
+/*
+ * Compares two stats items (for qsort): most expensive first.
+ */
+
+int
+script_action_stats_cmp_cb (const void *item1, const void *item2)
+{
+    const struct t_script_action_stats *stats1, *stats2;
+    int rc;
+
+    stats1 = (const struct t_script_action_stats *)item1;
+    stats2 = (const struct t_script_action_stats *)item2;
+
+    if (stats1->time_total > stats2->time_total)
+        return -1;
+    if (stats1->time_total < stats2->time_total)
+        return 1;
+    rc = strcmp (stats1->script, stats2->script);
+    if (rc != 0)
+        return rc;
+    return strcmp (stats1->type, stats2->type);
+}
+
+/*
+ * Displays time spent in callbacks of loaded scripts, by script and type of
+ * hook (most expensive first).
+ */
+
+void
+script_action_stats ()
+{
+    struct t_infolist *infolist;
+    struct t_script_action_stats *stats, *new_stats;
+    const char *ptr_plugin_name, *ptr_subplugin, *ptr_type;
+    char str_script[256], *error;
+    long value;
+    int i, num_stats, size_stats, language;
+
+    stats = NULL;
+    num_stats = 0;
+    size_stats = 0;
+
+    infolist = weechat_infolist_get ("hook", NULL, NULL);
+    if (infolist)
+    {
+        while (weechat_infolist_next (infolist))
+        {
+            ptr_plugin_name = weechat_infolist_string (infolist,
+                                                       "plugin_name");
+            ptr_subplugin = weechat_infolist_string (infolist, "subplugin");
+            ptr_type = weechat_infolist_string (infolist, "type");
+            if (!ptr_plugin_name || !ptr_subplugin || !ptr_subplugin[0]
+                || !ptr_type
+                || weechat_infolist_integer (infolist, "deleted"))
+            {
+                continue;
+            }
+            language = script_language_search (ptr_plugin_name);
+            snprintf (str_script, sizeof (str_script), "%s%s%s",
+                      ptr_subplugin,
+                      (language >= 0) ? "." : "",
+                      (language >= 0) ? script_extension[language] : "");
+            for (i = 0; i < num_stats; i++)
+            {
+                if ((strcmp (stats[i].script, str_script) == 0)
+                    && (strncmp (stats[i].type, ptr_type,
+                                 sizeof (stats[i].type) - 1) == 0))
+                    break;
+            }
+            if (i == num_stats)
+            {
+                if (num_stats == size_stats)
+                {
+                    size_stats = (size_stats == 0) ? 16 : size_stats * 2;
+                    new_stats = realloc (stats,
+                                         size_stats * sizeof (*new_stats));
+                    if (!new_stats)
+                        break;
+                    stats = new_stats;
+                }
+                stats[i].script = strdup (str_script);
+                if (!stats[i].script)
+                    break;
+                snprintf (stats[i].type, sizeof (stats[i].type),
+                          "%s", ptr_type);
+                stats[i].hooks = 0;
+                stats[i].calls = 0;
+                stats[i].time_total = 0;
+                stats[i].time_max = 0;
+                stats[i].budget_exceeded = 0;
+                num_stats++;
+            }
+            stats[i].hooks++;
+            error = NULL;
+            value = strtol (weechat_infolist_string (infolist, "calls"),
+                            &error, 10);
+            if (error && !error[0])
+                stats[i].calls += value;
+            error = NULL;
+            value = strtol (weechat_infolist_string (infolist, "time_total"),
+                            &error, 10);
+            if (error && !error[0])
+                stats[i].time_total += value;
+            error = NULL;
+            value = strtol (weechat_infolist_string (infolist, "time_max"),
+                            &error, 10);
+            if (error && !error[0] && (value > stats[i].time_max))
+                stats[i].time_max = value;
+            error = NULL;
+            value = strtol (
+                weechat_infolist_string (infolist, "budget_exceeded"),
+                &error, 10);
+            if (error && !error[0])
+                stats[i].budget_exceeded += value;
+        }
+        weechat_infolist_free (infolist);
+    }
+
+    weechat_printf (NULL, "");
+    weechat_printf (NULL, _("Time spent in callbacks of scripts:"));
+
+    if (num_stats == 0)
+    {
+        weechat_printf (NULL, _("  (none)"));
+        return;
+    }
+
+    qsort (stats, num_stats, sizeof (*stats), &script_action_stats_cmp_cb);
+
+    for (i = 0; i < num_stats; i++)
+    {
+        weechat_printf (NULL,
+                        _("  %s%-24s%s %-10s %10.3f ms, %ld calls (%ld "
+                          "hooks), max: %.3f ms, over budget: %ld"),
+                        weechat_color (weechat_config_string (script_config_color_text_name)),
+                        stats[i].script,
+                        weechat_color ("reset"),
+                        stats[i].type,
+                        ((float)stats[i].time_total) / 1000,
+                        stats[i].calls,
+                        stats[i].hooks,
+                        ((float)stats[i].time_max) / 1000,
+                        stats[i].budget_exceeded);
+    }
+
+    for (i = 0; i < num_stats; i++)
+    {
+        free (stats[i].script);
+    }
+    free (stats);
+}
+
 /*
  * Lists loaded scripts (all languages) in input.
  *
@@ -1231,6 +1383,10 @@ script_action_run ()
                     else
                         script_action_list ();
                 }
+                else if (weechat_strcasecmp (argv[0], "stats") == 0)
+                {
+                    script_action_stats ();
+                }
                 else if (weechat_strcasecmp (argv[0], "load") == 0)
                 {
                     for (j = 1; j < argc; j++)
@@ -20,6 +20,19 @@
 #ifndef WEECHAT_SCRIPT_ACTION_H
 #define WEECHAT_SCRIPT_ACTION_H 1
 
+/* time spent in callbacks of a script, for a type of hook */
+
+struct t_script_action_stats
+{
+    char *script;                      /* script name with extension        */
+    char type[32];                     /* hook type (timer, signal, ...)    */
+    long hooks;                        /* number of hooks                   */
+    long calls;                        /* number of calls of callbacks      */
+    long time_total;                   /* total time spent in callbacks     */
+    long time_max;                     /* max time spent in one call        */
+    long budget_exceeded;              /* number of calls over budget       */
+};
+
 extern char *script_actions;
 
 extern int script_action_run ();
@@ -169,6 +169,12 @@ script_command_script (const void *pointer, void *data,
         return WEECHAT_RC_OK;
     }
 
+    if (weechat_strcasecmp (argv[1], "stats") == 0)
+    {
+        script_action_schedule ("stats", 0, 0);
+        return WEECHAT_RC_OK;
+    }
+
     if ((weechat_strcasecmp (argv[1], "load") == 0)
         || (weechat_strcasecmp (argv[1], "unload") == 0)
         || (weechat_strcasecmp (argv[1], "reload") == 0)
@@ -291,6 +297,7 @@ script_command_init ()
         "script",
         N_("WeeChat scripts manager"),
         N_("list [-o|-i]"
+           " || stats"
            " || search <text>"
            " || show <script>"
            " || load|unload|reload <script> [<script>...]"
@@ -302,6 +309,9 @@ script_command_init ()
            "            -o: send list of loaded scripts to buffer\n"
            "            -i: copy list of loaded scripts in command line (for "
            "sending to buffer)\n"
+           "         stats: display time spent in callbacks of loaded "
+           "scripts, by script and type of hook (see options "
+           "weechat.plugin.script_callback_*)\n"
            "        search: search scripts by tags, language (python, "
            "perl, ...), filename extension (py, pl, ...) or text; result is "
            "displayed on scripts buffer\n"
@@ -369,6 +379,7 @@ script_command_init ()
            "  /script reload urlserver\n"
            "  /script upgrade"),
         "list -o|-i"
+        " || stats"
         " || search %(script_tags)|%(script_languages)|%(script_extensions)"
         " || show %(script_scripts)"
         " || load %(script_files)|%*"
@@ -103,6 +103,8 @@ script_completion_scripts_cb (const void *pointer, void *data,
     (void) completion_item;
     (void) buffer;
 
+    script_repo_file_read_pending ();
+
     for (ptr_script = scripts_repo; ptr_script;
          ptr_script = ptr_script->next_script)
     {
@@ -132,6 +134,8 @@ script_completion_scripts_installed_cb (const void *pointer, void *data,
     (void) completion_item;
     (void) buffer;
 
+    script_repo_file_read_pending ();
+
     for (ptr_script = scripts_repo; ptr_script;
          ptr_script = ptr_script->next_script)
     {
@@ -251,6 +255,8 @@ script_completion_tags_cb (const void *pointer, void *data,
     (void) completion_item;
     (void) buffer;
 
+    script_repo_file_read_pending ();
+
     for (ptr_script = scripts_repo; ptr_script;
          ptr_script = ptr_script->next_script)
     {
@@ -66,6 +66,7 @@ script_info_infolist_script_script_cb (const void *pointer, void *data,
     else
     {
         /* build list with all scripts matching arguments */
+        script_repo_file_read_pending ();
         for (ptr_script = scripts_repo; ptr_script;
              ptr_script = ptr_script->next_script)
         {
@@ -52,6 +52,9 @@ int script_repo_count = 0;
 int script_repo_count_displayed = 0;
 struct t_hashtable *script_repo_max_length_field = NULL;
 char *script_repo_filter = NULL;
+char **script_repo_filter_words = NULL;
+int script_repo_filter_num_words = 0;
+int script_repo_file_pending = 0;
 
 
 /*
@@ -899,14 +902,80 @@ script_repo_update_status_all ()
 
 /*
  * Sets filter for scripts.
+ *
+ * The filter is split in lower case words only once here, so that they can
+ * be compared quickly with each script.
  */
 
 void
 script_repo_set_filter (const char *filter)
 {
+    char *filter_lower;
+
     if (script_repo_filter)
+    {
         free (script_repo_filter);
-    script_repo_filter = (filter) ? strdup (filter) : NULL;
+        script_repo_filter = NULL;
+    }
+    if (script_repo_filter_words)
+    {
+        weechat_string_free_split (script_repo_filter_words);
+        script_repo_filter_words = NULL;
+    }
+    script_repo_filter_num_words = 0;
+
+    if (!filter)
+        return;
+
+    script_repo_filter = strdup (filter);
+
+    if (strcmp (filter, "*") != 0)
+    {
+        filter_lower = strdup (filter);
+        if (filter_lower)
+        {
+            weechat_string_tolower (filter_lower);
+            script_repo_filter_words = weechat_string_split (
+                filter_lower, " ", 0, 0, &script_repo_filter_num_words);
+            free (filter_lower);
+        }
+    }
+}
+
+/*
+ * Checks if a comma-separated list of tags contains a tag (case insensitive).
+ *
+ * Returns:
+ *   1: tag found in list
+ *   0: tag not found in list
+ */
+
+int
+script_repo_tags_has_tag (const char *tags, const char *tag)
+{
+    const char *ptr_tags, *pos;
+    int length_tag;
+
+    if (!tags || !tag || !tag[0])
+        return 0;
+
+    length_tag = weechat_utf8_strlen (tag);
+    ptr_tags = tags;
+    while (ptr_tags[0])
+    {
+        if (weechat_strncasecmp (ptr_tags, tag, length_tag) == 0)
+        {
+            pos = weechat_utf8_add_offset (ptr_tags, length_tag);
+            if (!pos[0] || (pos[0] == ','))
+                return 1;
+        }
+        pos = strchr (ptr_tags, ',');
+        if (!pos)
+            break;
+        ptr_tags = pos + 1;
+    }
+
+    return 0;
 }
 
 /*
@@ -920,76 +989,45 @@ script_repo_set_filter (const char *filter)
 int
 script_repo_match_filter (struct t_script_repo *script)
 {
-    char **words, **tags;
-    int num_words, num_tags, has_tag, match, i, j;
+    const char *ptr_word;
+    int i;
 
-    if (!script_repo_filter || strcmp (script_repo_filter, "*") == 0)
+    if (!script_repo_filter_words)
         return 1;
 
-    words = weechat_string_split (script_repo_filter, " ", 0, 0, &num_words);
-    tags = weechat_string_split ((script->tags) ? script->tags : "", ",", 0, 0,
-                                 &num_tags);
-    if (words)
+    for (i = 0; i < script_repo_filter_num_words; i++)
     {
-        for (i = 0; i < num_words; i++)
-        {
-            has_tag = 0;
-            if (tags)
-            {
-                for (j = 0; j < num_tags; j++)
-                {
-                    if (weechat_strcasecmp (tags[j], words[i]) == 0)
-                    {
-                        has_tag = 1;
-                        break;
-                    }
-                }
-            }
-            if (!has_tag)
-            {
-                match = 0;
+        ptr_word = script_repo_filter_words[i];
 
-                if (script->name_with_extension
-                    && weechat_strcasestr (script->name_with_extension,
-                                           words[i]))
-                {
-                    match = 1;
-                }
+        if (script_repo_tags_has_tag (script->tags, ptr_word))
+            continue;
 
-                if (!match
-                    && (weechat_strcasecmp (script_language[script->language],
-                                            words[i]) == 0))
-                {
-                    match = 1;
-                }
+        if (script->name_with_extension
+            && weechat_strcasestr (script->name_with_extension, ptr_word))
+        {
+            continue;
+        }
 
-                if (!match
-                    && (weechat_strcasecmp (script_extension[script->language],
-                                            words[i]) == 0))
-                {
-                    match = 1;
-                }
+        if (weechat_strcasecmp (script_language[script->language],
+                                ptr_word) == 0)
+        {
+            continue;
+        }
 
-                if (!match && script->description
-                    && weechat_strcasestr (script->description, words[i]))
-                {
-                    match = 1;
-                }
+        if (weechat_strcasecmp (script_extension[script->language],
+                                ptr_word) == 0)
+        {
+            continue;
+        }
 
-                if (!match)
-                {
-                    weechat_string_free_split (words);
-                    weechat_string_free_split (tags);
-                    return 0;
-                }
-            }
+        if (script->description
+            && weechat_strcasestr (script->description, ptr_word))
+        {
+            continue;
         }
-    }
 
-    if (words)
-        weechat_string_free_split (words);
-    if (tags)
-        weechat_string_free_split (tags);
+        return 0;
+    }
 
     return 1;
 }
@@ -1133,6 +1171,8 @@ script_repo_file_read (int quiet)
     struct tm tm_script;
     struct t_hashtable *descriptions;
 
+    script_repo_file_pending = 0;
+
     script_get_loaded_plugins ();
     script_get_scripts ();
 
@@ -1416,6 +1456,18 @@ script_repo_file_read (int quiet)
     return 1;
 }
 
+/*
+ * Reads repository file if its reading has been delayed (on startup, the file
+ * is read only when the list of scripts is needed for the first time).
+ */
+
+void
+script_repo_file_read_pending ()
+{
+    if (script_repo_file_pending)
+        script_repo_file_read (1);
+}
+
 /*
  * Callback called when list of scripts is downloaded.
  */
@@ -61,6 +61,7 @@ extern struct t_script_repo *last_script_repo;
 extern int script_repo_count, script_repo_count_displayed;
 extern struct t_hashtable *script_repo_max_length_field;
 extern char *script_repo_filter;
+extern int script_repo_file_pending;
 
 extern int script_repo_script_valid (struct t_script_repo *script);
 extern struct t_script_repo *script_repo_search_displayed_by_number (int number);
@@ -80,6 +81,7 @@ extern void script_repo_filter_scripts (const char *search);
 extern int script_repo_file_exists ();
 extern int script_repo_file_is_uptodate ();
 extern int script_repo_file_read (int quiet);
+extern void script_repo_file_read_pending ();
 extern void script_repo_file_update (int quiet);
 extern struct t_hdata *script_repo_hdata_script_cb (const void *pointer,
                                                     void *data,
@@ -455,7 +455,7 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
         if (!script_repo_file_is_uptodate ())
             script_repo_file_update (0);
         else
-            script_repo_file_read (0);
+            script_repo_file_pending = 1;
     }
 
     if (script_buffer)
@@ -478,8 +478,7 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     script_repo_remove_all ();
 
-    if (script_repo_filter)
-        free (script_repo_filter);
+    script_repo_set_filter (NULL);
 
     if (script_loaded)
         weechat_hashtable_free (script_loaded);
@@ -2121,6 +2121,33 @@ API_FUNC(print_date_tags)
     API_RETURN_OK;
 }
 
+API_FUNC(print_lines)
+{
+    Tcl_Obj *objp;
+    char *buffer, *tags, *lines;
+    int i, tdate;
+
+    API_INIT_FUNC(1, "print_lines", API_RETURN_ERROR);
+    if (objc < 5)
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    if (Tcl_GetIntFromObj (interp, objv[2], &tdate) != TCL_OK)
+        API_WRONG_ARGS(API_RETURN_ERROR);
+
+    buffer = Tcl_GetStringFromObj (objv[1], &i);
+    tags = Tcl_GetStringFromObj (objv[3], &i);
+    lines = Tcl_GetStringFromObj (objv[4], &i);
+
+    plugin_script_api_print_lines (weechat_tcl_plugin,
+                                   tcl_current_script,
+                                   API_STR2PTR(buffer),
+                                   tdate,
+                                   tags,
+                                   lines);
+
+    API_RETURN_OK;
+}
+
 API_FUNC(print_y)
 {
     Tcl_Obj *objp;
@@ -5221,6 +5248,65 @@ API_FUNC(hdata_hashtable)
     API_RETURN_OBJ(result_dict);
 }
 
+/*
+ * Callback called for each object fetched by function hdata_fetch: adds a
+ * dict with the variables of object in the list.
+ */
+
+void
+weechat_tcl_api_hdata_fetch_cb (void *data, struct t_hdata *hdata,
+                                void *pointer, struct t_hashtable *record)
+{
+    Tcl_Interp *interp;
+    Tcl_Obj *result_dict;
+
+    /* make C compiler happy */
+    (void) hdata;
+    (void) pointer;
+
+    interp = (Tcl_Interp *)(((void **)data)[0]);
+
+    result_dict = weechat_tcl_hashtable_to_dict (interp, record);
+    if (result_dict)
+    {
+        Tcl_ListObjAppendElement (interp, (Tcl_Obj *)(((void **)data)[1]),
+                                  result_dict);
+    }
+}
+
+API_FUNC(hdata_fetch)
+{
+    Tcl_Obj *objp, *result_list;
+    char *hdata, *pointer, *fields;
+    int i, count;
+    void *data[2];
+
+    API_INIT_FUNC(1, "hdata_fetch", API_RETURN_EMPTY);
+    if (objc < 5)
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    if (Tcl_GetIntFromObj (interp, objv[4], &count) != TCL_OK)
+        API_WRONG_ARGS(API_RETURN_EMPTY);
+
+    hdata = Tcl_GetStringFromObj (objv[1], &i);
+    pointer = Tcl_GetStringFromObj (objv[2], &i);
+    fields = Tcl_GetStringFromObj (objv[3], &i);
+
+    result_list = Tcl_NewListObj (0, NULL);
+
+    data[0] = interp;
+    data[1] = result_list;
+
+    weechat_hdata_fetch (API_STR2PTR(hdata),
+                         API_STR2PTR(pointer),
+                         fields,
+                         count,
+                         &weechat_tcl_api_hdata_fetch_cb,
+                         data);
+
+    API_RETURN_OBJ(result_list);
+}
+
 API_FUNC(hdata_update)
 {
     Tcl_Obj *objp;
@@ -5584,6 +5670,7 @@ void weechat_tcl_api_init (Tcl_Interp *interp)
     API_DEF_FUNC(color);
     API_DEF_FUNC(print);
     API_DEF_FUNC(print_date_tags);
+    API_DEF_FUNC(print_lines);
     API_DEF_FUNC(print_y);
     API_DEF_FUNC(log_print);
     API_DEF_FUNC(hook_command);
@@ -5692,6 +5779,7 @@ void weechat_tcl_api_init (Tcl_Interp *interp)
     API_DEF_FUNC(hdata_pointer);
     API_DEF_FUNC(hdata_time);
     API_DEF_FUNC(hdata_hashtable);
+    API_DEF_FUNC(hdata_fetch);
     API_DEF_FUNC(hdata_update);
     API_DEF_FUNC(hdata_get_string);
     API_DEF_FUNC(upgrade_new);
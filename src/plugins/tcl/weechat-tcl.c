@@ -176,6 +176,53 @@ weechat_tcl_dict_to_hashtable (Tcl_Interp *interp, Tcl_Obj *dict,
     return hashtable;
 }
 
+/*
+ * Callback called to free a reference to a tcl function.
+ */
+
+void
+weechat_tcl_function_ref_free_cb (struct t_hashtable *hashtable,
+                                  const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    Tcl_DecrRefCount ((Tcl_Obj *)value);
+}
+
+/*
+ * Gets object with name of a tcl function: the object is cached in script,
+ * so the command found by tcl is kept in object between calls.
+ *
+ * Returns object with name of function (must be released by caller with
+ * Tcl_DecrRefCount).
+ */
+
+Tcl_Obj *
+weechat_tcl_function_obj (struct t_plugin_script *script,
+                          const char *function)
+{
+    Tcl_Obj *obj;
+
+    obj = (Tcl_Obj *)plugin_script_function_ref_get (weechat_tcl_plugin,
+                                                     script, function);
+    if (!obj)
+    {
+        obj = Tcl_NewStringObj (function, -1);
+        Tcl_IncrRefCount (obj); /* +1 for cache */
+        if (!plugin_script_function_ref_set (weechat_tcl_plugin,
+                                             script, function, obj,
+                                             &weechat_tcl_function_ref_free_cb))
+        {
+            return obj;
+        }
+    }
+
+    Tcl_IncrRefCount (obj); /* +1 for caller */
+    return obj;
+}
+
 /*
  * Executes a tcl function.
  */
@@ -185,12 +232,13 @@ weechat_tcl_exec (struct t_plugin_script *script,
                   int ret_type, const char *function,
                   const char *format, void **argv)
 {
-    int argc, i, llength;
+    int argc, i, llength, timeout, limit_set, rc;
     int *ret_i;
     char *ret_cv;
     void *ret_val;
-    Tcl_Obj *cmdlist;
+    Tcl_Obj *cmdlist, *func;
     Tcl_Interp *interp;
+    Tcl_Time limit;
     struct t_plugin_script *old_tcl_script;
 
     old_tcl_script = tcl_current_script;
@@ -201,7 +249,9 @@ weechat_tcl_exec (struct t_plugin_script *script,
     {
         cmdlist = Tcl_NewListObj (0, NULL);
         Tcl_IncrRefCount (cmdlist); /* +1 */
-        Tcl_ListObjAppendElement (interp, cmdlist, Tcl_NewStringObj (function,-1));
+        func = weechat_tcl_function_obj (script, function);
+        Tcl_ListObjAppendElement (interp, cmdlist, func);
+        Tcl_DecrRefCount (func);
     }
     else
     {
@@ -235,7 +285,33 @@ weechat_tcl_exec (struct t_plugin_script *script,
     if (Tcl_ListObjLength (interp, cmdlist, &llength) != TCL_OK)
         llength = 0;
 
-    if (Tcl_EvalObjEx (interp, cmdlist, TCL_EVAL_DIRECT) == TCL_OK)
+    /*
+     * interrupt the function if it runs for too long (the limit of an outer
+     * function in same interpreter is kept)
+     */
+    limit_set = 0;
+    timeout = plugin_script_callback_timeout (weechat_tcl_plugin);
+    if ((timeout > 0) && !Tcl_LimitTypeEnabled (interp, TCL_LIMIT_TIME))
+    {
+        Tcl_GetTime (&limit);
+        limit.sec += timeout / 1000;
+        limit.usec += (timeout % 1000) * 1000;
+        if (limit.usec >= 1000000)
+        {
+            limit.sec++;
+            limit.usec -= 1000000;
+        }
+        Tcl_LimitSetTime (interp, &limit);
+        Tcl_LimitTypeSet (interp, TCL_LIMIT_TIME);
+        limit_set = 1;
+    }
+
+    rc = Tcl_EvalObjEx (interp, cmdlist, TCL_EVAL_DIRECT);
+
+    if (limit_set)
+        Tcl_LimitTypeReset (interp, TCL_LIMIT_TIME);
+
+    if (rc == TCL_OK)
     {
         Tcl_ListObjReplace (interp, cmdlist, 0, llength, 0, NULL); /* remove elements, decrement their ref count */
         Tcl_DecrRefCount (cmdlist); /* -1 */
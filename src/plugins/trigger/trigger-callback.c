@@ -36,6 +36,9 @@ struct t_hashtable *trigger_callback_hashtable_options_conditions = NULL;
 /* hashtable used to replace with regex */
 struct t_hashtable *trigger_callback_hashtable_options_regex = NULL;
 
+/* hashtable with variables used to check filters (before building hashtables) */
+struct t_hashtable *trigger_callback_hashtable_filter_vars = NULL;
+
 
 /*
  * Parses an IRC message.
@@ -68,6 +71,187 @@ trigger_callback_irc_message_parse (const char *irc_message,
 
     return hashtable_out;
 }
+
+/*
+ * Checks if filters of a trigger must be checked in callback: they are not
+ * checked if the monitor buffer is opened (so that all calls are displayed).
+ *
+ * Returns:
+ *   1: filters must be checked
+ *   0: filters must not be checked
+ */
+
+int
+trigger_callback_filters_enabled (struct t_trigger *trigger)
+{
+    return ((trigger->filters_count > 0)
+            && trigger_callback_hashtable_filter_vars
+            && !trigger_buffer
+            && (weechat_trigger_plugin->debug < 1)) ? 1 : 0;
+}
+
+/*
+ * Checks filters of a trigger with variables in hashtable
+ * "trigger_callback_hashtable_filter_vars" (a filter on a variable which is
+ * not in this hashtable is ignored).
+ *
+ * Returns:
+ *   1: filters are OK
+ *   0: at least one filter is false (so conditions are false)
+ */
+
+int
+trigger_callback_check_filters (struct t_trigger *trigger)
+{
+    int i;
+
+    for (i = 0; i < trigger->filters_count; i++)
+    {
+        if (!weechat_hashtable_has_key (trigger_callback_hashtable_filter_vars,
+                                        trigger->filters[i].variable))
+        {
+            continue;
+        }
+        if (!trigger_filter_match (
+                &trigger->filters[i],
+                weechat_hashtable_get (trigger_callback_hashtable_filter_vars,
+                                       trigger->filters[i].variable)))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Returns optional variables to build in a callback (mask of
+ * TRIGGER_VARS_XXX): all variables are built if the monitor buffer is opened.
+ */
+
+int
+trigger_callback_vars_needed (struct t_trigger *trigger)
+{
+    if (trigger_buffer || (weechat_trigger_plugin->debug >= 1))
+        return TRIGGER_VARS_ALL;
+
+    return trigger->vars_needed;
+}
+
+/*
+ * Sets variable "tg_tags" in a hashtable with tags of a message (format:
+ * ",tag1,tag2,tag3,").
+ */
+
+void
+trigger_callback_set_tags_string (struct t_hashtable *hashtable,
+                                  const char **tags)
+{
+    char *str_tags, *str_tags2;
+    int length;
+
+    str_tags = weechat_string_build_with_split_string (tags, ",");
+    if (str_tags)
+    {
+        /* build string with tags and commas around: ",tag1,tag2,tag3," */
+        length = 1 + strlen (str_tags) + 1 + 1;
+        str_tags2 = malloc (length);
+        if (str_tags2)
+        {
+            snprintf (str_tags2, length, ",%s,", str_tags);
+            weechat_hashtable_set (hashtable, "tg_tags", str_tags2);
+            free (str_tags2);
+        }
+        free (str_tags);
+    }
+}
+
+/*
+ * Sets variables used by filters for a "weechat_print" modifier, using
+ * modifier data (format: "plugin;buffer_name;tags").
+ */
+
+void
+trigger_callback_set_filter_vars_weechat_print (const char *modifier_data)
+{
+    const char *pos, *pos2, *ptr_tag, *ptr_nick, *pos_comma;
+    char *str_temp;
+    int length, length_nick;
+
+    weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                           "tg_plugin", "");
+    weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                           "tg_buffer", "");
+    weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                           "tg_tags", "");
+    weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                           "tg_tag_nick", "");
+
+    pos = strchr (modifier_data, ';');
+    if (!pos)
+        return;
+    str_temp = weechat_strndup (modifier_data, pos - modifier_data);
+    if (str_temp)
+    {
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_plugin", str_temp);
+        free (str_temp);
+    }
+    pos++;
+    pos2 = strchr (pos, ';');
+    if (!pos2)
+        return;
+
+    /* "tg_buffer" is the buffer full name: "plugin.buffer_name" */
+    str_temp = weechat_strndup (modifier_data, pos2 - modifier_data);
+    if (str_temp)
+    {
+        str_temp[pos - 1 - modifier_data] = '.';
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_buffer", str_temp);
+        free (str_temp);
+    }
+    pos2++;
+    if (!pos2[0])
+        return;
+
+    length = 1 + strlen (pos2) + 1 + 1;
+    str_temp = malloc (length);
+    if (str_temp)
+    {
+        snprintf (str_temp, length, ",%s,", pos2);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_tags", str_temp);
+        free (str_temp);
+    }
+
+    /* "tg_tag_nick" is set with the last tag "nick_xxx" */
+    ptr_nick = NULL;
+    length_nick = 0;
+    ptr_tag = pos2;
+    while (ptr_tag)
+    {
+        pos_comma = strchr (ptr_tag, ',');
+        if (strncmp (ptr_tag, "nick_", 5) == 0)
+        {
+            ptr_nick = ptr_tag + 5;
+            length_nick = (pos_comma) ?
+                pos_comma - ptr_nick : (int)strlen (ptr_nick);
+        }
+        ptr_tag = (pos_comma) ? pos_comma + 1 : NULL;
+    }
+    if (ptr_nick)
+    {
+        str_temp = weechat_strndup (ptr_nick, length_nick);
+        if (str_temp)
+        {
+            weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                                   "tg_tag_nick", str_temp);
+            free (str_temp);
+        }
+    }
+}
+
 /*
  * Sets variables in "extra_vars" hashtable using tags from message.
  *
@@ -224,36 +408,48 @@ trigger_callback_replace_regex (struct t_trigger *trigger,
             continue;
         }
 
-        weechat_hashtable_set (pointers, "regex", trigger->regex[i].regex);
-        weechat_hashtable_set (trigger_callback_hashtable_options_regex,
-                               "regex_replace",
-                               trigger->regex[i].replace_escaped);
+        /*
+         * if regex does not match, the value is unchanged: skip the
+         * evaluation (and the copy of value)
+         */
+        value = NULL;
+        if (weechat_string_regexec (trigger->regex[i].regex, ptr_value,
+                                    0, NULL, 0) == 0)
+        {
+            weechat_hashtable_set (pointers, "regex", trigger->regex[i].regex);
+            weechat_hashtable_set (trigger_callback_hashtable_options_regex,
+                                   "regex_replace",
+                                   trigger->regex[i].replace_escaped);
+
+            value = weechat_string_eval_expression (
+                ptr_value,
+                pointers,
+                extra_vars,
+                trigger_callback_hashtable_options_regex);
+            if (!value)
+                continue;
+        }
 
-        value = weechat_string_eval_expression (
-            ptr_value,
-            pointers,
-            extra_vars,
-            trigger_callback_hashtable_options_regex);
+        /* display debug info on trigger buffer */
+        if (trigger_buffer && display_monitor)
+        {
+            weechat_printf_date_tags (trigger_buffer, 0, "no_trigger",
+                                      "\t  regex %d %s(%s%s%s)%s: "
+                                      "%s\"%s%s%s\"",
+                                      i + 1,
+                                      weechat_color ("chat_delimiters"),
+                                      weechat_color ("reset"),
+                                      ptr_key,
+                                      weechat_color ("chat_delimiters"),
+                                      weechat_color ("reset"),
+                                      weechat_color ("chat_delimiters"),
+                                      weechat_color ("reset"),
+                                      (value) ? value : ptr_value,
+                                      weechat_color ("chat_delimiters"));
+        }
 
         if (value)
         {
-            /* display debug info on trigger buffer */
-            if (trigger_buffer && display_monitor)
-            {
-                weechat_printf_date_tags (trigger_buffer, 0, "no_trigger",
-                                          "\t  regex %d %s(%s%s%s)%s: "
-                                          "%s\"%s%s%s\"",
-                                          i + 1,
-                                          weechat_color ("chat_delimiters"),
-                                          weechat_color ("reset"),
-                                          ptr_key,
-                                          weechat_color ("chat_delimiters"),
-                                          weechat_color ("reset"),
-                                          weechat_color ("chat_delimiters"),
-                                          weechat_color ("reset"),
-                                          value,
-                                          weechat_color ("chat_delimiters"));
-            }
             weechat_hashtable_set (extra_vars, ptr_key, value);
             free (value);
         }
@@ -375,10 +571,50 @@ trigger_callback_signal_cb (const void *pointer, void *data,
 
     TRIGGER_CALLBACK_CB_INIT(WEECHAT_RC_OK);
 
+    /* get signal data as string */
+    ptr_signal_data = NULL;
+    if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_STRING) == 0)
+    {
+        ptr_signal_data = (const char *)signal_data;
+    }
+    else if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_INT) == 0)
+    {
+        str_data[0] = '\0';
+        if (signal_data)
+        {
+            snprintf (str_data, sizeof (str_data),
+                      "%d", *((int *)signal_data));
+        }
+        ptr_signal_data = str_data;
+    }
+    else if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_POINTER) == 0)
+    {
+        str_data[0] = '\0';
+        if (signal_data)
+        {
+            snprintf (str_data, sizeof (str_data),
+                      "0x%lx", (long unsigned int)signal_data);
+        }
+        ptr_signal_data = str_data;
+    }
+
+    /* check filters (before building hashtables) */
+    if (trigger_callback_filters_enabled (trigger))
+    {
+        weechat_hashtable_remove_all (trigger_callback_hashtable_filter_vars);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_signal", signal);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_signal_data", ptr_signal_data);
+        if (!trigger_callback_check_filters (trigger))
+            goto end;
+    }
+
     /* split IRC message (if signal_data is an IRC message) */
     irc_server = NULL;
     ptr_irc_message = NULL;
-    if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_STRING) == 0)
+    if ((trigger_callback_vars_needed (trigger) & TRIGGER_VARS_IRC)
+        && (strcmp (type_data, WEECHAT_HOOK_SIGNAL_STRING) == 0))
     {
         if (strstr (signal, ",irc_in_")
             || strstr (signal, ",irc_in2_")
@@ -423,32 +659,7 @@ trigger_callback_signal_cb (const void *pointer, void *data,
     }
 
     /* add data in hashtable used for conditions/replace/command */
-    ptr_signal_data = NULL;
     weechat_hashtable_set (extra_vars, "tg_signal", signal);
-    if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_STRING) == 0)
-    {
-        ptr_signal_data = (const char *)signal_data;
-    }
-    else if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_INT) == 0)
-    {
-        str_data[0] = '\0';
-        if (signal_data)
-        {
-            snprintf (str_data, sizeof (str_data),
-                      "%d", *((int *)signal_data));
-        }
-        ptr_signal_data = str_data;
-    }
-    else if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_POINTER) == 0)
-    {
-        str_data[0] = '\0';
-        if (signal_data)
-        {
-            snprintf (str_data, sizeof (str_data),
-                      "0x%lx", (long unsigned int)signal_data);
-        }
-        ptr_signal_data = str_data;
-    }
     weechat_hashtable_set (extra_vars, "tg_signal_data", ptr_signal_data);
 
     /* execute the trigger (conditions, regex, command) */
@@ -471,6 +682,16 @@ trigger_callback_hsignal_cb (const void *pointer, void *data,
 
     TRIGGER_CALLBACK_CB_INIT(WEECHAT_RC_OK);
 
+    /* check filters (before building hashtables) */
+    if (trigger_callback_filters_enabled (trigger))
+    {
+        weechat_hashtable_remove_all (trigger_callback_hashtable_filter_vars);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_signal", signal);
+        if (!trigger_callback_check_filters (trigger))
+            goto end;
+    }
+
     /* duplicate hashtable */
     if (hashtable
         && (strcmp (weechat_hashtable_get_string (hashtable, "type_keys"), "string") == 0))
@@ -519,7 +740,7 @@ trigger_callback_modifier_cb (const void *pointer, void *data,
     const char *ptr_string;
     char *string_modified, *pos, *pos2, *plugin_name, *buffer_name;
     char *buffer_full_name, *str_tags, **tags, *prefix, *string_no_color;
-    int length, num_tags;
+    int length, num_tags, vars_needed;
 
     TRIGGER_CALLBACK_CB_INIT(NULL);
 
@@ -528,11 +749,30 @@ trigger_callback_modifier_cb (const void *pointer, void *data,
     num_tags = 0;
     string_no_color = NULL;
 
+    /* check filters (before building hashtables) */
+    if (trigger_callback_filters_enabled (trigger))
+    {
+        weechat_hashtable_remove_all (trigger_callback_hashtable_filter_vars);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_modifier", modifier);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_modifier_data", modifier_data);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_string", string);
+        if (strcmp (modifier, "weechat_print") == 0)
+            trigger_callback_set_filter_vars_weechat_print (modifier_data);
+        if (!trigger_callback_check_filters (trigger))
+            goto end;
+    }
+
+    vars_needed = trigger_callback_vars_needed (trigger);
+
     /* split IRC message (if string is an IRC message) */
-    if ((strncmp (modifier, "irc_in_", 7) == 0)
-        || (strncmp (modifier, "irc_in2_", 8) == 0)
-        || (strncmp (modifier, "irc_out1_", 9) == 0)
-        || (strncmp (modifier, "irc_out_", 8) == 0))
+    if ((vars_needed & TRIGGER_VARS_IRC)
+        && ((strncmp (modifier, "irc_in_", 7) == 0)
+            || (strncmp (modifier, "irc_in2_", 8) == 0)
+            || (strncmp (modifier, "irc_out1_", 9) == 0)
+            || (strncmp (modifier, "irc_out_", 8) == 0)))
     {
         extra_vars = trigger_callback_irc_message_parse (string,
                                                          modifier_data);
@@ -550,7 +790,8 @@ trigger_callback_modifier_cb (const void *pointer, void *data,
     weechat_hashtable_set (extra_vars, "tg_modifier", modifier);
     weechat_hashtable_set (extra_vars, "tg_modifier_data", modifier_data);
     weechat_hashtable_set (extra_vars, "tg_string", string);
-    string_no_color = weechat_string_remove_color (string, NULL);
+    if (vars_needed & TRIGGER_VARS_NOCOLOR)
+        string_no_color = weechat_string_remove_color (string, NULL);
     if (string_no_color)
     {
         weechat_hashtable_set (extra_vars,
@@ -676,7 +917,8 @@ trigger_callback_modifier_cb (const void *pointer, void *data,
     trigger_callback_execute (trigger, buffer, pointers, extra_vars);
 
 end:
-    ptr_string = weechat_hashtable_get (extra_vars, "tg_string");
+    ptr_string = (extra_vars) ?
+        weechat_hashtable_get (extra_vars, "tg_string") : NULL;
     string_modified = (ptr_string && (strcmp (ptr_string, string) != 0)) ?
         strdup (ptr_string) : NULL;
 
@@ -699,8 +941,8 @@ trigger_callback_print_cb  (const void *pointer, void *data,
                             int displayed, int highlight, const char *prefix,
                             const char *message)
 {
-    char *str_tags, *str_tags2, str_temp[128], *str_no_color;
-    int length;
+    char str_temp[128], *str_no_color;
+    int i, vars_needed;
     struct tm *date_tmp;
 
     TRIGGER_CALLBACK_CB_INIT(WEECHAT_RC_OK);
@@ -710,50 +952,85 @@ trigger_callback_print_cb  (const void *pointer, void *data,
         && !weechat_buffer_match_list (buffer, trigger->hook_print_buffers))
         goto end;
 
+    /* check filters (before building hashtables) */
+    if (trigger_callback_filters_enabled (trigger))
+    {
+        weechat_hashtable_remove_all (trigger_callback_hashtable_filter_vars);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "buffer.full_name",
+                               weechat_buffer_get_string (buffer, "full_name"));
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "buffer.name",
+                               weechat_buffer_get_string (buffer, "name"));
+        snprintf (str_temp, sizeof (str_temp), "%d", displayed);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_displayed", str_temp);
+        snprintf (str_temp, sizeof (str_temp), "%d", highlight);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_highlight", str_temp);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_tags", "");
+        trigger_callback_set_tags_string (
+            trigger_callback_hashtable_filter_vars, tags);
+        weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                               "tg_tag_nick", "");
+        for (i = 0; i < tags_count; i++)
+        {
+            if (strncmp (tags[i], "nick_", 5) == 0)
+            {
+                weechat_hashtable_set (trigger_callback_hashtable_filter_vars,
+                                       "tg_tag_nick", tags[i] + 5);
+            }
+        }
+        if (!trigger_callback_check_filters (trigger))
+            goto end;
+    }
+
+    vars_needed = trigger_callback_vars_needed (trigger);
+
     TRIGGER_CALLBACK_CB_NEW_POINTERS;
     TRIGGER_CALLBACK_CB_NEW_EXTRA_VARS;
 
     /* add data in hashtables used for conditions/replace/command */
     weechat_hashtable_set (pointers, "buffer", buffer);
-    date_tmp = localtime (&date);
-    if (date_tmp)
+    if (vars_needed & TRIGGER_VARS_DATE)
     {
-        strftime (str_temp, sizeof (str_temp), "%Y-%m-%d %H:%M:%S", date_tmp);
-        weechat_hashtable_set (extra_vars, "tg_date", str_temp);
+        date_tmp = localtime (&date);
+        if (date_tmp)
+        {
+            strftime (str_temp, sizeof (str_temp), "%Y-%m-%d %H:%M:%S",
+                      date_tmp);
+            weechat_hashtable_set (extra_vars, "tg_date", str_temp);
+        }
     }
     snprintf (str_temp, sizeof (str_temp), "%d", displayed);
     weechat_hashtable_set (extra_vars, "tg_displayed", str_temp);
     snprintf (str_temp, sizeof (str_temp), "%d", highlight);
     weechat_hashtable_set (extra_vars, "tg_highlight", str_temp);
     weechat_hashtable_set (extra_vars, "tg_prefix", prefix);
-    str_no_color = weechat_string_remove_color (prefix, NULL);
-    if (str_no_color)
+    if (vars_needed & TRIGGER_VARS_NOCOLOR)
     {
-        weechat_hashtable_set (extra_vars, "tg_prefix_nocolor", str_no_color);
-        free (str_no_color);
+        str_no_color = weechat_string_remove_color (prefix, NULL);
+        if (str_no_color)
+        {
+            weechat_hashtable_set (extra_vars, "tg_prefix_nocolor",
+                                   str_no_color);
+            free (str_no_color);
+        }
     }
     weechat_hashtable_set (extra_vars, "tg_message", message);
-    str_no_color = weechat_string_remove_color (message, NULL);
-    if (str_no_color)
+    if (vars_needed & TRIGGER_VARS_NOCOLOR)
     {
-        weechat_hashtable_set (extra_vars, "tg_message_nocolor", str_no_color);
-        free (str_no_color);
-    }
-
-    str_tags = weechat_string_build_with_split_string (tags, ",");
-    if (str_tags)
-    {
-        /* build string with tags and commas around: ",tag1,tag2,tag3," */
-        length = 1 + strlen (str_tags) + 1 + 1;
-        str_tags2 = malloc (length);
-        if (str_tags2)
+        str_no_color = weechat_string_remove_color (message, NULL);
+        if (str_no_color)
         {
-            snprintf (str_tags2, length, ",%s,", str_tags);
-            weechat_hashtable_set (extra_vars, "tg_tags", str_tags2);
-            free (str_tags2);
+            weechat_hashtable_set (extra_vars, "tg_message_nocolor",
+                                   str_no_color);
+            free (str_no_color);
         }
-        free (str_tags);
     }
+
+    trigger_callback_set_tags_string (extra_vars, tags);
     if (!trigger_callback_set_tags (buffer, tags, tags_count, extra_vars))
         goto end;
 
@@ -956,6 +1233,12 @@ trigger_callback_init ()
         WEECHAT_HASHTABLE_STRING,
         WEECHAT_HASHTABLE_STRING,
         NULL, NULL);
+
+    trigger_callback_hashtable_filter_vars = weechat_hashtable_new (
+        32,
+        WEECHAT_HASHTABLE_STRING,
+        WEECHAT_HASHTABLE_STRING,
+        NULL, NULL);
 }
 
 /*
@@ -969,4 +1252,6 @@ trigger_callback_end ()
         weechat_hashtable_free (trigger_callback_hashtable_options_conditions);
     if (trigger_callback_hashtable_options_regex)
         weechat_hashtable_free (trigger_callback_hashtable_options_regex);
+    if (trigger_callback_hashtable_filter_vars)
+        weechat_hashtable_free (trigger_callback_hashtable_filter_vars);
 }
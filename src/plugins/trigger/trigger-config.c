@@ -195,6 +195,9 @@ trigger_config_change_trigger_hook (const void *pointer, void *data,
 
     if (ptr_trigger->options[TRIGGER_OPTION_ARGUMENTS])
         trigger_hook (ptr_trigger);
+
+    /* default variable for regex depends on hook type */
+    trigger_set_vars_needed (ptr_trigger);
 }
 
 /*
@@ -219,6 +222,30 @@ trigger_config_change_trigger_arguments (const void *pointer, void *data,
         trigger_hook (ptr_trigger);
 }
 
+/*
+ * Callback for changes on option "trigger.trigger.xxx.conditions".
+ */
+
+void
+trigger_config_change_trigger_conditions (const void *pointer, void *data,
+                                          struct t_config_option *option)
+{
+    struct t_trigger *ptr_trigger;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    ptr_trigger = trigger_search_with_option (option);
+    if (!ptr_trigger)
+        return;
+
+    trigger_filter_split (weechat_config_string (option),
+                          &ptr_trigger->filters_count,
+                          &ptr_trigger->filters);
+    trigger_set_vars_needed (ptr_trigger);
+}
+
 /*
  * Callback for changes on option "trigger.trigger.xxx.regex".
  */
@@ -263,6 +290,8 @@ trigger_config_change_trigger_regex (const void *pointer, void *data,
                             weechat_prefix ("error"), TRIGGER_PLUGIN_NAME);
             break;
     }
+
+    trigger_set_vars_needed (ptr_trigger);
 }
 
 /*
@@ -286,6 +315,8 @@ trigger_config_change_trigger_command (const void *pointer, void *data,
     trigger_split_command (weechat_config_string (option),
                            &ptr_trigger->commands_count,
                            &ptr_trigger->commands);
+
+    trigger_set_vars_needed (ptr_trigger);
 }
 
 /*
@@ -356,7 +387,9 @@ trigger_config_create_trigger_option (const char *trigger_name, int index_option
                    "hook callback) (note: content is evaluated when trigger is "
                    "run, see /help eval)"),
                 NULL, 0, 0, value, NULL, 0,
-                NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+                NULL, NULL, NULL,
+                &trigger_config_change_trigger_conditions, NULL, NULL,
+                NULL, NULL, NULL);
             break;
         case TRIGGER_OPTION_REGEX:
             ptr_option = weechat_config_new_option (
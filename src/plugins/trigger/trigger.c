@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <regex.h>
 
 #include "../weechat-plugin.h"
@@ -72,6 +73,22 @@ int trigger_return_code[TRIGGER_NUM_RETURN_CODES] =
 char *trigger_post_action_string[TRIGGER_NUM_POST_ACTIONS] =
 { "none", "disable", "delete" };
 
+/* comparisons used in filters (same order as in evaluation of conditions) */
+char *trigger_filter_comparison_string[TRIGGER_NUM_FILTER_COMPARISONS] =
+{ "=~", "!~", "==", "!=" };
+char *trigger_filter_other_comparisons[] =
+{ "<=", "<", ">=", ">", NULL };
+
+/* optional variables built in callbacks (see TRIGGER_VARS_XXX) */
+char *trigger_vars_nocolor[] =
+{ "tg_string_nocolor", "tg_prefix_nocolor", "tg_message_nocolor", NULL };
+char *trigger_vars_date[] =
+{ "tg_date", NULL };
+char *trigger_vars_irc[] =
+{ "server", "tags", "message_without_tags", "nick", "host", "command",
+  "channel", "arguments", "text", "pos_command", "pos_arguments",
+  "pos_channel", "pos_text", NULL };
+
 struct t_trigger *triggers = NULL;          /* first trigger                */
 struct t_trigger *last_trigger = NULL;      /* last trigger                 */
 int triggers_count = 0;                     /* number of triggers           */
@@ -492,7 +509,7 @@ trigger_regex_free (int *regex_count, struct t_trigger_regex **regex)
                 free ((*regex)[i].str_regex);
             if ((*regex)[i].regex)
             {
-                regfree ((*regex)[i].regex);
+                weechat_string_regfree ((*regex)[i].regex);
                 free ((*regex)[i].regex);
             }
             if ((*regex)[i].replace)
@@ -718,6 +735,491 @@ trigger_split_command (const char *command,
     }
 }
 
+/*
+ * Searches a string in another at level 0 (not between parentheses), like
+ * it is done when conditions are evaluated.
+ *
+ * Returns pointer to string found, NULL if not found.
+ */
+
+const char *
+trigger_filter_strstr_level (const char *string, const char *search)
+{
+    const char *ptr_string;
+    int level, length;
+
+    if (!string || !search)
+        return NULL;
+
+    length = strlen (search);
+
+    ptr_string = string;
+    level = 0;
+    while (ptr_string[0])
+    {
+        if (ptr_string[0] == '(')
+        {
+            level++;
+        }
+        else if (ptr_string[0] == ')')
+        {
+            if (level > 0)
+                level--;
+        }
+
+        if ((level == 0) && (strncmp (ptr_string, search, length) == 0))
+            return ptr_string;
+
+        ptr_string++;
+    }
+
+    return NULL;
+}
+
+/*
+ * Frees all the filters in a trigger.
+ */
+
+void
+trigger_filter_free (int *filters_count, struct t_trigger_filter **filters)
+{
+    int i;
+
+    if (*filters_count > 0)
+    {
+        for (i = 0; i < *filters_count; i++)
+        {
+            if ((*filters)[i].variable)
+                free ((*filters)[i].variable);
+            if ((*filters)[i].value)
+                free ((*filters)[i].value);
+            if ((*filters)[i].regex)
+            {
+                weechat_string_regfree ((*filters)[i].regex);
+                free ((*filters)[i].regex);
+            }
+        }
+        free (*filters);
+    }
+    *filters = NULL;
+    *filters_count = 0;
+}
+
+/*
+ * Adds a filter built with a sub-expression of conditions, if it has format
+ * "${variable} op value" (op is one of: =~, !~, ==, !=) and if value is a
+ * constant (other sub-expressions are ignored).
+ *
+ * Returns:
+ *    0: OK (filter added or sub-expression ignored)
+ *   -1: invalid sub-expression or not enough memory
+ */
+
+int
+trigger_filter_add (const char *expr, int length,
+                    int *filters_count, struct t_trigger_filter **filters)
+{
+    struct t_trigger_filter *new_filters;
+    const char *pos, *pos_end, *ptr_value;
+    char *expr2, *variable, *value;
+    int comparison, i, rc, length_var;
+
+    rc = -1;
+    variable = NULL;
+    value = NULL;
+
+    /* skip spaces at beginning/end of sub-expression */
+    while ((length > 0) && (expr[0] == ' '))
+    {
+        expr++;
+        length--;
+    }
+    while ((length > 0) && (expr[length - 1] == ' '))
+    {
+        length--;
+    }
+    if (length == 0)
+        return -1;
+
+    expr2 = weechat_strndup (expr, length);
+    if (!expr2)
+        return -1;
+
+    rc = 0;
+
+    /* search the comparison, exactly like the evaluation of conditions */
+    pos = NULL;
+    for (comparison = 0; comparison < TRIGGER_NUM_FILTER_COMPARISONS;
+         comparison++)
+    {
+        pos = trigger_filter_strstr_level (
+            expr2, trigger_filter_comparison_string[comparison]);
+        if (pos > expr2)
+            break;
+    }
+    if (comparison >= TRIGGER_NUM_FILTER_COMPARISONS)
+        goto end;
+
+    /* left part must be a single variable: "${name}" */
+    pos_end = pos - 1;
+    while ((pos_end > expr2) && (pos_end[0] == ' '))
+    {
+        pos_end--;
+    }
+    length_var = pos_end + 1 - expr2 - 3;
+    if ((length_var <= 0) || (strncmp (expr2, "${", 2) != 0)
+        || (pos_end[0] != '}'))
+    {
+        goto end;
+    }
+    for (i = 2; i < 2 + length_var; i++)
+    {
+        if (!isalnum ((unsigned char)expr2[i]) && (expr2[i] != '_')
+            && (expr2[i] != '.'))
+        {
+            goto end;
+        }
+    }
+
+    /* right part must be a constant */
+    ptr_value = pos + strlen (trigger_filter_comparison_string[comparison]);
+    while (ptr_value[0] == ' ')
+    {
+        ptr_value++;
+    }
+    if (strchr (ptr_value, '$'))
+        goto end;
+    if ((comparison == TRIGGER_FILTER_EQUAL)
+        || (comparison == TRIGGER_FILTER_NOT_EQUAL))
+    {
+        /* value is evaluated as a condition: it must not be an expression */
+        if (strchr (ptr_value, '(') || strchr (ptr_value, ')'))
+            goto end;
+        for (i = 0; i < TRIGGER_NUM_FILTER_COMPARISONS; i++)
+        {
+            if (strstr (ptr_value, trigger_filter_comparison_string[i]))
+                goto end;
+        }
+        for (i = 0; trigger_filter_other_comparisons[i]; i++)
+        {
+            if (strstr (ptr_value, trigger_filter_other_comparisons[i]))
+                goto end;
+        }
+    }
+
+    variable = weechat_strndup (expr2 + 2, length_var);
+    value = strdup (ptr_value);
+    new_filters = realloc (*filters,
+                           (*filters_count + 1) * sizeof ((*filters)[0]));
+    if (!variable || !value || !new_filters)
+    {
+        if (new_filters)
+            *filters = new_filters;
+        rc = -1;
+        goto end;
+    }
+    *filters = new_filters;
+    (*filters)[*filters_count].variable = variable;
+    (*filters)[*filters_count].comparison = comparison;
+    (*filters)[*filters_count].value = value;
+    (*filters)[*filters_count].regex = NULL;
+    (*filters_count)++;
+    variable = NULL;
+    value = NULL;
+
+    /* compile regex (if it is invalid, the comparison is always false) */
+    if ((comparison == TRIGGER_FILTER_REGEX_MATCHING)
+        || (comparison == TRIGGER_FILTER_REGEX_NOT_MATCHING))
+    {
+        (*filters)[*filters_count - 1].regex =
+            malloc (sizeof (*(*filters)[*filters_count - 1].regex));
+        if (!(*filters)[*filters_count - 1].regex)
+        {
+            rc = -1;
+            goto end;
+        }
+        if (weechat_string_regcomp ((*filters)[*filters_count - 1].regex,
+                                    ptr_value,
+                                    REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0)
+        {
+            free ((*filters)[*filters_count - 1].regex);
+            (*filters)[*filters_count - 1].regex = NULL;
+        }
+    }
+
+end:
+    free (expr2);
+    if (variable)
+        free (variable);
+    if (value)
+        free (value);
+
+    return rc;
+}
+
+/*
+ * Builds filters using conditions of a trigger: the filters are the
+ * sub-expressions "${variable} op value" joined with "&&" at top level.
+ * They can be checked in callbacks with a few variables, before building
+ * the hashtables and evaluating the conditions (if one filter is false,
+ * the conditions are false).
+ *
+ * No filter is built if conditions contain a logical "or" at top level.
+ */
+
+void
+trigger_filter_split (const char *conditions,
+                      int *filters_count, struct t_trigger_filter **filters)
+{
+    const char *ptr_cond, *pos;
+
+    if (!filters_count || !filters)
+        return;
+
+    /* remove any existing filter */
+    trigger_filter_free (filters_count, filters);
+
+    if (!conditions || !conditions[0]
+        || trigger_filter_strstr_level (conditions, "||"))
+    {
+        return;
+    }
+
+    ptr_cond = conditions;
+    while (1)
+    {
+        while (ptr_cond[0] == ' ')
+        {
+            ptr_cond++;
+        }
+        pos = trigger_filter_strstr_level (ptr_cond, "&&");
+        if (pos == ptr_cond)
+            goto error;
+        if (trigger_filter_add (ptr_cond,
+                                (pos) ? pos - ptr_cond : (int)strlen (ptr_cond),
+                                filters_count, filters) < 0)
+        {
+            goto error;
+        }
+        if (!pos)
+            break;
+        ptr_cond = pos + 2;
+    }
+
+    return;
+
+error:
+    trigger_filter_free (filters_count, filters);
+}
+
+/*
+ * Checks if a value matches a filter (the comparison is the same as the one
+ * done in evaluation of conditions).
+ *
+ * Returns:
+ *   1: value matches filter
+ *   0: value does not match filter
+ */
+
+int
+trigger_filter_match (struct t_trigger_filter *filter, const char *value)
+{
+    int rc, string_compare, length1, length2;
+    long number1, number2;
+    char *error;
+
+    if (!value)
+        value = "";
+
+    if ((filter->comparison == TRIGGER_FILTER_REGEX_MATCHING)
+        || (filter->comparison == TRIGGER_FILTER_REGEX_NOT_MATCHING))
+    {
+        /* invalid regex: comparison is always false */
+        if (!filter->regex)
+            return 0;
+        rc = (weechat_string_regexec (filter->regex, value,
+                                      0, NULL, 0) == 0) ? 1 : 0;
+        return (filter->comparison == TRIGGER_FILTER_REGEX_MATCHING) ?
+            rc : rc ^ 1;
+    }
+
+    length1 = strlen (value);
+    length2 = strlen (filter->value);
+
+    /* string comparison is forced with empty strings or double quotes */
+    string_compare = 0;
+    if (((length1 == 0) || ((value[0] == '"') && (value[length1 - 1] == '"')))
+        && ((length2 == 0)
+            || ((filter->value[0] == '"')
+                && (filter->value[length2 - 1] == '"'))))
+    {
+        string_compare = 1;
+    }
+
+    number1 = 0;
+    number2 = 0;
+    if (!string_compare)
+    {
+        number1 = strtol (value, &error, 10);
+        if (!error || error[0])
+            string_compare = 1;
+        else
+        {
+            number2 = strtol (filter->value, &error, 10);
+            if (!error || error[0])
+                string_compare = 1;
+        }
+    }
+
+    rc = (string_compare) ?
+        (strcmp (value, filter->value) == 0) : (number1 == number2);
+
+    return (filter->comparison == TRIGGER_FILTER_EQUAL) ? rc : rc ^ 1;
+}
+
+/*
+ * Checks if variable names are built dynamically in a string, for example
+ * with "${eval:...}" or "${tg_${xxx}}".
+ *
+ * Returns:
+ *   1: variable names may be built dynamically
+ *   0: all variable names are static
+ */
+
+int
+trigger_string_has_dynamic_vars (const char *string)
+{
+    const char *pos;
+
+    if (!string || !string[0])
+        return 0;
+
+    if (strstr (string, "${eval:"))
+        return 1;
+
+    pos = strstr (string, "${");
+    while (pos)
+    {
+        if ((pos > string)
+            && (isalnum ((unsigned char)pos[-1]) || (pos[-1] == '_')
+                || (pos[-1] == '.') || (pos[-1] == '{')))
+        {
+            return 1;
+        }
+        pos = strstr (pos + 2, "${");
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if a variable is used in a trigger: in conditions, regex (as
+ * variable or in replacement text) or command.
+ *
+ * Returns:
+ *   1: variable is used
+ *   0: variable is not used
+ */
+
+int
+trigger_var_used (struct t_trigger *trigger, const char *name)
+{
+    char str_var[128];
+    const char *ptr_var;
+    int i;
+
+    snprintf (str_var, sizeof (str_var), "${%s}", name);
+
+    if (strstr (weechat_config_string (trigger->options[TRIGGER_OPTION_CONDITIONS]),
+                str_var)
+        || strstr (weechat_config_string (trigger->options[TRIGGER_OPTION_REGEX]),
+                   str_var)
+        || strstr (weechat_config_string (trigger->options[TRIGGER_OPTION_COMMAND]),
+                   str_var))
+    {
+        return 1;
+    }
+
+    for (i = 0; i < trigger->regex_count; i++)
+    {
+        ptr_var = (trigger->regex[i].variable) ?
+            trigger->regex[i].variable :
+            trigger_hook_regex_default_var[weechat_config_integer (trigger->options[TRIGGER_OPTION_HOOK])];
+        if (ptr_var && (strcmp (ptr_var, name) == 0))
+            return 1;
+        if (trigger->regex[i].replace_escaped
+            && strstr (trigger->regex[i].replace_escaped, str_var))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if at least one variable of a list is used in a trigger.
+ *
+ * Returns:
+ *   1: one variable is used
+ *   0: no variable is used
+ */
+
+int
+trigger_vars_used (struct t_trigger *trigger, char **names)
+{
+    int i;
+
+    for (i = 0; names[i]; i++)
+    {
+        if (trigger_var_used (trigger, names[i]))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Sets the optional variables that must be built in callbacks of a trigger
+ * (variables that are expensive to build and used only in a few triggers).
+ *
+ * Must be called when conditions, regex or command is changed.
+ */
+
+void
+trigger_set_vars_needed (struct t_trigger *trigger)
+{
+    int i;
+
+    if (!trigger)
+        return;
+
+    trigger->vars_needed = 0;
+
+    if (trigger_string_has_dynamic_vars (weechat_config_string (trigger->options[TRIGGER_OPTION_CONDITIONS]))
+        || trigger_string_has_dynamic_vars (weechat_config_string (trigger->options[TRIGGER_OPTION_REGEX]))
+        || trigger_string_has_dynamic_vars (weechat_config_string (trigger->options[TRIGGER_OPTION_COMMAND])))
+    {
+        trigger->vars_needed = TRIGGER_VARS_ALL;
+        return;
+    }
+    for (i = 0; i < trigger->regex_count; i++)
+    {
+        if (trigger_string_has_dynamic_vars (trigger->regex[i].replace_escaped))
+        {
+            trigger->vars_needed = TRIGGER_VARS_ALL;
+            return;
+        }
+    }
+
+    if (trigger_vars_used (trigger, trigger_vars_nocolor))
+        trigger->vars_needed |= TRIGGER_VARS_NOCOLOR;
+    if (trigger_vars_used (trigger, trigger_vars_date))
+        trigger->vars_needed |= TRIGGER_VARS_DATE;
+    if (trigger_vars_used (trigger, trigger_vars_irc))
+        trigger->vars_needed |= TRIGGER_VARS_IRC;
+}
+
 /*
  * Checks if a trigger name is valid: it must not start with "-" and not have
  * any spaces.
@@ -778,6 +1280,9 @@ trigger_alloc (const char *name)
     new_trigger->hook_count_cmd = 0;
     new_trigger->hook_running = 0;
     new_trigger->hook_print_buffers = NULL;
+    new_trigger->filters_count = 0;
+    new_trigger->filters = NULL;
+    new_trigger->vars_needed = TRIGGER_VARS_ALL;
     new_trigger->regex_count = 0;
     new_trigger->regex = NULL;
     new_trigger->commands_count = 0;
@@ -882,6 +1387,11 @@ trigger_new_with_options (const char *name, struct t_config_option **options)
                            &new_trigger->commands_count,
                            &new_trigger->commands);
 
+    trigger_filter_split (weechat_config_string (new_trigger->options[TRIGGER_OPTION_CONDITIONS]),
+                          &new_trigger->filters_count,
+                          &new_trigger->filters);
+    trigger_set_vars_needed (new_trigger);
+
     trigger_hook (new_trigger);
 
     return new_trigger;
@@ -1080,6 +1590,7 @@ trigger_free (struct t_trigger *trigger)
     /* free data */
     trigger_unhook (trigger);
     trigger_regex_free (&trigger->regex_count, &trigger->regex);
+    trigger_filter_free (&trigger->filters_count, &trigger->filters);
     if (trigger->name)
         free (trigger->name);
     for (i = 0; i < TRIGGER_NUM_OPTIONS; i++)
@@ -1154,6 +1665,21 @@ trigger_print_log ()
         weechat_log_printf ("  hook_count_cmd. . . . . : %llu",  ptr_trigger->hook_count_cmd);
         weechat_log_printf ("  hook_running. . . . . . : %d",    ptr_trigger->hook_running);
         weechat_log_printf ("  hook_print_buffers. . . : '%s'",  ptr_trigger->hook_print_buffers);
+        weechat_log_printf ("  filters_count . . . . . : %d",    ptr_trigger->filters_count);
+        weechat_log_printf ("  filters . . . . . . . . : 0x%lx", ptr_trigger->filters);
+        for (i = 0; i < ptr_trigger->filters_count; i++)
+        {
+            weechat_log_printf ("    filters[%03d].variable . . : '%s'",
+                                i, ptr_trigger->filters[i].variable);
+            weechat_log_printf ("    filters[%03d].comparison . : %d ('%s')",
+                                i, ptr_trigger->filters[i].comparison,
+                                trigger_filter_comparison_string[ptr_trigger->filters[i].comparison]);
+            weechat_log_printf ("    filters[%03d].value. . . . : '%s'",
+                                i, ptr_trigger->filters[i].value);
+            weechat_log_printf ("    filters[%03d].regex. . . . : 0x%lx",
+                                i, ptr_trigger->filters[i].regex);
+        }
+        weechat_log_printf ("  vars_needed . . . . . . : %d",    ptr_trigger->vars_needed);
         weechat_log_printf ("  regex_count . . . . . . : %d",    ptr_trigger->regex_count);
         weechat_log_printf ("  regex . . . . . . . . . : 0x%lx", ptr_trigger->regex);
         for (i = 0; i < ptr_trigger->regex_count; i++)
@@ -76,6 +76,23 @@ enum t_trigger_post_action
     TRIGGER_NUM_POST_ACTIONS,
 };
 
+enum t_trigger_filter_comparison
+{
+    TRIGGER_FILTER_REGEX_MATCHING = 0,
+    TRIGGER_FILTER_REGEX_NOT_MATCHING,
+    TRIGGER_FILTER_EQUAL,
+    TRIGGER_FILTER_NOT_EQUAL,
+    /* number of filter comparisons */
+    TRIGGER_NUM_FILTER_COMPARISONS,
+};
+
+/* variables built in callbacks only if they are used by trigger */
+#define TRIGGER_VARS_NOCOLOR (1 << 0)  /* tg_*_nocolor                      */
+#define TRIGGER_VARS_DATE    (1 << 1)  /* tg_date                           */
+#define TRIGGER_VARS_IRC     (1 << 2)  /* parsed IRC message (nick, ...)    */
+#define TRIGGER_VARS_ALL     (TRIGGER_VARS_NOCOLOR | TRIGGER_VARS_DATE | \
+                              TRIGGER_VARS_IRC)
+
 struct t_trigger_regex
 {
     char *variable;                    /* the hashtable key used            */
@@ -85,6 +102,14 @@ struct t_trigger_regex
     char *replace_escaped;             /* repl. text (with chars escaped)   */
 };
 
+struct t_trigger_filter
+{
+    char *variable;                    /* variable compared                 */
+    int comparison;                    /* comparison (==, !=, =~, !~)       */
+    char *value;                       /* value to compare with             */
+    regex_t *regex;                    /* compiled regex (for =~ and !~)    */
+};
+
 struct t_trigger
 {
     /* user choices */
@@ -101,6 +126,13 @@ struct t_trigger
     int hook_running;                  /* 1 if one hook callback is running */
     char *hook_print_buffers;          /* buffers (for hook_print only)     */
 
+    /* filters checked before evaluating conditions (built with conditions) */
+    int filters_count;                 /* number of filters                 */
+    struct t_trigger_filter *filters;  /* array of filters                  */
+
+    /* variables to build in callbacks (mask of TRIGGER_VARS_XXX) */
+    int vars_needed;                   /* optional variables used           */
+
     /* regular expressions with their replacement text */
     int regex_count;                   /* number of regex                   */
     struct t_trigger_regex *regex;     /* array of regex                    */
@@ -125,6 +157,7 @@ extern char *trigger_hook_regex_default_var[];
 extern char *trigger_return_code_string[];
 extern int trigger_return_code[];
 extern char *trigger_post_action_string[];
+extern char *trigger_filter_comparison_string[];
 extern struct t_trigger *triggers;
 extern struct t_trigger *last_trigger;
 extern int triggers_count;
@@ -143,6 +176,14 @@ extern void trigger_regex_free (int *regex_count,
 extern int trigger_regex_split (const char *str_regex,
                                 int *regex_count,
                                 struct t_trigger_regex **regex);
+extern void trigger_filter_free (int *filters_count,
+                                 struct t_trigger_filter **filters);
+extern void trigger_filter_split (const char *conditions,
+                                  int *filters_count,
+                                  struct t_trigger_filter **filters);
+extern int trigger_filter_match (struct t_trigger_filter *filter,
+                                 const char *value);
+extern void trigger_set_vars_needed (struct t_trigger *trigger);
 extern void trigger_split_command (const char *command,
                                    int *commands_count, char ***commands);
 extern void trigger_unhook (struct t_trigger *trigger);
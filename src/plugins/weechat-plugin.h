@@ -46,6 +46,7 @@ struct t_infolist_item;
 struct t_weelist;
 struct t_hashtable;
 struct t_hdata;
+struct t_hdata_field;
 struct timeval;
 
 /*
@@ -58,7 +59,7 @@ struct timeval;
  * please change the date with current one; for a second change at same
  * date, increment the 01, otherwise please keep 01.
  */
-#define WEECHAT_PLUGIN_API_VERSION "20160618-01"
+#define WEECHAT_PLUGIN_API_VERSION "20261015-10"
 
 /* macros for defining plugin infos */
 #define WEECHAT_PLUGIN_NAME(__name)                                     \
@@ -294,6 +295,9 @@ struct t_weechat_plugin
     const char *(*string_regex_flags) (const char *regex, int default_flags,
                                        int *flags);
     int (*string_regcomp) (void *preg, const char *regex, int default_flags);
+    int (*string_regexec) (void *preg, const char *string, int nmatch,
+                           void *pmatch, int eflags);
+    void (*string_regfree) (void *preg);
     int (*string_has_highlight) (const char *string,
                                  const char *highlight_words);
     int (*string_has_highlight_regex) (const char *string, const char *regex);
@@ -306,7 +310,11 @@ struct t_weechat_plugin
     char **(*string_split) (const char *string, const char *separators,
                             int keep_eol, int num_items_max, int *num_items);
     char **(*string_split_shell) (const char *string, int *num_items);
+    char **(*string_split_argv) (const char *string, const char *separators,
+                                 int keep_eol, int num_items_max,
+                                 int *num_items, char ***argv_eol);
     void (*string_free_split) (char **split_string);
+    void (*string_free_split_argv) (char **argv);
     char *(*string_build_with_split_string) (const char **split_string,
                                              const char *separator);
     char **(*string_split_command) (const char *command, char separator);
@@ -324,6 +332,8 @@ struct t_weechat_plugin
                                      struct t_hashtable *pointers,
                                      struct t_hashtable *extra_vars,
                                      struct t_hashtable *options);
+    const char *(*string_shared_get) (const char *string);
+    void (*string_shared_free) (const char *string);
 
     /* UTF-8 strings */
     int (*utf8_has_8bits) (const char *string);
@@ -360,6 +370,9 @@ struct t_weechat_plugin
     void (*util_timeval_add) (struct timeval *tv, long long interval);
     const char *(*util_get_time_string) (const time_t *date);
     int (*util_version_number) (const char *version);
+    void (*latency_message_set) (const struct timeval *date_recv);
+    const struct timeval *(*latency_message_get) ();
+    void (*latency_add) (const char *stage, const struct timeval *date_start);
 
     /* sorted lists */
     struct t_weelist *(*list_new) ();
@@ -550,6 +563,9 @@ struct t_weechat_plugin
                               const char *option_name,
                               const char *value, ...);
     int (*config_write) (struct t_config_file *config_file);
+    void (*config_set_dirty) (struct t_config_file *config_file,
+                              struct t_config_section *section);
+    int (*config_is_dirty) (struct t_config_file *config_file);
     int (*config_read) (struct t_config_file *config_file);
     int (*config_reload) (struct t_config_file *config_file);
     void (*config_option_free) (struct t_config_option *option);
@@ -578,6 +594,9 @@ struct t_weechat_plugin
     const char *(*color) (const char *color_name);
     void (*printf_date_tags) (struct t_gui_buffer *buffer, time_t date,
                               const char *tags, const char *message, ...);
+    void (*print_lines) (struct t_gui_buffer *buffer, time_t date,
+                         const char *tags, const char **lines,
+                         int num_lines);
     void (*printf_y) (struct t_gui_buffer *buffer, int y,
                       const char *message, ...);
     void (*log_printf) (const char *message, ...);
@@ -740,6 +759,8 @@ struct t_weechat_plugin
                                  const char *modifier,
                                  const char *modifier_data,
                                  const char *string);
+    int (*hook_modifier_exists) (struct t_weechat_plugin *plugin,
+                                 const char *modifier);
     struct t_hook *(*hook_info) (struct t_weechat_plugin *plugin,
                                  const char *info_name,
                                  const char *description,
@@ -793,6 +814,10 @@ struct t_weechat_plugin
     void (*unhook) (struct t_hook *hook);
     void (*unhook_all) (struct t_weechat_plugin *plugin,
                         const char *subplugin);
+    int (*async_post) (struct t_weechat_plugin *plugin,
+                       int (*callback)(const void *pointer, void *data),
+                       const void *callback_pointer,
+                       void *callback_data);
 
     /* buffers */
     struct t_gui_buffer *(*buffer_new) (struct t_weechat_plugin *plugin,
@@ -821,6 +846,13 @@ struct t_weechat_plugin
                                       const char *property);
     void *(*buffer_get_pointer) (struct t_gui_buffer *buffer,
                                  const char *property);
+    int (*buffer_search_property) (const char *property);
+    int (*buffer_get_integer_id) (struct t_gui_buffer *buffer,
+                                  int property_id);
+    const char *(*buffer_get_string_id) (struct t_gui_buffer *buffer,
+                                         int property_id);
+    void *(*buffer_get_pointer_id) (struct t_gui_buffer *buffer,
+                                    int property_id);
     void (*buffer_set) (struct t_gui_buffer *buffer, const char *property,
                         const char *value);
     void (*buffer_set_pointer) (struct t_gui_buffer *buffer,
@@ -997,6 +1029,12 @@ struct t_weechat_plugin
                            const char *hdata_name);
     void (*hdata_new_list) (struct t_hdata *hdata, const char *name,
                             void *pointer, int flags);
+    void (*hdata_new_index) (struct t_hdata *hdata, const char *name,
+                             void *(*callback_search)(void *data,
+                                                      struct t_hdata *hdata,
+                                                      void *pointer,
+                                                      const char *value),
+                             void *callback_search_data);
     struct t_hdata *(*hdata_get) (struct t_weechat_plugin *plugin,
                                   const char *hdata_name);
     int (*hdata_get_var_offset) (struct t_hdata *hdata, const char *name);
@@ -1034,6 +1072,35 @@ struct t_weechat_plugin
                           const char *name);
     struct t_hashtable *(*hdata_hashtable) (struct t_hdata *hdata,
                                             void *pointer, const char *name);
+    int (*hdata_fetch) (struct t_hdata *hdata, void *pointer,
+                        const char *fields, int count,
+                        void (*callback)(void *data,
+                                         struct t_hdata *hdata,
+                                         void *pointer,
+                                         struct t_hashtable *record),
+                        void *callback_data);
+    struct t_hdata_field *(*hdata_field_new) (struct t_hdata *hdata,
+                                              const char *name);
+    int (*hdata_field_type) (struct t_hdata_field *field);
+    int (*hdata_field_array_size) (struct t_hdata_field *field,
+                                   void *pointer);
+    char (*hdata_field_char) (struct t_hdata_field *field, void *pointer,
+                              int index);
+    int (*hdata_field_integer) (struct t_hdata_field *field, void *pointer,
+                                int index);
+    long (*hdata_field_long) (struct t_hdata_field *field, void *pointer,
+                              int index);
+    const char *(*hdata_field_string) (struct t_hdata_field *field,
+                                       void *pointer, int index);
+    void *(*hdata_field_pointer) (struct t_hdata_field *field, void *pointer,
+                                  int index);
+    time_t (*hdata_field_time) (struct t_hdata_field *field, void *pointer,
+                                int index);
+    struct t_hashtable *(*hdata_field_hashtable) (struct t_hdata_field *field,
+                                                  void *pointer, int index);
+    int (*hdata_field_read) (struct t_hdata_field **fields, int num_fields,
+                             void *pointer, void **values);
+    void (*hdata_field_free) (struct t_hdata_field *field);
     int (*hdata_set) (struct t_hdata *hdata, void *pointer, const char *name,
                       const char *value);
     int (*hdata_update) (struct t_hdata *hdata, void *pointer,
@@ -1136,6 +1203,12 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                          __flags)
 #define weechat_string_regcomp(__preg, __regex, __default_flags)        \
     (weechat_plugin->string_regcomp)(__preg, __regex, __default_flags)
+#define weechat_string_regexec(__preg, __string, __nmatch, __pmatch,    \
+                               __eflags)                                \
+    (weechat_plugin->string_regexec)(__preg, __string, __nmatch,        \
+                                     __pmatch, __eflags)
+#define weechat_string_regfree(__preg)                                  \
+    (weechat_plugin->string_regfree)(__preg)
 #define weechat_string_has_highlight(__string, __highlight_words)       \
     (weechat_plugin->string_has_highlight)(__string, __highlight_words)
 #define weechat_string_has_highlight_regex(__string, __regex)           \
@@ -1154,8 +1227,14 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                    __max, __num_items)
 #define weechat_string_split_shell(__string, __num_items)               \
     (weechat_plugin->string_split_shell)(__string, __num_items)
+#define weechat_string_split_argv(__string, __separator, __eol,        \
+                                  __max, __num_items, __argv_eol)       \
+    (weechat_plugin->string_split_argv)(__string, __separator, __eol,   \
+                                        __max, __num_items, __argv_eol)
 #define weechat_string_free_split(__split_string)                       \
     (weechat_plugin->string_free_split)(__split_string)
+#define weechat_string_free_split_argv(__argv)                          \
+    (weechat_plugin->string_free_split_argv)(__argv)
 #define weechat_string_build_with_split_string(__split_string,          \
                                                __separator)             \
     (weechat_plugin->string_build_with_split_string)(__split_string,    \
@@ -1185,6 +1264,10 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                        __extra_vars, __options)         \
     (weechat_plugin->string_eval_expression)(__expr, __pointers,        \
                                              __extra_vars, __options)
+#define weechat_string_shared_get(__string)                             \
+    (weechat_plugin->string_shared_get)(__string)
+#define weechat_string_shared_free(__string)                            \
+    (weechat_plugin->string_shared_free)(__string)
 
 /* UTF-8 strings */
 #define weechat_utf8_has_8bits(__string)                                \
@@ -1247,6 +1330,12 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     (weechat_plugin->util_get_time_string)(__date)
 #define weechat_util_version_number(__version)                          \
     (weechat_plugin->util_version_number)(__version)
+#define weechat_latency_message_set(__date_recv)                        \
+    (weechat_plugin->latency_message_set)(__date_recv)
+#define weechat_latency_message_get()                                   \
+    (weechat_plugin->latency_message_get)()
+#define weechat_latency_add(__stage, __date_start)                      \
+    (weechat_plugin->latency_add)(__stage, __date_start)
 
 /* sorted list */
 #define weechat_list_new()                                              \
@@ -1455,6 +1544,10 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     (weechat_plugin->config_write_line)(__config, __option, ##__value)
 #define weechat_config_write(__config)                                  \
     (weechat_plugin->config_write)(__config)
+#define weechat_config_set_dirty(__config, __section)                  \
+    (weechat_plugin->config_set_dirty)(__config, __section)
+#define weechat_config_is_dirty(__config)                               \
+    (weechat_plugin->config_is_dirty)(__config)
 #define weechat_config_read(__config)                                   \
     (weechat_plugin->config_read)(__config)
 #define weechat_config_reload(__config)                                 \
@@ -1500,6 +1593,10 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                  __argz...)                             \
     (weechat_plugin->printf_date_tags)(__buffer, __date, __tags,        \
                                        __message, ##__argz)
+#define weechat_print_lines(__buffer, __date, __tags, __lines,          \
+                            __num_lines)                                \
+    (weechat_plugin->print_lines)(__buffer, __date, __tags, __lines,    \
+                                  __num_lines)
 #define weechat_printf_y(__buffer, __y, __message, __argz...)           \
     (weechat_plugin->printf_y)(__buffer, __y, __message, ##__argz)
 #define weechat_log_printf(__message, __argz...)                        \
@@ -1593,6 +1690,8 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                    __string)                            \
     (weechat_plugin->hook_modifier_exec)(weechat_plugin, __modifier,    \
                                          __modifier_data, __string)
+#define weechat_hook_modifier_exists(__modifier)                        \
+    (weechat_plugin->hook_modifier_exists)(weechat_plugin, __modifier)
 #define weechat_hook_info(__info_name, __description,                   \
                           __args_description, __callback, __pointer,    \
                           __data)                                       \
@@ -1634,6 +1733,9 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     (weechat_plugin->unhook)( __hook)
 #define weechat_unhook_all(__subplugin)                                 \
     (weechat_plugin->unhook_all)(weechat_plugin, __subplugin)
+#define weechat_async_post(__callback, __pointer, __data)               \
+    (weechat_plugin->async_post)(weechat_plugin, __callback, __pointer, \
+                                 __data)
 
 /* buffers */
 #define weechat_buffer_new(__name, __input_callback,                    \
@@ -1669,6 +1771,14 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     (weechat_plugin->buffer_get_string)(__buffer, __property)
 #define weechat_buffer_get_pointer(__buffer, __property)                \
     (weechat_plugin->buffer_get_pointer)(__buffer, __property)
+#define weechat_buffer_search_property(__property)                      \
+    (weechat_plugin->buffer_search_property)(__property)
+#define weechat_buffer_get_integer_id(__buffer, __property_id)          \
+    (weechat_plugin->buffer_get_integer_id)(__buffer, __property_id)
+#define weechat_buffer_get_string_id(__buffer, __property_id)           \
+    (weechat_plugin->buffer_get_string_id)(__buffer, __property_id)
+#define weechat_buffer_get_pointer_id(__buffer, __property_id)          \
+    (weechat_plugin->buffer_get_pointer_id)(__buffer, __property_id)
 #define weechat_buffer_set(__buffer, __property, __value)               \
     (weechat_plugin->buffer_set)(__buffer, __property, __value)
 #define weechat_buffer_set_pointer(__buffer, __property, __pointer)     \
@@ -1873,6 +1983,11 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                      __flags)
 #define WEECHAT_HDATA_LIST(__name, __flags)                             \
     weechat_hdata_new_list (hdata, #__name, &(__name), __flags);
+#define weechat_hdata_new_index(__hdata, __name, __callback_search,   \
+                                __callback_search_data)                 \
+    (weechat_plugin->hdata_new_index)(__hdata, __name,                  \
+                                      __callback_search,                \
+                                      __callback_search_data)
 #define weechat_hdata_get(__hdata_name)                                 \
     (weechat_plugin->hdata_get)(weechat_plugin, __hdata_name)
 #define weechat_hdata_get_var_offset(__hdata, __name)                   \
@@ -1919,6 +2034,36 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     (weechat_plugin->hdata_time)(__hdata, __pointer, __name)
 #define weechat_hdata_hashtable(__hdata, __pointer, __name)             \
     (weechat_plugin->hdata_hashtable)(__hdata, __pointer, __name)
+#define weechat_hdata_fetch(__hdata, __pointer, __fields, __count,    \
+                            __callback, __callback_data)                \
+    (weechat_plugin->hdata_fetch)(__hdata, __pointer, __fields,         \
+                                  __count, __callback, __callback_data)
+#define weechat_hdata_field_new(__hdata, __name)                        \
+    (weechat_plugin->hdata_field_new)(__hdata, __name)
+#define weechat_hdata_field_type(__field)                               \
+    (weechat_plugin->hdata_field_type)(__field)
+#define weechat_hdata_field_array_size(__field, __pointer)              \
+    (weechat_plugin->hdata_field_array_size)(__field, __pointer)
+#define weechat_hdata_field_char(__field, __pointer, __index)           \
+    (weechat_plugin->hdata_field_char)(__field, __pointer, __index)
+#define weechat_hdata_field_integer(__field, __pointer, __index)        \
+    (weechat_plugin->hdata_field_integer)(__field, __pointer, __index)
+#define weechat_hdata_field_long(__field, __pointer, __index)           \
+    (weechat_plugin->hdata_field_long)(__field, __pointer, __index)
+#define weechat_hdata_field_string(__field, __pointer, __index)         \
+    (weechat_plugin->hdata_field_string)(__field, __pointer, __index)
+#define weechat_hdata_field_pointer(__field, __pointer, __index)        \
+    (weechat_plugin->hdata_field_pointer)(__field, __pointer, __index)
+#define weechat_hdata_field_time(__field, __pointer, __index)           \
+    (weechat_plugin->hdata_field_time)(__field, __pointer, __index)
+#define weechat_hdata_field_hashtable(__field, __pointer, __index)      \
+    (weechat_plugin->hdata_field_hashtable)(__field, __pointer, __index)
+#define weechat_hdata_field_read(__fields, __num_fields, __pointer,     \
+                                 __values)                              \
+    (weechat_plugin->hdata_field_read)(__fields, __num_fields,          \
+                                       __pointer, __values)
+#define weechat_hdata_field_free(__field)                               \
+    (weechat_plugin->hdata_field_free)(__field)
 #define weechat_hdata_set(__hdata, __pointer, __name, __value)          \
     (weechat_plugin->hdata_set)(__hdata, __pointer, __name, __value)
 #define weechat_hdata_update(__hdata, __pointer, __hashtable)           \
@@ -47,7 +47,7 @@ xfer_buffer_refresh (const char *hotlist)
     char str_ip[128], str_hash[128];
     char *progress_bar, *str_pos, *str_total, *str_bytes_per_sec;
     int i, length, line, progress_bar_size, num_bars;
-    unsigned long long pos, pct_complete;
+    unsigned long long pos, total, pct_complete;
     struct tm *date_tmp;
 
     if (xfer_buffer)
@@ -166,15 +166,27 @@ xfer_buffer_refresh (const char *hotlist)
             }
             else
             {
+                /* position (progress of hash while resuming file) */
+                if ((ptr_xfer->status == XFER_STATUS_HASHING)
+                    && (ptr_xfer->start_resume > 0))
+                {
+                    total = ptr_xfer->start_resume;
+                    pos = (ptr_xfer->hash_pos <= total) ? ptr_xfer->hash_pos : total;
+                }
+                else
+                {
+                    total = ptr_xfer->size;
+                    pos = (ptr_xfer->pos <= total) ? ptr_xfer->pos : total;
+                }
+
                 /* build progress bar */
-                pos = (ptr_xfer->pos <= ptr_xfer->size) ? ptr_xfer->pos : ptr_xfer->size;
                 progress_bar = NULL;
                 progress_bar_size = weechat_config_integer (xfer_config_look_progress_bar_size);
                 if (progress_bar_size > 0)
                 {
                     progress_bar = malloc (1 + progress_bar_size + 1 + 1 + 1);
                     strcpy (progress_bar, "[");
-                    if (ptr_xfer->size == 0)
+                    if (total == 0)
                     {
                         if (ptr_xfer->status == XFER_STATUS_DONE)
                             num_bars = progress_bar_size;
@@ -182,7 +194,7 @@ xfer_buffer_refresh (const char *hotlist)
                             num_bars = 0;
                     }
                     else
-                        num_bars = (int)(((float)(pos)/(float)(ptr_xfer->size)) * (float)progress_bar_size);
+                        num_bars = (int)(((float)(pos)/(float)(total)) * (float)progress_bar_size);
                     for (i = 0; i < num_bars - 1; i++)
                     {
                         strcat (progress_bar, "=");
@@ -197,7 +209,7 @@ xfer_buffer_refresh (const char *hotlist)
                 }
 
                 /* computes percentage */
-                if (ptr_xfer->size == 0)
+                if (total == 0)
                 {
                     if (ptr_xfer->status == XFER_STATUS_DONE)
                         pct_complete = 100;
@@ -205,11 +217,11 @@ xfer_buffer_refresh (const char *hotlist)
                         pct_complete = 0;
                 }
                 else
-                    pct_complete = (unsigned long long)(((float)(pos)/(float)(ptr_xfer->size)) * 100);
+                    pct_complete = (unsigned long long)(((float)(pos)/(float)(total)) * 100);
 
                 /* position, total and bytes per second */
                 str_pos = weechat_string_format_size (pos);
-                str_total = weechat_string_format_size (ptr_xfer->size);
+                str_total = weechat_string_format_size (total);
                 str_bytes_per_sec = weechat_string_format_size (ptr_xfer->bytes_per_sec);
 
                 /* ETA */
@@ -18,6 +18,10 @@
  * You should have received a copy of the GNU General Public License
  * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -26,33 +30,90 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 #include <poll.h>
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <time.h>
 #include <netdb.h>
 #include <errno.h>
+#include <pthread.h>
 #include <gcrypt.h>
 
 #include "../weechat-plugin.h"
 #include "xfer.h"
-#include "xfer-config.h"
+#include "xfer-dcc.h"
 #include "xfer-file.h"
 #include "xfer-network.h"
 
 
 /*
- * Child process for sending file with DCC protocol.
+ * Sends a block of file to receiver, using sendfile() if available (data is
+ * copied from file to socket by the kernel), otherwise read() + send().
+ *
+ * Returns number of bytes sent, -1 if error (errno is set), -2 if end of
+ * file has been reached (file truncated?).
+ */
+
+int
+xfer_dcc_send_file_block (struct t_xfer *xfer, int size, int *use_sendfile)
+{
+    char buffer[XFER_BLOCKSIZE_MAX];
+    int num_read, num_sent;
+#ifdef HAVE_SYS_SENDFILE_H
+    off_t offset;
+
+    if (*use_sendfile)
+    {
+        offset = (off_t)xfer->pos;
+        num_sent = sendfile (xfer->sock, xfer->file, &offset, size);
+        if (num_sent == 0)
+            return -2;
+        if ((num_sent > 0)
+            || ((errno != EINVAL) && (errno != ENOSYS)
+                && (errno != EOPNOTSUPP)))
+        {
+            return num_sent;
+        }
+        /* sendfile not supported for this file/socket: use read/send */
+        *use_sendfile = 0;
+    }
+#else
+    /* make C compiler happy */
+    (void) use_sendfile;
+#endif /* HAVE_SYS_SENDFILE_H */
+
+    if (size > XFER_BLOCKSIZE_MAX)
+        size = XFER_BLOCKSIZE_MAX;
+    if (lseek (xfer->file, xfer->pos, SEEK_SET) == (off_t)-1)
+        return -2;
+    num_read = read (xfer->file, buffer, size);
+    if (num_read < 1)
+        return -2;
+    num_sent = send (xfer->sock, buffer, num_read, 0);
+
+    return num_sent;
+}
+
+/*
+ * Thread for sending file with DCC protocol.
+ *
+ * The speed limit is applied with a token bucket: tokens (bytes allowed) are
+ * added according to time elapsed, and a block is sent only if there are
+ * enough tokens; otherwise the thread waits for the time needed to get them.
  */
 
 void
 xfer_dcc_send_file_child (struct t_xfer *xfer)
 {
-    int num_read, num_sent, blocksize;
-    static char buffer[XFER_BLOCKSIZE_MAX];
+    int num_read, num_sent, blocksize, size, use_sendfile, wait_ms, sndbuf;
     uint32_t ack;
-    time_t last_sent, new_time, last_second, sent_ok;
-    unsigned long long sent_last_second;
+    time_t last_sent, new_time, sent_ok;
+    struct timeval tv_last_refill, tv_now;
+    double speed_limit, tokens, tokens_max;
 
     /* empty file? just return immediately */
     if (xfer->pos >= xfer->size)
@@ -63,18 +124,36 @@ xfer_dcc_send_file_child (struct t_xfer *xfer)
     }
 
     blocksize = xfer->blocksize;
-    if (weechat_config_integer (xfer_config_network_speed_limit) > 0)
+    speed_limit = (double)xfer->speed_limit * 1024;
+    if (speed_limit > 0)
+    {
+        if (blocksize > speed_limit)
+            blocksize = speed_limit;
+    }
+
+    /* bigger socket buffer, so that many blocks are sent without waiting */
+    if (xfer->fast_send)
     {
-        if (blocksize > weechat_config_integer (xfer_config_network_speed_limit) * 1024)
-            blocksize = weechat_config_integer (xfer_config_network_speed_limit) * 1024;
+        sndbuf = XFER_DCC_SEND_SOCKET_BUFFER;
+        setsockopt (xfer->sock, SOL_SOCKET, SO_SNDBUF,
+                    (void *)&sndbuf, sizeof (sndbuf));
     }
 
+    use_sendfile = 1;
+
+    /* token bucket for speed limit (it can contain at most 1/4 second) */
+    tokens_max = (speed_limit / 4 > blocksize) ? speed_limit / 4 : blocksize;
+    tokens = blocksize;
+    gettimeofday (&tv_last_refill, NULL);
+
     last_sent = time (NULL);
-    last_second = time (NULL);
     sent_ok = 0;
-    sent_last_second = 0;
     while (1)
     {
+        /* stop asked by main thread? */
+        if (xfer_network_child_stopped (xfer))
+            return;
+
         /* read DCC ACK (sent by receiver) */
         if (xfer->pos > xfer->ack)
         {
@@ -112,65 +191,80 @@ xfer_dcc_send_file_child (struct t_xfer *xfer)
         if ((xfer->pos < xfer->size) &&
              (xfer->fast_send || (xfer->pos <= xfer->ack)))
         {
-            if ((weechat_config_integer (xfer_config_network_speed_limit) > 0)
-                && (sent_last_second >= (unsigned long long)weechat_config_integer (xfer_config_network_speed_limit) * 1024))
+            size = blocksize;
+            if (speed_limit > 0)
+            {
+                /* add tokens for time elapsed since last refill */
+                gettimeofday (&tv_now, NULL);
+                tokens += speed_limit
+                    * weechat_util_timeval_diff (&tv_last_refill, &tv_now)
+                    / 1000000;
+                if (tokens > tokens_max)
+                    tokens = tokens_max;
+                tv_last_refill = tv_now;
+                if (tokens < blocksize)
+                {
+                    /*
+                     * we're sending too fast (according to speed limit set
+                     * by user): wait until there are enough tokens (or an
+                     * ACK is received)
+                     */
+                    wait_ms = (int)(((blocksize - tokens) * 1000)
+                                    / speed_limit) + 1;
+                    xfer_network_child_wait (xfer, POLLIN,
+                                             (wait_ms > 100) ? 100 : wait_ms);
+                    continue;
+                }
+            }
+            if ((unsigned long long)size > xfer->size - xfer->pos)
+                size = xfer->size - xfer->pos;
+            num_sent = xfer_dcc_send_file_block (xfer, size, &use_sendfile);
+            if (num_sent == -2)
             {
-                /* we're sending too fast (according to speed limit set by user) */
-                usleep (100);
+                xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
+                                         XFER_ERROR_READ_LOCAL);
+                return;
             }
-            else
+            if (num_sent < 0)
             {
-                lseek (xfer->file, xfer->pos, SEEK_SET);
-                num_read = read (xfer->file, buffer, blocksize);
-                if (num_read < 1)
+                /*
+                 * socket is temporarily not available (receiver can't
+                 * receive amount of data we sent ?!): wait until socket is
+                 * writable again
+                 */
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                    xfer_network_child_wait (xfer, POLLOUT | POLLIN, 100);
+                else
                 {
                     xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                             XFER_ERROR_READ_LOCAL);
+                                             XFER_ERROR_SEND_BLOCK);
                     return;
                 }
-                num_sent = send (xfer->sock, buffer, num_read, 0);
-                if (num_sent < 0)
-                {
-                    /*
-                     * socket is temporarily not available (receiver can't
-                     * receive amount of data we sent ?!)
-                     */
-                    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        usleep (1000);
-                    else
-                    {
-                        xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                                 XFER_ERROR_SEND_BLOCK);
-                        return;
-                    }
-                }
-                if (num_sent > 0)
+            }
+            if (num_sent > 0)
+            {
+                xfer->pos += (unsigned long long) num_sent;
+                tokens -= num_sent;
+                new_time = time (NULL);
+                if ((last_sent != new_time)
+                    || ((sent_ok == 0) && (xfer->pos >= xfer->size)))
                 {
-                    xfer->pos += (unsigned long long) num_sent;
-                    sent_last_second += (unsigned long long) num_sent;
-                    new_time = time (NULL);
-                    if ((last_sent != new_time)
-                        || ((sent_ok == 0) && (xfer->pos >= xfer->size)))
-                    {
-                        last_sent = new_time;
-                        xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
-                                                 XFER_NO_ERROR);
-                        if (xfer->pos >= xfer->size)
-                            sent_ok = new_time;
-                    }
+                    last_sent = new_time;
+                    xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
+                                             XFER_NO_ERROR);
+                    if (xfer->pos >= xfer->size)
+                        sent_ok = new_time;
                 }
             }
         }
         else
-            usleep (1000);
-
-        new_time = time (NULL);
-        if (new_time > last_second)
         {
-            last_second = new_time;
-            sent_last_second = 0;
+            /* wait for ACK */
+            xfer_network_child_wait (xfer, POLLIN, 100);
         }
 
+        new_time = time (NULL);
+
         /*
          * if send if OK since 2 seconds or more, and that no ACK was received,
          * then consider it's OK
@@ -228,30 +322,53 @@ xfer_dcc_recv_file_send_ack (struct t_xfer *xfer)
     return 2;
 }
 
+/*
+ * Closes file hashed (called when hash ends or if thread is canceled).
+ */
+
+void
+xfer_dcc_resume_hash_cleanup (void *arg)
+{
+    int *fd;
+
+    fd = (int *)arg;
+
+    if (*fd > 0)
+    {
+        while (close (*fd) < 0)
+        {
+            if (errno != EINTR)
+                break;
+        }
+        *fd = 0;
+    }
+}
+
 /*
  * Reads a resumed xfer from disk for hashing.
  *
+ * Progress (number of bytes hashed) is reported to main thread every second,
+ * so that it is displayed in xfer buffer.
+ *
  * Returns:
  *   1: OK
  *   0: error
+ *  -1: stop asked by main thread
  */
 
 int
 xfer_dcc_resume_hash (struct t_xfer *xfer)
 {
-    char *buf;
+    char buf[XFER_DCC_RESUME_HASH_BUFFER];
     unsigned long long total_read;
-    ssize_t length_buf, to_read, num_read;
+    ssize_t to_read, num_read;
     int ret, fd;
+    time_t last_sent, new_time;
 
     total_read = 0;
     ret = 1;
     fd = 0;
-
-    length_buf = 1024 * 1024;
-    buf = malloc (length_buf);
-    if (!buf)
-        return 0;
+    last_sent = time (NULL);
 
     while (fd <= 0)
     {
@@ -266,53 +383,65 @@ xfer_dcc_resume_hash (struct t_xfer *xfer)
         }
     }
 
+    pthread_cleanup_push (&xfer_dcc_resume_hash_cleanup, &fd);
+
     if (fd)
     {
+#ifdef POSIX_FADV_SEQUENTIAL
+        /* file is read only once, from start to end */
+        posix_fadvise (fd, 0, xfer->start_resume, POSIX_FADV_SEQUENTIAL);
+#endif /* POSIX_FADV_SEQUENTIAL */
         while (total_read < xfer->start_resume)
         {
+            if (xfer_network_child_stopped (xfer))
+            {
+                ret = -1;
+                break;
+            }
             to_read = xfer->start_resume - total_read;
-            if (to_read > length_buf)
-                num_read = read (fd, buf, length_buf);
+            if (to_read > (ssize_t)sizeof (buf))
+                num_read = read (fd, buf, sizeof (buf));
             else
                 num_read = read (fd, buf, to_read);
             if (num_read > 0)
             {
                 gcry_md_write (*xfer->hash_handle, buf, num_read);
                 total_read += num_read;
+                new_time = time (NULL);
+                if (last_sent != new_time)
+                {
+                    last_sent = new_time;
+                    xfer->hash_pos = total_read;
+                    xfer_network_write_pipe (xfer, XFER_STATUS_HASHING,
+                                             XFER_NO_ERROR);
+                }
             }
-            else if (num_read < 0)
+            else
             {
-                if (errno == EINTR)
+                if ((num_read < 0) && (errno == EINTR))
                     continue;
                 ret = 0;
                 break;
             }
         }
-
-        while (close (fd) < 0)
-        {
-            if (errno != EINTR)
-                break;
-        }
     }
 
-    free (buf);
+    pthread_cleanup_pop (1);
 
     return ret;
 }
 
 /*
- * Child process for receiving file with DCC protocol.
+ * Thread for receiving file with DCC protocol.
  */
 
 void
 xfer_dcc_recv_file_child (struct t_xfer *xfer)
 {
-    int flags, num_read, ack_enabled, ready;
-    static char buffer[XFER_BLOCKSIZE_MAX];
+    int flags, num_read, ack_enabled, rc;
+    char buffer[XFER_BLOCKSIZE_MAX];
     time_t last_sent, new_time;
     unsigned long long pos_last_ack;
-    struct pollfd poll_fd;
     ssize_t written, total_written;
     unsigned char *bin_hash;
     char hash[9];
@@ -322,10 +451,12 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
     {
         xfer_network_write_pipe (xfer, XFER_STATUS_HASHING,
                                  XFER_NO_ERROR);
-        if (!xfer_dcc_resume_hash (xfer))
+        rc = xfer_dcc_resume_hash (xfer);
+        if (rc < 0)
+            return;
+        if (rc == 0)
         {
-            gcry_md_close (*xfer->hash_handle);
-            free (xfer->hash_handle);
+            /* hash handle is freed by main thread, with the xfer */
             xfer->hash_handle = NULL;
             xfer_network_write_pipe (xfer, XFER_STATUS_HASHING,
                                      XFER_ERROR_HASH_RESUME_ERROR);
@@ -334,18 +465,10 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
                                  XFER_NO_ERROR);
     }
 
-    /* first connect to sender (blocking) */
-    xfer->sock = weechat_network_connect_to (xfer->proxy,
-                                             xfer->remote_address,
-                                             xfer->remote_address_length);
-    if (xfer->sock == -1)
-    {
-        xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                 XFER_ERROR_CONNECT_SENDER);
-        return;
-    }
-
-    /* connection is OK, change DCC status (inform parent process) */
+    /*
+     * socket is connected to sender by main thread (before the thread is
+     * started): change DCC status (inform main thread)
+     */
     xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
                              XFER_NO_ERROR);
 
@@ -362,11 +485,10 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
     while (1)
     {
         /* wait until there is something to read on socket (or error) */
-        poll_fd.fd = xfer->sock;
-        poll_fd.events = POLLIN;
-        poll_fd.revents = 0;
-        ready = poll (&poll_fd, 1, -1);
-        if (ready <= 0)
+        rc = xfer_network_child_wait (xfer, POLLIN, -1);
+        if (rc < 0)
+            return;
+        if (rc == 0)
         {
             if ((errno == EINTR) || (errno == EAGAIN))
                 continue;
@@ -480,7 +602,7 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
                     return;
                 }
 
-                /* update status of DCC (parent process) */
+                /* update status of DCC (main thread) */
                 new_time = time (NULL);
                 if (last_sent != new_time)
                 {
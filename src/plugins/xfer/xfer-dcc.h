@@ -20,6 +20,12 @@
 #ifndef WEECHAT_XFER_DCC_H
 #define WEECHAT_XFER_DCC_H 1
 
+/* size of socket send buffer when sending a file without waiting ACK */
+#define XFER_DCC_SEND_SOCKET_BUFFER (1024 * 1024)
+
+/* size of buffer used to read file for hash of resumed file */
+#define XFER_DCC_RESUME_HASH_BUFFER (64 * 1024)
+
 extern void xfer_dcc_send_file_child (struct t_xfer *xfer);
 extern void xfer_dcc_recv_file_child (struct t_xfer *xfer);
 
@@ -26,12 +26,12 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <signal.h>
 #include <time.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
 
 #include "../weechat-plugin.h"
 #include "xfer.h"
@@ -40,10 +40,12 @@
 #include "xfer-config.h"
 #include "xfer-dcc.h"
 #include "xfer-file.h"
+#include "xfer-network.h"
 
 
 /*
- * Creates pipe for communication with child process.
+ * Creates pipes for communication with thread sending/receiving file: one
+ * to receive status from thread, one to ask the thread to stop.
  *
  * Returns:
  *   1: OK
@@ -53,7 +55,7 @@
 int
 xfer_network_create_pipe (struct t_xfer *xfer)
 {
-    int child_pipe[2];
+    int child_pipe[2], stop_pipe[2];
 
     if (pipe (child_pipe) < 0)
     {
@@ -69,6 +71,20 @@ xfer_network_create_pipe (struct t_xfer *xfer)
     xfer->child_read = child_pipe[0];
     xfer->child_write = child_pipe[1];
 
+    if (pipe (stop_pipe) < 0)
+    {
+        weechat_printf (NULL,
+                        _("%s%s: unable to create pipe: error %d %s"),
+                        weechat_prefix ("error"), XFER_PLUGIN_NAME,
+                        errno, strerror (errno));
+        xfer_close (xfer, XFER_STATUS_FAILED);
+        xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+        return 0;
+    }
+
+    xfer->child_stop_read = stop_pipe[0];
+    xfer->child_stop_write = stop_pipe[1];
+
     return 1;
 }
 
@@ -82,14 +98,71 @@ xfer_network_write_pipe (struct t_xfer *xfer, int status, int error)
     char buffer[1 + 1 + 32 + 1];   /* status + error + pos + \0 */
     int num_written;
 
+    /* while hashing (resume of file), the number of bytes hashed is sent */
     snprintf (buffer, sizeof (buffer), "%c%c%032llu",
-              status + '0', error + '0', xfer->pos);
+              status + '0', error + '0',
+              (status == XFER_STATUS_HASHING) ? xfer->hash_pos : xfer->pos);
     num_written = write (xfer->child_write, buffer, sizeof (buffer));
     (void) num_written;
 }
 
 /*
- * Reads data from child via pipe.
+ * Checks if the main thread has asked the thread sending/receiving file to
+ * stop (called by the thread).
+ *
+ * Returns:
+ *   1: thread must stop
+ *   0: thread can go on
+ */
+
+int
+xfer_network_child_stopped (struct t_xfer *xfer)
+{
+    struct pollfd poll_fd;
+
+    poll_fd.fd = xfer->child_stop_read;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+
+    return (poll (&poll_fd, 1, 0) > 0) ? 1 : 0;
+}
+
+/*
+ * Waits for events on socket of xfer, at most "timeout" in milliseconds
+ * (-1 = no timeout), or until the main thread asks the thread to stop
+ * (called by the thread).
+ *
+ * Returns:
+ *   1: socket is ready
+ *   0: timeout or error (errno is set)
+ *  -1: thread must stop
+ */
+
+int
+xfer_network_child_wait (struct t_xfer *xfer, short events, int timeout)
+{
+    struct pollfd poll_fds[2];
+    int ready;
+
+    poll_fds[0].fd = xfer->sock;
+    poll_fds[0].events = events;
+    poll_fds[0].revents = 0;
+    poll_fds[1].fd = xfer->child_stop_read;
+    poll_fds[1].events = POLLIN;
+    poll_fds[1].revents = 0;
+
+    ready = poll (poll_fds, 2, timeout);
+    if (ready <= 0)
+        return 0;
+
+    if (poll_fds[1].revents)
+        return -1;
+
+    return 1;
+}
+
+/*
+ * Reads data from thread sending/receiving file via pipe.
  */
 
 int
@@ -108,9 +181,16 @@ xfer_network_child_read_cb (const void *pointer, void *data, int fd)
     num_read = read (xfer->child_read, bufpipe, sizeof (bufpipe));
     if (num_read > 0)
     {
-        sscanf (bufpipe + 2, "%llu", &xfer->pos);
         xfer->last_activity = time (NULL);
-        xfer_file_calculate_speed (xfer, 0);
+        if (bufpipe[0] - '0' == XFER_STATUS_HASHING)
+        {
+            sscanf (bufpipe + 2, "%llu", &xfer->hash_pos);
+        }
+        else
+        {
+            sscanf (bufpipe + 2, "%llu", &xfer->pos);
+            xfer_file_calculate_speed (xfer, 0);
+        }
 
         /* read error code */
         switch (bufpipe[1] - '0')
@@ -177,7 +257,7 @@ xfer_network_child_read_cb (const void *pointer, void *data, int fd)
             case XFER_STATUS_ACTIVE:
                 if (xfer->status == XFER_STATUS_CONNECTING)
                 {
-                    /* connection was successful by child, init transfer times */
+                    /* connection was successful by thread, init transfer times */
                     xfer->status = XFER_STATUS_ACTIVE;
                     xfer->start_transfer = time (NULL);
                     xfer->last_check_time = time (NULL);
@@ -210,48 +290,111 @@ xfer_network_child_read_cb (const void *pointer, void *data, int fd)
 }
 
 /*
- * Forks process for sending file.
+ * Thread sending/receiving file.
+ *
+ * The thread uses its own copy of xfer (like a forked process would do):
+ * status and position are reported to main thread via the pipe. The socket
+ * is connected (or accepted) by the main thread, which also closes it; the
+ * WeeChat API and options are never used by the thread (values needed are
+ * read before the thread is started).
  */
 
-void
-xfer_network_send_file_fork (struct t_xfer *xfer)
+void *
+xfer_network_file_thread (void *arg)
+{
+    struct t_xfer *xfer;
+
+    xfer = (struct t_xfer *)arg;
+
+    switch (xfer->protocol)
+    {
+        case XFER_NO_PROTOCOL:
+            break;
+        case XFER_PROTOCOL_DCC:
+            if (XFER_IS_RECV(xfer->type))
+                xfer_dcc_recv_file_child (xfer);
+            else
+                xfer_dcc_send_file_child (xfer);
+            break;
+        case XFER_NUM_PROTOCOLS:
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Creates thread for sending/receiving file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (xfer is closed)
+ */
+
+int
+xfer_network_create_thread (struct t_xfer *xfer)
 {
-    pid_t pid;
+    pthread_attr_t attr;
     int rc;
 
+    /* options used by the thread are read now (not thread-safe) */
+    xfer->speed_limit = weechat_config_integer (xfer_config_network_speed_limit);
+
+    xfer->child_xfer = malloc (sizeof (*xfer->child_xfer));
+    if (!xfer->child_xfer)
+    {
+        rc = ENOMEM;
+    }
+    else
+    {
+        memcpy (xfer->child_xfer, xfer, sizeof (*xfer->child_xfer));
+        pthread_attr_init (&attr);
+        pthread_attr_setstacksize (&attr, XFER_NETWORK_THREAD_STACK_SIZE);
+        rc = pthread_create (&xfer->child_thread, &attr,
+                             &xfer_network_file_thread, xfer->child_xfer);
+        pthread_attr_destroy (&attr);
+    }
+
+    if (rc != 0)
+    {
+        weechat_printf (NULL,
+                        _("%s%s: unable to create thread (%s)"),
+                        weechat_prefix ("error"),
+                        XFER_PLUGIN_NAME,
+                        strerror (rc));
+        if (xfer->child_xfer)
+        {
+            free (xfer->child_xfer);
+            xfer->child_xfer = NULL;
+        }
+        xfer_close (xfer, XFER_STATUS_FAILED);
+        xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+        return 0;
+    }
+
+    xfer->child_running = 1;
+    xfer->hook_fd = weechat_hook_fd (xfer->child_read,
+                                     1, 0, 0,
+                                     &xfer_network_child_read_cb,
+                                     xfer, NULL);
+
+    return 1;
+}
+
+/*
+ * Starts thread for sending file.
+ */
+
+void
+xfer_network_send_file_start (struct t_xfer *xfer)
+{
     if (!xfer_network_create_pipe (xfer))
         return;
 
     xfer->file = open (xfer->local_filename, O_RDONLY | O_NONBLOCK, 0644);
 
-    switch (pid = fork ())
-    {
-        case -1:  /* fork failed */
-            weechat_printf (NULL,
-                            _("%s%s: unable to fork (%s)"),
-                            weechat_prefix ("error"),
-                            XFER_PLUGIN_NAME,
-                            strerror (errno));
-            xfer_close (xfer, XFER_STATUS_FAILED);
-            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-            return;
-        case 0:  /* child process */
-            rc = setuid (getuid ());
-            (void) rc;
-            close (xfer->child_read);
-            switch (xfer->protocol)
-            {
-                case XFER_NO_PROTOCOL:
-                    _exit (EXIT_SUCCESS);
-                    break;
-                case XFER_PROTOCOL_DCC:
-                    xfer_dcc_send_file_child (xfer);
-                    break;
-                case XFER_NUM_PROTOCOLS:
-                    break;
-            }
-            _exit (EXIT_SUCCESS);
-    }
+    if (!xfer_network_create_thread (xfer))
+        return;
 
     weechat_printf (NULL,
                     _("%s: sending file to %s (%s, %s.%s), "
@@ -265,27 +408,15 @@ xfer_network_send_file_fork (struct t_xfer *xfer)
                     xfer->local_filename,
                     xfer->size,
                     xfer_protocol_string[xfer->protocol]);
-
-    /* parent process */
-    xfer->child_pid = pid;
-    close (xfer->child_write);
-    xfer->child_write = -1;
-    xfer->hook_fd = weechat_hook_fd (xfer->child_read,
-                                     1, 0, 0,
-                                     &xfer_network_child_read_cb,
-                                     xfer, NULL);
 }
 
 /*
- * Forks process for receiving file.
+ * Starts thread for receiving file.
  */
 
 void
-xfer_network_recv_file_fork (struct t_xfer *xfer)
+xfer_network_recv_file_start (struct t_xfer *xfer)
 {
-    pid_t pid;
-    int rc;
-
     if (!xfer_network_create_pipe (xfer))
         return;
 
@@ -297,61 +428,36 @@ xfer_network_recv_file_fork (struct t_xfer *xfer)
                            O_CREAT | O_TRUNC | O_WRONLY | O_NONBLOCK,
                            0644);
 
-    switch (pid = fork ())
-    {
-        case -1:  /* fork failed */
-            weechat_printf (NULL,
-                            _("%s%s: unable to fork (%s)"),
-                            weechat_prefix ("error"),
-                            XFER_PLUGIN_NAME,
-                            strerror (errno));
-            xfer_close (xfer, XFER_STATUS_FAILED);
-            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-            return;
-        case 0:  /* child process */
-            rc = setuid (getuid ());
-            (void) rc;
-            close (xfer->child_read);
-            switch (xfer->protocol)
-            {
-                case XFER_NO_PROTOCOL:
-                    _exit (EXIT_SUCCESS);
-                    break;
-                case XFER_PROTOCOL_DCC:
-                    xfer_dcc_recv_file_child (xfer);
-                    break;
-                case XFER_NUM_PROTOCOLS:
-                    break;
-            }
-            _exit (EXIT_SUCCESS);
-    }
-
-    /* parent process */
-    xfer->child_pid = pid;
-    close (xfer->child_write);
-    xfer->child_write = -1;
-    xfer->hook_fd = weechat_hook_fd (xfer->child_read,
-                                     1, 0, 0,
-                                     &xfer_network_child_read_cb,
-                                     xfer, NULL);
+    xfer_network_create_thread (xfer);
 }
 
 /*
- * Kills child process and closes pipe.
+ * Stops thread sending/receiving file and closes pipes.
+ *
+ * The thread is asked to stop via a pipe (it checks it while sending or
+ * receiving data), then the main thread waits for its end.
  */
 
 void
 xfer_network_child_kill (struct t_xfer *xfer)
 {
-    /* kill process */
-    if (xfer->child_pid > 0)
+    int num_written;
+
+    /* stop thread (if it is still running) and wait for its end */
+    if (xfer->child_running)
+    {
+        num_written = write (xfer->child_stop_write, "1", 1);
+        (void) num_written;
+        pthread_join (xfer->child_thread, NULL);
+        xfer->child_running = 0;
+    }
+    if (xfer->child_xfer)
     {
-        kill (xfer->child_pid, SIGKILL);
-        waitpid (xfer->child_pid, NULL, 0);
-        xfer->child_pid = 0;
+        free (xfer->child_xfer);
+        xfer->child_xfer = NULL;
     }
 
-    /* close pipe used with child */
+    /* close pipe used with thread */
     if (xfer->child_read != -1)
     {
         close (xfer->child_read);
@@ -362,6 +468,16 @@ xfer_network_child_kill (struct t_xfer *xfer)
         close (xfer->child_write);
         xfer->child_write = -1;
     }
+    if (xfer->child_stop_read != -1)
+    {
+        close (xfer->child_stop_read);
+        xfer->child_stop_read = -1;
+    }
+    if (xfer->child_stop_write != -1)
+    {
+        close (xfer->child_stop_write);
+        xfer->child_stop_write = -1;
+    }
 }
 
 /*
@@ -435,7 +551,7 @@ xfer_network_fd_cb (const void *pointer, void *data, int fd)
             xfer->status = XFER_STATUS_ACTIVE;
             xfer->start_transfer = time (NULL);
             xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-            xfer_network_send_file_fork (xfer);
+            xfer_network_send_file_start (xfer);
         }
     }
 
@@ -529,11 +645,11 @@ xfer_network_timer_cb (const void *pointer, void *data, int remaining_calls)
 }
 
 /*
- * Callback called when connecting to remote host (DCC chat only).
+ * Callback called when connecting to remote host (DCC chat or file receiving).
  */
 
 int
-xfer_network_connect_chat_recv_cb (const void *pointer, void *data,
+xfer_network_connect_recv_cb (const void *pointer, void *data,
                                    int status, int gnutls_rc,
                                    int sock, const char *error,
                                    const char *ip_address)
@@ -556,6 +672,13 @@ xfer_network_connect_chat_recv_cb (const void *pointer, void *data,
     {
         xfer->sock = sock;
 
+        /* for a file: launch thread receiving file on this socket */
+        if (XFER_IS_FILE(xfer->type))
+        {
+            xfer_network_recv_file_start (xfer);
+            return WEECHAT_RC_OK;
+        }
+
         flags = fcntl (xfer->sock, F_GETFL);
         if (flags == -1)
             flags = 0;
@@ -713,19 +836,20 @@ xfer_network_connect (struct t_xfer *xfer)
         }
     }
 
-    /* for chat receiving, connect to listening host */
-    if (xfer->type == XFER_TYPE_CHAT_RECV)
+    /*
+     * for chat/file receiving, connect to listening host (for a file, the
+     * thread receiving file is started when the connection is established)
+     */
+    if (XFER_IS_RECV(xfer->type))
     {
         xfer->hook_connect = weechat_hook_connect (xfer->proxy,
                                                    xfer->remote_address_str,
                                                    xfer->port, 1, 0, NULL, NULL,
                                                    0, "NONE", NULL,
-                                                   &xfer_network_connect_chat_recv_cb,
+                                                   &xfer_network_connect_recv_cb,
                                                    xfer, NULL);
     }
 
-    /* for file receiving, connection is made in child process (blocking) */
-
     return 1;
 }
 
@@ -737,17 +861,9 @@ void
 xfer_network_connect_init (struct t_xfer *xfer)
 {
     if (!xfer_network_connect (xfer))
-    {
         xfer_close (xfer, XFER_STATUS_FAILED);
-    }
     else
-    {
-        /* for a file: launch child process */
-        if (XFER_IS_FILE(xfer->type))
-            xfer_network_recv_file_fork (xfer);
-
         xfer->status = XFER_STATUS_CONNECTING;
-    }
     xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
 }
 
@@ -20,8 +20,14 @@
 #ifndef WEECHAT_XFER_NETWORK_H
 #define WEECHAT_XFER_NETWORK_H 1
 
+/* stack size of thread sending/receiving a file */
+#define XFER_NETWORK_THREAD_STACK_SIZE (512 * 1024)
+
 extern void xfer_network_write_pipe (struct t_xfer *xfer, int status,
                                      int error);
+extern int xfer_network_child_stopped (struct t_xfer *xfer);
+extern int xfer_network_child_wait (struct t_xfer *xfer, short events,
+                                    int timeout);
 extern void xfer_network_connect_init (struct t_xfer *xfer);
 extern void xfer_network_child_kill (struct t_xfer *xfer);
 extern int xfer_network_connect (struct t_xfer *xfer);
@@ -373,7 +373,7 @@ xfer_close (struct t_xfer *xfer, enum t_xfer_status status)
 }
 
 /*
- * Disconnects all active xfer (with a socket).
+ * Disconnects all active xfer (with a socket or a thread).
  */
 
 void
@@ -383,7 +383,7 @@ xfer_disconnect_all ()
 
     for (ptr_xfer = xfer_list; ptr_xfer; ptr_xfer = ptr_xfer->next_xfer)
     {
-        if (ptr_xfer->sock >= 0)
+        if ((ptr_xfer->sock >= 0) || ptr_xfer->child_running)
         {
             if (ptr_xfer->status == XFER_STATUS_ACTIVE)
             {
@@ -486,12 +486,16 @@ xfer_alloc ()
     new_xfer->remote_nick_color = NULL;
     new_xfer->fast_send = weechat_config_boolean (xfer_config_network_fast_send);
     new_xfer->blocksize = weechat_config_integer (xfer_config_network_blocksize);
+    new_xfer->speed_limit = 0;
     new_xfer->start_time = time_now;
     new_xfer->start_transfer = time_now;
     new_xfer->sock = -1;
-    new_xfer->child_pid = 0;
+    new_xfer->child_running = 0;
+    new_xfer->child_xfer = NULL;
     new_xfer->child_read = -1;
     new_xfer->child_write = -1;
+    new_xfer->child_stop_read = -1;
+    new_xfer->child_stop_write = -1;
     new_xfer->hook_fd = NULL;
     new_xfer->hook_timer = NULL;
     new_xfer->hook_connect = NULL;
@@ -706,6 +710,7 @@ xfer_new (const char *plugin_name, const char *plugin_id,
     new_xfer->hash_handle = NULL;
     new_xfer->hash_target = NULL;
     new_xfer->hash_status = XFER_HASH_STATUS_UNKNOWN;
+    new_xfer->hash_pos = 0;
 
     if ((type == XFER_TYPE_FILE_RECV)
         && weechat_config_boolean (xfer_config_file_auto_check_crc32))
@@ -1632,7 +1637,7 @@ xfer_add_to_infolist (struct t_infolist *infolist, struct t_xfer *xfer)
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "sock", xfer->sock))
         return 0;
-    if (!weechat_infolist_new_var_integer (ptr_item, "child_pid", xfer->child_pid))
+    if (!weechat_infolist_new_var_integer (ptr_item, "child_running", xfer->child_running))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "child_read", xfer->child_read))
         return 0;
@@ -1680,6 +1685,9 @@ xfer_add_to_infolist (struct t_infolist *infolist, struct t_xfer *xfer)
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "hash_status_string", xfer_hash_status_string[xfer->hash_status]))
         return 0;
+    snprintf (value, sizeof (value), "%llu", xfer->hash_pos);
+    if (!weechat_infolist_new_var_string (ptr_item, "hash_pos", value))
+        return 0;
 
     return 1;
 }
@@ -1726,12 +1734,16 @@ xfer_print_log ()
         weechat_log_printf ("  remote_nick_color . . . : '%s'",  ptr_xfer->remote_nick_color);
         weechat_log_printf ("  fast_send . . . . . . . : %d",    ptr_xfer->fast_send);
         weechat_log_printf ("  blocksize . . . . . . . : %d",    ptr_xfer->blocksize);
+        weechat_log_printf ("  speed_limit . . . . . . : %d",    ptr_xfer->speed_limit);
         weechat_log_printf ("  start_time. . . . . . . : %ld",   ptr_xfer->start_time);
         weechat_log_printf ("  start_transfer. . . . . : %ld",   ptr_xfer->start_transfer);
         weechat_log_printf ("  sock. . . . . . . . . . : %d",    ptr_xfer->sock);
-        weechat_log_printf ("  child_pid . . . . . . . : %d",    ptr_xfer->child_pid);
+        weechat_log_printf ("  child_running . . . . . : %d",    ptr_xfer->child_running);
+        weechat_log_printf ("  child_xfer. . . . . . . : 0x%lx", ptr_xfer->child_xfer);
         weechat_log_printf ("  child_read. . . . . . . : %d",    ptr_xfer->child_read);
         weechat_log_printf ("  child_write . . . . . . : %d",    ptr_xfer->child_write);
+        weechat_log_printf ("  child_stop_read . . . . : %d",    ptr_xfer->child_stop_read);
+        weechat_log_printf ("  child_stop_write. . . . : %d",    ptr_xfer->child_stop_write);
         weechat_log_printf ("  hook_fd . . . . . . . . : 0x%lx", ptr_xfer->hook_fd);
         weechat_log_printf ("  hook_timer. . . . . . . : 0x%lx", ptr_xfer->hook_timer);
         weechat_log_printf ("  hook_connect. . . . . . : 0x%lx", ptr_xfer->hook_connect);
@@ -1751,6 +1763,7 @@ xfer_print_log ()
         weechat_log_printf ("  hash_status . . . . . . : %d (%s)",
                             ptr_xfer->hash_status,
                             xfer_hash_status_string[ptr_xfer->hash_status]);
+        weechat_log_printf ("  hash_pos. . . . . . . . : %llu",  ptr_xfer->hash_pos);
         weechat_log_printf ("  prev_xfer . . . . . . . : 0x%lx", ptr_xfer->prev_xfer);
         weechat_log_printf ("  next_xfer . . . . . . . : 0x%lx", ptr_xfer->next_xfer);
     }
@@ -1846,6 +1859,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 int
 weechat_plugin_end (struct t_weechat_plugin *plugin)
 {
+    struct t_xfer *ptr_xfer;
+
     /* make C compiler happy */
     (void) plugin;
 
@@ -1856,5 +1871,11 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
     else
         xfer_disconnect_all ();
 
+    /* threads sending/receiving files can not run after plugin is unloaded */
+    for (ptr_xfer = xfer_list; ptr_xfer; ptr_xfer = ptr_xfer->next_xfer)
+    {
+        xfer_network_child_kill (ptr_xfer);
+    }
+
     return WEECHAT_RC_OK;
 }
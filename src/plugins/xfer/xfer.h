@@ -22,6 +22,7 @@
 
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
 #include <gcrypt.h>
 #include <sys/socket.h>
 
@@ -157,12 +158,18 @@ struct t_xfer
                                        /* (returned by IRC plugin)          */
     int fast_send;                     /* fast send file: does not wait ACK */
     int blocksize;                     /* block size for sending file       */
+    int speed_limit;                   /* speed limit (KB/s, 0 = no limit)  */
+                                       /* (read when thread is started)     */
     time_t start_time;                 /* time when xfer started            */
     time_t start_transfer;             /* time when xfer transfer started   */
     int sock;                          /* socket for connection             */
-    pid_t child_pid;                   /* pid of child process (send/recv)  */
+    pthread_t child_thread;            /* thread sending/receiving file     */
+    int child_running;                 /* 1 if thread has been created      */
+    struct t_xfer *child_xfer;         /* copy of xfer used by the thread   */
     int child_read;                    /* to read into child pipe           */
     int child_write;                   /* to write into child pipe          */
+    int child_stop_read;               /* pipe to stop thread (read)        */
+    int child_stop_write;              /* pipe to stop thread (write)       */
     struct t_hook *hook_fd;            /* hook for socket or child pipe     */
     struct t_hook *hook_timer;         /* timeout for receiver accept       */
     struct t_hook *hook_connect;       /* hook for connection to chat recv  */
@@ -181,6 +188,7 @@ struct t_xfer
     gcry_md_hd_t *hash_handle;         /* handle for CRC32 hash             */
     char *hash_target;                 /* the CRC32 hash to check against   */
     enum t_xfer_hash_status hash_status; /* hash status                     */
+    unsigned long long hash_pos;       /* bytes hashed (resume of file)     */
     struct t_xfer *prev_xfer;          /* link to previous xfer             */
     struct t_xfer *next_xfer;          /* link to next xfer                 */
 };
@@ -0,0 +1,992 @@
+/*
+ * core-benchmark.c - benchmark of core functions (hashtables, strings, eval)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program runs WeeChat without interface (with the fake ncurses
+ * library used by tests) and measures the time of core functions called
+ * in hot paths: hashtables, split of strings, regex replacement,
+ * highlights, UTF-8 screen length, evaluation of trigger conditions and
+ * decoding of colors.
+ *
+ * Each benchmark is run with an increasing number of iterations until it
+ * lasts at least the minimum time, then one line is displayed, with fields
+ * separated by tabs:
+ *
+ *   name  iterations  ns/op
+ *
+ * Lines beginning with "#" are comments, so the output can be compared
+ * between two versions with standard tools.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <regex.h>
+#include <time.h>
+
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include "src/core/weechat.h"
+#include "src/core/wee-eval.h"
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-utf8.h"
+#include "src/core/wee-util.h"
+#include "src/core/wee-version.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-main.h"
+#include "src/plugins/weechat-plugin.h"
+
+extern void gui_main_init ();
+
+#define BENCHMARK_MAX_KEYS 100000
+
+struct t_benchmark
+{
+    char *name;                        /* name of benchmark                 */
+    char *hash;                        /* hashtable: hash function          */
+    int hashtable_size;                /* hashtable: size (0 = open addr.)  */
+    int size;                          /* hashtable: number of items        */
+    void (*init)(struct t_benchmark *benchmark);    /* before measure       */
+    void (*run)(struct t_benchmark *benchmark,      /* function measured    */
+                long long iterations);
+    void (*end)(struct t_benchmark *benchmark);     /* after measure        */
+};
+
+/* options */
+int benchmark_min_time = 200;          /* min time for a benchmark (ms)     */
+char *benchmark_filter = NULL;         /* run only benchmarks with this     */
+
+/* data used by benchmarks */
+char *benchmark_keys[BENCHMARK_MAX_KEYS];
+struct t_hashtable *benchmark_hashtable = NULL;
+regex_t benchmark_regex;
+struct t_string_highlight *benchmark_highlight = NULL;
+struct t_hashtable *benchmark_eval_pointers = NULL;
+struct t_hashtable *benchmark_eval_extra_vars = NULL;
+struct t_hashtable *benchmark_eval_options = NULL;
+char benchmark_colored_message[1024];
+struct t_gui_buffer *benchmark_buffer = NULL;
+volatile long long benchmark_sink = 0;  /* results, so that calls are kept  */
+
+const char *benchmark_message =
+    "@time=2017-03-12T10:00:00.000Z :alice!~alice@example.com PRIVMSG "
+    "#weechat :hello everybody, this is a test message with some words "
+    "in it, and a nick at the end: bob";
+const char *benchmark_highlight_words =
+    "carol,dave,eve,mallory,trent,weechat*,bob";
+const char *benchmark_regex_message =
+    "contact alice@example or bob@example, or write to admin@server "
+    "if nobody replies";
+const char *benchmark_utf8_message =
+    "ASCII text, accents: àéèçù, CJK: 你好世界, "
+    "emoji: \xf0\x9f\x98\x80, and more ASCII text at the end";
+
+/*
+ * Returns current time of monotonic clock (in nanoseconds).
+ */
+
+long long
+benchmark_get_time ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((long long)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+/*
+ * Initializes a hashtable with "size" keys.
+ */
+
+void
+benchmark_hashtable_init (struct t_benchmark *benchmark)
+{
+    char type_keys[64];
+    int i;
+
+    snprintf (type_keys, sizeof (type_keys),
+              "%s:%s", WEECHAT_HASHTABLE_STRING, benchmark->hash);
+    benchmark_hashtable = hashtable_new (benchmark->hashtable_size,
+                                         type_keys,
+                                         WEECHAT_HASHTABLE_STRING,
+                                         NULL, NULL);
+    for (i = 0; i < benchmark->size; i++)
+    {
+        hashtable_set (benchmark_hashtable,
+                       benchmark_keys[i], benchmark_keys[i]);
+    }
+}
+
+/*
+ * Frees the hashtable.
+ */
+
+void
+benchmark_hashtable_end (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    if (benchmark_hashtable)
+    {
+        hashtable_free (benchmark_hashtable);
+        benchmark_hashtable = NULL;
+    }
+}
+
+/*
+ * Benchmark: hashtable_set (one op = one key added; the hashtable is
+ * created again each time "size" keys have been added).
+ */
+
+void
+benchmark_hashtable_set (struct t_benchmark *benchmark, long long iterations)
+{
+    char type_keys[64];
+    long long i;
+    int index;
+
+    snprintf (type_keys, sizeof (type_keys),
+              "%s:%s", WEECHAT_HASHTABLE_STRING, benchmark->hash);
+    index = 0;
+    for (i = 0; i < iterations; i++)
+    {
+        if (index == 0)
+        {
+            if (benchmark_hashtable)
+                hashtable_free (benchmark_hashtable);
+            benchmark_hashtable = hashtable_new (benchmark->hashtable_size,
+                                                 type_keys,
+                                                 WEECHAT_HASHTABLE_STRING,
+                                                 NULL, NULL);
+        }
+        hashtable_set (benchmark_hashtable,
+                       benchmark_keys[index], benchmark_keys[index]);
+        index++;
+        if (index >= benchmark->size)
+            index = 0;
+    }
+}
+
+/*
+ * Benchmark: hashtable_get (one op = one key found).
+ */
+
+void
+benchmark_hashtable_get (struct t_benchmark *benchmark, long long iterations)
+{
+    long long i;
+    int index;
+
+    index = 0;
+    for (i = 0; i < iterations; i++)
+    {
+        if (hashtable_get (benchmark_hashtable, benchmark_keys[index]))
+            benchmark_sink++;
+        index++;
+        if (index >= benchmark->size)
+            index = 0;
+    }
+}
+
+/*
+ * Callback for hashtable_map.
+ */
+
+void
+benchmark_hashtable_map_cb (void *data, struct t_hashtable *hashtable,
+                            const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) hashtable;
+    (void) key;
+    (void) value;
+
+    benchmark_sink++;
+}
+
+/*
+ * Benchmark: hashtable_map (one op = one map of all items).
+ */
+
+void
+benchmark_hashtable_map (struct t_benchmark *benchmark, long long iterations)
+{
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        hashtable_map (benchmark_hashtable,
+                       &benchmark_hashtable_map_cb, NULL);
+    }
+}
+
+/*
+ * Benchmark: string_split of an IRC message.
+ */
+
+void
+benchmark_string_split (struct t_benchmark *benchmark, long long iterations)
+{
+    char **items;
+    long long i;
+    int num_items;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        items = string_split (benchmark_message, " ", 0, 0, &num_items);
+        benchmark_sink += num_items;
+        string_free_split (items);
+    }
+}
+
+/*
+ * Benchmark: string_split_shared of an IRC message.
+ */
+
+void
+benchmark_string_split_shared (struct t_benchmark *benchmark,
+                               long long iterations)
+{
+    char **items;
+    long long i;
+    int num_items;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        items = string_split_shared (benchmark_message, " ", 0, 0,
+                                     &num_items);
+        benchmark_sink += num_items;
+        string_free_split_shared (items);
+    }
+}
+
+/*
+ * Compiles regex for benchmark of string_replace_regex.
+ */
+
+void
+benchmark_string_replace_regex_init (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    string_regcomp (&benchmark_regex, "([a-z]+)@([a-z]+)", REG_EXTENDED);
+}
+
+/*
+ * Frees regex used for benchmark of string_replace_regex.
+ */
+
+void
+benchmark_string_replace_regex_end (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    regfree (&benchmark_regex);
+}
+
+/*
+ * Benchmark: string_replace_regex (3 matches in string).
+ */
+
+void
+benchmark_string_replace_regex (struct t_benchmark *benchmark,
+                                long long iterations)
+{
+    char *result;
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        result = string_replace_regex (benchmark_regex_message,
+                                       &benchmark_regex, "$2 at $1", '$',
+                                       NULL, NULL);
+        if (result)
+        {
+            benchmark_sink += strlen (result);
+            free (result);
+        }
+    }
+}
+
+/*
+ * Benchmark: string_has_highlight (highlight word at the end of message).
+ */
+
+void
+benchmark_string_has_highlight (struct t_benchmark *benchmark,
+                                long long iterations)
+{
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        benchmark_sink += string_has_highlight (benchmark_message,
+                                                benchmark_highlight_words);
+    }
+}
+
+/*
+ * Compiles highlight words for benchmark of string_highlight_match.
+ */
+
+void
+benchmark_string_highlight_match_init (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    benchmark_highlight = string_highlight_compile (benchmark_highlight_words);
+}
+
+/*
+ * Frees compiled highlight words.
+ */
+
+void
+benchmark_string_highlight_match_end (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    string_highlight_free (benchmark_highlight);
+    benchmark_highlight = NULL;
+}
+
+/*
+ * Benchmark: string_highlight_match (with compiled highlight words).
+ */
+
+void
+benchmark_string_highlight_match (struct t_benchmark *benchmark,
+                                  long long iterations)
+{
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        benchmark_sink += string_highlight_match (benchmark_highlight,
+                                                  benchmark_message);
+    }
+}
+
+/*
+ * Benchmark: utf8_strlen_screen (ASCII, accents, wide chars and emoji).
+ */
+
+void
+benchmark_utf8_strlen_screen (struct t_benchmark *benchmark,
+                              long long iterations)
+{
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        benchmark_sink += utf8_strlen_screen (benchmark_utf8_message);
+    }
+}
+
+/*
+ * Initializes hashtables for benchmarks of eval_expression, with variables
+ * set like in a trigger on signal "*,irc_in2_privmsg" or hook "print".
+ */
+
+void
+benchmark_eval_init (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    benchmark_eval_pointers = hashtable_new (32,
+                                             WEECHAT_HASHTABLE_STRING,
+                                             WEECHAT_HASHTABLE_POINTER,
+                                             NULL, NULL);
+    hashtable_set (benchmark_eval_pointers, "buffer", gui_buffers);
+
+    benchmark_eval_extra_vars = hashtable_new (32,
+                                               WEECHAT_HASHTABLE_STRING,
+                                               WEECHAT_HASHTABLE_STRING,
+                                               NULL, NULL);
+    hashtable_set (benchmark_eval_extra_vars, "tg_displayed", "1");
+    hashtable_set (benchmark_eval_extra_vars, "tg_highlight", "0");
+    hashtable_set (benchmark_eval_extra_vars, "tg_msg_pv", "1");
+    hashtable_set (benchmark_eval_extra_vars, "tg_tags",
+                   ",irc_privmsg,notify_private,prefix_nick_green,"
+                   "nick_alice,host_~alice@example.com,log1,");
+    hashtable_set (benchmark_eval_extra_vars, "tg_prefix_nocolor", "alice");
+    hashtable_set (benchmark_eval_extra_vars, "tg_message_nocolor",
+                   benchmark_message);
+
+    benchmark_eval_options = hashtable_new (32,
+                                            WEECHAT_HASHTABLE_STRING,
+                                            WEECHAT_HASHTABLE_STRING,
+                                            NULL, NULL);
+    hashtable_set (benchmark_eval_options, "type", "condition");
+}
+
+/*
+ * Frees hashtables used for benchmarks of eval_expression.
+ */
+
+void
+benchmark_eval_end (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    hashtable_free (benchmark_eval_pointers);
+    benchmark_eval_pointers = NULL;
+    hashtable_free (benchmark_eval_extra_vars);
+    benchmark_eval_extra_vars = NULL;
+    hashtable_free (benchmark_eval_options);
+    benchmark_eval_options = NULL;
+}
+
+/*
+ * Evaluates a condition "iterations" times.
+ */
+
+void
+benchmark_eval_condition (const char *condition, long long iterations)
+{
+    char *result;
+    long long i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        result = eval_expression (condition,
+                                  benchmark_eval_pointers,
+                                  benchmark_eval_extra_vars,
+                                  benchmark_eval_options);
+        if (result)
+        {
+            benchmark_sink += result[0];
+            free (result);
+        }
+    }
+}
+
+/*
+ * Benchmark: eval_expression with a trigger condition on variables.
+ */
+
+void
+benchmark_eval_vars (struct t_benchmark *benchmark, long long iterations)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    benchmark_eval_condition (
+        "${tg_displayed} && (${tg_highlight} || ${tg_msg_pv})",
+        iterations);
+}
+
+/*
+ * Benchmark: eval_expression with a trigger condition on tags and message.
+ */
+
+void
+benchmark_eval_match (struct t_benchmark *benchmark, long long iterations)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    benchmark_eval_condition (
+        "${tg_tags} !~ ,notify_none, && ${tg_prefix_nocolor} != bob "
+        "&& ${tg_message_nocolor} =* *test*",
+        iterations);
+}
+
+/*
+ * Benchmark: eval_expression with a trigger condition on a buffer property
+ * and a regex.
+ */
+
+void
+benchmark_eval_buffer (struct t_benchmark *benchmark, long long iterations)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    benchmark_eval_condition (
+        "${buffer.full_name} =~ ^core\\. && ${buffer.number} == 1",
+        iterations);
+}
+
+/*
+ * Builds a message with colors for benchmark of gui_color_decode.
+ */
+
+void
+benchmark_gui_color_decode_init (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    snprintf (benchmark_colored_message, sizeof (benchmark_colored_message),
+              "%s[%s12:34:56%s] %s<%salice%s>%s hello %severybody%s, "
+              "this is a %stest%s message %swith%s colors%s",
+              gui_color_get_custom ("blue"),
+              gui_color_get_custom ("default"),
+              gui_color_get_custom ("blue"),
+              gui_color_get_custom ("green"),
+              gui_color_get_custom ("lightcyan"),
+              gui_color_get_custom ("green"),
+              gui_color_get_custom ("reset"),
+              gui_color_get_custom ("bold"),
+              gui_color_get_custom ("-bold"),
+              gui_color_get_custom ("yellow,red"),
+              gui_color_get_custom ("default,default"),
+              gui_color_get_custom ("underline"),
+              gui_color_get_custom ("-underline"),
+              gui_color_get_custom ("reset"));
+}
+
+/*
+ * Benchmark: gui_color_decode (colors removed).
+ */
+
+void
+benchmark_gui_color_decode (struct t_benchmark *benchmark,
+                            long long iterations)
+{
+    char *result;
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    for (i = 0; i < iterations; i++)
+    {
+        result = gui_color_decode (benchmark_colored_message, NULL);
+        if (result)
+        {
+            benchmark_sink += strlen (result);
+            free (result);
+        }
+    }
+}
+
+/*
+ * Creates a buffer for benchmark of gui_chat_printf_date_tags.
+ */
+
+void
+benchmark_gui_chat_printf_init (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    benchmark_buffer = gui_buffer_new (NULL, "benchmark",
+                                       NULL, NULL, NULL,
+                                       NULL, NULL, NULL);
+}
+
+/*
+ * Closes buffer used for benchmark of gui_chat_printf_date_tags.
+ */
+
+void
+benchmark_gui_chat_printf_end (struct t_benchmark *benchmark)
+{
+    /* make C compiler happy */
+    (void) benchmark;
+
+    if (benchmark_buffer)
+    {
+        gui_buffer_close (benchmark_buffer);
+        benchmark_buffer = NULL;
+    }
+}
+
+/*
+ * Benchmark: gui_chat_printf_date_tags (formatted message with prefix and
+ * tags added in a buffer).
+ */
+
+void
+benchmark_gui_chat_printf (struct t_benchmark *benchmark,
+                           long long iterations)
+{
+    long long i;
+
+    /* make C compiler happy */
+    (void) benchmark;
+
+    if (!benchmark_buffer)
+        return;
+
+    for (i = 0; i < iterations; i++)
+    {
+        gui_chat_printf_date_tags (benchmark_buffer, 0,
+                                   "irc_privmsg,notify_message,nick_alice",
+                                   "%s\t%s (%lld)",
+                                   "alice", benchmark_message, i);
+    }
+}
+
+struct t_benchmark benchmarks_hashtable[] =
+{
+    { "hashtable_set", NULL, 0, 0,
+      NULL, &benchmark_hashtable_set, &benchmark_hashtable_end },
+    { "hashtable_get", NULL, 0, 0,
+      &benchmark_hashtable_init, &benchmark_hashtable_get,
+      &benchmark_hashtable_end },
+    { "hashtable_map", NULL, 0, 0,
+      &benchmark_hashtable_init, &benchmark_hashtable_map,
+      &benchmark_hashtable_end },
+    { NULL, NULL, 0, 0, NULL, NULL, NULL },
+};
+
+char *benchmark_hashtable_hash[] = { "siphash", "djb2", NULL };
+int benchmark_hashtable_sizes[] = { 10, 1000, 100000, 0 };
+
+struct t_benchmark benchmarks[] =
+{
+    { "string_split", NULL, 0, 0,
+      NULL, &benchmark_string_split, NULL },
+    { "string_split_shared", NULL, 0, 0,
+      NULL, &benchmark_string_split_shared, NULL },
+    { "string_replace_regex", NULL, 0, 0,
+      &benchmark_string_replace_regex_init, &benchmark_string_replace_regex,
+      &benchmark_string_replace_regex_end },
+    { "string_has_highlight", NULL, 0, 0,
+      NULL, &benchmark_string_has_highlight, NULL },
+    { "string_highlight_match", NULL, 0, 0,
+      &benchmark_string_highlight_match_init,
+      &benchmark_string_highlight_match,
+      &benchmark_string_highlight_match_end },
+    { "utf8_strlen_screen", NULL, 0, 0,
+      NULL, &benchmark_utf8_strlen_screen, NULL },
+    { "eval_expression/vars", NULL, 0, 0,
+      &benchmark_eval_init, &benchmark_eval_vars, &benchmark_eval_end },
+    { "eval_expression/match", NULL, 0, 0,
+      &benchmark_eval_init, &benchmark_eval_match, &benchmark_eval_end },
+    { "eval_expression/buffer", NULL, 0, 0,
+      &benchmark_eval_init, &benchmark_eval_buffer, &benchmark_eval_end },
+    { "gui_color_decode", NULL, 0, 0,
+      &benchmark_gui_color_decode_init, &benchmark_gui_color_decode, NULL },
+    { "gui_chat_printf", NULL, 0, 0,
+      &benchmark_gui_chat_printf_init, &benchmark_gui_chat_printf,
+      &benchmark_gui_chat_printf_end },
+    { NULL, NULL, 0, 0, NULL, NULL, NULL },
+};
+
+/*
+ * Runs a benchmark: the number of iterations is doubled until the benchmark
+ * lasts at least the minimum time, then the result is displayed.
+ */
+
+void
+benchmark_run (struct t_benchmark *benchmark)
+{
+    char name[256];
+    long long iterations, start, elapsed;
+
+    if (benchmark->hash)
+    {
+        snprintf (name, sizeof (name), "%s/%s/%s/%d",
+                  benchmark->name, benchmark->hash,
+                  (benchmark->hashtable_size == 0) ? "open" : "chained",
+                  benchmark->size);
+    }
+    else
+    {
+        snprintf (name, sizeof (name), "%s", benchmark->name);
+    }
+
+    if (benchmark_filter && !strstr (name, benchmark_filter))
+        return;
+
+    if (benchmark->init)
+        benchmark->init (benchmark);
+
+    iterations = 1;
+    while (1)
+    {
+        start = benchmark_get_time ();
+        benchmark->run (benchmark, iterations);
+        elapsed = benchmark_get_time () - start;
+        if ((elapsed >= (long long)benchmark_min_time * 1000000LL)
+            || (iterations >= (1LL << 40)))
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    if (benchmark->end)
+        benchmark->end (benchmark);
+
+    printf ("%s\t%lld\t%.1f\n",
+            name, iterations, (double)elapsed / (double)iterations);
+}
+
+/*
+ * Runs benchmarks of hashtables, for each hash function, type of hashtable
+ * (linked lists with 32 entries or open addressing) and number of items.
+ */
+
+void
+benchmark_run_hashtables ()
+{
+    struct t_benchmark benchmark;
+    int i, j, k, l;
+
+    for (i = 0; benchmarks_hashtable[i].name; i++)
+    {
+        for (j = 0; benchmark_hashtable_hash[j]; j++)
+        {
+            for (k = 0; k < 2; k++)
+            {
+                for (l = 0; benchmark_hashtable_sizes[l] > 0; l++)
+                {
+                    benchmark = benchmarks_hashtable[i];
+                    benchmark.hash = benchmark_hashtable_hash[j];
+                    benchmark.hashtable_size = (k == 0) ? 32 : 0;
+                    benchmark.size = benchmark_hashtable_sizes[l];
+                    benchmark_run (&benchmark);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Hides (redirects to /dev/null) or restores standard output.
+ */
+
+void
+benchmark_hide_stdout (int hide, int stdout_fd)
+{
+    int fd;
+
+    fflush (stdout);
+    if (hide)
+    {
+        fd = open ("/dev/null", O_WRONLY);
+        if (fd >= 0)
+        {
+            dup2 (fd, STDOUT_FILENO);
+            close (fd);
+        }
+    }
+    else
+    {
+        dup2 (stdout_fd, STDOUT_FILENO);
+    }
+}
+
+/*
+ * Removes a file (callback for util_exec_on_files).
+ */
+
+void
+benchmark_remove_file_cb (void *data, const char *filename)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    unlink (filename);
+}
+
+/*
+ * Removes a directory with its content.
+ */
+
+void
+benchmark_remove_dir (const char *path)
+{
+    util_exec_on_files (path, 1, &benchmark_remove_file_cb, NULL);
+    rmdir (path);
+}
+
+/*
+ * Displays help.
+ */
+
+void
+benchmark_display_help (const char *name)
+{
+    printf ("Usage: %s [option...]\n", name);
+    printf ("\n");
+    printf ("Benchmark of core functions: WeeChat is started without "
+            "interface and\n"
+            "each function is called in a loop; output is one line per "
+            "benchmark:\n"
+            "name, iterations and nanoseconds per operation, separated "
+            "by tabs.\n");
+    printf ("\n");
+    printf ("  -t, --time <ms>          minimum time for each benchmark "
+            "(default: 200)\n");
+    printf ("  -f, --filter <string>    run only benchmarks with this "
+            "string in name\n");
+    printf ("  -h, --help               display this help\n");
+    printf ("\n");
+}
+
+/*
+ * Parses command line arguments.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_parse_args (int argc, char *argv[])
+{
+    struct option long_options[] = {
+        { "time",   required_argument, NULL, 't' },
+        { "filter", required_argument, NULL, 'f' },
+        { "help",   no_argument,       NULL, 'h' },
+        { NULL,     0,                 NULL, 0   },
+    };
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, "t:f:h",
+                               long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                benchmark_min_time = atoi (optarg);
+                break;
+            case 'f':
+                benchmark_filter = optarg;
+                break;
+            default:
+                benchmark_display_help (argv[0]);
+                return 0;
+        }
+    }
+
+    if (benchmark_min_time <= 0)
+    {
+        fprintf (stderr, "Error: invalid arguments\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Runs benchmark of core functions.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    char weechat_dir[] = "/tmp/weechat_benchmark_XXXXXX";
+    char *weechat_argv[] = { argv[0], "--dir", weechat_dir, "--no-plugin",
+                             NULL };
+    char key[64];
+    int i, stdout_fd;
+
+    if (!benchmark_parse_args (argc, argv))
+        return 1;
+
+    /* setup environment: default language, no specific timezone */
+    setenv ("LC_ALL", "C", 1);
+    setenv ("TZ", "", 1);
+
+    /* display output as soon as possible (it can be piped) */
+    setvbuf (stdout, NULL, _IOLBF, 0);
+
+    /* WeeChat home is a new temporary directory, removed on exit */
+    if (!mkdtemp (weechat_dir))
+    {
+        fprintf (stderr, "Error: unable to create directory %s\n",
+                 weechat_dir);
+        return 1;
+    }
+
+    /*
+     * init WeeChat (Curses calls are made with the fake ncurses library),
+     * terminal sequences sent by WeeChat are hidden so that the output
+     * contains only results
+     */
+    stdout_fd = dup (STDOUT_FILENO);
+    benchmark_hide_stdout (1, stdout_fd);
+    weechat_init (4, weechat_argv, &gui_main_init);
+    benchmark_hide_stdout (0, stdout_fd);
+
+    for (i = 0; i < BENCHMARK_MAX_KEYS; i++)
+    {
+        snprintf (key, sizeof (key), "nick_%d", i);
+        benchmark_keys[i] = strdup (key);
+    }
+
+    printf ("# WeeChat %s, core benchmark (min time: %d ms)\n",
+            version_get_version (), benchmark_min_time);
+    printf ("# name\titerations\tns/op\n");
+
+    benchmark_run_hashtables ();
+    for (i = 0; benchmarks[i].name; i++)
+    {
+        benchmark_run (&benchmarks[i]);
+    }
+
+    for (i = 0; i < BENCHMARK_MAX_KEYS; i++)
+    {
+        free (benchmark_keys[i]);
+    }
+
+    benchmark_hide_stdout (1, stdout_fd);
+    weechat_end (&gui_main_end);
+    benchmark_hide_stdout (0, stdout_fd);
+    close (stdout_fd);
+    benchmark_remove_dir (weechat_dir);
+
+    return 0;
+}
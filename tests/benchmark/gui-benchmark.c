@@ -0,0 +1,573 @@
+/*
+ * gui-benchmark.c - benchmark of Curses interface (refresh of screen)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program runs WeeChat with the fake ncurses library used by tests,
+ * which counts the calls to Curses functions and the chars written, then
+ * runs scenarios, each one being a sequence of frames: a frame is a change
+ * (scroll, resize, nicklist, message, buffer switch) followed by a refresh of screen, like
+ * at the end of an iteration of main loop.
+ *
+ * Scenarios:
+ *
+ *   scroll:   scroll a buffer with many lines, one page per frame,
+ *   resize:   resize the terminal,
+ *   nicklist: replace one nick in a nicklist with many nicks,
+ *   status:   new message in a buffer not displayed (hotlist in status bar),
+ *   print:    new message in the buffer displayed,
+ *   switch:   switch between two buffers with many lines.
+ *
+ * Output is one line per scenario, with fields separated by tabs:
+ *
+ *   scenario  frames  frames/s  calls/frame  cells/frame
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include "src/core/weechat.h"
+#include "src/core/wee-util.h"
+#include "src/core/wee-version.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-hotlist.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-main.h"
+#include "src/gui/gui-nicklist.h"
+#include "src/gui/gui-window.h"
+
+extern void gui_main_init ();
+extern void gui_main_refreshs ();
+extern int gui_term_cols, gui_term_lines;
+
+/* counters of fake ncurses library */
+extern long long ncurses_fake_calls;
+extern long long ncurses_fake_cells;
+
+enum t_benchmark_scenario
+{
+    BENCHMARK_SCENARIO_SCROLL = 0,
+    BENCHMARK_SCENARIO_RESIZE,
+    BENCHMARK_SCENARIO_NICKLIST,
+    BENCHMARK_SCENARIO_STATUS,
+    BENCHMARK_SCENARIO_PRINT,
+    BENCHMARK_SCENARIO_SWITCH,
+    /* number of scenarios */
+    BENCHMARK_NUM_SCENARIOS,
+};
+
+char *benchmark_scenario_string[] =
+{ "scroll", "resize", "nicklist", "status", "print", "switch" };
+
+/* options */
+int benchmark_scenario = -1;           /* -1 = all scenarios                */
+int benchmark_frames = 1000;
+int benchmark_lines = 10000;
+int benchmark_nicks = 10000;
+int benchmark_width = 160;
+int benchmark_height = 50;
+
+/*
+ * Returns current time of monotonic clock (in nanoseconds).
+ */
+
+long long
+benchmark_get_time ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((long long)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+/*
+ * Sets size of terminal.
+ */
+
+void
+benchmark_set_term_size (int width, int height)
+{
+    gui_term_cols = width;
+    gui_term_lines = height;
+    gui_window_ask_refresh (1);
+}
+
+/*
+ * Refreshes screen, like at the end of an iteration of main loop.
+ */
+
+void
+benchmark_refresh ()
+{
+    gui_hotlist_flush ();
+    if (gui_lines_detached)
+        gui_lines_detached_free (GUI_LINES_DETACHED_FREE_LINES);
+    gui_main_refreshs ();
+    if (gui_window_refresh_needed)
+        gui_main_refreshs ();
+}
+
+/*
+ * Displays a message in a buffer, like a message received on IRC.
+ */
+
+void
+benchmark_print (struct t_gui_buffer *buffer, int number)
+{
+    gui_chat_printf_date_tags (
+        buffer, 0, "irc_privmsg,notify_message,log1",
+        "%snick%d\t%sthis is message %d, with %scolors%s and some text "
+        "to fill the line",
+        gui_color_get_custom ("lightcyan"),
+        number % 100,
+        gui_color_get_custom ("default"),
+        number,
+        gui_color_get_custom ("yellow"),
+        gui_color_get_custom ("default"));
+}
+
+/*
+ * Creates a buffer and displays it in current window.
+ */
+
+struct t_gui_buffer *
+benchmark_new_buffer (const char *name, int display)
+{
+    struct t_gui_buffer *buffer;
+
+    buffer = gui_buffer_search_by_name (NULL, name);
+    if (!buffer)
+    {
+        buffer = gui_buffer_new (NULL, name,
+                                 NULL, NULL, NULL,
+                                 NULL, NULL, NULL);
+    }
+    if (buffer && display)
+        gui_window_switch_to_buffer (gui_current_window, buffer, 1);
+
+    return buffer;
+}
+
+/*
+ * Prepares a scenario (not measured).
+ *
+ * Returns pointer to buffer used by scenario.
+ */
+
+struct t_gui_buffer *
+benchmark_scenario_init (int scenario)
+{
+    struct t_gui_buffer *buffer;
+    char name[64];
+    int i;
+
+    buffer = NULL;
+
+    switch (scenario)
+    {
+        case BENCHMARK_SCENARIO_SCROLL:
+            buffer = benchmark_new_buffer ("bench_scroll", 1);
+            for (i = 0; i < benchmark_lines; i++)
+            {
+                benchmark_print (buffer, i);
+            }
+            break;
+        case BENCHMARK_SCENARIO_RESIZE:
+            buffer = benchmark_new_buffer ("bench_scroll", 1);
+            break;
+        case BENCHMARK_SCENARIO_NICKLIST:
+            buffer = benchmark_new_buffer ("bench_nicklist", 1);
+            gui_buffer_set (buffer, "nicklist", "1");
+            gui_nicklist_set_batch (buffer, 1);
+            for (i = 0; i < benchmark_nicks; i++)
+            {
+                snprintf (name, sizeof (name), "nick%d", i);
+                gui_nicklist_add_nick (buffer, NULL, name, "bar_fg",
+                                       (i % 20 == 0) ? "@" : " ",
+                                       "lightgreen", 1);
+            }
+            gui_nicklist_set_batch (buffer, 0);
+            for (i = 0; i < 100; i++)
+            {
+                benchmark_print (buffer, i);
+            }
+            break;
+        case BENCHMARK_SCENARIO_STATUS:
+            (void) benchmark_new_buffer ("bench_scroll", 1);
+            buffer = benchmark_new_buffer ("bench_status", 0);
+            break;
+        case BENCHMARK_SCENARIO_PRINT:
+            buffer = benchmark_new_buffer ("bench_print", 1);
+            break;
+        case BENCHMARK_SCENARIO_SWITCH:
+            /* two buffers with lines, the second one with a nicklist */
+            buffer = benchmark_new_buffer ("bench_scroll", 0);
+            if (buffer && !buffer->own_lines->first_line)
+            {
+                for (i = 0; i < benchmark_lines; i++)
+                {
+                    benchmark_print (buffer, i);
+                }
+            }
+            buffer = benchmark_new_buffer ("bench_switch", 1);
+            gui_buffer_set (buffer, "nicklist", "1");
+            gui_nicklist_set_batch (buffer, 1);
+            for (i = 0; i < 1000; i++)
+            {
+                snprintf (name, sizeof (name), "nick%d", i);
+                gui_nicklist_add_nick (buffer, NULL, name, "bar_fg",
+                                       (i % 20 == 0) ? "@" : " ",
+                                       "lightgreen", 1);
+            }
+            gui_nicklist_set_batch (buffer, 0);
+            for (i = 0; i < benchmark_lines; i++)
+            {
+                benchmark_print (buffer, i);
+            }
+            break;
+    }
+
+    return buffer;
+}
+
+/*
+ * Executes the change of a frame.
+ */
+
+void
+benchmark_scenario_frame (int scenario, struct t_gui_buffer *buffer,
+                          int frame)
+{
+    struct t_gui_nick *ptr_nick;
+    char name[64];
+
+    switch (scenario)
+    {
+        case BENCHMARK_SCENARIO_SCROLL:
+            if (gui_current_window->scroll->first_line_displayed)
+                gui_window_scroll_bottom (gui_current_window);
+            else
+                gui_window_page_up (gui_current_window);
+            break;
+        case BENCHMARK_SCENARIO_RESIZE:
+            if (frame % 2 == 0)
+            {
+                benchmark_set_term_size (benchmark_width - 20,
+                                         benchmark_height - 10);
+            }
+            else
+            {
+                benchmark_set_term_size (benchmark_width, benchmark_height);
+            }
+            break;
+        case BENCHMARK_SCENARIO_NICKLIST:
+            /* a nick leaves, another one joins */
+            snprintf (name, sizeof (name), "nick%d", frame);
+            ptr_nick = gui_nicklist_search_nick (buffer, NULL, name);
+            if (ptr_nick)
+                gui_nicklist_remove_nick (buffer, ptr_nick);
+            snprintf (name, sizeof (name), "newnick%d", frame);
+            gui_nicklist_add_nick (buffer, NULL, name, "bar_fg", " ",
+                                   "lightgreen", 1);
+            break;
+        case BENCHMARK_SCENARIO_STATUS:
+        case BENCHMARK_SCENARIO_PRINT:
+            benchmark_print (buffer, frame);
+            break;
+        case BENCHMARK_SCENARIO_SWITCH:
+            /* switch between two buffers (like alt+number) */
+            if (gui_current_window->buffer == buffer)
+            {
+                gui_window_switch_to_buffer (
+                    gui_current_window,
+                    gui_buffer_search_by_name (NULL, "bench_scroll"), 1);
+            }
+            else
+            {
+                gui_window_switch_to_buffer (gui_current_window, buffer, 1);
+            }
+            break;
+    }
+}
+
+/*
+ * Runs a scenario and displays results.
+ */
+
+void
+benchmark_run_scenario (int scenario)
+{
+    struct t_gui_buffer *buffer;
+    long long start, elapsed, calls, cells;
+    int i;
+
+    benchmark_set_term_size (benchmark_width, benchmark_height);
+    buffer = benchmark_scenario_init (scenario);
+    if (!buffer)
+        return;
+
+    /* first refresh of screen (not measured) */
+    gui_window_ask_refresh (1);
+    benchmark_refresh ();
+
+    calls = ncurses_fake_calls;
+    cells = ncurses_fake_cells;
+    start = benchmark_get_time ();
+    for (i = 0; i < benchmark_frames; i++)
+    {
+        benchmark_scenario_frame (scenario, buffer, i);
+        benchmark_refresh ();
+    }
+    elapsed = benchmark_get_time () - start;
+    calls = ncurses_fake_calls - calls;
+    cells = ncurses_fake_cells - cells;
+
+    printf ("%s\t%d\t%.1f\t%.1f\t%.1f\n",
+            benchmark_scenario_string[scenario],
+            benchmark_frames,
+            (elapsed > 0) ?
+            (double)benchmark_frames * 1000000000.0 / (double)elapsed : 0,
+            (double)calls / benchmark_frames,
+            (double)cells / benchmark_frames);
+}
+
+/*
+ * Hides (redirects to /dev/null) or restores standard output.
+ */
+
+void
+benchmark_hide_stdout (int hide, int stdout_fd)
+{
+    int fd;
+
+    fflush (stdout);
+    if (hide)
+    {
+        fd = open ("/dev/null", O_WRONLY);
+        if (fd >= 0)
+        {
+            dup2 (fd, STDOUT_FILENO);
+            close (fd);
+        }
+    }
+    else
+    {
+        dup2 (stdout_fd, STDOUT_FILENO);
+    }
+}
+
+/*
+ * Removes a file (callback for util_exec_on_files).
+ */
+
+void
+benchmark_remove_file_cb (void *data, const char *filename)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    unlink (filename);
+}
+
+/*
+ * Removes a directory with its content.
+ */
+
+void
+benchmark_remove_dir (const char *path)
+{
+    util_exec_on_files (path, 1, &benchmark_remove_file_cb, NULL);
+    rmdir (path);
+}
+
+/*
+ * Displays help.
+ */
+
+void
+benchmark_display_help (const char *name)
+{
+    printf ("Usage: %s [option...]\n", name);
+    printf ("\n");
+    printf ("Benchmark of Curses interface: WeeChat is started with a "
+            "fake ncurses library\n"
+            "and the screen is refreshed after changes (one frame per "
+            "change).\n");
+    printf ("\n");
+    printf ("  -s, --scenario <name>    scenario: scroll, resize, nicklist, "
+            "status, print, switch\n"
+            "                           (default: all)\n");
+    printf ("  -f, --frames <n>         number of frames by scenario "
+            "(default: 1000)\n");
+    printf ("  -l, --lines <n>          number of lines in buffer for "
+            "scroll (default: 10000)\n");
+    printf ("  -n, --nicks <n>          number of nicks in nicklist "
+            "(default: 10000)\n");
+    printf ("  -W, --width <n>          width of terminal (default: 160)\n");
+    printf ("  -H, --height <n>         height of terminal (default: 50)\n");
+    printf ("  -h, --help               display this help\n");
+    printf ("\n");
+}
+
+/*
+ * Parses command line arguments.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_parse_args (int argc, char *argv[])
+{
+    struct option long_options[] = {
+        { "scenario", required_argument, NULL, 's' },
+        { "frames",   required_argument, NULL, 'f' },
+        { "lines",    required_argument, NULL, 'l' },
+        { "nicks",    required_argument, NULL, 'n' },
+        { "width",    required_argument, NULL, 'W' },
+        { "height",   required_argument, NULL, 'H' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL,       0,                 NULL, 0   },
+    };
+    int i, opt;
+
+    while ((opt = getopt_long (argc, argv, "s:f:l:n:W:H:h",
+                               long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                benchmark_scenario = -1;
+                for (i = 0; i < BENCHMARK_NUM_SCENARIOS; i++)
+                {
+                    if (strcmp (optarg, benchmark_scenario_string[i]) == 0)
+                    {
+                        benchmark_scenario = i;
+                        break;
+                    }
+                }
+                if (benchmark_scenario < 0)
+                {
+                    fprintf (stderr, "Error: invalid scenario: %s\n",
+                             optarg);
+                    return 0;
+                }
+                break;
+            case 'f':
+                benchmark_frames = atoi (optarg);
+                break;
+            case 'l':
+                benchmark_lines = atoi (optarg);
+                break;
+            case 'n':
+                benchmark_nicks = atoi (optarg);
+                break;
+            case 'W':
+                benchmark_width = atoi (optarg);
+                break;
+            case 'H':
+                benchmark_height = atoi (optarg);
+                break;
+            default:
+                benchmark_display_help (argv[0]);
+                return 0;
+        }
+    }
+
+    if ((benchmark_frames <= 0) || (benchmark_lines < 0)
+        || (benchmark_nicks < 0) || (benchmark_width < 40)
+        || (benchmark_height < 20))
+    {
+        fprintf (stderr, "Error: invalid arguments\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Runs benchmark of Curses interface.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    char weechat_dir[] = "/tmp/weechat_benchmark_XXXXXX";
+    char *weechat_argv[] = { argv[0], "--dir", weechat_dir, "--no-plugin",
+                             NULL };
+    int i, stdout_fd;
+
+    if (!benchmark_parse_args (argc, argv))
+        return 1;
+
+    /* setup environment: default language, no specific timezone */
+    setenv ("LC_ALL", "C", 1);
+    setenv ("TZ", "", 1);
+
+    /* display output as soon as possible (it can be piped) */
+    setvbuf (stdout, NULL, _IOLBF, 0);
+
+    /* WeeChat home is a new temporary directory, removed on exit */
+    if (!mkdtemp (weechat_dir))
+    {
+        fprintf (stderr, "Error: unable to create directory %s\n",
+                 weechat_dir);
+        return 1;
+    }
+
+    /*
+     * init WeeChat (Curses calls are made with the fake ncurses library),
+     * terminal sequences sent by WeeChat are hidden so that the output
+     * contains only results
+     */
+    stdout_fd = dup (STDOUT_FILENO);
+    benchmark_hide_stdout (1, stdout_fd);
+    weechat_init (4, weechat_argv, &gui_main_init);
+    benchmark_hide_stdout (0, stdout_fd);
+
+    printf ("# WeeChat %s, gui benchmark (terminal: %dx%d)\n",
+            version_get_version (), benchmark_width, benchmark_height);
+    printf ("# scenario\tframes\tframes/s\tcalls/frame\tcells/frame\n");
+
+    for (i = 0; i < BENCHMARK_NUM_SCENARIOS; i++)
+    {
+        if ((benchmark_scenario < 0) || (benchmark_scenario == i))
+            benchmark_run_scenario (i);
+    }
+
+    benchmark_hide_stdout (1, stdout_fd);
+    weechat_end (&gui_main_end);
+    benchmark_hide_stdout (0, stdout_fd);
+    close (stdout_fd);
+    benchmark_remove_dir (weechat_dir);
+
+    return 0;
+}
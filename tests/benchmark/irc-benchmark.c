@@ -0,0 +1,1124 @@
+/*
+ * irc-benchmark.c - benchmark of irc plugin (processing of received messages)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program runs WeeChat without interface (with the fake ncurses
+ * library used by tests) and loads irc plugin, then:
+ *
+ *   1. creates a server "bench", which is marked as connected without
+ *      network connection (messages sent by WeeChat are written in a local
+ *      socket and discarded),
+ *   2. feeds messages directly in the queue of received messages of server
+ *      (functions irc_server_msgq_add_buffer and irc_server_msgq_flush),
+ *      as fast as possible: messages are generated for a scenario (joins,
+ *      netsplit, flood of messages in a channel) or read from a file with
+ *      raw IRC messages (one message per line),
+ *   3. displays lines/s, allocations per line and time spent per line in
+ *      each part of the processing.
+ *
+ * Time is split with wrappers around functions of plugin API used by irc
+ * plugin (modifiers, signals, printing and nicklist); time of parsing is
+ * measured separately with the same messages, and the remaining time is
+ * the time of protocol callbacks (including calls to other functions of
+ * core).
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include "src/core/weechat.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
+#include "src/plugins/plugin.h"
+#include "src/plugins/irc/irc-message.h"
+#include "src/plugins/irc/irc-server.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-main.h"
+
+extern void gui_main_init ();
+
+#ifndef BENCHMARK_PLUGINS_DIR
+#define BENCHMARK_PLUGINS_DIR "../src/plugins"
+#endif
+#ifndef BENCHMARK_PLUGINS_LIBDIR
+#define BENCHMARK_PLUGINS_LIBDIR ""
+#endif
+
+#define BENCHMARK_SERVER "bench"
+#define BENCHMARK_NICK "bench"
+#define BENCHMARK_NAMES_PER_LINE 50    /* nicks per message 353 (names)     */
+#define BENCHMARK_FLOOD_NICKS 100      /* nicks talking in flood scenario   */
+
+enum t_benchmark_scenario
+{
+    BENCHMARK_SCENARIO_JOIN = 0,
+    BENCHMARK_SCENARIO_NETSPLIT,
+    BENCHMARK_SCENARIO_FLOOD,
+    BENCHMARK_SCENARIO_FILE,
+    /* number of scenarios */
+    BENCHMARK_NUM_SCENARIOS,
+};
+
+enum t_benchmark_part
+{
+    BENCHMARK_PART_IRC = 0,            /* irc plugin (parse and callbacks)  */
+    BENCHMARK_PART_MODIFIERS,          /* modifiers (irc_in, charset, ...)  */
+    BENCHMARK_PART_SIGNALS,            /* signals and hsignals              */
+    BENCHMARK_PART_PRINT,              /* printing of lines                 */
+    BENCHMARK_PART_NICKLIST,           /* changes in nicklist               */
+    /* number of parts */
+    BENCHMARK_NUM_PARTS,
+};
+
+#define BENCHMARK_MAX_DEPTH 64
+
+char *benchmark_scenario_string[] = { "join", "netsplit", "flood", "file" };
+
+struct t_benchmark_lines
+{
+    char **lines;                      /* messages                          */
+    int count;                         /* number of messages                */
+    int alloc;                         /* allocated size for messages       */
+};
+
+/* options */
+int benchmark_scenario = -1;           /* -1 = all generated scenarios      */
+int benchmark_num_lines = 10000;
+int benchmark_chunk = 100;
+char *benchmark_file = NULL;
+char *benchmark_plugins_dir = NULL;
+
+/* fake connection and functions of irc plugin */
+int benchmark_sock[2] = { -1, -1 };
+struct t_irc_server *benchmark_server = NULL;
+struct t_irc_server *(*benchmark_irc_server_search) (const char *server_name);
+struct t_gui_buffer *(*benchmark_irc_server_create_buffer) (struct t_irc_server *server);
+void (*benchmark_irc_server_msgq_add_buffer) (struct t_irc_server *server,
+                                              const char *buffer);
+void (*benchmark_irc_server_msgq_flush) ();
+void (*benchmark_irc_server_disconnect) (struct t_irc_server *server,
+                                         int switch_address, int reconnect);
+void (*benchmark_irc_message_parse_positions) (struct t_irc_server *server,
+                                               const char *message,
+                                               struct t_irc_message_parsed *parsed);
+
+/* time spent in parts of processing (exclusive time, in nanoseconds) */
+int benchmark_measure = 0;
+long long benchmark_time_parts[BENCHMARK_NUM_PARTS];
+int benchmark_stack[BENCHMARK_MAX_DEPTH];
+int benchmark_stack_depth = 0;
+long long benchmark_stack_time = 0;
+
+/* number of allocations (malloc, calloc, realloc) */
+long long benchmark_allocs = 0;
+
+/* functions of plugin API replaced by wrappers */
+struct t_weechat_plugin benchmark_plugin_api;
+
+/*
+ * Counts allocations: the functions of C library are replaced (glibc only).
+ */
+
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+void *
+malloc (size_t size)
+{
+    benchmark_allocs++;
+    return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+    benchmark_allocs++;
+    return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+    benchmark_allocs++;
+    return __libc_realloc (ptr, size);
+}
+#endif /* __GLIBC__ */
+
+/*
+ * Returns current time of monotonic clock (in nanoseconds).
+ */
+
+long long
+benchmark_get_time ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((long long)ts.tv_sec * 1000000000LL) + ts.tv_nsec;
+}
+
+/*
+ * Enters a part of processing: time since last change is added to the
+ * current part (time of nested parts is not counted in parent part).
+ */
+
+void
+benchmark_part_enter (int part)
+{
+    long long now;
+
+    if (!benchmark_measure)
+        return;
+
+    now = benchmark_get_time ();
+    if ((benchmark_stack_depth > 0)
+        && (benchmark_stack_depth <= BENCHMARK_MAX_DEPTH))
+    {
+        benchmark_time_parts[benchmark_stack[benchmark_stack_depth - 1]] +=
+            now - benchmark_stack_time;
+    }
+    if (benchmark_stack_depth < BENCHMARK_MAX_DEPTH)
+        benchmark_stack[benchmark_stack_depth] = part;
+    benchmark_stack_depth++;
+    benchmark_stack_time = now;
+}
+
+/*
+ * Leaves a part of processing.
+ */
+
+void
+benchmark_part_leave ()
+{
+    long long now;
+
+    if (!benchmark_measure || (benchmark_stack_depth <= 0))
+        return;
+
+    now = benchmark_get_time ();
+    benchmark_stack_depth--;
+    if (benchmark_stack_depth < BENCHMARK_MAX_DEPTH)
+    {
+        benchmark_time_parts[benchmark_stack[benchmark_stack_depth]] +=
+            now - benchmark_stack_time;
+    }
+    benchmark_stack_time = now;
+}
+
+/*
+ * Wrappers for functions of plugin API: time is added to a part of
+ * processing.
+ */
+
+void
+benchmark_printf_date_tags (struct t_gui_buffer *buffer, time_t date,
+                            const char *tags, const char *message, ...)
+{
+    va_list args;
+    char *str;
+    int length;
+
+    if (!message)
+        return;
+
+    benchmark_part_enter (BENCHMARK_PART_PRINT);
+
+    va_start (args, message);
+    length = vsnprintf (NULL, 0, message, args);
+    va_end (args);
+    str = malloc (length + 1);
+    if (str)
+    {
+        va_start (args, message);
+        vsnprintf (str, length + 1, message, args);
+        va_end (args);
+        (benchmark_plugin_api.printf_date_tags) (buffer, date, tags,
+                                                 "%s", str);
+        free (str);
+    }
+
+    benchmark_part_leave ();
+}
+
+char *
+benchmark_hook_modifier_exec (struct t_weechat_plugin *plugin,
+                              const char *modifier,
+                              const char *modifier_data,
+                              const char *string)
+{
+    char *result;
+
+    benchmark_part_enter (BENCHMARK_PART_MODIFIERS);
+    result = (benchmark_plugin_api.hook_modifier_exec) (plugin, modifier,
+                                                        modifier_data,
+                                                        string);
+    benchmark_part_leave ();
+
+    return result;
+}
+
+int
+benchmark_hook_signal_send (const char *signal, const char *type_data,
+                            void *signal_data)
+{
+    int rc;
+
+    benchmark_part_enter (BENCHMARK_PART_SIGNALS);
+    rc = (benchmark_plugin_api.hook_signal_send) (signal, type_data,
+                                                  signal_data);
+    benchmark_part_leave ();
+
+    return rc;
+}
+
+int
+benchmark_hook_hsignal_send (const char *signal,
+                             struct t_hashtable *hashtable)
+{
+    int rc;
+
+    benchmark_part_enter (BENCHMARK_PART_SIGNALS);
+    rc = (benchmark_plugin_api.hook_hsignal_send) (signal, hashtable);
+    benchmark_part_leave ();
+
+    return rc;
+}
+
+void
+benchmark_buffer_set (struct t_gui_buffer *buffer, const char *property,
+                      const char *value)
+{
+    int nicklist;
+
+    /* end of a batch of changes in nicklist updates the nicklist */
+    nicklist = (property && (strncmp (property, "nicklist", 8) == 0));
+    if (nicklist)
+        benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    (benchmark_plugin_api.buffer_set) (buffer, property, value);
+    if (nicklist)
+        benchmark_part_leave ();
+}
+
+struct t_gui_nick_group *
+benchmark_nicklist_add_group (struct t_gui_buffer *buffer,
+                              struct t_gui_nick_group *parent_group,
+                              const char *name, const char *color,
+                              int visible)
+{
+    struct t_gui_nick_group *group;
+
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    group = (benchmark_plugin_api.nicklist_add_group) (buffer, parent_group,
+                                                       name, color, visible);
+    benchmark_part_leave ();
+
+    return group;
+}
+
+struct t_gui_nick_group *
+benchmark_nicklist_search_group (struct t_gui_buffer *buffer,
+                                 struct t_gui_nick_group *from_group,
+                                 const char *name)
+{
+    struct t_gui_nick_group *group;
+
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    group = (benchmark_plugin_api.nicklist_search_group) (buffer, from_group,
+                                                          name);
+    benchmark_part_leave ();
+
+    return group;
+}
+
+struct t_gui_nick *
+benchmark_nicklist_add_nick (struct t_gui_buffer *buffer,
+                             struct t_gui_nick_group *group,
+                             const char *name, const char *color,
+                             const char *prefix, const char *prefix_color,
+                             int visible)
+{
+    struct t_gui_nick *nick;
+
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    nick = (benchmark_plugin_api.nicklist_add_nick) (buffer, group, name,
+                                                     color, prefix,
+                                                     prefix_color, visible);
+    benchmark_part_leave ();
+
+    return nick;
+}
+
+struct t_gui_nick *
+benchmark_nicklist_search_nick (struct t_gui_buffer *buffer,
+                                struct t_gui_nick_group *from_group,
+                                const char *name)
+{
+    struct t_gui_nick *nick;
+
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    nick = (benchmark_plugin_api.nicklist_search_nick) (buffer, from_group,
+                                                        name);
+    benchmark_part_leave ();
+
+    return nick;
+}
+
+void
+benchmark_nicklist_remove_group (struct t_gui_buffer *buffer,
+                                 struct t_gui_nick_group *group)
+{
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    (benchmark_plugin_api.nicklist_remove_group) (buffer, group);
+    benchmark_part_leave ();
+}
+
+void
+benchmark_nicklist_remove_nick (struct t_gui_buffer *buffer,
+                                struct t_gui_nick *nick)
+{
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    (benchmark_plugin_api.nicklist_remove_nick) (buffer, nick);
+    benchmark_part_leave ();
+}
+
+void
+benchmark_nicklist_remove_all (struct t_gui_buffer *buffer)
+{
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    (benchmark_plugin_api.nicklist_remove_all) (buffer);
+    benchmark_part_leave ();
+}
+
+void
+benchmark_nicklist_nick_set (struct t_gui_buffer *buffer,
+                             struct t_gui_nick *nick,
+                             const char *property, const char *value)
+{
+    benchmark_part_enter (BENCHMARK_PART_NICKLIST);
+    (benchmark_plugin_api.nicklist_nick_set) (buffer, nick, property, value);
+    benchmark_part_leave ();
+}
+
+/*
+ * Replaces functions of plugin API used by irc plugin with wrappers (if
+ * "install" is 1), or restores them (if "install" is 0).
+ */
+
+void
+benchmark_wrappers (struct t_weechat_plugin *plugin, int install)
+{
+    if (install)
+    {
+        memcpy (&benchmark_plugin_api, plugin, sizeof (benchmark_plugin_api));
+        plugin->printf_date_tags = &benchmark_printf_date_tags;
+        plugin->hook_modifier_exec = &benchmark_hook_modifier_exec;
+        plugin->hook_signal_send = &benchmark_hook_signal_send;
+        plugin->hook_hsignal_send = &benchmark_hook_hsignal_send;
+        plugin->buffer_set = &benchmark_buffer_set;
+        plugin->nicklist_add_group = &benchmark_nicklist_add_group;
+        plugin->nicklist_search_group = &benchmark_nicklist_search_group;
+        plugin->nicklist_add_nick = &benchmark_nicklist_add_nick;
+        plugin->nicklist_search_nick = &benchmark_nicklist_search_nick;
+        plugin->nicklist_remove_group = &benchmark_nicklist_remove_group;
+        plugin->nicklist_remove_nick = &benchmark_nicklist_remove_nick;
+        plugin->nicklist_remove_all = &benchmark_nicklist_remove_all;
+        plugin->nicklist_nick_set = &benchmark_nicklist_nick_set;
+    }
+    else
+    {
+        plugin->printf_date_tags = benchmark_plugin_api.printf_date_tags;
+        plugin->hook_modifier_exec = benchmark_plugin_api.hook_modifier_exec;
+        plugin->hook_signal_send = benchmark_plugin_api.hook_signal_send;
+        plugin->hook_hsignal_send = benchmark_plugin_api.hook_hsignal_send;
+        plugin->buffer_set = benchmark_plugin_api.buffer_set;
+        plugin->nicklist_add_group = benchmark_plugin_api.nicklist_add_group;
+        plugin->nicklist_search_group = benchmark_plugin_api.nicklist_search_group;
+        plugin->nicklist_add_nick = benchmark_plugin_api.nicklist_add_nick;
+        plugin->nicklist_search_nick = benchmark_plugin_api.nicklist_search_nick;
+        plugin->nicklist_remove_group = benchmark_plugin_api.nicklist_remove_group;
+        plugin->nicklist_remove_nick = benchmark_plugin_api.nicklist_remove_nick;
+        plugin->nicklist_remove_all = benchmark_plugin_api.nicklist_remove_all;
+        plugin->nicklist_nick_set = benchmark_plugin_api.nicklist_nick_set;
+    }
+}
+
+/*
+ * Adds a message in a list of messages.
+ */
+
+void
+benchmark_lines_add (struct t_benchmark_lines *lines, const char *format, ...)
+{
+    va_list args;
+    char message[4096], **new_lines;
+    int new_alloc;
+
+    va_start (args, format);
+    vsnprintf (message, sizeof (message), format, args);
+    va_end (args);
+
+    if (lines->count >= lines->alloc)
+    {
+        new_alloc = (lines->alloc < 64) ? 64 : lines->alloc * 2;
+        new_lines = realloc (lines->lines, new_alloc * sizeof (*new_lines));
+        if (!new_lines)
+            return;
+        lines->lines = new_lines;
+        lines->alloc = new_alloc;
+    }
+    lines->lines[lines->count] = strdup (message);
+    if (lines->lines[lines->count])
+        lines->count++;
+}
+
+/*
+ * Frees messages in a list.
+ */
+
+void
+benchmark_lines_free (struct t_benchmark_lines *lines)
+{
+    int i;
+
+    for (i = 0; i < lines->count; i++)
+    {
+        free (lines->lines[i]);
+    }
+    if (lines->lines)
+        free (lines->lines);
+    lines->lines = NULL;
+    lines->count = 0;
+    lines->alloc = 0;
+}
+
+/*
+ * Adds messages to join a channel with "num_nicks" other nicks.
+ */
+
+void
+benchmark_lines_join_channel (struct t_benchmark_lines *lines,
+                              const char *channel, int num_nicks)
+{
+    char names[BENCHMARK_NAMES_PER_LINE * 32];
+    int i, length;
+
+    benchmark_lines_add (lines, ":%s!~%s@localhost JOIN %s",
+                         BENCHMARK_NICK, BENCHMARK_NICK, channel);
+    names[0] = '\0';
+    length = 0;
+    for (i = 0; i < num_nicks; i++)
+    {
+        length += snprintf (names + length, sizeof (names) - length,
+                            "%s%snick%d",
+                            (length > 0) ? " " : "",
+                            (i % 20 == 0) ? "@" : ((i % 5 == 0) ? "+" : ""),
+                            i);
+        if ((i % BENCHMARK_NAMES_PER_LINE) == BENCHMARK_NAMES_PER_LINE - 1)
+        {
+            benchmark_lines_add (lines, ":irc.bench 353 %s = %s :%s",
+                                 BENCHMARK_NICK, channel, names);
+            names[0] = '\0';
+            length = 0;
+        }
+    }
+    benchmark_lines_add (lines, ":irc.bench 353 %s = %s :@%s%s%s",
+                         BENCHMARK_NICK, channel, BENCHMARK_NICK,
+                         (length > 0) ? " " : "", names);
+    benchmark_lines_add (lines, ":irc.bench 366 %s %s :End of /NAMES list.",
+                         BENCHMARK_NICK, channel);
+}
+
+/*
+ * Builds messages of a scenario: messages in "setup" are processed before
+ * the measure, messages in "lines" are measured.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_build_scenario (int scenario, struct t_benchmark_lines *setup,
+                          struct t_benchmark_lines *lines)
+{
+    FILE *file;
+    char line[8192], *pos;
+    int i;
+
+    switch (scenario)
+    {
+        case BENCHMARK_SCENARIO_JOIN:
+            benchmark_lines_join_channel (setup, "#join", 0);
+            for (i = 0; i < benchmark_num_lines; i++)
+            {
+                benchmark_lines_add (
+                    lines,
+                    ":nick%d!~user%d@host%d.example.com JOIN #join",
+                    i, i, i);
+            }
+            break;
+        case BENCHMARK_SCENARIO_NETSPLIT:
+            benchmark_lines_join_channel (setup, "#netsplit",
+                                          benchmark_num_lines);
+            for (i = 0; i < benchmark_num_lines; i++)
+            {
+                benchmark_lines_add (
+                    lines,
+                    ":nick%d!~user%d@host%d.example.com QUIT "
+                    ":irc1.example.com irc2.example.com",
+                    i, i, i);
+            }
+            break;
+        case BENCHMARK_SCENARIO_FLOOD:
+            benchmark_lines_join_channel (setup, "#flood",
+                                          BENCHMARK_FLOOD_NICKS);
+            for (i = 0; i < benchmark_num_lines; i++)
+            {
+                benchmark_lines_add (
+                    lines,
+                    "@time=2017-03-12T10:%02d:%02d.000Z "
+                    ":nick%d!~user%d@host%d.example.com PRIVMSG #flood "
+                    ":this is message %d in the flood of messages%s",
+                    (i / 60) % 60, i % 60,
+                    i % BENCHMARK_FLOOD_NICKS, i % BENCHMARK_FLOOD_NICKS,
+                    i % BENCHMARK_FLOOD_NICKS, i,
+                    (i % 10 == 0) ? ", hello " BENCHMARK_NICK : "");
+            }
+            break;
+        case BENCHMARK_SCENARIO_FILE:
+            file = fopen (benchmark_file, "r");
+            if (!file)
+            {
+                fprintf (stderr, "Error: unable to read file \"%s\"\n",
+                         benchmark_file);
+                return 0;
+            }
+            while (fgets (line, sizeof (line), file))
+            {
+                pos = strpbrk (line, "\r\n");
+                if (pos)
+                    pos[0] = '\0';
+                if (line[0])
+                    benchmark_lines_add (lines, "%s", line);
+            }
+            fclose (file);
+            break;
+    }
+
+    return 1;
+}
+
+/*
+ * Discards data sent by WeeChat to the fake server.
+ */
+
+void
+benchmark_drain_socket ()
+{
+    char buffer[65536];
+
+    while (read (benchmark_sock[1], buffer, sizeof (buffer)) > 0)
+    {
+    }
+}
+
+/*
+ * Feeds messages in queue of received messages of server, by chunks.
+ */
+
+void
+benchmark_feed_lines (struct t_benchmark_lines *lines)
+{
+    char *buffer;
+    int i, j, length;
+
+    for (i = 0; i < lines->count; i += benchmark_chunk)
+    {
+        length = 0;
+        for (j = i; (j < lines->count) && (j < i + benchmark_chunk); j++)
+        {
+            length += strlen (lines->lines[j]) + 2;
+        }
+        buffer = malloc (length + 1);
+        if (!buffer)
+            return;
+        buffer[0] = '\0';
+        length = 0;
+        for (j = i; (j < lines->count) && (j < i + benchmark_chunk); j++)
+        {
+            length += sprintf (buffer + length, "%s\r\n", lines->lines[j]);
+        }
+        benchmark_irc_server_msgq_add_buffer (benchmark_server, buffer);
+        benchmark_irc_server_msgq_flush ();
+        free (buffer);
+        benchmark_drain_socket ();
+    }
+}
+
+/*
+ * Returns time to parse the messages (in nanoseconds).
+ */
+
+long long
+benchmark_parse_lines (struct t_benchmark_lines *lines)
+{
+    struct t_irc_message_parsed parsed;
+    long long start;
+    int i;
+
+    start = benchmark_get_time ();
+    for (i = 0; i < lines->count; i++)
+    {
+        benchmark_irc_message_parse_positions (benchmark_server,
+                                               lines->lines[i], &parsed);
+    }
+    return benchmark_get_time () - start;
+}
+
+/*
+ * Runs a scenario and displays results.
+ */
+
+void
+benchmark_run_scenario (int scenario)
+{
+    struct t_benchmark_lines setup, lines;
+    long long start, elapsed, allocs, time_parse, time_callbacks;
+    double count;
+    int i;
+
+    memset (&setup, 0, sizeof (setup));
+    memset (&lines, 0, sizeof (lines));
+
+    if (!benchmark_build_scenario (scenario, &setup, &lines)
+        || (lines.count == 0))
+    {
+        benchmark_lines_free (&setup);
+        benchmark_lines_free (&lines);
+        return;
+    }
+
+    benchmark_feed_lines (&setup);
+
+    /* measure */
+    for (i = 0; i < BENCHMARK_NUM_PARTS; i++)
+    {
+        benchmark_time_parts[i] = 0;
+    }
+    benchmark_stack_depth = 0;
+    benchmark_measure = 1;
+    benchmark_part_enter (BENCHMARK_PART_IRC);
+    allocs = benchmark_allocs;
+    start = benchmark_get_time ();
+    benchmark_feed_lines (&lines);
+    elapsed = benchmark_get_time () - start;
+    allocs = benchmark_allocs - allocs;
+    benchmark_part_leave ();
+    benchmark_measure = 0;
+
+    time_parse = benchmark_parse_lines (&lines);
+    time_callbacks = benchmark_time_parts[BENCHMARK_PART_IRC] - time_parse;
+    if (time_callbacks < 0)
+        time_callbacks = 0;
+
+    count = lines.count;
+    printf ("%s\t%d\t%.0f\t%.1f\t%.0f\t%.0f\t%.0f\t%.0f\t%.0f\t%.0f\n",
+            benchmark_scenario_string[scenario],
+            lines.count,
+            (elapsed > 0) ? count * 1000000000.0 / (double)elapsed : 0,
+#ifdef __GLIBC__
+            (double)allocs / count,
+#else
+            -1.0,
+#endif /* __GLIBC__ */
+            (double)time_parse / count,
+            (double)benchmark_time_parts[BENCHMARK_PART_MODIFIERS] / count,
+            (double)benchmark_time_parts[BENCHMARK_PART_SIGNALS] / count,
+            (double)time_callbacks / count,
+            (double)benchmark_time_parts[BENCHMARK_PART_PRINT] / count,
+            (double)benchmark_time_parts[BENCHMARK_PART_NICKLIST] / count);
+
+    benchmark_lines_free (&setup);
+    benchmark_lines_free (&lines);
+}
+
+/*
+ * Creates server and simulates the connection (welcome messages).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_connect (struct t_weechat_plugin *plugin)
+{
+    struct t_benchmark_lines lines;
+    int i;
+
+    benchmark_irc_server_search = dlsym (plugin->handle,
+                                         "irc_server_search");
+    benchmark_irc_server_create_buffer = dlsym (plugin->handle,
+                                                "irc_server_create_buffer");
+    benchmark_irc_server_msgq_add_buffer = dlsym (plugin->handle,
+                                                  "irc_server_msgq_add_buffer");
+    benchmark_irc_server_msgq_flush = dlsym (plugin->handle,
+                                             "irc_server_msgq_flush");
+    benchmark_irc_server_disconnect = dlsym (plugin->handle,
+                                             "irc_server_disconnect");
+    benchmark_irc_message_parse_positions = dlsym (plugin->handle,
+                                                   "irc_message_parse_positions");
+    if (!benchmark_irc_server_search
+        || !benchmark_irc_server_create_buffer
+        || !benchmark_irc_server_msgq_add_buffer
+        || !benchmark_irc_server_msgq_flush
+        || !benchmark_irc_server_disconnect
+        || !benchmark_irc_message_parse_positions)
+    {
+        fprintf (stderr, "Error: functions not found in irc plugin\n");
+        return 0;
+    }
+
+    input_data (gui_buffer_search_main (),
+                "/server add " BENCHMARK_SERVER " 127.0.0.1/6667");
+    input_data (gui_buffer_search_main (),
+                "/set irc.server." BENCHMARK_SERVER ".nicks \""
+                BENCHMARK_NICK "\"");
+    benchmark_server = benchmark_irc_server_search (BENCHMARK_SERVER);
+    if (!benchmark_server)
+    {
+        fprintf (stderr, "Error: unable to create server\n");
+        return 0;
+    }
+
+    /* messages sent by WeeChat are written in a local socket */
+    if (socketpair (AF_UNIX, SOCK_STREAM, 0, benchmark_sock) < 0)
+    {
+        fprintf (stderr, "Error: unable to create socket: %s\n",
+                 strerror (errno));
+        return 0;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        fcntl (benchmark_sock[i], F_SETFL,
+               fcntl (benchmark_sock[i], F_GETFL) | O_NONBLOCK);
+    }
+
+    if (!benchmark_irc_server_create_buffer (benchmark_server))
+    {
+        fprintf (stderr, "Error: unable to create server buffer\n");
+        return 0;
+    }
+    benchmark_server->sock = benchmark_sock[0];
+
+    memset (&lines, 0, sizeof (lines));
+    benchmark_lines_add (&lines, ":irc.bench 001 %s :Welcome %s",
+                         BENCHMARK_NICK, BENCHMARK_NICK);
+    benchmark_lines_add (&lines,
+                         ":irc.bench 005 %s CHANTYPES=# PREFIX=(ov)@+ "
+                         "NETWORK=bench CASEMAPPING=rfc1459 NICKLEN=30 "
+                         ":are supported by this server",
+                         BENCHMARK_NICK);
+    benchmark_lines_add (&lines, ":irc.bench 376 %s :End of /MOTD command.",
+                         BENCHMARK_NICK);
+    benchmark_feed_lines (&lines);
+    benchmark_lines_free (&lines);
+
+    if (!benchmark_server->is_connected)
+    {
+        fprintf (stderr, "Error: server not connected\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Hides (redirects to /dev/null) or restores standard output.
+ */
+
+void
+benchmark_hide_stdout (int hide, int stdout_fd)
+{
+    int fd;
+
+    fflush (stdout);
+    if (hide)
+    {
+        fd = open ("/dev/null", O_WRONLY);
+        if (fd >= 0)
+        {
+            dup2 (fd, STDOUT_FILENO);
+            close (fd);
+        }
+    }
+    else
+    {
+        dup2 (stdout_fd, STDOUT_FILENO);
+    }
+}
+
+/*
+ * Removes a file (callback for util_exec_on_files).
+ */
+
+void
+benchmark_remove_file_cb (void *data, const char *filename)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    unlink (filename);
+}
+
+/*
+ * Removes a directory with its content.
+ */
+
+void
+benchmark_remove_dir (const char *path)
+{
+    util_exec_on_files (path, 1, &benchmark_remove_file_cb, NULL);
+    rmdir (path);
+}
+
+/*
+ * Displays help.
+ */
+
+void
+benchmark_display_help (const char *name)
+{
+    printf ("Usage: %s [option...]\n", name);
+    printf ("\n");
+    printf ("Benchmark of irc plugin: WeeChat is started without "
+            "interface and\n"
+            "messages are added directly in the queue of received "
+            "messages of a server.\n");
+    printf ("\n");
+    printf ("  -s, --scenario <name>    scenario: join, netsplit, flood "
+            "(default: all)\n");
+    printf ("  -f, --file <file>        read messages in file "
+            "(one raw message per line)\n");
+    printf ("  -n, --lines <n>          number of messages in scenarios "
+            "(default: 10000)\n");
+    printf ("  -c, --chunk <n>          number of messages received at "
+            "once (default: 100)\n");
+    printf ("  -P, --plugins-dir <dir>  directory with compiled plugins\n"
+            "                           (default: %s)\n",
+            BENCHMARK_PLUGINS_DIR);
+    printf ("  -h, --help               display this help\n");
+    printf ("\n");
+    printf ("Output is one line per scenario, with fields separated by "
+            "tabs:\n"
+            "  scenario, lines, lines/s, allocations/line and time per "
+            "line (in ns)\n"
+            "  spent in: parse, modifiers, signals, callbacks, print, "
+            "nicklist.\n");
+    printf ("\n");
+}
+
+/*
+ * Parses command line arguments.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_parse_args (int argc, char *argv[])
+{
+    struct option long_options[] = {
+        { "scenario",    required_argument, NULL, 's' },
+        { "file",        required_argument, NULL, 'f' },
+        { "lines",       required_argument, NULL, 'n' },
+        { "chunk",       required_argument, NULL, 'c' },
+        { "plugins-dir", required_argument, NULL, 'P' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL,          0,                 NULL, 0   },
+    };
+    int i, opt;
+
+    while ((opt = getopt_long (argc, argv, "s:f:n:c:P:h",
+                               long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                benchmark_scenario = -1;
+                for (i = 0; i < BENCHMARK_SCENARIO_FILE; i++)
+                {
+                    if (strcmp (optarg, benchmark_scenario_string[i]) == 0)
+                    {
+                        benchmark_scenario = i;
+                        break;
+                    }
+                }
+                if (benchmark_scenario < 0)
+                {
+                    fprintf (stderr, "Error: invalid scenario: %s\n",
+                             optarg);
+                    return 0;
+                }
+                break;
+            case 'f':
+                benchmark_file = optarg;
+                benchmark_scenario = BENCHMARK_SCENARIO_FILE;
+                break;
+            case 'n':
+                benchmark_num_lines = atoi (optarg);
+                break;
+            case 'c':
+                benchmark_chunk = atoi (optarg);
+                break;
+            case 'P':
+                benchmark_plugins_dir = optarg;
+                break;
+            default:
+                benchmark_display_help (argv[0]);
+                return 0;
+        }
+    }
+
+    if ((benchmark_num_lines <= 0) || (benchmark_chunk <= 0))
+    {
+        fprintf (stderr, "Error: invalid arguments\n");
+        return 0;
+    }
+
+    if (!benchmark_plugins_dir)
+        benchmark_plugins_dir = BENCHMARK_PLUGINS_DIR;
+
+    return 1;
+}
+
+/*
+ * Runs benchmark of irc plugin.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    char weechat_dir[] = "/tmp/weechat_benchmark_XXXXXX";
+    char *weechat_argv[] = { argv[0], "--dir", weechat_dir, "--no-plugin",
+                             NULL };
+    char command[4096];
+    struct t_weechat_plugin *ptr_plugin;
+    int i, rc, stdout_fd;
+
+    if (!benchmark_parse_args (argc, argv))
+        return 1;
+
+    /* setup environment: default language, no specific timezone */
+    setenv ("LC_ALL", "C", 1);
+    setenv ("TZ", "", 1);
+
+    /* display output as soon as possible (it can be piped) */
+    setvbuf (stdout, NULL, _IOLBF, 0);
+
+    /* WeeChat home is a new temporary directory, removed on exit */
+    if (!mkdtemp (weechat_dir))
+    {
+        fprintf (stderr, "Error: unable to create directory %s\n",
+                 weechat_dir);
+        return 1;
+    }
+
+    /*
+     * init WeeChat (Curses calls are made with the fake ncurses library),
+     * terminal sequences sent by WeeChat are hidden so that the output
+     * contains only results
+     */
+    stdout_fd = dup (STDOUT_FILENO);
+    benchmark_hide_stdout (1, stdout_fd);
+    weechat_init (4, weechat_argv, &gui_main_init);
+    benchmark_hide_stdout (0, stdout_fd);
+
+    snprintf (command, sizeof (command),
+              "/plugin load %s/irc/" BENCHMARK_PLUGINS_LIBDIR "irc.so",
+              benchmark_plugins_dir);
+    input_data (gui_buffer_search_main (), command);
+    ptr_plugin = plugin_search ("irc");
+    if (!ptr_plugin)
+    {
+        fprintf (stderr,
+                 "Error: unable to load plugin irc from directory \"%s\"\n",
+                 benchmark_plugins_dir);
+        benchmark_hide_stdout (1, stdout_fd);
+        weechat_end (&gui_main_end);
+        benchmark_hide_stdout (0, stdout_fd);
+        close (stdout_fd);
+        benchmark_remove_dir (weechat_dir);
+        return 1;
+    }
+
+    rc = 0;
+    if (benchmark_connect (ptr_plugin))
+    {
+        benchmark_wrappers (ptr_plugin, 1);
+
+        printf ("# scenario\tlines\tlines/s\tallocs/line\tparse\t"
+                "modifiers\tsignals\tcallbacks\tprint\tnicklist\n");
+        for (i = 0; i < BENCHMARK_SCENARIO_FILE; i++)
+        {
+            if ((benchmark_scenario < 0) || (benchmark_scenario == i))
+                benchmark_run_scenario (i);
+        }
+        if (benchmark_scenario == BENCHMARK_SCENARIO_FILE)
+            benchmark_run_scenario (BENCHMARK_SCENARIO_FILE);
+
+        benchmark_wrappers (ptr_plugin, 0);
+    }
+    else
+    {
+        rc = 1;
+    }
+
+    if (benchmark_server && (benchmark_server->sock >= 0))
+        benchmark_irc_server_disconnect (benchmark_server, 0, 0);
+    if (benchmark_sock[1] >= 0)
+        close (benchmark_sock[1]);
+
+    benchmark_hide_stdout (1, stdout_fd);
+    weechat_end (&gui_main_end);
+    benchmark_hide_stdout (0, stdout_fd);
+    close (stdout_fd);
+    benchmark_remove_dir (weechat_dir);
+
+    return rc;
+}
@@ -0,0 +1,1524 @@
+/*
+ * relay-benchmark.c - benchmark of relay plugin (weechat and irc protocols)
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program runs WeeChat without interface (with the fake ncurses
+ * library used by tests), loads irc and relay plugins, then in a separate
+ * thread:
+ *
+ *   1. runs a fake IRC server, which WeeChat connects to (channel "#bench"),
+ *   2. connects simulated relay clients (weechat and irc protocols, with
+ *      optional compression and websocket),
+ *   3. sends lines in the channel at a fixed rate: each line contains its
+ *      sequence number and the time it was sent, so that clients can compute
+ *      the delivery latency,
+ *   4. displays messages/s, bytes/s, latency (p50/p99) and CPU time used by
+ *      WeeChat per client.
+ *
+ * All sockets of the benchmark are on the loopback interface.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include "src/core/weechat.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-util.h"
+#include "src/plugins/plugin.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-main.h"
+
+extern void gui_main_init ();
+
+#ifndef BENCHMARK_PLUGINS_DIR
+#define BENCHMARK_PLUGINS_DIR "../src/plugins"
+#endif
+#ifndef BENCHMARK_PLUGINS_LIBDIR
+#define BENCHMARK_PLUGINS_LIBDIR ""
+#endif
+
+#define BENCHMARK_PASSWORD "bench"
+#define BENCHMARK_CHANNEL "#bench"
+#define BENCHMARK_TAG "BENCH "
+#define BENCHMARK_TIMEOUT 10           /* timeout for connections (seconds) */
+#define BENCHMARK_WARMUP 1000          /* delay before measures (ms)        */
+#define BENCHMARK_DRAIN 5000           /* max wait for last lines (ms)      */
+
+enum t_benchmark_protocol
+{
+    BENCHMARK_PROTOCOL_WEECHAT = 0,
+    BENCHMARK_PROTOCOL_IRC,
+    /* number of protocols */
+    BENCHMARK_NUM_PROTOCOLS,
+};
+
+enum t_benchmark_compression
+{
+    BENCHMARK_COMPRESSION_OFF = 0,
+    BENCHMARK_COMPRESSION_ZLIB,
+    BENCHMARK_COMPRESSION_ZLIB_STREAM,
+    /* number of compressions */
+    BENCHMARK_NUM_COMPRESSIONS,
+};
+
+char *benchmark_protocol_string[] = { "weechat", "irc" };
+char *benchmark_compression_string[] = { "off", "zlib", "zlib_stream" };
+
+struct t_benchmark_buffer
+{
+    char *data;                        /* data (can be NULL)                */
+    int size;                          /* size of data                      */
+    int alloc;                         /* allocated size                    */
+};
+
+struct t_benchmark_client
+{
+    int protocol;                      /* weechat or irc                    */
+    int sock;                          /* socket (connected to relay)       */
+    int connected;                     /* 0 if connection was closed        */
+    struct t_benchmark_buffer raw;     /* raw data received (websocket)     */
+    struct t_benchmark_buffer stream;  /* data of protocol                  */
+    z_stream *zstream;                 /* zlib stream (compression stream)  */
+    long long messages;                /* number of messages received       */
+    long long bytes;                   /* number of bytes received          */
+    long long lines;                   /* number of benchmark lines recvd   */
+};
+
+struct t_benchmark_stats
+{
+    int clients;                       /* number of clients                 */
+    long long messages;                /* number of messages received       */
+    long long bytes;                   /* number of bytes received          */
+    long long lines;                   /* number of benchmark lines recvd   */
+    unsigned int *latency;             /* latency of lines (microseconds)   */
+    long long latency_count;           /* number of latencies               */
+    long long latency_alloc;           /* allocated size for latencies      */
+};
+
+/* options */
+int benchmark_port = 9000;
+int benchmark_clients[BENCHMARK_NUM_PROTOCOLS] = { 10, 10 };
+int benchmark_compression = BENCHMARK_COMPRESSION_OFF;
+int benchmark_websocket = 0;
+int benchmark_rate = 100;
+int benchmark_duration = 10;
+int benchmark_length = 64;
+char *benchmark_plugins_dir = NULL;
+
+/* state */
+int benchmark_ircd_listen = -1;
+int benchmark_ircd_sock = -1;
+struct t_benchmark_buffer benchmark_ircd_buffer;
+struct t_benchmark_client *benchmark_clients_list = NULL;
+int benchmark_clients_count = 0;
+struct t_benchmark_stats benchmark_stats[BENCHMARK_NUM_PROTOCOLS];
+clockid_t benchmark_cpu_clock;
+volatile sig_atomic_t benchmark_done = 0;
+int benchmark_rc = 0;
+
+
+/*
+ * Returns current monotonic time in nanoseconds.
+ */
+
+unsigned long long
+benchmark_time_ns ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/*
+ * Returns CPU time used by WeeChat main thread in nanoseconds.
+ */
+
+unsigned long long
+benchmark_cpu_ns ()
+{
+    struct timespec ts;
+
+    if (clock_gettime (benchmark_cpu_clock, &ts) != 0)
+        return 0;
+    return ((unsigned long long)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/*
+ * Appends data to a buffer.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (memory)
+ */
+
+int
+benchmark_buffer_append (struct t_benchmark_buffer *buffer,
+                         const void *data, int size)
+{
+    char *new_data;
+    int new_alloc;
+
+    if (buffer->size + size > buffer->alloc)
+    {
+        new_alloc = (buffer->alloc > 0) ? buffer->alloc : 4096;
+        while (new_alloc < buffer->size + size)
+        {
+            new_alloc *= 2;
+        }
+        new_data = realloc (buffer->data, new_alloc);
+        if (!new_data)
+            return 0;
+        buffer->data = new_data;
+        buffer->alloc = new_alloc;
+    }
+    memcpy (buffer->data + buffer->size, data, size);
+    buffer->size += size;
+
+    return 1;
+}
+
+/*
+ * Removes "size" bytes at beginning of a buffer.
+ */
+
+void
+benchmark_buffer_consume (struct t_benchmark_buffer *buffer, int size)
+{
+    if (size >= buffer->size)
+    {
+        buffer->size = 0;
+        return;
+    }
+    memmove (buffer->data, buffer->data + size, buffer->size - size);
+    buffer->size -= size;
+}
+
+/*
+ * Sends all data on a socket (socket can be non-blocking).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_send (int sock, const void *data, int size)
+{
+    struct pollfd pfd;
+    int num_sent;
+
+    while (size > 0)
+    {
+        num_sent = send (sock, data, size, MSG_NOSIGNAL);
+        if (num_sent < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                pfd.fd = sock;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                if (poll (&pfd, 1, BENCHMARK_TIMEOUT * 1000) <= 0)
+                    return 0;
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        data = (const char *)data + num_sent;
+        size -= num_sent;
+    }
+
+    return 1;
+}
+
+/*
+ * Connects to a port on loopback interface (blocking socket).
+ *
+ * Returns socket, -1 if error.
+ */
+
+int
+benchmark_connect (int port)
+{
+    struct sockaddr_in addr;
+    struct timeval tv;
+    int sock, set;
+
+    sock = socket (AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if (connect (sock, (struct sockaddr *)&addr, sizeof (addr)) < 0)
+    {
+        close (sock);
+        return -1;
+    }
+
+    set = 1;
+    setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, &set, sizeof (set));
+    tv.tv_sec = BENCHMARK_TIMEOUT;
+    tv.tv_usec = 0;
+    setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+
+    return sock;
+}
+
+/*
+ * Sends a message to relay: in a websocket frame if websocket is enabled,
+ * otherwise as-is.
+ *
+ * Frames sent by a client must be masked: a null mask is used, so that the
+ * payload is sent unchanged.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_client_send (struct t_benchmark_client *client, const char *message)
+{
+    unsigned char header[14];
+    int length, header_length;
+
+    length = strlen (message);
+
+    if (benchmark_websocket)
+    {
+        header[0] = 0x81;              /* FIN + text frame */
+        if (length <= 125)
+        {
+            header[1] = 0x80 | length;
+            header_length = 2;
+        }
+        else
+        {
+            header[1] = 0x80 | 126;
+            header[2] = (length >> 8) & 0xFF;
+            header[3] = length & 0xFF;
+            header_length = 4;
+        }
+        memset (header + header_length, 0, 4);  /* null mask */
+        header_length += 4;
+        if (!benchmark_send (client->sock, header, header_length))
+            return 0;
+    }
+
+    return benchmark_send (client->sock, message, length);
+}
+
+/*
+ * Upgrades connection to websocket (HTTP handshake).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_client_websocket_handshake (struct t_benchmark_client *client)
+{
+    const char *request = "GET /weechat HTTP/1.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Host: localhost\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    char buffer[4096];
+    int size, num_read;
+
+    if (!benchmark_send (client->sock, request, strlen (request)))
+        return 0;
+
+    size = 0;
+    while (size < (int)sizeof (buffer) - 1)
+    {
+        num_read = recv (client->sock, buffer + size,
+                         sizeof (buffer) - 1 - size, 0);
+        if (num_read <= 0)
+            return 0;
+        size += num_read;
+        buffer[size] = '\0';
+        if (strstr (buffer, "\r\n\r\n"))
+            return (strncmp (buffer, "HTTP/1.1 101", 12) == 0) ? 1 : 0;
+    }
+
+    return 0;
+}
+
+/*
+ * Connects a client to relay and sends the commands to start receiving
+ * messages.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_client_connect (struct t_benchmark_client *client, int protocol,
+                          int number)
+{
+    char message[256];
+    int flags;
+
+    memset (client, 0, sizeof (*client));
+    client->protocol = protocol;
+    client->sock = benchmark_connect (
+        benchmark_port + ((protocol == BENCHMARK_PROTOCOL_IRC) ? 1 : 0));
+    if (client->sock < 0)
+        return 0;
+    client->connected = 1;
+
+    if (benchmark_websocket
+        && !benchmark_client_websocket_handshake (client))
+    {
+        return 0;
+    }
+
+    switch (protocol)
+    {
+        case BENCHMARK_PROTOCOL_WEECHAT:
+            snprintf (message, sizeof (message),
+                      "init password=%s,compression=%s\n",
+                      BENCHMARK_PASSWORD,
+                      benchmark_compression_string[benchmark_compression]);
+            if (!benchmark_client_send (client, message))
+                return 0;
+            if (!benchmark_client_send (client, "sync\n"))
+                return 0;
+            break;
+        case BENCHMARK_PROTOCOL_IRC:
+            snprintf (message, sizeof (message),
+                      "PASS %s\r\n",
+                      BENCHMARK_PASSWORD);
+            if (!benchmark_client_send (client, message))
+                return 0;
+            snprintf (message, sizeof (message),
+                      "NICK bench%d\r\n"
+                      "USER bench%d 0 * :bench%d\r\n",
+                      number, number, number);
+            if (!benchmark_client_send (client, message))
+                return 0;
+            break;
+    }
+
+    flags = fcntl (client->sock, F_GETFL);
+    if (flags == -1)
+        flags = 0;
+    fcntl (client->sock, F_SETFL, flags | O_NONBLOCK);
+
+    return 1;
+}
+
+/*
+ * Searches benchmark lines in data received by a client and records their
+ * latency.
+ */
+
+void
+benchmark_client_search_lines (struct t_benchmark_client *client,
+                               const char *data, int size,
+                               unsigned long long now)
+{
+    struct t_benchmark_stats *stats;
+    const char *ptr_data, *ptr_tag;
+    char numbers[64], *pos;
+    unsigned long long time_sent;
+    unsigned int *new_latency;
+    long long new_alloc;
+    int length;
+
+    stats = &benchmark_stats[client->protocol];
+    ptr_data = data;
+
+    while (size > 0)
+    {
+        ptr_tag = memchr (ptr_data, BENCHMARK_TAG[0], size);
+        if (!ptr_tag)
+            break;
+        if ((size - (ptr_tag - ptr_data) < (int)strlen (BENCHMARK_TAG))
+            || (memcmp (ptr_tag, BENCHMARK_TAG, strlen (BENCHMARK_TAG)) != 0))
+        {
+            size -= (ptr_tag - ptr_data) + 1;
+            ptr_data = ptr_tag + 1;
+            continue;
+        }
+        size -= (ptr_tag - ptr_data) + strlen (BENCHMARK_TAG);
+        ptr_data = ptr_tag + strlen (BENCHMARK_TAG);
+        /* line is "BENCH <seq> <time_sent> xxx..." */
+        length = (size < (int)sizeof (numbers) - 1) ?
+            size : (int)sizeof (numbers) - 1;
+        memcpy (numbers, ptr_data, length);
+        numbers[length] = '\0';
+        (void) strtoull (numbers, &pos, 10);
+        if ((pos == numbers) || (pos[0] != ' '))
+            continue;
+        time_sent = strtoull (pos + 1, NULL, 10);
+        if ((time_sent == 0) || (time_sent > now))
+            continue;
+        client->lines++;
+        if (stats->latency_count >= stats->latency_alloc)
+        {
+            new_alloc = (stats->latency_alloc > 0) ?
+                stats->latency_alloc * 2 : 65536;
+            new_latency = realloc (stats->latency,
+                                   new_alloc * sizeof (*new_latency));
+            if (!new_latency)
+                continue;
+            stats->latency = new_latency;
+            stats->latency_alloc = new_alloc;
+        }
+        stats->latency[stats->latency_count++] =
+            (unsigned int)((now - time_sent) / 1000);
+    }
+}
+
+/*
+ * Decompresses a message of weechat protocol.
+ *
+ * Returns:
+ *   1: OK (data is in "output")
+ *   0: error
+ */
+
+int
+benchmark_client_decompress (struct t_benchmark_client *client,
+                             int compression,
+                             const char *data, int size,
+                             struct t_benchmark_buffer *output)
+{
+    char buffer[65536], *new_data;
+    uLongf dest_size;
+    int rc;
+
+    output->size = 0;
+
+    switch (compression)
+    {
+        case BENCHMARK_COMPRESSION_ZLIB:
+            dest_size = (output->alloc > size * 8) ? output->alloc : size * 8;
+            while (1)
+            {
+                if ((int)dest_size > output->alloc)
+                {
+                    new_data = realloc (output->data, dest_size);
+                    if (!new_data)
+                        return 0;
+                    output->data = new_data;
+                    output->alloc = dest_size;
+                }
+                rc = uncompress ((Bytef *)output->data, &dest_size,
+                                 (const Bytef *)data, size);
+                if (rc == Z_OK)
+                {
+                    output->size = dest_size;
+                    return 1;
+                }
+                if (rc != Z_BUF_ERROR)
+                    return 0;
+                dest_size = output->alloc * 2;
+            }
+            break;
+        case BENCHMARK_COMPRESSION_ZLIB_STREAM:
+            if (!client->zstream)
+            {
+                client->zstream = calloc (1, sizeof (*client->zstream));
+                if (!client->zstream)
+                    return 0;
+                if (inflateInit (client->zstream) != Z_OK)
+                {
+                    free (client->zstream);
+                    client->zstream = NULL;
+                    return 0;
+                }
+            }
+            client->zstream->next_in = (Bytef *)data;
+            client->zstream->avail_in = size;
+            do
+            {
+                client->zstream->next_out = (Bytef *)buffer;
+                client->zstream->avail_out = sizeof (buffer);
+                rc = inflate (client->zstream, Z_SYNC_FLUSH);
+                if ((rc != Z_OK) && (rc != Z_BUF_ERROR))
+                    return 0;
+                if (!benchmark_buffer_append (
+                        output, buffer,
+                        sizeof (buffer) - client->zstream->avail_out))
+                {
+                    return 0;
+                }
+            } while (client->zstream->avail_out == 0);
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Parses messages of weechat protocol received by a client.
+ */
+
+void
+benchmark_client_parse_weechat (struct t_benchmark_client *client,
+                                unsigned long long now)
+{
+    static struct t_benchmark_buffer output = { NULL, 0, 0 };
+    char *ptr_msg;
+    uint32_t length;
+    int pos;
+
+    pos = 0;
+    while (client->stream.size - pos >= 5)
+    {
+        ptr_msg = client->stream.data + pos;
+        memcpy (&length, ptr_msg, 4);
+        length = ntohl (length);
+        if (length < 5)
+        {
+            client->connected = 0;
+            pos = client->stream.size;
+            break;
+        }
+        if ((int)length > client->stream.size - pos)
+            break;
+        client->messages++;
+        if (ptr_msg[4] == 0)
+        {
+            benchmark_client_search_lines (client, ptr_msg + 5, length - 5,
+                                           now);
+        }
+        else if (benchmark_client_decompress (
+                     client,
+                     (ptr_msg[4] == 1) ?
+                     BENCHMARK_COMPRESSION_ZLIB :
+                     BENCHMARK_COMPRESSION_ZLIB_STREAM,
+                     ptr_msg + 5, length - 5, &output))
+        {
+            benchmark_client_search_lines (client, output.data, output.size,
+                                           now);
+        }
+        pos += length;
+    }
+
+    benchmark_buffer_consume (&client->stream, pos);
+}
+
+/*
+ * Parses messages of irc protocol received by a client.
+ */
+
+void
+benchmark_client_parse_irc (struct t_benchmark_client *client,
+                            unsigned long long now)
+{
+    char *ptr_msg, *ptr_end;
+    int pos;
+
+    pos = 0;
+    while (pos < client->stream.size)
+    {
+        ptr_msg = client->stream.data + pos;
+        ptr_end = memchr (ptr_msg, '\n', client->stream.size - pos);
+        if (!ptr_end)
+            break;
+        client->messages++;
+        benchmark_client_search_lines (client, ptr_msg, ptr_end - ptr_msg,
+                                       now);
+        pos += ptr_end - ptr_msg + 1;
+    }
+
+    benchmark_buffer_consume (&client->stream, pos);
+}
+
+/*
+ * Extracts payload of websocket frames received by a client (frames sent by
+ * relay are never masked).
+ */
+
+void
+benchmark_client_decode_websocket (struct t_benchmark_client *client)
+{
+    unsigned char *ptr_data;
+    unsigned long long length;
+    int i, pos, size, header_length, opcode;
+
+    pos = 0;
+    while (client->raw.size - pos >= 2)
+    {
+        ptr_data = (unsigned char *)client->raw.data + pos;
+        size = client->raw.size - pos;
+        opcode = ptr_data[0] & 0x0F;
+        length = ptr_data[1] & 0x7F;
+        header_length = 2;
+        if (length == 126)
+        {
+            if (size < 4)
+                break;
+            length = ((unsigned long long)ptr_data[2] << 8) | ptr_data[3];
+            header_length = 4;
+        }
+        else if (length == 127)
+        {
+            if (size < 10)
+                break;
+            length = 0;
+            for (i = 0; i < 8; i++)
+            {
+                length = (length << 8) | ptr_data[2 + i];
+            }
+            header_length = 10;
+        }
+        if ((unsigned long long)size < header_length + length)
+            break;
+        if (opcode == 8)
+            client->connected = 0;
+        else if ((opcode <= 2)
+                 && !benchmark_buffer_append (&client->stream,
+                                              ptr_data + header_length,
+                                              (int)length))
+        {
+            client->connected = 0;
+        }
+        pos += header_length + (int)length;
+    }
+
+    benchmark_buffer_consume (&client->raw, pos);
+}
+
+/*
+ * Reads data available on socket of a client.
+ */
+
+void
+benchmark_client_read (struct t_benchmark_client *client)
+{
+    char buffer[65536];
+    unsigned long long now;
+    int num_read;
+
+    while (client->connected)
+    {
+        num_read = recv (client->sock, buffer, sizeof (buffer), 0);
+        if (num_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                client->connected = 0;
+            break;
+        }
+        if (num_read == 0)
+        {
+            client->connected = 0;
+            break;
+        }
+        client->bytes += num_read;
+        if (!benchmark_buffer_append (
+                (benchmark_websocket) ? &client->raw : &client->stream,
+                buffer, num_read))
+        {
+            client->connected = 0;
+            break;
+        }
+    }
+
+    if (benchmark_websocket)
+        benchmark_client_decode_websocket (client);
+
+    now = benchmark_time_ns ();
+    if (client->protocol == BENCHMARK_PROTOCOL_WEECHAT)
+        benchmark_client_parse_weechat (client, now);
+    else
+        benchmark_client_parse_irc (client, now);
+}
+
+/*
+ * Sends a message to WeeChat, on the fake IRC server.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_ircd_send (const char *message)
+{
+    return benchmark_send (benchmark_ircd_sock, message, strlen (message));
+}
+
+/*
+ * Reads and handles messages sent by WeeChat to the fake IRC server.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (connection closed)
+ */
+
+int
+benchmark_ircd_read ()
+{
+    char buffer[4096], message[1024], *pos;
+    int num_read;
+
+    num_read = recv (benchmark_ircd_sock, buffer, sizeof (buffer), 0);
+    if (num_read < 0)
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                || (errno == EINTR)) ? 1 : 0;
+    if (num_read == 0)
+        return 0;
+    if (!benchmark_buffer_append (&benchmark_ircd_buffer, buffer, num_read))
+        return 0;
+
+    while ((pos = memchr (benchmark_ircd_buffer.data, '\n',
+                          benchmark_ircd_buffer.size)))
+    {
+        pos[0] = '\0';
+        if (strncmp (benchmark_ircd_buffer.data, "USER ", 5) == 0)
+        {
+            if (!benchmark_ircd_send (
+                    ":bench.server 001 bench :Welcome\r\n"
+                    ":bench.server 005 bench CHANTYPES=# PREFIX=(ov)@+ "
+                    ":are supported\r\n"
+                    ":bench.server 376 bench :End of MOTD\r\n"
+                    ":bench!bench@localhost JOIN " BENCHMARK_CHANNEL "\r\n"
+                    ":bench.server 353 bench = " BENCHMARK_CHANNEL
+                    " :bench sender\r\n"
+                    ":bench.server 366 bench " BENCHMARK_CHANNEL
+                    " :End of /NAMES list\r\n"))
+            {
+                return 0;
+            }
+        }
+        else if (strncmp (benchmark_ircd_buffer.data, "PING ", 5) == 0)
+        {
+            snprintf (message, sizeof (message),
+                      ":bench.server PONG bench.server %s\n",
+                      benchmark_ircd_buffer.data + 5);
+            if (!benchmark_ircd_send (message))
+                return 0;
+        }
+        benchmark_buffer_consume (&benchmark_ircd_buffer,
+                                  pos - benchmark_ircd_buffer.data + 1);
+    }
+
+    return 1;
+}
+
+/*
+ * Accepts connection of WeeChat on the fake IRC server, and waits until
+ * channel is joined.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_ircd_accept ()
+{
+    struct pollfd pfd;
+    int flags;
+
+    pfd.fd = benchmark_ircd_listen;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll (&pfd, 1, BENCHMARK_TIMEOUT * 1000) <= 0)
+        return 0;
+
+    benchmark_ircd_sock = accept (benchmark_ircd_listen, NULL, NULL);
+    if (benchmark_ircd_sock < 0)
+        return 0;
+
+    flags = fcntl (benchmark_ircd_sock, F_GETFL);
+    if (flags == -1)
+        flags = 0;
+    fcntl (benchmark_ircd_sock, F_SETFL, flags | O_NONBLOCK);
+
+    /* wait for login of WeeChat (and let it process the JOIN) */
+    pfd.fd = benchmark_ircd_sock;
+    while (poll (&pfd, 1, 500) > 0)
+    {
+        if (!benchmark_ircd_read ())
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Reads data available on all sockets (clients and fake IRC server), waiting
+ * at most "timeout" milliseconds.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (connection closed by WeeChat on fake IRC server)
+ */
+
+int
+benchmark_poll (struct pollfd *pfds, int timeout)
+{
+    int i, ready;
+
+    for (i = 0; i < benchmark_clients_count; i++)
+    {
+        pfds[i].fd = (benchmark_clients_list[i].connected) ?
+            benchmark_clients_list[i].sock : -1;
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+    }
+    pfds[benchmark_clients_count].fd = benchmark_ircd_sock;
+    pfds[benchmark_clients_count].events = POLLIN;
+    pfds[benchmark_clients_count].revents = 0;
+
+    ready = poll (pfds, benchmark_clients_count + 1, timeout);
+    if (ready <= 0)
+        return 1;
+
+    for (i = 0; i < benchmark_clients_count; i++)
+    {
+        if (pfds[i].revents)
+            benchmark_client_read (&benchmark_clients_list[i]);
+    }
+    if (pfds[benchmark_clients_count].revents)
+        return benchmark_ircd_read ();
+
+    return 1;
+}
+
+/*
+ * Compares two latencies (for qsort).
+ */
+
+int
+benchmark_latency_cmp (const void *latency1, const void *latency2)
+{
+    unsigned int value1, value2;
+
+    value1 = *((const unsigned int *)latency1);
+    value2 = *((const unsigned int *)latency2);
+
+    return (value1 < value2) ? -1 : ((value1 > value2) ? 1 : 0);
+}
+
+/*
+ * Returns a percentile of latencies (in microseconds), sorted before call.
+ */
+
+unsigned int
+benchmark_latency_percentile (struct t_benchmark_stats *stats, int percentile)
+{
+    if (stats->latency_count == 0)
+        return 0;
+
+    return stats->latency[((stats->latency_count - 1) * percentile) / 100];
+}
+
+/*
+ * Displays results of benchmark.
+ */
+
+void
+benchmark_display_results (long long lines_sent, double seconds_send,
+                           double seconds, unsigned long long cpu_ns)
+{
+    struct t_benchmark_stats *stats;
+    long long lines_expected;
+    int i, total_clients;
+
+    for (i = 0; i < benchmark_clients_count; i++)
+    {
+        stats = &benchmark_stats[benchmark_clients_list[i].protocol];
+        stats->messages += benchmark_clients_list[i].messages;
+        stats->bytes += benchmark_clients_list[i].bytes;
+        stats->lines += benchmark_clients_list[i].lines;
+    }
+
+    printf ("\n");
+    printf ("Lines sent: %lld in %.2fs (%.1f lines/s), "
+            "measures done on %.2fs\n",
+            lines_sent, seconds_send, (double)lines_sent / seconds_send,
+            seconds);
+    printf ("\n");
+    printf ("%-8s %7s %12s %12s %14s %14s %10s %10s\n",
+            "protocol", "clients", "lines", "messages", "messages/s",
+            "bytes/s", "p50 (ms)", "p99 (ms)");
+
+    total_clients = 0;
+    for (i = 0; i < BENCHMARK_NUM_PROTOCOLS; i++)
+    {
+        stats = &benchmark_stats[i];
+        if (stats->clients == 0)
+            continue;
+        total_clients += stats->clients;
+        qsort (stats->latency, stats->latency_count,
+               sizeof (stats->latency[0]), &benchmark_latency_cmp);
+        printf ("%-8s %7d %12lld %12lld %14.1f %14.1f %10.3f %10.3f\n",
+                benchmark_protocol_string[i],
+                stats->clients,
+                stats->lines,
+                stats->messages,
+                (double)stats->messages / seconds,
+                (double)stats->bytes / seconds,
+                (double)benchmark_latency_percentile (stats, 50) / 1000,
+                (double)benchmark_latency_percentile (stats, 99) / 1000);
+        lines_expected = lines_sent * stats->clients;
+        if (stats->lines < lines_expected)
+        {
+            printf ("  => %lld lines lost (%s)\n",
+                    lines_expected - stats->lines,
+                    benchmark_protocol_string[i]);
+            benchmark_rc = 1;
+        }
+    }
+
+    printf ("\n");
+    printf ("CPU used by WeeChat: %.3fs (%.1f%%), %.3fms per client\n",
+            (double)cpu_ns / 1000000000,
+            ((double)cpu_ns * 100) / (seconds * 1000000000),
+            (total_clients > 0) ?
+            ((double)cpu_ns / 1000000) / total_clients : 0);
+}
+
+/*
+ * Runs the benchmark (in a separate thread, WeeChat is running in main
+ * thread).
+ */
+
+void *
+benchmark_run (void *arg)
+{
+    struct pollfd *pfds;
+    char *message, *padding;
+    unsigned long long time_start, time_end, time_next, now, cpu_start;
+    long long lines_sent, lines_expected, lines_received;
+    int i, j, protocol, length, timeout;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pfds = NULL;
+    message = NULL;
+    padding = NULL;
+
+    printf ("Waiting for connection of WeeChat on fake IRC server...\n");
+    if (!benchmark_ircd_accept ())
+    {
+        fprintf (stderr,
+                 "Error: WeeChat not connected to fake IRC server "
+                 "(port %d)\n",
+                 benchmark_port + 2);
+        benchmark_rc = 1;
+        goto end;
+    }
+
+    /* connect clients */
+    benchmark_clients_count = benchmark_clients[BENCHMARK_PROTOCOL_WEECHAT]
+        + benchmark_clients[BENCHMARK_PROTOCOL_IRC];
+    benchmark_clients_list = calloc (benchmark_clients_count + 1,
+                                     sizeof (*benchmark_clients_list));
+    pfds = calloc (benchmark_clients_count + 1, sizeof (*pfds));
+    if (!benchmark_clients_list || !pfds)
+    {
+        fprintf (stderr, "Error: not enough memory\n");
+        benchmark_rc = 1;
+        goto end;
+    }
+    printf ("Connecting %d clients...\n", benchmark_clients_count);
+    j = 0;
+    for (protocol = 0; protocol < BENCHMARK_NUM_PROTOCOLS; protocol++)
+    {
+        benchmark_stats[protocol].clients = benchmark_clients[protocol];
+        for (i = 0; i < benchmark_clients[protocol]; i++)
+        {
+            if (!benchmark_client_connect (&benchmark_clients_list[j],
+                                           protocol, i + 1))
+            {
+                fprintf (stderr,
+                         "Error: unable to connect client %d (%s) "
+                         "to relay\n",
+                         i + 1, benchmark_protocol_string[protocol]);
+                benchmark_rc = 1;
+                goto end;
+            }
+            j++;
+        }
+    }
+
+    /* receive initial data (sync, backlog, ...) */
+    time_end = benchmark_time_ns () + (BENCHMARK_WARMUP * 1000000ULL);
+    while (benchmark_time_ns () < time_end)
+    {
+        if (!benchmark_poll (pfds, 100))
+            goto error_ircd;
+    }
+    for (i = 0; i < benchmark_clients_count; i++)
+    {
+        if (!benchmark_clients_list[i].connected)
+        {
+            fprintf (stderr,
+                     "Error: client %d (%s) disconnected by relay\n",
+                     i + 1,
+                     benchmark_protocol_string[benchmark_clients_list[i].protocol]);
+            benchmark_rc = 1;
+            goto end;
+        }
+        benchmark_clients_list[i].messages = 0;
+        benchmark_clients_list[i].bytes = 0;
+        benchmark_clients_list[i].lines = 0;
+    }
+
+    /* build line sent on fake IRC server */
+    length = 256 + benchmark_length;
+    message = malloc (length);
+    padding = malloc (benchmark_length + 1);
+    if (!message || !padding)
+    {
+        fprintf (stderr, "Error: not enough memory\n");
+        benchmark_rc = 1;
+        goto end;
+    }
+    memset (padding, 'x', benchmark_length);
+    padding[benchmark_length] = '\0';
+
+    printf ("Sending %d lines/s during %ds...\n",
+            benchmark_rate, benchmark_duration);
+
+    lines_sent = 0;
+    cpu_start = benchmark_cpu_ns ();
+    time_start = benchmark_time_ns ();
+    time_end = time_start + (benchmark_duration * 1000000000ULL);
+    while (1)
+    {
+        now = benchmark_time_ns ();
+        if (now >= time_end)
+            break;
+        /* send all lines due now */
+        time_next = time_start
+            + ((lines_sent * 1000000000ULL) / benchmark_rate);
+        while (time_next <= now)
+        {
+            lines_sent++;
+            snprintf (message, length,
+                      ":sender!sender@localhost PRIVMSG " BENCHMARK_CHANNEL
+                      " :" BENCHMARK_TAG "%lld %llu %s\r\n",
+                      lines_sent, benchmark_time_ns (), padding);
+            if (!benchmark_ircd_send (message))
+                goto error_ircd;
+            time_next = time_start
+                + ((lines_sent * 1000000000ULL) / benchmark_rate);
+        }
+        timeout = (int)((time_next - now) / 1000000);
+        if (!benchmark_poll (pfds, timeout))
+            goto error_ircd;
+    }
+
+    /* wait for last lines */
+    lines_expected = lines_sent * benchmark_clients_count;
+    time_end = benchmark_time_ns () + (BENCHMARK_DRAIN * 1000000ULL);
+    while (benchmark_time_ns () < time_end)
+    {
+        lines_received = 0;
+        for (i = 0; i < benchmark_clients_count; i++)
+        {
+            lines_received += benchmark_clients_list[i].lines;
+        }
+        if (lines_received >= lines_expected)
+            break;
+        if (!benchmark_poll (pfds, 10))
+            goto error_ircd;
+    }
+
+    benchmark_display_results (
+        lines_sent,
+        (double)benchmark_duration,
+        (double)(benchmark_time_ns () - time_start) / 1000000000,
+        benchmark_cpu_ns () - cpu_start);
+    goto end;
+
+error_ircd:
+    fprintf (stderr, "Error: WeeChat disconnected from fake IRC server\n");
+    benchmark_rc = 1;
+
+end:
+    if (benchmark_clients_list)
+    {
+        for (i = 0; i < benchmark_clients_count; i++)
+        {
+            if (benchmark_clients_list[i].sock > 0)
+                close (benchmark_clients_list[i].sock);
+            if (benchmark_clients_list[i].zstream)
+            {
+                inflateEnd (benchmark_clients_list[i].zstream);
+                free (benchmark_clients_list[i].zstream);
+            }
+            free (benchmark_clients_list[i].raw.data);
+            free (benchmark_clients_list[i].stream.data);
+        }
+    }
+    free (pfds);
+    free (message);
+    free (padding);
+    benchmark_done = 1;
+
+    return NULL;
+}
+
+/*
+ * Creates the socket of fake IRC server.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_ircd_listen_socket ()
+{
+    struct sockaddr_in addr;
+    int set;
+
+    benchmark_ircd_listen = socket (AF_INET, SOCK_STREAM, 0);
+    if (benchmark_ircd_listen < 0)
+        return 0;
+
+    set = 1;
+    setsockopt (benchmark_ircd_listen, SOL_SOCKET, SO_REUSEADDR,
+                &set, sizeof (set));
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (benchmark_port + 2);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if ((bind (benchmark_ircd_listen, (struct sockaddr *)&addr,
+               sizeof (addr)) < 0)
+        || (listen (benchmark_ircd_listen, 1) < 0))
+    {
+        close (benchmark_ircd_listen);
+        benchmark_ircd_listen = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Executes a command in WeeChat core buffer.
+ */
+
+void
+benchmark_command (const char *format, ...)
+{
+    va_list args;
+    char command[4096];
+
+    va_start (args, format);
+    vsnprintf (command, sizeof (command), format, args);
+    va_end (args);
+
+    input_data (gui_buffer_search_main (), command);
+}
+
+/*
+ * Removes a file (callback for util_exec_on_files).
+ */
+
+void
+benchmark_remove_file_cb (void *data, const char *filename)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    unlink (filename);
+}
+
+/*
+ * Removes WeeChat home directory (only files are created in this directory
+ * by the benchmark).
+ */
+
+void
+benchmark_remove_dir (const char *path)
+{
+    util_exec_on_files (path, 1, &benchmark_remove_file_cb, NULL);
+    rmdir (path);
+}
+
+/*
+ * Displays help.
+ */
+
+void
+benchmark_display_help (const char *name)
+{
+    printf ("Usage: %s [option...]\n", name);
+    printf ("\n");
+    printf ("Benchmark of relay plugin: WeeChat is started without "
+            "interface and\n"
+            "simulated clients receive lines sent on a fake IRC server.\n");
+    printf ("\n");
+    printf ("  -w, --weechat <n>        number of clients with weechat "
+            "protocol (default: 10)\n");
+    printf ("  -i, --irc <n>            number of clients with irc "
+            "protocol (default: 10)\n");
+    printf ("  -z, --compression <c>    compression for weechat protocol: "
+            "off, zlib,\n"
+            "                           zlib_stream (default: off)\n");
+    printf ("  -s, --websocket          connect clients with websocket\n");
+    printf ("  -r, --rate <n>           lines sent per second "
+            "(default: 100)\n");
+    printf ("  -d, --duration <n>       duration of benchmark in seconds "
+            "(default: 10)\n");
+    printf ("  -l, --length <n>         length of padding in lines "
+            "(default: 64)\n");
+    printf ("  -p, --port <n>           first port used (default: 9000): "
+            "weechat relay,\n"
+            "                           then irc relay and fake IRC server\n");
+    printf ("  -P, --plugins-dir <dir>  directory with compiled plugins\n"
+            "                           (default: %s)\n",
+            BENCHMARK_PLUGINS_DIR);
+    printf ("  -h, --help               display this help\n");
+    printf ("\n");
+}
+
+/*
+ * Parses command line arguments.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+benchmark_parse_args (int argc, char *argv[])
+{
+    struct option long_options[] = {
+        { "weechat",     required_argument, NULL, 'w' },
+        { "irc",         required_argument, NULL, 'i' },
+        { "compression", required_argument, NULL, 'z' },
+        { "websocket",   no_argument,       NULL, 's' },
+        { "rate",        required_argument, NULL, 'r' },
+        { "duration",    required_argument, NULL, 'd' },
+        { "length",      required_argument, NULL, 'l' },
+        { "port",        required_argument, NULL, 'p' },
+        { "plugins-dir", required_argument, NULL, 'P' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL,          0,                 NULL, 0   },
+    };
+    int i, opt;
+
+    while ((opt = getopt_long (argc, argv, "w:i:z:sr:d:l:p:P:h",
+                               long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'w':
+                benchmark_clients[BENCHMARK_PROTOCOL_WEECHAT] = atoi (optarg);
+                break;
+            case 'i':
+                benchmark_clients[BENCHMARK_PROTOCOL_IRC] = atoi (optarg);
+                break;
+            case 'z':
+                benchmark_compression = -1;
+                for (i = 0; i < BENCHMARK_NUM_COMPRESSIONS; i++)
+                {
+                    if (strcmp (optarg, benchmark_compression_string[i]) == 0)
+                    {
+                        benchmark_compression = i;
+                        break;
+                    }
+                }
+                if (benchmark_compression < 0)
+                {
+                    fprintf (stderr, "Error: invalid compression: %s\n",
+                             optarg);
+                    return 0;
+                }
+                break;
+            case 's':
+                benchmark_websocket = 1;
+                break;
+            case 'r':
+                benchmark_rate = atoi (optarg);
+                break;
+            case 'd':
+                benchmark_duration = atoi (optarg);
+                break;
+            case 'l':
+                benchmark_length = atoi (optarg);
+                break;
+            case 'p':
+                benchmark_port = atoi (optarg);
+                break;
+            case 'P':
+                benchmark_plugins_dir = optarg;
+                break;
+            default:
+                benchmark_display_help (argv[0]);
+                return 0;
+        }
+    }
+
+    if ((benchmark_clients[BENCHMARK_PROTOCOL_WEECHAT] < 0)
+        || (benchmark_clients[BENCHMARK_PROTOCOL_IRC] < 0)
+        || (benchmark_rate <= 0) || (benchmark_duration <= 0)
+        || (benchmark_length < 0) || (benchmark_length > 4096)
+        || (benchmark_port <= 0) || (benchmark_port > 65533))
+    {
+        fprintf (stderr, "Error: invalid arguments\n");
+        return 0;
+    }
+
+    if (!benchmark_plugins_dir)
+        benchmark_plugins_dir = BENCHMARK_PLUGINS_DIR;
+
+    return 1;
+}
+
+/*
+ * Runs benchmark of relay plugin.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    char weechat_dir[] = "/tmp/weechat_benchmark_XXXXXX";
+    char *weechat_argv[] = { argv[0], "--dir", weechat_dir, "--no-plugin",
+                             NULL };
+    pthread_t thread;
+
+    if (!benchmark_parse_args (argc, argv))
+        return 1;
+
+    /* setup environment: default language, no specific timezone */
+    setenv ("LC_ALL", "C", 1);
+    setenv ("TZ", "", 1);
+
+    /* display output as soon as possible (it can be piped) */
+    setvbuf (stdout, NULL, _IOLBF, 0);
+
+    if (pthread_getcpuclockid (pthread_self (), &benchmark_cpu_clock) != 0)
+        benchmark_cpu_clock = CLOCK_PROCESS_CPUTIME_ID;
+
+    if (!benchmark_ircd_listen_socket ())
+    {
+        fprintf (stderr, "Error: unable to listen on port %d\n",
+                 benchmark_port + 2);
+        return 1;
+    }
+
+    printf ("Relay benchmark: %d weechat client(s) (compression: %s), "
+            "%d irc client(s), websocket: %s\n",
+            benchmark_clients[BENCHMARK_PROTOCOL_WEECHAT],
+            benchmark_compression_string[benchmark_compression],
+            benchmark_clients[BENCHMARK_PROTOCOL_IRC],
+            (benchmark_websocket) ? "yes" : "no");
+
+    /* WeeChat home is a new temporary directory, removed on exit */
+    if (!mkdtemp (weechat_dir))
+    {
+        fprintf (stderr, "Error: unable to create directory %s\n",
+                 weechat_dir);
+        return 1;
+    }
+
+    /* init WeeChat (Curses calls are made with the fake ncurses library) */
+    weechat_init (4, weechat_argv, &gui_main_init);
+
+    benchmark_command ("/plugin load %s/irc/" BENCHMARK_PLUGINS_LIBDIR "irc.so",
+                       benchmark_plugins_dir);
+    benchmark_command ("/plugin load %s/relay/" BENCHMARK_PLUGINS_LIBDIR "relay.so",
+                       benchmark_plugins_dir);
+    if (!plugin_search ("irc") || !plugin_search ("relay"))
+    {
+        fprintf (stderr,
+                 "Error: unable to load plugins irc and relay from "
+                 "directory \"%s\"\n",
+                 benchmark_plugins_dir);
+        weechat_end (&gui_main_end);
+        benchmark_remove_dir (weechat_dir);
+        return 1;
+    }
+    benchmark_command ("/set relay.network.password \"%s\"",
+                       BENCHMARK_PASSWORD);
+    benchmark_command ("/set relay.network.max_clients 0");
+    benchmark_command ("/set relay.network.ipv6 off");
+    benchmark_command ("/set relay.network.bind_address \"127.0.0.1\"");
+    benchmark_command ("/server add bench 127.0.0.1/%d", benchmark_port + 2);
+    benchmark_command ("/set irc.server.bench.nicks \"bench\"");
+    benchmark_command ("/relay add weechat %d", benchmark_port);
+    benchmark_command ("/relay add irc.bench %d", benchmark_port + 1);
+    benchmark_command ("/connect bench");
+
+    if (pthread_create (&thread, NULL, &benchmark_run, NULL) != 0)
+    {
+        fprintf (stderr, "Error: unable to create thread\n");
+        weechat_end (&gui_main_end);
+        benchmark_remove_dir (weechat_dir);
+        return 1;
+    }
+
+    /* main loop (without refresh of screen) */
+    while (!weechat_quit && !benchmark_done)
+    {
+        hook_timer_exec ();
+        hook_fd_exec (100);
+        hook_process_exec ();
+    }
+
+    pthread_join (thread, NULL);
+
+    weechat_end (&gui_main_end);
+    benchmark_remove_dir (weechat_dir);
+
+    if (benchmark_ircd_sock >= 0)
+        close (benchmark_ircd_sock);
+    close (benchmark_ircd_listen);
+
+    return benchmark_rc;
+}
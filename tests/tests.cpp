@@ -49,15 +49,28 @@ extern "C"
 /* import tests from libs */
 IMPORT_TEST_GROUP(Plugins);
 IMPORT_TEST_GROUP(Arraylist);
+IMPORT_TEST_GROUP(Async);
 IMPORT_TEST_GROUP(Eval);
 IMPORT_TEST_GROUP(Hashtable);
 IMPORT_TEST_GROUP(Hdata);
+IMPORT_TEST_GROUP(Hook);
 IMPORT_TEST_GROUP(Infolist);
 IMPORT_TEST_GROUP(List);
 IMPORT_TEST_GROUP(String);
 IMPORT_TEST_GROUP(Url);
 IMPORT_TEST_GROUP(Utf8);
 IMPORT_TEST_GROUP(Util);
+IMPORT_TEST_GROUP(Buffer);
+IMPORT_TEST_GROUP(Color);
+IMPORT_TEST_GROUP(Completion);
+IMPORT_TEST_GROUP(Filter);
+IMPORT_TEST_GROUP(History);
+IMPORT_TEST_GROUP(Hotlist);
+IMPORT_TEST_GROUP(Key);
+IMPORT_TEST_GROUP(Line);
+IMPORT_TEST_GROUP(LineIndex);
+IMPORT_TEST_GROUP(Nick);
+IMPORT_TEST_GROUP(Nicklist);
 
 
 /*
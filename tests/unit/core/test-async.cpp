@@ -0,0 +1,174 @@
+/*
+ * test-async.cpp - test events posted by threads
+ *
+ * Copyright (C) 2003-2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "src/core/wee-async.h"
+#include "src/plugins/plugin.h"
+}
+
+#define ASYNC_TEST_THREADS 4
+#define ASYNC_TEST_EVENTS  1000
+
+int async_test_count = 0;
+int async_test_sum = 0;
+int async_test_last = -1;
+int async_test_ordered = 1;
+
+TEST_GROUP(Async)
+{
+};
+
+/*
+ * Callback for events (data is a number allocated by the poster).
+ */
+
+int
+test_async_cb (const void *pointer, void *data)
+{
+    int value;
+
+    /* make C compiler happy */
+    (void) pointer;
+
+    value = *((int *)data);
+    async_test_count++;
+    async_test_sum += value;
+    if (value <= async_test_last)
+        async_test_ordered = 0;
+    async_test_last = value;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Posts events from a thread.
+ */
+
+void *
+test_async_thread_run (void *arg)
+{
+    int i, *value;
+
+    for (i = 0; i < ASYNC_TEST_EVENTS; i++)
+    {
+        value = (int *)malloc (sizeof (*value));
+        *value = (*((int *)arg) * ASYNC_TEST_EVENTS) + i;
+        async_post (NULL, &test_async_cb, NULL, value);
+    }
+
+    return NULL;
+}
+
+/*
+ * Tests functions:
+ *   async_post
+ *   async_exec
+ */
+
+TEST(Async, PostExec)
+{
+    pthread_t threads[ASYNC_TEST_THREADS];
+    int i, args[ASYNC_TEST_THREADS], expected_sum;
+
+    async_exec ();
+
+    LONGS_EQUAL(0, async_post (NULL, NULL, NULL, NULL));
+
+    /* events posted by main thread are executed in order */
+    async_test_count = 0;
+    async_test_sum = 0;
+    async_test_last = -1;
+    async_test_ordered = 1;
+    args[0] = 0;
+    test_async_thread_run (&args[0]);
+    LONGS_EQUAL(0, async_test_count);
+    async_exec ();
+    LONGS_EQUAL(ASYNC_TEST_EVENTS, async_test_count);
+    LONGS_EQUAL(1, async_test_ordered);
+    async_exec ();
+    LONGS_EQUAL(ASYNC_TEST_EVENTS, async_test_count);
+
+    /* events posted by many threads */
+    async_test_count = 0;
+    async_test_sum = 0;
+    expected_sum = 0;
+    for (i = 0; i < ASYNC_TEST_THREADS; i++)
+    {
+        args[i] = i;
+        pthread_create (&threads[i], NULL, &test_async_thread_run, &args[i]);
+    }
+    for (i = 0; i < ASYNC_TEST_THREADS; i++)
+    {
+        pthread_join (threads[i], NULL);
+    }
+    for (i = 0; i < ASYNC_TEST_THREADS * ASYNC_TEST_EVENTS; i++)
+    {
+        expected_sum += i;
+    }
+    async_exec ();
+    LONGS_EQUAL(ASYNC_TEST_THREADS * ASYNC_TEST_EVENTS, async_test_count);
+    LONGS_EQUAL(expected_sum, async_test_sum);
+}
+
+/*
+ * Tests functions:
+ *   async_remove_plugin
+ */
+
+TEST(Async, RemovePlugin)
+{
+    struct t_weechat_plugin *plugin;
+    int *value;
+
+    async_exec ();
+
+    plugin = (struct t_weechat_plugin *)0x1;
+
+    async_test_count = 0;
+    async_test_sum = 0;
+    async_test_last = -1;
+    value = (int *)malloc (sizeof (*value));
+    *value = 1;
+    LONGS_EQUAL(1, async_post (plugin, &test_async_cb, NULL, value));
+    value = (int *)malloc (sizeof (*value));
+    *value = 2;
+    LONGS_EQUAL(1, async_post (NULL, &test_async_cb, NULL, value));
+    value = (int *)malloc (sizeof (*value));
+    *value = 4;
+    LONGS_EQUAL(1, async_post (plugin, &test_async_cb, NULL, value));
+
+    /* events of plugin are discarded (their data is freed) */
+    async_remove_plugin (plugin);
+
+    value = (int *)malloc (sizeof (*value));
+    *value = 8;
+    LONGS_EQUAL(1, async_post (NULL, &test_async_cb, NULL, value));
+
+    async_exec ();
+    LONGS_EQUAL(2, async_test_count);
+    LONGS_EQUAL(2 + 8, async_test_sum);
+}
@@ -30,8 +30,10 @@ extern "C"
 #include "src/core/wee-config.h"
 #include "src/core/wee-config-file.h"
 #include "src/core/wee-hashtable.h"
+#include "src/core/wee-secure.h"
 #include "src/core/wee-string.h"
 #include "src/core/wee-version.h"
+#include "src/gui/gui-buffer.h"
 #include "src/gui/gui-color.h"
 #include "src/plugins/plugin.h"
 }
@@ -262,6 +264,23 @@ TEST(Eval, EvalExpression)
     WEE_CHECK_EVAL("1", "${window.buffer.number}");
     WEE_CHECK_EVAL("core.weechat", "${buffer.full_name}");
     WEE_CHECK_EVAL("core.weechat", "${window.buffer.full_name}");
+    WEE_CHECK_EVAL("core", "${window.buffer.local_variables.plugin}");
+    WEE_CHECK_EVAL("weechat", "${buffer.local_variables.name}");
+    WEE_CHECK_EVAL("", "${buffer.local_variables.xxx}");
+    WEE_CHECK_EVAL("", "${buffer.xxx}");
+    WEE_CHECK_EVAL("", "${window.buffer.xxx}");
+    WEE_CHECK_EVAL("0x0", "${buffer.plugin}");
+    WEE_CHECK_EVAL("", "${buffer.plugin.name}");
+    snprintf (str_value, sizeof (str_value),
+              "0x%lx", (long unsigned int)gui_buffers);
+    WEE_CHECK_EVAL(str_value, "${window.buffer.}");
+    WEE_CHECK_EVAL(str_value, "${window.buffer}");
+
+    /* test hdata (compiled paths in cache) */
+    WEE_CHECK_EVAL("1", "${window.buffer.number}");
+    WEE_CHECK_EVAL("core.weechat", "${window.buffer.full_name}");
+    WEE_CHECK_EVAL("core", "${window.buffer.local_variables.plugin}");
+    WEE_CHECK_EVAL("", "${window.buffer.xxx}");
 
     hashtable_free (extra_vars);
 }
@@ -352,3 +371,217 @@ TEST(Eval, EvalReplaceRegex)
     hashtable_free (extra_vars);
     hashtable_free (options);
 }
+
+/*
+ * Tests functions:
+ *   eval_compile
+ *   eval_compiled_expression
+ *   eval_compiled_free
+ */
+
+TEST(Eval, EvalCompiled)
+{
+    struct t_hashtable *pointers, *extra_vars, *options;
+    struct t_eval_compiled *compiled;
+    char *value;
+
+    pointers = hashtable_new (32,
+                              WEECHAT_HASHTABLE_STRING,
+                              WEECHAT_HASHTABLE_POINTER,
+                              NULL, NULL);
+    CHECK(pointers);
+
+    extra_vars = hashtable_new (32,
+                                WEECHAT_HASHTABLE_STRING,
+                                WEECHAT_HASHTABLE_STRING,
+                                NULL, NULL);
+    CHECK(extra_vars);
+
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+
+    POINTERS_EQUAL(NULL, eval_compile (NULL, NULL));
+    POINTERS_EQUAL(NULL, eval_compiled_expression (NULL, NULL, NULL, NULL));
+
+    /* compiled expression evaluated with different extra vars */
+    compiled = eval_compile ("a${test}b${x${test}}c\\${test}", NULL);
+    CHECK(compiled);
+    hashtable_set (extra_vars, "test", "1");
+    hashtable_set (extra_vars, "x1", "X");
+    value = eval_compiled_expression (compiled, NULL, extra_vars, NULL);
+    STRCMP_EQUAL("a1bXc${test}", value);
+    free (value);
+    hashtable_set (extra_vars, "test", "2");
+    value = eval_compiled_expression (compiled, NULL, extra_vars, NULL);
+    STRCMP_EQUAL("a2bc${test}", value);
+    free (value);
+    eval_compiled_free (compiled);
+
+    /* prefix without suffix */
+    compiled = eval_compile ("abc${test", NULL);
+    CHECK(compiled);
+    value = eval_compiled_expression (compiled, NULL, extra_vars, NULL);
+    STRCMP_EQUAL("abc", value);
+    free (value);
+    eval_compiled_free (compiled);
+
+    /* compiled condition */
+    hashtable_set (options, "type", "condition");
+    compiled = eval_compile ("${test} == 1 || (${test} > 2 && ${test} =~ ^[0-9]+$)",
+                             options);
+    CHECK(compiled);
+    hashtable_set (extra_vars, "test", "1");
+    value = eval_compiled_expression (compiled, pointers, extra_vars, options);
+    STRCMP_EQUAL("1", value);
+    free (value);
+    hashtable_set (extra_vars, "test", "2");
+    value = eval_compiled_expression (compiled, pointers, extra_vars, options);
+    STRCMP_EQUAL("0", value);
+    free (value);
+    hashtable_set (extra_vars, "test", "3");
+    value = eval_compiled_expression (compiled, pointers, extra_vars, options);
+    STRCMP_EQUAL("1", value);
+    free (value);
+    eval_compiled_free (compiled);
+
+    /* condition with text after parentheses */
+    compiled = eval_compile ("(${test}) 1", options);
+    CHECK(compiled);
+    hashtable_set (extra_vars, "test", "");
+    value = eval_compiled_expression (compiled, pointers, extra_vars, options);
+    STRCMP_EQUAL("1", value);
+    free (value);
+    eval_compiled_free (compiled);
+
+    /* custom prefix/suffix */
+    hashtable_remove (options, "type");
+    hashtable_set (options, "prefix", "%(");
+    hashtable_set (options, "suffix", ")");
+    compiled = eval_compile ("a%(test)b${test}", options);
+    CHECK(compiled);
+    value = eval_compiled_expression (compiled, pointers, extra_vars, options);
+    STRCMP_EQUAL("ab${test}", value);
+    free (value);
+    eval_compiled_free (compiled);
+
+    hashtable_free (pointers);
+    hashtable_free (extra_vars);
+    hashtable_free (options);
+}
+
+/*
+ * Tests functions:
+ *   eval_expression (cache of compiled expressions, evaluated many times)
+ */
+
+TEST(Eval, EvalCache)
+{
+    struct t_hashtable *pointers, *extra_vars, *options;
+    char *value, str_expr[128], str_result[128];
+    int i;
+
+    pointers = NULL;
+
+    extra_vars = hashtable_new (32,
+                                WEECHAT_HASHTABLE_STRING,
+                                WEECHAT_HASHTABLE_STRING,
+                                NULL, NULL);
+    CHECK(extra_vars);
+
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+
+    /* same condition evaluated many times (from cache) */
+    hashtable_set (options, "type", "condition");
+    for (i = 0; i < 10000; i++)
+    {
+        snprintf (str_result, sizeof (str_result), "%d", i);
+        hashtable_set (extra_vars, "test", str_result);
+        WEE_CHECK_EVAL((i % 2 == 0) ? "1" : "0",
+                       "${buffer.number} == 1 && ${re:0} == && "
+                       "${eval:${test}} =~ [02468]$");
+    }
+
+    /* same string evaluated many times (from cache) */
+    hashtable_remove (options, "type");
+    for (i = 0; i < 10000; i++)
+    {
+        snprintf (str_result, sizeof (str_result), "%d", i);
+        hashtable_set (extra_vars, "test", str_result);
+        snprintf (str_result, sizeof (str_result), "core.weechat:%d", i);
+        WEE_CHECK_EVAL(str_result, "${window.buffer.full_name}:${test}");
+    }
+
+    /* more expressions than size of cache */
+    for (i = 0; i < 3 * EVAL_COMPILED_CACHE_MAX; i++)
+    {
+        snprintf (str_expr, sizeof (str_expr), "%d:${test}", i);
+        snprintf (str_result, sizeof (str_result), "%d:%d",
+                  i, 10000 - 1);
+        WEE_CHECK_EVAL(str_result, str_expr);
+    }
+    for (i = 0; i < 3 * EVAL_COMPILED_CACHE_MAX; i++)
+    {
+        snprintf (str_expr, sizeof (str_expr), "%d:${test}",
+                  (i * 7) % (3 * EVAL_COMPILED_CACHE_MAX));
+        snprintf (str_result, sizeof (str_result), "%d:%d",
+                  (i * 7) % (3 * EVAL_COMPILED_CACHE_MAX), 10000 - 1);
+        WEE_CHECK_EVAL(str_result, str_expr);
+    }
+
+    hashtable_free (extra_vars);
+    hashtable_free (options);
+}
+
+/*
+ * Tests functions:
+ *   eval_expression (memoized values of variables, option "cache")
+ *   eval_memo_reset
+ */
+
+TEST(Eval, EvalMemo)
+{
+    struct t_hashtable *pointers, *extra_vars, *options;
+    char *value;
+
+    pointers = NULL;
+    extra_vars = NULL;
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+
+    eval_memo_reset ();
+    hashtable_set (secure_hashtable_data, "test_memo", "value1");
+
+    /* without option "cache", values are never memoized */
+    WEE_CHECK_EVAL("value1", "${sec.data.test_memo}");
+    hashtable_set (secure_hashtable_data, "test_memo", "value2");
+    WEE_CHECK_EVAL("value2", "${sec.data.test_memo}");
+
+    /* with option "cache", the first value is kept until reset */
+    hashtable_set (options, "cache", "1");
+    WEE_CHECK_EVAL("value2", "${sec.data.test_memo}");
+    hashtable_set (secure_hashtable_data, "test_memo", "value3");
+    WEE_CHECK_EVAL("value2", "${sec.data.test_memo}");
+    WEE_CHECK_EVAL("value2/value2",
+                   "${sec.data.test_memo}/${sec.data.test_memo}");
+    WEE_CHECK_EVAL(gui_buffers->name, "${buffer.name}");
+    hashtable_remove (options, "cache");
+    WEE_CHECK_EVAL("value3", "${sec.data.test_memo}");
+    eval_memo_reset ();
+    hashtable_set (options, "cache", "1");
+    WEE_CHECK_EVAL("value3", "${sec.data.test_memo}");
+
+    eval_memo_reset ();
+    hashtable_remove (secure_hashtable_data, "test_memo");
+
+    hashtable_free (options);
+}
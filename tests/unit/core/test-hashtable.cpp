@@ -49,6 +49,60 @@ TEST(Hashtable, HashDbj2)
     CHECK(hash == HASHTABLE_TEST_KEY_HASH);
 }
 
+/*
+ * Tests functions:
+ *   hashtable_hash_key_siphash
+ *   hashtable_get_hash_function
+ */
+
+TEST(Hashtable, HashFunctions)
+{
+    struct t_hashtable *hashtable;
+    char str_key[64];
+    int i;
+
+    /* same string => same hash, even if string is not aligned */
+    strcpy (str_key, "x#chan-1");
+    CHECK(hashtable_hash_key_siphash ("#chan-1")
+          == hashtable_hash_key_siphash (str_key + 1));
+    CHECK(hashtable_hash_key_siphash ("#chan-1")
+          != hashtable_hash_key_siphash ("#chan-2"));
+    CHECK(hashtable_hash_key_siphash ("")
+          != hashtable_hash_key_siphash ("a"));
+    CHECK(hashtable_hash_key_siphash ("0123456789abcdef")
+          != hashtable_hash_key_siphash ("0123456789abcdeg"));
+
+    /* hash functions by name */
+    POINTERS_EQUAL(NULL, hashtable_get_hash_function (NULL));
+    POINTERS_EQUAL(NULL, hashtable_get_hash_function ("xxx"));
+    CHECK(hashtable_get_hash_function ("siphash"));
+    CHECK(hashtable_get_hash_function ("djb2"));
+    LONGS_EQUAL(HASHTABLE_TEST_KEY_HASH,
+                (hashtable_get_hash_function ("djb2")) (NULL, HASHTABLE_TEST_KEY));
+
+    /* invalid hash function, or hash function with keys other than string */
+    POINTERS_EQUAL(NULL, hashtable_new (32, "string:xxx", "string",
+                                        NULL, NULL));
+    POINTERS_EQUAL(NULL, hashtable_new (32, "integer:djb2", "string",
+                                        NULL, NULL));
+
+    /* hashtable with each hash function */
+    for (i = 0; i < 2; i++)
+    {
+        hashtable = hashtable_new (0,
+                                   (i == 0) ? "string:siphash" : "string:djb2",
+                                   WEECHAT_HASHTABLE_STRING,
+                                   NULL, NULL);
+        CHECK(hashtable);
+        LONGS_EQUAL(HASHTABLE_STRING, hashtable->type_keys);
+        POINTERS_EQUAL(hashtable_get_hash_function ((i == 0) ? "siphash" : "djb2"),
+                       hashtable->callback_hash_key);
+        hashtable_set (hashtable, "#weechat", "1");
+        STRCMP_EQUAL("1", (const char *)hashtable_get (hashtable, "#weechat"));
+        hashtable_free (hashtable);
+    }
+}
+
 /*
  * Test callback hashing a key.
  *
@@ -297,7 +351,7 @@ TEST(Hashtable, SetGetRemove)
      *   +-----+
      */
     hashtable = hashtable_new (8,
-                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING ":djb2",
                                WEECHAT_HASHTABLE_STRING,
                                NULL,
                                NULL);
@@ -332,6 +386,193 @@ TEST(Hashtable, SetGetRemove)
     hashtable_free (hashtable);
 }
 
+/*
+ * Removes all items with an even key (callback called for each item in
+ * hashtable).
+ */
+
+void
+test_hashtable_remove_even_cb (void *data,
+                               struct t_hashtable *hashtable,
+                               const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) value;
+
+    if (*((int *)key) % 2 == 0)
+    {
+        hashtable_remove (hashtable, key);
+        (*((int *)data))++;
+    }
+}
+
+/*
+ * Tests functions (hashtable with open addressing):
+ *   hashtable_new
+ *   hashtable_set
+ *   hashtable_get
+ *   hashtable_remove
+ *   hashtable_map
+ *   hashtable_dup
+ */
+
+TEST(Hashtable, OpenAddressing)
+{
+    struct t_hashtable *hashtable, *hashtable2;
+    struct t_hashtable_item *item;
+    char str_key[64], str_value[64];
+    int i, count, value;
+
+    /* strings: table grows automatically */
+    hashtable = hashtable_new (0,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL, NULL);
+    CHECK(hashtable);
+    LONGS_EQUAL(1, hashtable->open_addressing);
+    LONGS_EQUAL(HASHTABLE_OPEN_MIN_SIZE, hashtable->size);
+    POINTERS_EQUAL(NULL, hashtable->htable);
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "#chan-%d", i);
+        snprintf (str_value, sizeof (str_value), "value %d", i);
+        CHECK(hashtable_set (hashtable, str_key, str_value));
+    }
+    LONGS_EQUAL(1000, hashtable->items_count);
+    CHECK(hashtable->size >= 1000 * 4 / 3);
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "#chan-%d", i);
+        snprintf (str_value, sizeof (str_value), "value %d", i);
+        STRCMP_EQUAL(str_value, (const char *)hashtable_get (hashtable, str_key));
+    }
+    POINTERS_EQUAL(NULL, hashtable_get (hashtable, "#chan-1000"));
+
+    /* replace value */
+    hashtable_set (hashtable, "#chan-5", "new value");
+    LONGS_EQUAL(1000, hashtable->items_count);
+    STRCMP_EQUAL("new value", (const char *)hashtable_get (hashtable, "#chan-5"));
+
+    /* remove items */
+    for (i = 0; i < 1000; i += 2)
+    {
+        snprintf (str_key, sizeof (str_key), "#chan-%d", i);
+        hashtable_remove (hashtable, str_key);
+    }
+    LONGS_EQUAL(500, hashtable->items_count);
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "#chan-%d", i);
+        LONGS_EQUAL((i % 2 == 0) ? 0 : 1, hashtable_has_key (hashtable, str_key));
+    }
+
+    /* duplicate */
+    hashtable2 = hashtable_dup (hashtable);
+    CHECK(hashtable2);
+    LONGS_EQUAL(1, hashtable2->open_addressing);
+    LONGS_EQUAL(500, hashtable2->items_count);
+    STRCMP_EQUAL("value 999", (const char *)hashtable_get (hashtable2, "#chan-999"));
+    hashtable_free (hashtable2);
+
+    hashtable_remove_all (hashtable);
+    LONGS_EQUAL(0, hashtable->items_count);
+    POINTERS_EQUAL(NULL, hashtable_get (hashtable, "#chan-1"));
+    hashtable_free (hashtable);
+
+    /* integers: keys/values stored in slots */
+    hashtable = hashtable_new (0,
+                               WEECHAT_HASHTABLE_INTEGER,
+                               WEECHAT_HASHTABLE_INTEGER,
+                               NULL, NULL);
+    CHECK(hashtable);
+    for (i = 0; i < 100; i++)
+    {
+        value = i * 10;
+        item = hashtable_set (hashtable, &i, &value);
+        CHECK(item);
+        LONGS_EQUAL(i, *((int *)item->key));
+        LONGS_EQUAL(value, *((int *)item->value));
+    }
+    for (i = 0; i < 100; i++)
+    {
+        LONGS_EQUAL(i * 10, *((int *)hashtable_get (hashtable, &i)));
+    }
+
+    /* remove items while they are mapped */
+    count = 0;
+    hashtable_map (hashtable, &test_hashtable_remove_even_cb, &count);
+    LONGS_EQUAL(50, count);
+    LONGS_EQUAL(50, hashtable->items_count);
+    for (i = 0; i < 100; i++)
+    {
+        LONGS_EQUAL(i % 2, hashtable_has_key (hashtable, &i));
+    }
+    hashtable_free (hashtable);
+}
+
+/*
+ * Tests functions:
+ *   hashtable_pool_get
+ *   hashtable_pool_dup
+ *   hashtable_pool_release
+ */
+
+TEST(Hashtable, Pool)
+{
+    struct t_hashtable *hashtable, *hashtable2, *hashtable3;
+    struct t_hashtable_item **htable;
+
+    hashtable = hashtable_pool_get (32,
+                                    WEECHAT_HASHTABLE_STRING,
+                                    WEECHAT_HASHTABLE_STRING);
+    CHECK(hashtable);
+    LONGS_EQUAL(0, hashtable->open_addressing);
+    LONGS_EQUAL(32, hashtable->size);
+    LONGS_EQUAL(0, hashtable->items_count);
+    hashtable_set (hashtable, "key1", "value1");
+    hashtable_set (hashtable, "key2", "value2");
+    CHECK(hashtable_get_string (hashtable, "keys_values"));
+    htable = hashtable->htable;
+
+    /* duplicate hashtable */
+    hashtable2 = hashtable_pool_dup (hashtable);
+    CHECK(hashtable2);
+    CHECK(hashtable2 != hashtable);
+    LONGS_EQUAL(2, hashtable2->items_count);
+    STRCMP_EQUAL("value2", (const char *)hashtable_get (hashtable2, "key2"));
+
+    /* the same hashtable is given back, empty, with same table */
+    hashtable_pool_release (hashtable);
+    hashtable3 = hashtable_pool_get (32,
+                                     WEECHAT_HASHTABLE_STRING,
+                                     WEECHAT_HASHTABLE_STRING);
+    POINTERS_EQUAL(hashtable, hashtable3);
+    POINTERS_EQUAL(htable, hashtable3->htable);
+    LONGS_EQUAL(0, hashtable3->items_count);
+    POINTERS_EQUAL(NULL, hashtable3->keys_values);
+    POINTERS_EQUAL(NULL, hashtable_get (hashtable3, "key1"));
+
+    /* other size or types: another hashtable */
+    hashtable_pool_release (hashtable2);
+    hashtable = hashtable_pool_get (0,
+                                    WEECHAT_HASHTABLE_STRING,
+                                    WEECHAT_HASHTABLE_STRING);
+    CHECK(hashtable);
+    CHECK(hashtable != hashtable2);
+    LONGS_EQUAL(1, hashtable->open_addressing);
+    hashtable_pool_release (hashtable);
+    hashtable = hashtable_pool_get (32,
+                                    WEECHAT_HASHTABLE_STRING,
+                                    WEECHAT_HASHTABLE_POINTER);
+    CHECK(hashtable);
+    CHECK(hashtable != hashtable2);
+    LONGS_EQUAL(HASHTABLE_POINTER, hashtable->type_values);
+    hashtable_pool_release (hashtable);
+
+    hashtable_pool_release (hashtable3);
+    hashtable_pool_release (NULL);
+}
+
 /*
  * Tests functions:
  *   hashtable_map
@@ -23,13 +23,63 @@
 
 extern "C"
 {
+#include <stddef.h>
+#include <string.h>
 #include "src/core/wee-hdata.h"
+#include "src/core/wee-hashtable.h"
+#include "src/plugins/weechat-plugin.h"
+
+extern void hdata_free (struct t_hdata *hdata);
 }
 
+struct t_test_fetch
+{
+    int number;
+    char *name;
+    struct t_test_fetch *prev_item;
+    struct t_test_fetch *next_item;
+};
+
+struct t_test_field
+{
+    char flag;
+    int count;
+    int values[3];
+    long id;
+    time_t date;
+    char *name;
+    char **tags;
+};
+
+char test_fetch_result[256];
+int test_search_index_calls = 0;
+
 TEST_GROUP(Hdata)
 {
 };
 
+/*
+ * Callback used in test of hdata_fetch: adds "number:name" of each object in
+ * result string.
+ */
+
+void
+test_hdata_fetch_cb (void *data, struct t_hdata *hdata, void *pointer,
+                     struct t_hashtable *record)
+{
+    (void) data;
+    (void) hdata;
+    (void) pointer;
+
+    if (test_fetch_result[0])
+        strcat (test_fetch_result, ",");
+    strcat (test_fetch_result,
+            (const char *)hashtable_get (record, "number"));
+    strcat (test_fetch_result, ":");
+    strcat (test_fetch_result,
+            (const char *)hashtable_get (record, "name"));
+}
+
 /*
  * Tests functions:
  *   hdata_new
@@ -96,6 +146,331 @@ TEST(Hdata, Read)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   hdata_fetch
+ */
+
+TEST(Hdata, Fetch)
+{
+    struct t_hdata *hdata;
+    struct t_test_fetch items[3];
+    int i;
+
+    memset (items, 0, sizeof (items));
+    for (i = 0; i < 3; i++)
+    {
+        items[i].number = i + 1;
+        items[i].prev_item = (i > 0) ? &items[i - 1] : NULL;
+        items[i].next_item = (i < 2) ? &items[i + 1] : NULL;
+    }
+    items[0].name = (char *)"first";
+    items[1].name = (char *)"second";
+    items[2].name = NULL;
+
+    hdata = hdata_new (NULL, "test_fetch", "prev_item", "next_item",
+                       0, 0, NULL, NULL);
+    CHECK(hdata);
+    hdata_new_var (hdata, "number", offsetof (struct t_test_fetch, number),
+                   WEECHAT_HDATA_INTEGER, 0, NULL, NULL);
+    hdata_new_var (hdata, "name", offsetof (struct t_test_fetch, name),
+                   WEECHAT_HDATA_STRING, 0, NULL, NULL);
+    hdata_new_var (hdata, "prev_item",
+                   offsetof (struct t_test_fetch, prev_item),
+                   WEECHAT_HDATA_POINTER, 0, NULL, "test_fetch");
+    hdata_new_var (hdata, "next_item",
+                   offsetof (struct t_test_fetch, next_item),
+                   WEECHAT_HDATA_POINTER, 0, NULL, "test_fetch");
+
+    /* invalid arguments */
+    LONGS_EQUAL(0, hdata_fetch (NULL, &items[0], "number", 0,
+                                &test_hdata_fetch_cb, NULL));
+    LONGS_EQUAL(0, hdata_fetch (hdata, NULL, "number", 0,
+                                &test_hdata_fetch_cb, NULL));
+    LONGS_EQUAL(0, hdata_fetch (hdata, &items[0], NULL, 0,
+                                &test_hdata_fetch_cb, NULL));
+    LONGS_EQUAL(0, hdata_fetch (hdata, &items[0], "number", 0,
+                                NULL, NULL));
+
+    /* one object */
+    test_fetch_result[0] = '\0';
+    LONGS_EQUAL(1, hdata_fetch (hdata, &items[0], "number,name", 1,
+                                &test_hdata_fetch_cb, NULL));
+    STRCMP_EQUAL("1:first", test_fetch_result);
+
+    /* all objects (NULL string is returned as empty string) */
+    test_fetch_result[0] = '\0';
+    LONGS_EQUAL(3, hdata_fetch (hdata, &items[0], "number,name,unknown", 0,
+                                &test_hdata_fetch_cb, NULL));
+    STRCMP_EQUAL("1:first,2:second,3:", test_fetch_result);
+
+    /* backward, with a max number of objects */
+    test_fetch_result[0] = '\0';
+    LONGS_EQUAL(2, hdata_fetch (hdata, &items[2], "number,name", -2,
+                                &test_hdata_fetch_cb, NULL));
+    STRCMP_EQUAL("3:,2:second", test_fetch_result);
+
+    /* all variables */
+    test_fetch_result[0] = '\0';
+    LONGS_EQUAL(2, hdata_fetch (hdata, &items[1], "*", 0,
+                                &test_hdata_fetch_cb, NULL));
+    STRCMP_EQUAL("2:second,3:", test_fetch_result);
+
+    hashtable_remove (weechat_hdata, "test_fetch");
+    hdata_free (hdata);
+}
+
+/*
+ * Callback used in test of hdata_search with an index: returns item with
+ * name (case is ignored).
+ */
+
+void *
+test_hdata_search_index_cb (void *data, struct t_hdata *hdata, void *pointer,
+                            const char *value)
+{
+    struct t_test_fetch *ptr_item;
+
+    (void) data;
+    (void) hdata;
+
+    test_search_index_calls++;
+
+    for (ptr_item = (struct t_test_fetch *)pointer; ptr_item;
+         ptr_item = ptr_item->next_item)
+    {
+        if (ptr_item->name && (strcasecmp (ptr_item->name, value) == 0))
+            return ptr_item;
+    }
+    return NULL;
+}
+
+/*
+ * Tests functions:
+ *   hdata_new_index
+ *   hdata_search (with an index)
+ */
+
+TEST(Hdata, SearchIndex)
+{
+    struct t_hdata *hdata;
+    struct t_test_fetch items[3];
+    int i;
+
+    memset (items, 0, sizeof (items));
+    for (i = 0; i < 3; i++)
+    {
+        items[i].number = i + 1;
+        items[i].prev_item = (i > 0) ? &items[i - 1] : NULL;
+        items[i].next_item = (i < 2) ? &items[i + 1] : NULL;
+    }
+    items[0].name = (char *)"first";
+    items[1].name = (char *)"second";
+    items[2].name = (char *)"third";
+
+    hdata = hdata_new (NULL, "test_search", "prev_item", "next_item",
+                       0, 0, NULL, NULL);
+    CHECK(hdata);
+    hdata_new_var (hdata, "number", offsetof (struct t_test_fetch, number),
+                   WEECHAT_HDATA_INTEGER, 0, NULL, NULL);
+    hdata_new_var (hdata, "name", offsetof (struct t_test_fetch, name),
+                   WEECHAT_HDATA_STRING, 0, NULL, NULL);
+    hdata_new_var (hdata, "prev_item",
+                   offsetof (struct t_test_fetch, prev_item),
+                   WEECHAT_HDATA_POINTER, 0, NULL, "test_search");
+    hdata_new_var (hdata, "next_item",
+                   offsetof (struct t_test_fetch, next_item),
+                   WEECHAT_HDATA_POINTER, 0, NULL, "test_search");
+
+    /* index is allowed only on a string */
+    hdata_new_index (hdata, "number", &test_hdata_search_index_cb, NULL);
+    hdata_new_index (hdata, "name", &test_hdata_search_index_cb, NULL);
+
+    /* simple comparison from start of list: index is used */
+    test_search_index_calls = 0;
+    POINTERS_EQUAL(&items[1],
+                   hdata_search (hdata, &items[0],
+                                 "${test_search.name} == second", 1));
+    POINTERS_EQUAL(&items[2],
+                   hdata_search (hdata, &items[0],
+                                 "  ${test_search.name}==third  ", 1));
+    POINTERS_EQUAL(NULL,
+                   hdata_search (hdata, &items[0],
+                                 "${test_search.name} == unknown", 1));
+    LONGS_EQUAL(3, test_search_index_calls);
+
+    /* value found by index must be exactly the same */
+    test_search_index_calls = 0;
+    POINTERS_EQUAL(NULL,
+                   hdata_search (hdata, &items[0],
+                                 "${test_search.name} == SECOND", 1));
+    LONGS_EQUAL(1, test_search_index_calls);
+
+    /* other expressions or partial search: expression is evaluated */
+    test_search_index_calls = 0;
+    POINTERS_EQUAL(&items[1],
+                   hdata_search (hdata, &items[0],
+                                 "${test_search.name} == second && 1", 1));
+    POINTERS_EQUAL(&items[1],
+                   hdata_search (hdata, &items[0],
+                                 "${test_search.number} == 2", 1));
+    POINTERS_EQUAL(&items[2],
+                   hdata_search (hdata, &items[1],
+                                 "${test_search.name} == third", 1));
+    POINTERS_EQUAL(&items[0],
+                   hdata_search (hdata, &items[2],
+                                 "${test_search.name} == first", -1));
+    POINTERS_EQUAL(NULL,
+                   hdata_search (hdata, &items[0],
+                                 "${test_search.name} == 12", 1));
+    LONGS_EQUAL(0, test_search_index_calls);
+
+    hashtable_remove (weechat_hdata, "test_search");
+    hdata_free (hdata);
+}
+
+/*
+ * Tests functions:
+ *   hdata_field_new
+ *   hdata_field_type
+ *   hdata_field_array_size
+ *   hdata_field_char
+ *   hdata_field_integer
+ *   hdata_field_long
+ *   hdata_field_string
+ *   hdata_field_time
+ *   hdata_field_read
+ *   hdata_field_free
+ */
+
+TEST(Hdata, Field)
+{
+    struct t_hdata *hdata;
+    struct t_hdata_field *field_flag, *field_count, *field_values;
+    struct t_hdata_field *field_value2, *field_id, *field_date, *field_name;
+    struct t_hdata_field *field_tags, *fields[4];
+    struct t_test_field item;
+    const char *tags[3] = { "tag1", "tag2", NULL };
+    const char *name;
+    void *values[4];
+    time_t date;
+    long id;
+    int count;
+
+    memset (&item, 0, sizeof (item));
+    item.flag = 'x';
+    item.count = 3;
+    item.values[0] = 10;
+    item.values[1] = 20;
+    item.values[2] = 30;
+    item.id = 123456789L;
+    item.date = 1000000000;
+    item.name = (char *)"test";
+    item.tags = (char **)tags;
+
+    hdata = hdata_new (NULL, "test_field", NULL, NULL, 0, 0, NULL, NULL);
+    CHECK(hdata);
+    hdata_new_var (hdata, "flag", offsetof (struct t_test_field, flag),
+                   WEECHAT_HDATA_CHAR, 0, NULL, NULL);
+    hdata_new_var (hdata, "count", offsetof (struct t_test_field, count),
+                   WEECHAT_HDATA_INTEGER, 0, NULL, NULL);
+    hdata_new_var (hdata, "values", offsetof (struct t_test_field, values),
+                   WEECHAT_HDATA_INTEGER, 0, "count", NULL);
+    hdata_new_var (hdata, "id", offsetof (struct t_test_field, id),
+                   WEECHAT_HDATA_LONG, 0, NULL, NULL);
+    hdata_new_var (hdata, "date", offsetof (struct t_test_field, date),
+                   WEECHAT_HDATA_TIME, 0, NULL, NULL);
+    hdata_new_var (hdata, "name", offsetof (struct t_test_field, name),
+                   WEECHAT_HDATA_STRING, 0, NULL, NULL);
+    hdata_new_var (hdata, "tags", offsetof (struct t_test_field, tags),
+                   WEECHAT_HDATA_STRING, 0, "*", NULL);
+
+    /* invalid arguments or unknown variable */
+    POINTERS_EQUAL(NULL, hdata_field_new (NULL, "count"));
+    POINTERS_EQUAL(NULL, hdata_field_new (hdata, NULL));
+    POINTERS_EQUAL(NULL, hdata_field_new (hdata, "unknown"));
+    LONGS_EQUAL(-1, hdata_field_type (NULL));
+    LONGS_EQUAL(-1, hdata_field_array_size (NULL, &item));
+    LONGS_EQUAL(0, hdata_field_integer (NULL, &item, -1));
+    POINTERS_EQUAL(NULL, hdata_field_string (NULL, &item, -1));
+    hdata_field_free (NULL);
+
+    field_flag = hdata_field_new (hdata, "flag");
+    field_count = hdata_field_new (hdata, "count");
+    field_values = hdata_field_new (hdata, "values");
+    field_value2 = hdata_field_new (hdata, "2|values");
+    field_id = hdata_field_new (hdata, "id");
+    field_date = hdata_field_new (hdata, "date");
+    field_name = hdata_field_new (hdata, "name");
+    field_tags = hdata_field_new (hdata, "tags");
+    CHECK(field_flag);
+    CHECK(field_count);
+    CHECK(field_values);
+    CHECK(field_value2);
+    CHECK(field_id);
+    CHECK(field_date);
+    CHECK(field_name);
+    CHECK(field_tags);
+
+    /* type and array size */
+    LONGS_EQUAL(WEECHAT_HDATA_INTEGER, hdata_field_type (field_count));
+    LONGS_EQUAL(WEECHAT_HDATA_STRING, hdata_field_type (field_tags));
+    LONGS_EQUAL(-1, hdata_field_array_size (field_count, &item));
+    LONGS_EQUAL(3, hdata_field_array_size (field_values, &item));
+    LONGS_EQUAL(2, hdata_field_array_size (field_tags, &item));
+
+    /* read values (same as functions hdata_xxx with the name) */
+    BYTES_EQUAL('x', hdata_field_char (field_flag, &item, -1));
+    LONGS_EQUAL(3, hdata_field_integer (field_count, &item, -1));
+    LONGS_EQUAL(3, hdata_field_integer (field_count, &item, 1));
+    LONGS_EQUAL(20, hdata_field_integer (field_values, &item, 1));
+    LONGS_EQUAL(30, hdata_field_integer (field_value2, &item, -1));
+    LONGS_EQUAL(10, hdata_field_integer (field_value2, &item, 0));
+    LONGS_EQUAL(hdata_integer (hdata, &item, "2|values"),
+                hdata_field_integer (field_value2, &item, -1));
+    LONGS_EQUAL(123456789L, hdata_field_long (field_id, &item, -1));
+    LONGS_EQUAL(1000000000, hdata_field_time (field_date, &item, -1));
+    STRCMP_EQUAL("test", hdata_field_string (field_name, &item, -1));
+    STRCMP_EQUAL("tag2", hdata_field_string (field_tags, &item, 1));
+    POINTERS_EQUAL(NULL, hdata_field_string (field_tags, &item, 2));
+    POINTERS_EQUAL(NULL, hdata_field_string (field_name, NULL, -1));
+
+    /* read many fields at once */
+    fields[0] = field_count;
+    fields[1] = field_id;
+    fields[2] = field_name;
+    fields[3] = field_date;
+    values[0] = &count;
+    values[1] = &id;
+    values[2] = &name;
+    values[3] = &date;
+    count = 0;
+    id = 0;
+    name = NULL;
+    date = 0;
+    LONGS_EQUAL(0, hdata_field_read (NULL, 4, &item, values));
+    LONGS_EQUAL(0, hdata_field_read (fields, 4, NULL, values));
+    LONGS_EQUAL(4, hdata_field_read (fields, 4, &item, values));
+    LONGS_EQUAL(3, count);
+    LONGS_EQUAL(123456789L, id);
+    STRCMP_EQUAL("test", name);
+    LONGS_EQUAL(1000000000, date);
+    fields[1] = NULL;
+    LONGS_EQUAL(3, hdata_field_read (fields, 4, &item, values));
+
+    hdata_field_free (field_flag);
+    hdata_field_free (field_count);
+    hdata_field_free (field_values);
+    hdata_field_free (field_value2);
+    hdata_field_free (field_id);
+    hdata_field_free (field_date);
+    hdata_field_free (field_name);
+    hdata_field_free (field_tags);
+
+    hashtable_remove (weechat_hdata, "test_field");
+    hdata_free (hdata);
+}
+
 /*
  * Tests functions:
  *   hdata_free_all_plugin
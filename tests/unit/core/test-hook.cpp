@@ -0,0 +1,741 @@
+/*
+ * test-hook.cpp - test hook functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "src/core/wee-hook.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/plugins/plugin.h"
+}
+
+#define TEST_HOOK_MAX_CALLS 16
+
+char test_hook_calls[TEST_HOOK_MAX_CALLS + 1];
+int test_hook_count_calls;
+
+TEST_GROUP(Hook)
+{
+};
+
+/*
+ * Resets list of callbacks called.
+ */
+
+void
+test_hook_reset_calls ()
+{
+    test_hook_calls[0] = '\0';
+    test_hook_count_calls = 0;
+}
+
+/*
+ * Adds a callback in list of callbacks called (the callback is identified
+ * by a single char).
+ */
+
+void
+test_hook_add_call (const void *pointer)
+{
+    if (test_hook_count_calls < TEST_HOOK_MAX_CALLS)
+    {
+        test_hook_calls[test_hook_count_calls] = *((const char *)pointer);
+        test_hook_count_calls++;
+        test_hook_calls[test_hook_count_calls] = '\0';
+    }
+}
+
+/*
+ * Builds list of calls with signal hooks "test_priority" in the list of
+ * hooks (to check the order of hooks in list).
+ */
+
+void
+test_hook_list_priority ()
+{
+    struct t_hook *ptr_hook;
+
+    test_hook_reset_calls ();
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_SIGNAL]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted
+            && (strcmp (HOOK_SIGNAL(ptr_hook, signal), "test_priority") == 0))
+        {
+            test_hook_add_call (ptr_hook->callback_pointer);
+        }
+    }
+}
+
+/*
+ * Test callback for command: adds pointer (a char) in list of calls.
+ */
+
+int
+test_hook_command_cb (const void *pointer, void *data,
+                      struct t_gui_buffer *buffer, int argc, char **argv,
+                      char **argv_eol)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) buffer;
+    (void) argc;
+    (void) argv;
+    (void) argv_eol;
+
+    test_hook_add_call (pointer);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Test callback for print: adds pointer (a char) in list of calls.
+ */
+
+int
+test_hook_print_cb (const void *pointer, void *data,
+                    struct t_gui_buffer *buffer, time_t date,
+                    int tags_count, const char **tags, int displayed,
+                    int highlight, const char *prefix, const char *message)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) buffer;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+    (void) prefix;
+    (void) message;
+
+    test_hook_add_call (pointer);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Test callback for signal: adds pointer (a char) in list of calls.
+ */
+
+int
+test_hook_signal_cb (const void *pointer, void *data,
+                     const char *signal, const char *type_data,
+                     void *signal_data)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    test_hook_add_call (pointer);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Test callback for signal: adds pointer (a char) in list of calls and eats
+ * the signal.
+ */
+
+int
+test_hook_signal_eat_cb (const void *pointer, void *data,
+                         const char *signal, const char *type_data,
+                         void *signal_data)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    test_hook_add_call (pointer);
+
+    return WEECHAT_RC_OK_EAT;
+}
+
+/*
+ * Test callback for timer: adds pointer (a char) in list of calls.
+ */
+
+int
+test_hook_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    test_hook_add_call (pointer);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Test callback for modifier: returns string with pointer (a char) appended,
+ * or an empty string if pointer is "-" (string dropped).
+ */
+
+char *
+test_hook_modifier_cb (const void *pointer, void *data,
+                       const char *modifier, const char *modifier_data,
+                       const char *string)
+{
+    char *result;
+    int length;
+
+    /* make C++ compiler happy */
+    (void) data;
+    (void) modifier;
+    (void) modifier_data;
+
+    if (*((const char *)pointer) == '-')
+        return strdup ("");
+
+    length = strlen (string);
+    result = (char *)malloc (length + 2);
+    if (result)
+    {
+        memcpy (result, string, length);
+        result[length] = *((const char *)pointer);
+        result[length + 1] = '\0';
+    }
+    return result;
+}
+
+/*
+ * Test callback for hsignal: adds pointer (a char) in list of calls.
+ */
+
+int
+test_hook_hsignal_cb (const void *pointer, void *data,
+                      const char *signal, struct t_hashtable *hashtable)
+{
+    /* make C++ compiler happy */
+    (void) data;
+    (void) signal;
+    (void) hashtable;
+
+    test_hook_add_call (pointer);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   hook_command
+ *   hook_command_exec
+ */
+
+TEST(Hook, Command)
+{
+    struct t_weechat_plugin *plugin1, *plugin2, *plugin3;
+    struct t_hook *hooks[5];
+    int i;
+
+    /* fake plugins (only pointers are compared, they are never used) */
+    plugin1 = (struct t_weechat_plugin *)0x1;
+    plugin2 = (struct t_weechat_plugin *)0x2;
+    plugin3 = (struct t_weechat_plugin *)0x3;
+
+    hooks[0] = hook_command (NULL, "test_cmd", NULL, NULL, NULL, NULL,
+                             &test_hook_command_cb, "a", NULL);
+    hooks[1] = hook_command (plugin1, "test_cmd2", NULL, NULL, NULL, NULL,
+                             &test_hook_command_cb, "b", NULL);
+    hooks[2] = hook_command (plugin2, "test_cmd2", NULL, NULL, NULL, NULL,
+                             &test_hook_command_cb, "c", NULL);
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(hooks[i]);
+    }
+
+    /* command already exists for the same plugin */
+    POINTERS_EQUAL(NULL, hook_command (NULL, "test_cmd", NULL, NULL, NULL,
+                                       NULL, &test_hook_command_cb, "x",
+                                       NULL));
+    POINTERS_EQUAL(NULL, hook_command (NULL, "TEST_CMD", NULL, NULL, NULL,
+                                       NULL, &test_hook_command_cb, "x",
+                                       NULL));
+
+    test_hook_reset_calls ();
+    LONGS_EQUAL(HOOK_COMMAND_EXEC_OK,
+                hook_command_exec (gui_buffers, 0, NULL, "/test_cmd"));
+    LONGS_EQUAL(HOOK_COMMAND_EXEC_OK,
+                hook_command_exec (gui_buffers, 0, NULL, "/TEST_CMD arg"));
+    STRCMP_EQUAL("aa", test_hook_calls);
+
+    test_hook_reset_calls ();
+    LONGS_EQUAL(HOOK_COMMAND_EXEC_NOT_FOUND,
+                hook_command_exec (gui_buffers, 1, NULL, "/test_cmd_xyz"));
+    LONGS_EQUAL(HOOK_COMMAND_EXEC_NOT_FOUND,
+                hook_command_exec (gui_buffers, 0, NULL, "/test_cmd2"));
+    STRCMP_EQUAL("", test_hook_calls);
+
+    /* same priority in two other plugins => ambiguous */
+    LONGS_EQUAL(HOOK_COMMAND_EXEC_AMBIGUOUS_PLUGINS,
+                hook_command_exec (gui_buffers, 1, NULL, "/test_cmd2"));
+
+    /* command of current plugin is used */
+    test_hook_reset_calls ();
+    hook_command_exec (gui_buffers, 1, plugin1, "/test_cmd2");
+    hook_command_exec (gui_buffers, 0, plugin2, "/test_cmd2");
+    STRCMP_EQUAL("bc", test_hook_calls);
+
+    /* command with higher priority in another plugin is used */
+    hooks[3] = hook_command (plugin3, "2000|test_cmd2", NULL, NULL, NULL, NULL,
+                             &test_hook_command_cb, "d", NULL);
+    CHECK(hooks[3]);
+    test_hook_reset_calls ();
+    hook_command_exec (gui_buffers, 1, NULL, "/test_cmd2");
+    hook_command_exec (gui_buffers, 1, plugin1, "/test_cmd2");
+    hook_command_exec (gui_buffers, 0, plugin1, "/test_cmd2");
+    STRCMP_EQUAL("ddb", test_hook_calls);
+
+    /* command removed */
+    unhook (hooks[3]);
+    unhook (hooks[1]);
+    test_hook_reset_calls ();
+    hook_command_exec (gui_buffers, 1, NULL, "/test_cmd2");
+    hook_command_exec (gui_buffers, 1, plugin1, "/test_cmd2");
+    STRCMP_EQUAL("cc", test_hook_calls);
+
+    /* command can be hooked again after removal */
+    hooks[4] = hook_command (plugin1, "test_cmd2", NULL, NULL, NULL, NULL,
+                             &test_hook_command_cb, "e", NULL);
+    CHECK(hooks[4]);
+    test_hook_reset_calls ();
+    hook_command_exec (gui_buffers, 1, plugin1, "/test_cmd2");
+    STRCMP_EQUAL("e", test_hook_calls);
+
+    unhook (hooks[0]);
+    unhook (hooks[2]);
+    unhook (hooks[4]);
+    LONGS_EQUAL(HOOK_COMMAND_EXEC_NOT_FOUND,
+                hook_command_exec (gui_buffers, 1, NULL, "/test_cmd"));
+}
+
+/*
+ * Tests functions:
+ *   hook_print
+ *   hook_print_exec
+ */
+
+TEST(Hook, Print)
+{
+    struct t_hook *hooks[7];
+    int i;
+
+    hooks[0] = hook_print (NULL, gui_buffers, NULL, NULL, 1,
+                           &test_hook_print_cb, "a", NULL);
+    hooks[1] = hook_print (NULL, NULL, "test_tag1", NULL, 1,
+                           &test_hook_print_cb, "b", NULL);
+    hooks[2] = hook_print (NULL, NULL, "test_tag2+test_tag3", NULL, 1,
+                           &test_hook_print_cb, "c", NULL);
+    hooks[3] = hook_print (NULL, NULL, "test_tag1,test_tag2", NULL, 1,
+                           &test_hook_print_cb, "d", NULL);
+    hooks[4] = hook_print (NULL, NULL, "!test_tag9+test_tag*", NULL, 1,
+                           &test_hook_print_cb, "e", NULL);
+    hooks[5] = hook_print (NULL, NULL, NULL, "xyz", 1,
+                           &test_hook_print_cb, "f", NULL);
+    hooks[6] = hook_print (NULL, NULL, "!test_tag9+TEST_TAG1", NULL, 1,
+                           &test_hook_print_cb, "g", NULL);
+    for (i = 0; i < 7; i++)
+    {
+        CHECK(hooks[i]);
+    }
+
+    /* hooks are called in creation order, whatever their bucket */
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, "test_tag1", "hello");
+    STRCMP_EQUAL("abdeg", test_hook_calls);
+
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, "test_tag2,test_tag3",
+                               "hello xyz");
+    STRCMP_EQUAL("acdef", test_hook_calls);
+
+    /* same tag twice in line: hooks are called only once */
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, "test_tag1,TEST_TAG1", "hello");
+    STRCMP_EQUAL("abdeg", test_hook_calls);
+
+    /* negated tag */
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, "test_tag1,test_tag9", "hello");
+    STRCMP_EQUAL("abd", test_hook_calls);
+
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, NULL, "xyz");
+    STRCMP_EQUAL("af", test_hook_calls);
+
+    unhook (hooks[0]);
+    unhook (hooks[1]);
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, "test_tag1", "hello");
+    STRCMP_EQUAL("deg", test_hook_calls);
+
+    for (i = 2; i < 7; i++)
+    {
+        unhook (hooks[i]);
+    }
+    test_hook_reset_calls ();
+    gui_chat_printf_date_tags (gui_buffers, 0, "test_tag1", "hello xyz");
+    STRCMP_EQUAL("", test_hook_calls);
+}
+
+/*
+ * Tests functions:
+ *   hook_signal
+ *   hook_signal_send
+ */
+
+TEST(Hook, Signal)
+{
+    struct t_hook *hooks[8];
+    int i;
+
+    hooks[0] = hook_signal (NULL, "test_signal_a",
+                            &test_hook_signal_cb, "a", NULL);
+    hooks[1] = hook_signal (NULL, "2000|test_signal_*",
+                            &test_hook_signal_cb, "b", NULL);
+    hooks[2] = hook_signal (NULL, "*_signal_a",
+                            &test_hook_signal_cb, "c", NULL);
+    hooks[3] = hook_signal (NULL, "500|*",
+                            &test_hook_signal_cb, "d", NULL);
+    hooks[4] = hook_signal (NULL, "TEST_SIGNAL_A",
+                            &test_hook_signal_cb, "e", NULL);
+    hooks[5] = hook_signal (NULL, "test_*_a*",
+                            &test_hook_signal_cb, "f", NULL);
+    hooks[6] = hook_signal (NULL, "test_*_z",
+                            &test_hook_signal_cb, "g", NULL);
+    hooks[7] = hook_signal (NULL, "3000|test_signal_b",
+                            &test_hook_signal_cb, "h", NULL);
+    for (i = 0; i < 8; i++)
+    {
+        CHECK(hooks[i]);
+    }
+
+    /* priority, then creation order; "*" (priority 500) is the last one */
+    test_hook_reset_calls ();
+    LONGS_EQUAL(WEECHAT_RC_OK,
+                hook_signal_send ("test_signal_a",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    STRCMP_EQUAL("bacefd", test_hook_calls);
+
+    /* case is ignored */
+    test_hook_reset_calls ();
+    hook_signal_send ("Test_Signal_A", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("bacefd", test_hook_calls);
+
+    test_hook_reset_calls ();
+    hook_signal_send ("test_signal_b", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("hbd", test_hook_calls);
+
+    test_hook_reset_calls ();
+    hook_signal_send ("test_xyz_z", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("gd", test_hook_calls);
+
+    /* signal eaten by a hook: next hooks are not called */
+    unhook (hooks[1]);
+    hooks[1] = hook_signal (NULL, "2000|test_signal_*",
+                            &test_hook_signal_eat_cb, "b", NULL);
+    test_hook_reset_calls ();
+    LONGS_EQUAL(WEECHAT_RC_OK_EAT,
+                hook_signal_send ("test_signal_a",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    STRCMP_EQUAL("b", test_hook_calls);
+
+    /* hooks removed are not called any more */
+    unhook (hooks[1]);
+    unhook (hooks[4]);
+    test_hook_reset_calls ();
+    hook_signal_send ("test_signal_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("acfd", test_hook_calls);
+
+    unhook (hooks[0]);
+    unhook (hooks[2]);
+    unhook (hooks[3]);
+    unhook (hooks[5]);
+    unhook (hooks[6]);
+    unhook (hooks[7]);
+    test_hook_reset_calls ();
+    hook_signal_send ("test_signal_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("", test_hook_calls);
+}
+
+/*
+ * Tests functions:
+ *   hook_add_to_list
+ *   hook_valid
+ *   unhook
+ */
+
+TEST(Hook, Priority)
+{
+    struct t_hook *hooks[7];
+    int i;
+
+    hooks[0] = hook_signal (NULL, "test_priority",
+                            &test_hook_signal_cb, "a", NULL);
+    hooks[1] = hook_signal (NULL, "2000|test_priority",
+                            &test_hook_signal_cb, "b", NULL);
+    hooks[2] = hook_signal (NULL, "1000|test_priority",
+                            &test_hook_signal_cb, "c", NULL);
+    hooks[3] = hook_signal (NULL, "500|test_priority",
+                            &test_hook_signal_cb, "d", NULL);
+    hooks[4] = hook_signal (NULL, "2000|test_priority",
+                            &test_hook_signal_cb, "e", NULL);
+    for (i = 0; i < 5; i++)
+    {
+        CHECK(hooks[i]);
+        LONGS_EQUAL(1, hook_valid (hooks[i]));
+    }
+
+    /* hooks are sorted by priority, then creation order */
+    test_hook_list_priority ();
+    STRCMP_EQUAL("beacd", test_hook_calls);
+
+    /* remove first hook of a priority */
+    unhook (hooks[0]);
+    LONGS_EQUAL(1, hook_valid (hooks[2]));
+    test_hook_list_priority ();
+    STRCMP_EQUAL("becd", test_hook_calls);
+    hooks[5] = hook_signal (NULL, "test_priority",
+                            &test_hook_signal_cb, "f", NULL);
+    test_hook_list_priority ();
+    STRCMP_EQUAL("becfd", test_hook_calls);
+
+    /* remove all hooks of a priority */
+    unhook (hooks[1]);
+    unhook (hooks[4]);
+    test_hook_list_priority ();
+    STRCMP_EQUAL("cfd", test_hook_calls);
+    hooks[6] = hook_signal (NULL, "3000|test_priority",
+                            &test_hook_signal_cb, "g", NULL);
+    hooks[1] = hook_signal (NULL, "1500|test_priority",
+                            &test_hook_signal_cb, "b", NULL);
+    test_hook_list_priority ();
+    STRCMP_EQUAL("gbcfd", test_hook_calls);
+
+    unhook (hooks[1]);
+    unhook (hooks[2]);
+    unhook (hooks[3]);
+    unhook (hooks[5]);
+    unhook (hooks[6]);
+    test_hook_list_priority ();
+    STRCMP_EQUAL("", test_hook_calls);
+}
+
+/*
+ * Tests functions:
+ *   hook_hsignal
+ *   hook_hsignal_send
+ */
+
+TEST(Hook, Hsignal)
+{
+    struct t_hook *hook1, *hook2, *hook3;
+
+    hook1 = hook_hsignal (NULL, "test_hsignal",
+                          &test_hook_hsignal_cb, "a", NULL);
+    hook2 = hook_hsignal (NULL, "2000|test_h*",
+                          &test_hook_hsignal_cb, "b", NULL);
+    hook3 = hook_hsignal (NULL, "*_other",
+                          &test_hook_hsignal_cb, "c", NULL);
+    CHECK(hook1);
+    CHECK(hook2);
+    CHECK(hook3);
+
+    test_hook_reset_calls ();
+    hook_hsignal_send ("test_hsignal", NULL);
+    STRCMP_EQUAL("ba", test_hook_calls);
+
+    test_hook_reset_calls ();
+    hook_hsignal_send ("test_hsignal_other", NULL);
+    STRCMP_EQUAL("bc", test_hook_calls);
+
+    unhook (hook1);
+    unhook (hook2);
+    unhook (hook3);
+}
+
+/*
+ * Tests functions:
+ *   hook_timer
+ *   hook_timer_exec
+ */
+
+TEST(Hook, Timer)
+{
+    struct t_hook *hook1, *hook2, *hook3, *hook4;
+
+    POINTERS_EQUAL(NULL, hook_timer (NULL, 0, 0, 0,
+                                     &test_hook_timer_cb, "x", NULL));
+    POINTERS_EQUAL(NULL, hook_timer (NULL, 100, 0, 0, NULL, "x", NULL));
+
+    hook1 = hook_timer (NULL, 30, 0, 0, &test_hook_timer_cb, "a", NULL);
+    hook2 = hook_timer (NULL, 1, 0, 1, &test_hook_timer_cb, "b", NULL);
+    hook3 = hook_timer (NULL, 10, 0, 0, &test_hook_timer_cb, "c", NULL);
+    hook4 = hook_timer (NULL, 3600 * 1000, 0, 0,
+                        &test_hook_timer_cb, "d", NULL);
+    CHECK(hook1);
+    CHECK(hook2);
+    CHECK(hook3);
+    CHECK(hook4);
+
+    /* timers are executed by date of next execution, each one only once */
+    usleep (50 * 1000);
+    test_hook_reset_calls ();
+    hook_timer_exec ();
+    STRCMP_EQUAL("bca", test_hook_calls);
+
+    /* timer "b" was called once (max_calls == 1), so it has been removed */
+    usleep (50 * 1000);
+    test_hook_reset_calls ();
+    hook_timer_exec ();
+    STRCMP_EQUAL("ca", test_hook_calls);
+
+    unhook (hook3);
+    usleep (50 * 1000);
+    test_hook_reset_calls ();
+    hook_timer_exec ();
+    STRCMP_EQUAL("a", test_hook_calls);
+
+    unhook (hook1);
+    unhook (hook4);
+    usleep (50 * 1000);
+    test_hook_reset_calls ();
+    hook_timer_exec ();
+    STRCMP_EQUAL("", test_hook_calls);
+}
+
+/*
+ * Tests functions:
+ *   hook_modifier
+ *   hook_modifier_exec
+ *   hook_modifier_exists
+ */
+
+TEST(Hook, Modifier)
+{
+    struct t_hook *hook1, *hook2, *hook3, *hook4;
+    char *str;
+
+    LONGS_EQUAL(0, hook_modifier_exists (NULL, NULL));
+    LONGS_EQUAL(0, hook_modifier_exists (NULL, ""));
+    LONGS_EQUAL(0, hook_modifier_exists (NULL, "test_modifier"));
+    POINTERS_EQUAL(NULL, hook_modifier_exec (NULL, NULL, NULL, "x"));
+
+    /* no hook: string is returned unchanged */
+    str = hook_modifier_exec (NULL, "test_modifier", NULL, "x");
+    STRCMP_EQUAL("x", str);
+    free (str);
+
+    hook1 = hook_modifier (NULL, "test_modifier",
+                           &test_hook_modifier_cb, "a", NULL);
+    hook2 = hook_modifier (NULL, "2000|test_modifier",
+                           &test_hook_modifier_cb, "b", NULL);
+    hook3 = hook_modifier (NULL, "test_*",
+                           &test_hook_modifier_cb, "c", NULL);
+    hook4 = hook_modifier (NULL, "other_modifier",
+                           &test_hook_modifier_cb, "-", NULL);
+    CHECK(hook1);
+    CHECK(hook2);
+    CHECK(hook3);
+    CHECK(hook4);
+
+    LONGS_EQUAL(1, hook_modifier_exists (NULL, "test_modifier"));
+    LONGS_EQUAL(1, hook_modifier_exists (NULL, "TEST_MODIFIER"));
+    LONGS_EQUAL(1, hook_modifier_exists (NULL, "other_modifier"));
+    LONGS_EQUAL(0, hook_modifier_exists (NULL, "test_modifier2"));
+
+    /* priority, then creation order; no wildcard in modifier names */
+    str = hook_modifier_exec (NULL, "test_modifier", NULL, "x");
+    STRCMP_EQUAL("xba", str);
+    free (str);
+
+    str = hook_modifier_exec (NULL, "test_*", NULL, "x");
+    STRCMP_EQUAL("xc", str);
+    free (str);
+
+    /* string dropped */
+    str = hook_modifier_exec (NULL, "other_modifier", NULL, "x");
+    STRCMP_EQUAL("", str);
+    free (str);
+
+    unhook (hook2);
+    str = hook_modifier_exec (NULL, "test_modifier", NULL, "x");
+    STRCMP_EQUAL("xa", str);
+    free (str);
+
+    unhook (hook1);
+    LONGS_EQUAL(0, hook_modifier_exists (NULL, "test_modifier"));
+
+    unhook (hook3);
+    unhook (hook4);
+    LONGS_EQUAL(0, hook_modifier_exists (NULL, "other_modifier"));
+}
+
+/*
+ * Tests functions:
+ *   hook_callback_start
+ *   hook_callback_end
+ *   hook_stats_reset
+ */
+
+TEST(Hook, CallbackStats)
+{
+    struct t_hook *hook1, *hook2;
+
+    hook1 = hook_signal (NULL, "test_stats_a",
+                         &test_hook_signal_cb, "a", NULL);
+    hook2 = hook_signal (NULL, "test_stats_*",
+                         &test_hook_signal_cb, "b", NULL);
+    CHECK(hook1);
+    CHECK(hook2);
+    LONGS_EQUAL(0, hook1->calls);
+    LONGS_EQUAL(0, hook1->time_total);
+    LONGS_EQUAL(0, hook1->time_max);
+
+    test_hook_reset_calls ();
+    hook_signal_send ("test_stats_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    hook_signal_send ("test_stats_a", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    hook_signal_send ("test_stats_b", WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    STRCMP_EQUAL("ababb", test_hook_calls);
+    LONGS_EQUAL(2, hook1->calls);
+    LONGS_EQUAL(3, hook2->calls);
+    CHECK(hook1->time_max <= hook1->time_total);
+    CHECK(hook2->time_max <= hook2->time_total);
+
+    hook_stats_reset ();
+    LONGS_EQUAL(0, hook1->calls);
+    LONGS_EQUAL(0, hook2->calls);
+    LONGS_EQUAL(0, hook2->time_total);
+    LONGS_EQUAL(0, hook2->time_max);
+
+    unhook (hook1);
+    unhook (hook2);
+}
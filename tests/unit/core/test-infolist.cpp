@@ -23,13 +23,61 @@
 
 extern "C"
 {
+#include <string.h>
 #include "src/core/wee-infolist.h"
 }
 
+int test_infolist_stream_position;
+int test_infolist_stream_freed;
+
 TEST_GROUP(Infolist)
 {
 };
 
+/*
+ * Test callback for streamed infolist: builds items 1, 2 and 3 (variable
+ * "int").
+ */
+
+int
+test_infolist_stream_cb (void *stream_data, struct t_infolist *infolist,
+                         int direction)
+{
+    struct t_infolist_item *item;
+    int *position;
+
+    position = (int *)stream_data;
+    if (direction == 0)
+        *position = 0;
+    else if (direction > 0)
+        *position = (*position >= 3) ? 0 : *position + 1;
+    else
+        *position = (*position == 0) ? 3 : *position - 1;
+
+    if (*position == 0)
+        return 0;
+
+    item = infolist_new_item (infolist);
+    if (!item)
+        return 0;
+    infolist_new_var_integer (item, "int", *position);
+
+    return 1;
+}
+
+/*
+ * Test callback to free data of streamed infolist.
+ */
+
+void
+test_infolist_stream_free_cb (void *stream_data)
+{
+    /* make C++ compiler happy */
+    (void) stream_data;
+
+    test_infolist_stream_freed = 1;
+}
+
 /*
  * Tests functions:
  *   infolist_new
@@ -43,7 +91,56 @@ TEST_GROUP(Infolist)
 
 TEST(Infolist, New)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+    struct t_infolist_item *item1, *item2, *item3;
+    char buffer[4] = { 'a', 'b', 'c', 'd' };
+
+    infolist = infolist_new (NULL);
+    CHECK(infolist);
+    POINTERS_EQUAL(NULL, infolist->items);
+    POINTERS_EQUAL(NULL, infolist->schemas);
+
+    item1 = infolist_new_item (infolist);
+    CHECK(item1);
+    POINTERS_EQUAL(item1, infolist->items);
+    POINTERS_EQUAL(item1, infolist->last_item);
+    POINTERS_EQUAL(NULL, item1->schema);
+
+    POINTERS_EQUAL(NULL, infolist_new_var_integer (NULL, "int", 1));
+    POINTERS_EQUAL(NULL, infolist_new_var_integer (item1, NULL, 1));
+    POINTERS_EQUAL(NULL, infolist_new_var_integer (item1, "", 1));
+    POINTERS_EQUAL(NULL, infolist_new_var_buffer (item1, "buf", buffer, 0));
+
+    CHECK(infolist_new_var_integer (item1, "int", 1));
+    CHECK(infolist_new_var_string (item1, "str", "abc"));
+    CHECK(infolist_new_var_pointer (item1, "ptr", item1));
+    CHECK(infolist_new_var_buffer (item1, "buf", buffer, sizeof (buffer)));
+    CHECK(infolist_new_var_time (item1, "time", 1234567890));
+    CHECK(item1->schema);
+    LONGS_EQUAL(5, item1->vars_count);
+    LONGS_EQUAL(5, item1->schema->fields_count);
+
+    /* same fields: the schema is shared with the first item */
+    item2 = infolist_new_item (infolist);
+    CHECK(item2);
+    POINTERS_EQUAL(item1->schema, item2->schema);
+    CHECK(infolist_new_var_integer (item2, "int", 2));
+    CHECK(infolist_new_var_string (item2, "str", NULL));
+    POINTERS_EQUAL(item1->schema, item2->schema);
+    LONGS_EQUAL(2, item2->vars_count);
+    POINTERS_EQUAL(NULL, infolist->schemas->next_schema);
+
+    /* different field: a new schema is created */
+    item3 = infolist_new_item (infolist);
+    CHECK(item3);
+    CHECK(infolist_new_var_integer (item3, "int", 3));
+    CHECK(infolist_new_var_string (item3, "other", "xyz"));
+    CHECK(item3->schema != item1->schema);
+    LONGS_EQUAL(2, item3->schema->fields_count);
+    LONGS_EQUAL(5, item1->schema->fields_count);
+    POINTERS_EQUAL(item1->schema, item2->schema);
+
+    infolist_free (infolist);
 }
 
 /*
@@ -63,7 +160,35 @@ TEST(Infolist, Valid)
 
 TEST(Infolist, Search)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+    struct t_infolist_item *item1, *item2;
+
+    infolist = infolist_new (NULL);
+    item1 = infolist_new_item (infolist);
+    infolist_new_var_integer (item1, "int", 1);
+    infolist_new_var_string (item1, "str", "abc");
+    item2 = infolist_new_item (infolist);
+    infolist_new_var_integer (item2, "int", 2);
+
+    POINTERS_EQUAL(NULL, infolist_search_var (NULL, "int"));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "int"));
+
+    POINTERS_EQUAL(item1, infolist_next (infolist));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, NULL));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, ""));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "xxx"));
+    POINTERS_EQUAL(&item1->vars[0], infolist_search_var (infolist, "int"));
+    POINTERS_EQUAL(&item1->vars[0], infolist_search_var (infolist, "INT"));
+    POINTERS_EQUAL(&item1->vars[1], infolist_search_var (infolist, "str"));
+    STRCMP_EQUAL("i:int,s:str", infolist_fields (infolist));
+
+    /* second item has only the first field of schema */
+    POINTERS_EQUAL(item2, infolist_next (infolist));
+    POINTERS_EQUAL(&item2->vars[0], infolist_search_var (infolist, "int"));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "str"));
+    STRCMP_EQUAL("i:int", infolist_fields (infolist));
+
+    infolist_free (infolist);
 }
 
 /*
@@ -78,6 +203,59 @@ TEST(Infolist, Move)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   infolist_set_stream
+ *   infolist_next (streamed infolist)
+ *   infolist_prev (streamed infolist)
+ *   infolist_reset_item_cursor (streamed infolist)
+ */
+
+TEST(Infolist, Stream)
+{
+    struct t_infolist *infolist;
+    struct t_infolist_schema *schema;
+
+    test_infolist_stream_position = 0;
+    test_infolist_stream_freed = 0;
+
+    infolist = infolist_new (NULL);
+    infolist_set_stream (infolist, &test_infolist_stream_cb,
+                         &test_infolist_stream_free_cb,
+                         &test_infolist_stream_position);
+    POINTERS_EQUAL(NULL, infolist->items);
+
+    /* read all items: only current item is kept in memory */
+    CHECK(infolist_next (infolist));
+    LONGS_EQUAL(1, infolist_integer (infolist, "int"));
+    schema = infolist->items->schema;
+    CHECK(infolist_next (infolist));
+    LONGS_EQUAL(2, infolist_integer (infolist, "int"));
+    POINTERS_EQUAL(infolist->items, infolist->last_item);
+    POINTERS_EQUAL(schema, infolist->items->schema);
+    POINTERS_EQUAL(NULL, infolist->schemas->next_schema);
+    CHECK(infolist_next (infolist));
+    LONGS_EQUAL(3, infolist_integer (infolist, "int"));
+    POINTERS_EQUAL(NULL, infolist_next (infolist));
+    POINTERS_EQUAL(NULL, infolist->items);
+
+    /* read again from the end */
+    CHECK(infolist_prev (infolist));
+    LONGS_EQUAL(3, infolist_integer (infolist, "int"));
+    CHECK(infolist_prev (infolist));
+    LONGS_EQUAL(2, infolist_integer (infolist, "int"));
+
+    /* reset cursor */
+    infolist_reset_item_cursor (infolist);
+    POINTERS_EQUAL(NULL, infolist->ptr_item);
+    POINTERS_EQUAL(NULL, infolist->items);
+    CHECK(infolist_next (infolist));
+    LONGS_EQUAL(1, infolist_integer (infolist, "int"));
+
+    infolist_free (infolist);
+    LONGS_EQUAL(1, test_infolist_stream_freed);
+}
+
 /*
  * Tests functions:
  *   infolist_integer
@@ -89,7 +267,40 @@ TEST(Infolist, Move)
 
 TEST(Infolist, Get)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+    struct t_infolist_item *item;
+    char buffer[4] = { 'a', 'b', 'c', 'd' };
+    void *ptr_buffer;
+    int size;
+
+    infolist = infolist_new (NULL);
+    item = infolist_new_item (infolist);
+    infolist_new_var_integer (item, "int", 123);
+    infolist_new_var_string (item, "str", "abc");
+    infolist_new_var_pointer (item, "ptr", item);
+    infolist_new_var_buffer (item, "buf", buffer, sizeof (buffer));
+    infolist_new_var_time (item, "time", 1234567890);
+
+    POINTERS_EQUAL(item, infolist_next (infolist));
+
+    LONGS_EQUAL(123, infolist_integer (infolist, "int"));
+    LONGS_EQUAL(0, infolist_integer (infolist, "str"));
+    STRCMP_EQUAL("abc", infolist_string (infolist, "str"));
+    STRCMP_EQUAL("abc", infolist_string (infolist, "STR"));
+    POINTERS_EQUAL(NULL, infolist_string (infolist, "int"));
+    POINTERS_EQUAL(item, infolist_pointer (infolist, "ptr"));
+    POINTERS_EQUAL(NULL, infolist_pointer (infolist, "int"));
+    size = 0;
+    ptr_buffer = infolist_buffer (infolist, "buf", &size);
+    CHECK(ptr_buffer);
+    CHECK(ptr_buffer != buffer);
+    LONGS_EQUAL(4, size);
+    MEMCMP_EQUAL(buffer, ptr_buffer, 4);
+    POINTERS_EQUAL(NULL, infolist_buffer (infolist, "int", &size));
+    LONGS_EQUAL(1234567890, infolist_time (infolist, "time"));
+    LONGS_EQUAL(0, infolist_time (infolist, "int"));
+
+    infolist_free (infolist);
 }
 
 /*
@@ -23,6 +23,8 @@
 
 extern "C"
 {
+#include <stdio.h>
+#include "src/core/wee-arraylist.h"
 #include "src/core/wee-list.h"
 #include "src/plugins/plugin.h"
 }
@@ -69,6 +71,9 @@ TEST(List, New)
     POINTERS_EQUAL(NULL, list->items);
     POINTERS_EQUAL(NULL, list->last_item);
     LONGS_EQUAL(0, list->size);
+    CHECK(list->array);
+    LONGS_EQUAL(0, list->array->size);
+    LONGS_EQUAL(1, list->array->sorted);
 
     /* free list */
     weelist_free (list);
@@ -227,6 +232,90 @@ TEST(List, Search)
     weelist_free (list);
 }
 
+/*
+ * Tests functions:
+ *   weelist_add (sorted/unsorted list)
+ *   weelist_search_pos
+ *   weelist_casesearch_pos
+ *   weelist_get
+ *   weelist_set
+ *   weelist_remove
+ */
+
+TEST(List, SearchSorted)
+{
+    struct t_weelist *list;
+    struct t_weelist_item *ptr_item;
+    char str_value[64];
+    int i;
+
+    list = weelist_new ();
+
+    /* add 1000 elements, in reverse order, keeping list sorted */
+    for (i = 999; i >= 0; i--)
+    {
+        snprintf (str_value, sizeof (str_value), "value%04d", i);
+        weelist_add (list, str_value, WEECHAT_LIST_POS_SORT, NULL);
+    }
+    LONGS_EQUAL(1000, weelist_size (list));
+    LONGS_EQUAL(1, list->array->sorted);
+    for (i = 0; i < 1000; i += 111)
+    {
+        snprintf (str_value, sizeof (str_value), "value%04d", i);
+        LONGS_EQUAL(i, weelist_search_pos (list, str_value));
+        STRCMP_EQUAL(str_value, weelist_string (weelist_get (list, i)));
+        str_value[0] = 'V';
+        LONGS_EQUAL(-1, weelist_search_pos (list, str_value));
+        LONGS_EQUAL(i, weelist_casesearch_pos (list, str_value));
+    }
+
+    /* same value with different case: added after the existing one */
+    weelist_add (list, "VALUE0500", WEECHAT_LIST_POS_SORT, NULL);
+    LONGS_EQUAL(1, list->array->sorted);
+    LONGS_EQUAL(500, weelist_search_pos (list, "value0500"));
+    LONGS_EQUAL(501, weelist_search_pos (list, "VALUE0500"));
+    LONGS_EQUAL(500, weelist_casesearch_pos (list, "Value0500"));
+    weelist_remove (list, weelist_get (list, 501));
+    LONGS_EQUAL(1000, weelist_size (list));
+
+    /* add at beginning/end without breaking the sort */
+    weelist_add (list, "a", WEECHAT_LIST_POS_BEGINNING, NULL);
+    weelist_add (list, "z", WEECHAT_LIST_POS_END, NULL);
+    LONGS_EQUAL(1, list->array->sorted);
+    LONGS_EQUAL(0, weelist_search_pos (list, "a"));
+    LONGS_EQUAL(1001, weelist_search_pos (list, "z"));
+
+    /* add at end, breaking the sort: linear search is used */
+    weelist_add (list, "b", WEECHAT_LIST_POS_END, NULL);
+    LONGS_EQUAL(0, list->array->sorted);
+    LONGS_EQUAL(1002, weelist_search_pos (list, "b"));
+    LONGS_EQUAL(1002, weelist_casesearch_pos (list, "B"));
+    LONGS_EQUAL(1, weelist_search_pos (list, "value0000"));
+    ptr_item = weelist_get (list, 1002);
+    STRCMP_EQUAL("b", weelist_string (ptr_item));
+    POINTERS_EQUAL(list->last_item, ptr_item);
+
+    /* remove all elements: list is sorted again */
+    weelist_remove_all (list);
+    LONGS_EQUAL(0, weelist_size (list));
+    LONGS_EQUAL(0, list->array->size);
+    LONGS_EQUAL(1, list->array->sorted);
+
+    /* set a value breaking the sort */
+    weelist_add (list, "a", WEECHAT_LIST_POS_SORT, NULL);
+    weelist_add (list, "b", WEECHAT_LIST_POS_SORT, NULL);
+    weelist_add (list, "c", WEECHAT_LIST_POS_SORT, NULL);
+    weelist_set (weelist_get (list, 1), "bb");
+    LONGS_EQUAL(1, list->array->sorted);
+    weelist_set (weelist_get (list, 0), "d");
+    LONGS_EQUAL(0, list->array->sorted);
+    LONGS_EQUAL(0, weelist_search_pos (list, "d"));
+    LONGS_EQUAL(1, weelist_search_pos (list, "bb"));
+
+    /* free list */
+    weelist_free (list);
+}
+
 /*
  * Tests functions:
  *   weelist_get
@@ -57,7 +57,7 @@ extern "C"
                 string_has_highlight_regex_compiled (__str,             \
                                                      &regex));          \
     if (__result_regex == 0)                                            \
-        regfree(&regex);
+        string_regfree (&regex);
 
 #define WEE_REPLACE_REGEX(__result_regex, __result_replace, __str,      \
                           __regex, __replace, __ref_char, __callback)   \
@@ -76,7 +76,7 @@ extern "C"
         free (result);                                                  \
     }                                                                   \
     if (__result_regex == 0)                                            \
-        regfree(&regex);
+        string_regfree (&regex);
 
 #define WEE_REPLACE_CB(__result_replace, __result_errors,               \
                        __str, __prefix, __suffix,                       \
@@ -552,6 +552,8 @@ TEST(String, MaskToRegex)
  * Tests functions:
  *   string_regex_flags
  *   string_regcomp
+ *   string_regexec
+ *   string_regfree
  */
 
 TEST(String, Regex)
@@ -559,6 +561,7 @@ TEST(String, Regex)
     int flags;
     const char *ptr;
     regex_t regex;
+    regmatch_t regex_match[3];
 
     string_regex_flags (NULL, 0, NULL);
     string_regex_flags ("", 0, NULL);
@@ -599,13 +602,37 @@ TEST(String, Regex)
     /* compile regular expression */
     LONGS_EQUAL(-1, string_regcomp (&regex, NULL, 0));
     LONGS_EQUAL(0, string_regcomp (&regex, "", 0));
-    regfree (&regex);
+    string_regfree (&regex);
     LONGS_EQUAL(0, string_regcomp (&regex, "test", 0));
-    regfree (&regex);
+    string_regfree (&regex);
     LONGS_EQUAL(0, string_regcomp (&regex, "test", REG_EXTENDED));
-    regfree (&regex);
+    string_regfree (&regex);
     LONGS_EQUAL(0, string_regcomp (&regex, "(?ins)test", REG_EXTENDED));
-    regfree (&regex);
+    string_regfree (&regex);
+
+    /* execute regular expression */
+    LONGS_EQUAL(REG_NOMATCH, string_regexec (NULL, "test", 0, NULL, 0));
+    LONGS_EQUAL(0, string_regcomp (&regex, "^t(e|x)(s)?t$",
+                                   REG_EXTENDED | REG_ICASE));
+    LONGS_EQUAL(REG_NOMATCH, string_regexec (&regex, NULL, 0, NULL, 0));
+    LONGS_EQUAL(REG_NOMATCH, string_regexec (&regex, "", 0, NULL, 0));
+    LONGS_EQUAL(REG_NOMATCH, string_regexec (&regex, "test2", 0, NULL, 0));
+    LONGS_EQUAL(0, string_regexec (&regex, "TEST", 0, NULL, 0));
+    LONGS_EQUAL(0, string_regexec (&regex, "test", 3, regex_match, 0));
+    LONGS_EQUAL(0, regex_match[0].rm_so);
+    LONGS_EQUAL(4, regex_match[0].rm_eo);
+    LONGS_EQUAL(1, regex_match[1].rm_so);
+    LONGS_EQUAL(2, regex_match[1].rm_eo);
+    LONGS_EQUAL(2, regex_match[2].rm_so);
+    LONGS_EQUAL(3, regex_match[2].rm_eo);
+    LONGS_EQUAL(0, string_regexec (&regex, "txt", 3, regex_match, 0));
+    LONGS_EQUAL(1, regex_match[1].rm_so);
+    LONGS_EQUAL(2, regex_match[1].rm_eo);
+    LONGS_EQUAL(-1, regex_match[2].rm_so);
+    LONGS_EQUAL(REG_NOMATCH,
+                string_regexec (&regex, "test", 0, NULL, REG_NOTBOL));
+    string_regfree (&regex);
+    string_regfree (NULL);
 }
 
 /*
@@ -637,6 +664,16 @@ TEST(String, Highlight)
     WEE_HAS_HL_STR(1, "test\u00A0:here", "test");  /* unbreakable space */
     WEE_HAS_HL_STR(1, "this is a test here", "test");
     WEE_HAS_HL_STR(1, "this is a test here", "abc,test");
+    WEE_HAS_HL_STR(1, "this is a TEST here", "abc,test");
+    WEE_HAS_HL_STR(0, "this is a TEST here", "abc,(?-i)test");
+    WEE_HAS_HL_STR(1, "this is a test here", "abc,(?-i)test");
+    WEE_HAS_HL_STR(0, "tested here", "test");
+    WEE_HAS_HL_STR(1, "tested here", "test*");
+    WEE_HAS_HL_STR(1, "retest here", "*test");
+    WEE_HAS_HL_STR(1, "retested here", "*test*");
+    WEE_HAS_HL_STR(0, "retested here", "*test,test*");
+    WEE_HAS_HL_STR(1, "nick: hello", "xnick,ick,nick");
+    WEE_HAS_HL_STR(1, "\u00e9t\u00e9 nick", "nick");
 
     /*
      * check highlight with a regex, each call of macro
@@ -657,6 +694,50 @@ TEST(String, Highlight)
     WEE_HAS_HL_REGEX(0, 0, "test here", "teste.*");
 }
 
+/*
+ * Tests functions:
+ *   string_highlight_compile
+ *   string_highlight_match
+ *   string_highlight_free
+ */
+
+TEST(String, HighlightCompiled)
+{
+    struct t_string_highlight *highlight;
+    char words[1024];
+    int i;
+
+    POINTERS_EQUAL(NULL, string_highlight_compile (NULL));
+    LONGS_EQUAL(0, string_highlight_match (NULL, "test"));
+
+    highlight = string_highlight_compile ("");
+    CHECK(highlight);
+    LONGS_EQUAL(0, highlight->words_count);
+    LONGS_EQUAL(0, string_highlight_match (highlight, "test"));
+    string_highlight_free (highlight);
+
+    /* many words sharing prefixes and suffixes */
+    words[0] = '\0';
+    for (i = 0; i < 80; i++)
+    {
+        snprintf (words + strlen (words), sizeof (words) - strlen (words),
+                  "%sword%d", (i > 0) ? "," : "", i);
+    }
+    strcat (words, ",he,she,hers,(?-i)His");
+    highlight = string_highlight_compile (words);
+    CHECK(highlight);
+    LONGS_EQUAL(84, highlight->words_count);
+    LONGS_EQUAL(0, string_highlight_match (highlight, "no highlight here"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "word800 word"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "a WORD79!"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "word7 test"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "ushers"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "it is hers"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "it is his"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "it is His"));
+    string_highlight_free (highlight);
+}
+
 /*
  * Test callback for function string_replace_with_callback.
  *
@@ -902,6 +983,119 @@ TEST(String, SplitShared)
     string_free_split_shared (NULL);
 }
 
+/*
+ * Tests functions:
+ *    string_split_slices
+ */
+
+TEST(String, SplitSlices)
+{
+    struct t_string_slice buffer[2], *slices;
+    int num_items;
+
+    POINTERS_EQUAL(NULL, string_split_slices (NULL, NULL, 0, 0, NULL, 0,
+                                              NULL));
+    POINTERS_EQUAL(NULL, string_split_slices ("", " ", 0, 0, NULL, 0,
+                                              &num_items));
+    LONGS_EQUAL(0, num_items);
+    POINTERS_EQUAL(NULL, string_split_slices ("   ", " ", 0, 0, NULL, 0,
+                                              &num_items));
+    LONGS_EQUAL(0, num_items);
+
+    /* items fit in buffer */
+    slices = string_split_slices (" abc de ", " ", 0, 0, buffer, 2,
+                                  &num_items);
+    POINTERS_EQUAL(buffer, slices);
+    LONGS_EQUAL(2, num_items);
+    LONGS_EQUAL(1, slices[0].offset);
+    LONGS_EQUAL(3, slices[0].length);
+    LONGS_EQUAL(5, slices[1].offset);
+    LONGS_EQUAL(2, slices[1].length);
+
+    /* items do not fit in buffer: new array */
+    slices = string_split_slices (" abc de  fghi ", " ", 0, 0, buffer, 2,
+                                  &num_items);
+    CHECK(slices != buffer);
+    LONGS_EQUAL(3, num_items);
+    LONGS_EQUAL(9, slices[2].offset);
+    LONGS_EQUAL(4, slices[2].length);
+    free (slices);
+
+    /* keep eol */
+    slices = string_split_slices (" abc de  fghi ", " ", 1, 0, NULL, 0,
+                                  &num_items);
+    LONGS_EQUAL(3, num_items);
+    LONGS_EQUAL(12, slices[0].length);
+    LONGS_EQUAL(8, slices[1].length);
+    LONGS_EQUAL(4, slices[2].length);
+    free (slices);
+
+    /* keep eol == 2 and max 2 items */
+    slices = string_split_slices (" abc de  fghi ", " ", 2, 2, NULL, 0,
+                                  &num_items);
+    LONGS_EQUAL(2, num_items);
+    LONGS_EQUAL(13, slices[0].length);
+    LONGS_EQUAL(9, slices[1].length);
+    free (slices);
+}
+
+/*
+ * Tests functions:
+ *    string_split_argv
+ *    string_free_split_argv
+ */
+
+TEST(String, SplitArgv)
+{
+    const char *strings[] = { "abc", " abc de  fghi ", "a,b;;c,", ",,",
+                              ":server 001 nick :Welcome  ", NULL };
+    char **argv, **argv_eol, **argv2, **argv_eol2;
+    int i, j, keep_eol, argc, argc2;
+
+    POINTERS_EQUAL(NULL, string_split_argv (NULL, NULL, 1, 0, NULL, NULL));
+    argv_eol = (char **)0x1;
+    POINTERS_EQUAL(NULL, string_split_argv ("", " ", 1, 0, &argc, &argv_eol));
+    LONGS_EQUAL(0, argc);
+    POINTERS_EQUAL(NULL, argv_eol);
+
+    /* compare with string_split */
+    for (i = 0; strings[i]; i++)
+    {
+        for (keep_eol = 1; keep_eol <= 2; keep_eol++)
+        {
+            argv = string_split_argv (strings[i], " ,;", keep_eol, 0, &argc,
+                                      &argv_eol);
+            argv2 = string_split (strings[i], " ,;", 0, 0, &argc2);
+            argv_eol2 = string_split (strings[i], " ,;", keep_eol, 0, NULL);
+            LONGS_EQUAL(argc2, argc);
+            for (j = 0; j < argc; j++)
+            {
+                STRCMP_EQUAL(argv2[j], argv[j]);
+                STRCMP_EQUAL(argv_eol2[j], argv_eol[j]);
+            }
+            if (argv)
+            {
+                POINTERS_EQUAL(NULL, argv[argc]);
+                POINTERS_EQUAL(NULL, argv_eol[argc]);
+            }
+            string_free_split_argv (argv);
+            string_free_split (argv2);
+            string_free_split (argv_eol2);
+        }
+    }
+
+    /* without argv_eol */
+    argv = string_split_argv (" abc de ", " ", 1, 0, &argc, NULL);
+    LONGS_EQUAL(2, argc);
+    STRCMP_EQUAL("abc", argv[0]);
+    STRCMP_EQUAL("de", argv[1]);
+    POINTERS_EQUAL(NULL, argv[2]);
+    string_free_split_argv (argv);
+
+    /* free with NULL */
+    string_free_split_argv (NULL);
+}
+
 /*
  * Tests functions:
  *    string_split_shell
@@ -1023,6 +1217,8 @@ TEST(String, SplitBuildWithSplitString)
 
 /*
  * Tests functions:
+ *    string_is_ascii
+ *    string_charset_is_ascii_compatible
  *    string_iconv
  *    string_iconv_to_internal
  *    string_iconv_from_internal
@@ -1036,6 +1232,23 @@ TEST(String, Iconv)
     char *str;
     FILE *f;
 
+    /* string_is_ascii */
+    LONGS_EQUAL(1, string_is_ascii (NULL));
+    LONGS_EQUAL(1, string_is_ascii (""));
+    LONGS_EQUAL(1, string_is_ascii ("abc 123"));
+    LONGS_EQUAL(0, string_is_ascii (noel_utf8));
+    LONGS_EQUAL(0, string_is_ascii (noel_iso));
+
+    /* string_charset_is_ascii_compatible */
+    LONGS_EQUAL(0, string_charset_is_ascii_compatible (NULL));
+    LONGS_EQUAL(0, string_charset_is_ascii_compatible (""));
+    LONGS_EQUAL(0, string_charset_is_ascii_compatible ("UTF-16"));
+    LONGS_EQUAL(0, string_charset_is_ascii_compatible ("ISO-2022-JP"));
+    LONGS_EQUAL(1, string_charset_is_ascii_compatible ("UTF-8"));
+    LONGS_EQUAL(1, string_charset_is_ascii_compatible ("utf8"));
+    LONGS_EQUAL(1, string_charset_is_ascii_compatible ("ISO-8859-15"));
+    LONGS_EQUAL(1, string_charset_is_ascii_compatible ("cp1252"));
+
     /* string_iconv */
     WEE_TEST_STR(NULL, string_iconv (0, NULL, NULL, NULL));
     WEE_TEST_STR("", string_iconv (0, NULL, NULL, ""));
@@ -1043,6 +1256,9 @@ TEST(String, Iconv)
     WEE_TEST_STR("abc", string_iconv (1, "UTF-8", "ISO-8859-15", "abc"));
     WEE_TEST_STR(noel_iso, string_iconv (1, "UTF-8", "ISO-8859-15", noel_utf8));
     WEE_TEST_STR(noel_utf8, string_iconv (0, "ISO-8859-15", "UTF-8", noel_iso));
+    /* same conversions again (with iconv descriptors in cache) */
+    WEE_TEST_STR(noel_iso, string_iconv (1, "UTF-8", "ISO-8859-15", noel_utf8));
+    WEE_TEST_STR(noel_utf8, string_iconv (0, "ISO-8859-15", "UTF-8", noel_iso));
 
     /* string_iconv_to_internal */
     WEE_TEST_STR(NULL, string_iconv_to_internal (NULL, NULL));
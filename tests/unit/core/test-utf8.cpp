@@ -201,6 +201,79 @@ TEST(Utf8, Validity)
     LONGS_EQUAL(1, utf8_is_valid ("\xf7\xbf\xbf\xbf", 2, NULL));
 }
 
+/*
+ * Tests functions:
+ *   utf8_ascii_length
+ *   utf8_has_8bits
+ *   utf8_is_valid
+ *   utf8_strlen
+ *   utf8_strlen_screen
+ *
+ * (long strings, checked by machine words, with all possible alignments)
+ */
+
+TEST(Utf8, Ascii)
+{
+    char buffer[128], *error;
+    int i, j;
+
+    LONGS_EQUAL(0, utf8_ascii_length (NULL, 0));
+    LONGS_EQUAL(0, utf8_ascii_length (NULL, 1));
+    LONGS_EQUAL(0, utf8_ascii_length ("", 0));
+    LONGS_EQUAL(0, utf8_ascii_length ("", 1));
+    LONGS_EQUAL(3, utf8_ascii_length ("abc", 0));
+    LONGS_EQUAL(3, utf8_ascii_length ("abc", 1));
+    LONGS_EQUAL(2, utf8_ascii_length (noel_valid, 0));
+    LONGS_EQUAL(1, utf8_ascii_length ("a\tb", 1));
+    LONGS_EQUAL(3, utf8_ascii_length ("a\tb", 0));
+    LONGS_EQUAL(1, utf8_ascii_length ("a\x7f" "b", 1));
+    LONGS_EQUAL(3, utf8_ascii_length ("a\x7f" "b", 0));
+
+    for (i = 0; i < 16; i++)
+    {
+        for (j = i; j < 96; j++)
+        {
+            /* only 7-bit chars, end of string at position j */
+            memset (buffer, 'a', sizeof (buffer));
+            buffer[j] = '\0';
+            LONGS_EQUAL(j - i, utf8_ascii_length (buffer + i, 0));
+            LONGS_EQUAL(j - i, utf8_ascii_length (buffer + i, 1));
+            LONGS_EQUAL(0, utf8_has_8bits (buffer + i));
+            LONGS_EQUAL(1, utf8_is_valid (buffer + i, -1, NULL));
+            LONGS_EQUAL(j - i, utf8_strlen (buffer + i));
+            LONGS_EQUAL(j - i, utf8_strlen_screen (buffer + i));
+
+            /* control char at position j */
+            buffer[j] = '\x01';
+            buffer[j + 1] = 'a';
+            buffer[100] = '\0';
+            LONGS_EQUAL(100 - i, utf8_ascii_length (buffer + i, 0));
+            LONGS_EQUAL(j - i, utf8_ascii_length (buffer + i, 1));
+            LONGS_EQUAL(100 - i, utf8_strlen (buffer + i));
+
+            /* invalid UTF-8 char at position j */
+            buffer[j] = '\xff';
+            LONGS_EQUAL(j - i, utf8_ascii_length (buffer + i, 0));
+            LONGS_EQUAL(1, utf8_has_8bits (buffer + i));
+            LONGS_EQUAL(0, utf8_is_valid (buffer + i, -1, &error));
+            POINTERS_EQUAL(buffer + j, error);
+            if (j > i)
+            {
+                LONGS_EQUAL(1, utf8_is_valid (buffer + i, j - i, &error));
+                POINTERS_EQUAL(NULL, error);
+            }
+            LONGS_EQUAL(0, utf8_is_valid (buffer + i, j - i + 1, &error));
+            POINTERS_EQUAL(buffer + j, error);
+
+            /* valid UTF-8 char at position j */
+            memcpy (buffer + j, noel_valid + 2, 2);
+            LONGS_EQUAL(1, utf8_is_valid (buffer + i, -1, NULL));
+            LONGS_EQUAL(100 - i - 1, utf8_strlen (buffer + i));
+            LONGS_EQUAL(100 - i - 1, utf8_strlen_screen (buffer + i));
+        }
+    }
+}
+
 /*
  * Tests functions:
  *   utf8_normalize
@@ -0,0 +1,226 @@
+/*
+ * test-buffer.cpp - test buffer functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include "src/core/wee-hashtable.h"
+#include "src/gui/gui-buffer.h"
+}
+
+TEST_GROUP(Buffer)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_buffer_index_add
+ *   gui_buffer_index_remove
+ *   gui_buffer_search_by_full_name
+ *   gui_buffer_search_by_name
+ */
+
+TEST(Buffer, SearchIndex)
+{
+    struct t_gui_buffer *buffer, *buffers[50];
+    char name[64];
+    int i;
+
+    buffer = gui_buffer_new (NULL, "test_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    CHECK(gui_buffers_by_full_name);
+    POINTERS_EQUAL(buffer,
+                   hashtable_get (gui_buffers_by_full_name,
+                                  "core.test_index"));
+
+    /* search by full name */
+    POINTERS_EQUAL(buffer, gui_buffer_search_by_full_name ("core.test_index"));
+    POINTERS_EQUAL(NULL, gui_buffer_search_by_full_name ("core.TEST_INDEX"));
+    POINTERS_EQUAL(buffer,
+                   gui_buffer_search_by_full_name ("(?i)core.TEST_INDEX"));
+    POINTERS_EQUAL(NULL, gui_buffer_search_by_full_name ("irc.test_index"));
+
+    /* search by plugin and name */
+    POINTERS_EQUAL(buffer, gui_buffer_search_by_name ("core", "test_index"));
+    POINTERS_EQUAL(buffer, gui_buffer_search_by_name (NULL, "test_index"));
+    POINTERS_EQUAL(buffer, gui_buffer_search_by_name ("", "test_index"));
+    POINTERS_EQUAL(buffer,
+                   gui_buffer_search_by_name ("==", "core.test_index"));
+    POINTERS_EQUAL(buffer,
+                   gui_buffer_search_by_name ("core", "(?i)TEST_INDEX"));
+    POINTERS_EQUAL(NULL, gui_buffer_search_by_name ("core", "TEST_INDEX"));
+    POINTERS_EQUAL(NULL, gui_buffer_search_by_name ("irc", "test_index"));
+
+    /* rename buffer: index is updated */
+    gui_buffer_set (buffer, "name", "test_index2");
+    POINTERS_EQUAL(NULL, gui_buffer_search_by_full_name ("core.test_index"));
+    POINTERS_EQUAL(buffer,
+                   gui_buffer_search_by_full_name ("core.test_index2"));
+    POINTERS_EQUAL(buffer, gui_buffer_search_by_name ("core", "test_index2"));
+
+    /* many buffers */
+    for (i = 0; i < 50; i++)
+    {
+        snprintf (name, sizeof (name), "test_index_%d", i);
+        buffers[i] = gui_buffer_new (NULL, name,
+                                     NULL, NULL, NULL, NULL, NULL, NULL);
+        CHECK(buffers[i]);
+    }
+    for (i = 0; i < 50; i++)
+    {
+        snprintf (name, sizeof (name), "test_index_%d", i);
+        POINTERS_EQUAL(buffers[i], gui_buffer_search_by_name ("core", name));
+    }
+
+    /* close buffers: they are removed from index */
+    for (i = 0; i < 50; i++)
+    {
+        gui_buffer_close (buffers[i]);
+    }
+    POINTERS_EQUAL(NULL,
+                   gui_buffer_search_by_name ("core", "test_index_0"));
+    gui_buffer_close (buffer);
+    POINTERS_EQUAL(NULL,
+                   gui_buffer_search_by_full_name ("core.test_index2"));
+    POINTERS_EQUAL(NULL,
+                   hashtable_get (gui_buffers_by_full_name,
+                                  "core.test_index2"));
+
+    /* core buffer is still in index */
+    CHECK(gui_buffer_search_by_full_name ("core.weechat"));
+}
+
+/*
+ * Tests functions:
+ *   gui_buffer_search_property
+ *   gui_buffer_get_integer_id
+ *   gui_buffer_get_string_id
+ *   gui_buffer_get_pointer_id
+ */
+
+TEST(Buffer, SearchProperty)
+{
+    struct t_gui_buffer *buffer;
+    int id_number, id_name, id_plugin;
+
+    LONGS_EQUAL(-1, gui_buffer_search_property (NULL));
+    LONGS_EQUAL(-1, gui_buffer_search_property (""));
+    LONGS_EQUAL(-1, gui_buffer_search_property ("xxx"));
+    LONGS_EQUAL(-1, gui_buffer_search_property ("localvar_name"));
+
+    id_number = gui_buffer_search_property ("number");
+    LONGS_EQUAL(GUI_BUFFER_PROPERTY_NUMBER, id_number);
+    LONGS_EQUAL(id_number, gui_buffer_search_property ("NUMBER"));
+    id_name = gui_buffer_search_property ("name");
+    LONGS_EQUAL(GUI_BUFFER_PROPERTY_NAME, id_name);
+    LONGS_EQUAL(id_name, gui_buffer_search_property ("Name"));
+    id_plugin = gui_buffer_search_property ("plugin");
+    LONGS_EQUAL(GUI_BUFFER_PROPERTY_PLUGIN, id_plugin);
+
+    buffer = gui_buffer_new (NULL, "test_prop",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    LONGS_EQUAL(gui_buffer_get_integer (buffer, "number"),
+                gui_buffer_get_integer_id (buffer, id_number));
+    STRCMP_EQUAL("test_prop", gui_buffer_get_string_id (buffer, id_name));
+    STRCMP_EQUAL("test_prop", gui_buffer_get_string (buffer, "NAME"));
+    STRCMP_EQUAL("core", gui_buffer_get_string (buffer, "localvar_plugin"));
+    POINTERS_EQUAL(NULL, gui_buffer_get_pointer_id (buffer, id_plugin));
+
+    /* wrong type or invalid id */
+    LONGS_EQUAL(0, gui_buffer_get_integer_id (buffer, id_name));
+    POINTERS_EQUAL(NULL, gui_buffer_get_string_id (buffer, id_number));
+    LONGS_EQUAL(0, gui_buffer_get_integer_id (buffer, -1));
+    POINTERS_EQUAL(NULL, gui_buffer_get_string_id (buffer, -1));
+    POINTERS_EQUAL(NULL,
+                   gui_buffer_get_pointer_id (buffer,
+                                              GUI_BUFFER_NUM_PROPERTIES));
+    LONGS_EQUAL(0, gui_buffer_get_integer_id (NULL, id_number));
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_buffer_search_number_pos
+ *   gui_buffer_search_by_number
+ *   gui_buffer_count_merged_buffers
+ *   gui_buffer_move_to_number
+ */
+
+TEST(Buffer, SearchNumber)
+{
+    struct t_gui_buffer *buffers[20], *ptr_buffer;
+    char name[64];
+    int i, number;
+
+    for (i = 0; i < 20; i++)
+    {
+        snprintf (name, sizeof (name), "test_number_%d", i);
+        buffers[i] = gui_buffer_new (NULL, name,
+                                     NULL, NULL, NULL, NULL, NULL, NULL);
+        CHECK(buffers[i]);
+    }
+    number = buffers[0]->number;
+
+    /* search from start and from end of list */
+    POINTERS_EQUAL(gui_buffers, gui_buffer_search_number_pos (-1));
+    POINTERS_EQUAL(gui_buffers, gui_buffer_search_number_pos (1));
+    POINTERS_EQUAL(NULL,
+                   gui_buffer_search_number_pos (last_gui_buffer->number + 1));
+    for (i = 0; i < 20; i++)
+    {
+        POINTERS_EQUAL(buffers[i], gui_buffer_search_number_pos (number + i));
+        POINTERS_EQUAL(buffers[i], gui_buffer_search_by_number (number + i));
+    }
+
+    LONGS_EQUAL(1, gui_buffer_count_merged_buffers (number + 10));
+    LONGS_EQUAL(0, gui_buffer_count_merged_buffers (number + 20));
+
+    /* move buffers near the start and the end of list */
+    gui_buffer_move_to_number (buffers[19], number + 1);
+    POINTERS_EQUAL(buffers[19], gui_buffer_search_by_number (number + 1));
+    POINTERS_EQUAL(buffers[1], gui_buffer_search_by_number (number + 2));
+    gui_buffer_move_to_number (buffers[19], number + 19);
+    POINTERS_EQUAL(buffers[19], gui_buffer_search_by_number (number + 19));
+    POINTERS_EQUAL(buffers[18], gui_buffer_search_by_number (number + 18));
+    gui_buffer_move_to_number (buffers[3], number + 17);
+    POINTERS_EQUAL(buffers[3], gui_buffer_search_by_number (number + 17));
+    POINTERS_EQUAL(buffers[4], gui_buffer_search_by_number (number + 3));
+    POINTERS_EQUAL(buffers[18], gui_buffer_search_by_number (number + 18));
+
+    /* buffers are still sorted by number */
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        if (ptr_buffer->prev_buffer)
+            CHECK(ptr_buffer->number > ptr_buffer->prev_buffer->number);
+    }
+
+    for (i = 0; i < 20; i++)
+    {
+        gui_buffer_close (buffers[i]);
+    }
+}
@@ -0,0 +1,215 @@
+/*
+ * test-color.cpp - test color functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-line.h"
+}
+
+#define WEE_CHECK_RUNS(__string)                                        \
+    runs_count = gui_color_get_runs (__string, NULL, 0);                \
+    LONGS_EQUAL(runs_count,                                             \
+                gui_color_get_runs (__string, runs,                     \
+                                    sizeof (runs) / sizeof (runs[0]))); \
+    decoded = gui_color_decode (__string, NULL);                        \
+    decoded_runs = gui_color_decode_runs (__string, runs, runs_count);  \
+    STRCMP_EQUAL(decoded, decoded_runs);                                \
+    free (decoded);                                                     \
+    free (decoded_runs);
+
+TEST_GROUP(Color)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_color_skip_code
+ */
+
+TEST(Color, SkipCode)
+{
+    const char *string;
+
+    POINTERS_EQUAL(NULL, gui_color_skip_code (NULL));
+    POINTERS_EQUAL(NULL, gui_color_skip_code (""));
+    POINTERS_EQUAL(NULL, gui_color_skip_code ("abc"));
+
+    /* reset */
+    string = "\x1C" "abc";
+    POINTERS_EQUAL(string + 1, gui_color_skip_code (string));
+
+    /* fg color */
+    string = "\x19" "F05abc";
+    POINTERS_EQUAL(string + 4, gui_color_skip_code (string));
+
+    /* fg extended color with attributes */
+    string = "\x19" "F@*00214abc";
+    POINTERS_EQUAL(string + 9, gui_color_skip_code (string));
+
+    /* fg/bg colors */
+    string = "\x19" "*05,03abc";
+    POINTERS_EQUAL(string + 7, gui_color_skip_code (string));
+
+    /* set attribute */
+    string = "\x1A" "\x01" "abc";
+    POINTERS_EQUAL(string + 2, gui_color_skip_code (string));
+
+    /* truncated color code */
+    string = "\x19";
+    POINTERS_EQUAL(string + 1, gui_color_skip_code (string));
+}
+
+/*
+ * Tests functions:
+ *   gui_color_decode
+ *   gui_color_decode_ansi
+ */
+
+TEST(Color, Decode)
+{
+    char *str;
+
+    POINTERS_EQUAL(NULL, gui_color_decode (NULL, NULL));
+    POINTERS_EQUAL(NULL, gui_color_decode_ansi (NULL, 0));
+
+    /* WeeChat colors */
+    str = gui_color_decode ("", NULL);
+    STRCMP_EQUAL("", str);
+    free (str);
+    str = gui_color_decode ("a long text without any color code", NULL);
+    STRCMP_EQUAL("a long text without any color code", str);
+    free (str);
+    str = gui_color_decode ("\x19" "05" "hello " "\x1C" "world é", NULL);
+    STRCMP_EQUAL("hello world é", str);
+    free (str);
+    str = gui_color_decode ("\x19" "05" "hello " "\x1C" "world", "?");
+    STRCMP_EQUAL("?hello ?world", str);
+    free (str);
+    str = gui_color_decode ("abc" "\x19", NULL);
+    STRCMP_EQUAL("abc", str);
+    free (str);
+
+    /* ANSI colors */
+    str = gui_color_decode_ansi ("a long text without any color code", 0);
+    STRCMP_EQUAL("a long text without any color code", str);
+    free (str);
+    str = gui_color_decode_ansi ("\33[1m" "bold" "\33[0m" " text", 0);
+    STRCMP_EQUAL("bold text", str);
+    free (str);
+}
+
+/*
+ * Tests functions:
+ *   gui_color_get_runs
+ *   gui_color_decode_runs
+ */
+
+TEST(Color, Runs)
+{
+    struct t_gui_color_run runs[16];
+    char *decoded, *decoded_runs;
+    int runs_count;
+
+    LONGS_EQUAL(0, gui_color_get_runs (NULL, NULL, 0));
+    LONGS_EQUAL(0, gui_color_get_runs ("", NULL, 0));
+    POINTERS_EQUAL(NULL, gui_color_decode_runs (NULL, runs, 0));
+    POINTERS_EQUAL(NULL, gui_color_decode_runs ("abc", runs, -1));
+
+    /* no color: one run */
+    LONGS_EQUAL(1, gui_color_get_runs ("abc", runs, 16));
+    LONGS_EQUAL(0, runs[0].offset);
+    LONGS_EQUAL(3, runs[0].length);
+
+    /* text between colors */
+    LONGS_EQUAL(2, gui_color_get_runs ("\x19" "05ab" "\x1C" "cd" "\x1C",
+                                       runs, 16));
+    LONGS_EQUAL(3, runs[0].offset);
+    LONGS_EQUAL(2, runs[0].length);
+    LONGS_EQUAL(6, runs[1].offset);
+    LONGS_EQUAL(2, runs[1].length);
+
+    /* runs are counted even if array is too small */
+    LONGS_EQUAL(3, gui_color_get_runs ("a" "\x1C" "b" "\x1C" "c", runs, 1));
+    LONGS_EQUAL(0, runs[0].offset);
+    LONGS_EQUAL(1, runs[0].length);
+
+    /* only colors: no run */
+    LONGS_EQUAL(0, gui_color_get_runs ("\x19" "05" "\x1C", runs, 16));
+
+    /* decoded string must be the same as with gui_color_decode */
+    WEE_CHECK_RUNS("");
+    WEE_CHECK_RUNS("abc");
+    WEE_CHECK_RUNS("\x19" "05" "\x1C");
+    WEE_CHECK_RUNS("\x19" "F@00214" "nick" "\x1C" ": hello " "\x1A" "\x01"
+                   "world" "\x1B" "\x01" " é");
+    WEE_CHECK_RUNS("\x19" "*05,03" "a" "\x19" "b" "\x19" "E" "c" "\x19");
+}
+
+/*
+ * Tests functions:
+ *   gui_line_data_alloc (runs of message)
+ *   gui_line_data_build_message_runs
+ *   gui_line_data_get_message_no_color
+ *   gui_line_data_free_message_runs
+ */
+
+TEST(Color, LineDataRuns)
+{
+    struct t_gui_line_data *line_data;
+    char *str;
+
+    POINTERS_EQUAL(NULL, gui_line_data_get_message_no_color (NULL));
+
+    line_data = gui_line_data_alloc (0, NULL,
+                                     "\x19" "05" "hello" "\x1C" " world");
+    CHECK(line_data);
+    LONGS_EQUAL(2, line_data->message_runs_count);
+    CHECK(gui_line_data_in_block (line_data, line_data->message_runs));
+    str = gui_line_data_get_message_no_color (line_data);
+    STRCMP_EQUAL("hello world", str);
+    free (str);
+
+    /* message changed: runs are allocated outside the block */
+    gui_line_data_free_string (line_data, &line_data->message);
+    line_data->message = strdup ("a" "\x1C" "b" "\x1C" "c");
+    gui_line_data_build_message_runs (line_data);
+    LONGS_EQUAL(3, line_data->message_runs_count);
+    CHECK(!gui_line_data_in_block (line_data, line_data->message_runs));
+    str = gui_line_data_get_message_no_color (line_data);
+    STRCMP_EQUAL("abc", str);
+    free (str);
+
+    /* runs not available: color codes are removed from message */
+    gui_line_data_free_message_runs (line_data);
+    LONGS_EQUAL(-1, line_data->message_runs_count);
+    POINTERS_EQUAL(NULL, line_data->message_runs);
+    str = gui_line_data_get_message_no_color (line_data);
+    STRCMP_EQUAL("abc", str);
+    free (str);
+
+    gui_line_data_free_string (line_data, &line_data->message);
+    free (line_data);
+}
@@ -0,0 +1,136 @@
+/*
+ * test-completion.cpp - test completion functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-arraylist.h"
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-completion.h"
+
+extern int completion_list_add_config_options_cb (const void *pointer,
+                                                  void *data,
+                                                  const char *completion_item,
+                                                  struct t_gui_buffer *buffer,
+                                                  struct t_gui_completion *completion);
+}
+
+#define TEST_COMPLETION_SORTED(__base_word, __prefix, __count)          \
+    free (completion->base_word);                                       \
+    completion->base_word = strdup (__base_word);                       \
+    arraylist_clear (completion->list);                                 \
+    gui_completion_list_add_sorted (completion, words, 6, __prefix);    \
+    LONGS_EQUAL(__count, arraylist_size (completion->list));
+
+TEST_GROUP(Completion)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_completion_sort_words
+ *   gui_completion_list_add_sorted
+ */
+
+TEST(Completion, ListAddSorted)
+{
+    struct t_gui_completion *completion;
+    struct t_gui_completion_word *ptr_word;
+    const char *words[6] = { "quit", "Help", "hello", "buffer", "he", "bar" };
+
+    completion = (struct t_gui_completion *)malloc (sizeof (*completion));
+    CHECK(completion);
+    gui_completion_buffer_init (completion, gui_buffers);
+
+    gui_completion_sort_words (words, 6);
+    STRCMP_EQUAL("bar", words[0]);
+    STRCMP_EQUAL("buffer", words[1]);
+    STRCMP_EQUAL("he", words[2]);
+    STRCMP_EQUAL("quit", words[5]);
+
+    TEST_COMPLETION_SORTED("", NULL, 6);
+    TEST_COMPLETION_SORTED("b", NULL, 2);
+    TEST_COMPLETION_SORTED("HE", NULL, 3);
+    TEST_COMPLETION_SORTED("hel", NULL, 2);
+    TEST_COMPLETION_SORTED("help2", NULL, 0);
+    TEST_COMPLETION_SORTED("z", NULL, 0);
+    TEST_COMPLETION_SORTED("a", NULL, 0);
+
+    /* words with a prefix */
+    TEST_COMPLETION_SORTED("/", "/", 6);
+    TEST_COMPLETION_SORTED("/q", "/", 1);
+    ptr_word = (struct t_gui_completion_word *)arraylist_get (completion->list, 0);
+    STRCMP_EQUAL("/quit", ptr_word->word);
+    TEST_COMPLETION_SORTED("q", "/", 0);
+
+    gui_completion_free (completion);
+}
+
+/*
+ * Tests functions:
+ *   completion_list_add_config_options_cb
+ */
+
+TEST(Completion, ConfigOptions)
+{
+    struct t_gui_completion *completion;
+    struct t_config_file *ptr_config;
+    struct t_config_section *ptr_section;
+    struct t_config_option *ptr_option;
+    int count;
+
+    completion = (struct t_gui_completion *)malloc (sizeof (*completion));
+    CHECK(completion);
+    gui_completion_buffer_init (completion, gui_buffers);
+
+    /* same options found as with a scan of all options */
+    count = 0;
+    for (ptr_config = config_files; ptr_config;
+         ptr_config = ptr_config->next_config)
+    {
+        if (strcmp (ptr_config->name, "weechat") != 0)
+            continue;
+        for (ptr_section = ptr_config->sections; ptr_section;
+             ptr_section = ptr_section->next_section)
+        {
+            if (strcmp (ptr_section->name, "look") != 0)
+                continue;
+            for (ptr_option = ptr_section->options; ptr_option;
+                 ptr_option = ptr_option->next_option)
+            {
+                if (string_strncasecmp (ptr_option->name, "buffer", 6) == 0)
+                    count++;
+            }
+        }
+    }
+    CHECK(count > 0);
+    completion->base_word = strdup ("weechat.look.buffer");
+    completion_list_add_config_options_cb (NULL, NULL, "config_options",
+                                           gui_buffers, completion);
+    LONGS_EQUAL(count, arraylist_size (completion->list));
+
+    gui_completion_free (completion);
+}
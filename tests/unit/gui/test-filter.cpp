@@ -0,0 +1,131 @@
+/*
+ * test-filter.cpp - test filter functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-filter.h"
+#include "src/gui/gui-line.h"
+}
+
+TEST_GROUP(Filter)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_filter_new
+ *   gui_filter_all_buffers
+ *   gui_filter_check_line
+ *   gui_filter_free
+ */
+
+TEST(Filter, Masks)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_filter *filter1, *filter2;
+    struct t_gui_line *line1, *line2, *line3;
+
+    buffer = gui_buffer_new (NULL, "test_filter",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    gui_chat_printf_date_tags (buffer, 0, "tag1", "test line 1");
+    gui_chat_printf_date_tags (buffer, 0, "tag2", "test line 2");
+    gui_chat_printf_date_tags (buffer, 0, "tag2", "test hidden 3");
+    LONGS_EQUAL(3, buffer->own_lines->lines_count);
+    line1 = buffer->own_lines->first_line;
+    line2 = line1->next_line;
+    line3 = line2->next_line;
+
+    filter1 = gui_filter_new (1, "test_filter1", "core.test_filter",
+                              "tag1", "*");
+    CHECK(filter1);
+    LONGS_EQUAL(0, filter1->index);
+    filter2 = gui_filter_new (0, "test_filter2", "core.test_filter",
+                              "*", "hidden");
+    CHECK(filter2);
+    LONGS_EQUAL(1, filter2->index);
+
+    /* new filter enabled: it is checked on lines */
+    gui_filter_all_buffers (filter1);
+    LONGS_EQUAL(1, line1->data->filters_mask);
+    LONGS_EQUAL(0, line1->data->displayed);
+    LONGS_EQUAL(1, line2->data->displayed);
+    LONGS_EQUAL(1, line3->data->displayed);
+    LONGS_EQUAL(1, buffer->own_lines->lines_hidden);
+
+    /* enable second filter */
+    filter2->enabled = 1;
+    gui_filter_all_buffers (filter2);
+    LONGS_EQUAL(2, line3->data->filters_mask);
+    LONGS_EQUAL(0, line3->data->displayed);
+    LONGS_EQUAL(2, buffer->own_lines->lines_hidden);
+
+    /* new line is checked with enabled filters */
+    gui_chat_printf_date_tags (buffer, 0, "tag1", "test hidden 4");
+    LONGS_EQUAL(3, buffer->own_lines->last_line->data->filters_mask);
+    LONGS_EQUAL(0, buffer->own_lines->last_line->data->displayed);
+    LONGS_EQUAL(3, buffer->own_lines->lines_hidden);
+
+    /* disable first filter */
+    filter1->enabled = 0;
+    gui_filter_all_buffers (filter1);
+    LONGS_EQUAL(1, line1->data->displayed);
+    LONGS_EQUAL(0, line3->data->displayed);
+    LONGS_EQUAL(0, buffer->own_lines->last_line->data->displayed);
+    LONGS_EQUAL(2, buffer->own_lines->lines_hidden);
+
+    /* line with tag "no_filter" is never hidden */
+    gui_chat_printf_date_tags (buffer, 0, "no_filter", "test hidden 5");
+    LONGS_EQUAL(0, buffer->own_lines->last_line->data->filters_mask);
+    LONGS_EQUAL(1, buffer->own_lines->last_line->data->displayed);
+
+    /* disable filters in buffer */
+    buffer->filter = 0;
+    gui_filter_buffer (buffer, NULL);
+    LONGS_EQUAL(0, buffer->own_lines->lines_hidden);
+    buffer->filter = 1;
+    gui_filter_buffer (buffer, NULL);
+    LONGS_EQUAL(2, buffer->own_lines->lines_hidden);
+
+    /* delete second filter: its bit is reused by next filter */
+    filter2->enabled = 0;
+    gui_filter_all_buffers (filter2);
+    gui_filter_free (filter2);
+    LONGS_EQUAL(0, buffer->own_lines->lines_hidden);
+    filter2 = gui_filter_new (1, "test_filter2", "core.other_buffer",
+                              "*", "hidden");
+    CHECK(filter2);
+    LONGS_EQUAL(1, filter2->index);
+    gui_filter_all_buffers (filter2);
+    LONGS_EQUAL(0, line3->data->filters_mask);
+    LONGS_EQUAL(1, line3->data->displayed);
+    LONGS_EQUAL(0, buffer->own_lines->lines_hidden);
+
+    gui_filter_free (filter1);
+    gui_filter_free (filter2);
+    gui_buffer_close (buffer);
+}
@@ -0,0 +1,96 @@
+/*
+ * test-history.cpp - test history functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-history.h"
+}
+
+TEST_GROUP(History)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_history_buffer_add
+ *   gui_history_buffer_free
+ */
+
+TEST(History, BufferAdd)
+{
+    struct t_gui_buffer *buffer;
+
+    buffer = gui_buffer_new (NULL, "test_history",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    config_file_option_set (config_history_max_commands, "3", 1);
+    config_file_option_set (config_history_remove_duplicates, "off", 1);
+
+    gui_history_buffer_add (buffer, "a");
+    gui_history_buffer_add (buffer, "a");
+    LONGS_EQUAL(1, buffer->num_history);
+
+    /* oldest entry is removed */
+    gui_history_buffer_add (buffer, "b");
+    gui_history_buffer_add (buffer, "c");
+    gui_history_buffer_add (buffer, "d");
+    LONGS_EQUAL(3, buffer->num_history);
+    STRCMP_EQUAL("d", buffer->history->text);
+    STRCMP_EQUAL("b", buffer->last_history->text);
+
+    /* duplicates are kept by default */
+    gui_history_buffer_add (buffer, "c");
+    LONGS_EQUAL(3, buffer->num_history);
+    STRCMP_EQUAL("c", buffer->history->text);
+    STRCMP_EQUAL("c", buffer->last_history->text);
+    POINTERS_EQUAL(NULL, buffer->history_index);
+
+    /* remove duplicates (older duplicates already in history are kept) */
+    config_file_option_set (config_history_remove_duplicates, "on", 1);
+    gui_history_buffer_add (buffer, "d");
+    CHECK(buffer->history_index);
+    LONGS_EQUAL(3, buffer->num_history);
+    STRCMP_EQUAL("d", buffer->history->text);
+    STRCMP_EQUAL("c", buffer->history->next_history->text);
+    STRCMP_EQUAL("c", buffer->last_history->text);
+    gui_history_buffer_add (buffer, "e");
+    gui_history_buffer_add (buffer, "c");
+    LONGS_EQUAL(3, buffer->num_history);
+    STRCMP_EQUAL("c", buffer->history->text);
+    STRCMP_EQUAL("e", buffer->history->next_history->text);
+    STRCMP_EQUAL("d", buffer->last_history->text);
+
+    gui_history_buffer_free (buffer);
+    POINTERS_EQUAL(NULL, buffer->history);
+    POINTERS_EQUAL(NULL, buffer->history_index);
+    LONGS_EQUAL(0, buffer->num_history);
+
+    config_file_option_reset (config_history_remove_duplicates, 1);
+    config_file_option_reset (config_history_max_commands, 1);
+
+    gui_buffer_close (buffer);
+}
@@ -0,0 +1,145 @@
+/*
+ * test-hotlist.cpp - test hotlist functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-hotlist.h"
+
+extern struct t_gui_hotlist *gui_hotlist_search (struct t_gui_buffer *buffer);
+extern int gui_hotlist_sorted_count;
+extern int gui_hotlist_signal_pending;
+extern int gui_hotlist_resort_pending;
+}
+
+TEST_GROUP(Hotlist)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_hotlist_add
+ *   gui_hotlist_search
+ *   gui_hotlist_find_pos
+ *   gui_hotlist_ask_resort
+ *   gui_hotlist_flush
+ *   gui_hotlist_remove_buffer
+ */
+
+TEST(Hotlist, AddSortRemove)
+{
+    struct t_gui_buffer *buffers[20];
+    struct t_gui_hotlist *ptr_hotlist;
+    char name[64];
+    int i, count;
+
+    gui_hotlist_clear (GUI_HOTLIST_MASK_MAX);
+    gui_hotlist_flush ();
+
+    for (i = 0; i < 20; i++)
+    {
+        snprintf (name, sizeof (name), "test_hotlist_%d", i);
+        buffers[i] = gui_buffer_new (NULL, name,
+                                     NULL, NULL, NULL, NULL, NULL, NULL);
+        CHECK(buffers[i]);
+    }
+
+    /* add buffers with different priorities, in reverse order */
+    for (i = 19; i >= 0; i--)
+    {
+        CHECK(gui_hotlist_add (buffers[i],
+                               (enum t_gui_hotlist_priority)(i % 3), NULL));
+    }
+    LONGS_EQUAL(1, gui_hotlist_signal_pending);
+    LONGS_EQUAL(20, gui_hotlist_sorted_count);
+    for (i = 0; i < 20; i++)
+    {
+        ptr_hotlist = gui_hotlist_search (buffers[i]);
+        CHECK(ptr_hotlist);
+        POINTERS_EQUAL(buffers[i], ptr_hotlist->buffer);
+    }
+
+    /* higher priority: counts are kept */
+    ptr_hotlist = gui_hotlist_add (buffers[0], GUI_HOTLIST_HIGHLIGHT, NULL);
+    CHECK(ptr_hotlist);
+    POINTERS_EQUAL(ptr_hotlist, gui_hotlist_search (buffers[0]));
+    POINTERS_EQUAL(ptr_hotlist, gui_hotlist);
+    LONGS_EQUAL(1, ptr_hotlist->count[GUI_HOTLIST_LOW]);
+    LONGS_EQUAL(1, ptr_hotlist->count[GUI_HOTLIST_HIGHLIGHT]);
+    LONGS_EQUAL(20, gui_hotlist_sorted_count);
+
+    /* default sort: group by priority, then by time */
+    count = 0;
+    for (ptr_hotlist = gui_hotlist; ptr_hotlist;
+         ptr_hotlist = ptr_hotlist->next_hotlist)
+    {
+        if (ptr_hotlist->next_hotlist)
+        {
+            CHECK(ptr_hotlist->priority >= ptr_hotlist->next_hotlist->priority);
+        }
+        count++;
+    }
+    LONGS_EQUAL(20, count);
+
+    /* resort by number: it is done by gui_hotlist_flush */
+    config_file_option_set (config_look_hotlist_sort, "number_asc", 1);
+    LONGS_EQUAL(1, gui_hotlist_resort_pending);
+    gui_hotlist_flush ();
+    LONGS_EQUAL(0, gui_hotlist_resort_pending);
+    LONGS_EQUAL(0, gui_hotlist_signal_pending);
+    i = 0;
+    for (ptr_hotlist = gui_hotlist; ptr_hotlist;
+         ptr_hotlist = ptr_hotlist->next_hotlist)
+    {
+        POINTERS_EQUAL(buffers[i], ptr_hotlist->buffer);
+        i++;
+    }
+    POINTERS_EQUAL(buffers[19], last_gui_hotlist->buffer);
+
+    /* remove buffers */
+    for (i = 0; i < 20; i += 2)
+    {
+        gui_buffer_close (buffers[i]);
+    }
+    LONGS_EQUAL(10, gui_hotlist_sorted_count);
+    i = 1;
+    for (ptr_hotlist = gui_hotlist; ptr_hotlist;
+         ptr_hotlist = ptr_hotlist->next_hotlist)
+    {
+        POINTERS_EQUAL(buffers[i], ptr_hotlist->buffer);
+        i += 2;
+    }
+    for (i = 1; i < 20; i += 2)
+    {
+        gui_buffer_close (buffers[i]);
+    }
+    POINTERS_EQUAL(NULL, gui_hotlist);
+    POINTERS_EQUAL(NULL, last_gui_hotlist);
+    LONGS_EQUAL(0, gui_hotlist_sorted_count);
+
+    config_file_option_reset (config_look_hotlist_sort, 1);
+    gui_hotlist_flush ();
+}
@@ -0,0 +1,82 @@
+/*
+ * test-key.cpp - test key functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include "src/gui/gui-key.h"
+
+extern struct t_gui_key *gui_key_search_part (struct t_gui_buffer *buffer,
+                                              int context,
+                                              const char *key);
+}
+
+TEST_GROUP(Key)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_key_search_part
+ *   gui_key_trie_build
+ *   gui_key_trie_search
+ */
+
+TEST(Key, SearchPart)
+{
+    struct t_gui_key *key1, *key2;
+
+    key1 = gui_key_bind (NULL, GUI_KEY_CONTEXT_DEFAULT, "meta-Qq", "/test1");
+    CHECK(key1);
+    key2 = gui_key_bind (NULL, GUI_KEY_CONTEXT_DEFAULT, "meta-Qqa", "/test2");
+    CHECK(key2);
+
+    /* beginning of keys: first key in sorted list */
+    POINTERS_EQUAL(key1, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Q"));
+
+    /* exact keys */
+    POINTERS_EQUAL(key1, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Qq"));
+    POINTERS_EQUAL(key2, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Qqa"));
+
+    /* no key */
+    POINTERS_EQUAL(NULL, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Qx"));
+    POINTERS_EQUAL(NULL, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Qqab"));
+
+    /* unbind first key: trie is built again */
+    LONGS_EQUAL(1, gui_key_unbind (NULL, GUI_KEY_CONTEXT_DEFAULT, "meta-Qq"));
+    POINTERS_EQUAL(key2, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Qq"));
+
+    LONGS_EQUAL(1, gui_key_unbind (NULL, GUI_KEY_CONTEXT_DEFAULT, "meta-Qqa"));
+    POINTERS_EQUAL(NULL, gui_key_search_part (NULL, GUI_KEY_CONTEXT_DEFAULT,
+                                              "\x01[Qq"));
+
+    /* keys with area are ignored in cursor context */
+    POINTERS_EQUAL(NULL, gui_key_search_part (NULL, GUI_KEY_CONTEXT_CURSOR,
+                                              "@"));
+}
@@ -0,0 +1,159 @@
+/*
+ * test-line-index.cpp - test index of lines functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-input.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-line-index.h"
+}
+
+#define WEE_INDEX_SEARCH(__rc, __line, __start, __backward, __text)     \
+    gui_input_delete_line (buffer);                                     \
+    gui_input_insert_string (buffer, __text, -1);                       \
+    LONGS_EQUAL(__rc, gui_line_index_search (buffer, __start,           \
+                                             __backward, &line_found)); \
+    POINTERS_EQUAL(__line, line_found);
+
+TEST_GROUP(LineIndex)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_line_index_build
+ *   gui_line_index_add_line
+ *   gui_line_index_remove_line
+ *   gui_line_index_search
+ *   gui_line_index_free
+ */
+
+TEST(LineIndex, Search)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *line1, *line2, *line3, *line4, *line_found;
+
+    buffer = gui_buffer_new (NULL, "test_index",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    buffer->text_search_where = GUI_TEXT_SEARCH_IN_PREFIX
+        | GUI_TEXT_SEARCH_IN_MESSAGE;
+    buffer->text_search_exact = 0;
+    buffer->text_search_regex = 0;
+
+    gui_chat_printf (buffer, "first line");
+    gui_chat_printf (buffer, "nick\tsecond line");
+    gui_chat_printf (buffer, "third LINE, with \x19" "02color");
+    line1 = buffer->own_lines->first_line;
+    line2 = line1->next_line;
+    line3 = line2->next_line;
+
+    /* index is not built if buffer has not enough lines */
+    config_file_option_set (config_look_buffer_search_index, "10", 1);
+    gui_line_index_build (buffer);
+    POINTERS_EQUAL(NULL, buffer->lines->search_index);
+    WEE_INDEX_SEARCH(0, NULL, NULL, 1, "line");
+
+    config_file_option_set (config_look_buffer_search_index, "1", 1);
+    gui_line_index_build (buffer);
+    CHECK(buffer->lines->search_index);
+
+    /* text too short for the index */
+    WEE_INDEX_SEARCH(0, NULL, NULL, 1, "li");
+
+    /* text not found */
+    WEE_INDEX_SEARCH(1, NULL, NULL, 1, "xyz");
+    WEE_INDEX_SEARCH(1, NULL, NULL, 1, "line first");
+
+    /* search backward and forward */
+    WEE_INDEX_SEARCH(1, line3, NULL, 1, "line");
+    WEE_INDEX_SEARCH(1, line2, line3, 1, "line");
+    WEE_INDEX_SEARCH(1, line1, line2, 1, "LINE");
+    WEE_INDEX_SEARCH(1, NULL, line1, 1, "line");
+    WEE_INDEX_SEARCH(1, line1, NULL, 0, "line");
+    WEE_INDEX_SEARCH(1, line3, line2, 0, "line");
+
+    /* search in prefix and message without colors */
+    WEE_INDEX_SEARCH(1, line2, NULL, 1, "nick");
+    WEE_INDEX_SEARCH(1, line3, NULL, 1, "with color");
+    buffer->text_search_where = GUI_TEXT_SEARCH_IN_MESSAGE;
+    WEE_INDEX_SEARCH(1, NULL, NULL, 1, "nick");
+    buffer->text_search_where = GUI_TEXT_SEARCH_IN_PREFIX
+        | GUI_TEXT_SEARCH_IN_MESSAGE;
+
+    /* case sensitive search */
+    buffer->text_search_exact = 1;
+    WEE_INDEX_SEARCH(1, line3, NULL, 1, "LINE");
+    WEE_INDEX_SEARCH(1, line2, line3, 1, "line");
+    buffer->text_search_exact = 0;
+
+    /* new line is added in index */
+    gui_chat_printf (buffer, "fourth line");
+    line4 = buffer->own_lines->last_line;
+    WEE_INDEX_SEARCH(1, line4, NULL, 1, "fourth");
+
+    /* removed line is removed from index */
+    gui_line_free (buffer, line1);
+    WEE_INDEX_SEARCH(1, NULL, NULL, 1, "first");
+    WEE_INDEX_SEARCH(1, line2, NULL, 0, "line");
+
+    /* regex */
+    buffer->text_search_regex = 1;
+    gui_input_delete_line (buffer);
+    gui_input_insert_string (buffer, "se.ond", -1);
+    gui_input_search_compile_regex (buffer);
+    LONGS_EQUAL(1, gui_line_index_search (buffer, NULL, 1, &line_found));
+    POINTERS_EQUAL(line2, line_found);
+    gui_input_delete_line (buffer);
+    gui_input_insert_string (buffer, "se.o[n]d", -1);
+    gui_input_search_compile_regex (buffer);
+    LONGS_EQUAL(0, gui_line_index_search (buffer, NULL, 1, &line_found));
+    gui_input_delete_line (buffer);
+    gui_input_insert_string (buffer, "^thi+rd (line)?, w", -1);
+    gui_input_search_compile_regex (buffer);
+    LONGS_EQUAL(1, gui_line_index_search (buffer, NULL, 1, &line_found));
+    POINTERS_EQUAL(line3, line_found);
+    gui_input_delete_line (buffer);
+    gui_input_insert_string (buffer, "fourth|second", -1);
+    gui_input_search_compile_regex (buffer);
+    LONGS_EQUAL(0, gui_line_index_search (buffer, NULL, 1, &line_found));
+    gui_input_delete_line (buffer);
+    gui_input_insert_string (buffer, "fourth[a-z]*xyz", -1);
+    gui_input_search_compile_regex (buffer);
+    LONGS_EQUAL(1, gui_line_index_search (buffer, NULL, 1, &line_found));
+    POINTERS_EQUAL(NULL, line_found);
+    buffer->text_search_regex = 0;
+    gui_input_search_compile_regex (buffer);
+
+    gui_line_index_free (buffer->lines);
+    POINTERS_EQUAL(NULL, buffer->lines->search_index);
+    WEE_INDEX_SEARCH(0, NULL, NULL, 1, "line");
+
+    config_file_option_reset (config_look_buffer_search_index, 1);
+    gui_buffer_close (buffer);
+}
@@ -0,0 +1,831 @@
+/*
+ * test-line.cpp - test line functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "src/core/wee-string.h"
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-filter.h"
+#include "src/gui/gui-hotlist.h"
+#include "src/gui/gui-line.h"
+#include "src/gui/gui-line-cold.h"
+#include "src/gui/gui-line-scroll.h"
+
+extern struct t_gui_hotlist *gui_hotlist_search (struct t_gui_buffer *buffer);
+}
+
+#define TEST_LINES_COUNT (GUI_LINES_CHUNK_SIZE * 2 + 10)
+
+TEST_GROUP(Line)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_lines_alloc
+ *   gui_lines_alloc_line
+ *   gui_lines_free_line
+ *   gui_lines_get_line
+ *   gui_lines_free
+ */
+
+TEST(Line, Chunks)
+{
+    struct t_gui_lines *lines;
+    struct t_gui_line *ptr_lines[TEST_LINES_COUNT];
+    struct t_gui_line_data line_data[TEST_LINES_COUNT];
+    int i;
+
+    POINTERS_EQUAL(NULL, gui_lines_alloc_line (NULL));
+    POINTERS_EQUAL(NULL, gui_lines_get_line (NULL, 0));
+
+    lines = gui_lines_alloc ();
+    CHECK(lines);
+    POINTERS_EQUAL(NULL, lines->chunks);
+    LONGS_EQUAL(0, lines->chunks_count);
+    POINTERS_EQUAL(NULL, gui_lines_get_line (lines, 0));
+
+    /* allocate lines: 3 chunks are used */
+    for (i = 0; i < TEST_LINES_COUNT; i++)
+    {
+        ptr_lines[i] = gui_lines_alloc_line (lines);
+        CHECK(ptr_lines[i]);
+        ptr_lines[i]->data = &line_data[i];
+        lines->lines_count++;
+    }
+    LONGS_EQUAL(3, lines->chunks_count);
+    LONGS_EQUAL(0, lines->holes);
+    POINTERS_EQUAL(ptr_lines[0] + 1, ptr_lines[1]);
+    for (i = 0; i < TEST_LINES_COUNT; i++)
+    {
+        POINTERS_EQUAL(ptr_lines[i], gui_lines_get_line (lines, i));
+    }
+    POINTERS_EQUAL(NULL, gui_lines_get_line (lines, -1));
+    POINTERS_EQUAL(NULL, gui_lines_get_line (lines, TEST_LINES_COUNT));
+
+    /* remove first lines */
+    for (i = 0; i < 5; i++)
+    {
+        gui_lines_free_line (lines, ptr_lines[i]);
+        lines->lines_count--;
+    }
+    LONGS_EQUAL(5, lines->first_slot);
+    LONGS_EQUAL(0, lines->holes);
+    POINTERS_EQUAL(ptr_lines[5], gui_lines_get_line (lines, 0));
+    POINTERS_EQUAL(ptr_lines[GUI_LINES_CHUNK_SIZE],
+                   gui_lines_get_line (lines, GUI_LINES_CHUNK_SIZE - 5));
+
+    /* remove a line in the middle: a hole is created */
+    gui_lines_free_line (lines, ptr_lines[10]);
+    lines->lines_count--;
+    LONGS_EQUAL(1, lines->holes);
+    POINTERS_EQUAL(ptr_lines[9], gui_lines_get_line (lines, 4));
+    POINTERS_EQUAL(ptr_lines[11], gui_lines_get_line (lines, 5));
+    POINTERS_EQUAL(ptr_lines[TEST_LINES_COUNT - 1],
+                   gui_lines_get_line (lines, TEST_LINES_COUNT - 7));
+
+    /* remove lines until the hole: it is skipped */
+    for (i = 5; i < 10; i++)
+    {
+        gui_lines_free_line (lines, ptr_lines[i]);
+        lines->lines_count--;
+    }
+    LONGS_EQUAL(11, lines->first_slot);
+    LONGS_EQUAL(0, lines->holes);
+
+    /* remove all lines of first chunk: the chunk is freed */
+    for (i = 11; i < GUI_LINES_CHUNK_SIZE; i++)
+    {
+        gui_lines_free_line (lines, ptr_lines[i]);
+        lines->lines_count--;
+    }
+    LONGS_EQUAL(2, lines->chunks_count);
+    LONGS_EQUAL(0, lines->first_slot);
+    POINTERS_EQUAL(ptr_lines[GUI_LINES_CHUNK_SIZE],
+                   gui_lines_get_line (lines, 0));
+
+    /* remove last line: its slot is reused */
+    gui_lines_free_line (lines, ptr_lines[TEST_LINES_COUNT - 1]);
+    lines->lines_count--;
+    LONGS_EQUAL(0, lines->holes);
+    ptr_lines[TEST_LINES_COUNT - 1] = gui_lines_alloc_line (lines);
+    POINTERS_EQUAL(ptr_lines[TEST_LINES_COUNT - 2] + 1,
+                   ptr_lines[TEST_LINES_COUNT - 1]);
+    ptr_lines[TEST_LINES_COUNT - 1]->data = &line_data[TEST_LINES_COUNT - 1];
+    lines->lines_count++;
+    POINTERS_EQUAL(ptr_lines[TEST_LINES_COUNT - 1],
+                   gui_lines_get_line (lines, lines->lines_count - 1));
+
+    /* remove all lines */
+    for (i = GUI_LINES_CHUNK_SIZE; i < TEST_LINES_COUNT; i++)
+    {
+        gui_lines_free_line (lines, ptr_lines[i]);
+        lines->lines_count--;
+    }
+    LONGS_EQUAL(0, lines->chunks_count);
+    LONGS_EQUAL(0, lines->holes);
+
+    gui_lines_free (lines);
+}
+
+/*
+ * Tests functions:
+ *   gui_chat_layout_invalidate
+ */
+
+TEST(Line, LayoutInvalidate)
+{
+    struct t_gui_lines *lines;
+    struct t_gui_line *ptr_line;
+    int old_generation;
+
+    lines = gui_lines_alloc ();
+    CHECK(lines);
+
+    /* a new line has no layout cached */
+    ptr_line = gui_lines_alloc_line (lines);
+    CHECK(ptr_line);
+    LONGS_EQUAL(0, ptr_line->layout_generation);
+
+    old_generation = gui_chat_layout_generation;
+    CHECK(old_generation > 0);
+
+    gui_chat_layout_invalidate ();
+    LONGS_EQUAL(old_generation + 1, gui_chat_layout_generation);
+
+    /* generation 0 is never used (it means "no layout cached") */
+    gui_chat_layout_generation = INT_MAX;
+    gui_chat_layout_invalidate ();
+    LONGS_EQUAL(1, gui_chat_layout_generation);
+
+    gui_chat_layout_generation = old_generation;
+
+    gui_lines_free (lines);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_mixed_add
+ *   gui_line_free
+ *   gui_line_mixed_free_all
+ */
+
+TEST(Line, Mixed)
+{
+    struct t_gui_buffer *buffer1, *buffer2;
+    struct t_gui_line *ptr_line;
+    struct t_gui_line_data *ptr_data;
+    int i;
+
+    buffer1 = gui_buffer_new (NULL, "test_mixed1",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer1);
+    buffer2 = gui_buffer_new (NULL, "test_mixed2",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer2);
+
+    for (i = 0; i < TEST_LINES_COUNT; i++)
+    {
+        gui_chat_printf (buffer1, "line %d", i);
+        gui_chat_printf (buffer2, "line %d", i);
+    }
+    POINTERS_EQUAL(NULL, buffer1->own_lines->first_line->data->mixed_line);
+
+    /* merge buffers: each line data points to its mixed line */
+    gui_buffer_merge (buffer2, buffer1);
+    CHECK(buffer1->mixed_lines);
+    POINTERS_EQUAL(buffer1->mixed_lines, buffer2->mixed_lines);
+    LONGS_EQUAL(TEST_LINES_COUNT * 2, buffer1->mixed_lines->lines_count);
+    for (ptr_line = buffer1->mixed_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        POINTERS_EQUAL(ptr_line, ptr_line->data->mixed_line);
+    }
+
+    /* delete a line: its mixed line is removed too */
+    ptr_data = buffer1->own_lines->last_line->data;
+    ptr_line = ptr_data->mixed_line;
+    CHECK(ptr_line);
+    gui_line_free (buffer1, buffer1->own_lines->last_line);
+    LONGS_EQUAL(TEST_LINES_COUNT * 2 - 1, buffer1->mixed_lines->lines_count);
+    for (ptr_line = buffer1->mixed_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        POINTERS_EQUAL(ptr_line, ptr_line->data->mixed_line);
+    }
+
+    /* unmerge buffers: all mixed lines are freed */
+    gui_buffer_unmerge (buffer2, -1);
+    POINTERS_EQUAL(NULL, buffer1->mixed_lines);
+    POINTERS_EQUAL(NULL, buffer2->mixed_lines);
+    POINTERS_EQUAL(buffer1->own_lines, buffer1->lines);
+    for (ptr_line = buffer1->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        POINTERS_EQUAL(NULL, ptr_line->data->mixed_line);
+    }
+    for (ptr_line = buffer2->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        POINTERS_EQUAL(NULL, ptr_line->data->mixed_line);
+    }
+    LONGS_EQUAL(TEST_LINES_COUNT - 1, buffer1->own_lines->lines_count);
+    LONGS_EQUAL(TEST_LINES_COUNT, buffer2->own_lines->lines_count);
+
+    gui_buffer_close (buffer1);
+    gui_buffer_close (buffer2);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_free_all
+ *   gui_lines_detached_free
+ */
+
+TEST(Line, Detached)
+{
+    struct t_gui_buffer *buffer1, *buffer2;
+    int i, count;
+
+    gui_lines_detached_free (-1);
+    POINTERS_EQUAL(NULL, gui_lines_detached);
+    LONGS_EQUAL(0, gui_lines_detached_count);
+
+    buffer1 = gui_buffer_new (NULL, "test_detached1",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer1);
+    buffer2 = gui_buffer_new (NULL, "test_detached2",
+                              NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer2);
+
+    /* few lines: they are freed immediately */
+    for (i = 0; i < TEST_LINES_COUNT; i++)
+    {
+        gui_chat_printf (buffer1, "line %d", i);
+    }
+    gui_buffer_clear (buffer1);
+    LONGS_EQUAL(0, buffer1->own_lines->lines_count);
+    POINTERS_EQUAL(NULL, gui_lines_detached);
+
+    /* many lines (in merged buffers): they are detached from buffer */
+    count = GUI_LINES_DETACHED_MIN_LINES + 100;
+    for (i = 0; i < count; i++)
+    {
+        gui_chat_printf (buffer1, "line %d", i);
+        gui_chat_printf (buffer2, "line %d", i);
+    }
+    gui_buffer_merge (buffer2, buffer1);
+    LONGS_EQUAL(count * 2, buffer1->mixed_lines->lines_count);
+    gui_buffer_clear (buffer1);
+    POINTERS_EQUAL(NULL, buffer1->own_lines->first_line);
+    POINTERS_EQUAL(NULL, buffer1->own_lines->last_line);
+    LONGS_EQUAL(0, buffer1->own_lines->lines_count);
+    LONGS_EQUAL(0, buffer1->own_lines->chunks_count);
+    LONGS_EQUAL(count, buffer1->mixed_lines->lines_count);
+    CHECK(gui_lines_detached);
+    LONGS_EQUAL(count, gui_lines_detached_count);
+
+    /* free some lines */
+    gui_lines_detached_free (100);
+    LONGS_EQUAL(count - 100, gui_lines_detached_count);
+
+    /* buffer can still be used */
+    gui_chat_printf (buffer1, "new line");
+    LONGS_EQUAL(1, buffer1->own_lines->lines_count);
+    STRCMP_EQUAL("new line", buffer1->own_lines->first_line->data->message);
+    LONGS_EQUAL(count + 1, buffer1->mixed_lines->lines_count);
+
+    /* close buffer: its lines are detached too */
+    gui_buffer_close (buffer2);
+    LONGS_EQUAL(count - 100 + count, gui_lines_detached_count);
+
+    /* free all lines */
+    gui_lines_detached_free (-1);
+    POINTERS_EQUAL(NULL, gui_lines_detached);
+    LONGS_EQUAL(0, gui_lines_detached_count);
+
+    gui_buffer_close (buffer1);
+}
+
+/*
+ * Tests functions:
+ *   gui_lines_prefix_length_add
+ *   gui_lines_prefix_length_remove
+ *   gui_line_compute_prefix_max_length
+ */
+
+TEST(Line, PrefixMaxLength)
+{
+    struct t_gui_buffer *buffer;
+
+    buffer = gui_buffer_new (NULL, "test_prefix",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(-1, buffer->own_lines->prefix_lengths_max);
+
+    gui_chat_printf (buffer, "a\tline 1");
+    gui_chat_printf (buffer, "abcdef\tline 2");
+    gui_chat_printf (buffer, "abc\tline 3");
+    gui_chat_printf (buffer, "abcdef\tline 4");
+    LONGS_EQUAL(6, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(6, buffer->own_lines->prefix_lengths_max);
+    LONGS_EQUAL(2, buffer->own_lines->prefix_lengths[6]);
+
+    /* remove lines with longest prefix: max is updated without full scan */
+    gui_line_free (buffer, buffer->own_lines->last_line);
+    LONGS_EQUAL(6, buffer->own_lines->prefix_max_length);
+    gui_line_free (buffer, buffer->own_lines->first_line->next_line);
+    LONGS_EQUAL(3, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(3, buffer->own_lines->prefix_lengths_max);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_max_length_refresh);
+
+    /* full computation gives the same result */
+    gui_line_compute_prefix_max_length (buffer->own_lines);
+    LONGS_EQUAL(3, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_lengths[1]);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_lengths[3]);
+
+    gui_buffer_clear (buffer);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(-1, buffer->own_lines->prefix_lengths_max);
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_cold_save
+ *   gui_line_cold_load
+ *   gui_line_cold_free
+ */
+
+TEST(Line, Cold)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    char message[32];
+    int i;
+
+    config_file_option_set (config_history_max_buffer_lines_number, "10", 1);
+    config_file_option_set (config_history_buffer_lines_on_disk, "on", 1);
+
+    buffer = gui_buffer_new (NULL, "test_cold",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    LONGS_EQUAL(0, gui_line_cold_load (buffer, 10));
+
+    /* 20 lines removed from buffer are saved in file */
+    for (i = 0; i < 30; i++)
+    {
+        gui_chat_printf (buffer, "line %d", i);
+    }
+    LONGS_EQUAL(10, buffer->own_lines->lines_count);
+    CHECK(buffer->lines_cold);
+    CHECK(buffer->lines_cold->size > 0);
+    LONGS_EQUAL(buffer->lines_cold->size, buffer->lines_cold->offset);
+    STRCMP_EQUAL("line 20", buffer->own_lines->first_line->data->message);
+
+    /* load the 5 most recent lines removed */
+    LONGS_EQUAL(5, gui_line_cold_load (buffer, 5));
+    LONGS_EQUAL(15, buffer->own_lines->lines_count);
+    LONGS_EQUAL(5, buffer->lines_cold->lines_loaded);
+    for (ptr_line = buffer->own_lines->first_line, i = 15; ptr_line;
+         ptr_line = ptr_line->next_line, i++)
+    {
+        snprintf (message, sizeof (message), "line %d", i);
+        STRCMP_EQUAL(message, ptr_line->data->message);
+        if (ptr_line->next_line)
+        {
+            CHECK(ptr_line->id < ptr_line->next_line->id);
+            /* id of line data is kept in file */
+            LONGS_EQUAL(ptr_line->data->id + 1,
+                        ptr_line->next_line->data->id);
+        }
+    }
+
+    /* new line: lines loaded are removed again, without writing them */
+    gui_chat_printf (buffer, "line %d", 30);
+    LONGS_EQUAL(10, buffer->own_lines->lines_count);
+    LONGS_EQUAL(0, buffer->lines_cold->lines_loaded);
+    LONGS_EQUAL(buffer->lines_cold->size, buffer->lines_cold->offset);
+    STRCMP_EQUAL("line 21", buffer->own_lines->first_line->data->message);
+
+    /* load all lines removed */
+    LONGS_EQUAL(21, gui_line_cold_load (buffer, 100));
+    LONGS_EQUAL(31, buffer->own_lines->lines_count);
+    LONGS_EQUAL(0, buffer->lines_cold->offset);
+    STRCMP_EQUAL("line 0", buffer->own_lines->first_line->data->message);
+    LONGS_EQUAL(0, gui_line_cold_load (buffer, 100));
+
+    /* clear buffer: file is deleted */
+    gui_buffer_clear (buffer);
+    POINTERS_EQUAL(NULL, buffer->lines_cold);
+
+    gui_buffer_close (buffer);
+
+    config_file_option_reset (config_history_buffer_lines_on_disk, 1);
+    config_file_option_reset (config_history_max_buffer_lines_number, 1);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_scroll_build
+ *   gui_line_scroll_add_line
+ *   gui_line_scroll_remove_line
+ *   gui_line_scroll_search
+ *   gui_line_scroll_free
+ */
+
+TEST(Line, Scroll)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_filter *filter;
+    struct t_gui_line_scroll *scroll;
+    struct t_gui_line *ptr_line;
+    char str_message[64];
+    int i;
+
+    buffer = gui_buffer_new (NULL, "test_scroll",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    /* one line per minute, odd lines are hidden by filter */
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_message, sizeof (str_message), "line %d", i);
+        gui_chat_printf_date_tags (buffer, 1000000 + (i * 60),
+                                   (i % 2) ? "test_hide" : NULL,
+                                   "%s", str_message);
+    }
+    filter = gui_filter_new (1, "test_scroll", "core.test_scroll",
+                             "test_hide", "*");
+    CHECK(filter);
+    gui_filter_all_buffers (filter);
+    LONGS_EQUAL(500, buffer->own_lines->lines_hidden);
+
+    scroll = gui_line_scroll_build (buffer->own_lines);
+    CHECK(scroll);
+    POINTERS_EQUAL(scroll, buffer->own_lines->scroll_index);
+    LONGS_EQUAL(500, scroll->end - scroll->start);
+    POINTERS_EQUAL(scroll, gui_line_scroll_build (buffer->own_lines));
+
+    /* scroll by number of messages */
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, NULL, -1, 10, ' ',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 978", ptr_line->data->message);
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, ptr_line, +1, 5, ' ',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 988", ptr_line->data->message);
+    LONGS_EQUAL(0, gui_line_scroll_search (scroll, ptr_line, +1, 100, ' ',
+                                           &ptr_line));
+    POINTERS_EQUAL(NULL, ptr_line);
+    LONGS_EQUAL(0, gui_line_scroll_search (scroll, NULL, -1, 500, ' ',
+                                           &ptr_line));
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, NULL, -1, 499, ' ',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 0", ptr_line->data->message);
+
+    /* start on a hidden line */
+    ptr_line = buffer->own_lines->last_line->prev_line->prev_line;
+    STRCMP_EQUAL("line 997", ptr_line->data->message);
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, ptr_line, -1, 1, ' ',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 994", ptr_line->data->message);
+
+    /* scroll by time */
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, NULL, -1, 1, 'h',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 938", ptr_line->data->message);
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, NULL, +1, 10, 'h',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 600", ptr_line->data->message);
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, NULL, +1, 0, 'm',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 2", ptr_line->data->message);
+    LONGS_EQUAL(0, gui_line_scroll_search (scroll, NULL, -1, 1, 'd',
+                                           &ptr_line));
+
+    /* lines added and removed are updated in index */
+    gui_chat_printf_date_tags (buffer, 1000000 + (1000 * 60), NULL,
+                               "line 1000");
+    gui_chat_printf_date_tags (buffer, 1000000 + (1001 * 60), "test_hide",
+                               "line 1001");
+    POINTERS_EQUAL(scroll, buffer->own_lines->scroll_index);
+    LONGS_EQUAL(501, scroll->end - scroll->start);
+    gui_line_free (buffer, buffer->own_lines->first_line);
+    gui_line_free (buffer, buffer->own_lines->first_line);
+    POINTERS_EQUAL(scroll, buffer->own_lines->scroll_index);
+    LONGS_EQUAL(500, scroll->end - scroll->start);
+    LONGS_EQUAL(1, gui_line_scroll_search (scroll, NULL, -1, 499, ' ',
+                                           &ptr_line));
+    STRCMP_EQUAL("line 2", ptr_line->data->message);
+
+    /* filter disabled: index is built again */
+    filter->enabled = 0;
+    gui_filter_all_buffers (filter);
+    scroll = gui_line_scroll_build (buffer->own_lines);
+    CHECK(scroll);
+    LONGS_EQUAL(1000, scroll->end - scroll->start);
+
+    gui_filter_free (filter);
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_tags_get_known
+ *   gui_line_tags_compute_mask
+ *   gui_line_has_tag_no_filter
+ *   gui_line_match_tags
+ *   gui_line_get_notify_level
+ */
+
+TEST(Line, TagsMask)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *ptr_line;
+    char **tags[2];
+    int i;
+
+    /* well-known tags are sorted */
+    for (i = 0; i < GUI_LINE_NUM_TAGS; i++)
+    {
+        LONGS_EQUAL(i, gui_line_tags_get_known (gui_line_tags_known[i]));
+        if (i > 0)
+            CHECK(strcmp (gui_line_tags_known[i - 1], gui_line_tags_known[i]) < 0);
+    }
+    LONGS_EQUAL(GUI_LINE_TAG_NOTIFY_NONE, gui_line_tags_get_known ("NOTIFY_none"));
+    LONGS_EQUAL(-1, gui_line_tags_get_known ("nick_test"));
+    LONGS_EQUAL(-1, gui_line_tags_get_known (NULL));
+
+    buffer = gui_buffer_new (NULL, "test_tags",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    gui_chat_printf_date_tags (buffer, 0, "irc_privmsg,notify_message,nick_a",
+                               "a\tline 1");
+    ptr_line = buffer->own_lines->last_line;
+    UNSIGNED_LONGS_EQUAL(GUI_LINE_TAG_BIT(GUI_LINE_TAG_IRC_PRIVMSG)
+                         | GUI_LINE_TAG_BIT(GUI_LINE_TAG_NOTIFY_MESSAGE),
+                         ptr_line->data->tags_mask);
+    LONGS_EQUAL(0, gui_line_has_tag_no_filter (ptr_line->data));
+    LONGS_EQUAL(GUI_HOTLIST_MESSAGE, gui_line_get_notify_level (ptr_line));
+
+    tags[0] = string_split_shared ("irc_privmsg,!notify_none", ",", 0, 0, NULL);
+    tags[1] = string_split_shared ("nick_*", ",", 0, 0, NULL);
+    LONGS_EQUAL(1, gui_line_match_tags (ptr_line->data, 1, tags));
+    LONGS_EQUAL(1, gui_line_match_tags (ptr_line->data, 1, tags + 1));
+    string_free_split_shared (tags[0]);
+    tags[0] = string_split_shared ("IRC_PRIVMSG,!notify_message", ",", 0, 0, NULL);
+    LONGS_EQUAL(0, gui_line_match_tags (ptr_line->data, 1, tags));
+    LONGS_EQUAL(1, gui_line_match_tags (ptr_line->data, 2, tags));
+    string_free_split_shared (tags[0]);
+    string_free_split_shared (tags[1]);
+
+    /* many tags "notify_xxx": the first one is used */
+    gui_chat_printf_date_tags (buffer, 0,
+                               "no_filter,notify_private,notify_none",
+                               "line 2");
+    ptr_line = buffer->own_lines->last_line;
+    LONGS_EQUAL(1, gui_line_has_tag_no_filter (ptr_line->data));
+    LONGS_EQUAL(GUI_HOTLIST_PRIVATE, gui_line_get_notify_level (ptr_line));
+
+    gui_chat_printf_date_tags (buffer, 0, NULL, "line 3");
+    ptr_line = buffer->own_lines->last_line;
+    UNSIGNED_LONGS_EQUAL(0, ptr_line->data->tags_mask);
+    LONGS_EQUAL(GUI_HOTLIST_LOW, gui_line_get_notify_level (ptr_line));
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_set_batch
+ *   gui_line_hotlist_add
+ */
+
+TEST(Line, Batch)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_hotlist *ptr_hotlist;
+    time_t date;
+    int i;
+
+    gui_hotlist_clear (GUI_HOTLIST_MASK_MAX);
+    gui_hotlist_flush ();
+
+    buffer = gui_buffer_new (NULL, "test_batch",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    /* end of batch without batch started: nothing done */
+    gui_line_set_batch (buffer, 0);
+    LONGS_EQUAL(0, buffer->lines_batch);
+    POINTERS_EQUAL(NULL, buffer->lines_batch_hotlist);
+
+    /* add lines in a batch, with dates older than the last line */
+    gui_buffer_set (buffer, "lines_batch", "1");
+    LONGS_EQUAL(1, gui_buffer_get_integer (buffer, "lines_batch"));
+    CHECK(buffer->lines_batch_hotlist);
+    date = time (NULL) - 3600;
+    for (i = 0; i < 100; i++)
+    {
+        gui_chat_printf_date_tags (buffer, date - i, "notify_message",
+                                   "nick\tline %d", i);
+    }
+    gui_chat_printf_date_tags (buffer, date, "notify_highlight",
+                               "nick\thighlight");
+    LONGS_EQUAL(101, buffer->lines_batch_count);
+    LONGS_EQUAL(101, buffer->own_lines->lines_count);
+    LONGS_EQUAL(date - 99, buffer->own_lines->last_line->prev_line->data->date);
+    LONGS_EQUAL(100, buffer->lines_batch_hotlist[GUI_HOTLIST_MESSAGE]);
+    LONGS_EQUAL(1, buffer->lines_batch_hotlist[GUI_HOTLIST_HIGHLIGHT]);
+    POINTERS_EQUAL(NULL, gui_hotlist_search (buffer));
+
+    /* end of batch: hotlist is updated with counts of the whole batch */
+    gui_buffer_set (buffer, "lines_batch", "0");
+    LONGS_EQUAL(0, buffer->lines_batch);
+    LONGS_EQUAL(0, buffer->lines_batch_count);
+    POINTERS_EQUAL(NULL, buffer->lines_batch_hotlist);
+    ptr_hotlist = gui_hotlist_search (buffer);
+    CHECK(ptr_hotlist);
+    LONGS_EQUAL(GUI_HOTLIST_HIGHLIGHT, ptr_hotlist->priority);
+    LONGS_EQUAL(100, ptr_hotlist->count[GUI_HOTLIST_MESSAGE]);
+    LONGS_EQUAL(1, ptr_hotlist->count[GUI_HOTLIST_HIGHLIGHT]);
+
+    /* lines added outside a batch: hotlist is updated immediately */
+    gui_chat_printf_date_tags (buffer, 0, "notify_message", "nick\tline");
+    LONGS_EQUAL(101, ptr_hotlist->count[GUI_HOTLIST_MESSAGE]);
+
+    gui_hotlist_clear (GUI_HOTLIST_MASK_MAX);
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_chat_print_lines
+ */
+
+TEST(Line, PrintLines)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_hotlist *ptr_hotlist;
+    const char *lines[4] = { "nick\tline 1", NULL, "line 2\nline 3",
+                             "\t\tline 4" };
+
+    gui_hotlist_clear (GUI_HOTLIST_MASK_MAX);
+    gui_hotlist_flush ();
+
+    buffer = gui_buffer_new (NULL, "test_print_lines",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    /* invalid arguments: nothing is printed */
+    gui_chat_print_lines (buffer, 0, NULL, NULL, 4);
+    gui_chat_print_lines (buffer, 0, NULL, lines, 0);
+    LONGS_EQUAL(0, buffer->own_lines->lines_count);
+
+    /* lines added in a batch, ended after the lines */
+    gui_chat_print_lines (buffer, 0, "notify_message", lines, 4);
+    LONGS_EQUAL(0, buffer->lines_batch);
+    POINTERS_EQUAL(NULL, buffer->lines_batch_hotlist);
+    LONGS_EQUAL(4, buffer->own_lines->lines_count);
+    STRCMP_EQUAL("nick", buffer->own_lines->first_line->data->prefix);
+    STRCMP_EQUAL("line 1", buffer->own_lines->first_line->data->message);
+    STRCMP_EQUAL("line 3",
+                 buffer->own_lines->last_line->prev_line->data->message);
+    LONGS_EQUAL(0, buffer->own_lines->last_line->data->date);
+    STRCMP_EQUAL("line 4", buffer->own_lines->last_line->data->message);
+    ptr_hotlist = gui_hotlist_search (buffer);
+    CHECK(ptr_hotlist);
+    LONGS_EQUAL(4, ptr_hotlist->count[GUI_HOTLIST_MESSAGE]);
+
+    /* batch already in progress: it is not ended */
+    gui_line_set_batch (buffer, 1);
+    gui_chat_print_lines (buffer, 0, "notify_message", lines, 1);
+    LONGS_EQUAL(1, buffer->lines_batch);
+    LONGS_EQUAL(1, buffer->lines_batch_count);
+    LONGS_EQUAL(4, ptr_hotlist->count[GUI_HOTLIST_MESSAGE]);
+    gui_line_set_batch (buffer, 0);
+    LONGS_EQUAL(5, ptr_hotlist->count[GUI_HOTLIST_MESSAGE]);
+
+    gui_hotlist_clear (GUI_HOTLIST_MASK_MAX);
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_line_data_get_memory
+ *   gui_lines_get_memory
+ */
+
+TEST(Line, Memory)
+{
+    struct t_gui_buffer *buffer;
+    long size, size_data;
+
+    LONGS_EQUAL(0, gui_line_data_get_memory (NULL));
+    LONGS_EQUAL(0, gui_lines_get_memory (NULL, 0));
+    LONGS_EQUAL(0, gui_lines_get_memory (NULL, 1));
+
+    buffer = gui_buffer_new (NULL, "test_memory",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    LONGS_EQUAL(sizeof (struct t_gui_lines),
+                gui_lines_get_memory (buffer->own_lines, 1));
+
+    gui_chat_printf_date_tags (buffer, 0, "tag1,tag2", "nick\tmessage");
+    size_data = gui_line_data_get_memory (buffer->own_lines->first_line->data);
+    CHECK(size_data > (long)(sizeof (struct t_gui_line_data)
+                             + strlen ("message")));
+    size = gui_lines_get_memory (buffer->own_lines, 1);
+    LONGS_EQUAL(sizeof (struct t_gui_lines) + sizeof (struct t_gui_line)
+                + size_data,
+                size);
+    LONGS_EQUAL(sizeof (struct t_gui_lines) + sizeof (struct t_gui_line),
+                gui_lines_get_memory (buffer->own_lines, 0));
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_chat_get_time_string_cached
+ *   gui_chat_get_time_string
+ */
+
+TEST(Line, TimeStringCache)
+{
+    struct t_gui_buffer *buffer;
+    const char *str_time, *str_time2;
+    char *str_time3;
+    time_t date;
+
+    date = 1500000000;
+
+    POINTERS_EQUAL(NULL, gui_chat_get_time_string_cached (0));
+
+    /* same date: same string in cache */
+    str_time = gui_chat_get_time_string_cached (date);
+    CHECK(str_time);
+    POINTERS_EQUAL(str_time, gui_chat_get_time_string_cached (date));
+    str_time3 = gui_chat_get_time_string (date);
+    STRCMP_EQUAL(str_time, str_time3);
+    CHECK(str_time3 != str_time);
+    free (str_time3);
+
+    /* other date: other string */
+    str_time2 = gui_chat_get_time_string_cached (date + 3600);
+    CHECK(str_time2);
+    CHECK(str_time2 != str_time);
+    POINTERS_EQUAL(str_time, gui_chat_get_time_string_cached (date));
+
+    /* time of lines uses the cache and the time format */
+    buffer = gui_buffer_new (NULL, "test_time",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+    gui_chat_printf_date_tags (buffer, date, NULL, "message");
+    STRCMP_EQUAL(gui_chat_get_time_string_cached (date),
+                 buffer->own_lines->last_line->data->str_time);
+    config_file_option_set (config_look_buffer_time_format, "%Y", 1);
+    str_time = gui_chat_get_time_string_cached (date);
+    STRCMP_EQUAL(str_time, buffer->own_lines->last_line->data->str_time);
+    str_time3 = gui_color_decode (str_time, NULL);
+    STRCMP_EQUAL("2017", str_time3);
+    free (str_time3);
+    config_file_option_set (config_look_buffer_time_format, "", 1);
+    POINTERS_EQUAL(NULL, gui_chat_get_time_string_cached (date));
+    config_file_option_reset (config_look_buffer_time_format, 1);
+    gui_buffer_close (buffer);
+}
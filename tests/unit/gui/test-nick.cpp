@@ -0,0 +1,98 @@
+/*
+ * test-nick.cpp - test nick functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-hashtable.h"
+#include "src/gui/gui-color.h"
+#include "src/gui/gui-nick.h"
+}
+
+TEST_GROUP(Nick)
+{
+};
+
+/*
+ * Tests functions:
+ *   gui_nick_find_color
+ *   gui_nick_find_color_name
+ *   gui_nick_color_cache_clear
+ */
+
+TEST(Nick, FindColor)
+{
+    char nick[32], color[32];
+    const char *ptr_color;
+    int i;
+
+    config_file_option_set (config_look_nick_color_force, "", 1);
+    config_file_option_set (config_color_chat_nick_colors,
+                            "red,green,blue", 1);
+
+    STRCMP_EQUAL("default", gui_nick_find_color_name (NULL));
+    STRCMP_EQUAL("default", gui_nick_find_color_name (""));
+
+    /* same color for same nick, from cache */
+    ptr_color = gui_nick_find_color_name ("alice");
+    CHECK(strcmp (ptr_color, "red") == 0
+          || strcmp (ptr_color, "green") == 0
+          || strcmp (ptr_color, "blue") == 0);
+    LONGS_EQUAL(1, gui_nick_color_cache->items_count);
+    STRCMP_EQUAL(ptr_color, gui_nick_find_color_name ("alice"));
+    STRCMP_EQUAL(gui_color_get_custom (ptr_color),
+                 gui_nick_find_color ("alice"));
+    LONGS_EQUAL(1, gui_nick_color_cache->items_count);
+
+    /* forced color: cache is cleared */
+    config_file_option_set (config_look_nick_color_force, "alice:yellow", 1);
+    LONGS_EQUAL(0, gui_nick_color_cache->items_count);
+    STRCMP_EQUAL("yellow", gui_nick_find_color_name ("alice"));
+    snprintf (color, sizeof (color), "%s", gui_color_get_custom ("yellow"));
+    STRCMP_EQUAL(color, gui_nick_find_color ("alice"));
+
+    /* stop chars are used as key of forced color, not the nick */
+    STRCMP_EQUAL("yellow", gui_nick_find_color_name ("alice|away"));
+    LONGS_EQUAL(2, gui_nick_color_cache->items_count);
+
+    /* cache size is limited */
+    for (i = 0; i < GUI_NICK_COLOR_CACHE_SIZE + 10; i++)
+    {
+        snprintf (nick, sizeof (nick), "nick%d", i);
+        gui_nick_find_color (nick);
+    }
+    LONGS_EQUAL(GUI_NICK_COLOR_CACHE_SIZE, gui_nick_color_cache->items_count);
+    POINTERS_EQUAL(NULL, hashtable_get (gui_nick_color_cache, "alice"));
+    CHECK(hashtable_get (gui_nick_color_cache, "nick10"));
+
+    /* new nick colors: cache is cleared */
+    config_file_option_set (config_color_chat_nick_colors, "cyan", 1);
+    LONGS_EQUAL(0, gui_nick_color_cache->items_count);
+    STRCMP_EQUAL("cyan", gui_nick_find_color_name ("nick1"));
+
+    config_file_option_reset (config_look_nick_color_force, 1);
+    config_file_option_reset (config_color_chat_nick_colors, 1);
+}
@@ -0,0 +1,440 @@
+/*
+ * test-nicklist.cpp - test nicklist functions
+ *
+ * Copyright (C) 2017 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-bar-item.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-nicklist.h"
+#include "src/plugins/plugin.h"
+
+extern int gui_nicklist_find_pos_nick (struct t_gui_nick_group *group,
+                                       struct t_gui_nick *nick);
+}
+
+int test_nicklist_signals_count = 0;
+
+TEST_GROUP(Nicklist)
+{
+};
+
+/*
+ * Callback for nicklist signals (counts signals received).
+ */
+
+int
+test_nicklist_signal_cb (const void *pointer, void *data,
+                         const char *signal, const char *type_data,
+                         void *signal_data)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    test_nicklist_signals_count++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Tests functions:
+ *   gui_nicklist_index_add
+ *   gui_nicklist_index_remove
+ *   gui_nicklist_search_group
+ */
+
+TEST(Nicklist, SearchGroup)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group_ops, *group_voices, *group_sub, *group_sub2;
+
+    buffer = gui_buffer_new (NULL, "test_nicklist",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    group_ops = gui_nicklist_add_group (buffer, NULL, "000|o", NULL, 1);
+    CHECK(group_ops);
+    group_voices = gui_nicklist_add_group (buffer, NULL, "001|v", NULL, 1);
+    CHECK(group_voices);
+    group_sub = gui_nicklist_add_group (buffer, group_ops, "sub", NULL, 1);
+    CHECK(group_sub);
+
+    /* group already exists */
+    POINTERS_EQUAL(NULL, gui_nicklist_add_group (buffer, NULL, "000|o",
+                                                 NULL, 1));
+
+    POINTERS_EQUAL(buffer->nicklist_root,
+                   gui_nicklist_search_group (buffer, NULL, "root"));
+    POINTERS_EQUAL(group_ops,
+                   gui_nicklist_search_group (buffer, NULL, "000|o"));
+    POINTERS_EQUAL(group_ops,
+                   gui_nicklist_search_group (buffer, NULL, "o"));
+    POINTERS_EQUAL(NULL,
+                   gui_nicklist_search_group (buffer, NULL, "002|o"));
+    POINTERS_EQUAL(group_voices,
+                   gui_nicklist_search_group (buffer, NULL, "v"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_group (buffer, NULL, "h"));
+    POINTERS_EQUAL(group_sub,
+                   gui_nicklist_search_group (buffer, NULL, "sub"));
+    POINTERS_EQUAL(group_sub,
+                   gui_nicklist_search_group (buffer, group_ops, "sub"));
+    POINTERS_EQUAL(NULL,
+                   gui_nicklist_search_group (buffer, group_sub, "000|o"));
+
+    /* same name in another group: nicklist is searched */
+    group_sub2 = gui_nicklist_add_group (buffer, group_voices, "sub", NULL, 1);
+    CHECK(group_sub2);
+    POINTERS_EQUAL(NULL, hashtable_get (buffer->nicklist_groups_index, "sub"));
+    POINTERS_EQUAL(group_sub,
+                   gui_nicklist_search_group (buffer, NULL, "sub"));
+    POINTERS_EQUAL(group_sub2,
+                   gui_nicklist_search_group (buffer, group_voices, "sub"));
+
+    /* remove groups */
+    gui_nicklist_remove_group (buffer, group_sub2);
+    POINTERS_EQUAL(group_sub,
+                   gui_nicklist_search_group (buffer, NULL, "sub"));
+    gui_nicklist_remove_group (buffer, group_ops);
+    POINTERS_EQUAL(NULL, gui_nicklist_search_group (buffer, NULL, "o"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_group (buffer, NULL, "sub"));
+    POINTERS_EQUAL(group_voices,
+                   gui_nicklist_search_group (buffer, NULL, "001|v"));
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_nicklist_find_pos_nick
+ *   gui_nicklist_insert_nick_sorted
+ *   gui_nicklist_remove_sorted_nick
+ *   gui_nicklist_search_nick
+ */
+
+TEST(Nicklist, SearchNick)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group;
+    struct t_gui_nick *nick, *nick_alice, *ptr_nick, *nicks[100];
+    char name[64];
+    int i, count;
+
+    buffer = gui_buffer_new (NULL, "test_nicklist",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    group = gui_nicklist_add_group (buffer, NULL, "000|o", NULL, 1);
+    CHECK(group);
+
+    nick_alice = gui_nicklist_add_nick (buffer, group, "alice",
+                                        NULL, "@", NULL, 1);
+    CHECK(nick_alice);
+    POINTERS_EQUAL(NULL, gui_nicklist_add_nick (buffer, NULL, "alice",
+                                                NULL, NULL, NULL, 1));
+
+    POINTERS_EQUAL(nick_alice, gui_nicklist_search_nick (buffer, NULL,
+                                                         "alice"));
+    POINTERS_EQUAL(nick_alice, gui_nicklist_search_nick (buffer, group,
+                                                         "alice"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "ALICE"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "bob"));
+
+    /* many nicks, in random order */
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (name, sizeof (name), "%c%c_nick%d",
+                  'a' + ((i * 7) % 26), 'A' + ((i * 13) % 26), i);
+        nicks[i] = gui_nicklist_add_nick (buffer, NULL, name,
+                                          NULL, NULL, NULL, 1);
+        CHECK(nicks[i]);
+    }
+    nick = gui_nicklist_add_nick (buffer, NULL, "ALICE", NULL, NULL, NULL, 1);
+    CHECK(nick);
+    LONGS_EQUAL(102, buffer->nicklist_nicks_count);
+    LONGS_EQUAL(101, buffer->nicklist_root->sorted_nicks_count);
+
+    for (i = 0; i < 100; i++)
+    {
+        POINTERS_EQUAL(nicks[i],
+                       gui_nicklist_search_nick (buffer, NULL,
+                                                 nicks[i]->name));
+        POINTERS_EQUAL(NULL,
+                       gui_nicklist_search_nick (buffer, group,
+                                                 nicks[i]->name));
+    }
+    POINTERS_EQUAL(nick, gui_nicklist_search_nick (buffer, NULL, "ALICE"));
+    POINTERS_EQUAL(nick_alice, gui_nicklist_search_nick (buffer, NULL,
+                                                         "alice"));
+
+    /* nicks are sorted (ignoring case) in list and in sorted nicks */
+    count = 0;
+    for (ptr_nick = buffer->nicklist_root->nicks; ptr_nick;
+         ptr_nick = ptr_nick->next_nick)
+    {
+        POINTERS_EQUAL(buffer->nicklist_root->sorted_nicks[count], ptr_nick);
+        if (ptr_nick->next_nick)
+        {
+            CHECK(string_strcasecmp (ptr_nick->name,
+                                     ptr_nick->next_nick->name) <= 0);
+        }
+        count++;
+    }
+    LONGS_EQUAL(101, count);
+    POINTERS_EQUAL(buffer->nicklist_root->sorted_nicks[100],
+                   buffer->nicklist_root->last_nick);
+    LONGS_EQUAL(101,
+                gui_nicklist_find_pos_nick (buffer->nicklist_root,
+                                            buffer->nicklist_root->last_nick));
+
+    /* remove nicks */
+    for (i = 0; i < 100; i += 2)
+    {
+        gui_nicklist_remove_nick (buffer, nicks[i]);
+    }
+    LONGS_EQUAL(51, buffer->nicklist_root->sorted_nicks_count);
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (name, sizeof (name), "%c%c_nick%d",
+                  'a' + ((i * 7) % 26), 'A' + ((i * 13) % 26), i);
+        if (i % 2 == 0)
+        {
+            POINTERS_EQUAL(NULL,
+                           gui_nicklist_search_nick (buffer, NULL, name));
+        }
+        else
+        {
+            POINTERS_EQUAL(nicks[i],
+                           gui_nicklist_search_nick (buffer, NULL, name));
+        }
+    }
+
+    gui_nicklist_remove_all (buffer);
+    LONGS_EQUAL(0, buffer->nicklist_nicks_count);
+    POINTERS_EQUAL(NULL, buffer->nicklist_root->sorted_nicks);
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "alice"));
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_nicklist_set_batch
+ *   gui_nicklist_append_nick_unsorted
+ *   gui_nicklist_sort_nicks
+ */
+
+TEST(Nicklist, Batch)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group;
+    struct t_gui_nick *ptr_nick, *nicks[100];
+    struct t_hook *hook;
+    char name[64];
+    int i, count;
+
+    buffer = gui_buffer_new (NULL, "test_nicklist",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    group = gui_nicklist_add_group (buffer, NULL, "000|o", NULL, 1);
+    CHECK(group);
+
+    hook = hook_signal (NULL, "nicklist_*", &test_nicklist_signal_cb,
+                        NULL, NULL);
+    CHECK(hook);
+    test_nicklist_signals_count = 0;
+
+    /* end of batch without batch started: nothing done */
+    gui_nicklist_set_batch (buffer, 0);
+    LONGS_EQUAL(0, buffer->nicklist_batch);
+    LONGS_EQUAL(0, test_nicklist_signals_count);
+
+    /* add nicks in a batch, in random order: no signal sent */
+    gui_buffer_set (buffer, "nicklist_batch", "1");
+    LONGS_EQUAL(1, gui_buffer_get_integer (buffer, "nicklist_batch"));
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (name, sizeof (name), "%c%c_nick%d",
+                  'a' + ((i * 7) % 26), 'A' + ((i * 13) % 26), i);
+        nicks[i] = gui_nicklist_add_nick (buffer, (i % 3 == 0) ? group : NULL,
+                                          name, NULL, NULL, NULL, 1);
+        CHECK(nicks[i]);
+    }
+    gui_nicklist_nick_set (buffer, nicks[1], "color", "red");
+    LONGS_EQUAL(0, test_nicklist_signals_count);
+    LONGS_EQUAL(101, buffer->nicklist_batch_changes);
+    LONGS_EQUAL(1, buffer->nicklist_root->nicks_unsorted);
+    LONGS_EQUAL(1, group->nicks_unsorted);
+    for (i = 0; i < 100; i++)
+    {
+        POINTERS_EQUAL(nicks[i],
+                       gui_nicklist_search_nick (buffer, NULL,
+                                                 nicks[i]->name));
+    }
+
+    /* remove nicks while nicks are not sorted: no signal sent */
+    gui_nicklist_remove_nick (buffer, nicks[0]);
+    gui_nicklist_remove_nick (buffer, nicks[1]);
+    LONGS_EQUAL(0, test_nicklist_signals_count);
+    LONGS_EQUAL(103, buffer->nicklist_batch_changes);
+    LONGS_EQUAL(33, group->sorted_nicks_count);
+    LONGS_EQUAL(65, buffer->nicklist_root->sorted_nicks_count);
+
+    /* end of batch: nicks are sorted and one signal is sent */
+    test_nicklist_signals_count = 0;
+    gui_buffer_set (buffer, "nicklist_batch", "0");
+    LONGS_EQUAL(0, buffer->nicklist_batch);
+    LONGS_EQUAL(0, buffer->nicklist_batch_changes);
+    LONGS_EQUAL(1, test_nicklist_signals_count);
+    LONGS_EQUAL(0, buffer->nicklist_root->nicks_unsorted);
+    LONGS_EQUAL(0, group->nicks_unsorted);
+    count = 0;
+    for (ptr_nick = buffer->nicklist_root->nicks; ptr_nick;
+         ptr_nick = ptr_nick->next_nick)
+    {
+        POINTERS_EQUAL(buffer->nicklist_root->sorted_nicks[count], ptr_nick);
+        if (ptr_nick->next_nick)
+        {
+            CHECK(string_strcasecmp (ptr_nick->name,
+                                     ptr_nick->next_nick->name) <= 0);
+        }
+        count++;
+    }
+    LONGS_EQUAL(65, count);
+    POINTERS_EQUAL(buffer->nicklist_root->sorted_nicks[64],
+                   buffer->nicklist_root->last_nick);
+    count = 0;
+    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        if (ptr_nick->next_nick)
+        {
+            CHECK(string_strcasecmp (ptr_nick->name,
+                                     ptr_nick->next_nick->name) <= 0);
+        }
+        count++;
+    }
+    LONGS_EQUAL(33, count);
+
+    /* nick added after batch is inserted in sorted nicks */
+    test_nicklist_signals_count = 0;
+    ptr_nick = gui_nicklist_add_nick (buffer, NULL, "0_first",
+                                      NULL, NULL, NULL, 1);
+    CHECK(ptr_nick);
+    LONGS_EQUAL(1, test_nicklist_signals_count);
+    POINTERS_EQUAL(ptr_nick, buffer->nicklist_root->nicks);
+
+    unhook (hook);
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_bar_item_buffer_nicklist_count_lines
+ *   gui_bar_item_buffer_nicklist_build
+ */
+
+TEST(Nicklist, BarItem)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group;
+    char *str, name[64];
+    int i, max_length;
+
+    buffer = gui_buffer_new (NULL, "test_nicklist",
+                             NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    LONGS_EQUAL(0, gui_bar_item_buffer_nicklist_count_lines (buffer,
+                                                             &max_length));
+    LONGS_EQUAL(0, max_length);
+    str = gui_bar_item_buffer_nicklist_build (buffer, 0, -1);
+    STRCMP_EQUAL("", str);
+    free (str);
+
+    group = gui_nicklist_add_group (buffer, NULL, "000|o", NULL, 1);
+    CHECK(group);
+    for (i = 0; i < 10; i++)
+    {
+        snprintf (name, sizeof (name), "nick%d", i);
+        CHECK(gui_nicklist_add_nick (buffer, group, name,
+                                     NULL, "@", NULL, 1));
+    }
+    CHECK(gui_nicklist_add_nick (buffer, group, "hidden",
+                                 NULL, "@", NULL, 0));
+    group = gui_nicklist_add_group (buffer, NULL, "001|v", NULL, 1);
+    CHECK(group);
+    CHECK(gui_nicklist_add_nick (buffer, group, "long_nick",
+                                 NULL, NULL, NULL, 1));
+
+    /* 2 groups + 11 nicks (hidden nick is not counted) */
+    LONGS_EQUAL(13, gui_bar_item_buffer_nicklist_count_lines (buffer,
+                                                              &max_length));
+    LONGS_EQUAL(10, max_length);
+
+    /* whole nicklist */
+    str = gui_bar_item_buffer_nicklist_build (buffer, 0, -1);
+    STRCMP_EQUAL("o\n"
+                 " @nick0\n"
+                 " @nick1\n"
+                 " @nick2\n"
+                 " @nick3\n"
+                 " @nick4\n"
+                 " @nick5\n"
+                 " @nick6\n"
+                 " @nick7\n"
+                 " @nick8\n"
+                 " @nick9\n"
+                 "v\n"
+                 " long_nick",
+                 str);
+    free (str);
+
+    /* lines displayed in a bar window (scrolled) */
+    str = gui_bar_item_buffer_nicklist_build (buffer, 1, 3);
+    STRCMP_EQUAL(" @nick0\n @nick1\n @nick2", str);
+    free (str);
+    str = gui_bar_item_buffer_nicklist_build (buffer, 10, 5);
+    STRCMP_EQUAL(" @nick9\nv\n long_nick", str);
+    free (str);
+    str = gui_bar_item_buffer_nicklist_build (buffer, 20, 5);
+    STRCMP_EQUAL("", str);
+    free (str);
+
+    /* without groups */
+    gui_buffer_set (buffer, "nicklist_display_groups", "0");
+    LONGS_EQUAL(11, gui_bar_item_buffer_nicklist_count_lines (buffer, NULL));
+    str = gui_bar_item_buffer_nicklist_build (buffer, 9, 5);
+    STRCMP_EQUAL("@nick9\nlong_nick", str);
+    free (str);
+
+    gui_buffer_close (buffer);
+}